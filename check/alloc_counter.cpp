@@ -0,0 +1,85 @@
+/** @file alloc_counter.cpp
+ *
+ *  Replacement of the global operator new which counts the allocations of
+ *  a benchmark, and the peak number of live expression objects, for
+ *  bench_runner. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "memory_usage.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<unsigned long> allocations(0);
+
+void * operator new(std::size_t n)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	void * p = std::malloc(n ? n : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void * p) noexcept
+{
+	std::free(p);
+}
+
+/** Number of allocations so far, for benchmarks which measure parts of
+ *  the program. */
+unsigned long get_allocation_count()
+{
+	return allocations.load();
+}
+
+namespace {
+
+/** Writes the number of allocations to the file named by the environment
+ *  variable GINAC_BENCH_ALLOCATIONS, if it is set, at program exit. If the
+ *  variable GINAC_BENCH_OBJECTS is set, the live expression objects are
+ *  accounted from the start, and their peak number and bytes follow. */
+struct alloc_reporter {
+	alloc_reporter()
+	{
+		if (std::getenv("GINAC_BENCH_OBJECTS"))
+			GiNaC::set_memory_accounting_enabled(true);
+	}
+	~alloc_reporter()
+	{
+		const char * name = std::getenv("GINAC_BENCH_ALLOCATIONS");
+		if (!name)
+			return;
+		std::FILE * f = std::fopen(name, "w");
+		if (!f)
+			return;
+		std::fprintf(f, "%lu", allocations.load());
+		if (GiNaC::get_memory_accounting_enabled()) {
+			const GiNaC::memory_usage u = GiNaC::get_memory_usage();
+			std::fprintf(f, " %lu %llu", u.peak_objects, u.peak_bytes);
+		}
+		std::fprintf(f, "\n");
+		std::fclose(f);
+	}
+} reporter;
+
+} // anonymous namespace
@@ -0,0 +1,420 @@
+/** @file bench_runner.cpp
+ *
+ *  Runs the timing programs several times and writes wall and CPU times,
+ *  peak memory, allocation counts and peak numbers of live expression
+ *  objects as JSON or CSV. Optionally compares
+ *  them to a baseline written by an earlier run. Needs a POSIX system. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+/** Measurements of one run of a program. */
+struct run_result {
+	double wall;           // seconds
+	double cpu;            // user and system time, seconds
+	long max_rss;          // kilobytes
+	double allocations;    // -1 if the program doesn't count them
+	double peak_objects;   // live expression objects, -1 if not counted
+	double peak_object_kb; // their memory
+	bool ok;
+};
+
+/** Summary of the measured runs of a program. */
+struct bench_result {
+	string name;
+	unsigned repetitions;
+	double wall_min, wall_median;
+	double cpu_min, cpu_median;
+	long max_rss;
+	double allocations;
+	double peak_objects, peak_object_kb;
+	bool ok;
+};
+
+static double now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static double seconds(const struct timeval & tv)
+{
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static run_result run_once(const string & prog, bool objects, bool verbose)
+{
+	run_result r = { 0, 0, 0, -1, -1, -1, false };
+
+	char alloc_file[] = "/tmp/ginac_benchXXXXXX";
+	const int fd = mkstemp(alloc_file);
+	if (fd >= 0)
+		close(fd);
+
+	const double start = now();
+	const pid_t pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		return r;
+	}
+	if (pid == 0) {
+		if (fd >= 0)
+			setenv("GINAC_BENCH_ALLOCATIONS", alloc_file, 1);
+		if (objects)
+			setenv("GINAC_BENCH_OBJECTS", "1", 1);
+		if (!verbose) {
+			const int null = open("/dev/null", O_WRONLY);
+			if (null >= 0) {
+				dup2(null, 1);
+				close(null);
+			}
+		}
+		execl(prog.c_str(), prog.c_str(), (char *)0);
+		perror(prog.c_str());
+		_exit(127);
+	}
+
+	int status;
+	struct rusage ru;
+	if (wait4(pid, &status, 0, &ru) < 0) {
+		perror("wait4");
+		return r;
+	}
+	r.wall = now() - start;
+	r.cpu = seconds(ru.ru_utime) + seconds(ru.ru_stime);
+	r.max_rss = ru.ru_maxrss;
+	r.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+	if (fd >= 0) {
+		// The allocations, followed by the peak live objects and their
+		// bytes if the program has counted them
+		ifstream in(alloc_file);
+		double n, objs, bytes;
+		if (in >> n)
+			r.allocations = n;
+		if (in >> objs >> bytes) {
+			r.peak_objects = objs;
+			r.peak_object_kb = bytes / 1024;
+		}
+		unlink(alloc_file);
+	}
+	return r;
+}
+
+static double median(vector<double> v)
+{
+	sort(v.begin(), v.end());
+	const size_t n = v.size();
+	if (n == 0)
+		return 0;
+	return n % 2 ? v[n/2] : (v[n/2 - 1] + v[n/2]) / 2;
+}
+
+static string base_name(const string & path)
+{
+	const string::size_type slash = path.rfind('/');
+	return slash == string::npos ? path : path.substr(slash + 1);
+}
+
+static bench_result run_benchmark(const string & prog, unsigned warmup, unsigned repetitions, bool objects, bool verbose)
+{
+	bench_result b;
+	b.name = base_name(prog);
+	b.repetitions = repetitions;
+	b.max_rss = 0;
+	b.allocations = -1;
+	b.peak_objects = b.peak_object_kb = -1;
+	b.ok = true;
+
+	for (unsigned i = 0; i < warmup && b.ok; ++i)
+		b.ok = run_once(prog, objects, verbose).ok;
+
+	vector<double> wall, cpu, allocs;
+	for (unsigned i = 0; i < repetitions && b.ok; ++i) {
+		const run_result r = run_once(prog, objects, verbose);
+		b.ok = r.ok;
+		wall.push_back(r.wall);
+		cpu.push_back(r.cpu);
+		b.max_rss = max(b.max_rss, r.max_rss);
+		if (r.allocations >= 0)
+			allocs.push_back(r.allocations);
+		b.peak_objects = max(b.peak_objects, r.peak_objects);
+		b.peak_object_kb = max(b.peak_object_kb, r.peak_object_kb);
+	}
+
+	b.wall_min = wall.empty() ? 0 : *min_element(wall.begin(), wall.end());
+	b.wall_median = median(wall);
+	b.cpu_min = cpu.empty() ? 0 : *min_element(cpu.begin(), cpu.end());
+	b.cpu_median = median(cpu);
+	if (!allocs.empty())
+		b.allocations = median(allocs);
+	return b;
+}
+
+// The fields of the output, in this order
+static const char * const field_names[] = {
+	"name", "ok", "repetitions", "wall_min", "wall_median",
+	"cpu_min", "cpu_median", "max_rss_kb", "allocations",
+	"peak_objects", "peak_object_kb"
+};
+static const size_t num_fields = sizeof(field_names) / sizeof(field_names[0]);
+
+static vector<string> fields(const bench_result & b)
+{
+	vector<string> v;
+	ostringstream s;
+	s << setprecision(6);
+	s << b.repetitions << ' ' << b.wall_min << ' ' << b.wall_median << ' '
+	  << b.cpu_min << ' ' << b.cpu_median << ' ' << b.max_rss << ' '
+	  << setprecision(12) << b.allocations << ' ' << b.peak_objects << ' '
+	  << b.peak_object_kb;
+	istringstream in(s.str());
+	v.push_back(b.name);
+	v.push_back(b.ok ? "1" : "0");
+	string f;
+	while (in >> f)
+		v.push_back(f);
+	return v;
+}
+
+static void write_csv(ostream & os, const vector<bench_result> & results)
+{
+	for (size_t i = 0; i < num_fields; ++i)
+		os << (i ? "," : "") << field_names[i];
+	os << endl;
+	for (size_t r = 0; r < results.size(); ++r) {
+		const vector<string> v = fields(results[r]);
+		for (size_t i = 0; i < v.size(); ++i)
+			os << (i ? "," : "") << v[i];
+		os << endl;
+	}
+}
+
+/** Writes one object per line, so that read_results() can find them
+ *  without a real JSON parser. */
+static void write_json(ostream & os, const vector<bench_result> & results)
+{
+	os << "[" << endl;
+	for (size_t r = 0; r < results.size(); ++r) {
+		const vector<string> v = fields(results[r]);
+		os << "  {";
+		for (size_t i = 0; i < v.size(); ++i) {
+			os << (i ? ", " : "") << '"' << field_names[i] << "\": ";
+			if (i == 0)
+				os << '"' << v[i] << '"';
+			else
+				os << v[i];
+		}
+		os << "}" << (r + 1 < results.size() ? "," : "") << endl;
+	}
+	os << "]" << endl;
+}
+
+/** The value of a field in a line written by write_json(). */
+static string json_field(const string & line, const string & name)
+{
+	const string key = "\"" + name + "\": ";
+	string::size_type pos = line.find(key);
+	if (pos == string::npos)
+		return "";
+	pos += key.size();
+	if (line[pos] == '"') {
+		const string::size_type end = line.find('"', pos + 1);
+		return line.substr(pos + 1, end - pos - 1);
+	}
+	const string::size_type end = line.find_first_of(",}", pos);
+	return line.substr(pos, end - pos);
+}
+
+/** Read a file written by write_csv() or write_json() into a map from the
+ *  benchmark names to their fields. */
+static bool read_results(const string & file, map<string, map<string, double> > & results)
+{
+	ifstream in(file.c_str());
+	if (!in)
+		return false;
+	string line;
+	vector<string> header;
+	while (getline(in, line)) {
+		const string::size_type first = line.find_first_not_of(" \t");
+		if (first == string::npos || line[first] == '[' || line[first] == ']')
+			continue;
+		map<string, double> row;
+		string name;
+		if (line[first] == '{') {
+			name = json_field(line, "name");
+			for (size_t i = 1; i < num_fields; ++i)
+				row[field_names[i]] = atof(json_field(line, field_names[i]).c_str());
+		} else {
+			vector<string> v;
+			istringstream s(line);
+			string f;
+			while (getline(s, f, ','))
+				v.push_back(f);
+			if (header.empty()) {
+				header = v;
+				continue;
+			}
+			for (size_t i = 0; i < v.size() && i < header.size(); ++i) {
+				if (header[i] == "name")
+					name = v[i];
+				else
+					row[header[i]] = atof(v[i].c_str());
+			}
+		}
+		if (!name.empty())
+			results[name] = row;
+	}
+	return true;
+}
+
+/** Print the ratios of the results to the baseline and count the
+ *  benchmarks whose CPU time, peak memory, allocations or peak number of
+ *  live objects grew by more than threshold percent. */
+static unsigned compare(const vector<bench_result> & results, const map<string, map<string, double> > & baseline, double threshold)
+{
+	unsigned regressions = 0;
+	const double limit = 1 + threshold / 100;
+	clog << setprecision(3) << left;
+	clog << setw(24) << "benchmark" << setw(10) << "cpu" << setw(10) << "wall"
+	     << setw(10) << "rss" << setw(10) << "allocs" << setw(10) << "objects" << endl;
+	for (size_t r = 0; r < results.size(); ++r) {
+		const bench_result & b = results[r];
+		map<string, map<string, double> >::const_iterator it = baseline.find(b.name);
+		if (it == baseline.end()) {
+			clog << setw(24) << b.name << "not in baseline" << endl;
+			continue;
+		}
+		map<string, double> base = it->second;
+		const double cpu = base["cpu_median"] > 0 ? b.cpu_median / base["cpu_median"] : 1;
+		const double wall = base["wall_median"] > 0 ? b.wall_median / base["wall_median"] : 1;
+		const double rss = base["max_rss_kb"] > 0 ? b.max_rss / base["max_rss_kb"] : 1;
+		const double allocs = base["allocations"] > 0 && b.allocations >= 0 ? b.allocations / base["allocations"] : 1;
+		const double objects = base["peak_objects"] > 0 && b.peak_objects >= 0 ? b.peak_objects / base["peak_objects"] : 1;
+		const bool regressed = cpu > limit || rss > limit || allocs > limit || objects > limit;
+		if (regressed)
+			++regressions;
+		clog << setw(24) << b.name << setw(10) << cpu << setw(10) << wall
+		     << setw(10) << rss << setw(10) << allocs << setw(10) << objects
+		     << (regressed ? "REGRESSION" : "") << endl;
+	}
+	return regressions;
+}
+
+static void usage()
+{
+	cerr << "usage: bench_runner [options] program..." << endl
+	     << "  -r N      measured runs of each program (default 5)" << endl
+	     << "  -w N      warm-up runs of each program (default 1)" << endl
+	     << "  -f FMT    output format, json (default) or csv" << endl
+	     << "  -o FILE   write the results to FILE instead of standard output" << endl
+	     << "  -b FILE   compare with the results in FILE" << endl
+	     << "  -t PCT    report a regression if the CPU time, the peak memory, the" << endl
+	     << "            number of allocations or the peak number of live objects" << endl
+	     << "            grow by more than PCT percent (default 10)" << endl
+	     << "  -m        count the live expression objects (slows the programs down)" << endl
+	     << "  -v        show the output of the programs" << endl
+	     << "The exit status is 1 if there are regressions and 2 if a program fails." << endl;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned repetitions = 5, warmup = 1;
+	string format = "json", output, baseline_file;
+	double threshold = 10;
+	bool objects = false, verbose = false;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "r:w:f:o:b:t:mvh")) != -1) {
+		switch (opt) {
+			case 'r': repetitions = max(1, atoi(optarg)); break;
+			case 'w': warmup = max(0, atoi(optarg)); break;
+			case 'f': format = optarg; break;
+			case 'o': output = optarg; break;
+			case 'b': baseline_file = optarg; break;
+			case 't': threshold = atof(optarg); break;
+			case 'm': objects = true; break;
+			case 'v': verbose = true; break;
+			default: usage(); return 2;
+		}
+	}
+	if (optind == argc || (format != "json" && format != "csv")) {
+		usage();
+		return 2;
+	}
+
+	map<string, map<string, double> > baseline;
+	if (!baseline_file.empty() && !read_results(baseline_file, baseline)) {
+		cerr << "cannot read " << baseline_file << endl;
+		return 2;
+	}
+
+	vector<bench_result> results;
+	bool failed = false;
+	for (int i = optind; i < argc; ++i) {
+		clog << "running " << argv[i] << endl;
+		results.push_back(run_benchmark(argv[i], warmup, repetitions, objects, verbose));
+		if (!results.back().ok) {
+			clog << argv[i] << " failed" << endl;
+			failed = true;
+		}
+	}
+
+	ofstream file;
+	if (!output.empty()) {
+		file.open(output.c_str());
+		if (!file) {
+			cerr << "cannot write " << output << endl;
+			return 2;
+		}
+	}
+	ostream & os = output.empty() ? cout : file;
+	if (format == "csv")
+		write_csv(os, results);
+	else
+		write_json(os, results);
+
+	unsigned regressions = 0;
+	if (!baseline_file.empty())
+		regressions = compare(results, baseline, threshold);
+
+	if (failed)
+		return 2;
+	return regressions ? 1 : 0;
+}
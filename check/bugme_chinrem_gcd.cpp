@@ -66,12 +66,26 @@ static void integer_coeff_braindamage()
 	}
 }
 
+static void check_multivariate()
+{
+	parser readme;
+	ex d = readme("2*x^3*y - 5*y^2*z^4 + 7*x*z - 3");
+	ex A = expand(d*readme("x^2*y^3 + z - 11*x*y*z^2 + 1"));
+	ex B = expand(6*d*readme("y*z^5 - 4*x^4 + 13*x*y^2"));
+	ex g = chinrem_gcd(A, B);
+	if (!(g - d).expand().is_zero() && !(g + d).expand().is_zero()) {
+		std::cerr << "expected " << d << ", got " << g << std::endl;
+		throw std::logic_error("chinrem_gcd failed on multivariate input");
+	}
+}
+
 int main(int argc, char** argv)
 {
 	cout << "checking for bugs in poly_cra() and friends " << flush;
 	check_poly_cra();
 	check_extract_integer_content();
 	integer_coeff_braindamage();
+	check_multivariate();
 	cout << "not found.";
 	return 0;
 }
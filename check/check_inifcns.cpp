@@ -191,7 +191,28 @@ static unsigned inifcns_check_Li2()
 	
 	if (errorflag)
 		++result;
-	
+
+	// check some known values to high precision, with floating point
+	// arguments so that they are not evaluated exactly
+	const long digits = Digits;
+	Digits = 50;
+	const ex one = numeric(1).evalf();
+	const ex known[][2] = {
+		{ Li2(-one), -pow(Pi, 2)/12 },
+		{ Li2(one/2), pow(Pi, 2)/12 - pow(log(2), 2)/2 },
+		{ Li2(one*I), -pow(Pi, 2)/48 + Catalan*I },
+		{ Li2(-one/2), -Li2(one/3) - pow(log(numeric(3, 2)), 2)/2 },
+		{ Li2((sqrt(5) - 1).evalf()/2), pow(Pi, 2)/10 - pow(log((sqrt(5) - 1)/2), 2) },
+		{ Li2((3 - sqrt(5)).evalf()/2), pow(Pi, 2)/15 - pow(log((sqrt(5) - 1)/2), 2) }
+	};
+	for (size_t i = 0; i < sizeof(known) / sizeof(known[0]); ++i) {
+		if (abs(ex_to<numeric>((known[i][0] - known[i][1]).evalf())) > numeric(1, 10).power(45)) {
+			clog << known[i][0] << " is not " << known[i][1].evalf() << endl;
+			++result;
+		}
+	}
+	Digits = digits;
+
 	return result;
 }
 
@@ -25,8 +25,191 @@ using namespace GiNaC;
 
 #include <fstream>
 #include <iostream>
+#include <sstream>
 using namespace std;
 
+// Write an indexed archive and unarchive parts of it.
+static unsigned exam_indexed_archive(const ex & e, const lst & syms)
+{
+	unsigned result = 0;
+	symbol x("x"), y("y");
+	ex common = pow(sin(x) + 3*y, 5) * cos(y);
+
+	archive ar;
+	ar.archive_ex(e, "expr 1");
+	ar.archive_ex(lst(common, x), "expr 2");
+	ar.archive_ex(lst(common, y), "expr 3");
+	{
+		std::ofstream fout("exam.gari", std::ios_base::binary);
+		ar.write_indexed(fout);
+	}
+
+	indexed_archive iar("exam.gari");
+	if (iar.num_expressions() != 3 || iar.get_name(2) != "expr 3") {
+		clog << "indexed archive has wrong table of expressions" << endl;
+		++result;
+	}
+
+	// Only the nodes of the requested expressions are decoded
+	ex f2 = iar.unarchive_ex(lst(x, y), "expr 2");
+	if (!f2.is_equal(lst(common, x))) {
+		clog << "indexed archive returned " << f2 << " instead of " << lst(common, x) << endl;
+		++result;
+	}
+	if (iar.num_loaded_nodes() >= iar.num_nodes() / 2) {
+		clog << "indexed archive decoded " << iar.num_loaded_nodes()
+		     << " of " << iar.num_nodes() << " nodes for a small expression" << endl;
+		++result;
+	}
+
+	// Shared subexpressions are unarchived only once
+	ex f3 = iar.unarchive_ex(lst(x, y), 2);
+	if (!f3.is_equal(lst(common, y)) || !are_ex_trivially_equal(f2.op(0), f3.op(0))) {
+		clog << "indexed archive returned " << f3 << " instead of " << lst(common, y)
+		     << " sharing " << f2.op(0) << endl;
+		++result;
+	}
+
+	// Archives held in memory can be read as well
+	std::ostringstream os;
+	ar.write_indexed(os);
+	std::string data = os.str();
+	indexed_archive mar(data.data(), data.size());
+
+	// The structure can be examined without decoding any node
+	indexed_archive::node_info info;
+	mar.get_node_info(mar.get_root(1), info);
+	if (info.class_name != "lst" || info.children.size() != 2 || info.size == 0
+	 || mar.num_loaded_nodes() != 0) {
+		clog << "indexed archive reported class " << info.class_name << " with "
+		     << info.children.size() << " children for " << lst(common, x) << endl;
+		++result;
+	}
+
+	ex f1 = mar.unarchive_ex(syms, "expr 1");
+	if (!(f1 - e).expand().is_zero()) {
+		clog << "indexed archive returned " << f1 << " instead of " << e << endl;
+		++result;
+	}
+
+	return result;
+}
+
+// Write an archive with archive_writer and read it back.
+static unsigned exam_archive_writer(const ex & e, const lst & syms)
+{
+	unsigned result = 0;
+	symbol x("x"), y("y");
+	ex common = pow(sin(x) + 3*y, 5) * cos(y);
+
+	std::ostringstream os;
+	archive_writer w(os, true);
+	w.archive_ex(e, "expr 1");
+	w.archive_ex(lst(common, x), "expr 2");
+	unsigned n = w.num_nodes();
+	w.archive_ex(lst(common, y), "expr 3");
+	w.finish();
+
+	// Only the list is new in the last expression
+	if (w.num_nodes() != n + 1) {
+		clog << "archive_writer wrote " << w.num_nodes() - n
+		     << " nodes for an expression with 1 new node" << endl;
+		++result;
+	}
+
+	std::string data = os.str();
+	archive ar;
+	{
+		std::istringstream is(data);
+		is >> ar;
+	}
+	ex f1 = ar.unarchive_ex(syms, "expr 1");
+	ex f3 = ar.unarchive_ex(lst(x, y), 2);
+	if (!(f1 - e).expand().is_zero() || !f3.is_equal(lst(common, y))) {
+		clog << "streamed archive returned " << f1 << " and " << f3 << endl;
+		++result;
+	}
+
+	indexed_archive iar(data.data(), data.size());
+	ex f2 = iar.unarchive_ex(lst(x, y), "expr 2");
+	if (!f2.is_equal(lst(common, x)) || iar.num_nodes() != w.num_nodes()) {
+		clog << "index of streamed archive returned " << f2 << endl;
+		++result;
+	}
+
+	return result;
+}
+
+// Write a compressed archive and read it back.
+static unsigned exam_compressed_archive(const ex & e, const lst & syms)
+{
+	unsigned result = 0;
+	symbol x("x");
+	ex big;
+	for (int i=0; i<200; ++i)
+		big += pow(x, i) * sin(i*x);
+
+	archive ar;
+	ar.archive_ex(e, "expr 1");
+	ar.archive_ex(big, "expr 2");
+
+	std::ostringstream plain, compressed;
+	plain << ar;
+	ar.write_compressed(compressed, 256);
+	if (compressed.str().size() >= plain.str().size()) {
+		clog << "compressed archive has " << compressed.str().size()
+		     << " bytes, uncompressed " << plain.str().size() << endl;
+		++result;
+	}
+
+	archive ar2;
+	{
+		std::istringstream is(compressed.str());
+		is >> ar2;
+	}
+	ex f1 = ar2.unarchive_ex(syms, "expr 1");
+	ex f2 = ar2.unarchive_ex(lst(x), "expr 2");
+	if (!(f1 - e).expand().is_zero() || !(f2 - big).is_zero()) {
+		clog << "compressed archive returned " << f1 << " and " << f2 << endl;
+		++result;
+	}
+
+	return result;
+}
+
+// Archive numbers large enough to be stored in binary.
+static unsigned exam_binary_numbers()
+{
+	unsigned result = 0;
+	symbol x("x");
+	long save_digits = Digits;
+	Digits = 200;
+
+	ex e = lst(pow(numeric(3), 500) / pow(numeric(7), 300) * x,
+	           -pow(numeric(2), 64) + I * pow(numeric(5), 100) / 3,
+	           evalf(Pi) * x, evalf(sqrt(ex(2)) - I * pow(numeric(10), 50)),
+	           ex(1)/3 + evalf(exp(ex(-1))) * I, numeric(-7, 2));
+	archive ar(e, "e");
+	std::ostringstream os;
+	os << ar;
+	archive ar2;
+	{
+		std::istringstream is(os.str());
+		is >> ar2;
+	}
+	ex f = ar2.unarchive_ex(lst(x), "e");
+	for (size_t i=0; i<e.nops(); ++i) {
+		if (!f.op(i).is_equal(e.op(i))) {
+			clog << "archiving/unarchiving " << e.op(i) << endl
+			     << "erroneously returned " << f.op(i) << endl;
+			++result;
+		}
+	}
+
+	Digits = save_digits;
+	return result;
+}
+
 unsigned exam_archive()
 {
 	unsigned result = 0;
@@ -73,6 +256,26 @@ unsigned exam_archive()
 		++result;
 	}
 
+	// Archive more expressions into the archive which has been read, with
+	// new atoms, and unarchive all of them again
+	ar.archive_ex(pow(x, 3) + sqrt(mu), "expr 2");
+	ar.archive_ex(matrix(2, 2, lst(x, 1, 2, y)), "expr 3");
+	ar.forget();
+	f = ar.unarchive_ex(lst(x, y, mu, dim), "expr 1");
+	ex g = ar.unarchive_ex(lst(x, y, mu, dim), "expr 2");
+	ex h = ar.unarchive_ex(lst(x, y, mu, dim), "expr 3");
+	if (!(f - e).expand().is_zero() || !g.is_equal(pow(x, 3) + sqrt(mu))
+	 || !h.is_equal(matrix(2, 2, lst(x, 1, 2, y)))) {
+		clog << "unarchiving after adding expressions returned " << f
+		     << ", " << g << " and " << h << endl;
+		++result;
+	}
+
+	result += exam_binary_numbers();
+	result += exam_indexed_archive(e, lst(x, y, mu, dim));
+	result += exam_archive_writer(e, lst(x, y, mu, dim));
+	result += exam_compressed_archive(e, lst(x, y, mu, dim));
+
 	return result;
 }
 
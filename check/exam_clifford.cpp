@@ -252,6 +252,28 @@ static unsigned clifford_check3()
 	//result += check_equal_simplify(dirac_trace(e, 2), canonicalize_clifford(e)); // e will be canonicalized by the calculation of the trace
 	result += check_equal_simplify(dirac_trace(e, lst(0, 1)), 16 * dim);
 
+	// long strings, whose traces reuse those of their substrings
+	exvector ix;
+	ix.push_back(varidx(symbol("a0"), dim));
+	ix.push_back(varidx(symbol("a1"), dim));
+	ix.push_back(varidx(symbol("a2"), dim));
+	ix.push_back(varidx(symbol("a3"), dim));
+	ix.push_back(varidx(symbol("a4"), dim));
+	e = dirac_ONE();
+	for (int i = 0; i < 5; ++i)
+		e = e * dirac_gamma(ix[i]);
+	for (int i = 4; i >= 0; --i)
+		e = e * dirac_gamma(ex_to<varidx>(ix[i]).toggle_variance());
+	result += check_equal_simplify(dirac_trace(e), 4 * pow(dim, 5));
+
+	e = dirac_gamma(mu) * dirac_gamma(nu) * dirac_gamma(rho) * dirac_gamma(sig) * dirac_gamma(kap)
+	  * dirac_gamma(lam) * dirac_gamma(ix[0]) * dirac_gamma(ix[1]) * dirac_gamma(ix[2]) * dirac_gamma(ix[3]);
+	ex tr = dirac_trace(e);
+	result += check_equal((tr - dirac_trace(e, 0, 4, dirac_trace_options::parallel)).expand(), 0);
+	e = dirac_gamma(ix[3]) * dirac_gamma(ix[2]) * dirac_gamma(ix[1]) * dirac_gamma(ix[0]) * dirac_gamma(lam)
+	  * dirac_gamma(kap) * dirac_gamma(sig) * dirac_gamma(rho) * dirac_gamma(nu) * dirac_gamma(mu);
+	result += check_equal((tr - dirac_trace(e)).expand(), 0);
+
 	return result;
 }
 
@@ -314,6 +336,15 @@ static unsigned clifford_check5()
 	  - dirac_gamma(mu) * dirac_gamma(nu) * dirac_gamma(lam);
 	result += check_equal(canonicalize_clifford(e), 0);
 
+	// longer strings keep their traces, and canonicalization is linear
+	// and idempotent
+	varidx rho(symbol("rho"), dim), sig(symbol("sig"), dim), tau(symbol("tau"), dim);
+	e = dirac_gamma(tau) * dirac_gamma(sig) * dirac_gamma(rho) * dirac_gamma(lam) * dirac_gamma(nu) * dirac_gamma(mu);
+	ex c = canonicalize_clifford(e);
+	result += check_equal((dirac_trace(c) - dirac_trace(e)).expand().simplify_indexed(), 0);
+	ex r = dirac_gamma(mu) * dirac_gamma(nu) * dirac_gamma(lam) * dirac_gamma(rho) * dirac_gamma(sig) * dirac_gamma(tau);
+	result += check_equal(canonicalize_clifford(e + r - c - canonicalize_clifford(r)), 0);
+
 	return result;
 }
 
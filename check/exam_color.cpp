@@ -144,6 +144,36 @@ static unsigned color_check3()
 	return result;
 }
 
+static unsigned color_check4()
+{
+	// color factors in SU(N)
+
+	unsigned result = 0;
+
+	symbol N("N");
+	idx a(symbol("a"), 8), b(symbol("b"), 8), c(symbol("c"), 8), d(symbol("d"), 8), e(symbol("e"), 8);
+
+	result += check_equal(color_factor(color_f(a, b, c) * color_f(a, b, c), N), N * (pow(N, 2) - 1));
+	result += check_equal((color_factor(color_d(a, b, c) * color_d(a, b, c), N)
+	                       - (pow(N, 2) - 4) * (pow(N, 2) - 1) / N).expand(), 0);
+	result += check_equal(color_factor(color_T(a) * color_T(b) * color_T(a) * color_T(b), N).expand(),
+	                      (-(pow(N, 2) - 1) / (4 * N)).expand());
+	result += check_equal(color_factor(color_f(a, b, c) * color_T(a) * color_T(b) * color_T(c), N).expand(),
+	                      (I * N * (pow(N, 2) - 1) / 4).expand());
+	result += check_equal(color_factor(color_ONE() + delta_tensor(a, b) * delta_tensor(a, b), N).expand(),
+	                      (N + pow(N, 2) - 1).expand());
+
+	ex s = color_f(a, b, e) * color_f(c, d, e) * color_T(a) * color_T(b) * color_T(c) * color_T(d);
+	result += check_equal(color_factor(s, N).expand(), (-pow(N, 2) * (pow(N, 2) - 1) / 8).expand());
+	result += check_equal_simplify(color_trace(s), color_factor(s));
+
+	s = color_d(a, b, e) * color_f(c, d, e) * color_T(a) * color_T(c) * color_T(b) * color_T(d)
+	  + color_T(a) * color_T(b) * color_T(c) * color_T(a) * color_T(b) * color_T(c);
+	result += check_equal_simplify(color_trace(s), color_factor(s));
+
+	return result;
+}
+
 unsigned exam_color()
 {
 	unsigned result = 0;
@@ -153,6 +183,7 @@ unsigned exam_color()
 	result += color_check1();  cout << '.' << flush;
 	result += color_check2();  cout << '.' << flush;
 	result += color_check3();  cout << '.' << flush;
+	result += color_check4();  cout << '.' << flush;
 	
 	return result;
 }
@@ -28,10 +28,10 @@ using namespace std;
 
 static symbol w("w"), x("x"), y("y"), z("z");
 
-static unsigned check_factor(const ex& e)
+static unsigned check_factor(const ex& e, unsigned options = 0)
 {
 	ex ee = e.expand();
-	ex answer = factor(ee);
+	ex answer = factor(ee, options);
 	if ( answer.expand() != ee || answer != e ) {
 		clog << "factorization of " << e << " == " << ee << " gave wrong result: " << answer << endl;
 		return 1;
@@ -105,6 +105,21 @@ static unsigned exam_factor1()
 	e = ex("(77+11*x^3+25*x^2+27*x+102*x^4)*(85+57*x^3+92*x^2+29*x+66*x^4)", syms);
 	result += check_factor(e);
 
+	// irreducible, but splits into factors of degree 32 or less modulo the
+	// primes, exercising equal degree factorization
+	e = ex("x^64+1", syms);
+	result += check_factor(e);
+
+	e = ex("(1+x^64)*(1-x^31+x^40)", syms);
+	result += check_factor(e);
+
+	// Swinnerton-Dyer polynomials: irreducible, but many modular factors
+	e = ex("x^16-136*x^14+6476*x^12-141912*x^10+1513334*x^8-7453176*x^6+13950764*x^4-5596840*x^2+46225", syms);
+	result += check_factor(e);
+
+	e = ex("(x^8-40*x^6+352*x^4-960*x^2+576)*(x^16+16*x^15-16*x^14-1344*x^13-4080*x^12+32576*x^11+157376*x^10-255232*x^9-2062624*x^8-249088*x^7+10702080*x^6+9126912*x^5-18643712*x^4-24167424*x^3+2712576*x^2+10653696*x+2324736)", syms);
+	result += check_factor(e);
+
 	return result;
 }
 
@@ -184,6 +199,58 @@ static unsigned exam_factor3()
 	return result;
 }
 
+/* Factorization using several threads must give the same result (even if
+ * the library is not thread-safe and the option is ignored). */
+static unsigned exam_factor_parallel()
+{
+	unsigned result = 0;
+	ex e;
+	symbol x("x"), y("y"), z("z");
+	lst syms;
+	syms = x, y, z;
+
+	e = ex("(16+x^2*z^3)*(-17+3*x-5*z)*(2*x+3*z)*(x-y^2-z^3)", syms);
+	result += check_factor(e, factor_options::parallel);
+
+	e = ex("327*(x+z^2+x^3)*(3*x-4*z)*(-7+5*x-x^3)*(1+x+x^2)", syms);
+	result += check_factor(e, factor_options::parallel);
+
+	e = ex("390*(-1+x^6-x)*(7+3*x^4)*(2+x^2)*(y+x)*(-1+y-x^2)*(1+x^2+x)^2", syms);
+	result += check_factor(e, factor_options::parallel);
+
+	return result;
+}
+
+/* Polynomials whose factorization is decided (or not) by the degrees of the
+ * modular factors. */
+static unsigned exam_factor_degree_pattern()
+{
+	unsigned result = 0;
+	ex e;
+	symbol x("x");
+	lst syms;
+	syms.append(x);
+
+	// irreducible, proved by the degree patterns
+	e = ex("-1-x+x^5", syms);
+	result += check_factor(e);
+
+	e = ex("3+3*x^2+x^11", syms);
+	result += check_factor(e);
+
+	// irreducible, but splits modulo every prime
+	e = ex("1-10*x^2+x^4", syms);
+	result += check_factor(e);
+
+	e = ex("(-1-x+x^5)*(2+2*x+x^7)", syms);
+	result += check_factor(e);
+
+	e = ex("(1-10*x^2+x^4)*(-2+x^3)", syms);
+	result += check_factor(e);
+
+	return result;
+}
+
 unsigned exam_factor()
 {
 	unsigned result = 0;
@@ -193,6 +260,8 @@ unsigned exam_factor()
 	result += exam_factor1(); cout << '.' << flush;
 	result += exam_factor2(); cout << '.' << flush;
 	result += exam_factor3(); cout << '.' << flush;
+	result += exam_factor_parallel(); cout << '.' << flush;
+	result += exam_factor_degree_pattern(); cout << '.' << flush;
 
 	return result;
 }
@@ -284,6 +284,49 @@ unsigned exam_hashmap()
 	}
 	cout << '.' << flush;
 
+	// Test many insertions and erasures, which leave erased buckets behind
+	exhashmap<unsigned> M7;
+	for (unsigned i = 0; i < 10000; ++i) {
+		M7[numeric(i)] = i;
+		if (i >= 10)
+			M7.erase(numeric(i - 10));
+	}
+	if (M7.size() != 10 || M7.bucket_count() > 64) {
+		clog << "After inserting 10000 and erasing 9990 elements, size() is " << M7.size()
+		     << " and bucket_count() is " << M7.bucket_count() << endl;
+		++result;
+	}
+	for (unsigned i = 0; i < 10000; ++i) {
+		if (M7.count(numeric(i)) != (i >= 9990 ? 1 : 0)) {
+			clog << "count(" << i << ") is wrong after erasures" << endl;
+			++result;
+			break;
+		}
+	}
+	cout << '.' << flush;
+
+	// Test exhashset
+	exhashset S;
+	S.insert(x);
+	S.insert(y);
+	S.insert(x + y);
+	if (S.insert(x).second || S.size() != 3 || S.count(y) != 1 || S.count(x*y) != 0) {
+		clog << "exhashset doesn't hold {x, y, x+y}" << endl;
+		++result;
+	}
+	S.erase(y);
+	unsigned elements = 0;
+	for (exhashset::const_iterator it = S.begin(); it != S.end(); ++it, ++elements)
+		if (!it->is_equal(x) && !it->is_equal(x + y)) {
+			clog << "exhashset contains " << *it << " instead of x or x+y" << endl;
+			++result;
+		}
+	if (elements != 2 || S.find(y) != S.end()) {
+		clog << "exhashset has " << elements << " elements after erase(y) instead of 2" << endl;
+		++result;
+	}
+	cout << '.' << flush;
+
 	return result;
 }
 
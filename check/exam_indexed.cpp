@@ -82,6 +82,19 @@ static unsigned delta_check()
 	result += check_equal_simplify(delta_tensor(i, j) * indexed(A, i), indexed(A, j));
 	result += check_equal_simplify(delta_tensor(i, j) * delta_tensor(j, k) * indexed(A, i), indexed(A, k));
 
+	// long chain of contractions, in scrambled order
+	exvector chain;
+	ex prod = 1;
+	ex last = i;
+	for (int n = 0; n < 60; ++n) {
+		ex next = idx((new symbol)->setflag(status_flags::dynallocated), 3);
+		chain.push_back(delta_tensor(last, next));
+		last = next;
+	}
+	for (int n = 0; n < 60; ++n)
+		prod *= chain[(n * 37) % 60];
+	result += check_equal_simplify(prod * indexed(A, last), indexed(A, i));
+
 	return result;
 }
 
@@ -196,6 +209,18 @@ static unsigned symmetry_check()
 	result += check_equal(symmetrize(e), 0);
 	result += check_equal(antisymmetrize(e), e);
 
+	e = indexed(A, sy_symm(), i, j, k) * indexed(B, l);
+	result += check_equal(symmetrize(e, lst(i, j, k, l)),
+	                      (e + indexed(A, sy_symm(), j, k, l) * indexed(B, i)
+	                         + indexed(A, sy_symm(), i, k, l) * indexed(B, j)
+	                         + indexed(A, sy_symm(), i, j, l) * indexed(B, k)) / 4);
+	result += check_equal(antisymmetrize(e, lst(i, j, k, l)), 0);
+	e = indexed(A, sy_anti(), i, j) * indexed(B, k);
+	result += check_equal(antisymmetrize(e, lst(i, j, k)),
+	                      (e + indexed(A, sy_anti(), j, k) * indexed(B, i)
+	                         + indexed(A, sy_anti(), k, i) * indexed(B, j)) / 3);
+	result += check_equal(symmetrize(e, lst(i, j, k)), 0);
+
 	e = (indexed(A, sy_anti(), i, j, k, l) * (indexed(B, j) * indexed(C, k) + indexed(B, k) * indexed(C, j)) + indexed(B, i, l)).expand();
 	result += check_equal_simplify(e, indexed(B, i, l));
 
@@ -226,6 +251,32 @@ static unsigned scalar_product_check()
 	e = indexed(A, i, i) * indexed(B, j, j); // GiNaC 0.8.0 had a bug here
 	result += check_equal_simplify(e, e, sp);
 
+	// vectors with products of their components, in either order
+	symbol a("a"), b("b"), c("c");
+	scalar_products sp2;
+	sp2.add_vectors(lst(a, b, c));
+	e = indexed(a, i) * indexed(b, i) + indexed(c, j) * indexed(a, j) + indexed(c, i) * indexed(c, i);
+	result += check_equal_simplify(e, a * b + a * c + pow(c, 2), sp2);
+	if (!sp2.is_defined(b, a, 3) || !sp2.evaluate(b, a, 3).is_equal(a * b)) {
+		clog << "scalar product of b and a erroneously not found" << endl;
+		++result;
+	}
+
+	// large sums, also simplified in parallel
+	idx k(symbol("k"), 3);
+	symbol x("x");
+	ex sum, expected;
+	for (int n=0; n<200; ++n) {
+		if (n % 2)
+			sum += pow(x, n) * indexed(A, i) * indexed(B, i);
+		else {
+			sum += pow(x, n) * indexed(A, j) * indexed(A, j) * indexed(B, n % 4 ? i : k) * indexed(C, n % 4 ? i : k);
+			expected += 4 * pow(x, n) * indexed(B, i) * indexed(C, i);
+		}
+	}
+	result += check_equal_simplify(simplify_indexed(sum, sp) - expected, 0, sp);
+	result += check_equal_simplify(simplify_indexed(sum, sp, simplify_indexed_options::parallel) - expected, 0, sp);
+
 	return result;
 }
 
@@ -379,6 +430,28 @@ static unsigned dummy_check()
 	e = indexed(p, mu.toggle_variance(), mu) - indexed(p, nu, nu.toggle_variance());
 	result += check_equal_simplify(e, 0);
 
+	// terms equal up to the names of their dummy indices and symmetries
+	symbol A("A"), B("B"), C("C");
+	idx k(symbol("k"), 3), l(symbol("l"), 3), m(symbol("m"), 3);
+	e = indexed(A, sy_symm(), i, j) * indexed(B, j, k) * indexed(C, k, i)
+	  - indexed(A, sy_symm(), k, l) * indexed(B, k, m) * indexed(C, m, l);
+	result += check_equal_simplify(e, 0);
+	e = indexed(A, sy_anti(), i, j) * indexed(p, i) * indexed(q, j)
+	  + indexed(A, sy_anti(), k, l) * indexed(p, l) * indexed(q, k);
+	result += check_equal_simplify(e, 0);
+	e = indexed(A, i, j) * indexed(B, j, k) * indexed(C, k, i)
+	  + indexed(A, l, m) * indexed(B, m, n) * indexed(C, n, l)
+	  + indexed(A, j, i) * indexed(B, i, n) * indexed(C, n, j);
+	result += check_equal_simplify(e - 3 * indexed(A, i, j) * indexed(B, j, k) * indexed(C, k, i), 0);
+
+	// expanding products of sums must rename clashing dummy indices
+	scalar_products sp;
+	sp.add(p, q, 2);
+	sp.add(q, q, 3);
+	e = (indexed(p, i) * indexed(q, i) + 1) * (indexed(p, i) * indexed(q, i) + indexed(q, j) * indexed(q, j))
+	  * (indexed(q, i) * indexed(q, i) - 1);
+	result += check_equal_simplify(e.expand(), 30, sp);
+
 	// GiNaC 1.2.1 had a bug here because p.i*p.i -> (p.i)^2
 	e = indexed(p, i) * indexed(p, i) * indexed(p, j) + indexed(p, j);
 	ex fi = exprseq(e.get_free_indices());
@@ -391,6 +464,50 @@ static unsigned dummy_check()
 	return result;
 }
 
+static unsigned component_check()
+{
+	// check dense evaluation of components
+
+	unsigned result = 0;
+
+	idx i(symbol("i"), 2), j(symbol("j"), 2), k(symbol("k"), 2);
+	idx i0(0, 2), i1(1, 2);
+	symbol A("A"), B("B");
+	matrix M(2, 2), v(2, 1);
+	M = 1, 2, 3, 4;
+	v = 5, 6;
+
+	component_array c(indexed(M, i, j) * indexed(v, j));
+	if (c.rank() != 1 || c.size() != 2 || !c[0].is_equal(17) || !c[1].is_equal(39)) {
+		clog << "components of M.i.j*v.j erroneously returned " << exprseq(c.components()) << endl;
+		++result;
+	}
+
+	c = component_array(delta_tensor(i, j) * delta_tensor(j, k) * delta_tensor(k, i));
+	if (c.rank() != 0 || !c[0].is_equal(2)) {
+		clog << "components of delta.i.j*delta.j.k*delta.k.i erroneously returned " << exprseq(c.components()) << endl;
+		++result;
+	}
+
+	c = component_array(indexed(A, i, j) * indexed(B, j) + indexed(B, i), lst(i));
+	ex e = indexed(A, i1, i0) * indexed(B, i0) + indexed(A, i1, i1) * indexed(B, i1) + indexed(B, i1);
+	result += check_equal(c[1], e);
+
+	c = component_array(indexed(A, i, j), lst(j, i));
+	std::vector<unsigned> pos;
+	pos.push_back(1);
+	pos.push_back(0);
+	result += check_equal(c(pos), indexed(A, i0, i1));
+
+	std::vector<double> d = evalf_components(indexed(M, i, j) * indexed(M, j, k) * indexed(v, k), lst(i));
+	if (d.size() != 2 || d[0] != 5 * 7 + 6 * 10 || d[1] != 5 * 15 + 6 * 22) {
+		clog << "evalf_components(M.i.j*M.j.k*v.k) returned wrong values" << endl;
+		++result;
+	}
+
+	return result;
+}
+
 unsigned exam_indexed()
 {
 	unsigned result = 0;
@@ -405,6 +522,7 @@ unsigned exam_indexed()
 	result += edyn_check();  cout << '.' << flush;
 	result += spinor_check(); cout << '.' << flush;
 	result += dummy_check(); cout << '.' << flush;
+	result += component_check(); cout << '.' << flush;
 	
 	return result;
 }
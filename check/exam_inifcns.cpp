@@ -121,6 +121,46 @@ static unsigned inifcns_consist_trans()
 	return result;
 }
 
+/* The exact values of sin, cos and tan at multiples of Pi/60 must agree with
+ * the numerical ones. */
+static unsigned inifcns_special_trans()
+{
+	unsigned result = 0;
+
+	for (int k=-150; k<=150; ++k) {
+		const ex x = numeric(k,60)*Pi;
+		const bool pole = (k%60 == 30 || k%60 == -30);
+		const ex exact[] = { sin(x), cos(x), pole ? ex(0) : tan(x) };
+		const ex approx[] = { sin(x).hold(), cos(x).hold(), tan(x).hold() };
+		for (int f=0; f<3; ++f) {
+			if (is_a<function>(exact[f]) || (f == 2 && pole))
+				continue;
+			if (abs(ex_to<numeric>(evalf(exact[f] - approx[f]))) > numeric(1,1000000)) {
+				clog << "the exact value " << exact[f] << " of " << approx[f] << " is wrong" << endl;
+				++result;
+			}
+		}
+	}
+
+	bool caught = false;
+	try {
+		tan(numeric(-3,2)*Pi);
+	} catch (const pole_error &) {
+		caught = true;
+	}
+	if (!caught) {
+		clog << "tan(-3/2*Pi) did not raise a pole error" << endl;
+		++result;
+	}
+
+	if (!exp(numeric(-7,2)*Pi*I).is_equal(I) || !exp(Pi*I).is_equal(-1)) {
+		clog << "exp(-7/2*Pi*I) or exp(Pi*I) is wrong" << endl;
+		++result;
+	}
+
+	return result;
+}
+
 /* Simple tests on the tgamma function.  We stuff in arguments where the results
  * exists in closed form and check if it's ok. */
 static unsigned inifcns_consist_gamma()
@@ -167,6 +207,40 @@ static unsigned inifcns_consist_gamma()
 	return result;
 }
 
+/* Numerical tgamma at various precisions: in double precision, with the
+ * tabulated Lanczos coefficients and with coefficients computed for more than
+ * 200 digits. */
+static unsigned inifcns_gamma_evalf()
+{
+	using GiNaC::tgamma;
+	using GiNaC::lgamma;
+	unsigned result = 0;
+	const long saved_digits = Digits;
+
+	const long digits[] = { 15, 17, 40, 150, 250 };
+	for (size_t i = 0; i < sizeof(digits)/sizeof(digits[0]); ++i) {
+		Digits = digits[i];
+		const numeric eps = numeric(10).power(5 - digits[i]);
+		// tgamma(1/2)^2 == Pi
+		const ex e1 = pow(tgamma(numeric(1, 2)), 2) - Pi.evalf();
+		// tgamma(x+1) == x*tgamma(x), also for complex x and x < 1/2
+		const numeric x = ex_to<numeric>(ex(numeric(-7, 3) + numeric(1, 5)*I).evalf());
+		const ex e2 = tgamma(x + 1) - x*tgamma(x);
+		// lgamma(10) == log(9!)
+		const ex e3 = lgamma(ex(10)).evalf() - log(ex(362880)).evalf();
+		if (!is_exactly_a<numeric>(e1) || abs(ex_to<numeric>(e1)) > eps ||
+		    !is_exactly_a<numeric>(e2) || abs(ex_to<numeric>(e2)) > eps * abs(tgamma(x)) ||
+		    !is_exactly_a<numeric>(e3) || abs(ex_to<numeric>(e3)) > eps * 13) {
+			clog << "Gamma function with " << digits[i] << " digits erroneously returned "
+			     << e1 << ", " << e2 << ", " << e3 << " instead of 0" << endl;
+			++result;
+		}
+	}
+	Digits = saved_digits;
+
+	return result;
+}
+
 /* Simple tests on the Psi-function (aka polygamma-function).  We stuff in
    arguments where the result exists in closed form and check if it's ok. */
 static unsigned inifcns_consist_psi()
@@ -240,7 +314,9 @@ unsigned exam_inifcns()
 	cout << "examining consistency of symbolic functions" << flush;
 	
 	result += inifcns_consist_trans();  cout << '.' << flush;
+	result += inifcns_special_trans();  cout << '.' << flush;
 	result += inifcns_consist_gamma();  cout << '.' << flush;
+	result += inifcns_gamma_evalf();  cout << '.' << flush;
 	result += inifcns_consist_psi();  cout << '.' << flush;
 	result += inifcns_consist_zeta();  cout << '.' << flush;
 	result += inifcns_consist_various();  cout << '.' << flush;
@@ -192,11 +192,20 @@ static unsigned inifcns_test_zeta()
 	res.append(zeta(lst(4,2,3)) - (-zeta(9)*59 + zeta(2)*zeta(7)*28 + pow(zeta(2),2)*zeta(5)*4 -
 	                               pow(zeta(3),3)/3 + pow(zeta(2),3)*zeta(3)*8/21));
 	res.append(zeta(lst(3,1,3,1,3,1,3,1)) - (2*pow(Pi,16)/factorial(18)));
+	res.append(zeta(lst(3,1,1)).hold() - (2*zeta(5) - zeta(2)*zeta(3)));
+	res.append(zeta(lst(2,2,2)).hold() - pow(Pi,6)/5040);
 	res.append(zeta(lst(2),lst(-1)) - -zeta(2)/2);
 	res.append(zeta(lst(1,2),lst(-1,1)) - (-zeta(3)/4 - zeta(lst(1),lst(-1))*zeta(2)/2));
 	res.append(zeta(lst(2,1,1),lst(-1,-1,1)) - (-pow(zeta(2),2)*23/40 - pow(zeta(lst(1),lst(-1)),2)*zeta(2)*3/4
 	                                            - zeta(lst(3,1),lst(-1,1))*3/2 - zeta(lst(1),lst(-1))*zeta(3)*21/8));
 	
+	// closed forms of multiple zeta values
+	if (!zeta(lst(2,1)).is_equal(zeta(3)) || !zeta(lst(3,1,1)).is_equal(2*zeta(5) - zeta(2)*zeta(3))
+	 || !zeta(lst(2,2,2)).is_equal(pow(Pi,6)/5040) || !zeta(lst(2,1,1,1,1)).is_equal(zeta(6))) {
+		clog << "multiple zeta values with closed forms were not simplified" << endl;
+		result++;
+	}
+
 	for (lst::const_iterator it = res.begin(); it != res.end(); it++) {
 		Digits = 17;
 		ex prec = 5 * pow(10, -(ex)Digits);
@@ -366,6 +375,64 @@ static unsigned inifcns_test_legacy()
 }
 
 
+// The lookup tables for S and Li are kept for several precisions, so
+// switching back and forth must give the same values as before.
+static unsigned inifcns_test_tables()
+{
+	int digitsbuf = Digits;
+	unsigned result = 0;
+
+	const ex e = S(2, 3, numeric(2, 5)) + Li(5, numeric(3, 5)) + S(1, 4, numeric(-7, 10));
+	Digits = 17;
+	const ex v17 = e.evalf();
+	Digits = 40;
+	prepare_polylog_tables(6);
+	const ex v40 = e.evalf();
+	Digits = 17;
+	if (!e.evalf().is_equal(v17)) {
+		clog << e << " changed to " << e.evalf() << " after switching the precision" << endl;
+		result++;
+	}
+	if (abs(v40 - v17) > 5 * pow(ex(10), -17)) {
+		clog << e << " gave " << v40 << " with 40 digits, but " << v17 << " with 17" << endl;
+		result++;
+	}
+	cout << "." << flush;
+
+	Digits = digitsbuf;
+	return result;
+}
+
+// evalf_polylogs() must give the same values as evalf() one by one.
+static unsigned inifcns_test_batch()
+{
+	int digitsbuf = Digits;
+	Digits = 17;
+	ex prec = 5 * pow(10, -(ex)Digits);
+	unsigned result = 0;
+
+	exvector v;
+	v.push_back(G(lst(0, 1.2, 1, 1.01), 1).hold());
+	v.push_back(G(lst(0, 1.2, 1, 1.01), 1).hold() * G(lst(0.5, 0, 2.0), 1).hold());
+	v.push_back(G(lst(0.5, 0, 2.0), 1).hold());
+	v.push_back(Li(lst(2, 1), lst(numeric(1, 3), numeric(-5, 2))).hold());
+	v.push_back(H(lst(1, -1, 0), numeric(3, 10)).hold());
+	v.push_back(H(lst(1, -1, 0), numeric(3, 10)).hold() - Li(3, numeric(1, 7)));
+
+	const exvector values = evalf_polylogs(v);
+	for (size_t i = 0; i < v.size(); ++i) {
+		const ex diff = abs(values[i] - v[i].evalf());
+		if (diff > prec) {
+			clog << "evalf_polylogs() of " << v[i] << " seems to be wrong: " << diff << endl;
+			result++;
+		}
+	}
+	cout << "." << flush;
+
+	Digits = digitsbuf;
+	return result;
+}
+
 unsigned exam_inifcns_nstdsums(void)
 {
 	unsigned result = 0;
@@ -377,6 +444,8 @@ unsigned exam_inifcns_nstdsums(void)
 	result += inifcns_test_HLi();
 	result += inifcns_test_LiG();
 	result += inifcns_test_legacy();
+	result += inifcns_test_tables();
+	result += inifcns_test_batch();
 	
 	return result;
 }
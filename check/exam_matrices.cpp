@@ -114,6 +114,41 @@ static unsigned matrix_determinants()
 	return result;
 }
 
+static unsigned matrix_charpoly()
+{
+	unsigned result = 0;
+	symbol a("a"), b("b"), lambda("lambda");
+
+	// polynomial entries, with a zero on the diagonal
+	matrix P(5,5);
+	for (unsigned ro=0; ro<5; ++ro)
+		for (unsigned co=0; co<5; ++co)
+			P(ro,co) = (ro+2*co)%5*a - pow(b, (ro+co)%3) + (ro==2 && co==2 ? 1 : 0);
+
+	// rational functions
+	matrix Q(3,3);
+	Q = a/b, 1, 0,
+	    1/(a+b), b, a,
+	    2, numeric(1,3), 1/a;
+
+	const matrix * M[] = { &P, &Q };
+	for (unsigned i=0; i<2; ++i) {
+		matrix L(*M[i]);
+		for (unsigned d=0; d<L.rows(); ++d)
+			L(d,d) -= lambda;
+		const ex cmp = L.determinant(determinant_algo::laplace);
+		const ex p = M[i]->charpoly(lambda);
+		const ex pp = M[i]->charpoly(lambda, true);
+		if (!(p - cmp).normal().is_zero() || !(pp - cmp).normal().is_zero()) {
+			clog << "charpoly of " << *M[i] << " erroneously returned "
+			     << p << " instead of " << cmp << endl;
+			++result;
+		}
+	}
+
+	return result;
+}
+
 static unsigned matrix_invert1()
 {
 	unsigned result = 0;
@@ -242,6 +277,17 @@ static unsigned matrix_evalm()
 		result++;
 	}
 
+	// A chain of differently shaped factors, where multiplying left to right
+	// is cheaper, and a sum with coefficients
+	matrix A(1, 3, lst(1, 2, 3)), B(3, 1, lst(1, 0, -1)), C(1, 3, lst(2, 1, 0));
+	e = A * B * C - 2*A + C;
+	f = e.evalm();
+	matrix Q(1, 3, lst(-4, -5, -6));
+	if (!f.is_equal(Q)) {
+		clog << "Evaluating " << e << " erroneously returned " << f << " instead of " << Q << endl;
+		result++;
+	}
+
 	return result;
 }
 
@@ -282,9 +328,575 @@ static unsigned matrix_rank()
 		++result;
 	}
 
+	// a sum of two symbolic outer products, with the modular image
+	matrix o(6,5);
+	for (unsigned r=0; r<6; ++r)
+		for (unsigned c=0; c<5; ++c)
+			o(r,c) = pow(x, r)*(c+y) + (r+1)*pow(y, c)/(x+1);
+	if (o.rank() != 2 || o.rank(solve_algo::modular) != 2) {
+		clog << "The rank of " << o << " was not computed correctly." << endl;
+		++result;
+	}
+
+	// entries which are not rational functions
+	matrix t(2,2);
+	t = sin(x), 1,
+	    pow(sin(x), 2), sin(x);
+	if (t.rank() != 1 || t.rank(solve_algo::modular) != 1) {
+		clog << "The rank of " << t << " was not computed correctly." << endl;
+		++result;
+	}
+
 	return result;	
 }
 
+static unsigned matrix_numeric()
+{
+	unsigned result = 0;
+	const unsigned n = 8;
+
+	// A Hilbert matrix plus the unit matrix, exact and evaluated
+	matrix A(n,n), B(n,1), X(n,1);
+	for (unsigned r=0; r<n; ++r) {
+		for (unsigned c=0; c<n; ++c)
+			A(r,c) = numeric(1, r+c+1) + (r==c ? 1 : 0);
+		B(r,0) = numeric(r*r) - 3;
+		X(r,0) = symbol();
+	}
+	const matrix I = ex_to<matrix>(unit_matrix(n));
+
+	const matrix Ai = A.inverse();
+	if (!A.mul(Ai).sub(I).is_zero_matrix()) {
+		clog << "inversion of the exact numeric matrix " << A
+		     << " erroneously returned " << Ai << endl;
+		++result;
+	}
+	const matrix sol = A.solve(X, B);
+	if (!A.mul(sol).sub(B).is_zero_matrix() || sol != Ai.mul(B)) {
+		clog << "solving the exact numeric system " << A << " * " << X
+		     << " == " << B << " erroneously returned " << sol << endl;
+		++result;
+	}
+	if (A.determinant(determinant_algo::gauss) != A.determinant(determinant_algo::bareiss)) {
+		clog << "Gauss elimination of the exact numeric matrix " << A
+		     << " erroneously returned the determinant "
+		     << A.determinant(determinant_algo::gauss) << endl;
+		++result;
+	}
+
+	// Floating-point matrices of double and of higher precision
+	const long saved_digits = Digits;
+	const long digits[] = { 15, 40 };
+	for (unsigned i=0; i<sizeof(digits)/sizeof(digits[0]); ++i) {
+		Digits = digits[i];
+		const matrix Af = ex_to<matrix>(A.evalf());
+		const matrix Bf = ex_to<matrix>(B.evalf());
+		const numeric eps = numeric(10).power(4-digits[i]);
+		const matrix D = Af.mul(Af.inverse()).sub(I);
+		const matrix E = Af.mul(Af.solve(X, Bf)).sub(Bf);
+		for (unsigned r=0; r<n; ++r) {
+			if (abs(ex_to<numeric>(E(r,0))) > eps) {
+				clog << "solving the floating-point system " << Af << " * " << X
+				     << " == " << Bf << " with Digits=" << Digits
+				     << " has the residual " << E << endl;
+				++result;
+				break;
+			}
+			for (unsigned c=0; c<n; ++c)
+				if (abs(ex_to<numeric>(D(r,c))) > eps) {
+					clog << "inversion of the floating-point matrix " << Af
+					     << " with Digits=" << Digits << " has the residual "
+					     << D << endl;
+					++result;
+					c = r = n;
+				}
+		}
+	}
+	Digits = saved_digits;
+
+	// A singular numeric matrix and an underdetermined numeric system
+	matrix S(2,2), S1(2,1), T(2,1);
+	S = 1, 2,
+	    2, 4;
+	try {
+		S.inverse();
+		clog << "inversion of the singular matrix " << S << " didn't fail" << endl;
+		++result;
+	} catch (const std::runtime_error & e) {
+	}
+	S1 = 3, 6;
+	T(0,0) = symbol("t0");
+	T(1,0) = symbol("t1");
+	const matrix Ssol = S.solve(T, S1);
+	if (Ssol(1,0) != T(1,0) || Ssol(0,0) != 3 - 2*T(1,0)) {
+		clog << "solving the underdetermined system " << S << " * " << T
+		     << " == " << S1 << " erroneously returned " << Ssol << endl;
+		++result;
+	}
+
+	return result;
+}
+
+static unsigned matrix_modular()
+{
+	unsigned result = 0;
+	const unsigned n = 10;
+
+	// pseudo-random integers, some of them large, and a Hilbert matrix
+	matrix A(n,n), H(n,n), B(n,2), X(n,2);
+	unsigned long x = 4711;
+	for (unsigned r=0; r<n; ++r) {
+		for (unsigned c=0; c<n; ++c) {
+			x = (x*1103515245 + 12345) % 2147483648UL;
+			A(r,c) = numeric(long(x % 2001) - 1000);
+			if ((r+c) % 3 == 0)
+				A(r,c) = A(r,c) * pow(numeric(10), numeric(20)) + c;
+			H(r,c) = numeric(1, r+c+1);
+		}
+		B(r,0) = numeric(r+1, 2);
+		B(r,1) = numeric(long(r) - 5);
+		X(r,0) = symbol();
+		X(r,1) = symbol();
+	}
+
+	for (unsigned i=0; i<2; ++i) {
+		const matrix & M = i ? H : A;
+		const ex det = M.determinant(determinant_algo::modular);
+		if (det != M.determinant(determinant_algo::bareiss)) {
+			clog << "the modular determinant of " << M << " erroneously returned "
+			     << det << endl;
+			++result;
+		}
+		const matrix sol = M.solve(X, B, solve_algo::modular);
+		if (sol != M.solve(X, B, solve_algo::gauss) || !M.mul(sol).sub(B).is_zero_matrix()) {
+			clog << "solving " << M << " * " << X << " == " << B
+			     << " with the modular algorithm erroneously returned " << sol << endl;
+			++result;
+		}
+	}
+
+	// a singular system falls back to elimination
+	matrix S(3,3), S1(3,1), T(3,1);
+	S = 1, 2, 3,
+	    4, 5, 6,
+	    7, 8, 9;
+	S1 = 1, 1, 1;
+	T = symbol("t0"), symbol("t1"), symbol("t2");
+	if (S.determinant(determinant_algo::modular) != 0) {
+		clog << "the modular determinant of " << S << " erroneously returned "
+		     << S.determinant(determinant_algo::modular) << endl;
+		++result;
+	}
+	const matrix Ssol = S.solve(T, S1, solve_algo::modular);
+	if (!S.mul(Ssol).sub(S1).expand().is_zero_matrix()) {
+		clog << "solving the singular system " << S << " * " << T << " == "
+		     << S1 << " erroneously returned " << Ssol << endl;
+		++result;
+	}
+
+	return result;
+}
+
+static unsigned matrix_interpolation()
+{
+	unsigned result = 0;
+	symbol a("a"), b("b"), c("c");
+
+	// a Toeplitz matrix of polynomials in two symbols
+	const ex p[6] = { a, b, a+b, a*a+a*b+b*b, pow(a,3)+a*a*b-a*b*b+pow(b,3), 3*a-b+2 };
+	matrix T(6,6);
+	for (unsigned ro=0; ro<6; ++ro)
+		for (unsigned nd=ro; nd<6; ++nd) {
+			T(nd-ro,nd) = p[ro];
+			T(nd,nd-ro) = p[ro];
+		}
+
+	// rational coefficients, a constant row and an unused symbol
+	matrix R(4,4);
+	R = numeric(1,2)*a, b-numeric(2,3), 1, 0,
+	    a*b, 0, c*c-a, numeric(5,7),
+	    1, 2, 3, 4,
+	    a*a*c, b, numeric(-1,3), a-b-c;
+
+	// a singular one
+	matrix S(3,3);
+	S = a, b, a+b,
+	    a*a, c, a*a+c,
+	    1, b*c, 1+b*c;
+
+	const matrix * M[] = { &T, &R, &S };
+	for (unsigned i=0; i<3; ++i) {
+		const ex det = M[i]->determinant(determinant_algo::interpolation);
+		const ex cmp = M[i]->determinant(determinant_algo::laplace);
+		if (!(det - cmp).expand().is_zero()) {
+			clog << "the interpolated determinant of " << *M[i]
+			     << " erroneously returned " << det << " instead of " << cmp << endl;
+			++result;
+		}
+	}
+
+	return result;
+}
+
+static unsigned matrix_sparse()
+{
+	unsigned result = 0;
+	symbol a("a"), b("b");
+
+	// a tridiagonal system with symbolic coefficients
+	const unsigned n = 12;
+	matrix A(n,n), B(n,1), X(n,1);
+	for (unsigned i=0; i<n; ++i) {
+		A(i,i) = a+i;
+		if (i+1<n) {
+			A(i,i+1) = b;
+			A(i+1,i) = 1;
+		}
+		B(i,0) = i%3;
+		X(i,0) = symbol();
+	}
+	const matrix sol = sparse_matrix(A).solve(X, B);
+	const matrix res = A.mul(sol).sub(B);
+	for (unsigned i=0; i<n; ++i)
+		if (!res(i,0).normal().is_zero()) {
+			clog << "the sparse solution of " << A << " * X == " << B
+			     << " erroneously returned " << sol << endl;
+			++result;
+			break;
+		}
+
+	// an underdetermined one keeps a free symbol
+	symbol x("x"), y("y"), z("z");
+	sparse_matrix U(2,3);
+	U.set(0,0,1).set(0,2,a).set(1,1,b);
+	const matrix usol = U.solve(matrix(3,1,lst(x,y,z)), matrix(2,1,lst(a,1)));
+	if (!(usol(0,0)-a+a*z).normal().is_zero() || !(usol(1,0)-1/b).normal().is_zero() || usol(2,0)!=z) {
+		clog << "the sparse solution of " << U.to_matrix()
+		     << " * [x,y,z] == [a,1] erroneously returned " << usol << endl;
+		++result;
+	}
+
+	// an inconsistent one
+	sparse_matrix I(2,1);
+	I.set(0,0,a).set(1,0,2*a);
+	bool caught = false;
+	try {
+		I.solve(matrix(1,1,lst(x)), matrix(2,1,lst(1,1)));
+	} catch (const std::runtime_error & e) {
+		caught = true;
+	}
+	if (!caught) {
+		clog << "the inconsistent system " << I.to_matrix()
+		     << " * [x] == [1,1] was erroneously solved" << endl;
+		++result;
+	}
+
+	// lsolve() builds the sparse system from the equations
+	const ex eqns = lst(a*x+y==1, x-b*z==a, y+z==0);
+	const ex vars = lst(x, y, z);
+	const ex ssol = lsolve(eqns, vars, solve_algo::sparse);
+	const ex dsol = lsolve(eqns, vars);
+	for (size_t i=0; i<3; ++i)
+		if (ssol.nops()!=3 || !(ssol.op(i).rhs()-dsol.op(i).rhs()).normal().is_zero()) {
+			clog << "the sparse lsolve of " << eqns
+			     << " erroneously returned " << ssol << " instead of " << dsol << endl;
+			++result;
+			break;
+		}
+
+	// a large rational system is eliminated fraction-free
+	const unsigned m = 300;
+	lst reqns, rvars;
+	exvector xs;
+	for (unsigned i=0; i<m; ++i)
+		xs.push_back(symbol());
+	for (unsigned i=0; i<m; ++i) {
+		ex lhs = numeric(i%7+2, 3)*xs[i] + xs[(i*37+5)%m];
+		if (i+1<m)
+			lhs -= numeric(1, i%5+1)*xs[i+1];
+		reqns.append(lhs == i%4);
+		rvars.append(xs[i]);
+	}
+	const ex rsol = lsolve(reqns, rvars, solve_algo::sparse);
+	if (rsol.nops() != m) {
+		clog << "the sparse lsolve of a rational system returned " << rsol << endl;
+		++result;
+	} else {
+		for (lst::const_iterator i=ex_to<lst>(reqns).begin(); i!=ex_to<lst>(reqns).end(); ++i)
+			if (!(i->lhs()-i->rhs()).subs(rsol).is_zero()) {
+				clog << "the sparse lsolve of a rational system does not solve "
+				     << *i << endl;
+				++result;
+				break;
+			}
+	}
+
+	return result;
+}
+
+static unsigned matrix_parallel()
+{
+	unsigned result = 0;
+	symbol a("a"), b("b"), c("c");
+
+	// a symbolic matrix in which every row needs work in every step
+	const unsigned n = 6;
+	matrix A(n,n), B(n,1), X(n,1);
+	for (unsigned ro=0; ro<n; ++ro) {
+		for (unsigned co=0; co<n; ++co)
+			A(ro,co) = pow(a, (ro*co)%3) + (ro+co)%4*b - (ro==co ? ex(c) : ex(0));
+		B(ro,0) = ro*a - 1;
+		X(ro,0) = symbol();
+	}
+
+	const ex det = A.determinant(determinant_algo::bareiss);
+	const ex pdet = A.determinant(determinant_algo::bareiss | determinant_algo::parallel);
+	const ex gdet = A.determinant(determinant_algo::gauss | determinant_algo::parallel);
+	if (!(pdet - det).expand().is_zero() || !(gdet - det).normal().is_zero()) {
+		clog << "the determinant of " << A << " erroneously returned "
+		     << pdet << " and " << gdet << " in parallel instead of " << det << endl;
+		++result;
+	}
+
+	const unsigned algos[] = { solve_algo::bareiss | solve_algo::parallel,
+	                           solve_algo::gauss | solve_algo::parallel };
+	for (unsigned i=0; i<2; ++i) {
+		const matrix sol = A.solve(X, B, algos[i]);
+		const matrix res = A.mul(sol).sub(B);
+		for (unsigned ro=0; ro<n; ++ro)
+			if (!res(ro,0).normal().is_zero()) {
+				clog << "the parallel solution of " << A << " * X == " << B
+				     << " erroneously returned " << sol << endl;
+				++result;
+				break;
+			}
+	}
+
+	return result;
+}
+
+static unsigned matrix_mul()
+{
+	unsigned result = 0;
+	symbol a("a"), b("b");
+
+	// powers of a symbolic matrix
+	matrix S(4,4);
+	for (unsigned ro=0; ro<4; ++ro)
+		for (unsigned co=0; co<4; ++co)
+			S(ro,co) = (ro+co)%3 ? ex((ro+1)*a - co*b) : ex(0);
+	const matrix S5 = S.pow(5);
+	const matrix cmp = S.mul(S).mul(S).mul(S).mul(S);
+	for (unsigned ro=0; ro<4; ++ro)
+		for (unsigned co=0; co<4; ++co)
+			if (!(S5(ro,co) - cmp(ro,co)).expand().is_zero()) {
+				clog << "the 5th power of " << S << " erroneously returned " << S5 << endl;
+				return ++result;
+			}
+
+	// large integer matrices are multiplied by Strassen's algorithm
+	const unsigned n = 130;
+	const numeric big = numeric(2).power(70);
+	matrix A(n,n), B(n,n);
+	for (unsigned ro=0; ro<n; ++ro)
+		for (unsigned co=0; co<n; ++co) {
+			A(ro,co) = big * numeric(int((ro*7+co*3)%11) - 5) + numeric(ro);
+			B(ro,co) = numeric(int((ro*co)%13) - 6) - big * numeric(co%3);
+		}
+	const matrix C = A.mul(B);
+	for (unsigned ro=0; ro<n; ro+=43)
+		for (unsigned co=0; co<n; co+=17) {
+			numeric e = 0;
+			for (unsigned k=0; k<n; ++k)
+				e += ex_to<numeric>(A(ro,k)) * ex_to<numeric>(B(k,co));
+			if (C(ro,co) != e) {
+				clog << "entry (" << ro << "," << co << ") of a product of "
+				     << n << "x" << n << " integer matrices erroneously returned "
+				     << C(ro,co) << " instead of " << e << endl;
+				return ++result;
+			}
+		}
+
+	return result;
+}
+
+static unsigned matrix_lu()
+{
+	unsigned result = 0;
+	symbol a("a"), b("b"), x("x"), y("y"), z("z");
+	const matrix X(3,1,lst(x,y,z));
+
+	// one decomposition for several right hand sides
+	matrix A(3,3);
+	A = 0, a, 1,
+	    b, 1, a+b,
+	    2, numeric(1,2), a*b;
+	const lu_decomposition lu(A);
+	const matrix B[] = { matrix(3,1,lst(1,0,0)), matrix(3,1,lst(a,b,3)), matrix(3,1,lst(0,a*a,1/b)) };
+	for (unsigned i=0; i<3; ++i) {
+		const matrix sol = lu.solve(X, B[i]);
+		const matrix cmp = A.solve(X, B[i]);
+		if (!(sol(0,0)-cmp(0,0)).normal().is_zero() || !(sol(1,0)-cmp(1,0)).normal().is_zero() ||
+		    !(sol(2,0)-cmp(2,0)).normal().is_zero()) {
+			clog << "the LU decomposition of " << A << " erroneously solved it with rhs "
+			     << B[i] << " as " << sol << " instead of " << cmp << endl;
+			++result;
+		}
+	}
+
+	// a singular numeric one, which is underdetermined or inconsistent
+	matrix S(3,3);
+	S = 1, 2, 3,
+	    2, 4, 6,
+	    1, 0, 1;
+	const lu_decomposition slu(S);
+	const matrix ssol = slu.solve(X, matrix(3,1,lst(1,2,0)));
+	const matrix sres = S.mul(ssol).sub(matrix(3,1,lst(1,2,0)));
+	if (slu.rank() != 2 || !sres(0,0).expand().is_zero() || !sres(1,0).expand().is_zero() ||
+	    !sres(2,0).expand().is_zero() || !ssol.has(z)) {
+		clog << "the LU decomposition of " << S << " erroneously returned "
+		     << ssol << " of rank " << slu.rank() << endl;
+		++result;
+	}
+	bool caught = false;
+	try {
+		slu.solve(X, matrix(3,1,lst(1,1,1)));
+	} catch (const std::runtime_error & e) {
+		caught = true;
+	}
+	if (!caught) {
+		clog << "the LU decomposition of " << S << " erroneously solved an inconsistent system" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* Substitution leaves the entries without the substituted symbols alone. */
+static unsigned matrix_subs()
+{
+	unsigned result = 0;
+	symbol a("a"), b("b"), c("c");
+
+	matrix M(3,3);
+	M = a, b, c,
+	    b*c, a+b, Pi,
+	    sin(c), 1, a*c;
+	const matrix N = ex_to<matrix>(M.subs(a == 2));
+	for (unsigned ro=0; ro<3; ++ro)
+		for (unsigned co=0; co<3; ++co) {
+			if (!N(ro,co).is_equal(M(ro,co).subs(a == 2))) {
+				clog << "entry (" << ro << "," << co << ") of " << M << " with a==2 is "
+				     << N(ro,co) << endl;
+				++result;
+			} else if (!M(ro,co).has(a) && !are_ex_trivially_equal(N(ro,co), M(ro,co))) {
+				clog << "entry (" << ro << "," << co << ") of " << M << " was copied by subs()" << endl;
+				++result;
+			}
+		}
+
+	// changed entries must be seen by the next substitution
+	M(1,2) = a*Pi;
+	const ex N2 = M.subs(a == 3);
+	if (!N2.op(5).is_equal(3*Pi)) {
+		clog << "entry (1,2) of " << M << " with a==3 is " << N2.op(5) << endl;
+		++result;
+	}
+
+	// keys without symbols, and patterns
+	const ex N3 = M.subs(lst(Pi == 4, sin(wild()) == c));
+	if (!N3.op(5).is_equal(4*a) || !N3.op(6).is_equal(c)) {
+		clog << M << " with Pi==4, sin($0)==c is " << N3 << endl;
+		++result;
+	}
+
+	return result;
+}
+
+static unsigned matrix_structured()
+{
+	unsigned result = 0;
+	symbol a("a"), b("b"), c("c");
+
+	// triangular
+	matrix U(4,4);
+	U = a, 1, b, 2,
+	    0, b, c, a,
+	    0, 0, a+b, 1,
+	    0, 0, 0, c;
+	// block diagonal
+	matrix D(5,5);
+	D = a, b, 0, 0, 0,
+	    c, 1, 0, 0, 0,
+	    0, 0, 2, a, b,
+	    0, 0, 1, b, c,
+	    0, 0, a, 0, 1;
+	// Vandermonde, and its transpose
+	const ex nodes[4] = { a, b, c+1, a*b };
+	matrix V(4,4);
+	for (unsigned ro=0; ro<4; ++ro)
+		for (unsigned co=0; co<4; ++co)
+			V(ro,co) = pow(nodes[ro], co);
+	const matrix W = V.transpose();
+	const matrix * M[] = { &U, &D, &V, &W };
+	for (unsigned i=0; i<4; ++i) {
+		const ex det = M[i]->determinant();
+		const ex cmp = M[i]->determinant(determinant_algo::laplace);
+		if (!(det - cmp).expand().is_zero()) {
+			clog << "the determinant of " << *M[i] << " erroneously returned "
+			     << det << " instead of " << cmp << endl;
+			++result;
+		}
+	}
+
+	// Toeplitz matrices of rationals, one with a singular leading block
+	const numeric t[2][11] = { { 3, 1, -2, numeric(1,2), 5, 7, -1, 0, 4, numeric(-3,7), 2 },
+	                           { 0, 1, -2, numeric(1,2), 5, 1, -1, 0, 4, numeric(-3,7), 2 } };
+	for (unsigned i=0; i<2; ++i) {
+		matrix T(6,6);
+		for (unsigned ro=0; ro<6; ++ro)
+			for (unsigned co=0; co<6; ++co)
+				T(ro,co) = t[i][co+5-ro];
+		const ex det = T.determinant();
+		const ex cmp = T.determinant(determinant_algo::bareiss);
+		if (det != cmp) {
+			clog << "the determinant of " << T << " erroneously returned "
+			     << det << " instead of " << cmp << endl;
+			++result;
+		}
+	}
+
+	// a symbolic band matrix and the inverse of a triangular one
+	const unsigned n = 9;
+	matrix B(n,n), X(n,1), R(n,1);
+	for (unsigned i=0; i<n; ++i) {
+		B(i,i) = a + i;
+		if (i+1 < n)
+			B(i,i+1) = b;
+		if (i > 0)
+			B(i,i-1) = c;
+		X(i,0) = symbol();
+		R(i,0) = i;
+	}
+	matrix res = B.mul(B.solve(X, R)).sub(R);
+	for (unsigned i=0; i<n; ++i)
+		if (!res(i,0).normal().is_zero()) {
+			clog << "the solution of " << B << " * X == " << R
+			     << " erroneously returned " << B.solve(X, R) << endl;
+			++result;
+			break;
+		}
+	const matrix I = U.mul(U.inverse());
+	for (unsigned ro=0; ro<4; ++ro)
+		for (unsigned co=0; co<4; ++co)
+			if (!(I(ro,co) - (ro==co ? 1 : 0)).normal().is_zero()) {
+				clog << "the inverse of " << U << " was not computed correctly" << endl;
+				return ++result;
+			}
+
+	return result;
+}
+
 static unsigned matrix_misc()
 {
 	unsigned result = 0;
@@ -343,12 +955,22 @@ unsigned exam_matrices()
 	cout << "examining symbolic matrix manipulations" << flush;
 	
 	result += matrix_determinants();  cout << '.' << flush;
+	result += matrix_charpoly();  cout << '.' << flush;
 	result += matrix_invert1();  cout << '.' << flush;
 	result += matrix_invert2();  cout << '.' << flush;
 	result += matrix_invert3();  cout << '.' << flush;
 	result += matrix_solve2();  cout << '.' << flush;
 	result += matrix_evalm();  cout << "." << flush;
 	result += matrix_rank();  cout << "." << flush;
+	result += matrix_numeric();  cout << '.' << flush;
+	result += matrix_modular();  cout << '.' << flush;
+	result += matrix_interpolation();  cout << '.' << flush;
+	result += matrix_sparse();  cout << '.' << flush;
+	result += matrix_parallel();  cout << '.' << flush;
+	result += matrix_mul();  cout << '.' << flush;
+	result += matrix_lu();  cout << '.' << flush;
+	result += matrix_structured();  cout << '.' << flush;
+	result += matrix_subs();  cout << '.' << flush;
 	result += matrix_misc();  cout << '.' << flush;
 	
 	return result;
@@ -23,7 +23,13 @@
 #include "ginac.h"
 using namespace GiNaC;
 
+#include <cmath>
+#include <complex>
 #include <iostream>
+#include <sstream>
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+#include <thread>
+#endif
 using namespace std;
 
 #define VECSIZE 30
@@ -89,209 +95,2295 @@ static unsigned exam_expand_power()
 	return result;
 }
 
-static unsigned exam_sqrfree()
+/* Parallel expansion must give the same result as the sequential one
+ * (even if the library is not thread-safe and the option is ignored). */
+static unsigned exam_expand_parallel()
 {
 	unsigned result = 0;
-	symbol x("x"), y("y");
-	ex e1, e2;
-	
-	e1 = (1+x)*pow((2+x),2)*pow((3+x),3)*pow((4+x),4);
-	e2 = sqrfree(expand(e1),lst(x));
-	if (e1 != e2) {
-		clog << "sqrfree(expand(" << e1 << ")) erroneously returned "
-		     << e2 << endl;
+	symbol x("x"), y("y"), z("z"), t("t");
+	const ex p = pow(1 + x + y + z + t, 8);
+	const ex e = expand(p * (p + 1));
+	const ex f = expand(p * (p + 1), expand_options::parallel);
+
+	if (!(e - f).expand().is_zero()) {
+		clog << "parallel expansion of (1+x+y+z+t)^8*((1+x+y+z+t)^8+1) erroneously returned "
+		     << f << " instead of " << e << endl;
 		++result;
 	}
-	
-	e1 = (x+y)*pow((x+2*y),2)*pow((x+3*y),3)*pow((x+4*y),4);
-	e2 = sqrfree(expand(e1));
-	if (e1 != e2) {
-		clog << "sqrfree(expand(" << e1 << ")) erroneously returned "
-		     << e2 << endl;
+
+	const ex g = expand(pow(1 + x - y + 2*z/3, 5), expand_options::parallel);
+	if (!(g - expand(pow(1 + x - y + 2*z/3, 5))).is_zero()) {
+		clog << "parallel expansion of (1+x-y+2*z/3)^5 erroneously returned " << g << endl;
 		++result;
 	}
-	e2 = sqrfree(expand(e1),lst(x));
-	if (e1 != e2) {
-		clog << "sqrfree(expand(" << e1 << "),[x]) erroneously returned "
-		     << e2 << endl;
+
+	return result;
+}
+
+/* The thread limit applies to all parallel operations; results don't
+ * depend on it. */
+static unsigned exam_thread_limit()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y"), z("z");
+
+	set_max_threads(2);
+	if (max_threads() != 2 && max_threads() != 1) {
+		clog << "max_threads() erroneously returned " << max_threads()
+		     << " after set_max_threads(2)" << endl;
 		++result;
 	}
-	e2 = sqrfree(expand(e1),lst(y));
-	if (e1 != e2) {
-		clog << "sqrfree(expand(" << e1 << "),[y]) erroneously returned "
-		     << e2 << endl;
+
+	const ex p = pow(1 + x + y + z, 10);
+	const ex e = expand(p * (p - 1), expand_options::parallel);
+	set_max_threads(0);
+	if (!(e - expand(p * (p - 1))).is_zero()) {
+		clog << "parallel expansion with two threads erroneously returned " << e << endl;
 		++result;
 	}
-	e2 = sqrfree(expand(e1),lst(x,y));
-	if (e1 != e2) {
-		clog << "sqrfree(expand(" << e1 << "),[x,y]) erroneously returned "
-		     << e2 << endl;
+
+	// An irreducible polynomial lets the parallel trials stop early
+	const ex irr = pow(x, 2) + pow(y, 2) + pow(z, 2) + 1;
+	const ex f = factor(irr, factor_options::parallel);
+	if (!(f - irr).is_zero()) {
+		clog << "parallel factorization of " << irr << " erroneously returned " << f << endl;
 		++result;
 	}
-	
+	const ex red = expand(irr * (x*y - z + 2));
+	const ex g = factor(red, factor_options::parallel);
+	if (!(expand(g) - red).is_zero() || !is_a<mul>(g)) {
+		clog << "parallel factorization of " << red << " erroneously returned " << g << endl;
+		++result;
+	}
+
 	return result;
 }
 
-/* Arithmetic Operators should behave just as one expects from built-in types.
- * When somebody screws up the operators this routine will most probably fail
- * to compile.  Unfortunately we can only test the stuff that is allowed, not
- * what is forbidden (e.g. e1+e2 = 42) since that must not compile.  :-(   */
-static unsigned exam_operator_semantics()
+/* Computations stop with budget_exceeded when their budget is exhausted,
+ * and run normally afterwards. */
+static unsigned exam_budget()
 {
 	unsigned result = 0;
-	ex e1, e2;
-	int i1, i2;
-	
-	// Assignment should not return const ex though it may be obfuscated:
-	e1 = 7; e2 = 4;
-	i1 = 7; i2 = 4;
-	(e1 = e2) = 2;
-	(i1 = i2) = 2;
-	if (e1!=i1 || e2!=i2) {
-		clog << "Semantics of ex::operator=() screwed." << endl;
+	symbol x("x"), y("y"), z("z");
+	const ex p = expand(pow(1 + x + y + z, 8));
+
+	cancellation_token t;
+	t.cancel();
+	try {
+		computation_budget b;
+		b.set_token(t);
+		ex e = expand(p * (p + 1));
+		clog << "expansion with a cancelled token erroneously returned " << e.nops() << " terms" << endl;
 		++result;
+	} catch (const budget_exceeded & e) {
+		if (e.reason() != budget_exceeded::cancelled) {
+			clog << "cancelled expansion threw " << e.what() << endl;
+			++result;
+		}
 	}
-	(e1 += e2) = 2;
-	(i1 += i2) = 2;
-	if (e1!=i1 || e2!=i2) {
-		clog << "Semantics of ex::operator=() screwed." << endl;
+
+	matrix m(5, 5);
+	for (unsigned r=0; r<5; ++r)
+		for (unsigned c=0; c<5; ++c) {
+			std::ostringstream name;
+			name << "m" << r << c;
+			m(r, c) = symbol(name.str());
+		}
+	try {
+		computation_budget b;
+		b.set_node_limit(1);
+		ex d = m.determinant();
+		clog << "determinant with a node limit of 1 erroneously returned " << d << endl;
 		++result;
+	} catch (const budget_exceeded & e) {
+		if (e.reason() != budget_exceeded::node_limit) {
+			clog << "determinant with a node limit threw " << e.what() << endl;
+			++result;
+		}
 	}
-	(e1 -= e2) = 2;
-	(i1 -= i2) = 2;
-	if (e1!=i1 || e2!=i2) {
-		clog << "Semantics of ex::operator=() screwed." << endl;
-		++result;
+
+	ex d1;
+	{
+		computation_budget b;
+		b.set_time_limit(3600);
+		d1 = m.determinant();
 	}
-	
-	// Prefix/postfix increment/decrement behaviour:
-	e1 = 7; e2 = 4;
-	i1 = 7; i2 = 4;
-	e1 = (--e2 = 2)++;
-	i1 = (--i2 = 2)++;
-	if (e1!=i1 || e2!=i2) {
-		clog << "Semantics of increment/decrement operators screwed." << endl;
+	if (d1.is_zero() || !(d1 - m.determinant()).expand().is_zero()) {
+		clog << "determinant within a budget erroneously returned " << d1 << endl;
 		++result;
 	}
-	e1 = (++e2 = 2)--;
-	i1 = (++i2 = 2)--;
-	if (e1!=i1 || e2!=i2) {
-		clog << "Semantics of increment/decrement operators screwed." << endl;
+
+	return result;
+}
+
+/* Products of large polynomials are expanded in packed distributed form,
+ * check the result by evaluating at a point. */
+static unsigned exam_expand_packed()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y"), z("z");
+	const ex p = expand(pow(1 + x + 2*y/3 - z, 6));
+	const ex q = expand(pow(x - y*z + 3, 5) + pow(z, 40));
+	const lst pt(x == 2, y == -5, z == numeric(1, 7));
+
+	const ex e = expand(p * q);
+	if (!(e.subs(pt) - p.subs(pt) * q.subs(pt)).is_zero()) {
+		clog << "expansion of (1+x+2*y/3-z)^6*((x-y*z+3)^5+z^40) erroneously returned "
+		     << e << endl;
 		++result;
 	}
-	
-	// prefix increment/decrement must return an lvalue (contrary to postfix):
-	e1 = 7; e2 = 4;
-	i1 = 7; i2 = 4;
-	--++----e1;  ++(++++++++(++++e2));
-	--++----i1;  ++(++++++++(++++i2));
-	if (e1!=i1 || e2!=i2) {
-		clog << "Semantics of prefix increment/decrement operators screwed." << endl;
+
+	// non-polynomial factors take the ordinary route
+	const ex r = expand((p + sin(x)) * q);
+	if (!(r - e - expand(sin(x) * q)).is_zero()) {
+		clog << "expansion of ((1+x+2*y/3-z)^6+sin(x))*((x-y*z+3)^5+z^40) erroneously returned "
+		     << r << endl;
 		++result;
 	}
-	
-	// This one has a good chance of detecting problems in self-assignment:
-	// (which incidentally was severely broken from version 0.7.3 to 0.8.2).
-	ex selfprobe = numeric("65536");
-	selfprobe = selfprobe;
-	if (!is_exactly_a<numeric>(selfprobe)) {
-		clog << "ex (of numeric) after self-assignment became " << selfprobe << endl;
+
+	return result;
+}
+
+/* Expressions created inside a basic_arena must survive it. */
+static unsigned exam_arena()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y");
+	const ex e = expand(pow(x + y, 6) - pow(x - y, 6));
+	ex f, g;
+	{
+		basic_arena a;
+		f = factor(e);
+		{
+			basic_arena b;
+			g = expand(f);
+		}
+	}
+
+	if (!(g - e).is_zero() || !(expand(f) - e).is_zero()) {
+		clog << "factorization of " << e << " in a basic_arena erroneously returned "
+		     << f << endl;
 		++result;
 	}
-	
+
 	return result;
 }
 
-/* This checks whether subs() works as intended in some special cases. */
-static unsigned exam_subs()
+/* Big integers created by expand() live in the pools of basic_alloc() and
+ * must survive the arena they were created in. */
+static unsigned exam_numeric_alloc()
 {
 	unsigned result = 0;
 	symbol x("x");
-	ex e1, e2;
+	const numeric big = numeric(3).power(50);
+	ex e, c;
+	{
+		basic_arena a;
+		e = expand(pow(x + big, 4));
+		c = e.coeff(x, 1);
+	}
+	expand(pow(x - big, 8));  // reuses the memory of the arena
 
-	// This used to fail in GiNaC 1.0.5 because it first substituted
-	// x+1 -> (x-1)+1 -> x, and then substituted again x -> x-1, giving
-	// the wrong result
-	e1 = x+1;
-	e2 = e1.subs(x == x-1);
-	if (!e2.is_equal(x)) {
-		clog << "(x+1).subs(x==x-1) erroneously returned " << e2 << " instead of x" << endl;
+	if (!c.is_equal(4*pow(big, 3)) || !e.coeff(x, 0).is_equal(pow(big, 4))) {
+		clog << "coefficients of " << e << " were corrupted after leaving the arena" << endl;
 		++result;
 	}
 
-	// And this used to fail in GiNaC 1.5.8 because it first substituted
-	// exp(x) -> exp(log(x)) -> x, and then substitued again x -> log(x)
-	e1 = exp(x);
-	e2 = e1.subs(x == log(x));
-	if (!e2.is_equal(x)) {
-		clog << "exp(x).subs(x==log(x)) erroneously returned " << e2 << " instead of x" << endl;
+	return result;
+}
+
+/* With hash-consing, equal expressions share one object, and modifying
+ * one of them must not affect the others. */
+static unsigned exam_hash_consing()
+{
+	unsigned result = 0;
+#ifndef GINAC_THREAD_SAFE_REFCOUNT
+	symbol x("x"), y("y");
+	set_hash_consing(true);
+
+	ex e1 = pow(x, 2) + 2*y;
+	ex e2 = 2*y + pow(x, 2);
+	if (!are_ex_trivially_equal(e1, e2) || !are_ex_trivially_equal(e1.op(0), e2.op(0))) {
+		clog << "hash-consing failed to share " << e1 << " and " << e2 << endl;
 		++result;
 	}
 
-	e1 = sin(1+sin(x));
-	e2 = e1.subs(sin(wild()) == cos(wild()));
-	if (!e2.is_equal(cos(1+cos(x)))) {
-		clog << "sin(1+sin(x)).subs(sin($1)==cos($1)) erroneously returned " << e2 << " instead of cos(1+cos(x))" << endl;
+	lst l1(e1, x), l2(e1, x);
+	ex l = l1;
+	l.let_op(1) = y;
+	if (!l2.op(1).is_equal(x) || !lst(e1, x).is_equal(l1) || !l.op(1).is_equal(y)) {
+		clog << "modifying a hash-consed list erroneously gave " << l << ", " << l2 << endl;
+		++result;
+	}
+
+	// 3 and 3.0 are is_equal(), but must not replace each other
+	const ex exact = numeric(3), inexact = numeric(3.0);
+	const ex s1 = x + exact, s2 = x + inexact;
+	if (!ex_to<numeric>(inexact).is_equal(numeric(3)) || ex_to<numeric>(inexact).is_rational()
+	 || ex_to<numeric>(s2.op(1)).is_rational() || !ex_to<numeric>(s1.op(1)).is_rational()) {
+		clog << "hash-consing replaced " << inexact << " or " << s2 << " by an exact number" << endl;
 		++result;
 	}
 
+	set_hash_consing(false);
+	if ((e1 - e2).expand() != 0) {
+		clog << "hash-consed " << e1 << " and " << e2 << " erroneously differ" << endl;
+		++result;
+	}
+#endif
 	return result;
 }
 
-/* Joris van der Hoeven (he of TeXmacs fame) is a funny guy.  He has his own
- * ideas what a symbolic system should do.  Let's make sure we won't disappoint
- * him some day.  Incidentally, this seems to always have worked. */
-static unsigned exam_joris()
+/* Long sums and products are combined through a hash table, this must
+ * give the same as combining the terms one by one. */
+static unsigned exam_combine_hashed()
 {
 	unsigned result = 0;
-	symbol x("x");
+	symbol x("x"), y("y");
 
-	ex e = expand(pow(x, x-1) * x);
-	if (e != pow(x, x)) {
-		clog << "x^(x-1)*x did not expand to x^x.  Please call Joris!" << endl;
+	exvector terms, factors;
+	ex sum = 0, prod = 1;
+	for (int i = 0; i < 1000; ++i) {
+		const ex t = numeric(i % 7 - 3) * pow(x, i % 37) * pow(y, i % 5);
+		terms.push_back(t);
+		sum += t;
+		const ex f = (i % 3 == 0) ? sqrt(ex(2)) : pow(x + i % 11, i % 4 - 1);
+		factors.push_back(f);
+		prod *= f;
+	}
+	for (int i = 0; i < 1000; ++i)
+		terms.push_back(-terms[i]);
+
+	const ex s = add(terms);
+	if (!s.is_zero()) {
+		clog << "sum of 1000 terms and their negatives erroneously gave " << s << endl;
+		++result;
+	}
+	terms.resize(1000);
+	const ex s2 = add(terms);
+	if (!s2.is_equal(sum)) {
+		clog << "sum of 1000 terms erroneously gave " << s2 << " instead of " << sum << endl;
+		++result;
+	}
+	const ex p = mul(factors);
+	if (!p.is_equal(prod)) {
+		clog << "product of 1000 factors erroneously gave " << p << " instead of " << prod << endl;
 		++result;
 	}
 
 	return result;
 }
 
-/* Test Chris Dams' algebraic substitutions. */
-static unsigned exam_subs_algebraic()
+/* The coefficients of like terms are summed up over a common denominator,
+ * which must give the same as adding the numbers one by one. */
+static unsigned exam_combine_rational()
 {
 	unsigned result = 0;
 	symbol x("x"), y("y");
 
-	ex e = ex(x*x*x*y*y).subs(x*y==2, subs_options::algebraic);
-	if (e != 4*x) {
-		clog << "(x^3*y^2).subs(x*y==2,subs_options::algebraic) erroneously returned " << e << endl;
+	// few terms (sorted) and many terms (hashed), small integers, fractions
+	// with different denominators, and a floating-point number
+	const int sizes[] = { 5, 2000 };
+	for (int k = 0; k < 2; ++k) {
+		exvector terms;
+		numeric cx, cy;
+		for (int i = 1; i <= sizes[k]; ++i) {
+			const numeric c = (i % 3 == 0) ? numeric(i % 200) : numeric(i, i % 17 + 2);
+			terms.push_back(c * x);
+			cx = cx + c;
+			terms.push_back(-c * y);
+			cy = cy - c;
+		}
+		terms.push_back(numeric(1.5) * y);
+		cy = cy + numeric(1.5);
+		const ex s = add(terms);
+		const ex expected = cx * x + cy * y;
+		if (!s.is_equal(expected)) {
+			clog << "sum of " << terms.size() << " rational terms erroneously gave "
+			     << s << " instead of " << expected << endl;
+			++result;
+		}
+	}
+
+	// cancellation to zero and to an integer coefficient
+	exvector v;
+	v.push_back(numeric(1, 3) * x);
+	v.push_back(numeric(1, 6) * x);
+	v.push_back(numeric(-1, 2) * x);
+	v.push_back(numeric(1, 4) * y);
+	v.push_back(numeric(3, 4) * y);
+	const ex z = add(v);
+	if (!z.is_equal(y)) {
+		clog << "x/3+x/6-x/2+y/4+3*y/4 erroneously gave " << z << endl;
 		++result;
 	}
 
-	e = ex(x*x*x*x*x).subs(x*x==y, subs_options::algebraic);
-	if (e != y*y*x) {
-		clog << "x^5.subs(x^2==y,subs_options::algebraic) erroneously returned " << e << endl;
+	return result;
+}
+
+/* subs(), has(), evalf() and diff() visit shared subexpressions only once,
+ * this expression has 2^300 paths from the root to x. */
+static unsigned exam_shared_subexpressions()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y"), z("z");
+
+	ex e = x;
+	double v = 1;
+	for (int i = 0; i < 300; ++i) {
+		e = sin(e) + cos(e);
+		v = std::sin(v) + std::cos(v);
+	}
+
+	if (!e.has(x) || e.has(z)) {
+		clog << "has() failed on a deep shared expression" << endl;
+		++result;
+	}
+	const ex s = e.subs(x == y);
+	if (s.has(x) || !s.has(y)) {
+		clog << "subs(x == y) failed on a deep shared expression" << endl;
+		++result;
+	}
+	const ex f = s.subs(y == 1).evalf();
+	if (!is_a<numeric>(f) || abs(ex_to<numeric>(f) - v) > 1e-10) {
+		clog << "evalf() of a deep shared expression gave " << f << " instead of " << v << endl;
+		++result;
+	}
+	const ex d = e.diff(x);
+	if (d.is_zero() || !d.has(x) || !e.diff(y).is_zero()) {
+		clog << "diff() failed on a deep shared expression" << endl;
 		++result;
 	}
 
-	e=x*x*y;
-	if (!e.has(x*y, has_options::algebraic))
-	{	clog << "(x^2*y).has(x*y, has_options::algebraic) erroneously returned false." << endl;
+	return result;
+}
+
+/* has(), degree(), coeff() and subs() skip subexpressions by their symbol
+ * masks, where more than 32 symbols have to share some bits. */
+static unsigned exam_symbol_masks()
+{
+	unsigned result = 0;
+	symbol z("z");
+	exvector x;
+	ex e = 1;
+	for (int i = 0; i < 40; ++i) {
+		x.push_back(symbol());
+		e += pow(x[i] + 1, i + 1);
+	}
+	e = expand(e);
+	symbol y("y");
+
+	for (int i = 0; i < 40; ++i) {
+		if (!e.has(x[i]) || e.degree(x[i]) != i + 1 || e.ldegree(x[i]) != 0 ||
+		    !e.coeff(x[i], i + 1).is_equal(1)) {
+			clog << "has(), degree() or coeff() failed for x" << i << endl;
+			++result;
+		}
+	}
+	if (e.has(y) || e.has(z) || e.degree(y) != 0 || !e.coeff(y, 0).is_equal(e) ||
+	    !e.coeff(y, 1).is_zero()) {
+		clog << "has(), degree() or coeff() failed for a missing symbol" << endl;
+		++result;
+	}
+	const ex s = e.subs(lst(x[0] == y, x[39] == z));
+	if (s.has(x[0]) || s.has(x[39]) || s.degree(y) != 1 || s.degree(z) != 40 ||
+	    s.degree(x[38]) != 39) {
+		clog << "subs() failed on an expression with many symbols" << endl;
 		++result;
 	}
 
-	if (e.has(x*y*y, has_options::algebraic))
-	{	clog << "(x^2*y).has(x*y*y, has_options::algebraic) erroneously returned true." << endl;
+	return result;
+}
+
+/* The run-time statistics count nothing while they are switched off. */
+static unsigned exam_statistics()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y");
+
+	reset_statistics();
+	ex e = expand(pow(x + y + 1, 4));
+	if (!get_statistics().empty()) {
+		clog << "statistics were collected although switched off" << endl;
 		++result;
 	}
 
-	e=x*x*x*y;
-	if (!e.has(x*x, has_options::algebraic))
-	{	clog << "(x^3*y).has(x*x, has_options::algebraic) erroneously returned false." << endl;
+	set_statistics_enabled(true);
+	e = expand(pow(x + y + 2, 4));
+	set_statistics_enabled(false);
+	const statistics_map m = get_statistics();
+	statistics_map::const_iterator it = m.find("add");
+	if (it == m.end() || it->second.constructions == 0 || it->second.compares == 0) {
+		clog << "no additions counted in the expansion of (x+y+2)^4" << endl;
+		++result;
+	}
+	it = m.find("power");
+	if (it == m.end() || it->second.expands == 0) {
+		clog << "no expansion of a power counted in the expansion of (x+y+2)^4" << endl;
 		++result;
 	}
 
-	if (e.has(y*y, has_options::algebraic))
-	{	clog << "(x^3*y).has(y*y, has_options::algebraic) erroneously returned true." << endl;
+	reset_statistics();
+	if (!get_statistics().empty()) {
+		clog << "reset_statistics() didn't clear the counters" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* Memory accounting: objects created while it is on are counted until
+ * they die. */
+static unsigned exam_memory_usage()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y");
+
+	set_memory_accounting_enabled(true);
+	reset_memory_peaks();
+	const memory_usage before = get_memory_usage();
+	ex e = expand(pow(x + y + 3, 5));
+	const memory_usage during = get_memory_usage();
+	memory_usage_map::const_iterator it = during.classes.find("add");
+	if (it == during.classes.end() || it->second.objects == 0 ||
+	    it->second.bytes < it->second.objects * sizeof(add)) {
+		clog << "no live sums accounted after expanding (x+y+3)^5" << endl;
+		++result;
+	}
+	if (during.peak_bytes < during.bytes || during.bytes <= before.bytes) {
+		clog << "inconsistent totals: " << during.bytes << " bytes, peak "
+		     << during.peak_bytes << endl;
+		++result;
+	}
+
+	e = 0;
+	set_memory_accounting_enabled(false);
+	const memory_usage after = get_memory_usage();
+	if (after.objects != before.objects || after.bytes != before.bytes) {
+		clog << "objects of the expansion still accounted after they died: "
+		     << after.objects - before.objects << endl;
+		++result;
+	}
+	if (after.peak_bytes < during.bytes) {
+		clog << "peak below an earlier usage" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* Tracing: nested scopes are timed by name and exported as folded stacks
+ * and Chrome trace events. */
+static unsigned exam_trace()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y");
+
+	reset_trace();
+	ex e = factor(expand(pow(x + y, 3) * (x - 2)));
+	if (!get_trace().empty()) {
+		clog << "scopes were traced although tracing was off" << endl;
+		++result;
+	}
+
+	set_tracing_enabled(true);
+	{
+		trace_scope t("exam_trace");
+		e = factor(expand(pow(x + y, 4) * (x - 3)));
+	}
+	set_tracing_enabled(false);
+	const trace_map m = get_trace();
+	trace_map::const_iterator outer = m.find("exam_trace"), inner = m.find("factor");
+	if (outer == m.end() || outer->second.calls != 1 ||
+	    inner == m.end() || inner->second.calls == 0 ||
+	    inner->second.total > outer->second.total) {
+		clog << "factor() was not traced inside the outer scope" << endl;
+		++result;
+	}
+
+	std::ostringstream folded, chrome;
+	write_folded_trace(folded);
+	write_chrome_trace(chrome);
+	if (folded.str().find("exam_trace;factor ") == std::string::npos) {
+		clog << "no folded stack exam_trace;factor in:" << endl << folded.str();
+		++result;
+	}
+	if (chrome.str().find("\"name\":\"factor\"") == std::string::npos) {
+		clog << "no event for factor() in the Chrome trace" << endl;
+		++result;
+	}
+
+	reset_trace();
+	if (!get_trace().empty()) {
+		clog << "reset_trace() didn't clear the times" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* Powers of sums of monomials are expanded from exponent vectors, or by
+ * repeated squaring if they are dense; check them against repeated
+ * multiplication. */
+static unsigned exam_expand_power_monomials()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y"), z("z");
+
+	const ex sums[] = {
+		x + y + z + 1,
+		2*x*pow(y, 2) - numeric(3, 2)*z + pow(x, -1) - 7,
+		x*y + pow(x, 2) - pow(y, 3)*z + I*x,
+		1 - x + 3*pow(x, 2) + pow(x, 3)/2 + pow(x, 4) - 2*pow(x, 5) + pow(x, 6) + pow(x, 7)
+	};
+	for (size_t i=0; i<sizeof(sums)/sizeof(sums[0]); ++i) {
+		ex product = 1;
+		for (int n=1; n<=6; ++n) {
+			product = expand(product * sums[i]);
+			const ex serial = expand(pow(sums[i], n));
+			const ex parallel = expand(pow(sums[i], n), expand_options::parallel);
+			if (!(serial - product).is_zero() || !(parallel - product).is_zero()) {
+				clog << "expand(" << pow(sums[i], n) << ") erroneously returned "
+				     << serial << " (parallel: " << parallel << "), should be "
+				     << product << endl;
+				++result;
+			}
+		}
+	}
+
+	return result;
+}
+
+static unsigned golden_ratio_evaluations = 0;
+
+static ex golden_ratio_evalf()
+{
+	++golden_ratio_evaluations;
+	return evalf((1 + sqrt(ex(5)))/2);
+}
+
+/* The values of constants are cached at the highest precision computed so
+ * far, and rounded for lower ones. */
+static unsigned exam_constant_cache()
+{
+	unsigned result = 0;
+	const long digits = Digits;
+	const constant phi("phi", golden_ratio_evalf);
+
+	Digits = 60;
+	const ex pi60 = evalf(Pi), phi60 = evalf(phi);
+	Digits = 20;
+	const ex pi20 = evalf(Pi), phi20 = evalf(phi), phi20b = evalf(phi);
+	if (golden_ratio_evaluations != 1) {
+		clog << "phi was evaluated " << golden_ratio_evaluations
+		     << " times instead of once" << endl;
+		++result;
+	}
+	if (abs(ex_to<numeric>(pi20 - pi60)) > numeric(1, 1000000000000000000LL) ||
+	    abs(ex_to<numeric>(phi20 - phi60)) > numeric(1, 1000000000000000000LL) ||
+	    !phi20.is_equal(phi20b)) {
+		clog << "cached constants were rounded wrongly: Pi = " << pi20
+		     << ", phi = " << phi20 << endl;
+		++result;
+	}
+
+	Digits = 80;
+	const ex phi80 = evalf(phi);
+	if (golden_ratio_evaluations != 2 ||
+	    abs(ex_to<numeric>(phi80 - phi60)) > numeric(1, 1000000000000000000LL)) {
+		clog << "phi was not evaluated again for more digits" << endl;
+		++result;
+	}
+
+	Digits = digits;
+	return result;
+}
+
+/* The bytecode backend of compile_ex() must agree with evalf(). */
+static unsigned exam_compile_ex_bytecode()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y");
+	const unsigned backend = get_compile_ex_backend();
+	set_compile_ex_backend(compile_ex_backends::bytecode);
+
+	const ex e1 = pow(sin(x), 2) + pow(x, -3)/2 - sqrt(x)*exp(x) + Pi*log(x);
+	FUNCP_1P f1;
+	compile_ex(e1, x, f1);
+	const double v1 = ex_to<numeric>(e1.subs(x == numeric(7, 10)).evalf()).to_double();
+	if (std::fabs(f1(0.7) - v1) > 1e-12 * std::fabs(v1)) {
+		clog << "bytecode for " << e1 << " erroneously returned " << f1(0.7)
+		     << " instead of " << v1 << endl;
+		++result;
+	}
+
+	const ex e2 = pow(x + y, 5) - atan2(y, x)*x/3;
+	FUNCP_2P f2;
+	compile_ex(e2, x, y, f2);
+	const double v2 = ex_to<numeric>(e2.subs(lst(x == numeric(1, 4), y == 2)).evalf()).to_double();
+	if (std::fabs(f2(0.25, 2) - v2) > 1e-12 * std::fabs(v2)) {
+		clog << "bytecode for " << e2 << " erroneously returned " << f2(0.25, 2)
+		     << " instead of " << v2 << endl;
+		++result;
+	}
+
+	FUNCP_CUBA f3;
+	compile_ex(lst(x*y, x - y), lst(x, y), f3);
+	const int an = 2, fn = 2;
+	const double a[2] = { 3, 5 };
+	double f[2];
+	f3(&an, a, &fn, f);
+	if (f[0] != 15 || f[1] != -2) {
+		clog << "bytecode for {x*y, x-y} erroneously returned {" << f[0] << ", " << f[1] << "}" << endl;
+		++result;
+	}
+
+	const matrix jac(2, 2, lst(y, x, 2*x, pow(sin(x*y), 2)));
+	FUNCP_CUBA f5;
+	compile_ex(jac, lst(x, y), f5);
+	double g[4];
+	f5(&an, a, &fn, g);
+	if (g[0] != 5 || g[1] != 3 || g[2] != 6 || std::fabs(g[3] - std::pow(std::sin(15.), 2)) > 1e-12) {
+		clog << "bytecode for " << jac << " erroneously returned {"
+		     << g[0] << ", " << g[1] << ", " << g[2] << ", " << g[3] << "}" << endl;
+		++result;
+	}
+
+	FUNCP_BATCH_2P f4;
+	compile_ex(e2, x, y, f4);
+	double xs[100], ys[100], out[100];
+	for (int i = 0; i < 100; ++i) {
+		xs[i] = 0.01 * (i + 1);
+		ys[i] = 2 - 0.01 * i;
+	}
+	f4(100, xs, ys, out);
+	for (int i = 0; i < 100; ++i) {
+		if (std::fabs(out[i] - f2(xs[i], ys[i])) > 1e-12 * std::fabs(out[i])) {
+			clog << "batch bytecode for " << e2 << " erroneously returned " << out[i]
+			     << " at (" << xs[i] << ", " << ys[i] << ")" << endl;
+			++result;
+			break;
+		}
+	}
+
+	// Released functions must free their slots for reuse.
+	for (int i = 0; i < 2000; ++i) {
+		FUNCP_1P fi;
+		compile_ex(x + i, x, fi);
+		if (fi(0.5) != i + 0.5) {
+			clog << "bytecode for x+" << i << " erroneously returned " << fi(0.5) << endl;
+			++result;
+			break;
+		}
+		release_ex(fi);
+	}
+	if (std::fabs(f1(0.7) - v1) > 1e-12 * std::fabs(v1)) {
+		clog << "bytecode for " << e1 << " was lost by releasing other functions" << endl;
+		++result;
+	}
+
+	release_ex(f1);
+	release_ex(f2);
+	release_ex(f3);
+	release_ex(f5);
+	release_ex(f4);
+	set_compile_ex_backend(backend);
+	return result;
+}
+
+/* kernel_source_ex() must read the parameters and write the results in
+ * the documented layout, and compute common subexpressions once. */
+static unsigned exam_kernel_source()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y");
+	const ex common = sin(x*y);
+	const lst exprs(common + x, pow(common, 2) - y);
+
+	const string cl = kernel_source_ex(exprs, lst(x, y), kernel_dialects::opencl, "integrand");
+	const string cu = kernel_source_ex(exprs, lst(x, y), kernel_dialects::cuda, "integrand");
+	if (cl.find("__kernel void integrand(") == string::npos
+	 || cl.find("get_global_id(0)") == string::npos) {
+		clog << "OpenCL kernel has wrong signature:" << endl << cl;
+		++result;
+	}
+	if (cu.find("__global__ void integrand(") == string::npos
+	 || cu.find("threadIdx.x") == string::npos) {
+		clog << "CUDA kernel has wrong signature:" << endl << cu;
+		++result;
+	}
+	const char * parts[] = { "a[0*n+i]", "a[1*n+i]", "f[0*n+i] = ", "f[1*n+i] = ", "cse_0" };
+	for (size_t i = 0; i < sizeof(parts)/sizeof(parts[0]); ++i) {
+		if (cl.find(parts[i]) == string::npos || cu.find(parts[i]) == string::npos) {
+			clog << "kernels do not contain " << parts[i] << ":" << endl << cl << cu;
+			++result;
+		}
+	}
+	if (cl.find("sin(") != cl.rfind("sin(")) {
+		clog << "common subexpression computed more than once:" << endl << cl;
+		++result;
+	}
+	return result;
+}
+
+static unsigned exam_horner()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y");
+
+	const ex p = 1 + 2*x + 3*pow(x, 2) + 4*pow(x, 3);
+	const ex h = horner_ex(p);
+	const ex expected = 1 + x*(2 + x*(3 + 4*x));
+	if (!h.is_equal(expected)) {
+		clog << "horner_ex(" << p << ") erroneously returned " << h
+		     << " instead of " << expected << endl;
+		++result;
+	}
+
+	// Multivariate, with coefficients which are not polynomials
+	const ex q = (pow(x + 2*y + 1, 5) + sin(pow(x, 2) + 2*pow(x, 3))*y).expand();
+	const ex hq = horner_ex(q);
+	if (!(hq.expand() - q).expand().is_zero() || hq.nops() >= q.nops()) {
+		clog << "horner_ex(" << q << ") erroneously returned " << hq << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* Functions with a double_func or double_batch_func must be computed with
+ * them by compile_ex() and evalf_double(). */
+static ex hyp_fcn_evalf(const ex & x, const ex & y)
+{
+	return sqrt(pow(x, 2) + pow(y, 2));
+}
+
+static double hyp_fcn_double(const double * args)
+{
+	return std::sqrt(args[0]*args[0] + args[1]*args[1]);
+}
+
+DECLARE_FUNCTION_2P(hyp_fcn)
+REGISTER_FUNCTION(hyp_fcn, evalf_func(hyp_fcn_evalf).double_func(hyp_fcn_double));
+
+static ex cube_fcn_evalf(const ex & x)
+{
+	return pow(x, 3);
+}
+
+static void cube_fcn_batch(size_t n, const double * const * args, double * out)
+{
+	for (size_t i = 0; i < n; ++i)
+		out[i] = args[0][i] * args[0][i] * args[0][i];
+}
+
+DECLARE_FUNCTION_1P(cube_fcn)
+REGISTER_FUNCTION(cube_fcn, evalf_func(cube_fcn_evalf).double_batch_func(cube_fcn_batch));
+
+static unsigned exam_double_kernels()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y");
+
+	// compiled with the bytecode backend whatever backend is selected
+	const ex e = hyp_fcn(x, 2*y) * cube_fcn(x - y) + sin(x);
+	FUNCP_2P f;
+	compile_ex(e, x, y, f);
+	const double v = ex_to<numeric>(e.subs(lst(x == numeric(3, 4), y == numeric(-1, 2))).evalf()).to_double();
+	if (std::fabs(f(0.75, -0.5) - v) > 1e-12 * std::fabs(v)) {
+		clog << "compiled " << e << " erroneously returned " << f(0.75, -0.5)
+		     << " instead of " << v << endl;
+		++result;
+	}
+
+	FUNCP_BATCH_2P fb;
+	compile_ex(e, x, y, fb);
+	std::vector<double> xs, ys, out(100);
+	for (int i = 0; i < 100; ++i) {
+		xs.push_back(i / 10.);
+		ys.push_back(1 - i / 25.);
+	}
+	fb(xs.size(), &xs[0], &ys[0], &out[0]);
+	for (size_t i = 0; i < xs.size(); ++i) {
+		const double d = f(xs[i], ys[i]);
+		if (std::fabs(out[i] - d) > 1e-12 * (1 + std::fabs(d))) {
+			clog << "batch code for " << e << " erroneously returned " << out[i]
+			     << " instead of " << d << " at point " << i << endl;
+			++result;
+			break;
+		}
+	}
+
+	std::vector<double> args;
+	args.push_back(0.75);
+	args.push_back(-0.5);
+	const double w = eval_plan(hyp_fcn(x, 2*y) + cube_fcn(y), lst(x, y)).evalf(args);
+	if (std::fabs(w - (1.25 - 0.125)) > 1e-12) {
+		clog << "eval_plan erroneously returned " << w << " for hyp_fcn(3/4, -1) + cube_fcn(-1/2)" << endl;
+		++result;
+	}
+
+	const std::complex<double> z = evalf_double(hyp_fcn(numeric(3), numeric(4)));
+	if (z != std::complex<double>(5)) {
+		clog << "evalf_double(hyp_fcn(3, 4)) erroneously returned " << z << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* eval_plan must agree with subs() and evalf(). */
+static unsigned exam_eval_plan()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y");
+
+	const ex e = pow(sin(x), 2) + pow(x + y, 5)/3 - Pi*sqrt(x)*y + zeta(x + 2) + pow(x, y);
+	const eval_plan p(e, lst(x, y));
+
+	std::vector<std::vector<numeric> > rows;
+	std::vector<std::vector<double> > drows;
+	for (int i = 1; i <= 20; ++i) {
+		std::vector<numeric> r;
+		r.push_back(numeric(i, 7));
+		r.push_back(numeric(3 - i, 5));
+		rows.push_back(r);
+		drows.push_back(std::vector<double>());
+		drows.back().push_back(r[0].to_double());
+		drows.back().push_back(r[1].to_double());
+	}
+
+	const std::vector<numeric> values = p.evalf_rows(rows);
+	const std::vector<double> dvalues = p.evalf_rows(drows, true);
+	for (size_t i = 0; i < rows.size(); ++i) {
+		const ex v = e.subs(lst(x == rows[i][0], y == rows[i][1])).evalf();
+		if (!is_a<numeric>(v) || abs(ex_to<numeric>(v) - values[i]) > (1 + abs(ex_to<numeric>(v)))/1000000000) {
+			clog << "eval_plan for " << e << " erroneously returned " << values[i]
+			     << " instead of " << v << endl;
+			++result;
+		}
+		const double d = ex_to<numeric>(v).to_double();
+		if (std::fabs(dvalues[i] - d) > 1e-12 * (1 + std::fabs(d))) {
+			clog << "eval_plan for " << e << " erroneously returned " << dvalues[i]
+			     << " in double precision instead of " << d << endl;
+			++result;
+		}
+	}
+
+	// Complex arguments and constants, in complex double precision
+	const ex ce = exp(I*x)*y + pow(x + I, 3) - log(x)*y + zeta(x + 2);
+	const eval_plan cp(ce, lst(x, y));
+	std::vector<std::vector<std::complex<double> > > crows;
+	for (int i = 1; i <= 20; ++i) {
+		crows.push_back(std::vector<std::complex<double> >());
+		crows.back().push_back(std::complex<double>(i / 7.0, (3 - i) / 5.0));
+		crows.back().push_back(std::complex<double>(-i / 4.0, 0.5));
+	}
+	const std::vector<std::complex<double> > cvalues = cp.evalf_rows(crows, true);
+	for (size_t i = 0; i < crows.size(); ++i) {
+		const numeric cx = numeric(crows[i][0].real()) + numeric(crows[i][0].imag())*I;
+		const numeric cy = numeric(crows[i][1].real()) + numeric(crows[i][1].imag())*I;
+		const ex v = ce.subs(lst(x == cx, y == cy)).evalf();
+		std::complex<double> c;
+		if (is_a<numeric>(v))
+			c = std::complex<double>(ex_to<numeric>(v).real().to_double(), ex_to<numeric>(v).imag().to_double());
+		if (!is_a<numeric>(v) || std::abs(cvalues[i] - c) > 1e-12 * (1 + std::abs(c))) {
+			clog << "eval_plan for " << ce << " erroneously returned " << cvalues[i]
+			     << " in complex double precision instead of " << v << endl;
+			++result;
+		}
+	}
+
+	return result;
+}
+
+static unsigned exam_eval_state()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y"), z("z");
+
+	const ex e = pow(sin(x) + y, 3) * exp(y) + zeta(z + 2) * x + pow(z, 4);
+	const eval_plan p(e, lst(x, y, z));
+	std::vector<numeric> args;
+	args.push_back(numeric(1, 3));
+	args.push_back(numeric(2, 5));
+	args.push_back(numeric(1, 2));
+	eval_state st(p, args);
+	st.value();
+
+	// Scan over z, then over x, checking that only the parts depending on
+	// the changed variable are computed again
+	for (int i = 1; i <= 10; ++i) {
+		const numeric zv(i, 9), xv(-i, 4);
+		const bool scan_z = i <= 5;
+		if (scan_z) {
+			st.set(z, zv);
+			args[2] = zv;
+		} else {
+			st.set(0, xv);
+			args[0] = xv;
+		}
+		const numeric v = st.value();
+		const ex w = e.subs(lst(x == args[0], y == args[1], z == args[2])).evalf();
+		if (!is_a<numeric>(w) || abs(ex_to<numeric>(w) - v) > (1 + abs(v))/1000000000) {
+			clog << "eval_state for " << e << " erroneously returned " << v
+			     << " instead of " << w << endl;
+			++result;
+		}
+		if (st.recomputed() == 0 || st.recomputed() >= p.size()) {
+			clog << "eval_state for " << e << " computed " << st.recomputed()
+			     << " of " << p.size() << " operations after changing one variable" << endl;
+			++result;
+		}
+	}
+
+	st.set(y, args[1]);
+	st.value();
+	if (st.recomputed() != 0) {
+		clog << "eval_state computed " << st.recomputed() << " operations without changes" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+static unsigned exam_sqrfree()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y");
+	ex e1, e2;
+	
+	e1 = (1+x)*pow((2+x),2)*pow((3+x),3)*pow((4+x),4);
+	e2 = sqrfree(expand(e1),lst(x));
+	if (e1 != e2) {
+		clog << "sqrfree(expand(" << e1 << ")) erroneously returned "
+		     << e2 << endl;
+		++result;
+	}
+	
+	e1 = (x+y)*pow((x+2*y),2)*pow((x+3*y),3)*pow((x+4*y),4);
+	e2 = sqrfree(expand(e1));
+	if (e1 != e2) {
+		clog << "sqrfree(expand(" << e1 << ")) erroneously returned "
+		     << e2 << endl;
+		++result;
+	}
+	e2 = sqrfree(expand(e1),lst(x));
+	if (e1 != e2) {
+		clog << "sqrfree(expand(" << e1 << "),[x]) erroneously returned "
+		     << e2 << endl;
+		++result;
+	}
+	e2 = sqrfree(expand(e1),lst(y));
+	if (e1 != e2) {
+		clog << "sqrfree(expand(" << e1 << "),[y]) erroneously returned "
+		     << e2 << endl;
+		++result;
+	}
+	e2 = sqrfree(expand(e1),lst(x,y));
+	if (e1 != e2) {
+		clog << "sqrfree(expand(" << e1 << "),[x,y]) erroneously returned "
+		     << e2 << endl;
+		++result;
+	}
+
+	// factors not depending on the first variable
+	e1 = pow(x*y+1,2)*pow(x-y,3)*(y+2);
+	e2 = sqrfree(expand(e1),lst(x,y));
+	if (e1 != e2) {
+		clog << "sqrfree(expand(" << e1 << "),[x,y]) erroneously returned "
+		     << e2 << endl;
+		++result;
+	}
+
+	// non-monic factors
+	e1 = pow(3*x+5*y,2)*pow(7*x*y-11,3);
+	e2 = sqrfree(expand(e1),lst(x,y));
+	if (e1 != e2) {
+		clog << "sqrfree(expand(" << e1 << "),[x,y]) erroneously returned "
+		     << e2 << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* Arithmetic Operators should behave just as one expects from built-in types.
+ * When somebody screws up the operators this routine will most probably fail
+ * to compile.  Unfortunately we can only test the stuff that is allowed, not
+ * what is forbidden (e.g. e1+e2 = 42) since that must not compile.  :-(   */
+static unsigned exam_operator_semantics()
+{
+	unsigned result = 0;
+	ex e1, e2;
+	int i1, i2;
+	
+	// Assignment should not return const ex though it may be obfuscated:
+	e1 = 7; e2 = 4;
+	i1 = 7; i2 = 4;
+	(e1 = e2) = 2;
+	(i1 = i2) = 2;
+	if (e1!=i1 || e2!=i2) {
+		clog << "Semantics of ex::operator=() screwed." << endl;
+		++result;
+	}
+	(e1 += e2) = 2;
+	(i1 += i2) = 2;
+	if (e1!=i1 || e2!=i2) {
+		clog << "Semantics of ex::operator=() screwed." << endl;
+		++result;
+	}
+	(e1 -= e2) = 2;
+	(i1 -= i2) = 2;
+	if (e1!=i1 || e2!=i2) {
+		clog << "Semantics of ex::operator=() screwed." << endl;
+		++result;
+	}
+	
+	// Prefix/postfix increment/decrement behaviour:
+	e1 = 7; e2 = 4;
+	i1 = 7; i2 = 4;
+	e1 = (--e2 = 2)++;
+	i1 = (--i2 = 2)++;
+	if (e1!=i1 || e2!=i2) {
+		clog << "Semantics of increment/decrement operators screwed." << endl;
+		++result;
+	}
+	e1 = (++e2 = 2)--;
+	i1 = (++i2 = 2)--;
+	if (e1!=i1 || e2!=i2) {
+		clog << "Semantics of increment/decrement operators screwed." << endl;
+		++result;
+	}
+	
+	// prefix increment/decrement must return an lvalue (contrary to postfix):
+	e1 = 7; e2 = 4;
+	i1 = 7; i2 = 4;
+	--++----e1;  ++(++++++++(++++e2));
+	--++----i1;  ++(++++++++(++++i2));
+	if (e1!=i1 || e2!=i2) {
+		clog << "Semantics of prefix increment/decrement operators screwed." << endl;
+		++result;
+	}
+	
+	// This one has a good chance of detecting problems in self-assignment:
+	// (which incidentally was severely broken from version 0.7.3 to 0.8.2).
+	ex selfprobe = numeric("65536");
+	selfprobe = selfprobe;
+	if (!is_exactly_a<numeric>(selfprobe)) {
+		clog << "ex (of numeric) after self-assignment became " << selfprobe << endl;
+		++result;
+	}
+	
+	return result;
+}
+
+/* This checks whether subs() works as intended in some special cases. */
+static unsigned exam_subs()
+{
+	unsigned result = 0;
+	symbol x("x");
+	ex e1, e2;
+
+	// This used to fail in GiNaC 1.0.5 because it first substituted
+	// x+1 -> (x-1)+1 -> x, and then substituted again x -> x-1, giving
+	// the wrong result
+	e1 = x+1;
+	e2 = e1.subs(x == x-1);
+	if (!e2.is_equal(x)) {
+		clog << "(x+1).subs(x==x-1) erroneously returned " << e2 << " instead of x" << endl;
+		++result;
+	}
+
+	// And this used to fail in GiNaC 1.5.8 because it first substituted
+	// exp(x) -> exp(log(x)) -> x, and then substitued again x -> log(x)
+	e1 = exp(x);
+	e2 = e1.subs(x == log(x));
+	if (!e2.is_equal(x)) {
+		clog << "exp(x).subs(x==log(x)) erroneously returned " << e2 << " instead of x" << endl;
+		++result;
+	}
+
+	e1 = sin(1+sin(x));
+	e2 = e1.subs(sin(wild()) == cos(wild()));
+	if (!e2.is_equal(cos(1+cos(x)))) {
+		clog << "sin(1+sin(x)).subs(sin($1)==cos($1)) erroneously returned " << e2 << " instead of cos(1+cos(x))" << endl;
+		++result;
+	}
+
+	// Substitutions for symbols only are looked up by serial number
+	symbol y("y");
+	exmap m;
+	m[x] = y;
+	m[y] = x;
+	e1 = sin(x)*pow(y, 2) + x + exp(x*y);
+	e2 = e1.subs(m);
+	if (!e2.is_equal(sin(y)*pow(x, 2) + y + exp(x*y))) {
+		clog << e1 << ".subs({x==y,y==x}) erroneously returned " << e2 << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* Joris van der Hoeven (he of TeXmacs fame) is a funny guy.  He has his own
+ * ideas what a symbolic system should do.  Let's make sure we won't disappoint
+ * him some day.  Incidentally, this seems to always have worked. */
+static unsigned exam_joris()
+{
+	unsigned result = 0;
+	symbol x("x");
+
+	ex e = expand(pow(x, x-1) * x);
+	if (e != pow(x, x)) {
+		clog << "x^(x-1)*x did not expand to x^x.  Please call Joris!" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* Test Chris Dams' algebraic substitutions. */
+static unsigned exam_subs_algebraic()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y");
+
+	ex e = ex(x*x*x*y*y).subs(x*y==2, subs_options::algebraic);
+	if (e != 4*x) {
+		clog << "(x^3*y^2).subs(x*y==2,subs_options::algebraic) erroneously returned " << e << endl;
+		++result;
+	}
+
+	e = ex(x*x*x*x*x).subs(x*x==y, subs_options::algebraic);
+	if (e != y*y*x) {
+		clog << "x^5.subs(x^2==y,subs_options::algebraic) erroneously returned " << e << endl;
+		++result;
+	}
+
+	e=x*x*y;
+	if (!e.has(x*y, has_options::algebraic))
+	{	clog << "(x^2*y).has(x*y, has_options::algebraic) erroneously returned false." << endl;
+		++result;
+	}
+
+	if (e.has(x*y*y, has_options::algebraic))
+	{	clog << "(x^2*y).has(x*y*y, has_options::algebraic) erroneously returned true." << endl;
+		++result;
+	}
+
+	e=x*x*x*y;
+	if (!e.has(x*x, has_options::algebraic))
+	{	clog << "(x^3*y).has(x*x, has_options::algebraic) erroneously returned false." << endl;
+		++result;
+	}
+
+	if (e.has(y*y, has_options::algebraic))
+	{	clog << "(x^3*y).has(y*y, has_options::algebraic) erroneously returned true." << endl;
+		++result;
+	}
+
+	return result;
+}
+
+static unsigned exam_evalf_double()
+{
+	unsigned result = 0;
+
+	lst exprs;
+	exprs.append(sin(ex(1)) + exp(ex(2)));
+	exprs.append(log(ex(-2)));
+	exprs.append(sqrt(-4) + pow(3, numeric(1, 3)));
+	exprs.append(tgamma(numeric(5, 2)) * Pi);
+	exprs.append(Li2(numeric(1, 3)) - Li2(-3) + atan(numeric(1, 2)));
+	exprs.append(Li2(numeric(3, 10) + numeric(2, 5)*I) + Li2(2 + I) - Li2(-5 - 7*I));
+	exprs.append(Li2(numeric(9, 10)) + Li2(-numeric(1, 5) + numeric(9, 10)*I) + Li2(3));
+	exprs.append(asin(ex(2)) + acosh(numeric(1, 2)));  // left to evalf()
+	exprs.append(exp(ex(1000)) / exp(ex(999)));  // overflows
+	exprs.append(zeta(3) + Euler);
+
+	for (lst::const_iterator i = exprs.begin(); i != exprs.end(); ++i) {
+		const numeric v = ex_to<numeric>(i->evalf());
+		const std::complex<double> z = evalf_double(*i);
+		const double re = v.real().to_double(), im = v.imag().to_double();
+		if (std::abs(z - std::complex<double>(re, im)) > 1e-12 * (1 + std::abs(z))) {
+			clog << "evalf_double(" << *i << ") erroneously returned " << z
+			     << " instead of " << v << endl;
+			++result;
+		}
+	}
+
+	symbol x("x");
+	try {
+		evalf_double(sin(x));
+		clog << "evalf_double(sin(x)) failed to throw" << endl;
+		++result;
+	} catch (const std::invalid_argument &) {
+	}
+
+	return result;
+}
+
+static unsigned exam_evalf_ball()
+{
+	unsigned result = 0;
+	const long saved_digits = Digits;
+
+	// exp(Pi*sqrt(163)) is 744 short of 640320^3 by about 7.5e-13
+	const ex e = exp(Pi*sqrt(ex(163))) - pow(ex(640320), 3) - 744;
+	const ball b = evalf_ball(e, 20);
+	Digits = 80;
+	const numeric v = ex_to<numeric>(e.evalf());
+	Digits = saved_digits;
+	if (!b.contains(v) || b.accurate_digits() < 20) {
+		clog << "evalf_ball(" << e << ", 20) erroneously returned " << b
+		     << " instead of " << v << endl;
+		++result;
+	}
+	if (long(Digits) != saved_digits) {
+		clog << "evalf_ball() changed Digits to " << Digits << endl;
+		++result;
+	}
+
+	// a zero can't be certified, but it must lie in the ball
+	const ex z = pow(sin(ex(1)), 2) + pow(cos(ex(1)), 2) - 1;
+	if (!evalf_ball(z, 10).contains_zero()) {
+		clog << "evalf_ball(" << z << ") erroneously excluded 0" << endl;
+		++result;
+	}
+
+	try {
+		evalf_ball(log(sin(ex(4))));
+		clog << "evalf_ball(log(sin(4))) failed to throw" << endl;
+		++result;
+	} catch (const std::domain_error &) {
+	}
+
+	return result;
+}
+
+static unsigned exam_integration()
+{
+	unsigned result = 0;
+	symbol x("x");
+	const unsigned saved_method = integral::integration_method;
+
+	// all methods must reach the default accuracy of 10^-8
+	const unsigned methods[] = { integration_algo::adaptive_simpson,
+	                             integration_algo::gauss_kronrod,
+	                             integration_algo::tanh_sinh };
+	const ex expected = exp(ex(1)).evalf() - 1;
+	for (size_t i = 0; i < 3; ++i) {
+		integral::integration_method = methods[i];
+		const ex v = integral(x, 0, 1, exp(x)).evalf();
+		if (!is_exactly_a<numeric>(v) || abs(ex_to<numeric>(v - expected)) > 1e-7) {
+			clog << "integration method " << methods[i] << " erroneously returned "
+			     << v << " instead of " << expected << endl;
+			++result;
+		}
+	}
+	integral::integration_method = saved_method;
+
+	// tanh-sinh copes with singularities at the end points
+	const ex v = tanhsinh(x, 0, 1, 1/sqrt(x));
+	if (abs(ex_to<numeric>(v - 2)) > 1e-7) {
+		clog << "tanhsinh(x, 0, 1, 1/sqrt(x)) erroneously returned " << v
+		     << " instead of 2" << endl;
+		++result;
+	}
+
+	// and with high precision
+	const long saved_digits = Digits;
+	Digits = 60;
+	const ex pi = tanhsinh(x, 0, 1, 4/(1+x*x), pow(ex(10), -50));
+	const ex d = pi - Pi.evalf();
+	Digits = saved_digits;
+	if (abs(ex_to<numeric>(d)) > numeric(10).power(-48)) {
+		clog << "tanhsinh(x, 0, 1, 4/(1+x^2)) is off from Pi by " << d << endl;
+		++result;
+	}
+
+	// a sum of integrals, which may be computed concurrently, and the
+	// same sum again, which is found in the cache
+	const ex s = integral(x, 0, 1, exp(x)) + 2*integral(x, 0, 1, 4/(1+x*x))
+	           + integral(x, 1, 2, pow(x, 3));
+	const ex s_expected = expected + 2*Pi.evalf() + numeric(15, 4);
+	const integral_cache_statistics before = get_integral_cache_statistics();
+	const ex s1 = s.evalf(), s2 = s.evalf();
+	const integral_cache_statistics after = get_integral_cache_statistics();
+	if (!is_exactly_a<numeric>(s1) || abs(ex_to<numeric>(s1 - s_expected)) > 1e-7
+	 || !s2.is_equal(s1)) {
+		clog << "evaluating " << s << " erroneously returned " << s1 << " and " << s2
+		     << " instead of " << s_expected << endl;
+		++result;
+	}
+	if (after.hits - before.hits < 3) {
+		clog << "evaluating " << s << " twice found only " << after.hits - before.hits
+		     << " integrals in the cache" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+static ex digits_test_expression()
+{
+	return exp(ex(1)) + Pi + Li2(numeric(1, 3)) + S(2, 2, numeric(1, 3));
+}
+
+static void evalf_with_digits(long digits, numeric * value)
+{
+	Digits = digits;
+	*value = ex_to<numeric>(digits_test_expression().evalf());
+}
+#endif
+
+/* Digits is per thread, so threads may evaluate at different precisions at
+ * the same time. */
+static unsigned exam_thread_digits()
+{
+	unsigned result = 0;
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	const long saved_digits = Digits;
+	const long digits[] = { 20, 45, 70, 95 };
+	const size_t n = sizeof(digits) / sizeof(digits[0]);
+	std::vector<numeric> values(n);
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < n; ++i)
+		threads.push_back(std::thread(evalf_with_digits, digits[i], &values[i]));
+	for (size_t i = 0; i < n; ++i)
+		threads[i].join();
+
+	if (long(Digits) != saved_digits) {
+		clog << "other threads changed Digits to " << Digits << endl;
+		++result;
+	}
+	for (size_t i = 0; i < n; ++i) {
+		Digits = digits[i];
+		const ex v = digits_test_expression().evalf();
+		if (!v.is_equal(values[i])) {
+			clog << "evaluation with Digits = " << digits[i] << " in a thread gave "
+			     << values[i] << " instead of " << v << endl;
+			++result;
+		}
+	}
+	Digits = saved_digits;
+#endif
+	return result;
+}
+
+/* With atomic reference counters, copies of the flyweights don't touch
+ * their counters. */
+static unsigned exam_immortal_flyweights()
+{
+	unsigned result = 0;
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	const int values[] = { 0, 1, -1, 100 };
+	for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+		const ex n = values[i];
+		const unsigned before = ex_to<basic>(n).get_refcount();
+		exvector copies(100, n);
+		if (ex_to<basic>(n).get_refcount() != before || before < refcounted::immortal_refcount) {
+			clog << "copying the flyweight " << n << " changed its reference count from "
+			     << before << " to " << ex_to<basic>(n).get_refcount() << endl;
+			++result;
+		}
+	}
+#endif
+	return result;
+}
+
+/* Shared subexpressions are expanded once, and expanding again with the
+ * same options does nothing. */
+static unsigned exam_expand_dag()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y"), z("z");
+
+	const ex s = pow(x + y, 4);
+	ex e = 0;
+	for (int i = 1; i <= 5; ++i)
+		e += s * pow(z, i) + sin(s * (z + i));
+	const ex r = e.expand(expand_options::expand_function_args);
+	ex d = 0;
+	const ex se = s.expand();
+	for (int i = 1; i <= 5; ++i)
+		d += se * pow(z, i) + sin((se * (z + i)).expand());
+	if (!(r - d.expand()).expand().is_zero()) {
+		clog << "expand(" << e << ", expand_function_args) erroneously returned " << r << endl;
+		++result;
+	}
+
+	const unsigned options[] = { 0, expand_options::expand_function_args, expand_options::expand_indexed,
+	                             expand_options::expand_function_args | expand_options::expand_indexed };
+	for (size_t i = 0; i < sizeof(options) / sizeof(options[0]); ++i) {
+		const ex a = e.expand(options[i]);
+		if (!are_ex_trivially_equal(a, a.expand(options[i]))) {
+			clog << "expanding " << a << " again with options " << options[i] << " created a new object" << endl;
+			++result;
+		}
+	}
+
+	return result;
+}
+
+DECLARE_FUNCTION_1P(abstract_fcn)
+REGISTER_FUNCTION(abstract_fcn, dummy());
+
+/* Equal derivatives created by the chain rule are shared. */
+static unsigned exam_fderivative_sharing()
+{
+	unsigned result = 0;
+	symbol x("x");
+
+	const ex d1 = abstract_fcn(sin(x)).diff(x, 4);
+	const ex d2 = abstract_fcn(sin(x)).diff(x, 4);
+	if (!d1.is_equal(d2)) {
+		clog << "fourth derivative of abstract_fcn(sin(x)) is " << d1 << " and " << d2 << endl;
+		++result;
+	}
+
+	paramset ps;
+	ps.insert(0);
+	ps.insert(0);
+	const exvector args(1, sin(x));
+	const ex a = fderivative::shared(abstract_fcn_SERIAL::serial, ps, args);
+	const ex b = fderivative::shared(abstract_fcn_SERIAL::serial, ps, args);
+	if (!are_ex_trivially_equal(a, b)) {
+		clog << a << " was not shared" << endl;
+		++result;
+	}
+	if (!a.is_equal(fderivative(abstract_fcn_SERIAL::serial, ps, args))) {
+		clog << "shared derivative " << a << " is wrong" << endl;
+		++result;
+	}
+
+	// derivatives of functions with a derivative are evaluated
+	ps.clear();
+	ps.insert(0);
+	const ex c = fderivative::shared(sin_SERIAL::serial, ps, exvector(1, x));
+	if (!c.is_equal(cos(x))) {
+		clog << "shared derivative of sin(x) is " << c << " instead of cos(x)" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* The text_writer must produce the same text as print_dflt. */
+static unsigned exam_text_writer()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y"), z("z");
+	numeric big = pow(numeric(10), numeric(200)) + numeric(123456789);
+	const ex exprs[] = {
+		x + 2*y - 3*x*y + 4,
+		pow(x, 2)*3/2 + numeric(4.5)*I,
+		-x*y/z + numeric(-2, 3)*pow(x + y, 3) - sqrt(x + 1),
+		pow(x, numeric(1, 3)) - pow(y, -x) + pow(2, x)*sin(x),
+		big*x - big/7 + pow(big, 3)*y + (1 + 2*I)*z - I*x,
+		lst(x, -y, numeric(-5, 7)*x*z, pow(-x, -2)),
+		ex(-numeric(5, 3)) + numeric(2, 3)*I*x
+	};
+
+	std::ostringstream expected, written;
+	{
+		text_writer out(written, 64);  // small buffer, to test the flushing
+		for (size_t i = 0; i < sizeof(exprs)/sizeof(exprs[0]); ++i) {
+			expected << exprs[i] << '\n';
+			out << exprs[i] << '\n';
+		}
+	}
+	if (written.str() != expected.str()) {
+		clog << "text_writer wrote" << endl << written.str()
+		     << "instead of" << endl << expected.str();
+		++result;
+	}
+
+	return result;
+}
+
+/* is_a<> and is_exactly_a<> compare class tags; classes without a
+ * registration of their own (like realsymbol) must still be told apart. */
+struct count_powers_visitor : public visitor, public power::visitor, public basic::visitor {
+	count_powers_visitor() : powers(0), others(0) {}
+	void visit(const power &) { ++powers; }
+	void visit(const basic &) { ++others; }
+	unsigned powers, others;
+};
+
+static unsigned exam_class_tags()
+{
+	unsigned result = 0;
+	symbol x("x");
+	realsymbol r("r");
+	const ex e = pow(x, 2) + sin(r) + 3;
+
+	if (!is_a<expairseq>(e) || !is_a<add>(e) || is_a<mul>(e) || !is_a<basic>(e)
+	 || !is_exactly_a<add>(e) || is_exactly_a<expairseq>(e)) {
+		clog << "wrong class of " << e << endl;
+		++result;
+	}
+	if (!is_a<symbol>(r) || !is_a<realsymbol>(r) || is_exactly_a<symbol>(r)
+	 || is_a<realsymbol>(x) || !is_exactly_a<symbol>(x) || is_a<possymbol>(r)) {
+		clog << "realsymbol not told apart from symbol" << endl;
+		++result;
+	}
+	if (!is_a<GiNaC::function>(sin(r)) || !is_a<exprseq>(sin(r)) || is_exactly_a<exprseq>(sin(r))
+	 || !is_a<lst>(lst(x)) || is_a<exprseq>(lst(x))) {
+		clog << "wrong class of containers" << endl;
+		++result;
+	}
+
+	// The interfaces found are remembered; the second pass must agree
+	count_powers_visitor v;
+	for (int pass = 0; pass < 2; ++pass)
+		e.traverse(v);
+	if (v.powers != 2 || v.others != 12) {
+		clog << "visitor found " << v.powers << " powers and " << v.others
+		     << " other objects in " << e << " instead of 2 and 12" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* Sums built from canonical sequences without sorting must be the same as
+ * those built the usual way. */
+static unsigned exam_canonical_seq()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y"), z("z");
+
+	const ex e1 = expand(3*pow(x + 2*y - z, 3));
+	const ex e2 = expand(pow(x + 2*y - z, 3));
+	exvector terms;
+	for (size_t i = 0; i < e2.nops(); ++i)
+		terms.push_back(3*e2.op(i));
+	const ex e3 = (new add(terms))->setflag(status_flags::dynallocated);
+	if (!e1.is_equal(e3) || e1.compare(e3) != 0 || e1.gethash() != e3.gethash()) {
+		clog << "expanded " << 3*pow(x + 2*y - z, 3) << " to " << e1
+		     << " instead of " << e3 << endl;
+		++result;
+	}
+
+	// *(+(x,y,...);c) distributes c over the terms
+	const ex e4 = numeric(2, 3) * (x - y + z);
+	if (!is_exactly_a<add>(e4) || !e4.is_equal(numeric(2, 3)*x - numeric(2, 3)*y + numeric(2, 3)*z)) {
+		clog << "distributed to " << e4 << endl;
+		++result;
+	}
+
+	// The gcd heuristic reduces sums modulo numbers
+	const ex g = gcd(expand((x + y + 1)*(x - 2*y)), expand((x + y + 1)*(x + 3*z)));
+	if (!(g - (x + y + 1)).is_zero()) {
+		clog << "gcd returned " << g << " instead of " << x + y + 1 << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* Sums and products built from vectors which are moved in must be the same
+ * as those built from copies. */
+static unsigned exam_move_construction()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y");
+
+	epvector terms;
+	terms.push_back(expair(x, 2));
+	terms.push_back(expair(numeric(3), 1));
+	terms.push_back(expair(y, -1));
+	terms.push_back(expair(x + y, 1));    // flattened
+	terms.push_back(expair(numeric(-1), 1));
+	const ex copied = (new add(terms))->setflag(status_flags::dynallocated);
+	epvector terms2(terms);
+	const ex moved = (new add(std::move(terms2)))->setflag(status_flags::dynallocated);
+	if (!copied.is_equal(moved) || !moved.is_equal(3*x + 2)) {
+		clog << "add from moved terms gave " << moved << " instead of " << copied << endl;
+		++result;
+	}
+
+	epvector factors;
+	factors.push_back(expair(x, 2));
+	factors.push_back(expair(y, 1));
+	factors.push_back(expair(x, -1));
+	const ex product = (new mul(std::move(factors), numeric(5)))->setflag(status_flags::dynallocated);
+	if (!product.is_equal(5*x*y)) {
+		clog << "mul from moved factors gave " << product << " instead of " << 5*x*y << endl;
+		++result;
+	}
+
+	exvector elements(3, x);
+	const lst l(std::list<ex>(elements.begin(), elements.end()));
+	const exprseq es(std::move(elements));
+	const matrix m(1, 3, exvector(3, y));
+	if (l.nops() != 3 || es.nops() != 3 || !es.op(2).is_equal(x) || !m(0, 2).is_equal(y)) {
+		clog << "containers built from moved vectors are wrong" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* Appending to a list held by an ex changes it in place unless it is
+ * shared, in which case the other expressions keep the old list. */
+static unsigned exam_container_append()
+{
+	unsigned result = 0;
+	symbol x("x");
+
+	ex l = lst();
+	for (int i = 0; i < 100; ++i)
+		append_to<lst>(l, pow(x, i));
+	const basic * const before = &ex_to<basic>(l);
+	append_to<lst>(l, 100);
+	if (&ex_to<basic>(l) != before || l.nops() != 101 || !l.op(99).is_equal(pow(x, 99))) {
+		clog << "appending to an unshared list copied it or gave wrong elements" << endl;
+		++result;
+	}
+
+	const ex shared = l;
+	remove_first_from<lst>(l);
+	prepend_to<lst>(l, -1);
+	remove_last_from<lst>(l);
+	if (shared.nops() != 101 || !shared.op(0).is_equal(1) || !shared.op(100).is_equal(100)
+	 || l.nops() != 100 || !l.op(0).is_equal(-1) || !l.op(99).is_equal(pow(x, 99))) {
+		clog << "changing a shared list gave " << l << " and changed the other copy to "
+		     << shared << endl;
+		++result;
+	}
+
+	ex es = exprseq(x);
+	append_to<exprseq>(es, 2*x);
+	if (!is_exactly_a<exprseq>(es) || es.nops() != 2 || !es.op(1).is_equal(2*x)) {
+		clog << "appending to an exprseq gave " << es << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* Sums and products accumulated with the builders are the same as the ones
+ * built with += and *=. */
+static unsigned exam_builders()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y");
+
+	ex s = 0;
+	add_builder sb(10);
+	for (int i = 0; i < 3000; ++i) {
+		const ex t = pow(x, i % 7) * numeric(i, i % 5 + 1) - y / (i % 3 + 1);
+		s += t;
+		if (i % 2)
+			sb += t;
+		else
+			sb -= -t;
+	}
+	const ex sbs = sb.finish();
+	if (!sbs.is_equal(s)) {
+		clog << "add_builder gave " << sbs << " instead of " << s << endl;
+		++result;
+	}
+	if (sb.size() != 0 || !sb.finish().is_zero()) {
+		clog << "add_builder is not empty after finish()" << endl;
+		++result;
+	}
+
+	ex p = 1;
+	mul_builder pb;
+	for (int i = 0; i < 2000; ++i) {
+		const ex f = pow(x + i % 4, i % 3) * (i + 1);
+		p *= f;
+		pb *= f;
+	}
+	pb /= x + 1;
+	p /= x + 1;
+	const ex pbp = pb.finish();
+	if (!pbp.is_equal(p)) {
+		clog << "mul_builder gave " << pbp << " instead of " << p << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* Real expressions are their own conjugate and real part, and are returned
+ * unchanged (and marked, so that the next call returns at once). */
+static unsigned exam_known_real()
+{
+	unsigned result = 0;
+	realsymbol a("a"), b("b");
+	possymbol p("p");
+	symbol z("z");
+
+	const ex e = expand(pow(a + 2*b, 3)) - 5*sqrt(p);
+	for (int round = 0; round < 2; ++round) {
+		if (!are_ex_trivially_equal(e.conjugate(), e)
+		 || !are_ex_trivially_equal(e.real_part(), e)
+		 || !e.imag_part().is_zero()) {
+			clog << "real expression " << e << " was rebuilt by conjugate() or real_part()" << endl;
+			++result;
+		}
+	}
+
+	const ex c = e + I*z*a;
+	if (!c.conjugate().is_equal(e - I*conjugate(z)*a)) {
+		clog << "conjugate(" << c << ") gave " << c.conjugate() << endl;
+		++result;
+	}
+	if (!c.real_part().is_equal(e - imag_part(z)*a)
+	 || !c.imag_part().is_equal(real_part(z)*a)) {
+		clog << "real or imaginary part of " << c << " is wrong" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* Relations between numbers are decided without forming the difference, also
+ * many at a time. */
+static unsigned exam_decide_relations()
+{
+	unsigned result = 0;
+	symbol x("x");
+
+	if (!(ex(numeric(1,3)) < numeric(1,2)) || ex(2) <= numeric(1)
+	 || !(ex(1) == 1.0) || (ex(3) != numeric(6,2)) || !(ex(2) > 1.5)) {
+		clog << "comparison of numbers is wrong" << endl;
+		++result;
+	}
+
+	exvector rels;
+	rels.push_back(ex(1) < 2);
+	rels.push_back(ex(2) < 1);
+	rels.push_back(x == x);
+	rels.push_back(x < x + 1);
+	rels.push_back(x != 1);
+	rels.push_back(I + 1 == 1 + I);
+	std::vector<bool> decided;
+	decide_relations(rels, decided);
+	const bool expected[] = { true, false, true, true, true, true };
+	for (size_t i = 0; i < rels.size(); ++i) {
+		if (decided[i] != expected[i]) {
+			clog << rels[i] << " was decided to be " << decided[i] << endl;
+			++result;
+		}
+	}
+
+	exvector values;
+	for (int i = -5; i <= 5; ++i)
+		values.push_back(numeric(i, 2));
+	compare_all(values, numeric(1,2), relational::greater_or_equal, decided);
+	for (size_t i = 0; i < values.size(); ++i) {
+		if (decided[i] != (i >= 6)) {
+			clog << values[i] << " >= 1/2 was decided to be " << decided[i] << endl;
+			++result;
+		}
+	}
+
+	return result;
+}
+
+/* Collects the terms of an out-of-core expansion, checking their order. */
+struct collecting_sink : public term_sink {
+	collecting_sink() : sum(0), unordered(false) {}
+	void operator()(const ex & rest, const numeric & coeff)
+	{
+		if (!last.is_zero() && last.compare(rest) >= 0)
+			unordered = true;
+		last = rest;
+		sum += rest * coeff;
+	}
+	ex sum, last;
+	bool unordered;
+};
+
+static unsigned exam_out_of_core_expand()
+{
+	unsigned result = 0;
+	symbol a("a"), b("b"), c("c");
+
+	const ex e = pow(a + b + c, 5) * (a - 2*b) - 3*pow(b - c, 4) + (a + 1)*(c - 1);
+	const ex expected = expand(e);
+	for (size_t run_size = 7; run_size <= 7000; run_size *= 1000) {
+		out_of_core_expander x(lst(a, b, c), run_size);
+		collecting_sink sink;
+		const size_t n = x.expand(e, sink);
+		if (!sink.sum.is_equal(expected) || n != expected.nops()) {
+			clog << "out-of-core expansion of " << e << " with runs of " << run_size
+			     << " terms gave " << sink.sum << " instead of " << expected << endl;
+			++result;
+		}
+		if (sink.unordered) {
+			clog << "out-of-core expansion passed the terms out of order" << endl;
+			++result;
+		}
+		if ((run_size == 7) != (x.num_runs() > 1)) {
+			clog << "out-of-core expansion with runs of " << run_size
+			     << " terms wrote " << x.num_runs() << " runs" << endl;
+			++result;
+		}
+	}
+
+	return result;
+}
+
+/* Exchanging the parts of two sums like two processes of a cluster would
+ * brings the like terms together. */
+static unsigned exam_distributed_terms()
+{
+	unsigned result = 0;
+	symbol a("a"), b("b"), c("c");
+	const unsigned nparts = 3;
+
+	const ex e1 = expand(pow(a + b - c, 4) + 3);
+	const ex e2 = expand(pow(a - b + 2*c, 4) - 2*a + 1);
+	const std::vector<std::string> parts1 = partition_terms(e1, nparts);
+	const std::vector<std::string> parts2 = partition_terms(e2, nparts);
+	ex total = 0;
+	for (unsigned i = 0; i < nparts; ++i) {
+		std::vector<std::string> received;
+		received.push_back(parts1[i]);
+		received.push_back(parts2[i]);
+		const ex part = combine_parts(received, lst(a, b, c));
+		const ex terms = is_a<add>(part) ? part : ex(lst(part));
+		for (size_t j = 0; j < terms.nops(); ++j) {
+			if (!terms.op(j).is_zero() && term_part(terms.op(j), nparts) != i) {
+				clog << "term " << terms.op(j) << " ended up in part " << i << endl;
+				++result;
+			}
+		}
+		total += part;
+	}
+	if (!total.is_equal(expand(e1 + e2))) {
+		clog << "the parts of " << e1 << " and " << e2 << " add up to " << total << endl;
+		++result;
+	}
+	if (term_part(7*a*b, nparts) != term_part(-a*b, nparts) || term_part(5*c, nparts) != term_part(c, nparts)) {
+		clog << "like terms are put into different parts" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+static ex vec_fcn_evalf(const exvector & args)
+{
+	return args[0];
+}
+
+DECLARE_FUNCTION_1P(vec_fcn)
+REGISTER_FUNCTION(vec_fcn, evalf_func(vec_fcn_evalf));
+
+static unsigned counted_fcn_calls = 0;
+
+static ex counted_fcn_eval(const ex & x)
+{
+	++counted_fcn_calls;
+	if (x.is_zero())
+		return 0;
+	return GiNaC::function(GiNaC::function::current_serial, x).hold();
+}
+
+// default options, so eval() takes the fast lane
+DECLARE_FUNCTION_1P(counted_fcn)
+REGISTER_FUNCTION(counted_fcn, eval_func(counted_fcn_eval));
+
+// with a remember table, which eval() must look into first
+DECLARE_FUNCTION_1P(remembered_fcn)
+REGISTER_FUNCTION(remembered_fcn, eval_func(counted_fcn_eval).remember(16));
+
+static unsigned exam_function_dispatch()
+{
+	unsigned result = 0;
+	symbol x("x");
+
+	// one-parameter fast lanes of eval() and evalf()
+	const ex e = sin(Pi/6) + exp(log(x)) + tgamma(numeric(5));
+	if (!e.is_equal(x + numeric(49, 2))) {
+		clog << "sin(Pi/6)+exp(log(x))+tgamma(5) evaluated to " << e << endl;
+		++result;
+	}
+	const ex f = sin(numeric(1, 2)).evalf();
+	if (!is_a<numeric>(f) || abs(ex_to<numeric>(f) - sin(numeric(0.5))) > numeric(1e-15)) {
+		clog << "sin(1/2).evalf() gave " << f << endl;
+		++result;
+	}
+
+	// the eval function is called on every evaluation, and gets the serial
+	// of its function
+	symbol y("y");
+	counted_fcn_calls = 0;
+	const ex c1 = counted_fcn(y), c2 = counted_fcn(y), c0 = counted_fcn(0);
+	if (counted_fcn_calls != 3 || !c0.is_zero() || !is_ex_the_function(c1, counted_fcn)
+	 || !c1.is_equal(c2)) {
+		clog << "counted_fcn() gave " << c1 << ", " << c2 << ", " << c0
+		     << " with " << counted_fcn_calls << " calls" << endl;
+		++result;
+	}
+	// a remembered result is not evaluated again
+	counted_fcn_calls = 0;
+	const ex r1 = remembered_fcn(y), r2 = remembered_fcn(y);
+	if (counted_fcn_calls != 1 || !is_ex_the_function(r1, remembered_fcn) || !r1.is_equal(r2)) {
+		clog << "remembered_fcn() gave " << r1 << ", " << r2
+		     << " with " << counted_fcn_calls << " calls" << endl;
+		++result;
+	}
+
+	// exvector evalf functions get the numerically evaluated arguments
+	const ex g = vec_fcn(numeric(1, 4)).evalf();
+	if (!is_a<numeric>(g) || ex_to<numeric>(g).is_rational() || g != numeric(0.25)) {
+		clog << "vec_fcn(1/4).evalf() gave " << g << " instead of 0.25" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+static unsigned exam_canonical_order()
+{
+	unsigned result = 0;
+
+	// sums long enough to be sorted through their hash values, with
+	// subexpressions of equal hash values (x^2 and pow(x,2) built apart)
+	exvector syms;
+	for (int i = 0; i < 60; ++i) {
+		std::ostringstream name;
+		name << "s" << i;
+		syms.push_back(symbol(name.str()));
+	}
+	ex e1 = 0, e2 = 0;
+	for (int i = 0; i < 60; ++i) {
+		e1 += syms[i] * pow(syms[(i + 1) % 60], 2);
+		e2 += pow(syms[(60 - i) % 60], 2) * syms[59 - i];
+	}
+	if (e1.nops() != e2.nops()) {
+		clog << "sums of the same terms have different lengths" << endl;
+		return 1;
+	}
+	for (size_t i = 0; i < e1.nops(); ++i) {
+		if (!e1.op(i).is_equal(e2.op(i))) {
+			clog << "sums of the same terms are ordered differently at term " << i << endl;
+			++result;
+			break;
+		}
+		if (i > 0 && e1.op(i - 1).compare(e1.op(i)) >= 0) {
+			clog << "terms " << e1.op(i - 1) << " and " << e1.op(i) << " are not in ex::compare() order" << endl;
+			++result;
+			break;
+		}
+	}
+
+	return result;
+}
+
+static unsigned exam_anonymous_symbols()
+{
+	unsigned result = 0;
+
+	symbol a;
+	std::ostringstream expected, printed;
+	expected << "symbol" << a.get_serial();
+	printed << ex(a);
+	if (a.get_name() != expected.str() || printed.str() != expected.str()) {
+		clog << "anonymous symbol is named " << a.get_name() << " and printed as "
+		     << printed.str() << " instead of " << expected.str() << endl;
+		++result;
+	}
+
+	symbol x("x", "\\xi");
+	symbol y = x;
+	y.set_name("y");
+	std::ostringstream tex;
+	tex << GiNaC::latex << ex(y);
+	if (x.get_name() != "x" || y.get_name() != "y" || tex.str() != "\\xi" || !ex(x).is_equal(y)) {
+		clog << "renaming a copy of a symbol gave the names " << x.get_name() << ", "
+		     << y.get_name() << " and LaTeX name " << tex.str() << endl;
+		++result;
+	}
+
+	return result;
+}
+
+static unsigned exam_expression_metrics()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y");
+
+	// mul(power(add(x, y), 2), sin(add(x, y)))
+	ex e = pow(x+y, 2)*sin(x+y);
+	expression_metrics m = get_metrics(e);
+	if (m.tree_size != 10 || m.dag_size != 7 || m.depth != 4 || m.coeff_bits != 2) {
+		clog << "metrics of " << e << " are tree size " << m.tree_size << ", DAG size "
+		     << m.dag_size << ", depth " << m.depth << ", coefficient bits "
+		     << m.coeff_bits << " instead of 10, 7, 4, 2" << endl;
+		++result;
+	}
+
+	e = numeric(5, 1024)*pow(x, 3)*y + x;
+	m = get_metrics(e);
+	if (m.coeff_bits != 11 || m.max_degree.size() != 2 ||
+	    !m.max_degree[x].is_equal(3) || !m.max_degree[y].is_equal(1)) {
+		clog << "metrics of " << e << " give coefficient bits " << m.coeff_bits
+		     << " and degrees " << m.max_degree[x] << ", " << m.max_degree[y]
+		     << " instead of 11, 3, 1" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* ex::coeffs() must agree with ex::coeff() for every degree. */
+static unsigned exam_coeffs()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y");
+	const ex e = expand(pow(x + 2*y + 1, 4)*(pow(x, 2) - 3)) + x*sin(x) + pow(x, 2)/y + sqrt(x);
+
+	const ex vars[] = { x, y };
+	for (size_t k = 0; k < 2; ++k) {
+		const ex & s = vars[k];
+		const std::map<int, ex> c = e.coeffs(s);
+		for (int n = e.ldegree(s); n <= e.degree(s); ++n) {
+			std::map<int, ex>::const_iterator i = c.find(n);
+			const ex cn = i == c.end() ? ex(0) : i->second;
+			if (!(cn - e.coeff(s, n)).expand().is_zero()) {
+				clog << "coefficient of " << s << "^" << n << " in " << e << " is "
+				     << cn << " instead of " << e.coeff(s, n) << endl;
+				++result;
+			}
+		}
+	}
+
+	const exvector v = expand(pow(x + 1, 3)).coeff_vector(x);
+	if (v.size() != 4 || !v[0].is_equal(1) || !v[1].is_equal(3) || !v[2].is_equal(3) || !v[3].is_equal(1)) {
+		clog << "coefficient vector of (x+1)^3 is " << exprseq(v) << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* Distributed collect() must give one term per monomial in the symbols. */
+static unsigned exam_collect_distributed()
+{
+	unsigned result = 0;
+	symbol a("a"), x("x"), y("y");
+	const ex e = expand(pow(x + y + 1, 2)*(a + 1)) + x*sin(x) + pow(y, -1)*a;
+	const ex c = e.collect(lst(x, y), true);
+
+	// x^2, x*y, y^2, x, y and 1/y, plus the constant term a+1 which is
+	// merged into the sum
+	if (!is_a<add>(c) || c.nops() != 8 || !(c - e).expand().is_zero()) {
+		clog << "distributed collect() of " << e << " in x and y gave " << c << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* gradient() and jacobian() must agree with diff(). */
+static unsigned exam_gradient()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y"), z("z");
+	const lst vars(x, y, z);
+	const ex e = sin(x*y)*exp(x+z) + pow(x*y + 1, 3) + log(z)/y + pow(x, y);
+
+	const lst g = gradient(e, vars);
+	for (size_t i = 0; i < vars.nops(); ++i) {
+		const ex d = e.diff(ex_to<symbol>(vars.op(i)));
+		if (!(g.op(i) - d).expand().is_zero()) {
+			clog << "gradient of " << e << " with respect to " << vars.op(i)
+			     << " is " << g.op(i) << " instead of " << d << endl;
+			++result;
+		}
+	}
+
+	const matrix j = jacobian(lst(x*y, sin(x) + pow(y, 2)), lst(x, y));
+	if (!j(0, 0).is_equal(y) || !j(0, 1).is_equal(x) ||
+	    !j(1, 0).is_equal(cos(x)) || !(j(1, 1) - 2*y).expand().is_zero()) {
+		clog << "Jacobian of {x*y, sin(x)+y^2} is " << j << endl;
+		++result;
+	}
+
+	// Higher derivatives share the work of the lower ones
+	const ex d4 = (sin(x)*exp(x)).diff(x, 4);
+	if (!(d4 + 4*sin(x)*exp(x)).expand().is_zero()) {
+		clog << "fourth derivative of sin(x)*exp(x) is " << d4 << endl;
+		++result;
+	}
+
+	return result;
+}
+
+static unsigned exam_rule_set()
+{
+	unsigned result = 0;
+	symbol a("a"), b("b"), c("c");
+	const ex w = wild();
+
+	exmap rules;
+	rules[sin(w)] = cos(w);
+	rules[tan(w)] = sinh(w);
+	rules[exp(w)] = cosh(w);
+	rules[log(w)] = w;
+	rules[asin(w)] = acos(w);
+	rules[atan(w)] = 0;
+	rules[abs(w)] = w;
+	rules[pow(w, 3)] = pow(w, 2);
+	rules[a + w] = w;
+
+	const ex e = sin(a) + tan(b)*exp(a+b) + pow(c, 3) + log(c) + a;
+	const ex expected = cos(a) + sinh(b)*cosh(b) + pow(c, 2) + c;
+
+	// Indexed by ex::subs() itself
+	ex r = e.subs(rules);
+	if (!r.is_equal(expected)) {
+		clog << "substituting " << rules.size() << " rules in " << e
+		     << " gave " << r << " instead of " << expected << endl;
+		++result;
+	}
+
+	const rule_set rs(rules);
+	r = rs.subs(e);
+	if (!r.is_equal(expected)) {
+		clog << "rule_set substituted " << e << " into " << r
+		     << " instead of " << expected << endl;
+		++result;
+	}
+
+	// Only the rule for sin() (and none for a symbol) may fit
+	std::vector<exmap::const_iterator> cand;
+	rs.candidates(sin(b), cand);
+	if (cand.size() != 1 || !cand[0]->first.is_equal(sin(w))) {
+		clog << "rule_set has " << cand.size() << " candidates for sin(b)" << endl;
+		++result;
+	}
+	cand.clear();
+	rs.candidates(b, cand);
+	if (!cand.empty()) {
+		clog << "rule_set has " << cand.size() << " candidates for b" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+static unsigned exam_ac_match()
+{
+	unsigned result = 0;
+	symbol a("a"), b("b"), c("c"), x("x"), y("y"), z("z");
+
+	// Matching sin($0) with the first sine is wrong, whichever it is
+	const ex e = sin(a) + sin(b) + sin(c) + cos(b);
+	exmap repls;
+	if (!e.match(sin(wild(0)) + cos(wild(0)) + wild(1), repls)
+	 || !repls[wild(0)].is_equal(b) || !repls[wild(1)].is_equal(sin(a) + sin(c))) {
+		clog << e << " did not match sin($0)+cos($0)+$1 correctly: " << repls << endl;
+		++result;
+	}
+
+	// A failed match leaves the replacements alone
+	repls.clear();
+	repls[wild(2)] = z;
+	if (e.match(sin(wild(0)) + cos(wild(1)) + wild(0), repls) || repls.size() != 1) {
+		clog << e << " matched sin($0)+cos($1)+$0, or left " << repls << endl;
+		++result;
+	}
+
+	// Products with several wildcards
+	const ex f = x*pow(y, 2)*sin(x)*cos(y);
+	repls.clear();
+	if (!f.match(sin(wild(0))*cos(wild(1))*wild(0)*pow(wild(1), 2), repls)
+	 || !repls[wild(0)].is_equal(x) || !repls[wild(1)].is_equal(y)) {
+		clog << f << " did not match sin($0)*cos($1)*$0*$1^2 correctly: " << repls << endl;
+		++result;
+	}
+
+	// Algebraic matching of products
+	const ex g = pow(x, 5)*pow(y, 2)*z;
+	if (!g.has(x*y, has_options::algebraic)) {
+		clog << g << " does not contain x*y algebraically" << endl;
+		++result;
+	}
+	const ex h = g.subs(pow(x, 2)*y == c, subs_options::algebraic);
+	if (!h.is_equal(x*pow(c, 2)*z)) {
+		clog << g << " with x^2*y=c became " << h << " instead of x*c^2*z" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+static unsigned exam_ncmul_expand()
+{
+	unsigned result = 0;
+	symbol a("a"), b("b");
+	const ex g0 = dirac_gamma(varidx(0, 4), 0), g1 = dirac_gamma(varidx(1, 4), 0);
+	const ex t1 = color_T(idx(1, 8), 1), t2 = color_T(idx(2, 8), 1);
+
+	// Factors with different representation labels are collected in
+	// order of their first appearance, keeping their own order
+	const ex e = ncmul(g0, t1, g1, t2);
+	const ex expected = ncmul(g0, g1) * ncmul(t1, t2);
+	if (!e.is_equal(expected)) {
+		clog << "ncmul(g0, t1, g1, t2) evaluated to " << e << " instead of " << expected << endl;
+		++result;
+	}
+
+	// All products of the terms, in order
+	const ex f = ncmul(a*g0 + g1, g1 + b*g0, g0).expand();
+	const ex f_expected = a*ncmul(g0, g1, g0) + a*b*ncmul(g0, g0, g0)
+	                    + ncmul(g1, g1, g0) + b*ncmul(g1, g0, g0);
+	if (!(f - f_expected).expand().is_zero()) {
+		clog << "expanding ncmul(a*g0+g1, g1+b*g0, g0) gave " << f << endl;
+		++result;
+	}
+
+	return result;
+}
+
+static unsigned exam_expression_profile()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y");
+	const ex s = expand(pow(x + y + 1, 8));
+	const ex e = s*sin(s) + pow(s, 2) + x;
+	const expression_metrics m = get_metrics(e);
+
+	expression_profile p;
+	p.scan(e);
+	if (p.dag_size() != m.dag_size || p.tree_size() != m.tree_size || p.depth() != m.depth) {
+		clog << "profile of " << e << " has sizes " << p.tree_size() << ", "
+		     << p.dag_size() << " and depth " << p.depth() << " instead of "
+		     << m.tree_size << ", " << m.dag_size << " and " << m.depth << endl;
+		++result;
+	}
+	if (p.largest_sums().empty() || !p.largest_sums()[0].is_equal(s)) {
+		clog << "largest sum of " << e << " is not " << s << endl;
+		++result;
+	}
+	const exvector & path = p.deepest_path();
+	if (path.size() < 3 || !path[0].is_equal(e) || path.back().nops() != 0) {
+		clog << "deepest path of " << e << " has " << path.size() << " nodes" << endl;
+		++result;
+	}
+	if (p.classes().find("symbol")->second.nodes != 2) {
+		clog << "profile of " << e << " does not count two symbols" << endl;
+		++result;
+	}
+
+	// Sampling sees fewer nodes, but estimates about as many
+	expression_profile q(5);
+	q.scan(e);
+	if (q.dag_size() < m.dag_size / 10.0 || q.dag_size() > 10.0 * m.dag_size) {
+		clog << "sampled profile of " << e << " estimates " << q.dag_size()
+		     << " nodes instead of about " << m.dag_size << endl;
 		++result;
 	}
 
@@ -307,6 +2399,56 @@ unsigned exam_misc()
 	result += exam_expand_subs();  cout << '.' << flush;
 	result += exam_expand_subs2();  cout << '.' << flush;
 	result += exam_expand_power(); cout << '.' << flush;
+	result += exam_expand_parallel(); cout << '.' << flush;
+	result += exam_thread_limit(); cout << '.' << flush;
+	result += exam_budget(); cout << '.' << flush;
+	result += exam_expand_packed(); cout << '.' << flush;
+	result += exam_arena(); cout << '.' << flush;
+	result += exam_numeric_alloc(); cout << '.' << flush;
+	result += exam_hash_consing(); cout << '.' << flush;
+	result += exam_combine_hashed(); cout << '.' << flush;
+	result += exam_combine_rational(); cout << '.' << flush;
+	result += exam_shared_subexpressions(); cout << '.' << flush;
+	result += exam_symbol_masks(); cout << '.' << flush;
+	result += exam_statistics(); cout << '.' << flush;
+	result += exam_memory_usage(); cout << '.' << flush;
+	result += exam_trace(); cout << '.' << flush;
+	result += exam_expand_power_monomials(); cout << '.' << flush;
+	result += exam_constant_cache(); cout << '.' << flush;
+	result += exam_compile_ex_bytecode(); cout << '.' << flush;
+	result += exam_kernel_source(); cout << '.' << flush;
+	result += exam_horner(); cout << '.' << flush;
+	result += exam_double_kernels(); cout << '.' << flush;
+	result += exam_eval_plan(); cout << '.' << flush;
+	result += exam_eval_state(); cout << '.' << flush;
+	result += exam_evalf_double(); cout << '.' << flush;
+	result += exam_evalf_ball(); cout << '.' << flush;
+	result += exam_text_writer(); cout << '.' << flush;
+	result += exam_class_tags(); cout << '.' << flush;
+	result += exam_canonical_seq(); cout << '.' << flush;
+	result += exam_move_construction(); cout << '.' << flush;
+	result += exam_container_append(); cout << '.' << flush;
+	result += exam_builders(); cout << '.' << flush;
+	result += exam_known_real(); cout << '.' << flush;
+	result += exam_decide_relations(); cout << '.' << flush;
+	result += exam_out_of_core_expand(); cout << '.' << flush;
+	result += exam_distributed_terms(); cout << '.' << flush;
+	result += exam_function_dispatch(); cout << '.' << flush;
+	result += exam_canonical_order(); cout << '.' << flush;
+	result += exam_anonymous_symbols(); cout << '.' << flush;
+	result += exam_expression_metrics(); cout << '.' << flush;
+	result += exam_coeffs(); cout << '.' << flush;
+	result += exam_collect_distributed(); cout << '.' << flush;
+	result += exam_gradient(); cout << '.' << flush;
+	result += exam_rule_set(); cout << '.' << flush;
+	result += exam_ac_match(); cout << '.' << flush;
+	result += exam_ncmul_expand(); cout << '.' << flush;
+	result += exam_expression_profile(); cout << '.' << flush;
+	result += exam_integration(); cout << '.' << flush;
+	result += exam_thread_digits(); cout << '.' << flush;
+	result += exam_immortal_flyweights(); cout << '.' << flush;
+	result += exam_expand_dag(); cout << '.' << flush;
+	result += exam_fderivative_sharing(); cout << '.' << flush;
 	result += exam_sqrfree(); cout << '.' << flush;
 	result += exam_operator_semantics(); cout << '.' << flush;
 	result += exam_subs(); cout << '.' << flush;
@@ -62,6 +62,28 @@ static void run_test_once(const std::size_t deg)
 	}
 }
 
+// GCD of polynomials with a common factor, of degree fdeg, and cofactors
+// of degree cdeg: large enough for mod_gcd to use the half-GCD algorithm
+static void run_common_factor_test(const std::size_t fdeg, const std::size_t cdeg)
+{
+	static const symbol xsym("x");
+
+	const ex f = upoly_to_ex(make_random_upoly(fdeg), xsym);
+	const ex ea = expand(f*upoly_to_ex(make_random_upoly(cdeg), xsym));
+	const ex eb = expand(f*upoly_to_ex(make_random_upoly(cdeg), xsym));
+
+	upoly g;
+	mod_gcd(g, ex_to_upoly(ea, xsym), ex_to_upoly(eb, xsym));
+	const ex eg = upoly_to_ex(g, xsym);
+	ex q;
+	if (eg.degree(xsym) < int(fdeg) || !divide(ea, eg, q) || !divide(eb, eg, q)) {
+		std::cerr << "a = " << ea << std::endl;
+		std::cerr << "b = " << eb << std::endl;
+		std::cerr << "mod_gcd(a, b) = " << eg << std::endl;
+		throw std::logic_error("bug in mod_gcd (common factor lost)");
+	}
+}
+
 int main(int argc, char** argv)
 {
 	std::cout << "examining modular gcd. ";
@@ -75,6 +97,8 @@ int main(int argc, char** argv)
 		for (std::size_t k = 0; k < i->second; ++k)
 			run_test_once(i->first);
 	}
+	for (std::size_t k = 0; k < 4; ++k)
+		run_common_factor_test(150, 150);
 	return 0;
 }
 
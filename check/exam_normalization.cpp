@@ -167,6 +167,216 @@ static unsigned exam_normal4()
 	return result;
 }
 
+/* Sums of many fractions, which are added pairwise. */
+static unsigned exam_normal5()
+{
+	unsigned result = 0;
+	const int n = 20;
+
+	// Telescoping sum, each term twice and the repetitions apart
+	ex e = 0;
+	for (int i=0; i<2; ++i)
+		for (int k=1; k<=n; ++k)
+			e += 1/((x+k)*(x+k+1));
+	ex en = e.normal();
+	if (!(en.numer()*(x+1)*(x+n+1) - 2*n*en.denom()).expand().is_zero()
+	 || en.denom().degree(x) != 2) {
+		clog << "normal form of " << e << " erroneously returned "
+		     << en << " (should be " << 2*n << "/((x+1)*(x+" << n+1 << ")))" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* Normal form with factored denominators. */
+static unsigned check_normal_factored(const ex &e, int ndenom)
+{
+	ex f = normal_factored(e);
+	int found = 0;
+	if (is_exactly_a<mul>(f)) {
+		for (size_t i=0; i<f.nops(); ++i)
+			if (is_exactly_a<power>(f.op(i)) && f.op(i).op(1).info(info_flags::negint))
+				++found;
+	} else if (is_exactly_a<power>(f) && f.op(1).info(info_flags::negint))
+		found = 1;
+	if (found != ndenom || !(f - e).normal().is_zero()) {
+		clog << "normal_factored(" << e << ") erroneously returned " << f << endl;
+		return 1;
+	}
+	return 0;
+}
+
+static unsigned exam_normal_factored()
+{
+	unsigned result = 0;
+	symbol s("s"), m1("m1"), m2("m2");
+	ex e;
+
+	e = 1/(pow(s-pow(m1,2),2)*(s-pow(m2,2))) + 1/(s-pow(m1,2)) - s/pow(s-pow(m2,2),3);
+	result += check_normal_factored(e, 2);
+
+	// The factors of the denominators have a common factor
+	e = 1/(pow(x,2)-1) + 1/(pow(x,2)+x) + y/(x-1);
+	result += check_normal_factored(e, 3);
+
+	// Cancellation
+	e = (pow(x,2)-1)/(x+1) + 1/(x-y) - 1/(x-y);
+	result += check_normal_factored(e, 0);
+	e = 1/(x*(x+1)) - 1/(x*(x+2));
+	result += check_normal_factored(e, 3);
+	e = pow(x+1, 3)/((pow(x,2)+2*x+1)*pow(y-2, 2)) + sin(x)/(y-2);
+	result += check_normal_factored(e, 1);
+
+	return result;
+}
+
+/* A normal_context gives the same temporary symbols in all its calls. */
+static unsigned exam_normal_context()
+{
+	unsigned result = 0;
+	normal_context ctx;
+	ex e, f;
+
+	e = sin(x)/(pow(sin(x),2) - 1) + 1/(sin(x) + 1);
+	f = ctx.normal(e);
+	if (!f.is_equal(e.normal())) {
+		clog << "normal_context::normal(" << e << ") erroneously returned " << f
+		     << " instead of " << e.normal() << endl;
+		++result;
+	}
+	const size_t nrepl = ctx.replacements().size();
+
+	e = pow(sin(x),2)/(sin(x) - 1) - sqrt(y);
+	f = ctx.numer_denom(e);
+	if (!(f.op(0)/f.op(1) - e).normal().is_zero()) {
+		clog << "normal_context::numer_denom(" << e << ") erroneously returned " << f << endl;
+		++result;
+	}
+
+	// sin(x) and sqrt(y) were replaced by normal() and numer_denom()
+	const ex p1 = ctx.to_polynomial(sin(x) + x);
+	const ex p2 = ctx.to_polynomial(pow(sin(x),2) - sqrt(y));
+	if (ctx.replacements().size() != nrepl + 1 || p1.has(sin(x)) || p2.has(sin(x))) {
+		clog << "normal_context replaced sin(x) more than once: " << ctx.replacements() << endl;
+		++result;
+	}
+	const ex q = (p2 - pow(p1 - x, 2)).expand();
+	if (!ctx.restore(q).is_equal(-sqrt(y))) {
+		clog << "normal_context gave different symbols for sin(x): " << p1 << ", " << p2 << endl;
+		++result;
+	}
+	const ex r = ctx.to_rational(1/sin(x));
+	if (!(r*(p1 - x)).expand().is_equal(1)) {
+		clog << "normal_context::to_rational(1/sin(x)) erroneously returned " << r << endl;
+		++result;
+	}
+
+	ctx.clear();
+	if (!ctx.replacements().empty()) {
+		clog << "normal_context::clear() left " << ctx.replacements() << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* Parallel normalization must give the same result as normal() (even if
+ * the library is not thread-safe and everything is done sequentially). */
+static unsigned exam_normal_parallel()
+{
+	unsigned result = 0;
+	ex e, f;
+
+	e = 1/(x+y) + sin(x)/(x-y) + sin(x)/(x+y) + pow(x,2)/(pow(x,2)-pow(y,2)) + z/(y-x) + 1;
+	f = normal_parallel(e);
+	if (!(f - e.normal()).normal().is_zero()) {
+		clog << "normal_parallel(" << e << ") erroneously returned " << f
+		     << " instead of " << e.normal() << endl;
+		++result;
+	}
+
+	e = lst(1/(x+1) + 1/(x-1), (pow(x,2)-1)/(x+1), sqrt(y)/(x+sqrt(y)) + x/(x+sqrt(y)), z);
+	f = normal_parallel(e);
+	if (!is_a<lst>(f) || !f.is_equal(e.normal())) {
+		clog << "normal_parallel(" << e << ") erroneously returned " << f
+		     << " instead of " << e.normal() << endl;
+		++result;
+	}
+
+	matrix m(2, 2);
+	m = 1/(x+1) - 1/(x-1), x/(y+z) + y/(y+z),
+	    (pow(y,2)-pow(z,2))/(y-z), exp(x)/(exp(x)*x+exp(x));
+	f = normal_parallel(m);
+	if (!is_a<matrix>(f) || !ex_to<matrix>(f).sub(ex_to<matrix>(ex(m).normal())).is_zero_matrix()) {
+		clog << "normal_parallel(" << m << ") erroneously returned " << f
+		     << " instead of " << ex(m).normal() << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* Probabilistic zero test. */
+static unsigned check_zero_modular(const ex & e, bool zero, bool exact = false)
+{
+	if (is_zero_modular(e, exact) != zero) {
+		clog << "is_zero_modular(" << e << (exact ? ", true" : "")
+		     << ") erroneously returned " << !zero << endl;
+		return 1;
+	}
+	return 0;
+}
+
+static unsigned exam_zero_modular()
+{
+	unsigned result = 0;
+
+	result += check_zero_modular(pow(x+y, 7) - expand(pow(x+y, 7)), true);
+	result += check_zero_modular((pow(x,2)-1)/(x-1) - x - 1, true);
+	result += check_zero_modular((pow(x,2)-1)/(x-1) - x - 1, true, true);
+	result += check_zero_modular(1/(x+y) - 1/(x-y), false);
+	result += check_zero_modular(pow(x+y, 7) - expand(pow(x+y, 7)) + numeric(1, 3), false);
+
+	// Non-rational subexpressions
+	result += check_zero_modular(sin(x)/(sin(x)+1) + 1/(sin(x)+1) - 1, true);
+	result += check_zero_modular(sqrt(y)/(x+sqrt(y)) + x/(x+sqrt(y)) - 1, true);
+	result += check_zero_modular(sqrt(y)/(x+sqrt(y)) - 1, false);
+
+	// Only ex::normal() normalizes the arguments of functions
+	const ex f = sin((pow(x,2)-1)/(x-1)) - sin(x+1);
+	result += check_zero_modular(f, false);
+	result += check_zero_modular(f, true, true);
+
+	return result;
+}
+
+/* Normalization by evaluation and interpolation. */
+static unsigned check_normal_interpolate(const ex & e)
+{
+	const ex f = normal_interpolate(e);
+	if (!(f - e.normal()).normal().is_zero()) {
+		clog << "normal_interpolate(" << e << ") erroneously returned " << f
+		     << " instead of " << e.normal() << endl;
+		return 1;
+	}
+	return 0;
+}
+
+static unsigned exam_normal_interpolate()
+{
+	unsigned result = 0;
+
+	result += check_normal_interpolate(pow(x+y, 6) - expand(pow(x+y, 6)) + (pow(x,2)-pow(y,2))/(x-y) + 1/(x+z));
+	result += check_normal_interpolate(expand(pow(x-2*y+3, 4)) / expand(pow(x-2*y+3, 2)*(x+w)));
+	result += check_normal_interpolate(numeric(1, 3)*x/(y+x) - y/(3*x+3*y) + z);
+	result += check_normal_interpolate(sin(x)/(sin(x)+y) + y/(sin(x)+y));
+	result += check_normal_interpolate(1/(x-y) + 1/(y-x));
+	result += check_normal_interpolate(-pow(x, 2)/(2*y-2*x));
+
+	return result;
+}
+
 /* Test content(), integer_content(), primpart(). */
 static unsigned check_content(const ex & e, const ex & x, const ex & ic, const ex & c, const ex & pp)
 {
@@ -218,6 +428,38 @@ static unsigned exam_content()
 	return result;
 }
 
+static unsigned check_collect_common_factors(const ex & e, const ex & d)
+{
+	const ex r = collect_common_factors(e);
+	if (!r.is_equal(d) || !(r - e).expand().is_zero()) {
+		clog << "collect_common_factors(" << e << ") erroneously returned "
+		     << r << " instead of " << d << endl;
+		return 1;
+	}
+	return 0;
+}
+
+static unsigned exam_collect_common_factors()
+{
+	unsigned result = 0;
+
+	result += check_collect_common_factors(w*x+w*y, w*(x+y));
+	result += check_collect_common_factors(6*pow(w,2)*x*y+4*w*pow(x,3)*z, 2*w*x*(3*w*y+2*pow(x,2)*z));
+	result += check_collect_common_factors(w*(x*(w+z)*y+x*((w+z)*y+(w+z)*z)*z),
+	                                       w*x*(w+z)*(y+(y+z)*z));
+	result += check_collect_common_factors(w*y+(pow(y,2)-y)*z, y*(w+(y-1)*z));
+	result += check_collect_common_factors(x+y, x+y);
+
+	ex e = 0, d = 0;
+	for (int i=1; i<=200; i++) {
+		e += pow(w,2)*x*pow(y,i)*(w+z)*i;
+		d += pow(y,i-1)*i;
+	}
+	result += check_collect_common_factors(e, pow(w,2)*x*y*(w+z)*d);
+
+	return result;
+}
+
 unsigned exam_normalization()
 {
 	unsigned result = 0;
@@ -228,7 +470,14 @@ unsigned exam_normalization()
 	result += exam_normal2(); cout << '.' << flush;
 	result += exam_normal3(); cout << '.' << flush;
 	result += exam_normal4(); cout << '.' << flush;
+	result += exam_normal5(); cout << '.' << flush;
+	result += exam_normal_factored(); cout << '.' << flush;
+	result += exam_normal_context(); cout << '.' << flush;
+	result += exam_normal_parallel(); cout << '.' << flush;
+	result += exam_zero_modular(); cout << '.' << flush;
+	result += exam_normal_interpolate(); cout << '.' << flush;
 	result += exam_content(); cout << '.' << flush;
+	result += exam_collect_common_factors(); cout << '.' << flush;
 	
 	return result;
 }
@@ -381,6 +381,78 @@ static unsigned exam_numeric6()
 	return result;
 }
 
+/* Arithmetic of small integers, which is done without CLN, must agree with
+ * that of other numbers, also when the results leave the range. */
+static unsigned exam_numeric7()
+{
+	unsigned result = 0;
+
+	for (long a = -300; a <= 300; a += 37) {
+		for (long b = -300; b <= 300; b += 41) {
+			const numeric na(a), nb(b);
+			const ex ea(a), eb(b);
+			if (na.add(nb) != numeric(a + b) || na.sub(nb) != numeric(a - b) ||
+			    na.mul(nb) != numeric(a * b)) {
+				clog << "arithmetic of " << a << " and " << b << " failed" << endl;
+				++result;
+			}
+			if (!(ea + eb).is_equal(numeric(a + b)) || !(ea - eb).is_equal(numeric(a - b)) ||
+			    !(ea * eb).is_equal(numeric(a * b))) {
+				clog << "arithmetic of ex(" << a << ") and ex(" << b << ") failed" << endl;
+				++result;
+			}
+		}
+	}
+
+	// Results in the range of small integers are flyweights
+	const ex e1 = numeric(200).add(numeric(56));
+	const ex e2 = ex(128) * 2;
+	if (!are_ex_trivially_equal(e1, e2) || !are_ex_trivially_equal(ex(numeric(1)), ex(1))) {
+		clog << "small integers didn't end up as flyweights" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* The cached combinatorial functions must agree with their definitions, on
+ * both sides of the table limits and when the tables grow. */
+static unsigned exam_numeric8()
+{
+	unsigned result = 0;
+
+	for (int i = 500; i <= 520; ++i) {
+		const numeric n(i);
+		if (factorial(n) != n * factorial(n - 1)) {
+			clog << "factorial(" << n << ") != " << n << "*factorial(" << n - 1 << ")" << endl;
+			++result;
+		}
+		if (doublefactorial(n) != n * doublefactorial(n - 2)) {
+			clog << "doublefactorial(" << n << ") != " << n << "*doublefactorial(" << n - 2 << ")" << endl;
+			++result;
+		}
+		if (binomial(n, numeric(200)) != binomial(n - 1, numeric(199)) + binomial(n - 1, numeric(200))) {
+			clog << "binomial(" << n << ", 200) doesn't obey Pascal's rule" << endl;
+			++result;
+		}
+	}
+
+	// B_n = -1/(n+1) * sum_{k=0}^{n-1} binomial(n+1,k)*B_k, asking for a small
+	// number first so that the table is extended later on
+	bernoulli(numeric(4));
+	for (numeric n = 1; n <= 80; ++n) {
+		numeric sum;
+		for (numeric k = 0; k < n; ++k)
+			sum += binomial(n + 1, k) * bernoulli(k);
+		if (bernoulli(n) != -sum / (n + 1)) {
+			clog << "bernoulli(" << n << ") erroneously returned " << bernoulli(n) << endl;
+			++result;
+		}
+	}
+
+	return result;
+}
+
 unsigned exam_numeric()
 {
 	unsigned result = 0;
@@ -393,6 +465,8 @@ unsigned exam_numeric()
 	result += exam_numeric4();  cout << '.' << flush;
 	result += exam_numeric5();  cout << '.' << flush;
 	result += exam_numeric6();  cout << '.' << flush;
+	result += exam_numeric7();  cout << '.' << flush;
+	result += exam_numeric8();  cout << '.' << flush;
 	
 	return result;
 }
@@ -230,6 +230,176 @@ static unsigned poly_gcd7()
 	return 0;
 }
 
+// Modular GCD with the images computed in parallel
+static unsigned poly_gcd8()
+{
+	symbol y("y");
+	const unsigned options = gcd_options::no_heur_gcd | gcd_options::parallel;
+
+	for (int j=1; j<=MAX_VARIABLES; j++) {
+		ex d = pow(x, j) * pow(y, j + 1) - numeric("12345678901") * z + 3;
+		ex f = d * (pow(x + y, j) - numeric("98765432123") * pow(z, j + 1));
+		ex g = d * (pow(x - z, j + 1) + numeric("11111111111") * y);
+		ex r = gcd(f.expand(), g.expand(), NULL, NULL, true, options);
+		if (!(r - d).expand().is_zero() && !(r + d).expand().is_zero()) {
+			clog << "case 8, gcd(" << f << "," << g << ") = " << r << " (should be " << d << ")" << endl;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Sparse GCD of high degree in several variables, by sparse interpolation
+static unsigned poly_gcd9()
+{
+	symbol y("y"), u("u"), v("v");
+	const unsigned options = gcd_options::no_heur_gcd | gcd_options::use_sparse_interp;
+
+	for (int j=1; j<=MAX_VARIABLES; j++) {
+		ex d = pow(x, 3*j) * pow(u, 7) + pow(y, 5*j) * v - 3 * pow(z * u, 4*j) + 2;
+		ex f = d * (pow(v, 6*j) - x * pow(y * z, 2*j) + 5);
+		ex g = d * (pow(x * v, 4*j) + 7 * pow(u, 3*j) * y - 1);
+		ex r = gcd(f.expand(), g.expand(), NULL, NULL, true, options);
+		if (!(r - d).expand().is_zero() && !(r + d).expand().is_zero()) {
+			clog << "case 9, gcd(" << f << "," << g << ") = " << r << " (should be " << d << ")" << endl;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Cached GCDs and cofactors
+static unsigned poly_gcd10()
+{
+	symbol y("y");
+	ex d = pow(x + y, 3) - z;
+	ex f = (d * (x - 2 * y + z)).expand();
+	ex g = (d * (pow(x, 2) + y * z - 1)).expand();
+
+	set_gcd_cache_size(64);
+	ex ca1, cb1, ca2, cb2;
+	ex r1 = gcd(f, g, &ca1, &cb1);
+	ex r2 = gcd(f, g, &ca2, &cb2);
+	gcd_cache_statistics st = get_gcd_cache_statistics();
+	set_gcd_cache_size(0);
+
+	if (!r1.is_equal(r2) || !ca1.is_equal(ca2) || !cb1.is_equal(cb2)) {
+		clog << "case 10, cached gcd(" << f << "," << g << ") = " << r2 << " (should be " << r1 << ")" << endl;
+		return 1;
+	}
+	if (!(r1 * ca1 - f).expand().is_zero() || !(r1 * cb1 - g).expand().is_zero()) {
+		clog << "case 10, wrong cofactors " << ca1 << ", " << cb1 << endl;
+		return 1;
+	}
+	if (st.hits == 0 || st.entries == 0 || st.lookups < 2) {
+		clog << "case 10, gcd cache not used" << endl;
+		return 1;
+	}
+	return 0;
+}
+
+// Univariate heuristic GCD with large coefficients
+static unsigned poly_gcd11()
+{
+	ex d = 0, f = 0, g = 0;
+	for (int i = 0; i <= 20; ++i) {
+		d += numeric(i % 3 == 0 ? -1 : 1) * pow(numeric(3), 20 - i) * pow(x, i);
+		f += numeric(i * i - 7) * pow(x, i);
+		g += numeric(i % 4 == 1 ? -1 : 1) * pow(numeric(2), 3 * i) * pow(x, 30 - i);
+	}
+	f = (f * d).expand();
+	g = (g * d).expand();
+
+	ex ca, cb;
+	ex r = gcd(f, g, &ca, &cb);
+	ex r_prime = gcd(f, g, 0, 0, gcd_options::no_heur_gcd);
+	if (!(r - r_prime).expand().is_zero() && !(r + r_prime).expand().is_zero()) {
+		clog << "case 11, gcd(" << f << "," << g << ") = " << r << " (should be " << r_prime << ")" << endl;
+		return 1;
+	}
+	if (!(r * ca - f).expand().is_zero() || !(r * cb - g).expand().is_zero()) {
+		clog << "case 11, wrong cofactors " << ca << ", " << cb << endl;
+		return 1;
+	}
+	return 0;
+}
+
+// Determinant of the Sylvester matrix of e1 and e2 with respect to s
+static ex sylvester_determinant(const ex &e1, const ex &e2, const symbol &s)
+{
+	const int h1 = e1.degree(s), h2 = e2.degree(s);
+	matrix m(h1 + h2, h1 + h2);
+	for (int l = 0; l <= h1; ++l)
+		for (int k = 0; k < h2; ++k)
+			m(k, k+h1-l) = e1.coeff(s, l);
+	for (int l = 0; l <= h2; ++l)
+		for (int k = 0; k < h1; ++k)
+			m(k+h2, k+h2-l) = e2.coeff(s, l);
+	return m.determinant();
+}
+
+// Multivariate resultants (modular algorithm)
+static unsigned poly_resultant()
+{
+	ex r = resultant(x + pow(y[0], 2), 2*pow(x, 3) - 1, x);
+	if (!(r + 1 + 2*pow(y[0], 6)).expand().is_zero()) {
+		clog << "case 12, resultant(x+y0^2, 2*x^3-1, x) = " << r << " (should be -1-2*y0^6)" << endl;
+		return 1;
+	}
+
+	const ex cases[][2] = {
+		{ 3*pow(x, 3)*y[0] - 2*x*z + numeric(1, 2), pow(x, 2)*pow(z, 2) - 5*y[0]*x + pow(y[0], 3) },
+		{ (y[0] - 1)*pow(x, 2) + x + y[0], (y[0] - 2)*x + 3 },
+		{ pow(x - y[0] - z, 3) - y[1], pow(x, 2)*y[1] - 7*z + 11 },
+		{ expand((x - y[0])*(x + z)), expand((x - y[0])*(x - 2)) }
+	};
+	for (size_t i = 0; i < sizeof(cases)/sizeof(cases[0]); ++i) {
+		const ex e1 = cases[i][0].expand(), e2 = cases[i][1].expand();
+		r = resultant(e1, e2, x);
+		const ex r_prime = sylvester_determinant(e1, e2, x);
+		if (!(r - r_prime).expand().is_zero()) {
+			clog << "case 12, resultant(" << e1 << ", " << e2 << ", x) = " << r
+			     << " (should be " << r_prime << ")" << endl;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Exact division, with divisors that do and don't divide
+static unsigned poly_divide()
+{
+	const ex f = pow(x, 3)*y[0] - 2*x*pow(z, 2) + 5*y[1] - 1;
+	const ex g = pow(x + y[0] - z, 3) + numeric(1, 3)*y[1];
+	const ex a = (f*g).expand();
+
+	const ex divisors[] = { f, g, 7*f, numeric(2, 5)*g };
+	for (size_t i = 0; i < sizeof(divisors)/sizeof(divisors[0]); ++i) {
+		ex q;
+		if (!divide(a, divisors[i], q) || !(q*divisors[i] - a).expand().is_zero()) {
+			clog << "case 13, divide(" << a << ", " << divisors[i] << ") failed" << endl;
+			return 1;
+		}
+	}
+
+	const ex non_divisors[] = {
+		f + y[0],
+		pow(x, 4) + 1,
+		pow(y[1], 2) + x,
+		3*pow(x, 3)*y[0] + 1,
+		expand((x - y[1])*(z + 2))
+	};
+	for (size_t i = 0; i < sizeof(non_divisors)/sizeof(non_divisors[0]); ++i) {
+		ex q;
+		if (divide(a, non_divisors[i], q)) {
+			clog << "case 13, divide(" << a << ", " << non_divisors[i] << ") succeeded with "
+			     << q << endl;
+			return 1;
+		}
+	}
+	return 0;
+}
+
 unsigned exam_polygcd()
 {
 	unsigned result = 0;
@@ -245,6 +415,12 @@ unsigned exam_polygcd()
 	result += poly_gcd5p();  cout << '.' << flush;
 	result += poly_gcd6();  cout << '.' << flush;
 	result += poly_gcd7();  cout << '.' << flush;
+	result += poly_gcd8();  cout << '.' << flush;
+	result += poly_gcd9();  cout << '.' << flush;
+	result += poly_gcd10();  cout << '.' << flush;
+	result += poly_gcd11();  cout << '.' << flush;
+	result += poly_resultant();  cout << '.' << flush;
+	result += poly_divide();  cout << '.' << flush;
 	
 	return result;
 }
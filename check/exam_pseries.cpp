@@ -386,6 +386,359 @@ static unsigned exam_series14()
 	return result;
 }
 
+// Long expansions, by multiplication and powers of series
+static unsigned exam_series15()
+{
+	unsigned result = 0;
+	const int order = 60;
+
+	ex e = exp(x)*exp(2*x);
+	ex d = Order(pow(x, order));
+	for (int k = 0; k < order; ++k)
+		d += pow(numeric(3), k) / factorial(numeric(k)) * pow(x, k);
+	result += check_series(e, 0, d, order);
+
+	e = pow(1 - x, -2) * (1 + x);
+	d = Order(pow(x, order));
+	for (int k = 0; k < order; ++k)
+		d += (2*k + 1) * pow(x, k);
+	result += check_series(e, 0, d, order);
+
+	// Catalan numbers
+	e = (1 - sqrt(1 - 4*x)) / (2*x);
+	d = Order(pow(x, order));
+	for (int k = 0; k < order; ++k)
+		d += binomial(numeric(2*k), numeric(k)) / (k + 1) * pow(x, k);
+	result += check_series(e, 0, d, order);
+
+	return result;
+}
+
+// Lazy series, extended term by term
+static unsigned exam_series16()
+{
+	unsigned result = 0;
+
+	const ex cases[][2] = {
+		{ sin(x) / (1 - x), 0 },
+		{ pow(1 + x + 2*pow(x, 2), numeric(1, 3)) * exp(x), 0 },
+		{ 1 / (x * cos(x)), 0 },
+		{ pow(x + 1, 5) - x, 0 },
+		{ pow(x, 3) / (x - 2) + log(x), 1 }
+	};
+	for (size_t i = 0; i < sizeof(cases)/sizeof(cases[0]); ++i) {
+		const ex e = cases[i][0], point = cases[i][1];
+		lazy_series ls(e, x == point);
+		for (int order = 1; order <= 12; ++order) {
+			const ex d = series_to_poly(e.series(x == point, order));
+			const ex l = series_to_poly(ls.series(order));
+			if (!(l - d).expand().is_zero()) {
+				clog << "lazy series expansion of " << e << " at " << point << " to order "
+				     << order << " erroneously returned " << l << " (instead of " << d
+				     << ")" << endl;
+				++result;
+				break;
+			}
+		}
+	}
+
+	return result;
+}
+
+// Multivariate series, truncated by weighted total degree
+static unsigned exam_series17()
+{
+	unsigned result = 0;
+	symbol y("y"), t("t");
+
+	const ex cases[] = {
+		exp(x + y) / (1 - x*y),
+		sqrt(1 + x + pow(y, 2)) * cos(x*y),
+		pow(1 + x, y) + log(1 - y) / (2 + x)
+	};
+	for (int w = 1; w <= 2; ++w) {
+		std::vector<int> weights;
+		weights.push_back(1);
+		weights.push_back(w);
+		for (size_t i = 0; i < sizeof(cases)/sizeof(cases[0]); ++i) {
+			const int order = 7;
+			const mseries ms(cases[i], lst(x, y), weights, order);
+			const ex scaled = cases[i].subs(lst(x == t*x, y == pow(t, w)*y));
+			const ex d = series_to_poly(scaled.series(t == 0, order));
+			const ex m = series_to_poly(ms.to_pseries(t));
+			if (!(m - d).expand().is_zero()) {
+				clog << "multivariate expansion of " << cases[i] << " with weights 1, " << w
+				     << " erroneously returned " << m << " (instead of " << d << ")" << endl;
+				++result;
+			}
+		}
+	}
+
+	// Products of series
+	const mseries a(exp(x), lst(x, y), 6), b(exp(y), lst(x, y), 6), c(exp(x + y), lst(x, y), 6);
+	if (!((a*b).to_polynomial() - c.to_polynomial()).expand().is_zero()) {
+		clog << "product of multivariate series of exp(x) and exp(y) erroneously returned "
+		     << (a*b).to_polynomial() << " (instead of " << c.to_polynomial() << ")" << endl;
+		++result;
+	}
+
+	// Truncated series in the expression lower the order
+	const ex e = sin(x).series(x == 0, 4) * (1 + y) + Order(pow(y, 5));
+	const mseries p(e, lst(x, y), 10);
+	const ex d = x + x*y - pow(x, 3)/6;
+	if (p.get_order() != 4 || !(p.to_polynomial() - d).expand().is_zero()) {
+		clog << "multivariate expansion of " << e << " erroneously returned "
+		     << p.to_polynomial() << " to order " << p.get_order()
+		     << " (instead of " << d << " to order 4)" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+// Products truncated at the order, with factors of low and negative ldegree
+static unsigned exam_series18()
+{
+	unsigned result = 0;
+	ex e, d;
+
+	ex p = 0;
+	for (int k = 0; k <= 30; ++k)
+		p += pow(x, k);
+	e = p * (1 - x);
+	d = 1 + Order(pow(x, 10));
+	result += check_series(e, 0, d, 10);
+
+	e = pow(x, -2) * (pow(x, 2) + pow(x, 5)) * exp(x);
+	d = 1 + x + pow(x, 2)/2 + numeric(7, 6)*pow(x, 3) + Order(pow(x, 4));
+	result += check_series(e, 0, d, 4);
+
+	e = exp(x) * exp(-x);
+	d = 1 + Order(pow(x, 40));
+	result += check_series(e, 0, d, 40);
+
+	e = pow(sin(x), -2) * pow(x, 3) * (1 - pow(x, 2)/6);
+	d = x + pow(x, 3)/6 + Order(pow(x, 4));
+	result += check_series(e, 0, d, 4);
+
+	return result;
+}
+
+// Sums with many terms, expanded with and without several threads
+static unsigned exam_series19()
+{
+	unsigned result = 0;
+	symbol a("a");
+
+	ex e = 0;
+	for (int k = 1; k <= 400; ++k)
+		e += pow(x + k, -1) + k * sin(k*x) * pow(a, k % 7);
+	const ex s = series_to_poly(e.series(x == 0, 6));
+	const ex p = series_to_poly(e.series(x == 0, 6, series_options::parallel));
+	if (!(s - p).expand().is_zero()) {
+		clog << "parallel series expansion of a sum with " << e.nops()
+		     << " terms erroneously returned " << p << " (instead of " << s << ")" << endl;
+		++result;
+	}
+
+	ex d = 0;
+	for (int n = 0; n < 6; ++n) {
+		ex c = 0;
+		for (int k = 1; k <= 400; ++k)
+			c += pow(numeric(-1), n) / pow(numeric(k), n + 1);
+		d += c * pow(x, n);
+	}
+	for (int k = 1; k <= 400; ++k)
+		d += k * (k*x - pow(k*x, 3)/6 + pow(k*x, 5)/120) * pow(a, k % 7);
+	if (!(p - d).expand().is_zero()) {
+		clog << "parallel series expansion of a sum with " << e.nops()
+		     << " terms erroneously returned " << p << " (instead of " << d << ")" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+// Series of exp and log by Newton iteration, and of other functions by
+// composition with the series of their argument
+static unsigned exam_series20()
+{
+	unsigned result = 0;
+	symbol a("a"), b("b");
+	ex e, d;
+
+	e = log(1 + x);
+	d = Order(pow(x, 30));
+	for (int k = 1; k < 30; ++k)
+		d += pow(numeric(-1), k + 1) / k * pow(x, k);
+	result += check_series(e, 0, d, 30);
+
+	e = exp(a*x + b*pow(x, 2));
+	d = 1 + a*x + (pow(a, 2)/2 + b)*pow(x, 2) + (pow(a, 3)/6 + a*b)*pow(x, 3)
+	  + (pow(a, 4)/24 + pow(a, 2)*b/2 + pow(b, 2)/2)*pow(x, 4) + Order(pow(x, 5));
+	result += check_series(e, 0, d, 5);
+
+	e = sin(2*x);
+	d = Order(pow(x, 20));
+	for (int k = 0; 2*k + 1 < 20; ++k)
+		d += pow(numeric(-1), k) * pow(2*x, 2*k + 1) / factorial(numeric(2*k + 1));
+	result += check_series(e, 0, d, 20);
+
+	d = 1 + Order(pow(x, 20));
+	result += check_series(exp(sin(x)).series(x == 0, 20) * exp(-sin(x)).series(x == 0, 20), 0, d, 20);
+
+	const ex u = exp(x) - 1;
+	d = 1 + Order(pow(x, 15));
+	result += check_series(pow(cos(u), 2) + pow(sin(u), 2), 0, d, 15);
+
+	return result;
+}
+
+// Taylor expansion by differentiation, with shared derivatives
+static unsigned exam_series21()
+{
+	unsigned result = 0;
+	symbol a("a");
+	ex e, d;
+
+	e = pow(1 + x, x);
+	d = 1 + pow(x, 2) - pow(x, 3)/2 + numeric(5, 6)*pow(x, 4) - numeric(3, 4)*pow(x, 5)
+	  + numeric(33, 40)*pow(x, 6) + Order(pow(x, 7));
+	result += check_series(e, 0, d, 7);
+
+	e = pow(a + x, x) * pow(a - x, x);
+	d = 1 + 2*log(a)*x + 2*pow(log(a), 2)*pow(x, 2) + Order(pow(x, 3));
+	result += check_series(e, 0, d, 3);
+
+	return result;
+}
+
+// Series answered from the series cache, also at lower order
+static unsigned exam_series22()
+{
+	unsigned result = 0;
+	ex e = sin(x) / (1 + exp(x));
+
+	const ex d8 = e.series(x == 0, 8);
+	const ex d5 = e.series(x == 0, 5);
+
+	set_series_cache_size(64);
+	const ex c8 = e.series(x == 0, 8);
+	const ex c5 = e.series(x == 0, 5);
+	series_cache_statistics st = get_series_cache_statistics();
+	set_series_cache_size(0);
+
+	if (!(series_to_poly(c8) - series_to_poly(d8)).expand().is_zero() ||
+	    !(series_to_poly(c5) - series_to_poly(d5)).expand().is_zero() ||
+	    ex_to<pseries>(c5).degree(x) != ex_to<pseries>(d5).degree(x)) {
+		clog << "cached series of " << e << " are " << c8 << " and " << c5
+		     << " (should be " << d8 << " and " << d5 << ")" << endl;
+		++result;
+	}
+	if (st.hits == 0 || st.entries == 0) {
+		clog << "series cache not used" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+// Rational powers of series, with irrational leading coefficients and
+// sparse bases
+static unsigned exam_series23()
+{
+	unsigned result = 0;
+	symbol a("a"), b("b");
+	ex e, d;
+
+	e = sqrt(2 + x);
+	d = sqrt(numeric(2)) * (1 + x/4 - pow(x, 2)/32 + pow(x, 3)/128 - numeric(5, 2048)*pow(x, 4))
+	  + Order(pow(x, 5));
+	result += check_series(e, 0, d, 5);
+
+	e = pow(1 - pow(x, 2), numeric(-1, 2));
+	d = Order(pow(x, 24));
+	for (int k = 0; 2*k < 24; ++k)
+		d += binomial(numeric(2*k), numeric(k)) / pow(numeric(4), k) * pow(x, 2*k);
+	result += check_series(e, 0, d, 24);
+
+	e = sqrt(a + b*x);
+	d = sqrt(a) + b/(2*sqrt(a))*x - pow(b, 2)/(8*pow(a, numeric(3, 2)))*pow(x, 2)
+	  + Order(pow(x, 3));
+	result += check_series(e, 0, d, 3);
+
+	e = pow(a*(1 + x + 3*pow(x, 2)), numeric(1, 3));
+	d = pow(a, numeric(1, 3)) * (1 + x/3 + numeric(8, 9)*pow(x, 2) - numeric(49, 81)*pow(x, 3))
+	  + Order(pow(x, 4));
+	result += check_series(e, 0, d, 4);
+
+	return result;
+}
+
+// Leading terms without the full series
+static unsigned exam_series24()
+{
+	unsigned result = 0;
+	symbol a("a");
+
+	struct {
+		ex e, point;
+		int deg;
+		ex coeff;
+	} cases[] = {
+		{ pow(x, 3) * sin(x) / (1 - cos(x)), 0, 2, 2 },
+		{ exp(x) / pow(x, 2) + 1/x, 0, -2, 1 },
+		{ sin(x) - x, 0, 3, numeric(-1, 6) },
+		{ sqrt(a + x) * cos(x), 0, 0, sqrt(a) },
+		{ log(x) * pow(x - 1, -3), 1, -2, 1 },
+		{ pow(sin(x) - x, -2) + 1, 0, -6, 36 },
+	};
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+		const ex & e = cases[i].e;
+		const int deg = series_ldegree(e, x == cases[i].point);
+		const ex coeff = series_lcoeff(e, x == cases[i].point);
+		if (deg != cases[i].deg || !(coeff - cases[i].coeff).expand().is_zero()) {
+			clog << "leading term of " << e << " at " << x << "==" << cases[i].point
+			     << " erroneously returned " << coeff << "*(x-point)^" << deg
+			     << " (instead of " << cases[i].coeff << "*(x-point)^" << cases[i].deg << ")" << endl;
+			++result;
+		}
+	}
+
+	return result;
+}
+
+// Expansion truncated by weighted total degree
+static unsigned exam_series25()
+{
+	unsigned result = 0;
+	symbol y("y"), a("a");
+
+	const ex e = pow(1 + x + a*y, 6) * (x - 2*y + a) * pow(a + x*y, 3);
+	const ex full = e.expand();
+	for (int w = 1; w <= 2; ++w) {
+		std::vector<int> weights;
+		weights.push_back(1);
+		weights.push_back(w);
+		for (int n = 0; n <= 8; n += 3) {
+			ex d = 0;
+			for (size_t i = 0; i < full.nops(); ++i) {
+				const ex & t = full.op(i);
+				if (t.degree(x) + w*t.degree(y) <= n)
+					d += t;
+			}
+			const ex r = expand_truncated(e, lst(x, y), weights, n);
+			if (!(r - d).expand().is_zero()) {
+				clog << "expand_truncated(" << e << ") with weights 1, " << w << " to degree " << n
+				     << " erroneously returned " << r << " (instead of " << d << ")" << endl;
+				++result;
+			}
+		}
+	}
+
+	return result;
+}
+
 unsigned exam_pseries()
 {
 	unsigned result = 0;
@@ -406,6 +759,17 @@ unsigned exam_pseries()
 	result += exam_series12();  cout << '.' << flush;
 	result += exam_series13();  cout << '.' << flush;
 	result += exam_series14();  cout << '.' << flush;
+	result += exam_series15();  cout << '.' << flush;
+	result += exam_series16();  cout << '.' << flush;
+	result += exam_series17();  cout << '.' << flush;
+	result += exam_series18();  cout << '.' << flush;
+	result += exam_series19();  cout << '.' << flush;
+	result += exam_series20();  cout << '.' << flush;
+	result += exam_series21();  cout << '.' << flush;
+	result += exam_series22();  cout << '.' << flush;
+	result += exam_series23();  cout << '.' << flush;
+	result += exam_series24();  cout << '.' << flush;
+	result += exam_series25();  cout << '.' << flush;
 	
 	return result;
 }
@@ -96,6 +96,122 @@ static int check4(std::ostream& err_str)
 	}
 }
 
+/// parser::parse_buffer() must agree with the stream parser, except for
+/// signs after an operator, which only apply to the following factor.
+static int check5(std::ostream& err_str)
+{
+	const char* const inputs[] = {
+		"-a-b", "5-(3*x)/10", "5-(2*I)/3", "x+2*x-3*x^2+x*x # comment",
+		"2*(a+b)-2*a", "a/(2*b)*4", "sin(x)^2+cos(x)^2-1",
+		"{1.5E3, 123456789012345678901234567890*a, Pi*x^(-2)}",
+		"(a+b)*(a-b)+0*c", "1/3+2/3-x/y/z"
+	};
+	int errors = 0;
+	for (std::size_t i = 0; i < sizeof(inputs)/sizeof(inputs[0]); ++i) {
+		const std::string srep(inputs[i]);
+		parser reader;
+		ex e = reader(srep);
+		ex f = reader.parse_buffer(srep.data(), srep.data() + srep.size());
+		if (!e.is_equal(f)) {
+			err_str << "\"" << srep << "\" was parsed as \""
+				<< f << "\" instead of \"" << e << "\"" << std::endl;
+			++errors;
+		}
+	}
+
+	const std::string signs("a*-b+c");
+	parser reader;
+	ex e = reader.parse_buffer(signs.data(), signs.data() + signs.size());
+	ex a = reader.get_syms()["a"];
+	ex b = reader.get_syms()["b"];
+	ex c = reader.get_syms()["c"];
+	if (!e.is_equal(-a*b+c)) {
+		err_str << "\"" << signs << "\" was parsed as \""
+			<< e << "\"" << std::endl;
+		++errors;
+	}
+
+	const std::string junk("x^2^3+1");
+	try {
+		e = reader.parse_buffer(junk.data(), junk.data() + junk.size());
+		err_str << "parse_buffer accepts junk: \"" << junk << "\"" << std::endl;
+		++errors;
+	} catch (parse_error& err) {
+	}
+	return errors;
+}
+
+/// Parsing large sums and lists in pieces must not change the result.
+static int check6(std::ostream& err_str)
+{
+	std::ostringstream sum, list;
+	list << '{';
+	for (int i = 1; i < 20000; ++i) {
+		sum << (i % 3 ? '+' : '-') << i << "*x^" << i % 50
+		    << "*y" << i % 7 << "/(1+z)^-" << i % 5;
+		list << (i > 1 ? "," : "") << "x" << i % 11 << "^" << i << "-" << i;
+	}
+	list << '}';
+
+	int errors = 0;
+	const std::string inputs[] = { sum.str(), list.str() };
+	for (std::size_t i = 0; i < 2; ++i) {
+		const std::string& srep = inputs[i];
+		parser reader;
+		ex e = reader.parse_buffer(srep.data(), srep.data() + srep.size());
+		parser parallel_reader(reader.get_syms());
+		parallel_reader.parallel = true;
+		ex f = parallel_reader.parse_buffer(srep.data(), srep.data() + srep.size());
+		if (!e.is_equal(f)) {
+			err_str << "parallel parsing of a " << (i ? "list" : "sum")
+				<< " gave a different result" << std::endl;
+			++errors;
+		}
+	}
+	return errors;
+}
+
+static ex one_arg_reader(const exvector& ev)
+{
+	return ev[0];
+}
+
+static ex two_args_reader(const exvector& ev)
+{
+	return ev[0] - ev[1];
+}
+
+/// Readers are found by name and number of arguments, a reader for 0
+/// arguments takes any number of them, and a call with no arguments must
+/// not find a reader for more.
+static int check7(std::ostream& err_str)
+{
+	prototype_table table = get_default_reader();
+	table[prototype("f", 1)] = one_arg_reader;
+	table[prototype("f", 2)] = two_args_reader;
+	parser reader(symtab(), false, table);
+	ex e = reader("f(x)+f(x,y)");
+	ex x = reader.get_syms()["x"];
+	ex y = reader.get_syms()["y"];
+	int errors = 0;
+	if (!e.is_equal(2*x-y)) {
+		err_str << "\"f(x)+f(x,y)\" was parsed as \"" << e << "\"" << std::endl;
+		++errors;
+	}
+	e = reader("lst(x,y,x+y)");
+	if (!e.is_equal(lst(x, y, x+y))) {
+		err_str << "\"lst(x,y,x+y)\" was parsed as \"" << e << "\"" << std::endl;
+		++errors;
+	}
+	try {
+		e = reader("f()");
+		err_str << "\"f()\" was parsed as \"" << e << "\"" << std::endl;
+		++errors;
+	} catch (parse_error& err) {
+	}
+	return errors;
+}
+
 int main(int argc, char** argv)
 {
 	std::cout << "checking for parser bugs. " << std::flush;
@@ -105,6 +221,9 @@ int main(int argc, char** argv)
 	errors += check2(err_str);
 	errors += check3(err_str);
 	errors += check4(err_str);
+	errors += check5(err_str);
+	errors += check6(err_str);
+	errors += check7(err_str);
 	if (errors) {
 		std::cout << "Yes, unfortunately:" << std::endl;
 		std::cout << err_str.str();
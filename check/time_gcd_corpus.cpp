@@ -0,0 +1,337 @@
+/** @file time_gcd_corpus.cpp
+ *
+ *  Time the polynomial GCD algorithms and the factorization on a corpus of
+ *  sparse and dense, univariate and multivariate polynomials, and write the
+ *  times as CSV, one line per case and algorithm. The results of the GCD
+ *  algorithms are compared with each other, and the factorizations are
+ *  expanded again, so the program also serves as a regression test. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "ginac.h"
+#include "timer.h"
+#include "test_runner.h"
+#include "polynomial/chinrem_gcd.h"
+#include "polynomial/pgcd.h"
+using namespace GiNaC;
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+/// Linear congruential generator, so that the corpus is the same on every
+/// system (unlike with rand())
+static unsigned long next_random(unsigned long & seed)
+{
+	seed = (seed * 1103515245UL + 12345UL) & 0x7fffffffUL;
+	return seed >> 8;
+}
+
+static ex random_coeff(unsigned long & seed)
+{
+	const long c = long(next_random(seed) % 199) - 99;
+	return c == 0 ? 1 : c;
+}
+
+/// Polynomial with nterms terms of degree at most maxdeg in each variable
+static ex sparse_poly(const exvector & vars, unsigned nterms, unsigned maxdeg, unsigned long & seed)
+{
+	ex p = 0;
+	for (unsigned t = 0; t < nterms; ++t) {
+		ex term = random_coeff(seed);
+		for (size_t i = 0; i < vars.size(); ++i)
+			term *= pow(vars[i], next_random(seed) % (maxdeg + 1));
+		p += term;
+	}
+	return p.expand();
+}
+
+/// Polynomial with all monomials of total degree at most deg in the
+/// variables vars[k], vars[k+1], ...
+static ex dense_poly(const exvector & vars, size_t k, unsigned deg, unsigned long & seed)
+{
+	if (k == vars.size())
+		return random_coeff(seed);
+	ex p = 0;
+	for (unsigned e = 0; e <= deg; ++e)
+		p += pow(vars[k], e) * dense_poly(vars, k + 1, deg - e, seed);
+	return p.expand();
+}
+
+/// Swinnerton-Dyer polynomial of degree 2^n: the product of
+/// x +- sqrt(2) +- sqrt(3) +- ... over all signs. It is irreducible over
+/// the integers, but splits into factors of degree at most 2 modulo every
+/// prime, which is the worst case for the Zassenhaus algorithm.
+static ex swinnerton_dyer(const symbol & x, unsigned n)
+{
+	static const unsigned primes[] = { 2, 3, 5, 7, 11, 13 };
+	ex p = x;
+	for (unsigned i = 0; i < n; ++i) {
+		const ex s = sqrt(ex(primes[i]));
+		p = (p.subs(x == x - s) * p.subs(x == x + s)).expand();
+	}
+	return p;
+}
+
+/** One case of the corpus. */
+struct corpus_case {
+	string name;
+	string kind;       ///< "gcd" or "factor"
+	ex a, b;           ///< polynomials (b is unused for factorization)
+	exvector vars;
+	bool prs;          ///< whether the PRS algorithm finishes in reasonable time
+};
+
+static corpus_case gcd_case(const string & name, const exvector & vars,
+                            const ex & g, const ex & a, const ex & b, bool prs = true)
+{
+	corpus_case c;
+	c.name = name;
+	c.kind = "gcd";
+	c.a = (g * a).expand();
+	c.b = (g * b).expand();
+	c.vars = vars;
+	c.prs = prs;
+	return c;
+}
+
+static corpus_case factor_case(const string & name, const exvector & vars, const ex & a)
+{
+	corpus_case c;
+	c.name = name;
+	c.kind = "factor";
+	c.a = a.expand();
+	c.b = 0;
+	c.vars = vars;
+	c.prs = false;
+	return c;
+}
+
+static vector<corpus_case> make_corpus(bool expensive)
+{
+	unsigned long seed = 4711;
+	symbol x("x");
+	exvector v1(1, x);
+	exvector v3, v6, v10;
+	for (unsigned i = 0; i < 10; ++i) {
+		ostringstream s;
+		s << "x" << i;
+		const symbol xi(s.str());
+		if (i < 3)
+			v3.push_back(xi);
+		if (i < 6)
+			v6.push_back(xi);
+		v10.push_back(xi);
+	}
+
+	vector<corpus_case> corpus;
+	corpus.push_back(gcd_case("uvar_dense_30", v1,
+		dense_poly(v1, 0, 30, seed), dense_poly(v1, 0, 30, seed), dense_poly(v1, 0, 30, seed)));
+	corpus.push_back(gcd_case("uvar_sparse_500", v1,
+		sparse_poly(v1, 5, 500, seed), sparse_poly(v1, 5, 500, seed), sparse_poly(v1, 5, 500, seed), false));
+	corpus.push_back(gcd_case("uvar_coprime_60", v1,
+		1, dense_poly(v1, 0, 60, seed), dense_poly(v1, 0, 60, seed)));
+	corpus.push_back(gcd_case("mvar_dense_3v_5", v3,
+		dense_poly(v3, 0, 5, seed), dense_poly(v3, 0, 5, seed), dense_poly(v3, 0, 5, seed)));
+	corpus.push_back(gcd_case("mvar_sparse_6v_8", v6,
+		sparse_poly(v6, 8, 8, seed), sparse_poly(v6, 8, 8, seed), sparse_poly(v6, 8, 8, seed), false));
+	corpus.push_back(gcd_case("mvar_sparse_10v_20", v10,
+		sparse_poly(v10, 5, 20, seed), sparse_poly(v10, 5, 20, seed), sparse_poly(v10, 5, 20, seed), false));
+	corpus.push_back(gcd_case("mvar_coprime_3v_6", v3,
+		1, dense_poly(v3, 0, 6, seed), dense_poly(v3, 0, 6, seed), false));
+	if (expensive) {
+		corpus.push_back(gcd_case("uvar_dense_200", v1,
+			dense_poly(v1, 0, 200, seed), dense_poly(v1, 0, 200, seed), dense_poly(v1, 0, 200, seed), false));
+		corpus.push_back(gcd_case("mvar_dense_3v_12", v3,
+			dense_poly(v3, 0, 12, seed), dense_poly(v3, 0, 12, seed), dense_poly(v3, 0, 12, seed), false));
+		corpus.push_back(gcd_case("mvar_sparse_10v_40", v10,
+			sparse_poly(v10, 20, 40, seed), sparse_poly(v10, 20, 40, seed), sparse_poly(v10, 20, 40, seed), false));
+	}
+
+	corpus.push_back(factor_case("factor_uvar_3x10", v1,
+		dense_poly(v1, 0, 10, seed) * dense_poly(v1, 0, 10, seed) * dense_poly(v1, 0, 10, seed)));
+	corpus.push_back(factor_case("factor_mvar_3v_3x4", v3,
+		sparse_poly(v3, 4, 4, seed) * sparse_poly(v3, 4, 4, seed) * sparse_poly(v3, 4, 4, seed)));
+	corpus.push_back(factor_case("factor_mvar_square", v3,
+		pow(dense_poly(v3, 0, 3, seed), 2) * dense_poly(v3, 0, 2, seed)));
+	corpus.push_back(factor_case("swinnerton_dyer_3", v1, swinnerton_dyer(x, 3)));
+	corpus.push_back(factor_case("swinnerton_dyer_4", v1, swinnerton_dyer(x, 4)));
+	if (expensive)
+		corpus.push_back(factor_case("swinnerton_dyer_5", v1, swinnerton_dyer(x, 5)));
+	return corpus;
+}
+
+/** An algorithm to be timed on the cases of one kind. */
+struct algorithm {
+	virtual ~algorithm() {}
+	virtual string name() const = 0;
+	virtual bool applies(const corpus_case & c) const = 0;
+	virtual ex operator()(const corpus_case & c) const = 0;
+	/** Whether the result can be compared with the one of gcd(). */
+	virtual bool comparable() const { return true; }
+};
+
+struct gcd_algorithm : public algorithm {
+	string n;
+	unsigned options;
+	gcd_algorithm(const string & n_, unsigned options_) : n(n_), options(options_) {}
+	string name() const { return n; }
+	bool applies(const corpus_case & c) const
+	{
+		return c.kind == "gcd" && (c.prs || !(options & gcd_options::use_sr_gcd));
+	}
+	ex operator()(const corpus_case & c) const
+	{
+		return gcd(c.a, c.b, NULL, NULL, true, options);
+	}
+};
+
+struct chinrem_algorithm : public algorithm {
+	string name() const { return "chinrem_gcd"; }
+	bool applies(const corpus_case & c) const { return c.kind == "gcd"; }
+	ex operator()(const corpus_case & c) const
+	{
+		return chinrem_gcd(c.a, c.b, c.vars);
+	}
+};
+
+/** The GCD modulo a single prime, which chinrem_gcd() computes for every
+ *  prime it uses. */
+struct pgcd_algorithm : public algorithm {
+	string name() const { return "pgcd_mod_p"; }
+	bool applies(const corpus_case & c) const { return c.kind == "gcd"; }
+	ex operator()(const corpus_case & c) const
+	{
+		return pgcd(c.a, c.b, c.vars, 1000003);
+	}
+	bool comparable() const { return false; }
+};
+
+struct factor_algorithm : public algorithm {
+	string name() const { return "factor"; }
+	bool applies(const corpus_case & c) const { return c.kind == "factor"; }
+	ex operator()(const corpus_case & c) const
+	{
+		return factor(c.a);
+	}
+};
+
+static size_t num_terms(const ex & e)
+{
+	const ex x = e.expand();
+	if (x.is_zero())
+		return 0;
+	return is_exactly_a<add>(x) ? x.nops() : 1;
+}
+
+/// Run alg on c repeatedly for at least 0.1 seconds (but at most 100 times)
+static double time_algorithm(const algorithm & alg, const corpus_case & c, ex & result, unsigned & reps)
+{
+	timer t;
+	double total = 0;
+	reps = 0;
+	do {
+		t.start();
+		result = alg(c);
+		total += t.read();
+		++reps;
+	} while (total < 0.1 && reps < 100);
+	return total / reps;
+}
+
+static bool agrees(const ex & g, const ex & ref)
+{
+	return (g - ref).expand().is_zero() || (g + ref).expand().is_zero();
+}
+
+static unsigned run_corpus(const vector<corpus_case> & corpus, ostream & csv)
+{
+	vector<algorithm *> algorithms;
+	algorithms.push_back(new gcd_algorithm("gcd", 0));
+	algorithms.push_back(new gcd_algorithm("gcd_no_heur", gcd_options::no_heur_gcd));
+	algorithms.push_back(new gcd_algorithm("gcd_sparse_interp",
+		gcd_options::no_heur_gcd | gcd_options::use_sparse_interp));
+	algorithms.push_back(new gcd_algorithm("gcd_parallel",
+		gcd_options::no_heur_gcd | gcd_options::parallel));
+	algorithms.push_back(new gcd_algorithm("gcd_sr",
+		gcd_options::no_heur_gcd | gcd_options::use_sr_gcd));
+	algorithms.push_back(new chinrem_algorithm);
+	algorithms.push_back(new pgcd_algorithm);
+	algorithms.push_back(new factor_algorithm);
+
+	unsigned failures = 0;
+	csv << "case,kind,variables,terms_a,terms_b,algorithm,seconds,repetitions,result_terms,ok" << endl;
+	for (vector<corpus_case>::const_iterator c = corpus.begin(); c != corpus.end(); ++c) {
+		ex reference;
+		bool have_reference = false;
+		for (vector<algorithm *>::const_iterator a = algorithms.begin(); a != algorithms.end(); ++a) {
+			if (!(*a)->applies(*c))
+				continue;
+			ex result;
+			unsigned reps;
+			const double t = time_algorithm(**a, *c, result, reps);
+
+			bool ok = true;
+			if (c->kind == "factor") {
+				ok = (result.expand() - c->a).is_zero();
+			} else if ((*a)->comparable()) {
+				if (have_reference) {
+					ok = agrees(result, reference);
+				} else {
+					reference = result;
+					have_reference = true;
+				}
+			}
+			if (!ok) {
+				clog << (*a)->name() << " gives wrong result for " << c->name << ": " << result << endl;
+				++failures;
+			}
+
+			csv << c->name << ',' << c->kind << ',' << c->vars.size() << ','
+			    << num_terms(c->a) << ',' << num_terms(c->b) << ','
+			    << (*a)->name() << ',' << t << ',' << reps << ','
+			    << num_terms(result) << ',' << (ok ? 1 : 0) << endl;
+		}
+	}
+
+	for (vector<algorithm *>::iterator a = algorithms.begin(); a != algorithms.end(); ++a)
+		delete *a;
+	return failures;
+}
+
+int main(int argc, char** argv)
+{
+	cout << "timing GCD and factorization corpus..." << flush;
+	const vector<corpus_case> corpus = make_corpus(run_expensive_timings_p() >= 1);
+
+	ostringstream csv;
+	const unsigned failures = run_corpus(corpus, csv);
+	cout << (failures ? "FAILED" : "OK") << endl;
+
+	// Write the CSV to the file given as argument, or to stdout
+	if (argc > 1) {
+		ofstream f(argv[1]);
+		f << csv.str();
+	} else
+		cout << csv.str();
+	return failures ? 1 : 0;
+}
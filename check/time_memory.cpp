@@ -0,0 +1,166 @@
+/** @file time_memory.cpp
+ *
+ *  Measure the memory used by computations which are prone to blow up:
+ *  normal(), series(), expand(), matrix::determinant() and archiving.
+ *  Each test fails if the peak memory of its live expression objects
+ *  exceeds a limit. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "ginac.h"
+#include "timer.h"
+using namespace GiNaC;
+
+#ifdef HAVE_RUSAGE
+#include <sys/resource.h>
+#endif
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+extern void randomify_symbol_serials();
+extern unsigned long get_allocation_count();
+
+/// Sum of rational functions with different denominators
+static bool normal_sum()
+{
+	symbol x("x"), y("y");
+	ex e = 0;
+	for (int i = 1; i <= 12; ++i)
+		e += (pow(x, i) + y) / pow(x + i*y, 2);
+	const ex r = e.normal();
+	return !r.is_zero() && r.subs(lst(x == 1, y == 2)).is_equal(e.subs(lst(x == 1, y == 2)));
+}
+
+/// Series of nested functions to high order
+static bool series_nested()
+{
+	symbol x("x");
+	const ex s = series(exp(sin(tan(x))), x == 0, 30);
+	return s.coeff(x, 1).is_equal(1) && s.coeff(x, 2).is_equal(numeric(1, 2));
+}
+
+/// Expansion of a power of a sum with 5456 terms
+static bool expand_power()
+{
+	symbol x("x"), y("y"), z("z");
+	const ex e = pow(x + y + z + 1, 30).expand();
+	return e.nops() == 5456;
+}
+
+/// Determinant of a 6x6 matrix of symbols (720 terms)
+static bool determinant_symbolic()
+{
+	matrix m(6, 6);
+	for (unsigned r = 0; r < 6; ++r)
+		for (unsigned c = 0; c < 6; ++c) {
+			ostringstream s;
+			s << "a" << r << c;
+			m(r, c) = symbol(s.str());
+		}
+	const ex d = m.determinant();
+	return d.nops() == 720;
+}
+
+/// Archive an expression with 4845 terms to a string and read it back
+static bool archive_roundtrip()
+{
+	symbol a("a"), b("b"), c("c"), d("d");
+	const ex e = pow(a + b + c + d + 1, 16).expand();
+	ostringstream os;
+	os << archive(e, "e");
+	istringstream is(os.str());
+	archive ar;
+	is >> ar;
+	const ex f = ar.unarchive_ex(lst(a, b, c, d), "e");
+	return f.is_equal(e);
+}
+
+/** A test and the limit of the peak memory of the live expression objects
+ *  it creates. The limits leave ample room above the current usage, so
+ *  that only blowups fail. */
+struct memory_test {
+	const char * name;
+	bool (*run)();
+	double limit_mb;
+};
+
+static const memory_test tests[] = {
+	{ "normal_sum", normal_sum, 64 },
+	{ "series_nested", series_nested, 64 },
+	{ "expand_power", expand_power, 64 },
+	{ "determinant", determinant_symbolic, 64 },
+	{ "archive_roundtrip", archive_roundtrip, 128 }
+};
+
+static long max_rss_kb()
+{
+#ifdef HAVE_RUSAGE
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_maxrss;
+#else
+	return 0;
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	cout << "timing memory usage..." << flush;
+	randomify_symbol_serials();
+	set_memory_accounting_enabled(true);
+
+	unsigned failures = 0;
+	ostringstream table;
+	table << "# test  time, s  allocations  peak objects  peak MB  limit MB  max RSS MB" << endl;
+	for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); ++i) {
+		const memory_test & t = tests[i];
+		reset_memory_peaks();
+		const memory_usage before = get_memory_usage();
+		const unsigned long allocs = get_allocation_count();
+		timer clock;
+		clock.start();
+		const bool ok = t.run();
+		const double time = clock.read();
+		const memory_usage after = get_memory_usage();
+
+		const unsigned long objects = after.peak_objects - before.objects;
+		const double mb = (after.peak_bytes - before.bytes) / 1048576.0;
+		if (!ok) {
+			clog << t.name << " gives a wrong result" << endl;
+			++failures;
+		}
+		if (mb > t.limit_mb) {
+			clog << t.name << " uses " << mb << " MB, more than " << t.limit_mb << " MB" << endl;
+			++failures;
+		}
+		table << " " << t.name << '\t' << time << '\t'
+		      << get_allocation_count() - allocs << '\t' << objects << '\t'
+		      << setprecision(3) << mb << '\t' << t.limit_mb << '\t'
+		      << max_rss_kb() / 1024.0 << setprecision(6) << endl;
+	}
+
+	cout << (failures ? "FAILED" : "OK") << endl;
+	cout << table.str();
+	return failures ? 1 : 0;
+}
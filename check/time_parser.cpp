@@ -45,13 +45,20 @@ static string prepare_str(const unsigned n, const char x = 'x')
 	return s.str();
 }
 
-static double benchmark_and_cmp(const string& srep)
+static double benchmark_and_cmp(const string& srep, double& t_buffer)
 {
 	parser the_parser;
 	timer RSD10;
 	RSD10.start();
 	ex e = the_parser(srep);
 	const double t = RSD10.read();
+
+	parser buffer_parser(the_parser.get_syms());
+	RSD10.start();
+	ex f = buffer_parser.parse_buffer(srep.data(), srep.data() + srep.size());
+	t_buffer = RSD10.read();
+	if (!e.is_equal(f))
+		throw logic_error("parse_buffer() disagrees with the stream parser");
 	return t;
 }
 
@@ -65,17 +72,20 @@ int main(int argc, char** argv)
 		n_max = atoi(argv[1]);
 
 	vector<double> times;
+	vector<double> buffer_times;
 	vector<unsigned> ns;
 	for (unsigned n = n_min; n <= n_max; n = n << 1) {
 		string srep = prepare_str(n);
-		const double t = benchmark_and_cmp(srep);
+		double t_buffer;
+		const double t = benchmark_and_cmp(srep, t_buffer);
 		times.push_back(t);
+		buffer_times.push_back(t_buffer);
 		ns.push_back(n);
 	}
 
 	cout << "OK" << endl;
-	cout << "# terms  time, s" << endl;
+	cout << "# terms  time, s  parse_buffer, s" << endl;
 	for (size_t i = 0; i < times.size(); i++)
-		cout << " " << ns[i] << '\t' << times[i] << endl;
+		cout << " " << ns[i] << '\t' << times[i] << '\t' << buffer_times[i] << endl;
 	return 0;
 }
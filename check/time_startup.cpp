@@ -0,0 +1,106 @@
+/** @file time_startup.cpp
+ *
+ *  Time the startup of processes linked with GiNaC, and the first use of
+ *  the tables which are built on demand. Needs a POSIX system. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "ginac.h"
+#include "timer.h"
+using namespace GiNaC;
+
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+using namespace std;
+
+static double wall_time()
+{
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + 1e-6 * tv.tv_usec;
+}
+
+/// Run prog with the argument arg n times, return the mean wall time
+static double time_runs(const char* prog, const char* arg, unsigned n)
+{
+	const double start = wall_time();
+	for (unsigned i = 0; i < n; ++i) {
+		const pid_t pid = fork();
+		if (pid < 0)
+			throw runtime_error("fork failed");
+		if (pid == 0) {
+			execl(prog, prog, arg, (char *)0);
+			_exit(127);
+		}
+		int status;
+		if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			throw runtime_error(string("running ") + prog + " failed");
+	}
+	return (wall_time() - start) / n;
+}
+
+/// Time of the first unarchiving and of the first LaTeX output, which
+/// build the unarchiver map and the print method tables
+static double time_first_use()
+{
+	symbol x("x");
+	ostringstream os;
+	os << archive(sin(x) + pow(x, 2)/3);
+
+	timer t;
+	t.start();
+	istringstream is(os.str());
+	archive a;
+	is >> a;
+	ex e = a.unarchive_ex(lst(x));
+	ostringstream out;
+	out << latex << e;
+	return t.read();
+}
+
+int main(int argc, char** argv)
+{
+	// The child processes only initialize the library and exit
+	if (argc > 1 && strcmp(argv[1], "--child") == 0)
+		return 0;
+
+	cout << "timing startup of GiNaC..." << flush;
+	unsigned n = 200;
+	if (argc > 1)
+		n = atoi(argv[1]);
+
+	const double t_true = time_runs("/bin/true", "", n);
+	const double t_ginac = time_runs(argv[0], "--child", n);
+	const double t_first = time_first_use();
+
+	cout << "OK" << endl;
+	cout << "# processes  /bin/true, s  GiNaC, s  difference, s  first use, s" << endl;
+	cout << " " << n << '\t' << t_true << '\t' << t_ginac << '\t'
+	     << t_ginac - t_true << '\t' << t_first << endl;
+	return 0;
+}
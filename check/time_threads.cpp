@@ -0,0 +1,185 @@
+/** @file time_threads.cpp
+ *
+ *  Run independent computations like those of the other timings on several
+ *  threads at once, check that every thread gets the right results, and
+ *  report how well the wall time scales. Needs a library built with
+ *  GINAC_THREAD_SAFE_REFCOUNT; otherwise only the single-threaded times
+ *  are measured. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "ginac.h"
+using namespace GiNaC;
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+#include <thread>
+#endif
+using namespace std;
+
+extern void randomify_symbol_serials();
+
+// The workloads return a number computed from their result, so that the
+// results of different threads (with different symbols) can be compared.
+
+static numeric work_expand()
+{
+	symbol x("x"), y("y"), z("z");
+	const ex e = pow(x + 2*y + 3*z + 1, 12).expand() * (x - y);
+	return ex_to<numeric>(e.expand().subs(lst(x == 3, y == 2, z == -1)));
+}
+
+static numeric work_gcd()
+{
+	symbol x("x"), y("y");
+	const ex a = (pow(x + y, 6) * pow(x - 2*y, 3)).expand();
+	const ex b = (pow(x + y, 4) * pow(x + 3*y, 2) * (x - 2*y)).expand();
+	return ex_to<numeric>(gcd(a, b).subs(lst(x == 5, y == 1)));
+}
+
+static numeric work_normal()
+{
+	symbol x("x");
+	ex e = 0;
+	for (int i = 1; i <= 10; ++i)
+		e += 1 / (x + i) - i / pow(x - i, 2);
+	return ex_to<numeric>(e.normal().subs(x == numeric(1, 3)));
+}
+
+static numeric work_series()
+{
+	symbol x("x");
+	const ex s = series(tgamma(x) * exp(sin(x)), x == 0, 10);
+	return ex_to<numeric>(s.coeff(x, 1).evalf());
+}
+
+/// Uses Digits, which is per thread
+static numeric work_evalf()
+{
+	Digits = 60;
+	const numeric v = ex_to<numeric>((zeta(3) + exp(numeric(1, 7)) * Pi).evalf());
+	Digits = 17;
+	return v;
+}
+
+/// Uses the tables of the multiple polylogarithms, which are per thread
+static numeric work_nstdsums()
+{
+	Digits = 30;
+	const numeric v = ex_to<numeric>((Li(2, numeric(1, 3)) + S(2, 2, numeric(2, 5))
+	                                  + H(lst(2, 1), numeric(1, 4))).evalf());
+	Digits = 17;
+	return v;
+}
+
+struct workload {
+	const char * name;
+	numeric (*run)();
+	unsigned reps;
+};
+
+static const workload workloads[] = {
+	{ "expand", work_expand, 4 },
+	{ "gcd", work_gcd, 20 },
+	{ "normal", work_normal, 4 },
+	{ "series", work_series, 4 },
+	{ "evalf", work_evalf, 20 },
+	{ "nstdsums", work_nstdsums, 4 }
+};
+
+static double wall_time()
+{
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// Run w reps times, count the results which differ from reference
+static void run_workload(const workload * w, const numeric * reference, unsigned * wrong)
+{
+	for (unsigned i = 0; i < w->reps; ++i) {
+		if (!w->run().is_equal(*reference))
+			++*wrong;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	cout << "timing concurrent computations..." << flush;
+	randomify_symbol_serials();
+
+	unsigned nthreads = 1;
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	nthreads = thread::hardware_concurrency();
+	if (nthreads > 8)
+		nthreads = 8;
+	if (nthreads < 2)
+		nthreads = 2;
+	if (argc > 1)
+		nthreads = max(1, atoi(argv[1]));
+#endif
+
+	unsigned failures = 0;
+	ostringstream table;
+	table << "# workload  threads  1 thread, s  " << nthreads << " threads, s  efficiency" << endl;
+	for (size_t k = 0; k < sizeof(workloads) / sizeof(workloads[0]); ++k) {
+		const workload & w = workloads[k];
+		const numeric reference = w.run();
+
+		unsigned wrong = 0;
+		double start = wall_time();
+		run_workload(&w, &reference, &wrong);
+		const double t1 = wall_time() - start;
+
+		// Every thread does as much work as the single thread, so the
+		// wall time stays the same if the computation scales perfectly
+		double tn = t1;
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+		if (nthreads > 1) {
+			vector<unsigned> wrongs(nthreads, 0);
+			vector<thread> threads;
+			start = wall_time();
+			for (unsigned t = 0; t < nthreads; ++t)
+				threads.push_back(thread(run_workload, &w, &reference, &wrongs[t]));
+			for (unsigned t = 0; t < nthreads; ++t)
+				threads[t].join();
+			tn = wall_time() - start;
+			for (unsigned t = 0; t < nthreads; ++t)
+				wrong += wrongs[t];
+		}
+#endif
+		if (wrong) {
+			clog << w.name << ": " << wrong << " wrong results" << endl;
+			++failures;
+		}
+		table << " " << w.name << '\t' << nthreads << '\t' << t1 << '\t' << tn << '\t'
+		      << (tn > 0 ? t1 / tn : 1) << endl;
+	}
+
+	cout << (failures ? "FAILED" : "OK") << endl;
+#ifndef GINAC_THREAD_SAFE_REFCOUNT
+	cout << "# built without GINAC_THREAD_SAFE_REFCOUNT, ran on one thread only" << endl;
+#endif
+	cout << table.str();
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,186 @@
+/** @file ac_match.cpp
+ *
+ *  Matching the operands of commutative operations. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "ac_match.h"
+#include "wildcard.h"
+
+#include <algorithm>
+#include <map>
+#include <typeindex>
+#include <typeinfo>
+
+namespace GiNaC {
+
+namespace {
+
+void collect_wildcards(const ex & e, exvector & v)
+{
+	if (is_exactly_a<wildcard>(e)) {
+		for (exvector::const_iterator i = v.begin(); i != v.end(); ++i) {
+			if (i->is_equal(e))
+				return;
+		}
+		v.push_back(e);
+		return;
+	}
+	for (size_t i = 0; i < e.nops(); ++i)
+		collect_wildcards(e.op(i), v);
+}
+
+/** Search order of a pattern operand: without wildcards first, plain
+ *  wildcards last, and otherwise by the number of candidates. */
+struct search_rank {
+	int kind;
+	size_t num_candidates;
+	size_t index;
+	bool operator<(const search_rank & other) const
+	{
+		if (kind != other.kind)
+			return kind < other.kind;
+		if (num_candidates != other.num_candidates)
+			return num_candidates < other.num_candidates;
+		return index < other.index;
+	}
+};
+
+} // anonymous namespace
+
+ac_matcher::ac_matcher(const exvector & s, const exvector & p, bool all)
+ : subject(s), pattern(p), use_all(all)
+{
+}
+
+bool ac_matcher::match_operand(const ex & s, const ex & p, exmap & repls)
+{
+	return s.match(p, repls);
+}
+
+bool ac_matcher::run(exmap & repls)
+{
+	const size_t n = pattern.size(), m = subject.size();
+	if (n > m || (use_all && n != m))
+		return false;
+
+	in_use.assign(m, false);
+	assignment.assign(n, size_t(-1));
+	undo_log.clear();
+	candidates.assign(n, std::vector<size_t>());
+	wildcards.assign(n, exvector());
+
+	exvector subject_keys;
+	subject_keys.reserve(m);
+	std::map<std::type_index, size_t> subject_classes, pattern_classes;
+	for (size_t i = 0; i < m; ++i) {
+		subject_keys.push_back(key(subject[i]));
+		++subject_classes[typeid(ex_to<basic>(subject_keys.back()))];
+	}
+
+	std::vector<search_rank> ranks(n);
+	for (size_t k = 0; k < n; ++k) {
+		collect_wildcards(pattern[k], wildcards[k]);
+		const ex pk = key(pattern[k]);
+		search_rank & r = ranks[k];
+		r.index = k;
+		if (is_exactly_a<wildcard>(pk)) {
+			for (size_t i = 0; i < m; ++i)
+				candidates[k].push_back(i);
+			r.kind = 2;
+		} else {
+			const std::type_info & t = typeid(ex_to<basic>(pk));
+			const bool ground = !haswild(pk);
+			for (size_t i = 0; i < m; ++i) {
+				const ex & si = subject_keys[i];
+				if (typeid(ex_to<basic>(si)) == t && (!ground || si.gethash() == pk.gethash()))
+					candidates[k].push_back(i);
+			}
+			if (candidates[k].empty())
+				return false;
+			if (++pattern_classes[t] > subject_classes[t])
+				return false;
+			r.kind = ground ? 0 : 1;
+		}
+		r.num_candidates = candidates[k].size();
+	}
+
+	std::sort(ranks.begin(), ranks.end());
+	order.clear();
+	for (size_t k = 0; k < n; ++k)
+		order.push_back(ranks[k].index);
+
+	return search(0, repls);
+}
+
+bool ac_matcher::search(size_t level, exmap & repls)
+{
+	if (level == order.size())
+		return accept(repls);
+
+	const size_t k = order[level];
+	const ex & p = pattern[k];
+	const exvector & w = wildcards[k];
+	std::vector<size_t> tried;
+	std::vector<bool> unbound(w.size());
+
+	for (std::vector<size_t>::const_iterator c = candidates[k].begin(); c != candidates[k].end(); ++c) {
+		const size_t i = *c;
+		if (in_use[i])
+			continue;
+
+		// Equal operands lead to the same result
+		bool seen = false;
+		for (std::vector<size_t>::const_iterator t = tried.begin(); t != tried.end(); ++t) {
+			if (subject[*t].is_equal(subject[i])) {
+				seen = true;
+				break;
+			}
+		}
+		if (seen)
+			continue;
+		tried.push_back(i);
+
+		for (size_t j = 0; j < w.size(); ++j)
+			unbound[j] = repls.find(w[j]) == repls.end();
+		if (!match_operand(subject[i], p, repls))
+			continue;
+
+		const size_t mark = undo_log.size();
+		for (size_t j = 0; j < w.size(); ++j) {
+			if (unbound[j] && repls.find(w[j]) != repls.end())
+				undo_log.push_back(w[j]);
+		}
+		in_use[i] = true;
+		assignment[k] = i;
+		if (search(level + 1, repls))
+			return true;
+
+		// Take back the bindings of this choice
+		in_use[i] = false;
+		assignment[k] = size_t(-1);
+		while (undo_log.size() > mark) {
+			repls.erase(undo_log.back());
+			undo_log.pop_back();
+		}
+	}
+	return false;
+}
+
+} // namespace GiNaC
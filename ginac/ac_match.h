@@ -0,0 +1,93 @@
+/** @file ac_match.h
+ *
+ *  Interface to matching the operands of commutative operations. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_AC_MATCH_H
+#define GINAC_AC_MATCH_H
+
+#include "ex.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace GiNaC {
+
+/** Matching of the operands of a commutative operation (the terms of a sum
+ *  or the factors of a product) against the operands of a pattern, each
+ *  pattern operand against a different operand.
+ *
+ *  The search tries the most constrained pattern operands first: the ones
+ *  without wildcards, then the others by their number of candidates, and
+ *  plain wildcards last. The candidates of a pattern operand are the
+ *  operands whose key (see key()) has the same class, or the same value
+ *  if the key of the pattern operand has no wildcards. If a pattern operand
+ *  has no candidate, or there are more pattern operands of some class than
+ *  operands, the match fails at once. Among equal operands only one is
+ *  tried. Bindings of wildcards are added to the map of replacements in
+ *  place and taken back from an undo log when the search backtracks. */
+class ac_matcher {
+public:
+	/** Operands and pattern operands to match. If use_all is set, every
+	 *  operand must be matched. */
+	ac_matcher(const exvector & subject, const exvector & pattern, bool use_all);
+	virtual ~ac_matcher() {}
+
+	/** Look for a match which is consistent with the bindings in repls.
+	 *  On success, the new bindings are left in repls; otherwise repls is
+	 *  unchanged. */
+	bool run(exmap & repls);
+
+	/** After a successful run(): the operand matched by pattern operand k. */
+	size_t matched_operand(size_t k) const { return assignment[k]; }
+	/** After a successful run(): whether operand i has been matched. */
+	bool used(size_t i) const { return in_use[i]; }
+
+protected:
+	/** Match operand s against pattern operand p, adding bindings to repls
+	 *  on success and leaving it unchanged otherwise. */
+	virtual bool match_operand(const ex & s, const ex & p, exmap & repls);
+
+	/** The part of an operand or pattern operand which decides whether they
+	 *  can match. */
+	virtual ex key(const ex & e) const { return e; }
+
+	/** Called when all pattern operands are matched, to accept the match
+	 *  (possibly adding bindings) or to go on searching. */
+	virtual bool accept(exmap & repls) { return true; }
+
+	const exvector & subject;
+	const exvector & pattern;
+
+private:
+	bool search(size_t level, exmap & repls);
+
+	bool use_all;
+	std::vector<size_t> order;           ///< pattern operands in search order
+	std::vector<std::vector<size_t> > candidates;
+	std::vector<exvector> wildcards;     ///< wildcards of each pattern operand
+	std::vector<size_t> assignment;
+	std::vector<bool> in_use;
+	exvector undo_log;                   ///< wildcards bound by the search
+};
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_AC_MATCH_H
@@ -62,6 +62,7 @@ add::add(const ex & lh, const ex & rh)
 {
 	overall_coeff = _ex0;
 	construct_from_2_ex(lh,rh);
+	internal::count_event(*this, internal::stat_construction);
 	GINAC_ASSERT(is_canonical());
 }
 
@@ -69,6 +70,7 @@ add::add(const exvector & v)
 {
 	overall_coeff = _ex0;
 	construct_from_exvector(v);
+	internal::count_event(*this, internal::stat_construction);
 	GINAC_ASSERT(is_canonical());
 }
 
@@ -76,6 +78,7 @@ add::add(const epvector & v)
 {
 	overall_coeff = _ex0;
 	construct_from_epvector(v);
+	internal::count_event(*this, internal::stat_construction);
 	GINAC_ASSERT(is_canonical());
 }
 
@@ -83,6 +86,23 @@ add::add(const epvector & v, const ex & oc)
 {
 	overall_coeff = oc;
 	construct_from_epvector(v);
+	internal::count_event(*this, internal::stat_construction);
+	GINAC_ASSERT(is_canonical());
+}
+
+add::add(epvector && v)
+{
+	overall_coeff = _ex0;
+	construct_from_epvector(std::move(v));
+	internal::count_event(*this, internal::stat_construction);
+	GINAC_ASSERT(is_canonical());
+}
+
+add::add(epvector && v, const ex & oc)
+{
+	overall_coeff = oc;
+	construct_from_epvector(std::move(v));
+	internal::count_event(*this, internal::stat_construction);
 	GINAC_ASSERT(is_canonical());
 }
 
@@ -90,7 +110,18 @@ add::add(std::shared_ptr<epvector> vp, const ex & oc)
 {
 	GINAC_ASSERT(vp.get()!=0);
 	overall_coeff = oc;
-	construct_from_epvector(*vp);
+	construct_from_epvector(std::move(*vp));
+	internal::count_event(*this, internal::stat_construction);
+	GINAC_ASSERT(is_canonical());
+}
+
+/** Construct from a canonical sequence of terms, which is taken over as it
+ *  is. */
+add::add(std::shared_ptr<epvector> vp, const ex & oc, canonical_seq_t)
+{
+	overall_coeff = oc;
+	construct_from_canonical_epvector(vp);
+	internal::count_event(*this, internal::stat_construction);
 	GINAC_ASSERT(is_canonical());
 }
 
@@ -272,6 +303,8 @@ bool add::is_polynomial(const ex & var) const
 
 int add::degree(const ex & s) const
 {
+	if (!may_contain(s))
+		return 0;
 	int deg = std::numeric_limits<int>::min();
 	if (!overall_coeff.is_zero())
 		deg = 0;
@@ -289,6 +322,8 @@ int add::degree(const ex & s) const
 
 int add::ldegree(const ex & s) const
 {
+	if (!may_contain(s))
+		return 0;
 	int deg = std::numeric_limits<int>::max();
 	if (!overall_coeff.is_zero())
 		deg = 0;
@@ -306,8 +341,10 @@ int add::ldegree(const ex & s) const
 
 ex add::coeff(const ex & s, int n) const
 {
-	std::shared_ptr<epvector> coeffseq(new epvector);
-	std::shared_ptr<epvector> coeffseq_cliff(new epvector);
+	if (!may_contain(s))
+		return n==0 ? ex(*this) : _ex0;
+	std::shared_ptr<epvector> coeffseq = std::make_shared<epvector>();
+	std::shared_ptr<epvector> coeffseq_cliff = std::make_shared<epvector>();
 	int rl = clifford_max_label(s);
 	bool do_clifford = (rl != -1);
 	bool nonscalar = false;
@@ -334,6 +371,38 @@ ex add::coeff(const ex & s, int n) const
 	                n==0 ? overall_coeff : _ex0))->setflag(status_flags::dynallocated);
 }
 
+void add::coeffs(const ex & s, std::map<int, ex> & c) const
+{
+	if (!may_contain(s)) {
+		c.insert(std::make_pair(0, ex(*this)));
+		return;
+	}
+	// Leave the Clifford units to coeff()
+	if (clifford_max_label(s) != -1) {
+		basic::coeffs(s, c);
+		return;
+	}
+
+	// Sort the coefficients of the terms by degree
+	std::map<int, epvector> terms;
+	epvector::const_iterator i = seq.begin(), end = seq.end();
+	while (i != end) {
+		std::map<int, ex> restcoeffs;
+		ex_to<basic>(i->rest).coeffs(s, restcoeffs);
+		for (std::map<int, ex>::const_iterator r=restcoeffs.begin(); r!=restcoeffs.end(); ++r)
+			terms[r->first].push_back(combine_ex_with_coeff_to_pair(r->second, i->coeff));
+		++i;
+	}
+
+	for (std::map<int, epvector>::iterator t=terms.begin(); t!=terms.end(); ++t) {
+		ex cn = (new add(std::move(t->second), t->first==0 ? overall_coeff : _ex0))->setflag(status_flags::dynallocated);
+		if (!cn.is_zero())
+			c.insert(std::make_pair(t->first, cn));
+	}
+	if (!overall_coeff.is_zero() && terms.find(0) == terms.end())
+		c.insert(std::make_pair(0, overall_coeff));
+}
+
 /** Perform automatic term rewriting rules in this class.  In the following
  *  x stands for a symbolic variables of type ex and c stands for such
  *  an expression that contain a plain number.
@@ -386,7 +455,7 @@ ex add::eval(int level) const
 		++j;
 	}
 	if (terms_to_collect) {
-		std::shared_ptr<epvector> s(new epvector);
+		std::shared_ptr<epvector> s = std::make_shared<epvector>();
 		s->reserve(seq_size - terms_to_collect);
 		numeric oc = *_num1_p;
 		j = seq.begin();
@@ -397,7 +466,8 @@ ex add::eval(int level) const
 				s->push_back(*j);
 			++j;
 		}
-		return (new add(s, ex_to<numeric>(overall_coeff).add_dyn(oc)))
+		// leaving out terms keeps the sequence canonical
+		return (new add(s, ex_to<numeric>(overall_coeff).add_dyn(oc), canonical_seq))
 		        ->setflag(status_flags::dynallocated);
 	}
 	
@@ -407,33 +477,50 @@ ex add::eval(int level) const
 ex add::evalm() const
 {
 	// Evaluate children first and add up all matrices. Stop if there's one
-	// term that is not a matrix.
-	std::shared_ptr<epvector> s(new epvector);
-	s->reserve(seq.size());
-
+	// term that is not a matrix. The matrices are not added up pairwise:
+	// the terms of each entry, multiplied by the coefficients, are
+	// collected in one pass and summed up at the end.
+	exvector rests;
+	rests.reserve(seq.size());
 	bool all_matrices = true;
-	bool first_term = true;
-	matrix sum;
-
 	epvector::const_iterator it = seq.begin(), itend = seq.end();
 	while (it != itend) {
-		const ex &m = recombine_pair_to_ex(*it).evalm();
-		s->push_back(split_ex_to_pair(m));
-		if (is_a<matrix>(m)) {
-			if (first_term) {
-				sum = ex_to<matrix>(m);
-				first_term = false;
-			} else
-				sum = sum.add(ex_to<matrix>(m));
-		} else
+		rests.push_back(it->rest.evalm());
+		if (!is_a<matrix>(rests.back()))
 			all_matrices = false;
 		++it;
 	}
 
-	if (all_matrices)
-		return sum + overall_coeff;
-	else
-		return (new add(s, overall_coeff))->setflag(status_flags::dynallocated);
+	if (all_matrices && !rests.empty()) {
+		const matrix & first = ex_to<matrix>(rests[0]);
+		const unsigned rows = first.rows(), cols = first.cols();
+		std::vector<exvector> entries(rows * cols);
+		for (size_t i=0; i<entries.size(); ++i)
+			entries[i].reserve(seq.size());
+		for (size_t k=0; k<seq.size(); ++k) {
+			const matrix & m = ex_to<matrix>(rests[k]);
+			if (m.rows() != rows || m.cols() != cols)
+				throw std::logic_error("matrix::add(): incompatible matrices");
+			const ex & c = seq[k].coeff;
+			const bool unit = c.is_equal(_ex1);
+			for (size_t i=0; i<entries.size(); ++i)
+				entries[i].push_back(unit ? m(i / cols, i % cols) : m(i / cols, i % cols) * c);
+		}
+		exvector sum(entries.size());
+		for (size_t i=0; i<entries.size(); ++i)
+			sum[i] = (new add(entries[i]))->setflag(status_flags::dynallocated);
+		return matrix(rows, cols, std::move(sum)) + overall_coeff;
+	}
+
+	std::shared_ptr<epvector> s = std::make_shared<epvector>();
+	s->reserve(seq.size());
+	for (size_t k=0; k<seq.size(); ++k) {
+		if (is_a<matrix>(rests[k]) && !seq[k].coeff.is_equal(_ex1))
+			s->push_back(split_ex_to_pair(ex_to<matrix>(rests[k]).mul(ex_to<numeric>(seq[k].coeff))));
+		else
+			s->push_back(combine_ex_with_coeff_to_pair(rests[k], seq[k].coeff));
+	}
+	return (new add(s, overall_coeff))->setflag(status_flags::dynallocated);
 }
 
 ex add::conjugate() const
@@ -466,17 +553,24 @@ ex add::real_part() const
 {
 	epvector v;
 	v.reserve(seq.size());
+	bool unchanged = overall_coeff.info(info_flags::real);
 	for (epvector::const_iterator i=seq.begin(); i!=seq.end(); ++i)
 		if ((i->coeff).info(info_flags::real)) {
 			ex rp = (i->rest).real_part();
+			if (!are_ex_trivially_equal(rp, i->rest))
+				unchanged = false;
 			if (!rp.is_zero())
 				v.push_back(expair(rp, i->coeff));
 		} else {
+			unchanged = false;
 			ex rp=recombine_pair_to_ex(*i).real_part();
 			if (!rp.is_zero())
 				v.push_back(split_ex_to_pair(rp));
 		}
-	return (new add(v, overall_coeff.real_part()))
+	// A real sum is its own real part, don't rebuild it
+	if (unchanged)
+		return *this;
+	return (new add(std::move(v), overall_coeff.real_part()))
 		-> setflag(status_flags::dynallocated);
 }
 
@@ -494,7 +588,9 @@ ex add::imag_part() const
 			if (!ip.is_zero())
 				v.push_back(split_ex_to_pair(ip));
 		}
-	return (new add(v, overall_coeff.imag_part()))
+	if (v.empty())
+		return overall_coeff.imag_part();
+	return (new add(std::move(v), overall_coeff.imag_part()))
 		-> setflag(status_flags::dynallocated);
 }
 
@@ -512,7 +608,7 @@ ex add::eval_ncmul(const exvector & v) const
  *  @see ex::diff */
 ex add::derivative(const symbol & y) const
 {
-	std::shared_ptr<epvector> s(new epvector);
+	std::shared_ptr<epvector> s = std::make_shared<epvector>();
 	s->reserve(seq.size());
 	
 	// Only differentiate the "rest" parts of the expairs. This is faster
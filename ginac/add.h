@@ -41,7 +41,10 @@ public:
 	add(const exvector & v);
 	add(const epvector & v);
 	add(const epvector & v, const ex & oc);
+	add(epvector && v);
+	add(epvector && v, const ex & oc);
 	add(std::shared_ptr<epvector> vp, const ex & oc);
+	add(std::shared_ptr<epvector> vp, const ex & oc, canonical_seq_t);
 	
 	// functions overriding virtual functions from base classes
 public:
@@ -51,6 +54,7 @@ public:
 	int degree(const ex & s) const;
 	int ldegree(const ex & s) const;
 	ex coeff(const ex & s, int n=1) const;
+	void coeffs(const ex & s, std::map<int, ex> & c) const;
 	ex eval(int level=0) const;
 	ex evalm() const;
 	ex series(const relational & r, int order, unsigned options = 0) const;
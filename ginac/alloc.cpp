@@ -0,0 +1,462 @@
+/** @file alloc.cpp
+ *
+ *  Implementation of the memory allocator for GiNaC's expression objects. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "alloc.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+#include <atomic>
+#include <mutex>
+#endif
+
+#include <cln/malloc.h>
+
+// Define GINAC_DISABLE_BASIC_POOL to allocate all expression objects with
+// the global operator new, e.g. when hunting memory errors with valgrind.
+
+namespace GiNaC {
+
+namespace {
+
+/** Bytes and number of objects requested from basic_alloc() by this
+ *  thread. */
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+thread_local unsigned long long allocated_bytes = 0;
+thread_local unsigned long long allocated_objects = 0;
+#else
+unsigned long long allocated_bytes = 0;
+unsigned long long allocated_objects = 0;
+#endif
+
+} // anonymous namespace
+
+unsigned long long basic_alloc_bytes()
+{
+	return allocated_bytes;
+}
+
+unsigned long long basic_alloc_count()
+{
+	return allocated_objects;
+}
+
+#ifndef GINAC_DISABLE_BASIC_POOL
+
+namespace {
+
+/** Object sizes are rounded up to multiples of this. */
+const std::size_t granule = 16;
+
+/** Number of size classes; larger objects go to the global operator new. */
+const std::size_t num_classes = 16;
+
+const std::size_t max_pooled_size = granule * num_classes;
+
+/** Pools get their memory in chunks of this size. Chunks are aligned to
+ *  their size, so the header of the chunk an object lives in can be found
+ *  from the address of the object. */
+const std::size_t chunk_size = 64 * 1024;
+
+/** Number of chunks which are obtained from malloc() at once. */
+const std::size_t chunks_per_block = 16;
+
+struct free_block {
+	free_block * next;
+};
+
+struct chunk_header {
+	memory_pool * pool;    ///< pool the chunk belongs to
+	std::size_t live;      ///< number of allocated objects in the chunk
+	chunk_header * next;   ///< link in the cache of unused chunks
+};
+
+const std::size_t header_size = (sizeof(chunk_header) + granule - 1) / granule * granule;
+
+inline chunk_header * chunk_of(void * p)
+{
+	return reinterpret_cast<chunk_header *>(reinterpret_cast<std::size_t>(p) & ~(chunk_size - 1));
+}
+
+inline std::size_t size_class(std::size_t size)
+{
+	return (size - 1) / granule;
+}
+
+const std::size_t block_size = chunk_size * (chunks_per_block + 1);
+
+/** Unused chunks, shared by all pools. Memory is never given back to the
+ *  system, but chunks released by one pool are reused by the others. */
+chunk_header * chunk_cache = 0;
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+std::mutex chunk_cache_mutex;
+#endif
+
+/** Sorted start addresses of the blocks the chunks were cut from, for
+ *  telling the memory of the pools from the memory CLN got from malloc().
+ *  When a block is added, the list is replaced by a longer copy, so it
+ *  can be read without locking. The old lists are kept, like the blocks. */
+struct block_list {
+	std::vector<std::size_t> starts;
+	const block_list * previous;
+};
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+std::atomic<const block_list *> blocks(0);
+#else
+const block_list * blocks = 0;
+#endif
+
+/** Called with chunk_cache_mutex held. */
+void add_block(const char * raw)
+{
+	const block_list * old = blocks;
+	block_list * b = new block_list;
+	if (old)
+		b->starts = old->starts;
+	b->previous = old;
+	const std::size_t start = reinterpret_cast<std::size_t>(raw);
+	b->starts.insert(std::upper_bound(b->starts.begin(), b->starts.end(), start), start);
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	blocks.store(b, std::memory_order_release);
+#else
+	blocks = b;
+#endif
+}
+
+bool in_pool_memory(const void * p)
+{
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	const block_list * b = blocks.load(std::memory_order_acquire);
+#else
+	const block_list * b = blocks;
+#endif
+	if (!b)
+		return false;
+	const std::size_t a = reinterpret_cast<std::size_t>(p);
+	std::vector<std::size_t>::const_iterator i = std::upper_bound(b->starts.begin(), b->starts.end(), a);
+	return i != b->starts.begin() && a - *(i - 1) < block_size;
+}
+
+chunk_header * get_chunk()
+{
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	std::lock_guard<std::mutex> lock(chunk_cache_mutex);
+#endif
+	if (!chunk_cache) {
+		char * raw = static_cast<char *>(std::malloc(block_size));
+		if (!raw)
+			throw std::bad_alloc();
+		add_block(raw);
+		std::size_t offset = chunk_size - (reinterpret_cast<std::size_t>(raw) & (chunk_size - 1));
+		for (std::size_t i = 0; i < chunks_per_block; ++i) {
+			chunk_header * c = reinterpret_cast<chunk_header *>(raw + offset + i * chunk_size);
+			c->next = chunk_cache;
+			chunk_cache = c;
+		}
+	}
+	chunk_header * c = chunk_cache;
+	chunk_cache = c->next;
+	return c;
+}
+
+void put_chunk(chunk_header * c)
+{
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	std::lock_guard<std::mutex> lock(chunk_cache_mutex);
+#endif
+	c->next = chunk_cache;
+	chunk_cache = c;
+}
+
+} // anonymous namespace
+
+/** Free lists and chunks for the objects of all size classes. A pool is
+ *  either the default pool of a thread or the pool of a basic_arena. Once
+ *  it is closed (when the thread ends or the arena is left), it hands back
+ *  its chunks as they become empty and deletes itself together with the
+ *  last one. */
+class memory_pool {
+public:
+	memory_pool() : nchunks(0), closed(false)
+	{
+		for (std::size_t i = 0; i < num_classes; ++i) {
+			free_list[i] = 0;
+			bump[i] = bump_end[i] = 0;
+		}
+	}
+
+	void * allocate(std::size_t cls);
+	void release(void * p, std::size_t cls);
+	void close();
+
+private:
+	free_block * free_list[num_classes];
+	char * bump[num_classes];      ///< next never used object in the current chunk
+	char * bump_end[num_classes];  ///< end of the current chunk
+	std::vector<chunk_header *> chunks;
+	std::size_t nchunks;           ///< chunks not yet handed back (after close())
+	bool closed;
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	std::mutex mtx;
+#endif
+};
+
+void * memory_pool::allocate(std::size_t cls)
+{
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	std::lock_guard<std::mutex> lock(mtx);
+#endif
+	void * p;
+	if (free_list[cls]) {
+		p = free_list[cls];
+		free_list[cls] = free_list[cls]->next;
+	} else {
+		const std::size_t size = (cls + 1) * granule;
+		if (bump[cls] == bump_end[cls]) {
+			chunk_header * c = get_chunk();
+			c->pool = this;
+			c->live = 0;
+			chunks.push_back(c);
+			bump[cls] = reinterpret_cast<char *>(c) + header_size;
+			bump_end[cls] = bump[cls] + (chunk_size - header_size) / size * size;
+		}
+		p = bump[cls];
+		bump[cls] += size;
+	}
+	++chunk_of(p)->live;
+	return p;
+}
+
+void memory_pool::release(void * p, std::size_t cls)
+{
+	bool last = false;
+	{
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+		std::lock_guard<std::mutex> lock(mtx);
+#endif
+		chunk_header * c = chunk_of(p);
+		--c->live;
+		if (!closed) {
+			free_block * b = static_cast<free_block *>(p);
+			b->next = free_list[cls];
+			free_list[cls] = b;
+		} else if (c->live == 0) {
+			put_chunk(c);
+			last = (--nchunks == 0);
+		}
+	}
+	if (last)
+		delete this;
+}
+
+void memory_pool::close()
+{
+	bool empty;
+	{
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+		std::lock_guard<std::mutex> lock(mtx);
+#endif
+		closed = true;
+		for (std::vector<chunk_header *>::iterator i = chunks.begin(); i != chunks.end(); ++i) {
+			if ((*i)->live == 0)
+				put_chunk(*i);
+			else
+				++nchunks;
+		}
+		chunks.clear();
+		empty = (nchunks == 0);
+	}
+	if (empty)
+		delete this;
+}
+
+namespace {
+
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+
+thread_local memory_pool * current_arena = 0;
+thread_local memory_pool * default_pool = 0;
+thread_local unsigned numeric_scopes = 0;
+thread_local bool thread_finished = false;
+
+/** Closes the default pool of a thread when the thread ends. */
+struct default_pool_closer {
+	void arm() { }
+	~default_pool_closer()
+	{
+		thread_finished = true;
+		if (default_pool)
+			default_pool->close();
+		default_pool = 0;
+	}
+};
+
+thread_local default_pool_closer closer;
+
+inline memory_pool * current_pool()
+{
+	if (current_arena)
+		return current_arena;
+	if (!default_pool) {
+		default_pool = new memory_pool;
+		// Objects created during the destruction of other thread-local
+		// or static objects may create a new default pool, which is
+		// then simply kept.
+		if (!thread_finished)
+			closer.arm();
+	}
+	return default_pool;
+}
+
+#else
+
+memory_pool * current_arena = 0;
+memory_pool * default_pool = 0;
+unsigned numeric_scopes = 0;
+
+inline memory_pool * current_pool()
+{
+	if (current_arena)
+		return current_arena;
+	if (!default_pool)
+		default_pool = new memory_pool;
+	return default_pool;
+}
+
+#endif // def GINAC_THREAD_SAFE_REFCOUNT
+
+/** Pooled memory handed to CLN starts with the size class, since CLN
+ *  doesn't tell the size when freeing. */
+const std::size_t cln_header = granule;
+
+void * cln_malloc(std::size_t size)
+{
+	if (numeric_scopes && size <= max_pooled_size - cln_header) {
+		const std::size_t cls = size_class(size + cln_header);
+		char * p = static_cast<char *>(current_pool()->allocate(cls));
+		*reinterpret_cast<std::size_t *>(p) = cls;
+		return p + cln_header;
+	}
+	void * p = std::malloc(size);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void cln_free(void * p)
+{
+	// Memory CLN allocated before the hooks were installed, or outside of
+	// a numeric_alloc_scope, came from malloc()
+	if (!in_pool_memory(p)) {
+		std::free(p);
+		return;
+	}
+	char * q = static_cast<char *>(p) - cln_header;
+	chunk_of(q)->pool->release(q, *reinterpret_cast<std::size_t *>(q));
+}
+
+struct cln_hooks_installer {
+	cln_hooks_installer()
+	{
+		cln::malloc_hook = cln_malloc;
+		cln::free_hook = cln_free;
+	}
+} install_cln_hooks;
+
+} // anonymous namespace
+
+void * basic_alloc(std::size_t size)
+{
+	allocated_bytes += size;
+	++allocated_objects;
+	if (size > max_pooled_size)
+		return ::operator new(size);
+	return current_pool()->allocate(size_class(size));
+}
+
+void basic_free(void * p, std::size_t size)
+{
+	if (!p)
+		return;
+	if (size > max_pooled_size) {
+		::operator delete(p);
+		return;
+	}
+	chunk_of(p)->pool->release(p, size_class(size));
+}
+
+basic_arena::basic_arena() : pool(new memory_pool), outer(current_arena)
+{
+	current_arena = pool;
+}
+
+basic_arena::~basic_arena()
+{
+	current_arena = outer;
+	pool->close();
+}
+
+numeric_alloc_scope::numeric_alloc_scope()
+{
+	++numeric_scopes;
+}
+
+numeric_alloc_scope::~numeric_alloc_scope()
+{
+	--numeric_scopes;
+}
+
+#else // def GINAC_DISABLE_BASIC_POOL
+
+void * basic_alloc(std::size_t size)
+{
+	allocated_bytes += size;
+	++allocated_objects;
+	return ::operator new(size);
+}
+
+void basic_free(void * p, std::size_t size)
+{
+	::operator delete(p);
+}
+
+basic_arena::basic_arena() : pool(0), outer(0)
+{
+}
+
+basic_arena::~basic_arena()
+{
+}
+
+numeric_alloc_scope::numeric_alloc_scope()
+{
+}
+
+numeric_alloc_scope::~numeric_alloc_scope()
+{
+}
+
+#endif // ndef GINAC_DISABLE_BASIC_POOL
+
+} // namespace GiNaC
@@ -0,0 +1,103 @@
+/** @file alloc.h
+ *
+ *  Interface to the memory allocator for GiNaC's expression objects. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_ALLOC_H
+#define GINAC_ALLOC_H
+
+#include <cstddef> // for size_t
+
+namespace GiNaC {
+
+class memory_pool;
+
+/** Allocate memory for an object of class basic (or a derived class).
+ *  Small objects are taken from size-class pools, so the many short-lived
+ *  temporaries created during evaluation don't go through malloc/free.
+ *  The memory comes from the innermost basic_arena active in the calling
+ *  thread, or from the thread's default pool. */
+void * basic_alloc(std::size_t size);
+
+/** Release memory obtained from basic_alloc(). size must be the size
+ *  which was passed to basic_alloc(). This may be called from any thread,
+ *  also after the arena the memory came from has been left. */
+void basic_free(void * p, std::size_t size);
+
+/** Total number of bytes requested from basic_alloc() by the calling
+ *  thread so far. The difference of two values measures the expression
+ *  objects created by a computation. */
+unsigned long long basic_alloc_bytes();
+
+/** Number of objects requested from basic_alloc() by the calling thread
+ *  so far, the counterpart of basic_alloc_bytes() for expression nodes. */
+unsigned long long basic_alloc_count();
+
+/** Scoped arena for expression objects.
+ *
+ *  While an object of this class exists, all objects of class basic which
+ *  are created by the constructing thread are allocated from memory which
+ *  is private to the arena. Objects created in the arena may well outlive
+ *  it (e.g. the result of the computation). When the arena is left, the
+ *  memory of the temporaries that have already died is handed back at
+ *  once in whole chunks to a cache shared by all pools, instead of
+ *  remaining scattered over the free lists of the default pool; the
+ *  remaining chunks follow as soon as their last object is deleted.
+ *  Arenas may be nested.
+ *
+ *  Example:
+ *  @code
+ *  ex r;
+ *  {
+ *      basic_arena a;
+ *      r = factor(e);
+ *  }
+ *  @endcode */
+class basic_arena {
+public:
+	basic_arena();
+	~basic_arena();
+private:
+	basic_arena(const basic_arena &);
+	basic_arena & operator=(const basic_arena &);
+
+	memory_pool * pool;
+	memory_pool * outer;
+};
+
+/** Scope in which the numbers created by CLN in the calling thread get
+ *  their memory like expression objects: from the innermost basic_arena,
+ *  or from the thread's default pool, instead of from malloc(). Numbers
+ *  too large for the pools still use malloc(). ex::expand(), ex::normal()
+ *  and factor() open such a scope, since they create many short-lived big
+ *  integers. Scopes may be nested, and numbers created in a scope may
+ *  outlive it. */
+class numeric_alloc_scope {
+public:
+	numeric_alloc_scope();
+	~numeric_alloc_scope();
+private:
+	numeric_alloc_scope(const numeric_alloc_scope &);
+	numeric_alloc_scope & operator=(const numeric_alloc_scope &);
+};
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_ALLOC_H
@@ -24,13 +24,18 @@
 #include "registrar.h"
 #include "ex.h"
 #include "lst.h"
+#include "mapped_file.h"
+#include "parallel.h"
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 #include "tostring.h"
 #include "version.h"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <sstream>
 #include <stdexcept>
 
 namespace GiNaC {
@@ -58,14 +63,29 @@ archive_node_id archive::add_node(const archive_node &n)
 		mapit i = exprtable.find(n.get_ex());
 		if (i != exprtable.end())
 			return i->second;
+	}
+
+	// Not found, add archive_node to nodes vector (or write it out)
+	archive_node_id id;
+	if (writer) {
+		id = writer->write_node(n);
+	} else {
 		nodes.push_back(n);
-		exprtable[n.get_ex()] = nodes.size() - 1;
-		return nodes.size() - 1;
+		id = nodes.size() - 1;
 	}
+	if (n.has_ex())
+		exprtable[n.get_ex()] = id;
+	return id;
+}
+
 
-	// Not found, add archive_node to nodes vector
-	nodes.push_back(n);
-	return nodes.size()-1;
+bool archive::find_node(const ex &e, archive_node_id &id) const
+{
+	mapit i = exprtable.find(e);
+	if (i == exprtable.end())
+		return false;
+	id = i->second;
+	return true;
 }
 
 
@@ -213,6 +233,25 @@ std::ostream &operator<<(std::ostream &os, const archive_node &n)
 	return os;
 }
 
+/** Number of bytes written by write_unsigned(). */
+static unsigned unsigned_size(unsigned val)
+{
+	unsigned ret = 1;
+	while (val >= 0x80) {
+		val >>= 7;
+		ret++;
+	}
+	return ret;
+}
+
+unsigned long long archive_node::encoded_size() const
+{
+	unsigned long long ret = unsigned_size(props.size());
+	for (unsigned i=0; i<props.size(); i++)
+		ret += unsigned_size(props[i].type | (props[i].name << 3)) + unsigned_size(props[i].value);
+	return ret;
+}
+
 /** Write archive to binary data stream. */
 std::ostream &operator<<(std::ostream &os, const archive &ar)
 {
@@ -260,13 +299,254 @@ std::istream &operator>>(std::istream &is, archive_node &n)
 	return is;
 }
 
+/*
+ *  Compressed archives
+ *
+ *  A compressed archive consists of "GARZ", the archive version, the number
+ *  of blocks and, for each block, its method (0 = stored, 1 = compressed),
+ *  its original size and its stored size, followed by the data of all
+ *  blocks. The blocks are the consecutive pieces of an archive in the
+ *  stream format. Since all sizes are known in advance, the blocks are
+ *  compressed and decompressed independently of each other, by several
+ *  threads if possible.
+ *
+ *  Compressed blocks use the LZ77 sequence layout of LZ4: a token with the
+ *  number of literals in the upper and the match length minus 4 in the
+ *  lower four bits (15 meaning that more bytes of the length follow, each
+ *  adding up to 255), the literals, a two-byte little-endian match offset
+ *  and the rest of the match length. The last sequence has no match.
+ */
+
+static const unsigned lz_min_match = 4;
+static const size_t lz_max_offset = 0xffff;
+static const unsigned lz_hash_bits = 16;
+
+/** Archive version which introduced compressed archives. */
+static const unsigned compressed_min_version = 4;
+
+static unsigned lz_read32(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24);
+}
+
+static void lz_write_length(std::string &out, size_t len)
+{
+	while (len >= 255) {
+		out += char(255);
+		len -= 255;
+	}
+	out += char(len);
+}
+
+/** Append a sequence of literals and a match (none if len is zero). */
+static void lz_emit(std::string &out, const unsigned char *lit, size_t nlit, size_t offset, size_t len)
+{
+	size_t mlen = len ? len - lz_min_match : 0;
+	out += char(((nlit < 15 ? nlit : 15) << 4) | (mlen < 15 ? mlen : 15));
+	if (nlit >= 15)
+		lz_write_length(out, nlit - 15);
+	out.append(reinterpret_cast<const char *>(lit), nlit);
+	if (len) {
+		out += char(offset & 0xff);
+		out += char(offset >> 8);
+		if (mlen >= 15)
+			lz_write_length(out, mlen - 15);
+	}
+}
+
+/** Compress n bytes with a greedy matcher which remembers the last
+ *  position of each hashed 4-byte string. */
+static void lz_compress(const unsigned char *src, size_t n, std::string &out)
+{
+	std::vector<size_t> table(size_t(1) << lz_hash_bits, size_t(-1));
+	size_t anchor = 0, i = 0;
+	while (i + lz_min_match <= n) {
+		unsigned v = lz_read32(src + i);
+		unsigned h = (v * 2654435761U) >> (32 - lz_hash_bits);
+		size_t cand = table[h];
+		table[h] = i;
+		if (cand == size_t(-1) || i - cand > lz_max_offset || lz_read32(src + cand) != v) {
+			++i;
+			continue;
+		}
+		size_t len = lz_min_match;
+		while (i + len < n && src[cand + len] == src[i + len])
+			++len;
+		lz_emit(out, src + anchor, i - anchor, i - cand, len);
+		i += len;
+		anchor = i;
+	}
+	lz_emit(out, src + anchor, n - anchor, 0, 0);
+}
+
+static size_t lz_read_length(const unsigned char *&p, const unsigned char *end)
+{
+	size_t len = 0;
+	unsigned char b;
+	do {
+		if (p == end)
+			throw (std::runtime_error("compressed archive is corrupt (truncated block)"));
+		b = *p++;
+		len += b;
+	} while (b == 255);
+	return len;
+}
+
+/** Decompress a block into exactly n bytes at dst. */
+static void lz_decompress(const unsigned char *p, const unsigned char *end, unsigned char *dst, size_t n)
+{
+	size_t pos = 0;
+	while (p != end) {
+		unsigned token = *p++;
+		size_t nlit = token >> 4;
+		if (nlit == 15)
+			nlit += lz_read_length(p, end);
+		if (nlit > size_t(end - p) || nlit > n - pos)
+			throw (std::runtime_error("compressed archive is corrupt (bad literals)"));
+		std::memcpy(dst + pos, p, nlit);
+		p += nlit;
+		pos += nlit;
+		if (p == end)
+			break;
+
+		if (end - p < 2)
+			throw (std::runtime_error("compressed archive is corrupt (truncated block)"));
+		size_t offset = p[0] | (p[1] << 8);
+		p += 2;
+		size_t len = token & 15;
+		if (len == 15)
+			len += lz_read_length(p, end);
+		len += lz_min_match;
+		if (offset == 0 || offset > pos || len > n - pos)
+			throw (std::runtime_error("compressed archive is corrupt (bad match)"));
+		for (size_t k=0; k<len; ++k, ++pos)
+			dst[pos] = dst[pos - offset];
+	}
+	if (pos != n)
+		throw (std::runtime_error("compressed archive is corrupt (wrong block size)"));
+}
+
+/** Describes one block of a compressed archive. */
+struct archive_block {
+	archive_block() : method(0), size(0), offset(0) {}
+	unsigned method;  ///< 0 = stored, 1 = compressed
+	size_t size;      ///< original size
+	size_t offset;    ///< offset of the original data
+	std::string data; ///< stored data
+};
+
+/** Compresses the blocks of a compressed archive. */
+struct compress_block_task : public parallel_task {
+	compress_block_task(const std::string &r, std::vector<archive_block> &b) : raw(r), blocks(b) {}
+	void operator()(size_t i)
+	{
+		archive_block &b = blocks[i];
+		const unsigned char *src = reinterpret_cast<const unsigned char *>(raw.data()) + b.offset;
+		lz_compress(src, b.size, b.data);
+		if (b.data.size() < b.size) {
+			b.method = 1;
+		} else {
+			b.method = 0;
+			b.data.assign(raw, b.offset, b.size);
+		}
+	}
+	const std::string &raw;
+	std::vector<archive_block> &blocks;
+};
+
+/** Decompresses the blocks of a compressed archive. */
+struct decompress_block_task : public parallel_task {
+	decompress_block_task(std::string &r, const std::vector<archive_block> &b) : raw(r), blocks(b) {}
+	void operator()(size_t i)
+	{
+		const archive_block &b = blocks[i];
+		unsigned char *dst = reinterpret_cast<unsigned char *>(&raw[0]) + b.offset;
+		const unsigned char *src = reinterpret_cast<const unsigned char *>(b.data.data());
+		if (b.method == 1)
+			lz_decompress(src, src + b.data.size(), dst, b.size);
+		else if (b.method == 0 && b.data.size() == b.size)
+			std::memcpy(dst, src, b.size);
+		else
+			throw (std::runtime_error("compressed archive is corrupt (bad block)"));
+	}
+	std::string &raw;
+	const std::vector<archive_block> &blocks;
+};
+
+void archive::write_compressed(std::ostream &os, size_t block_size) const
+{
+	if (block_size == 0 || block_size > 0x7fffffff)
+		throw (std::invalid_argument("archive::write_compressed(): block size out of range"));
+
+	std::ostringstream raw_stream;
+	raw_stream << *this;
+	const std::string raw = raw_stream.str();
+
+	size_t num_blocks = (raw.size() + block_size - 1) / block_size;
+	std::vector<archive_block> blocks(num_blocks);
+	for (size_t i=0; i<num_blocks; i++) {
+		blocks[i].offset = i * block_size;
+		blocks[i].size = std::min(block_size, raw.size() - blocks[i].offset);
+	}
+	compress_block_task task(raw, blocks);
+	parallel_for(num_blocks, task);
+
+	// Write header
+	os.put('G');	// Signature
+	os.put('A');
+	os.put('R');
+	os.put('Z');
+	write_unsigned(os, GINACLIB_ARCHIVE_VERSION);
+
+	// Write block table and blocks
+	write_unsigned(os, num_blocks);
+	for (size_t i=0; i<num_blocks; i++) {
+		write_unsigned(os, blocks[i].method);
+		write_unsigned(os, blocks[i].size);
+		write_unsigned(os, blocks[i].data.size());
+	}
+	for (size_t i=0; i<num_blocks; i++)
+		os.write(blocks[i].data.data(), blocks[i].data.size());
+}
+
+/** Read the blocks of a compressed archive (after the header) and the
+ *  archive they contain. */
+static void read_compressed(std::istream &is, archive &ar)
+{
+	unsigned num_blocks = read_unsigned(is);
+	std::vector<archive_block> blocks(num_blocks);
+	size_t total = 0;
+	for (unsigned i=0; i<num_blocks; i++) {
+		blocks[i].method = read_unsigned(is);
+		blocks[i].size = read_unsigned(is);
+		blocks[i].data.resize(read_unsigned(is));
+		blocks[i].offset = total;
+		total += blocks[i].size;
+	}
+	for (unsigned i=0; i<num_blocks; i++) {
+		if (!blocks[i].data.empty())
+			is.read(&blocks[i].data[0], blocks[i].data.size());
+		if (!is)
+			throw (std::runtime_error("compressed archive is truncated"));
+	}
+
+	std::string raw(total, '\0');
+	decompress_block_task task(raw, blocks);
+	parallel_for(num_blocks, task);
+
+	std::istringstream raw_stream(raw);
+	raw_stream >> ar;
+}
+
 /** Read archive from binary data stream. */
 std::istream &operator>>(std::istream &is, archive &ar)
 {
+	ar.forget_lookups();
+
 	// Read header
 	char c1, c2, c3, c4;
 	is.get(c1); is.get(c2); is.get(c3); is.get(c4);
-	if (c1 != 'G' || c2 != 'A' || c3 != 'R' || c4 != 'C')
+	if (c1 != 'G' || c2 != 'A' || c3 != 'R' || (c4 != 'C' && c4 != 'S' && c4 != 'Z'))
 		throw (std::runtime_error("not a GiNaC archive (signature not found)"));
 	static const unsigned max_version = GINACLIB_ARCHIVE_VERSION;
 	static const unsigned min_version = GINACLIB_ARCHIVE_VERSION - GINACLIB_ARCHIVE_AGE;
@@ -274,6 +554,41 @@ std::istream &operator>>(std::istream &is, archive &ar)
 	if ((version > max_version) || (version < min_version))
 		throw (std::runtime_error("archive version " + ToString(version) + " cannot be read by this GiNaC library (which supports versions " + ToString(min_version) + " thru " + ToString(max_version)));
 
+	if (c4 == 'Z') {
+		if (version < compressed_min_version)
+			throw (std::runtime_error("compressed archive has invalid version " + ToString(version)));
+		read_compressed(is, ar);
+		return is;
+	}
+
+	// Archives written by archive_writer consist of records of atoms,
+	// nodes and expressions in the order of their creation
+	if (c4 == 'S') {
+		ar.clear();
+		while (true) {
+			char tag;
+			if (!is.get(tag))
+				throw (std::runtime_error("streamed archive is truncated"));
+			if (tag == 'a') {
+				std::string s;
+				getline(is, s, '\0');
+				ar.inverse_atoms[s] = ar.atoms.size();
+				ar.atoms.push_back(s);
+			} else if (tag == 'n') {
+				ar.nodes.push_back(archive_node(ar));
+				is >> ar.nodes.back();
+			} else if (tag == 'e') {
+				archive_atom name = read_unsigned(is);
+				archive_node_id root = read_unsigned(is);
+				ar.exprs.push_back(archive::archived_ex(name, root));
+			} else if (tag == 'z') {
+				break;
+			} else
+				throw (std::runtime_error("streamed archive is corrupt (unknown record)"));
+		}
+		return is;
+	}
+
 	// Read atoms
 	unsigned num_atoms = read_unsigned(is);
 	ar.atoms.resize(num_atoms);
@@ -300,6 +615,479 @@ std::istream &operator>>(std::istream &is, archive &ar)
 }
 
 
+/*
+ *  Indexed archive format
+ *
+ *  An indexed archive holds the same atoms, expressions and nodes as the
+ *  stream format, but it starts with tables of fixed-width offsets, so
+ *  that each atom and node can be located without reading the ones in
+ *  front of it. All fixed-width quantities are stored in little-endian
+ *  byte order, and offsets count from the start of the archive:
+ *
+ *   header        "GARX", format version, archive version (4 bytes each),
+ *                 number of atoms, expressions and nodes (4 bytes each),
+ *                 offsets of the expression, atom and node tables (8 bytes
+ *                 each)
+ *   expressions   name atom and root node of each expression (4 bytes each)
+ *   atom table    offsets of the atom strings, plus the end of the last one
+ *   node table    offsets of the nodes, plus the end of the last one
+ *   atoms         the strings, without terminators
+ *   nodes         the properties of each node, encoded like in the stream
+ *                 format
+ *
+ *  Archives written by archive_writer start with "GARS" and the archive
+ *  version, followed by records of atoms ('a' and the string with a
+ *  terminating '\0'), nodes ('n' and the properties) and expressions ('e',
+ *  name atom and root node), in the order of their creation, and an end
+ *  record 'z'. The index which may follow consists of the three tables
+ *  and, at the very end, the header of the indexed format. The last entries
+ *  of the atom and node tables are the offset of the end record.
+ */
+
+static const unsigned indexed_format_version = 1;
+static const size_t indexed_header_size = 48;
+
+/** Write unsigned integer quantity with a fixed number of bytes to stream. */
+static void write_fixed(std::ostream &os, unsigned long long val, unsigned bytes)
+{
+	for (unsigned i=0; i<bytes; i++) {
+		os.put(val & 0xff);
+		val >>= 8;
+	}
+}
+
+/** Read unsigned integer quantity with a fixed number of bytes from memory. */
+static unsigned long long read_fixed(const unsigned char *p, unsigned bytes)
+{
+	unsigned long long ret = 0;
+	for (unsigned i=bytes; i>0; i--)
+		ret = (ret << 8) | p[i-1];
+	return ret;
+}
+
+/** Read unsigned integer quantity from memory, advancing p. */
+static unsigned read_unsigned(const unsigned char *&p, const unsigned char *end)
+{
+	unsigned char b;
+	unsigned ret = 0;
+	unsigned shift = 0;
+	do {
+		if (p == end || shift >= 32)
+			throw (std::runtime_error("indexed archive is corrupt (bad node data)"));
+		b = *p++;
+		ret |= (b & 0x7f) << shift;
+		shift += 7;
+	} while (b & 0x80);
+	return ret;
+}
+
+void archive::write_indexed(std::ostream &os) const
+{
+	unsigned num_atoms = atoms.size();
+	unsigned num_exprs = exprs.size();
+	unsigned num_nodes = nodes.size();
+
+	// Lay out the tables behind the header
+	unsigned long long expr_table = indexed_header_size;
+	unsigned long long atom_table = expr_table + 8ULL * num_exprs;
+	unsigned long long node_table = atom_table + 8ULL * (num_atoms + 1);
+	unsigned long long offset = node_table + 8ULL * (num_nodes + 1);
+
+	// Write header
+	os.put('G');	// Signature
+	os.put('A');
+	os.put('R');
+	os.put('X');
+	write_fixed(os, indexed_format_version, 4);
+	write_fixed(os, GINACLIB_ARCHIVE_VERSION, 4);
+	write_fixed(os, num_atoms, 4);
+	write_fixed(os, num_exprs, 4);
+	write_fixed(os, num_nodes, 4);
+	write_fixed(os, expr_table, 8);
+	write_fixed(os, atom_table, 8);
+	write_fixed(os, node_table, 8);
+
+	// Write expressions
+	for (unsigned i=0; i<num_exprs; i++) {
+		write_fixed(os, exprs[i].name, 4);
+		write_fixed(os, exprs[i].root, 4);
+	}
+
+	// Write offsets of atoms
+	for (unsigned i=0; i<num_atoms; i++) {
+		write_fixed(os, offset, 8);
+		offset += atoms[i].size();
+	}
+	write_fixed(os, offset, 8);
+
+	// Write offsets of nodes
+	for (unsigned i=0; i<num_nodes; i++) {
+		write_fixed(os, offset, 8);
+		offset += nodes[i].encoded_size();
+	}
+	write_fixed(os, offset, 8);
+
+	// Write atoms and nodes
+	for (unsigned i=0; i<num_atoms; i++)
+		os.write(atoms[i].data(), atoms[i].size());
+	for (unsigned i=0; i<num_nodes; i++)
+		os << nodes[i];
+}
+
+archive_writer::archive_writer(std::ostream &s, bool with_index)
+  : os(s), index(with_index), finished(false), pos(0), natoms(0), nnodes(0)
+{
+	ar.writer = this;
+
+	// Write header
+	os.put('G');	// Signature
+	os.put('A');
+	os.put('R');
+	os.put('S');
+	write_unsigned(os, GINACLIB_ARCHIVE_VERSION);
+	pos = 4 + unsigned_size(GINACLIB_ARCHIVE_VERSION);
+}
+
+void archive_writer::archive_ex(const ex &e, const char *name)
+{
+	if (finished)
+		throw (std::logic_error("archive_writer::archive_ex(): archive has been finished"));
+
+	// Write the nodes of the expression which have not been written before
+	archive_node_id root;
+	if (!ar.find_node(e, root))
+		root = ar.add_node(archive_node(ar, e));
+
+	archive_atom name_atom = ar.atomize(name);
+	os.put('e');
+	write_unsigned(os, name_atom);
+	write_unsigned(os, root);
+	pos += 1 + unsigned_size(name_atom) + unsigned_size(root);
+	if (index)
+		exprs.push_back(std::make_pair(name_atom, root));
+}
+
+void archive_writer::write_atom(const std::string &s)
+{
+	if (index)
+		atom_offsets.push_back(pos + 1);
+	os.put('a');
+	os.write(s.data(), s.size());
+	os.put('\0');
+	pos += s.size() + 2;
+	natoms++;
+}
+
+archive_node_id archive_writer::write_node(const archive_node &n)
+{
+	if (index)
+		node_offsets.push_back(pos + 1);
+	os.put('n');
+	os << n;
+	pos += 1 + n.encoded_size();
+	return nnodes++;
+}
+
+void archive_writer::finish()
+{
+	if (finished)
+		return;
+	finished = true;
+
+	unsigned long long end = pos;
+	os.put('z');
+	pos++;
+	if (!index)
+		return;
+
+	// Write the tables of the indexed format behind the end record, and a
+	// trailer with the layout of the header of the indexed format; the
+	// tables end with the offset of the end record
+	unsigned long long expr_table = pos;
+	for (unsigned i=0; i<exprs.size(); i++) {
+		write_fixed(os, exprs[i].first, 4);
+		write_fixed(os, exprs[i].second, 4);
+	}
+	unsigned long long atom_table = expr_table + 8ULL * exprs.size();
+	for (unsigned i=0; i<natoms; i++)
+		write_fixed(os, atom_offsets[i], 8);
+	write_fixed(os, end, 8);
+	unsigned long long node_table = atom_table + 8ULL * (natoms + 1);
+	for (unsigned i=0; i<nnodes; i++)
+		write_fixed(os, node_offsets[i], 8);
+	write_fixed(os, end, 8);
+
+	os.put('G');
+	os.put('A');
+	os.put('R');
+	os.put('X');
+	write_fixed(os, indexed_format_version, 4);
+	write_fixed(os, GINACLIB_ARCHIVE_VERSION, 4);
+	write_fixed(os, natoms, 4);
+	write_fixed(os, exprs.size(), 4);
+	write_fixed(os, nnodes, 4);
+	write_fixed(os, expr_table, 8);
+	write_fixed(os, atom_table, 8);
+	write_fixed(os, node_table, 8);
+	pos = node_table + 8ULL * (nnodes + 1) + indexed_header_size;
+}
+
+indexed_archive::indexed_archive(const std::string &filename)
+  : file(new mapped_file(filename)), class_atom(0), class_atom_found(false)
+{
+	base = reinterpret_cast<const unsigned char *>(file->data());
+	length = file->size();
+	init();
+}
+
+indexed_archive::indexed_archive(const void *data, size_t size)
+  : base(static_cast<const unsigned char *>(data)), length(size),
+    class_atom(0), class_atom_found(false)
+{
+	init();
+}
+
+indexed_archive::~indexed_archive()
+{
+}
+
+/** Check the header and read the expression table. */
+void indexed_archive::init()
+{
+	// Archives written by archive_writer have the header at the end
+	const unsigned char *header = base;
+	streamed = length >= indexed_header_size && base[0] == 'G' && base[1] == 'A' && base[2] == 'R' && base[3] == 'S';
+	if (streamed)
+		header = base + length - indexed_header_size;
+
+	if (length < indexed_header_size || header[0] != 'G' || header[1] != 'A' || header[2] != 'R' || header[3] != 'X')
+		throw (std::runtime_error(streamed ? "streamed GiNaC archive has no index"
+		                                   : "not an indexed GiNaC archive (signature not found)"));
+	unsigned format = read_fixed(header + 4, 4);
+	if (format != indexed_format_version)
+		throw (std::runtime_error("indexed archive format " + ToString(format) + " cannot be read by this GiNaC library"));
+	static const unsigned max_version = GINACLIB_ARCHIVE_VERSION;
+	static const unsigned min_version = GINACLIB_ARCHIVE_VERSION - GINACLIB_ARCHIVE_AGE;
+	unsigned version = read_fixed(header + 8, 4);
+	if ((version > max_version) || (version < min_version))
+		throw (std::runtime_error("archive version " + ToString(version) + " cannot be read by this GiNaC library (which supports versions " + ToString(min_version) + " thru " + ToString(max_version)));
+
+	natoms = read_fixed(header + 12, 4);
+	unsigned nexprs = read_fixed(header + 16, 4);
+	nnodes = read_fixed(header + 20, 4);
+	unsigned long long expr_table = read_fixed(header + 24, 8);
+	atom_table = read_fixed(header + 32, 8);
+	node_table = read_fixed(header + 40, 8);
+	if (expr_table > length || (length - expr_table) / 8 < nexprs
+	 || atom_table > length || (length - atom_table) / 8 <= natoms
+	 || node_table > length || (length - node_table) / 8 <= nnodes)
+		throw (std::runtime_error("indexed archive is corrupt (tables out of range)"));
+
+	// Read expressions
+	names.resize(nexprs);
+	roots.resize(nexprs);
+	for (unsigned i=0; i<nexprs; i++) {
+		archive_atom name = read_fixed(base + expr_table + 8*i, 4);
+		roots[i] = read_fixed(base + expr_table + 8*i + 4, 4);
+		if (name >= natoms || roots[i] >= nnodes)
+			throw (std::runtime_error("indexed archive is corrupt (bad expression table)"));
+		names[i] = ar.unatomize(load_atom(name));
+	}
+}
+
+const std::string &indexed_archive::get_name(unsigned index) const
+{
+	if (index >= names.size())
+		throw (std::range_error("index of archived expression out of range"));
+
+	return names[index];
+}
+
+/** Find the characters of an atom in the archive data. */
+void indexed_archive::atom_range(archive_atom id, const unsigned char *&begin, const unsigned char *&end) const
+{
+	if (id >= natoms)
+		throw (std::runtime_error("indexed archive is corrupt (atom ID out of range)"));
+	unsigned long long b = read_fixed(base + atom_table + 8*id, 8);
+	unsigned long long e = read_fixed(base + atom_table + 8*id + 8, 8);
+	if (b > e || e > length)
+		throw (std::runtime_error("indexed archive is corrupt (bad atom offset)"));
+	if (streamed) {
+		const void *term = std::memchr(base + b, 0, e - b);
+		if (!term)
+			throw (std::runtime_error("indexed archive is corrupt (bad atom)"));
+		e = static_cast<const unsigned char *>(term) - base;
+	}
+	begin = base + b;
+	end = base + e;
+}
+
+/** Find the encoded properties of a node in the archive data. */
+void indexed_archive::node_range(archive_node_id id, const unsigned char *&begin, const unsigned char *&end) const
+{
+	unsigned long long b = read_fixed(base + node_table + 8*id, 8);
+	unsigned long long e = read_fixed(base + node_table + 8*id + 8, 8);
+	if (b > e || e > length)
+		throw (std::runtime_error("indexed archive is corrupt (bad node offset)"));
+	begin = base + b;
+	end = base + e;
+}
+
+/** Copy atom from the archive data into the internal archive.
+ *  @return ID of the atom in the internal archive */
+archive_atom indexed_archive::load_atom(archive_atom id)
+{
+	std::map<archive_atom, archive_atom>::const_iterator i = loaded_atoms.find(id);
+	if (i != loaded_atoms.end())
+		return i->second;
+
+	const unsigned char *begin, *end;
+	atom_range(id, begin, end);
+	archive_atom ret = ar.atomize(std::string(reinterpret_cast<const char *>(begin), end - begin));
+	loaded_atoms[id] = ret;
+	return ret;
+}
+
+/** Decode a node and all nodes reachable from it which have not been
+ *  decoded before.
+ *  @return ID of the node in the internal archive */
+archive_node_id indexed_archive::load(archive_node_id id)
+{
+	std::map<archive_node_id, archive_node_id>::const_iterator i = loaded.find(id);
+	if (i != loaded.end())
+		return i->second;
+
+	// New nodes get their IDs when they are first referred to, so the
+	// references can be translated right away
+	archive_node_id ret = ar.nodes.size();
+	loaded[id] = ret;
+	ar.nodes.push_back(archive_node(ar));
+	std::vector<std::pair<archive_node_id, archive_node_id> > todo;
+	todo.push_back(std::make_pair(id, ret));
+
+	while (!todo.empty()) {
+		archive_node_id old_id = todo.back().first;
+		archive_node_id new_id = todo.back().second;
+		todo.pop_back();
+
+		const unsigned char *p, *pend;
+		node_range(old_id, p, pend);
+
+		unsigned num_props = read_unsigned(p, pend);
+		std::vector<archive_node::property> props(num_props);
+		for (unsigned j=0; j<num_props; j++) {
+			unsigned name_type = read_unsigned(p, pend);
+			unsigned value = read_unsigned(p, pend);
+			if ((name_type & 7) > archive_node::PTYPE_BINARY)
+				throw (std::runtime_error("indexed archive is corrupt (bad property type)"));
+			props[j].type = (archive_node::property_type)(name_type & 7);
+			props[j].name = load_atom(name_type >> 3);
+			switch (props[j].type) {
+				case archive_node::PTYPE_STRING:
+				case archive_node::PTYPE_BINARY:
+					value = load_atom(value);
+					break;
+				case archive_node::PTYPE_NODE: {
+					if (value >= nnodes)
+						throw (std::runtime_error("indexed archive is corrupt (node ID out of range)"));
+					std::map<archive_node_id, archive_node_id>::const_iterator k = loaded.find(value);
+					if (k != loaded.end()) {
+						value = k->second;
+					} else {
+						archive_node_id child = ar.nodes.size();
+						loaded[value] = child;
+						ar.nodes.push_back(archive_node(ar));
+						todo.push_back(std::make_pair(value, child));
+						value = child;
+					}
+					break;
+				}
+				default:
+					break;
+			}
+			props[j].value = value;
+		}
+		ar.nodes[new_id].props.swap(props);
+	}
+	return ret;
+}
+
+archive_node_id indexed_archive::get_root(unsigned index) const
+{
+	if (index >= roots.size())
+		throw (std::range_error("index of archived expression out of range"));
+
+	return roots[index];
+}
+
+void indexed_archive::get_node_info(archive_node_id id, node_info &info) const
+{
+	if (id >= nnodes)
+		throw (std::range_error("node ID out of range"));
+
+	const unsigned char *p, *pend;
+	node_range(id, p, pend);
+	info.size = pend - p;
+	info.class_name.clear();
+	info.children.clear();
+
+	unsigned num_props = read_unsigned(p, pend);
+	for (unsigned j=0; j<num_props; j++) {
+		unsigned name_type = read_unsigned(p, pend);
+		unsigned value = read_unsigned(p, pend);
+		switch (name_type & 7) {
+			case archive_node::PTYPE_STRING: {
+				archive_atom name = name_type >> 3;
+				if (!class_atom_found) {
+					const unsigned char *b, *e;
+					atom_range(name, b, e);
+					if (e - b == 5 && std::memcmp(b, "class", 5) == 0) {
+						class_atom = name;
+						class_atom_found = true;
+					}
+				}
+				if (class_atom_found && name == class_atom) {
+					const unsigned char *b, *e;
+					atom_range(value, b, e);
+					info.class_name.assign(reinterpret_cast<const char *>(b), e - b);
+				}
+				break;
+			}
+			case archive_node::PTYPE_NODE:
+				if (value >= nnodes)
+					throw (std::runtime_error("indexed archive is corrupt (node ID out of range)"));
+				info.children.push_back(value);
+				break;
+			default:
+				if ((name_type & 7) > archive_node::PTYPE_BINARY)
+					throw (std::runtime_error("indexed archive is corrupt (bad property type)"));
+				break;
+		}
+	}
+}
+
+ex indexed_archive::unarchive_ex(const lst &sym_lst, const char *name)
+{
+	std::string name_string = name;
+	for (unsigned i=0; i<names.size(); i++)
+		if (names[i] == name_string)
+			return unarchive_ex(sym_lst, i);
+	throw (std::runtime_error("expression with name '" + name_string + "' not found in archive"));
+}
+
+ex indexed_archive::unarchive_ex(const lst &sym_lst, unsigned index)
+{
+	if (index >= roots.size())
+		throw (std::range_error("index of archived expression out of range"));
+
+	// Decode the nodes of the expression, then unarchive them; nodes which
+	// were unarchived before return their cached expressions
+	archive_node_id root = load(roots[index]);
+	lst sym_lst_copy = sym_lst;
+	return ar.nodes[root].unarchive(sym_lst_copy);
+}
+
+
 /** Atomize a string (i.e. convert it into an ID number that uniquely
  *  represents the string). */
 archive_atom archive::atomize(const std::string &s) const
@@ -313,9 +1101,36 @@ archive_atom archive::atomize(const std::string &s) const
 	archive_atom id = atoms.size();
 	atoms.push_back(s);
 	inverse_atoms[s] = id;
+	known_atoms.clear();
+	if (writer)
+		writer->write_atom(s);
 	return id;
 }
 
+archive_atom archive::known_atom(archive_node::known_name n) const
+{
+	if (known_atoms.empty()) {
+		static const char *names[archive_node::KN_COUNT] = {
+			"class", "rest", "coeff", "overall_coeff", "basis",
+			"exponent", "number", "name", "TeXname"
+		};
+		known_atoms.resize(archive_node::KN_COUNT);
+		for (unsigned i=0; i<archive_node::KN_COUNT; i++) {
+			inv_at_cit it = inverse_atoms.find(names[i]);
+			known_atoms[i] = it != inverse_atoms.end() ? it->second : archive_atom(-1);
+		}
+	}
+	return known_atoms[n];
+}
+
+/** Forget the atoms of the predefined property names and the resolved
+ *  class names (when the atoms are replaced). */
+void archive::forget_lookups() const
+{
+	known_atoms.clear();
+	factories.clear();
+}
+
 /** Unatomize a string (i.e. convert the ID number back to the string). */
 const std::string &archive::unatomize(archive_atom id) const
 {
@@ -379,6 +1194,37 @@ archive_node::archive_node_cit
 	return props.end();
 }
 
+archive_node::archive_node_cit
+		archive_node::find_first(known_name name) const
+{
+	archive_atom name_atom = a.known_atom(name);
+	for (archive_node_cit i=props.begin(); i!=props.end(); ++i)
+		if (i->name == name_atom)
+			return i;
+	return props.end();
+}
+
+archive_node::archive_node_cit
+		archive_node::find_last(known_name name) const
+{
+	archive_atom name_atom = a.known_atom(name);
+	for (archive_node_cit i=props.end(); i!=props.begin();) {
+		--i;
+		if (i->name == name_atom)
+			return i;
+	}
+	return props.end();
+}
+
+archive_node::archive_node_cit
+		archive_node::find_property(archive_atom name, property_type type, unsigned index) const
+{
+	for (archive_node_cit i=props.begin(); i!=props.end(); ++i)
+		if (i->type == type && i->name == name && index-- == 0)
+			return i;
+	return props.end();
+}
+
 void archive_node::add_bool(const std::string &name, bool value)
 {
 	props.push_back(property(a.atomize(name), PTYPE_BOOL, value));
@@ -394,10 +1240,63 @@ void archive_node::add_string(const std::string &name, const std::string &value)
 	props.push_back(property(a.atomize(name), PTYPE_STRING, a.atomize(value)));
 }
 
+/*
+ *  Binary properties are stored as atoms. Since atoms are written with a
+ *  terminating '\0', the bytes are packed into groups of 7 bits, each
+ *  stored in a byte with the highest bit set.
+ */
+
+static std::string pack_binary(const std::string &s)
+{
+	std::string ret;
+	ret.reserve(s.size() + s.size() / 7 + 1);
+	unsigned acc = 0, bits = 0;
+	for (size_t i=0; i<s.size(); ++i) {
+		acc = (acc << 8) | (unsigned char)s[i];
+		bits += 8;
+		while (bits >= 7) {
+			bits -= 7;
+			ret += char(0x80 | ((acc >> bits) & 0x7f));
+		}
+		acc &= (1U << bits) - 1;
+	}
+	if (bits)
+		ret += char(0x80 | ((acc << (7 - bits)) & 0x7f));
+	return ret;
+}
+
+static std::string unpack_binary(const std::string &s)
+{
+	std::string ret;
+	ret.reserve(s.size() - s.size() / 8);
+	unsigned acc = 0, bits = 0;
+	for (size_t i=0; i<s.size(); ++i) {
+		unsigned char c = s[i];
+		if (!(c & 0x80))
+			throw (std::runtime_error("archive contains malformed binary property"));
+		acc = (acc << 7) | (c & 0x7f);
+		bits += 7;
+		if (bits >= 8) {
+			bits -= 8;
+			ret += char((acc >> bits) & 0xff);
+		}
+		acc &= (1U << bits) - 1;
+	}
+	return ret;
+}
+
+void archive_node::add_binary(const std::string &name, const std::string &value)
+{
+	props.push_back(property(a.atomize(name), PTYPE_BINARY, a.atomize(pack_binary(value))));
+}
+
 void archive_node::add_ex(const std::string &name, const ex &value)
 {
-	// Recursively create an archive_node and add its ID to the properties of this node
-	archive_node_id id = a.add_node(archive_node(a, value));
+	// Recursively create an archive_node (unless the expression has been
+	// archived before) and add its ID to the properties of this node
+	archive_node_id id;
+	if (!a.find_node(value, id))
+		id = a.add_node(archive_node(a, value));
 	props.push_back(property(a.atomize(name), PTYPE_NODE, id));
 }
 
@@ -456,6 +1355,33 @@ bool archive_node::find_string(const std::string &name, std::string &ret, unsign
 	return false;
 }
 
+bool archive_node::find_string(known_name name, std::string &ret, unsigned index) const
+{
+	archive_node_cit i = find_property(a.known_atom(name), PTYPE_STRING, index);
+	if (i == props.end())
+		return false;
+	ret = a.unatomize(i->value);
+	return true;
+}
+
+bool archive_node::find_binary(const std::string &name, std::string &ret, unsigned index) const
+{
+	archive_node_cit i = find_property(a.atomize(name), PTYPE_BINARY, index);
+	if (i == props.end())
+		return false;
+	ret = unpack_binary(a.unatomize(i->value));
+	return true;
+}
+
+bool archive_node::find_binary(known_name name, std::string &ret, unsigned index) const
+{
+	archive_node_cit i = find_property(a.known_atom(name), PTYPE_BINARY, index);
+	if (i == props.end())
+		return false;
+	ret = unpack_binary(a.unatomize(i->value));
+	return true;
+}
+
 void archive_node::find_ex_by_loc(archive_node_cit loc, ex &ret, lst &sym_lst)
 		const
 {
@@ -480,6 +1406,15 @@ bool archive_node::find_ex(const std::string &name, ex &ret, lst &sym_lst, unsig
 	return false;
 }
 
+bool archive_node::find_ex(known_name name, ex &ret, lst &sym_lst, unsigned index) const
+{
+	archive_node_cit i = find_property(a.known_atom(name), PTYPE_NODE, index);
+	if (i == props.end())
+		return false;
+	ret = a.get_node(i->value).unarchive(sym_lst);
+	return true;
+}
+
 const archive_node &archive_node::find_ex_node(const std::string &name, unsigned index) const
 {
 	archive_atom name_atom = a.atomize(name);
@@ -528,6 +1463,17 @@ static synthesize_func find_factory_fcn(const std::string& name)
 	return ret;
 }
 
+synthesize_func archive::find_factory(archive_atom class_name) const
+{
+	if (class_name >= atoms.size())
+		throw (std::range_error("archive::find_factory(): atom ID out of range"));
+	if (factories.size() < atoms.size())
+		factories.resize(atoms.size(), 0);
+	if (!factories[class_name])
+		factories[class_name] = find_factory_fcn(atoms[class_name]);
+	return factories[class_name];
+}
+
 /** Convert archive node to GiNaC expression. */
 ex archive_node::unarchive(lst &sym_lst) const
 {
@@ -536,12 +1482,12 @@ ex archive_node::unarchive(lst &sym_lst) const
 		return e;
 
 	// Find instantiation function for class specified in node
-	std::string class_name;
-	if (!find_string("class", class_name))
+	archive_node_cit i = find_property(a.known_atom(KN_CLASS), PTYPE_STRING, 0);
+	if (i == props.end())
 		throw (std::runtime_error("archive node contains no class name"));
 
 	// Call instantiation function
-	synthesize_func factory_fcn = find_factory_fcn(class_name);
+	synthesize_func factory_fcn = a.find_factory(i->value);
 	ptr<basic> obj(factory_fcn());
 	obj->setflag(status_flags::dynallocated);
 	obj->read_archive(*this, sym_lst);
@@ -552,16 +1498,36 @@ ex archive_node::unarchive(lst &sym_lst) const
 
 int unarchive_table_t::usecount = 0;
 unarchive_map_t* unarchive_table_t::unarch_map = 0;
+unarchive_table_t::pending_t* unarchive_table_t::pending = 0;
 
 unarchive_table_t::unarchive_table_t()
 {
-	if (usecount == 0)
+	if (usecount == 0) {
 		unarch_map = new unarchive_map_t();
+		pending = new pending_t();
+		pending->reserve(128);
+	}
 	++usecount;
 }
 
+/** Move the classes registered by name literal into the map. */
+void unarchive_table_t::insert_pending()
+{
+	pending_t p;
+	p.swap(*pending);
+	for (pending_t::const_iterator i = p.begin(); i != p.end(); ++i) {
+		std::pair<unarchive_map_t::iterator, bool> r
+			= unarch_map->insert(unarchive_map_t::value_type(i->first, i->second));
+		if (!r.second)
+			throw std::runtime_error(std::string("Class \"") + i->first
+					+ "\" is already registered");
+	}
+}
+
 synthesize_func unarchive_table_t::find(const std::string& classname) const
 {
+	if (!pending->empty())
+		insert_pending();
 	unarchive_map_t::const_iterator i = unarch_map->find(classname);
 	if (i != unarch_map->end())
 		return i->second;
@@ -571,21 +1537,31 @@ synthesize_func unarchive_table_t::find(const std::string& classname) const
 
 void unarchive_table_t::insert(const std::string& classname, synthesize_func f)
 {
+	if (!pending->empty())
+		insert_pending();
 	if (unarch_map->find(classname) != unarch_map->end())
 		throw std::runtime_error(std::string("Class \"" + classname
 					+ "\" is already registered"));
 	unarch_map->operator[](classname) = f;
 }
 
+void unarchive_table_t::insert(const char* classname, synthesize_func f)
+{
+	pending->push_back(std::make_pair(classname, f));
+}
+
 unarchive_table_t::~unarchive_table_t()
 {
-	if (--usecount == 0)
+	if (--usecount == 0) {
 		delete unarch_map;
+		delete pending;
+	}
 }
 
 
 void archive::clear()
 {
+	forget_lookups();
 	atoms.clear();
 	inverse_atoms.clear();
 	exprs.clear();
@@ -666,6 +1642,7 @@ void archive_node::printraw(std::ostream &os) const
 			case PTYPE_UNSIGNED: os << "unsigned"; break;
 			case PTYPE_STRING: os << "string"; break;
 			case PTYPE_NODE: os << "node"; break;
+			case PTYPE_BINARY: os << "binary"; break;
 			default: os << "<unknown>"; break;
 		}
 		os << " \"" << a.unatomize(i->name) << "\" " << i->value << std::endl;
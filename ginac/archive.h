@@ -25,14 +25,20 @@
 
 #include "ex.h"
 
+#include <cstddef>
 #include <iosfwd>
 #include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace GiNaC {
 
 class archive;
+class archive_writer;
+class indexed_archive;
+class mapped_file;
 
 
 /** Numerical ID value to refer to an archive_node. */
@@ -49,6 +55,9 @@ class archive_node
 {
 	friend std::ostream &operator<<(std::ostream &os, const archive_node &ar);
 	friend std::istream &operator>>(std::istream &is, archive_node &ar);
+	friend class archive;
+	friend class archive_writer;
+	friend class indexed_archive;
 
 public:
 	/** Property data types */
@@ -56,7 +65,24 @@ public:
 		PTYPE_BOOL,
 		PTYPE_UNSIGNED,
 		PTYPE_STRING,
-		PTYPE_NODE
+		PTYPE_NODE,
+		PTYPE_BINARY
+	};
+
+	/** Names of properties used by the most common classes. Their atoms
+	 *  are looked up only once per archive, so these classes can find
+	 *  their properties without string comparisons. */
+	enum known_name {
+		KN_CLASS,
+		KN_REST,
+		KN_COEFF,
+		KN_OVERALL_COEFF,
+		KN_BASIS,
+		KN_EXPONENT,
+		KN_NUMBER,
+		KN_NAME,
+		KN_TEXNAME,
+		KN_COUNT
 	};
 
 	/** Information about a stored property. A vector of these structures
@@ -101,6 +127,9 @@ public:
 	/** Add property of type "ex" to node. */
 	void add_ex(const std::string &name, const ex &value);
 
+	/** Add property of type "binary" (a string of arbitrary bytes) to node. */
+	void add_binary(const std::string &name, const std::string &value);
+
 	/** Retrieve property of type "bool" from node.
 	 *  @return "true" if property was found, "false" otherwise */
 	bool find_bool(const std::string &name, bool &ret, unsigned index = 0) const;
@@ -113,11 +142,23 @@ public:
 	 *  @return "true" if property was found, "false" otherwise */
 	bool find_string(const std::string &name, std::string &ret, unsigned index = 0) const;
 
+	/** Retrieve property of type "binary" from node.
+	 *  @return "true" if property was found, "false" otherwise */
+	bool find_binary(const std::string &name, std::string &ret, unsigned index = 0) const;
+
 	/** Find the location in the vector of properties of the first/last
     *  property with a given name. */
 	archive_node_cit find_first(const std::string &name) const;
 	archive_node_cit find_last(const std::string &name) const;
 
+	/** Same as the preceding functions and find_string() and find_ex(),
+	 *  but for predefined property names. */
+	archive_node_cit find_first(known_name name) const;
+	archive_node_cit find_last(known_name name) const;
+	bool find_string(known_name name, std::string &ret, unsigned index = 0) const;
+	bool find_binary(known_name name, std::string &ret, unsigned index = 0) const;
+	bool find_ex(known_name name, ex &ret, lst &sym_lst, unsigned index = 0) const;
+
 	/** Retrieve property of type "ex" from node.
 	 *  @return "true" if property was found, "false" otherwise */
 	bool find_ex(const std::string &name, ex &ret, lst &sym_lst, unsigned index = 0) const;
@@ -145,6 +186,13 @@ public:
 private:
 	static archive* dummy_ar_creator();
 
+	/** Number of bytes written by operator<<. */
+	unsigned long long encoded_size() const;
+
+	/** Find the property with the given name atom and type which occurs
+	 *  at the given index among those, or props.end(). */
+	archive_node_cit find_property(archive_atom name, property_type type, unsigned index) const;
+
 	/** Reference to the archive to which this node belongs. */
 	archive &a;
 
@@ -161,15 +209,25 @@ private:
 typedef basic* (*synthesize_func)();
 typedef std::map<std::string, synthesize_func> unarchive_map_t;
 
+/** Table of the functions creating the objects of the unarchivable
+ *  classes. Registration runs before main(), so it only appends the class
+ *  name (a string literal) and the function to a vector; the map is built
+ *  on the first lookup, that is in processes which actually unarchive. */
 class unarchive_table_t
 {
+	typedef std::vector<std::pair<const char*, synthesize_func> > pending_t;
 	static int usecount;
 	static unarchive_map_t* unarch_map;
+	static pending_t* pending;
+	static void insert_pending();
 public:
 	unarchive_table_t();
 	~unarchive_table_t();
 	synthesize_func find(const std::string& classname) const;
 	void insert(const std::string& classname, synthesize_func f);
+	/** Register a class whose name is a string literal. The check for
+	 *  duplicates is done when the map is built. */
+	void insert(const char* classname, synthesize_func f);
 };
 static unarchive_table_t unarch_table_instance;
 
@@ -227,7 +285,7 @@ classname ## _unarchiver::classname ## _unarchiver()		\
 {								\
 	static GiNaC::unarchive_table_t table;			\
 	if (usecount++ == 0) {					\
-		table.insert(std::string(#classname),		\
+		table.insert(#classname,			\
 			&(classname ## _unarchiver::create));	\
 	}							\
 }								\
@@ -250,16 +308,18 @@ class archive
 {
 	friend std::ostream &operator<<(std::ostream &os, const archive &ar);
 	friend std::istream &operator>>(std::istream &is, archive &ar);
+	friend class archive_writer;
+	friend class indexed_archive;
 
 public:
-	archive() {}
+	archive() : writer(0) {}
 	~archive() {}
 
 	/** Construct archive from expression using the default name "ex". */
-	archive(const ex &e) {archive_ex(e, "ex");}
+	archive(const ex &e) : writer(0) {archive_ex(e, "ex");}
 
 	/** Construct archive from expression using the specified name. */
-	archive(const ex &e, const char *n) {archive_ex(e, n);}
+	archive(const ex &e, const char *n) : writer(0) {archive_ex(e, n);}
 
 	/** Archive an expression.
 	 *  @param e the expression to be archived
@@ -293,9 +353,23 @@ public:
 	/** Clear all archived expressions. */
 	void clear();
 
+	/** Write archive to binary data stream in the indexed format, which
+	 *  can be read with class indexed_archive.
+	 *  @see indexed_archive */
+	void write_indexed(std::ostream &os) const;
+
+	/** Write archive to binary data stream in compressed form. The archive
+	 *  is split into blocks of the given size, which are compressed (and,
+	 *  when reading it with operator>>, decompressed) in parallel. */
+	void write_compressed(std::ostream &os, size_t block_size = 1 << 20) const;
+
 	archive_node_id add_node(const archive_node &n);
 	archive_node &get_node(archive_node_id id);
 
+	/** Look up the node of an expression which has already been archived.
+	 *  @return "true" if the node was found, "false" otherwise */
+	bool find_node(const ex &e, archive_node_id &id) const;
+
 	void forget();
 	void printraw(std::ostream &os) const;
 
@@ -319,6 +393,14 @@ public:
 	archive_atom atomize(const std::string &s) const;
 	const std::string &unatomize(archive_atom id) const;
 
+	/** Atom of a predefined property name, or an ID which is no atom if the
+	 *  name doesn't occur in the archive. */
+	archive_atom known_atom(archive_node::known_name n) const;
+
+	/** Instantiation function of the class whose name is the given atom.
+	 *  Each class name is resolved only once per archive. */
+	synthesize_func find_factory(archive_atom class_name) const;
+
 private:
 	/** Vector of atomized strings (using a vector allows faster unarchiving). */
 	mutable std::vector<std::string> atoms;
@@ -328,15 +410,165 @@ private:
 	typedef std::map<std::string, archive_atom>::const_iterator inv_at_cit;
 	mutable std::map<std::string, archive_atom> inverse_atoms;
 
+	/** Atoms of the predefined property names (empty if not looked up yet),
+	 *  and instantiation functions of the class names, indexed by atom. */
+	mutable std::vector<archive_atom> known_atoms;
+	mutable std::vector<synthesize_func> factories;
+	void forget_lookups() const;
+
 	/** Map of stored expressions to nodes for faster archiving */
-	typedef std::map<ex, archive_node_id, ex_is_less>::iterator mapit;
-	mutable std::map<ex, archive_node_id, ex_is_less> exprtable;
+	struct ex_hash {
+		size_t operator()(const ex &e) const { return e.gethash(); }
+	};
+	typedef std::unordered_map<ex, archive_node_id, ex_hash, ex_is_equal>::const_iterator mapit;
+	std::unordered_map<ex, archive_node_id, ex_hash, ex_is_equal> exprtable;
+
+	/** If not null, nodes and atoms are written there instead of being
+	 *  stored in the archive. */
+	archive_writer *writer;
 };
 
 
 std::ostream &operator<<(std::ostream &os, const archive &ar);
 std::istream &operator>>(std::istream &is, archive &ar);
 
+
+/** Writes archived expressions to a stream while they are archived. Each
+ *  node is written as soon as it has been created and is not kept in
+ *  memory; only the table which maps the archived expressions to their
+ *  node IDs (for sharing common subexpressions) and the atoms remain.
+ *  The result can be read with operator>> like a regular archive. If an
+ *  index is requested, it is appended by finish(), and the archive can
+ *  also be read with class indexed_archive. */
+class archive_writer
+{
+	friend class archive;
+
+public:
+	explicit archive_writer(std::ostream &os, bool index = false);
+
+	/** Archive an expression and write its new nodes to the stream.
+	 *  @param e the expression to be archived
+	 *  @param name name under which the expression is stored */
+	void archive_ex(const ex &e, const char *name);
+
+	/** Write the end of the archive (and the index, if requested). No
+	 *  expressions can be added afterwards. The destructor does not call
+	 *  this function. */
+	void finish();
+
+	/** Return number of nodes written so far. */
+	unsigned num_nodes() const { return nnodes; }
+
+private:
+	archive_writer(const archive_writer &);
+	archive_writer &operator=(const archive_writer &);
+
+	void write_atom(const std::string &s);
+	archive_node_id write_node(const archive_node &n);
+
+	std::ostream &os;
+	bool index, finished;
+	unsigned long long pos; ///< number of bytes written
+	unsigned natoms, nnodes;
+
+	/** Holds the atoms and the table of archived subexpressions, but no nodes. */
+	archive ar;
+
+	/** Offsets of atoms, nodes and archived expressions, for the index. */
+	std::vector<unsigned long long> atom_offsets, node_offsets;
+	std::vector<std::pair<archive_atom, archive_node_id> > exprs;
+};
+
+
+/** Read-only access to an archive written by archive::write_indexed(),
+ *  or by an archive_writer with an index. Unlike the stream format, these
+ *  hold tables with the offsets of all nodes and atoms, so the archive can
+ *  be used in place: a file is memory-mapped (where the system supports
+ *  it) and only the nodes which are reachable from the requested
+ *  expressions are ever decoded. Nodes which have been decoded are kept, together with their
+ *  unarchived expressions, so subexpressions shared by several requested
+ *  expressions are unarchived once and remain shared. */
+class indexed_archive
+{
+public:
+	/** Open the archive stored in the named file. */
+	explicit indexed_archive(const std::string &filename);
+
+	/** Use an archive held in memory. The buffer is not copied and must
+	 *  remain valid as long as this object exists. */
+	indexed_archive(const void *data, size_t size);
+
+	~indexed_archive();
+
+	/** Return number of archived expressions. */
+	unsigned num_expressions() const { return names.size(); }
+
+	/** Return name of the archived expression with the given index. */
+	const std::string &get_name(unsigned index) const;
+
+	/** Retrieve expression by name.
+	 *  @param sym_lst list of pre-defined symbols
+	 *  @param name name of expression */
+	ex unarchive_ex(const lst &sym_lst, const char *name);
+
+	/** Retrieve expression by index.
+	 *  @param sym_lst list of pre-defined symbols
+	 *  @param index index of expression */
+	ex unarchive_ex(const lst &sym_lst, unsigned index = 0);
+
+	/** Return number of nodes decoded so far. */
+	unsigned num_loaded_nodes() const { return loaded.size(); }
+
+	/** Return number of nodes stored in the archive. */
+	unsigned num_nodes() const { return nnodes; }
+
+	/** Return root node of the archived expression with the given index. */
+	archive_node_id get_root(unsigned index) const;
+
+	/** Summary of a stored node. */
+	struct node_info {
+		std::string class_name;                ///< class of the archived object
+		size_t size;                           ///< size of the encoded node in bytes
+		std::vector<archive_node_id> children; ///< nodes it refers to
+	};
+
+	/** Read the class name, size and references of a stored node without
+	 *  decoding it, so the structure of an archive can be examined without
+	 *  unarchiving anything. */
+	void get_node_info(archive_node_id id, node_info &info) const;
+
+private:
+	indexed_archive(const indexed_archive &);
+	indexed_archive &operator=(const indexed_archive &);
+
+	void init();
+	void atom_range(archive_atom id, const unsigned char *&begin, const unsigned char *&end) const;
+	void node_range(archive_node_id id, const unsigned char *&begin, const unsigned char *&end) const;
+	archive_atom load_atom(archive_atom id);
+	archive_node_id load(archive_node_id id);
+
+	std::unique_ptr<mapped_file> file; ///< the archive file, if any
+	const unsigned char *base;         ///< start of the archive data
+	size_t length;                     ///< size of the archive data
+
+	unsigned natoms, nnodes;
+	size_t atom_table, node_table; ///< offsets of the tables
+	bool streamed; ///< written by archive_writer (atoms end with a '\0')
+
+	std::vector<std::string> names;     ///< names of the expressions
+	std::vector<archive_node_id> roots; ///< root nodes of the expressions
+
+	/** Nodes and atoms decoded so far, renumbered in the order of loading. */
+	archive ar;
+	std::map<archive_node_id, archive_node_id> loaded;
+	std::map<archive_atom, archive_atom> loaded_atoms;
+
+	/** Atom of the property name "class" (if found yet), for get_node_info(). */
+	mutable archive_atom class_atom;
+	mutable bool class_atom_found;
+};
+
 } // namespace GiNaC
 
 #endif // ndef GINAC_ARCHIVE_H
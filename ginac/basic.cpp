@@ -35,13 +35,23 @@
 #include "utils.h"
 #include "hash_seed.h"
 #include "inifcns.h"
+#include "mul.h"
+#include "hash_map.h"
+#include "rule_set.h"
 
 #include <iostream>
 #include <stdexcept>
 #include <typeinfo>
+#include <unordered_map>
+#include <vector>
 
 namespace GiNaC {
 
+/** The flags recording that expand() has done its job, with any options. */
+static const unsigned expanded_flags = status_flags::expanded | status_flags::expanded_indexed
+                                     | status_flags::expanded_function_args
+                                     | status_flags::expanded_indexed_function_args;
+
 GINAC_IMPLEMENT_REGISTERED_CLASS_OPT(basic, void,
   print_func<print_context>(&basic::do_print).
   print_func<print_tree>(&basic::do_print_tree).
@@ -56,19 +66,23 @@ GINAC_IMPLEMENT_REGISTERED_CLASS_OPT(basic, void,
 /** basic copy constructor: implicitly assumes that the other class is of
  *  the exact same type (as it's used by duplicate()), so it can copy the
  *  tinfo_key and the hash value. */
-basic::basic(const basic & other) : flags(other.flags & ~status_flags::dynallocated), hashvalue(other.hashvalue)
+basic::basic(const basic & other) : flags(other.flags & ~(status_flags::dynallocated | status_flags::hash_consed | status_flags::accounted | status_flags::symbols_calculated | status_flags::metrics_calculated | status_flags::conjugate_invariant | status_flags::known_real)), hashvalue(other.hashvalue)
 {
 }
 
 /** basic assignment operator: the other object might be of a derived class. */
 const basic & basic::operator=(const basic & other)
 {
-	unsigned fl = other.flags & ~status_flags::dynallocated;
+	if (flags & status_flags::hash_consed)
+		hash_cons_forget(*this);
+	if (flags & status_flags::accounted)
+		internal::forget_accounted_object(*this);
+	unsigned fl = other.flags & ~(status_flags::dynallocated | status_flags::hash_consed | status_flags::accounted | status_flags::symbols_calculated | status_flags::metrics_calculated | status_flags::conjugate_invariant | status_flags::known_real);
 	if (typeid(*this) != typeid(other)) {
 		// The other object is of a derived class, so clear the flags as they
 		// might no longer apply (especially hash_calculated). Oh, and don't
 		// copy the tinfo_key: it is already set correctly for this object.
-		fl &= ~(status_flags::evaluated | status_flags::expanded | status_flags::hash_calculated);
+		fl &= ~(status_flags::evaluated | expanded_flags | status_flags::hash_calculated);
 	} else {
 		// The objects are of the exact same class, so copy the hash value.
 		hashvalue = other.hashvalue;
@@ -279,6 +293,8 @@ ex & basic::operator[](size_t i)
  *  but e.has(x+y) is false. */
 bool basic::has(const ex & pattern, unsigned options) const
 {
+	if (!may_contain(pattern))
+		return false;
 	exmap repl_lst;
 	if (match(pattern, repl_lst))
 		return true;
@@ -310,7 +326,7 @@ ex basic::map(map_function & f) const
 
 	if (copy) {
 		copy->setflag(status_flags::dynallocated);
-		copy->clearflag(status_flags::hash_calculated | status_flags::expanded);
+		copy->clearflag(status_flags::hash_calculated | expanded_flags);
 		return *copy;
 	} else
 		return *this;
@@ -343,6 +359,119 @@ ex basic::coeff(const ex & s, int n) const
 		return n==0 ? *this : _ex0;
 }
 
+/** Store the non-zero coefficients of all powers of s in c, which must be
+ *  empty, the same as coeff(s, n) for n from ldegree(s) to degree(s). The
+ *  default implementation does just that; sums, products and powers find
+ *  all coefficients in one pass.
+ *
+ *  @param s  object to take the powers of
+ *  @param c  map from the exponents to the coefficients (returned) */
+void basic::coeffs(const ex & s, std::map<int, ex> & c) const
+{
+	const int deg = degree(s);
+	for (int n=ldegree(s); n<=deg; ++n) {
+		ex cn = coeff(s, n);
+		if (!cn.is_zero())
+			c.insert(std::make_pair(n, cn));
+	}
+}
+
+namespace {
+
+typedef std::vector<int> exponent_vector;
+
+struct exponent_vector_hash {
+	std::size_t operator()(const exponent_vector & v) const
+	{
+		hash_t h = v.size();
+		for (exponent_vector::const_iterator i = v.begin(); i != v.end(); ++i)
+			h = rotate_left(h) ^ golden_ratio_hash(p_int(*i));
+		return h;
+	}
+};
+
+/** Split the term t of an expanded sum into the exponents of the symbols
+ *  and the product of the other factors. Returns false if some factor
+ *  may contain the symbols in another way. */
+bool split_monomial(const ex & t, const exhashmap<size_t> & index, unsigned mask,
+                    exponent_vector & exps, exvector & rest)
+{
+	const size_t n = is_exactly_a<mul>(t) ? t.nops() : 1;
+	for (size_t i = 0; i < n; ++i) {
+		const ex f = is_exactly_a<mul>(t) ? t.op(i) : t;
+		if (!(ex_to<basic>(f).symbol_mask() & mask)) {
+			rest.push_back(f);
+			continue;
+		}
+		exhashmap<size_t>::const_iterator j = index.find(f);
+		if (j != index.end()) {
+			++exps[j->second];
+			continue;
+		}
+		if (!is_exactly_a<power>(f) || !f.op(1).info(info_flags::integer))
+			return false;
+		j = index.find(f.op(0));
+		if (j == index.end())
+			return false;
+		exps[j->second] += ex_to<numeric>(f.op(1)).to_int();
+	}
+	return true;
+}
+
+} // anonymous namespace
+
+/** Distributed form of collect() for an expanded sum x: every term is
+ *  split once into a monomial in the objects of l and its coefficient, and
+ *  the coefficients are summed in a hash table keyed by the exponents. */
+static ex collect_distributed(const ex & x, const lst & l)
+{
+	bool all_symbols = true;
+	unsigned mask = 0;
+	exhashmap<size_t> index;
+	exvector vars;
+	for (lst::const_iterator li=l.begin(); li!=l.end(); ++li) {
+		if (!is_a<symbol>(*li))
+			all_symbols = false;
+		mask |= ex_to<basic>(*li).symbol_mask();
+		if (index.find(*li) == index.end()) {
+			index[*li] = vars.size();
+			vars.push_back(*li);
+		}
+	}
+
+	typedef std::unordered_map<exponent_vector, exvector, exponent_vector_hash> coeff_table;
+	coeff_table cmap;
+	exponent_vector exps(vars.size());
+	exvector rest;
+	for (const_iterator xi=x.begin(); xi!=x.end(); ++xi) {
+		std::fill(exps.begin(), exps.end(), 0);
+		rest.clear();
+		if (!all_symbols || !split_monomial(*xi, index, mask, exps, rest)) {
+			// Take the degrees and coefficients one object after the other
+			std::fill(exps.begin(), exps.end(), 0);
+			ex pre_coeff = *xi;
+			for (size_t k=0; k<vars.size(); ++k) {
+				exps[k] = pre_coeff.degree(vars[k]);
+				pre_coeff = pre_coeff.coeff(vars[k], exps[k]);
+			}
+			rest.assign(1, pre_coeff);
+		}
+		cmap[exps].push_back((new mul(rest))->setflag(status_flags::dynallocated));
+	}
+
+	exvector resv;
+	resv.reserve(cmap.size());
+	for (coeff_table::const_iterator mi=cmap.begin(); mi != cmap.end(); ++mi) {
+		exvector factors;
+		for (size_t k=0; k<vars.size(); ++k)
+			if (mi->first[k] != 0)
+				factors.push_back(pow(vars[k], mi->first[k]));
+		factors.push_back((new add(mi->second))->setflag(status_flags::dynallocated));
+		resv.push_back((new mul(factors))->setflag(status_flags::dynallocated));
+	}
+	return (new add(resv))->setflag(status_flags::dynallocated);
+}
+
 /** Sort expanded expression in terms of powers of some object(s).
  *  @param s object(s) to sort in
  *  @param distributed recursive or distributed form (only used when s is a list) */
@@ -362,29 +491,7 @@ ex basic::collect(const ex & s, bool distributed) const
 			x = this->expand();
 			if (! is_a<add>(x))
 				return x; 
-			const lst& l(ex_to<lst>(s));
-
-			exmap cmap;
-			cmap[_ex1] = _ex0;
-			for (const_iterator xi=x.begin(); xi!=x.end(); ++xi) {
-				ex key = _ex1;
-				ex pre_coeff = *xi;
-				for (lst::const_iterator li=l.begin(); li!=l.end(); ++li) {
-					int cexp = pre_coeff.degree(*li);
-					pre_coeff = pre_coeff.coeff(*li, cexp);
-					key *= pow(*li, cexp);
-				}
-				exmap::iterator ci = cmap.find(key);
-				if (ci != cmap.end())
-					ci->second += pre_coeff;
-				else
-					cmap.insert(exmap::value_type(key, pre_coeff));
-			}
-
-			exvector resv;
-			for (exmap::const_iterator mi=cmap.begin(); mi != cmap.end(); ++mi)
-				resv.push_back((mi->first)*(mi->second));
-			return (new add(resv))->setflag(status_flags::dynallocated);
+			return collect_distributed(x, ex_to<lst>(s));
 
 		} else {
 
@@ -402,8 +509,13 @@ ex basic::collect(const ex & s, bool distributed) const
 	} else {
 
 		// Only one object specified
-		for (int n=this->ldegree(s); n<=this->degree(s); ++n)
-			x += this->coeff(s,n)*power(s,n);
+		std::map<int, ex> c;
+		coeffs(s, c);
+		exvector terms;
+		terms.reserve(c.size());
+		for (std::map<int, ex>::const_iterator ci=c.begin(); ci!=c.end(); ++ci)
+			terms.push_back(ci->second*power(s, ci->first));
+		x = (new add(terms))->setflag(status_flags::dynallocated);
 	}
 	
 	// correct for lost fractional arguments and return
@@ -596,11 +708,23 @@ ex basic::subs_one_level(const exmap & m, unsigned options) const
 	exmap::const_iterator it;
 
 	if (options & subs_options::no_pattern) {
+		// Only symbols can be equal to a symbol
+		if ((options & subs_options::keys_are_symbols) && !is_a<symbol>(*this))
+			return *this;
 		ex thisex = *this;
 		it = m.find(thisex);
 		if (it != m.end())
 			return it->second;
 		return thisex;
+	} else if (const rule_set * rules = rule_set::active(m)) {
+		// Only try the patterns which the index lets through
+		std::vector<exmap::const_iterator> cand;
+		rules->candidates(*this, cand);
+		for (std::vector<exmap::const_iterator>::const_iterator c = cand.begin(); c != cand.end(); ++c) {
+			exmap repl_lst;
+			if (match(ex_to<basic>((*c)->first), repl_lst))
+				return (*c)->second.subs(repl_lst, options | subs_options::no_pattern);
+		}
 	} else {
 		for (it = m.begin(); it != m.end(); ++it) {
 			exmap repl_lst;
@@ -629,7 +753,7 @@ ex basic::subs(const exmap & m, unsigned options) const
 				// Something changed, clone the object
 				basic *copy = duplicate();
 				copy->setflag(status_flags::dynallocated);
-				copy->clearflag(status_flags::hash_calculated | status_flags::expanded);
+				copy->clearflag(status_flags::hash_calculated | expanded_flags);
 
 				// Substitute the changed operand
 				copy->let_op(i++) = subsed_op;
@@ -779,23 +903,49 @@ return_type_t basic::return_type_tinfo() const
  *  members.  For this reason it is well suited for container classes but
  *  atomic classes should override this implementation because otherwise they
  *  would all end up with the same hashvalue. */
-unsigned basic::calchash() const
+hash_t basic::calchash() const
 {
-	unsigned v = make_hash_seed(typeid(*this));
-	for (size_t i=0; i<nops(); i++) {
-		v = rotate_left(v);
-		v ^= this->op(i).gethash();
-	}
+	hash_t v = make_hash_seed(typeid(*this));
+	for (size_t i=0; i<nops(); i++)
+		v = hash_combine(v, this->op(i).gethash());
 
 	// store calculated hash value only if object is already evaluated
 	if (flags & status_flags::evaluated) {
-		setflag(status_flags::hash_calculated);
 		hashvalue = v;
+		setflag(status_flags::hash_calculated);
 	}
 
 	return v;
 }
 
+/** Compute the symbol_mask() of an object. The method inherited from class
+ *  basic combines the masks of the operands. Classes which substitute into
+ *  other subexpressions in subs() must include them. */
+unsigned basic::calc_symbol_mask() const
+{
+	unsigned m = 0;
+	for (size_t i=0; i<nops(); i++)
+		m |= ex_to<basic>(op(i)).symbol_mask();
+	return m;
+}
+
+/** Computes the size measures returned by metrics(). The default
+ *  implementation combines those of the operands. */
+tree_metrics basic::calc_metrics() const
+{
+	tree_metrics m;
+	for (size_t i=0; i<nops(); i++)
+		m.add_child(ex_to<basic>(op(i)).metrics());
+	return m;
+}
+
+/** Returns false if s is a symbol which doesn't occur in the object, so that
+ *  has(s) is false and the degree in s is 0. Returns true otherwise. */
+bool basic::may_contain(const ex & s) const
+{
+	return !is_a<symbol>(s) || (symbol_mask() & ex_to<basic>(s).symbol_mask());
+}
+
 /** Function object to be applied by basic::expand(). */
 struct expand_map_function : public map_function {
 	unsigned options;
@@ -830,13 +980,15 @@ int basic::compare(const basic & other) const
 #ifdef GINAC_COMPARE_STATISTICS
 	compare_statistics.total_basic_compares++;
 #endif
-	const unsigned hash_this = gethash();
-	const unsigned hash_other = other.gethash();
+	internal::count_event(*this, internal::stat_compare);
+	const hash_t hash_this = gethash();
+	const hash_t hash_other = other.gethash();
 	if (hash_this<hash_other) return -1;
 	if (hash_this>hash_other) return 1;
 #ifdef GINAC_COMPARE_STATISTICS
 	compare_statistics.compare_same_hashvalue++;
 #endif
+	internal::count_event(*this, internal::stat_compare_same_hash);
 
 	const std::type_info& typeid_this = typeid(*this);
 	const std::type_info& typeid_other = typeid(other);
@@ -877,11 +1029,13 @@ bool basic::is_equal(const basic & other) const
 #ifdef GINAC_COMPARE_STATISTICS
 	compare_statistics.total_basic_is_equals++;
 #endif
+	internal::count_event(*this, internal::stat_is_equal);
 	if (this->gethash()!=other.gethash())
 		return false;
 #ifdef GINAC_COMPARE_STATISTICS
 	compare_statistics.is_equal_same_hashvalue++;
 #endif
+	internal::count_event(*this, internal::stat_is_equal_same_hash);
 	if (typeid(*this) != typeid(other))
 		return false;
 	
@@ -907,7 +1061,9 @@ void basic::ensure_if_modifiable() const
 {
 	if (get_refcount() > 1)
 		throw(std::runtime_error("cannot modify multiply referenced object"));
-	clearflag(status_flags::hash_calculated | status_flags::evaluated);
+	if (flags & status_flags::hash_consed)
+		hash_cons_forget(*this);
+	clearflag(status_flags::hash_calculated | status_flags::evaluated | expanded_flags | status_flags::symbols_calculated | status_flags::metrics_calculated | status_flags::conjugate_invariant | status_flags::known_real);
 }
 
 //////////
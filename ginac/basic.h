@@ -23,10 +23,13 @@
 #ifndef GINAC_BASIC_H
 #define GINAC_BASIC_H
 
+#include "alloc.h"
 #include "flags.h"
 #include "ptr.h"
 #include "assertion.h"
 #include "registrar.h"
+#include "statistics.h"
+#include "memory_usage.h"
 
 // CINT needs <algorithm> to work properly with <vector>
 #include <algorithm>
@@ -35,6 +38,9 @@
 #include <set>
 #include <typeinfo> // for typeid
 #include <vector>
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+#include <atomic>
+#endif
 
 namespace GiNaC {
 
@@ -50,6 +56,37 @@ typedef std::vector<ex> exvector;
 typedef std::set<ex, ex_is_less> exset;
 typedef std::map<ex, ex, ex_is_less> exmap;
 
+/** Type of the hash values of expressions. Defining GINAC_HASH64 makes
+ *  them 64 bits wide and selects a stronger mixing function (see
+ *  hash_combine()), so that large expression trees have fewer collisions
+ *  which force deep comparisons. */
+#ifdef GINAC_HASH64
+typedef unsigned long long hash_t;
+#else
+typedef unsigned hash_t;
+#endif
+
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+/** A member of basic which const methods fill in as a cache, such as the
+ *  status flags and the hash value. Threads sharing an expression may
+ *  fill it at the same time, so it is atomic. Loads acquire and stores
+ *  release, so that a thread which sees a flag announcing a cached value
+ *  also sees the value, which is therefore stored before the flag. */
+template <typename T>
+class basic_cache {
+public:
+	basic_cache(T x = T()) : v(x) {}
+	basic_cache(const basic_cache & other) : v(T(other)) {}
+	basic_cache & operator=(const basic_cache & other) { return *this = T(other); }
+	basic_cache & operator=(T x) { v.store(x, std::memory_order_release); return *this; }
+	operator T() const { return v.load(std::memory_order_acquire); }
+	basic_cache & operator|=(T x) { v.fetch_or(x, std::memory_order_acq_rel); return *this; }
+	basic_cache & operator&=(T x) { v.fetch_and(x, std::memory_order_acq_rel); return *this; }
+private:
+	std::atomic<T> v;
+};
+#endif
+
 // Define this to enable some statistical output for comparisons and hashing
 #undef GINAC_COMPARE_STATISTICS
 
@@ -93,19 +130,89 @@ struct map_function {
 
 /** Degenerate base class for visitors. basic and derivative classes
  *  support Robert C. Martin's Acyclic Visitor pattern (cf.
- *  http://objectmentor.com/publications/acv.pdf). */
+ *  http://objectmentor.com/publications/acv.pdf).
+ *
+ *  Which visitor interfaces a visitor implements is looked up once per
+ *  visited class and remembered in a table indexed by the class tags. */
 class visitor {
+public:
+	/** Return the interface V of this visitor for the class with the given
+	 *  tag, or NULL if the visitor doesn't implement it. */
+	template <class V>
+	V *get_interface(unsigned tag)
+	{
+		if (tag < interfaces.size() && generation == registered_class_info::get_generation()) {
+			const interface_entry &i = interfaces[tag];
+			if (i.known)
+				return static_cast<V *>(i.ptr);
+		}
+		V *p = dynamic_cast<V *>(this);
+		remember_interface(tag, p);
+		return p;
+	}
+
 protected:
+	visitor() : generation(0) {}
+	// The table points into this object, so it is not copied
+	visitor(const visitor &) : generation(0) {}
+	visitor &operator=(const visitor &) { return *this; }
 	virtual ~visitor() {}
+
+private:
+	struct interface_entry {
+		interface_entry() : known(false), ptr(0) {}
+		bool known;
+		void *ptr;
+	};
+
+	void remember_interface(unsigned tag, void *ptr)
+	{
+		if (generation != registered_class_info::get_generation()) {
+			interfaces.clear();
+			generation = registered_class_info::get_generation();
+		}
+		if (tag == 0)
+			return;
+		if (tag >= interfaces.size())
+			interfaces.resize(tag + 1);
+		interfaces[tag].known = true;
+		interfaces[tag].ptr = ptr;
+	}
+
+	std::vector<interface_entry> interfaces;
+	unsigned generation;
 };
 
 
+/** Cheap size measures of an expression tree, see basic::metrics(). The
+ *  depth and the bit length saturate at 65535, the size at UINT_MAX. */
+struct tree_metrics {
+	tree_metrics(unsigned s = 1, unsigned d = 1, unsigned b = 0) : size(s), depth(d), bits(b) {}
+
+	/** Account for a subtree of a node. */
+	void add_child(const tree_metrics & c)
+	{
+		size = c.size > ~size ? ~0U : size + c.size;
+		if (c.depth >= depth)
+			depth = c.depth < 0xffff ? c.depth + 1 : 0xffff;
+		if (c.bits > bits)
+			bits = c.bits;
+	}
+
+	unsigned size;   ///< number of nodes, repeated subexpressions counted each time
+	unsigned depth;  ///< height of the tree, 1 for atoms
+	unsigned bits;   ///< largest bit length of a numerator or denominator
+};
+
+void hash_cons_forget(const basic & b);
+
 /** This class is the ABC (abstract base class) of GiNaC's class hierarchy. */
 class basic : public refcounted
 {
 	GINAC_DECLARE_REGISTERED_CLASS_NO_CTORS(basic, void)
 	
 	friend class ex;
+	friend void hash_cons_forget(const basic & b);
 	
 	// default constructor, destructor, copy constructor and assignment operator
 protected:
@@ -117,10 +224,20 @@ public:
 	virtual ~basic()
 	{
 		GINAC_ASSERT((!(flags & status_flags::dynallocated)) || (get_refcount() == 0));
+		if (flags & status_flags::hash_consed)
+			hash_cons_forget(*this);
+		if (flags & status_flags::accounted)
+			internal::forget_accounted_object(*this);
 	}
 	basic(const basic & other);
 	const basic & operator=(const basic & other);
 
+	// memory management (see alloc.h)
+	static void * operator new(std::size_t size) { return basic_alloc(size); }
+	static void operator delete(void * p, std::size_t size) { basic_free(p, size); }
+	static void * operator new(std::size_t size, void * where) { return where; }
+	static void operator delete(void * p, void * where) { }
+
 protected:
 	// new virtual functions which can be overridden by derived classes
 public: // only const functions please (may break reference counting)
@@ -174,7 +291,7 @@ public:
 	// visitors and tree traversal
 	virtual void accept(GiNaC::visitor & v) const
 	{
-		if (visitor *p = dynamic_cast<visitor *>(&v))
+		if (visitor *p = v.get_interface<visitor>(basic::get_class_info_static().get_tag()))
 			p->visit(*this);
 	}
 
@@ -183,6 +300,7 @@ public:
 	virtual int degree(const ex & s) const;
 	virtual int ldegree(const ex & s) const;
 	virtual ex coeff(const ex & s, int n = 1) const;
+	virtual void coeffs(const ex & s, std::map<int, ex> & c) const;
 
 	// expand/collect
 	virtual ex expand(unsigned options = 0) const;
@@ -224,7 +342,9 @@ protected:
 	virtual int compare_same_type(const basic & other) const;
 	virtual bool is_equal_same_type(const basic & other) const;
 
-	virtual unsigned calchash() const;
+	virtual hash_t calchash() const;
+	virtual unsigned calc_symbol_mask() const;
+	virtual tree_metrics calc_metrics() const;
 	
 	// non-virtual functions in this class
 public:
@@ -264,23 +384,71 @@ public:
 	bool is_equal(const basic & other) const;
 	const basic & hold() const;
 
-	unsigned gethash() const
+	hash_t gethash() const
 	{
 #ifdef GINAC_COMPARE_STATISTICS
 		compare_statistics.total_gethash++;
 #endif
+		internal::count_event(*this, internal::stat_gethash);
 		if (flags & status_flags::hash_calculated) {
 #ifdef GINAC_COMPARE_STATISTICS
 			compare_statistics.gethash_cached++;
 #endif
+			internal::count_event(*this, internal::stat_gethash_cached);
 			return hashvalue;
 		} else {
 			return calchash();
 		}
 	}
 
+	/** Summary of the symbols occurring in the object: the bitwise or of
+	 *  symbol::mask_bit() of their serial numbers. Different symbols may
+	 *  share a bit, so only clear bits carry information. */
+	unsigned symbol_mask() const
+	{
+		if (flags & status_flags::symbols_calculated)
+			return symmask;
+		const unsigned m = calc_symbol_mask();
+		// store it only if the object is already evaluated
+		if (flags & status_flags::evaluated) {
+			symmask = m;
+			setflag(status_flags::symbols_calculated);
+		}
+		return m;
+	}
+
+	bool may_contain(const ex & s) const;
+
+	/** Size, depth and coefficient size of the expression tree, for
+	 *  choosing between algorithms. Like the hash value, they are computed
+	 *  once and kept in the object when it is evaluated.
+	 *  @see get_metrics */
+	tree_metrics metrics() const
+	{
+		if (flags & status_flags::metrics_calculated)
+			return tree_metrics(msize, mdepth, mbits);
+		const tree_metrics m = calc_metrics();
+		if (flags & status_flags::evaluated) {
+			msize = m.size;
+			mdepth = m.depth;
+			mbits = m.bits;
+			setflag(status_flags::metrics_calculated);
+		}
+		return m;
+	}
+
 	/** Set some status_flags. */
-	const basic & setflag(unsigned f) const {flags |= f; return *this;}
+	const basic & setflag(unsigned f) const
+	{
+		const unsigned old_flags = flags;
+		if ((old_flags & f) == f)
+			return *this;
+		const unsigned born = f & ~old_flags & status_flags::dynallocated;
+		flags |= f;
+		if (born && internal::memory_accounting_active())
+			internal::account_object(*this);
+		return *this;
+	}
 
 	/** Clear some status_flags. */
 	const basic & clearflag(unsigned f) const {flags &= ~f; return *this;}
@@ -294,8 +462,21 @@ protected:
 	
 	// member variables
 protected:
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	mutable basic_cache<unsigned> flags;          ///< of type status_flags
+	mutable basic_cache<hash_t> hashvalue;        ///< hash value
+	mutable basic_cache<unsigned> symmask;        ///< see symbol_mask()
+	mutable basic_cache<unsigned> msize;          ///< see metrics()
+	mutable basic_cache<unsigned short> mdepth;   ///< see metrics()
+	mutable basic_cache<unsigned short> mbits;    ///< see metrics()
+#else
 	mutable unsigned flags;             ///< of type status_flags
-	mutable unsigned hashvalue;         ///< hash value
+	mutable hash_t hashvalue;           ///< hash value
+	mutable unsigned symmask;           ///< see symbol_mask()
+	mutable unsigned msize;             ///< see metrics()
+	mutable unsigned short mdepth;      ///< see metrics()
+	mutable unsigned short mbits;       ///< see metrics()
+#endif
 };
 
 
@@ -306,17 +487,34 @@ extern int max_recursion_level;
 
 // convenience type checker template functions
 
-/** Check if obj is a T, including base classes. */
+/** Check if obj is a T, including base classes.
+ *
+ *  This compares the class tags (see class_info). Only for classes without
+ *  their own registration (such as realsymbol, which shares that of symbol),
+ *  or while the classes are still being registered, a dynamic_cast is
+ *  needed. */
 template <class T>
 inline bool is_a(const basic &obj)
 {
+	const registered_class_info &t = T::get_class_info_static();
+	unsigned tag = obj.get_class_info().get_tag();
+	if (tag && t.get_tag()) {
+		if (tag < t.get_tag() || tag >= t.get_tag_end())
+			return false;
+		if (t.options.get_id() == &typeid(T))
+			return true;
+	}
 	return dynamic_cast<const T *>(&obj) != 0;
 }
 
-/** Check if obj is a T, not including base classes. */
+/** Check if obj is a T, not including base classes. Objects of different
+ *  registered classes are told apart by their class tags. */
 template <class T>
 inline bool is_exactly_a(const basic & obj)
 {
+	unsigned tag = obj.get_class_info().get_tag();
+	if (tag && tag != T::get_class_info_static().get_tag())
+		return false;
 	return typeid(T) == typeid(obj);
 }
 
@@ -0,0 +1,140 @@
+/** @file budget.cpp
+ *
+ *  Implementation of cancellation and resource limits of long computations. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "budget.h"
+#include "alloc.h"
+#include "parallel.h"
+
+#include <atomic>
+#include <chrono>
+
+namespace GiNaC {
+
+budget_exceeded::budget_exceeded(reason_type r_, const std::string & what_arg)
+  : std::runtime_error(what_arg), r(r_) { }
+
+budget_exceeded::reason_type budget_exceeded::reason() const
+{
+	return r;
+}
+
+struct cancellation_state {
+	cancellation_state() : flag(false) { }
+	std::atomic<bool> flag;
+};
+
+cancellation_token::cancellation_token() : state(std::make_shared<cancellation_state>()) { }
+
+void cancellation_token::cancel() const
+{
+	state->flag = true;
+}
+
+bool cancellation_token::cancelled() const
+{
+	return state->flag;
+}
+
+namespace {
+
+/** Innermost budget of this thread. */
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+thread_local const computation_budget * current = 0;
+#else
+const computation_budget * current = 0;
+#endif
+
+double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // anonymous namespace
+
+computation_budget::computation_budget()
+  : outer(current), owner(&current), has_token(false), deadline(0),
+    bytes0(basic_alloc_bytes()), max_bytes(0), nodes0(basic_alloc_count()), max_nodes(0)
+{
+	current = this;
+}
+
+computation_budget::~computation_budget()
+{
+	current = outer;
+}
+
+void computation_budget::set_time_limit(double seconds)
+{
+	deadline = now() + seconds;
+}
+
+void computation_budget::set_memory_limit(unsigned long long bytes)
+{
+	max_bytes = bytes;
+}
+
+void computation_budget::set_node_limit(unsigned long long nodes)
+{
+	max_nodes = nodes;
+}
+
+void computation_budget::set_token(const cancellation_token & t)
+{
+	token = t;
+	has_token = true;
+}
+
+void computation_budget::check() const
+{
+	if (has_token && token.cancelled())
+		throw budget_exceeded(budget_exceeded::cancelled, "computation cancelled");
+	if (deadline != 0 && now() > deadline)
+		throw budget_exceeded(budget_exceeded::time_limit, "time limit exceeded");
+	// The allocation counters are per thread, other threads only see the
+	// time limit and the token
+	if (owner != &current)
+		return;
+	if (max_bytes && basic_alloc_bytes() - bytes0 > max_bytes)
+		throw budget_exceeded(budget_exceeded::memory_limit, "memory limit exceeded");
+	if (max_nodes && basic_alloc_count() - nodes0 > max_nodes)
+		throw budget_exceeded(budget_exceeded::node_limit, "node limit exceeded");
+}
+
+void check_budget()
+{
+	for (const computation_budget * b = current; b; b = b->outer)
+		b->check();
+}
+
+const computation_budget * current_budget()
+{
+	return current;
+}
+
+const computation_budget * adopt_budget(const computation_budget * b)
+{
+	const computation_budget * previous = current;
+	current = b;
+	return previous;
+}
+
+} // namespace GiNaC
@@ -0,0 +1,127 @@
+/** @file budget.h
+ *
+ *  Interface to cancellation and resource limits of long computations. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_BUDGET_H
+#define GINAC_BUDGET_H
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace GiNaC {
+
+/** Exception thrown by check_budget() when a computation has been
+ *  cancelled or has exhausted its computation_budget. The expressions
+ *  involved are left in a valid state, so the caller may go on with a
+ *  cheaper method. */
+class budget_exceeded : public std::runtime_error {
+public:
+	enum reason_type {
+		cancelled,     ///< the cancellation_token was triggered
+		time_limit,    ///< the wall time limit has passed
+		memory_limit,  ///< too many bytes of expression objects were created
+		node_limit     ///< too many expression objects were created
+	};
+	budget_exceeded(reason_type r, const std::string & what_arg);
+	reason_type reason() const;
+private:
+	reason_type r;
+};
+
+struct cancellation_state;
+
+/** Flag for stopping a computation from another thread. Copies share the
+ *  flag, so one copy can be given to a computation_budget while another
+ *  one is kept by the thread which may cancel it. */
+class cancellation_token {
+public:
+	cancellation_token();
+	/** Request the cancellation. May be called from any thread. */
+	void cancel() const;
+	bool cancelled() const;
+private:
+	std::shared_ptr<cancellation_state> state;
+};
+
+/** Limits for the computations of the constructing thread while the object
+ *  exists. The long-running algorithms (factorization, GCDs, elimination
+ *  and determinants of matrices, expansion of products) call check_budget()
+ *  regularly, which throws budget_exceeded as soon as a limit is reached.
+ *  The tasks such an algorithm runs on other threads see the time limit
+ *  and the cancellation token of their caller. Budgets may be nested; all
+ *  enclosing budgets are checked.
+ *
+ *  Example:
+ *  @code
+ *  ex r;
+ *  try {
+ *      computation_budget b;
+ *      b.set_time_limit(10);
+ *      r = factor(e);
+ *  } catch (const budget_exceeded &) {
+ *      r = e;
+ *  }
+ *  @endcode */
+class computation_budget {
+public:
+	/** Install a budget without limits. */
+	computation_budget();
+	~computation_budget();
+
+	/** Stop after the given number of seconds from now. */
+	void set_time_limit(double seconds);
+	/** Stop when more than the given number of bytes of expression objects
+	 *  have been created since the budget was installed (see
+	 *  basic_alloc_bytes(); objects which are freed again count as well). */
+	void set_memory_limit(unsigned long long bytes);
+	/** Stop when more than the given number of expression objects have
+	 *  been created since the budget was installed. */
+	void set_node_limit(unsigned long long nodes);
+	/** Stop when the token is cancelled. */
+	void set_token(const cancellation_token & t);
+
+	/** Throw budget_exceeded if this budget (not the enclosing ones) is
+	 *  exhausted. */
+	void check() const;
+
+private:
+	computation_budget(const computation_budget &);
+	computation_budget & operator=(const computation_budget &);
+
+	friend void check_budget();
+
+	const computation_budget * outer;
+	const void * owner;  ///< identifies the installing thread
+	cancellation_token token;
+	bool has_token;
+	double deadline;     ///< seconds on the steady clock, or 0
+	unsigned long long bytes0, max_bytes;  ///< max_bytes == 0: no limit
+	unsigned long long nodes0, max_nodes;  ///< max_nodes == 0: no limit
+};
+
+/** Throw budget_exceeded if one of the budgets installed in the calling
+ *  thread is exhausted. Does nothing if there is none. */
+void check_budget();
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_BUDGET_H
@@ -0,0 +1,117 @@
+/** @file builder.cpp
+ *
+ *  Implementation of the accumulators for building large sums and
+ *  products. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "builder.h"
+#include "add.h"
+#include "mul.h"
+#include "power.h"
+#include "operators.h"
+#include "flags.h"
+#include "utils.h"
+
+#include <algorithm>
+
+namespace GiNaC {
+
+/** Fewest terms collected before they are combined. Below this, the
+ *  combination costs more than the memory it saves. */
+static const size_t min_combine_at = 1024;
+
+add_builder::add_builder(size_t expected_terms)
+ : combine_at(std::max(expected_terms, min_combine_at))
+{
+	terms.reserve(expected_terms);
+}
+
+add_builder & add_builder::operator+=(const ex & e)
+{
+	terms.push_back(e);
+	if (terms.size() > combine_at)
+		combine();
+	return *this;
+}
+
+add_builder & add_builder::operator-=(const ex & e)
+{
+	return *this += (new mul(e, _ex_1))->setflag(status_flags::dynallocated);
+}
+
+/** Replace the collected terms by their sum, which the next combination
+ *  flattens again. */
+void add_builder::combine()
+{
+	const ex sum = (new add(terms))->setflag(status_flags::dynallocated);
+	terms.clear();
+	terms.push_back(sum);
+	combine_at = std::max(combine_at, 2 * sum.nops());
+}
+
+ex add_builder::finish()
+{
+	const ex sum = (new add(terms))->setflag(status_flags::dynallocated);
+	terms.clear();
+	return sum;
+}
+
+mul_builder::mul_builder(size_t expected_factors)
+ : combine_at(std::max(expected_factors, min_combine_at))
+{
+	factors.reserve(expected_factors);
+}
+
+mul_builder & mul_builder::operator*=(const ex & e)
+{
+	if (e.return_type() != return_types::commutative) {
+		const ex product = finish();
+		factors.push_back(product * e);
+		return *this;
+	}
+	factors.push_back(e);
+	if (factors.size() > combine_at)
+		combine();
+	return *this;
+}
+
+mul_builder & mul_builder::operator/=(const ex & e)
+{
+	return *this *= power(e, _ex_1);
+}
+
+/** Replace the collected factors by their product, which the next
+ *  combination flattens again. */
+void mul_builder::combine()
+{
+	const ex product = (new mul(factors))->setflag(status_flags::dynallocated);
+	factors.clear();
+	factors.push_back(product);
+	combine_at = std::max(combine_at, 2 * product.nops());
+}
+
+ex mul_builder::finish()
+{
+	const ex product = (new mul(factors))->setflag(status_flags::dynallocated);
+	factors.clear();
+	return product;
+}
+
+} // namespace GiNaC
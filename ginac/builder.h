@@ -0,0 +1,96 @@
+/** @file builder.h
+ *
+ *  Interface to accumulators for building large sums and products. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_BUILDER_H
+#define GINAC_BUILDER_H
+
+#include "ex.h"
+
+#include <cstddef> // for size_t
+
+namespace GiNaC {
+
+/** Accumulator for a sum of many terms. Adding terms one by one with
+ *  s += t builds a new add object in every step, which copies and
+ *  recombines all the terms collected so far, so n steps take O(n^2)
+ *  time. Here the terms are collected in a vector, and like terms are
+ *  combined (through a hash table, see expairseq) only when the vector
+ *  has grown to twice the size of the combined sum, and by finish(). The
+ *  total time is linear in the number of terms.
+ *
+ *  @code
+ *  add_builder b(n);
+ *  for (int i = 0; i < n; ++i)
+ *      b += term(i);
+ *  ex s = b.finish();
+ *  @endcode */
+class add_builder {
+public:
+	/** Start an empty sum, with room for expected_terms terms. */
+	explicit add_builder(size_t expected_terms = 0);
+
+	add_builder & operator+=(const ex & e);
+	add_builder & operator-=(const ex & e);
+
+	/** Number of terms added since the last combination. */
+	size_t size() const { return terms.size(); }
+
+	/** Return the sum of all terms, in canonical form, and start a new,
+	 *  empty sum. */
+	ex finish();
+
+private:
+	void combine();
+
+	exvector terms;
+	size_t combine_at;  ///< size of terms at which they are combined
+};
+
+/** Accumulator for a product of many factors, like add_builder for sums.
+ *  Powers of the same basis are combined. Non-commutative factors are
+ *  multiplied with the factors collected so far right away, so that
+ *  their order is kept. */
+class mul_builder {
+public:
+	/** Start an empty product, with room for expected_factors factors. */
+	explicit mul_builder(size_t expected_factors = 0);
+
+	mul_builder & operator*=(const ex & e);
+	mul_builder & operator/=(const ex & e);
+
+	/** Number of factors multiplied since the last combination. */
+	size_t size() const { return factors.size(); }
+
+	/** Return the product of all factors, in canonical form, and start a
+	 *  new, empty product. */
+	ex finish();
+
+private:
+	void combine();
+
+	exvector factors;
+	size_t combine_at;  ///< size of factors at which they are combined
+};
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_BUILDER_H
@@ -36,22 +36,38 @@ namespace GiNaC {
 
 // OPT is the class that stores the actual per-class data. It must provide
 // get_name(), get_parent_name() and get_id() members.
+//
+// Every registered class gets a tag: the classes are numbered in a depth-first
+// walk of the class tree, so that the classes derived from a class (directly
+// or not) have the tags following its own. Checking whether a class is
+// derived from another is then a comparison of integers. The numbering is
+// redone each time a class is registered.
 
 template <class OPT>
 class class_info {
 public:
-	class_info(const OPT & o) : options(o), next(first), parent(NULL)
+	class_info(const OPT & o) : options(o), next(first), parent(NULL), tag(0), tag_end(0)
 	{
 		first = this;
-		parents_identified = false;
+		number_classes();
 	}
 
 	/** Get pointer to class_info of parent class (or NULL). */
-	class_info *get_parent() const
-	{
-		identify_parents();
-		return parent;
-	}
+	class_info *get_parent() const { return parent; }
+
+	/** Tag of the class (starting with 1). */
+	unsigned get_tag() const { return tag; }
+
+	/** End of the range of tags of this class and the classes derived
+	 *  from it. */
+	unsigned get_tag_end() const { return tag_end; }
+
+	/** Check whether the class c is this class or derived from it. */
+	bool is_base_of(const class_info &c) const { return tag <= c.tag && c.tag < tag_end; }
+
+	/** Number of times the classes have been renumbered, so that tables
+	 *  indexed by tags can tell when they become invalid. */
+	static unsigned get_generation() { return generation; }
 
 	/** Find class_info by name. */
 	static const class_info *find(const std::string &class_name);
@@ -71,13 +87,16 @@ private:
 	};
 
 	static void dump_tree(tree_node *n, const std::string & prefix, bool verbose);
-	static void identify_parents();
+	static void number_classes();
+	static unsigned number_subtree(class_info *p, const std::vector<std::vector<class_info *> > &children,
+	                               const std::map<const class_info *, size_t> &index, unsigned next_tag);
 
 	static class_info *first;
 	class_info *next;
-	mutable class_info *parent;
+	class_info *parent;
+	unsigned tag, tag_end;
 
-	static bool parents_identified;
+	static unsigned generation;
 };
 
 template <class OPT>
@@ -147,8 +166,6 @@ void class_info<OPT>::dump_tree(tree_node *n, const std::string & prefix, bool v
 template <class OPT>
 void class_info<OPT>::dump_hierarchy(bool verbose)
 {
-	identify_parents();
-
 	// Create tree nodes for all class_infos
 	std::vector<tree_node> tree;
 	for (class_info *p = first; p; p = p->next)
@@ -174,24 +191,52 @@ void class_info<OPT>::dump_hierarchy(bool verbose)
 }
 
 template <class OPT>
-void class_info<OPT>::identify_parents()
+void class_info<OPT>::number_classes()
 {
-	if (!parents_identified) {
-		for (class_info *p = first; p; p = p->next) {
-			const char *parent_name = p->options.get_parent_name();
-			for (class_info *q = first; q; q = q->next) {
-				if (std::strcmp(q->options.get_name(), parent_name) == 0) {
-					p->parent = q;
-					break;
-				}
-			}
-		}
-		parents_identified = true;
+	// Find the parents. If several classes have the same name, the one
+	// registered last is used.
+	typedef std::map<std::string, class_info *> name_map_type;
+	name_map_type name_map;
+	std::vector<class_info *> all;
+	for (class_info *p = first; p; p = p->next) {
+		name_map.insert(std::make_pair(std::string(p->options.get_name()), p));
+		all.push_back(p);
+	}
+	std::map<const class_info *, size_t> index;
+	for (size_t i = 0; i < all.size(); ++i)
+		index[all[i]] = i;
+
+	std::vector<std::vector<class_info *> > children(all.size());
+	for (size_t i = 0; i < all.size(); ++i) {
+		typename name_map_type::const_iterator it = name_map.find(all[i]->options.get_parent_name());
+		all[i]->parent = (it == name_map.end() || it->second == all[i]) ? NULL : it->second;
+		if (all[i]->parent)
+			children[index[all[i]->parent]].push_back(all[i]);
+	}
+
+	// Number the trees, in the order of registration
+	unsigned next_tag = 1;
+	for (size_t i = all.size(); i-- > 0; ) {
+		if (!all[i]->parent)
+			next_tag = number_subtree(all[i], children, index, next_tag);
 	}
+	++generation;
+}
+
+template <class OPT>
+unsigned class_info<OPT>::number_subtree(class_info *p, const std::vector<std::vector<class_info *> > &children,
+                                         const std::map<const class_info *, size_t> &index, unsigned next_tag)
+{
+	p->tag = next_tag++;
+	const std::vector<class_info *> &c = children[index.find(p)->second];
+	for (size_t i = c.size(); i-- > 0; )
+		next_tag = number_subtree(c[i], children, index, next_tag);
+	p->tag_end = next_tag;
+	return next_tag;
 }
 
 template <class OPT> class_info<OPT> *class_info<OPT>::first = NULL;
-template <class OPT> bool class_info<OPT>::parents_identified = false;
+template <class OPT> unsigned class_info<OPT>::generation = 0;
 
 } // namespace GiNaC
 
@@ -36,9 +36,11 @@
 #include "power.h"
 #include "matrix.h"
 #include "archive.h"
+#include "parallel.h"
 #include "utils.h"
 
 #include <stdexcept>
+#include <unordered_map>
 
 namespace GiNaC {
 
@@ -229,6 +231,12 @@ ex clifford::subs(const exmap & m, unsigned options) const
 	return subsed;
 }
 
+unsigned clifford::calc_symbol_mask() const
+{
+	// subs() substitutes in the metric, too
+	return inherited::calc_symbol_mask() | ex_to<basic>(metric).symbol_mask();
+}
+
 int clifford::compare_same_type(const basic & other) const
 {
 	GINAC_ASSERT(is_a<clifford>(other));
@@ -816,10 +824,78 @@ static unsigned char get_representation_label(const return_type_t& ti)
 	return (unsigned char)ti.rl;
 }
 
+/** Hash function for strings of objects, for unordered maps keyed on
+ *  exvectors. */
+struct string_hash {
+	size_t operator()(const exvector & v) const
+	{
+		hash_t h = v.size();
+		for (exvector::const_iterator it=v.begin(); it!=v.end(); ++it)
+			h = hash_combine(h, it->gethash());
+		return h;
+	}
+};
+
+struct string_equal {
+	bool operator()(const exvector & a, const exvector & b) const
+	{
+		if (a.size() != b.size())
+			return false;
+		for (size_t i=0; i<a.size(); ++i)
+			if (!a[i].is_equal(b[i]))
+				return false;
+		return true;
+	}
+};
+
+/** Traces of strings of an even number of Dirac gammas given by vectors of
+ *  indices, remembered for the strings of more than four gammas. The
+ *  recursion for the trace of a string of n gammas visits (n-1)!! strings,
+ *  but far fewer different ones, which also recur in the traces of the
+ *  other terms of an expression. */
+class trace_table {
+public:
+	ex trace(const exvector & ix);
+	ex expand_trace(const exvector & ix, size_t i);
+
+private:
+	std::unordered_map<exvector, ex, string_hash, string_equal> traces;
+};
+
+/** Representative of the strings with the same trace as ix, obtained by
+ *  rotating or reversing it: the smallest one in the order of ex::compare(). */
+static exvector canonical_string(const exvector & ix)
+{
+	const size_t num = ix.size();
+	size_t best_start = 0;
+	bool best_reversed = false;
+	for (int reversed=0; reversed<2; ++reversed) {
+		for (size_t start=0; start<num; ++start) {
+			for (size_t k=0; k<num; ++k) {
+				const ex & a = reversed ? ix[(start + num - k) % num] : ix[(start + k) % num];
+				const ex & b = best_reversed ? ix[(best_start + num - k) % num] : ix[(best_start + k) % num];
+				const int c = a.compare(b);
+				if (c < 0) {
+					best_start = start;
+					best_reversed = reversed;
+				}
+				if (c != 0)
+					break;
+			}
+		}
+	}
+	exvector v(num);
+	for (size_t k=0; k<num; ++k)
+		v[k] = best_reversed ? ix[(best_start + num - k) % num] : ix[(best_start + k) % num];
+	return v;
+}
+
 /** Take trace of a string of an even number of Dirac gammas given a vector
  *  of indices. */
-static ex trace_string(exvector::const_iterator ix, size_t num)
+ex trace_table::trace(const exvector & ix)
 {
+	const size_t num = ix.size();
+
 	// Tr gamma.mu gamma.nu = 4 g.mu.nu
 	if (num == 2)
 		return lorentz_g(ix[0], ix[1]);
@@ -830,29 +906,93 @@ static ex trace_string(exvector::const_iterator ix, size_t num)
 		     + lorentz_g(ix[1], ix[2]) * lorentz_g(ix[0], ix[3])
 		     - lorentz_g(ix[0], ix[2]) * lorentz_g(ix[1], ix[3]);
 
-	// Traces of 6 or more gammas are computed recursively:
-	// Tr gamma.mu1 gamma.mu2 ... gamma.mun =
-	//   + g.mu1.mu2 * Tr gamma.mu3 ... gamma.mun
-	//   - g.mu1.mu3 * Tr gamma.mu2 gamma.mu4 ... gamma.mun
-	//   + g.mu1.mu4 * Tr gamma.mu3 gamma.mu3 gamma.mu5 ... gamma.mun
-	//   - ...
-	//   + g.mu1.mun * Tr gamma.mu2 ... gamma.mu(n-1)
-	exvector v(num - 2);
-	int sign = 1;
-	ex result;
-	for (size_t i=1; i<num; i++) {
-		for (size_t n=1, j=0; n<num; n++) {
-			if (n == i)
-				continue;
-			v[j++] = ix[n];
-		}
-		result += sign * lorentz_g(ix[0], ix[i]) * trace_string(v.begin(), num-2);
-		sign = -sign;
-	}
+	// The trace of a string without gamma5 doesn't change under rotations
+	// and reversal
+	const exvector key = canonical_string(ix);
+	std::unordered_map<exvector, ex, string_hash, string_equal>::const_iterator it = traces.find(key);
+	if (it != traces.end())
+		return it->second;
+
+	exvector terms;
+	terms.reserve(num - 1);
+	for (size_t i=1; i<num; ++i)
+		terms.push_back(expand_trace(key, i));
+	const ex result = (new add(terms))->setflag(status_flags::dynallocated);
+	traces[key] = result;
 	return result;
 }
 
-ex dirac_trace(const ex & e, const std::set<unsigned char> & rls, const ex & trONE)
+/** Term i of the recursion for the trace of a string of 6 or more gammas:
+ *  Tr gamma.mu1 gamma.mu2 ... gamma.mun =
+ *    + g.mu1.mu2 * Tr gamma.mu3 ... gamma.mun
+ *    - g.mu1.mu3 * Tr gamma.mu2 gamma.mu4 ... gamma.mun
+ *    + g.mu1.mu4 * Tr gamma.mu3 gamma.mu3 gamma.mu5 ... gamma.mun
+ *    - ...
+ *    + g.mu1.mun * Tr gamma.mu2 ... gamma.mu(n-1) */
+ex trace_table::expand_trace(const exvector & ix, size_t i)
+{
+	const size_t num = ix.size();
+	exvector v;
+	v.reserve(num - 2);
+	for (size_t n=1; n<num; n++)
+		if (n != i)
+			v.push_back(ix[n]);
+	const ex term = lorentz_g(ix[0], ix[i]) * trace(v);
+	return i % 2 ? term : -term;
+}
+
+/** Minimal number of gammas in a string whose trace is split over several
+ *  threads with dirac_trace_options::parallel. */
+static const size_t parallel_trace_length = 10;
+
+/** Computes the terms of the top-level recursion for a trace, each with
+ *  its own table. */
+struct trace_term_task : public parallel_task {
+	trace_term_task(const exvector & i, exvector & t) : ix(i), terms(t) {}
+	void operator()(size_t i)
+	{
+		trace_table table;
+		terms[i] = table.expand_trace(ix, i + 1);
+	}
+	const exvector & ix;
+	exvector & terms;
+};
+
+/** Take trace of a string of an even number of Dirac gammas given a vector
+ *  of indices, splitting the recursion over several threads if requested. */
+static ex trace_string(const exvector & ix, trace_table & table, unsigned options)
+{
+	const size_t num = ix.size();
+	bool parallel = (options & dirac_trace_options::parallel) && num >= parallel_trace_length
+	             && parallel_threads(num - 1) > 1;
+	for (size_t i=0; parallel && i<num; ++i) {
+		parallel = numerics_are_immediate(ix[i]);
+		ix[i].gethash();
+	}
+	if (!parallel)
+		return table.trace(ix);
+
+	exvector terms(num - 1);
+	trace_term_task task(ix, terms);
+	parallel_for(num - 1, task);
+	return (new add(terms))->setflag(status_flags::dynallocated);
+}
+
+static ex dirac_trace(const ex & e, const std::set<unsigned char> & rls, const ex & trONE, unsigned options, trace_table & table);
+
+/** Applies dirac_trace() to the operands of a container, sharing the
+ *  table of traces. */
+struct dirac_trace_map_function : public map_function {
+	dirac_trace_map_function(const std::set<unsigned char> & r, const ex & t, unsigned o, trace_table & tt)
+	 : rls(r), trONE(t), options(o), table(tt) {}
+	ex operator()(const ex & e) { return dirac_trace(e, rls, trONE, options, table); }
+	const std::set<unsigned char> & rls;
+	const ex & trONE;
+	unsigned options;
+	trace_table & table;
+};
+
+static ex dirac_trace(const ex & e, const std::set<unsigned char> & rls, const ex & trONE, unsigned options, trace_table & table)
 {
 	if (is_a<clifford>(e)) {
 
@@ -878,7 +1018,7 @@ ex dirac_trace(const ex & e, const std::set<unsigned char> & rls, const ex & trO
 		for (size_t i=0; i<e.nops(); i++) {
 			const ex &o = e.op(i);
 			if (is_clifford_tinfo(o.return_type_tinfo()))
-				prod *= dirac_trace(o, rls, trONE);
+				prod *= dirac_trace(o, rls, trONE, options, table);
 			else
 				prod *= o;
 		}
@@ -898,7 +1038,7 @@ ex dirac_trace(const ex & e, const std::set<unsigned char> & rls, const ex & trO
 			dirac_gammaR(rl) == (dirac_ONE(rl)+dirac_gamma5(rl))/2
 		), subs_options::no_pattern).expand();
 		if (!is_a<ncmul>(e_expanded))
-			return dirac_trace(e_expanded, rls, trONE);
+			return dirac_trace(e_expanded, rls, trONE, options, table);
 
 		// gamma5 gets moved to the front so this check is enough
 		bool has_gamma5 = is_a<diracgamma5>(e.op(0).op(0));
@@ -930,7 +1070,7 @@ ex dirac_trace(const ex & e, const std::set<unsigned char> & rls, const ex & trO
 				base_and_index(e.op(i), bv[i-1], ix[i-1]);
 			num--;
 			int *iv = new int[num];
-			ex result;
+			exvector terms;
 			for (size_t i=0; i<num-3; i++) {
 				ex idx1 = ix[i];
 				for (size_t j=i+1; j<num-2; j++) {
@@ -949,13 +1089,14 @@ ex dirac_trace(const ex & e, const std::set<unsigned char> & rls, const ex & trO
 								v.push_back(ix[n]);
 							}
 							int sign = permutation_sign(iv, iv + num);
-							result += sign * lorentz_eps(ex_to<idx>(idx1).replace_dim(_ex4), ex_to<idx>(idx2).replace_dim(_ex4), ex_to<idx>(idx3).replace_dim(_ex4), ex_to<idx>(idx4).replace_dim(_ex4))
-							        * trace_string(v.begin(), num - 4);
+							terms.push_back(sign * lorentz_eps(ex_to<idx>(idx1).replace_dim(_ex4), ex_to<idx>(idx2).replace_dim(_ex4), ex_to<idx>(idx3).replace_dim(_ex4), ex_to<idx>(idx4).replace_dim(_ex4))
+							                * table.trace(v));
 						}
 					}
 				}
 			}
 			delete[] iv;
+			const ex result = (new add(terms))->setflag(status_flags::dynallocated);
 			return trONE * I * result * mul(bv);
 
 		} else { // no gamma5
@@ -976,20 +1117,26 @@ ex dirac_trace(const ex & e, const std::set<unsigned char> & rls, const ex & trO
 			for (size_t i=0; i<num; i++)
 				base_and_index(e.op(i), bv[i], iv[i]);
 
-			return trONE * (trace_string(iv.begin(), num) * mul(bv)).simplify_indexed();
+			return trONE * (trace_string(iv, table, options) * mul(bv)).simplify_indexed();
 		}
 
 	} else if (e.nops() > 0) {
 
 		// Trace maps to all other container classes (this includes sums)
-		pointer_to_map_function_2args<const std::set<unsigned char> &, const ex &> fcn(dirac_trace, rls, trONE);
+		dirac_trace_map_function fcn(rls, trONE, options, table);
 		return e.map(fcn);
 
 	} else
 		return _ex0;
 }
 
-ex dirac_trace(const ex & e, const lst & rll, const ex & trONE)
+ex dirac_trace(const ex & e, const std::set<unsigned char> & rls, const ex & trONE, unsigned options)
+{
+	trace_table table;
+	return dirac_trace(e, rls, trONE, options, table);
+}
+
+ex dirac_trace(const ex & e, const lst & rll, const ex & trONE, unsigned options)
 {
 	// Convert list to set
 	std::set<unsigned char> rls;
@@ -998,18 +1145,66 @@ ex dirac_trace(const ex & e, const lst & rll, const ex & trONE)
 			rls.insert(ex_to<numeric>(*i).to_int());
 	}
 
-	return dirac_trace(e, rls, trONE);
+	return dirac_trace(e, rls, trONE, options);
 }
 
-ex dirac_trace(const ex & e, unsigned char rl, const ex & trONE)
+ex dirac_trace(const ex & e, unsigned char rl, const ex & trONE, unsigned options)
 {
 	// Convert label to set
 	std::set<unsigned char> rls;
 	rls.insert(rl);
 
-	return dirac_trace(e, rls, trONE);
+	return dirac_trace(e, rls, trONE, options);
+}
+
+
+/** Linear combination of strings of Clifford units in canonical order,
+ *  with the strings as keys and their coefficients as values. */
+typedef std::unordered_map<exvector, ex, string_hash, string_equal> clifford_combination;
+
+static void add_to_combination(clifford_combination & result, const exvector & s, const ex & c)
+{
+	if (c.is_zero())
+		return;
+	std::pair<clifford_combination::iterator, bool> ins = result.insert(std::make_pair(s, c));
+	if (!ins.second) {
+		ins.first->second += c;
+		if (ins.first->second.is_zero())
+			result.erase(ins.first);
+	}
 }
 
+/** Multiply the string s, which is in canonical order, from the right by
+ *  the Clifford unit x and add c times the result, also in canonical
+ *  order, to result. x is moved to the left past the larger units a with
+ *  a*x = 2*B(a,x) + sign*x*a, where B is the (symmetrised) metric; each
+ *  step gives one term without a and x. */
+static void multiply_canonical(const exvector & s, const ex & x, const ex & c, clifford_combination & result)
+{
+	exvector w(s);
+	w.push_back(x);
+	ex coeff = c;
+	size_t pos = s.size();
+	while (pos > 0 && s[pos - 1].compare(x) > 0) {
+		const ex & a = s[pos - 1];
+		const clifford & ca = ex_to<clifford>(a);
+		ex b1, i1, b2, i2;
+		base_and_index(a, b1, i1);
+		base_and_index(x, b2, i2);
+		const ex metric = (ca.get_metric(i1, i2, ca.get_commutator_sign() == -1) * b1 * b2).simplify_indexed();
+
+		exvector rest;
+		rest.reserve(s.size() - 1);
+		rest.insert(rest.end(), s.begin(), s.begin() + (pos - 1));
+		rest.insert(rest.end(), s.begin() + pos, s.end());
+		add_to_combination(result, rest, _ex2 * coeff * metric);
+
+		coeff *= ca.get_commutator_sign();
+		std::swap(w[pos - 1], w[pos]);
+		--pos;
+	}
+	add_to_combination(result, w, coeff);
+}
 
 ex canonicalize_clifford(const ex & e_)
 {
@@ -1041,36 +1236,49 @@ ex canonicalize_clifford(const ex & e_)
 				} else if (!is_a<clifford>(rhs.op(0)))
 					continue;
 
-				exvector v;
-				v.reserve(rhs.nops());
-				for (size_t j=0; j<rhs.nops(); j++)
-					v.push_back(rhs.op(j));
-
-				// Stupid recursive bubble sort because we only want to swap adjacent gammas
-				exvector::iterator it = v.begin(), next_to_last = v.end() - 1;
-				if (is_a<diracgamma5>(it->op(0)) || is_a<diracgammaL>(it->op(0)) || is_a<diracgammaR>(it->op(0)))
-					++it;
-
-				while (it != next_to_last) {
-					if (it[0].compare(it[1]) > 0) {
-
-						ex save0 = it[0], save1 = it[1];
-						ex b1, i1, b2, i2;
-						base_and_index(it[0], b1, i1);
-						base_and_index(it[1], b2, i2);
-						// for Clifford algebras (commutator_sign == -1) metric should be symmetrised
-						it[0] = (ex_to<clifford>(save0).get_metric(i1, i2, ex_to<clifford>(save0).get_commutator_sign() == -1) * b1 * b2).simplify_indexed();
-						it[1] = v.size() ? _ex2 * dirac_ONE(ex_to<clifford>(save0).get_representation_label()) : _ex2;
-						ex sum = ncmul(v);
-						it[0] = save1;
-						it[1] = save0;
-						sum += ex_to<clifford>(save0).get_commutator_sign() * ncmul(v, true);
-						i->second = canonicalize_clifford(sum);
-						goto next_sym;
-					}
-					++it;
+				// A leading gamma5 (or L/R) stays in front
+				exvector prefix;
+				size_t first = 0;
+				const ex & front = rhs.op(0).op(0);
+				if (is_a<diracgamma5>(front) || is_a<diracgammaL>(front) || is_a<diracgammaR>(front)) {
+					prefix.push_back(rhs.op(0));
+					first = 1;
+				}
+
+				// Bring the units into canonical order one at a time,
+				// collecting equal strings; sorting by swapping adjacent
+				// units only gives rise to the same strings over and over
+				bool units_only = true, sorted = true;
+				for (size_t j=first; j<rhs.nops(); ++j) {
+					if (!is_a<clifford>(rhs.op(j)))
+						units_only = false;
+					else if (j > first && rhs.op(j - 1).compare(rhs.op(j)) > 0)
+						sorted = false;
+				}
+				if (!units_only || sorted)
+					continue;
+
+				clifford_combination current, next;
+				current[exvector()] = _ex1;
+				for (size_t j=first; j<rhs.nops(); ++j) {
+					next.clear();
+					for (clifford_combination::const_iterator it=current.begin(); it!=current.end(); ++it)
+						multiply_canonical(it->first, rhs.op(j), it->second, next);
+					current.swap(next);
+				}
+
+				const unsigned char rl = ex_to<clifford>(rhs.op(0)).get_representation_label();
+				exvector terms;
+				terms.reserve(current.size());
+				for (clifford_combination::const_iterator it=current.begin(); it!=current.end(); ++it) {
+					exvector units(prefix);
+					units.insert(units.end(), it->first.begin(), it->first.end());
+					if (units.empty())
+						terms.push_back(it->second * dirac_ONE(rl));
+					else
+						terms.push_back(it->second * ncmul(units));
 				}
-next_sym:	;
+				i->second = (new add(terms))->setflag(status_flags::dynallocated);
 			}
 		}
 		return aux.subs(srl, subs_options::no_pattern).simplify_indexed();
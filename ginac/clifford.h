@@ -61,6 +61,7 @@ protected:
 	ex thiscontainer(std::shared_ptr<exvector> vp) const;
 	unsigned return_type() const { return return_types::noncommutative; }
 	return_type_t return_type_tinfo() const;
+	unsigned calc_symbol_mask() const;
 	// non-virtual functions in this class
 public:
 	unsigned char get_representation_label() const { return representation_label; }
@@ -244,11 +245,14 @@ ex dirac_slash(const ex & e, const ex & dim, unsigned char rl = 0);
  *  The computed trace is a linear functional that is equal to the usual
  *  trace only in D = 4 dimensions. In particular, the functional is not
  *  always cyclic in D != 4 dimensions when gamma5 is involved.
+ *  Traces of identical strings of gammas, also as parts of longer strings,
+ *  are computed once per call.
  *
  *  @param e Expression to take the trace of
  *  @param rls Set of representation labels
- *  @param trONE Expression to be returned as the trace of the unit matrix */
-ex dirac_trace(const ex & e, const std::set<unsigned char> & rls, const ex & trONE = 4);
+ *  @param trONE Expression to be returned as the trace of the unit matrix
+ *  @param options See dirac_trace_options */
+ex dirac_trace(const ex & e, const std::set<unsigned char> & rls, const ex & trONE = 4, unsigned options = 0);
 
 /** Calculate dirac traces over the specified list of representation labels.
  *  The computed trace is a linear functional that is equal to the usual
@@ -257,8 +261,9 @@ ex dirac_trace(const ex & e, const std::set<unsigned char> & rls, const ex & trO
  *
  *  @param e Expression to take the trace of
  *  @param rll List of representation labels
- *  @param trONE Expression to be returned as the trace of the unit matrix */
-ex dirac_trace(const ex & e, const lst & rll, const ex & trONE = 4);
+ *  @param trONE Expression to be returned as the trace of the unit matrix
+ *  @param options See dirac_trace_options */
+ex dirac_trace(const ex & e, const lst & rll, const ex & trONE = 4, unsigned options = 0);
 
 /** Calculate the trace of an expression containing gamma objects with
  *  a specified representation label. The computed trace is a linear
@@ -268,8 +273,9 @@ ex dirac_trace(const ex & e, const lst & rll, const ex & trONE = 4);
  *
  *  @param e Expression to take the trace of
  *  @param rl Representation label
- *  @param trONE Expression to be returned as the trace of the unit matrix */
-ex dirac_trace(const ex & e, unsigned char rl = 0, const ex & trONE = 4);
+ *  @param trONE Expression to be returned as the trace of the unit matrix
+ *  @param options See dirac_trace_options */
+ex dirac_trace(const ex & e, unsigned char rl = 0, const ex & trONE = 4, unsigned options = 0);
 
 /** Bring all products of clifford objects in an expression into a canonical
  *  order. This is not necessarily the most simple form but it will allow
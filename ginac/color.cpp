@@ -23,17 +23,23 @@
 #include "color.h"
 #include "idx.h"
 #include "ncmul.h"
+#include "tensor.h"
 #include "symmetry.h"
 #include "operators.h"
 #include "numeric.h"
+#include "add.h"
 #include "mul.h"
 #include "power.h" // for sqrt()
 #include "symbol.h"
 #include "archive.h"
+#include "hash_map.h"
 #include "utils.h"
 
+#include <algorithm>
 #include <iostream>
+#include <map>
 #include <stdexcept>
+#include <vector>
 
 namespace GiNaC {
 
@@ -642,4 +648,318 @@ ex color_trace(const ex & e, unsigned char rl)
 	return color_trace(e, rls);
 }
 
+namespace {
+
+/** Laurent polynomial in N, as the coefficients of the powers of N. */
+typedef std::map<int, numeric> N_poly;
+
+/** Add c*N^shift*b to a. */
+void add_N_poly(N_poly & a, const N_poly & b, const numeric & c, int shift)
+{
+	for (N_poly::const_iterator it=b.begin(); it!=b.end(); ++it) {
+		numeric & x = a[it->first + shift];
+		x += c * it->second;
+		if (x.is_zero())
+			a.erase(it->first + shift);
+	}
+}
+
+/** Product of traces of strings of generators of SU(N) in the fundamental
+ *  representation, each given as the cycle of the labels of the adjoint
+ *  indices of its generators. Every label occurs twice. This is the
+ *  birdtrack of the color structure, with the gluon lines not yet
+ *  removed. */
+typedef std::vector<std::vector<int> > trace_product;
+
+/** Evaluation of fully contracted color structures for SU(N). Every gluon
+ *  line is removed with the Fierz identity
+ *      T^a_ij T^a_kl = 1/2 (delta_il delta_kj - 1/N delta_ij delta_kl),
+ *  which turns a product of traces into two with one label less, until
+ *  only traces of the unit matrix (N) remain. Structures which recur in
+ *  this recursion are evaluated once. */
+class color_graph {
+public:
+	N_poly evaluate(const trace_product & t);
+
+private:
+	static bool normalize(const trace_product & t, trace_product & key, int & loops);
+
+	std::map<trace_product, N_poly> memo;
+};
+
+/** Bring t into a normal form, with empty traces removed (their number is
+ *  returned in loops), the traces sorted by length, and the labels
+ *  numbered in the order of their appearance. Structures which only
+ *  differ by the naming of the labels or the order of the traces mostly
+ *  have the same normal form. Returns false if t vanishes, because it
+ *  contains the trace of a single generator. */
+bool color_graph::normalize(const trace_product & t, trace_product & key, int & loops)
+{
+	trace_product sorted;
+	loops = 0;
+	for (trace_product::const_iterator it=t.begin(); it!=t.end(); ++it) {
+		if (it->empty())
+			++loops;
+		else if (it->size() == 1)
+			return false;
+		else
+			sorted.push_back(*it);
+	}
+	struct shorter {
+		bool operator()(const std::vector<int> & a, const std::vector<int> & b) const { return a.size() < b.size(); }
+	};
+	std::stable_sort(sorted.begin(), sorted.end(), shorter());
+
+	std::map<int, int> label;
+	key.clear();
+	key.reserve(sorted.size());
+	for (trace_product::const_iterator it=sorted.begin(); it!=sorted.end(); ++it) {
+		// Start the cycle at its label which was numbered first, if any
+		const size_t n = it->size();
+		size_t start = 0;
+		int first = -1;
+		for (size_t k=0; k<n; ++k) {
+			std::map<int, int>::const_iterator l = label.find((*it)[k]);
+			if (l != label.end() && (first < 0 || l->second < first)) {
+				first = l->second;
+				start = k;
+			}
+		}
+		std::vector<int> cycle(n);
+		for (size_t k=0; k<n; ++k) {
+			const int old = (*it)[(start + k) % n];
+			std::map<int, int>::const_iterator l = label.find(old);
+			if (l == label.end())
+				l = label.insert(std::make_pair(old, int(label.size()))).first;
+			cycle[k] = l->second;
+		}
+		key.push_back(cycle);
+	}
+	return true;
+}
+
+N_poly color_graph::evaluate(const trace_product & t)
+{
+	trace_product key;
+	int loops;
+	N_poly result;
+	if (!normalize(t, key, loops))
+		return result;
+	if (key.empty()) {
+		result[loops] = *_num1_p;
+		return result;
+	}
+
+	std::map<trace_product, N_poly>::const_iterator m = memo.find(key);
+	if (m != memo.end()) {
+		add_N_poly(result, m->second, *_num1_p, loops);
+		return result;
+	}
+
+	// Remove the gluon line of the first label of the first trace
+	const std::vector<int> & c0 = key[0];
+	const int a = c0[0];
+	trace_product t1, t2;
+	size_t other = 0, pos = 0;
+	bool found = false;
+	for (size_t i=0; i<key.size() && !found; ++i)
+		for (size_t k=(i==0 ? 1 : 0); k<key[i].size() && !found; ++k)
+			if (key[i][k] == a) {
+				other = i;
+				pos = k;
+				found = true;
+			}
+	if (!found)
+		throw std::logic_error("color_graph::evaluate(): unpaired label");
+	for (size_t i=1; i<key.size(); ++i)
+		if (i != other) {
+			t1.push_back(key[i]);
+			t2.push_back(key[i]);
+		}
+	if (other == 0) {
+		// Tr(T^a B T^a C) = 1/2 Tr(B) Tr(C) - 1/(2N) Tr(B C)
+		std::vector<int> B(c0.begin() + 1, c0.begin() + pos), C(c0.begin() + pos + 1, c0.end());
+		t1.push_back(B);
+		t1.push_back(C);
+		B.insert(B.end(), C.begin(), C.end());
+		t2.push_back(B);
+	} else {
+		// Tr(T^a A) Tr(T^a B) = 1/2 Tr(A B) - 1/(2N) Tr(A) Tr(B)
+		const std::vector<int> & ck = key[other];
+		std::vector<int> A(c0.begin() + 1, c0.end()), B(ck.begin() + pos + 1, ck.end());
+		B.insert(B.end(), ck.begin(), ck.begin() + pos);
+		t2.push_back(A);
+		t2.push_back(B);
+		A.insert(A.end(), B.begin(), B.end());
+		t1.push_back(A);
+	}
+
+	N_poly value;
+	add_N_poly(value, evaluate(t1), *_num1_2_p, 0);
+	add_N_poly(value, evaluate(t2), -*_num1_2_p, -1);
+	memo[key] = value;
+	add_N_poly(result, value, *_num1_p, loops);
+	return result;
+}
+
+/** Check whether e contains color objects, structure constants or deltas. */
+bool has_color(const ex & e)
+{
+	if (is_a<color>(e))
+		return true;
+	if (is_a<indexed>(e) && (is_a<su3f>(e.op(0)) || is_a<su3d>(e.op(0)) || is_a<tensdelta>(e.op(0))))
+		return true;
+	for (size_t i=0; i<e.nops(); ++i)
+		if (has_color(e.op(i)))
+			return true;
+	return false;
+}
+
+/** Translation of a product of color objects into sums of products of
+ *  traces of generators, over which it is then summed. */
+class color_structure {
+public:
+	color_structure() : scalar(_ex1) { terms.push_back(std::make_pair(*_num1_p, trace_product())); }
+
+	void add_factor(const ex & e);
+	N_poly evaluate(color_graph & g) const;
+
+	ex scalar;  ///< factors not involving color objects
+
+private:
+	int label(const ex & i);
+	void append(const std::vector<int> & cycle, const numeric & c);
+	void append(const std::vector<int> & cycle1, const numeric & c1,
+	            const std::vector<int> & cycle2, const numeric & c2);
+
+	std::vector<std::pair<numeric, trace_product> > terms;
+	exhashmap<int> labels;
+	std::vector<int> occurrences;
+};
+
+int color_structure::label(const ex & i)
+{
+	if (!is_a<idx>(i) || !ex_to<idx>(i).is_symbolic())
+		throw std::invalid_argument("color_factor(): indices must be symbolic");
+	const ex v = ex_to<idx>(i).get_value();
+	exhashmap<int>::const_iterator it = labels.find(v);
+	if (it == labels.end()) {
+		it = labels.insert(std::make_pair(v, int(occurrences.size()))).first;
+		occurrences.push_back(0);
+	}
+	if (++occurrences[it->second] > 2)
+		throw std::invalid_argument("color_factor(): index occurs more than twice");
+	return it->second;
+}
+
+void color_structure::append(const std::vector<int> & cycle, const numeric & c)
+{
+	for (size_t i=0; i<terms.size(); ++i) {
+		terms[i].first *= c;
+		terms[i].second.push_back(cycle);
+	}
+}
+
+void color_structure::append(const std::vector<int> & cycle1, const numeric & c1,
+                             const std::vector<int> & cycle2, const numeric & c2)
+{
+	const size_t n = terms.size();
+	terms.reserve(2 * n);
+	for (size_t i=0; i<n; ++i) {
+		terms.push_back(terms[i]);
+		terms.back().first *= c2;
+		terms.back().second.push_back(cycle2);
+		terms[i].first *= c1;
+		terms[i].second.push_back(cycle1);
+	}
+}
+
+void color_structure::add_factor(const ex & e)
+{
+	if (is_exactly_a<power>(e) && e.op(1).info(info_flags::posint)) {
+		for (int k=ex_to<numeric>(e.op(1)).to_int(); k>0; --k)
+			add_factor(e.op(0));
+
+	} else if (is_a<color>(e) || is_exactly_a<ncmul>(e)) {
+		// Trace of a string of generators
+		std::vector<int> cycle;
+		for (size_t k=0; k<(is_a<color>(e) ? 1 : e.nops()); ++k) {
+			const ex & g = is_a<color>(e) ? e : e.op(k);
+			if (!is_a<color>(g))
+				throw std::invalid_argument("color_factor(): products of color and other non-commutative objects are not supported");
+			if (is_a<su3t>(g.op(0)))
+				cycle.push_back(label(g.op(1)));
+		}
+		append(cycle, *_num1_p);
+
+	} else if (is_a<indexed>(e) && (is_a<su3f>(e.op(0)) || is_a<su3d>(e.op(0)))) {
+		// f.abc = -2I (Tr(T.a T.b T.c) - Tr(T.a T.c T.b)),
+		// d.abc = 2 (Tr(T.a T.b T.c) + Tr(T.a T.c T.b))
+		std::vector<int> abc(3), acb(3);
+		abc[0] = acb[0] = label(e.op(1));
+		abc[1] = acb[2] = label(e.op(2));
+		abc[2] = acb[1] = label(e.op(3));
+		if (is_a<su3f>(e.op(0)))
+			append(abc, -2 * I, acb, 2 * I);
+		else
+			append(abc, *_num2_p, acb, *_num2_p);
+
+	} else if (is_a<indexed>(e) && is_a<tensdelta>(e.op(0))) {
+		// delta.ab = 2 Tr(T.a T.b)
+		std::vector<int> ab(2);
+		ab[0] = label(e.op(1));
+		ab[1] = label(e.op(2));
+		append(ab, *_num2_p);
+
+	} else if (!has_color(e))
+		scalar *= e;
+
+	else
+		throw std::invalid_argument("color_factor(): color objects must only occur in products");
+}
+
+N_poly color_structure::evaluate(color_graph & g) const
+{
+	for (size_t i=0; i<occurrences.size(); ++i)
+		if (occurrences[i] != 2)
+			throw std::invalid_argument("color_factor(): the color structure has free indices");
+	N_poly result;
+	for (size_t i=0; i<terms.size(); ++i)
+		if (!terms[i].first.is_zero())
+			add_N_poly(result, g.evaluate(terms[i].second), terms[i].first, 0);
+	return result;
+}
+
+} // anonymous namespace
+
+ex color_factor(const ex & e, const ex & N)
+{
+	const ex expanded = e.expand();
+	exvector products;
+	if (is_exactly_a<add>(expanded))
+		products.assign(expanded.begin(), expanded.end());
+	else
+		products.push_back(expanded);
+
+	color_graph g;
+	exvector result;
+	result.reserve(products.size());
+	for (exvector::const_iterator it=products.begin(); it!=products.end(); ++it) {
+		color_structure s;
+		if (is_exactly_a<mul>(*it))
+			for (size_t k=0; k<it->nops(); ++k)
+				s.add_factor(it->op(k));
+		else
+			s.add_factor(*it);
+
+		// Only here the polynomial in N becomes an expression
+		const N_poly p = s.evaluate(g);
+		exvector terms;
+		for (N_poly::const_iterator c=p.begin(); c!=p.end(); ++c)
+			terms.push_back(c->second * pow(N, c->first));
+		result.push_back(s.scalar * (new add(terms))->setflag(status_flags::dynallocated));
+	}
+	return (new add(result))->setflag(status_flags::dynallocated);
+}
+
 } // namespace GiNaC
@@ -191,6 +191,21 @@ ex color_trace(const ex & e, const lst & rll);
  *  @param rl Representation label */
 ex color_trace(const ex & e, unsigned char rl = 0);
 
+/** Calculate the color factor of a fully contracted color structure in
+ *  SU(N). The terms of the expanded expression e must be products of
+ *  color_T strings (whose traces are taken, whatever their representation
+ *  labels), color_ONE, structure constants and delta tensors of adjoint
+ *  indices, every index occurring twice. The dimension of the indices is
+ *  not looked at, so the SU(3) objects may be used for any N.
+ *
+ *  The structures are reduced on their birdtracks, as products of traces
+ *  with the Fierz identity, and only the final polynomial in N is
+ *  converted to an expression.
+ *
+ *  @param e Expression whose color factor is computed
+ *  @param N Number of colors (may be a symbol) */
+ex color_factor(const ex & e, const ex & N = 3);
+
 } // namespace GiNaC
 
 #endif // ndef GINAC_COLOR_H
@@ -0,0 +1,453 @@
+/** @file component_array.cpp
+ *
+ *  Implementation of dense arrays of the components of indexed
+ *  expressions. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "component_array.h"
+#include "indexed.h"
+#include "idx.h"
+#include "symmetry.h"
+#include "add.h"
+#include "mul.h"
+#include "power.h"
+#include "numeric.h"
+#include "relational.h"
+#include "lst.h"
+#include "operators.h"
+#include "tostring.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace GiNaC {
+
+namespace {
+
+/** Components of an expression with respect to some of its indices (the
+ *  labels), stored in row-major order. */
+template <class T>
+struct dense_tensor {
+	exvector labels;            ///< indices, one for each dimension
+	std::vector<unsigned> dims;
+	std::vector<T> data;
+
+	/** Position of the label with the same value as i, or rank(). */
+	size_t find(const ex & i) const
+	{
+		size_t k = 0;
+		while (k < labels.size() && !labels[k].op(0).is_equal(i.op(0)))
+			++k;
+		return k;
+	}
+	size_t rank() const { return labels.size(); }
+	std::vector<size_t> strides() const
+	{
+		std::vector<size_t> s(dims.size());
+		size_t stride = 1;
+		for (size_t k=dims.size(); k-->0; ) {
+			s[k] = stride;
+			stride *= dims[k];
+		}
+		return s;
+	}
+};
+
+/** Advance the multi-index cnt with the ranges dims, returns false after
+ *  the last one. */
+inline bool next_multi_index(std::vector<unsigned> & cnt, const std::vector<unsigned> & dims)
+{
+	for (size_t k=cnt.size(); k-->0; ) {
+		if (++cnt[k] < dims[k])
+			return true;
+		cnt[k] = 0;
+	}
+	return false;
+}
+
+/** Components as they are. */
+struct ex_components {
+	typedef ex value_type;
+
+	static ex convert(const ex & c) { return c; }
+
+	/** Collects products and returns their sum. */
+	struct sum_of_products {
+		exvector terms;
+		void push(const ex & a, const ex & b)
+		{
+			if (!a.is_zero() && !b.is_zero())
+				terms.push_back(a * b);
+		}
+		ex get()
+		{
+			ex s = (new add(terms))->setflag(status_flags::dynallocated);
+			terms.clear();
+			return s;
+		}
+	};
+
+	static ex sum(const exvector & v)
+	{
+		return (new add(v))->setflag(status_flags::dynallocated);
+	}
+};
+
+/** Components as floating point numbers. */
+struct double_components {
+	typedef double value_type;
+
+	static double convert(const ex & c)
+	{
+		const ex f = c.evalf();
+		if (!is_exactly_a<numeric>(f) || !ex_to<numeric>(f).is_real())
+			throw std::invalid_argument("evalf_components(): component " + ToString(c) + " is not a real number");
+		return ex_to<numeric>(f).to_double();
+	}
+
+	struct sum_of_products {
+		double s;
+		sum_of_products() : s(0) { }
+		void push(double a, double b) { s += a * b; }
+		double get() { double r = s; s = 0; return r; }
+	};
+
+	static double sum(const std::vector<double> & v)
+	{
+		double s = 0;
+		for (std::vector<double>::const_iterator it=v.begin(); it!=v.end(); ++it)
+			s += *it;
+		return s;
+	}
+};
+
+static unsigned numeric_dim(const ex & i)
+{
+	const ex d = ex_to<idx>(i).get_dim();
+	if (!d.info(info_flags::posint))
+		throw std::invalid_argument("component_array: index " + ToString(i) + " has no numeric dimension");
+	return ex_to<numeric>(d).to_int();
+}
+
+static bool contains_indexed(const ex & e)
+{
+	if (is_a<indexed>(e))
+		return true;
+	for (size_t i=0; i<e.nops(); ++i)
+		if (contains_indexed(e.op(i)))
+			return true;
+	return false;
+}
+
+template <class C>
+class network {
+	typedef typename C::value_type T;
+	typedef dense_tensor<T> tensor;
+
+public:
+	/** Components of e with respect to its free indices. */
+	static tensor evaluate(const ex & e)
+	{
+		if (is_a<indexed>(e))
+			return leaf(e);
+		if (is_exactly_a<add>(e))
+			return sum(e);
+		if (is_exactly_a<mul>(e) || (is_exactly_a<power>(e) && e.op(1).is_equal(_ex2) && contains_indexed(e.op(0))))
+			return product(e);
+		if (contains_indexed(e))
+			throw std::invalid_argument("component_array: can't evaluate " + ToString(e));
+		tensor t;
+		t.data.push_back(C::convert(e));
+		return t;
+	}
+
+	/** Reorder the dimensions of t to the order of the labels. */
+	static tensor permute(const tensor & t, const exvector & labels)
+	{
+		if (labels.size() != t.rank())
+			throw std::invalid_argument("component_array: inconsistent free indices");
+		tensor r;
+		r.labels = labels;
+		std::vector<size_t> src(labels.size());
+		for (size_t k=0; k<labels.size(); ++k) {
+			src[k] = t.find(labels[k]);
+			if (src[k] == t.rank())
+				throw std::invalid_argument("component_array: inconsistent free indices");
+			r.dims.push_back(t.dims[src[k]]);
+		}
+		const std::vector<size_t> s = t.strides();
+		r.data.reserve(t.data.size());
+		std::vector<unsigned> cnt(r.rank(), 0);
+		if (!t.data.empty()) {
+			do {
+				size_t off = 0;
+				for (size_t k=0; k<cnt.size(); ++k)
+					off += cnt[k] * s[src[k]];
+				r.data.push_back(t.data[off]);
+			} while (next_multi_index(cnt, r.dims));
+		}
+		return r;
+	}
+
+private:
+	static tensor leaf(const ex & e)
+	{
+		// Sort the indices into those with numeric values, free ones and
+		// pairs of dummy indices
+		const size_t nslots = e.nops() - 1;
+		std::vector<int> slot_label(nslots, -1);
+		exvector labels, traced;
+		std::vector<unsigned> label_dims, traced_dims;
+		for (size_t k=0; k<nslots; ++k) {
+			const ex & index = e.op(k + 1);
+			if (ex_to<idx>(index).is_numeric())
+				continue;
+			const unsigned d = numeric_dim(index);
+			size_t l = 0;
+			while (l < labels.size() && !labels[l].op(0).is_equal(index.op(0)))
+				++l;
+			if (l == labels.size()) {
+				labels.push_back(index);
+				label_dims.push_back(d);
+			} else
+				label_dims[l] = std::min(label_dims[l], d);
+			slot_label[k] = l;
+		}
+		std::vector<unsigned> occurrences(labels.size(), 0);
+		for (size_t k=0; k<nslots; ++k)
+			if (slot_label[k] >= 0)
+				++occurrences[slot_label[k]];
+
+		tensor t;
+		std::vector<int> label_pos(labels.size());
+		for (size_t l=0; l<labels.size(); ++l) {
+			if (occurrences[l] == 1) {
+				label_pos[l] = t.labels.size();
+				t.labels.push_back(labels[l]);
+				t.dims.push_back(label_dims[l]);
+			} else if (occurrences[l] == 2) {
+				label_pos[l] = -1 - int(traced.size());
+				traced.push_back(labels[l]);
+				traced_dims.push_back(label_dims[l]);
+			} else
+				throw std::invalid_argument("component_array: index " + ToString(labels[l]) + " occurs more than twice");
+		}
+
+		// The index objects with numeric values for each slot
+		std::vector<exvector> slot_values(nslots);
+		for (size_t k=0; k<nslots; ++k) {
+			if (slot_label[k] < 0)
+				continue;
+			const ex & index = e.op(k + 1);
+			const unsigned d = label_dims[slot_label[k]];
+			for (unsigned n=0; n<d; ++n)
+				slot_values[k].push_back(index.subs(index.op(0) == numeric(n), subs_options::no_pattern));
+		}
+
+		const ex & base = e.op(0);
+		const symmetry & symm = ex_to<symmetry>(ex_to<indexed>(e).get_symmetry());
+		size_t size = 1;
+		for (size_t k=0; k<t.dims.size(); ++k)
+			size *= t.dims[k];
+		t.data.reserve(size);
+		std::vector<unsigned> cnt(t.rank(), 0), tcnt(traced.size(), 0);
+		exvector iv(nslots);
+		do {
+			std::vector<T> terms;
+			do {
+				for (size_t k=0; k<nslots; ++k) {
+					const int l = slot_label[k];
+					if (l < 0)
+						iv[k] = e.op(k + 1);
+					else if (label_pos[l] >= 0)
+						iv[k] = slot_values[k][cnt[label_pos[l]]];
+					else
+						iv[k] = slot_values[k][tcnt[-1 - label_pos[l]]];
+				}
+				terms.push_back(C::convert(indexed(base, symm, iv)));
+			} while (next_multi_index(tcnt, traced_dims));
+			t.data.push_back(terms.size() == 1 ? terms[0] : C::sum(terms));
+		} while (next_multi_index(cnt, t.dims));
+		return t;
+	}
+
+	static tensor sum(const ex & e)
+	{
+		tensor t = evaluate(e.op(0));
+		for (size_t i=1; i<e.nops(); ++i) {
+			const tensor term = permute(evaluate(e.op(i)), t.labels);
+			for (size_t k=0; k<t.data.size(); ++k)
+				t.data[k] = t.data[k] + term.data[k];
+		}
+		return t;
+	}
+
+	static tensor product(const ex & e)
+	{
+		std::vector<tensor> factors;
+		if (is_exactly_a<power>(e)) {
+			factors.push_back(evaluate(e.op(0)));
+			factors.push_back(factors.back());
+		} else {
+			for (size_t i=0; i<e.nops(); ++i)
+				factors.push_back(evaluate(e.op(i)));
+		}
+
+		// Contract the pair of factors with the smallest cost first
+		while (factors.size() > 1) {
+			size_t best_i = 0, best_j = 1;
+			double best_cost = std::numeric_limits<double>::max();
+			for (size_t i=0; i<factors.size(); ++i)
+				for (size_t j=i+1; j<factors.size(); ++j) {
+					double cost = 1;
+					for (size_t k=0; k<factors[i].rank(); ++k)
+						cost *= factors[i].dims[k];
+					for (size_t k=0; k<factors[j].rank(); ++k)
+						if (factors[i].find(factors[j].labels[k]) == factors[i].rank())
+							cost *= factors[j].dims[k];
+					if (cost < best_cost) {
+						best_cost = cost;
+						best_i = i;
+						best_j = j;
+					}
+				}
+			factors[best_i] = contract(factors[best_i], factors[best_j]);
+			factors.erase(factors.begin() + best_j);
+		}
+		return factors[0];
+	}
+
+	/** Product of a and b, summed over their common indices. */
+	static tensor contract(const tensor & a, const tensor & b)
+	{
+		tensor r;
+		std::vector<size_t> a_pos, b_pos;          // dimensions of r
+		std::vector<std::pair<size_t, size_t> > shared;
+		std::vector<unsigned> shared_dims;
+		for (size_t k=0; k<a.rank(); ++k) {
+			const size_t l = b.find(a.labels[k]);
+			if (l == b.rank()) {
+				a_pos.push_back(k);
+				r.labels.push_back(a.labels[k]);
+				r.dims.push_back(a.dims[k]);
+			} else {
+				shared.push_back(std::make_pair(k, l));
+				shared_dims.push_back(std::min(a.dims[k], b.dims[l]));
+			}
+		}
+		for (size_t l=0; l<b.rank(); ++l)
+			if (a.find(b.labels[l]) == a.rank()) {
+				b_pos.push_back(l);
+				r.labels.push_back(b.labels[l]);
+				r.dims.push_back(b.dims[l]);
+			}
+
+		// Offsets of the terms of the sum over the common indices
+		const std::vector<size_t> sa = a.strides(), sb = b.strides();
+		std::vector<size_t> a_off, b_off;
+		std::vector<unsigned> cnt(shared.size(), 0);
+		do {
+			size_t oa = 0, ob = 0;
+			for (size_t k=0; k<shared.size(); ++k) {
+				oa += cnt[k] * sa[shared[k].first];
+				ob += cnt[k] * sb[shared[k].second];
+			}
+			a_off.push_back(oa);
+			b_off.push_back(ob);
+		} while (next_multi_index(cnt, shared_dims));
+
+		typename C::sum_of_products acc;
+		cnt.assign(r.rank(), 0);
+		do {
+			size_t oa = 0, ob = 0;
+			for (size_t k=0; k<a_pos.size(); ++k)
+				oa += cnt[k] * sa[a_pos[k]];
+			for (size_t k=0; k<b_pos.size(); ++k)
+				ob += cnt[a_pos.size() + k] * sb[b_pos[k]];
+			for (size_t s=0; s<a_off.size(); ++s)
+				acc.push(a.data[oa + a_off[s]], b.data[ob + b_off[s]]);
+			r.data.push_back(acc.get());
+		} while (next_multi_index(cnt, r.dims));
+		return r;
+	}
+};
+
+/** Labels in the order of the free indices, checked against those of e. */
+static exvector free_index_order(const ex & e, const lst & free_indices)
+{
+	exvector order(free_indices.begin(), free_indices.end());
+	for (exvector::const_iterator it=order.begin(); it!=order.end(); ++it)
+		if (!is_a<idx>(*it))
+			throw std::invalid_argument("component_array: " + ToString(*it) + " is not an index");
+	if (e.get_free_indices().size() != order.size())
+		throw std::invalid_argument("component_array: wrong number of free indices");
+	return order;
+}
+
+} // anonymous namespace
+
+component_array::component_array(const ex & e)
+{
+	init(e, e.get_free_indices());
+}
+
+component_array::component_array(const ex & e, const lst & free_indices)
+{
+	init(e, free_index_order(e, free_indices));
+}
+
+void component_array::init(const ex & e, const exvector & order)
+{
+	const dense_tensor<ex> t = network<ex_components>::permute(network<ex_components>::evaluate(e), order);
+	free = order;
+	dims = t.dims;
+	data = t.data;
+}
+
+const ex & component_array::operator()(const std::vector<unsigned> & values) const
+{
+	if (values.size() != dims.size())
+		throw std::invalid_argument("component_array: wrong number of index values");
+	size_t pos = 0;
+	for (size_t k=0; k<dims.size(); ++k) {
+		if (values[k] >= dims[k])
+			throw std::range_error("component_array: index value out of range");
+		pos = pos * dims[k] + values[k];
+	}
+	return data[pos];
+}
+
+std::vector<double> component_array::to_double() const
+{
+	std::vector<double> v;
+	v.reserve(data.size());
+	for (exvector::const_iterator it=data.begin(); it!=data.end(); ++it)
+		v.push_back(double_components::convert(*it));
+	return v;
+}
+
+std::vector<double> evalf_components(const ex & e, const lst & free_indices)
+{
+	return network<double_components>::permute(network<double_components>::evaluate(e), free_index_order(e, free_indices)).data;
+}
+
+} // namespace GiNaC
@@ -0,0 +1,91 @@
+/** @file component_array.h
+ *
+ *  Interface to dense arrays of the components of indexed expressions. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_COMPONENT_ARRAY_H
+#define GINAC_COMPONENT_ARRAY_H
+
+#include "ex.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace GiNaC {
+
+/** All components of an indexed expression whose indices have numeric
+ *  dimensions, stored densely in row-major order of its free indices.
+ *
+ *  The components of each indexed object in the expression are formed
+ *  once, by putting numeric values into its indices (so predefined tensors
+ *  and matrices give their entries, and other objects give indexed objects
+ *  with numeric indices). Products are then evaluated as tensor networks:
+ *  the factors are contracted pairwise over their common dummy indices, in
+ *  the order which keeps the cost of each step smallest, and sums add up
+ *  the arrays of their terms. Dummy indices are summed over without raising
+ *  or lowering, like in simplify_indexed(). */
+class component_array {
+public:
+	/** Components of e, with the free indices in the order of
+	 *  e.get_free_indices(). */
+	explicit component_array(const ex & e);
+
+	/** Components of e, with the free indices in the given order. The
+	 *  list must hold the free indices of e. */
+	component_array(const ex & e, const lst & free_indices);
+
+	/** Free indices, in the order of the array dimensions. */
+	const exvector & get_free_indices() const { return free; }
+
+	size_t rank() const { return dims.size(); }
+	/** Dimension of the k-th free index. */
+	unsigned dim(size_t k) const { return dims[k]; }
+	/** Total number of components. */
+	size_t size() const { return data.size(); }
+
+	/** Component number i in row-major order. */
+	const ex & operator[](size_t i) const { return data[i]; }
+	/** Component with the given values of the free indices. */
+	const ex & operator()(const std::vector<unsigned> & values) const;
+
+	/** All components in row-major order. */
+	const exvector & components() const { return data; }
+
+	/** The components as floating point numbers, which must all be real
+	 *  after evalf(). */
+	std::vector<double> to_double() const;
+
+private:
+	void init(const ex & e, const exvector & order);
+
+	exvector free;
+	std::vector<unsigned> dims;
+	exvector data;
+};
+
+/** Components of e as floating point numbers, in row-major order of the
+ *  given free indices, like component_array(e, free_indices).to_double().
+ *  The components of the indexed objects are converted to double at once,
+ *  and the contractions are done in floating point arithmetic. */
+std::vector<double> evalf_components(const ex & e, const lst & free_indices);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_COMPONENT_ARRAY_H
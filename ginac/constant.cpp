@@ -151,7 +151,7 @@ bool constant::info(unsigned inf) const
 ex constant::evalf(int level) const
 {
 	if (ef!=0) {
-		return ef();
+		return cached_evalf(ef);
 	} else {
 		return number.evalf();
 	}
@@ -213,14 +213,15 @@ bool constant::is_equal_same_type(const basic & other) const
 	return serial == o.serial;
 }
 
-unsigned constant::calchash() const
+hash_t constant::calchash() const
 {
 	const void* typeid_this = (const void*)typeid(*this).name();
-	hashvalue = golden_ratio_hash((p_int)typeid_this ^ serial);
+	const hash_t v = golden_ratio_hash((p_int)typeid_this ^ serial);
+	hashvalue = v;
 
 	setflag(status_flags::hash_calculated);
 
-	return hashvalue;
+	return v;
 }
 
 //////////
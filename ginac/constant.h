@@ -58,7 +58,7 @@ public:
 protected:
 	ex derivative(const symbol & s) const;
 	bool is_equal_same_type(const basic & other) const;
-	unsigned calchash() const;
+	hash_t calchash() const;
 	
 	// non-virtual functions in this class
 protected:
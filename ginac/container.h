@@ -152,6 +152,12 @@ public:
 			this->seq = s;
 	}
 
+	container(STLT && s)
+	{
+		setflag(get_default_flags());
+		this->seq.swap(s);
+	}
+
 	explicit container(std::shared_ptr<STLT> vp)
 	{
 		setflag(get_default_flags());
@@ -411,11 +417,8 @@ protected:
 			}
 			newcont->push_back(x);
 		}
-		if (newcont) {
-			ex result = thiscontainer(*newcont);
-			delete newcont;
-			return result;
-		}
+		if (newcont)
+			return thiscontainer(std::shared_ptr<STLT>(newcont));
 		return *this;
 	}
 
@@ -427,7 +430,7 @@ protected:
 		const_iterator e = end();
 		for(const_iterator i=b; i!=e; ++i)
 			cont.push_back(i->real_part());
-		return thiscontainer(cont);
+		return thiscontainer(std::make_shared<STLT>(std::move(cont)));
 	}
 
 	ex imag_part() const
@@ -438,7 +441,7 @@ protected:
 		const_iterator e = end();
 		for(const_iterator i=b; i!=e; ++i)
 			cont.push_back(i->imag_part());
-		return thiscontainer(cont);
+		return thiscontainer(std::make_shared<STLT>(std::move(cont)));
 	}
 
 	bool is_equal_same_type(const basic & other) const;
@@ -568,7 +571,7 @@ ex container<C>::eval(int level) const
 	if (level == 1)
 		return hold();
 	else
-		return thiscontainer(evalchildren(level));
+		return thiscontainer(std::make_shared<STLT>(evalchildren(level)));
 }
 
 template <template <class T, class = std::allocator<T> > class C>
@@ -785,6 +788,59 @@ std::shared_ptr<typename container<C>::STLT> container<C>::subschildren(const ex
 	return std::shared_ptr<STLT>(0); // nothing has changed
 }
 
+/** The container of class T held by e, ready to be modified. The
+ *  container is copied if e shares it with other expressions, otherwise it
+ *  is modified in place. */
+template <class T>
+T & let_container(ex & e)
+{
+	if (!is_a<T>(e))
+		throw std::invalid_argument("let_container(): expression is not a container of this class");
+	if (ex_to<T>(e).get_refcount() > 1)
+		e = ex_to<T>(e).duplicate()->setflag(status_flags::dynallocated);
+	return const_cast<T &>(ex_to<T>(e));
+}
+
+/** Append b to the container of class T (such as lst or exprseq) held by
+ *  e. Unlike
+ *    e = T(ex_to<T>(e)).append(b);
+ *  this doesn't copy the elements if e holds the only reference to the
+ *  container, so that building a container element by element takes
+ *  linear time. */
+template <class T>
+ex & append_to(ex & e, const ex & b)
+{
+	let_container<T>(e).append(b);
+	return e;
+}
+
+/** Add b at the front of the container of class T held by e, see
+ *  append_to(). */
+template <class T>
+ex & prepend_to(ex & e, const ex & b)
+{
+	let_container<T>(e).prepend(b);
+	return e;
+}
+
+/** Remove the first element of the container of class T held by e, see
+ *  append_to(). */
+template <class T>
+ex & remove_first_from(ex & e)
+{
+	let_container<T>(e).remove_first();
+	return e;
+}
+
+/** Remove the last element of the container of class T held by e, see
+ *  append_to(). */
+template <class T>
+ex & remove_last_from(ex & e)
+{
+	let_container<T>(e).remove_last();
+	return e;
+}
+
 } // namespace GiNaC
 
 #endif // ndef GINAC_CONTAINER_H
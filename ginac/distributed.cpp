@@ -0,0 +1,129 @@
+/** @file distributed.cpp
+ *
+ *  Implementation of helpers for distributing the terms of large sums over
+ *  the processes of a cluster. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "distributed.h"
+#include "add.h"
+#include "mul.h"
+#include "numeric.h"
+#include "lst.h"
+#include "archive.h"
+#include "builder.h"
+#include "utils.h"
+
+#include <sstream>
+#include <stdexcept>
+
+namespace GiNaC {
+
+/** FNV-1a hash of a string. */
+static unsigned string_hash(const std::string & s)
+{
+	unsigned h = 2166136261u;
+	for (std::string::const_iterator i = s.begin(); i != s.end(); ++i) {
+		h ^= static_cast<unsigned char>(*i);
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static unsigned mix(unsigned h)
+{
+	h ^= h >> 16;
+	h *= 0x45d9f3bu;
+	h ^= h >> 16;
+	return h;
+}
+
+/** Hash of an expression which is the same in every process. The hashes of
+ *  the operands are added up, since the order of the operands of sums and
+ *  products (and of symmetric objects) depends on the serial numbers of
+ *  the symbols, which may differ between processes. */
+static unsigned portable_hash(const ex & e, bool skip_numeric = false)
+{
+	if (is_exactly_a<numeric>(e))
+		return e.gethash();  // depends only on the value
+	const size_t n = e.nops();
+	if (n == 0) {
+		std::ostringstream os;
+		os << e;
+		return string_hash(os.str());
+	}
+	unsigned h = string_hash(ex_to<basic>(e).class_name());
+	for (size_t i = 0; i < n; ++i) {
+		const ex & o = e.op(i);
+		if (skip_numeric && is_exactly_a<numeric>(o))
+			continue;
+		h += mix(portable_hash(o));
+	}
+	return mix(h);
+}
+
+unsigned term_part(const ex & term, unsigned nparts)
+{
+	if (nparts == 0)
+		throw std::invalid_argument("term_part(): no parts");
+	if (is_exactly_a<numeric>(term))
+		return 0;
+	// Leave out the numeric coefficient (the last operand of a product),
+	// so that the hash is the one of the rest of the term in a sum
+	if (is_exactly_a<mul>(term) && is_exactly_a<numeric>(term.op(term.nops() - 1))) {
+		if (term.nops() == 2)
+			return portable_hash(term.op(0)) % nparts;
+		return portable_hash(term, true) % nparts;
+	}
+	return portable_hash(term) % nparts;
+}
+
+std::vector<std::string> partition_terms(const ex & e, unsigned nparts)
+{
+	std::vector<add_builder> parts(nparts);
+	if (is_exactly_a<add>(e)) {
+		for (size_t i = 0; i < e.nops(); ++i) {
+			const ex t = e.op(i);
+			parts[term_part(t, nparts)] += t;
+		}
+	} else
+		parts[term_part(e, nparts)] += e;
+
+	std::vector<std::string> result(nparts);
+	for (unsigned i = 0; i < nparts; ++i) {
+		std::ostringstream os;
+		os << archive(parts[i].finish());
+		result[i] = os.str();
+	}
+	return result;
+}
+
+ex combine_parts(const std::vector<std::string> & parts, const lst & syms)
+{
+	add_builder sum(parts.size());
+	for (std::vector<std::string>::const_iterator i = parts.begin(); i != parts.end(); ++i) {
+		std::istringstream is(*i);
+		archive a;
+		is >> a;
+		sum += a.unarchive_ex(syms);
+	}
+	return sum.finish();
+}
+
+} // namespace GiNaC
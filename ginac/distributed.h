@@ -0,0 +1,55 @@
+/** @file distributed.h
+ *
+ *  Interface to helpers for distributing the terms of large sums over the
+ *  processes of a cluster. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_DISTRIBUTED_H
+#define GINAC_DISTRIBUTED_H
+
+#include "ex.h"
+
+#include <string>
+#include <vector>
+
+namespace GiNaC {
+
+class lst;
+
+/** Number (0...nparts-1) of the part a term belongs to. The terms which
+ *  differ only in their numeric coefficient belong to the same part, and
+ *  this is the same in every process running the same program: the hash
+ *  used depends only on the structure of the term and on the names of its
+ *  symbols, not on the addresses or serial numbers of objects. */
+unsigned term_part(const ex & term, unsigned nparts);
+
+/** Split the terms of e (e itself if it is not a sum) into nparts parts by
+ *  term_part(), and archive each part into a string. Part i is meant to be
+ *  sent to process i, which receives the like terms from all processes. */
+std::vector<std::string> partition_terms(const ex & e, unsigned nparts);
+
+/** Unarchive the parts received from all processes and add them up, which
+ *  combines the like terms.
+ *  @param syms the symbols occurring in the parts */
+ex combine_parts(const std::vector<std::string> & parts, const lst & syms);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_DISTRIBUTED_H
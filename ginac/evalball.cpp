@@ -0,0 +1,332 @@
+/** @file evalball.cpp
+ *
+ *  Implementation of numerical evaluation with rigorous error bounds. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "evalball.h"
+#include "add.h"
+#include "constant.h"
+#include "function.h"
+#include "inifcns.h"
+#include "mul.h"
+#include "operators.h"
+#include "power.h"
+
+#include <cln/real.h>
+#include <cln/float.h>
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+namespace GiNaC {
+
+long ball::accurate_digits() const
+{
+	if (rad.is_zero())
+		return -1;
+	if (contains_zero())
+		return 0;
+	return long(std::floor(log(abs(mid) / rad).to_double() / std::log(10.0)));
+}
+
+std::ostream & operator<<(std::ostream & os, const ball & b)
+{
+	return os << '[' << b.mid << " +- " << b.rad << ']';
+}
+
+namespace {
+
+/** Number of digits by which the working precision exceeds the number of
+ *  digits a result is expected to have. */
+const long guard_digits = 5;
+
+/** Sets Digits for the lifetime of the object. */
+class digits_guard {
+public:
+	explicit digits_guard(long d) : saved(Digits)
+	{
+		if (d != saved)
+			Digits = d;
+	}
+	~digits_guard()
+	{
+		if (long(Digits) != saved)
+			Digits = saved;
+	}
+private:
+	long saved;
+};
+
+/** Evaluation of expressions in ball arithmetic with Digits digits. */
+class ball_evaluator {
+public:
+	explicit ball_evaluator(long max_digits_)
+	  : digits(Digits), max_digits(max_digits_),
+	    eps(numeric(10).power(2 - digits)),
+	    tolerance(numeric(10).power(guard_digits - digits)) {}
+
+	ball eval(const ex & e) const;
+
+private:
+	ball eval_add(const ex & e) const;
+	ball eval_mul(const ex & e) const;
+	ball eval_power(const ex & e) const;
+	ball eval_function(const ex & e) const;
+	ball from_numeric(const numeric & x) const;
+
+	ball product(const ball & a, const ball & b) const;
+	ball inverse(const ball & a) const;
+	ball integer_power(const ball & a, const numeric & n) const;
+	ball exponential(const ball & a) const;
+	ball logarithm(const ball & a) const;
+
+	/** Bound for the rounding error of a computed value x. Floating-point
+	 *  results are assumed to be accurate to 100 units in the last place,
+	 *  which also covers the rounding of the radius computations. */
+	numeric rounding(const numeric & x) const
+	{
+		return x.is_rational() ? numeric(0) : abs(x) * eps;
+	}
+
+	long digits, max_digits;
+	numeric eps, tolerance;
+};
+
+ball ball_evaluator::eval(const ex & e) const
+{
+	if (is_exactly_a<numeric>(e))
+		return from_numeric(ex_to<numeric>(e));
+	if (is_exactly_a<constant>(e)) {
+		const ex v = e.evalf();
+		if (!is_exactly_a<numeric>(v))
+			throw std::invalid_argument("evalf_ball(): expression is not numeric");
+		const numeric & x = ex_to<numeric>(v);
+		if (!x.is_real())
+			throw std::domain_error("evalf_ball(): value is not real");
+		return ball(x, rounding(x));
+	}
+	if (is_exactly_a<add>(e))
+		return eval_add(e);
+	if (is_exactly_a<mul>(e))
+		return eval_mul(e);
+	if (is_exactly_a<power>(e))
+		return eval_power(e);
+	if (is_a<function>(e))
+		return eval_function(e);
+	throw std::invalid_argument("evalf_ball(): expression is not numeric");
+}
+
+ball ball_evaluator::from_numeric(const numeric & x) const
+{
+	if (!x.is_real())
+		throw std::domain_error("evalf_ball(): value is not real");
+	if (x.is_rational())
+		return ball(x, 0);
+	// floating-point numbers of a lower precision would drag the
+	// arithmetic down to it
+	const numeric y(cln::cl_float(cln::realpart(x.to_cl_N()), cln::float_format(Digits)));
+	return ball(y, rounding(y));
+}
+
+/** Sums are the only place where the working precision is raised: if the
+ *  terms cancel, they are evaluated again with the digits that were lost
+ *  in addition. */
+ball ball_evaluator::eval_add(const ex & e) const
+{
+	ball s;
+	numeric largest;
+	for (size_t i = 0; i < e.nops(); ++i) {
+		const ball t = eval(e.op(i));
+		s.mid = s.mid + t.mid;
+		s.rad = s.rad + t.rad + rounding(s.mid);
+		largest = std::max(largest, abs(t.mid));
+	}
+
+	if (s.rad <= abs(s.mid) * tolerance || digits >= max_digits)
+		return s;
+	long lost;
+	if (s.contains_zero())
+		lost = digits;
+	else if (largest > abs(s.mid) * 10)
+		lost = long(std::ceil(log(largest / abs(s.mid)).to_double() / std::log(10.0)));
+	else
+		return s;  // the error comes from the terms, not from cancellation
+
+	digits_guard g(std::min(max_digits, digits + lost + guard_digits));
+	return ball_evaluator(max_digits).eval_add(e);
+}
+
+ball ball_evaluator::product(const ball & a, const ball & b) const
+{
+	const numeric m = a.mid * b.mid;
+	return ball(m, abs(a.mid) * b.rad + abs(b.mid) * a.rad + a.rad * b.rad + rounding(m));
+}
+
+ball ball_evaluator::eval_mul(const ex & e) const
+{
+	ball p(1, 0);
+	for (size_t i = 0; i < e.nops(); ++i)
+		p = product(p, eval(e.op(i)));
+	return p;
+}
+
+ball ball_evaluator::inverse(const ball & a) const
+{
+	if (a.contains_zero())
+		throw std::domain_error("evalf_ball(): division by a ball containing zero");
+	const numeric m = a.mid.inverse();
+	const numeric am = abs(a.mid);
+	return ball(m, a.rad / (am * (am - a.rad)) + rounding(m));
+}
+
+/** a^n for an integer n, with |x^k - m^k| <= k*r*(|m|+r)^(k-1). */
+ball ball_evaluator::integer_power(const ball & a, const numeric & n) const
+{
+	const numeric k = abs(n);
+	if (k.is_zero())
+		return ball(1, 0);
+	const numeric m = a.mid.power(k);
+	const ball p(m, k * a.rad * (abs(a.mid) + a.rad).power(k - 1)
+	                + numeric(2 * k.int_length()) * rounding(m));
+	return n.is_negative() ? inverse(p) : p;
+}
+
+ball ball_evaluator::exponential(const ball & a) const
+{
+	// |exp(x) - exp(m)| <= exp(m)*r*exp(r)
+	const numeric m = exp(a.mid);
+	return ball(m, m * a.rad * exp(a.rad) + rounding(m));
+}
+
+ball ball_evaluator::logarithm(const ball & a) const
+{
+	if (!a.lower().is_positive())
+		throw std::domain_error("evalf_ball(): argument of log() is not positive");
+	const numeric m = log(a.mid);
+	return ball(m, a.rad / a.lower() + rounding(m));
+}
+
+ball ball_evaluator::eval_power(const ex & e) const
+{
+	const ball b = eval(e.op(0));
+	const ex & expo = e.op(1);
+	if (is_exactly_a<numeric>(expo) && ex_to<numeric>(expo).is_integer())
+		return integer_power(b, ex_to<numeric>(expo));
+	return exponential(product(eval(expo), logarithm(b)));
+}
+
+ball ball_evaluator::eval_function(const ex & e) const
+{
+	if (e.nops() != 1)
+		throw std::invalid_argument("evalf_ball(): no ball arithmetic for " + ex_to<function>(e).get_name() + "()");
+	const ball a = eval(e.op(0));
+	const numeric & m = a.mid;
+	const numeric & r = a.rad;
+
+	if (is_ex_the_function(e, exp))
+		return exponential(a);
+	if (is_ex_the_function(e, log))
+		return logarithm(a);
+	if (is_ex_the_function(e, abs))
+		return ball(abs(m), r);
+
+	// the functions with |f'| <= 1
+	numeric x;
+	bool unit_slope = true;
+	if (is_ex_the_function(e, sin))
+		x = sin(m);
+	else if (is_ex_the_function(e, cos))
+		x = cos(m);
+	else if (is_ex_the_function(e, atan))
+		x = atan(m);
+	else if (is_ex_the_function(e, tanh))
+		x = tanh(m);
+	else if (is_ex_the_function(e, asinh))
+		x = asinh(m);
+	else
+		unit_slope = false;
+	if (unit_slope)
+		return ball(x, r + rounding(x));
+
+	if (is_ex_the_function(e, sinh) || is_ex_the_function(e, cosh)) {
+		x = is_ex_the_function(e, sinh) ? sinh(m) : cosh(m);
+		return ball(x, r * cosh(abs(m) + r) + rounding(x));
+	}
+	if (is_ex_the_function(e, tan)) {
+		const numeric c = abs(cos(m)) - r;
+		if (!c.is_positive())
+			throw std::domain_error("evalf_ball(): argument of tan() contains a pole");
+		x = tan(m);
+		return ball(x, r / (c * c) + rounding(x));
+	}
+	if (is_ex_the_function(e, asin) || is_ex_the_function(e, acos) || is_ex_the_function(e, atanh)) {
+		const numeric s = abs(m) + r;
+		if (s >= 1)
+			throw std::domain_error("evalf_ball(): argument of " + ex_to<function>(e).get_name() + "() is not inside (-1, 1)");
+		if (is_ex_the_function(e, atanh)) {
+			x = atanh(m);
+			return ball(x, r / (1 - s * s) + rounding(x));
+		}
+		x = is_ex_the_function(e, asin) ? asin(m) : acos(m);
+		return ball(x, r / sqrt(1 - s * s) + rounding(x));
+	}
+	if (is_ex_the_function(e, acosh)) {
+		const numeric l = m - r;
+		if (l <= 1)
+			throw std::domain_error("evalf_ball(): argument of acosh() is not greater than 1");
+		x = acosh(m);
+		return ball(x, r / sqrt(l * l - 1) + rounding(x));
+	}
+	throw std::invalid_argument("evalf_ball(): no ball arithmetic for " + ex_to<function>(e).get_name() + "()");
+}
+
+} // anonymous namespace
+
+ball evalf_ball(const ex & e, long digits)
+{
+	if (digits < 1)
+		throw std::invalid_argument("evalf_ball(): number of digits must be positive");
+	const long max_digits = 4 * digits + 100;
+	const numeric tolerance = numeric(10).power(-digits);
+
+	// Loss of precision outside of sums, e.g. in exp() of a large argument,
+	// is made up for by evaluating everything again.
+	long w = digits + guard_digits;
+	for (;;) {
+		ball b;
+		{
+			digits_guard g(w);
+			b = ball_evaluator(max_digits).eval(e);
+		}
+		if (b.rad <= abs(b.mid) * tolerance || w >= max_digits)
+			return b;
+		const long missing = b.contains_zero() ? w : digits - b.accurate_digits();
+		w = std::min(max_digits, w + missing + guard_digits);
+	}
+}
+
+ball evalf_ball(const ex & e)
+{
+	return evalf_ball(e, Digits);
+}
+
+} // namespace GiNaC
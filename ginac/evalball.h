@@ -0,0 +1,77 @@
+/** @file evalball.h
+ *
+ *  Interface to numerical evaluation with rigorous error bounds. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_EVALBALL_H
+#define GINAC_EVALBALL_H
+
+#include "ex.h"
+#include "numeric.h"
+#include "operators.h"
+
+#include <iosfwd>
+
+namespace GiNaC {
+
+/** A real number which is only known to lie in the interval
+ *  [mid-rad, mid+rad]. */
+struct ball {
+	ball() : mid(0), rad(0) {}
+	ball(const numeric & m, const numeric & r) : mid(m), rad(r) {}
+
+	numeric lower() const { return mid - rad; }
+	numeric upper() const { return mid + rad; }
+	bool contains(const numeric & x) const { return abs(x - mid) <= rad; }
+	bool contains_zero() const { return abs(mid) <= rad; }
+
+	/** Number of correct significant decimal digits of mid, or -1 for
+	 *  an exact value. */
+	long accurate_digits() const;
+
+	numeric mid;  ///< midpoint, a rational or floating-point number
+	numeric rad;  ///< radius, non-negative
+};
+
+std::ostream & operator<<(std::ostream & os, const ball & b);
+
+/** Numerical value of e with an error bound, for certified numerics.
+ *  Numbers, constants, sums, products, powers and the elementary
+ *  functions are evaluated in ball arithmetic. The working precision
+ *  starts a few digits above the requested one and is raised only for
+ *  the sums which suffer from cancellation, until the relative radius of
+ *  the result is at most 10^-digits or a limit is reached; a value which
+ *  is zero can never be certified, so check the radius of the result.
+ *  Digits is left unchanged.
+ *
+ *  @param e expression to evaluate
+ *  @param digits requested number of correct decimal digits
+ *  @exception invalid_argument (e doesn't evaluate to a number or contains
+ *             functions without ball arithmetic)
+ *  @exception domain_error (a subexpression is not real or an argument
+ *             leaves the domain of a function) */
+ball evalf_ball(const ex & e, long digits);
+
+/** Same as evalf_ball(e, Digits). */
+ball evalf_ball(const ex & e);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_EVALBALL_H
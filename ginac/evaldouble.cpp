@@ -0,0 +1,164 @@
+/** @file evaldouble.cpp
+ *
+ *  Implementation of numerical evaluation in double precision. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "evaldouble.h"
+#include "add.h"
+#include "constant.h"
+#include "function.h"
+#include "mul.h"
+#include "numeric.h"
+#include "power.h"
+
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+#include <vector>
+
+namespace GiNaC {
+
+namespace {
+
+typedef std::complex<double> cdouble;
+
+cdouble to_complex(const numeric & n)
+{
+	if (n.is_real())
+		return cdouble(n.to_double());
+	return cdouble(n.real().to_double(), n.imag().to_double());
+}
+
+bool is_finite(const cdouble & z)
+{
+	return std::isfinite(z.real()) && std::isfinite(z.imag());
+}
+
+/** z^n by repeated squaring. */
+cdouble pow_int(cdouble z, long n)
+{
+	if (n < 0)
+		return cdouble(1) / pow_int(z, -n);
+	cdouble r(1);
+	while (n) {
+		if (n & 1)
+			r *= z;
+		z *= z;
+		n >>= 1;
+	}
+	return r;
+}
+
+/** Value of e computed by evalf().
+ *
+ *  @exception invalid_argument (e doesn't evaluate to a number) */
+cdouble evalf_cln(const ex & e)
+{
+	const ex v = e.evalf();
+	if (!is_exactly_a<numeric>(v))
+		throw std::invalid_argument("evalf_double(): expression is not numeric");
+	return to_complex(ex_to<numeric>(v));
+}
+
+bool try_eval_double(const ex & e, cdouble & r);
+
+/** Value of e, in double precision where possible. */
+cdouble eval_double(const ex & e)
+{
+	cdouble r;
+	if (try_eval_double(e, r) && is_finite(r))
+		return r;
+	return evalf_cln(e);
+}
+
+/** Value of e in double precision. Returns false if this is not possible
+ *  for the top level of e. */
+bool try_eval_double(const ex & e, cdouble & r)
+{
+	if (is_exactly_a<numeric>(e)) {
+		r = to_complex(ex_to<numeric>(e));
+		return true;
+	}
+	if (is_exactly_a<constant>(e)) {
+		const ex v = e.evalf();
+		if (!is_exactly_a<numeric>(v))
+			return false;
+		r = to_complex(ex_to<numeric>(v));
+		return true;
+	}
+	if (is_exactly_a<add>(e)) {
+		r = 0;
+		for (size_t i = 0; i < e.nops(); ++i)
+			r += eval_double(e.op(i));
+		return true;
+	}
+	if (is_exactly_a<mul>(e)) {
+		r = 1;
+		for (size_t i = 0; i < e.nops(); ++i)
+			r *= eval_double(e.op(i));
+		return true;
+	}
+	if (is_exactly_a<power>(e)) {
+		const ex & expo = e.op(1);
+		const cdouble b = eval_double(e.op(0));
+		if (is_exactly_a<numeric>(expo) && ex_to<numeric>(expo).is_integer()
+		 && abs(ex_to<numeric>(expo)) <= numeric(1L << 30)) {
+			const long n = ex_to<numeric>(expo).to_long();
+			if (n < 0 && b == cdouble(0))
+				return false;
+			r = pow_int(b, n);
+			return true;
+		}
+		const cdouble w = eval_double(expo);
+		if (b == cdouble(0))
+			return false;
+		if (b.imag() == 0 && b.real() > 0 && w.imag() == 0) {
+			r = std::pow(b.real(), w.real());
+			return true;
+		}
+		// the principal branch, with the cut approached from above as
+		// in evalf()
+		const cdouble z(b.real(), b.imag() == 0 ? 0.0 : b.imag());
+		r = std::exp(w * std::log(z));
+		return true;
+	}
+	if (is_a<function>(e)) {
+		const size_t n = e.nops();
+		std::vector<cdouble> args(n);
+		try {
+			for (size_t i = 0; i < n; ++i)
+				args[i] = eval_double(e.op(i));
+		} catch (const std::invalid_argument &) {
+			// arguments which are not numbers are left to evalf()
+			return false;
+		}
+		return ex_to<function>(e).evalf_double(n ? &args[0] : 0, r);
+	}
+	return false;
+}
+
+} // anonymous namespace
+
+std::complex<double> evalf_double(const ex & e)
+{
+	return eval_double(e);
+}
+
+} // namespace GiNaC
@@ -0,0 +1,44 @@
+/** @file evaldouble.h
+ *
+ *  Interface to numerical evaluation in double precision. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_EVALDOUBLE_H
+#define GINAC_EVALDOUBLE_H
+
+#include "ex.h"
+
+#include <complex>
+
+namespace GiNaC {
+
+/** Numerical value of e, like evalf(), but computed with hardware double
+ *  precision numbers where possible. Numbers, constants, sums, products,
+ *  powers and the functions registered with an evalf_double_func (or, for
+ *  real arguments, a double_func) are evaluated in double precision. Other subexpressions, functions which
+ *  decline the arguments and subexpressions whose value overflows are
+ *  evaluated by evalf() at the current precision (see Digits) instead.
+ *
+ *  @exception invalid_argument (e doesn't evaluate to a number) */
+std::complex<double> evalf_double(const ex & e);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_EVALDOUBLE_H
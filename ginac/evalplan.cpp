@@ -0,0 +1,742 @@
+/** @file evalplan.cpp
+ *
+ *  Implementation of expressions compiled for numerical evaluation at many
+ *  points. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "evalplan.h"
+#include "add.h"
+#include "mul.h"
+#include "power.h"
+#include "constant.h"
+#include "symbol.h"
+#include "function.h"
+#include "lst.h"
+#include "exvm.h"
+#include "parallel.h"
+#include "polynomial/sparse_mpoly.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace GiNaC {
+
+static std::complex<double> to_complex(const numeric & n)
+{
+	return std::complex<double>(n.real().to_double(), n.imag().to_double());
+}
+
+static numeric to_numeric(const std::complex<double> & c)
+{
+	if (c.imag() == 0)
+		return numeric(c.real());
+	return numeric(c.real()) + numeric(c.imag()) * I;
+}
+
+eval_plan::eval_plan(const ex & e, const lst & vars_)
+ : vars(vars_.begin(), vars_.end()), needs_cln(false), has_complex(false), complex_needs_cln(false)
+{
+	for (size_t i=0; i<vars.size(); ++i)
+		if (!is_a<symbol>(vars[i]))
+			throw std::invalid_argument("eval_plan: variables must be symbols");
+	step_map done;
+	compile(e, done);
+}
+
+size_t eval_plan::emit(const step & s)
+{
+	steps.push_back(s);
+	return steps.size() - 1;
+}
+
+/** Append the steps computing e, unless it was already done. Return the
+ *  index of the step with the result. */
+size_t eval_plan::compile(const ex & e, step_map & done)
+{
+	step_map::const_iterator it = done.find(e);
+	if (it != done.end())
+		return it->second;
+
+	size_t result;
+	if (is_exactly_a<numeric>(e)) {
+		step s(step::load_const);
+		s.value = ex_to<numeric>(e);
+		s.cvalue = to_complex(s.value);
+		if (s.value.is_real())
+			s.dvalue = s.value.to_double();
+		else
+			has_complex = true;
+		result = emit(s);
+
+	} else if (is_a<symbol>(e)) {
+		size_t i = 0;
+		while (i < vars.size() && !vars[i].is_equal(e))
+			++i;
+		if (i == vars.size())
+			throw std::runtime_error("eval_plan: expression contains the unbound symbol " + ex_to<symbol>(e).get_name());
+		step s(step::load_arg);
+		s.index = long(i);
+		result = emit(s);
+
+	} else if (is_exactly_a<constant>(e)) {
+		const ex v = e.evalf();
+		if (!is_exactly_a<numeric>(v))
+			throw std::runtime_error("eval_plan: constant without numeric value");
+		step s(step::load_constant);
+		s.expr = e;
+		s.cvalue = to_complex(ex_to<numeric>(v));
+		if (ex_to<numeric>(v).is_real())
+			s.dvalue = ex_to<numeric>(v).to_double();
+		else
+			has_complex = true;
+		result = emit(s);
+
+	} else if (is_exactly_a<add>(e) || is_exactly_a<mul>(e)) {
+		step s(is_exactly_a<add>(e) ? step::add_n : step::mul_n);
+		const size_t num = e.nops();
+		for (size_t i=0; i<num; ++i)
+			s.operands.push_back(compile(e.op(i), done));
+		result = emit(s);
+
+	} else if (is_exactly_a<power>(e)) {
+		const ex & expo = e.op(1);
+		const size_t b = compile(e.op(0), done);
+		if (expo.info(info_flags::integer) && abs(ex_to<numeric>(expo)) <= numeric(1L << 30)) {
+			step s(step::powi);
+			s.operands.push_back(b);
+			s.index = ex_to<numeric>(expo).to_long();
+			result = emit(s);
+		} else {
+			step s(step::pow);
+			s.operands.push_back(b);
+			s.operands.push_back(compile(expo, done));
+			result = emit(s);
+		}
+
+	} else if (is_a<function>(e)) {
+		step s(step::call);
+		const size_t num = e.nops();
+		for (size_t i=0; i<num; ++i)
+			s.operands.push_back(compile(e.op(i), done));
+		s.expr = e;
+		s.index = long(ex_to<function>(e).get_serial());
+		s.fk = ex_to<function>(e).get_double_func();
+		if (num == 1 && !s.fk)
+			s.f1 = vm_math_function(ex_to<function>(e).get_name());
+		if (!s.f1 && !s.fk)
+			needs_cln = true;
+		if (!ex_to<function>(e).get_evalf_double_func())
+			complex_needs_cln = true;
+		result = emit(s);
+
+	} else {
+		step s(step::generic);
+		s.expr = e;
+		needs_cln = true;
+		complex_needs_cln = true;
+		result = emit(s);
+	}
+
+	done.insert(std::make_pair(e, result));
+	return result;
+}
+
+/** Compute the values of the constants with the current precision. */
+void eval_plan::prepare(std::vector<numeric> & constants) const
+{
+	constants.resize(steps.size());
+	for (size_t i=0; i<steps.size(); ++i)
+		if (steps[i].code == step::load_constant)
+			constants[i] = ex_to<numeric>(steps[i].expr.evalf());
+}
+
+static numeric numeric_value(const ex & e)
+{
+	const ex v = e.evalf();
+	if (!is_exactly_a<numeric>(v))
+		throw std::runtime_error("eval_plan: expression doesn't evaluate to a number");
+	return ex_to<numeric>(v);
+}
+
+/** Value of step i, from the values v of the steps before it. */
+numeric eval_plan::run_step(size_t i, const std::vector<numeric> & args, const std::vector<numeric> & constants,
+                            const std::vector<numeric> & v) const
+{
+	const step & s = steps[i];
+	switch (s.code) {
+	case step::load_const:
+		return s.value;
+	case step::load_constant:
+		return constants[i];
+	case step::load_arg:
+		return args[s.index];
+	case step::add_n: {
+		numeric r = v[s.operands[0]];
+		for (size_t k=1; k<s.operands.size(); ++k)
+			r = r.add(v[s.operands[k]]);
+		return r;
+	}
+	case step::mul_n: {
+		numeric r = v[s.operands[0]];
+		for (size_t k=1; k<s.operands.size(); ++k)
+			r = r.mul(v[s.operands[k]]);
+		return r;
+	}
+	case step::powi:
+		return v[s.operands[0]].power(numeric(s.index));
+	case step::pow:
+		return v[s.operands[0]].power(v[s.operands[1]]);
+	case step::call: {
+		exvector a;
+		a.reserve(s.operands.size());
+		for (size_t k=0; k<s.operands.size(); ++k)
+			a.push_back(v[s.operands[k]]);
+		return numeric_value(function(unsigned(s.index), a));
+	}
+	case step::generic: {
+		exmap m;
+		for (size_t k=0; k<vars.size(); ++k)
+			m[vars[k]] = args[k];
+		return numeric_value(s.expr.subs(m, subs_options::no_pattern));
+	}
+	}
+	return 0;
+}
+
+numeric eval_plan::run(const std::vector<numeric> & args, const std::vector<numeric> & constants,
+                       std::vector<numeric> & v) const
+{
+	if (args.size() != vars.size())
+		throw std::invalid_argument("eval_plan: wrong number of arguments");
+	v.resize(steps.size());
+	for (size_t i=0; i<steps.size(); ++i)
+		v[i] = run_step(i, args, constants, v);
+	return numeric_value(v.back());
+}
+
+numeric eval_plan::evalf(const std::vector<numeric> & args) const
+{
+	std::vector<numeric> constants, v;
+	prepare(constants);
+	std::vector<numeric> fargs(args.size());
+	for (size_t j=0; j<args.size(); ++j)
+		fargs[j] = numeric_value(args[j]);
+	return run(fargs, constants, v);
+}
+
+std::vector<numeric> eval_plan::evalf_rows(const std::vector<std::vector<numeric> > & rows) const
+{
+	std::vector<numeric> constants, v, fargs;
+	prepare(constants);
+	std::vector<numeric> result;
+	result.reserve(rows.size());
+	for (size_t i=0; i<rows.size(); ++i) {
+		fargs.resize(rows[i].size());
+		for (size_t j=0; j<rows[i].size(); ++j)
+			fargs[j] = numeric_value(rows[i][j]);
+		result.push_back(run(fargs, constants, v));
+	}
+	return result;
+}
+
+double eval_plan::run(const double * args, std::vector<double> & v) const
+{
+	v.resize(steps.size());
+	for (size_t i=0; i<steps.size(); ++i) {
+		const step & s = steps[i];
+		switch (s.code) {
+		case step::load_const:
+		case step::load_constant:
+			v[i] = s.dvalue;
+			break;
+		case step::load_arg:
+			v[i] = args[s.index];
+			break;
+		case step::add_n: {
+			double r = v[s.operands[0]];
+			for (size_t k=1; k<s.operands.size(); ++k)
+				r += v[s.operands[k]];
+			v[i] = r;
+			break;
+		}
+		case step::mul_n: {
+			double r = v[s.operands[0]];
+			for (size_t k=1; k<s.operands.size(); ++k)
+				r *= v[s.operands[k]];
+			v[i] = r;
+			break;
+		}
+		case step::powi: {
+			double b = v[s.operands[0]];
+			long n = s.index;
+			if (n < 0) {
+				b = 1 / b;
+				n = -n;
+			}
+			double r = 1;
+			while (n) {
+				if (n & 1)
+					r *= b;
+				b *= b;
+				n >>= 1;
+			}
+			v[i] = r;
+			break;
+		}
+		case step::pow:
+			v[i] = std::pow(v[s.operands[0]], v[s.operands[1]]);
+			break;
+		case step::call:
+			if (s.f1)
+				v[i] = s.f1(v[s.operands[0]]);
+			else if (s.fk) {
+				double a[16];
+				std::vector<double> va;
+				double * pa = a;
+				if (s.operands.size() > 16) {
+					va.resize(s.operands.size());
+					pa = &va[0];
+				}
+				for (size_t k=0; k<s.operands.size(); ++k)
+					pa[k] = v[s.operands[k]];
+				v[i] = s.fk(pa);
+			} else {
+				exvector a;
+				a.reserve(s.operands.size());
+				for (size_t k=0; k<s.operands.size(); ++k)
+					a.push_back(numeric(v[s.operands[k]]));
+				v[i] = numeric_value(function(unsigned(s.index), a)).to_double();
+			}
+			break;
+		case step::generic: {
+			exmap m;
+			for (size_t k=0; k<vars.size(); ++k)
+				m[vars[k]] = numeric(args[k]);
+			v[i] = numeric_value(s.expr.subs(m, subs_options::no_pattern)).to_double();
+			break;
+		}
+		}
+	}
+	return v.back();
+}
+
+double eval_plan::evalf(const std::vector<double> & args) const
+{
+	if (has_complex)
+		throw std::runtime_error("eval_plan: complex numbers cannot be evaluated in double precision");
+	if (args.size() != vars.size())
+		throw std::invalid_argument("eval_plan: wrong number of arguments");
+	std::vector<double> v;
+	return run(args.empty() ? 0 : &args[0], v);
+}
+
+std::complex<double> eval_plan::run(const std::complex<double> * args, std::vector<std::complex<double> > & v) const
+{
+	typedef std::complex<double> cdouble;
+	v.resize(steps.size());
+	for (size_t i=0; i<steps.size(); ++i) {
+		const step & s = steps[i];
+		switch (s.code) {
+		case step::load_const:
+		case step::load_constant:
+			v[i] = s.cvalue;
+			break;
+		case step::load_arg:
+			v[i] = args[s.index];
+			break;
+		case step::add_n: {
+			cdouble r = v[s.operands[0]];
+			for (size_t k=1; k<s.operands.size(); ++k)
+				r += v[s.operands[k]];
+			v[i] = r;
+			break;
+		}
+		case step::mul_n: {
+			cdouble r = v[s.operands[0]];
+			for (size_t k=1; k<s.operands.size(); ++k)
+				r *= v[s.operands[k]];
+			v[i] = r;
+			break;
+		}
+		case step::powi: {
+			cdouble b = v[s.operands[0]];
+			long n = s.index;
+			if (n < 0) {
+				b = 1.0 / b;
+				n = -n;
+			}
+			cdouble r = 1;
+			while (n) {
+				if (n & 1)
+					r *= b;
+				b *= b;
+				n >>= 1;
+			}
+			v[i] = r;
+			break;
+		}
+		case step::pow:
+			v[i] = std::pow(v[s.operands[0]], v[s.operands[1]]);
+			break;
+		case step::call: {
+			cdouble a[16];
+			std::vector<cdouble> va;
+			cdouble * pa = a;
+			if (s.operands.size() > 16) {
+				va.resize(s.operands.size());
+				pa = &va[0];
+			}
+			for (size_t k=0; k<s.operands.size(); ++k)
+				pa[k] = v[s.operands[k]];
+			if (!ex_to<function>(s.expr).evalf_double(pa, v[i])) {
+				exvector ea;
+				ea.reserve(s.operands.size());
+				for (size_t k=0; k<s.operands.size(); ++k)
+					ea.push_back(to_numeric(pa[k]));
+				v[i] = to_complex(numeric_value(function(unsigned(s.index), ea)));
+			}
+			break;
+		}
+		case step::generic: {
+			exmap m;
+			for (size_t k=0; k<vars.size(); ++k)
+				m[vars[k]] = to_numeric(args[k]);
+			v[i] = to_complex(numeric_value(s.expr.subs(m, subs_options::no_pattern)));
+			break;
+		}
+		}
+	}
+	return v.back();
+}
+
+std::complex<double> eval_plan::evalf(const std::vector<std::complex<double> > & args) const
+{
+	if (args.size() != vars.size())
+		throw std::invalid_argument("eval_plan: wrong number of arguments");
+	std::vector<std::complex<double> > v;
+	return run(args.empty() ? 0 : &args[0], v);
+}
+
+/** Reduce the numbers of the plan modulo p. Returns false if a denominator
+ *  is divisible by p or the plan has steps other than those of a rational
+ *  function with rational coefficients. */
+bool eval_plan::prepare_mod(long p, std::vector<long> & constants) const
+{
+	constants.assign(steps.size(), 0);
+	for (size_t i=0; i<steps.size(); ++i) {
+		const step & s = steps[i];
+		switch (s.code) {
+		case step::load_const: {
+			if (!s.value.is_rational())
+				return false;
+			const long den = to_mod(cln::the<cln::cl_I>(s.value.denom().to_cl_N()), p);
+			if (den == 0)
+				return false;
+			constants[i] = mul_mod(to_mod(cln::the<cln::cl_I>(s.value.numer().to_cl_N()), p),
+			                       recip_mod(den, p), p);
+			break;
+		}
+		case step::load_arg:
+		case step::add_n:
+		case step::mul_n:
+		case step::powi:
+			break;
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+bool eval_plan::run_mod(const long * args, long p, const std::vector<long> & constants,
+                        std::vector<long> & v, long & value) const
+{
+	v.resize(steps.size());
+	for (size_t i=0; i<steps.size(); ++i) {
+		const step & s = steps[i];
+		switch (s.code) {
+		case step::load_arg:
+			v[i] = args[s.index];
+			break;
+		case step::add_n: {
+			long r = v[s.operands[0]];
+			for (size_t k=1; k<s.operands.size(); ++k)
+				r = add_mod(r, v[s.operands[k]], p);
+			v[i] = r;
+			break;
+		}
+		case step::mul_n: {
+			long r = v[s.operands[0]];
+			for (size_t k=1; k<s.operands.size(); ++k)
+				r = mul_mod(r, v[s.operands[k]], p);
+			v[i] = r;
+			break;
+		}
+		case step::powi: {
+			long b = v[s.operands[0]];
+			long n = s.index;
+			if (n < 0) {
+				if (b == 0)
+					return false;
+				b = recip_mod(b, p);
+				n = -n;
+			}
+			long r = 1;
+			while (n) {
+				if (n & 1)
+					r = mul_mod(r, b, p);
+				b = mul_mod(b, b, p);
+				n >>= 1;
+			}
+			v[i] = r;
+			break;
+		}
+		default:
+			v[i] = constants[i];
+			break;
+		}
+	}
+	value = v.back();
+	return true;
+}
+
+bool eval_plan::eval_mod(const std::vector<long> & args, long p, long & value) const
+{
+	if (args.size() != vars.size())
+		throw std::invalid_argument("eval_plan: wrong number of arguments");
+	std::vector<long> constants, v;
+	if (!prepare_mod(p, constants))
+		return false;
+	return run_mod(args.empty() ? 0 : &args[0], p, constants, v, value);
+}
+
+/** Evaluates a block of points modulo a prime. */
+struct eval_plan::mod_rows_task : public parallel_task {
+	mod_rows_task(const eval_plan & pl, const std::vector<long> & pts, long p_,
+	              const std::vector<long> & c, std::vector<long> & res)
+	 : plan(pl), points(pts), p(p_), constants(c), result(res) { }
+
+	void operator()(size_t block)
+	{
+		std::vector<long> v;
+		const size_t n = plan.vars.size();
+		const size_t end = std::min(result.size(), (block + 1) * rows_per_block);
+		for (size_t i = block * rows_per_block; i < end; ++i)
+			if (!plan.run_mod(&points[i*n], p, constants, v, result[i]))
+				result[i] = -1;
+	}
+
+	static const size_t rows_per_block = 256;
+
+	const eval_plan & plan;
+	const std::vector<long> & points;
+	const long p;
+	const std::vector<long> & constants;
+	std::vector<long> & result;
+};
+
+bool eval_plan::eval_mod_rows(const std::vector<long> & points, long p, std::vector<long> & values,
+                              bool parallel) const
+{
+	const size_t n = vars.size();
+	if (n == 0 || points.size() % n != 0)
+		throw std::invalid_argument("eval_plan: wrong number of arguments");
+	std::vector<long> constants;
+	if (!prepare_mod(p, constants))
+		return false;
+
+	// The modular arithmetic doesn't use numbers of CLN, so the points can
+	// always be shared between threads
+	values.resize(points.size() / n);
+	mod_rows_task task(*this, points, p, constants, values);
+	const size_t blocks = (values.size() + mod_rows_task::rows_per_block - 1) / mod_rows_task::rows_per_block;
+	if (parallel)
+		parallel_for(blocks, task);
+	else
+		for (size_t i=0; i<blocks; ++i)
+			task(i);
+	return true;
+}
+
+/** Evaluates a block of rows. */
+struct eval_plan::rows_task : public parallel_task {
+	rows_task(const eval_plan & p, const std::vector<std::vector<double> > & r, std::vector<double> & res)
+	 : plan(p), rows(r), result(res) { }
+
+	void operator()(size_t block)
+	{
+		std::vector<double> v;
+		const size_t end = std::min(rows.size(), (block + 1) * rows_per_block);
+		for (size_t i = block * rows_per_block; i < end; ++i)
+			result[i] = plan.run(rows[i].empty() ? 0 : &rows[i][0], v);
+	}
+
+	static const size_t rows_per_block = 256;
+
+	const eval_plan & plan;
+	const std::vector<std::vector<double> > & rows;
+	std::vector<double> & result;
+};
+
+std::vector<double> eval_plan::evalf_rows(const std::vector<std::vector<double> > & rows, bool parallel) const
+{
+	if (has_complex)
+		throw std::runtime_error("eval_plan: complex numbers cannot be evaluated in double precision");
+	for (size_t i=0; i<rows.size(); ++i)
+		if (rows[i].size() != vars.size())
+			throw std::invalid_argument("eval_plan: wrong number of arguments");
+
+	std::vector<double> result(rows.size());
+	std::vector<double> v;
+	if (!parallel || needs_cln) {
+		// Numbers of CLN can't be shared between threads
+		for (size_t i=0; i<rows.size(); ++i)
+			result[i] = run(rows[i].empty() ? 0 : &rows[i][0], v);
+		return result;
+	}
+
+	rows_task task(*this, rows, result);
+	parallel_for((rows.size() + rows_task::rows_per_block - 1) / rows_task::rows_per_block, task);
+	return result;
+}
+
+/** Evaluates a block of rows in complex double precision. */
+struct eval_plan::complex_rows_task : public parallel_task {
+	typedef std::complex<double> cdouble;
+
+	complex_rows_task(const eval_plan & p, const std::vector<std::vector<cdouble> > & r, std::vector<cdouble> & res)
+	 : plan(p), rows(r), result(res) { }
+
+	void operator()(size_t block)
+	{
+		std::vector<cdouble> v;
+		const size_t end = std::min(rows.size(), (block + 1) * rows_per_block);
+		for (size_t i = block * rows_per_block; i < end; ++i)
+			result[i] = plan.run(rows[i].empty() ? 0 : &rows[i][0], v);
+	}
+
+	static const size_t rows_per_block = 256;
+
+	const eval_plan & plan;
+	const std::vector<std::vector<cdouble> > & rows;
+	std::vector<cdouble> & result;
+};
+
+std::vector<std::complex<double> > eval_plan::evalf_rows(const std::vector<std::vector<std::complex<double> > > & rows,
+                                                         bool parallel) const
+{
+	for (size_t i=0; i<rows.size(); ++i)
+		if (rows[i].size() != vars.size())
+			throw std::invalid_argument("eval_plan: wrong number of arguments");
+
+	std::vector<std::complex<double> > result(rows.size());
+	std::vector<std::complex<double> > v;
+	if (!parallel || complex_needs_cln) {
+		for (size_t i=0; i<rows.size(); ++i)
+			result[i] = run(rows[i].empty() ? 0 : &rows[i][0], v);
+		return result;
+	}
+
+	complex_rows_task task(*this, rows, result);
+	parallel_for((rows.size() + complex_rows_task::rows_per_block - 1) / complex_rows_task::rows_per_block, task);
+	return result;
+}
+
+eval_state::eval_state(const eval_plan & p, const std::vector<numeric> & args_)
+ : plan(p), args(args_.size()), changed(args_.size(), false), digits(0), last_count(0)
+{
+	if (args.size() != plan.vars.size())
+		throw std::invalid_argument("eval_state: wrong number of arguments");
+	for (size_t j=0; j<args.size(); ++j)
+		args[j] = numeric_value(args_[j]);
+
+	// The steps are in the order of evaluation, so a step depends on a
+	// variable if one of its operands does
+	const size_t num = plan.steps.size();
+	dependents.resize(args.size());
+	std::vector<bool> depends(num);
+	for (size_t j=0; j<args.size(); ++j) {
+		for (size_t i=0; i<num; ++i) {
+			const eval_plan::step & s = plan.steps[i];
+			bool d = (s.code == eval_plan::step::generic)
+			      || (s.code == eval_plan::step::load_arg && size_t(s.index) == j);
+			for (size_t k=0; !d && k<s.operands.size(); ++k)
+				d = depends[s.operands[k]];
+			depends[i] = d;
+			if (d)
+				dependents[j].push_back(i);
+		}
+	}
+}
+
+void eval_state::set(size_t j, const numeric & value)
+{
+	if (j >= args.size())
+		throw std::out_of_range("eval_state::set(): no such variable");
+	const numeric v = numeric_value(value);
+	if (!v.is_equal(args[j])) {
+		args[j] = v;
+		changed[j] = true;
+	}
+}
+
+void eval_state::set(const ex & var, const numeric & value)
+{
+	for (size_t j=0; j<plan.vars.size(); ++j)
+		if (plan.vars[j].is_equal(var)) {
+			set(j, value);
+			return;
+		}
+	throw std::invalid_argument("eval_state::set(): no such variable");
+}
+
+numeric eval_state::value()
+{
+	const size_t num = plan.steps.size();
+	if (digits != long(Digits) || v.size() != num) {
+		// First evaluation or different precision: compute everything
+		digits = long(Digits);
+		plan.prepare(constants);
+		plan.run(args, constants, v);
+		last_count = num;
+	} else {
+		std::vector<bool> stale(num, false);
+		bool any = false;
+		for (size_t j=0; j<args.size(); ++j)
+			if (changed[j]) {
+				for (size_t k=0; k<dependents[j].size(); ++k)
+					stale[dependents[j][k]] = true;
+				any = true;
+			}
+		last_count = 0;
+		if (any)
+			for (size_t i=0; i<num; ++i)
+				if (stale[i]) {
+					v[i] = plan.run_step(i, args, constants, v);
+					++last_count;
+				}
+	}
+	changed.assign(args.size(), false);
+	return numeric_value(v.back());
+}
+
+} // namespace GiNaC
@@ -0,0 +1,183 @@
+/** @file evalplan.h
+ *
+ *  Interface to expressions compiled for numerical evaluation at many
+ *  points. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_EVALPLAN_H
+#define GINAC_EVALPLAN_H
+
+#include "ex.h"
+#include "hash_map.h"
+#include "lst.h"
+#include "numeric.h"
+
+#include <complex>
+#include <vector>
+
+namespace GiNaC {
+
+/** An expression translated into a flat list of arithmetic operations,
+ *  for computing e.subs(vars == values).evalf() for many sets of values.
+ *  Subexpressions which occur several times are computed once. Functions
+ *  are evaluated through their evalf() methods (in double precision by the
+ *  C math library or their double_func, if there is one), objects of other
+ *  classes through subs() and evalf(). */
+class eval_plan {
+public:
+	/** Translate e, which is to be evaluated for the symbols in vars. */
+	eval_plan(const ex & e, const lst & vars);
+
+	/** Value for vars[j] == args[j], in floating point numbers with the
+	 *  current precision (see Digits). */
+	numeric evalf(const std::vector<numeric> & args) const;
+
+	/** Same as evalf(), for each of the rows. */
+	std::vector<numeric> evalf_rows(const std::vector<std::vector<numeric> > & rows) const;
+
+	/** Same as evalf(), in double precision. Throws if the expression
+	 *  contains complex numbers. */
+	double evalf(const std::vector<double> & args) const;
+
+	/** Same as evalf(const std::vector<double> &), for each of the rows.
+	 *  With parallel set, the rows are distributed over several threads
+	 *  (if GiNaC was built with GINAC_THREAD_SAFE_REFCOUNT), unless the
+	 *  plan contains operations which need CLN numbers. */
+	std::vector<double> evalf_rows(const std::vector<std::vector<double> > & rows, bool parallel = false) const;
+
+	/** Same as evalf(), in complex double precision. Functions are
+	 *  evaluated by their evalf_double_func (or their double_func, for
+	 *  real arguments), and by their evalf() methods otherwise. */
+	std::complex<double> evalf(const std::vector<std::complex<double> > & args) const;
+
+	/** Same as evalf(const std::vector<std::complex<double> > &), for
+	 *  each of the rows. With parallel set, the rows are distributed over
+	 *  several threads, unless the plan contains functions without an
+	 *  evalf_double_func or objects of other classes. */
+	std::vector<std::complex<double> > evalf_rows(const std::vector<std::vector<std::complex<double> > > & rows,
+	                                              bool parallel = false) const;
+
+	/** Value for vars[j] == args[j] modulo the prime p, in machine
+	 *  integers. The arguments must be in the range [0, p) and p must be
+	 *  smaller than 2^30. Returns false if a denominator vanishes modulo p
+	 *  or the expression is not a rational function with rational
+	 *  coefficients. */
+	bool eval_mod(const std::vector<long> & args, long p, long & value) const;
+
+	/** Same as eval_mod(), for several points which are stored one after
+	 *  the other in points, with one coordinate per variable each. Where a
+	 *  denominator vanishes, the value is -1. With parallel set, the
+	 *  points are distributed over several threads (if GiNaC was built
+	 *  with GINAC_THREAD_SAFE_REFCOUNT). Returns false if the expression
+	 *  is not a rational function with rational coefficients. */
+	bool eval_mod_rows(const std::vector<long> & points, long p, std::vector<long> & values,
+	                   bool parallel = false) const;
+
+	/** Number of operations. */
+	size_t size() const { return steps.size(); }
+
+private:
+	friend class eval_state;
+
+	struct step {
+		enum opcode {
+			load_const,   ///< value
+			load_constant,///< value of the constant expr
+			load_arg,     ///< args[index]
+			add_n,        ///< sum of the operands
+			mul_n,        ///< product of the operands
+			powi,         ///< first operand to the power index
+			pow,          ///< first operand to the power of the second
+			call,         ///< the function expr applied to the operands
+			generic       ///< expr with the symbols replaced by args
+		};
+
+		step(opcode c) : code(c), index(0), dvalue(0), f1(0), fk(0) { }
+
+		opcode code;
+		std::vector<size_t> operands; ///< indices of earlier steps
+		long index;
+		numeric value;
+		ex expr;
+		double dvalue;                ///< value in double precision
+		std::complex<double> cvalue;  ///< value in complex double precision
+		double (*f1)(double);         ///< math library function for call
+		double (*fk)(const double *); ///< double_func of the function for call
+	};
+
+	typedef exhashmap<size_t> step_map;
+	struct rows_task;
+	struct complex_rows_task;
+	struct mod_rows_task;
+
+	size_t compile(const ex & e, step_map & done);
+	size_t emit(const step & s);
+	void prepare(std::vector<numeric> & constants) const;
+	numeric run(const std::vector<numeric> & args, const std::vector<numeric> & constants,
+	            std::vector<numeric> & v) const;
+	double run(const double * args, std::vector<double> & v) const;
+	std::complex<double> run(const std::complex<double> * args, std::vector<std::complex<double> > & v) const;
+	numeric run_step(size_t i, const std::vector<numeric> & args, const std::vector<numeric> & constants,
+	                 const std::vector<numeric> & v) const;
+	bool prepare_mod(long p, std::vector<long> & constants) const;
+	bool run_mod(const long * args, long p, const std::vector<long> & constants,
+	             std::vector<long> & v, long & value) const;
+
+	std::vector<step> steps;
+	exvector vars;
+	bool needs_cln;     ///< whether the double precision code uses numerics
+	bool has_complex;   ///< whether there are complex numbers
+	bool complex_needs_cln; ///< whether the complex code uses numerics
+};
+
+/** Values of an eval_plan for arguments which change a few at a time, as
+ *  in parameter scans. The values of all operations are kept, and only
+ *  those which depend on changed arguments are computed again. */
+class eval_state {
+public:
+	/** Start with vars[j] == args[j]. The plan must outlive the state. */
+	eval_state(const eval_plan & p, const std::vector<numeric> & args);
+
+	/** Change the value of the variable vars[j]. */
+	void set(size_t j, const numeric & value);
+
+	/** Change the value of the variable var. */
+	void set(const ex & var, const numeric & value);
+
+	/** Same as eval_plan::evalf() for the current arguments. Everything is
+	 *  computed again after Digits has been changed. */
+	numeric value();
+
+	/** Number of operations computed by the last call of value(). */
+	size_t recomputed() const { return last_count; }
+
+private:
+	const eval_plan & plan;
+	std::vector<numeric> args;
+	std::vector<bool> changed;                   ///< arguments set since the last value()
+	std::vector<std::vector<size_t> > dependents;///< steps depending on each argument, in order
+	std::vector<numeric> constants, v;
+	long digits;                                 ///< Digits of the last value()
+	size_t last_count;
+};
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_EVALPLAN_H
@@ -30,12 +30,38 @@
 #include "lst.h"
 #include "relational.h"
 #include "utils.h"
+#include "traversal.h"
+#include "rule_set.h"
+#include "wildcard.h"
 
+#include <cln/complex.h>
+#include <cln/float.h>
+#include <cln/rational.h>
 #include <iostream>
 #include <stdexcept>
+#include <unordered_map>
+#include <vector>
 
 namespace GiNaC {
 
+/** Number of substitution rules from which ex::subs() indexes the patterns
+ *  in a rule_set. */
+static const size_t rule_set_threshold = 8;
+
+/** Whether ex::construct_from_basic() does hash-consing. */
+static bool hash_consing_on = false;
+
+typedef std::unordered_multimap<hash_t, basic *> hash_cons_table_t;
+
+/** Table of hash-consed objects, by hash value. The table doesn't hold
+ *  references: objects remove themselves when they are destroyed. It is
+ *  never deleted, since that would have to happen after all objects. */
+static hash_cons_table_t & hash_cons_table()
+{
+	static hash_cons_table_t * table = new hash_cons_table_t;
+	return *table;
+}
+
 //////////
 // other constructors
 //////////
@@ -70,12 +96,144 @@ void ex::dbgprinttree() const
 	bp->dbgprinttree();
 }
 
+/** Coefficients of s^0, s^1, ..., s^degree(s), found in one pass like
+ *  coeffs(s). The expression must not contain negative powers of s.
+ *
+ *  @exception domain_error (negative powers of s) */
+exvector ex::coeff_vector(const ex & s) const
+{
+	std::map<int, ex> c;
+	bp->coeffs(s, c);
+	if (!c.empty() && c.begin()->first < 0)
+		throw std::domain_error("ex::coeff_vector(): negative powers");
+	exvector v(c.empty() ? 1 : c.rbegin()->first + 1, _ex0);
+	for (std::map<int, ex>::const_iterator i=c.begin(); i!=c.end(); ++i)
+		v[i->first] = i->second;
+	return v;
+}
+
+/** The status flags which show that expand(options) has nothing left to
+ *  do (the expansion with more options includes the one with fewer). The
+ *  options used internally have none. Parallel expansion gives the same
+ *  result as the standard one. */
+static unsigned expanded_flags_for(unsigned options)
+{
+	switch (options & ~expand_options::parallel) {
+	case 0:
+		return status_flags::expanded | status_flags::expanded_indexed
+		     | status_flags::expanded_function_args | status_flags::expanded_indexed_function_args;
+	case expand_options::expand_indexed:
+		return status_flags::expanded_indexed | status_flags::expanded_indexed_function_args;
+	case expand_options::expand_function_args:
+		return status_flags::expanded_function_args | status_flags::expanded_indexed_function_args;
+	case expand_options::expand_indexed | expand_options::expand_function_args:
+		return status_flags::expanded_indexed_function_args;
+	default:
+		return 0;
+	}
+}
+
+/** The status flag to set on the result of expand(options). The one for
+ *  options == 0 is set by the classes themselves. */
+static unsigned expanded_flag_of(unsigned options)
+{
+	switch (options & ~expand_options::parallel) {
+	case expand_options::expand_indexed:
+		return status_flags::expanded_indexed;
+	case expand_options::expand_function_args:
+		return status_flags::expanded_function_args;
+	case expand_options::expand_indexed | expand_options::expand_function_args:
+		return status_flags::expanded_indexed_function_args;
+	default:
+		return 0;
+	}
+}
+
+namespace {
+
+struct expand_memo_hash {
+	size_t operator()(const std::pair<const basic *, unsigned> & k) const
+	{
+		return std::hash<const basic *>()(k.first) ^ k.second;
+	}
+};
+
+/** Expansions of the subexpressions which are referenced more than once,
+ *  by object and options. The key expression keeps the object alive, so
+ *  that its address is not reused during the expansion. */
+typedef std::unordered_map<std::pair<const basic *, unsigned>, std::pair<ex, ex>, expand_memo_hash> expand_memo_t;
+
+/** Upper limit of the entries of the memo, so that keeping intermediate
+ *  results alive doesn't use too much memory. */
+const size_t expand_memo_max = 1 << 16;
+
+} // anonymous namespace
+
+/** The memo of the outermost running expand() call, or 0. */
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+static thread_local expand_memo_t * expand_memo = 0;
+#else
+static expand_memo_t * expand_memo = 0;
+#endif
+
+/** Installs a memo for the duration of the outermost expand() call. */
+struct expand_memo_scope {
+	expand_memo_scope(expand_memo_t & m) { expand_memo = &m; }
+	~expand_memo_scope() { expand_memo = 0; }
+};
+
+static ex expand_uncached(const ex & e, unsigned options)
+{
+	trace_scope timer("expand");
+	internal::count_event(ex_to<basic>(e), internal::stat_expand);
+	numeric_alloc_scope scope;
+	const ex result = ex_to<basic>(e).expand(options);
+	const unsigned flag = expanded_flag_of(options);
+	if (flag)
+		ex_to<basic>(result).setflag(flag);
+	return result;
+}
+
 ex ex::expand(unsigned options) const
 {
-	if (options == 0 && (bp->flags & status_flags::expanded)) // The "expanded" flag only covers the standard options; someone might want to re-expand with different options
+	if (bp->flags & expanded_flags_for(options))
 		return *this;
-	else
-		return bp->expand(options);
+
+	if (expand_memo == 0) {
+		expand_memo_t memo;
+		expand_memo_scope memo_scope(memo);
+		return expand_uncached(*this, options);
+	}
+
+	// A subexpression which is shared in a DAG is expanded only once per
+	// call of expand(), unless each occurrence gets new dummy indices
+	if (bp->nops() == 0 || bp->get_refcount() <= 1 || (options & expand_options::expand_rename_idx))
+		return expand_uncached(*this, options);
+	const std::pair<const basic *, unsigned> key(get_pointer(bp), options);
+	const expand_memo_t::const_iterator it = expand_memo->find(key);
+	if (it != expand_memo->end())
+		return it->second.second;
+	const ex result = expand_uncached(*this, options);
+	if (expand_memo->size() < expand_memo_max)
+		expand_memo->insert(std::make_pair(key, std::make_pair(*this, result)));
+	return result;
+}
+
+/** Evaluate object numerically.
+ *
+ *  @see traversal.h */
+ex ex::evalf(int level) const
+{
+	return traverse_evalf(*this, level);
+}
+
+/** Test for occurrence of a pattern.
+ *
+ *  @see basic::has
+ *  @see traversal.h */
+bool ex::has(const ex & pattern, unsigned options) const
+{
+	return traverse_has(*this, pattern, options);
 }
 
 /** Compute partial derivative of an expression.
@@ -85,10 +243,7 @@ ex ex::expand(unsigned options) const
  *  @return partial derivative as a new expression */
 ex ex::diff(const symbol & s, unsigned nth) const
 {
-	if (!nth)
-		return *this;
-	else
-		return bp->diff(s, nth);
+	return traverse_diff(*this, s, nth);
 }
 
 /** Check whether expression matches a specified pattern. */
@@ -115,6 +270,25 @@ bool ex::find(const ex & pattern, exset& found) const
 	return any_found;
 }
 
+/** Substitute objects in an expression (syntactic substitution).
+ *
+ *  @see traversal.h */
+ex ex::subs(const exmap & m, unsigned options) const
+{
+	trace_scope timer("subs");
+
+	// Index large sets of patterns, so that each subexpression is only
+	// matched against the patterns which may fit
+	if (!(options & subs_options::no_pattern) && m.size() >= rule_set_threshold
+	 && !rule_set::active(m)) {
+		for (exmap::const_iterator it = m.begin(); it != m.end(); ++it) {
+			if (haswild(it->first))
+				return rule_set(m).subs(*this, options);
+		}
+	}
+	return traverse_subs(*this, m, options);
+}
+
 /** Substitute objects in an expression (syntactic substitution) and return
  *  the result as a new expression. */
 ex ex::subs(const lst & ls, const lst & lr, unsigned options) const
@@ -134,7 +308,7 @@ ex ex::subs(const lst & ls, const lst & lr, unsigned options) const
 	if (!(options & subs_options::pattern_is_product))
 		options |= subs_options::pattern_is_not_product;
 
-	return bp->subs(m, options);
+	return subs(m, options);
 }
 
 /** Substitute objects in an expression (syntactic substitution) and return
@@ -155,7 +329,7 @@ ex ex::subs(const ex & e, unsigned options) const
 		else
 			options |= subs_options::pattern_is_not_product;
 
-		return bp->subs(m, options);
+		return subs(m, options);
 
 	} else if (e.info(info_flags::list)) {
 
@@ -177,7 +351,7 @@ ex ex::subs(const ex & e, unsigned options) const
 		if (!(options & subs_options::pattern_is_product))
 			options |= subs_options::pattern_is_not_product;
 
-		return bp->subs(m, options);
+		return subs(m, options);
 
 	} else
 		throw(std::invalid_argument("ex::subs(ex): argument must be a relation_equal or a list"));
@@ -238,6 +412,42 @@ ex ex::rhs() const
 	return bp->op(1);
 }
 
+/** Complex conjugate. An object that is its own conjugate is marked, so
+ *  that conjugating it again, also as part of a larger expression, takes
+ *  constant time. */
+ex ex::conjugate() const
+{
+	if (bp->flags & (status_flags::conjugate_invariant | status_flags::known_real))
+		return *this;
+	ex result = bp->conjugate();
+	if (are_ex_trivially_equal(result, *this))
+		bp->setflag(status_flags::conjugate_invariant);
+	return result;
+}
+
+/** Real part. An object found to be real is marked, like in conjugate(). */
+ex ex::real_part() const
+{
+	if (bp->flags & status_flags::known_real)
+		return *this;
+	ex result = bp->real_part();
+	if (are_ex_trivially_equal(result, *this))
+		bp->setflag(status_flags::known_real);
+	return result;
+}
+
+/** Imaginary part. An object found to be real is marked, like in
+ *  conjugate(). */
+ex ex::imag_part() const
+{
+	if (bp->flags & status_flags::known_real)
+		return _ex0;
+	ex result = bp->imag_part();
+	if (result.is_zero())
+		bp->setflag(status_flags::known_real);
+	return result;
+}
+
 /** Check whether expression is a polynomial. */
 bool ex::is_polynomial(const ex & vars) const
 {
@@ -271,6 +481,7 @@ void ex::makewriteable()
 {
 	GINAC_ASSERT(bp->flags & status_flags::dynallocated);
 	bp.makewritable();
+	bp->setflag(status_flags::dynallocated);
 	GINAC_ASSERT(bp->get_refcount() == 1);
 }
 
@@ -294,6 +505,8 @@ ptr<basic> ex::construct_from_basic(const basic & other)
 {
 	if (!(other.flags & status_flags::evaluated)) {
 
+		internal::count_event(other, internal::stat_eval);
+
 		// The object is not yet evaluated, so call eval() to evaluate
 		// the top level. This will return either
 		//  a) the original object with status_flags::evaluated set (when the
@@ -307,6 +520,17 @@ ptr<basic> ex::construct_from_basic(const basic & other)
 		// apply eval() once more. The recursion stops when eval() calls
 		// hold() or returns an object that already has its "evaluated"
 		// flag set, such as a symbol or a numeric.
+		// With hash-consing, the evaluated object may be replaced by an
+		// equal one from the table, deleting it in the recursive call
+		// below. So we hold a reference to the original one as long as we
+		// need it; it is then deleted here if nobody else wants it.
+		if (hash_consing_on && (other.flags & status_flags::dynallocated) && (other.get_refcount() == 0)) {
+			ptr<basic> keep(const_cast<basic &>(other));
+			const ex & tmpex = other.eval(1);
+			GINAC_ASSERT(tmpex.bp->flags & status_flags::dynallocated);
+			return tmpex.bp;
+		}
+
 		const ex & tmpex = other.eval(1);
 
 		// Eventually, the eval() recursion goes through the "else" branch
@@ -334,214 +558,161 @@ ptr<basic> ex::construct_from_basic(const basic & other)
 
 			// The object is already heap-allocated, so we can just make
 			// another reference to it.
+			if (hash_consing_on)
+				return hash_cons(ptr<basic>(const_cast<basic &>(other)));
 			return ptr<basic>(const_cast<basic &>(other));
 
 		} else {
 
 			// The object is not heap-allocated, so we create a duplicate
-			// on the heap.
+			// on the heap, unless it is a small integer with a flyweight.
+			if (typeid(other) == typeid(numeric)) {
+				const numeric * flyweight = find_small_integer(static_cast<const numeric &>(other));
+				if (flyweight)
+					return ptr<basic>(const_cast<numeric &>(*flyweight));
+			}
 			basic *bp = other.duplicate();
 			bp->setflag(status_flags::dynallocated);
 			GINAC_ASSERT(bp->get_refcount() == 0);
+			if (hash_consing_on)
+				return hash_cons(bp);
 			return bp;
 		}
 	}
 }
 
-basic & ex::construct_from_int(int i)
+/** Whether two real numbers are both exact, or floats of the same
+ *  precision. */
+static bool same_number_kind(const cln::cl_R & x, const cln::cl_R & y)
 {
-	switch (i) {  // prefer flyweights over new objects
-	case -12:
-		return *const_cast<numeric *>(_num_12_p);
-	case -11:
-		return *const_cast<numeric *>(_num_11_p);
-	case -10:
-		return *const_cast<numeric *>(_num_10_p);
-	case -9:
-		return *const_cast<numeric *>(_num_9_p);
-	case -8:
-		return *const_cast<numeric *>(_num_8_p);
-	case -7:
-		return *const_cast<numeric *>(_num_7_p);
-	case -6:
-		return *const_cast<numeric *>(_num_6_p);
-	case -5:
-		return *const_cast<numeric *>(_num_5_p);
-	case -4:
-		return *const_cast<numeric *>(_num_4_p);
-	case -3:
-		return *const_cast<numeric *>(_num_3_p);
-	case -2:
-		return *const_cast<numeric *>(_num_2_p);
-	case -1:
-		return *const_cast<numeric *>(_num_1_p);
-	case 0:
-		return *const_cast<numeric *>(_num0_p);
-	case 1:
-		return *const_cast<numeric *>(_num1_p);
-	case 2:
-		return *const_cast<numeric *>(_num2_p);
-	case 3:
-		return *const_cast<numeric *>(_num3_p);
-	case 4:
-		return *const_cast<numeric *>(_num4_p);
-	case 5:
-		return *const_cast<numeric *>(_num5_p);
-	case 6:
-		return *const_cast<numeric *>(_num6_p);
-	case 7:
-		return *const_cast<numeric *>(_num7_p);
-	case 8:
-		return *const_cast<numeric *>(_num8_p);
-	case 9:
-		return *const_cast<numeric *>(_num9_p);
-	case 10:
-		return *const_cast<numeric *>(_num10_p);
-	case 11:
-		return *const_cast<numeric *>(_num11_p);
-	case 12:
-		return *const_cast<numeric *>(_num12_p);
-	default:
-		basic *bp = new numeric(i);
-		bp->setflag(status_flags::dynallocated);
-		GINAC_ASSERT(bp->get_refcount() == 0);
-		return *bp;
+	const bool exact_x = instanceof(x, cln::cl_RA_ring);
+	const bool exact_y = instanceof(y, cln::cl_RA_ring);
+	if (exact_x || exact_y)
+		return exact_x == exact_y;
+	return cln::float_digits(cln::the<cln::cl_F>(x)) == cln::float_digits(cln::the<cln::cl_F>(y));
+}
+
+/** Whether the numbers in a and b, which are is_equal(), also agree in
+ *  exactness and precision. is_equal() treats 3 and 3.0 as equal, but
+ *  hash-consing must not replace one by the other. */
+static bool same_number_kinds(const basic & a, const basic & b)
+{
+	if (is_exactly_a<numeric>(a)) {
+		if (!is_exactly_a<numeric>(b))
+			return false;
+		const cln::cl_N x = ex_to<numeric>(a).to_cl_N();
+		const cln::cl_N y = ex_to<numeric>(b).to_cl_N();
+		return same_number_kind(cln::realpart(x), cln::realpart(y))
+		    && same_number_kind(cln::imagpart(x), cln::imagpart(y));
 	}
+	const size_t n = a.nops();
+	if (n != b.nops())
+		return false;
+	for (size_t i = 0; i < n; ++i) {
+		const ex oa = a.op(i), ob = b.op(i);
+		if (!are_ex_trivially_equal(oa, ob) && !same_number_kinds(ex_to<basic>(oa), ex_to<basic>(ob)))
+			return false;
+	}
+	return true;
 }
-	
-basic & ex::construct_from_uint(unsigned int i)
+
+/** Return the object in the hash-consing table which is equal to the
+ *  evaluated object p, entering p into the table if there is none. */
+ptr<basic> ex::hash_cons(const ptr<basic> & p)
 {
-	switch (i) {  // prefer flyweights over new objects
-	case 0:
-		return *const_cast<numeric *>(_num0_p);
-	case 1:
-		return *const_cast<numeric *>(_num1_p);
-	case 2:
-		return *const_cast<numeric *>(_num2_p);
-	case 3:
-		return *const_cast<numeric *>(_num3_p);
-	case 4:
-		return *const_cast<numeric *>(_num4_p);
-	case 5:
-		return *const_cast<numeric *>(_num5_p);
-	case 6:
-		return *const_cast<numeric *>(_num6_p);
-	case 7:
-		return *const_cast<numeric *>(_num7_p);
-	case 8:
-		return *const_cast<numeric *>(_num8_p);
-	case 9:
-		return *const_cast<numeric *>(_num9_p);
-	case 10:
-		return *const_cast<numeric *>(_num10_p);
-	case 11:
-		return *const_cast<numeric *>(_num11_p);
-	case 12:
-		return *const_cast<numeric *>(_num12_p);
-	default:
-		basic *bp = new numeric(i);
-		bp->setflag(status_flags::dynallocated);
-		GINAC_ASSERT(bp->get_refcount() == 0);
-		return *bp;
+	if (p->flags & (status_flags::hash_consed | status_flags::not_shareable))
+		return p;
+
+	const hash_t h = p->gethash();
+	if (!(p->flags & status_flags::hash_calculated) || p->hashvalue != h)
+		return p;  // hash_cons_forget() needs the cached hash value
+
+	hash_cons_table_t & table = hash_cons_table();
+	std::vector<basic *> candidates;
+	std::pair<hash_cons_table_t::iterator, hash_cons_table_t::iterator> range = table.equal_range(h);
+	for (hash_cons_table_t::iterator i = range.first; i != range.second; ++i) {
+		if (i->second->is_equal(*p))
+			candidates.push_back(i->second);
 	}
+	// op() of sums and products may create (and hash-cons) new objects,
+	// so the table is not iterated over any more
+	for (size_t i = 0; i < candidates.size(); ++i) {
+		if (same_number_kinds(*candidates[i], *p))
+			return ptr<basic>(*candidates[i]);
+	}
+
+	table.insert(std::make_pair(h, get_pointer(p)));
+	p->setflag(status_flags::hash_consed);
+	return p;
 }
-	
-basic & ex::construct_from_long(long i)
+
+/** Remove an object from the hash-consing table. This is called when the
+ *  object is destroyed or is about to be modified. */
+void hash_cons_forget(const basic & b)
 {
-	switch (i) {  // prefer flyweights over new objects
-	case -12:
-		return *const_cast<numeric *>(_num_12_p);
-	case -11:
-		return *const_cast<numeric *>(_num_11_p);
-	case -10:
-		return *const_cast<numeric *>(_num_10_p);
-	case -9:
-		return *const_cast<numeric *>(_num_9_p);
-	case -8:
-		return *const_cast<numeric *>(_num_8_p);
-	case -7:
-		return *const_cast<numeric *>(_num_7_p);
-	case -6:
-		return *const_cast<numeric *>(_num_6_p);
-	case -5:
-		return *const_cast<numeric *>(_num_5_p);
-	case -4:
-		return *const_cast<numeric *>(_num_4_p);
-	case -3:
-		return *const_cast<numeric *>(_num_3_p);
-	case -2:
-		return *const_cast<numeric *>(_num_2_p);
-	case -1:
-		return *const_cast<numeric *>(_num_1_p);
-	case 0:
-		return *const_cast<numeric *>(_num0_p);
-	case 1:
-		return *const_cast<numeric *>(_num1_p);
-	case 2:
-		return *const_cast<numeric *>(_num2_p);
-	case 3:
-		return *const_cast<numeric *>(_num3_p);
-	case 4:
-		return *const_cast<numeric *>(_num4_p);
-	case 5:
-		return *const_cast<numeric *>(_num5_p);
-	case 6:
-		return *const_cast<numeric *>(_num6_p);
-	case 7:
-		return *const_cast<numeric *>(_num7_p);
-	case 8:
-		return *const_cast<numeric *>(_num8_p);
-	case 9:
-		return *const_cast<numeric *>(_num9_p);
-	case 10:
-		return *const_cast<numeric *>(_num10_p);
-	case 11:
-		return *const_cast<numeric *>(_num11_p);
-	case 12:
-		return *const_cast<numeric *>(_num12_p);
-	default:
-		basic *bp = new numeric(i);
-		bp->setflag(status_flags::dynallocated);
-		GINAC_ASSERT(bp->get_refcount() == 0);
-		return *bp;
+	hash_cons_table_t & table = hash_cons_table();
+	std::pair<hash_cons_table_t::iterator, hash_cons_table_t::iterator> range = table.equal_range(b.hashvalue);
+	for (hash_cons_table_t::iterator i = range.first; i != range.second; ++i) {
+		if (i->second == &b) {
+			table.erase(i);
+			break;
+		}
 	}
+	b.clearflag(status_flags::hash_consed);
 }
-	
+
+void set_hash_consing(bool enable)
+{
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	if (enable)
+		throw std::runtime_error("set_hash_consing(): not supported with thread-safe reference counting");
+#endif
+	hash_consing_on = enable;
+}
+
+bool hash_consing_enabled()
+{
+	return hash_consing_on;
+}
+
+basic & ex::construct_from_int(int i)
+{
+	if (i >= small_integer_min && i <= small_integer_max)  // prefer flyweights over new objects
+		return const_cast<numeric &>(small_integer(i));
+	basic *bp = new numeric(i);
+	bp->setflag(status_flags::dynallocated);
+	GINAC_ASSERT(bp->get_refcount() == 0);
+	return *bp;
+}
+
+basic & ex::construct_from_uint(unsigned int i)
+{
+	if (i <= unsigned(small_integer_max))  // prefer flyweights over new objects
+		return const_cast<numeric &>(small_integer(i));
+	basic *bp = new numeric(i);
+	bp->setflag(status_flags::dynallocated);
+	GINAC_ASSERT(bp->get_refcount() == 0);
+	return *bp;
+}
+
+basic & ex::construct_from_long(long i)
+{
+	if (i >= small_integer_min && i <= small_integer_max)  // prefer flyweights over new objects
+		return const_cast<numeric &>(small_integer(i));
+	basic *bp = new numeric(i);
+	bp->setflag(status_flags::dynallocated);
+	GINAC_ASSERT(bp->get_refcount() == 0);
+	return *bp;
+}
+
 basic & ex::construct_from_ulong(unsigned long i)
 {
-	switch (i) {  // prefer flyweights over new objects
-	case 0:
-		return *const_cast<numeric *>(_num0_p);
-	case 1:
-		return *const_cast<numeric *>(_num1_p);
-	case 2:
-		return *const_cast<numeric *>(_num2_p);
-	case 3:
-		return *const_cast<numeric *>(_num3_p);
-	case 4:
-		return *const_cast<numeric *>(_num4_p);
-	case 5:
-		return *const_cast<numeric *>(_num5_p);
-	case 6:
-		return *const_cast<numeric *>(_num6_p);
-	case 7:
-		return *const_cast<numeric *>(_num7_p);
-	case 8:
-		return *const_cast<numeric *>(_num8_p);
-	case 9:
-		return *const_cast<numeric *>(_num9_p);
-	case 10:
-		return *const_cast<numeric *>(_num10_p);
-	case 11:
-		return *const_cast<numeric *>(_num11_p);
-	case 12:
-		return *const_cast<numeric *>(_num12_p);
-	default:
-		basic *bp = new numeric(i);
-		bp->setflag(status_flags::dynallocated);
-		GINAC_ASSERT(bp->get_refcount() == 0);
-		return *bp;
-	}
+	if (i <= (unsigned long)small_integer_max)  // prefer flyweights over new objects
+		return const_cast<numeric &>(small_integer(i));
+	basic *bp = new numeric(i);
+	bp->setflag(status_flags::dynallocated);
+	GINAC_ASSERT(bp->get_refcount() == 0);
+	return *bp;
 }
 	
 basic & ex::construct_from_double(double d)
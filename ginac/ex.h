@@ -25,6 +25,7 @@
 
 #include "basic.h"
 #include "ptr.h"
+#include "trace.h"
 
 #include <functional>
 #include <iosfwd>
@@ -114,8 +115,12 @@ public:
 	const_postorder_iterator postorder_end() const throw();
 
 	// evaluation
-	ex eval(int level = 0) const { return bp->eval(level); }
-	ex evalf(int level = 0) const { return bp->evalf(level); }
+	ex eval(int level = 0) const
+	{
+		trace_scope timer("eval");
+		return bp->eval(level);
+	}
+	ex evalf(int level = 0) const;
 	ex evalm() const { return bp->evalm(); }
 	ex eval_ncmul(const exvector & v) const { return bp->eval_ncmul(v); }
 	ex eval_integ() const { return bp->eval_integ(); }
@@ -140,12 +145,12 @@ public:
 	ex rhs() const;
 
 	// function for complex expressions
-	ex conjugate() const { return bp->conjugate(); }
-	ex real_part() const { return bp->real_part(); }
-	ex imag_part() const { return bp->imag_part(); }
+	ex conjugate() const;
+	ex real_part() const;
+	ex imag_part() const;
 
 	// pattern matching
-	bool has(const ex & pattern, unsigned options = 0) const { return bp->has(pattern, options); }
+	bool has(const ex & pattern, unsigned options = 0) const;
 	bool find(const ex & pattern, exset& found) const;
 	bool match(const ex & pattern) const;
 	bool match(const ex & pattern, exmap & repls) const { return bp->match(pattern, repls); }
@@ -172,6 +177,8 @@ public:
 	ex coeff(const ex & s, int n = 1) const { return bp->coeff(s, n); }
 	ex lcoeff(const ex & s) const { return coeff(s, degree(s)); }
 	ex tcoeff(const ex & s) const { return coeff(s, ldegree(s)); }
+	std::map<int, ex> coeffs(const ex & s) const { std::map<int, ex> c; bp->coeffs(s, c); return c; }
+	exvector coeff_vector(const ex & s) const;
 
 	// expand/collect
 	ex expand(unsigned options=0) const;
@@ -229,7 +236,7 @@ public:
 	unsigned return_type() const { return bp->return_type(); }
 	return_type_t return_type_tinfo() const { return bp->return_type_tinfo(); }
 
-	unsigned gethash() const { return bp->gethash(); }
+	hash_t gethash() const { return bp->gethash(); }
 
 private:
 	static ptr<basic> construct_from_basic(const basic & other);
@@ -239,6 +246,7 @@ private:
 	static basic & construct_from_ulong(unsigned long i);
 	static basic & construct_from_double(double d);
 	static ptr<basic> construct_from_string_and_lst(const std::string &s, const ex &l);
+	static ptr<basic> hash_cons(const ptr<basic> & p);
 	void makewriteable();
 	void share(const ex & other) const;
 
@@ -313,9 +321,19 @@ int ex::compare(const ex & other) const
 		return 0;
 #ifdef GINAC_COMPARE_STATISTICS
 	compare_statistics.nontrivial_compares++;
+#else
+	// Different cached hash values decide the order (see basic::compare())
+	// without calling out of line.
+	if (bp->flags & other.bp->flags & status_flags::hash_calculated
+	 && bp->hashvalue != other.bp->hashvalue) {
+		internal::count_event(*bp, internal::stat_compare);
+		return bp->hashvalue < other.bp->hashvalue ? -1 : 1;
+	}
 #endif
 	const int cmpval = bp->compare(*other.bp);
-#if 1
+#ifndef GINAC_THREAD_SAFE_REFCOUNT
+	// NB: share() rebinds ex objects which may be part of trees seen by
+	// other threads, so it is disabled in thread-safe mode.
 	if (cmpval == 0) {
 		// Expressions point to different, but equal, trees: conserve
 		// memory and make subsequent compare() operations faster by
@@ -671,6 +689,17 @@ inline bool are_ex_trivially_equal(const ex &e1, const ex &e2)
 	return e1.bp == e2.bp;
 }
 
+/** Switch hash-consing of expressions on or off. When it is on, every
+ *  evaluated object which gets wrapped in an ex is looked up in a global
+ *  table first, so that structurally equal expressions share one object
+ *  (and comparing them becomes a pointer comparison). It is off by
+ *  default because the lookups are not free, and it is not available if
+ *  the library was built with GINAC_THREAD_SAFE_REFCOUNT. */
+void set_hash_consing(bool enable);
+
+/** Check whether hash-consing is switched on (@see set_hash_consing()). */
+bool hash_consing_enabled();
+
 /* Function objects for STL sort() etc. */
 struct ex_is_less : public std::binary_function<ex, ex, bool> {
 	bool operator() (const ex &lh, const ex &rh) const { return lh.compare(rh) < 0; }
@@ -814,11 +843,6 @@ inline bool is_zero(const ex & thisex)
 inline void swap(ex & e1, ex & e2)
 { e1.swap(e2); }
 
-inline ex ex::subs(const exmap & m, unsigned options) const
-{
-	return bp->subs(m, options);
-}
-
 inline ex subs(const ex & thisex, const exmap & m, unsigned options = 0)
 { return thisex.subs(m, options); }
 
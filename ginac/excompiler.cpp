@@ -32,17 +32,33 @@
 #include <boost/mpi.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include "add.h"
 #include "ex.h"
+#include "exvm.h"
+#include "hash_map.h"
 #include "lst.h"
+#include "matrix.h"
+#include "mul.h"
+#include "numeric.h"
 #include "operators.h"
+#include "power.h"
 #include "relational.h"
 #include "symbol.h"
 
 #ifdef HAVE_LIBDL
 #include <dlfcn.h>
+#include <unistd.h>
 #endif // def HAVE_LIBDL
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+#include <mutex>
+#endif
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <iomanip>
 #include <ios>
+#include <map>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -50,7 +66,363 @@
 
 namespace GiNaC {
 
+static unsigned default_compile_ex_backend()
+{
 #ifdef HAVE_LIBDL
+	const char* env = std::getenv("GINAC_COMPILE_EX_BACKEND");
+	if (env && std::strcmp(env, "bytecode") == 0) {
+		return compile_ex_backends::bytecode;
+	}
+	return compile_ex_backends::external_compiler;
+#else
+	return compile_ex_backends::bytecode;
+#endif
+}
+
+static unsigned& compile_ex_backend()
+{
+	static unsigned backend = default_compile_ex_backend();
+	return backend;
+}
+
+void set_compile_ex_backend(unsigned backend)
+{
+	switch (backend) {
+	case compile_ex_backends::external_compiler:
+#ifndef HAVE_LIBDL
+		throw std::runtime_error("set_compile_ex_backend: the external compiler has been disabled because of missing libdl!");
+#endif
+		// fall through
+	case compile_ex_backends::bytecode:
+		compile_ex_backend() = backend;
+		break;
+	default:
+		throw std::invalid_argument("set_compile_ex_backend: invalid backend");
+	}
+}
+
+unsigned get_compile_ex_backend()
+{
+	return compile_ex_backend();
+}
+
+static std::string& compile_ex_cache_dir()
+{
+	static std::string dir = std::getenv("GINAC_COMPILE_EX_CACHE") ? std::getenv("GINAC_COMPILE_EX_CACHE") : "";
+	return dir;
+}
+
+void set_compile_ex_cache_dir(const std::string& dir)
+{
+	compile_ex_cache_dir() = dir;
+}
+
+std::string get_compile_ex_cache_dir()
+{
+	return compile_ex_cache_dir();
+}
+
+static bool& compile_ex_horner()
+{
+	static bool enable = std::getenv("GINAC_COMPILE_EX_HORNER") != 0;
+	return enable;
+}
+
+void set_compile_ex_horner(bool enable)
+{
+	compile_ex_horner() = enable;
+}
+
+bool get_compile_ex_horner()
+{
+	return compile_ex_horner();
+}
+
+namespace {
+
+/** A term of a sum, as a coefficient times integer powers of symbols. */
+struct horner_term {
+	ex coeff;
+	std::map<ex, int, ex_is_less> powers;
+};
+
+struct horner_map_function : public map_function {
+	ex operator()(const ex& e) { return horner_ex(e); }
+};
+
+/** Splits the factor f of a term into powers of symbols and coefficient. */
+void add_factor(horner_term& t, const ex& f)
+{
+	if (is_a<symbol>(f)) {
+		++t.powers[f];
+	} else if (is_exactly_a<power>(f) && is_a<symbol>(f.op(0)) && f.op(1).info(info_flags::posint)) {
+		t.powers[f.op(0)] += ex_to<numeric>(f.op(1)).to_int();
+	} else {
+		t.coeff *= horner_ex(f);
+	}
+}
+
+/** Greedy multivariate Horner scheme of the sum of the terms. */
+ex horner_terms(std::vector<horner_term>& terms)
+{
+	// The symbol which occurs in most terms is factored out first
+	std::map<ex, unsigned, ex_is_less> occurrences;
+	for (std::vector<horner_term>::const_iterator t = terms.begin(); t != terms.end(); ++t) {
+		for (std::map<ex, int, ex_is_less>::const_iterator p = t->powers.begin(); p != t->powers.end(); ++p) {
+			++occurrences[p->first];
+		}
+	}
+	ex var;
+	unsigned most = 0;
+	for (std::map<ex, unsigned, ex_is_less>::const_iterator o = occurrences.begin(); o != occurrences.end(); ++o) {
+		if (o->second > most) {
+			var = o->first;
+			most = o->second;
+		}
+	}
+
+	if (most < 2) {
+		ex sum = 0;
+		for (std::vector<horner_term>::const_iterator t = terms.begin(); t != terms.end(); ++t) {
+			ex term = t->coeff;
+			for (std::map<ex, int, ex_is_less>::const_iterator p = t->powers.begin(); p != t->powers.end(); ++p) {
+				term *= pow(p->first, p->second);
+			}
+			sum += term;
+		}
+		return sum;
+	}
+
+	int k = 0;
+	for (std::vector<horner_term>::const_iterator t = terms.begin(); t != terms.end(); ++t) {
+		std::map<ex, int, ex_is_less>::const_iterator p = t->powers.find(var);
+		if (p != t->powers.end() && (k == 0 || p->second < k)) {
+			k = p->second;
+		}
+	}
+
+	// terms = rest + var^k*inner
+	std::vector<horner_term> rest, inner;
+	for (std::vector<horner_term>::iterator t = terms.begin(); t != terms.end(); ++t) {
+		std::map<ex, int, ex_is_less>::iterator p = t->powers.find(var);
+		if (p == t->powers.end()) {
+			rest.push_back(*t);
+		} else {
+			if ((p->second -= k) == 0) {
+				t->powers.erase(p);
+			}
+			inner.push_back(*t);
+		}
+	}
+	return horner_terms(rest) + pow(var, k) * horner_terms(inner);
+}
+
+} // anonymous namespace
+
+ex horner_ex(const ex& e)
+{
+	if (is_exactly_a<add>(e)) {
+		std::vector<horner_term> terms(e.nops());
+		for (size_t i=0; i<e.nops(); ++i) {
+			const ex& t = e.op(i);
+			terms[i].coeff = 1;
+			if (is_exactly_a<mul>(t)) {
+				for (size_t j=0; j<t.nops(); ++j) {
+					add_factor(terms[i], t.op(j));
+				}
+			} else {
+				add_factor(terms[i], t);
+			}
+		}
+		return horner_terms(terms);
+	}
+	if (e.nops() == 0) {
+		return e;
+	}
+	horner_map_function f;
+	return e.map(f);
+}
+
+/** The expression from which the external compiler backend generates C code. */
+static ex c_form(const ex& e)
+{
+	return compile_ex_horner() ? horner_ex(e) : e;
+}
+
+void compile_ex(const matrix& m, const lst& syms, FUNCP_CUBA& fp, const std::string filename)
+{
+	lst entries;
+	for (unsigned r=0; r<m.rows(); ++r) {
+		for (unsigned c=0; c<m.cols(); ++c) {
+			entries.append(m(r, c));
+		}
+	}
+	compile_ex(entries, syms, fp, filename);
+}
+
+/**
+ * Common subexpression elimination for the generated C code. Subexpressions
+ * which occur more than once in the expressions passed to count() are
+ * computed only once, into temporaries which print_temporaries() declares.
+ * rewrite() then returns the expressions in terms of these temporaries.
+ */
+class cse_context
+{
+	exhashmap<unsigned> counts; /**< number of occurrences of subexpressions */
+	exhashmap<ex> replacements; /**< temporaries for common subexpressions */
+	std::vector<std::pair<ex, ex> > temporaries; /**< temporaries and their values, in order of dependency */
+
+	struct rewrite_function : public map_function
+	{
+		cse_context& c;
+		rewrite_function(cse_context& c_) : c(c_) {}
+		ex operator()(const ex& e) { return c.rewrite(e); }
+	};
+public:
+	/**
+	 * Counts the occurrences of the subexpressions of e. Subexpressions of a
+	 * subexpression which has been seen already are not counted again, since
+	 * they will be computed only once together with it.
+	 */
+	void count(const ex& e)
+	{
+		if (e.nops() == 0) {
+			return;
+		}
+		if (++counts[e] > 1) {
+			return;
+		}
+		for (size_t i=0; i<e.nops(); ++i) {
+			count(e.op(i));
+		}
+	}
+	/**
+	 * Returns e with all common subexpressions replaced by temporaries.
+	 */
+	ex rewrite(const ex& e)
+	{
+		if (e.nops() == 0) {
+			return e;
+		}
+		exhashmap<ex>::const_iterator it = replacements.find(e);
+		if (it != replacements.end()) {
+			return it->second;
+		}
+		rewrite_function f(*this);
+		ex r = e.map(f);
+		if (counts[e] > 1) {
+			std::ostringstream name;
+			name << "cse_" << temporaries.size();
+			symbol t(name.str());
+			temporaries.push_back(std::make_pair(ex(t), r));
+			replacements[e] = t;
+			return t;
+		}
+		return r;
+	}
+	/**
+	 * Prints the definitions of all temporaries as C code.
+	 */
+	void print_temporaries(std::ostream& os) const
+	{
+		for (std::vector<std::pair<ex, ex> >::const_iterator it = temporaries.begin(); it != temporaries.end(); ++it) {
+			os << "const double " << it->first << " = ";
+			it->second.print(GiNaC::print_csrc_double(os));
+			os << ";" << std::endl;
+		}
+	}
+};
+
+std::string kernel_source_ex(const lst& exprs, const lst& syms, unsigned dialect, const std::string& name)
+{
+	if (dialect != kernel_dialects::opencl && dialect != kernel_dialects::cuda) {
+		throw std::invalid_argument("kernel_source_ex: invalid dialect");
+	}
+	if (vm_has_kernels(exprs)) {
+		throw std::invalid_argument("kernel_source_ex: functions with double_func or double_batch_func can't run on a device");
+	}
+
+	// Parameter j of point i is a[j*n+i], so that neighbouring work items
+	// read neighbouring elements
+	lst replacements;
+	for (std::size_t count=0; count<syms.nops(); ++count) {
+		std::ostringstream s;
+		s << "a[" << count << "*n+i]";
+		replacements.append(syms.op(count) == symbol(s.str()));
+	}
+
+	std::vector<ex> expr_with_cname;
+	cse_context cse;
+	for (std::size_t count=0; count<exprs.nops(); ++count) {
+		expr_with_cname.push_back(c_form(exprs.op(count).subs(replacements)));
+		cse.count(expr_with_cname.back());
+	}
+	for (std::size_t count=0; count<exprs.nops(); ++count) {
+		expr_with_cname[count] = cse.rewrite(expr_with_cname[count]);
+	}
+
+	std::ostringstream ofs;
+
+	if (dialect == kernel_dialects::opencl) {
+		ofs << "#pragma OPENCL EXTENSION cl_khr_fp64 : enable" << std::endl;
+		ofs << "__kernel void " << name << "(const ulong n, __global const double* restrict a, __global double* restrict f)" << std::endl;
+		ofs << "{" << std::endl;
+		ofs << "const size_t i = get_global_id(0);" << std::endl;
+	} else {
+		ofs << "extern \"C\" __global__ void " << name << "(const size_t n, const double* __restrict__ a, double* __restrict__ f)" << std::endl;
+		ofs << "{" << std::endl;
+		ofs << "const size_t i = blockIdx.x * (size_t)blockDim.x + threadIdx.x;" << std::endl;
+	}
+	ofs << "if (i >= n) return;" << std::endl;
+	cse.print_temporaries(ofs);
+	for (std::size_t count=0; count<exprs.nops(); ++count) {
+		ofs << "f[" << count << "*n+i] = ";
+		expr_with_cname[count].print(GiNaC::print_csrc_double(ofs));
+		ofs << ";" << std::endl;
+	}
+	ofs << "}" << std::endl;
+	return ofs.str();
+}
+
+#ifdef HAVE_LIBDL
+
+/**
+ * Command which compiles the generated C code.
+ */
+static const char* excompiler_command = "ginac-excompiler";
+
+/**
+ * Returns a 64 bit FNV-1a hash of the source code and of the compiler command,
+ * in hexadecimal.
+ */
+static std::string source_hash(const std::string& source)
+{
+	unsigned long long h = 14695981039346656037ULL;
+	const std::string text = std::string(excompiler_command) + '\0' + source;
+	for (std::string::const_iterator it = text.begin(); it != text.end(); ++it) {
+		h ^= static_cast<unsigned char>(*it);
+		h *= 1099511628211ULL;
+	}
+	std::ostringstream os;
+	os << std::hex << std::setw(16) << std::setfill('0') << h;
+	return os.str();
+}
+
+static bool file_exists(const std::string& filename)
+{
+	return std::ifstream(filename.c_str()).good();
+}
+
+/**
+ * Returns the content of a file, or an empty string if it cannot be read.
+ */
+static std::string file_content(const std::string& filename)
+{
+	std::ifstream ifs(filename.c_str(), std::ios::in | std::ios::binary);
+	std::ostringstream os;
+	os << ifs.rdbuf();
+	return ifs ? os.str() : std::string();
+}
 
 /**
  * Small class that manages modules opened by libdl. It is used by compile_ex
@@ -73,6 +445,9 @@ class excompiler
 		bool clean_up; /**< if true, source and so-file will be deleted */
 	};
 	std::vector<filedesc> filelist; /**< List of all opened modules */
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	std::mutex filelist_mutex; /**< compile_ex may be called by several threads */
+#endif
 public:
 	/**
 	 * Complete clean-up of opend modules is done on destruction.
@@ -92,6 +467,9 @@ public:
 		fd.module = module;
 		fd.name = name;
 		fd.clean_up = clean_up;
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+		std::lock_guard<std::mutex> lock(filelist_mutex);
+#endif
 		filelist.push_back(fd);
 	}
 	/**
@@ -105,36 +483,27 @@ public:
 		}
 	}
 	/**
-	 * Creates a new C source file and adds a standard header. If filename is
-	 * empty, a unique random name is produced and used.
+	 * Creates a new C source file. If filename is empty, a unique random name
+	 * made from pattern (ending in XXXXXX) is produced and used.
 	 */
-	void create_src_file(std::string& filename, std::ofstream& ofs)
+	void create_src_file(std::string& filename, std::ofstream& ofs, const std::string& pattern = "./GiNaCXXXXXX")
 	{
 		if (filename.empty()) {
 			// fill filename with unique random word
-			const char* filename_pattern = "./GiNaCXXXXXX";
-			char* new_filename = new char[strlen(filename_pattern)+1];
-			strcpy(new_filename, filename_pattern);
-			if (!mktemp(new_filename)) {
-				delete[] new_filename;
-				throw std::runtime_error("mktemp failed");
+			std::vector<char> new_filename(pattern.begin(), pattern.end());
+			new_filename.push_back('\0');
+			const int fd = mkstemp(&new_filename[0]);
+			if (fd < 0) {
+				throw std::runtime_error("mkstemp failed");
 			}
-			filename = std::string(new_filename);
-			ofs.open(new_filename, std::ios::out);
-			delete[] new_filename;
-		} else {
-			// use parameter as filename
-			ofs.open(filename.c_str(), std::ios::out);
+			close(fd);
+			filename = std::string(&new_filename[0]);
 		}
+		ofs.open(filename.c_str(), std::ios::out);
 
 		if (!ofs) {
 			throw std::runtime_error("could not create source code file for compilation");
 		}
-
-		ofs << "#include <stddef.h> " << std::endl;
-		ofs << "#include <stdlib.h> " << std::endl;
-		ofs << "#include <math.h> " << std::endl;
-		ofs << std::endl;
 	}
 	/**
 	 * Calls the shell script 'ginac-excompiler' to compile the produced C
@@ -143,7 +512,7 @@ public:
 	 */
 	void compile_src_file(const std::string filename, bool clean_up)
 	{
-		std::string strcompile = "ginac-excompiler " + filename;
+		std::string strcompile = std::string(excompiler_command) + " " + filename;
 		if (system(strcompile.c_str()))
 		{
 			// try the compiler in Feel++ source
@@ -173,12 +542,75 @@ public:
 
 		return dlsym(module, "compiled_ex");
 	}
+	/**
+	 * Writes the C code, after a standard header, to a source file, compiles
+	 * it and links the so-file. Without a filename and with a cache directory
+	 * (see set_compile_ex_cache_dir()), the so-file is taken from the cache
+	 * if the same code has been compiled before, by any process.
+	 */
+	void* compile_and_link(const std::string& code, const std::string& filename, bool clean_up)
+	{
+		const std::string source = "#include <stddef.h> \n#include <stdlib.h> \n#include <math.h> \n\n" + code;
+		const std::string& cache_dir = compile_ex_cache_dir();
+		if (filename.empty() && !cache_dir.empty()) {
+			return compile_cached(source, cache_dir);
+		}
+
+		std::ofstream ofs;
+		std::string unique_filename = filename;
+		create_src_file(unique_filename, ofs);
+		ofs << source;
+		ofs.close();
+		compile_src_file(unique_filename, clean_up);
+		return link_so_file(unique_filename+".so", clean_up);
+	}
+	/**
+	 * Looks up the so-file for the source code in the cache directory, and
+	 * compiles it there if it is missing. The files are named after a hash
+	 * of the source code and of the compiler command. A hit also requires
+	 * the cached source to be equal to this one, so that a collision of
+	 * hashes does no harm. New files are compiled under unique names and
+	 * then renamed, which is atomic, so processes sharing the directory
+	 * (even over a network file system) see either no so-file or a complete
+	 * one, never a partially written one.
+	 */
+	void* compile_cached(const std::string& source, const std::string& cache_dir)
+	{
+		const std::string key = cache_dir + "/ginac-" + source_hash(source);
+		const std::string src_name = key + ".c";
+		const std::string so_name = key + ".so";
+
+		if (!(file_exists(so_name) && file_content(src_name) == source)) {
+			std::ofstream ofs;
+			std::string tmp_name;
+			create_src_file(tmp_name, ofs, key + ".XXXXXX");
+			ofs << source;
+			ofs.close();
+			try {
+				compile_src_file(tmp_name, false);
+			} catch (...) {
+				remove(tmp_name.c_str());
+				remove((tmp_name + ".so").c_str());
+				throw;
+			}
+			if (std::rename((tmp_name + ".so").c_str(), so_name.c_str()) != 0
+			 || std::rename(tmp_name.c_str(), src_name.c_str()) != 0) {
+				remove(tmp_name.c_str());
+				remove((tmp_name + ".so").c_str());
+				throw std::runtime_error("excompiler::compile_cached: could not move compiled module into the cache!");
+			}
+		}
+		return link_so_file(so_name, false);
+	}
 	/**
 	 * Removes a modules from the module list. Performs a clean-up before that.
 	 * Every module with the given name will be affected.
 	 */
 	void unlink(const std::string filename)
 	{
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+		std::lock_guard<std::mutex> lock(filelist_mutex);
+#endif
 		for (std::vector<filedesc>::iterator it = filelist.begin(); it != filelist.end();) {
 			if (it->name == filename) {
 				clean_up(it);
@@ -204,56 +636,134 @@ static excompiler global_excompiler;
 
 void compile_ex(const ex& expr, const symbol& sym, FUNCP_1P& fp, const std::string filename)
 {
+	if (compile_ex_backend() == compile_ex_backends::bytecode || vm_has_kernels(expr)) {
+		fp = vm_compile_ex(expr, sym);
+		return;
+	}
+
 	symbol x("x");
-	ex expr_with_x = expr.subs(lst(sym==x));
+	ex expr_with_x = c_form(expr.subs(lst(sym==x)));
 
-	std::ofstream ofs;
-	std::string unique_filename = filename;
-	global_excompiler.create_src_file(unique_filename, ofs);
+	std::ostringstream ofs;
 
 	ofs << "double compiled_ex(double x)" << std::endl;
 	ofs << "{" << std::endl;
+	cse_context cse;
+	cse.count(expr_with_x);
+	const ex body = cse.rewrite(expr_with_x);
+	cse.print_temporaries(ofs);
 	ofs << "double res = ";
-	expr_with_x.print(GiNaC::print_csrc_double(ofs));
+	body.print(GiNaC::print_csrc_double(ofs));
 	ofs << ";" << std::endl;
 	ofs << "return(res); " << std::endl;
 	ofs << "}" << std::endl;
 
-	ofs.close();
-
-	global_excompiler.compile_src_file(unique_filename, filename.empty());
 	// This is not standard compliant! ... no conversion between
 	// pointer-to-functions and pointer-to-objects ...
-	fp = (FUNCP_1P) global_excompiler.link_so_file(unique_filename+".so", filename.empty());
+	fp = (FUNCP_1P) global_excompiler.compile_and_link(ofs.str(), filename, filename.empty());
 }
 
 void compile_ex(const ex& expr, const symbol& sym1, const symbol& sym2, FUNCP_2P& fp, const std::string filename)
 {
+	if (compile_ex_backend() == compile_ex_backends::bytecode || vm_has_kernels(expr)) {
+		fp = vm_compile_ex(expr, sym1, sym2);
+		return;
+	}
+
 	symbol x("x"), y("y");
-	ex expr_with_xy = expr.subs(lst(sym1==x, sym2==y));
+	ex expr_with_xy = c_form(expr.subs(lst(sym1==x, sym2==y)));
 
-	std::ofstream ofs;
-	std::string unique_filename = filename;
-	global_excompiler.create_src_file(unique_filename, ofs);
+	std::ostringstream ofs;
 
 	ofs << "double compiled_ex(double x, double y)" << std::endl;
 	ofs << "{" << std::endl;
+	cse_context cse;
+	cse.count(expr_with_xy);
+	const ex body = cse.rewrite(expr_with_xy);
+	cse.print_temporaries(ofs);
 	ofs << "double res = ";
-	expr_with_xy.print(GiNaC::print_csrc_double(ofs));
+	body.print(GiNaC::print_csrc_double(ofs));
 	ofs << ";" << std::endl;
 	ofs << "return(res); " << std::endl;
 	ofs << "}" << std::endl;
 
-	ofs.close();
+	// This is not standard compliant! ... no conversion between
+	// pointer-to-functions and pointer-to-objects ...
+	fp = (FUNCP_2P) global_excompiler.compile_and_link(ofs.str(), filename, filename.empty());
+}
+
+void compile_ex(const ex& expr, const symbol& sym, FUNCP_BATCH_1P& fp, const std::string filename)
+{
+	if (compile_ex_backend() == compile_ex_backends::bytecode || vm_has_kernels(expr)) {
+		fp = vm_compile_batch_ex(expr, sym);
+		return;
+	}
+
+	symbol x("x");
+	ex expr_with_x = c_form(expr.subs(lst(sym==x)));
+	cse_context cse;
+	cse.count(expr_with_x);
+	const ex body = cse.rewrite(expr_with_x);
+
+	std::ostringstream ofs;
+
+	ofs << "void compiled_ex(size_t n, const double* restrict xs, double* restrict out)" << std::endl;
+	ofs << "{" << std::endl;
+	ofs << "size_t i;" << std::endl;
+	ofs << "for (i = 0; i < n; ++i) {" << std::endl;
+	ofs << "const double x = xs[i];" << std::endl;
+	cse.print_temporaries(ofs);
+	ofs << "out[i] = ";
+	body.print(GiNaC::print_csrc_double(ofs));
+	ofs << ";" << std::endl;
+	ofs << "}" << std::endl;
+	ofs << "}" << std::endl;
 
-	global_excompiler.compile_src_file(unique_filename, filename.empty());
 	// This is not standard compliant! ... no conversion between
 	// pointer-to-functions and pointer-to-objects ...
-	fp = (FUNCP_2P) global_excompiler.link_so_file(unique_filename+".so", filename.empty());
+	fp = (FUNCP_BATCH_1P) global_excompiler.compile_and_link(ofs.str(), filename, filename.empty());
+}
+
+void compile_ex(const ex& expr, const symbol& sym1, const symbol& sym2, FUNCP_BATCH_2P& fp, const std::string filename)
+{
+	if (compile_ex_backend() == compile_ex_backends::bytecode || vm_has_kernels(expr)) {
+		fp = vm_compile_batch_ex(expr, sym1, sym2);
+		return;
+	}
+
+	symbol x("x"), y("y");
+	ex expr_with_xy = c_form(expr.subs(lst(sym1==x, sym2==y)));
+	cse_context cse;
+	cse.count(expr_with_xy);
+	const ex body = cse.rewrite(expr_with_xy);
+
+	std::ostringstream ofs;
+
+	ofs << "void compiled_ex(size_t n, const double* restrict xs, const double* restrict ys, double* restrict out)" << std::endl;
+	ofs << "{" << std::endl;
+	ofs << "size_t i;" << std::endl;
+	ofs << "for (i = 0; i < n; ++i) {" << std::endl;
+	ofs << "const double x = xs[i];" << std::endl;
+	ofs << "const double y = ys[i];" << std::endl;
+	cse.print_temporaries(ofs);
+	ofs << "out[i] = ";
+	body.print(GiNaC::print_csrc_double(ofs));
+	ofs << ";" << std::endl;
+	ofs << "}" << std::endl;
+	ofs << "}" << std::endl;
+
+	// This is not standard compliant! ... no conversion between
+	// pointer-to-functions and pointer-to-objects ...
+	fp = (FUNCP_BATCH_2P) global_excompiler.compile_and_link(ofs.str(), filename, filename.empty());
 }
 
 void compile_ex(const lst& exprs, const lst& syms, FUNCP_CUBA& fp, const std::string filename)
 {
+	if (compile_ex_backend() == compile_ex_backends::bytecode || vm_has_kernels(exprs)) {
+		fp = vm_compile_ex(exprs, syms);
+		return;
+	}
+
 	boost::mpi::communicator world;
 	lst replacements;
 	for (std::size_t count=0; count<syms.nops(); ++count) {
@@ -263,16 +773,20 @@ void compile_ex(const lst& exprs, const lst& syms, FUNCP_CUBA& fp, const std::st
 	}
 
 	std::vector<ex> expr_with_cname;
+	cse_context cse;
+	for (std::size_t count=0; count<exprs.nops(); ++count) {
+		expr_with_cname.push_back(c_form(exprs.op(count).subs(replacements)));
+		cse.count(expr_with_cname.back());
+	}
 	for (std::size_t count=0; count<exprs.nops(); ++count) {
-		expr_with_cname.push_back(exprs.op(count).subs(replacements));
+		expr_with_cname[count] = cse.rewrite(expr_with_cname[count]);
 	}
 
-	std::ofstream ofs;
-	std::string unique_filename = filename+boost::lexical_cast<std::string>(world.rank());
-	global_excompiler.create_src_file(unique_filename, ofs);
+	std::ostringstream ofs;
 
 	ofs << "void compiled_ex(const int* an, const double a[], const int* fn, double f[])" << std::endl;
 	ofs << "{" << std::endl;
+	cse.print_temporaries(ofs);
 	for (std::size_t count=0; count<exprs.nops(); ++count) {
 		ofs << "f[" << count << "] = ";
 		expr_with_cname[count].print(GiNaC::print_csrc_double(ofs));
@@ -280,12 +794,11 @@ void compile_ex(const lst& exprs, const lst& syms, FUNCP_CUBA& fp, const std::st
 	}
 	ofs << "}" << std::endl;
 
-	ofs.close();
-
-	global_excompiler.compile_src_file(unique_filename, filename.empty());
+	// Each process writes its own files
+	const std::string unique_filename = filename.empty() ? filename : filename+boost::lexical_cast<std::string>(world.rank());
 	// This is not standard compliant! ... no conversion between
 	// pointer-to-functions and pointer-to-objects ...
-	fp = (FUNCP_CUBA) global_excompiler.link_so_file(unique_filename+".so", filename.empty());
+	fp = (FUNCP_CUBA) global_excompiler.compile_and_link(ofs.str(), unique_filename, filename.empty());
 }
 
 void link_ex(const std::string filename, FUNCP_1P& fp)
@@ -309,6 +822,20 @@ void link_ex(const std::string filename, FUNCP_CUBA& fp)
 	fp = (FUNCP_CUBA) global_excompiler.link_so_file(filename, false);
 }
 
+void link_ex(const std::string filename, FUNCP_BATCH_1P& fp)
+{
+	// This is not standard compliant! ... no conversion between
+	// pointer-to-functions and pointer-to-objects ...
+	fp = (FUNCP_BATCH_1P) global_excompiler.link_so_file(filename, false);
+}
+
+void link_ex(const std::string filename, FUNCP_BATCH_2P& fp)
+{
+	// This is not standard compliant! ... no conversion between
+	// pointer-to-functions and pointer-to-objects ...
+	fp = (FUNCP_BATCH_2P) global_excompiler.link_so_file(filename, false);
+}
+
 void unlink_ex(const std::string filename)
 {
 	global_excompiler.unlink(filename);
@@ -317,23 +844,34 @@ void unlink_ex(const std::string filename)
 #else // def HAVE_LIBDL
 
 /*
- * In case no working libdl has been found by configure, the following function
- * stubs preserve the interface. Every function just raises an exception.
+ * In case no working libdl has been found by configure, compile_ex always uses
+ * the bytecode backend. The other function stubs preserve the interface. They
+ * just raise an exception.
  */
 
 void compile_ex(const ex& expr, const symbol& sym, FUNCP_1P& fp, const std::string filename)
 {
-	throw std::runtime_error("compile_ex has been disabled because of missing libdl!");
+	fp = vm_compile_ex(expr, sym);
 }
 
 void compile_ex(const ex& expr, const symbol& sym1, const symbol& sym2, FUNCP_2P& fp, const std::string filename)
 {
-	throw std::runtime_error("compile_ex has been disabled because of missing libdl!");
+	fp = vm_compile_ex(expr, sym1, sym2);
+}
+
+void compile_ex(const ex& expr, const symbol& sym, FUNCP_BATCH_1P& fp, const std::string filename)
+{
+	fp = vm_compile_batch_ex(expr, sym);
+}
+
+void compile_ex(const ex& expr, const symbol& sym1, const symbol& sym2, FUNCP_BATCH_2P& fp, const std::string filename)
+{
+	fp = vm_compile_batch_ex(expr, sym1, sym2);
 }
 
 void compile_ex(const lst& exprs, const lst& syms, FUNCP_CUBA& fp, const std::string filename)
 {
-	throw std::runtime_error("compile_ex has been disabled because of missing libdl!");
+	fp = vm_compile_ex(exprs, syms);
 }
 
 void link_ex(const std::string filename, FUNCP_1P& fp)
@@ -351,6 +889,16 @@ void link_ex(const std::string filename, FUNCP_CUBA& fp)
 	throw std::runtime_error("link_ex has been disabled because of missing libdl!");
 }
 
+void link_ex(const std::string filename, FUNCP_BATCH_1P& fp)
+{
+	throw std::runtime_error("link_ex has been disabled because of missing libdl!");
+}
+
+void link_ex(const std::string filename, FUNCP_BATCH_2P& fp)
+{
+	throw std::runtime_error("link_ex has been disabled because of missing libdl!");
+}
+
 void unlink_ex(const std::string filename)
 {
 	throw std::runtime_error("unlink_ex has been disabled because of missing libdl!");
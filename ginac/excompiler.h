@@ -26,11 +26,13 @@
 
 #include "lst.h"
 
+#include <cstddef>
 #include <string>
 
 namespace GiNaC {
 
 class ex;
+class matrix;
 class symbol;
 
 /**
@@ -48,6 +50,98 @@ typedef double (*FUNCP_2P) (double, double);
  */
 typedef void (*FUNCP_CUBA) (const int*, const double[], const int*, double[]);
 
+/**
+ * Function pointer evaluating a function of one parameter at n points at once:
+ * out[i] = f(x[i]) for 0 <= i < n.
+ */
+typedef void (*FUNCP_BATCH_1P) (std::size_t n, const double* x, double* out);
+
+/**
+ * Function pointer evaluating a function of two parameters at n points at once:
+ * out[i] = f(x[i], y[i]) for 0 <= i < n.
+ */
+typedef void (*FUNCP_BATCH_2P) (std::size_t n, const double* x, const double* y, double* out);
+
+/**
+ * Backends of compile_ex().
+ */
+class compile_ex_backends {
+public:
+	enum {
+		external_compiler, ///< write C code, compile it with ginac-excompiler and dlopen() it
+		bytecode           ///< translate to bytecode and run it in process
+	};
+};
+
+/**
+ * Selects the backend used by compile_ex(). The default is the external compiler
+ * if the library has been built with libdl, unless the environment variable
+ * GINAC_COMPILE_EX_BACKEND is set to "bytecode". The bytecode backend needs no
+ * compiler at run time and takes microseconds instead of a compiler run, but
+ * evaluates more slowly and supports only the elementary functions of the C
+ * math library and the functions registered with a double_func or
+ * double_batch_func. It doesn't write any files, so the filename parameter of
+ * compile_ex() is ignored. Expressions containing functions with such kernels
+ * are always compiled by the bytecode backend.
+ *
+ * @param backend One of compile_ex_backends
+ */
+void set_compile_ex_backend(unsigned backend);
+
+/**
+ * Returns the backend used by compile_ex() (one of compile_ex_backends).
+ */
+unsigned get_compile_ex_backend();
+
+/**
+ * Sets the directory in which the external compiler backend of compile_ex()
+ * keeps the so-files it has compiled, to reuse them in later calls and
+ * runs. The files are named after a hash of the generated C code and the
+ * compiler command, so the same expression is compiled only once, and
+ * processes may share the directory, also on a network file system. The
+ * cache is only used if no filename is passed to compile_ex(). The default
+ * is the value of the environment variable GINAC_COMPILE_EX_CACHE; an
+ * empty string (the default if that is not set) disables the cache. The
+ * directory must exist, and old files have to be deleted by hand.
+ *
+ * @param dir Cache directory
+ */
+void set_compile_ex_cache_dir(const std::string& dir);
+
+/**
+ * Returns the cache directory of compile_ex(), or an empty string.
+ */
+std::string get_compile_ex_cache_dir();
+
+/**
+ * Selects whether the external compiler backend of compile_ex() and
+ * kernel_source_ex() rewrite polynomials into Horner schemes (see horner_ex())
+ * before generating the C code. The default is off, unless the environment
+ * variable GINAC_COMPILE_EX_HORNER is set.
+ *
+ * @param enable Whether to use Horner schemes
+ */
+void set_compile_ex_horner(bool enable);
+
+/**
+ * Returns whether compile_ex() uses Horner schemes.
+ */
+bool get_compile_ex_horner();
+
+/**
+ * Rewrites the sums in an expanded polynomial (and the polynomials in the
+ * arguments of functions and powers) into multivariate Horner schemes. The
+ * symbol occurring in most terms is factored out with its smallest power,
+ * and the same is repeated on the cofactor and on the remaining terms, so
+ * 1+2*x+3*x^2+4*x^3 becomes 1+x*(2+x*(3+4*x)). Printed as C code, this
+ * needs fewer multiplications than the expanded form, the integer powers
+ * of symbols are multiplication chains, and every level is a multiply-add.
+ * Factors other than integer powers of symbols are kept as coefficients.
+ *
+ * @param e Expression to be rewritten
+ */
+ex horner_ex(const ex& e);
+
 /**
  * Takes an expression and produces a function pointer to the compiled and linked
  * C code equivalent in double precision. The function pointer has type FUNCP_1P.
@@ -84,6 +178,80 @@ void compile_ex(const ex& expr, const symbol& sym1, const symbol& sym2, FUNCP_2P
  */
 void compile_ex(const lst& exprs, const lst& syms, FUNCP_CUBA& fp, const std::string filename = "");
 
+/**
+ * Takes a matrix of expressions (e.g. a Jacobian) and produces a function pointer
+ * to the compiled and linked C code equivalent in double precision, which fills
+ * all entries at once. The function pointer has type FUNCP_CUBA; f[i*cols+j]
+ * receives the entry in row i and column j. Common subexpressions of all entries
+ * are computed only once.
+ *
+ * @param m Matrix of expressions to be compiled
+ * @param syms Symbols from the expressions to become the function parameters
+ * @param fp Returned function pointer
+ * @param filename Name of the intermediate source code and so-file. If
+ * supplied, these intermediate files will not be deleted
+ */
+void compile_ex(const matrix& m, const lst& syms, FUNCP_CUBA& fp, const std::string filename = "");
+
+/**
+ * Takes an expression and produces a function pointer to the compiled and linked
+ * C code equivalent in double precision, evaluating the expression for a whole
+ * array of parameter values in one call. The function pointer has type
+ * FUNCP_BATCH_1P. The generated loop has no dependencies between its
+ * iterations, so that the C compiler can vectorize it.
+ *
+ * @param expr Expression to be compiled
+ * @param sym Symbol from the expression to become the function parameter
+ * @param fp Returned function pointer
+ * @param filename Name of the intermediate source code and so-file. If
+ * supplied, these intermediate files will not be deleted
+ */
+void compile_ex(const ex& expr, const symbol& sym, FUNCP_BATCH_1P& fp, const std::string filename = "");
+
+/**
+ * Takes an expression and produces a function pointer to the compiled and linked
+ * C code equivalent in double precision, evaluating the expression for whole
+ * arrays of parameter values in one call. The function pointer has type
+ * FUNCP_BATCH_2P.
+ *
+ * @param expr Expression to be compiled
+ * @param sym1 Symbol from the expression to become the first function parameter
+ * @param sym2 Symbol from the expression to become the second function parameter
+ * @param fp Returned function pointer
+ * @param filename Name of the intermediate source code and so-file. If
+ * supplied, these intermediate files will not be deleted
+ */
+void compile_ex(const ex& expr, const symbol& sym1, const symbol& sym2, FUNCP_BATCH_2P& fp, const std::string filename = "");
+
+/**
+ * Dialects of the kernels written by kernel_source_ex().
+ */
+class kernel_dialects {
+public:
+	enum {
+		opencl, ///< OpenCL C, for clCreateProgramWithSource()
+		cuda    ///< CUDA C++, for nvcc or NVRTC
+	};
+};
+
+/**
+ * Returns the source code of a GPU kernel evaluating a list of expressions in
+ * double precision at n points, one point per work item (thread). Parameter j
+ * of point i is read from a[j*n+i] and expression k is written to f[k*n+i],
+ * so the arrays are laid out for coalesced access. Common subexpressions are
+ * computed only once. The kernel has the signature
+ * name(n, const double* a, double* f) with the address space qualifiers and
+ * the index computation of the dialect; launch it with at least n work items.
+ * Compiling and launching the kernel is left to the caller's OpenCL or CUDA
+ * runtime, which owns the device and the device arrays.
+ *
+ * @param exprs List of expressions to be compiled
+ * @param syms Symbols from the expressions to become the parameters
+ * @param dialect One of kernel_dialects
+ * @param name Name of the kernel
+ */
+std::string kernel_source_ex(const lst& exprs, const lst& syms, unsigned dialect, const std::string& name = "compiled_ex");
+
 /** 
  * Opens an existing so-file and returns a function pointer of type FUNCP_1P to
  * the contained function. The so-file has to be generated by compile_ex in
@@ -114,6 +282,26 @@ void link_ex(const std::string filename, FUNCP_2P& fp);
  */
 void link_ex(const std::string filename, FUNCP_CUBA& fp);
 
+/** 
+ * Opens an existing so-file and returns a function pointer of type FUNCP_BATCH_1P
+ * to the contained function. The so-file has to be generated by compile_ex in
+ * advance.
+ *
+ * @param filename Name of the so-file to open and link
+ * @param fp Returned function pointer
+ */
+void link_ex(const std::string filename, FUNCP_BATCH_1P& fp);
+
+/** 
+ * Opens an existing so-file and returns a function pointer of type FUNCP_BATCH_2P
+ * to the contained function. The so-file has to be generated by compile_ex in
+ * advance.
+ *
+ * @param filename Name of the so-file to open and link
+ * @param fp Returned function pointer
+ */
+void link_ex(const std::string filename, FUNCP_BATCH_2P& fp);
+
 /**
  * Closes all linked .so files that have the supplied filename.
  *
@@ -121,6 +309,21 @@ void link_ex(const std::string filename, FUNCP_CUBA& fp);
  */
 void unlink_ex(const std::string filename);
 
+/**
+ * Frees a function compiled by the bytecode backend of compile_ex(). Only
+ * 512 bytecode functions of each signature can exist at the same time, so
+ * programs compiling many expressions should release the ones they no
+ * longer need. fp must not be called afterwards. Functions compiled by the
+ * external compiler are left alone; they are closed by unlink_ex().
+ *
+ * @param fp Function pointer returned by compile_ex()
+ */
+void release_ex(FUNCP_1P fp);
+void release_ex(FUNCP_2P fp);
+void release_ex(FUNCP_CUBA fp);
+void release_ex(FUNCP_BATCH_1P fp);
+void release_ex(FUNCP_BATCH_2P fp);
+
 } // namespace GiNaC
 
 #endif // ndef GINAC_EXCOMPILER_H
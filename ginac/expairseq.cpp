@@ -27,16 +27,15 @@
 #include "power.h"
 #include "relational.h"
 #include "wildcard.h"
+#include "ac_match.h"
 #include "archive.h"
 #include "operators.h"
 #include "utils.h"
 #include "hash_seed.h"
+#include "numsum.h"
 #include "indexed.h"
 
 #include <algorithm>
-#if EXPAIRSEQ_USE_HASHTAB
-#include <cmath>
-#endif // EXPAIRSEQ_USE_HASHTAB
 #include <iostream>
 #include <iterator>
 #include <stdexcept>
@@ -70,9 +69,6 @@ public:
 // public
 
 expairseq::expairseq() 
-#if EXPAIRSEQ_USE_HASHTAB
-	: hashtabsize(0)
-#endif // EXPAIRSEQ_USE_HASHTAB
 {}
 
 // protected
@@ -83,24 +79,6 @@ void expairseq::copy(const expairseq &other)
 {
 	seq = other.seq;
 	overall_coeff = other.overall_coeff;
-#if EXPAIRSEQ_USE_HASHTAB
-	// copy hashtab
-	hashtabsize = other.hashtabsize;
-	if (hashtabsize!=0) {
-		hashmask = other.hashmask;
-		hashtab.resize(hashtabsize);
-		epvector::const_iterator osb = other.seq.begin();
-		for (unsigned i=0; i<hashtabsize; ++i) {
-			hashtab[i].clear();
-			for (epplist::const_iterator cit=other.hashtab[i].begin();
-			     cit!=other.hashtab[i].end(); ++cit) {
-				hashtab[i].push_back(seq.begin()+((*cit)-osb));
-			}
-		}
-	} else {
-		hashtab.clear();
-	}
-#endif // EXPAIRSEQ_USE_HASHTAB
 }
 #endif
 
@@ -111,12 +89,14 @@ void expairseq::copy(const expairseq &other)
 expairseq::expairseq(const ex &lh, const ex &rh)
 {
 	construct_from_2_ex(lh,rh);
+	internal::count_event(*this, internal::stat_construction);
 	GINAC_ASSERT(is_canonical());
 }
 
 expairseq::expairseq(const exvector &v)
 {
 	construct_from_exvector(v);
+	internal::count_event(*this, internal::stat_construction);
 	GINAC_ASSERT(is_canonical());
 }
 
@@ -125,15 +105,37 @@ expairseq::expairseq(const epvector &v, const ex &oc, bool do_index_renaming)
 {
 	GINAC_ASSERT(is_a<numeric>(oc));
 	construct_from_epvector(v, do_index_renaming);
+	internal::count_event(*this, internal::stat_construction);
+	GINAC_ASSERT(is_canonical());
+}
+
+expairseq::expairseq(epvector &&v, const ex &oc, bool do_index_renaming)
+  :  overall_coeff(oc)
+{
+	GINAC_ASSERT(is_a<numeric>(oc));
+	construct_from_epvector(std::move(v), do_index_renaming);
+	internal::count_event(*this, internal::stat_construction);
 	GINAC_ASSERT(is_canonical());
 }
 
+/** Construct from a sequence held by a shared pointer. Like for the
+ *  containers, the sequence is taken over and left empty. */
 expairseq::expairseq(std::shared_ptr<epvector> vp, const ex &oc, bool do_index_renaming)
   :  overall_coeff(oc)
 {
 	GINAC_ASSERT(vp.get()!=0);
 	GINAC_ASSERT(is_a<numeric>(oc));
-	construct_from_epvector(*vp, do_index_renaming);
+	construct_from_epvector(std::move(*vp), do_index_renaming);
+	internal::count_event(*this, internal::stat_construction);
+	GINAC_ASSERT(is_canonical());
+}
+
+expairseq::expairseq(std::shared_ptr<epvector> vp, const ex &oc, canonical_seq_t)
+  :  overall_coeff(oc)
+{
+	GINAC_ASSERT(is_a<numeric>(oc));
+	construct_from_canonical_epvector(vp);
+	internal::count_event(*this, internal::stat_construction);
 	GINAC_ASSERT(is_canonical());
 }
 
@@ -144,8 +146,8 @@ expairseq::expairseq(std::shared_ptr<epvector> vp, const ex &oc, bool do_index_r
 void expairseq::read_archive(const archive_node &n, lst &sym_lst) 
 {
 	inherited::read_archive(n, sym_lst);
-	archive_node::archive_node_cit first = n.find_first("rest");
-	archive_node::archive_node_cit last = n.find_last("coeff");
+	archive_node::archive_node_cit first = n.find_first(archive_node::KN_REST);
+	archive_node::archive_node_cit last = n.find_last(archive_node::KN_COEFF);
 	++last;
 	seq.reserve((last-first)/2);
 
@@ -157,7 +159,7 @@ void expairseq::read_archive(const archive_node &n, lst &sym_lst)
 		seq.push_back(expair(rest, coeff));
 	}
 
-	n.find_ex("overall_coeff", overall_coeff, sym_lst);
+	n.find_ex(archive_node::KN_OVERALL_COEFF, overall_coeff, sym_lst);
 
 	canonicalize();
 	GINAC_ASSERT(is_canonical());
@@ -208,59 +210,6 @@ void expairseq::do_print_tree(const print_tree & c, unsigned level) const
 		overall_coeff.print(c, level + c.delta_indent);
 	}
 	c.s << std::string(level + c.delta_indent,' ') << "=====" << std::endl;
-#if EXPAIRSEQ_USE_HASHTAB
-	c.s << std::string(level + c.delta_indent,' ')
-	    << "hashtab size " << hashtabsize << std::endl;
-	if (hashtabsize == 0) return;
-#define MAXCOUNT 5
-	unsigned count[MAXCOUNT+1];
-	for (int i=0; i<MAXCOUNT+1; ++i)
-		count[i] = 0;
-	unsigned this_bin_fill;
-	unsigned cum_fill_sq = 0;
-	unsigned cum_fill = 0;
-	for (unsigned i=0; i<hashtabsize; ++i) {
-		this_bin_fill = 0;
-		if (hashtab[i].size() > 0) {
-			c.s << std::string(level + c.delta_indent, ' ')
-			    << "bin " << i << " with entries ";
-			for (epplist::const_iterator it=hashtab[i].begin();
-			     it!=hashtab[i].end(); ++it) {
-				c.s << *it-seq.begin() << " ";
-				++this_bin_fill;
-			}
-			c.s << std::endl;
-			cum_fill += this_bin_fill;
-			cum_fill_sq += this_bin_fill*this_bin_fill;
-		}
-		if (this_bin_fill<MAXCOUNT)
-			++count[this_bin_fill];
-		else
-			++count[MAXCOUNT];
-	}
-	unsigned fact = 1;
-	double cum_prob = 0;
-	double lambda = (1.0*seq.size()) / hashtabsize;
-	for (int k=0; k<MAXCOUNT; ++k) {
-		if (k>0)
-			fact *= k;
-		double prob = std::pow(lambda,k)/fact * std::exp(-lambda);
-		cum_prob += prob;
-		c.s << std::string(level + c.delta_indent, ' ') << "bins with " << k << " entries: "
-		    << int(1000.0*count[k]/hashtabsize)/10.0 << "% (expected: "
-		    << int(prob*1000)/10.0 << ")" << std::endl;
-	}
-	c.s << std::string(level + c.delta_indent, ' ') << "bins with more entries: "
-	    << int(1000.0*count[MAXCOUNT]/hashtabsize)/10.0 << "% (expected: "
-	    << int((1-cum_prob)*1000)/10.0 << ")" << std::endl;
-
-	c.s << std::string(level + c.delta_indent, ' ') << "variance: "
-	    << 1.0/hashtabsize*cum_fill_sq-(1.0/hashtabsize*cum_fill)*(1.0/hashtabsize*cum_fill)
-	    << std::endl;
-	c.s << std::string(level + c.delta_indent, ' ') << "average fill: "
-	    << (1.0*cum_fill)/hashtabsize
-	    << " (should be equal to " << (1.0*seq.size())/hashtabsize << ")" << std::endl;
-#endif // EXPAIRSEQ_USE_HASHTAB
 }
 
 bool expairseq::info(unsigned inf) const
@@ -306,7 +255,7 @@ ex expairseq::op(size_t i) const
 
 ex expairseq::map(map_function &f) const
 {
-	std::shared_ptr<epvector> v(new epvector);
+	std::shared_ptr<epvector> v = std::make_shared<epvector>();
 	v->reserve(seq.size()+1);
 
 	epvector::const_iterator cit = seq.begin(), last = seq.end();
@@ -316,14 +265,14 @@ ex expairseq::map(map_function &f) const
 	}
 
 	if (overall_coeff.is_equal(default_overall_coeff()))
-		return thisexpairseq(v, default_overall_coeff(), true);
+		return thisexpairseq(std::move(v), default_overall_coeff(), true);
 	else {
 		ex newcoeff = f(overall_coeff);
 		if(is_a<numeric>(newcoeff))
-			return thisexpairseq(v, newcoeff, true);
+			return thisexpairseq(std::move(v), newcoeff, true);
 		else {
 			v->push_back(split_ex_to_pair(newcoeff));
-			return thisexpairseq(v, default_overall_coeff(), true);
+			return thisexpairseq(std::move(v), default_overall_coeff(), true);
 		}
 	}
 }
@@ -338,7 +287,7 @@ ex expairseq::eval(int level) const
 	if (vp.get() == 0)
 		return this->hold();
 	
-	return (new expairseq(vp, overall_coeff))->setflag(status_flags::dynallocated | status_flags::evaluated);
+	return (new expairseq(std::move(vp), overall_coeff))->setflag(status_flags::dynallocated | status_flags::evaluated);
 }
 
 epvector* conjugateepvector(const epvector&epv)
@@ -370,11 +319,59 @@ ex expairseq::conjugate() const
 	if (!newepv && are_ex_trivially_equal(x, overall_coeff)) {
 		return *this;
 	}
-	ex result = thisexpairseq(newepv ? *newepv : seq, x);
-	delete newepv;
-	return result;
+	if (newepv)
+		return thisexpairseq(std::shared_ptr<epvector>(newepv), x);
+	return thisexpairseq(seq, x);
 }
 
+/** The sum or product of some of the terms (as given by op()) of this
+ *  object, for the global wildcard of a pattern. */
+ex expairseq::rest_of_terms(const exvector & terms) const
+{
+	std::shared_ptr<epvector> vp = std::make_shared<epvector>();
+	vp->reserve(terms.size());
+	for (size_t i=0; i<terms.size(); i++)
+		vp->push_back(split_ex_to_pair(terms[i]));
+	return thisexpairseq(std::move(vp), default_overall_coeff());
+}
+
+/** Matcher for the terms of an expairseq, which assigns the unmatched terms
+ *  to the global wildcard of the pattern (if there is one). */
+class expairseq_matcher : public ac_matcher {
+public:
+	expairseq_matcher(const expairseq & s, const exvector & ops, const exvector & pattern_ops,
+	                  bool has_global, const ex & global)
+	 : ac_matcher(ops, pattern_ops, !has_global), seq(s), has_global_wildcard(has_global),
+	   global_wildcard(global) {}
+
+protected:
+	bool accept(exmap & repls)
+	{
+		if (!has_global_wildcard)
+			return true;
+
+		// Assign all the remaining terms to the global wildcard (unless
+		// it has already been matched before, in which case the matches
+		// must be equal)
+		exvector rest;
+		for (size_t i=0; i<subject.size(); i++) {
+			if (!used(i))
+				rest.push_back(subject[i]);
+		}
+		const ex r = seq.rest_of_terms(rest);
+		exmap::const_iterator it = repls.find(global_wildcard);
+		if (it != repls.end())
+			return r.is_equal(it->second);
+		repls[global_wildcard] = r;
+		return true;
+	}
+
+private:
+	const expairseq & seq;
+	bool has_global_wildcard;
+	ex global_wildcard;
+};
+
 bool expairseq::match(const ex & pattern, exmap & repl_lst) const
 {
 	// This differs from basic::match() because we want "a+b+c+d" to
@@ -394,57 +391,23 @@ bool expairseq::match(const ex & pattern, exmap & repl_lst) const
 			}
 		}
 
-		// Unfortunately, this is an O(N^2) operation because we can't
-		// sort the pattern in a useful way...
-
 		// Chop into terms
-		exvector ops;
+		exvector ops, pattern_ops;
 		ops.reserve(nops());
 		for (size_t i=0; i<nops(); i++)
 			ops.push_back(op(i));
-
-		// Now, for every term of the pattern, look for a matching term in
-		// the expression and remove the match
+		pattern_ops.reserve(pattern.nops());
 		for (size_t i=0; i<pattern.nops(); i++) {
-			ex p = pattern.op(i);
-			if (has_global_wildcard && p.is_equal(global_wildcard))
-				continue;
-			exvector::iterator it = ops.begin(), itend = ops.end();
-			while (it != itend) {
-				if (it->match(p, repl_lst)) {
-					ops.erase(it);
-					goto found;
-				}
-				++it;
-			}
-			return false; // no match found
-found:		;
+			const ex p = pattern.op(i);
+			if (!has_global_wildcard || !p.is_equal(global_wildcard))
+				pattern_ops.push_back(p);
 		}
 
-		if (has_global_wildcard) {
-
-			// Assign all the remaining terms to the global wildcard (unless
-			// it has already been matched before, in which case the matches
-			// must be equal)
-			size_t num = ops.size();
-			std::shared_ptr<epvector> vp(new epvector);
-			vp->reserve(num);
-			for (size_t i=0; i<num; i++)
-				vp->push_back(split_ex_to_pair(ops[i]));
-			ex rest = thisexpairseq(vp, default_overall_coeff());
-			for (exmap::const_iterator it = repl_lst.begin(); it != repl_lst.end(); ++it) {
-				if (it->first.is_equal(global_wildcard))
-					return rest.is_equal(it->second);
-			}
-			repl_lst[global_wildcard] = rest;
-			return true;
-
-		} else {
-
-			// No global wildcard, then the match fails if there are any
-			// unmatched terms left
-			return ops.empty();
-		}
+		// Match every term of the pattern with a different term of the
+		// expression. The remaining terms, if any, go to the global
+		// wildcard
+		expairseq_matcher m(*this, ops, pattern_ops, has_global_wildcard, global_wildcard);
+		return m.run(repl_lst);
 	}
 	return inherited::match(pattern, repl_lst);
 }
@@ -453,7 +416,7 @@ ex expairseq::subs(const exmap & m, unsigned options) const
 {
 	std::shared_ptr<epvector> vp = subschildren(m, options);
 	if (vp.get())
-		return ex_to<basic>(thisexpairseq(vp, overall_coeff, (options & subs_options::no_index_renaming) == 0));
+		return ex_to<basic>(thisexpairseq(std::move(vp), overall_coeff, (options & subs_options::no_index_renaming) == 0));
 	else if ((options & subs_options::algebraic) && is_exactly_a<mul>(*this))
 		return static_cast<const mul *>(this)->algebraic_subs_mul(m, options);
 	else
@@ -478,54 +441,20 @@ int expairseq::compare_same_type(const basic &other) const
 	if (cmpval!=0)
 		return cmpval;
 	
-#if EXPAIRSEQ_USE_HASHTAB
-	GINAC_ASSERT(hashtabsize==o.hashtabsize);
-	if (hashtabsize==0) {
-#endif // EXPAIRSEQ_USE_HASHTAB
-		epvector::const_iterator cit1 = seq.begin();
-		epvector::const_iterator cit2 = o.seq.begin();
-		epvector::const_iterator last1 = seq.end();
-		epvector::const_iterator last2 = o.seq.end();
-		
-		for (; (cit1!=last1)&&(cit2!=last2); ++cit1, ++cit2) {
-			cmpval = (*cit1).compare(*cit2);
-			if (cmpval!=0) return cmpval;
-		}
-		
-		GINAC_ASSERT(cit1==last1);
-		GINAC_ASSERT(cit2==last2);
-		
-		return 0;
-#if EXPAIRSEQ_USE_HASHTAB
-	}
+	epvector::const_iterator cit1 = seq.begin();
+	epvector::const_iterator cit2 = o.seq.begin();
+	epvector::const_iterator last1 = seq.end();
+	epvector::const_iterator last2 = o.seq.end();
 	
-	// compare number of elements in each hashtab entry
-	for (unsigned i=0; i<hashtabsize; ++i) {
-		unsigned cursize=hashtab[i].size();
-		if (cursize != o.hashtab[i].size())
-			return (cursize < o.hashtab[i].size()) ? -1 : 1;
+	for (; (cit1!=last1)&&(cit2!=last2); ++cit1, ++cit2) {
+		cmpval = (*cit1).compare(*cit2);
+		if (cmpval!=0) return cmpval;
 	}
 	
-	// compare individual (sorted) hashtab entries
-	for (unsigned i=0; i<hashtabsize; ++i) {
-		unsigned sz = hashtab[i].size();
-		if (sz>0) {
-			const epplist &eppl1 = hashtab[i];
-			const epplist &eppl2 = o.hashtab[i];
-			epplist::const_iterator it1 = eppl1.begin();
-			epplist::const_iterator it2 = eppl2.begin();
-			while (it1!=eppl1.end()) {
-				cmpval = (*(*it1)).compare(*(*it2));
-				if (cmpval!=0)
-					return cmpval;
-				++it1;
-				++it2;
-			}
-		}
-	}
+	GINAC_ASSERT(cit1==last1);
+	GINAC_ASSERT(cit2==last2);
 	
-	return 0; // equal
-#endif // EXPAIRSEQ_USE_HASHTAB
+	return 0;
 }
 
 bool expairseq::is_equal_same_type(const basic &other) const
@@ -540,56 +469,17 @@ bool expairseq::is_equal_same_type(const basic &other) const
 	if (!overall_coeff.is_equal(o.overall_coeff))
 		return false;
 	
-#if EXPAIRSEQ_USE_HASHTAB
-	// compare number of elements in each hashtab entry
-	if (hashtabsize!=o.hashtabsize) {
-		std::cout << "this:" << std::endl;
-		print(print_tree(std::cout));
-		std::cout << "other:" << std::endl;
-		other.print(print_tree(std::cout));
-	}
-		
-	GINAC_ASSERT(hashtabsize==o.hashtabsize);
+	epvector::const_iterator cit1 = seq.begin();
+	epvector::const_iterator cit2 = o.seq.begin();
+	epvector::const_iterator last1 = seq.end();
 	
-	if (hashtabsize==0) {
-#endif // EXPAIRSEQ_USE_HASHTAB
-		epvector::const_iterator cit1 = seq.begin();
-		epvector::const_iterator cit2 = o.seq.begin();
-		epvector::const_iterator last1 = seq.end();
-		
-		while (cit1!=last1) {
-			if (!(*cit1).is_equal(*cit2)) return false;
-			++cit1;
-			++cit2;
-		}
-		
-		return true;
-#if EXPAIRSEQ_USE_HASHTAB
-	}
-	
-	for (unsigned i=0; i<hashtabsize; ++i) {
-		if (hashtab[i].size() != o.hashtab[i].size())
-			return false;
-	}
-
-	// compare individual sorted hashtab entries
-	for (unsigned i=0; i<hashtabsize; ++i) {
-		unsigned sz = hashtab[i].size();
-		if (sz>0) {
-			const epplist &eppl1 = hashtab[i];
-			const epplist &eppl2 = o.hashtab[i];
-			epplist::const_iterator it1 = eppl1.begin();
-			epplist::const_iterator it2 = eppl2.begin();
-			while (it1!=eppl1.end()) {
-				if (!(*(*it1)).is_equal(*(*it2))) return false;
-				++it1;
-				++it2;
-			}
-		}
+	while (cit1!=last1) {
+		if (!(*cit1).is_equal(*cit2)) return false;
+		++cit1;
+		++cit2;
 	}
 	
 	return true;
-#endif // EXPAIRSEQ_USE_HASHTAB
 }
 
 unsigned expairseq::return_type() const
@@ -597,18 +487,14 @@ unsigned expairseq::return_type() const
 	return return_types::noncommutative_composite;
 }
 
-unsigned expairseq::calchash() const
+hash_t expairseq::calchash() const
 {
-	unsigned v = make_hash_seed(typeid(*this));
+	hash_t v = make_hash_seed(typeid(*this));
 	epvector::const_iterator i = seq.begin();
 	const epvector::const_iterator end = seq.end();
 	while (i != end) {
-		v ^= i->rest.gethash();
-#if !EXPAIRSEQ_USE_HASHTAB
 		// rotation spoils commutativity!
-		v = rotate_left(v);
-		v ^= i->coeff.gethash();
-#endif // !EXPAIRSEQ_USE_HASHTAB
+		v = hash_combine(v ^ i->rest.gethash(), i->coeff.gethash());
 		++i;
 	}
 
@@ -616,18 +502,48 @@ unsigned expairseq::calchash() const
 
 	// store calculated hash value only if object is already evaluated
 	if (flags &status_flags::evaluated) {
-		setflag(status_flags::hash_calculated);
 		hashvalue = v;
+		setflag(status_flags::hash_calculated);
 	}
 	
 	return v;
 }
 
+unsigned expairseq::calc_symbol_mask() const
+{
+	// the coefficients are numbers
+	unsigned m = 0;
+	for (epvector::const_iterator i = seq.begin(); i != seq.end(); ++i)
+		m |= ex_to<basic>(i->rest).symbol_mask();
+	return m;
+}
+
+tree_metrics expairseq::calc_metrics() const
+{
+	// Measure the terms as op() would return them, without constructing
+	// them: a coefficient other than one adds itself and the node which
+	// joins it to the rest.
+	tree_metrics m;
+	for (epvector::const_iterator i = seq.begin(); i != seq.end(); ++i) {
+		tree_metrics t = ex_to<basic>(i->rest).metrics();
+		if (!i->coeff.is_equal(_ex1)) {
+			tree_metrics c = ex_to<basic>(i->coeff).metrics();
+			c.add_child(t);
+			t = c;
+			t.size = t.size < ~0U ? t.size + 1 : t.size;
+		}
+		m.add_child(t);
+	}
+	if (!overall_coeff.is_equal(default_overall_coeff()))
+		m.add_child(ex_to<basic>(overall_coeff).metrics());
+	return m;
+}
+
 ex expairseq::expand(unsigned options) const
 {
 	std::shared_ptr<epvector> vp = expandchildren(options);
 	if (vp.get())
-		return thisexpairseq(vp, overall_coeff);
+		return thisexpairseq(std::move(vp), overall_coeff);
 	else {
 		// The terms have not changed, so it is safe to declare this expanded
 		return (options == 0) ? setflag(status_flags::expanded) : *this;
@@ -725,9 +641,6 @@ ex expairseq::recombine_pair_to_ex(const expair &p) const
 
 bool expairseq::expair_needs_further_processing(epp it)
 {
-#if EXPAIRSEQ_USE_HASHTAB
-	//#  error "FIXME: expair_needs_further_processing not yet implemented for hashtabs, sorry. A.F."
-#endif // EXPAIRSEQ_USE_HASHTAB
 	return false;
 }
 
@@ -769,70 +682,30 @@ void expairseq::construct_from_2_ex_via_exvector(const ex &lh, const ex &rh)
 	v.push_back(lh);
 	v.push_back(rh);
 	construct_from_exvector(v);
-#if EXPAIRSEQ_USE_HASHTAB
-	GINAC_ASSERT((hashtabsize==0)||(hashtabsize>=minhashtabsize));
-	GINAC_ASSERT(hashtabsize==calc_hashtabsize(seq.size()));
-#endif // EXPAIRSEQ_USE_HASHTAB
 }
 
 void expairseq::construct_from_2_ex(const ex &lh, const ex &rh)
 {
 	if (typeid(ex_to<basic>(lh)) == typeid(*this)) {
 		if (typeid(ex_to<basic>(rh)) == typeid(*this)) {
-#if EXPAIRSEQ_USE_HASHTAB
-			unsigned totalsize = ex_to<expairseq>(lh).seq.size() +
-			                     ex_to<expairseq>(rh).seq.size();
-			if (calc_hashtabsize(totalsize)!=0) {
-				construct_from_2_ex_via_exvector(lh,rh);
-			} else {
-#endif // EXPAIRSEQ_USE_HASHTAB
-				if (is_a<mul>(lh) && lh.info(info_flags::has_indices) && 
-					rh.info(info_flags::has_indices)) {
-					ex newrh=rename_dummy_indices_uniquely(lh, rh);
-					construct_from_2_expairseq(ex_to<expairseq>(lh),
-					                           ex_to<expairseq>(newrh));
-				}
-				else
-					construct_from_2_expairseq(ex_to<expairseq>(lh),
-					                           ex_to<expairseq>(rh));
-#if EXPAIRSEQ_USE_HASHTAB
+			if (is_a<mul>(lh) && lh.info(info_flags::has_indices) && 
+				rh.info(info_flags::has_indices)) {
+				ex newrh=rename_dummy_indices_uniquely(lh, rh);
+				construct_from_2_expairseq(ex_to<expairseq>(lh),
+				                           ex_to<expairseq>(newrh));
 			}
-#endif // EXPAIRSEQ_USE_HASHTAB
+			else
+				construct_from_2_expairseq(ex_to<expairseq>(lh),
+				                           ex_to<expairseq>(rh));
 			return;
 		} else {
-#if EXPAIRSEQ_USE_HASHTAB
-			unsigned totalsize = ex_to<expairseq>(lh).seq.size()+1;
-			if (calc_hashtabsize(totalsize)!=0) {
-				construct_from_2_ex_via_exvector(lh, rh);
-			} else {
-#endif // EXPAIRSEQ_USE_HASHTAB
-				construct_from_expairseq_ex(ex_to<expairseq>(lh), rh);
-#if EXPAIRSEQ_USE_HASHTAB
-			}
-#endif // EXPAIRSEQ_USE_HASHTAB
+			construct_from_expairseq_ex(ex_to<expairseq>(lh), rh);
 			return;
 		}
 	} else if (typeid(ex_to<basic>(rh)) == typeid(*this)) {
-#if EXPAIRSEQ_USE_HASHTAB
-		unsigned totalsize=ex_to<expairseq>(rh).seq.size()+1;
-		if (calc_hashtabsize(totalsize)!=0) {
-			construct_from_2_ex_via_exvector(lh,rh);
-		} else {
-#endif // EXPAIRSEQ_USE_HASHTAB
-			construct_from_expairseq_ex(ex_to<expairseq>(rh),lh);
-#if EXPAIRSEQ_USE_HASHTAB
-		}
-#endif // EXPAIRSEQ_USE_HASHTAB
-		return;
-	}
-	
-#if EXPAIRSEQ_USE_HASHTAB
-	if (calc_hashtabsize(2)!=0) {
-		construct_from_2_ex_via_exvector(lh,rh);
+		construct_from_expairseq_ex(ex_to<expairseq>(rh),lh);
 		return;
 	}
-	hashtabsize = 0;
-#endif // EXPAIRSEQ_USE_HASHTAB
 	
 	if (is_exactly_a<numeric>(lh)) {
 		if (is_exactly_a<numeric>(rh)) {
@@ -927,6 +800,92 @@ void expairseq::construct_from_2_expairseq(const expairseq &s1,
 	}
 }
 
+namespace {
+
+/** Slot of the table used by expairseq::combine_same_terms_hashed(). */
+struct combine_slot {
+	hash_t hash;     ///< hash value of the rest
+	unsigned index;  ///< index of the term in seq plus one, 0 if empty
+	unsigned sum;    ///< index of the coefficient sum plus one, 0 if none
+};
+
+} // anonymous namespace
+
+/** Combine all matching expairs of an unsorted expairseq to one each and
+ *  sort the result. Matching terms are found through an open-addressing
+ *  table (linear probing) keyed on the hash values of the rests, so this
+ *  takes linear time, and only the combined terms are sorted. */
+void expairseq::combine_same_terms_hashed()
+{
+	const std::size_t n = seq.size();
+	std::size_t table_size = 16;
+	while (table_size < 2*n)
+		table_size <<= 1;
+	const std::size_t mask = table_size - 1;
+	const combine_slot empty = { 0, 0, 0 };
+	std::vector<combine_slot> table(table_size, empty);
+
+	// The coefficients of matching terms are summed up here and stored
+	// into the term sum_terms[i] at the end
+	std::vector<numeric_sum> sums;
+	std::vector<std::size_t> sum_terms;
+
+	bool needs_further_processing = false;
+
+	// Terms which don't match any of the previous ones are moved to the
+	// front of seq
+	std::size_t nout = 0;
+	for (std::size_t i = 0; i < n; ++i) {
+		const hash_t h = seq[i].rest.gethash();
+		std::size_t pos = h & mask;
+		while (table[pos].index != 0 &&
+		       (table[pos].hash != h ||
+		        !seq[table[pos].index - 1].rest.is_equal(seq[i].rest)))
+			pos = (pos + 1) & mask;
+		if (table[pos].index != 0) {
+			if (table[pos].sum == 0) {
+				sums.push_back(numeric_sum());
+				sums.back().add(ex_to<numeric>(seq[table[pos].index - 1].coeff));
+				sum_terms.push_back(table[pos].index - 1);
+				table[pos].sum = sums.size();
+			}
+			sums[table[pos].sum - 1].add(ex_to<numeric>(seq[i].coeff));
+		} else {
+			if (nout != i)
+				seq[nout].swap(seq[i]);
+			table[pos].hash = h;
+			table[pos].index = ++nout;
+		}
+	}
+	for (std::size_t k = 0; k < sums.size(); ++k) {
+		epp it = seq.begin() + sum_terms[k];
+		it->coeff = sums[k].result_dyn();
+		if (expair_needs_further_processing(it))
+			needs_further_processing = true;
+	}
+
+	// Drop the terms which cancelled
+	epvector::iterator itout = seq.begin();
+	const epvector::iterator last = seq.begin() + nout;
+	for (epvector::iterator itin = seq.begin(); itin != last; ++itin) {
+		if (!ex_to<numeric>(itin->coeff).is_zero()) {
+			if (itout != itin)
+				itout->swap(*itin);
+			++itout;
+		}
+	}
+	seq.erase(itout, seq.end());
+
+	if (needs_further_processing) {
+		epvector v = seq;
+		seq.clear();
+		construct_from_epvector(v);
+		return;
+	}
+
+	canonicalize();
+}
+
 void expairseq::construct_from_expairseq_ex(const expairseq &s,
                                             const ex &e)
 {
@@ -997,12 +956,7 @@ void expairseq::construct_from_exvector(const exvector &v)
 	//                  (same for (+,*) -> (*,^)
 
 	make_flat(v);
-#if EXPAIRSEQ_USE_HASHTAB
 	combine_same_terms();
-#else
-	canonicalize();
-	combine_same_terms_sorted_seq();
-#endif // EXPAIRSEQ_USE_HASHTAB
 }
 
 void expairseq::construct_from_epvector(const epvector &v, bool do_index_renaming)
@@ -1013,12 +967,21 @@ void expairseq::construct_from_epvector(const epvector &v, bool do_index_renamin
 	//                  same for (+,*) -> (*,^)
 
 	make_flat(v, do_index_renaming);
-#if EXPAIRSEQ_USE_HASHTAB
 	combine_same_terms();
-#else
-	canonicalize();
-	combine_same_terms_sorted_seq();
-#endif // EXPAIRSEQ_USE_HASHTAB
+}
+
+void expairseq::construct_from_epvector(epvector &&v, bool do_index_renaming)
+{
+	make_flat(std::move(v), do_index_renaming);
+	combine_same_terms();
+}
+
+/** Take over a sequence which is already canonical, without sorting or
+ *  combining it. */
+void expairseq::construct_from_canonical_epvector(std::shared_ptr<epvector> vp)
+{
+	GINAC_ASSERT(vp.get()!=0);
+	seq.swap(*vp);
 }
 
 /** Combine this expairseq with argument exvector.
@@ -1135,10 +1098,94 @@ void expairseq::make_flat(const epvector &v, bool do_index_renaming)
 	}
 }
 
-/** Brings this expairseq into a sorted (canonical) form. */
+/** Like make_flat(const epvector &), but takes the terms out of v. Unless a
+ *  term has to be flattened or its indices renamed, the vector itself is
+ *  taken over, so no term is copied. */
+void expairseq::make_flat(epvector &&v, bool do_index_renaming)
+{
+	const bool may_rename = do_index_renaming && is_a<mul>(*this);
+	for (epvector::const_iterator cit = v.begin(); cit != v.end(); ++cit) {
+		if (typeid(ex_to<basic>(cit->rest)) == typeid(*this) ||
+		    (may_rename && cit->rest.info(info_flags::has_indices))) {
+			make_flat(static_cast<const epvector &>(v), do_index_renaming);
+			return;
+		}
+	}
+
+	// split off numerical part
+	seq.swap(v);
+	epvector::iterator out = seq.begin();
+	for (epvector::iterator in = seq.begin(); in != seq.end(); ++in) {
+		if (in->is_canonical_numeric())
+			combine_overall_coeff(in->rest);
+		else {
+			if (out != in)
+				out->swap(*in);
+			++out;
+		}
+	}
+	seq.erase(out, seq.end());
+}
+
+/** Brings this expairseq into a sorted (canonical) form and combines all
+ *  matching expairs. */
+void expairseq::combine_same_terms()
+{
+	if (seq.size() >= hashed_combine_threshold)
+		combine_same_terms_hashed();
+	else {
+		canonicalize();
+		combine_same_terms_sorted_seq();
+	}
+}
+
+namespace {
+
+/** Sort key of a term for expairseq::canonicalize(): the hash value of its
+ *  rest, which decides the order unless two of them coincide. */
+struct term_key {
+	hash_t hash;
+	size_t pos;
+};
+
+struct term_key_is_less {
+	term_key_is_less(const epvector & s) : seq(s) { }
+	bool operator()(const term_key & lh, const term_key & rh) const
+	{
+		if (lh.hash != rh.hash)
+			return lh.hash < rh.hash;
+		return seq[lh.pos].rest.compare(seq[rh.pos].rest) < 0;
+	}
+	const epvector & seq;
+};
+
+} // anonymous namespace
+
+/** Brings this expairseq into a sorted (canonical) form: sort the terms by
+ *  their rests, in the order of ex::compare(). Longer sequences are sorted
+ *  through an array of their hash values, so that most comparisons are
+ *  integer comparisons on contiguous memory and the terms are only compared
+ *  structurally when their hash values are equal. */
 void expairseq::canonicalize()
 {
-	std::sort(seq.begin(), seq.end(), expair_rest_is_less());
+	const size_t n = seq.size();
+	if (n < 16) {
+		std::sort(seq.begin(), seq.end(), expair_rest_is_less());
+		return;
+	}
+
+	std::vector<term_key> keys(n);
+	for (size_t i=0; i<n; ++i) {
+		keys[i].hash = seq[i].rest.gethash();
+		keys[i].pos = i;
+	}
+	std::sort(keys.begin(), keys.end(), term_key_is_less(seq));
+
+	epvector sorted;
+	sorted.reserve(n);
+	for (size_t i=0; i<n; ++i)
+		sorted.push_back(seq[keys[i].pos]);
+	seq.swap(sorted);
 }
 
 
@@ -1161,8 +1208,14 @@ void expairseq::combine_same_terms_sorted_seq()
 	bool must_copy = false;
 	while (itin2!=last) {
 		if (itin1->rest.compare(itin2->rest)==0) {
-			itin1->coeff = ex_to<numeric>(itin1->coeff).
-			               add_dyn(ex_to<numeric>(itin2->coeff));
+			// sum up the coefficients of the whole run of matching terms
+			numeric_sum sum;
+			sum.add(ex_to<numeric>(itin1->coeff));
+			do {
+				sum.add(ex_to<numeric>(itin2->coeff));
+				++itin2;
+			} while (itin2!=last && itin1->rest.compare(itin2->rest)==0);
+			itin1->coeff = sum.result_dyn();
 			if (expair_needs_further_processing(itin1))
 				needs_further_processing = true;
 			must_copy = true;
@@ -1173,8 +1226,8 @@ void expairseq::combine_same_terms_sorted_seq()
 				++itout;
 			}
 			itin1 = itin2;
+			++itin2;
 		}
-		++itin2;
 	}
 	if (!ex_to<numeric>(itin1->coeff).is_zero()) {
 		if (must_copy)
@@ -1191,314 +1244,6 @@ void expairseq::combine_same_terms_sorted_seq()
 	}
 }
 
-#if EXPAIRSEQ_USE_HASHTAB
-
-unsigned expairseq::calc_hashtabsize(unsigned sz) const
-{
-	unsigned size;
-	unsigned nearest_power_of_2 = 1 << log2(sz);
-	// if (nearest_power_of_2 < maxhashtabsize/hashtabfactor) {
-	//  size = nearest_power_of_2*hashtabfactor;
-	size = nearest_power_of_2/hashtabfactor;
-	if (size<minhashtabsize)
-		return 0;
-
-	// hashtabsize must be a power of 2
-	GINAC_ASSERT((1U << log2(size))==size);
-	return size;
-}
-
-unsigned expairseq::calc_hashindex(const ex &e) const
-{
-	// calculate hashindex
-	unsigned hashindex;
-	if (is_a<numeric>(e)) {
-		hashindex = hashmask;
-	} else {
-		hashindex = e.gethash() & hashmask;
-		// last hashtab entry is reserved for numerics
-		if (hashindex==hashmask) hashindex = 0;
-	}
-	GINAC_ASSERT((hashindex<hashtabsize)||(hashtabsize==0));
-	return hashindex;
-}
-
-void expairseq::shrink_hashtab()
-{
-	unsigned new_hashtabsize;
-	while (hashtabsize!=(new_hashtabsize=calc_hashtabsize(seq.size()))) {
-		GINAC_ASSERT(new_hashtabsize<hashtabsize);
-		if (new_hashtabsize==0) {
-			hashtab.clear();
-			hashtabsize = 0;
-			canonicalize();
-			return;
-		}
-		
-		// shrink by a factor of 2
-		unsigned half_hashtabsize = hashtabsize/2;
-		for (unsigned i=0; i<half_hashtabsize-1; ++i)
-			hashtab[i].merge(hashtab[i+half_hashtabsize],epp_is_less());
-		// special treatment for numeric hashes
-		hashtab[0].merge(hashtab[half_hashtabsize-1],epp_is_less());
-		hashtab[half_hashtabsize-1] = hashtab[hashtabsize-1];
-		hashtab.resize(half_hashtabsize);
-		hashtabsize = half_hashtabsize;
-		hashmask = hashtabsize-1;
-	}
-}
-
-void expairseq::remove_hashtab_entry(epvector::const_iterator element)
-{
-	if (hashtabsize==0)
-		return; // nothing to do
-	
-	// calculate hashindex of element to be deleted
-	unsigned hashindex = calc_hashindex((*element).rest);
-
-	// find it in hashtab and remove it
-	epplist &eppl = hashtab[hashindex];
-	epplist::iterator epplit = eppl.begin();
-	bool erased = false;
-	while (epplit!=eppl.end()) {
-		if (*epplit == element) {
-			eppl.erase(epplit);
-			erased = true;
-			break;
-		}
-		++epplit;
-	}
-	if (!erased) {
-		std::cout << "tried to erase " << element-seq.begin() << std::endl;
-		std::cout << "size " << seq.end()-seq.begin() << std::endl;
-
-		unsigned hashindex = calc_hashindex(element->rest);
-		epplist &eppl = hashtab[hashindex];
-		epplist::iterator epplit = eppl.begin();
-		bool erased = false;
-		while (epplit!=eppl.end()) {
-			if (*epplit == element) {
-				eppl.erase(epplit);
-				erased = true;
-				break;
-			}
-			++epplit;
-		}
-		GINAC_ASSERT(erased);
-	}
-	GINAC_ASSERT(erased);
-}
-
-void expairseq::move_hashtab_entry(epvector::const_iterator oldpos,
-                                   epvector::iterator newpos)
-{
-	GINAC_ASSERT(hashtabsize!=0);
-	
-	// calculate hashindex of element which was moved
-	unsigned hashindex=calc_hashindex((*newpos).rest);
-
-	// find it in hashtab and modify it
-	epplist &eppl = hashtab[hashindex];
-	epplist::iterator epplit = eppl.begin();
-	while (epplit!=eppl.end()) {
-		if (*epplit == oldpos) {
-			*epplit = newpos;
-			break;
-		}
-		++epplit;
-	}
-	GINAC_ASSERT(epplit!=eppl.end());
-}
-
-void expairseq::sorted_insert(epplist &eppl, epvector::const_iterator elem)
-{
-	epplist::const_iterator current = eppl.begin();
-	while ((current!=eppl.end()) && ((*current)->is_less(*elem))) {
-		++current;
-	}
-	eppl.insert(current,elem);
-}    
-
-void expairseq::build_hashtab_and_combine(epvector::iterator &first_numeric,
-                                          epvector::iterator &last_non_zero,
-                                          std::vector<bool> &touched,
-                                          unsigned &number_of_zeroes)
-{
-	epp current = seq.begin();
-
-	while (current!=first_numeric) {
-		if (is_exactly_a<numeric>(current->rest)) {
-			--first_numeric;
-			iter_swap(current,first_numeric);
-		} else {
-			// calculate hashindex
-			unsigned currenthashindex = calc_hashindex(current->rest);
-
-			// test if there is already a matching expair in the hashtab-list
-			epplist &eppl=hashtab[currenthashindex];
-			epplist::iterator epplit = eppl.begin();
-			while (epplit!=eppl.end()) {
-				if (current->rest.is_equal((*epplit)->rest))
-					break;
-				++epplit;
-			}
-			if (epplit==eppl.end()) {
-				// no matching expair found, append this to end of list
-				sorted_insert(eppl,current);
-				++current;
-			} else {
-				// epplit points to a matching expair, combine it with current
-				(*epplit)->coeff = ex_to<numeric>((*epplit)->coeff).
-				                   add_dyn(ex_to<numeric>(current->coeff));
-				
-				// move obsolete current expair to end by swapping with last_non_zero element
-				// if this was a numeric, it is swapped with the expair before first_numeric 
-				iter_swap(current,last_non_zero);
-				--first_numeric;
-				if (first_numeric!=last_non_zero) iter_swap(first_numeric,current);
-				--last_non_zero;
-				++number_of_zeroes;
-				// test if combined term has coeff 0 and can be removed is done later
-				touched[(*epplit)-seq.begin()] = true;
-			}
-		}
-	}
-}
-
-void expairseq::drop_coeff_0_terms(epvector::iterator &first_numeric,
-                                   epvector::iterator &last_non_zero,
-                                   std::vector<bool> &touched,
-                                   unsigned &number_of_zeroes)
-{
-	// move terms with coeff 0 to end and remove them from hashtab
-	// check only those elements which have been touched
-	epp current = seq.begin();
-	size_t i = 0;
-	while (current!=first_numeric) {
-		if (!touched[i]) {
-			++current;
-			++i;
-		} else if (!ex_to<numeric>((*current).coeff).is_zero()) {
-			++current;
-			++i;
-		} else {
-			remove_hashtab_entry(current);
-			
-			// move element to the end, unless it is already at the end
-			if (current!=last_non_zero) {
-				iter_swap(current,last_non_zero);
-				--first_numeric;
-				bool numeric_swapped = first_numeric!=last_non_zero;
-				if (numeric_swapped)
-					iter_swap(first_numeric,current);
-				epvector::iterator changed_entry;
-
-				if (numeric_swapped)
-					changed_entry = first_numeric;
-				else
-					changed_entry = last_non_zero;
-				
-				--last_non_zero;
-				++number_of_zeroes;
-
-				if (first_numeric!=current) {
-
-					// change entry in hashtab which referred to first_numeric or last_non_zero to current
-					move_hashtab_entry(changed_entry,current);
-					touched[current-seq.begin()] = touched[changed_entry-seq.begin()];
-				}
-			} else {
-				--first_numeric;
-				--last_non_zero;
-				++number_of_zeroes;
-			}
-		}
-	}
-	GINAC_ASSERT(i==current-seq.begin());
-}
-
-/** True if one of the coeffs vanishes, otherwise false.
- *  This would be an invariant violation, so this should only be used for
- *  debugging purposes. */
-bool expairseq::has_coeff_0() const
-{
-	epvector::const_iterator i = seq.begin(), end = seq.end();
-	while (i != end) {
-		if (i->coeff.is_zero())
-			return true;
-		++i;
-	}
-	return false;
-}
-
-void expairseq::add_numerics_to_hashtab(epvector::iterator first_numeric,
-                                        epvector::const_iterator last_non_zero)
-{
-	if (first_numeric == seq.end()) return; // no numerics
-	
-	epvector::const_iterator current = first_numeric, last = last_non_zero + 1;
-	while (current != last) {
-		sorted_insert(hashtab[hashmask], current);
-		++current;
-	}
-}
-
-void expairseq::combine_same_terms()
-{
-	// combine same terms, drop term with coeff 0, move numerics to end
-	
-	// calculate size of hashtab
-	hashtabsize = calc_hashtabsize(seq.size());
-	
-	// hashtabsize is a power of 2
-	hashmask = hashtabsize-1;
-	
-	// allocate hashtab
-	hashtab.clear();
-	hashtab.resize(hashtabsize);
-	
-	if (hashtabsize==0) {
-		canonicalize();
-		combine_same_terms_sorted_seq();
-		GINAC_ASSERT(!has_coeff_0());
-		return;
-	}
-	
-	// iterate through seq, move numerics to end,
-	// fill hashtab and combine same terms
-	epvector::iterator first_numeric = seq.end();
-	epvector::iterator last_non_zero = seq.end()-1;
-	
-	size_t num = seq.size();
-	std::vector<bool> touched(num);
-	
-	unsigned number_of_zeroes = 0;
-	
-	GINAC_ASSERT(!has_coeff_0());
-	build_hashtab_and_combine(first_numeric,last_non_zero,touched,number_of_zeroes);
-	
-	// there should not be any terms with coeff 0 from the beginning,
-	// so it should be safe to skip this step
-	if (number_of_zeroes!=0) {
-		drop_coeff_0_terms(first_numeric,last_non_zero,touched,number_of_zeroes);
-	}
-	
-	add_numerics_to_hashtab(first_numeric,last_non_zero);
-	
-	// pop zero elements
-	for (unsigned i=0; i<number_of_zeroes; ++i) {
-		seq.pop_back();
-	}
-	
-	// shrink hashtabsize to calculated value
-	GINAC_ASSERT(!has_coeff_0());
-	
-	shrink_hashtab();
-	
-	GINAC_ASSERT(!has_coeff_0());
-}
-
-#endif // EXPAIRSEQ_USE_HASHTAB
 
 /** Check if this expairseq is in sorted (canonical) form.  Useful mainly for
  *  debugging or in assertions since being sorted is an invariance. */
@@ -1507,10 +1252,6 @@ bool expairseq::is_canonical() const
 	if (seq.size() <= 1)
 		return 1;
 	
-#if EXPAIRSEQ_USE_HASHTAB
-	if (hashtabsize > 0) return 1; // not canoncalized
-#endif // EXPAIRSEQ_USE_HASHTAB
-	
 	epvector::const_iterator it = seq.begin(), itend = seq.end();
 	epvector::const_iterator it_last = it;
 	for (++it; it!=itend; it_last=it, ++it) {
@@ -1553,7 +1294,7 @@ std::shared_ptr<epvector> expairseq::expandchildren(unsigned options) const
 		if (!are_ex_trivially_equal(cit->rest,expanded_ex)) {
 			
 			// something changed, copy seq, eval and return it
-			std::shared_ptr<epvector> s(new epvector);
+			std::shared_ptr<epvector> s = std::make_shared<epvector>();
 			s->reserve(seq.size());
 			
 			// copy parts of seq which are known not to have changed
@@ -1608,7 +1349,7 @@ std::shared_ptr<epvector> expairseq::evalchildren(int level) const
 		if (!are_ex_trivially_equal(cit->rest,evaled_ex)) {
 			
 			// something changed, copy seq, eval and return it
-			std::shared_ptr<epvector> s(new epvector);
+			std::shared_ptr<epvector> s = std::make_shared<epvector>();
 			s->reserve(seq.size());
 			
 			// copy parts of seq which are known not to have changed
@@ -1671,7 +1412,7 @@ std::shared_ptr<epvector> expairseq::subschildren(const exmap & m, unsigned opti
 			if (!are_ex_trivially_equal(orig_ex, subsed_ex)) {
 
 				// Something changed, copy seq, subs and return it
-				std::shared_ptr<epvector> s(new epvector);
+				std::shared_ptr<epvector> s = std::make_shared<epvector>();
 				s->reserve(seq.size());
 
 				// Copy parts of seq which are known not to have changed
@@ -1702,7 +1443,7 @@ std::shared_ptr<epvector> expairseq::subschildren(const exmap & m, unsigned opti
 			if (!are_ex_trivially_equal(cit->rest, subsed_ex)) {
 			
 				// Something changed, copy seq, subs and return it
-				std::shared_ptr<epvector> s(new epvector);
+				std::shared_ptr<epvector> s = std::make_shared<epvector>();
 				s->reserve(seq.size());
 
 				// Copy parts of seq which are known not to have changed
@@ -1732,10 +1473,6 @@ std::shared_ptr<epvector> expairseq::subschildren(const exmap & m, unsigned opti
 // static member variables
 //////////
 
-#if EXPAIRSEQ_USE_HASHTAB
-unsigned expairseq::maxhashtabsize = 0x4000000U;
-unsigned expairseq::minhashtabsize = 0x1000U;
-unsigned expairseq::hashtabfactor = 1;
-#endif // EXPAIRSEQ_USE_HASHTAB
+const std::size_t expairseq::hashed_combine_threshold = 64;
 
 } // namespace GiNaC
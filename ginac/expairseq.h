@@ -25,35 +25,34 @@
 
 #include "expair.h"
 #include "indexed.h"
+#include "small_vector.h"
 
 // CINT needs <algorithm> to work properly with <vector> and <list>
 #include <algorithm>
+#include <cstddef>
 #include <list>
 #include <memory>
 #include <vector>
 
 namespace GiNaC {
 
-/** Using hash tables can potentially enhance the asymptotic behaviour of
- *  combining n terms into one large sum (or n terms into one large product)
- *  from O(n*log(n)) to about O(n).  There are, however, several drawbacks.
- *  The constant in front of O(n) is quite large, when copying such an object
- *  one also has to copy the has table, comparison is quite expensive because
- *  there is no ordering any more, it doesn't help at all when combining two
- *  expairseqs because due to the presorted nature the behaviour would be
- *  O(n) anyways, the code is quite messy, etc, etc.  The code is here as
- *  an example for following generations to tinker with. */
-#define EXPAIRSEQ_USE_HASHTAB 0
-
-typedef std::vector<expair> epvector;       ///< expair-vector
+/** Most sums and products have only a few terms, these are stored inside
+ *  the expairseq object without a separate allocation. */
+typedef small_vector<expair, 4> epvector;   ///< expair-vector
 typedef epvector::iterator epp;             ///< expair-vector pointer
-typedef std::list<epp> epplist;             ///< list of expair-vector pointers
-typedef std::vector<epplist> epplistvector; ///< vector of epplist
 
 /** Complex conjugate every element of an epvector. Returns zero if this
  *  does not change anything. */
 epvector* conjugateepvector(const epvector&);
 
+/** Selects the constructors which take over a sequence that is already
+ *  canonical: sorted, flat, with like terms combined and with evaluated
+ *  children. Operations which are known to keep these invariants (such as
+ *  multiplying all coefficients of a sum by a number) use them to skip the
+ *  sorting and combining. */
+struct canonical_seq_t {};
+const canonical_seq_t canonical_seq = canonical_seq_t();
+
 /** A sequence of class expair.
  *  This is used for time-critical classes like sums and products of terms
  *  since handling a list of coeff and rest is much faster than handling a
@@ -67,12 +66,16 @@ class expairseq : public basic
 {
 	GINAC_DECLARE_REGISTERED_CLASS(expairseq, basic)
 
+	friend class expairseq_matcher;
+
 	// other constructors
 public:
 	expairseq(const ex & lh, const ex & rh);
 	expairseq(const exvector & v);
 	expairseq(const epvector & v, const ex & oc, bool do_index_renaming = false);
+	expairseq(epvector && v, const ex & oc, bool do_index_renaming = false);
 	expairseq(std::shared_ptr<epvector>, const ex & oc, bool do_index_renaming = false);
+	expairseq(std::shared_ptr<epvector>, const ex & oc, canonical_seq_t);
 	
 	// functions overriding virtual functions from base classes
 public:
@@ -93,7 +96,9 @@ public:
 protected:
 	bool is_equal_same_type(const basic & other) const;
 	unsigned return_type() const;
-	unsigned calchash() const;
+	hash_t calchash() const;
+	unsigned calc_symbol_mask() const;
+	tree_metrics calc_metrics() const;
 	ex expand(unsigned options=0) const;
 	
 	// new virtual functions which can be overridden by derived classes
@@ -121,6 +126,7 @@ protected:
 protected:
 	void do_print(const print_context & c, unsigned level) const;
 	void do_print_tree(const print_tree & c, unsigned level) const;
+	ex rest_of_terms(const exvector & terms) const;
 	void construct_from_2_ex_via_exvector(const ex & lh, const ex & rh);
 	void construct_from_2_ex(const ex & lh, const ex & rh);
 	void construct_from_2_expairseq(const expairseq & s1,
@@ -129,49 +135,31 @@ protected:
 	                                 const ex & e);
 	void construct_from_exvector(const exvector & v);
 	void construct_from_epvector(const epvector & v, bool do_index_renaming = false);
+	void construct_from_epvector(epvector && v, bool do_index_renaming = false);
+	void construct_from_canonical_epvector(std::shared_ptr<epvector> vp);
 	void make_flat(const exvector & v);
 	void make_flat(const epvector & v, bool do_index_renaming = false);
+	void make_flat(epvector && v, bool do_index_renaming = false);
+	void combine_same_terms();
 	void canonicalize();
 	void combine_same_terms_sorted_seq();
-#if EXPAIRSEQ_USE_HASHTAB
-	void combine_same_terms();
-	unsigned calc_hashtabsize(unsigned sz) const;
-	unsigned calc_hashindex(const ex & e) const;
-	void shrink_hashtab();
-	void remove_hashtab_entry(epvector::const_iterator element);
-	void move_hashtab_entry(epvector::const_iterator oldpos,
-	                        epvector::iterator newpos);
-	void sorted_insert(epplist & eppl, epvector::const_iterator elem);
-	void build_hashtab_and_combine(epvector::iterator & first_numeric,
-	                               epvector::iterator & last_non_zero,
-	                               vector<bool> & touched,
-	                               unsigned & number_of_zeroes);
-	void drop_coeff_0_terms(epvector::iterator & first_numeric,
-	                        epvector::iterator & last_non_zero,
-	                        vector<bool> & touched,
-	                        unsigned & number_of_zeroes);
-	bool has_coeff_0() const;
-	void add_numerics_to_hashtab(epvector::iterator first_numeric,
-	                             epvector::const_iterator last_non_zero);
-#endif // EXPAIRSEQ_USE_HASHTAB
+	void combine_same_terms_hashed();
 	bool is_canonical() const;
 	std::shared_ptr<epvector> expandchildren(unsigned options) const;
 	std::shared_ptr<epvector> evalchildren(int level) const;
 	std::shared_ptr<epvector> subschildren(const exmap & m, unsigned options = 0) const;
 	
+	friend const epvector & traversal_terms(const expairseq & s);
+
 // member variables
 	
 protected:
 	epvector seq;
 	ex overall_coeff;
-#if EXPAIRSEQ_USE_HASHTAB
-	epplistvector hashtab;
-	unsigned hashtabsize;
-	unsigned hashmask;
-	static unsigned maxhashtabsize;
-	static unsigned minhashtabsize;
-	static unsigned hashtabfactor;
-#endif // EXPAIRSEQ_USE_HASHTAB
+
+	/** Sequences with at least this many terms are combined with
+	 *  combine_same_terms_hashed() instead of being sorted first. */
+	static const std::size_t hashed_combine_threshold;
 };
 
 /** Class to handle the renaming of dummy indices. It holds a vector of
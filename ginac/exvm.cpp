@@ -0,0 +1,660 @@
+/** @file exvm.cpp
+ *
+ *  Bytecode backend of compile_ex(): expressions are translated into the
+ *  instructions of a small stack machine, which is run by one of a fixed
+ *  set of trampoline functions with the signatures of FUNCP_1P, FUNCP_2P,
+ *  FUNCP_CUBA, FUNCP_BATCH_1P and FUNCP_BATCH_2P. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "exvm.h"
+#include "ex.h"
+#include "add.h"
+#include "mul.h"
+#include "power.h"
+#include "numeric.h"
+#include "constant.h"
+#include "symbol.h"
+#include "function.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+#include <mutex>
+#endif
+
+namespace GiNaC {
+
+namespace {
+
+typedef double (*math_func_1)(double);
+typedef double (*math_func_2)(double, double);
+
+/** One instruction of the stack machine. */
+struct instruction {
+	enum opcode {
+		push_const,   ///< push value
+		push_arg,     ///< push args[index]
+		add_n,        ///< replace the topmost index entries by their sum
+		mul_n,        ///< replace the topmost index entries by their product
+		powi,         ///< raise the top entry to the integer power index
+		pow,          ///< replace the two top entries x, y by x^y
+		call_1,       ///< apply f1 to the top entry
+		call_2,       ///< replace the two top entries x, y by f2(x, y)
+		call_n,       ///< replace the topmost index entries by the value of
+		              ///< the kernel fk or fb of a function for them
+		store         ///< pop the top entry into out[index]
+	};
+
+	instruction(opcode c, long i = 0, double v = 0) : code(c), index(i), value(v), f1(0), f2(0), fk(0), fb(0) { }
+
+	opcode code;
+	long index;
+	double value;
+	math_func_1 f1;
+	math_func_2 f2;
+	double_funcp fk;
+	double_batch_funcp fb;
+};
+
+double abs_double(double x) { return std::fabs(x); }
+
+/** Math library functions which GiNaC functions of one argument map to. */
+math_func_1 lookup_func_1(const std::string & name)
+{
+	static const struct {
+		const char * name;
+		math_func_1 f;
+	} table[] = {
+		{ "sin", ::sin }, { "cos", ::cos }, { "tan", ::tan },
+		{ "asin", ::asin }, { "acos", ::acos }, { "atan", ::atan },
+		{ "sinh", ::sinh }, { "cosh", ::cosh }, { "tanh", ::tanh },
+		{ "asinh", ::asinh }, { "acosh", ::acosh }, { "atanh", ::atanh },
+		{ "exp", ::exp }, { "log", ::log }, { "abs", abs_double },
+		{ "tgamma", ::tgamma }, { "lgamma", ::lgamma }
+	};
+	for (size_t i = 0; i < sizeof(table) / sizeof(table[0]); ++i)
+		if (name == table[i].name)
+			return table[i].f;
+	return 0;
+}
+
+/** Compiled expression(s). */
+class program {
+public:
+	program(const exvector & vars) : vars(vars), depth(0), max_depth(0) { }
+
+	/** Append code evaluating e, leaving the result on the stack. */
+	void compile(const ex & e);
+
+	/** Append code storing the top of the stack into out[i]. */
+	void compile_store(size_t i)
+	{
+		emit(instruction(instruction::store, long(i)), -1);
+	}
+
+	void run(const double * args, double * out) const;
+
+	double run_1(double x) const
+	{
+		double res;
+		run(&x, &res);
+		return res;
+	}
+
+	double run_2(double x, double y) const
+	{
+		const double args[2] = { x, y };
+		double res;
+		run(args, &res);
+		return res;
+	}
+
+	void run_batch(size_t n, const double * const * args, double * out) const;
+
+private:
+	void emit(const instruction & i, int stack_change)
+	{
+		code.push_back(i);
+		depth += stack_change;
+		if (depth > max_depth)
+			max_depth = depth;
+	}
+
+	std::vector<instruction> code;
+	exvector vars;
+	int depth;
+	int max_depth;
+};
+
+void program::compile(const ex & e)
+{
+	if (is_exactly_a<numeric>(e)) {
+		const numeric & n = ex_to<numeric>(e);
+		if (!n.is_real())
+			throw std::runtime_error("compile_ex: complex numbers cannot be compiled");
+		emit(instruction(instruction::push_const, 0, n.to_double()), 1);
+		return;
+	}
+
+	if (is_a<symbol>(e)) {
+		for (size_t i = 0; i < vars.size(); ++i) {
+			if (vars[i].is_equal(e)) {
+				emit(instruction(instruction::push_arg, long(i)), 1);
+				return;
+			}
+		}
+		throw std::runtime_error("compile_ex: expression contains the unbound symbol " + ex_to<symbol>(e).get_name());
+	}
+
+	if (is_exactly_a<constant>(e)) {
+		const ex v = e.evalf();
+		if (!is_exactly_a<numeric>(v))
+			throw std::runtime_error("compile_ex: constant without numeric value");
+		compile(v);
+		return;
+	}
+
+	if (is_exactly_a<add>(e) || is_exactly_a<mul>(e)) {
+		const size_t n = e.nops();
+		for (size_t i = 0; i < n; ++i)
+			compile(e.op(i));
+		emit(instruction(is_exactly_a<add>(e) ? instruction::add_n : instruction::mul_n, long(n)), 1 - int(n));
+		return;
+	}
+
+	if (is_exactly_a<power>(e)) {
+		const ex & expo = e.op(1);
+		compile(e.op(0));
+		if (is_exactly_a<numeric>(expo) && ex_to<numeric>(expo).is_integer()
+		 && abs(ex_to<numeric>(expo)) <= numeric(64)) {
+			emit(instruction(instruction::powi, ex_to<numeric>(expo).to_long()), 0);
+		} else if (expo.is_equal(_ex1_2)) {
+			instruction i(instruction::call_1);
+			i.f1 = ::sqrt;
+			emit(i, 0);
+		} else {
+			compile(expo);
+			instruction i(instruction::pow);
+			i.f2 = ::pow;
+			emit(i, -1);
+		}
+		return;
+	}
+
+	if (is_a<function>(e)) {
+		const function & f = ex_to<function>(e);
+		const double_funcp fk = f.get_double_func();
+		const double_batch_funcp fb = f.get_double_batch_func();
+		if (fk || fb) {
+			const size_t n = e.nops();
+			for (size_t k = 0; k < n; ++k)
+				compile(e.op(k));
+			instruction i(instruction::call_n, long(n));
+			i.fk = fk;
+			i.fb = fb;
+			emit(i, 1 - int(n));
+			return;
+		}
+		const std::string name = f.get_name();
+		if (e.nops() == 1) {
+			const math_func_1 f = lookup_func_1(name);
+			if (f) {
+				compile(e.op(0));
+				instruction i(instruction::call_1);
+				i.f1 = f;
+				emit(i, 0);
+				return;
+			}
+		} else if (e.nops() == 2 && name == "atan2") {
+			compile(e.op(0));
+			compile(e.op(1));
+			instruction i(instruction::call_2);
+			i.f2 = ::atan2;
+			emit(i, -1);
+			return;
+		}
+		throw std::runtime_error("compile_ex: function " + name + " is not supported by the bytecode backend");
+	}
+
+	throw std::runtime_error(std::string("compile_ex: cannot compile an object of class ") + ex_to<basic>(e).class_name());
+}
+
+void program::run(const double * args, double * out) const
+{
+	double fixed_stack[32];
+	std::vector<double> heap_stack;
+	double * st = fixed_stack;
+	if (max_depth > 32) {
+		heap_stack.resize(max_depth);
+		st = &heap_stack[0];
+	}
+
+	int sp = 0;  // number of entries on the stack
+	for (std::vector<instruction>::const_iterator i = code.begin(); i != code.end(); ++i) {
+		switch (i->code) {
+		case instruction::push_const:
+			st[sp++] = i->value;
+			break;
+		case instruction::push_arg:
+			st[sp++] = args[i->index];
+			break;
+		case instruction::add_n: {
+			double s = st[sp - i->index];
+			for (int k = sp - i->index + 1; k < sp; ++k)
+				s += st[k];
+			sp -= int(i->index) - 1;
+			st[sp - 1] = s;
+			break;
+		}
+		case instruction::mul_n: {
+			double p = st[sp - i->index];
+			for (int k = sp - i->index + 1; k < sp; ++k)
+				p *= st[k];
+			sp -= int(i->index) - 1;
+			st[sp - 1] = p;
+			break;
+		}
+		case instruction::powi: {
+			double b = st[sp - 1];
+			long n = i->index;
+			if (n < 0) {
+				b = 1 / b;
+				n = -n;
+			}
+			double r = 1;
+			while (n) {
+				if (n & 1)
+					r *= b;
+				b *= b;
+				n >>= 1;
+			}
+			st[sp - 1] = r;
+			break;
+		}
+		case instruction::pow:
+		case instruction::call_2:
+			--sp;
+			st[sp - 1] = i->f2(st[sp - 1], st[sp]);
+			break;
+		case instruction::call_1:
+			st[sp - 1] = i->f1(st[sp - 1]);
+			break;
+		case instruction::call_n: {
+			const int n = int(i->index);
+			const double * a = st + sp - n;
+			double r;
+			if (i->fk) {
+				r = i->fk(a);
+			} else {
+				std::vector<const double *> p(n);
+				for (int k = 0; k < n; ++k)
+					p[k] = a + k;
+				i->fb(1, n ? &p[0] : 0, &r);
+			}
+			sp -= n - 1;
+			st[sp - 1] = r;
+			break;
+		}
+		case instruction::store:
+			out[i->index] = st[--sp];
+			break;
+		}
+	}
+	if (sp)
+		out[0] = st[sp - 1];
+}
+
+/** Number of points run_batch() evaluates at once. Each instruction is
+ *  applied to all of them in a simple loop, which amortizes the dispatch
+ *  and can be vectorized by the compiler. */
+const size_t batch_lanes = 64;
+
+void program::run_batch(size_t n, const double * const * args, double * out) const
+{
+	std::vector<double> stack(max_depth * batch_lanes);
+	for (size_t base = 0; base < n; base += batch_lanes) {
+		const size_t m = std::min(batch_lanes, n - base);
+		double * top = &stack[0];  // first lane of the entry above the top
+		for (std::vector<instruction>::const_iterator i = code.begin(); i != code.end(); ++i) {
+			switch (i->code) {
+			case instruction::push_const: {
+				const double v = i->value;
+				for (size_t l = 0; l < m; ++l)
+					top[l] = v;
+				top += batch_lanes;
+				break;
+			}
+			case instruction::push_arg: {
+				const double * a = args[i->index] + base;
+				for (size_t l = 0; l < m; ++l)
+					top[l] = a[l];
+				top += batch_lanes;
+				break;
+			}
+			case instruction::add_n: {
+				double * first = top - i->index * batch_lanes;
+				for (double * t = first + batch_lanes; t != top; t += batch_lanes)
+					for (size_t l = 0; l < m; ++l)
+						first[l] += t[l];
+				top = first + batch_lanes;
+				break;
+			}
+			case instruction::mul_n: {
+				double * first = top - i->index * batch_lanes;
+				for (double * t = first + batch_lanes; t != top; t += batch_lanes)
+					for (size_t l = 0; l < m; ++l)
+						first[l] *= t[l];
+				top = first + batch_lanes;
+				break;
+			}
+			case instruction::powi: {
+				double * t = top - batch_lanes;
+				long e = i->index;
+				if (e < 0) {
+					for (size_t l = 0; l < m; ++l)
+						t[l] = 1 / t[l];
+					e = -e;
+				}
+				double r[batch_lanes];
+				for (size_t l = 0; l < m; ++l)
+					r[l] = 1;
+				while (e) {
+					if (e & 1)
+						for (size_t l = 0; l < m; ++l)
+							r[l] *= t[l];
+					for (size_t l = 0; l < m; ++l)
+						t[l] *= t[l];
+					e >>= 1;
+				}
+				for (size_t l = 0; l < m; ++l)
+					t[l] = r[l];
+				break;
+			}
+			case instruction::pow:
+			case instruction::call_2: {
+				top -= batch_lanes;
+				double * t = top - batch_lanes;
+				const math_func_2 f = i->f2;
+				for (size_t l = 0; l < m; ++l)
+					t[l] = f(t[l], top[l]);
+				break;
+			}
+			case instruction::call_1: {
+				double * t = top - batch_lanes;
+				const math_func_1 f = i->f1;
+				for (size_t l = 0; l < m; ++l)
+					t[l] = f(t[l]);
+				break;
+			}
+			case instruction::call_n: {
+				const size_t nargs = size_t(i->index);
+				double * first = top - nargs * batch_lanes;
+				if (i->fb) {
+					std::vector<const double *> p(nargs);
+					for (size_t k = 0; k < nargs; ++k)
+						p[k] = first + k * batch_lanes;
+					double r[batch_lanes];
+					i->fb(m, nargs ? &p[0] : 0, r);
+					for (size_t l = 0; l < m; ++l)
+						first[l] = r[l];
+				} else {
+					std::vector<double> a(nargs);
+					for (size_t l = 0; l < m; ++l) {
+						for (size_t k = 0; k < nargs; ++k)
+							a[k] = first[k * batch_lanes + l];
+						first[l] = i->fk(nargs ? &a[0] : 0);
+					}
+				}
+				top = first + batch_lanes;
+				break;
+			}
+			case instruction::store:
+				// not used in batch programs
+				top -= batch_lanes;
+				break;
+			}
+		}
+		for (size_t l = 0; l < m; ++l)
+			out[base + l] = stack[l];
+	}
+}
+
+/** Number of trampolines, i.e. of bytecode functions which can exist at
+ *  the same time for each signature. */
+const unsigned num_trampolines = 512;
+
+const program * programs_1p[num_trampolines];
+const program * programs_2p[num_trampolines];
+const program * programs_cuba[num_trampolines];
+const program * programs_batch_1p[num_trampolines];
+const program * programs_batch_2p[num_trampolines];
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+std::mutex programs_mutex;
+#endif
+
+template <unsigned K> double trampoline_1p(double x)
+{
+	return programs_1p[K]->run_1(x);
+}
+
+template <unsigned K> double trampoline_2p(double x, double y)
+{
+	return programs_2p[K]->run_2(x, y);
+}
+
+template <unsigned K> void trampoline_cuba(const int * an, const double a[], const int * fn, double f[])
+{
+	programs_cuba[K]->run(a, f);
+}
+
+template <unsigned K> void trampoline_batch_1p(size_t n, const double * x, double * out)
+{
+	programs_batch_1p[K]->run_batch(n, &x, out);
+}
+
+template <unsigned K> void trampoline_batch_2p(size_t n, const double * x, const double * y, double * out)
+{
+	const double * const args[2] = { x, y };
+	programs_batch_2p[K]->run_batch(n, args, out);
+}
+
+struct trampoline_tables;
+
+/** Fill the entries first, ..., first+N-1 of the trampoline tables (by
+ *  bisection, to keep the template recursion shallow). */
+template <unsigned first, unsigned N> struct trampoline_filler {
+	static void fill(trampoline_tables & t)
+	{
+		trampoline_filler<first, N/2>::fill(t);
+		trampoline_filler<first + N/2, N - N/2>::fill(t);
+	}
+};
+
+struct trampoline_tables {
+	trampoline_tables()
+	{
+		trampoline_filler<0, num_trampolines>::fill(*this);
+	}
+	FUNCP_1P t1[num_trampolines];
+	FUNCP_2P t2[num_trampolines];
+	FUNCP_CUBA tc[num_trampolines];
+	FUNCP_BATCH_1P tb1[num_trampolines];
+	FUNCP_BATCH_2P tb2[num_trampolines];
+};
+
+template <unsigned first> struct trampoline_filler<first, 1> {
+	static void fill(trampoline_tables & t)
+	{
+		t.t1[first] = &trampoline_1p<first>;
+		t.t2[first] = &trampoline_2p<first>;
+		t.tc[first] = &trampoline_cuba<first>;
+		t.tb1[first] = &trampoline_batch_1p<first>;
+		t.tb2[first] = &trampoline_batch_2p<first>;
+	}
+};
+
+const trampoline_tables & trampolines()
+{
+	static const trampoline_tables t;
+	return t;
+}
+
+/** Compile e into a new program with parameters vars. */
+program * compile_program(const exvector & vars, const ex & e)
+{
+	program * p = new program(vars);
+	try {
+		p->compile(e);
+	} catch (...) {
+		delete p;
+		throw;
+	}
+	return p;
+}
+
+/** Register a program in a free entry of table, return its index. The
+ *  entry is freed again by release_program(). */
+unsigned register_program(const program * p, const program ** table)
+{
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	std::lock_guard<std::mutex> lock(programs_mutex);
+#endif
+	for (unsigned i = 0; i < num_trampolines; ++i) {
+		if (!table[i]) {
+			table[i] = p;
+			return i;
+		}
+	}
+	delete p;
+	throw std::runtime_error("compile_ex: too many expressions compiled by the bytecode backend, release unused ones with release_ex()");
+}
+
+/** Delete the program run by the trampoline fp and free its entry of
+ *  table. Function pointers which are not trampolines are ignored. */
+template <typename FUNCP>
+void release_program(FUNCP fp, const FUNCP * trampoline_table, const program ** table)
+{
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	std::lock_guard<std::mutex> lock(programs_mutex);
+#endif
+	for (unsigned i = 0; i < num_trampolines; ++i) {
+		if (trampoline_table[i] == fp) {
+			delete table[i];
+			table[i] = 0;
+			return;
+		}
+	}
+}
+
+} // anonymous namespace
+
+vm_math_func vm_math_function(const std::string & name)
+{
+	return lookup_func_1(name);
+}
+
+bool vm_has_kernels(const ex & e)
+{
+	if (is_a<function>(e)) {
+		const function & f = ex_to<function>(e);
+		if (f.get_double_func() || f.get_double_batch_func())
+			return true;
+	}
+	for (size_t i = 0; i < e.nops(); ++i)
+		if (vm_has_kernels(e.op(i)))
+			return true;
+	return false;
+}
+
+FUNCP_1P vm_compile_ex(const ex & expr, const symbol & sym)
+{
+	const exvector vars(1, sym);
+	return trampolines().t1[register_program(compile_program(vars, expr), programs_1p)];
+}
+
+FUNCP_2P vm_compile_ex(const ex & expr, const symbol & sym1, const symbol & sym2)
+{
+	exvector vars;
+	vars.push_back(sym1);
+	vars.push_back(sym2);
+	return trampolines().t2[register_program(compile_program(vars, expr), programs_2p)];
+}
+
+FUNCP_BATCH_1P vm_compile_batch_ex(const ex & expr, const symbol & sym)
+{
+	const exvector vars(1, sym);
+	return trampolines().tb1[register_program(compile_program(vars, expr), programs_batch_1p)];
+}
+
+FUNCP_BATCH_2P vm_compile_batch_ex(const ex & expr, const symbol & sym1, const symbol & sym2)
+{
+	exvector vars;
+	vars.push_back(sym1);
+	vars.push_back(sym2);
+	return trampolines().tb2[register_program(compile_program(vars, expr), programs_batch_2p)];
+}
+
+FUNCP_CUBA vm_compile_ex(const lst & exprs, const lst & syms)
+{
+	exvector vars(syms.begin(), syms.end());
+	program * p = new program(vars);
+	try {
+		for (size_t i = 0; i < exprs.nops(); ++i) {
+			p->compile(exprs.op(i));
+			p->compile_store(i);
+		}
+	} catch (...) {
+		delete p;
+		throw;
+	}
+	return trampolines().tc[register_program(p, programs_cuba)];
+}
+
+void release_ex(FUNCP_1P fp)
+{
+	release_program(fp, trampolines().t1, programs_1p);
+}
+
+void release_ex(FUNCP_2P fp)
+{
+	release_program(fp, trampolines().t2, programs_2p);
+}
+
+void release_ex(FUNCP_CUBA fp)
+{
+	release_program(fp, trampolines().tc, programs_cuba);
+}
+
+void release_ex(FUNCP_BATCH_1P fp)
+{
+	release_program(fp, trampolines().tb1, programs_batch_1p);
+}
+
+void release_ex(FUNCP_BATCH_2P fp)
+{
+	release_program(fp, trampolines().tb2, programs_batch_2p);
+}
+
+} // namespace GiNaC
@@ -0,0 +1,68 @@
+/** @file exvm.h
+ *
+ *  Interface to the bytecode backend of compile_ex(). */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_EXVM_H
+#define GINAC_EXVM_H
+
+#include "excompiler.h"
+
+#include <string>
+
+namespace GiNaC {
+
+/** Translate expr into bytecode for a small stack machine evaluating it in
+ *  double precision, and return a function pointer which runs it. No files
+ *  are written and no external compiler is needed. sym becomes the
+ *  function parameter. */
+FUNCP_1P vm_compile_ex(const ex & expr, const symbol & sym);
+
+/** Same as vm_compile_ex(const ex &, const symbol &), with two
+ *  parameters sym1 and sym2. */
+FUNCP_2P vm_compile_ex(const ex & expr, const symbol & sym1, const symbol & sym2);
+
+/** Same as vm_compile_ex(const ex &, const symbol &), for a function
+ *  evaluating expr at n points at once. */
+FUNCP_BATCH_1P vm_compile_batch_ex(const ex & expr, const symbol & sym);
+
+/** Same as vm_compile_batch_ex(const ex &, const symbol &), with two
+ *  parameters sym1 and sym2. */
+FUNCP_BATCH_2P vm_compile_batch_ex(const ex & expr, const symbol & sym1, const symbol & sym2);
+
+/** Same as vm_compile_ex(const ex &, const symbol &), for a function
+ *  with the CUBA signature: f[i] is set to exprs[i] evaluated for
+ *  syms[j] = a[j]. */
+FUNCP_CUBA vm_compile_ex(const lst & exprs, const lst & syms);
+
+typedef double (*vm_math_func)(double);
+
+/** The math library function the GiNaC function of one argument with the
+ *  given name is computed with, or 0 if there is none. */
+vm_math_func vm_math_function(const std::string & name);
+
+/** True if e contains a function with a double_func or double_batch_func.
+ *  Only the bytecode backend can call these kernels, so compile_ex() uses
+ *  it for such expressions whatever backend is selected. */
+bool vm_has_kernels(const ex & e);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_EXVM_H
@@ -64,11 +64,15 @@
 #include "mul.h"
 #include "normal.h"
 #include "add.h"
+#include "parallel.h"
+#include "budget.h"
+#include "polynomial/prime_table.h"
 
 #include <algorithm>
 #include <cmath>
 #include <limits>
 #include <list>
+#include <stdint.h> // for uint32_t, uint64_t
 #include <vector>
 #ifdef DEBUGFACTOR
 #include <ostream>
@@ -142,6 +146,134 @@ typedef std::vector<cln::cl_MI> umodpoly;
 typedef std::vector<cln::cl_I> upoly;
 typedef vector<umodpoly> upvec;
 
+// The univariate factorization works modulo small primes (see next_prime()).
+// cln's modular integers are not made for that: every operation dispatches
+// through the ring and updates reference counts. The following classes are
+// a drop-in replacement for cl_modint_ring and cl_MI for odd primes below
+// 2^31 which keep the coefficients in a single machine word, using
+// Montgomery's multiplication.
+
+class word_modint_ring;
+
+/** Element of a word_modint_ring. The representative rep of x is x*2^32 mod
+ *  p, in the range 0 <= rep < p. */
+struct word_MI
+{
+	word_MI() : R(0), rep(0) { }
+	word_MI(const word_modint_ring* R_, uint32_t rep_) : R(R_), rep(rep_) { }
+	const word_modint_ring* ring() const { return R; }
+
+	const word_modint_ring* R;
+	uint32_t rep;
+};
+
+/** The ring of integers modulo an odd prime p < 2^31. */
+class word_modint_ring
+{
+public:
+	explicit word_modint_ring(unsigned int p_) : p(p_), modulus(p_)
+	{
+		if ( p < 3 || p % 2 == 0 || p >= (1u << 31) ) {
+			throw logic_error("word_modint_ring: unsupported modulus.");
+		}
+		// p is its own inverse mod 2^3, each Newton step doubles the bits
+		uint32_t inv = p;
+		for ( int i=0; i<4; ++i ) {
+			inv *= 2 - p*inv;
+		}
+		pinv = 0 - inv;
+		const uint64_t r = (uint64_t(1) << 32) % p;
+		r1 = r;
+		r2 = r * r % p;
+	}
+	word_MI zero() const { return word_MI(this, 0); }
+	word_MI one() const { return word_MI(this, r1); }
+	/** Converts 0 <= x < 2^32. */
+	word_MI from_uint(uint32_t x) const { return word_MI(this, reduce(uint64_t(x % p) * r2)); }
+	word_MI canonhom(const cl_I& x) const { return from_uint(cl_I_to_uint(mod(x, modulus))); }
+	cl_I retract(const word_MI& x) const { return cl_I(static_cast<unsigned int>(reduce(x.rep))); }
+	/** t*2^(-32) mod p for t < p*2^32. */
+	uint32_t reduce(uint64_t t) const { return montgomery_reduce(t, p, pinv); }
+
+	const uint32_t p;
+	const cl_I modulus;
+private:
+	uint32_t pinv;  ///< -p^(-1) mod 2^32
+	uint32_t r1;    ///< 2^32 mod p, the representative of 1
+	uint32_t r2;    ///< 2^64 mod p, converts to the representation
+};
+
+static inline word_MI operator+(const word_MI& a, const word_MI& b)
+{
+	const uint32_t s = a.rep + b.rep;
+	return word_MI(a.R, s >= a.R->p ? s - a.R->p : s);
+}
+
+static inline word_MI operator-(const word_MI& a, const word_MI& b)
+{
+	return word_MI(a.R, a.rep >= b.rep ? a.rep - b.rep : a.rep + (a.R->p - b.rep));
+}
+
+static inline word_MI operator-(const word_MI& a)
+{
+	return word_MI(a.R, a.rep ? a.R->p - a.rep : 0);
+}
+
+static inline word_MI operator*(const word_MI& a, const word_MI& b)
+{
+	return word_MI(a.R, a.R->reduce(uint64_t(a.rep) * b.rep));
+}
+
+static inline word_MI operator*(const word_MI& a, int n)
+{
+	if ( n < 0 ) {
+		return -(a * a.R->from_uint(-n));
+	}
+	return a * a.R->from_uint(n);
+}
+
+static inline bool operator==(const word_MI& a, const word_MI& b)
+{
+	return a.rep == b.rep;
+}
+
+static inline bool operator!=(const word_MI& a, const word_MI& b)
+{
+	return a.rep != b.rep;
+}
+
+static inline bool zerop(const word_MI& a)
+{
+	return a.rep == 0;
+}
+
+static word_MI recip(const word_MI& a)
+{
+	const word_modint_ring* R = a.R;
+	int64_t r0 = R->p, r1 = R->reduce(a.rep);
+	if ( r1 == 0 ) {
+		throw logic_error("recip: division by zero.");
+	}
+	int64_t s0 = 0, s1 = 1;
+	while ( r1 ) {
+		const int64_t q = r0 / r1;
+		int64_t buf = r0 - q*r1; r0 = r1; r1 = buf;
+		buf = s0 - q*s1; s0 = s1; s1 = buf;
+	}
+	if ( s0 < 0 ) {
+		s0 += R->p;
+	}
+	return R->from_uint(static_cast<uint32_t>(s0));
+}
+
+static inline word_MI div(const word_MI& a, const word_MI& b)
+{
+	return a * recip(b);
+}
+
+typedef std::vector<word_MI> wumodpoly;
+typedef vector<wumodpoly> wupvec;
+
 // COPY FROM UPOLY.HPP
 
 // CHANGED size_t -> int !!!
@@ -155,7 +287,7 @@ template<typename T> static typename T::value_type lcoeff(const T& p)
 	return p[p.size() - 1];
 }
 
-static bool normalize_in_field(umodpoly& a)
+template<typename T> static bool normalize_in_field(T& a)
 {
 	if (a.size() == 0)
 		return true;
@@ -163,7 +295,7 @@ static bool normalize_in_field(umodpoly& a)
 		return true;
 	}
 
-	const cln::cl_MI lc_1 = recip(lcoeff(a));
+	const typename T::value_type lc_1 = recip(lcoeff(a));
 	for (std::size_t k = a.size(); k-- != 0; )
 		a[k] = a[k]*lc_1;
 	return false;
@@ -206,10 +338,10 @@ canonicalize(T& p, const typename T::size_type hint = std::numeric_limits<typena
 
 // END COPY FROM UPOLY.HPP
 
-static void expt_pos(umodpoly& a, unsigned int q)
+static void expt_pos(wumodpoly& a, unsigned int q)
 {
 	if ( a.empty() ) return;
-	cl_MI zero = a[0].ring()->zero(); 
+	word_MI zero = a[0].ring()->zero(); 
 	int deg = degree(a);
 	a.resize(degree(a)*q+1, zero);
 	for ( int i=deg; i>0; --i ) {
@@ -240,6 +372,26 @@ template<> struct uvar_poly_p<umodpoly>
 	static const bool value = true;
 };
 
+template<> struct uvar_poly_p<wumodpoly>
+{
+	static const bool value = true;
+};
+
+template<typename T> struct umodpoly_p
+{
+	static const bool value = false;
+};
+
+template<> struct umodpoly_p<umodpoly>
+{
+	static const bool value = true;
+};
+
+template<> struct umodpoly_p<wumodpoly>
+{
+	static const bool value = true;
+};
+
 template<typename T>
 // Don't define this for anything but univariate polynomials.
 static typename enable_if<uvar_poly_p<T>::value, T>::type
@@ -308,6 +460,216 @@ operator-(const T& a, const T& b)
 	}
 }
 
+// Polynomials with fewer coefficients than this are multiplied by the
+// schoolbook method.
+const size_t karatsuba_threshold = 32;
+
+/** Multiplies the polynomials with coefficients a[0..na) and b[0..nb) by the
+ *  schoolbook method and adds the product to c[0..na+nb-1). */
+template<typename C>
+static void mul_school(const C* a, size_t na, const C* b, size_t nb, C* c)
+{
+	for ( size_t i=0; i<na; ++i ) {
+		for ( size_t j=0; j<nb; ++j ) {
+			c[i+j] = c[i+j] + a[i] * b[j];
+		}
+	}
+}
+
+/** Karatsuba multiplication of the polynomials with coefficients a[0..n)
+ *  and b[0..n). The product is written to c[0..2n-1), which must be zero on
+ *  entry. */
+template<typename C>
+static void mul_karatsuba(const C* a, const C* b, size_t n, C* c, const C& zero)
+{
+	if ( n < karatsuba_threshold ) {
+		mul_school(a, n, b, n, c);
+		return;
+	}
+	// a = a0 + a1*x^m, b = b0 + b1*x^m with deg(a0), deg(b0) < m
+	const size_t m = n/2;
+	const size_t h = n - m;
+	vector<C> sa(a + m, a + n);
+	vector<C> sb(b + m, b + n);
+	for ( size_t i=0; i<m; ++i ) {
+		sa[i] = sa[i] + a[i];
+		sb[i] = sb[i] + b[i];
+	}
+	vector<C> z1(2*h - 1, zero);
+	mul_karatsuba(&sa[0], &sb[0], h, &z1[0], zero);
+	// a0*b0 and a1*b1 go directly to their places in c
+	mul_karatsuba(a, b, m, c, zero);
+	mul_karatsuba(a + m, b + m, h, c + 2*m, zero);
+	for ( size_t i=0; i<2*m-1; ++i ) {
+		z1[i] = z1[i] - c[i];
+	}
+	for ( size_t i=0; i<2*h-1; ++i ) {
+		z1[i] = z1[i] - c[2*m + i];
+	}
+	for ( size_t i=0; i<2*h-1; ++i ) {
+		c[m + i] = c[m + i] + z1[i];
+	}
+}
+
+/** Adds the product of the polynomials with coefficients a[0..na) and
+ *  b[0..nb) to c[0..na+nb-1). Unbalanced products are split into Karatsuba
+ *  multiplications of pieces of equal size. */
+template<typename C>
+static void mul_coeffs(const C* a, size_t na, const C* b, size_t nb, C* c, const C& zero)
+{
+	if ( na < nb ) {
+		std::swap(a, b);
+		std::swap(na, nb);
+	}
+	if ( nb < karatsuba_threshold ) {
+		mul_school(a, na, b, nb, c);
+		return;
+	}
+	vector<C> buf(2*nb - 1);
+	for ( size_t i=0; i<na; i+=nb ) {
+		const size_t len = std::min(nb, na - i);
+		fill(buf.begin(), buf.end(), zero);
+		if ( len == nb ) {
+			mul_karatsuba(a + i, b, nb, &buf[0], zero);
+		}
+		else {
+			mul_coeffs(a + i, len, b, nb, &buf[0], zero);
+		}
+		for ( size_t j=0; j<len+nb-1; ++j ) {
+			c[i + j] = c[i + j] + buf[j];
+		}
+	}
+}
+
+template<typename T> static void mul_poly(const T& a, const T& b, T& c)
+{
+	const typename T::value_type zero = c[0];
+	mul_coeffs(&a[0], a.size(), &b[0], b.size(), &c[0], zero);
+}
+
+// Word-sized modular polynomials of at least this many coefficients are
+// multiplied by number theoretic transforms.
+const size_t ntt_threshold = 64;
+
+// Primes c*2^k+1 with k >= 23 from the word_primes table. The coefficients
+// of the product of two polynomials with n coefficients below 2^31 are
+// smaller than n*2^62, which is less than the product of these primes for
+// n <= ntt_max_size.
+const uint32_t ntt_primes[3] = { 998244353, 754974721, 469762049 };
+const size_t ntt_max_size = size_t(1) << 22;
+
+static uint32_t expt_mod(uint64_t b, uint64_t e, uint32_t p)
+{
+	uint64_t r = 1;
+	b %= p;
+	while ( e ) {
+		if ( e & 1 ) {
+			r = r * b % p;
+		}
+		b = b * b % p;
+		e >>= 1;
+	}
+	return static_cast<uint32_t>(r);
+}
+
+/** In-place number theoretic transform of length a.size() (a power of 2)
+ *  modulo one of the ntt_primes. The twiddle factors are kept in
+ *  Montgomery representation, so the entries of a keep their
+ *  representation. */
+static void ntt(vector<uint32_t>& a, const word_prime& q, bool inverse)
+{
+	const uint32_t p = q.p;
+	const size_t n = a.size();
+	for ( size_t i=1, j=0; i<n; ++i ) {
+		size_t bit = n >> 1;
+		for ( ; j & bit; bit >>= 1 ) {
+			j ^= bit;
+		}
+		j ^= bit;
+		if ( i < j ) {
+			std::swap(a[i], a[j]);
+		}
+	}
+	for ( size_t len=2, lg=1; len<=n; len<<=1, ++lg ) {
+		uint32_t w = q.root_of_unity(lg);
+		if ( inverse ) {
+			w = q.expt(w, p - 2);
+		}
+		const size_t half = len >> 1;
+		for ( size_t i=0; i<n; i+=len ) {
+			uint32_t wn = q.r1;
+			for ( size_t j=0; j<half; ++j ) {
+				const uint32_t u = a[i+j];
+				const uint32_t v = q.mul(a[i+j+half], wn);
+				a[i+j] = u + v >= p ? u + v - p : u + v;
+				a[i+j+half] = u >= v ? u - v : u + p - v;
+				wn = q.mul(wn, w);
+			}
+		}
+	}
+	if ( inverse ) {
+		const uint32_t n_1 = q.expt(q.to_montgomery(static_cast<uint32_t>(n)), p - 2);
+		for ( size_t i=0; i<n; ++i ) {
+			a[i] = q.mul(a[i], n_1);
+		}
+	}
+}
+
+/** Multiplication of word-sized modular polynomials. Large products are
+ *  computed by number theoretic transforms modulo the three ntt_primes,
+ *  followed by Chinese remaindering of the exact integer coefficients
+ *  modulo p. */
+static void mul_poly(const wumodpoly& a, const wumodpoly& b, wumodpoly& c)
+{
+	const size_t nc = a.size() + b.size() - 1;
+	size_t n = 1;
+	while ( n < nc ) {
+		n <<= 1;
+	}
+	const word_modint_ring* R = a[0].ring();
+	if ( std::min(a.size(), b.size()) < ntt_threshold || n > ntt_max_size ) {
+		mul_coeffs(&a[0], a.size(), &b[0], b.size(), &c[0], R->zero());
+		return;
+	}
+
+	vector<uint32_t> res[3];
+	for ( int k=0; k<3; ++k ) {
+		const word_prime& q = *find_word_prime(ntt_primes[k]);
+		vector<uint32_t> fa(n, 0), fb(n, 0);
+		for ( size_t i=0; i<a.size(); ++i ) {
+			fa[i] = R->reduce(a[i].rep) % q.p;
+		}
+		// The transform of b in Montgomery representation, so that the
+		// pointwise products come out in the plain one
+		for ( size_t i=0; i<b.size(); ++i ) {
+			fb[i] = q.to_montgomery(R->reduce(b[i].rep));
+		}
+		ntt(fa, q, false);
+		ntt(fb, q, false);
+		for ( size_t i=0; i<n; ++i ) {
+			fa[i] = q.mul(fa[i], fb[i]);
+		}
+		ntt(fa, q, true);
+		res[k].swap(fa);
+	}
+
+	// Garner's algorithm: x = x0 + q0*x1 + q0*q1*x2
+	const uint64_t q0 = ntt_primes[0], q1 = ntt_primes[1], q2 = ntt_primes[2];
+	const uint64_t q0_1 = expt_mod(q0, q1 - 2, q1);
+	const uint64_t q01_2 = expt_mod(q0 * q1 % q2, q2 - 2, q2);
+	const uint64_t p = R->p;
+	const uint64_t q0p = q0 % p, q01p = q0 * q1 % p;
+	for ( size_t i=0; i<nc; ++i ) {
+		const uint64_t x0 = res[0][i];
+		const uint64_t x1 = (res[1][i] + q1 - x0 % q1) % q1 * q0_1 % q1;
+		uint64_t t = (res[2][i] + q2 - x0 % q2) % q2;
+		t = (t + q2 - q0 % q2 * x1 % q2) % q2;
+		const uint64_t x2 = t * q01_2 % q2;
+		const uint64_t x = (x0 % p + q0p * x1 % p + q01p * x2 % p) % p;
+		c[i] = R->from_uint(static_cast<uint32_t>(x));
+	}
+}
+
 static upoly operator*(const upoly& a, const upoly& b)
 {
 	upoly c;
@@ -315,29 +677,21 @@ static upoly operator*(const upoly& a, const upoly& b)
 
 	int n = degree(a) + degree(b);
 	c.resize(n+1, 0);
-	for ( int i=0 ; i<=n; ++i ) {
-		for ( int j=0 ; j<=i; ++j ) {
-			if ( j > degree(a) || (i-j) > degree(b) ) continue;
-			c[i] = c[i] + a[j] * b[i-j];
-		}
-	}
+	mul_poly(a, b, c);
 	canonicalize(c);
 	return c;
 }
 
-static umodpoly operator*(const umodpoly& a, const umodpoly& b)
+template<typename T>
+static typename enable_if<umodpoly_p<T>::value, T>::type
+operator*(const T& a, const T& b)
 {
-	umodpoly c;
+	T c;
 	if ( a.empty() || b.empty() ) return c;
 
 	int n = degree(a) + degree(b);
 	c.resize(n+1, a[0].ring()->zero());
-	for ( int i=0 ; i<=n; ++i ) {
-		for ( int j=0 ; j<=i; ++j ) {
-			if ( j > degree(a) || (i-j) > degree(b) ) continue;
-			c[i] = c[i] + a[j] * b[i-j];
-		}
-	}
+	mul_poly(a, b, c);
 	canonicalize(c);
 	return c;
 }
@@ -368,9 +722,11 @@ static upoly operator/(const upoly& a, const cl_I& x)
 	return r;
 }
 
-static umodpoly operator*(const umodpoly& a, const cl_MI& x)
+template<typename T>
+static typename enable_if<umodpoly_p<T>::value, T>::type
+operator*(const T& a, const typename T::value_type& x)
 {
-	umodpoly r(a.size());
+	T r(a.size());
 	for ( size_t i=0; i<a.size(); ++i ) {
 		r[i] = a[i] * x;
 	}
@@ -381,19 +737,15 @@ static umodpoly operator*(const umodpoly& a, const cl_MI& x)
 static void upoly_from_ex(upoly& up, const ex& e, const ex& x)
 {
 	// assert: e is in Z[x]
-	int deg = e.degree(x);
-	up.resize(deg+1);
-	int ldeg = e.ldegree(x);
-	for ( ; deg>=ldeg; --deg ) {
-		up[deg] = the<cl_I>(ex_to<numeric>(e.coeff(x, deg)).to_cl_N());
-	}
-	for ( ; deg>=0; --deg ) {
-		up[deg] = 0;
+	const exvector c = e.coeff_vector(x);
+	up.resize(c.size());
+	for ( size_t i=0; i<c.size(); ++i ) {
+		up[i] = the<cl_I>(ex_to<numeric>(c[i]).to_cl_N());
 	}
 	canonicalize(up);
 }
 
-static void umodpoly_from_upoly(umodpoly& ump, const upoly& e, const cl_modint_ring& R)
+static void umodpoly_from_upoly(wumodpoly& ump, const upoly& e, const word_modint_ring* R)
 {
 	int deg = degree(e);
 	ump.resize(deg+1);
@@ -406,15 +758,10 @@ static void umodpoly_from_upoly(umodpoly& ump, const upoly& e, const cl_modint_r
 static void umodpoly_from_ex(umodpoly& ump, const ex& e, const ex& x, const cl_modint_ring& R)
 {
 	// assert: e is in Z[x]
-	int deg = e.degree(x);
-	ump.resize(deg+1);
-	int ldeg = e.ldegree(x);
-	for ( ; deg>=ldeg; --deg ) {
-		cl_I coeff = the<cl_I>(ex_to<numeric>(e.coeff(x, deg)).to_cl_N());
-		ump[deg] = R->canonhom(coeff);
-	}
-	for ( ; deg>=0; --deg ) {
-		ump[deg] = R->zero();
+	const exvector c = e.coeff_vector(x);
+	ump.resize(c.size());
+	for ( size_t i=0; i<c.size(); ++i ) {
+		ump[i] = R->canonhom(the<cl_I>(ex_to<numeric>(c[i]).to_cl_N()));
 	}
 	canonicalize(ump);
 }
@@ -454,11 +801,11 @@ static ex umodpoly_to_ex(const umodpoly& a, const ex& x)
 	return e;
 }
 
-static upoly umodpoly_to_upoly(const umodpoly& a)
+static upoly umodpoly_to_upoly(const wumodpoly& a)
 {
 	upoly e(a.size());
 	if ( a.empty() ) return e;
-	cl_modint_ring R = a[0].ring();
+	const word_modint_ring* R = a[0].ring();
 	cl_I mod = R->modulus;
 	cl_I halfmod = (mod-1) >> 1;
 	for ( int i=degree(a); i>=0; --i ) {
@@ -506,6 +853,59 @@ static void reduce_coeff(umodpoly& a, const cl_I& x)
 	}
 }
 
+// Division uses Newton iteration if both the divisor and the quotient have
+// at least this degree.
+const int newton_division_threshold = 64;
+
+/** Truncates p modulo x^n. */
+template<typename T> static void truncate(T& p, size_t n)
+{
+	if ( p.size() > n ) {
+		p.resize(n);
+		canonicalize(p);
+	}
+}
+
+/** Calculates the inverse of the power series f modulo x^n by Newton
+ *  iteration. Assertion: f[0] is not zero. */
+template<typename T> static T inverse_series(const T& f, size_t n)
+{
+	const T one(1, f[0].ring()->one());
+	T g(1, recip(f[0]));
+	size_t m = 1;
+	while ( m < n ) {
+		m = std::min(2*m, n);
+		// g = g + g*(1 - f*g) mod x^m
+		T fm(f.begin(), f.begin() + std::min(f.size(), m));
+		canonicalize(fm);
+		T e = fm * g;
+		truncate(e, m);
+		e = one - e;
+		if ( e.empty() ) continue;
+		e = g * e;
+		truncate(e, m);
+		g = g + e;
+	}
+	return g;
+}
+
+/** Calculates the quotient of a/b from the reversed polynomials:
+ *  rev(q) = rev(a)/rev(b) mod x^(deg(a)-deg(b)+1).
+ *  Assertion: deg(a) >= deg(b), b not empty. */
+template<typename T> static void div_newton(const T& a, const T& b, T& q)
+{
+	const size_t k = a.size() - b.size() + 1;
+	T ra(a.rbegin(), a.rbegin() + k);
+	canonicalize(ra);
+	T rb(b.rbegin(), b.rbegin() + std::min(k, b.size()));
+	canonicalize(rb);
+	T rq = ra * inverse_series(rb, k);
+	truncate(rq, k);
+	rq.resize(k, a[0].ring()->zero());
+	q.assign(rq.rbegin(), rq.rend());
+	canonicalize(q);
+}
+
 /** Calculates remainder of a/b.
  *  Assertion: a and b not empty.
  *
@@ -513,7 +913,9 @@ static void reduce_coeff(umodpoly& a, const cl_I& x)
  *  @param[in]  b  polynomial divisor
  *  @param[out] r  polynomial remainder
  */
-static void rem(const umodpoly& a, const umodpoly& b, umodpoly& r)
+template<typename T>
+static typename enable_if<umodpoly_p<T>::value>::type
+rem(const T& a, const T& b, T& r)
 {
 	int k, n;
 	n = degree(b);
@@ -521,8 +923,15 @@ static void rem(const umodpoly& a, const umodpoly& b, umodpoly& r)
 	r = a;
 	if ( k < 0 ) return;
 
+	if ( n >= newton_division_threshold && k >= newton_division_threshold ) {
+		T q;
+		div_newton(a, b, q);
+		r = a - q * b;
+		return;
+	}
+
 	do {
-		cl_MI qk = div(r[n+k], b[n]);
+		typename T::value_type qk = div(r[n+k], b[n]);
 		if ( !zerop(qk) ) {
 			for ( int i=0; i<n; ++i ) {
 				unsigned int j = n + k - 1 - i;
@@ -542,7 +951,9 @@ static void rem(const umodpoly& a, const umodpoly& b, umodpoly& r)
  *  @param[in]  b  polynomial divisor
  *  @param[out] q  polynomial quotient
  */
-static void div(const umodpoly& a, const umodpoly& b, umodpoly& q)
+template<typename T>
+static typename enable_if<umodpoly_p<T>::value>::type
+div(const T& a, const T& b, T& q)
 {
 	int k, n;
 	n = degree(b);
@@ -550,10 +961,15 @@ static void div(const umodpoly& a, const umodpoly& b, umodpoly& q)
 	q.clear();
 	if ( k < 0 ) return;
 
-	umodpoly r = a;
+	if ( n >= newton_division_threshold && k >= newton_division_threshold ) {
+		div_newton(a, b, q);
+		return;
+	}
+
+	T r = a;
 	q.resize(k+1, a[0].ring()->zero());
 	do {
-		cl_MI qk = div(r[n+k], b[n]);
+		typename T::value_type qk = div(r[n+k], b[n]);
 		if ( !zerop(qk) ) {
 			q[k] = qk;
 			for ( int i=0; i<n; ++i ) {
@@ -574,7 +990,9 @@ static void div(const umodpoly& a, const umodpoly& b, umodpoly& q)
  *  @param[out] r  polynomial remainder
  *  @param[out] q  polynomial quotient
  */
-static void remdiv(const umodpoly& a, const umodpoly& b, umodpoly& r, umodpoly& q)
+template<typename T>
+static typename enable_if<umodpoly_p<T>::value>::type
+remdiv(const T& a, const T& b, T& r, T& q)
 {
 	int k, n;
 	n = degree(b);
@@ -583,9 +1001,15 @@ static void remdiv(const umodpoly& a, const umodpoly& b, umodpoly& r, umodpoly&
 	r = a;
 	if ( k < 0 ) return;
 
+	if ( n >= newton_division_threshold && k >= newton_division_threshold ) {
+		div_newton(a, b, q);
+		r = a - q * b;
+		return;
+	}
+
 	q.resize(k+1, a[0].ring()->zero());
 	do {
-		cl_MI qk = div(r[n+k], b[n]);
+		typename T::value_type qk = div(r[n+k], b[n]);
 		if ( !zerop(qk) ) {
 			q[k] = qk;
 			for ( int i=0; i<n; ++i ) {
@@ -606,15 +1030,17 @@ static void remdiv(const umodpoly& a, const umodpoly& b, umodpoly& r, umodpoly&
  *  @param[in]  b  polynomial
  *  @param[out] c  GCD
  */
-static void gcd(const umodpoly& a, const umodpoly& b, umodpoly& c)
+template<typename T>
+static typename enable_if<umodpoly_p<T>::value>::type
+gcd(const T& a, const T& b, T& c)
 {
 	if ( degree(a) < degree(b) ) return gcd(b, a, c);
 
 	c = a;
 	normalize_in_field(c);
-	umodpoly d = b;
+	T d = b;
 	normalize_in_field(d);
-	umodpoly r;
+	T r;
 	while ( !d.empty() ) {
 		rem(c, d, r);
 		c = d;
@@ -628,7 +1054,7 @@ static void gcd(const umodpoly& a, const umodpoly& b, umodpoly& c)
  *  @param[in]  a  polynomial of which to take the derivative
  *  @param[out] d  result/derivative
  */
-static void deriv(const umodpoly& a, umodpoly& d)
+template<typename T> static void deriv(const T& a, T& d)
 {
 	d.clear();
 	if ( a.size() <= 1 ) return;
@@ -641,13 +1067,13 @@ static void deriv(const umodpoly& a, umodpoly& d)
 	canonicalize(d);
 }
 
-static bool unequal_one(const umodpoly& a)
+template<typename T> static bool unequal_one(const T& a)
 {
 	if ( a.empty() ) return true;
 	return ( a.size() != 1 || a[0] != a[0].ring()->one() );
 }
 
-static bool equal_one(const umodpoly& a)
+template<typename T> static bool equal_one(const T& a)
 {
 	return ( a.size() == 1 && a[0] == a[0].ring()->one() );
 }
@@ -657,14 +1083,14 @@ static bool equal_one(const umodpoly& a)
  *  @param[in] a  polynomial to check
  *  @return       true if polynomial is square free, false otherwise
  */
-static bool squarefree(const umodpoly& a)
+template<typename T> static bool squarefree(const T& a)
 {
-	umodpoly b;
+	T b;
 	deriv(a, b);
 	if ( b.empty() ) {
 		return false;
 	}
-	umodpoly c;
+	T c;
 	gcd(a, b, c);
 	return equal_one(c);
 }
@@ -675,28 +1101,28 @@ static bool squarefree(const umodpoly& a)
 ////////////////////////////////////////////////////////////////////////////////
 // modular matrix
 
-typedef vector<cl_MI> mvec;
+typedef vector<word_MI> mvec;
 
 class modular_matrix
 {
 	friend ostream& operator<<(ostream& o, const modular_matrix& m);
 public:
-	modular_matrix(size_t r_, size_t c_, const cl_MI& init) : r(r_), c(c_)
+	modular_matrix(size_t r_, size_t c_, const word_MI& init) : r(r_), c(c_)
 	{
 		m.resize(c*r, init);
 	}
 	size_t rowsize() const { return r; }
 	size_t colsize() const { return c; }
-	cl_MI& operator()(size_t row, size_t col) { return m[row*c + col]; }
-	cl_MI operator()(size_t row, size_t col) const { return m[row*c + col]; }
-	void mul_col(size_t col, const cl_MI x)
+	word_MI& operator()(size_t row, size_t col) { return m[row*c + col]; }
+	word_MI operator()(size_t row, size_t col) const { return m[row*c + col]; }
+	void mul_col(size_t col, const word_MI x)
 	{
 		for ( size_t rc=0; rc<r; ++rc ) {
 			std::size_t i = c*rc + col;
 			m[i] = m[i] * x;
 		}
 	}
-	void sub_col(size_t col1, size_t col2, const cl_MI fac)
+	void sub_col(size_t col1, size_t col2, const word_MI fac)
 	{
 		for ( size_t rc=0; rc<r; ++rc ) {
 			std::size_t i1 = col1 + c*rc;
@@ -712,14 +1138,14 @@ public:
 			std::swap(m[i1], m[i2]);
 		}
 	}
-	void mul_row(size_t row, const cl_MI x)
+	void mul_row(size_t row, const word_MI x)
 	{
 		for ( size_t cc=0; cc<c; ++cc ) {
 			std::size_t i = row*c + cc; 
 			m[i] = m[i] * x;
 		}
 	}
-	void sub_row(size_t row1, size_t row2, const cl_MI fac)
+	void sub_row(size_t row1, size_t row2, const word_MI fac)
 	{
 		for ( size_t cc=0; cc<c; ++cc ) {
 			std::size_t i1 = row1*c + cc;
@@ -755,7 +1181,7 @@ public:
 		}
 		return true;
 	}
-	void set_row(size_t row, const vector<cl_MI>& newrow)
+	void set_row(size_t row, const vector<word_MI>& newrow)
 	{
 		for (std::size_t i2 = 0; i2 < newrow.size(); ++i2) {
 			std::size_t i1 = row*c + i2;
@@ -778,7 +1204,7 @@ modular_matrix operator*(const modular_matrix& m1, const modular_matrix& m2)
 
 	for ( size_t i=0; i<r; ++i ) {
 		for ( size_t j=0; j<c; ++j ) {
-			cl_MI buf;
+			word_MI buf;
 			buf = m1(i,0) * m2(0,j);
 			for ( size_t k=1; k<c; ++k ) {
 				buf = buf + m1(i,k)*m2(k,j);
@@ -791,7 +1217,7 @@ modular_matrix operator*(const modular_matrix& m1, const modular_matrix& m2)
 
 ostream& operator<<(ostream& o, const modular_matrix& m)
 {
-	cl_modint_ring R = m(0,0).ring();
+	const word_modint_ring* R = m(0,0).ring();
 	o << "{";
 	for ( size_t i=0; i<m.rowsize(); ++i ) {
 		o << "{";
@@ -816,19 +1242,19 @@ ostream& operator<<(ostream& o, const modular_matrix& m)
  *  @param[in]  a_  modular polynomial
  *  @param[out] Q   Q matrix
  */
-static void q_matrix(const umodpoly& a_, modular_matrix& Q)
+static void q_matrix(const wumodpoly& a_, modular_matrix& Q)
 {
-	umodpoly a = a_;
+	wumodpoly a = a_;
 	normalize_in_field(a);
 
 	int n = degree(a);
-	unsigned int q = cl_I_to_uint(a[0].ring()->modulus);
-	umodpoly r(n, a[0].ring()->zero());
+	unsigned int q = a[0].ring()->p;
+	wumodpoly r(n, a[0].ring()->zero());
 	r[0] = a[0].ring()->one();
 	Q.set_row(0, r);
 	unsigned int max = (n-1) * q;
 	for ( size_t m=1; m<=max; ++m ) {
-		cl_MI rn_1 = r.back();
+		word_MI rn_1 = r.back();
 		for ( size_t i=n-1; i>0; --i ) {
 			r[i] = r[i-1] - (rn_1 * a[i]);
 		}
@@ -847,7 +1273,7 @@ static void q_matrix(const umodpoly& a_, modular_matrix& Q)
 static void nullspace(modular_matrix& M, vector<mvec>& basis)
 {
 	const size_t n = M.rowsize();
-	const cl_MI one = M(0,0).ring()->one();
+	const word_MI one = M(0,0).ring()->one();
 	for ( size_t i=0; i<n; ++i ) {
 		M(i,i) = M(i,i) - one;
 	}
@@ -896,10 +1322,10 @@ static void nullspace(modular_matrix& M, vector<mvec>& basis)
  *  @param[out] upv  vector containing modular factors. if upv was not empty the
  *                   new elements are added at the end
  */
-static void berlekamp(const umodpoly& a, upvec& upv)
+static void berlekamp(const wumodpoly& a, wupvec& upv)
 {
-	cl_modint_ring R = a[0].ring();
-	umodpoly one(1, R->one());
+	const word_modint_ring* R = a[0].ring();
+	wumodpoly one(1, R->one());
 
 	// find nullspace of Q matrix
 	modular_matrix Q(degree(a), degree(a), R->zero());
@@ -913,24 +1339,24 @@ static void berlekamp(const umodpoly& a, upvec& upv)
 		return;
 	}
 
-	list<umodpoly> factors;
+	list<wumodpoly> factors;
 	factors.push_back(a);
 	unsigned int size = 1;
 	unsigned int r = 1;
-	unsigned int q = cl_I_to_uint(R->modulus);
+	unsigned int q = R->p;
 
-	list<umodpoly>::iterator u = factors.begin();
+	list<wumodpoly>::iterator u = factors.begin();
 
 	// calculate all gcd's
 	while ( true ) {
 		for ( unsigned int s=0; s<q; ++s ) {
-			umodpoly nur = nu[r];
-			nur[0] = nur[0] - cl_MI(R, s);
+			wumodpoly nur = nu[r];
+			nur[0] = nur[0] - R->from_uint(s);
 			canonicalize(nur);
-			umodpoly g;
+			wumodpoly g;
 			gcd(nur, *u, g);
 			if ( unequal_one(g) && g != *u ) {
-				umodpoly uo;
+				wumodpoly uo;
 				div(*u, g, uo);
 				if ( equal_one(uo) ) {
 					throw logic_error("berlekamp: unexpected divisor.");
@@ -940,13 +1366,13 @@ static void berlekamp(const umodpoly& a, upvec& upv)
 				}
 				factors.push_back(g);
 				size = 0;
-				list<umodpoly>::const_iterator i = factors.begin(), end = factors.end();
+				list<wumodpoly>::const_iterator i = factors.begin(), end = factors.end();
 				while ( i != end ) {
 					if ( degree(*i) ) ++size; 
 					++i;
 				}
 				if ( size == k ) {
-					list<umodpoly>::const_iterator i = factors.begin(), end = factors.end();
+					list<wumodpoly>::const_iterator i = factors.begin(), end = factors.end();
 					while ( i != end ) {
 						upv.push_back(*i++);
 					}
@@ -971,7 +1397,7 @@ static void berlekamp(const umodpoly& a, upvec& upv)
  *  @param[in] prime  prime number -> exponent 1/prime
  *  @param[in] ap     resulting polynomial
  */
-static void expt_1_over_p(const umodpoly& a, unsigned int prime, umodpoly& ap)
+static void expt_1_over_p(const wumodpoly& a, unsigned int prime, wumodpoly& ap)
 {
 	size_t newdeg = degree(a)/prime;
 	ap.resize(newdeg+1);
@@ -987,32 +1413,32 @@ static void expt_1_over_p(const umodpoly& a, unsigned int prime, umodpoly& ap)
  *  @param[out] factors  modular factors
  *  @param[out] mult     corresponding multiplicities (exponents)
  */
-static void modsqrfree(const umodpoly& a, upvec& factors, vector<int>& mult)
+static void modsqrfree(const wumodpoly& a, wupvec& factors, vector<int>& mult)
 {
 	const unsigned int prime = cl_I_to_uint(a[0].ring()->modulus);
 	int i = 1;
-	umodpoly b;
+	wumodpoly b;
 	deriv(a, b);
 	if ( b.size() ) {
-		umodpoly c;
+		wumodpoly c;
 		gcd(a, b, c);
-		umodpoly w;
+		wumodpoly w;
 		div(a, c, w);
 		while ( unequal_one(w) ) {
-			umodpoly y;
+			wumodpoly y;
 			gcd(w, c, y);
-			umodpoly z;
+			wumodpoly z;
 			div(w, y, z);
 			factors.push_back(z);
 			mult.push_back(i);
 			++i;
 			w = y;
-			umodpoly buf;
+			wumodpoly buf;
 			div(c, y, buf);
 			c = buf;
 		}
 		if ( unequal_one(c) ) {
-			umodpoly cp;
+			wumodpoly cp;
 			expt_1_over_p(c, prime, cp);
 			size_t previ = mult.size();
 			modsqrfree(cp, factors, mult);
@@ -1022,7 +1448,7 @@ static void modsqrfree(const umodpoly& a, upvec& factors, vector<int>& mult)
 		}
 	}
 	else {
-		umodpoly ap;
+		wumodpoly ap;
 		expt_1_over_p(a, prime, ap);
 		size_t previ = mult.size();
 		modsqrfree(ap, factors, mult);
@@ -1044,33 +1470,33 @@ static void modsqrfree(const umodpoly& a, upvec& factors, vector<int>& mult)
  *  @param[out] ddfactors  vector containing polynomials which factors have the
  *                         degree given in degrees.
  */
-static void distinct_degree_factor(const umodpoly& a_, vector<int>& degrees, upvec& ddfactors)
+static void distinct_degree_factor(const wumodpoly& a_, vector<int>& degrees, wupvec& ddfactors)
 {
-	umodpoly a = a_;
+	wumodpoly a = a_;
 
-	cl_modint_ring R = a[0].ring();
-	int q = cl_I_to_int(R->modulus);
+	const word_modint_ring* R = a[0].ring();
+	int q = R->p;
 	int nhalf = degree(a)/2;
 
 	int i = 1;
-	umodpoly w(2);
+	wumodpoly w(2);
 	w[0] = R->zero();
 	w[1] = R->one();
-	umodpoly x = w;
+	wumodpoly x = w;
 
 	while ( i <= nhalf ) {
 		expt_pos(w, q);
-		umodpoly buf;
+		wumodpoly buf;
 		rem(w, a, buf);
 		w = buf;
-		umodpoly wx = w - x;
+		wumodpoly wx = w - x;
 		gcd(a, wx, buf);
 		if ( unequal_one(buf) ) {
 			degrees.push_back(i);
 			ddfactors.push_back(buf);
 		}
 		if ( unequal_one(buf) ) {
-			umodpoly buf2;
+			wumodpoly buf2;
 			div(a, buf, buf2);
 			a = buf2;
 			nhalf = degree(a)/2;
@@ -1085,28 +1511,129 @@ static void distinct_degree_factor(const umodpoly& a_, vector<int>& degrees, upv
 	}
 }
 
+/** Calculates a^e mod f.
+ *
+ *  @param[in] a  polynomial
+ *  @param[in] e  exponent
+ *  @param[in] f  modulus, degree at least 1
+ *  @return       a^e mod f
+ */
+static wumodpoly expt_mod(const wumodpoly& a, uint64_t e, const wumodpoly& f)
+{
+	wumodpoly r(1, f[0].ring()->one());
+	wumodpoly b, buf;
+	rem(a, f, b);
+	while ( e ) {
+		if ( e & 1 ) {
+			rem(r * b, f, buf);
+			r.swap(buf);
+		}
+		e >>= 1;
+		if ( e ) {
+			rem(b * b, f, buf);
+			b.swap(buf);
+		}
+	}
+	return r;
+}
+
+/** Pseudo random numbers (xorshift) for equal_degree_factor(). The sequence
+ *  is fixed, so that the factorization is reproducible. */
+static uint32_t next_random(uint32_t& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+/** Cantor-Zassenhaus equal degree factorization.
+ *
+ *  The implementation follows the algorithm in chapter 14 of von zur Gathen,
+ *  Gerhard, Modern Computer Algebra: for a random polynomial b the factors
+ *  of a divide b^((p^d-1)/2) - 1 with probability close to 1/2 each, so the
+ *  gcd splits a. Unlike Berlekamp's algorithm it needs no matrix, so it is
+ *  used for high degrees.
+ *
+ *  @param[in]     a_     modular polynomial, product of distinct irreducible
+ *                        factors of degree d
+ *  @param[in]     d      degree of the factors
+ *  @param[out]    upv    vector containing the monic modular factors. if upv
+ *                        was not empty the new elements are added at the end
+ *  @param[in,out] state  state of the random number generator
+ */
+static void equal_degree_factor(const wumodpoly& a_, int d, wupvec& upv, uint32_t& state)
+{
+	wumodpoly a = a_;
+	normalize_in_field(a);
+	const int n = degree(a);
+	if ( n == d ) {
+		upv.push_back(a);
+		return;
+	}
+
+	const word_modint_ring* R = a[0].ring();
+	const wumodpoly one(1, R->one());
+	while ( true ) {
+		wumodpoly b(n);
+		for ( int i=0; i<n; ++i ) {
+			b[i] = R->from_uint(next_random(state));
+		}
+		canonicalize(b);
+		if ( degree(b) < 1 ) continue;
+
+		wumodpoly g;
+		gcd(a, b, g);
+		if ( equal_one(g) ) {
+			// (p^d-1)/2 = (1 + p + ... + p^(d-1)) * (p-1)/2
+			wumodpoly norm = b, bp = b, buf;
+			for ( int i=1; i<d; ++i ) {
+				bp = expt_mod(bp, R->p, a);
+				rem(norm * bp, a, buf);
+				norm.swap(buf);
+			}
+			buf = expt_mod(norm, (R->p - 1) / 2, a) - one;
+			if ( buf.empty() ) continue;
+			gcd(a, buf, g);
+		}
+		if ( degree(g) > 0 && degree(g) < n ) {
+			wumodpoly h;
+			div(a, g, h);
+			equal_degree_factor(g, d, upv, state);
+			equal_degree_factor(h, d, upv, state);
+			return;
+		}
+	}
+}
+
+// Factors of the distinct degree factorization with at least this degree are
+// split by equal_degree_factor(), smaller ones by berlekamp().
+const int equal_degree_threshold = 32;
+
 /** Modular same degree factorization.
  *  Same degree factorization is a kind of misnomer. It performs distinct degree
- *  factorization, but instead of using the Cantor-Zassenhaus algorithm it
- *  (sub-optimally) uses Berlekamp's algorithm for the factors of the same
- *  degree.
+ *  factorization, and then splits the factors of the same degree. This uses
+ *  Berlekamp's algorithm for small degrees and the Cantor-Zassenhaus algorithm
+ *  for high ones, where Berlekamp's matrix becomes too expensive.
  *
  *  @param[in]  a    modular polynomial
  *  @param[out] upv  vector containing modular factors. if upv was not empty the
  *                   new elements are added at the end
  */
-static void same_degree_factor(const umodpoly& a, upvec& upv)
+static void same_degree_factor(const wumodpoly& a, wupvec& upv)
 {
-	cl_modint_ring R = a[0].ring();
-
 	vector<int> degrees;
-	upvec ddfactors;
+	wupvec ddfactors;
 	distinct_degree_factor(a, degrees, ddfactors);
 
+	uint32_t state = 2463534242u;
 	for ( size_t i=0; i<degrees.size(); ++i ) {
 		if ( degrees[i] == degree(ddfactors[i]) ) {
 			upv.push_back(ddfactors[i]);
 		}
+		else if ( degree(ddfactors[i]) >= equal_degree_threshold ) {
+			equal_degree_factor(ddfactors[i], degrees[i], upv, state);
+		}
 		else {
 			berlekamp(ddfactors[i], upv);
 		}
@@ -1126,7 +1653,7 @@ static void same_degree_factor(const umodpoly& a, upvec& upv)
  *  @param[out] upv  vector containing modular factors. if upv was not empty the
  *                   new elements are added at the end
  */
-static void factor_modular(const umodpoly& p, upvec& upv)
+static void factor_modular(const wumodpoly& p, wupvec& upv)
 {
 #ifdef USE_SAME_DEGREE_FACTOR
 	same_degree_factor(p, upv);
@@ -1143,26 +1670,26 @@ static void factor_modular(const umodpoly& p, upvec& upv)
  *  @param[out] s  polynomial
  *  @param[out] t  polynomial
  */
-static void exteuclid(const umodpoly& a, const umodpoly& b, umodpoly& s, umodpoly& t)
+template<typename T> static void exteuclid(const T& a, const T& b, T& s, T& t)
 {
 	if ( degree(a) < degree(b) ) {
 		exteuclid(b, a, t, s);
 		return;
 	}
 
-	umodpoly one(1, a[0].ring()->one());
-	umodpoly c = a; normalize_in_field(c);
-	umodpoly d = b; normalize_in_field(d);
+	T one(1, a[0].ring()->one());
+	T c = a; normalize_in_field(c);
+	T d = b; normalize_in_field(d);
 	s = one;
 	t.clear();
-	umodpoly d1;
-	umodpoly d2 = one;
-	umodpoly q;
+	T d1;
+	T d2 = one;
+	T q;
 	while ( true ) {
 		div(c, d, q);
-		umodpoly r = c - q * d;
-		umodpoly r1 = s - q * d1;
-		umodpoly r2 = t - q * d2;
+		T r = c - q * d;
+		T r1 = s - q * d1;
+		T r2 = t - q * d2;
 		c = d;
 		s = d1;
 		t = d2;
@@ -1171,8 +1698,8 @@ static void exteuclid(const umodpoly& a, const umodpoly& b, umodpoly& s, umodpol
 		d1 = r1;
 		d2 = r2;
 	}
-	cl_MI fac = recip(lcoeff(a) * lcoeff(c));
-	umodpoly::iterator i = s.begin(), end = s.end();
+	typename T::value_type fac = recip(lcoeff(a) * lcoeff(c));
+	typename T::iterator i = s.begin(), end = s.end();
 	for ( ; i!=end; ++i ) {
 		*i = *i * fac;
 	}
@@ -1245,10 +1772,10 @@ static inline cl_I calc_bound(const upoly& a, int maxdeg)
  *  @param[out] u    lifted factor
  *  @param[out] w    lifted factor, u*w = a
  */
-static void hensel_univar(const upoly& a_, unsigned int p, const umodpoly& u1_, const umodpoly& w1_, upoly& u, upoly& w)
+static void hensel_univar(const upoly& a_, unsigned int p, const wumodpoly& u1_, const wumodpoly& w1_, upoly& u, upoly& w)
 {
 	upoly a = a_;
-	const cl_modint_ring& R = u1_[0].ring();
+	const word_modint_ring* R = u1_[0].ring();
 
 	// calc bound B
 	int maxdeg = (degree(u1_) > degree(w1_)) ? degree(u1_) : degree(w1_);
@@ -1257,21 +1784,21 @@ static void hensel_univar(const upoly& a_, unsigned int p, const umodpoly& u1_,
 	// step 1
 	cl_I alpha = lcoeff(a);
 	a = a * alpha;
-	umodpoly nu1 = u1_;
+	wumodpoly nu1 = u1_;
 	normalize_in_field(nu1);
-	umodpoly nw1 = w1_;
+	wumodpoly nw1 = w1_;
 	normalize_in_field(nw1);
 	upoly phi;
 	phi = umodpoly_to_upoly(nu1) * alpha;
-	umodpoly u1;
+	wumodpoly u1;
 	umodpoly_from_upoly(u1, phi, R);
 	phi = umodpoly_to_upoly(nw1) * alpha;
-	umodpoly w1;
+	wumodpoly w1;
 	umodpoly_from_upoly(w1, phi, R);
 
 	// step 2
-	umodpoly s;
-	umodpoly t;
+	wumodpoly s;
+	wumodpoly t;
 	exteuclid(u1, w1, s, t);
 
 	// step 3
@@ -1282,18 +1809,19 @@ static void hensel_univar(const upoly& a_, unsigned int p, const umodpoly& u1_,
 
 	// step 4
 	while ( !e.empty() && modulus < maxmodulus ) {
+		check_budget();
 		upoly c = e / modulus;
 		phi = umodpoly_to_upoly(s) * c;
-		umodpoly sigmatilde;
+		wumodpoly sigmatilde;
 		umodpoly_from_upoly(sigmatilde, phi, R);
 		phi = umodpoly_to_upoly(t) * c;
-		umodpoly tautilde;
+		wumodpoly tautilde;
 		umodpoly_from_upoly(tautilde, phi, R);
-		umodpoly r, q;
+		wumodpoly r, q;
 		remdiv(sigmatilde, w1, r, q);
-		umodpoly sigma = r;
+		wumodpoly sigma = r;
 		phi = umodpoly_to_upoly(tautilde) + umodpoly_to_upoly(q) * umodpoly_to_upoly(u1);
-		umodpoly tau;
+		wumodpoly tau;
 		umodpoly_from_upoly(tau, phi, R);
 		u = u + umodpoly_to_upoly(tau) * modulus;
 		w = w + umodpoly_to_upoly(sigma) * modulus;
@@ -1328,32 +1856,23 @@ static void hensel_univar(const upoly& a_, unsigned int p, const umodpoly& u1_,
  */
 static unsigned int next_prime(unsigned int p)
 {
-	static vector<unsigned int> primes;
-	if ( primes.size() == 0 ) {
-		primes.push_back(3); primes.push_back(5); primes.push_back(7);
-	}
-	vector<unsigned int>::const_iterator it = primes.begin();
-	if ( p >= primes.back() ) {
-		unsigned int candidate = primes.back() + 2;
-		while ( true ) {
-			size_t n = primes.size()/2;
-			for ( size_t i=0; i<n; ++i ) {
-				if ( candidate % primes[i] ) continue;
-				candidate += 2;
-				i=-1;
+	// The primes used here are small, so trial division is fast enough.
+	// Avoiding a static table keeps this function safe to call from
+	// several threads.
+	unsigned int candidate = p < 3 ? 3 : (p + 1) | 1;
+	while ( true ) {
+		bool isprime = true;
+		for ( unsigned int d=3; d*d<=candidate; d+=2 ) {
+			if ( candidate % d == 0 ) {
+				isprime = false;
+				break;
 			}
-			primes.push_back(candidate);
-			if ( candidate > p ) break;
 		}
-		return candidate;
-	}
-	vector<unsigned int>::const_iterator end = primes.end();
-	for ( ; it!=end; ++it ) {
-		if ( *it > p ) {
-			return *it;
+		if ( isprime ) {
+			return candidate;
 		}
+		candidate += 2;
 	}
-	throw logic_error("next_prime: should not reach this point!");
 }
 
 /** Manages the splitting a vector of of modular factors into two partitions.
@@ -1362,7 +1881,7 @@ class factor_partition
 {
 public:
 	/** Takes the vector of modular factors and initializes the first partition */
-	factor_partition(const upvec& factors_) : factors(factors_)
+	factor_partition(const wupvec& factors_) : factors(factors_)
 	{
 		n = factors.size();
 		k.resize(n, 0);
@@ -1417,9 +1936,9 @@ public:
 		return true;
 	}
 	/** Get first partition */
-	umodpoly& left() { return lr[0]; }
+	wumodpoly& left() { return lr[0]; }
 	/** Get second partition */
-	umodpoly& right() { return lr[1]; }
+	wumodpoly& right() { return lr[1]; }
 private:
 	void split_cached()
 	{
@@ -1440,7 +1959,7 @@ private:
 					size_t j = pos + cache[pos].size() + 1;
 					d -= cache[pos].size();
 					while ( d ) {
-						umodpoly buf = cache[pos].back() * factors[j];
+						wumodpoly buf = cache[pos].back() * factors[j];
 						cache[pos].push_back(buf);
 						--d;
 						++j;
@@ -1467,10 +1986,10 @@ private:
 		}
 	}
 private:
-	umodpoly lr[2];
-	vector< vector<umodpoly> > cache;
-	upvec factors;
-	umodpoly one;
+	wumodpoly lr[2];
+	vector< vector<wumodpoly> > cache;
+	wupvec factors;
+	wumodpoly one;
 	size_t n;
 	size_t len;
 	size_t last;
@@ -1483,9 +2002,622 @@ private:
 struct ModFactors
 {
 	upoly poly;
-	upvec factors;
+	wupvec factors;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// lattice based recombination of modular factors
+
+typedef vector<cl_I> lattice_vector;
+
+static cl_I dot(const lattice_vector& a, const lattice_vector& b)
+{
+	cl_I s = 0;
+	for ( size_t i=0; i<a.size(); ++i ) {
+		s = s + a[i] * b[i];
+	}
+	return s;
+}
+
+/** Integral LLL reduction with delta = 3/4.
+ *
+ *  The implementation follows algorithm 2.6.7 in H.Cohen, A Course in
+ *  Computational Algebraic Number Theory, Springer Verlag, 1993. All
+ *  quantities are kept as integers, so there are no rounding errors.
+ *
+ *  @param[in,out] b  linearly independent vectors, replaced by a reduced basis
+ *                    of the same lattice
+ *  @param[out]    d  d[0] == 1, and d[i]/d[i-1] is the squared norm of the i-th
+ *                    Gram-Schmidt vector of the reduced basis (i >= 1)
+ *  @return           false if the vectors turned out to be linearly dependent
+ */
+static bool lll_reduce(vector<lattice_vector>& b, vector<cl_I>& d)
+{
+	// indices are 1-based as in Cohen's book, b_k is b[k-1]
+	const size_t n = b.size();
+	d.assign(n+1, 0);
+	vector< vector<cl_I> > lambda(n+1, vector<cl_I>(n+1, 0));
+	d[0] = 1;
+	d[1] = dot(b[0], b[0]);
+	size_t k = 2, kmax = 1;
+
+	struct reducer {
+		vector<lattice_vector>& b;
+		vector<cl_I>& d;
+		vector< vector<cl_I> >& lambda;
+		void operator()(size_t k, size_t l)
+		{
+			if ( abs(2*lambda[k][l]) <= d[l] ) return;
+			const cl_I q = round1(lambda[k][l], d[l]);
+			for ( size_t i=0; i<b[k-1].size(); ++i ) {
+				b[k-1][i] = b[k-1][i] - q * b[l-1][i];
+			}
+			lambda[k][l] = lambda[k][l] - q * d[l];
+			for ( size_t i=1; i<l; ++i ) {
+				lambda[k][i] = lambda[k][i] - q * lambda[l][i];
+			}
+		}
+	} redi = { b, d, lambda };
+
+	while ( k <= n ) {
+		if ( k > kmax ) {
+			// incremental Gram-Schmidt
+			kmax = k;
+			for ( size_t j=1; j<=k; ++j ) {
+				cl_I u = dot(b[k-1], b[j-1]);
+				for ( size_t i=1; i<j; ++i ) {
+					u = exquo(d[i] * u - lambda[k][i] * lambda[j][i], d[i-1]);
+				}
+				if ( j < k ) {
+					lambda[k][j] = u;
+				}
+				else {
+					d[k] = u;
+				}
+			}
+			if ( zerop(d[k]) ) {
+				return false;
+			}
+		}
+		while ( true ) {
+			redi(k, k-1);
+			if ( 4 * d[k] * d[k-2] >= 3 * square(d[k-1]) - 4 * square(lambda[k][k-1]) ) {
+				break;
+			}
+			// swap b_k and b_(k-1)
+			b[k-1].swap(b[k-2]);
+			for ( size_t j=1; j+1<k; ++j ) {
+				std::swap(lambda[k][j], lambda[k-1][j]);
+			}
+			const cl_I lam = lambda[k][k-1];
+			const cl_I B = exquo(d[k-2] * d[k] + square(lam), d[k-1]);
+			for ( size_t i=k+1; i<=kmax; ++i ) {
+				const cl_I t = lambda[i][k];
+				lambda[i][k] = exquo(d[k] * lambda[i][k-1] - lam * t, d[k-1]);
+				lambda[i][k-1] = exquo(B * t + lam * lambda[i][k], d[k]);
+			}
+			d[k-1] = B;
+			if ( k > 2 ) {
+				--k;
+			}
+		}
+		for ( size_t l=k-1; l-- > 1; ) {
+			redi(k, l);
+		}
+		++k;
+	}
+	return true;
+}
+
+/** Returns x mod P in the symmetric range. */
+static cl_I symmetric_mod(const cl_I& x, const cl_I& P)
+{
+	cl_I m = mod(x, P);
+	if ( 2 * m > P ) {
+		m = m - P;
+	}
+	return m;
+}
+
+static upoly symmetric_mod(const upoly& a, const cl_I& P)
+{
+	upoly r(a.size());
+	for ( size_t i=0; i<a.size(); ++i ) {
+		r[i] = symmetric_mod(a[i], P);
+	}
+	canonicalize(r);
+	return r;
+}
+
+/** Divides a by b over Z.
+ *
+ *  @param[in]  a  polynomial dividend
+ *  @param[in]  b  polynomial divisor, not empty
+ *  @param[out] q  polynomial quotient
+ *  @return        true if b divides a, otherwise false and q is undefined
+ */
+static bool divide_exactly(const upoly& a, const upoly& b, upoly& q)
+{
+	q.clear();
+	const int n = degree(b);
+	int k = degree(a) - n;
+	if ( a.empty() ) return true;
+	if ( k < 0 ) return false;
+	upoly r = a;
+	q.resize(k+1, 0);
+	do {
+		const cl_I_div_t qr = truncate2(r[n+k], b[n]);
+		if ( !zerop(qr.remainder) ) return false;
+		q[k] = qr.quotient;
+		for ( int i=0; i<=n; ++i ) {
+			r[i+k] = r[i+k] - q[k] * b[i];
+		}
+	} while ( k-- );
+	canonicalize(r);
+	return r.empty();
+}
+
+/** Lifts a factorization a == u1*w1 mod p to a == u*w mod P, where P is a
+ *  power of p. Contrary to hensel_univar() this works for polynomials a which
+ *  are only known mod P, all polynomials are monic.
+ *
+ *  @param[in]  a   monic polynomial mod P
+ *  @param[in]  p   prime number
+ *  @param[in]  P   power of p
+ *  @param[in]  u1  monic modular factor of a (mod p)
+ *  @param[in]  w1  monic modular factor of a (mod p), relatively prime to u1
+ *  @param[out] u   lifted factor, monic, coefficients in the symmetric range
+ *  @param[out] w   lifted factor, monic, coefficients in the symmetric range
+ */
+static void hensel_lift_monic(const upoly& a, unsigned int p, const cl_I& P, const wumodpoly& u1, const wumodpoly& w1, upoly& u, upoly& w)
+{
+	const word_modint_ring* R = u1[0].ring();
+	wumodpoly s, t;
+	exteuclid(u1, w1, s, t);
+	u = umodpoly_to_upoly(u1);
+	w = umodpoly_to_upoly(w1);
+	cl_I modulus = p;
+	while ( modulus < P ) {
+		upoly e = a - u * w;
+		if ( e.empty() ) break;
+		wumodpoly c;
+		umodpoly_from_upoly(c, e / modulus, R);
+		// u*w changes by modulus*(du*w1 + dw*u1) == modulus*c mod p
+		wumodpoly du, dw;
+		rem(t * c, u1, du);
+		rem(s * c, w1, dw);
+		u = u + umodpoly_to_upoly(du) * modulus;
+		w = w + umodpoly_to_upoly(dw) * modulus;
+		modulus = modulus * p;
+	}
+	u = symmetric_mod(u, P);
+	w = symmetric_mod(w, P);
+}
+
+/** Lifts the monic modular factors f[begin..end) of a to factors mod P.
+ *
+ *  @param[in]  a       monic polynomial mod P, a == f[begin]*...*f[end-1] mod p
+ *  @param[in]  p       prime number
+ *  @param[in]  P       power of p
+ *  @param[in]  f       monic modular factors
+ *  @param[out] lifted  the lifted factors are stored at the same positions
+ */
+static void hensel_lift_factors(const upoly& a, unsigned int p, const cl_I& P, const wupvec& f, size_t begin, size_t end, vector<upoly>& lifted)
+{
+	if ( end - begin == 1 ) {
+		lifted[begin] = a;
+		return;
+	}
+	const size_t mid = (begin + end) / 2;
+	wumodpoly u1 = f[begin];
+	for ( size_t i=begin+1; i<mid; ++i ) {
+		u1 = u1 * f[i];
+	}
+	wumodpoly w1 = f[mid];
+	for ( size_t i=mid+1; i<end; ++i ) {
+		w1 = w1 * f[i];
+	}
+	upoly u, w;
+	hensel_lift_monic(a, p, P, u1, w1, u, w);
+	hensel_lift_factors(u, p, P, f, begin, mid, lifted);
+	hensel_lift_factors(w, p, P, f, mid, end, lifted);
+}
+
+/** Reads off the partition of the modular factors from the short vectors
+ *  of the reduced lattice.
+ *
+ *  @param[in]  M          projections of the short vectors onto their first
+ *                         r coordinates
+ *  @param[in]  r          number of modular factors
+ *  @param[out] partition  rows of 0/1 vectors with disjoint supports
+ *  @return                true if the reduced row echelon form of M is such a
+ *                         partition of {0,...,r-1}
+ */
+static bool lattice_partition(vector<lattice_vector> M, size_t r, vector<lattice_vector>& partition)
+{
+	// fraction free Gauss-Jordan elimination
+	size_t rank = 0;
+	for ( size_t col=0; col<r && rank<M.size(); ++col ) {
+		size_t piv = rank;
+		while ( piv < M.size() && zerop(M[piv][col]) ) ++piv;
+		if ( piv == M.size() ) continue;
+		M[piv].swap(M[rank]);
+		for ( size_t i=0; i<M.size(); ++i ) {
+			if ( i == rank || zerop(M[i][col]) ) continue;
+			const cl_I f1 = M[rank][col], f2 = M[i][col];
+			cl_I g = 0;
+			for ( size_t j=0; j<r; ++j ) {
+				M[i][j] = f1 * M[i][j] - f2 * M[rank][j];
+				g = gcd(g, M[i][j]);
+			}
+			if ( !zerop(g) ) {
+				for ( size_t j=0; j<r; ++j ) {
+					M[i][j] = exquo(M[i][j], g);
+				}
+			}
+		}
+		++rank;
+	}
+
+	partition.clear();
+	vector<int> covered(r, 0);
+	for ( size_t i=0; i<rank; ++i ) {
+		cl_I g = 0;
+		for ( size_t j=0; j<r; ++j ) {
+			g = gcd(g, M[i][j]);
+		}
+		// the sign of the pivot is the sign of the first nonzero entry
+		size_t j0 = 0;
+		while ( zerop(M[i][j0]) ) ++j0;
+		if ( minusp(M[i][j0]) ) {
+			g = -g;
+		}
+		lattice_vector row(r);
+		for ( size_t j=0; j<r; ++j ) {
+			row[j] = exquo(M[i][j], g);
+		}
+		for ( size_t j=0; j<r; ++j ) {
+			if ( row[j] == 1 ) {
+				++covered[j];
+			}
+			else if ( !zerop(row[j]) ) {
+				return false;
+			}
+		}
+		partition.push_back(row);
+	}
+	for ( size_t j=0; j<r; ++j ) {
+		if ( covered[j] != 1 ) return false;
+	}
+	return true;
+}
+
+/** Returns e >= 1 such that 2^e bounds the absolute values of all complex
+ *  roots of a (Fujiwara's bound). */
+static int root_bound_exponent(const upoly& a)
+{
+	const int n = degree(a);
+	const int ln = integer_length(abs(a[n]));
+	int e = 1;
+	for ( int k=1; k<=n; ++k ) {
+		if ( zerop(a[n-k]) ) continue;
+		// |a_(n-k)/a_n| < 2^d
+		const int d = int(integer_length(abs(a[n-k]))) - ln + 1;
+		const int ek = d > 0 ? (d + k - 1) / k + 1 : 1;
+		if ( ek > e ) e = ek;
+	}
+	return e;
+}
+
+// Modular factors are recombined by lattice reduction instead of trying all
+// partitions if there are at least this many.
+const size_t lattice_recombination_threshold = 8;
+
+/** Recombination of the modular factors of a polynomial by lattice reduction.
+ *
+ *  The implementation follows the knapsack approach of [vHo] with the
+ *  coefficients of the logarithmic derivative as in [BHKS]: if g_1,...,g_r
+ *  are the monic factors of the polynomial a lifted modulo P, then for each
+ *  true factor h the polynomial (a/h)*h' is the sum of a*g_i'/g_i over the
+ *  modular factors g_i of h. Its coefficients are small, so the 0/1 vectors
+ *  of the true factors are short vectors in a lattice built from the
+ *  coefficients of a*g_i'/g_i mod P, which LLL reduction finds in polynomial
+ *  time.
+ *    [vHo]  Factoring polynomials and the knapsack problem,
+ *           M.van Hoeij, J. Number Theory 95 (2002) 167--189.
+ *    [BHKS] Complexity of the van Hoeij algorithm,
+ *           K.Belabas, M.van Hoeij, J.Klueners, A.Steel,
+ *           J. Theor. Nombres Bordeaux 21 (2009) 15--43.
+ *
+ *  @param[in]  a           primitive square free polynomial with positive
+ *                          leading coefficient
+ *  @param[in]  p           prime number that does not divide lcoeff(a), a is
+ *                          square free mod p
+ *  @param[in]  modfactors  modular factors of a mod p
+ *  @param[out] factors     irreducible factors of a
+ *  @return                 true if the recombination succeeded, otherwise the
+ *                          caller has to fall back to trying all partitions
+ */
+static bool lattice_recombination(const upoly& a, unsigned int p, const wupvec& modfactors, vector<upoly>& factors)
+{
+	const int n = degree(a);
+	const size_t r = modfactors.size();
+	const cl_I lc = lcoeff(a);
+
+	// Bounds for the coefficients of (a/h)*h' == a * sum 1/(x-alpha), summed
+	// over the roots alpha of a factor h. The coefficient of x^j in
+	// a/(x-alpha) is sum_{k>j} a_k*alpha^(k-j-1) == -sum_{k<=j} a_k*alpha^(k-j-1),
+	// estimated with root bounds 2^e for alpha and 2^e0 for 1/alpha. The
+	// Mignotte bound n*2^n*||a||^2 for a/h and h' holds as well. The top
+	// coefficient is n*lcoeff(a) for all h and carries no information.
+	cl_I norm2 = 0;
+	for ( int i=0; i<=n; ++i ) {
+		norm2 = norm2 + square(a[i]);
+	}
+	const cl_I mignotte = n * expt_pos(cl_I(2), n) * norm2;
+	const int e = root_bound_exponent(a);
+	const bool zero_root = zerop(a[0]);
+	const int e0 = zero_root ? 0 : root_bound_exponent(upoly(a.rbegin(), a.rend()));
+	// column j is truncated by s[j] bits
+	vector<uintC> s(n-1);
+	vector< pair<uintC, int> > order;
+	for ( int j=0; j<n-1; ++j ) {
+		cl_I top = 0;
+		for ( int k=n; k>j; --k ) {
+			top = ash(top, e) + abs(a[k]);
+		}
+		cl_I bound = top < mignotte ? top : mignotte;
+		if ( !zero_root ) {
+			cl_I low = 0;
+			for ( int k=0; k<=j; ++k ) {
+				low = ash(low, e0) + abs(a[k]);
+			}
+			low = ash(low, e0);
+			if ( low < bound ) bound = low;
+		}
+		s[j] = integer_length(n * bound) + 1;
+		order.push_back(make_pair(s[j], j));
+	}
+	// use the columns with the smallest bounds, a few at a time
+	std::stable_sort(order.begin(), order.end());
+	const size_t batch = 2;
+	const size_t ref = std::min(2*r, size_t(n-1));
+	const uintC bits = order[ref-1].first + 2 * (r + batch) + 10;
+	cl_I P = p;
+	while ( integer_length(P) <= bits ) {
+		P = P * p;
+	}
+	vector<int> columns;
+	for ( size_t j=0; j<order.size(); ++j ) {
+		if ( integer_length(P) < order[j].first + r + batch + 10 ) break;
+		columns.push_back(order[j].second);
+	}
+
+	// lift the monic factors mod P
+	wupvec f(r);
+	for ( size_t i=0; i<r; ++i ) {
+		f[i] = modfactors[i];
+		normalize_in_field(f[i]);
+	}
+	cl_I lc_1, v;
+	xgcd(lc, P, &lc_1, &v);
+	upoly amonic = symmetric_mod(a * lc_1, P);
+	vector<upoly> g(r);
+	hensel_lift_factors(amonic, p, P, f, 0, r, g);
+
+	// coefficients of a*g_i'/g_i mod P
+	vector<upoly> cld(r);
+	for ( size_t i=0; i<r; ++i ) {
+		upoly q;
+		const int dg = degree(g[i]);
+		q.resize(n - dg + 1, 0);
+		upoly rest = a;
+		for ( int k=n-dg; k>=0; --k ) {
+			q[k] = rest[k+dg];
+			for ( int j=0; j<=dg; ++j ) {
+				rest[j+k] = rest[j+k] - q[k] * g[i][j];
+			}
+		}
+		upoly dgi(dg);
+		for ( int j=1; j<=dg; ++j ) {
+			dgi[j-1] = g[i][j] * j;
+		}
+		upoly c = q * dgi;
+		cld[i].resize(n, 0);
+		for ( size_t j=0; j<c.size(); ++j ) {
+			cld[i][j] = mod(c[j], P);
+		}
+	}
+
+	// The first r coordinates of the short lattice vectors found so far span
+	// the 0/1 vectors of the true factors. Start with the unit vectors.
+	vector<lattice_vector> W(r, lattice_vector(r, 0));
+	for ( size_t i=0; i<r; ++i ) {
+		W[i][i] = 1;
+	}
+	for ( size_t first=0; first<columns.size(); first+=batch ) {
+		const size_t m = std::min(batch, columns.size() - first);
+		const size_t N = W.size() + m;
+		vector<lattice_vector> b(N, lattice_vector(r + m, 0));
+		for ( size_t k=0; k<W.size(); ++k ) {
+			std::copy(W[k].begin(), W[k].end(), b[k].begin());
+			for ( size_t j=0; j<m; ++j ) {
+				const int col = columns[first+j];
+				cl_I x = 0;
+				for ( size_t i=0; i<r; ++i ) {
+					if ( !zerop(W[k][i]) ) {
+						x = x + W[k][i] * ash(cld[i][col], -sintC(s[col]));
+					}
+				}
+				b[k][r+j] = x;
+			}
+		}
+		for ( size_t j=0; j<m; ++j ) {
+			b[W.size()+j][r+j] = ash(P, -sintC(s[columns[first+j]]));
+		}
+		vector<cl_I> d;
+		if ( !lll_reduce(b, d) ) {
+			return false;
+		}
+
+		// The vectors of the true factors have squared norm at most C2, and
+		// any such lattice vector is an integer combination of the first t
+		// basis vectors.
+		const cl_I C2 = r + m * square(cl_I(r+1));
+		size_t t = N;
+		while ( t > 0 && d[t] > C2 * d[t-1] ) --t;
+		if ( t == 0 ) {
+			return false;
+		}
+		W.resize(t);
+		for ( size_t i=0; i<t; ++i ) {
+			W[i].assign(b[i].begin(), b[i].begin() + r);
+		}
+
+		vector<lattice_vector> partition;
+		if ( lattice_partition(W, r, partition) ) {
+			// check the candidates by trial division
+			vector<upoly> result;
+			upoly rest = a;
+			bool ok = true;
+			for ( size_t k=0; k<partition.size() && ok; ++k ) {
+				upoly h(1, lc);
+				for ( size_t i=0; i<r; ++i ) {
+					if ( partition[k][i] == 1 ) {
+						h = symmetric_mod(h * g[i], P);
+					}
+				}
+				cl_I cont = 0;
+				for ( size_t i=0; i<h.size(); ++i ) {
+					cont = gcd(cont, h[i]);
+				}
+				if ( minusp(lcoeff(h)) ) {
+					cont = -cont;
+				}
+				h = h / cont;
+				upoly q;
+				ok = divide_exactly(rest, h, q);
+				rest = q;
+				result.push_back(h);
+			}
+			if ( ok && degree(rest) == 0 && abs(rest[0]) == 1 ) {
+				if ( rest[0] != 1 ) {
+					result[0] = result[0] * rest[0];
+				}
+				factors.swap(result);
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+/** Possible degrees of the factors over the integers of a polynomial of
+ *  degree n whose irreducible modular factors have the given degrees: d is
+ *  possible if it is the sum of the degrees of some of them.
+ *
+ *  @param[in] degs  degrees of the modular factors
+ *  @param[in] n     degree of the polynomial
+ *  @return          vector with element d true if d is possible
+ */
+static vector<bool> factor_degree_set(const vector<int>& degs, int n)
+{
+	vector<bool> possible(n+1, false);
+	possible[0] = true;
+	for ( size_t i=0; i<degs.size(); ++i ) {
+		for ( int d=n; d>=degs[i]; --d ) {
+			if ( possible[d-degs[i]] ) {
+				possible[d] = true;
+			}
+		}
+	}
+	return possible;
+}
+
+/** Computes the possible factor degrees modulo several primes from the
+ *  distinct degree factorizations. Used by factor_degree_pattern(). The
+ *  tasks only read word-sized modular polynomials, not expressions, so
+ *  no caches have to be filled in with prepare_for_threads().
+ */
+struct degree_pattern_task : public parallel_task {
+	degree_pattern_task(const wupvec& polys_, int n_, vector<vector<bool> >& sets_)
+		: polys(polys_), n(n_), sets(sets_) { }
+	void operator()(size_t i)
+	{
+		vector<int> degrees;
+		wupvec ddfactors;
+		distinct_degree_factor(polys[i], degrees, ddfactors);
+		// ddfactors[j] is the product of irreducible factors of degree degrees[j]
+		vector<int> degs;
+		for ( size_t j=0; j<degrees.size(); ++j ) {
+			degs.insert(degs.end(), degree(ddfactors[j]) / degrees[j], degrees[j]);
+		}
+		sets[i] = factor_degree_set(degs, n);
+	}
+	const wupvec& polys;
+	const int n;
+	vector<vector<bool> >& sets;
+};
+
+/** Number of primes used by factor_degree_pattern(). */
+const size_t degree_pattern_primes = 5;
+
+/** Degree pattern test: the degrees of the factors over the integers must
+ *  be possible modulo every prime, so the sets of possible degrees modulo
+ *  several primes are intersected. The distinct degree factorizations are
+ *  computed in several threads if parallel is true. Used by
+ *  factor_univariate().
+ *
+ *  @param[in]  prim      primitive square free polynomial
+ *  @param[in]  lc        leading coefficient of the polynomial
+ *  @param[out] possible  element d is true if a factor may have degree d
+ *  @param[in]  parallel  use several threads
+ *  @return               false if the polynomial is irreducible
+ */
+static bool factor_degree_pattern(const upoly& prim, const cl_I& lc, vector<bool>& possible, bool parallel)
+{
+	const int n = degree(prim);
+	list<word_modint_ring> rings;
+	wupvec polys;
+	unsigned int p = 3;
+	for ( unsigned int tries=0; polys.size()<degree_pattern_primes && tries<4*degree_pattern_primes; ++tries ) {
+		p = next_prime(p);
+		if ( zerop(rem(lc, p)) ) {
+			continue;
+		}
+		rings.push_back(word_modint_ring(p));
+		wumodpoly modpoly;
+		umodpoly_from_upoly(modpoly, prim, &rings.back());
+		if ( squarefree(modpoly) ) {
+			polys.push_back(modpoly);
+		}
+	}
+
+	vector<vector<bool> > sets(polys.size());
+	degree_pattern_task task(polys, n, sets);
+	if ( parallel && parallel_threads(polys.size()) > 1 ) {
+		parallel_for(polys.size(), task);
+	}
+	else {
+		for ( size_t i=0; i<polys.size(); ++i ) {
+			task(i);
+		}
+	}
+
+	possible.assign(n+1, true);
+	for ( size_t i=0; i<sets.size(); ++i ) {
+		for ( int d=0; d<=n; ++d ) {
+			possible[d] = possible[d] && sets[i][d];
+		}
+	}
+	for ( int d=1; d<n; ++d ) {
+		if ( possible[d] ) {
+			return true;
+		}
+	}
+	return false;
+}
+
 /** Univariate polynomial factorization.
  *
  *  Modular factorization is tried for several primes to minimize the number of
@@ -1496,7 +2628,7 @@ struct ModFactors
  *  @param[in,out] prime  prime number to start trying modular factorization with,
  *                        output value is the prime number actually used
  */
-static ex factor_univariate(const ex& poly, const ex& x, unsigned int& prime)
+static ex factor_univariate(const ex& poly, const ex& x, unsigned int& prime, bool parallel = false)
 {
 	ex unit, cont, prim_ex;
 	poly.unitcontprim(x, unit, cont, prim_ex);
@@ -1506,29 +2638,47 @@ static ex factor_univariate(const ex& poly, const ex& x, unsigned int& prime)
 	// determine proper prime and minimize number of modular factors
 	prime = 3;
 	unsigned int lastp = prime;
-	cl_modint_ring R;
+	list<word_modint_ring> rings;
 	unsigned int trials = 0;
 	unsigned int minfactors = 0;
 	cl_I lc = lcoeff(prim) * the<cl_I>(ex_to<numeric>(cont).to_cl_N());
-	upvec factors;
-	while ( trials < 2 ) {
-		umodpoly modpoly;
+	vector<bool> possible;
+	if ( !factor_degree_pattern(prim, lc, possible, parallel) ) {
+		// irreducible for sure
+		return poly;
+	}
+	wupvec factors;
+	// Big polynomials make lifting and recombination much more expensive
+	// than modular factorizations, so look harder for a prime with few
+	// factors.
+	const unsigned int max_trials =
+		( degree(prim) >= 32 || ex_to<basic>(prim_ex).metrics().bits >= 64 ) ? 4 : 2;
+	while ( trials < max_trials ) {
+		wumodpoly modpoly;
 		while ( true ) {
 			prime = next_prime(prime);
 			if ( !zerop(rem(lc, prime)) ) {
-				R = find_modint_ring(prime);
-				umodpoly_from_upoly(modpoly, prim, R);
+				rings.push_back(word_modint_ring(prime));
+				umodpoly_from_upoly(modpoly, prim, &rings.back());
 				if ( squarefree(modpoly) ) break;
 			}
 		}
 
 		// do modular factorization
-		upvec trialfactors;
+		wupvec trialfactors;
 		factor_modular(modpoly, trialfactors);
 		if ( trialfactors.size() <= 1 ) {
 			// irreducible for sure
 			return poly;
 		}
+		vector<int> degs(trialfactors.size());
+		for ( size_t i=0; i<trialfactors.size(); ++i ) {
+			degs[i] = degree(trialfactors[i]);
+		}
+		const vector<bool> trialpossible = factor_degree_set(degs, degree(prim));
+		for ( size_t d=0; d<possible.size(); ++d ) {
+			possible[d] = possible[d] && trialpossible[d];
+		}
 
 		if ( minfactors == 0 || trialfactors.size() < minfactors ) {
 			factors = trialfactors;
@@ -1541,7 +2691,17 @@ static ex factor_univariate(const ex& poly, const ex& x, unsigned int& prime)
 		}
 	}
 	prime = lastp;
-	R = find_modint_ring(prime);
+
+	if ( factors.size() >= lattice_recombination_threshold ) {
+		vector<upoly> irred;
+		if ( lattice_recombination(prim, prime, factors, irred) ) {
+			ex result = 1;
+			for ( size_t i=0; i<irred.size(); ++i ) {
+				result *= upoly_to_ex(irred[i], x);
+			}
+			return unit * cont * result;
+		}
+	}
 
 	// lift all factor combinations
 	stack<ModFactors> tocheck;
@@ -1555,8 +2715,15 @@ static ex factor_univariate(const ex& poly, const ex& x, unsigned int& prime)
 		const size_t n = tocheck.top().factors.size();
 		factor_partition part(tocheck.top().factors);
 		while ( true ) {
-			// call Hensel lifting
-			hensel_univar(tocheck.top().poly, prime, part.left(), part.right(), f1, f2);
+			check_budget();
+			// call Hensel lifting, unless the degree pattern rules out the
+			// partition
+			if ( possible[degree(part.left())] ) {
+				hensel_univar(tocheck.top().poly, prime, part.left(), part.right(), f1, f2);
+			}
+			else {
+				f1.clear();
+			}
 			if ( !f1.empty() ) {
 				// successful, update the stack and the result
 				if ( part.size_left() == 1 ) {
@@ -1592,8 +2759,8 @@ static ex factor_univariate(const ex& poly, const ex& x, unsigned int& prime)
 					break;
 				}
 				else {
-					upvec newfactors1(part.size_left()), newfactors2(part.size_right());
-					upvec::iterator i1 = newfactors1.begin(), i2 = newfactors2.begin();
+					wupvec newfactors1(part.size_left()), newfactors2(part.size_right());
+					wupvec::iterator i1 = newfactors1.begin(), i2 = newfactors2.begin();
 					for ( size_t i=0; i<n; ++i ) {
 						if ( part[i] ) {
 							*i2++ = tocheck.top().factors[i];
@@ -1630,10 +2797,10 @@ static ex factor_univariate(const ex& poly, const ex& x, unsigned int& prime)
 /** Second interface to factor_univariate() to be used if the information about
  *  the prime is not needed.
  */
-static inline ex factor_univariate(const ex& poly, const ex& x)
+static inline ex factor_univariate(const ex& poly, const ex& x, bool parallel = false)
 {
 	unsigned int prime;
-	return factor_univariate(poly, x, prime);
+	return factor_univariate(poly, x, prime, parallel);
 }
 
 /** Represents an evaluation point (<symbol>==<integer>).
@@ -1655,7 +2822,7 @@ ostream& operator<<(ostream& o, const vector<EvalPoint>& v)
 #endif // def DEBUGFACTOR
 
 // forward declaration
-static vector<ex> multivar_diophant(const vector<ex>& a_, const ex& x, const ex& c, const vector<EvalPoint>& I, unsigned int d, unsigned int p, unsigned int k);
+static vector<ex> multivar_diophant(const vector<ex>& a_, const ex& x, const ex& c, const vector<EvalPoint>& I, unsigned int d, unsigned int p, unsigned int k, bool parallel = false);
 
 /** Utility function for multivariate Hensel lifting.
  *
@@ -1776,26 +2943,46 @@ static void eea_lift(const umodpoly& a, const umodpoly& b, const ex& x, unsigned
 /** Utility function for multivariate Hensel lifting.
  *
  *  Solves the equation
- *    s_1*b_1 + ... + s_r*b_r == x^m mod p^k
+ *    s_1*b_1 + ... + s_r*b_r == 1 mod p^k
  *  with given b_1 = a_1 * ... * a_{i-1} * a_{i+1} * ... * a_r
- *
- *  The implementation follows the algorithm in chapter 6 of [GCL].
+ *  The solutions of the equations with x^m on the right hand side are then
+ *  obtained by univar_diophant().
  *
  *  @param a  vector with univariate polynomials mod p^k
  *  @param x  symbol
- *  @param m  exponent of x^m in the equation to solve
  *  @param p  prime number
  *  @param k  p^k is modulus
  *  @return   vector of polynomials (s_i)
  */
-static upvec univar_diophant(const upvec& a, const ex& x, unsigned int m, unsigned int p, unsigned int k)
+static upvec univar_diophant_basis(const upvec& a, const ex& x, unsigned int p, unsigned int k)
 {
-	cl_modint_ring R = find_modint_ring(expt_pos(cl_I(p),k));
+	if ( a.size() > 2 ) {
+		return multiterm_eea_lift(a, x, p, k);
+	}
+	upvec s(2);
+	eea_lift(a[1], a[0], x, p, k, s[0], s[1]);
+	return s;
+}
 
+/** Utility function for multivariate Hensel lifting.
+ *
+ *  Solves the equation
+ *    s_1*b_1 + ... + s_r*b_r == x^m mod p^k
+ *  with given b_1 = a_1 * ... * a_{i-1} * a_{i+1} * ... * a_r
+ *
+ *  The implementation follows the algorithm in chapter 6 of [GCL].
+ *
+ *  @param a  vector with univariate polynomials mod p^k
+ *  @param s  solutions for x^0 as returned by univar_diophant_basis()
+ *  @param m  exponent of x^m in the equation to solve
+ *  @param R  modular ring mod p^k
+ *  @return   vector of polynomials (s_i)
+ */
+static upvec univar_diophant(const upvec& a, const upvec& s, unsigned int m, const cl_modint_ring& R)
+{
 	const size_t r = a.size();
 	upvec result;
 	if ( r > 2 ) {
-		upvec s = multiterm_eea_lift(a, x, p, k);
 		for ( size_t j=0; j<r; ++j ) {
 			umodpoly bmod = umodpoly_to_umodpoly(s[j], R, m);
 			umodpoly buf;
@@ -1804,13 +2991,11 @@ static upvec univar_diophant(const upvec& a, const ex& x, unsigned int m, unsign
 		}
 	}
 	else {
-		umodpoly s, t;
-		eea_lift(a[1], a[0], x, p, k, s, t);
-		umodpoly bmod = umodpoly_to_umodpoly(s, R, m);
+		umodpoly bmod = umodpoly_to_umodpoly(s[0], R, m);
 		umodpoly buf, q;
 		remdiv(bmod, a[0], buf, q);
 		result.push_back(buf);
-		umodpoly t1mod = umodpoly_to_umodpoly(t, R, m);
+		umodpoly t1mod = umodpoly_to_umodpoly(s[1], R, m);
 		buf = t1mod + q * a[1];
 		result.push_back(buf);
 	}
@@ -1819,28 +3004,23 @@ static upvec univar_diophant(const upvec& a, const ex& x, unsigned int m, unsign
 }
 
 /** Map used by function make_modular().
- *  Finds every coefficient in a polynomial and replaces it by is value in the
- *  given modular ring R (symmetric representation).
+ *  Finds every coefficient in a polynomial and replaces it by is value modulo
+ *  the given modulus (symmetric representation).
  */
 struct make_modular_map : public map_function {
-	cl_modint_ring R;
-	make_modular_map(const cl_modint_ring& R_) : R(R_) { }
+	cl_I modulus, halfmod;
+	make_modular_map(const cl_I& modulus_) : modulus(modulus_), halfmod(ash(modulus_ - 1, -1)) { }
 	ex operator()(const ex& e)
 	{
 		if ( is_a<add>(e) || is_a<mul>(e) ) {
 			return e.map(*this);
 		}
 		else if ( is_a<numeric>(e) ) {
-			numeric mod(R->modulus);
-			numeric halfmod = (mod-1)/2;
-			cl_MI emod = R->canonhom(the<cl_I>(ex_to<numeric>(e).to_cl_N()));
-			numeric n(R->retract(emod));
+			cl_I n = mod(the<cl_I>(ex_to<numeric>(e).to_cl_N()), modulus);
 			if ( n > halfmod ) {
-				return n-mod;
-			}
-			else {
-				return n;
+				n = n - modulus;
 			}
+			return numeric(n);
 		}
 		return e;
 	}
@@ -1848,17 +3028,72 @@ struct make_modular_map : public map_function {
 
 /** Helps mimicking modular multivariate polynomial arithmetic.
  *
- *  @param e  expression of which to make the coefficients equal to their value
- *            in the modular ring R (symmetric representation)
- *  @param R  modular ring
- *  @return   resulting expression
+ *  @param e         expression of which to make the coefficients equal to
+ *                   their value modulo the modulus (symmetric representation)
+ *  @param modulus   odd modulus
+ *  @param parallel  expand e with expand_options::parallel
+ *  @return          resulting expression
+ */
+static ex make_modular(const ex& e, const cl_I& modulus, bool parallel = false)
+{
+	make_modular_map map(modulus);
+	return map(e.expand(parallel ? expand_options::parallel : 0));
+}
+
+/** Same as make_modular(const ex&, const cl_I&, bool), with the modulus of
+ *  the modular ring R.
+ */
+static ex make_modular(const ex& e, const cl_modint_ring& R, bool parallel = false)
+{
+	return make_modular(e, R->modulus, parallel);
+}
+
+/** Checks whether all numbers in the expressions may be read by several
+ *  threads at once, see numerics_are_immediate().
  */
-static ex make_modular(const ex& e, const cl_modint_ring& R)
+static bool numerics_are_immediate(const vector<ex>& v)
 {
-	make_modular_map map(R);
-	return map(e.expand());
+	for ( size_t i=0; i<v.size(); ++i ) {
+		if ( !numerics_are_immediate(v[i]) ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/** Calls task(i) for i = 0, ..., n-1, in several threads if parallel is true.
+ *  The caller has to make sure that the calls can run at the same time.
+ */
+static void run_tasks(size_t n, parallel_task& task, bool parallel)
+{
+	if ( parallel && parallel_threads(n) > 1 ) {
+		parallel_for(n, task);
+		return;
+	}
+	for ( size_t i=0; i<n; ++i ) {
+		task(i);
+	}
 }
 
+/** Computes the products b_i of all a_j with j != i. Used by
+ *  multivar_diophant().
+ */
+struct cofactor_task : public parallel_task {
+	cofactor_task(const vector<ex>& a_, vector<ex>& b_) : a(a_), b(b_) { }
+	void operator()(size_t i)
+	{
+		ex prod = 1;
+		for ( size_t j=0; j<a.size(); ++j ) {
+			if ( j != i ) {
+				prod *= a[j];
+			}
+		}
+		b[i] = expand(prod);
+	}
+	const vector<ex>& a;
+	vector<ex>& b;
+};
+
 /** Utility function for multivariate Hensel lifting.
  *
  *  Returns the polynomials s_i that fulfill
@@ -1874,10 +3109,11 @@ static ex make_modular(const ex& e, const cl_modint_ring& R)
  *  @param d   maximum total degree of result
  *  @param p   prime number
  *  @param k   p^k is modulus
+ *  @param parallel  compute the b_i in parallel
  *  @return    vector of polynomials (s_i)
  */
 static vector<ex> multivar_diophant(const vector<ex>& a_, const ex& x, const ex& c, const vector<EvalPoint>& I,
-                                    unsigned int d, unsigned int p, unsigned int k)
+                                    unsigned int d, unsigned int p, unsigned int k, bool parallel)
 {
 	vector<ex> a = a_;
 
@@ -1890,14 +3126,13 @@ static vector<ex> multivar_diophant(const vector<ex>& a_, const ex& x, const ex&
 		ex xnu = I.back().x;
 		int alphanu = I.back().evalpoint;
 
-		ex A = 1;
-		for ( size_t i=0; i<r; ++i ) {
-			A *= a[i];
-		}
 		vector<ex> b(r);
-		for ( size_t i=0; i<r; ++i ) {
-			b[i] = normal(A / a[i]);
+		cofactor_task cofactors(a, b);
+		const bool parallel_b = parallel && numerics_are_immediate(a);
+		if ( parallel_b ) {
+			prepare_for_threads(a);
 		}
+		run_tasks(r, cofactors, parallel_b);
 
 		vector<ex> anew = a;
 		for ( size_t i=0; i<r; ++i ) {
@@ -1906,13 +3141,13 @@ static vector<ex> multivar_diophant(const vector<ex>& a_, const ex& x, const ex&
 		ex cnew = c.subs(xnu == alphanu);
 		vector<EvalPoint> Inew = I;
 		Inew.pop_back();
-		sigma = multivar_diophant(anew, x, cnew, Inew, d, p, k);
+		sigma = multivar_diophant(anew, x, cnew, Inew, d, p, k, parallel);
 
 		ex buf = c;
 		for ( size_t i=0; i<r; ++i ) {
 			buf -= sigma[i] * b[i];
 		}
-		ex e = make_modular(buf, R);
+		ex e = make_modular(buf, R, parallel);
 
 		ex monomial = 1;
 		for ( size_t m=1; !e.is_zero() && e.has(xnu) && m<=d; ++m ) {
@@ -1921,14 +3156,14 @@ static vector<ex> multivar_diophant(const vector<ex>& a_, const ex& x, const ex&
 			ex cm = e.diff(ex_to<symbol>(xnu), m).subs(xnu==alphanu) / factorial(m);
 			cm = make_modular(cm, R);
 			if ( !cm.is_zero() ) {
-				vector<ex> delta_s = multivar_diophant(anew, x, cm, Inew, d, p, k);
+				vector<ex> delta_s = multivar_diophant(anew, x, cm, Inew, d, p, k, parallel);
 				ex buf = e;
 				for ( size_t j=0; j<delta_s.size(); ++j ) {
 					delta_s[j] *= monomial;
 					sigma[j] += delta_s[j];
 					buf -= delta_s[j] * b[j];
 				}
-				e = make_modular(buf, R);
+				e = make_modular(buf, R, parallel);
 			}
 		}
 	}
@@ -1941,6 +3176,8 @@ static vector<ex> multivar_diophant(const vector<ex>& a_, const ex& x, const ex&
 		}
 
 		sigma.insert(sigma.begin(), r, 0);
+		// the solutions for the terms of c only differ by a power of x
+		const upvec s = univar_diophant_basis(amod, x, p, k);
 		size_t nterms;
 		ex z;
 		if ( is_a<add>(c) ) {
@@ -1954,7 +3191,7 @@ static vector<ex> multivar_diophant(const vector<ex>& a_, const ex& x, const ex&
 		for ( size_t i=0; i<nterms; ++i ) {
 			int m = z.degree(x);
 			cl_I cm = the<cl_I>(ex_to<numeric>(z.lcoeff(x)).to_cl_N());
-			upvec delta_s = univar_diophant(amod, x, m, p, k);
+			upvec delta_s = univar_diophant(amod, s, m, R);
 			cl_MI modcm;
 			cl_I poscm = cm;
 			while ( poscm < 0 ) {
@@ -1978,6 +3215,22 @@ static vector<ex> multivar_diophant(const vector<ex>& a_, const ex& x, const ex&
 	return sigma;
 }
 
+/** Adds the corrections deltaU_i*monomial to the factors U_i, modulo the
+ *  given modulus. Used by hensel_multivar().
+ */
+struct lift_factors_task : public parallel_task {
+	lift_factors_task(vector<ex>& U_, const vector<ex>& deltaU_, const ex& monomial_, const cl_I& modulus_)
+	 : U(U_), deltaU(deltaU_), monomial(monomial_), modulus(modulus_) { }
+	void operator()(size_t i)
+	{
+		U[i] = make_modular(U[i] + deltaU[i] * monomial, modulus);
+	}
+	vector<ex>& U;
+	const vector<ex>& deltaU;
+	const ex& monomial;
+	const cl_I& modulus;
+};
+
 /** Multivariate Hensel lifting.
  *  The implementation follows the algorithm in chapter 6 of [GCL].
  *  Since we don't have a data type for modular multivariate polynomials, the
@@ -1991,14 +3244,17 @@ static vector<ex> multivar_diophant(const vector<ex>& a_, const ex& x, const ex&
  *  @param l    p^l is the modulus of the lifted univariate field
  *  @param u    vector of modular (mod p^l) factors of a mod I
  *  @param lcU  correct leading coefficient of the univariate factors of a mod I
+ *  @param parallel  run independent parts of the lifting in several threads
  *  @return     list GiNaC::lst with lifted factors (multivariate factors of a),
  *              empty if Hensel lifting did not succeed
  */
 static ex hensel_multivar(const ex& a, const ex& x, const vector<EvalPoint>& I,
-                          unsigned int p, const cl_I& l, const upvec& u, const vector<ex>& lcU)
+                          unsigned int p, const cl_I& l, const upvec& u, const vector<ex>& lcU, bool parallel)
 {
 	const size_t nu = I.size() + 1;
 	const cl_modint_ring R = find_modint_ring(expt_pos(cl_I(p),l));
+	// numbers mod p^l can only be shared between threads if they are small
+	const bool parallel_mod = parallel && numerics_are_immediate(numeric(R->modulus));
 
 	vector<ex> A(nu);
 	A[nu-1] = a;
@@ -2040,7 +3296,7 @@ static ex hensel_multivar(const ex& a, const ex& x, const vector<EvalPoint>& I,
 		for ( size_t i=0; i<n; ++i ) {
 			Uprod *= U[i];
 		}
-		ex e = expand(A[j-1] - Uprod);
+		ex e = expand(A[j-1] - Uprod, parallel ? expand_options::parallel : 0);
 
 		vector<EvalPoint> newI;
 		for ( size_t i=1; i<=j-2; ++i ) {
@@ -2051,24 +3307,29 @@ static ex hensel_multivar(const ex& a, const ex& x, const vector<EvalPoint>& I,
 		int alphaj = I[j-2].evalpoint;
 		size_t deg = A[j-1].degree(xj);
 		for ( size_t k=1; k<=deg; ++k ) {
+			check_budget();
 			if ( !e.is_zero() ) {
 				monomial *= (xj - alphaj);
 				monomial = expand(monomial);
 				ex dif = e.diff(ex_to<symbol>(xj), k);
 				ex c = dif.subs(xj==alphaj) / factorial(k);
 				if ( !c.is_zero() ) {
-					vector<ex> deltaU = multivar_diophant(U1, x, c, newI, maxdeg, p, cl_I_to_uint(l));
-					for ( size_t i=0; i<n; ++i ) {
-						deltaU[i] *= monomial;
-						U[i] += deltaU[i];
-						U[i] = make_modular(U[i], R);
+					vector<ex> deltaU = multivar_diophant(U1, x, c, newI, maxdeg, p, cl_I_to_uint(l), parallel);
+					lift_factors_task lift(U, deltaU, monomial, R->modulus);
+					const bool parallel_lift = parallel_mod && numerics_are_immediate(U) &&
+					                           numerics_are_immediate(deltaU) && numerics_are_immediate(monomial);
+					if ( parallel_lift ) {
+						prepare_for_threads(U);
+						prepare_for_threads(deltaU);
+						prepare_for_threads(monomial);
 					}
+					run_tasks(n, lift, parallel_lift);
 					ex Uprod = 1;
 					for ( size_t i=0; i<n; ++i ) {
 						Uprod *= U[i];
 					}
 					e = A[j-1] - Uprod;
-					e = make_modular(e, R);
+					e = make_modular(e, R, parallel);
 				}
 			}
 		}
@@ -2227,7 +3488,36 @@ static void generate_set(const ex& u, const ex& vn, const exset& syms, const lst
 }
 
 // forward declaration
-static ex factor_sqrfree(const ex& poly);
+static ex factor_sqrfree(const ex& poly, bool parallel);
+
+/** An evaluation of a multivariate polynomial tried by factor_multivariate().
+ */
+struct eval_trial {
+	vector<numeric> a;  ///< evaluation points
+	ex u;               ///< evaluated (univariate) polynomial
+	ex ufac;            ///< factorization of u
+	unsigned int prime; ///< prime used for the factorization of u
+	bool done;          ///< whether ufac has been computed
+	eval_trial() : done(false) { }
+};
+
+/** Factorizes the evaluated polynomials of several evaluation trials. An
+ *  irreducible image proves that the polynomial is irreducible, so the
+ *  other trials are then skipped.
+ */
+struct factor_trials_task : public parallel_task {
+	factor_trials_task(vector<eval_trial>& trials_, const ex& x_) : trials(trials_), x(x_) { }
+	void operator()(size_t i)
+	{
+		trials[i].ufac = factor_univariate(trials[i].u, x, trials[i].prime);
+		trials[i].done = true;
+		if ( put_factors_into_lst(trials[i].ufac).nops() <= 2 ) {
+			cancel();
+		}
+	}
+	vector<eval_trial>& trials;
+	const ex& x;
+};
 
 /** Multivariate factorization.
  *  
@@ -2240,11 +3530,15 @@ static ex factor_sqrfree(const ex& poly);
  *  (as defined for a specific variable x). After that the Hensel lifting can be
  *  performed.
  *
- *  @param[in] poly  expanded, square free polynomial
- *  @param[in] syms  contains the symbols in the polynomial
- *  @return          factorized polynomial
+ *  If parallel is true, several evaluation points are tried at once and the
+ *  Hensel lifting runs independent parts in several threads.
+ *
+ *  @param[in] poly      expanded, square free polynomial
+ *  @param[in] syms      contains the symbols in the polynomial
+ *  @param[in] parallel  use several threads
+ *  @return              factorized polynomial
  */
-static ex factor_multivariate(const ex& poly, const exset& syms)
+static ex factor_multivariate(const ex& poly, const exset& syms, bool parallel)
 {
 	exset::const_iterator s;
 	const ex& x = *syms.begin();
@@ -2253,7 +3547,7 @@ static ex factor_multivariate(const ex& poly, const exset& syms)
 	ex unit, cont, pp;
 	poly.unitcontprim(x, unit, cont, pp);
 	if ( !is_a<numeric>(cont) ) {
-		return factor_sqrfree(cont) * factor_sqrfree(pp);
+		return factor_sqrfree(cont, parallel) * factor_sqrfree(pp, parallel);
 	}
 
 	// factor leading coefficient
@@ -2263,7 +3557,7 @@ static ex factor_multivariate(const ex& poly, const exset& syms)
 		vnlst = lst(vn);
 	}
 	else {
-		ex vnfactors = factor(vn);
+		ex vnfactors = factor(vn, parallel ? factor_options::parallel : 0);
 		vnlst = put_factors_into_lst(vnfactors);
 	}
 
@@ -2284,30 +3578,59 @@ static ex factor_multivariate(const ex& poly, const exset& syms)
 		// try several evaluation points to reduce the number of factors
 		while ( trialcount < maxtrials ) {
 
-			// generate a set of valid evaluation points
-			generate_set(pp, vn, syms, ex_to<lst>(vnlst), modulus, u, a);
-
-			ufac = factor_univariate(u, x, prime);
-			ufaclst = put_factors_into_lst(ufac);
-			factor_count = ufaclst.nops()-1;
-			delta = ufaclst.op(0);
-
-			if ( factor_count <= 1 ) {
-				// irreducible
-				return poly;
-			}
-			if ( min_factor_count < 0 ) {
-				// first time here
-				min_factor_count = factor_count;
+			// generate sets of valid evaluation points, in parallel mode as
+			// many as there may be trials left
+			const size_t ntrials = parallel ? parallel_threads(maxtrials - trialcount) : 1;
+			vector<eval_trial> trials(ntrials);
+			bool shareable = true;
+			for ( size_t t=0; t<ntrials; ++t ) {
+				trials[t].a = a;
+				generate_set(pp, vn, syms, ex_to<lst>(vnlst), modulus, trials[t].u, trials[t].a);
+				shareable = shareable && numerics_are_immediate(trials[t].u);
 			}
-			else if ( min_factor_count == factor_count ) {
-				// one less to try
-				++trialcount;
+			factor_trials_task factor_trials(trials, x);
+			const bool factored = ntrials > 1 && shareable;
+			if ( factored ) {
+				prepare_for_threads(x);
+				for ( size_t t=0; t<ntrials; ++t ) {
+					prepare_for_threads(trials[t].u);
+				}
+				parallel_for(ntrials, factor_trials);
 			}
-			else if ( min_factor_count > factor_count ) {
-				// new minimum, reset trial counter
-				min_factor_count = factor_count;
-				trialcount = 0;
+
+			for ( size_t t=0; t<ntrials && trialcount<maxtrials; ++t ) {
+				if ( !factored ) {
+					factor_trials(t);
+				}
+				else if ( !trials[t].done ) {
+					// skipped, another trial is irreducible
+					continue;
+				}
+				a = trials[t].a;
+				u = trials[t].u;
+				ufac = trials[t].ufac;
+				prime = trials[t].prime;
+				ufaclst = put_factors_into_lst(ufac);
+				factor_count = ufaclst.nops()-1;
+				delta = ufaclst.op(0);
+
+				if ( factor_count <= 1 ) {
+					// irreducible
+					return poly;
+				}
+				if ( min_factor_count < 0 ) {
+					// first time here
+					min_factor_count = factor_count;
+				}
+				else if ( min_factor_count == factor_count ) {
+					// one less to try
+					++trialcount;
+				}
+				else if ( min_factor_count > factor_count ) {
+					// new minimum, reset trial counter
+					min_factor_count = factor_count;
+					trialcount = 0;
+				}
 			}
 		}
 
@@ -2433,7 +3756,7 @@ static ex factor_multivariate(const ex& poly, const exset& syms)
 		}
 
 		// try Hensel lifting
-		ex res = hensel_multivar(pp, x, epv, prime, l, modfactors, C);
+		ex res = hensel_multivar(pp, x, epv, prime, l, modfactors, C, parallel);
 		if ( res != lst() ) {
 			ex result = cont * unit;
 			for ( size_t i=0; i<res.nops(); ++i ) {
@@ -2462,7 +3785,7 @@ struct find_symbols_map : public map_function {
 /** Factorizes a polynomial that is square free. It calls either the univariate
  *  or the multivariate factorization functions.
  */
-static ex factor_sqrfree(const ex& poly)
+static ex factor_sqrfree(const ex& poly, bool parallel)
 {
 	// determine all symbols in poly
 	find_symbols_map findsymbols;
@@ -2477,17 +3800,17 @@ static ex factor_sqrfree(const ex& poly)
 		if ( poly.ldegree(x) > 0 ) {
 			// pull out direct factors
 			int ld = poly.ldegree(x);
-			ex res = factor_univariate(expand(poly/pow(x, ld)), x);
+			ex res = factor_univariate(expand(poly/pow(x, ld)), x, parallel);
 			return res * pow(x,ld);
 		}
 		else {
-			ex res = factor_univariate(poly, x);
+			ex res = factor_univariate(poly, x, parallel);
 			return res;
 		}
 	}
 
 	// multivariate case
-	ex res = factor_multivariate(poly, findsymbols.syms);
+	ex res = factor_multivariate(poly, findsymbols.syms, parallel);
 	return res;
 }
 
@@ -2528,6 +3851,9 @@ struct apply_factor_map : public map_function {
  */
 ex factor(const ex& poly, unsigned options)
 {
+	trace_scope timer("factor");
+	numeric_alloc_scope scope;
+
 	// check arguments
 	if ( !poly.info(info_flags::polynomial) ) {
 		if ( options & factor_options::all ) {
@@ -2550,6 +3876,8 @@ ex factor(const ex& poly, unsigned options)
 		syms.append(*i);
 	}
 
+	const bool parallel = options & factor_options::parallel;
+
 	// make poly square free
 	ex sfpoly = sqrfree(poly.expand(), syms);
 
@@ -2561,7 +3889,7 @@ ex factor(const ex& poly, unsigned options)
 			// simple case: (monomial)^exponent
 			return sfpoly;
 		}
-		ex f = factor_sqrfree(base);
+		ex f = factor_sqrfree(base, parallel);
 		return pow(f, sfpoly.op(1));
 	}
 	if ( is_a<mul>(sfpoly) ) {
@@ -2575,12 +3903,12 @@ ex factor(const ex& poly, unsigned options)
 					res *= t;
 				}
 				else {
-					ex f = factor_sqrfree(base);
+					ex f = factor_sqrfree(base, parallel);
 					res *= pow(f, t.op(1));
 				}
 			}
 			else if ( is_a<add>(t) ) {
-				ex f = factor_sqrfree(t);
+				ex f = factor_sqrfree(t, parallel);
 				res *= f;
 			}
 			else {
@@ -2593,7 +3921,7 @@ ex factor(const ex& poly, unsigned options)
 		return poly;
 	}
 	// case: (polynomial)
-	ex f = factor_sqrfree(sfpoly);
+	ex f = factor_sqrfree(sfpoly, parallel);
 	return f;
 }
 
@@ -23,12 +23,41 @@
 #include "fderivative.h"
 #include "operators.h"
 #include "archive.h"
+#include "numeric.h"
 #include "utils.h"
 
 #include <iostream>
+#include <vector>
 
 namespace GiNaC {
 
+/** Cache of derivatives created by the chain rule, and of their numerical
+ *  values. Each derivative has one slot (chosen by its hash value), a new
+ *  one replaces the one stored there. */
+struct fderivative_cache_entry {
+	fderivative_cache_entry() : digits(0), evalf_digits(0) {}
+	ex key;      ///< the unevaluated derivative
+	ex value;    ///< the evaluated one
+	ex evalf_value;
+	long digits; ///< floating point arguments are evaluated with Digits
+	long evalf_digits;
+};
+
+const size_t fderivative_cache_size = 256;
+
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+thread_local std::vector<fderivative_cache_entry> fderivative_cache;
+#else
+std::vector<fderivative_cache_entry> fderivative_cache;
+#endif
+
+static fderivative_cache_entry & fderivative_slot(const basic & d)
+{
+	if (fderivative_cache.empty())
+		fderivative_cache.resize(fderivative_cache_size);
+	return fderivative_cache[d.gethash() % fderivative_cache_size];
+}
+
 GINAC_IMPLEMENT_REGISTERED_CLASS_OPT(fderivative, function,
   print_func<print_context>(&fderivative::do_print).
   print_func<print_csrc>(&fderivative::do_print_csrc).
@@ -59,6 +88,25 @@ fderivative::fderivative(unsigned ser, const paramset & params, std::shared_ptr<
 {
 }
 
+ex fderivative::shared(unsigned ser, const paramset & params, const exvector & args)
+{
+	fderivative d(ser, params, args);
+	fderivative_cache_entry & slot = fderivative_slot(d);
+	if (slot.digits == long(Digits) && ex_to<basic>(slot.key).is_equal(d))
+		return slot.value;
+
+	const ex value = d;  // evaluates d
+	// the evaluation may have replaced the slot (via the derivative
+	// function of the function)
+	fderivative_cache_entry & newslot = fderivative_slot(d);
+	newslot.key = d.hold();
+	newslot.value = value;
+	newslot.evalf_value = ex();
+	newslot.digits = Digits;
+	newslot.evalf_digits = 0;
+	return value;
+}
+
 //////////
 // archiving
 //////////
@@ -161,7 +209,20 @@ ex fderivative::eval(int level) const
  *  @see basic::evalf */
 ex fderivative::evalf(int level) const
 {
-	return basic::evalf(level);
+	if (level != 0)
+		return basic::evalf(level);
+
+	fderivative_cache_entry & slot = fderivative_slot(*this);
+	if (slot.evalf_digits == long(Digits) && ex_to<basic>(slot.key).is_equal(*this))
+		return slot.evalf_value;
+
+	const ex value = basic::evalf(level);
+	fderivative_cache_entry & newslot = fderivative_slot(*this);
+	if (ex_to<basic>(newslot.key).is_equal(*this)) {
+		newslot.evalf_value = value;
+		newslot.evalf_digits = Digits;
+	}
+	return value;
 }
 
 /** The series expansion of derivatives falls back to Taylor expansion.
@@ -191,7 +252,7 @@ ex fderivative::derivative(const symbol & s) const
 		if (!arg_diff.is_zero()) {
 			paramset ps = parameter_set;
 			ps.insert(i);
-			result += arg_diff * fderivative(serial, ps, seq);
+			result += arg_diff * shared(serial, ps, seq);
 		}
 	}
 	return result;
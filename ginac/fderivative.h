@@ -57,6 +57,12 @@ public:
 	// internal constructors
 	fderivative(unsigned ser, const paramset & params, std::shared_ptr<exvector> vp);
 
+	/** Evaluated derivative with respect to multiple parameters. Equal
+	 *  derivatives created by repeated applications of the chain rule
+	 *  share one object, and the evaluation (which may call the derivative
+	 *  function of the function) is done only once. */
+	static ex shared(unsigned ser, const paramset & params, const exvector & args);
+
 	// functions overriding virtual functions from base classes
 public:
 	void print(const print_context & c, unsigned level = 0) const;
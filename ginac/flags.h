@@ -31,7 +31,8 @@ public:
 	enum {
 		expand_indexed = 0x0001,      ///< expands (a+b).i to a.i+b.i
 		expand_function_args = 0x0002, ///< expands the arguments of functions
-		expand_rename_idx = 0x0004 ///< used internally by mul::expand()
+		expand_rename_idx = 0x0004, ///< used internally by mul::expand()
+		parallel = 0x0008 ///< multiply out large products using several threads (needs GINAC_THREAD_SAFE_REFCOUNT)
 	};
 };
 
@@ -57,7 +58,8 @@ public:
 		// To indicate that we want to substitue an index by something that is
 		// is not an index. Without this flag the index value would be
 		// substituted in that case.
-		really_subs_idx = 0x0020
+		really_subs_idx = 0x0020,
+		keys_are_symbols = 0x0040        ///< used internally by subs()
 	};
 };
 
@@ -79,7 +81,10 @@ public:
 		 *  themselves as step functions, if this option is not passed.  If
 		 *  it is passed and expansion at a point on a cut is performed, then
 		 *  the analytic continuation of the function is expanded. */
-		suppress_branchcut = 0x0001
+		suppress_branchcut = 0x0001,
+		/** Expand the terms of large sums using several threads (needs
+		 *  GINAC_THREAD_SAFE_REFCOUNT). */
+		parallel = 0x0002
 	};
 };
 
@@ -132,7 +137,30 @@ public:
 		 *  division.  The determinant can then be read of from the lower
 		 *  right entry.  This algorithm is rarely fast for computing
 		 *  determinants. */
-		bareiss
+		bareiss,
+		/** Multimodular elimination.  For matrices of rational numbers
+		 *  only: the determinant is computed modulo word-sized primes and
+		 *  reconstructed by Chinese remaindering once the product of the
+		 *  primes exceeds twice the Hadamard bound.  There is no growth of
+		 *  intermediate numbers, which makes it the fastest algorithm for
+		 *  larger exact matrices.  Other matrices are handled by Bareiss
+		 *  elimination. */
+		modular,
+		/** Evaluation and interpolation.  For matrices of polynomials with
+		 *  rational coefficients only: the symbols are set to the points
+		 *  of a grid which is large enough for the degrees of the
+		 *  determinant, the determinants at these points are computed
+		 *  modulo word-sized primes, and the polynomial is found by Newton
+		 *  interpolation and Chinese remaindering.  The number of points
+		 *  grows with the product of the degrees, so this is for
+		 *  polynomials in a few symbols, where it avoids all expression
+		 *  swell.  Other matrices are handled as with modular. */
+		interpolation,
+		/** May be or'ed to gauss or bareiss: the rows of every elimination
+		 *  step are updated by several threads (needs
+		 *  GINAC_THREAD_SAFE_REFCOUNT).  Steps where the matrix contains
+		 *  numbers other than small integers run in one thread. */
+		parallel = 0x0100
 	};
 };
 
@@ -181,7 +209,50 @@ public:
 		 *  linear systems.  In contrast to division-free elimination it only
 		 *  has a linear expression swell.  For two-dimensional systems, the
 		 *  two algorithms are equivalent, however. */
-		bareiss
+		bareiss,
+		/** Multimodular elimination.  For square systems of rational
+		 *  numbers only: the system is solved modulo word-sized primes and
+		 *  the solution is found by rational reconstruction from the
+		 *  Chinese remainder of the images.  Singular and other systems
+		 *  are handled by Gauss or Bareiss elimination. */
+		modular,
+		/** Sparse Gauss elimination.  The system is stored in a
+		 *  sparse_matrix, the pivots are chosen by the Markowitz criterion
+		 *  to keep the fill-in small, and only the entries which change
+		 *  are normalized.  This is the algorithm for large systems where
+		 *  most of the coefficients vanish. */
+		sparse,
+		/** May be or'ed to gauss or bareiss, as with
+		 *  determinant_algo::parallel. */
+		parallel = 0x0100
+	};
+};
+
+/** Switch to control algorithm for numerical integration.
+ *  @see integral::integration_method */
+class integration_algo {
+public:
+	enum {
+		/** Let the system choose.  Gauss-Kronrod quadrature is used up to
+		 *  50 digits, tanh-sinh quadrature above. */
+		automatic,
+		/** Adaptive Simpson rule.  The interval is halved until the
+		 *  Simpson estimates of the halves agree with the one of the
+		 *  whole.  Needs many evaluations of the integrand for high
+		 *  accuracy. */
+		adaptive_simpson,
+		/** Globally adaptive 7-point Gauss, 15-point Kronrod quadrature.
+		 *  The subinterval with the largest error estimate is bisected
+		 *  until the sum of the estimates is small enough.  Good for smooth
+		 *  integrands and moderate precision; the nodes are tabulated to 60
+		 *  digits. */
+		gauss_kronrod,
+		/** Tanh-sinh (double exponential) quadrature.  The step size of
+		 *  the transformed trapezoidal rule is halved until two estimates
+		 *  agree.  The number of correct digits roughly doubles with every
+		 *  level, also for integrands with singularities at the end points,
+		 *  which makes it the method of choice for high precision. */
+		tanh_sinh
 	};
 };
 
@@ -196,7 +267,16 @@ public:
 		hash_calculated = 0x0008, ///< .calchash() has already done its job
 		not_shareable   = 0x0010, ///< don't share instances of this object between different expressions unless explicitly asked to (used by ex::compare())
 		has_indices	= 0x0020,
-		has_no_indices	= 0x0040  // ! (has_indices || has_no_indices) means "don't know"
+		has_no_indices	= 0x0040, // ! (has_indices || has_no_indices) means "don't know"
+		hash_consed     = 0x0080, ///< object is registered in the hash-consing table (@see set_hash_consing())
+		symbols_calculated = 0x0100, ///< .calc_symbol_mask() has already done its job
+		metrics_calculated = 0x0200, ///< .calc_metrics() has already done its job
+		accounted       = 0x0400, ///< object is counted by the memory accounting (@see set_memory_accounting_enabled())
+		conjugate_invariant = 0x0800, ///< .conjugate() returned the object itself
+		known_real      = 0x1000, ///< .real_part() returned the object itself, or .imag_part() returned zero
+		expanded_indexed = 0x2000, ///< .expand(expand_options::expand_indexed) has already done its job
+		expanded_function_args = 0x4000, ///< .expand(expand_options::expand_function_args) has already done its job
+		expanded_indexed_function_args = 0x8000 ///< .expand() with both of these options has already done its job
 	};
 };
 
@@ -277,7 +357,24 @@ public:
 		delete_never,   ///< Let table grow undefinitely
 		delete_lru,     ///< Least recently used
 		delete_lfu,     ///< Least frequently used
-		delete_cyclic   ///< First (oldest) one in list
+		delete_cyclic,  ///< First (oldest) one in list
+		delete_clock    ///< Oldest one not used since it was last passed (second chance)
+	};
+};
+
+/** Flags to control the computation of Dirac traces. */
+class dirac_trace_options {
+public:
+	enum {
+		parallel = 0x0001  ///< split the traces of long strings of gammas over several threads (needs GINAC_THREAD_SAFE_REFCOUNT)
+	};
+};
+
+/** Flags to control the behavior of simplify_indexed(). */
+class simplify_indexed_options {
+public:
+	enum {
+		parallel = 0x0001  ///< simplify the terms of large sums using several threads (needs GINAC_THREAD_SAFE_REFCOUNT)
 	};
 };
 
@@ -286,7 +383,8 @@ class factor_options {
 public:
 	enum {
 		polynomial = 0x0000, ///< factor only expressions that are polynomials
-		all        = 0x0001  ///< factor all polynomial subexpressions
+		all        = 0x0001, ///< factor all polynomial subexpressions
+		parallel   = 0x0002  ///< factor multivariate polynomials using several threads (needs GINAC_THREAD_SAFE_REFCOUNT)
 	};
 };
 
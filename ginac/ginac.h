@@ -37,12 +37,15 @@
 #include "integral.h"
 #include "lst.h"
 #include "matrix.h"
+#include "sparse_matrix.h"
 #include "numeric.h"
 #include "power.h"
 #include "relational.h"
 #include "structure.h"
 #include "symbol.h"
 #include "pseries.h"
+#include "lazy_series.h"
+#include "mseries.h"
 #include "wildcard.h"
 #include "symmetry.h"
 
@@ -50,6 +53,9 @@
 #include "expairseq.h"
 #include "add.h"
 #include "mul.h"
+#include "builder.h"
+#include "out_of_core.h"
+#include "distributed.h"
 
 #include "exprseq.h"
 #include "function.h"
@@ -59,16 +65,30 @@
 #include "fderivative.h"
 #include "operators.h"
 #include "hash_map.h"
+#include "rule_set.h"
 
 #include "idx.h"
 #include "indexed.h"
 #include "tensor.h"
 #include "color.h"
 #include "clifford.h"
+#include "component_array.h"
 
 #include "factor.h"
+#include "gradient.h"
 
 #include "excompiler.h"
+#include "evalball.h"
+#include "evaldouble.h"
+#include "evalplan.h"
+#include "statistics.h"
+#include "memory_usage.h"
+#include "metrics.h"
+#include "profile.h"
+#include "text_writer.h"
+#include "threads.h"
+#include "budget.h"
+#include "trace.h"
 
 #ifndef IN_GINAC
 #include "parser.h"
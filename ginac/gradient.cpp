@@ -0,0 +1,274 @@
+/** @file gradient.cpp
+ *
+ *  Derivatives with respect to many symbols at once, in reverse mode. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "gradient.h"
+#include "add.h"
+#include "function.h"
+#include "hash_map.h"
+#include "inifcns.h"
+#include "lst.h"
+#include "matrix.h"
+#include "mul.h"
+#include "operators.h"
+#include "power.h"
+#include "symbol.h"
+#include "utils.h"
+
+#include <stdexcept>
+#include <vector>
+
+namespace GiNaC {
+
+namespace {
+
+/** The distinct subexpressions of some expressions which may contain the
+ *  symbols, each with the partial derivatives with respect to its
+ *  operands. Nodes are numbered such that operands come first. */
+class derivative_graph {
+public:
+	derivative_graph(const exvector & roots, const lst & vars);
+
+	/** Derivatives of roots[k] with respect to the symbols. */
+	exvector sweep(size_t k) const;
+
+private:
+	struct edge {
+		edge(size_t t, const ex & p) : to(t), partial(p) {}
+		size_t to;
+		ex partial;
+	};
+
+	struct node {
+		ex e;
+		std::vector<edge> edges;
+		int var;  ///< number of the symbol, or -1
+	};
+
+	bool relevant(const ex & e) const;
+	void local_derivatives(const ex & e, exvector & operands, exvector & partials) const;
+
+	exvector vars;
+	exhashmap<int> var_number;
+	unsigned mask;           ///< symbol mask of all vars
+	std::vector<node> nodes;
+	std::vector<size_t> root_nodes;
+};
+
+derivative_graph::derivative_graph(const exvector & roots, const lst & l) : mask(0)
+{
+	for (lst::const_iterator i = l.begin(); i != l.end(); ++i) {
+		if (!is_a<symbol>(*i))
+			throw std::invalid_argument("gradient(): variables must be symbols");
+		if (var_number.find(*i) == var_number.end())
+			var_number[*i] = vars.size();
+		vars.push_back(*i);
+		mask |= ex_to<basic>(*i).symbol_mask();
+	}
+
+	// Post-order traversal with an explicit stack. The operands and their
+	// partial derivatives of a node are kept on the stack until the node
+	// is numbered after them.
+	struct frame {
+		ex e;
+		exvector operands;
+		exvector partials;
+		bool expanded;
+	};
+	exhashmap<size_t> number;
+	std::vector<frame> stack;
+	for (exvector::const_iterator r = roots.begin(); r != roots.end(); ++r) {
+		if (!relevant(*r)) {
+			root_nodes.push_back(size_t(-1));
+			continue;
+		}
+		stack.push_back(frame());
+		stack.back().e = *r;
+		stack.back().expanded = false;
+		while (!stack.empty()) {
+			if (!stack.back().expanded) {
+				frame & f = stack.back();
+				f.expanded = true;
+				local_derivatives(f.e, f.operands, f.partials);
+				const exvector ops = f.operands;
+				for (exvector::const_iterator o = ops.begin(); o != ops.end(); ++o) {
+					if (number.find(*o) == number.end()) {
+						stack.push_back(frame());
+						stack.back().e = *o;
+						stack.back().expanded = false;
+					}
+				}
+				continue;
+			}
+			frame & f = stack.back();
+			if (number.find(f.e) == number.end()) {
+				node n;
+				n.e = f.e;
+				exhashmap<int>::const_iterator v = var_number.find(f.e);
+				n.var = v != var_number.end() ? v->second : -1;
+				for (size_t i = 0; i < f.operands.size(); ++i)
+					n.edges.push_back(edge(number[f.operands[i]], f.partials[i]));
+				number[f.e] = nodes.size();
+				nodes.push_back(n);
+			}
+			stack.pop_back();
+		}
+		root_nodes.push_back(number[*r]);
+	}
+}
+
+/** Whether e may contain one of the symbols. */
+bool derivative_graph::relevant(const ex & e) const
+{
+	return (ex_to<basic>(e).symbol_mask() & mask) != 0;
+}
+
+/** The relevant operands of e, and the partial derivatives of e with
+ *  respect to them. */
+void derivative_graph::local_derivatives(const ex & e, exvector & operands, exvector & partials) const
+{
+	if (is_a<symbol>(e))
+		return;
+
+	if (is_exactly_a<add>(e)) {
+		for (size_t i = 0; i < e.nops(); ++i) {
+			if (relevant(e.op(i))) {
+				operands.push_back(e.op(i));
+				partials.push_back(_ex1);
+			}
+		}
+		return;
+	}
+
+	if (is_exactly_a<mul>(e)) {
+		const size_t num = e.nops();
+		for (size_t i = 0; i < num; ++i) {
+			if (!relevant(e.op(i)))
+				continue;
+			exvector others;
+			others.reserve(num - 1);
+			for (size_t j = 0; j < num; ++j)
+				if (j != i)
+					others.push_back(e.op(j));
+			operands.push_back(e.op(i));
+			partials.push_back((new mul(others))->setflag(status_flags::dynallocated));
+		}
+		return;
+	}
+
+	if (is_exactly_a<power>(e)) {
+		const ex & b = e.op(0);
+		const ex & x = e.op(1);
+		if (relevant(b)) {
+			operands.push_back(b);
+			partials.push_back(x * pow(b, x - _ex1));
+		}
+		if (relevant(x)) {
+			operands.push_back(x);
+			partials.push_back(e * log(b));
+		}
+		return;
+	}
+
+	if (is_exactly_a<function>(e) && ex_to<function>(e).get_serial() != Order_SERIAL::serial) {
+		// Differentiate the function with its arguments replaced by
+		// symbols, and put the arguments back
+		const size_t num = e.nops();
+		exvector args;
+		exmap back;
+		for (size_t i = 0; i < num; ++i) {
+			symbol t;
+			args.push_back(t);
+			back[t] = e.op(i);
+		}
+		const ex g = function(ex_to<function>(e).get_serial(), args);
+		for (size_t i = 0; i < num; ++i) {
+			if (!relevant(e.op(i)))
+				continue;
+			operands.push_back(e.op(i));
+			partials.push_back(g.diff(ex_to<symbol>(args[i])).subs(back, subs_options::no_pattern));
+		}
+		return;
+	}
+
+	// Anything else is differentiated with respect to the symbols directly
+	for (exvector::const_iterator v = vars.begin(); v != vars.end(); ++v) {
+		if (!ex_to<basic>(e).may_contain(*v))
+			continue;
+		const ex d = e.diff(ex_to<symbol>(*v));
+		if (!d.is_zero()) {
+			operands.push_back(*v);
+			partials.push_back(d);
+		}
+	}
+}
+
+exvector derivative_graph::sweep(size_t k) const
+{
+	exvector result(vars.size(), _ex0);
+	if (root_nodes[k] == size_t(-1))
+		return result;
+
+	// Summands of the derivative of roots[k] with respect to each node
+	std::vector<exvector> adjoint(root_nodes[k] + 1);
+	adjoint[root_nodes[k]].push_back(_ex1);
+	for (size_t n = root_nodes[k] + 1; n-- > 0; ) {
+		if (adjoint[n].empty())
+			continue;
+		const ex a = (new add(adjoint[n]))->setflag(status_flags::dynallocated);
+		adjoint[n].clear();
+		if (a.is_zero())
+			continue;
+		const node & nd = nodes[n];
+		if (nd.var >= 0)
+			result[nd.var] = a;
+		for (std::vector<edge>::const_iterator i = nd.edges.begin(); i != nd.edges.end(); ++i)
+			adjoint[i->to].push_back(a * i->partial);
+	}
+	// Symbols listed more than once
+	for (size_t v = 0; v < vars.size(); ++v)
+		result[v] = result[var_number.find(vars[v])->second];
+	return result;
+}
+
+} // anonymous namespace
+
+lst gradient(const ex & e, const lst & vars)
+{
+	const derivative_graph g(exvector(1, e), vars);
+	const exvector d = g.sweep(0);
+	return lst(d.begin(), d.end());
+}
+
+matrix jacobian(const lst & f, const lst & vars)
+{
+	const exvector roots(f.begin(), f.end());
+	const derivative_graph g(roots, vars);
+	matrix m(roots.size(), vars.nops());
+	for (size_t k = 0; k < roots.size(); ++k) {
+		const exvector d = g.sweep(k);
+		for (size_t v = 0; v < d.size(); ++v)
+			m(k, v) = d[v];
+	}
+	return m;
+}
+
+} // namespace GiNaC
@@ -0,0 +1,50 @@
+/** @file gradient.h
+ *
+ *  Interface to derivatives with respect to many symbols at once. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_GRADIENT_H
+#define GINAC_GRADIENT_H
+
+#include "ex.h"
+#include "lst.h"
+
+namespace GiNaC {
+
+class matrix;
+
+/** Partial derivatives of e with respect to each of the symbols in vars,
+ *  in this order. They are found in reverse mode: the derivatives of e
+ *  with respect to its distinct subexpressions are propagated once from
+ *  e down to the symbols, instead of differentiating e once for every
+ *  symbol. The results equal e.diff(s), but need not have the same form.
+ *
+ *  @exception invalid_argument (vars holds something else than symbols) */
+lst gradient(const ex & e, const lst & vars);
+
+/** Jacobian matrix of the expressions in f: row i is the gradient of the
+ *  i-th one. The subexpressions they share are analyzed only once.
+ *
+ *  @exception invalid_argument (vars holds something else than symbols) */
+matrix jacobian(const lst & f, const lst & vars);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_GRADIENT_H
@@ -1,6 +1,6 @@
 /** @file hash_map.h
  *
- *  Replacement for map<> using hash tables. */
+ *  Replacements for map<> and set<> using hash tables. */
 
 /*
  *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
@@ -23,17 +23,22 @@
 #ifndef GINAC_HASH_MAP_H
 #define GINAC_HASH_MAP_H
 
+#include "ex.h"
+
 #include <algorithm>
+#include <cstddef>
 #include <functional>
 #include <iterator>
 #include <list>
 #include <utility>
+#include <vector>
 
 namespace GiNaC {
 
 /*
- *  "Hashmap Light" - buckets only contain one value, quadratic probing,
- *  grows automatically
+ *  "Hashmap Light" - buckets only contain one value and the hash value of
+ *  its key, open addressing with triangular probing in a table whose size
+ *  is a power of two (which visits every bucket), grows automatically
  */
 
 namespace internal {
@@ -59,6 +64,27 @@ inline unsigned long next_prime(unsigned long n)
 	return pos == last ? *(last - 1) : *pos;
 }
 
+/** Smallest power of two which is at least n. */
+inline std::size_t next_power_of_two(std::size_t n)
+{
+	std::size_t p = 1;
+	while (p < n)
+		p <<= 1;
+	return p;
+}
+
+/** Start of the probing sequence of hash value h in a table of mask+1
+ *  buckets. The upper bits are folded in, since the low bits of hash values
+ *  of similar expressions are often alike. */
+inline std::size_t hash_slot(hash_t h, std::size_t mask)
+{
+	std::size_t x = std::size_t(h);
+	x ^= x >> 15;
+	x *= 0x2c1b3c6dU;
+	x ^= x >> 12;
+	return x & mask;
+}
+
 } // namespace internal
 
 
@@ -77,11 +103,15 @@ class exhashmap;
  *   - comparison functor is hardcoded to ex_is_less
  *   - bucket_count() returns the number of buckets allocated in the hash table
  *   - insert() and erase() invalidate all iterators
- *   - average complexity of find() is constant time, worst case is O(n) */
+ *   - average complexity of find() is constant time, worst case is O(n)
+ *
+ *  The hash value of each key is stored with it, so that probing compares
+ *  keys only if their hash values are equal and growing the table doesn't
+ *  touch the keys. */
 template <typename T, template <class> class A>
 class exhashmap {
 public:
-	static const unsigned min_num_buckets = 31; // must be prime
+	static const unsigned min_num_buckets = 32; // must be a power of two
 
 	// Standard types
 	typedef ex key_type;
@@ -101,7 +131,12 @@ protected:
 		USED,   ///< bucket in use
 		ERASED  ///< bucket empty (element deleted), but may be part of a search chain
 	};
-	typedef std::pair<bucket_state, value_type> Bucket;
+	struct Bucket {
+		Bucket() : first(EMPTY), hash(0) {}
+		bucket_state first; ///< state of the bucket
+		value_type second;  ///< key and value
+		hash_t hash;        ///< hash value of the key, if used
+	};
 
 public:
 	// More standard types
@@ -214,57 +249,48 @@ public:
 protected:
 	// Private data
 	size_type num_entries; ///< Number of values stored in container (cached for faster operation of size())
+	size_type num_erased;  ///< Number of ERASED buckets
 	size_type num_buckets; ///< Number of buckets (= hashtab.size())
 	Table hashtab;         ///< Vector of buckets, each bucket is kept sorted
 
-	/** Return index of key in hash table. */
-	static size_type hash_index(const key_type &x, size_type nbuckets)
-	{
-		return x.gethash() % nbuckets;
-	}
-
-	static table_iterator find_bucket(const key_type &x, table_iterator tab, size_type nbuckets);
-	static table_const_iterator find_bucket(const key_type &x, table_const_iterator tab, size_type nbuckets);
-	static table_iterator find_bucket_for_insertion(const key_type &x, table_iterator tab, size_type nbuckets);
+	static table_iterator find_bucket(const key_type &x, hash_t h, table_iterator tab, size_type nbuckets);
+	static table_const_iterator find_bucket(const key_type &x, hash_t h, table_const_iterator tab, size_type nbuckets);
 
 	/** Return pointer to bucket corresponding to key (or first empty bucket). */
 	table_iterator find_bucket(const key_type &x)
 	{
-		return find_bucket(x, hashtab.begin(), num_buckets);
+		return find_bucket(x, x.gethash(), hashtab.begin(), num_buckets);
 	}
 
 	/** Return pointer to bucket corresponding to key (or first empty bucket). */
 	table_const_iterator find_bucket(const key_type &x) const
 	{
-		return find_bucket(x, hashtab.begin(), num_buckets);
+		return find_bucket(x, x.gethash(), hashtab.begin(), num_buckets);
 	}
 
-	/** Return pointer to bucket corresponding to key (or first empty or erased bucket). */
-	table_iterator find_bucket_for_insertion(const key_type &x)
-	{
-		return find_bucket_for_insertion(x, hashtab.begin(), num_buckets);
-	}
+	table_iterator find_bucket_for_insertion(const key_type &x, hash_t h);
 
-	/** Return number of entries above which the table will grow. */
+	/** Return number of used and erased buckets above which the table
+	 *  will be rebuilt. */
 	size_type hwm() const
 	{
 		// Try to keep at least 25% of the buckets free
 		return num_buckets - (num_buckets >> 2);
 	}
 
-	void grow();
+	void rehash(size_type new_num_buckets);
 
 public:
 	// 23.3.1.1 Construct/copy/destroy
 	exhashmap()
-	 : num_entries(0), num_buckets(min_num_buckets), hashtab(num_buckets, std::make_pair(EMPTY, std::make_pair(0, mapped_type()))) {}
+	 : num_entries(0), num_erased(0), num_buckets(min_num_buckets), hashtab(num_buckets) {}
 
 	explicit exhashmap(size_type nbuckets)
-	 : num_entries(0), num_buckets(internal::next_prime(nbuckets)), hashtab(num_buckets, std::make_pair(EMPTY, std::make_pair(0, mapped_type()))) {}
+	 : num_entries(0), num_erased(0), num_buckets(internal::next_power_of_two(std::max(nbuckets, size_type(min_num_buckets)))), hashtab(num_buckets) {}
 
 	template <class InputIterator>
 	exhashmap(InputIterator first, InputIterator last)
-	 : num_entries(0), num_buckets(min_num_buckets), hashtab(num_buckets, std::make_pair(EMPTY, std::make_pair(0, mapped_type())))
+	 : num_entries(0), num_erased(0), num_buckets(min_num_buckets), hashtab(num_buckets)
 	{
 		insert(first, last);
 	}
@@ -352,6 +378,7 @@ public:
 		bucket->first = ERASED;
 		bucket->second.first = 0;
 		--num_entries;
+		++num_erased;
 	}
 
 	size_type erase(const key_type &x);
@@ -361,6 +388,7 @@ public:
 		hashtab.swap(other.hashtab);
 		std::swap(num_buckets, other.num_buckets);
 		std::swap(num_entries, other.num_entries);
+		std::swap(num_erased, other.num_erased);
 	}
 
 	void clear();
@@ -409,7 +437,7 @@ public:
 
 	friend bool operator==(const exhashmap &lhs, const exhashmap &rhs)
 	{
-		if (lhs.num_entries != rhs.num_entries || lhs.num_buckets != rhs.num_buckets)
+		if (lhs.num_entries != rhs.num_entries)
 			return false;
 
 		// We can't compare the tables directly as the elements may be
@@ -444,92 +472,112 @@ public:
 #endif
 };
 
-/** Return pointer to bucket corresponding to key (or first empty bucket). */
+/** Return pointer to bucket corresponding to key with hash value h (or first
+ *  empty bucket). */
 template <typename T, template <class> class A>
-inline typename exhashmap<T, A>::table_iterator exhashmap<T, A>::find_bucket(const key_type &x, table_iterator tab, size_type nbuckets)
+inline typename exhashmap<T, A>::table_iterator exhashmap<T, A>::find_bucket(const key_type &x, hash_t h, table_iterator tab, size_type nbuckets)
 {
-	// Quadratic probing
-	size_type h = hash_index(x, nbuckets);
+	// Triangular probing
+	const size_type mask = nbuckets - 1;
+	size_type i = internal::hash_slot(h, mask);
 	size_type d = 1;
-	table_iterator it = tab + h;
-	while (it->first != EMPTY && !(it->first == USED && key_equal()(it->second.first, x))) {
-		h = (h + d) % nbuckets;
-		d += 2;
-		it = tab + h;
+	table_iterator it = tab + i;
+	while (it->first != EMPTY && !(it->first == USED && it->hash == h && key_equal()(it->second.first, x))) {
+		i = (i + d++) & mask;
+		it = tab + i;
 	}
 	return it;
 }
 
-/** Return pointer to bucket corresponding to key (or first empty bucket). */
+/** Return pointer to bucket corresponding to key with hash value h (or first
+ *  empty bucket). */
 template <typename T, template <class> class A>
-inline typename exhashmap<T, A>::table_const_iterator exhashmap<T, A>::find_bucket(const key_type &x, table_const_iterator tab, size_type nbuckets)
+inline typename exhashmap<T, A>::table_const_iterator exhashmap<T, A>::find_bucket(const key_type &x, hash_t h, table_const_iterator tab, size_type nbuckets)
 {
-	// Quadratic probing
-	size_type h = hash_index(x, nbuckets);
+	// Triangular probing
+	const size_type mask = nbuckets - 1;
+	size_type i = internal::hash_slot(h, mask);
 	size_type d = 1;
-	table_const_iterator it = tab + h;
-	while (it->first != EMPTY && !(it->first == USED && key_equal()(it->second.first, x))) {
-		h = (h + d) % nbuckets;
-		d += 2;
-		it = tab + h;
+	table_const_iterator it = tab + i;
+	while (it->first != EMPTY && !(it->first == USED && it->hash == h && key_equal()(it->second.first, x))) {
+		i = (i + d++) & mask;
+		it = tab + i;
 	}
 	return it;
 }
 
-/** Return pointer to bucket corresponding to key (or first empty or erased bucket). */
+/** Return pointer to bucket corresponding to key with hash value h (or the
+ *  first erased bucket on its search chain, or the empty bucket ending it). */
 template <typename T, template <class> class A>
-inline typename exhashmap<T, A>::table_iterator exhashmap<T, A>::find_bucket_for_insertion(const key_type &x, table_iterator tab, size_type nbuckets)
+inline typename exhashmap<T, A>::table_iterator exhashmap<T, A>::find_bucket_for_insertion(const key_type &x, hash_t h)
 {
-	// Quadratic probing
-	size_type h = hash_index(x, nbuckets);
+	// Triangular probing
+	const size_type mask = num_buckets - 1;
+	size_type i = internal::hash_slot(h, mask);
 	size_type d = 1;
-	table_iterator it = tab + h;
-	while (it->first != EMPTY && !key_equal()(it->second.first, x)) {
-		h = (h + d) % nbuckets;
-		d += 2;
-		it = tab + h;
-	}
-	return it;
+	table_iterator it = hashtab.begin() + i;
+	table_iterator erased = hashtab.end();
+	while (it->first != EMPTY) {
+		if (it->first == USED) {
+			if (it->hash == h && key_equal()(it->second.first, x))
+				return it;
+		} else if (erased == hashtab.end())
+			erased = it;
+		i = (i + d++) & mask;
+		it = hashtab.begin() + i;
+	}
+	return erased == hashtab.end() ? it : erased;
 }
 
-/** Grow hash table */
+/** Rebuild the hash table with new_num_buckets buckets, dropping the erased
+ *  ones. */
 template <typename T, template <class> class A>
-void exhashmap<T, A>::grow()
+void exhashmap<T, A>::rehash(size_type new_num_buckets)
 {
 	// Allocate new empty hash table
-	size_type new_num_buckets = internal::next_prime(num_buckets + 1);
-	Table new_hashtab;
-	new_hashtab.resize(new_num_buckets);
-	for (table_iterator it = new_hashtab.begin(); it != new_hashtab.end(); ++it)
-		it->first = EMPTY;
-
-	// Re-insert all elements into new table
-	for (table_const_iterator it = hashtab.begin(); it != hashtab.end(); ++it) {
+	Table new_hashtab(new_num_buckets);
+
+	// Re-insert all elements into new table, by their stored hash values
+	for (table_iterator it = hashtab.begin(); it != hashtab.end(); ++it) {
 		if (it->first == USED) {
-			table_iterator bucket = find_bucket(it->second.first, new_hashtab.begin(), new_num_buckets);
-			*bucket = *it;
+			const size_type mask = new_num_buckets - 1;
+			size_type i = internal::hash_slot(it->hash, mask);
+			size_type d = 1;
+			while (new_hashtab[i].first != EMPTY)
+				i = (i + d++) & mask;
+			Bucket & b = new_hashtab[i];
+			b.first = USED;
+			b.hash = it->hash;
+			b.second.first.swap(it->second.first);
+			std::swap(b.second.second, it->second.second);
 		}
 	}
 
 	// Swap with the old table
 	hashtab.swap(new_hashtab);
 	num_buckets = new_num_buckets;
+	num_erased = 0;
 }
 
 template <typename T, template <class> class A>
 std::pair<typename exhashmap<T, A>::iterator, bool> exhashmap<T, A>::insert(const value_type &x)
 {
-	table_iterator bucket = find_bucket_for_insertion(x.first);
+	const hash_t h = x.first.gethash();
+	table_iterator bucket = find_bucket_for_insertion(x.first, h);
 	if (bucket->first == USED) {
 		// Value already in map
 		return std::make_pair(iterator(bucket, hashtab.end()), false);
 	} else {
 		// Insert new value
+		if (bucket->first == ERASED)
+			--num_erased;
 		bucket->first = USED;
+		bucket->hash = h;
 		bucket->second = x;
 		++num_entries;
-		if (num_entries >= hwm()) {
-			grow();
+		if (num_entries + num_erased >= hwm()) {
+			// Grow the table, unless it is mostly filled by erased buckets
+			rehash(num_entries >= hwm() / 2 ? 2 * num_buckets : num_buckets);
 			bucket = find_bucket(x.first);
 		}
 		return std::make_pair(iterator(bucket, hashtab.end()), true);
@@ -576,8 +624,78 @@ void exhashmap<T, A>::clear()
 		i->second.second = mapped_type();
 	}
 	num_entries = 0;
+	num_erased = 0;
 }
 
+
+/** Associative Container of 'ex' objects, implemented with the hash table of
+ *  exhashmap, which can be used as a replacement for exset when the order of
+ *  the elements doesn't matter. The same differences as for exhashmap
+ *  apply, in particular insert() and erase() invalidate all iterators. */
+class exhashset {
+	typedef exhashmap<bool> Map;
+
+public:
+	typedef ex key_type;
+	typedef ex value_type;
+	typedef Map::size_type size_type;
+	typedef Map::difference_type difference_type;
+
+	class const_iterator : public std::iterator<std::forward_iterator_tag, ex, difference_type, const ex *, const ex &> {
+		friend class exhashset;
+	public:
+		const_iterator() {}
+		const ex & operator*() const { return it->first; }
+		const ex * operator->() const { return &it->first; }
+		const_iterator & operator++() { ++it; return *this; }
+		const_iterator operator++(int) { const_iterator tmp = *this; ++it; return tmp; }
+		bool operator==(const const_iterator & other) const { return it == other.it; }
+		bool operator!=(const const_iterator & other) const { return it != other.it; }
+	private:
+		explicit const_iterator(Map::const_iterator i) : it(i) {}
+		Map::const_iterator it;
+	};
+	typedef const_iterator iterator;
+
+	exhashset() {}
+	explicit exhashset(size_type nbuckets) : m(nbuckets) {}
+	template <class InputIterator>
+	exhashset(InputIterator first, InputIterator last) { insert(first, last); }
+
+	const_iterator begin() const { return const_iterator(m.begin()); }
+	const_iterator end() const { return const_iterator(m.end()); }
+
+	bool empty() const { return m.empty(); }
+	size_type size() const { return m.size(); }
+	size_type bucket_count() const { return m.bucket_count(); }
+
+	std::pair<const_iterator, bool> insert(const ex & x)
+	{
+		std::pair<Map::iterator, bool> r = m.insert(Map::value_type(x, true));
+		return std::make_pair(const_iterator(r.first), r.second);
+	}
+
+	template <class InputIterator>
+	void insert(InputIterator first, InputIterator last)
+	{
+		for (; first != last; ++first)
+			insert(*first);
+	}
+
+	size_type erase(const ex & x) { return m.erase(x); }
+	void swap(exhashset & other) { m.swap(other.m); }
+	void clear() { m.clear(); }
+
+	const_iterator find(const ex & x) const { return const_iterator(m.find(x)); }
+	size_type count(const ex & x) const { return m.count(x); }
+
+	friend bool operator==(const exhashset & lhs, const exhashset & rhs) { return lhs.m == rhs.m; }
+	friend bool operator!=(const exhashset & lhs, const exhashset & rhs) { return lhs.m != rhs.m; }
+
+private:
+	Map m;
+};
+
 } // namespace GiNaC
 
 
@@ -591,6 +709,12 @@ inline void swap(GiNaC::exhashmap<T, A> &lhs, GiNaC::exhashmap<T, A> &rhs)
 	lhs.swap(rhs);
 }
 
+/** Specialization of std::swap() for exhashset. */
+inline void swap(GiNaC::exhashset &lhs, GiNaC::exhashset &rhs)
+{
+	lhs.swap(rhs);
+}
+
 } // namespace std
 
 #endif // ndef GINAC_HASH_MAP_H
@@ -24,16 +24,16 @@
 namespace GiNaC
 {
 #ifndef GINAC_HASH_USE_MANGLED_NAME
-static inline unsigned make_hash_seed(const std::type_info& tinfo)
+static inline hash_t make_hash_seed(const std::type_info& tinfo)
 {
 	// this pointer is the same for all objects of the same type.
 	// Hence we can use that pointer 
 	const void* mangled_name_ptr = (const void*)tinfo.name();
-	unsigned v = golden_ratio_hash((p_int)mangled_name_ptr);
+	hash_t v = golden_ratio_hash((p_int)mangled_name_ptr);
 	return v;
 }
 #else
-static unsigned make_hash_seed(const std::type_info& tinfo)
+static hash_t make_hash_seed(const std::type_info& tinfo)
 {
 	const char* mangled_name = tinfo.name();
 	return crc32(mangled_name, std::strlen(mangled_name), 0);
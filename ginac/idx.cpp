@@ -341,7 +341,7 @@ bool spinidx::match_same_type(const basic & other) const
 	return inherited::match_same_type(other);
 }
 
-unsigned idx::calchash() const
+hash_t idx::calchash() const
 {
 	// NOTE: The code in simplify_indexed() assumes that canonically
 	// ordered sequences of indices have the two members of dummy index
@@ -351,14 +351,12 @@ unsigned idx::calchash() const
 	// hash keys. That is, the hash values must not depend on the index
 	// dimensions or other attributes (variance etc.).
 	// The compare_same_type() methods will take care of the rest.
-	unsigned v = make_hash_seed(typeid(*this));
-	v = rotate_left(v);
-	v ^= value.gethash();
+	hash_t v = hash_combine(make_hash_seed(typeid(*this)), value.gethash());
 
 	// Store calculated hash value only if object is already evaluated
 	if (flags & status_flags::evaluated) {
-		setflag(status_flags::hash_calculated);
 		hashvalue = v;
+		setflag(status_flags::hash_calculated);
 	}
 
 	return v;
@@ -36,9 +36,12 @@
 #include "integral.h"
 #include "matrix.h"
 #include "inifcns.h"
+#include "parallel.h"
 
+#include <algorithm>
 #include <iostream>
 #include <limits>
+#include <map>
 #include <sstream>
 #include <stdexcept>
 
@@ -780,8 +783,84 @@ template<class T> ex idx_symmetrization(const ex& r,const exvector& local_dummy_
 	return q;
 }
 
+/** Positions of the indexed factors of a product by the values of their
+ *  indices, so that the candidates for contractions with a factor are
+ *  found without looking at all other factors. */
+class index_adjacency {
+public:
+	index_adjacency(const exvector & v);
+
+	/** Positions after i of the factors sharing an index value with
+	 *  factor i, in increasing order. */
+	void partners(size_t i, std::vector<size_t> & out) const;
+
+	/** Re-index the factors which were replaced by a contraction. */
+	void update(const exvector & v);
+
+private:
+	void insert(size_t k, const ex & e);
+	void remove(size_t k);
+
+	std::map<ex, std::vector<size_t>, ex_is_less> positions;
+	std::vector<exvector> values; ///< index values of each factor
+	exvector known;               ///< factors as they were indexed
+};
+
+index_adjacency::index_adjacency(const exvector & v) : values(v.size()), known(v)
+{
+	for (size_t k=0; k<v.size(); ++k)
+		insert(k, v[k]);
+}
+
+void index_adjacency::insert(size_t k, const ex & e)
+{
+	known[k] = e;
+	values[k].clear();
+	if (!is_a<indexed>(e))
+		return;
+	for (size_t i=1; i<e.nops(); ++i) {
+		const ex value = e.op(i).op(0);
+		std::vector<size_t> & pos = positions[value];
+		std::vector<size_t>::iterator p = std::lower_bound(pos.begin(), pos.end(), k);
+		if (p == pos.end() || *p != k) {
+			pos.insert(p, k);
+			values[k].push_back(value);
+		}
+	}
+}
+
+void index_adjacency::remove(size_t k)
+{
+	for (exvector::const_iterator it=values[k].begin(); it!=values[k].end(); ++it) {
+		std::vector<size_t> & pos = positions[*it];
+		pos.erase(std::lower_bound(pos.begin(), pos.end(), k));
+	}
+	values[k].clear();
+}
+
+void index_adjacency::partners(size_t i, std::vector<size_t> & out) const
+{
+	out.clear();
+	for (exvector::const_iterator it=values[i].begin(); it!=values[i].end(); ++it) {
+		const std::vector<size_t> & pos = positions.find(*it)->second;
+		out.insert(out.end(), std::upper_bound(pos.begin(), pos.end(), i), pos.end());
+	}
+	std::sort(out.begin(), out.end());
+	out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+void index_adjacency::update(const exvector & v)
+{
+	for (size_t k=0; k<v.size(); ++k)
+		if (!are_ex_trivially_equal(known[k], v[k])) {
+			remove(k);
+			insert(k, v[k]);
+		}
+}
+
 // Forward declaration needed in absence of friend injection, C.f. [namespace.memdef]:
 ex simplify_indexed(const ex & e, exvector & free_indices, exvector & dummy_indices, const scalar_products & sp);
+ex simplify_indexed(const ex & e, exvector & free_indices, exvector & dummy_indices, const scalar_products & sp, unsigned options);
 
 /** Simplify product of indexed expressions (commutative, noncommutative and
  *  simple squares), return list of free indices. */
@@ -795,10 +874,14 @@ ex simplify_indexed_product(const ex & e, exvector & free_indices, exvector & du
 	bool non_commutative;
 	product_to_exvector(e, v, non_commutative);
 
-	// Perform contractions
+	// Perform contractions. Only the factors sharing an index value with
+	// the first one are candidates, they are looked up in the adjacency
+	// of the factors, which is updated after every contraction.
 	bool something_changed = false;
 	bool has_nonsymmetric = false;
 	GINAC_ASSERT(v.size() > 1);
+	index_adjacency adjacency(v);
+	std::vector<size_t> candidates;
 	exvector::iterator it1, itend = v.end(), next_to_last = itend - 1;
 	for (it1 = v.begin(); it1 != next_to_last; it1++) {
 
@@ -814,9 +897,10 @@ try_again:
 		exvector free1, dummy1;
 		find_free_and_dummy(ex_to<indexed>(*it1).seq.begin() + 1, ex_to<indexed>(*it1).seq.end(), free1, dummy1);
 
-		exvector::iterator it2;
-		for (it2 = it1 + 1; it2 != itend; it2++) {
+		adjacency.partners(it1 - v.begin(), candidates);
+		for (std::vector<size_t>::const_iterator c = candidates.begin(); c != candidates.end(); ++c) {
 
+			exvector::iterator it2 = v.begin() + *c;
 			if (!is_a<indexed>(*it2))
 				continue;
 
@@ -837,7 +921,7 @@ try_again:
 
 			// At least one dummy index, is it a defined scalar product?
 			bool contracted = false;
-			if (free.empty() && it1->nops()==2 && it2->nops()==2) {
+			if (free.empty() && it1->nops()==2 && it2->nops()==2 && !sp.empty()) {
 
 				ex dim = minimal_dim(
 					ex_to<idx>(it1->op(1)).get_dim(),
@@ -845,10 +929,11 @@ try_again:
 				);
 
 				// User-defined scalar product?
-				if (sp.is_defined(*it1, *it2, dim)) {
+				ex value;
+				if (sp.lookup(*it1, *it2, dim, value)) {
 
 					// Yes, substitute it
-					*it1 = sp.evaluate(*it1, *it2, dim);
+					*it1 = value;
 					*it2 = _ex1;
 					goto contraction_done;
 				}
@@ -882,6 +967,7 @@ contraction_done:
 				// even not be indexed objects any more, so we have to
 				// start over
 				something_changed = true;
+				adjacency.update(v);
 				goto try_again;
 			}
 			else if (!has_nonsymmetric &&
@@ -1041,8 +1127,44 @@ bool hasindex(const ex &x, const ex &sym)
 	return false;
 }
 
+/** Number of terms of a sum from which simplify_indexed() distributes
+ *  them over several threads, if asked to. */
+static const size_t parallel_simplify_terms = 64;
+
+/** Simplifies slices of the terms of a sum in parallel. Each slice has its
+ *  own set of dummy indices, which starts as a copy of the global one.
+ *  @see simplify_indexed */
+struct simplify_terms_task : public parallel_task {
+	simplify_terms_task(const ex & sum_, const exvector & dummy_indices, const scalar_products & sp_,
+	                    size_t nparts_, exvector & terms_, std::vector<exvector> & free_indices_)
+	 : sum(sum_), sp(sp_), nparts(nparts_), terms(terms_), free_indices(free_indices_),
+	   slice_dummy_indices(nparts_, dummy_indices) {}
+
+	size_t begin(size_t part) const { return (part * sum.nops()) / nparts; }
+
+	void operator()(size_t part)
+	{
+		for (size_t i=begin(part); i<begin(part + 1); ++i)
+			terms[i] = simplify_indexed(sum.op(i), free_indices[i], slice_dummy_indices[part], sp);
+	}
+
+	const ex & sum;
+	const scalar_products & sp;
+	const size_t nparts;
+	exvector & terms;
+	std::vector<exvector> & free_indices;
+	std::vector<exvector> slice_dummy_indices;
+};
+
 /** Simplify indexed expression, return list of free indices. */
 ex simplify_indexed(const ex & e, exvector & free_indices, exvector & dummy_indices, const scalar_products & sp)
+{
+	return simplify_indexed(e, free_indices, dummy_indices, sp, 0);
+}
+
+/** Simplify indexed expression, return list of free indices.
+ *  @param options see simplify_indexed_options */
+ex simplify_indexed(const ex & e, exvector & free_indices, exvector & dummy_indices, const scalar_products & sp, unsigned options)
 {
 	// Expand the expression
 	ex e_expanded = e.expand();
@@ -1078,31 +1200,72 @@ ex simplify_indexed(const ex & e, exvector & free_indices, exvector & dummy_indi
 	// Simplification of sum = sum of simplifications, check consistency of
 	// free indices in each term
 	if (is_exactly_a<add>(e_expanded)) {
+		const size_t nterms = e_expanded.nops();
+		exvector simplified_terms;
+		std::vector<exvector> free_indices_of_terms(nterms);
+
+		// Large sums may be simplified in parallel; the dummy indices of
+		// the terms are then renamed to the global ones in order
+		unsigned nthreads = 1;
+		if ((options & simplify_indexed_options::parallel) &&
+		    nterms >= parallel_simplify_terms &&
+		    (nthreads = parallel_threads(nterms)) > 1 &&
+		    numerics_are_immediate(e_expanded) && sp.numerics_are_immediate()) {
+			prepare_for_threads(e_expanded);
+			prepare_for_threads(dummy_indices);
+			sp.prepare_for_threads();
+			simplified_terms.resize(nterms);
+			simplify_terms_task task(e_expanded, dummy_indices, sp, std::min(nterms, size_t(4 * nthreads)), simplified_terms, free_indices_of_terms);
+			parallel_for(task.nparts, task);
+			for (size_t part=0; part<task.nparts; ++part) {
+				const exvector & slice_dummy_indices = task.slice_dummy_indices[part];
+				for (size_t i=task.begin(part); i<task.begin(part + 1); ++i) {
+					exvector local_dummy_indices;
+					for (exvector::const_iterator j=slice_dummy_indices.begin(); j!=slice_dummy_indices.end(); ++j)
+						if (hasindex(simplified_terms[i], j->op(0)))
+							local_dummy_indices.push_back(*j);
+					ex & term = simplified_terms[i];
+					term = rename_dummy_indices<idx>(term, dummy_indices, local_dummy_indices);
+					term = rename_dummy_indices<varidx>(term, dummy_indices, local_dummy_indices);
+					term = rename_dummy_indices<spinidx>(term, dummy_indices, local_dummy_indices);
+				}
+			}
+		} else {
+			simplified_terms.reserve(nterms);
+			for (size_t i=0; i<nterms; i++)
+				simplified_terms.push_back(simplify_indexed(e_expanded.op(i), free_indices_of_terms[i], dummy_indices, sp));
+		}
+
+		// Add up the terms; sums of indexed objects of the same kind (like
+		// matrices) are formed by the objects, the rest in one go
 		bool first = true;
 		ex sum;
+		exvector sum_terms;
 		free_indices.clear();
-
-		for (size_t i=0; i<e_expanded.nops(); i++) {
-			exvector free_indices_of_term;
-			ex term = simplify_indexed(e_expanded.op(i), free_indices_of_term, dummy_indices, sp);
-			if (!term.is_zero()) {
-				if (first) {
-					free_indices = free_indices_of_term;
-					sum = term;
-					first = false;
-				} else {
-					if (!indices_consistent(free_indices, free_indices_of_term)) {
-						std::ostringstream s;
-						s << "simplify_indexed: inconsistent indices in sum: ";
-						s << exprseq(free_indices) << " vs. " << exprseq(free_indices_of_term);
-						throw (std::runtime_error(s.str()));
-					}
-					if (is_a<indexed>(sum) && is_a<indexed>(term))
-						sum = ex_to<basic>(sum.op(0)).add_indexed(sum, term);
-					else
-						sum += term;
-				}
+		for (size_t i=0; i<nterms; i++) {
+			const ex & term = simplified_terms[i];
+			if (term.is_zero())
+				continue;
+			if (first) {
+				free_indices = free_indices_of_terms[i];
+				sum = term;
+				first = false;
+				continue;
+			}
+			if (!indices_consistent(free_indices, free_indices_of_terms[i])) {
+				std::ostringstream s;
+				s << "simplify_indexed: inconsistent indices in sum: ";
+				s << exprseq(free_indices) << " vs. " << exprseq(free_indices_of_terms[i]);
+				throw (std::runtime_error(s.str()));
 			}
+			if (sum_terms.empty() && is_a<indexed>(sum) && is_a<indexed>(term))
+				sum = ex_to<basic>(sum.op(0)).add_indexed(sum, term);
+			else
+				sum_terms.push_back(term);
+		}
+		if (!sum_terms.empty()) {
+			sum_terms.push_back(sum);
+			sum = (new add(sum_terms))->setflag(status_flags::dynallocated);
 		}
 
 		// If the sum turns out to be zero, we are finished
@@ -1116,6 +1279,36 @@ ex simplify_indexed(const ex & e, exvector & free_indices, exvector & dummy_indi
 		if (num_terms_orig < 2 || dummy_indices.size() < 2)
 			return sum;
 
+		// Rename the dummy indices of each term canonically, so that terms
+		// which only differ in the names of their dummy indices combine
+		{
+			exvector canonical_terms;
+			canonical_terms.reserve(num_terms_orig);
+			bool all_canonical = true;
+			for (size_t i=0; i<sum.nops(); i++) {
+				const ex & term = sum.op(i);
+				exvector dummy_indices_of_term;
+				for (exvector::const_iterator j=dummy_indices.begin(); j!=dummy_indices.end(); ++j)
+					if (hasindex(term, j->op(0)))
+						dummy_indices_of_term.push_back(*j);
+				ex canonical;
+				if (canonicalize_dummy_indices(term, dummy_indices_of_term, dummy_indices, canonical))
+					canonical_terms.push_back(canonical);
+				else {
+					canonical_terms.push_back(term);
+					all_canonical = false;
+				}
+			}
+			sum = (new add(canonical_terms))->setflag(status_flags::dynallocated);
+			if (sum.is_zero()) {
+				free_indices.clear();
+				return sum;
+			}
+			num_terms_orig = (is_exactly_a<add>(sum) ? sum.nops() : 1);
+			if (all_canonical || num_terms_orig < 2)
+				return sum;
+		}
+
 		// Chop the sum into terms and symmetrize each one over the dummy
 		// indices
 		std::vector<terminfo> terms;
@@ -1252,13 +1445,13 @@ ex simplify_indexed(const ex & e, exvector & free_indices, exvector & dummy_indi
  *  performs contraction of dummy indices where possible and checks whether
  *  the free indices in sums are consistent.
  *
- *  @param options Simplification options (currently unused)
+ *  @param options Simplification options (see simplify_indexed_options)
  *  @return simplified expression */
 ex ex::simplify_indexed(unsigned options) const
 {
 	exvector free_indices, dummy_indices;
 	scalar_products sp;
-	return GiNaC::simplify_indexed(*this, free_indices, dummy_indices, sp);
+	return GiNaC::simplify_indexed(*this, free_indices, dummy_indices, sp, options);
 }
 
 /** Simplify/canonicalize expression containing indexed objects. This
@@ -1267,12 +1460,12 @@ ex ex::simplify_indexed(unsigned options) const
  *  scalar products by known values if desired.
  *
  *  @param sp Scalar products to be replaced automatically
- *  @param options Simplification options (currently unused)
+ *  @param options Simplification options (see simplify_indexed_options)
  *  @return simplified expression */
 ex ex::simplify_indexed(const scalar_products & sp, unsigned options) const
 {
 	exvector free_indices, dummy_indices;
-	return GiNaC::simplify_indexed(*this, free_indices, dummy_indices, sp);
+	return GiNaC::simplify_indexed(*this, free_indices, dummy_indices, sp, options);
 }
 
 /** Symmetrize expression over its free indices. */
@@ -1311,10 +1504,13 @@ spmapkey::spmapkey(const ex & v1_, const ex & v2_, const ex & dim_) : dim(dim_)
 		v1 = s1;
 		v2 = s2;
 	}
+	hashval = hash_combine(v1.gethash(), v2.gethash());
 }
 
 bool spmapkey::operator==(const spmapkey &other) const
 {
+	if (hashval != other.hashval)
+		return false;
 	if (!v1.is_equal(other.v1))
 		return false;
 	if (!v2.is_equal(other.v2))
@@ -1341,6 +1537,13 @@ bool spmapkey::operator<(const spmapkey &other) const
 		return dim.compare(other.dim) < 0;
 }
 
+void spmapkey::prepare_for_threads() const
+{
+	GiNaC::prepare_for_threads(v1);
+	GiNaC::prepare_for_threads(v2);
+	GiNaC::prepare_for_threads(dim);
+}
+
 void spmapkey::debugprint() const
 {
 	std::cerr << "(" << v1 << "," << v2 << "," << dim << ")";
@@ -1358,10 +1561,13 @@ void scalar_products::add(const ex & v1, const ex & v2, const ex & dim, const ex
 
 void scalar_products::add_vectors(const lst & l, const ex & dim)
 {
-	// Add all possible pairs of products
+	// Add all possible pairs of products (the keys are symmetric, so
+	// each unordered pair is enough)
+	const size_t n = l.nops();
+	spm.reserve(spm.size() + n * (n + 1) / 2);
 	for (lst::const_iterator it1 = l.begin(); it1 != l.end(); ++it1)
-		for (lst::const_iterator it2 = l.begin(); it2 != l.end(); ++it2)
-			add(*it1, *it2, *it1 * *it2);
+		for (lst::const_iterator it2 = it1; it2 != l.end(); ++it2)
+			spm[spmapkey(*it1, *it2, dim)] = *it1 * *it2;
 }
 
 void scalar_products::clear()
@@ -1381,6 +1587,32 @@ ex scalar_products::evaluate(const ex & v1, const ex & v2, const ex & dim) const
 	return spm.find(spmapkey(v1, v2, dim))->second;
 }
 
+bool scalar_products::numerics_are_immediate() const
+{
+	for (spmap::const_iterator it = spm.begin(); it != spm.end(); ++it) {
+		if (!GiNaC::numerics_are_immediate(it->second))
+			return false;
+	}
+	return true;
+}
+
+void scalar_products::prepare_for_threads() const
+{
+	for (spmap::const_iterator it = spm.begin(); it != spm.end(); ++it) {
+		it->first.prepare_for_threads();
+		GiNaC::prepare_for_threads(it->second);
+	}
+}
+
+bool scalar_products::lookup(const ex & v1, const ex & v2, const ex & dim, ex & value) const
+{
+	spmap::const_iterator it = spm.find(spmapkey(v1, v2, dim));
+	if (it == spm.end())
+		return false;
+	value = it->second;
+	return true;
+}
+
 void scalar_products::debugprint() const
 {
 	std::cerr << "map size=" << spm.size() << std::endl;
@@ -27,6 +27,7 @@
 #include "wildcard.h"
 
 #include <map>
+#include <unordered_map>
 
 namespace GiNaC {
 
@@ -41,6 +42,7 @@ class indexed : public exprseq
 	GINAC_DECLARE_REGISTERED_CLASS(indexed, exprseq)
 
 	friend ex simplify_indexed(const ex & e, exvector & free_indices, exvector & dummy_indices, const scalar_products & sp);
+	friend ex simplify_indexed(const ex & e, exvector & free_indices, exvector & dummy_indices, const scalar_products & sp, unsigned options);
 	friend ex simplify_indexed_product(const ex & e, exvector & free_indices, exvector & dummy_indices, const scalar_products & sp);
 	friend bool reposition_dummy_indices(ex & e, exvector & variant_dummy_indices, exvector & moved_indices);
 
@@ -206,19 +208,32 @@ GINAC_DECLARE_UNARCHIVER(indexed);
 
 class spmapkey {
 public:
-	spmapkey() : dim(wild()) {}
+	spmapkey() : dim(wild()), hashval(0) {}
 	spmapkey(const ex & v1, const ex & v2, const ex & dim = wild());
 
 	bool operator==(const spmapkey &other) const;
 	bool operator<(const spmapkey &other) const;
 
+	/** Hash value of the pair of objects. The dimension is not included,
+	 *  because a key with a wildcard dimension equals keys with any
+	 *  dimension. */
+	unsigned hash() const { return hashval; }
+
+	/** Fill in the caches of the objects (see GiNaC::prepare_for_threads()). */
+	void prepare_for_threads() const;
+
 	void debugprint() const;
 
 protected:
 	ex v1, v2, dim;
+	unsigned hashval;
+};
+
+struct spmapkey_hash {
+	std::size_t operator()(const spmapkey & k) const { return k.hash(); }
 };
 
-typedef std::map<spmapkey, ex> spmap;
+typedef std::unordered_map<spmapkey, ex, spmapkey_hash> spmap;
 
 /** Helper class for storing information about known scalar products which
  *  are to be automatically replaced by simplify_indexed().
@@ -240,8 +255,23 @@ public:
 	/** Clear all registered scalar products. */
 	void clear();
 
+	/** Check whether no scalar products are registered. */
+	bool empty() const { return spm.empty(); }
+
+	/** Check whether the values may be read by several threads at once
+	 *  (see numerics_are_immediate()). */
+	bool numerics_are_immediate() const;
+
+	/** Fill in the caches of the keys and values, so that several threads
+	 *  may look up scalar products at once (see GiNaC::prepare_for_threads()). */
+	void prepare_for_threads() const;
+
 	bool is_defined(const ex & v1, const ex & v2, const ex & dim) const;
 	ex evaluate(const ex & v1, const ex & v2, const ex & dim) const;
+
+	/** Look up the value of a scalar product pair with a single search.
+	 *  Returns false if the pair is not defined. */
+	bool lookup(const ex & v1, const ex & v2, const ex & dim, ex & value) const;
 	void debugprint() const;
 
 protected:
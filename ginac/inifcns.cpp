@@ -22,6 +22,7 @@
 
 #include "inifcns.h"
 #include "ex.h"
+#include "add.h"
 #include "constant.h"
 #include "lst.h"
 #include "matrix.h"
@@ -30,10 +31,14 @@
 #include "operators.h"
 #include "relational.h"
 #include "pseries.h"
+#include "sparse_matrix.h"
 #include "symbol.h"
 #include "symmetry.h"
 #include "utils.h"
 
+#include <cmath>
+#include <complex>
+#include <map>
 #include <stdexcept>
 #include <vector>
 
@@ -186,6 +191,12 @@ static ex abs_evalf(const ex & arg)
 	return abs(arg).hold();
 }
 
+static bool abs_evalf_double(const std::complex<double> * x, std::complex<double> & r)
+{
+	r = std::abs(x[0]);
+	return true;
+}
+
 static ex abs_eval(const ex & arg)
 {
 	if (is_exactly_a<numeric>(arg))
@@ -235,6 +246,7 @@ static ex abs_power(const ex & arg, const ex & exp)
 
 REGISTER_FUNCTION(abs, eval_func(abs_eval).
                        evalf_func(abs_evalf).
+                       evalf_double_func(abs_evalf_double).
                        print_func<print_latex>(abs_print_latex).
                        print_func<print_csrc_float>(abs_print_csrc_float).
                        print_func<print_csrc_double>(abs_print_csrc_float).
@@ -524,6 +536,72 @@ static ex Li2_evalf(const ex & x)
 	return Li2(x).hold();
 }
 
+/** Li2(x) in double precision inside the rectangle of Li2_projection() in
+ *  numeric.cpp, by the series in z = -log(1-x) with Bernoulli numbers,
+ *  Li2(x) = z - z^2/4 + sum_{k>=1} B_2k z^(2k+1) / (2k+1)!. There |z| < 1,
+ *  so ten terms are enough. */
+static std::complex<double> Li2_double_series(const std::complex<double> & x)
+{
+	// B_2k/(2k+1)! for k = 1, ..., 10
+	static const double coeff[10] = {
+		2.77777777777777762e-02, -2.77777777777777778e-04,
+		4.72411186696900978e-06, -9.18577307466196408e-08,
+		1.89788699889710005e-09, -4.06476164514422560e-11,
+		8.92169102045645230e-13, -1.99392958607210744e-14,
+		4.51898002961991825e-16, -1.03565176121812472e-17 };
+	const std::complex<double> z = -std::log(1.0 - x);
+	const std::complex<double> z2 = z*z;
+	std::complex<double> p = coeff[9];
+	for (int k = 8; k >= 0; --k)
+		p = p*z2 + coeff[k];
+	return z - z2/4.0 + z*z2*p;
+}
+
+/** Folds the argument into the rectangle of Li2_double_series(), like
+ *  Li2_projection() in numeric.cpp. */
+static std::complex<double> Li2_double_projection(const std::complex<double> & x)
+{
+	const double pi2_6 = 1.6449340668482264365;  // Pi^2/6
+	const double re = x.real(), im = x.imag();
+	if (re > 0.5)
+		// reflection: Li2(x) = Pi^2/6 - log(x)*log(1-x) - Li2(1-x)
+		return pi2_6 - Li2_double_series(1.0 - x) - std::log(x)*std::log(1.0 - x);
+	if ((re <= 0 && std::fabs(im) > 0.75) || re < -0.5) {
+		// Landen: Li2(x) = -log(1-x)^2/2 - Li2(x/(x-1))
+		const std::complex<double> l = std::log(1.0 - x);
+		return -l*l/2.0 - Li2_double_series(x/(x - 1.0));
+	}
+	if (re > 0 && std::fabs(im) > 0.75)
+		// duplication: Li2(x) = Li2(x^2)/2 - Li2(-x)
+		return Li2_double_projection(x*x)/2.0 - Li2_double_projection(-x);
+	return Li2_double_series(x);
+}
+
+/** Li2(x) in double precision, with the same transformations (and branch
+ *  cut) as Li2_() in numeric.cpp. */
+static std::complex<double> Li2_double(const std::complex<double> & x)
+{
+	const double pi2_6 = 1.6449340668482264365;  // Pi^2/6
+	if (x == 1.0)
+		return pi2_6;
+	if (std::abs(x) > 1) {
+		// inversion: Li2(x) = -Pi^2/6 - log(-x)^2/2 - Li2(1/x)
+		const std::complex<double> l = std::log(-x);
+		return -pi2_6 - l*l/2.0 - Li2_double_projection(1.0/x);
+	}
+	return Li2_double_projection(x);
+}
+
+static bool Li2_evalf_double(const std::complex<double> * x, std::complex<double> & r)
+{
+	// on the branch cut, the value depends on the sign of the zero
+	// imaginary part; leave that to CLN
+	if (x[0].imag() == 0 && x[0].real() > 1)
+		return false;
+	r = Li2_double(x[0]);
+	return true;
+}
+
 static ex Li2_eval(const ex & x)
 {
 	if (x.info(info_flags::numeric)) {
@@ -659,6 +737,7 @@ static ex Li2_conjugate(const ex & x)
 
 REGISTER_FUNCTION(Li2, eval_func(Li2_eval).
                        evalf_func(Li2_evalf).
+                       evalf_double_func(Li2_evalf_double).
                        derivative_func(Li2_deriv).
                        series_func(Li2_series).
                        conjugate_func(Li2_conjugate).
@@ -883,6 +962,74 @@ REGISTER_FUNCTION(Order, eval_func(Order_eval).
 // Solve linear system
 //////////
 
+namespace {
+
+typedef std::map<ex, unsigned, ex_is_less> column_map;
+
+bool has_column_symbol(const ex & e, const column_map & columns)
+{
+	if (is_exactly_a<symbol>(e))
+		return columns.count(e) != 0;
+	for (size_t i=0; i<e.nops(); ++i)
+		if (has_column_symbol(e.op(i), columns))
+			return true;
+	return false;
+}
+
+/** Adds the coefficients of the expanded linear expression eq to row r of
+ *  sys and the negated rest to rhs, without looking for every symbol in
+ *  every equation like coeff() does.
+ *
+ *  @exception logic_error (system is not linear) */
+void sparse_linear_row(const ex & eq, const column_map & columns, unsigned r, sparse_matrix & sys, matrix & rhs)
+{
+	const ex e = eq.expand();
+	std::map<unsigned, exvector> coeffs;
+	exvector rest;
+	const size_t nterms = is_exactly_a<add>(e) ? e.nops() : 1;
+	for (size_t t=0; t<nterms; ++t) {
+		const ex term = is_exactly_a<add>(e) ? e.op(t) : e;
+		column_map::const_iterator col = columns.find(term);
+		if (col != columns.end()) {
+			coeffs[col->second].push_back(_ex1);
+			continue;
+		}
+		if (!is_exactly_a<mul>(term)) {
+			if (has_column_symbol(term, columns))
+				throw std::logic_error("lsolve: system is not linear");
+			rest.push_back(term);
+			continue;
+		}
+		col = columns.end();
+		size_t factor = 0;
+		for (size_t i=0; i<term.nops(); ++i) {
+			column_map::const_iterator c = columns.find(term.op(i));
+			if (c != columns.end()) {
+				if (col != columns.end())
+					throw std::logic_error("lsolve: system is not linear");
+				col = c;
+				factor = i;
+			} else if (has_column_symbol(term.op(i), columns))
+				throw std::logic_error("lsolve: system is not linear");
+		}
+		if (col == columns.end()) {
+			rest.push_back(term);
+			continue;
+		}
+		exvector others;
+		others.reserve(term.nops()-1);
+		for (size_t i=0; i<term.nops(); ++i)
+			if (i != factor)
+				others.push_back(term.op(i));
+		coeffs[col->second].push_back(mul(others));
+	}
+	for (std::map<unsigned, exvector>::const_iterator i=coeffs.begin(); i!=coeffs.end(); ++i)
+		sys.set(r, i->first, add(i->second));
+	rhs(r,0) = -add(rest);
+}
+
+} // anonymous namespace
+
 ex lsolve(const ex &eqns, const ex &symbols, unsigned options)
 {
 	// solve a system of linear equations
@@ -897,24 +1044,59 @@ ex lsolve(const ex &eqns, const ex &symbols, unsigned options)
 		return sol.op(0).op(1); // return rhs of first solution
 	}
 	
-	// syntax checks
+	// syntax checks (lists are walked with iterators, op(i) is linear in i)
 	if (!eqns.info(info_flags::list)) {
 		throw(std::invalid_argument("lsolve(): 1st argument must be a list or an equation"));
 	}
-	for (size_t i=0; i<eqns.nops(); i++) {
-		if (!eqns.op(i).info(info_flags::relation_equal)) {
+	for (lst::const_iterator i=ex_to<lst>(eqns).begin(); i!=ex_to<lst>(eqns).end(); ++i) {
+		if (!i->info(info_flags::relation_equal)) {
 			throw(std::invalid_argument("lsolve(): 1st argument must be a list of equations"));
 		}
 	}
 	if (!symbols.info(info_flags::list)) {
 		throw(std::invalid_argument("lsolve(): 2nd argument must be a list or a symbol"));
 	}
-	for (size_t i=0; i<symbols.nops(); i++) {
-		if (!symbols.op(i).info(info_flags::symbol)) {
+	for (lst::const_iterator i=ex_to<lst>(symbols).begin(); i!=ex_to<lst>(symbols).end(); ++i) {
+		if (!i->info(info_flags::symbol)) {
 			throw(std::invalid_argument("lsolve(): 2nd argument must be a list of symbols"));
 		}
 	}
 	
+	// large systems are built term by term into a sparse matrix
+	if (options == solve_algo::sparse ||
+	    (options == solve_algo::automatic && eqns.nops()*symbols.nops() > 10000)) {
+		const lst & eqnlist = ex_to<lst>(eqns);
+		const lst & symlist = ex_to<lst>(symbols);
+		column_map columns;
+		matrix vars(symbols.nops(),1);
+		unsigned i = 0;
+		for (lst::const_iterator s=symlist.begin(); s!=symlist.end(); ++s, ++i) {
+			columns.insert(std::make_pair(*s, i));
+			vars(i,0) = *s;
+		}
+		sparse_matrix sys(eqns.nops(),symbols.nops());
+		matrix rhs(eqns.nops(),1);
+		unsigned r = 0;
+		for (lst::const_iterator eq=eqnlist.begin(); eq!=eqnlist.end(); ++eq, ++r)
+			sparse_linear_row(eq->op(0)-eq->op(1), columns, r, sys, rhs);
+
+		matrix solution;
+		try {
+			// dense systems are better off with the dense algorithms
+			if (options == solve_algo::automatic && sys.nonzeros()*10 > eqns.nops()*symbols.nops())
+				solution = sys.to_matrix().solve(vars,rhs,options);
+			else
+				solution = sys.solve(vars,rhs);
+		} catch (const std::runtime_error & e) {
+			return lst();
+		}
+		lst sollist;
+		i = 0;
+		for (lst::const_iterator s=symlist.begin(); s!=symlist.end(); ++s, ++i)
+			sollist.append(*s==solution(i,0));
+		return sollist;
+	}
+	
 	// build matrix from equation system
 	matrix sys(eqns.nops(),symbols.nops());
 	matrix rhs(eqns.nops(),1);
@@ -151,6 +151,21 @@ DECLARE_FUNCTION_3P(S)
 /** Harmonic polylogarithm. */
 DECLARE_FUNCTION_2P(H)
 
+/** Fill the lookup tables used by the numerical evaluation of Li(n,x) and
+ *  S(n,p,x) for n, p <= weight at the current value of Digits in advance,
+ *  instead of extending them on the first calls. Tables are kept for the
+ *  few most recently used precisions, separately for each thread if GiNaC
+ *  was built with GINAC_THREAD_SAFE_REFCOUNT. */
+void prepare_polylog_tables(int weight);
+
+/** Numerical values of the expressions in v, like evalf() of each of them.
+ *  This is meant for many multiple polylogarithms G, Li and H at the same
+ *  point: during the call, the numerical evaluation of G, to which the
+ *  others are reduced, is done only once for each distinct set of
+ *  arguments, including the sub-evaluations of the Hoelder convolution and
+ *  of the convergence transformations. */
+exvector evalf_polylogs(const exvector & v);
+
 /** Gamma-function. */
 DECLARE_FUNCTION_1P(lgamma)
 DECLARE_FUNCTION_1P(tgamma)
@@ -32,6 +32,8 @@
 #include "symmetry.h"
 #include "utils.h"
 
+#include <cmath>
+#include <complex>
 #include <stdexcept>
 #include <vector>
 
@@ -52,6 +54,15 @@ static ex lgamma_evalf(const ex & x)
 	return lgamma(x).hold();
 }
 
+static bool lgamma_evalf_double(const std::complex<double> * x, std::complex<double> & r)
+{
+	// for other arguments lgamma() is complex
+	if (x[0].imag() != 0 || x[0].real() <= 0)
+		return false;
+	r = std::lgamma(x[0].real());
+	return true;
+}
+
 
 /** Evaluation of lgamma(x), the natural logarithm of the Gamma function.
  *  Handles integer arguments as a special case.
@@ -127,6 +138,7 @@ static ex lgamma_conjugate(const ex & x)
 
 REGISTER_FUNCTION(lgamma, eval_func(lgamma_eval).
                           evalf_func(lgamma_evalf).
+                          evalf_double_func(lgamma_evalf_double).
                           derivative_func(lgamma_deriv).
                           series_func(lgamma_series).
                           conjugate_func(lgamma_conjugate).
@@ -148,6 +160,15 @@ static ex tgamma_evalf(const ex & x)
 	return tgamma(x).hold();
 }
 
+static bool tgamma_evalf_double(const std::complex<double> * x, std::complex<double> & r)
+{
+	// no complex arguments and no poles
+	if (x[0].imag() != 0 || (x[0].real() <= 0 && x[0].real() == std::floor(x[0].real())))
+		return false;
+	r = std::tgamma(x[0].real());
+	return true;
+}
+
 
 /** Evaluation of tgamma(x), the true Gamma function.  Knows about integer
  *  arguments, half-integer arguments and that's it. Somebody ought to provide
@@ -232,6 +253,7 @@ static ex tgamma_conjugate(const ex & x)
 
 REGISTER_FUNCTION(tgamma, eval_func(tgamma_eval).
                           evalf_func(tgamma_evalf).
+                          evalf_double_func(tgamma_evalf_double).
                           derivative_func(tgamma_deriv).
                           series_func(tgamma_series).
                           conjugate_func(tgamma_conjugate).
@@ -80,8 +80,11 @@
 #include "wildcard.h"
 
 #include <cln/cln.h>
+#include <algorithm>
+#include <map>
 #include <sstream>
 #include <stdexcept>
+#include <unordered_map>
 #include <vector>
 
 namespace GiNaC {
@@ -102,11 +105,18 @@ namespace {
 
 // lookup table for factors built from Bernoulli numbers
 // see fill_Xn()
-std::vector<std::vector<cln::cl_N> > Xn;
 // initial size of Xn that should suffice for 32bit machines (must be even)
 const int xninitsizestep = 26;
+// the lookup tables are kept per thread, so that they need no locking
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+thread_local std::vector<std::vector<cln::cl_N> > Xn;
+thread_local int xninitsize = xninitsizestep;
+thread_local int xnsize = 0;
+#else
+std::vector<std::vector<cln::cl_N> > Xn;
 int xninitsize = xninitsizestep;
 int xnsize = 0;
+#endif
 
 
 // This function calculates the X_n. The X_n are needed for speed up of classical polylogarithms.
@@ -346,9 +356,9 @@ cln::cl_N Li_projection(int n, const cln::cl_N& x, const cln::float_format_t& pr
 		} else {
 			// choose the faster algorithm
 			if (cln::abs(cln::realpart(x)) > 0.75) {
-				return -Li2_do_sum(1-x) - cln::log(x) * cln::log(1-x) + cln::zeta(2);
+				return -Li2_do_sum(1-x) - cln::log(x) * cln::log(1-x) + cln::zeta(2, cln::float_format(Digits));
 			} else {
-				return -Li2_do_sum_Xn(1-x) - cln::log(x) * cln::log(1-x) + cln::zeta(2);
+				return -Li2_do_sum_Xn(1-x) - cln::log(x) * cln::log(1-x) + cln::zeta(2, cln::float_format(Digits));
 			}
 		}
 	} else {
@@ -390,11 +400,11 @@ const cln::cl_N Lin_numeric(const int n, const cln::cl_N& x)
 	}
 	if (x == 1) {
 		// [Kol] (2.22)
-		return cln::zeta(n);
+		return cln::zeta(n, cln::float_format(Digits));
 	}
 	else if (x == -1) {
 		// [Kol] (2.22)
-		return -(1-cln::expt(cln::cl_I(2),1-n)) * cln::zeta(n);
+		return -(1-cln::expt(cln::cl_I(2),1-n)) * cln::zeta(n, cln::float_format(Digits));
 	}
 	if (cln::abs(realpart(x)) < 0.4 && cln::abs(cln::abs(x)-1) < 0.01) {
 		cln::cl_N result = -cln::expt(cln::log(x), n-1) * cln::log(1-x) / cln::factorial(n-1);
@@ -407,7 +417,7 @@ const cln::cl_N Lin_numeric(const int n, const cln::cl_N& x)
 
 	// what is the desired float format?
 	// first guess: default format
-	cln::float_format_t prec = cln::default_float_format;
+	cln::float_format_t prec = cln::float_format(Digits);
 	const cln::cl_N value = x;
 	// second guess: the argument's format
 	if (!instanceof(realpart(x), cln::cl_RA_ring))
@@ -985,6 +995,51 @@ static cln::cl_N
 G_numeric(const std::vector<cln::cl_N>& x, const std::vector<int>& s,
 	  const cln::cl_N& y);
 
+// arguments of a numerical evaluation of G
+struct G_key {
+	G_key(const std::vector<cln::cl_N>& x_, const std::vector<int>& s_, const cln::cl_N& y_)
+	  : x(x_), s(s_), y(y_) {}
+	bool operator==(const G_key& other) const
+	{
+		if (x.size() != other.x.size() || s != other.s || !cln::equal(y, other.y))
+			return false;
+		for (std::size_t i = 0; i < x.size(); ++i) {
+			if (!cln::equal(x[i], other.x[i]))
+				return false;
+		}
+		return true;
+	}
+	std::vector<cln::cl_N> x;
+	std::vector<int> s;
+	cln::cl_N y;
+};
+
+struct G_key_hash {
+	std::size_t operator()(const G_key& k) const
+	{
+		std::size_t h = cln::equal_hashcode(k.y);
+		for (std::size_t i = 0; i < k.x.size(); ++i) {
+			h = h * 31 + cln::equal_hashcode(k.x[i]);
+			h = h * 31 + std::size_t(k.s[i]);
+		}
+		return h;
+	}
+};
+
+// results of G_numeric during one call of evalf_polylogs()
+struct G_cache_t {
+	explicit G_cache_t(long digits_) : digits(digits_) {}
+	long digits; // the values are only valid for this precision
+	std::unordered_map<G_key, cln::cl_N, G_key_hash> values;
+};
+
+// the cache of the running evalf_polylogs(), if any
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+thread_local G_cache_t* G_cache = 0;
+#else
+G_cache_t* G_cache = 0;
+#endif
+
 // do acceleration transformation (hoelder convolution [BBB])
 // the parameter x, s and y must only contain numerics
 static cln::cl_N
@@ -1122,11 +1177,11 @@ G_do_trafo(const std::vector<cln::cl_N>& x, const std::vector<int>& s,
 	return ret;
 }
 
-// handles the transformations and the numerical evaluation of G
+// numerical evaluation of G without G_cache
 // the parameter x, s and y must only contain numerics
 static cln::cl_N
-G_numeric(const std::vector<cln::cl_N>& x, const std::vector<int>& s,
-	  const cln::cl_N& y)
+G_numeric_do(const std::vector<cln::cl_N>& x, const std::vector<int>& s,
+	     const cln::cl_N& y)
 {
 	// check for convergence and necessary accelerations
 	bool need_trafo = false;
@@ -1181,6 +1236,25 @@ G_numeric(const std::vector<cln::cl_N>& x, const std::vector<int>& s,
 	return sign*multipleLi_do_sum(m, newx);
 }
 
+// handles the transformations and the numerical evaluation of G
+// the parameter x, s and y must only contain numerics
+static cln::cl_N
+G_numeric(const std::vector<cln::cl_N>& x, const std::vector<int>& s,
+	  const cln::cl_N& y)
+{
+	if (!G_cache || G_cache->digits != Digits) {
+		return G_numeric_do(x, s, y);
+	}
+	G_key key(x, s, y);
+	std::unordered_map<G_key, cln::cl_N, G_key_hash>::const_iterator it = G_cache->values.find(key);
+	if (it != G_cache->values.end()) {
+		return it->second;
+	}
+	const cln::cl_N result = G_numeric_do(x, s, y);
+	G_cache->values.insert(std::make_pair(key, result));
+	return result;
+}
+
 
 ex mLi_numeric(const lst& m, const lst& x)
 {
@@ -1730,9 +1804,43 @@ namespace {
 
 // lookup table for special Euler-Zagier-Sums (used for S_n,p(x))
 // see fill_Yn()
-std::vector<std::vector<cln::cl_N> > Yn;
-int ynsize = 0; // number of Yn[]
-int ynlength = 100; // initial length of all Yn[i]
+// The values depend on the precision, so there is one table for each of
+// the most recently used precisions, and switching between them does not
+// throw away the work.
+struct Yn_table {
+	explicit Yn_table(const cln::float_format_t& p) : prec(p), size(0), length(100) {}
+	cln::float_format_t prec;
+	std::vector<std::vector<cln::cl_N> > Yn;
+	int size; // number of Yn[]
+	int length; // length of all Yn[i], initially 100
+};
+
+// maximal number of precisions to keep tables for
+const size_t yn_tables_max = 4;
+
+// most recently used first; like Xn they are kept per thread
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+thread_local std::vector<Yn_table> yn_tables;
+#else
+std::vector<Yn_table> yn_tables;
+#endif
+
+
+// returns the table for the precision prec, which is created if needed
+Yn_table& get_Yn_table(const cln::float_format_t& prec)
+{
+	for (size_t i=0; i<yn_tables.size(); i++) {
+		if (yn_tables[i].prec == prec) {
+			std::rotate(yn_tables.begin(), yn_tables.begin() + i, yn_tables.begin() + i + 1);
+			return yn_tables.front();
+		}
+	}
+	if (yn_tables.size() == yn_tables_max) {
+		yn_tables.pop_back();
+	}
+	yn_tables.insert(yn_tables.begin(), Yn_table(prec));
+	return yn_tables.front();
+}
 
 
 // This function calculates the Y_n. The Y_n are needed for the evaluation of S_{n,p}(x).
@@ -1743,16 +1851,16 @@ int ynlength = 100; // initial length of all Yn[i]
 // The second index in Y_n corresponds to the running index of the outermost sum in the full Z-sum
 // representing S_{n,p}(x).
 // The calculation of Y_n uses the values from Y_{n-1}.
-void fill_Yn(int n, const cln::float_format_t& prec)
+void fill_Yn(Yn_table& t, int n)
 {
-	const int initsize = ynlength;
+	const int initsize = t.length;
 	//const int initsize = initsize_Yn;
-	cln::cl_N one = cln::cl_float(1, prec);
+	cln::cl_N one = cln::cl_float(1, t.prec);
 
 	if (n) {
 		std::vector<cln::cl_N> buf(initsize);
 		std::vector<cln::cl_N>::iterator it = buf.begin();
-		std::vector<cln::cl_N>::iterator itprev = Yn[n-1].begin();
+		std::vector<cln::cl_N>::iterator itprev = t.Yn[n-1].begin();
 		*it = (*itprev) / cln::cl_N(n+1) * one;
 		it++;
 		itprev++;
@@ -1763,7 +1871,7 @@ void fill_Yn(int n, const cln::float_format_t& prec)
 			it++;
 			itprev++;
 		}
-		Yn.push_back(buf);
+		t.Yn.push_back(buf);
 	} else {
 		std::vector<cln::cl_N> buf(initsize);
 		std::vector<cln::cl_N>::iterator it = buf.begin();
@@ -1773,40 +1881,40 @@ void fill_Yn(int n, const cln::float_format_t& prec)
 			*it = *(it-1) + 1 / cln::cl_N(i) * one;
 			it++;
 		}
-		Yn.push_back(buf);
+		t.Yn.push_back(buf);
 	}
-	ynsize++;
+	t.size++;
 }
 
 
 // make Yn longer ...
-void make_Yn_longer(int newsize, const cln::float_format_t& prec)
+void make_Yn_longer(Yn_table& t, int newsize)
 {
 
-	cln::cl_N one = cln::cl_float(1, prec);
+	cln::cl_N one = cln::cl_float(1, t.prec);
 
-	Yn[0].resize(newsize);
-	std::vector<cln::cl_N>::iterator it = Yn[0].begin();
-	it += ynlength;
-	for (int i=ynlength+1; i<=newsize; i++) {
+	t.Yn[0].resize(newsize);
+	std::vector<cln::cl_N>::iterator it = t.Yn[0].begin();
+	it += t.length;
+	for (int i=t.length+1; i<=newsize; i++) {
 		*it = *(it-1) + 1 / cln::cl_N(i) * one;
 		it++;
 	}
 
-	for (int n=1; n<ynsize; n++) {
-		Yn[n].resize(newsize);
-		std::vector<cln::cl_N>::iterator it = Yn[n].begin();
-		std::vector<cln::cl_N>::iterator itprev = Yn[n-1].begin();
-		it += ynlength;
-		itprev += ynlength;
-		for (int i=ynlength+n+1; i<=newsize+n; i++) {
+	for (int n=1; n<t.size; n++) {
+		t.Yn[n].resize(newsize);
+		std::vector<cln::cl_N>::iterator it = t.Yn[n].begin();
+		std::vector<cln::cl_N>::iterator itprev = t.Yn[n-1].begin();
+		it += t.length;
+		itprev += t.length;
+		for (int i=t.length+n+1; i<=newsize+n; i++) {
 			*it = *(it-1) + (*itprev) / cln::cl_N(i) * one;
 			it++;
 			itprev++;
 		}
 	}
 
-	ynlength = newsize;
+	t.length = newsize;
 }
 
 
@@ -1821,10 +1929,10 @@ cln::cl_N C(int n, int p)
 			if (k == 0) {
 				if (n & 1) {
 					if (j & 1) {
-						result = result - 2 * cln::expt(cln::pi(),2*j) * S_num(n-2*j,p,1) / cln::factorial(2*j);
+						result = result - 2 * cln::expt(cln::pi(cln::float_format(Digits)),2*j) * S_num(n-2*j,p,1) / cln::factorial(2*j);
 					}
 					else {
-						result = result + 2 * cln::expt(cln::pi(),2*j) * S_num(n-2*j,p,1) / cln::factorial(2*j);
+						result = result + 2 * cln::expt(cln::pi(cln::float_format(Digits)),2*j) * S_num(n-2*j,p,1) / cln::factorial(2*j);
 					}
 				}
 			}
@@ -1832,23 +1940,23 @@ cln::cl_N C(int n, int p)
 				if (k & 1) {
 					if (j & 1) {
 						result = result + cln::factorial(n+k-1)
-						                  * cln::expt(cln::pi(),2*j) * S_num(n+k-2*j,p-k,1)
+						                  * cln::expt(cln::pi(cln::float_format(Digits)),2*j) * S_num(n+k-2*j,p-k,1)
 						                  / (cln::factorial(k) * cln::factorial(n-1) * cln::factorial(2*j));
 					}
 					else {
 						result = result - cln::factorial(n+k-1)
-						                  * cln::expt(cln::pi(),2*j) * S_num(n+k-2*j,p-k,1)
+						                  * cln::expt(cln::pi(cln::float_format(Digits)),2*j) * S_num(n+k-2*j,p-k,1)
 						                  / (cln::factorial(k) * cln::factorial(n-1) * cln::factorial(2*j));
 					}
 				}
 				else {
 					if (j & 1) {
-						result = result - cln::factorial(n+k-1) * cln::expt(cln::pi(),2*j) * S_num(n+k-2*j,p-k,1)
+						result = result - cln::factorial(n+k-1) * cln::expt(cln::pi(cln::float_format(Digits)),2*j) * S_num(n+k-2*j,p-k,1)
 						                  / (cln::factorial(k) * cln::factorial(n-1) * cln::factorial(2*j));
 					}
 					else {
 						result = result + cln::factorial(n+k-1)
-						                  * cln::expt(cln::pi(),2*j) * S_num(n+k-2*j,p-k,1)
+						                  * cln::expt(cln::pi(cln::float_format(Digits)),2*j) * S_num(n+k-2*j,p-k,1)
 						                  / (cln::factorial(k) * cln::factorial(n-1) * cln::factorial(2*j));
 					}
 				}
@@ -1858,10 +1966,10 @@ cln::cl_N C(int n, int p)
 	int np = n+p;
 	if ((np-1) & 1) {
 		if (((np)/2+n) & 1) {
-			result = -result - cln::expt(cln::pi(),np) / (np * cln::factorial(n-1) * cln::factorial(p));
+			result = -result - cln::expt(cln::pi(cln::float_format(Digits)),np) / (np * cln::factorial(n-1) * cln::factorial(p));
 		}
 		else {
-			result = -result + cln::expt(cln::pi(),np) / (np * cln::factorial(n-1) * cln::factorial(p));
+			result = -result + cln::expt(cln::pi(cln::float_format(Digits)),np) / (np * cln::factorial(n-1) * cln::factorial(p));
 		}
 	}
 
@@ -1881,7 +1989,7 @@ cln::cl_N a_k(int k)
 
 	result = result;
 	for (int m=2; m<=k; m++) {
-		result = result + cln::expt(cln::cl_N(-1),m) * cln::zeta(m) * a_k(k-m);
+		result = result + cln::expt(cln::cl_N(-1),m) * cln::zeta(m, cln::float_format(Digits)) * a_k(k-m);
 	}
 
 	return -result / k;
@@ -1900,7 +2008,7 @@ cln::cl_N b_k(int k)
 
 	result = result;
 	for (int m=2; m<=k; m++) {
-		result = result + cln::expt(cln::cl_N(-1),m) * cln::zeta(m) * b_k(k-m);
+		result = result + cln::expt(cln::cl_N(-1),m) * cln::zeta(m, cln::float_format(Digits)) * b_k(k-m);
 	}
 
 	return result / k;
@@ -1910,24 +2018,16 @@ cln::cl_N b_k(int k)
 // helper function for S(n,p,x)
 cln::cl_N S_do_sum(int n, int p, const cln::cl_N& x, const cln::float_format_t& prec)
 {
-	static cln::float_format_t oldprec = cln::default_float_format;
-
 	if (p==1) {
 		return Li_projection(n+1, x, prec);
 	}
 
-	// precision has changed, we need to clear lookup table Yn
-	if ( oldprec != prec ) {
-		Yn.clear();
-		ynsize = 0;
-		ynlength = 100;
-		oldprec = prec;
-	}
+	Yn_table& t = get_Yn_table(prec);
 
 	// check if precalculated values are sufficient
-	if (p > ynsize+1) {
-		for (int i=ynsize; i<p-1; i++) {
-			fill_Yn(i, prec);
+	if (p > t.size+1) {
+		for (int i=t.size; i<p-1; i++) {
+			fill_Yn(t, i);
 		}
 	}
 
@@ -1942,11 +2042,11 @@ cln::cl_N S_do_sum(int n, int p, const cln::cl_N& x, const cln::float_format_t&
 	int i = p;
 	do {
 		resbuf = res;
-		if (i-p >= ynlength) {
+		if (i-p >= t.length) {
 			// make Yn longer
-			make_Yn_longer(ynlength*2, prec);
+			make_Yn_longer(t, t.length*2);
 		}
-		res = res + factor / cln::expt(cln::cl_I(i),n+1) * Yn[p-2][i-p]; // should we check it? or rely on magic number? ...
+		res = res + factor / cln::expt(cln::cl_I(i),n+1) * t.Yn[p-2][i-p]; // should we check it? or rely on magic number? ...
 		//res = res + factor / cln::expt(cln::cl_I(i),n+1) * (*it); // should we check it? or rely on magic number? ...
 		factor = factor * xf;
 		i++;
@@ -2017,7 +2117,7 @@ const cln::cl_N S_num(int n, int p, const cln::cl_N& x)
 
 	// what is the desired float format?
 	// first guess: default format
-	cln::float_format_t prec = cln::default_float_format;
+	cln::float_format_t prec = cln::float_format(Digits);
 	const cln::cl_N value = x;
 	// second guess: the argument's format
 	if (!instanceof(realpart(value), cln::cl_RA_ring))
@@ -2076,6 +2176,46 @@ const cln::cl_N S_num(int n, int p, const cln::cl_N& x)
 } // end of anonymous namespace
 
 
+void prepare_polylog_tables(int weight)
+{
+	if (xnsize == 0) {
+		fill_Xn(0);
+	}
+	for (int i=xnsize; i<weight-1; i++) {
+		fill_Xn(i);
+	}
+	Yn_table& t = get_Yn_table(cln::float_format(Digits));
+	for (int i=t.size; i<weight-1; i++) {
+		fill_Yn(t, i);
+	}
+}
+
+
+namespace {
+
+// installs a G_cache for the lifetime of the object
+struct G_cache_scope {
+	G_cache_scope() : cache(Digits), saved(G_cache) { G_cache = &cache; }
+	~G_cache_scope() { G_cache = saved; }
+	G_cache_t cache;
+	G_cache_t* saved;
+};
+
+} // end of anonymous namespace
+
+
+exvector evalf_polylogs(const exvector& v)
+{
+	G_cache_scope scope;
+	exvector result;
+	result.reserve(v.size());
+	for (exvector::const_iterator it = v.begin(); it != v.end(); ++it) {
+		result.push_back(it->evalf());
+	}
+	return result;
+}
+
+
 //////////////////////////////////////////////////////////////////////
 //
 // Nielsen's generalized polylogarithm  S(n,p,x)
@@ -3783,6 +3923,108 @@ cln::cl_N zeta_do_Hoelder_convolution(const std::vector<int>& m_, const std::vec
 }
 
 
+// the numerical values of the multiple zeta values computed so far, for
+// one precision; like Xn they are kept per thread
+struct mzv_cache_t {
+	mzv_cache_t() : digits(0) {}
+	long digits; // the values are only valid for this precision
+	std::map<std::vector<int>, cln::cl_N> values;
+};
+
+// maximal number of values to keep
+const size_t mzv_cache_max = 1024;
+
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+thread_local mzv_cache_t mzv_cache;
+#else
+mzv_cache_t mzv_cache;
+#endif
+
+
+// numerical value of the convergent multiple zeta value zeta(r)
+cln::cl_N mzv_value(const std::vector<int>& r)
+{
+	if (mzv_cache.digits != long(Digits)) {
+		mzv_cache.values.clear();
+		mzv_cache.digits = Digits;
+	}
+	std::map<std::vector<int>, cln::cl_N>::const_iterator it = mzv_cache.values.find(r);
+	if (it != mzv_cache.values.end()) {
+		return it->second;
+	}
+
+	// decide on summation algorithm
+	// this is still a bit clumsy
+	const int count = r.size();
+	int limit = (Digits>17) ? 10 : 6;
+	cln::cl_N res;
+	if ((r[0] < limit) || ((count > 3) && (r[1] < limit/2))) {
+		res = zeta_do_sum_Crandall(r);
+	} else {
+		res = zeta_do_sum_simple(r);
+	}
+	if (mzv_cache.values.size() < mzv_cache_max) {
+		mzv_cache.values[r] = res;
+	}
+	return res;
+}
+
+
+// dual of the convergent index r: with x0^(r_i-1)*x1 for every r_i, the
+// word of r is reversed and x0 and x1 are exchanged, see [BBB] (6.7)
+std::vector<int> mzv_dual(const std::vector<int>& r)
+{
+	std::vector<bool> word; // true for x0
+	for (std::size_t i=0; i<r.size(); ++i) {
+		word.insert(word.end(), r[i]-1, true);
+		word.push_back(false);
+	}
+	std::vector<int> d;
+	int n = 1;
+	for (std::vector<bool>::reverse_iterator it=word.rbegin(); it!=word.rend(); ++it) {
+		if (*it) {
+			// x0 becomes x1, which ends an index
+			d.push_back(n);
+			n = 1;
+		} else {
+			n++;
+		}
+	}
+	return d;
+}
+
+
+// exact value of the convergent multiple zeta value zeta(r) in terms of
+// single zeta values, for the families where it is known in closed form
+bool mzv_reduce(const std::vector<int>& r, ex& result)
+{
+	if (r.size() == 1) {
+		result = zeta(r[0]);
+		return true;
+	}
+
+	// zeta(2,...,2) with k twos is Pi^(2k)/(2k+1)!
+	if (std::count(r.begin(), r.end(), 2) == (std::ptrdiff_t)r.size()) {
+		const int k = r.size();
+		result = pow(Pi, 2*k) / factorial(2*k+1);
+		return true;
+	}
+
+	// Euler: zeta(n,1) = n/2*zeta(n+1) - 1/2*sum(zeta(n-k)*zeta(k+1), k=1..n-2)
+	if (r.size() == 2 && r[1] == 1) {
+		const int n = r[0];
+		ex sum = numeric(n, 2) * zeta(n+1);
+		for (int k=1; k<=n-2; ++k) {
+			sum -= zeta(n-k) * zeta(k+1) / 2;
+		}
+		result = sum;
+		return true;
+	}
+
+	return false;
+}
+
+
 } // end of anonymous namespace
 
 
@@ -3821,14 +4063,7 @@ static ex zeta1_evalf(const ex& x)
 			return zeta(x).hold();
 		}
 
-		// decide on summation algorithm
-		// this is still a bit clumsy
-		int limit = (Digits>17) ? 10 : 6;
-		if ((r[0] < limit) || ((count > 3) && (r[1] < limit/2))) {
-			return numeric(zeta_do_sum_Crandall(r));
-		} else {
-			return numeric(zeta_do_sum_simple(r));
-		}
+		return numeric(mzv_value(r));
 	}
 
 	// single zeta value
@@ -3848,6 +4083,18 @@ static ex zeta1_eval(const ex& m)
 		if (m.nops() == 1) {
 			return zeta(m.op(0));
 		}
+		std::vector<int> r;
+		for (std::size_t i=0; i<m.nops(); ++i) {
+			if (!m.op(i).info(info_flags::posint)) {
+				return zeta(m).hold();
+			}
+			r.push_back(ex_to<numeric>(m.op(i)).to_int());
+		}
+		// known closed forms of the value or of its dual
+		ex result;
+		if (r[0] > 1 && (mzv_reduce(r, result) || mzv_reduce(mzv_dual(r), result))) {
+			return result;
+		}
 		return zeta(m).hold();
 	}
 
@@ -25,6 +25,7 @@
 #include "ex.h"
 #include "constant.h"
 #include "numeric.h"
+#include "mul.h"
 #include "power.h"
 #include "operators.h"
 #include "relational.h"
@@ -32,11 +33,70 @@
 #include "pseries.h"
 #include "utils.h"
 
+#include <cmath>
+#include <complex>
 #include <stdexcept>
 #include <vector>
 
 namespace GiNaC {
 
+/** Check whether x is c*Pi with an exact, possibly complex rational number
+ *  c (zero included), the only arguments for which the functions below
+ *  have exact special values. This looks at the form of x instead of building and evaluating
+ *  x/Pi on every call. */
+static bool is_rational_multiple_of_Pi(const ex & x, numeric & c)
+{
+	if (is_exactly_a<numeric>(x)) {
+		if (!x.is_zero() || !ex_to<numeric>(x).is_rational())
+			return false;
+		c = *_num0_p;
+		return true;
+	}
+	if (is_exactly_a<constant>(x) && x.is_equal(Pi)) {
+		c = *_num1_p;
+		return true;
+	}
+	if (is_exactly_a<mul>(x) && x.nops() == 2 && x.op(0).is_equal(Pi)
+	 && is_exactly_a<numeric>(x.op(1)) && ex_to<numeric>(x.op(1)).is_crational()) {
+		c = ex_to<numeric>(x.op(1));
+		return true;
+	}
+	return false;
+}
+
+namespace {
+
+/** Exact values of a trigonometric function at the multiples k*Pi/60 of Pi,
+ *  computed once for k = 0...119 from the rules of the function. */
+class trig_special_values {
+public:
+	enum kind { none, value, pole };
+	typedef kind (*rules)(const numeric & k, ex & v);
+
+	explicit trig_special_values(rules special_value)
+	{
+		for (int k = 0; k < 120; ++k)
+			kinds[k] = special_value(numeric(k), values[k]);
+	}
+
+	/** Look up the value at c*Pi. */
+	kind lookup(const numeric & c, ex & v) const
+	{
+		const numeric k = c.mul(*_num60_p);
+		if (!k.is_integer())
+			return none;
+		const int i = mod(k, *_num120_p).to_int();
+		v = values[i];
+		return kinds[i];
+	}
+
+private:
+	ex values[120];
+	kind kinds[120];
+};
+
+} // anonymous namespace
+
 //////////
 // exponential function
 //////////
@@ -49,25 +109,41 @@ static ex exp_evalf(const ex & x)
 	return exp(x).hold();
 }
 
+static bool exp_evalf_double(const std::complex<double> * x, std::complex<double> & r)
+{
+	if (x[0].imag() == 0)
+		r = std::exp(x[0].real());
+	else
+		r = std::exp(x[0]);
+	return true;
+}
+
 static ex exp_eval(const ex & x)
 {
+	// exp(symbol) stays as it is
+	if (is_a<symbol>(x))
+		return exp(x).hold();
+
 	// exp(0) -> 1
 	if (x.is_zero()) {
 		return _ex1;
 	}
 
 	// exp(n*Pi*I/2) -> {+1|+I|-1|-I}
-	const ex TwoExOverPiI=(_ex2*x)/(Pi*I);
-	if (TwoExOverPiI.info(info_flags::integer)) {
-		const numeric z = mod(ex_to<numeric>(TwoExOverPiI),*_num4_p);
-		if (z.is_equal(*_num0_p))
-			return _ex1;
-		if (z.is_equal(*_num1_p))
-			return ex(I);
-		if (z.is_equal(*_num2_p))
-			return _ex_1;
-		if (z.is_equal(*_num3_p))
-			return ex(-I);
+	numeric c;
+	if (is_rational_multiple_of_Pi(x, c)) {
+		const numeric TwoCOverI = c.mul(*_num2_p).div(I);
+		if (TwoCOverI.is_integer()) {
+			const numeric z = mod(TwoCOverI, *_num4_p);
+			if (z.is_equal(*_num0_p))
+				return _ex1;
+			if (z.is_equal(*_num1_p))
+				return ex(I);
+			if (z.is_equal(*_num2_p))
+				return _ex_1;
+			if (z.is_equal(*_num3_p))
+				return ex(-I);
+		}
 	}
 
 	// exp(log(x)) -> x
@@ -105,9 +181,30 @@ static ex exp_conjugate(const ex & x)
 	return exp(x.conjugate());
 }
 
+static ex exp_series(const ex & arg,
+                     const relational & rel,
+                     int order,
+                     unsigned options)
+{
+	GINAC_ASSERT(is_a<symbol>(rel.lhs()));
+	if (order <= 0 || !arg.has(rel.lhs()))
+		throw do_taylor();  // caught by function::series()
+
+	// method:
+	// Series expand the argument and compute exp() of that series by Newton
+	// iteration, rather than differentiating exp(arg) over and over again.
+	// At a pole of the argument, the Taylor expansion fails as it should.
+	const pseries argser = ex_to<pseries>(arg.series(rel, order, options));
+	if (argser.nops() > 0 && ex_to<numeric>(argser.exponop(0)).is_negative())
+		throw do_taylor();
+	return argser.exp_series(order);
+}
+
 REGISTER_FUNCTION(exp, eval_func(exp_eval).
                        evalf_func(exp_evalf).
+                       evalf_double_func(exp_evalf_double).
                        derivative_func(exp_deriv).
+                       series_func(exp_series).
                        real_part_func(exp_real_part).
                        imag_part_func(exp_imag_part).
                        conjugate_func(exp_conjugate).
@@ -125,8 +222,25 @@ static ex log_evalf(const ex & x)
 	return log(x).hold();
 }
 
+static bool log_evalf_double(const std::complex<double> * x, std::complex<double> & r)
+{
+	if (x[0].imag() != 0)
+		r = std::log(x[0]);
+	else if (x[0].real() > 0)
+		r = std::log(x[0].real());
+	else if (x[0].real() < 0)
+		r = std::log(x[0]);
+	else
+		return false;
+	return true;
+}
+
 static ex log_eval(const ex & x)
 {
+	// log(symbol) stays as it is
+	if (is_a<symbol>(x))
+		return log(x).hold();
+
 	if (x.info(info_flags::numeric)) {
 		if (x.is_zero())         // log(0) -> infinity
 			throw(pole_error("log_eval(): log(0)",0));
@@ -213,22 +327,8 @@ static ex log_series(const ex &arg,
 		if (!argser.is_terminating() || argser.nops()!=1) {
 			// in this case n more (or less) terms are needed
 			// (sadly, to generate them, we have to start from the beginning)
-			if (n == 0 && coeff == 1) {
-				epvector epv;
-				ex acc = (new pseries(rel, epv))->setflag(status_flags::dynallocated);
-				epv.reserve(2);
-				epv.push_back(expair(-1, _ex0));
-				epv.push_back(expair(Order(_ex1), order));
-				ex rest = pseries(rel, epv).add_series(argser);
-				for (int i = order-1; i>0; --i) {
-					epvector cterm;
-					cterm.reserve(1);
-					cterm.push_back(expair(i%2 ? _ex1/i : _ex_1/i, _ex0));
-					acc = pseries(rel, cterm).add_series(ex_to<pseries>(acc));
-					acc = (ex_to<pseries>(rest)).mul_series(ex_to<pseries>(acc));
-				}
-				return acc;
-			}
+			if (n == 0 && coeff == 1)
+				return argser.log_series(order);
 			const ex newarg = ex_to<pseries>((arg/coeff).series(rel, order+n, options)).shift_exponents(-n).convert_to_poly(true);
 			return pseries(rel, seq).add_series(ex_to<pseries>(log(newarg).series(rel, order, options)));
 		} else  // it was a monomial
@@ -248,7 +348,15 @@ static ex log_series(const ex &arg,
 		seq.push_back(expair(Order(_ex1), order));
 		return series(replarg - I*Pi + pseries(rel, seq), rel, order);
 	}
-	throw do_taylor();  // caught by function::series()
+	if (order <= 0 || !arg.has(rel.lhs()))
+		throw do_taylor();  // caught by function::series()
+	// method:
+	// Taylor expansion as the integral of the series of arg'/arg, rather
+	// than differentiating log(arg) over and over again.
+	const pseries argser = ex_to<pseries>(arg.series(rel, order, options));
+	if (argser.nops() == 0 || !argser.exponop(0).is_zero() || is_order_function(argser.coeffop(0)))
+		throw do_taylor();
+	return argser.log_series(order);
 }
 
 static ex log_real_part(const ex & x)
@@ -281,6 +389,7 @@ static ex log_conjugate(const ex & x)
 
 REGISTER_FUNCTION(log, eval_func(log_eval).
                        evalf_func(log_evalf).
+                       evalf_double_func(log_evalf_double).
                        derivative_func(log_deriv).
                        series_func(log_series).
                        real_part_func(log_real_part).
@@ -300,40 +409,65 @@ static ex sin_evalf(const ex & x)
 	return sin(x).hold();
 }
 
-static ex sin_eval(const ex & x)
+static bool sin_evalf_double(const std::complex<double> * x, std::complex<double> & r)
+{
+	if (x[0].imag() == 0)
+		r = std::sin(x[0].real());
+	else
+		r = std::sin(x[0]);
+	return true;
+}
+
+/** Exact values of sin(k*Pi/60). */
+static trig_special_values::kind sin_special_value(const numeric & k, ex & v)
 {
 	// sin(n/d*Pi) -> { all known non-nested radicals }
-	const ex SixtyExOverPi = _ex60*x/Pi;
+	numeric z = k;
 	ex sign = _ex1;
-	if (SixtyExOverPi.info(info_flags::integer)) {
-		numeric z = mod(ex_to<numeric>(SixtyExOverPi),*_num120_p);
-		if (z>=*_num60_p) {
-			// wrap to interval [0, Pi)
-			z -= *_num60_p;
-			sign = _ex_1;
-		}
-		if (z>*_num30_p) {
-			// wrap to interval [0, Pi/2)
-			z = *_num60_p-z;
-		}
-		if (z.is_equal(*_num0_p))  // sin(0)       -> 0
-			return _ex0;
-		if (z.is_equal(*_num5_p))  // sin(Pi/12)   -> sqrt(6)/4*(1-sqrt(3)/3)
-			return sign*_ex1_4*sqrt(_ex6)*(_ex1+_ex_1_3*sqrt(_ex3));
-		if (z.is_equal(*_num6_p))  // sin(Pi/10)   -> sqrt(5)/4-1/4
-			return sign*(_ex1_4*sqrt(_ex5)+_ex_1_4);
-		if (z.is_equal(*_num10_p)) // sin(Pi/6)    -> 1/2
-			return sign*_ex1_2;
-		if (z.is_equal(*_num15_p)) // sin(Pi/4)    -> sqrt(2)/2
-			return sign*_ex1_2*sqrt(_ex2);
-		if (z.is_equal(*_num18_p)) // sin(3/10*Pi) -> sqrt(5)/4+1/4
-			return sign*(_ex1_4*sqrt(_ex5)+_ex1_4);
-		if (z.is_equal(*_num20_p)) // sin(Pi/3)    -> sqrt(3)/2
-			return sign*_ex1_2*sqrt(_ex3);
-		if (z.is_equal(*_num25_p)) // sin(5/12*Pi) -> sqrt(6)/4*(1+sqrt(3)/3)
-			return sign*_ex1_4*sqrt(_ex6)*(_ex1+_ex1_3*sqrt(_ex3));
-		if (z.is_equal(*_num30_p)) // sin(Pi/2)    -> 1
-			return sign;
+	if (z>=*_num60_p) {
+		// wrap to interval [0, Pi)
+		z -= *_num60_p;
+		sign = _ex_1;
+	}
+	if (z>*_num30_p) {
+		// wrap to interval [0, Pi/2)
+		z = *_num60_p-z;
+	}
+	if (z.is_equal(*_num0_p))       // sin(0)       -> 0
+		v = _ex0;
+	else if (z.is_equal(*_num5_p))  // sin(Pi/12)   -> sqrt(6)/4*(1-sqrt(3)/3)
+		v = sign*_ex1_4*sqrt(_ex6)*(_ex1+_ex_1_3*sqrt(_ex3));
+	else if (z.is_equal(*_num6_p))  // sin(Pi/10)   -> sqrt(5)/4-1/4
+		v = sign*(_ex1_4*sqrt(_ex5)+_ex_1_4);
+	else if (z.is_equal(*_num10_p)) // sin(Pi/6)    -> 1/2
+		v = sign*_ex1_2;
+	else if (z.is_equal(*_num15_p)) // sin(Pi/4)    -> sqrt(2)/2
+		v = sign*_ex1_2*sqrt(_ex2);
+	else if (z.is_equal(*_num18_p)) // sin(3/10*Pi) -> sqrt(5)/4+1/4
+		v = sign*(_ex1_4*sqrt(_ex5)+_ex1_4);
+	else if (z.is_equal(*_num20_p)) // sin(Pi/3)    -> sqrt(3)/2
+		v = sign*_ex1_2*sqrt(_ex3);
+	else if (z.is_equal(*_num25_p)) // sin(5/12*Pi) -> sqrt(6)/4*(1+sqrt(3)/3)
+		v = sign*_ex1_4*sqrt(_ex6)*(_ex1+_ex1_3*sqrt(_ex3));
+	else if (z.is_equal(*_num30_p)) // sin(Pi/2)    -> 1
+		v = sign;
+	else
+		return trig_special_values::none;
+	return trig_special_values::value;
+}
+
+static ex sin_eval(const ex & x)
+{
+	// sin(symbol) stays as it is
+	if (is_a<symbol>(x))
+		return sin(x).hold();
+
+	numeric c;
+	if (is_rational_multiple_of_Pi(x, c)) {
+		static const trig_special_values table(sin_special_value);
+		ex v;
+		if (table.lookup(c, v) == trig_special_values::value)
+			return v;
 	}
 
 	if (is_exactly_a<function>(x)) {
@@ -389,6 +523,7 @@ static ex sin_conjugate(const ex & x)
 
 REGISTER_FUNCTION(sin, eval_func(sin_eval).
                        evalf_func(sin_evalf).
+                       evalf_double_func(sin_evalf_double).
                        derivative_func(sin_deriv).
                        real_part_func(sin_real_part).
                        imag_part_func(sin_imag_part).
@@ -407,40 +542,65 @@ static ex cos_evalf(const ex & x)
 	return cos(x).hold();
 }
 
-static ex cos_eval(const ex & x)
+static bool cos_evalf_double(const std::complex<double> * x, std::complex<double> & r)
+{
+	if (x[0].imag() == 0)
+		r = std::cos(x[0].real());
+	else
+		r = std::cos(x[0]);
+	return true;
+}
+
+/** Exact values of cos(k*Pi/60). */
+static trig_special_values::kind cos_special_value(const numeric & k, ex & v)
 {
 	// cos(n/d*Pi) -> { all known non-nested radicals }
-	const ex SixtyExOverPi = _ex60*x/Pi;
+	numeric z = k;
 	ex sign = _ex1;
-	if (SixtyExOverPi.info(info_flags::integer)) {
-		numeric z = mod(ex_to<numeric>(SixtyExOverPi),*_num120_p);
-		if (z>=*_num60_p) {
-			// wrap to interval [0, Pi)
-			z = *_num120_p-z;
-		}
-		if (z>=*_num30_p) {
-			// wrap to interval [0, Pi/2)
-			z = *_num60_p-z;
-			sign = _ex_1;
-		}
-		if (z.is_equal(*_num0_p))  // cos(0)       -> 1
-			return sign;
-		if (z.is_equal(*_num5_p))  // cos(Pi/12)   -> sqrt(6)/4*(1+sqrt(3)/3)
-			return sign*_ex1_4*sqrt(_ex6)*(_ex1+_ex1_3*sqrt(_ex3));
-		if (z.is_equal(*_num10_p)) // cos(Pi/6)    -> sqrt(3)/2
-			return sign*_ex1_2*sqrt(_ex3);
-		if (z.is_equal(*_num12_p)) // cos(Pi/5)    -> sqrt(5)/4+1/4
-			return sign*(_ex1_4*sqrt(_ex5)+_ex1_4);
-		if (z.is_equal(*_num15_p)) // cos(Pi/4)    -> sqrt(2)/2
-			return sign*_ex1_2*sqrt(_ex2);
-		if (z.is_equal(*_num20_p)) // cos(Pi/3)    -> 1/2
-			return sign*_ex1_2;
-		if (z.is_equal(*_num24_p)) // cos(2/5*Pi)  -> sqrt(5)/4-1/4x
-			return sign*(_ex1_4*sqrt(_ex5)+_ex_1_4);
-		if (z.is_equal(*_num25_p)) // cos(5/12*Pi) -> sqrt(6)/4*(1-sqrt(3)/3)
-			return sign*_ex1_4*sqrt(_ex6)*(_ex1+_ex_1_3*sqrt(_ex3));
-		if (z.is_equal(*_num30_p)) // cos(Pi/2)    -> 0
-			return _ex0;
+	if (z>=*_num60_p) {
+		// wrap to interval [0, Pi)
+		z = *_num120_p-z;
+	}
+	if (z>=*_num30_p) {
+		// wrap to interval [0, Pi/2)
+		z = *_num60_p-z;
+		sign = _ex_1;
+	}
+	if (z.is_equal(*_num0_p))       // cos(0)       -> 1
+		v = sign;
+	else if (z.is_equal(*_num5_p))  // cos(Pi/12)   -> sqrt(6)/4*(1+sqrt(3)/3)
+		v = sign*_ex1_4*sqrt(_ex6)*(_ex1+_ex1_3*sqrt(_ex3));
+	else if (z.is_equal(*_num10_p)) // cos(Pi/6)    -> sqrt(3)/2
+		v = sign*_ex1_2*sqrt(_ex3);
+	else if (z.is_equal(*_num12_p)) // cos(Pi/5)    -> sqrt(5)/4+1/4
+		v = sign*(_ex1_4*sqrt(_ex5)+_ex1_4);
+	else if (z.is_equal(*_num15_p)) // cos(Pi/4)    -> sqrt(2)/2
+		v = sign*_ex1_2*sqrt(_ex2);
+	else if (z.is_equal(*_num20_p)) // cos(Pi/3)    -> 1/2
+		v = sign*_ex1_2;
+	else if (z.is_equal(*_num24_p)) // cos(2/5*Pi)  -> sqrt(5)/4-1/4x
+		v = sign*(_ex1_4*sqrt(_ex5)+_ex_1_4);
+	else if (z.is_equal(*_num25_p)) // cos(5/12*Pi) -> sqrt(6)/4*(1-sqrt(3)/3)
+		v = sign*_ex1_4*sqrt(_ex6)*(_ex1+_ex_1_3*sqrt(_ex3));
+	else if (z.is_equal(*_num30_p)) // cos(Pi/2)    -> 0
+		v = _ex0;
+	else
+		return trig_special_values::none;
+	return trig_special_values::value;
+}
+
+static ex cos_eval(const ex & x)
+{
+	// cos(symbol) stays as it is
+	if (is_a<symbol>(x))
+		return cos(x).hold();
+
+	numeric c;
+	if (is_rational_multiple_of_Pi(x, c)) {
+		static const trig_special_values table(cos_special_value);
+		ex v;
+		if (table.lookup(c, v) == trig_special_values::value)
+			return v;
 	}
 
 	if (is_exactly_a<function>(x)) {
@@ -496,6 +656,7 @@ static ex cos_conjugate(const ex & x)
 
 REGISTER_FUNCTION(cos, eval_func(cos_eval).
                        evalf_func(cos_evalf).
+                       evalf_double_func(cos_evalf_double).
                        derivative_func(cos_deriv).
                        real_part_func(cos_real_part).
                        imag_part_func(cos_imag_part).
@@ -514,36 +675,63 @@ static ex tan_evalf(const ex & x)
 	return tan(x).hold();
 }
 
-static ex tan_eval(const ex & x)
+static bool tan_evalf_double(const std::complex<double> * x, std::complex<double> & r)
+{
+	if (x[0].imag() == 0)
+		r = std::tan(x[0].real());
+	else
+		r = std::tan(x[0]);
+	return true;
+}
+
+/** Exact values of tan(k*Pi/60). */
+static trig_special_values::kind tan_special_value(const numeric & k, ex & v)
 {
 	// tan(n/d*Pi) -> { all known non-nested radicals }
-	const ex SixtyExOverPi = _ex60*x/Pi;
+	numeric z = mod(k, *_num60_p);
 	ex sign = _ex1;
-	if (SixtyExOverPi.info(info_flags::integer)) {
-		numeric z = mod(ex_to<numeric>(SixtyExOverPi),*_num60_p);
-		if (z>=*_num60_p) {
-			// wrap to interval [0, Pi)
-			z -= *_num60_p;
-		}
-		if (z>=*_num30_p) {
-			// wrap to interval [0, Pi/2)
-			z = *_num60_p-z;
-			sign = _ex_1;
+	if (z>=*_num30_p) {
+		// wrap to interval [0, Pi/2)
+		z = *_num60_p-z;
+		sign = _ex_1;
+	}
+	if (z.is_equal(*_num0_p))       // tan(0)       -> 0
+		v = _ex0;
+	else if (z.is_equal(*_num5_p))  // tan(Pi/12)   -> 2-sqrt(3)
+		v = sign*(_ex2-sqrt(_ex3));
+	else if (z.is_equal(*_num10_p)) // tan(Pi/6)    -> sqrt(3)/3
+		v = sign*_ex1_3*sqrt(_ex3);
+	else if (z.is_equal(*_num15_p)) // tan(Pi/4)    -> 1
+		v = sign;
+	else if (z.is_equal(*_num20_p)) // tan(Pi/3)    -> sqrt(3)
+		v = sign*sqrt(_ex3);
+	else if (z.is_equal(*_num25_p)) // tan(5/12*Pi) -> 2+sqrt(3)
+		v = sign*(sqrt(_ex3)+_ex2);
+	else if (z.is_equal(*_num30_p)) // tan(Pi/2)    -> infinity
+		return trig_special_values::pole;
+	else
+		return trig_special_values::none;
+	return trig_special_values::value;
+}
+
+static ex tan_eval(const ex & x)
+{
+	// tan(symbol) stays as it is
+	if (is_a<symbol>(x))
+		return tan(x).hold();
+
+	numeric c;
+	if (is_rational_multiple_of_Pi(x, c)) {
+		static const trig_special_values table(tan_special_value);
+		ex v;
+		switch (table.lookup(c, v)) {
+			case trig_special_values::value:
+				return v;
+			case trig_special_values::pole:
+				throw (pole_error("tan_eval(): simple pole",1));
+			default:
+				break;
 		}
-		if (z.is_equal(*_num0_p))  // tan(0)       -> 0
-			return _ex0;
-		if (z.is_equal(*_num5_p))  // tan(Pi/12)   -> 2-sqrt(3)
-			return sign*(_ex2-sqrt(_ex3));
-		if (z.is_equal(*_num10_p)) // tan(Pi/6)    -> sqrt(3)/3
-			return sign*_ex1_3*sqrt(_ex3);
-		if (z.is_equal(*_num15_p)) // tan(Pi/4)    -> 1
-			return sign;
-		if (z.is_equal(*_num20_p)) // tan(Pi/3)    -> sqrt(3)
-			return sign*sqrt(_ex3);
-		if (z.is_equal(*_num25_p)) // tan(5/12*Pi) -> 2+sqrt(3)
-			return sign*(sqrt(_ex3)+_ex2);
-		if (z.is_equal(*_num30_p)) // tan(Pi/2)    -> infinity
-			throw (pole_error("tan_eval(): simple pole",1));
 	}
 
 	if (is_exactly_a<function>(x)) {
@@ -620,6 +808,7 @@ static ex tan_conjugate(const ex & x)
 
 REGISTER_FUNCTION(tan, eval_func(tan_eval).
                        evalf_func(tan_evalf).
+                       evalf_double_func(tan_evalf_double).
                        derivative_func(tan_deriv).
                        series_func(tan_series).
                        real_part_func(tan_real_part).
@@ -639,6 +828,18 @@ static ex asin_evalf(const ex & x)
 	return asin(x).hold();
 }
 
+static bool asin_evalf_double(const std::complex<double> * x, std::complex<double> & r)
+{
+	// real arguments on the branch cuts are left to evalf()
+	if (x[0].imag() != 0)
+		r = std::asin(x[0]);
+	else if (std::fabs(x[0].real()) <= 1)
+		r = std::asin(x[0].real());
+	else
+		return false;
+	return true;
+}
+
 static ex asin_eval(const ex & x)
 {
 	if (x.info(info_flags::numeric)) {
@@ -696,6 +897,7 @@ static ex asin_conjugate(const ex & x)
 
 REGISTER_FUNCTION(asin, eval_func(asin_eval).
                         evalf_func(asin_evalf).
+                        evalf_double_func(asin_evalf_double).
                         derivative_func(asin_deriv).
                         conjugate_func(asin_conjugate).
                         latex_name("\\arcsin"));
@@ -712,6 +914,18 @@ static ex acos_evalf(const ex & x)
 	return acos(x).hold();
 }
 
+static bool acos_evalf_double(const std::complex<double> * x, std::complex<double> & r)
+{
+	// real arguments on the branch cuts are left to evalf()
+	if (x[0].imag() != 0)
+		r = std::acos(x[0]);
+	else if (std::fabs(x[0].real()) <= 1)
+		r = std::acos(x[0].real());
+	else
+		return false;
+	return true;
+}
+
 static ex acos_eval(const ex & x)
 {
 	if (x.info(info_flags::numeric)) {
@@ -769,6 +983,7 @@ static ex acos_conjugate(const ex & x)
 
 REGISTER_FUNCTION(acos, eval_func(acos_eval).
                         evalf_func(acos_evalf).
+                        evalf_double_func(acos_evalf_double).
                         derivative_func(acos_deriv).
                         conjugate_func(acos_conjugate).
                         latex_name("\\arccos"));
@@ -785,6 +1000,18 @@ static ex atan_evalf(const ex & x)
 	return atan(x).hold();
 }
 
+static bool atan_evalf_double(const std::complex<double> * x, std::complex<double> & r)
+{
+	// the branch cuts lie on the imaginary axis
+	if (x[0].imag() == 0)
+		r = std::atan(x[0].real());
+	else if (x[0].real() == 0 && std::fabs(x[0].imag()) >= 1)
+		return false;
+	else
+		r = std::atan(x[0]);
+	return true;
+}
+
 static ex atan_eval(const ex & x)
 {
 	if (x.info(info_flags::numeric)) {
@@ -885,6 +1112,7 @@ static ex atan_conjugate(const ex & x)
 
 REGISTER_FUNCTION(atan, eval_func(atan_eval).
                         evalf_func(atan_evalf).
+                        evalf_double_func(atan_evalf_double).
                         derivative_func(atan_deriv).
                         series_func(atan_series).
                         conjugate_func(atan_conjugate).
@@ -902,6 +1130,14 @@ static ex atan2_evalf(const ex &y, const ex &x)
 	return atan2(y, x).hold();
 }
 
+static bool atan2_evalf_double(const std::complex<double> * x, std::complex<double> & r)
+{
+	if (x[0].imag() != 0 || x[1].imag() != 0 || (x[0].real() == 0 && x[1].real() == 0))
+		return false;
+	r = std::atan2(x[0].real(), x[1].real());
+	return true;
+}
+
 static ex atan2_eval(const ex & y, const ex & x)
 {
 	if (y.is_zero()) {
@@ -987,6 +1223,7 @@ static ex atan2_deriv(const ex & y, const ex & x, unsigned deriv_param)
 
 REGISTER_FUNCTION(atan2, eval_func(atan2_eval).
                          evalf_func(atan2_evalf).
+                         evalf_double_func(atan2_evalf_double).
                          derivative_func(atan2_deriv));
 
 //////////
@@ -1001,6 +1238,15 @@ static ex sinh_evalf(const ex & x)
 	return sinh(x).hold();
 }
 
+static bool sinh_evalf_double(const std::complex<double> * x, std::complex<double> & r)
+{
+	if (x[0].imag() == 0)
+		r = std::sinh(x[0].real());
+	else
+		r = std::sinh(x[0]);
+	return true;
+}
+
 static ex sinh_eval(const ex & x)
 {
 	if (x.info(info_flags::numeric)) {
@@ -1067,6 +1313,7 @@ static ex sinh_conjugate(const ex & x)
 
 REGISTER_FUNCTION(sinh, eval_func(sinh_eval).
                         evalf_func(sinh_evalf).
+                        evalf_double_func(sinh_evalf_double).
                         derivative_func(sinh_deriv).
                         real_part_func(sinh_real_part).
                         imag_part_func(sinh_imag_part).
@@ -1085,6 +1332,15 @@ static ex cosh_evalf(const ex & x)
 	return cosh(x).hold();
 }
 
+static bool cosh_evalf_double(const std::complex<double> * x, std::complex<double> & r)
+{
+	if (x[0].imag() == 0)
+		r = std::cosh(x[0].real());
+	else
+		r = std::cosh(x[0]);
+	return true;
+}
+
 static ex cosh_eval(const ex & x)
 {
 	if (x.info(info_flags::numeric)) {
@@ -1151,6 +1407,7 @@ static ex cosh_conjugate(const ex & x)
 
 REGISTER_FUNCTION(cosh, eval_func(cosh_eval).
                         evalf_func(cosh_evalf).
+                        evalf_double_func(cosh_evalf_double).
                         derivative_func(cosh_deriv).
                         real_part_func(cosh_real_part).
                         imag_part_func(cosh_imag_part).
@@ -1169,6 +1426,15 @@ static ex tanh_evalf(const ex & x)
 	return tanh(x).hold();
 }
 
+static bool tanh_evalf_double(const std::complex<double> * x, std::complex<double> & r)
+{
+	if (x[0].imag() == 0)
+		r = std::tanh(x[0].real());
+	else
+		r = std::tanh(x[0]);
+	return true;
+}
+
 static ex tanh_eval(const ex & x)
 {
 	if (x.info(info_flags::numeric)) {
@@ -1255,6 +1521,7 @@ static ex tanh_conjugate(const ex & x)
 
 REGISTER_FUNCTION(tanh, eval_func(tanh_eval).
                         evalf_func(tanh_evalf).
+                        evalf_double_func(tanh_evalf_double).
                         derivative_func(tanh_deriv).
                         series_func(tanh_series).
                         real_part_func(tanh_real_part).
@@ -1274,6 +1541,18 @@ static ex asinh_evalf(const ex & x)
 	return asinh(x).hold();
 }
 
+static bool asinh_evalf_double(const std::complex<double> * x, std::complex<double> & r)
+{
+	// the branch cuts lie on the imaginary axis
+	if (x[0].imag() == 0)
+		r = std::asinh(x[0].real());
+	else if (x[0].real() == 0 && std::fabs(x[0].imag()) >= 1)
+		return false;
+	else
+		r = std::asinh(x[0]);
+	return true;
+}
+
 static ex asinh_eval(const ex & x)
 {
 	if (x.info(info_flags::numeric)) {
@@ -1320,6 +1599,7 @@ static ex asinh_conjugate(const ex & x)
 
 REGISTER_FUNCTION(asinh, eval_func(asinh_eval).
                          evalf_func(asinh_evalf).
+                         evalf_double_func(asinh_evalf_double).
                          derivative_func(asinh_deriv).
                          conjugate_func(asinh_conjugate));
 
@@ -1335,6 +1615,18 @@ static ex acosh_evalf(const ex & x)
 	return acosh(x).hold();
 }
 
+static bool acosh_evalf_double(const std::complex<double> * x, std::complex<double> & r)
+{
+	// real arguments on the branch cuts are left to evalf()
+	if (x[0].imag() != 0)
+		r = std::acosh(x[0]);
+	else if (x[0].real() >= 1)
+		r = std::acosh(x[0].real());
+	else
+		return false;
+	return true;
+}
+
 static ex acosh_eval(const ex & x)
 {
 	if (x.info(info_flags::numeric)) {
@@ -1384,6 +1676,7 @@ static ex acosh_conjugate(const ex & x)
 
 REGISTER_FUNCTION(acosh, eval_func(acosh_eval).
                          evalf_func(acosh_evalf).
+                         evalf_double_func(acosh_evalf_double).
                          derivative_func(acosh_deriv).
                          conjugate_func(acosh_conjugate));
 
@@ -1399,6 +1692,18 @@ static ex atanh_evalf(const ex & x)
 	return atanh(x).hold();
 }
 
+static bool atanh_evalf_double(const std::complex<double> * x, std::complex<double> & r)
+{
+	// real arguments on the branch cuts are left to evalf()
+	if (x[0].imag() != 0)
+		r = std::atanh(x[0]);
+	else if (std::fabs(x[0].real()) < 1)
+		r = std::atanh(x[0].real());
+	else
+		return false;
+	return true;
+}
+
 static ex atanh_eval(const ex & x)
 {
 	if (x.info(info_flags::numeric)) {
@@ -1487,6 +1792,7 @@ static ex atanh_conjugate(const ex & x)
 
 REGISTER_FUNCTION(atanh, eval_func(atanh_eval).
                          evalf_func(atanh_evalf).
+                         evalf_double_func(atanh_evalf_double).
                          derivative_func(atanh_deriv).
                          series_func(atanh_series).
                          conjugate_func(atanh_conjugate));
@@ -33,6 +33,16 @@
 #include "utils.h"
 #include "operators.h"
 #include "relational.h"
+#include "constant.h"
+#include "evalplan.h"
+#include "flags.h"
+#include "parallel.h"
+#include "traversal.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <vector>
 
 using namespace std;
 
@@ -188,7 +198,18 @@ ex integral::evalf(int level) const
 	// results after subsituting a number for the integration variable.
 	if (is_exactly_a<numeric>(ea) && is_exactly_a<numeric>(eb) 
 			&& is_exactly_a<numeric>(ef.subs(x==12.34).evalf())) {
-			return adaptivesimpson(x, ea, eb, ef);
+		switch (integration_method) {
+			case integration_algo::adaptive_simpson:
+				return adaptivesimpson(x, ea, eb, ef);
+			case integration_algo::gauss_kronrod:
+				return gausskronrod(x, ea, eb, ef);
+			case integration_algo::tanh_sinh:
+				return tanhsinh(x, ea, eb, ef);
+			default:
+				if (long(Digits) <= 50)
+					return gausskronrod(x, ea, eb, ef);
+				return tanhsinh(x, ea, eb, ef);
+		}
 	}
 
 	if (are_ex_trivially_equal(a, ea) && are_ex_trivially_equal(b, eb)
@@ -201,99 +222,209 @@ ex integral::evalf(int level) const
 
 int integral::max_integration_level = 15;
 ex integral::relative_integration_error = 1e-8;
+unsigned integral::integration_method = integration_algo::automatic;
 
-ex subsvalue(const ex & var, const ex & value, const ex & fun)
-{
-	ex result = fun.subs(var==value).evalf();
-	if (is_a<numeric>(result))
-		return result;
-	throw logic_error("integrand does not evaluate to numeric");
-}
+namespace {
 
-struct error_and_integral
-{
-	error_and_integral(const ex &err, const ex &integ)
-		:error(err), integral(integ){}
-	ex error;
-	ex integral;
-};
+/** An integrand as a function of the integration variable. The values are
+ *  computed with an eval_plan, which is compiled only once per integral. */
+class integrand {
+public:
+	integrand(const ex & x, const ex & f) : plan(f, lst(x)) {}
 
-struct error_and_integral_is_less
-{
-	bool operator()(const error_and_integral &e1,const error_and_integral &e2) const
+	numeric operator()(const numeric & x) const
+	{
+		return plan.evalf(vector<numeric>(1, x));
+	}
+
+	/** Values at all the points xs. */
+	vector<numeric> operator()(const vector<numeric> & xs) const
 	{
-		int c = e1.integral.compare(e2.integral);
-		if(c < 0)
-			return true;
-		if(c > 0)
-			return false;
-		return ex_is_less()(e1.error, e2.error);
+		vector<vector<numeric> > rows(xs.size(), vector<numeric>(1));
+		for (size_t i=0; i<xs.size(); ++i)
+			rows[i][0] = xs[i];
+		return plan.evalf_rows(rows);
 	}
+
+private:
+	eval_plan plan;
 };
 
-typedef map<error_and_integral, ex, error_and_integral_is_less> lookup_map;
+/** Cache of numerically computed integrals. Each integral has one slot
+ *  (chosen by its hash value), a new result replaces the one stored there,
+ *  so that the cache cannot grow without bound. */
+struct integral_cache_entry {
+	integral_cache_entry() : method(0), digits(0), used(false) {}
+	ex integ, error, value;
+	unsigned method;
+	long digits;
+	bool used;
+};
 
-/** Numeric integration routine based upon the "Adaptive Quadrature" one
-  * in "Numerical Analysis" by Burden and Faires. Parameters are integration
-  * variable, left boundary, right boundary, function to be integrated and
-  * the relative integration error. The function should evalf into a number
-  * after substituting the integration variable by a number. Another thing
-  * to note is that this implementation is no good at integrating functions
-  * with discontinuities. */
-ex adaptivesimpson(const ex & x, const ex & a_in, const ex & b_in, const ex & f, const ex & error)
+struct integral_cache_t {
+	integral_cache_t() : lookups(0), hits(0), entries(0) {}
+	vector<integral_cache_entry> slots;
+	unsigned long lookups, hits;
+	size_t entries;
+};
+
+size_t integral_cache_size = 64;
+
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+thread_local integral_cache_t integral_cache;
+#else
+integral_cache_t integral_cache;
+#endif
+
+typedef numeric (*quadrature_rule)(const integrand & f, const numeric & a, const numeric & b, const numeric & error);
+
+/** A numerical integral, with its key in the cache. */
+struct integral_request {
+	integral_request(unsigned method_, quadrature_rule rule_, const ex & x_, const ex & a_in, const ex & b_in, const ex & f_, const ex & error_);
+
+	/** Whether the integral is in the cache of the calling thread. */
+	bool cached() const;
+	/** Find the integral in the cache of the calling thread. */
+	bool lookup(ex & value) const;
+	/** Store the value in the cache of the calling thread. */
+	void store(const ex & value) const;
+
+	unsigned method;
+	quadrature_rule rule;
+	ex x, a, b, f, error;
+	ex key;  ///< the integral with a fixed integration variable
+	size_t slot;
+};
+
+/** Checks the arguments and computes the key. */
+integral_request::integral_request(unsigned method_, quadrature_rule rule_, const ex & x_, const ex & a_in, const ex & b_in, const ex & f_, const ex & error_)
+ : method(method_), rule(rule_), x(x_), f(f_), error(error_), slot(0)
 {
 	// Check whether boundaries and error are numbers.
-	ex a = is_exactly_a<numeric>(a_in) ? a_in : a_in.evalf();
-	ex b = is_exactly_a<numeric>(b_in) ? b_in : b_in.evalf();
+	a = is_exactly_a<numeric>(a_in) ? a_in : a_in.evalf();
+	b = is_exactly_a<numeric>(b_in) ? b_in : b_in.evalf();
 	if(!is_exactly_a<numeric>(a) || !is_exactly_a<numeric>(b))
 		throw std::runtime_error("For numerical integration the boundaries of the integral should evalf into numbers.");
 	if(!is_exactly_a<numeric>(error))
 		throw std::runtime_error("For numerical integration the error should be a number.");
 
-	// Use lookup table to be potentially much faster.
-	static lookup_map lookup;
 	static symbol ivar("ivar");
-	ex lookupex = integral(ivar,a,b,f.subs(x==ivar));
-	lookup_map::iterator emi = lookup.find(error_and_integral(error, lookupex));
-	if (emi!=lookup.end())
-		return emi->second;
+	key = integral(ivar,a,b,f.subs(x==ivar));
+	integral_cache_t & cache = integral_cache;
+	if (cache.slots.size() != integral_cache_size) {
+		// size changed by another thread
+		cache = integral_cache_t();
+		cache.slots.resize(integral_cache_size);
+	}
+	if (cache.slots.empty())
+		return;
+	const hash_t h = hash_combine(hash_combine(key.gethash(), error.gethash()), method);
+	slot = h % cache.slots.size();
+}
 
-	ex app = 0;
+bool integral_request::cached() const
+{
+	const integral_cache_t & cache = integral_cache;
+	if (cache.slots.empty())
+		return false;
+	const integral_cache_entry & e = cache.slots[slot];
+	return e.used && e.method == method && e.digits == long(Digits)
+	    && e.integ.is_equal(key) && e.error.is_equal(error);
+}
+
+bool integral_request::lookup(ex & value) const
+{
+	integral_cache_t & cache = integral_cache;
+	if (cache.slots.empty())
+		return false;
+	++cache.lookups;
+	if (!cached())
+		return false;
+	++cache.hits;
+	value = cache.slots[slot].value;
+	return true;
+}
+
+void integral_request::store(const ex & value) const
+{
+	integral_cache_t & cache = integral_cache;
+	if (cache.slots.empty() || cache.slots.size() != integral_cache_size)
+		return;
+	integral_cache_entry & e = cache.slots[slot];
+	if (!e.used)
+		++cache.entries;
+	e.integ = key;
+	e.error = error;
+	e.value = value;
+	e.method = method;
+	e.digits = Digits;
+	e.used = true;
+}
+
+/** Common part of the numerical integration routines: checks the
+ *  arguments, looks the integral up in the cache and calls the rule if it
+ *  is not found. */
+ex integrate_numerically(unsigned method, quadrature_rule rule, const ex & x, const ex & a_in, const ex & b_in, const ex & f, const ex & error)
+{
+	const integral_request r(method, rule, x, a_in, b_in, f, error);
+	ex value;
+	if (r.lookup(value))
+		return value;
+
+	// The integrand may contain integrals which take the slot, so the
+	// result is stored afterwards
+	value = rule(integrand(x, f), ex_to<numeric>(r.a), ex_to<numeric>(r.b), abs(ex_to<numeric>(error)));
+	r.store(value);
+	return value;
+}
+
+numeric simpson_rule(const integrand & f, const numeric & a, const numeric & b, const numeric & error)
+{
+	numeric app = 0;
 	int i = 1;
-	exvector avec(integral::max_integration_level+1);
-	exvector hvec(integral::max_integration_level+1);
-	exvector favec(integral::max_integration_level+1);
-	exvector fbvec(integral::max_integration_level+1);
-	exvector fcvec(integral::max_integration_level+1);
-	exvector svec(integral::max_integration_level+1);
-	exvector errorvec(integral::max_integration_level+1);
+	vector<numeric> avec(integral::max_integration_level+1);
+	vector<numeric> hvec(integral::max_integration_level+1);
+	vector<numeric> favec(integral::max_integration_level+1);
+	vector<numeric> fbvec(integral::max_integration_level+1);
+	vector<numeric> fcvec(integral::max_integration_level+1);
+	vector<numeric> svec(integral::max_integration_level+1);
+	vector<numeric> errorvec(integral::max_integration_level+1);
 	vector<int> lvec(integral::max_integration_level+1);
+	vector<numeric> points(3);
 
 	avec[i] = a;
 	hvec[i] = (b-a)/2;
-	favec[i] = subsvalue(x, a, f);
-	fcvec[i] = subsvalue(x, a+hvec[i], f);
-	fbvec[i] = subsvalue(x, b, f);
+	points[0] = a;
+	points[1] = a+hvec[i];
+	points[2] = b;
+	vector<numeric> values = f(points);
+	favec[i] = values[0];
+	fcvec[i] = values[1];
+	fbvec[i] = values[2];
 	svec[i] = hvec[i]*(favec[i]+4*fcvec[i]+fbvec[i])/3;
 	lvec[i] = 1;
 	errorvec[i] = error*abs(svec[i]);
 
+	points.resize(2);
 	while (i>0) {
-		ex fd = subsvalue(x, avec[i]+hvec[i]/2, f);
-		ex fe = subsvalue(x, avec[i]+3*hvec[i]/2, f);
-		ex s1 = hvec[i]*(favec[i]+4*fd+fcvec[i])/6;
-		ex s2 = hvec[i]*(fcvec[i]+4*fe+fbvec[i])/6;
-		ex nu1 = avec[i];
-		ex nu2 = favec[i];
-		ex nu3 = fcvec[i];
-		ex nu4 = fbvec[i];
-		ex nu5 = hvec[i];
+		points[0] = avec[i]+hvec[i]/2;
+		points[1] = avec[i]+3*hvec[i]/2;
+		values = f(points);
+		numeric fd = values[0];
+		numeric fe = values[1];
+		numeric s1 = hvec[i]*(favec[i]+4*fd+fcvec[i])/6;
+		numeric s2 = hvec[i]*(fcvec[i]+4*fe+fbvec[i])/6;
+		numeric nu1 = avec[i];
+		numeric nu2 = favec[i];
+		numeric nu3 = fcvec[i];
+		numeric nu4 = fbvec[i];
+		numeric nu5 = hvec[i];
 		// hopefully prevents a crash if the function is zero sometimes.
-		ex nu6 = max(errorvec[i], abs(s1+s2)*error);
-		ex nu7 = svec[i];
+		numeric nu6 = std::max(errorvec[i], abs(s1+s2)*error);
+		numeric nu7 = svec[i];
 		int nu8 = lvec[i];
 		--i;
-		if (abs(ex_to<numeric>(s1+s2-nu7)) <= nu6)
+		if (abs(s1+s2-nu7) <= nu6)
 			app+=(s1+s2);
 		else {
 			if (nu8>=integral::max_integration_level)
@@ -318,11 +449,362 @@ ex adaptivesimpson(const ex & x, const ex & a_in, const ex & b_in, const ex & f,
 			lvec[i] = lvec[i-1];
 		}
 	}
-
-	lookup[error_and_integral(error, lookupex)]=app;
 	return app;
 }
 
+/** Nodes of the 15-point Kronrod rule on [-1,1] (the non-negative ones, the
+ *  rule is symmetric), its weights and the weights of the 7-point Gauss rule
+ *  formed by every second node. */
+const char * const gauss_kronrod_table[8][3] = {
+	{ "0.991455371120812639206854697526328516642044338370334701291087",
+	  "0.022935322010529224963732008058969591993560811275746992267507",
+	  "0" },
+	{ "0.949107912342758524526189684047851262400770937670617783548769",
+	  "0.063092092629978553290700663189204286665071157211550707113606",
+	  "0.129484966168869693270611432679082018328587402259946663977209" },
+	{ "0.864864423359769072789712788640926201210972307074088148601458",
+	  "0.104790010322250183839876322541518017443756654213830611893391",
+	  "0" },
+	{ "0.741531185599394439863864773280788407074147647141390260119955",
+	  "0.140653259715525918745189590510237920399889757247998575561745",
+	  "0.279705391489276667901467771423779582486925065226598764537014" },
+	{ "0.586087235467691130294144838258729598436780750604360951304993",
+	  "0.169004726639267902826583426598550284106244900302944241497340",
+	  "0" },
+	{ "0.405845151377397166906606412076961463347382014099370126387043",
+	  "0.190350578064785409913256402421013682826078075455358355885441",
+	  "0.381830050505118944950369775488975133878365083533862734751083" },
+	{ "0.207784955007898467600689403773244913479784407145170649713846",
+	  "0.204432940075298892414161999234649084716517604180718357424471",
+	  "0" },
+	{ "0",
+	  "0.209482141084727828012999174891714263697762080223704316712998",
+	  "0.417959183673469387755102040816326530612244897959183673469388" }
+};
+
+struct gauss_kronrod_segment {
+	gauss_kronrod_segment(const numeric & a_, const numeric & b_, int l) : a(a_), b(b_), level(l) {}
+	numeric a, b;
+	numeric result, error, resabs;
+	int level;
+};
+
+/** Evaluates the 15-point rule on the segments. */
+class gauss_kronrod_evaluator {
+public:
+	explicit gauss_kronrod_evaluator(const integrand & f_) : f(f_)
+	{
+		for (size_t i=0; i<8; ++i) {
+			node[i] = numeric(gauss_kronrod_table[i][0]);
+			wk[i] = numeric(gauss_kronrod_table[i][1]);
+			wg[i] = numeric(gauss_kronrod_table[i][2]);
+		}
+	}
+
+	void compute(gauss_kronrod_segment & s1, gauss_kronrod_segment * s2 = 0) const
+	{
+		vector<numeric> points;
+		add_points(s1, points);
+		if (s2)
+			add_points(*s2, points);
+		const vector<numeric> values = f(points);
+		combine(s1, &values[0]);
+		if (s2)
+			combine(*s2, &values[15]);
+	}
+
+private:
+	void add_points(const gauss_kronrod_segment & s, vector<numeric> & points) const
+	{
+		const numeric c = (s.a+s.b)/2;
+		const numeric h = (s.b-s.a)/2;
+		for (size_t i=0; i<8; ++i) {
+			points.push_back(c-h*node[i]);
+			if (i < 7)
+				points.push_back(c+h*node[i]);
+		}
+	}
+
+	/** The Kronrod estimate is the result, its difference to the Gauss
+	 *  estimate the error. */
+	void combine(gauss_kronrod_segment & s, const numeric * values) const
+	{
+		numeric k, g, kabs;
+		for (size_t i=0; i<8; ++i) {
+			numeric sum = *values;
+			numeric asum = abs(*values);
+			++values;
+			if (i < 7) {
+				sum += *values;
+				asum += abs(*values);
+				++values;
+			}
+			k += wk[i]*sum;
+			g += wg[i]*sum;
+			kabs += wk[i]*asum;
+		}
+		const numeric h = (s.b-s.a)/2;
+		s.result = h*k;
+		s.error = abs(h*(k-g));
+		s.resabs = abs(h)*kabs;
+	}
+
+	const integrand & f;
+	numeric node[8], wk[8], wg[8];
+};
+
+numeric gauss_kronrod_rule(const integrand & f, const numeric & a, const numeric & b, const numeric & error)
+{
+	const gauss_kronrod_evaluator rule(f);
+	// errors below this fraction of the integral of |f| are rounding noise
+	const numeric eps = numeric(10).power(2-long(Digits));
+
+	vector<gauss_kronrod_segment> segments(1, gauss_kronrod_segment(a, b, 1));
+	rule.compute(segments[0]);
+	for (;;) {
+		numeric result, total_error, resabs;
+		size_t worst = 0;
+		for (size_t i=0; i<segments.size(); ++i) {
+			result += segments[i].result;
+			total_error += segments[i].error;
+			resabs += segments[i].resabs;
+			if (segments[i].error > segments[worst].error)
+				worst = i;
+		}
+		if (total_error <= std::max(error*abs(result), eps*resabs))
+			return result;
+
+		gauss_kronrod_segment & s = segments[worst];
+		if (s.level >= integral::max_integration_level)
+			throw runtime_error("max integration level reached");
+		const numeric m = (s.a+s.b)/2;
+		gauss_kronrod_segment right(m, s.b, s.level+1);
+		s.b = m;
+		++s.level;
+		rule.compute(s, &right);
+		segments.push_back(right);
+	}
+}
+
+numeric tanh_sinh_rule(const integrand & f, const numeric & a, const numeric & b, const numeric & error)
+{
+	const numeric h = (b-a)/2;
+	const numeric halfpi = ex_to<numeric>(Pi.evalf())/2;
+	const numeric eps = numeric(10).power(2-long(Digits));
+	// Beyond tmax, the weights are smaller than 10^(-4*Digits).
+	const double tmax = std::asinh(2*long(Digits)*std::log(10.0)/halfpi.to_double());
+
+	numeric sum, asum, previous;
+	for (int level=0; ; ++level) {
+		// The nodes are at t = j/steps, level 0 has all integers j, the
+		// later levels add the odd j.
+		const long steps = 1L << level;
+		const long jmax = long(std::ceil(tmax*steps));
+		vector<numeric> points, weights;
+		for (long j=(level ? 1 : 0); j<=jmax; j+=(level ? 2 : 1)) {
+			const numeric t = ex_to<numeric>(numeric(j, steps).evalf());
+			const numeric u = halfpi*sinh(t);
+			const numeric e = exp(2*u);
+			// the distance from the end points, h*(1-tanh(u))
+			const numeric d = 2*h/(e+1);
+			const numeric w = halfpi*cosh(t)*4*e/((e+1)*(e+1));
+			// the nodes which coincide with an end point are left out
+			const bool left = !(a+d).is_equal(a);
+			const bool right = j && !(b-d).is_equal(b);
+			if (left) {
+				points.push_back(a+d);
+				weights.push_back(w);
+			}
+			if (right) {
+				points.push_back(b-d);
+				weights.push_back(w);
+			}
+			if (!left && !right)
+				break;
+		}
+		const vector<numeric> values = f(points);
+		for (size_t i=0; i<values.size(); ++i) {
+			sum += weights[i]*values[i];
+			asum += weights[i]*abs(values[i]);
+		}
+
+		const numeric factor = h/steps;
+		const numeric result = factor*sum;
+		if (level >= 2 && abs(result-previous) <= std::max(error*abs(result), eps*abs(factor)*asum))
+			return result;
+		if (level >= integral::max_integration_level)
+			throw runtime_error("max integration level reached");
+		previous = result;
+	}
+}
+
+/** The method and the rule integral::evalf() uses. */
+quadrature_rule evalf_rule(unsigned & method)
+{
+	method = integral::integration_method;
+	switch (method) {
+		case integration_algo::adaptive_simpson:
+			return simpson_rule;
+		case integration_algo::gauss_kronrod:
+			return gauss_kronrod_rule;
+		case integration_algo::tanh_sinh:
+			return tanh_sinh_rule;
+		default:
+			if (long(Digits) <= 50) {
+				method = integration_algo::gauss_kronrod;
+				return gauss_kronrod_rule;
+			}
+			method = integration_algo::tanh_sinh;
+			return tanh_sinh_rule;
+	}
+}
+
+/** An integral computed by evalf_integrals_concurrently(). The request is
+ *  only used by the calling thread, the other members are passed to the
+ *  rule and must not share numbers with other jobs. */
+struct integral_job {
+	integral_job(const integral_request & r, const numeric & a_, const numeric & b_, const ex & f_, const numeric & e)
+	 : request(r), a(a_), b(b_), f(f_), error(e), done(false) {}
+	integral_request request;
+	numeric a, b;
+	ex f;
+	numeric error;
+	ex value;
+	bool done;
+};
+
+struct integral_jobs_task : public parallel_task {
+	explicit integral_jobs_task(vector<integral_job> & j) : jobs(j), digits(Digits) {}
+
+	void operator()(size_t i)
+	{
+		// Digits is per thread
+		const long saved_digits = Digits;
+		Digits = digits;
+		integral_job & job = jobs[i];
+		try {
+			job.value = job.request.rule(integrand(job.request.x, job.f), job.a, job.b, job.error);
+			job.done = true;
+		} catch (std::exception &) {
+			// integral::evalf() will throw again in the calling thread
+		}
+		Digits = saved_digits;
+	}
+
+	vector<integral_job> & jobs;
+	const long digits;
+};
+
+} // anonymous namespace
+
+void set_integral_cache_size(size_t size)
+{
+	integral_cache_size = size;
+	integral_cache = integral_cache_t();
+}
+
+integral_cache_statistics get_integral_cache_statistics()
+{
+	integral_cache_statistics st;
+	st.lookups = integral_cache.lookups;
+	st.hits = integral_cache.hits;
+	st.entries = integral_cache.entries;
+	return st;
+}
+
+void evalf_integrals_concurrently(const ex & e)
+{
+	if (integral_cache_size == 0 || !(is_exactly_a<add>(e) || is_a<lst>(e)) || parallel_threads(e.nops()) < 2)
+		return;
+
+	exvector integrals;
+	if (is_exactly_a<add>(e)) {
+		const epvector & seq = traversal_terms(ex_to<expairseq>(e));
+		for (epvector::const_iterator it = seq.begin(); it != seq.end(); ++it)
+			if (is_exactly_a<integral>(it->rest))
+				integrals.push_back(it->rest);
+	} else {
+		for (size_t i=0; i<e.nops(); ++i)
+			if (is_exactly_a<integral>(e.op(i)))
+				integrals.push_back(e.op(i));
+	}
+	if (integrals.size() < 2)
+		return;
+
+	// Collect the integrals integral::evalf() would compute numerically
+	// and which are not in the cache, at most one for each slot. Numbers
+	// of CLN can't be shared between threads, so the evaluated boundaries
+	// and integrand, whose floating-point numbers are only used for the
+	// key, are replaced by the original ones, which must be immediate
+	// integers, and the error by a floating-point number of each job.
+	const ex & error = integral::relative_integration_error;
+	if (!is_exactly_a<numeric>(error))
+		return;
+	const bool share_error = numerics_are_immediate(error);
+	vector<integral_job> jobs;
+	std::set<size_t> slots;
+	for (exvector::const_iterator it = integrals.begin(); it != integrals.end(); ++it) {
+		const ex x = it->op(0), a = it->op(1), b = it->op(2), f = it->op(3);
+		if (!is_exactly_a<numeric>(a) || !is_exactly_a<numeric>(b) || !numerics_are_immediate(a)
+		 || !numerics_are_immediate(b) || !numerics_are_immediate(f))
+			continue;
+		const ex ef = f.evalf();
+		if (!is_exactly_a<numeric>(ef.subs(x==12.34).evalf()))
+			continue;
+		unsigned method;
+		const quadrature_rule rule = evalf_rule(method);
+		const integral_request r(method, rule, x, a.evalf(), b.evalf(), ef, error);
+		if (slots.count(r.slot) || r.cached())
+			continue;
+		slots.insert(r.slot);
+		const numeric e = share_error ? abs(ex_to<numeric>(error))
+		                              : numeric(std::fabs(ex_to<numeric>(error).to_double()));
+		jobs.push_back(integral_job(r, ex_to<numeric>(a), ex_to<numeric>(b), f, e));
+	}
+	if (jobs.size() < 2)
+		return;
+
+	// The integrands may share the integration variable and other
+	// subexpressions
+	for (vector<integral_job>::const_iterator it = jobs.begin(); it != jobs.end(); ++it) {
+		prepare_for_threads(it->request.x);
+		prepare_for_threads(it->f);
+	}
+	integral_jobs_task task(jobs);
+	parallel_for(jobs.size(), task);
+	for (vector<integral_job>::const_iterator it = jobs.begin(); it != jobs.end(); ++it)
+		if (it->done)
+			it->request.store(it->value);
+}
+
+/** Numeric integration routine based upon the "Adaptive Quadrature" one
+  * in "Numerical Analysis" by Burden and Faires. Parameters are integration
+  * variable, left boundary, right boundary, function to be integrated and
+  * the relative integration error. The function should evalf into a number
+  * after substituting the integration variable by a number. Another thing
+  * to note is that this implementation is no good at integrating functions
+  * with discontinuities. */
+ex adaptivesimpson(const ex & x, const ex & a, const ex & b, const ex & f, const ex & error)
+{
+	return integrate_numerically(integration_algo::adaptive_simpson, simpson_rule, x, a, b, f, error);
+}
+
+/** Numeric integration with the adaptive 7-point Gauss, 15-point Kronrod
+  * rule. The parameters are the same as for adaptivesimpson(). The
+  * accuracy is limited to about 60 digits by the tabulated nodes. */
+ex gausskronrod(const ex & x, const ex & a, const ex & b, const ex & f, const ex & error)
+{
+	return integrate_numerically(integration_algo::gauss_kronrod, gauss_kronrod_rule, x, a, b, f, error);
+}
+
+/** Numeric integration with the tanh-sinh rule. The parameters are the same
+  * as for adaptivesimpson(). Integrable singularities at the boundaries are
+  * allowed. */
+ex tanhsinh(const ex & x, const ex & a, const ex & b, const ex & f, const ex & error)
+{
+	return integrate_numerically(integration_algo::tanh_sinh, tanh_sinh_rule, x, a, b, f, error);
+}
+
 int integral::degree(const ex & s) const
 {
 	return ((b-a)*f).degree(s);
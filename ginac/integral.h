@@ -73,6 +73,8 @@ protected:
 public:
 	static int max_integration_level;
 	static ex relative_integration_error;
+	/** Method used by evalf(), one of the integration_algo flags. */
+	static unsigned integration_method;
 private:
 	ex x;
 	ex a;
@@ -91,6 +93,51 @@ GiNaC::ex adaptivesimpson(
 	const GiNaC::ex &error = integral::relative_integration_error
 );
 
+GiNaC::ex gausskronrod(
+	const GiNaC::ex &x,
+	const GiNaC::ex &a,
+	const GiNaC::ex &b,
+	const GiNaC::ex &f,
+	const GiNaC::ex &error = integral::relative_integration_error
+);
+
+GiNaC::ex tanhsinh(
+	const GiNaC::ex &x,
+	const GiNaC::ex &a,
+	const GiNaC::ex &b,
+	const GiNaC::ex &f,
+	const GiNaC::ex &error = integral::relative_integration_error
+);
+
+/** Statistics of the cache of numerical integrals (@see set_integral_cache_size()). */
+struct integral_cache_statistics {
+	unsigned long lookups;  ///< numerical integrations which looked into the cache
+	unsigned long hits;     ///< integrations answered from the cache
+	size_t entries;         ///< results currently stored
+};
+
+/** Let the numerical integration routines remember their results in a
+ *  cache with room for size entries, 64 by default. Each integral has one
+ *  slot, chosen by its hash value, and a new result replaces the one
+ *  stored there. A size of 0 switches the cache off and frees the stored
+ *  expressions. With GINAC_THREAD_SAFE_REFCOUNT every thread has its own
+ *  cache (and statistics) of this size. */
+extern void set_integral_cache_size(size_t size);
+
+/** Return the statistics of the integral cache (of the calling thread). */
+extern integral_cache_statistics get_integral_cache_statistics();
+
+/** Compute the integrals among the terms of the sum or the elements of the
+ *  list e which integral::evalf() would integrate numerically, several of
+ *  them at a time with parallel_for(), and put the results into the cache,
+ *  where evalf() then finds them. ex::evalf() calls this. Since numbers
+ *  can't be shared between threads, only integrals with integer boundaries
+ *  and an integrand with integer numbers are considered (see
+ *  numerics_are_immediate()), and the integrations use
+ *  integral::relative_integration_error rounded to double precision if it
+ *  is not such a number. */
+extern void evalf_integrals_concurrently(const ex & e);
+
 } // namespace GiNaC
 
 #endif // ndef GINAC_INTEGRAL_H
@@ -0,0 +1,516 @@
+/** @file lazy_series.cpp
+ *
+ *  Implementation of power series whose coefficients are computed on
+ *  demand. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "lazy_series.h"
+#include "pseries.h"
+#include "add.h"
+#include "mul.h"
+#include "power.h"
+#include "function.h"
+#include "relational.h"
+#include "symbol.h"
+#include "inifcns.h" // for Order function
+#include "operators.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <stdexcept>
+
+namespace GiNaC {
+
+/** Number of zero coefficients which are skipped when looking for the
+ *  leading term of a series, before giving up. */
+static const int max_leading_zeros = 64;
+
+/** Value of node::maxdeg for series which don't terminate. */
+static const int no_degree_bound = std::numeric_limits<int>::max();
+
+lazy_series::lazy_series(const ex & e, const relational & r, unsigned options_)
+ : var(r.lhs()), point(r.rhs()), options(options_)
+{
+	if (!is_a<symbol>(var))
+		throw std::invalid_argument("lazy_series: expansion variable must be a symbol");
+	node_map done;
+	root = compile(e, done);
+}
+
+size_t lazy_series::emit(const node & n)
+{
+	nodes.push_back(n);
+	return nodes.size() - 1;
+}
+
+/** Append the nodes for the series of e, unless that was already done.
+ *  Return the index of the node of e. */
+size_t lazy_series::compile(const ex & e, node_map & done)
+{
+	node_map::const_iterator it = done.find(e);
+	if (it != done.end())
+		return it->second;
+
+	size_t result;
+	if (!e.has(var)) {
+		node n(node::constant);
+		n.e = e;
+		result = emit(n);
+
+	} else if (e.is_equal(var)) {
+		node n(node::variable);
+		n.maxdeg = 1;
+		result = emit(n);
+
+	} else if (is_exactly_a<add>(e)) {
+		node n(node::sum);
+		n.maxdeg = std::numeric_limits<int>::min();
+		for (size_t k=0; k<e.nops(); ++k) {
+			n.operands.push_back(compile(e.op(k), done));
+			n.maxdeg = std::max(n.maxdeg, nodes[n.operands.back()].maxdeg);
+		}
+		result = emit(n);
+
+	} else if (is_exactly_a<mul>(e)) {
+		result = compile(e.op(0), done);
+		for (size_t k=1; k<e.nops(); ++k) {
+			node n(node::product);
+			n.operands.push_back(result);
+			n.operands.push_back(compile(e.op(k), done));
+			const int d1 = nodes[n.operands[0]].maxdeg, d2 = nodes[n.operands[1]].maxdeg;
+			n.maxdeg = d1 == no_degree_bound || d2 == no_degree_bound ? no_degree_bound : d1 + d2;
+			result = emit(n);
+		}
+
+	} else if (is_exactly_a<power>(e) && e.op(1).info(info_flags::rational)) {
+		node n(node::power_const);
+		n.expo = ex_to<numeric>(e.op(1));
+		n.operands.push_back(compile(e.op(0), done));
+		if (!n.expo.is_integer()) {
+			// Needed if the result is a Puiseux series
+			node g(node::generic);
+			g.e = e;
+			g.maxdeg = no_degree_bound;
+			n.operands.push_back(emit(g));
+		}
+		const int d = nodes[n.operands[0]].maxdeg;
+		if (n.expo.is_nonneg_integer() && d >= 0 && d != no_degree_bound &&
+		    n.expo < numeric(no_degree_bound / (d + 1)))
+			n.maxdeg = n.expo.to_int() * d;
+		else
+			n.maxdeg = no_degree_bound;
+		result = emit(n);
+
+	} else {
+		node n(node::generic);
+		n.e = e;
+		n.maxdeg = no_degree_bound;
+		result = emit(n);
+	}
+
+	done[e] = result;
+	return result;
+}
+
+/** Lower bound of the exponents of the non-zero terms of node i. */
+int lazy_series::valuation(size_t i)
+{
+	if (nodes[i].val_known)
+		return nodes[i].val;
+
+	int v = 0;
+	switch (nodes[i].kind) {
+	case node::constant:
+		break;
+	case node::variable:
+		v = point.is_zero() ? 1 : 0;
+		break;
+	case node::sum:
+		v = std::numeric_limits<int>::max();
+		for (size_t k=0; k<nodes[i].operands.size(); ++k)
+			v = std::min(v, valuation(nodes[i].operands[k]));
+		break;
+	case node::product:
+		v = valuation(nodes[i].operands[0]) + valuation(nodes[i].operands[1]);
+		break;
+	case node::power_const: {
+		// The recurrence needs the leading term of the base
+		const size_t b = nodes[i].operands[0];
+		const int first = valuation(b);
+		int lead = first;
+		while (get(b, lead).is_zero()) {
+			if (lead - first == max_leading_zeros || lead >= nodes[b].maxdeg)
+				throw std::runtime_error("lazy_series: no leading term found in the base of a power");
+			++lead;
+		}
+		const numeric pv = nodes[i].expo * lead;
+		if (pv.is_integer()) {
+			nodes[i].lead = lead;
+			v = pv.to_int();
+		} else {
+			// Puiseux series, left to ex::series()
+			nodes[i].kind = node::alias;
+			nodes[i].operands.erase(nodes[i].operands.begin());
+			v = valuation(nodes[i].operands[0]);
+		}
+		break;
+	}
+	case node::generic:
+		expand_generic(i, 0);
+		return nodes[i].val;
+	case node::alias:
+		v = valuation(nodes[i].operands[0]);
+		break;
+	}
+	nodes[i].val = v;
+	nodes[i].val_known = true;
+	return v;
+}
+
+/** Make sure that the coefficients of the generic node i are known up to
+ *  the exponent n, by expanding its expression with a larger order. The
+ *  order is at least doubled every time, so that asking for one more term
+ *  at a time doesn't expand the expression over and over again. */
+void lazy_series::expand_generic(size_t i, int n)
+{
+	node & nd = nodes[i];
+	if (nd.val_known && (n < nd.val + int(nd.known) || n > nd.maxdeg))
+		return;
+
+	int order = n + 1;
+	if (nd.val_known)
+		order = std::max(order, nd.order + std::max(nd.order - nd.val, 1));
+	for (;;) {
+		const ex s = nd.e.series(relational(var, point), order, options);
+		const pseries & ps = ex_to<pseries>(s);
+		if (!nd.val_known) {
+			nd.val = ps.nops() == 0 ? 0 : ex_to<numeric>(ps.exponop(0)).to_int();
+			nd.val_known = true;
+		}
+		nd.order = order;
+		nd.c.clear();
+		int known_until = no_degree_bound;
+		for (size_t k=0; k<ps.nops(); ++k) {
+			const int d = ex_to<numeric>(ps.exponop(k)).to_int();
+			if (is_order_function(ps.coeffop(k))) {
+				known_until = d;
+				break;
+			}
+			if (d < nd.val)
+				continue;
+			if (size_t(d - nd.val) >= nd.c.size())
+				nd.c.resize(d - nd.val + 1, _ex0);
+			nd.c[d - nd.val] = ps.coeffop(k);
+		}
+		if (known_until == no_degree_bound) {
+			// The series terminates
+			nd.maxdeg = nd.val + int(nd.c.size()) - 1;
+			nd.known = nd.c.size();
+			return;
+		}
+		nd.known = known_until > nd.val ? size_t(known_until - nd.val) : 0;
+		if (nd.c.size() < nd.known)
+			nd.c.resize(nd.known, _ex0);
+		if (known_until > n)
+			return;
+		order += std::max(order - nd.val, 1);
+	}
+}
+
+/** Coefficient of (x-point)^n in the series of node i. */
+ex lazy_series::get(size_t i, int n)
+{
+	const int v = valuation(i);
+	if (n < v || n > nodes[i].maxdeg)
+		return _ex0;
+	const size_t k = size_t(n - v);
+	if (nodes[i].kind == node::generic) {
+		expand_generic(i, n);
+		return k < nodes[i].c.size() ? nodes[i].c[k] : _ex0;
+	}
+	while (nodes[i].c.size() <= k) {
+		const ex c = next(i, v + int(nodes[i].c.size()));
+		nodes[i].c.push_back(c);
+	}
+	return nodes[i].c[k];
+}
+
+/** Compute the coefficient of (x-point)^n in the series of node i, the
+ *  coefficients of lower powers being known. */
+ex lazy_series::next(size_t i, int n)
+{
+	const node & nd = nodes[i];
+	switch (nd.kind) {
+	case node::constant:
+		return n == 0 ? nd.e : _ex0;
+	case node::variable:
+		if (n == 1)
+			return _ex1;
+		return n == 0 ? point : _ex0;
+	case node::sum: {
+		exvector terms;
+		terms.reserve(nd.operands.size());
+		for (size_t k=0; k<nd.operands.size(); ++k)
+			terms.push_back(get(nd.operands[k], n));
+		return (new add(terms))->setflag(status_flags::dynallocated);
+	}
+	case node::product: {
+		// c(n) = a(lo)*b(n-lo) + ... + a(hi)*b(n-hi)
+		const size_t a = nd.operands[0], b = nd.operands[1];
+		int lo = valuation(a), hi = n - valuation(b);
+		if (nodes[b].maxdeg != no_degree_bound)
+			lo = std::max(lo, n - nodes[b].maxdeg);
+		hi = std::min(hi, nodes[a].maxdeg);
+		exvector terms;
+		for (int k=lo; k<=hi; ++k) {
+			const ex ca = get(a, k);
+			if (ca.is_zero())
+				continue;
+			const ex cb = get(b, n - k);
+			if (!cb.is_zero())
+				terms.push_back(ca * cb);
+		}
+		return (new add(terms))->setflag(status_flags::dynallocated);
+	}
+	case node::power_const: {
+		// J.C.P. Miller's recurrence, see pseries::power_const()
+		const size_t b = nd.operands[0];
+		const int m = n - nd.val;
+		const ex a0 = get(b, nd.lead);
+		if (m == 0)
+			return power(a0, nd.expo);
+		int jmax = m;
+		if (nodes[b].maxdeg != no_degree_bound)
+			jmax = std::min(jmax, nodes[b].maxdeg - nd.lead);
+		exvector terms;
+		for (int j=1; j<=jmax; ++j) {
+			const ex aj = get(b, nd.lead + j);
+			if (!aj.is_zero())
+				terms.push_back((nd.expo * j - (m - j)) * aj * nd.c[m - j]);
+		}
+		return (new add(terms))->setflag(status_flags::dynallocated) / (a0 * m);
+	}
+	case node::alias:
+		return get(nd.operands[0], n);
+	case node::generic:
+		break;
+	}
+	throw std::logic_error("lazy_series::next(): generic node");
+}
+
+ex lazy_series::coeff(int n)
+{
+	return get(root, n);
+}
+
+int lazy_series::ldegree()
+{
+	const int first = valuation(root);
+	for (int n=first; n<=nodes[root].maxdeg; ++n) {
+		if (!get(root, n).is_zero())
+			return n;
+		if (n - first == max_leading_zeros)
+			throw std::runtime_error("lazy_series::ldegree(): no leading term found");
+	}
+	return 0;  // zero series, as pseries::ldegree()
+}
+
+int lazy_series::ldegree(int bound)
+{
+	for (int n=valuation(root); n<bound && n<=nodes[root].maxdeg; ++n)
+		if (!get(root, n).is_zero())
+			return n;
+	return bound;
+}
+
+ex lazy_series::series(int order)
+{
+	epvector seq;
+	for (int n=valuation(root); n<order && n<=nodes[root].maxdeg; ++n) {
+		const ex c = get(root, n);
+		if (!c.is_zero())
+			seq.push_back(expair(c, numeric(n)));
+	}
+	if (nodes[root].maxdeg >= order)
+		seq.push_back(expair(Order(_ex1), numeric(order)));
+	return (new pseries(relational(var, point), seq))->setflag(status_flags::dynallocated);
+}
+
+namespace {
+
+/** Leading terms of the expansions of an expression and its
+ *  subexpressions, remembered so that every subexpression is looked at
+ *  once per query. */
+class leading_terms {
+public:
+	leading_terms(const ex & r, unsigned options);
+
+	int ldegree(const ex & e) { return find(e, false).deg; }
+	ex lcoeff(const ex & e) { return find(e, true).coeff; }
+
+private:
+	struct term {
+		term() : deg(0), coeff_known(false) { }
+		int deg;
+		bool coeff_known;
+		ex coeff;
+	};
+
+	const term & find(const ex & e, bool need_coeff);
+	void compute(const ex & e, term & t, bool need_coeff);
+	void expand(const ex & e, term & t);
+
+	std::map<ex, term, ex_is_less> done;
+	ex var;
+	ex point;
+	unsigned options;
+};
+
+leading_terms::leading_terms(const ex & r, unsigned options_) : options(options_)
+{
+	if (is_a<relational>(r)) {
+		var = r.lhs();
+		point = r.rhs();
+	} else if (is_a<symbol>(r)) {
+		var = r;
+		point = _ex0;
+	} else
+		throw std::logic_error("series_ldegree(): expansion point has unknown type");
+	if (!is_a<symbol>(var))
+		throw std::invalid_argument("series_ldegree(): expansion variable must be a symbol");
+}
+
+const leading_terms::term & leading_terms::find(const ex & e, bool need_coeff)
+{
+	std::map<ex, term, ex_is_less>::iterator it = done.find(e);
+	if (it == done.end())
+		it = done.insert(std::make_pair(e, term())).first;
+	else if (it->second.coeff_known || !need_coeff)
+		return it->second;
+	// The map doesn't move its elements when others are inserted
+	compute(e, it->second, need_coeff);
+	return it->second;
+}
+
+/** Find the leading term of e, by combining those of its operands. */
+void leading_terms::compute(const ex & e, term & t, bool need_coeff)
+{
+	if (!e.has(var)) {
+		t.coeff = e;
+		t.coeff_known = true;
+
+	} else if (e.is_equal(var)) {
+		t.deg = point.is_zero() ? 1 : 0;
+		t.coeff = point.is_zero() ? _ex1 : point;
+		t.coeff_known = true;
+
+	} else if (is_exactly_a<mul>(e)) {
+		t.deg = 0;
+		for (size_t k=0; k<e.nops(); ++k)
+			t.deg += find(e.op(k), false).deg;
+		if (need_coeff) {
+			exvector c;
+			c.reserve(e.nops());
+			for (size_t k=0; k<e.nops(); ++k)
+				c.push_back(find(e.op(k), true).coeff);
+			t.coeff = (new mul(c))->setflag(status_flags::dynallocated);
+			t.coeff_known = true;
+		}
+
+	} else if (is_exactly_a<power>(e) && e.op(1).info(info_flags::rational)) {
+		const numeric & p = ex_to<numeric>(e.op(1));
+		const numeric d = p * find(e.op(0), false).deg;
+		if (!d.is_integer()) {
+			// Puiseux series, which ex::series() refuses
+			expand(e, t);
+			return;
+		}
+		t.deg = d.to_int();
+		if (need_coeff) {
+			t.coeff = power(find(e.op(0), true).coeff, p);
+			t.coeff_known = true;
+		}
+
+	} else if (is_exactly_a<add>(e)) {
+		// Only the terms of lowest degree contribute, unless they cancel
+		int mindeg = std::numeric_limits<int>::max();
+		for (size_t k=0; k<e.nops(); ++k)
+			mindeg = std::min(mindeg, find(e.op(k), false).deg);
+		std::vector<size_t> lowest;
+		for (size_t k=0; k<e.nops(); ++k)
+			if (find(e.op(k), false).deg == mindeg)
+				lowest.push_back(k);
+		t.deg = mindeg;
+		if (lowest.size() > 1 || need_coeff) {
+			exvector c;
+			c.reserve(lowest.size());
+			for (size_t k=0; k<lowest.size(); ++k)
+				c.push_back(find(e.op(lowest[k]), true).coeff);
+			t.coeff = (new add(c))->setflag(status_flags::dynallocated);
+			t.coeff_known = true;
+			if (lowest.size() > 1 && t.coeff.expand().is_zero())
+				expand(e, t);
+		}
+
+	} else if (is_a<function>(e) && !is_order_function(e)) {
+		// A function which is finite and non-zero at the point starts with
+		// its value there
+		ex value;
+		try {
+			value = e.subs(var == point);
+		} catch (std::exception &) {
+		}
+		if (value.is_zero() || value.has(var)) {
+			expand(e, t);
+			return;
+		}
+		t.coeff = value;
+		t.coeff_known = true;
+
+	} else
+		expand(e, t);
+}
+
+/** Find the leading term of e from its coefficients. */
+void leading_terms::expand(const ex & e, term & t)
+{
+	lazy_series s(e, relational(var, point), options);
+	t.deg = s.ldegree();
+	t.coeff = s.coeff(t.deg);
+	t.coeff_known = true;
+}
+
+} // anonymous namespace
+
+int series_ldegree(const ex & e, const ex & r, unsigned options)
+{
+	leading_terms lt(r, options);
+	return lt.ldegree(e);
+}
+
+ex series_lcoeff(const ex & e, const ex & r, unsigned options)
+{
+	leading_terms lt(r, options);
+	return lt.lcoeff(e);
+}
+
+} // namespace GiNaC
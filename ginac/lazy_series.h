@@ -0,0 +1,129 @@
+/** @file lazy_series.h
+ *
+ *  Interface to power series whose coefficients are computed on demand. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_LAZY_SERIES_H
+#define GINAC_LAZY_SERIES_H
+
+#include "ex.h"
+#include "hash_map.h"
+#include "numeric.h"
+
+#include <vector>
+
+namespace GiNaC {
+
+class relational;
+
+/** Laurent series of an expression whose coefficients are computed when
+ *  they are asked for, and remembered. Asking for more terms later only
+ *  costs the new coefficients, unlike calling ex::series() again with a
+ *  higher order.
+ *
+ *  Sums, products and powers with rational exponents are expanded as
+ *  streams of coefficients (the coefficients of a power by J.C.P. Miller's
+ *  recurrence). Other subexpressions, such as functions, are expanded by
+ *  ex::series(); when more of their terms are needed, the order of that
+ *  expansion is doubled. Subexpressions which occur several times are
+ *  expanded once. */
+class lazy_series {
+public:
+	/** Expand e in the symbol r.lhs() around the point r.rhs(). The
+	 *  options are passed on to ex::series(). */
+	lazy_series(const ex & e, const relational & r, unsigned options = 0);
+
+	/** Coefficient of (x-point)^n. */
+	ex coeff(int n);
+
+	/** Exponent of the first non-zero term, which must be among the
+	 *  first few terms. */
+	int ldegree();
+
+	/** Exponent of the first non-zero term if it is less than bound,
+	 *  otherwise bound. Only the coefficients below bound are computed. */
+	int ldegree(int bound);
+
+	/** Terms with exponents below order as a pseries object, like
+	 *  e.series(r, order, options). */
+	ex series(int order);
+
+private:
+	struct node {
+		enum kind_t {
+			constant,     ///< e, not depending on x
+			variable,     ///< x
+			sum,          ///< sum of the operands
+			product,      ///< product of the two operands
+			power_const,  ///< first operand to the power expo
+			generic,      ///< ex::series() of e
+			alias         ///< same as the first operand
+		};
+
+		node(kind_t k) : kind(k), val_known(false), val(0), maxdeg(0), lead(0), order(0), known(0) { }
+
+		kind_t kind;
+		ex e;
+		numeric expo;
+		std::vector<size_t> operands; ///< indices of other nodes
+		bool val_known;
+		int val;      ///< lower bound of the exponents of non-zero terms
+		int maxdeg;   ///< upper bound of these exponents (or INT_MAX)
+		int lead;     ///< power_const: exponent of the leading term of the base
+		exvector c;   ///< known coefficients, starting with exponent val
+		int order;    ///< generic: order of the last ex::series() call
+		size_t known; ///< generic: number of valid coefficients in c
+	};
+
+	typedef exhashmap<size_t> node_map;
+
+	size_t compile(const ex & e, node_map & done);
+	size_t emit(const node & n);
+	int valuation(size_t i);
+	ex get(size_t i, int n);
+	ex next(size_t i, int n);
+	void expand_generic(size_t i, int n);
+
+	std::vector<node> nodes;
+	size_t root;
+	ex var;
+	ex point;
+	unsigned options;
+};
+
+/** Exponent of the leading term of the expansion of e in the symbol r
+ *  around zero (if r is a symbol) or in r.lhs() around r.rhs(), the same
+ *  as e.series(r, order, options).ldegree() for a large enough order.
+ *
+ *  The lowest degrees are propagated through sums, products, powers and
+ *  functions without expanding e. Coefficients are only computed for the
+ *  terms of sums whose lowest degrees coincide, to check for cancellation,
+ *  and for the subexpressions which cannot be handled this way (like
+ *  functions at a zero or singularity), which are expanded by lazy_series. */
+int series_ldegree(const ex & e, const ex & r, unsigned options = 0);
+
+/** Coefficient of the leading term of the expansion of e, computed like
+ *  series_ldegree(): only the leading coefficients of the subexpressions
+ *  are formed. */
+ex series_lcoeff(const ex & e, const ex & r, unsigned options = 0);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_LAZY_SERIES_H
@@ -0,0 +1,80 @@
+/** @file mapped_file.cpp
+ *
+ *  Read-only views of whole files. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "mapped_file.h"
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_UNISTD_H)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define GINAC_MMAP_FILES
+#endif
+
+namespace GiNaC {
+
+mapped_file::mapped_file(const std::string &filename)
+  : base(0), length(0), mapping(0)
+{
+#ifdef GINAC_MMAP_FILES
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw (std::runtime_error("cannot open file '" + filename + "'"));
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		void *p = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (p != MAP_FAILED) {
+			mapping = p;
+			base = static_cast<const char *>(p);
+			length = st.st_size;
+		}
+	}
+	close(fd);
+#endif
+
+	// Read the whole file if it cannot be mapped
+	if (!mapping) {
+		std::ifstream f(filename.c_str(), std::ios_base::in | std::ios_base::binary);
+		if (!f)
+			throw (std::runtime_error("cannot open file '" + filename + "'"));
+		buffer.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+		if (!buffer.empty())
+			base = &buffer[0];
+		length = buffer.size();
+	}
+}
+
+mapped_file::~mapped_file()
+{
+#ifdef GINAC_MMAP_FILES
+	if (mapping)
+		munmap(mapping, length);
+#endif
+}
+
+} // namespace GiNaC
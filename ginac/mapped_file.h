@@ -0,0 +1,56 @@
+/** @file mapped_file.h
+ *
+ *  Interface to read-only views of whole files. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_MAPPED_FILE_H
+#define GINAC_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace GiNaC {
+
+/** The contents of a file in memory. The file is memory-mapped where the
+ *  system supports it, otherwise it is read into a buffer. */
+class mapped_file
+{
+public:
+	/** Throws std::runtime_error if the file cannot be opened. */
+	explicit mapped_file(const std::string &filename);
+	~mapped_file();
+
+	const char *data() const { return base; }
+	size_t size() const { return length; }
+
+private:
+	mapped_file(const mapped_file &);
+	mapped_file &operator=(const mapped_file &);
+
+	const char *base;
+	size_t length;
+	void *mapping;            ///< memory-mapped file, if any
+	std::vector<char> buffer; ///< file contents, if it could not be mapped
+};
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_MAPPED_FILE_H
@@ -21,22 +21,35 @@
  */
 
 #include "matrix.h"
+#include "sparse_matrix.h"
 #include "numeric.h"
 #include "lst.h"
 #include "idx.h"
 #include "indexed.h"
 #include "add.h"
+#include "mul.h"
 #include "power.h"
 #include "symbol.h"
+#include "wildcard.h"
 #include "operators.h"
 #include "normal.h"
 #include "archive.h"
 #include "utils.h"
-
+#include "parallel.h"
+#include "budget.h"
+#include "polynomial/cra_garner.h"
+#include "polynomial/primes_factory.h"
+
+#include <cln/float.h>
+#include <cln/integer.h>
+#include <cln/rational.h>
 #include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <sstream>
+#include <stdint.h> // for uint32_t, uint64_t
 #include <stdexcept>
 #include <string>
 
@@ -82,6 +95,13 @@ matrix::matrix(unsigned r, unsigned c, const exvector & m2)
 	setflag(status_flags::not_shareable);
 }
 
+/** Ctor from representation, taking over the elements of m2. */
+matrix::matrix(unsigned r, unsigned c, exvector && m2)
+  : row(r), col(c), m(std::move(m2))
+{
+	setflag(status_flags::not_shareable);
+}
+
 /** Construct matrix from (flat) list of elements. If the list has fewer
  *  elements than the matrix, the remaining matrix elements are set to zero.
  *  If the list has more elements than the matrix, the excessive elements are
@@ -221,18 +241,95 @@ ex matrix::eval(int level) const
 		for (unsigned c=0; c<col; ++c)
 			m2[r*col+c] = m[r*col+c].eval(level);
 	
-	return (new matrix(row, col, m2))->setflag(status_flags::dynallocated |
+	return (new matrix(row, col, std::move(m2)))->setflag(status_flags::dynallocated |
 	                                           status_flags::evaluated);
 }
 
+/** Bit mask of the symbols in an expression, with one bit for each symbol
+ *  chosen by its hash value. Wildcards set all bits. */
+static uint64_t symbol_mask(const ex & e)
+{
+	if (is_a<symbol>(e))
+		return uint64_t(1) << (e.gethash() % 64);
+	if (is_a<wildcard>(e))
+		return ~uint64_t(0);
+	uint64_t mask = 0;
+	for (size_t i=0; i<e.nops(); ++i)
+		mask |= symbol_mask(e.op(i));
+	return mask;
+}
+
+/** The symbol masks of the entries of a matrix. The entries are kept to
+ *  tell whether the masks are still valid for the entries of a matrix,
+ *  which may have been changed with let_op() or operator(). */
+struct matrix_symbol_summary {
+	exvector entries;
+	std::vector<uint64_t> masks;
+};
+
+/** The symbol masks of the entries. Only the masks of entries which changed
+ *  since the last call are computed again. */
+std::shared_ptr<const matrix_symbol_summary> matrix::symbol_summary() const
+{
+	std::shared_ptr<const matrix_symbol_summary> old = std::atomic_load(&summary);
+	const bool comparable = old && old->entries.size() == m.size();
+	if (comparable) {
+		size_t i = 0;
+		while (i < m.size() && are_ex_trivially_equal(m[i], old->entries[i]))
+			++i;
+		if (i == m.size())
+			return old;
+	}
+
+	std::shared_ptr<matrix_symbol_summary> s = std::make_shared<matrix_symbol_summary>();
+	s->entries = m;
+	s->masks.resize(m.size());
+	for (size_t i=0; i<m.size(); ++i) {
+		if (comparable && are_ex_trivially_equal(m[i], old->entries[i]))
+			s->masks[i] = old->masks[i];
+		else
+			s->masks[i] = symbol_mask(m[i]);
+	}
+	std::shared_ptr<const matrix_symbol_summary> result = s;
+	std::atomic_store(&summary, result);
+	return result;
+}
+
+/** Substitution entry by entry. Entries without any of the symbols in the
+ *  keys are left alone, and the result shares the unchanged entries (and
+ *  their symbol masks) with this matrix, so that substituting a few
+ *  parameters costs time proportional to the entries containing them. */
 ex matrix::subs(const exmap & mp, unsigned options) const
 {
-	exvector m2(row * col);
-	for (unsigned r=0; r<row; ++r)
-		for (unsigned c=0; c<col; ++c)
-			m2[r*col+c] = m[r*col+c].subs(mp, options);
+	// keys without symbols may match anything
+	uint64_t keymask = 0;
+	for (exmap::const_iterator it = mp.begin(); it != mp.end(); ++it) {
+		const uint64_t k = symbol_mask(it->first);
+		keymask |= k ? k : ~uint64_t(0);
+	}
+
+	std::shared_ptr<const matrix_symbol_summary> s;
+	if (keymask != ~uint64_t(0))
+		s = symbol_summary();
+
+	exvector * ev = 0;
+	for (size_t i=0; i<m.size(); ++i) {
+		if (s && !(s->masks[i] & keymask))
+			continue;
+		ex x = m[i].subs(mp, options);
+		if (are_ex_trivially_equal(x, m[i]))
+			continue;
+		if (!ev)
+			ev = new exvector(m);
+		(*ev)[i] = x;
+	}
+	if (!ev)
+		return subs_one_level(mp, options);
 
-	return matrix(row, col, m2).subs_one_level(mp, options);
+	matrix result(row, col, std::move(*ev));
+	delete ev;
+	result.summary = s;  // the masks of the new entries are made on demand
+	return result.subs_one_level(mp, options);
 }
 
 /** Complex conjugate every matrix entry. */
@@ -256,7 +353,7 @@ ex matrix::conjugate() const
 		ev->push_back(x);
 	}
 	if (ev) {
-		ex result = matrix(row, col, *ev);
+		ex result = matrix(row, col, std::move(*ev));
 		delete ev;
 		return result;
 	}
@@ -269,7 +366,7 @@ ex matrix::real_part() const
 	v.reserve(m.size());
 	for (exvector::const_iterator i=m.begin(); i!=m.end(); ++i)
 		v.push_back(i->real_part());
-	return matrix(row, col, v);
+	return matrix(row, col, std::move(v));
 }
 
 ex matrix::imag_part() const
@@ -278,7 +375,7 @@ ex matrix::imag_part() const
 	v.reserve(m.size());
 	for (exvector::const_iterator i=m.begin(); i!=m.end(); ++i)
 		v.push_back(i->imag_part());
-	return matrix(row, col, v);
+	return matrix(row, col, std::move(v));
 }
 
 // protected
@@ -565,7 +662,7 @@ matrix matrix::add(const matrix & other) const
 	while (i != end)
 		*i++ += *ci++;
 	
-	return matrix(row,col,sum);
+	return matrix(row,col,std::move(sum));
 }
 
 
@@ -583,30 +680,1452 @@ matrix matrix::sub(const matrix & other) const
 	while (i != end)
 		*i++ -= *ci++;
 	
-	return matrix(row,col,dif);
+	return matrix(row,col,std::move(dif));
+}
+
+
+namespace {
+
+/** Kinds of the entries of matrices, for choosing a dense representation
+ *  when all of them are numeric. */
+class numeric_entries {
+public:
+	numeric_entries() : all_numeric(true), complex(false), long_float(false),
+	                    has_float(false), nonzero_rational(false), fraction(false) {}
+
+	void add(const exvector & v)
+	{
+		for (exvector::const_iterator i=v.begin(); i!=v.end(); ++i) {
+			if (!is_exactly_a<numeric>(*i)) {
+				all_numeric = false;
+				return;
+			}
+			const numeric & x = ex_to<numeric>(*i);
+			if (!x.is_real()) {
+				complex = true;
+				if (!x.is_crational())
+					has_float = true;
+			} else if (x.is_rational()) {
+				if (!x.is_zero())
+					nonzero_rational = true;
+				if (!x.is_integer())
+					fraction = true;
+			} else {
+				has_float = true;
+				if (cln::float_digits(cln::the<cln::cl_F>(x.to_cl_N())) > unsigned(std::numeric_limits<double>::digits))
+					long_float = true;
+			}
+		}
+	}
+
+	/** Real floating-point entries of at most double precision, rational
+	 *  ones are rounded as they would be in arithmetic with them. */
+	bool fit_double() const
+	{
+		return all_numeric && !complex && !long_float && has_float;
+	}
+
+	/** Only rational entries. */
+	bool exact_real() const
+	{
+		return all_numeric && !complex && !has_float;
+	}
+
+	/** Only integer entries. */
+	bool exact_integer() const
+	{
+		return exact_real() && !fraction;
+	}
+
+	bool all_numeric;
+	bool complex;
+	bool long_float;        ///< floats with more digits than a double
+	bool has_float;
+	bool nonzero_rational;
+	bool fraction;          ///< rational entries which are not integers
+};
+
+inline bool is_zero_entry(double x) { return x == 0; }
+inline bool is_zero_entry(const cln::cl_N & x) { return cln::zerop(x); }
+
+inline double magnitude(double x) { return std::fabs(x); }
+inline cln::cl_R magnitude(const cln::cl_N & x) { return cln::abs(x); }
+
+/** Numeric entry of a matrix.  Zeros become exact ones, like the entries
+ *  which are eliminated by matrix::gauss_elimination(). */
+inline ex dense_entry(const cln::cl_N & x)
+{
+	if (cln::zerop(x))
+		return _ex0;
+	return (new numeric(x))->setflag(status_flags::dynallocated);
+}
+
+inline ex dense_entry(double x)
+{
+	if (x == 0)
+		return _ex0;
+	return (new numeric(cln::cl_float(x, cln::float_format_dfloat)))->setflag(status_flags::dynallocated);
+}
+
+void to_dense(const exvector & v, std::vector<double> & a)
+{
+	a.resize(v.size());
+	for (size_t i=0; i<v.size(); ++i)
+		a[i] = ex_to<numeric>(v[i]).to_double();
+}
+
+void to_dense(const exvector & v, std::vector<cln::cl_N> & a)
+{
+	a.resize(v.size());
+	for (size_t i=0; i<v.size(); ++i)
+		a[i] = ex_to<numeric>(v[i]).to_cl_N();
+}
+
+void to_dense(const exvector & v, std::vector<cln::cl_I> & a)
+{
+	a.resize(v.size());
+	for (size_t i=0; i<v.size(); ++i)
+		a[i] = cln::the<cln::cl_I>(ex_to<numeric>(v[i]).to_cl_N());
+}
+
+template <class T>
+void from_dense(const std::vector<T> & a, exvector & v)
+{
+	v.resize(a.size());
+	for (size_t i=0; i<a.size(); ++i)
+		v[i] = dense_entry(a[i]);
+}
+
+/** Product c of the m x l matrix a and the l x n matrix b, all in row-major
+ *  order.  The loops run over blocks of b which stay in the cache while a
+ *  block row of c is accumulated. */
+void dense_mul(const std::vector<double> & a, const std::vector<double> & b,
+               std::vector<double> & c, unsigned m, unsigned l, unsigned n)
+{
+	const unsigned block = 64;
+	c.assign(m*n, 0);
+	for (unsigned k0=0; k0<l; k0+=block) {
+		const unsigned k1 = std::min(l, k0+block);
+		for (unsigned j0=0; j0<n; j0+=block) {
+			const unsigned j1 = std::min(n, j0+block);
+			for (unsigned i=0; i<m; ++i) {
+				double * ci = &c[i*n];
+				for (unsigned k=k0; k<k1; ++k) {
+					const double aik = a[i*l+k];
+					if (aik == 0)
+						continue;
+					const double * bk = &b[k*n];
+					for (unsigned j=j0; j<j1; ++j)
+						ci[j] += aik * bk[j];
+				}
+			}
+		}
+	}
+}
+
+inline bool is_exact_zero(const cln::cl_N & x) { return cln::zerop(x) && cln::instanceof(x, cln::cl_RA_ring); }
+inline bool is_exact_zero(const cln::cl_I & x) { return cln::zerop(x); }
+
+template <class T>
+void dense_mul(const std::vector<T> & a, const std::vector<T> & b,
+               std::vector<T> & c, unsigned m, unsigned l, unsigned n)
+{
+	c.assign(m*n, T(0));
+	for (unsigned i=0; i<m; ++i) {
+		for (unsigned k=0; k<l; ++k) {
+			const T & aik = a[i*l+k];
+			if (is_exact_zero(aik))
+				continue;
+			for (unsigned j=0; j<n; ++j)
+				c[i*n+j] = c[i*n+j] + aik * b[k*n+j];
+		}
+	}
+}
+
+/** Dimension below which strassen_mul() multiplies classically. */
+const unsigned strassen_cutoff = 64;
+
+/** Quadrant q (row-major, 0 is the upper left one) of the m x n matrix a,
+ *  with hm rows and hn columns, padded with zeros. */
+std::vector<cln::cl_I> quadrant(const std::vector<cln::cl_I> & a, unsigned m, unsigned n,
+                                 unsigned hm, unsigned hn, unsigned q)
+{
+	const unsigned r0 = (q/2) * hm, c0 = (q%2) * hn;
+	std::vector<cln::cl_I> result(hm*hn, cln::cl_I(0));
+	for (unsigned i=0; i<hm && r0+i<m; ++i)
+		for (unsigned j=0; j<hn && c0+j<n; ++j)
+			result[i*hn+j] = a[(r0+i)*n+c0+j];
+	return result;
+}
+
+std::vector<cln::cl_I> operator+(const std::vector<cln::cl_I> & a, const std::vector<cln::cl_I> & b)
+{
+	std::vector<cln::cl_I> c(a.size());
+	for (size_t i=0; i<a.size(); ++i)
+		c[i] = a[i] + b[i];
+	return c;
+}
+
+std::vector<cln::cl_I> operator-(const std::vector<cln::cl_I> & a, const std::vector<cln::cl_I> & b)
+{
+	std::vector<cln::cl_I> c(a.size());
+	for (size_t i=0; i<a.size(); ++i)
+		c[i] = a[i] - b[i];
+	return c;
+}
+
+/** Product c of the m x l integer matrix a and the l x n integer matrix b
+ *  by Strassen's algorithm, which multiplies the quadrants with seven
+ *  instead of eight products.  This pays off for large matrices with long
+ *  entries, where a multiplication costs much more than an addition. */
+void strassen_mul(const std::vector<cln::cl_I> & a, const std::vector<cln::cl_I> & b,
+                  std::vector<cln::cl_I> & c, unsigned m, unsigned l, unsigned n)
+{
+	if (m < strassen_cutoff || l < strassen_cutoff || n < strassen_cutoff) {
+		dense_mul(a, b, c, m, l, n);
+		return;
+	}
+	const unsigned hm = (m+1)/2, hl = (l+1)/2, hn = (n+1)/2;
+	std::vector<cln::cl_I> A[4], B[4];
+	for (unsigned q=0; q<4; ++q) {
+		A[q] = quadrant(a, m, l, hm, hl, q);
+		B[q] = quadrant(b, l, n, hl, hn, q);
+	}
+	std::vector<cln::cl_I> M[7];
+	strassen_mul(A[0] + A[3], B[0] + B[3], M[0], hm, hl, hn);
+	strassen_mul(A[2] + A[3], B[0], M[1], hm, hl, hn);
+	strassen_mul(A[0], B[1] - B[3], M[2], hm, hl, hn);
+	strassen_mul(A[3], B[2] - B[0], M[3], hm, hl, hn);
+	strassen_mul(A[0] + A[1], B[3], M[4], hm, hl, hn);
+	strassen_mul(A[2] - A[0], B[0] + B[1], M[5], hm, hl, hn);
+	strassen_mul(A[1] - A[3], B[2] + B[3], M[6], hm, hl, hn);
+	const std::vector<cln::cl_I> C[4] = { M[0] + M[3] - M[4] + M[6],
+	                                      M[2] + M[4],
+	                                      M[1] + M[3],
+	                                      M[0] - M[1] + M[2] + M[5] };
+	c.resize(m*n);
+	for (unsigned i=0; i<m; ++i)
+		for (unsigned j=0; j<n; ++j)
+			c[i*n+j] = C[(i/hm)*2 + j/hn][(i%hm)*hn + j%hn];
+}
+
+/** Gauss elimination of the m x n matrix a in row-major order, with the
+ *  same result as matrix::gauss_elimination().  With partial pivoting, the
+ *  pivot in a column is the element of largest magnitude, otherwise it is
+ *  the first non-zero one. */
+template <class T>
+int dense_gauss_elimination(std::vector<T> & a, unsigned m, unsigned n, bool det, bool partial_pivoting)
+{
+	int sign = 1;
+	unsigned r0 = 0;
+	for (unsigned c0=0; c0<n && r0<m-1; ++c0) {
+		check_budget();
+		unsigned k = m;
+		for (unsigned r=r0; r<m; ++r) {
+			if (is_zero_entry(a[r*n+c0]))
+				continue;
+			if (k == m || magnitude(a[r*n+c0]) > magnitude(a[k*n+c0]))
+				k = r;
+			if (!partial_pivoting)
+				break;
+		}
+		if (k == m) {
+			sign = 0;
+			if (det)
+				return 0;
+			continue;
+		}
+		if (k != r0) {
+			sign = -sign;
+			std::swap_ranges(a.begin()+k*n, a.begin()+(k+1)*n, a.begin()+r0*n);
+		}
+		const T p = a[r0*n+c0];
+		for (unsigned r2=r0+1; r2<m; ++r2) {
+			if (is_zero_entry(a[r2*n+c0]))
+				continue;
+			const T piv = a[r2*n+c0] / p;
+			for (unsigned c=c0+1; c<n; ++c)
+				a[r2*n+c] = a[r2*n+c] - piv * a[r0*n+c];
+			a[r2*n+c0] = T(0);
+		}
+		if (det) {
+			for (unsigned c=r0+1; c<n; ++c)
+				a[r0*n+c] = T(0);
+		}
+		++r0;
+	}
+	return sign;
+}
+
+/** Fraction-free elimination of the integer m x n matrix a in row-major
+ *  order.  All divisions are exact. */
+void dense_fraction_free_elimination(std::vector<cln::cl_I> & a, unsigned m, unsigned n)
+{
+	cln::cl_I divisor = 1;
+	unsigned r0 = 0;
+	for (unsigned c0=0; c0<n && r0<m-1; ++c0) {
+		check_budget();
+		unsigned k = r0;
+		while (k<m && cln::zerop(a[k*n+c0]))
+			++k;
+		if (k == m)
+			continue;
+		if (k != r0)
+			std::swap_ranges(a.begin()+k*n, a.begin()+(k+1)*n, a.begin()+r0*n);
+		const cln::cl_I p = a[r0*n+c0];
+		for (unsigned r2=r0+1; r2<m; ++r2) {
+			const cln::cl_I lead = a[r2*n+c0];
+			for (unsigned c=c0+1; c<n; ++c)
+				a[r2*n+c] = cln::exquo(p*a[r2*n+c] - lead*a[r0*n+c], divisor);
+			a[r2*n+c0] = 0;
+		}
+		divisor = p;
+		++r0;
+	}
+}
+
+/** Integer matrix with the same row space as the exact m x n matrix v:
+ *  every row is multiplied by the least common multiple of the
+ *  denominators in it.  The product of these factors is returned. */
+cln::cl_I integer_rows(const exvector & v, unsigned m, unsigned n, std::vector<cln::cl_I> & a)
+{
+	a.resize(m*n);
+	cln::cl_I scale = 1;
+	for (unsigned r=0; r<m; ++r) {
+		cln::cl_I d = 1;
+		for (unsigned c=0; c<n; ++c)
+			d = cln::lcm(d, cln::denominator(cln::the<cln::cl_RA>(ex_to<numeric>(v[r*n+c]).to_cl_N())));
+		for (unsigned c=0; c<n; ++c) {
+			const cln::cl_RA & x = cln::the<cln::cl_RA>(ex_to<numeric>(v[r*n+c]).to_cl_N());
+			a[r*n+c] = cln::numerator(x) * cln::exquo(d, cln::denominator(x));
+		}
+		scale = scale * d;
+	}
+	return scale;
+}
+
+/** Back substitution for the augmented m x (n+p) matrix a in upper
+ *  echelon form.  If the system has a unique solution, it is stored in the
+ *  n x p matrix x and true is returned. */
+template <class T, class R>
+bool dense_back_substitution(const std::vector<T> & a, unsigned m, unsigned n, unsigned p, std::vector<R> & x)
+{
+	const unsigned w = n + p;
+	if (m < n)
+		return false;
+	for (unsigned r=0; r<n; ++r)
+		if (is_zero_entry(a[r*w+r]))
+			return false;
+	for (unsigned r=n; r<m; ++r)
+		for (unsigned c=n; c<w; ++c)
+			if (!is_zero_entry(a[r*w+c]))
+				return false;
+	x.assign(n*p, R(0));
+	for (unsigned co=0; co<p; ++co) {
+		for (unsigned r=n; r-->0; ) {
+			R e = a[r*w+n+co];
+			for (unsigned c=r+1; c<n; ++c)
+				e = e - a[r*w+c] * x[c*p+co];
+			x[r*p+co] = e / a[r*w+r];
+		}
+	}
+	return true;
+}
+
+/** Product of numeric matrices in a dense representation.  Returns false
+ *  if an entry is not numeric. */
+bool mul_numeric(const exvector & a, const exvector & b, unsigned m, unsigned l, unsigned n, exvector & c)
+{
+	numeric_entries kind;
+	kind.add(a);
+	kind.add(b);
+	if (!kind.all_numeric)
+		return false;
+	// exact products of rational entries must not become floats
+	if (kind.fit_double() && !kind.nonzero_rational) {
+		std::vector<double> da, db, dc;
+		to_dense(a, da);
+		to_dense(b, db);
+		dense_mul(da, db, dc, m, l, n);
+		from_dense(dc, c);
+	} else if (kind.exact_integer() && std::min(m, std::min(l, n)) >= 2*strassen_cutoff) {
+		std::vector<cln::cl_I> ia, ib, ic;
+		to_dense(a, ia);
+		to_dense(b, ib);
+		strassen_mul(ia, ib, ic, m, l, n);
+		from_dense(ic, c);
+	} else {
+		std::vector<cln::cl_N> na, nb, nc;
+		to_dense(a, na);
+		to_dense(b, nb);
+		dense_mul(na, nb, nc, m, l, n);
+		from_dense(nc, c);
+	}
+	return true;
+}
+
+/** Gauss elimination of a numeric m x n matrix in a dense representation.
+ *  Returns false if an entry is not numeric. */
+bool eliminate_numeric(exvector & v, unsigned m, unsigned n, bool det, int & sign)
+{
+	numeric_entries kind;
+	kind.add(v);
+	if (!kind.all_numeric)
+		return false;
+	if (kind.fit_double()) {
+		std::vector<double> a;
+		to_dense(v, a);
+		sign = dense_gauss_elimination(a, m, n, det, true);
+		if (sign != 0 || !det)
+			from_dense(a, v);
+	} else {
+		std::vector<cln::cl_N> a;
+		to_dense(v, a);
+		sign = dense_gauss_elimination(a, m, n, det, kind.has_float);
+		if (sign != 0 || !det)
+			from_dense(a, v);
+	}
+	return true;
+}
+
+/** Solution of the numeric system with the augmented m x (n+p) matrix aug
+ *  in a dense representation.  Exact systems are made integer row by row
+ *  and solved by fraction-free elimination, floating-point ones by Gauss
+ *  elimination with partial pivoting.  If the solution is unique, it is
+ *  stored in sol and true is returned, otherwise aug is left in upper
+ *  echelon form. */
+bool solve_numeric(exvector & aug, unsigned m, unsigned n, unsigned p, exvector & sol)
+{
+	numeric_entries kind;
+	kind.add(aug);
+	GINAC_ASSERT(kind.all_numeric);
+	const unsigned w = n + p;
+	if (kind.fit_double()) {
+		std::vector<double> a, x;
+		to_dense(aug, a);
+		dense_gauss_elimination(a, m, w, false, true);
+		if (dense_back_substitution(a, m, n, p, x)) {
+			from_dense(x, sol);
+			return true;
+		}
+		from_dense(a, aug);
+	} else if (kind.exact_real()) {
+		std::vector<cln::cl_I> a;
+		integer_rows(aug, m, w, a);
+		dense_fraction_free_elimination(a, m, w);
+		std::vector<cln::cl_RA> x;
+		if (dense_back_substitution(a, m, n, p, x)) {
+			from_dense(x, sol);
+			return true;
+		}
+		from_dense(a, aug);
+	} else {
+		std::vector<cln::cl_N> a, x;
+		to_dense(aug, a);
+		dense_gauss_elimination(a, m, w, false, kind.has_float);
+		if (dense_back_substitution(a, m, n, p, x)) {
+			from_dense(x, sol);
+			return true;
+		}
+		from_dense(a, aug);
+	}
+	return false;
+}
+
+/** Number of bits of the Hadamard bound for the minors of the first n
+ *  columns of the integer m x w matrix a, i.e. of the product of the
+ *  lengths of their rows. */
+long hadamard_bits(const std::vector<cln::cl_I> & a, unsigned m, unsigned w, unsigned n)
+{
+	long bits = 0;
+	for (unsigned r=0; r<m; ++r) {
+		cln::cl_I s = 0;
+		for (unsigned c=0; c<n; ++c)
+			s = s + cln::square(a[r*w+c]);
+		bits += (long(cln::integer_length(s)) + 1) / 2;
+	}
+	return bits;
+}
+
+inline uint32_t mul_mod(uint32_t a, uint32_t b, uint32_t q)
+{
+	return uint32_t(uint64_t(a) * b % q);
 }
 
+uint32_t recip_mod(uint32_t a, uint32_t q)
+{
+	int64_t r0 = q, r1 = a, t0 = 0, t1 = 1;
+	while (r1 != 0) {
+		const int64_t k = r0 / r1;
+		const int64_t r = r0 - k*r1, t = t0 - k*t1;
+		r0 = r1; r1 = r;
+		t0 = t1; t1 = t;
+	}
+	return uint32_t(t0 < 0 ? t0 + q : t0);
+}
+
+/** Gauss-Jordan elimination of the n x (n+p) matrix a modulo the prime q.
+ *  Returns the determinant of the first n columns modulo q.  If it is not
+ *  zero, the last p columns then hold the solution of the system. */
+uint32_t eliminate_mod(std::vector<uint32_t> & a, unsigned n, unsigned p, uint32_t q)
+{
+	const unsigned w = n + p;
+	uint32_t det = 1;
+	for (unsigned c0=0; c0<n; ++c0) {
+		unsigned k = c0;
+		while (k<n && a[k*w+c0]==0)
+			++k;
+		if (k == n)
+			return 0;
+		if (k != c0) {
+			std::swap_ranges(a.begin()+k*w, a.begin()+(k+1)*w, a.begin()+c0*w);
+			det = q - det;
+		}
+		det = mul_mod(det, a[c0*w+c0], q);
+		const uint32_t inv = recip_mod(a[c0*w+c0], q);
+		for (unsigned c=c0; c<w; ++c)
+			a[c0*w+c] = mul_mod(a[c0*w+c], inv, q);
+		// for the determinant alone, the rows above need not be reduced
+		for (unsigned r=(p ? 0 : c0+1); r<n; ++r) {
+			if (r == c0 || a[r*w+c0] == 0)
+				continue;
+			const uint64_t f = q - a[r*w+c0];
+			for (unsigned c=c0; c<w; ++c)
+				a[r*w+c] = uint32_t((a[r*w+c] + f * a[c0*w+c]) % q);
+		}
+	}
+	return det;
+}
+
+/** Images of an integer n x (n+p) matrix modulo several primes, which are
+ *  eliminated in parallel.  They hold machine integers only, so they can be
+ *  worked on by several threads even though CLN numbers can't. */
+struct modular_images : public parallel_task {
+	modular_images(const std::vector<cln::cl_I> & a_, unsigned n_, unsigned p_)
+	  : a(a_), n(n_), p(p_) {}
+
+	/** Eliminates modulo the next count primes. */
+	void compute(size_t count)
+	{
+		primes.resize(count);
+		det.assign(count, 0);
+		images.resize(count);
+		for (size_t i=0; i<count; ++i) {
+			long q;
+			if (!next_prime(q, cln::cl_I(1)))
+				throw std::runtime_error("matrix: ran out of primes for the modular algorithm");
+			primes[i] = uint32_t(q);
+			const cln::cl_I modulus(q);
+			images[i].resize(a.size());
+			for (size_t j=0; j<a.size(); ++j)
+				images[i][j] = cln::cl_I_to_uint(cln::mod(a[j], modulus));
+		}
+		if (parallel_threads(count) > 1)
+			parallel_for(count, *this);
+		else
+			for (size_t i=0; i<count; ++i)
+				(*this)(i);
+	}
+
+	void operator()(size_t i)
+	{
+		det[i] = eliminate_mod(images[i], n, p, primes[i]);
+	}
+
+	/** Residue of the image i in the symmetric representation. */
+	cln::cl_I residue(size_t i, uint32_t x) const
+	{
+		return cln::cl_I(long(x) - (x > primes[i]/2 ? long(primes[i]) : 0));
+	}
+
+	const std::vector<cln::cl_I> & a;
+	const unsigned n, p;
+	primes_factory next_prime;
+	std::vector<uint32_t> primes, det;
+	std::vector<std::vector<uint32_t> > images;
+};
+
+cln::cl_I chinese_remainder(const std::vector<cln::cl_I> & residues, const std::vector<cln::cl_I> & moduli)
+{
+	if (moduli.size() == 1)
+		return residues[0];
+	return cln::integer_cra(residues, moduli);
+}
+
+/** Multimodular determinant of the integer n x n matrix a.  The images are
+ *  combined until the product of the primes exceeds twice the Hadamard
+ *  bound, which determines the determinant. */
+cln::cl_I modular_determinant(const std::vector<cln::cl_I> & a, unsigned n)
+{
+	const long bound = hadamard_bits(a, n, n, n) + 2;
+	modular_images task(a, n, 0);
+	std::vector<cln::cl_I> residues, moduli;
+	cln::cl_I M = 1;
+	while (long(cln::integer_length(M)) < bound) {
+		check_budget();
+		task.compute(parallel_threads(bound - long(cln::integer_length(M))));
+		for (size_t i=0; i<task.primes.size(); ++i) {
+			residues.push_back(task.residue(i, task.det[i]));
+			moduli.push_back(cln::cl_I(task.primes[i]));
+			M = M * moduli.back();
+		}
+	}
+	return chinese_remainder(residues, moduli);
+}
+
+/** Check that x solves the system with the augmented n x (n+p) integer
+ *  matrix a, column by column over a common denominator. */
+bool verify_solution(const std::vector<cln::cl_I> & a, unsigned n, unsigned p, const std::vector<cln::cl_RA> & x)
+{
+	const unsigned w = n + p;
+	std::vector<cln::cl_I> y(n);
+	for (unsigned co=0; co<p; ++co) {
+		cln::cl_I d = 1;
+		for (unsigned c=0; c<n; ++c)
+			d = cln::lcm(d, cln::denominator(x[c*p+co]));
+		for (unsigned c=0; c<n; ++c)
+			y[c] = cln::numerator(x[c*p+co]) * cln::exquo(d, cln::denominator(x[c*p+co]));
+		for (unsigned r=0; r<n; ++r) {
+			cln::cl_I s = 0;
+			for (unsigned c=0; c<n; ++c)
+				s = s + a[r*w+c] * y[c];
+			if (s != d * a[r*w+n+co])
+				return false;
+		}
+	}
+	return true;
+}
+
+/** Multimodular solution of the square system with the augmented integer
+ *  n x (n+p) matrix a.  The determinant is found as in
+ *  modular_determinant(), the solution modulo the product of the primes
+ *  which don't divide it by rational reconstruction.  This is tried for
+ *  doubling numbers of primes and accepted early if it checks out, and it
+ *  is certain once the product exceeds twice the square of the Hadamard
+ *  bound of the augmented matrix, which bounds the numerators and
+ *  denominators of the solution by Cramer's rule.  Returns false if the
+ *  system is singular. */
+bool modular_solve(const std::vector<cln::cl_I> & a, unsigned n, unsigned p, std::vector<cln::cl_RA> & x)
+{
+	const unsigned w = n + p;
+	const long det_bound = hadamard_bits(a, n, w, n) + 2;
+	const long sol_bound = 2*hadamard_bits(a, n, w, w) + 2;
+	modular_images task(a, n, p);
+	std::vector<cln::cl_I> det_residues, det_moduli;
+	// Residues of the entries of the solution, n*p for each prime
+	std::vector<long> moduli, residues;
+	std::vector<cln::cl_I> values;
+	cln::cl_I det_M = 1, M = 1;
+	bool regular = false;
+	size_t next_try = 2;
+	x.resize(n*p);
+	for (;;) {
+		const long missing = regular ? sol_bound - long(cln::integer_length(M))
+		                             : det_bound - long(cln::integer_length(det_M));
+		task.compute(parallel_threads(std::max(missing, 1L)));
+		for (size_t i=0; i<task.primes.size(); ++i) {
+			det_residues.push_back(task.residue(i, task.det[i]));
+			det_moduli.push_back(cln::cl_I(task.primes[i]));
+			det_M = det_M * det_moduli.back();
+			if (task.det[i] == 0)
+				continue;
+			moduli.push_back(long(task.primes[i]));
+			M = M * moduli.back();
+			for (unsigned j=0; j<n*p; ++j)
+				residues.push_back(long(task.images[i][(j/p)*w+n+j%p]));
+		}
+		if (!regular && long(cln::integer_length(det_M)) >= det_bound) {
+			if (cln::zerop(chinese_remainder(det_residues, det_moduli)))
+				return false;
+			regular = true;
+		}
+		const bool certain = regular && long(cln::integer_length(M)) >= sol_bound;
+		if (moduli.empty() || (moduli.size() < next_try && !certain))
+			continue;
+		next_try = 2*moduli.size();
+		bool reconstructed = true;
+		const cln::garner_cra crt(moduli);
+		crt(values, residues, n*p);
+		for (unsigned j=0; j<n*p && reconstructed; ++j)
+			reconstructed = rational_reconstruction(values[j], M, x[j]);
+		if (certain) {
+			if (!reconstructed)
+				throw std::logic_error("matrix: rational reconstruction failed");
+			return true;
+		}
+		if (reconstructed && verify_solution(a, n, p, x))
+			return true;
+	}
+}
+
+/** Multimodular solution of the exact square system with the augmented
+ *  n x (n+p) matrix aug.  Returns false if the entries are not all rational
+ *  or if the system is singular. */
+bool solve_modular(const exvector & aug, unsigned n, unsigned p, exvector & sol)
+{
+	numeric_entries kind;
+	kind.add(aug);
+	if (!kind.exact_real())
+		return false;
+	std::vector<cln::cl_I> a;
+	integer_rows(aug, n, n+p, a);
+	std::vector<cln::cl_RA> x;
+	if (!modular_solve(a, n, p, x))
+		return false;
+	from_dense(x, sol);
+	return true;
+}
+
+void collect_symbols(const ex & e, exset & syms)
+{
+	if (is_a<symbol>(e)) {
+		syms.insert(e);
+		return;
+	}
+	for (size_t i=0; i<e.nops(); ++i)
+		collect_symbols(e.op(i), syms);
+}
+
+/** Symbols in a matrix of polynomials with rational coefficients.  Returns
+ *  false if some entry is not such a polynomial. */
+bool polynomial_symbols(const exvector & v, exvector & vars)
+{
+	exset syms;
+	for (exvector::const_iterator i=v.begin(); i!=v.end(); ++i) {
+		if (!i->info(info_flags::rational_polynomial))
+			return false;
+		collect_symbols(*i, syms);
+	}
+	vars.assign(syms.begin(), syms.end());
+	return true;
+}
+
+/** Bounds for the degrees of the determinant of the polynomial n x n matrix
+ *  v in the symbols vars: the smaller one of the sums of the highest
+ *  degrees in the rows and in the columns. */
+std::vector<unsigned> determinant_degrees(const exvector & v, unsigned n, const exvector & vars)
+{
+	std::vector<unsigned> bounds(vars.size());
+	for (size_t j=0; j<vars.size(); ++j) {
+		std::vector<unsigned> row_max(n), col_max(n);
+		for (unsigned r=0; r<n; ++r)
+			for (unsigned c=0; c<n; ++c) {
+				const unsigned d = unsigned(v[r*n+c].degree(vars[j]));
+				row_max[r] = std::max(row_max[r], d);
+				col_max[c] = std::max(col_max[c], d);
+			}
+		unsigned row_sum = 0, col_sum = 0;
+		for (unsigned i=0; i<n; ++i) {
+			row_sum += row_max[i];
+			col_sum += col_max[i];
+		}
+		bounds[j] = std::min(row_sum, col_sum);
+	}
+	return bounds;
+}
+
+/** Number of points of the grid on which the determinant is interpolated. */
+double interpolation_points(const std::vector<unsigned> & degrees)
+{
+	double points = 1;
+	for (size_t j=0; j<degrees.size(); ++j)
+		points *= degrees[j] + 1;
+	return points;
+}
+
+inline uint32_t sub_mod(uint32_t a, uint32_t b, uint32_t q)
+{
+	return a >= b ? a - b : a + (q - b);
+}
+
+/** Replaces the values of a polynomial of degree d at the points
+ *  0, 1, ..., d, which are stored at v[0], v[stride], ..., by its
+ *  coefficients, using Newton's divided differences.  inv holds the
+ *  inverses of 1, ..., d modulo q. */
+void interpolate_mod(uint32_t * v, size_t stride, unsigned d, uint32_t q,
+                     const std::vector<uint32_t> & inv, std::vector<uint32_t> & c, std::vector<uint32_t> & r)
+{
+	c.resize(d+1);
+	for (unsigned i=0; i<=d; ++i)
+		c[i] = v[i*stride];
+	for (unsigned l=1; l<=d; ++l)
+		for (unsigned i=d; i>=l; --i)
+			c[i] = mul_mod(sub_mod(c[i], c[i-1], q), inv[l], q);
+	// from the Newton form, by multiplying with x-i from the inside out
+	r.assign(d+1, 0);
+	r[0] = c[d];
+	for (unsigned i=d; i-->0; ) {
+		for (unsigned k=d-i; k>0; --k)
+			r[k] = sub_mod(r[k-1], mul_mod(i, r[k], q), q);
+		r[0] = sub_mod(c[i], mul_mod(i, r[0], q), q);
+	}
+	for (unsigned i=0; i<=d; ++i)
+		v[i*stride] = r[i];
+}
+
+/** Determinants of an integer polynomial matrix at the points of a grid
+ *  modulo a prime, which are interpolated to the coefficients of the
+ *  determinant.  The entries are stored as lists of terms.  Their
+ *  coefficients are reduced modulo the prime in the calling thread, the
+ *  points are then handled in parallel. */
+struct polynomial_determinant_images : public parallel_task {
+	polynomial_determinant_images(unsigned n_, const std::vector<unsigned> & degrees_)
+	  : n(n_), degrees(degrees_), max_expo(degrees_.size()), term_begin(1, 0), points(1)
+	{
+		for (size_t j=0; j<degrees.size(); ++j)
+			points *= degrees[j] + 1;
+	}
+
+	/** Appends an entry, an expanded polynomial in vars with integer
+	 *  coefficients.  Returns the sum of the absolute values of its
+	 *  coefficients. */
+	cln::cl_I add_entry(const ex & e, const exvector & vars)
+	{
+		std::vector<unsigned> e_expo(vars.size());
+		cln::cl_I norm = 0;
+		add_terms(e, vars, 0, e_expo, norm);
+		term_begin.push_back(coeff.size());
+		return norm;
+	}
+
+	/** Computes the coefficients of the determinant modulo q. */
+	void compute(uint32_t q_)
+	{
+		q = q_;
+		const cln::cl_I modulus(q);
+		coeff_mod.resize(coeff.size());
+		for (size_t i=0; i<coeff.size(); ++i)
+			coeff_mod[i] = cln::cl_I_to_uint(cln::mod(coeff[i], modulus));
+		values.assign(points, 0);
+		if (parallel_threads(points) > 1)
+			parallel_for(points, *this);
+		else
+			for (size_t i=0; i<points; ++i)
+				(*this)(i);
+
+		// the grid is interpolated along one axis after the other
+		std::vector<uint32_t> c, r;
+		size_t stride = 1;
+		for (size_t j=0; j<degrees.size(); ++j) {
+			const unsigned d = degrees[j];
+			std::vector<uint32_t> inv(d+1);
+			for (unsigned l=1; l<=d; ++l)
+				inv[l] = recip_mod(l, q);
+			const size_t block = stride * (d+1);
+			for (size_t hi=0; hi<points; hi+=block)
+				for (size_t lo=0; lo<stride; ++lo)
+					interpolate_mod(&values[hi+lo], stride, d, q, inv, c, r);
+			stride = block;
+		}
+	}
+
+	/** Determinant modulo q at the grid point with index i. */
+	void operator()(size_t i)
+	{
+		const size_t k = degrees.size();
+		std::vector<std::vector<uint32_t> > powers(k);
+		size_t idx = i;
+		for (size_t j=0; j<k; ++j) {
+			const uint32_t t = uint32_t(idx % (degrees[j]+1));
+			idx /= degrees[j] + 1;
+			powers[j].resize(max_expo[j]+1);
+			powers[j][0] = 1;
+			for (unsigned e=1; e<=max_expo[j]; ++e)
+				powers[j][e] = mul_mod(powers[j][e-1], t, q);
+		}
+		std::vector<uint32_t> a(n*n);
+		for (size_t l=0; l<n*n; ++l) {
+			uint64_t s = 0;
+			for (size_t t=term_begin[l]; t<term_begin[l+1]; ++t) {
+				uint32_t m = coeff_mod[t];
+				for (size_t j=0; j<k; ++j)
+					m = mul_mod(m, powers[j][expo[t*k+j]], q);
+				s = (s + m) % q;
+			}
+			a[l] = uint32_t(s);
+		}
+		values[i] = eliminate_mod(a, n, 0, q);
+	}
+
+	const unsigned n;
+	const std::vector<unsigned> degrees;
+	std::vector<unsigned> max_expo;
+	std::vector<size_t> term_begin;  ///< terms of entry l are term_begin[l] to term_begin[l+1]-1
+	std::vector<unsigned> expo;      ///< exponents of the terms, one per symbol
+	std::vector<cln::cl_I> coeff;    ///< coefficients of the terms
+	size_t points;
+	uint32_t q;
+	std::vector<uint32_t> coeff_mod;
+	std::vector<uint32_t> values;    ///< determinants at the grid points, then coefficients
+
+private:
+	void add_terms(const ex & e, const exvector & vars, size_t j, std::vector<unsigned> & e_expo, cln::cl_I & norm)
+	{
+		if (j == vars.size()) {
+			if (e.is_zero())
+				return;
+			GINAC_ASSERT(is_exactly_a<numeric>(e) && e.info(info_flags::integer));
+			coeff.push_back(cln::the<cln::cl_I>(ex_to<numeric>(e).to_cl_N()));
+			norm = norm + cln::abs(coeff.back());
+			expo.insert(expo.end(), e_expo.begin(), e_expo.end());
+			return;
+		}
+		const int d = e.degree(vars[j]);
+		for (int i=e.ldegree(vars[j]); i<=d; ++i) {
+			e_expo[j] = unsigned(i);
+			max_expo[j] = std::max(max_expo[j], unsigned(i));
+			add_terms(e.coeff(vars[j], i), vars, j+1, e_expo, norm);
+		}
+	}
+};
+
+/** Determinant of the n x n matrix v of polynomials with rational
+ *  coefficients in vars, by evaluation and interpolation modulo primes.
+ *  Every row is made integer by multiplying it with the lcm of the
+ *  denominators.  The coefficients of the determinant are then bounded by
+ *  the product of the rows' sums of the absolute values of the
+ *  coefficients, and primes are taken until their product exceeds twice
+ *  this bound. */
+ex interpolation_determinant(const exvector & v, unsigned n, const exvector & vars)
+{
+	polynomial_determinant_images task(n, determinant_degrees(v, n, vars));
+	cln::cl_I scale = 1;
+	long bound = 2;
+	for (unsigned r=0; r<n; ++r) {
+		cln::cl_I d = 1;
+		for (unsigned c=0; c<n; ++c)
+			d = cln::lcm(d, cln::denominator(cln::the<cln::cl_RA>(v[r*n+c].integer_content().to_cl_N())));
+		cln::cl_I norm = 0;
+		for (unsigned c=0; c<n; ++c)
+			norm = norm + task.add_entry((v[r*n+c] * numeric(d)).expand(), vars);
+		bound += long(cln::integer_length(norm));
+		scale = scale * d;
+	}
+
+	primes_factory next_prime;
+	// Values at the points, task.points for each prime
+	std::vector<long> moduli, residues;
+	cln::cl_I M = 1;
+	while (long(cln::integer_length(M)) < bound) {
+		long q;
+		if (!next_prime(q, cln::cl_I(1)))
+			throw std::runtime_error("matrix: ran out of primes for the interpolation algorithm");
+		task.compute(uint32_t(q));
+		for (size_t i=0; i<task.points; ++i)
+			residues.push_back(long(task.values[i]));
+		moduli.push_back(q);
+		M = M * q;
+	}
+
+	std::vector<cln::cl_I> values;
+	const cln::garner_cra crt(moduli);
+	crt(values, residues, task.points);
+	exvector terms;
+	for (size_t i=0; i<task.points; ++i) {
+		const cln::cl_I & c = values[i];
+		if (cln::zerop(c))
+			continue;
+		ex t = dense_entry(cln::cl_RA(c) / scale);
+		size_t idx = i;
+		for (size_t j=0; j<vars.size(); ++j) {
+			t *= pow(vars[j], unsigned(idx % (task.degrees[j]+1)));
+			idx /= task.degrees[j] + 1;
+		}
+		terms.push_back(t);
+	}
+	return (new add(terms))->setflag(status_flags::dynallocated);
+}
+
+typedef std::map<ex, uint32_t, ex_is_less> point_map;
+
+/** Value of the rational function e modulo the prime q, with the symbols
+ *  replaced by the values in point.  Returns false if a denominator
+ *  vanishes or e is not a rational function with rational coefficients. */
+bool evaluate_mod(const ex & e, const point_map & point, uint32_t q, uint32_t & x)
+{
+	if (is_exactly_a<numeric>(e)) {
+		const numeric & c = ex_to<numeric>(e);
+		if (!c.is_rational())
+			return false;
+		const cln::cl_I modulus(q);
+		const uint32_t num = cln::cl_I_to_uint(cln::mod(cln::the<cln::cl_I>(c.numer().to_cl_N()), modulus));
+		const uint32_t den = cln::cl_I_to_uint(cln::mod(cln::the<cln::cl_I>(c.denom().to_cl_N()), modulus));
+		if (den == 0)
+			return false;
+		x = mul_mod(num, recip_mod(den, q), q);
+		return true;
+	}
+	if (is_a<symbol>(e)) {
+		const point_map::const_iterator i = point.find(e);
+		if (i == point.end())
+			return false;
+		x = i->second;
+		return true;
+	}
+	if (is_exactly_a<add>(e) || is_exactly_a<mul>(e)) {
+		const bool sum = is_exactly_a<add>(e);
+		x = sum ? 0 : 1;
+		for (size_t i=0; i<e.nops(); ++i) {
+			uint32_t y;
+			if (!evaluate_mod(e.op(i), point, q, y))
+				return false;
+			x = sum ? uint32_t((uint64_t(x) + y) % q) : mul_mod(x, y, q);
+		}
+		return true;
+	}
+	if (is_exactly_a<power>(e) && e.op(1).info(info_flags::integer)) {
+		uint32_t b;
+		if (!evaluate_mod(e.op(0), point, q, b))
+			return false;
+		const numeric & expo = ex_to<numeric>(e.op(1));
+		if (expo.is_negative()) {
+			if (b == 0)
+				return false;
+			b = recip_mod(b, q);
+		}
+		cln::cl_I k = cln::abs(cln::the<cln::cl_I>(expo.to_cl_N()));
+		x = 1;
+		while (!cln::zerop(k)) {
+			if (cln::oddp(k))
+				x = mul_mod(x, b, q);
+			b = mul_mod(b, b, q);
+			k = k >> 1;
+		}
+		return true;
+	}
+	return false;
+}
+
+/** Rank of the m x n matrix a modulo the prime q. */
+unsigned rank_mod(std::vector<uint32_t> & a, unsigned m, unsigned n, uint32_t q)
+{
+	unsigned r0 = 0;
+	for (unsigned c0=0; c0<n && r0<m; ++c0) {
+		check_budget();
+		unsigned k = r0;
+		while (k<m && a[k*n+c0]==0)
+			++k;
+		if (k == m)
+			continue;
+		if (k != r0)
+			std::swap_ranges(a.begin()+k*n, a.begin()+(k+1)*n, a.begin()+r0*n);
+		const uint32_t inv = recip_mod(a[r0*n+c0], q);
+		for (unsigned r=r0+1; r<m; ++r) {
+			if (a[r*n+c0] == 0)
+				continue;
+			const uint32_t f = mul_mod(a[r*n+c0], inv, q);
+			for (unsigned c=c0; c<n; ++c)
+				a[r*n+c] = sub_mod(a[r*n+c], mul_mod(f, a[r0*n+c], q), q);
+		}
+		++r0;
+	}
+	return r0;
+}
+
+/** Rank of the image of the m x n matrix v of rational functions modulo a
+ *  word-sized prime, with the symbols set to pseudo-random values.  It is
+ *  never larger than the rank of v, and smaller only if the point happens
+ *  to be a zero of all its non-vanishing minors of this size, which has a
+ *  probability of about the degree of these minors divided by the prime.
+ *  Returns false if the entries are not rational functions with rational
+ *  coefficients. */
+bool modular_rank(const exvector & v, unsigned m, unsigned n, unsigned & rk)
+{
+	exset syms;
+	for (exvector::const_iterator i=v.begin(); i!=v.end(); ++i) {
+		if (!i->info(info_flags::rational_function))
+			return false;
+		collect_symbols(*i, syms);
+	}
+
+	primes_factory next_prime;
+	uint64_t state = 0x2545f4914f6cdd1dULL;
+	for (unsigned attempt=0; attempt<3; ++attempt) {
+		long q;
+		if (!next_prime(q, cln::cl_I(1)))
+			return false;
+		point_map point;
+		for (exset::const_iterator i=syms.begin(); i!=syms.end(); ++i) {
+			// xorshift generator
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			point[*i] = uint32_t(state % uint64_t(q));
+		}
+		std::vector<uint32_t> a(v.size());
+		bool ok = true;
+		for (size_t i=0; i<v.size() && ok; ++i)
+			ok = evaluate_mod(v[i], point, uint32_t(q), a[i]);
+		if (ok) {
+			rk = rank_mod(a, m, n, uint32_t(q));
+			return true;
+		}
+		// a denominator vanished at this point, try another one
+	}
+	return false;
+}
+
+/** Widths of the band of non-zero entries of the m x n matrix v below and
+ *  above the diagonal. */
+void band_widths(const exvector & v, unsigned m, unsigned n, unsigned & lower, unsigned & upper)
+{
+	lower = upper = 0;
+	for (unsigned r=0; r<m; ++r)
+		for (unsigned c=0; c<n; ++c)
+			if (!v[r*n+c].is_zero()) {
+				if (r > c)
+					lower = std::max(lower, r-c);
+				else
+					upper = std::max(upper, c-r);
+			}
+}
+
+/** Sizes of the diagonal blocks of the n x n matrix v, outside of which
+ *  all entries vanish. */
+std::vector<unsigned> diagonal_blocks(const exvector & v, unsigned n)
+{
+	// reach[i] is the last row or column which row i or column i touch
+	std::vector<unsigned> reach(n);
+	for (unsigned r=0; r<n; ++r)
+		for (unsigned c=0; c<n; ++c)
+			if (!v[r*n+c].is_zero()) {
+				reach[r] = std::max(reach[r], c);
+				reach[c] = std::max(reach[c], r);
+			}
+	std::vector<unsigned> sizes;
+	unsigned begin = 0, end = 0;
+	for (unsigned i=0; i<n; ++i) {
+		end = std::max(end, reach[i]);
+		if (end == i) {
+			sizes.push_back(i+1-begin);
+			begin = i+1;
+		}
+	}
+	return sizes;
+}
+
+/** Check whether row (or column, if transposed) i of the n x n matrix v
+ *  consists of the powers 1, x_i, x_i^2, ..., x_i^(n-1). */
+bool is_vandermonde(const exvector & v, unsigned n, bool transposed, exvector & nodes)
+{
+	const unsigned rs = transposed ? 1 : n, cs = transposed ? n : 1;
+	for (unsigned i=0; i<n; ++i)
+		if (!v[i*rs].is_equal(_ex1))
+			return false;
+	nodes.resize(n);
+	for (unsigned i=0; i<n; ++i) {
+		nodes[i] = v[i*rs+cs];
+		for (unsigned k=2; k<n; ++k) {
+			const ex & e = v[i*rs+k*cs];
+			const ex p = pow(nodes[i], k);
+			if (!e.is_equal(p) && !(e - p).expand().is_zero())
+				return false;
+		}
+	}
+	return true;
+}
+
+bool is_toeplitz(const exvector & v, unsigned n)
+{
+	for (unsigned r=1; r<n; ++r)
+		for (unsigned c=1; c<n; ++c)
+			if (!v[r*n+c].is_equal(v[(r-1)*n+c-1]))
+				return false;
+	return true;
+}
+
+/** Determinant of the n x n Toeplitz matrix v by Levinson's recursion,
+ *  with O(n^2) operations.  The solutions f and b of T*f == e_1 and
+ *  T*b == e_k for the leading k x k block T are extended to the next one,
+ *  whose determinant is the one of T divided by the first entry of the new
+ *  f, since the trailing k x k block is T again.  Returns false if a
+ *  leading block is singular. */
+bool levinson_determinant(const exvector & v, unsigned n, ex & det)
+{
+	if (v[0].is_zero())
+		return false;
+	det = v[0];
+	exvector f(1, (1/v[0]).normal()), b(f);
+	for (unsigned k=1; k<n; ++k) {
+		ex ef = 0, eb = 0;
+		for (unsigned i=0; i<k; ++i) {
+			ef += v[k*n+i] * f[i];
+			eb += v[i+1] * b[i];
+		}
+		const ex d = (1 - ef*eb).normal();
+		if (d.is_zero())
+			return false;
+		exvector nf(k+1), nb(k+1);
+		for (unsigned i=0; i<=k; ++i) {
+			const ex fi = i<k ? f[i] : _ex0;
+			const ex bi = i>0 ? b[i-1] : _ex0;
+			nf[i] = ((fi - ef*bi) / d).normal();
+			nb[i] = ((bi - eb*fi) / d).normal();
+		}
+		det = (det * d / f[0]).normal();
+		f.swap(nf);
+		b.swap(nb);
+	}
+	return true;
+}
+
+/** Determinants of matrices with a structure that gives them directly:
+ *  triangular, block diagonal and Vandermonde matrices, and Toeplitz
+ *  matrices of rational numbers.  The result still has to be expanded or
+ *  normalized.  Returns false if the n x n matrix v has none of them. */
+bool structured_determinant(const exvector & v, unsigned n, bool rational_flag, ex & det)
+{
+	unsigned lower, upper;
+	band_widths(v, n, n, lower, upper);
+	if (lower == 0 || upper == 0) {
+		exvector diag(n);
+		for (unsigned i=0; i<n; ++i)
+			diag[i] = v[i*n+i];
+		det = (new mul(diag))->setflag(status_flags::dynallocated);
+		return true;
+	}
+
+	const std::vector<unsigned> sizes = diagonal_blocks(v, n);
+	if (sizes.size() > 1) {
+		exvector dets;
+		unsigned begin = 0;
+		for (size_t i=0; i<sizes.size(); ++i) {
+			matrix block(sizes[i], sizes[i]);
+			for (unsigned r=0; r<sizes[i]; ++r)
+				for (unsigned c=0; c<sizes[i]; ++c)
+					block(r,c) = v[(begin+r)*n+begin+c];
+			dets.push_back(block.determinant());
+			begin += sizes[i];
+		}
+		det = (new mul(dets))->setflag(status_flags::dynallocated);
+		return true;
+	}
+
+	exvector nodes;
+	if (is_vandermonde(v, n, false, nodes) || is_vandermonde(v, n, true, nodes)) {
+		exvector factors;
+		for (unsigned i=1; i<n; ++i)
+			for (unsigned j=0; j<i; ++j)
+				factors.push_back(nodes[i] - nodes[j]);
+		det = (new mul(factors))->setflag(status_flags::dynallocated);
+		return true;
+	}
+
+	return rational_flag && n >= 3 && is_toeplitz(v, n) && levinson_determinant(v, n, det);
+}
+
+/** Check whether the rows r0, ..., m-1 of an m x n matrix, from column c0
+ *  on, may be read by several threads at once.  Their hash values are
+ *  computed here, because they are cached on first use. */
+bool rows_are_shareable(const exvector & v, unsigned m, unsigned n, unsigned r0, unsigned c0)
+{
+	for (unsigned r=r0; r<m; ++r)
+		for (unsigned c=c0; c<n; ++c) {
+			if (!numerics_are_immediate(v[r*n+c]))
+				return false;
+			v[r*n+c].gethash();
+		}
+	return true;
+}
+
+/** Calls task(i) for the rows i = 0, ..., rows-1 of one step of an
+ *  algorithm, in several threads if parallel is true. */
+void run_rows(size_t rows, parallel_task & task, bool parallel)
+{
+	if (parallel && parallel_threads(rows) > 1) {
+		parallel_for(rows, task);
+		return;
+	}
+	for (size_t i=0; i<rows; ++i)
+		task(i);
+}
+
+/** Elimination of the row r0+1+i of an m x n matrix with the pivot in row
+ *  r0 and column c0, for matrix::gauss_elimination(). */
+struct gauss_row_task : public parallel_task {
+	gauss_row_task(exvector & v_, unsigned n_, unsigned r0_, unsigned c0_)
+	 : v(v_), n(n_), r0(r0_), c0(c0_) {}
+	void operator()(size_t i)
+	{
+		const unsigned r2 = r0 + 1 + unsigned(i);
+		if (!v[r2*n+c0].is_zero()) {
+			// yes, there is something to do in this row
+			ex piv = v[r2*n+c0] / v[r0*n+c0];
+			for (unsigned c=c0+1; c<n; ++c) {
+				v[r2*n+c] -= piv * v[r0*n+c];
+				if (!v[r2*n+c].info(info_flags::numeric))
+					v[r2*n+c] = v[r2*n+c].normal();
+			}
+		}
+		// fill up left hand side with zeros
+		for (unsigned c=r0; c<=c0; ++c)
+			v[r2*n+c] = _ex0;
+	}
+	exvector & v;
+	const unsigned n, r0, c0;
+};
+
+/** Fraction free elimination of the row r0+1+i of the numerators and the
+ *  denominators of an m x n matrix with the pivot in row r0 and column c0,
+ *  for matrix::fraction_free_elimination(). */
+struct fraction_free_row_task : public parallel_task {
+	fraction_free_row_task(exvector & num_, exvector & den_, unsigned n_, unsigned r0_, unsigned c0_,
+	                       const ex & divisor_n_, const ex & divisor_d_)
+	 : num(num_), den(den_), n(n_), r0(r0_), c0(c0_), divisor_n(divisor_n_), divisor_d(divisor_d_) {}
+	void operator()(size_t i)
+	{
+		const unsigned r2 = r0 + 1 + unsigned(i);
+		for (unsigned c=c0+1; c<n; ++c) {
+			const ex dividend_n = (num[r0*n+c0]*num[r2*n+c]*
+			                       den[r2*n+c0]*den[r0*n+c]
+			                      -num[r2*n+c0]*num[r0*n+c]*
+			                       den[r0*n+c0]*den[r2*n+c]).expand();
+			const ex dividend_d = (den[r2*n+c0]*den[r0*n+c]*
+			                       den[r0*n+c0]*den[r2*n+c]).expand();
+			bool check = divide(dividend_n, divisor_n, num[r2*n+c], true);
+			check &= divide(dividend_d, divisor_d, den[r2*n+c], true);
+			GINAC_ASSERT(check);
+		}
+		// fill up left hand side with zeros
+		for (unsigned c=r0; c<=c0; ++c)
+			num[r2*n+c] = _ex0;
+	}
+	exvector & num;
+	exvector & den;
+	const unsigned n, r0, c0;
+	const ex & divisor_n;
+	const ex & divisor_d;
+};
+
+/** Product of the leading block of an n x n matrix with the vector x, whose
+ *  dimension is the size of the block, for berkowitz_charpoly(). */
+struct block_product_task : public parallel_task {
+	block_product_task(const exvector & a_, unsigned n_, const exvector & x_, exvector & y_, bool normal_flag_)
+	 : a(a_), n(n_), x(x_), y(y_), normal_flag(normal_flag_) {}
+	void operator()(size_t i)
+	{
+		exvector terms;
+		terms.reserve(x.size());
+		for (size_t j=0; j<x.size(); ++j)
+			if (!a[i*n+j].is_zero() && !x[j].is_zero())
+				terms.push_back(a[i*n+j] * x[j]);
+		const ex e = (new add(terms))->setflag(status_flags::dynallocated);
+		y[i] = normal_flag ? e.normal() : e.expand();
+	}
+	const exvector & a;
+	const unsigned n;
+	const exvector & x;
+	exvector & y;
+	const bool normal_flag;
+};
+
+/** Row i of the product c of the m x l matrix a and the l x n matrix b,
+ *  for matrix::mul().  The products of an entry are collected first and
+ *  summed up by one add, instead of adding them one by one. */
+struct mul_row_task : public parallel_task {
+	mul_row_task(const exvector & a_, const exvector & b_, unsigned l_, unsigned n_, exvector & c_)
+	 : a(a_), b(b_), l(l_), n(n_), c(c_) {}
+	void operator()(size_t i)
+	{
+		exvector terms;
+		terms.reserve(l);
+		for (unsigned j=0; j<n; ++j) {
+			terms.clear();
+			for (unsigned k=0; k<l; ++k)
+				if (!a[i*l+k].is_zero() && !b[k*n+j].is_zero())
+					terms.push_back(a[i*l+k] * b[k*n+j]);
+			if (terms.empty())
+				c[i*n+j] = _ex0;
+			else if (terms.size() == 1)
+				c[i*n+j] = terms[0];
+			else
+				c[i*n+j] = (new add(terms))->setflag(status_flags::dynallocated);
+		}
+	}
+	const exvector & a;
+	const exvector & b;
+	const unsigned l, n;
+	exvector & c;
+};
+
+/** Number of products of entries from which matrix::mul() uses several
+ *  threads. */
+const size_t parallel_mul_threshold = 4096;
+
+/** Coefficients of det(lambda - A) of an n x n matrix A, from lambda^n on
+ *  down, by Berkowitz' division-free algorithm.  Step r extends the
+ *  characteristic polynomial p of the leading r x r block S to the next
+ *  one, by the product of p with the Toeplitz matrix whose first column is
+ *  1, -A(r,r), -R C, -R S C, ..., -R S^(r-1) C, where R and C are the row
+ *  and the column added to the block.  The products S^k C may be computed
+ *  by several threads. */
+exvector berkowitz_charpoly(const exvector & a, unsigned n, bool normal_flag, bool parallel)
+{
+	if (parallel)
+		parallel = rows_are_shareable(a, n, n, 0, 0);
+
+	exvector p(2);
+	p[0] = _ex1;
+	p[1] = -a[0];
+	for (unsigned r=1; r<n; ++r) {
+		exvector t(r+2);
+		t[0] = _ex1;
+		t[1] = -a[r*n+r];
+		exvector v(r), w(r);
+		for (unsigned i=0; i<r; ++i)
+			v[i] = a[i*n+r];
+		for (unsigned k=0; k<r; ++k) {
+			exvector terms;
+			for (unsigned j=0; j<r; ++j)
+				if (!a[r*n+j].is_zero() && !v[j].is_zero())
+					terms.push_back(a[r*n+j] * v[j]);
+			const ex e = (new add(terms))->setflag(status_flags::dynallocated);
+			t[k+2] = normal_flag ? (-e).normal() : (-e).expand();
+			if (k+1 < r) {
+				block_product_task task(a, n, v, w, normal_flag);
+				run_rows(r, task, parallel && rows_are_shareable(v, r, 1, 0, 0));
+				v.swap(w);
+			}
+		}
+
+		exvector q(r+2);
+		for (unsigned i=0; i<r+2; ++i) {
+			exvector terms;
+			for (unsigned j=0; j<=i && j<=r; ++j)
+				if (!t[i-j].is_zero() && !p[j].is_zero())
+					terms.push_back(t[i-j] * p[j]);
+			const ex e = (new add(terms))->setflag(status_flags::dynallocated);
+			q[i] = normal_flag ? e.normal() : e.expand();
+		}
+		p.swap(q);
+	}
+	return p;
+}
+
+} // anonymous namespace
+
 
 /** Product of matrices.
  *
  *  @exception logic_error (incompatible matrices) */
 matrix matrix::mul(const matrix & other) const
 {
+	trace_scope timer("matrix::mul");
 	if (this->cols() != other.rows())
 		throw std::logic_error("matrix::mul(): incompatible matrices");
 	
 	exvector prod(this->rows()*other.cols());
+	if (mul_numeric(m, other.m, row, col, other.col, prod))
+		return matrix(row, other.col, std::move(prod));
 	
-	for (unsigned r1=0; r1<this->rows(); ++r1) {
-		for (unsigned c=0; c<this->cols(); ++c) {
-			// Quick test: can we shortcut?
-			if (m[r1*col+c].is_zero())
-				continue;
-			for (unsigned r2=0; r2<other.cols(); ++r2)
-				prod[r1*other.col+r2] += (m[r1*col+c] * other.m[c*other.col+r2]);
-		}
-	}
-	return matrix(row, other.col, prod);
+	// The rows of large products are computed by several threads, if the
+	// library is thread-safe and no entries share CLN numbers.
+	mul_row_task task(m, other.m, col, other.col, prod);
+	run_rows(row, task, size_t(row)*col*other.col >= parallel_mul_threshold &&
+	                    parallel_threads(row) > 1 &&
+	                    rows_are_shareable(m, row, col, 0, 0) &&
+	                    rows_are_shareable(other.m, other.row, other.col, 0, 0));
+	return matrix(row, other.col, std::move(prod));
 }
 
 
@@ -619,7 +2138,7 @@ matrix matrix::mul(const numeric & other) const
 		for (unsigned c=0; c<col; ++c)
 			prod[r*col+c] = m[r*col+c] * other;
 
-	return matrix(row, col, prod);
+	return matrix(row, col, std::move(prod));
 }
 
 
@@ -635,13 +2154,14 @@ matrix matrix::mul_scalar(const ex & other) const
 		for (unsigned c=0; c<col; ++c)
 			prod[r*col+c] = m[r*col+c] * other;
 
-	return matrix(row, col, prod);
+	return matrix(row, col, std::move(prod));
 }
 
 
 /** Power of a matrix.  Currently handles integer exponents only. */
 matrix matrix::pow(const ex & expn) const
 {
+	trace_scope timer("matrix::pow");
 	if (col!=row)
 		throw (std::logic_error("matrix::pow(): matrix not square"));
 	
@@ -667,15 +2187,18 @@ matrix matrix::pow(const ex & expn) const
 			// that this is not entirely optimal but close to optimal and
 			// "better" algorithms are much harder to implement.  (See Knuth,
 			// TAoCP2, section "Evaluation of Powers" for a good discussion.)
+			// C is only multiplied once it differs from the identity.
+			bool C_is_identity = true;
 			while (b!=*_num1_p) {
 				if (b.is_odd()) {
-					C = C.mul(A);
+					C = C_is_identity ? A : C.mul(A);
+					C_is_identity = false;
 					--b;
 				}
 				b /= *_num2_p;  // still integer.
 				A = A.mul(A);
 			}
-			return A.mul(C);
+			return C_is_identity ? A : A.mul(C);
 		}
 	}
 	throw (std::runtime_error("matrix::pow(): don't know how to handle exponent"));
@@ -740,18 +2263,26 @@ matrix matrix::transpose() const
  *  @see       determinant_algo */
 ex matrix::determinant(unsigned algo) const
 {
+	trace_scope timer("matrix::determinant");
 	if (row!=col)
 		throw (std::logic_error("matrix::determinant(): matrix not square"));
 	GINAC_ASSERT(row*col==m.capacity());
+	const bool parallel = algo & determinant_algo::parallel;
+	algo &= ~determinant_algo::parallel;
 	
 	// Gather some statistical information about this matrix:
 	bool numeric_flag = true;
+	bool rational_flag = true;
 	bool normal_flag = false;
 	unsigned sparse_count = 0;  // counts non-zero elements
+	unsigned coeff_bits = 0;    // largest numerator or denominator
 	exvector::const_iterator r = m.begin(), rend = m.end();
 	while (r != rend) {
+		coeff_bits = std::max(coeff_bits, ex_to<basic>(*r).metrics().bits);
 		if (!r->info(info_flags::numeric))
 			numeric_flag = false;
+		if (!r->info(info_flags::rational))
+			rational_flag = false;
 		exmap srl;  // symbol replacement list
 		ex rtest = r->to_rational(srl);
 		if (!rtest.is_zero())
@@ -762,6 +2293,14 @@ ex matrix::determinant(unsigned algo) const
 		++r;
 	}
 	
+	// Triangular, block diagonal, Vandermonde and Toeplitz matrices are
+	// recognized first.
+	if (algo == determinant_algo::automatic && row > 1) {
+		ex det;
+		if (structured_determinant(m, row, rational_flag, det))
+			return normal_flag ? det.normal() : det.expand();
+	}
+
 	// Here is the heuristics in case this routine has to decide:
 	if (algo == determinant_algo::automatic) {
 		// Minor expansion is generally a good guess:
@@ -774,6 +2313,17 @@ ex matrix::determinant(unsigned algo) const
 		// This overrides any prior decisions.
 		if (numeric_flag)
 			algo = determinant_algo::gauss;
+		// Except for larger exact ones, where the coefficient growth
+		// makes the modular algorithm faster. With big entries this
+		// happens earlier.
+		if (rational_flag && (row>=8 || (row>=4 && coeff_bits>=64)))
+			algo = determinant_algo::modular;
+		// Larger matrices of polynomials in a few symbols suffer from
+		// expression swell with all the other algorithms.
+		exvector vars;
+		if (!numeric_flag && row>=6 && polynomial_symbols(m, vars) &&
+		    interpolation_points(determinant_degrees(m, row, vars)) <= 100000)
+			algo = determinant_algo::interpolation;
 	}
 	
 	// Trap the trivial case here, since some algorithms don't like it
@@ -790,7 +2340,7 @@ ex matrix::determinant(unsigned algo) const
 		case determinant_algo::gauss: {
 			ex det = 1;
 			matrix tmp(*this);
-			int sign = tmp.gauss_elimination(true);
+			int sign = tmp.gauss_elimination(true, parallel);
 			for (unsigned d=0; d<row; ++d)
 				det *= tmp.m[d*col+d];
 			if (normal_flag)
@@ -798,10 +2348,23 @@ ex matrix::determinant(unsigned algo) const
 			else
 				return (sign*det).normal().expand();
 		}
+		case determinant_algo::interpolation: {
+			exvector vars;
+			if (polynomial_symbols(m, vars))
+				return interpolation_determinant(m, row, vars);
+			// not polynomial, fall through
+		}
+		case determinant_algo::modular:
+			if (rational_flag) {
+				std::vector<cln::cl_I> a;
+				const cln::cl_I scale = integer_rows(m, row, col, a);
+				return dense_entry(cln::cl_RA(modular_determinant(a, row)) / scale);
+			}
+			// not exact, fall through
 		case determinant_algo::bareiss: {
 			matrix tmp(*this);
 			int sign;
-			sign = tmp.fraction_free_elimination(true);
+			sign = tmp.fraction_free_elimination(true, parallel);
 			if (normal_flag)
 				return (sign*tmp.m[row*col-1]).normal();
 			else
@@ -895,11 +2458,14 @@ ex matrix::trace() const
  *  returns the characteristic polynomial collected in powers of lambda as a
  *  new expression.
  *
+ *  @param parallel may be set to true to compute the matrix-vector products
+ *  of symbolic matrices in several threads.
  *  @return    characteristic polynomial as new expression
  *  @exception logic_error (matrix not square)
  *  @see       matrix::determinant() */
-ex matrix::charpoly(const ex & lambda) const
+ex matrix::charpoly(const ex & lambda, bool parallel) const
 {
+	trace_scope timer("matrix::charpoly");
 	if (row != col)
 		throw (std::logic_error("matrix::charpoly(): matrix not square"));
 	
@@ -933,11 +2499,29 @@ ex matrix::charpoly(const ex & lambda) const
 
 	} else {
 	
-		matrix M(*this);
-		for (unsigned r=0; r<col; ++r)
-			M.m[r*col+r] -= lambda;
-	
-		return M.determinant().collect(lambda);
+		// Berkowitz' algorithm needs no divisions, so it works on the
+		// polynomials themselves, and lambda appears only at the end.
+		bool normal_flag = false;
+		for (r=m.begin(); r!=rend; ++r) {
+			exmap srl;  // symbol replacement list
+			const ex rtest = r->to_rational(srl);
+			if (!rtest.info(info_flags::crational_polynomial) &&
+			     rtest.info(info_flags::rational_function)) {
+				normal_flag = true;
+				break;
+			}
+		}
+		const exvector p = berkowitz_charpoly(m, row, normal_flag, parallel);
+		exvector terms;
+		terms.reserve(row+1);
+		for (unsigned i=0; i<=row; ++i)
+			terms.push_back(p[i] * power(lambda, row-i));
+		ex poly = (new GiNaC::add(terms))->setflag(status_flags::dynallocated);
+		if (row%2)
+			poly = -poly;
+		if (has(lambda))
+			poly = (normal_flag ? poly.normal() : poly.expand()).collect(lambda);
+		return poly;
 	}
 }
 
@@ -949,6 +2533,7 @@ ex matrix::charpoly(const ex & lambda) const
  *  @exception runtime_error (singular matrix) */
 matrix matrix::inverse() const
 {
+	trace_scope timer("matrix::inverse");
 	if (row != col)
 		throw (std::logic_error("matrix::inverse(): matrix not square"));
 	
@@ -996,6 +2581,7 @@ matrix matrix::solve(const matrix & vars,
                      const matrix & rhs,
                      unsigned algo) const
 {
+	trace_scope timer("matrix::solve");
 	const unsigned m = this->rows();
 	const unsigned n = this->cols();
 	const unsigned p = rhs.cols();
@@ -1008,6 +2594,27 @@ matrix matrix::solve(const matrix & vars,
 			if (!vars(ro,co).info(info_flags::symbol))
 				throw (std::invalid_argument("matrix::solve(): 1st argument must be matrix of symbols"));
 	
+	const bool parallel = algo & solve_algo::parallel;
+	algo &= ~solve_algo::parallel;
+
+	// Symbolic triangular and banded systems have little fill-in, which the
+	// sparse elimination keeps that way.
+	numeric_entries kind;
+	kind.add(this->m);
+	if (algo == solve_algo::automatic && m == n && !kind.all_numeric) {
+		unsigned lower, upper;
+		band_widths(this->m, m, n, lower, upper);
+		if (lower == 0 || upper == 0 || 4*(lower+upper+1) <= n)
+			algo = solve_algo::sparse;
+	}
+	if (algo == solve_algo::sparse) {
+		try {
+			return sparse_matrix(*this).solve(vars, rhs);
+		} catch (const std::runtime_error & e) {
+			throw (std::runtime_error("matrix::solve(): inconsistent linear system"));
+		}
+	}
+	
 	// build the augmented matrix of *this with rhs attached to the right
 	matrix aug(m,n+p);
 	for (unsigned r=0; r<m; ++r) {
@@ -1019,10 +2626,13 @@ matrix matrix::solve(const matrix & vars,
 	
 	// Gather some statistical information about the augmented matrix:
 	bool numeric_flag = true;
+	bool rational_flag = true;
 	exvector::const_iterator r = aug.m.begin(), rend = aug.m.end();
 	while (r!=rend && numeric_flag==true) {
 		if (!r->info(info_flags::numeric))
 			numeric_flag = false;
+		if (!r->info(info_flags::rational))
+			rational_flag = false;
 		++r;
 	}
 	
@@ -1037,23 +2647,41 @@ matrix matrix::solve(const matrix & vars,
 		// This overrides any prior decisions.
 		if (numeric_flag)
 			algo = solve_algo::gauss;
+		// Except for larger exact square ones, where the coefficient
+		// growth makes the modular algorithm faster.
+		if (rational_flag && m==n && n>=8)
+			algo = solve_algo::modular;
 	}
 	
-	// Eliminate the augmented matrix:
+	// Eliminate the augmented matrix.  Purely numeric systems are solved
+	// without expressions if the solution is unique.
+	matrix sol(n,p);
 	switch(algo) {
+		case solve_algo::modular:
+			if (rational_flag && m==n && solve_modular(aug.m, n, p, sol.m))
+				return sol;
+			// singular or not exact
+			if (!numeric_flag) {
+				aug.fraction_free_elimination(false, parallel);
+				break;
+			}
+			// fall through
 		case solve_algo::gauss:
-			aug.gauss_elimination();
+			if (numeric_flag) {
+				if (solve_numeric(aug.m, m, n, p, sol.m))
+					return sol;
+			} else
+				aug.gauss_elimination(false, parallel);
 			break;
 		case solve_algo::divfree:
 			aug.division_free_elimination();
 			break;
 		case solve_algo::bareiss:
 		default:
-			aug.fraction_free_elimination();
+			aug.fraction_free_elimination(false, parallel);
 	}
 	
 	// assemble the solution matrix:
-	matrix sol(n,p);
 	for (unsigned co=0; co<p; ++co) {
 		unsigned last_assigned_sol = n+1;
 		for (int r=m-1; r>=0; --r) {
@@ -1087,15 +2715,121 @@ matrix matrix::solve(const matrix & vars,
 }
 
 
-/** Compute the rank of this matrix. */
-unsigned matrix::rank() const
+/** Performs the elimination.  The pivot in a column is the first non-zero
+ *  entry, or the one of largest magnitude if all entries are numeric, like
+ *  in matrix::gauss_elimination(). */
+lu_decomposition::lu_decomposition(const matrix & mat)
+  : nrows(mat.rows()), ncols(mat.cols()), lu(nrows*ncols), perm(nrows)
+{
+	const unsigned m = nrows, n = ncols;
+	bool numeric_flag = true;
+	for (unsigned r=0; r<m; ++r) {
+		perm[r] = r;
+		for (unsigned c=0; c<n; ++c) {
+			lu[r*n+c] = mat(r,c).normal();
+			if (!lu[r*n+c].info(info_flags::numeric))
+				numeric_flag = false;
+		}
+	}
+
+	unsigned r0 = 0;
+	for (unsigned c0=0; c0<n && r0<m; ++c0) {
+		check_budget();
+		unsigned p = m;
+		for (unsigned r=r0; r<m; ++r) {
+			if (lu[r*n+c0].is_zero())
+				continue;
+			if (p == m)
+				p = r;
+			if (!numeric_flag)
+				break;
+			if (abs(ex_to<numeric>(lu[r*n+c0])) > abs(ex_to<numeric>(lu[p*n+c0])))
+				p = r;
+		}
+		if (p == m)
+			continue;  // no pivot in this column
+		if (p != r0) {
+			for (unsigned c=0; c<n; ++c)
+				lu[p*n+c].swap(lu[r0*n+c]);
+			std::swap(perm[p], perm[r0]);
+		}
+		const ex & pivot = lu[r0*n+c0];
+		for (unsigned r=r0+1; r<m; ++r) {
+			if (lu[r*n+c0].is_zero())
+				continue;
+			const ex f = (lu[r*n+c0] / pivot).normal();
+			for (unsigned c=c0+1; c<n; ++c)
+				if (!lu[r0*n+c].is_zero())
+					lu[r*n+c] = (lu[r*n+c] - f * lu[r0*n+c]).normal();
+			lu[r*n+c0] = f;
+		}
+		pivot_cols.push_back(c0);
+		++r0;
+	}
+}
+
+matrix lu_decomposition::solve(const matrix & vars, const matrix & rhs) const
 {
+	const unsigned m = nrows, n = ncols, p = rhs.cols();
+	const unsigned rk = rank();
+
+	// syntax checks
+	if ((rhs.rows() != m) || (vars.rows() != n) || (vars.cols() != p))
+		throw (std::logic_error("lu_decomposition::solve(): incompatible matrices"));
+	for (unsigned ro=0; ro<n; ++ro)
+		for (unsigned co=0; co<p; ++co)
+			if (!vars(ro,co).info(info_flags::symbol))
+				throw (std::invalid_argument("lu_decomposition::solve(): 1st argument must be matrix of symbols"));
+
+	matrix sol(vars);
+	exvector y(m);
+	for (unsigned co=0; co<p; ++co) {
+		// forward substitution with L
+		for (unsigned r=0; r<m; ++r) {
+			ex e = rhs(perm[r], co);
+			for (unsigned k=0; k<r && k<rk; ++k)
+				if (!lu[r*n+pivot_cols[k]].is_zero())
+					e -= lu[r*n+pivot_cols[k]] * y[k];
+			y[r] = e.normal();
+			if (r >= rk && !y[r].is_zero())
+				throw (std::runtime_error("lu_decomposition::solve(): inconsistent linear system"));
+		}
+		// back substitution with U, the columns without a pivot are free
+		for (unsigned k=rk; k-->0; ) {
+			const unsigned pc = pivot_cols[k];
+			ex e = y[k];
+			for (unsigned c=pc+1; c<n; ++c)
+				if (!lu[k*n+c].is_zero())
+					e -= lu[k*n+c] * sol(c, co);
+			sol(pc, co) = (e / lu[k*n+pc]).normal();
+		}
+	}
+	return sol;
+}
+
+
+/** Compute the rank of this matrix.
+ *
+ *  @param algo solve_algo::modular returns the rank of an image modulo a
+ *  prime at a random point, which is correct with high probability.
+ *  Otherwise, the result is exact: it is only taken from the image if that
+ *  has full rank, and found by elimination else. */
+unsigned matrix::rank(unsigned algo) const
+{
+	trace_scope timer("matrix::rank");
 	// Method:
 	// Transform this matrix into upper echelon form and then count the
 	// number of non-zero rows.
 
 	GINAC_ASSERT(row*col==m.capacity());
 
+	// The rank of a modular image is a lower bound, and it is exact if the
+	// matrix has full rank.
+	unsigned rk;
+	if (modular_rank(m, row, col, rk) &&
+	    (rk == std::min(row, col) || algo == solve_algo::modular))
+		return rk;
+
 	// Actually, any elimination scheme will do since we are only
 	// interested in the echelon matrix' zeros.
 	matrix to_eliminate = *this;
@@ -1187,6 +2921,7 @@ ex matrix::determinant_minor() const
 	}
 	// proceed from right to left through matrix
 	for (int c=n-2; c>=0; --c) {
+		check_budget();
 		Pkey.erase(Pkey.begin(),Pkey.end());  // don't change capacity
 		Mkey.erase(Mkey.begin(),Mkey.end());
 		for (unsigned i=0; i<n-c; ++i)
@@ -1240,18 +2975,23 @@ ex matrix::determinant_minor() const
  *  @param det may be set to true to save a lot of space if one is only
  *  interested in the diagonal elements (i.e. for calculating determinants).
  *  The others are set to zero in this case.
+ *  @param parallel may be set to true to update the rows of every step in
+ *  several threads.
  *  @return sign is 1 if an even number of rows was swapped, -1 if an odd
  *  number of rows was swapped and 0 if the matrix is singular. */
-int matrix::gauss_elimination(const bool det)
+int matrix::gauss_elimination(const bool det, const bool parallel)
 {
 	ensure_if_modifiable();
 	const unsigned m = this->rows();
 	const unsigned n = this->cols();
 	GINAC_ASSERT(!det || n==m);
 	int sign = 1;
+	if (eliminate_numeric(this->m, m, n, det, sign))
+		return sign;
 	
 	unsigned r0 = 0;
 	for (unsigned c0=0; c0<n && r0<m-1; ++c0) {
+		check_budget();
 		int indx = pivot(r0, c0, true);
 		if (indx == -1) {
 			sign = 0;
@@ -1261,20 +3001,8 @@ int matrix::gauss_elimination(const bool det)
 		if (indx>=0) {
 			if (indx > 0)
 				sign = -sign;
-			for (unsigned r2=r0+1; r2<m; ++r2) {
-				if (!this->m[r2*n+c0].is_zero()) {
-					// yes, there is something to do in this row
-					ex piv = this->m[r2*n+c0] / this->m[r0*n+c0];
-					for (unsigned c=c0+1; c<n; ++c) {
-						this->m[r2*n+c] -= piv * this->m[r0*n+c];
-						if (!this->m[r2*n+c].info(info_flags::numeric))
-							this->m[r2*n+c] = this->m[r2*n+c].normal();
-					}
-				}
-				// fill up left hand side with zeros
-				for (unsigned c=r0; c<=c0; ++c)
-					this->m[r2*n+c] = _ex0;
-			}
+			gauss_row_task task(this->m, n, r0, c0);
+			run_rows(m-r0-1, task, parallel && rows_are_shareable(this->m, m, n, r0, c0));
 			if (det) {
 				// save space by deleting no longer needed elements
 				for (unsigned c=r0+1; c<n; ++c)
@@ -1311,6 +3039,7 @@ int matrix::division_free_elimination(const bool det)
 	
 	unsigned r0 = 0;
 	for (unsigned c0=0; c0<n && r0<m-1; ++c0) {
+		check_budget();
 		int indx = pivot(r0, c0, true);
 		if (indx==-1) {
 			sign = 0;
@@ -1353,9 +3082,11 @@ int matrix::division_free_elimination(const bool det)
  *  @param det may be set to true to save a lot of space if one is only
  *  interested in the last element (i.e. for calculating determinants). The
  *  others are set to zero in this case.
+ *  @param parallel may be set to true to update the rows of every step in
+ *  several threads.
  *  @return sign is 1 if an even number of rows was swapped, -1 if an odd
  *  number of rows was swapped and 0 if the matrix is singular. */
-int matrix::fraction_free_elimination(const bool det)
+int matrix::fraction_free_elimination(const bool det, const bool parallel)
 {
 	// Method:
 	// (single-step fraction free elimination scheme, already known to Jordan)
@@ -1390,8 +3121,6 @@ int matrix::fraction_free_elimination(const bool det)
 		return 1;
 	ex divisor_n = 1;
 	ex divisor_d = 1;
-	ex dividend_n;
-	ex dividend_d;
 	
 	// We populate temporary matrices to subsequently operate on.  There is
 	// one holding numerators and another holding denominators of entries.
@@ -1414,6 +3143,7 @@ int matrix::fraction_free_elimination(const bool det)
 	
 	unsigned r0 = 0;
 	for (unsigned c0=0; c0<n && r0<m-1; ++c0) {
+		check_budget();
 		// When trying to find a pivot, we should try a bit harder than expand().
 		// Searching the first non-zero element in-place here instead of calling
 		// pivot() allows us to do no more substitutions and back-substitutions
@@ -1436,24 +3166,11 @@ int matrix::fraction_free_elimination(const bool det)
 					tmp_d.m[n*indx+c].swap(tmp_d.m[n*r0+c]);
 				}
 			}
-			for (unsigned r2=r0+1; r2<m; ++r2) {
-				for (unsigned c=c0+1; c<n; ++c) {
-					dividend_n = (tmp_n.m[r0*n+c0]*tmp_n.m[r2*n+c]*
-					              tmp_d.m[r2*n+c0]*tmp_d.m[r0*n+c]
-					             -tmp_n.m[r2*n+c0]*tmp_n.m[r0*n+c]*
-					              tmp_d.m[r0*n+c0]*tmp_d.m[r2*n+c]).expand();
-					dividend_d = (tmp_d.m[r2*n+c0]*tmp_d.m[r0*n+c]*
-					              tmp_d.m[r0*n+c0]*tmp_d.m[r2*n+c]).expand();
-					bool check = divide(dividend_n, divisor_n,
-					                    tmp_n.m[r2*n+c], true);
-					check &= divide(dividend_d, divisor_d,
-					                tmp_d.m[r2*n+c], true);
-					GINAC_ASSERT(check);
-				}
-				// fill up left hand side with zeros
-				for (unsigned c=r0; c<=c0; ++c)
-					tmp_n.m[r2*n+c] = _ex0;
-			}
+			fraction_free_row_task task(tmp_n.m, tmp_d.m, n, r0, c0, divisor_n, divisor_d);
+			run_rows(m-r0-1, task, parallel &&
+			         rows_are_shareable(tmp_n.m, m, n, r0, c0) &&
+			         rows_are_shareable(tmp_d.m, m, n, r0, c0) &&
+			         numerics_are_immediate(divisor_n) && numerics_are_immediate(divisor_d));
 			if (c0<n && r0<m-1) {
 				// compute next iteration's divisor
 				divisor_n = tmp_n.m[r0*n+c0].expand();
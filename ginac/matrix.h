@@ -27,11 +27,14 @@
 #include "ex.h"
 #include "archive.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace GiNaC {
 
+struct matrix_symbol_summary;
+
 /** Helper template to allow initialization of matrices via an overloaded
  *  comma operator (idea stolen from Blitz++). */
 template <typename T, typename It>
@@ -99,6 +102,7 @@ class matrix : public basic
 public:
 	matrix(unsigned r, unsigned c);
 	matrix(unsigned r, unsigned c, const exvector & m2);
+	matrix(unsigned r, unsigned c, exvector && m2);
 	matrix(unsigned r, unsigned c, const lst & l);
 
 	// First step of initialization of matrix with a comma-separated seqeuence
@@ -151,33 +155,67 @@ public:
 	matrix transpose() const;
 	ex determinant(unsigned algo = determinant_algo::automatic) const;
 	ex trace() const;
-	ex charpoly(const ex & lambda) const;
+	ex charpoly(const ex & lambda, bool parallel = false) const;
 	matrix inverse() const;
 	matrix solve(const matrix & vars, const matrix & rhs,
 	             unsigned algo = solve_algo::automatic) const;
-	unsigned rank() const;
+	unsigned rank(unsigned algo = solve_algo::automatic) const;
 	bool is_zero_matrix() const;
 protected:
 	ex determinant_minor() const;
-	int gauss_elimination(const bool det = false);
+	int gauss_elimination(const bool det = false, const bool parallel = false);
 	int division_free_elimination(const bool det = false);
-	int fraction_free_elimination(const bool det = false);
+	int fraction_free_elimination(const bool det = false, const bool parallel = false);
 	int pivot(unsigned ro, unsigned co, bool symbolic = true);
 
 	void print_elements(const print_context & c, const char *row_start, const char *row_end, const char *row_sep, const char *col_sep) const;
 	void do_print(const print_context & c, unsigned level) const;
 	void do_print_latex(const print_latex & c, unsigned level) const;
 	void do_print_python_repr(const print_python_repr & c, unsigned level) const;
+	std::shared_ptr<const matrix_symbol_summary> symbol_summary() const;
 	
 // member variables
 protected:
 	unsigned row;             ///< number of rows
 	unsigned col;             ///< number of columns
 	exvector m;               ///< representation (cols indexed first)
+	/** Symbols in the entries, used by subs() and shared by copies. */
+	mutable std::shared_ptr<const matrix_symbol_summary> summary;
 };
 GINAC_DECLARE_UNARCHIVER(matrix); 
 
 
+/** LU decomposition P*A == L*U of an m x n matrix A by Gauss elimination,
+ *  for solving linear systems with the same coefficients and several right
+ *  hand sides.  The elimination is done once by the constructor, solve()
+ *  only needs forward and back substitution. */
+class lu_decomposition {
+public:
+	explicit lu_decomposition(const matrix & mat);
+
+	unsigned rows() const { return nrows; }
+	unsigned cols() const { return ncols; }
+	unsigned rank() const { return unsigned(pivot_cols.size()); }
+
+	/** Solve A*X == rhs like matrix::solve().
+	 *
+	 *  @param vars n x p matrix, all elements must be symbols
+	 *  @param rhs m x p matrix
+	 *  @return n x p solution matrix, which still contains some of the
+	 *          symbols of vars if the system is underdetermined
+	 *  @exception logic_error (incompatible matrices)
+	 *  @exception invalid_argument (1st argument must be matrix of symbols)
+	 *  @exception runtime_error (inconsistent linear system) */
+	matrix solve(const matrix & vars, const matrix & rhs) const;
+
+private:
+	unsigned nrows, ncols;
+	exvector lu;                       ///< multipliers of L below the pivots, U on and right of them
+	std::vector<unsigned> perm;        ///< row i of L*U is row perm[i] of A
+	std::vector<unsigned> pivot_cols;  ///< column of the pivot in row i of U
+};
+
+
 // wrapper functions around member functions
 
 inline size_t nops(const matrix & m)
@@ -213,8 +251,8 @@ inline ex charpoly(const matrix & m, const ex & lambda)
 inline matrix inverse(const matrix & m)
 { return m.inverse(); }
 
-inline unsigned rank(const matrix & m)
-{ return m.rank(); }
+inline unsigned rank(const matrix & m, unsigned algo = solve_algo::automatic)
+{ return m.rank(algo); }
 
 // utility functions
 
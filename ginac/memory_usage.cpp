@@ -0,0 +1,224 @@
+/** @file memory_usage.cpp
+ *
+ *  Implementation of the accounting of the memory held by expression
+ *  objects. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "memory_usage.h"
+#include "basic.h"
+#include "expairseq.h"
+#include "exprseq.h"
+#include "lst.h"
+#include "matrix.h"
+#include "numeric.h"
+#include "registrar.h"
+
+#include <iomanip>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+#include <mutex>
+#endif
+
+namespace GiNaC {
+
+namespace internal {
+
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+std::atomic<bool> memory_accounting_on(false);
+#else
+bool memory_accounting_on = false;
+#endif
+
+} // namespace internal
+
+namespace {
+
+/** Live objects of one class, by class index (see
+ *  registered_class_options::get_index()). */
+struct usage_row {
+	usage_row() : name(0) {}
+
+	const char *name;
+	class_memory_usage u;
+};
+
+/** What was accounted for an object, to be taken back when it dies (its
+ *  attached storage may have changed in between). */
+struct object_record {
+	unsigned index;
+	std::size_t bytes;
+};
+
+// Objects may die in another thread than the one which created them, so
+// the accounting is global. It is never deleted, since objects may die
+// after the static objects have been destroyed.
+struct accounting {
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	std::mutex mtx;
+#endif
+	std::vector<usage_row> rows;
+	std::unordered_map<const basic *, object_record> objects;
+	class_memory_usage total;
+};
+
+accounting & acc()
+{
+	static accounting * a = new accounting;
+	return *a;
+}
+
+} // anonymous namespace
+
+std::size_t internal::attached_memory(const basic & obj)
+{
+	if (is_a<numeric>(obj)) {
+		// Small integers are stored in the object, others in limbs of
+		// CLN (numerator and denominator of rationals)
+		const unsigned bits = obj.metrics().bits;
+		return bits > 29 ? 2 * (bits / 8 + 16) : 0;
+	}
+	if (is_a<expairseq>(obj))
+		return obj.nops() * sizeof(expair);
+	if (is_a<lst>(obj))
+		return obj.nops() * (sizeof(ex) + 2 * sizeof(void *));
+	if (is_a<exprseq>(obj) || is_a<matrix>(obj))
+		return obj.nops() * sizeof(ex);
+	return 0;
+}
+
+void internal::account_object(const basic & obj)
+{
+	const registered_class_options & opt = obj.get_class_info().options;
+	object_record r;
+	r.index = opt.get_index();
+	r.bytes = opt.get_object_size() + attached_memory(obj);
+
+	accounting & a = acc();
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	std::lock_guard<std::mutex> lock(a.mtx);
+#endif
+	if (!a.objects.insert(std::make_pair(&obj, r)).second)
+		return;
+	obj.setflag(status_flags::accounted);
+
+	if (r.index >= a.rows.size())
+		a.rows.resize(r.index + 1);
+	usage_row & row = a.rows[r.index];
+	row.name = opt.get_name();
+	class_memory_usage * us[2] = { &row.u, &a.total };
+	for (unsigned i=0; i<2; ++i) {
+		class_memory_usage & u = *us[i];
+		++u.objects;
+		u.bytes += r.bytes;
+		++u.allocations;
+		if (u.objects > u.peak_objects)
+			u.peak_objects = u.objects;
+		if (u.bytes > u.peak_bytes)
+			u.peak_bytes = u.bytes;
+	}
+}
+
+void internal::forget_accounted_object(const basic & obj)
+{
+	accounting & a = acc();
+	{
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+		std::lock_guard<std::mutex> lock(a.mtx);
+#endif
+		std::unordered_map<const basic *, object_record>::iterator i = a.objects.find(&obj);
+		if (i != a.objects.end()) {
+			const object_record & r = i->second;
+			class_memory_usage & u = a.rows[r.index].u;
+			--u.objects;
+			u.bytes -= r.bytes;
+			--a.total.objects;
+			a.total.bytes -= r.bytes;
+			a.objects.erase(i);
+		}
+	}
+	obj.clearflag(status_flags::accounted);
+}
+
+void set_memory_accounting_enabled(bool enabled)
+{
+	internal::memory_accounting_on = enabled;
+}
+
+bool get_memory_accounting_enabled()
+{
+	return internal::memory_accounting_active();
+}
+
+memory_usage get_memory_usage()
+{
+	memory_usage m;
+	accounting & a = acc();
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	std::lock_guard<std::mutex> lock(a.mtx);
+#endif
+	for (size_t i=0; i<a.rows.size(); ++i) {
+		const usage_row & row = a.rows[i];
+		if (row.name && (row.u.peak_objects || row.u.allocations))
+			m.classes[row.name] = row.u;
+	}
+	m.objects = a.total.objects;
+	m.bytes = a.total.bytes;
+	m.peak_objects = a.total.peak_objects;
+	m.peak_bytes = a.total.peak_bytes;
+	return m;
+}
+
+void reset_memory_peaks()
+{
+	accounting & a = acc();
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	std::lock_guard<std::mutex> lock(a.mtx);
+#endif
+	for (size_t i=0; i<=a.rows.size(); ++i) {
+		class_memory_usage & u = i < a.rows.size() ? a.rows[i].u : a.total;
+		u.peak_objects = u.objects;
+		u.peak_bytes = u.bytes;
+		u.allocations = 0;
+	}
+}
+
+void print_memory_usage(std::ostream & os)
+{
+	const memory_usage m = get_memory_usage();
+	os << std::setw(16) << std::left << "class" << std::right
+	   << ' ' << std::setw(10) << "objects" << ' ' << std::setw(14) << "bytes"
+	   << ' ' << std::setw(10) << "(peak)" << ' ' << std::setw(14) << "(peak)"
+	   << ' ' << std::setw(10) << "created" << std::endl;
+	for (memory_usage_map::const_iterator it = m.classes.begin(); it != m.classes.end(); ++it) {
+		const class_memory_usage & u = it->second;
+		os << std::setw(16) << std::left << it->first << std::right
+		   << ' ' << std::setw(10) << u.objects << ' ' << std::setw(14) << u.bytes
+		   << ' ' << std::setw(10) << u.peak_objects << ' ' << std::setw(14) << u.peak_bytes
+		   << ' ' << std::setw(10) << u.allocations << std::endl;
+	}
+	os << std::setw(16) << std::left << "total" << std::right
+	   << ' ' << std::setw(10) << m.objects << ' ' << std::setw(14) << m.bytes
+	   << ' ' << std::setw(10) << m.peak_objects << ' ' << std::setw(14) << m.peak_bytes
+	   << std::endl;
+}
+
+} // namespace GiNaC
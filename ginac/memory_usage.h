@@ -0,0 +1,112 @@
+/** @file memory_usage.h
+ *
+ *  Accounting of the memory held by expression objects, by class. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_MEMORY_USAGE_H
+#define GINAC_MEMORY_USAGE_H
+
+#include <cstddef> // for size_t
+#include <iosfwd>
+#include <map>
+#include <string>
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+#include <atomic>
+#endif
+
+namespace GiNaC {
+
+class basic;
+
+/** Live objects of one class, see get_memory_usage(). The bytes of an
+ *  object are the size of its class plus the storage attached to it: the
+ *  operand vectors of sums, products, sequences, lists and matrices, and
+ *  the digits of CLN numbers. */
+struct class_memory_usage {
+	class_memory_usage()
+	 : objects(0), bytes(0), peak_objects(0), peak_bytes(0), allocations(0) {}
+
+	unsigned long objects;          ///< objects alive now
+	unsigned long long bytes;       ///< their memory
+	unsigned long peak_objects;     ///< largest number of live objects
+	unsigned long long peak_bytes;  ///< largest memory of the live objects
+	unsigned long long allocations; ///< objects created
+};
+
+/** Memory usage by class name. */
+typedef std::map<std::string, class_memory_usage> memory_usage_map;
+
+/** A snapshot of the accounted objects. The peaks of the totals are not
+ *  the sums of the peaks of the classes, which need not occur at the same
+ *  time. */
+struct memory_usage {
+	memory_usage() : objects(0), bytes(0), peak_objects(0), peak_bytes(0) {}
+
+	memory_usage_map classes;
+	unsigned long objects;
+	unsigned long long bytes;
+	unsigned long peak_objects;
+	unsigned long long peak_bytes;
+};
+
+/** Switch the accounting on or off. It is off by default, and then costs
+ *  a single test of a flag when an object is created. Only objects which
+ *  are created while it is on are accounted (until they are destroyed,
+ *  also if it is switched off in between). Objects on the stack are not
+ *  accounted. */
+void set_memory_accounting_enabled(bool enabled = true);
+bool get_memory_accounting_enabled();
+
+/** Return the accounted objects which are alive, and the peaks since the
+ *  last call of reset_memory_peaks(). */
+memory_usage get_memory_usage();
+
+/** Set the peaks to the current usage, and the numbers of created objects
+ *  to zero. */
+void reset_memory_peaks();
+
+/** Print the result of get_memory_usage() as a table. */
+void print_memory_usage(std::ostream & os);
+
+namespace internal {
+
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+extern std::atomic<bool> memory_accounting_on;
+inline bool memory_accounting_active() { return memory_accounting_on.load(std::memory_order_relaxed); }
+#else
+extern bool memory_accounting_on;
+inline bool memory_accounting_active() { return memory_accounting_on; }
+#endif
+
+/** Estimate of the memory attached to obj, not counting the object itself
+ *  and the objects it refers to. */
+std::size_t attached_memory(const basic & obj);
+
+/** Account the new heap object obj. Called by basic::setflag(). */
+void account_object(const basic & obj);
+
+/** Remove obj from the accounting. Called when it is destroyed. */
+void forget_accounted_object(const basic & obj);
+
+} // namespace internal
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_MEMORY_USAGE_H
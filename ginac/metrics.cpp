@@ -0,0 +1,74 @@
+/** @file metrics.cpp
+ *
+ *  Size measures of expressions. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "metrics.h"
+#include "hash_map.h"
+#include "numeric.h"
+#include "power.h"
+#include "symbol.h"
+#include "utils.h"
+
+#include <vector>
+
+namespace GiNaC {
+
+/** Raise the recorded degree of the symbol s to at least d. */
+static void note_degree(exmap & degrees, const ex & s, const numeric & d)
+{
+	exmap::iterator i = degrees.find(s);
+	if (i == degrees.end())
+		degrees.insert(std::make_pair(s, ex(d)));
+	else if (ex_to<numeric>(i->second) < d)
+		i->second = d;
+}
+
+expression_metrics get_metrics(const ex & e)
+{
+	expression_metrics m;
+	const tree_metrics t = ex_to<basic>(e).metrics();
+	m.tree_size = t.size;
+	m.depth = t.depth;
+	m.coeff_bits = t.bits;
+
+	// Visit every distinct subexpression once, with an explicit stack so
+	// that deep expressions don't exhaust the C++ stack
+	exhashset visited;
+	exvector todo(1, e);
+	while (!todo.empty()) {
+		const ex x = todo.back();
+		todo.pop_back();
+		if (!visited.insert(x).second)
+			continue;
+		if (is_a<symbol>(x)) {
+			note_degree(m.max_degree, x, *_num1_p);
+		} else if (is_a<power>(x) && is_a<symbol>(x.op(0)) &&
+		           x.op(1).info(info_flags::posint)) {
+			note_degree(m.max_degree, x.op(0), ex_to<numeric>(x.op(1)));
+		}
+		for (size_t i=0; i<x.nops(); ++i)
+			todo.push_back(x.op(i));
+	}
+	m.dag_size = visited.size();
+	return m;
+}
+
+} // namespace GiNaC
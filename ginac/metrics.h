@@ -0,0 +1,49 @@
+/** @file metrics.h
+ *
+ *  Interface to size measures of expressions. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_METRICS_H
+#define GINAC_METRICS_H
+
+#include "ex.h"
+
+#include <cstddef>
+
+namespace GiNaC {
+
+/** Size measures of an expression, for estimating the cost of algorithms
+ *  on it. The first three are kept in the objects of the expression (see
+ *  basic::metrics()), the others are found by a traversal of the distinct
+ *  subexpressions. */
+struct expression_metrics {
+	std::size_t tree_size; ///< number of nodes, repeated subexpressions counted each time
+	std::size_t dag_size;  ///< number of distinct subexpressions
+	unsigned depth;        ///< height of the tree, 1 for atoms
+	unsigned coeff_bits;   ///< largest bit length of a numerator or denominator
+	exmap max_degree;      ///< highest integer exponent of each symbol (1 if it only occurs bare)
+};
+
+/** Size measures of e. */
+expression_metrics get_metrics(const ex & e);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_METRICS_H
@@ -0,0 +1,443 @@
+/** @file mseries.cpp
+ *
+ *  Implementation of truncated power series in several variables. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "mseries.h"
+#include "pseries.h"
+#include "add.h"
+#include "mul.h"
+#include "power.h"
+#include "function.h"
+#include "lst.h"
+#include "relational.h"
+#include "symbol.h"
+#include "inifcns.h" // for Order function
+#include "operators.h"
+#include "utils.h"
+#include "polynomial/packed_mpoly.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace GiNaC {
+
+mseries::mseries(const ex & e, const lst & vars_, int order)
+ : vars(vars_.begin(), vars_.end()), weights(vars_.nops(), 1), ord(order)
+{
+	init(e);
+}
+
+mseries::mseries(const ex & e, const lst & vars_, const std::vector<int> & weights_, int order)
+ : vars(vars_.begin(), vars_.end()), weights(weights_), ord(order)
+{
+	if (weights.size() != vars.size())
+		throw std::invalid_argument("mseries: numbers of weights and variables differ");
+	init(e);
+}
+
+mseries::mseries(const mseries & proto, const termvector & t, int order)
+ : vars(proto.vars), weights(proto.weights), ord(order), pk(proto.pk), terms(t)
+{
+}
+
+void mseries::init(const ex & e)
+{
+	std::vector<unsigned> max_degrees(vars.size());
+	for (size_t i=0; i<vars.size(); ++i) {
+		if (!is_a<symbol>(vars[i]))
+			throw std::invalid_argument("mseries: variables must be symbols");
+		if (weights[i] <= 0)
+			throw std::invalid_argument("mseries: weights must be positive");
+		max_degrees[i] = ord > 0 ? unsigned((ord - 1) / weights[i]) : 0;
+	}
+	monomial_packing * p = new monomial_packing;
+	pk.reset(p);
+	if (!p->init(vars, max_degrees))
+		throw std::runtime_error("mseries: exponents don't fit into a machine word");
+
+	int o = ord;
+	terms = expand(e, o);
+	ord = o;
+}
+
+/** Sort the terms, combine like terms and drop the terms of weighted
+ *  degree order or higher as well as those with zero coefficients. */
+void mseries::normalize(termvector & t, int order)
+{
+	std::sort(t.begin(), t.end(), term_less);
+	termvector r;
+	r.reserve(t.size());
+	for (size_t i=0; i<t.size(); ) {
+		size_t j = i + 1;
+		while (j < t.size() && t[j].mon == t[i].mon)
+			++j;
+		if (t[i].wdeg < order) {
+			ex c = t[i].coeff;
+			if (j > i + 1) {
+				exvector cs;
+				cs.reserve(j - i);
+				for (size_t k=i; k<j; ++k)
+					cs.push_back(t[k].coeff);
+				c = (new add(cs))->setflag(status_flags::dynallocated);
+			}
+			if (!c.is_zero())
+				r.push_back(term(t[i].mon, t[i].wdeg, c));
+		}
+		i = j;
+	}
+	t.swap(r);
+}
+
+bool mseries::term_less(const term & a, const term & b)
+{
+	return a.wdeg < b.wdeg || (a.wdeg == b.wdeg && a.mon < b.mon);
+}
+
+/** Lower bound of the weighted degrees of the terms of a series known up
+ *  to the given order. */
+int mseries::valuation(const termvector & t, int order)
+{
+	return t.empty() ? order : std::min(t[0].wdeg, order);
+}
+
+mseries::termvector mseries::sum(const termvector & a, const termvector & b, int order)
+{
+	termvector r(a);
+	r.insert(r.end(), b.begin(), b.end());
+	normalize(r, order);
+	return r;
+}
+
+/** Product of the series a, known up to oa, and b, known up to ob. On
+ *  entry, order is an upper bound for the order of the result, on return
+ *  it is the actual order. Pairs of terms beyond that order are skipped
+ *  without being multiplied. */
+mseries::termvector mseries::multiply(const termvector & a, int oa, const termvector & b, int ob, int & order) const
+{
+	order = std::min(order, std::min(oa + valuation(b, ob), ob + valuation(a, oa)));
+	termvector r;
+	for (size_t i=0; i<a.size(); ++i) {
+		const int limit = order - a[i].wdeg;
+		for (size_t j=0; j<b.size() && b[j].wdeg<limit; ++j)
+			r.push_back(term(a[i].mon + b[j].mon, a[i].wdeg + b[j].wdeg, a[i].coeff * b[j].coeff));
+	}
+	normalize(r, order);
+	return r;
+}
+
+/** Substitute the series u, which must not have a constant term, into
+ *  the power series whose coefficients are taylor. The order of u is
+ *  passed in order and is the order of the result. */
+mseries::termvector mseries::compose(const exvector & taylor, const termvector & u, int & order) const
+{
+	termvector r;
+	if (order > 0 && !taylor[0].is_zero())
+		r.push_back(term(0, 0, taylor[0]));
+	termvector pw = u;
+	int opw = order;
+	for (size_t k=1; k<taylor.size() && !pw.empty(); ++k) {
+		if (!taylor[k].is_zero())
+			for (size_t i=0; i<pw.size(); ++i)
+				r.push_back(term(pw[i].mon, pw[i].wdeg, taylor[k] * pw[i].coeff));
+		if (k + 1 < taylor.size()) {
+			int o = order;
+			pw = multiply(pw, opw, u, order, o);
+			opw = o;
+		}
+	}
+	normalize(r, order);
+	return r;
+}
+
+/** Expand e up to the weighted degree order. On return, order is the
+ *  weighted degree up to which the result is exact, which is less than the
+ *  requested one if e contains truncated series. */
+mseries::termvector mseries::expand(const ex & e, int & order) const
+{
+	termvector r;
+	bool depends = false;
+	for (size_t i=0; i<vars.size() && !depends; ++i)
+		depends = e.has(vars[i]);
+	if (!depends) {
+		if (order > 0 && !e.is_zero())
+			r.push_back(term(0, 0, e));
+		return r;
+	}
+
+	if (is_a<symbol>(e)) {
+		for (size_t i=0; i<vars.size(); ++i)
+			if (e.is_equal(vars[i])) {
+				if (weights[i] < order)
+					r.push_back(term(pk->pack(i, 1), weights[i], _ex1));
+				break;
+			}
+		return r;
+	}
+
+	if (is_exactly_a<add>(e)) {
+		int o = order;
+		for (size_t k=0; k<e.nops(); ++k) {
+			int ok = order;
+			const termvector t = expand(e.op(k), ok);
+			r.insert(r.end(), t.begin(), t.end());
+			o = std::min(o, ok);
+		}
+		normalize(r, o);
+		order = o;
+		return r;
+	}
+
+	if (is_exactly_a<mul>(e)) {
+		int o = order;
+		r = expand(e.op(0), o);
+		for (size_t k=1; k<e.nops(); ++k) {
+			int ok = order;
+			const termvector t = expand(e.op(k), ok);
+			int op = order;
+			r = multiply(r, o, t, ok, op);
+			o = op;
+		}
+		order = o;
+		return r;
+	}
+
+	if (is_exactly_a<power>(e)) {
+		const ex & expo = e.op(1);
+		if (expo.info(info_flags::nonnegint)) {
+			// Binary powering
+			int ob = order;
+			termvector b = expand(e.op(0), ob);
+			int o = order;
+			if (o > 0)
+				r.push_back(term(0, 0, _ex1));
+			for (unsigned n = ex_to<numeric>(expo).to_int(); n != 0; n >>= 1) {
+				if (n & 1) {
+					int op = order;
+					r = multiply(r, o, b, ob, op);
+					o = op;
+				}
+				if (n > 1) {
+					int op = order;
+					b = multiply(b, ob, b, ob, op);
+					ob = op;
+				}
+			}
+			order = o;
+			return r;
+		}
+		bool expo_depends = false;
+		for (size_t i=0; i<vars.size() && !expo_depends; ++i)
+			expo_depends = expo.has(vars[i]);
+		if (expo_depends)
+			return expand(exp(expo * log(e.op(0))), order);
+
+		// (a0+u)^p = sum(binomial(p,k)*a0^(p-k)*u^k, k>=0)
+		int ob = order;
+		termvector u = expand(e.op(0), ob);
+		if (u.empty() || u[0].wdeg != 0)
+			throw std::runtime_error("mseries: base of a power has no constant term");
+		const ex a0 = u[0].coeff;
+		u.erase(u.begin());
+		const int vu = valuation(u, ob);
+		exvector taylor(1, power(a0, expo));
+		for (int k=1; k*vu<ob; ++k)
+			taylor.push_back(taylor.back() * (expo - k + 1) / (a0 * k));
+		r = compose(taylor, u, ob);
+		order = ob;
+		return r;
+	}
+
+	if (is_order_function(e)) {
+		int oa = order;
+		const termvector a = expand(e.op(0), oa);
+		order = std::min(order, valuation(a, oa));
+		return r;
+	}
+
+	if (is_a<function>(e) && e.nops() == 1) {
+		// f(a0+u) = sum(f^(k)(a0)/k!*u^k, k>=0)
+		int oa = order;
+		termvector u = expand(e.op(0), oa);
+		ex a0 = _ex0;
+		if (!u.empty() && u[0].wdeg == 0) {
+			a0 = u[0].coeff;
+			u.erase(u.begin());
+		}
+		const int vu = valuation(u, oa);
+		const symbol s;
+		ex d = function(ex_to<function>(e).get_serial(), s);
+		exvector taylor(1, d.subs(s == a0));
+		numeric fact = 1;
+		for (int k=1; k*vu<oa; ++k) {
+			d = d.diff(s);
+			fact *= k;
+			taylor.push_back(d.subs(s == a0) / fact);
+		}
+		r = compose(taylor, u, oa);
+		order = oa;
+		return r;
+	}
+
+	if (is_exactly_a<pseries>(e)) {
+		const pseries & ps = ex_to<pseries>(e);
+		size_t i = 0;
+		while (i < vars.size() && !vars[i].is_equal(ps.get_var()))
+			++i;
+		if (i == vars.size() || !ps.get_point().is_zero())
+			throw std::invalid_argument("mseries: pseries must be expanded around zero in one of the variables");
+		int o = order;
+		for (size_t k=0; k<ps.nops(); ++k) {
+			const numeric d = ex_to<numeric>(ps.exponop(k));
+			if (!d.is_nonneg_integer())
+				throw std::runtime_error("mseries: Laurent and Puiseux series are not supported");
+			if (d >= numeric(o))
+				break;
+			const int wd = d.to_int() * weights[i];
+			if (is_order_function(ps.coeffop(k))) {
+				o = std::min(o, wd);
+				break;
+			}
+			if (wd >= o)
+				continue;
+			int oc = order - wd;
+			const termvector c = expand(ps.coeffop(k), oc);
+			const packed_monomial m = pk->pack(i, d.to_int());
+			for (size_t j=0; j<c.size(); ++j)
+				r.push_back(term(c[j].mon + m, c[j].wdeg + wd, c[j].coeff));
+			o = std::min(o, oc + wd);
+		}
+		normalize(r, o);
+		order = o;
+		return r;
+	}
+
+	throw std::runtime_error("mseries: don't know how to expand this expression");
+}
+
+void mseries::check_compatible(const mseries & other) const
+{
+	bool same = vars.size() == other.vars.size() && weights == other.weights;
+	for (size_t i=0; i<vars.size() && same; ++i)
+		same = vars[i].is_equal(other.vars[i]);
+	if (!same)
+		throw std::invalid_argument("mseries: series in different variables or with different weights");
+}
+
+/** Terms of other below the given order, in the packing of this series. */
+mseries::termvector mseries::repack(const mseries & other, int order) const
+{
+	termvector r;
+	for (size_t k=0; k<other.terms.size() && other.terms[k].wdeg<order; ++k) {
+		packed_monomial m = 0;
+		for (size_t i=0; i<vars.size(); ++i)
+			m += pk->pack(i, other.pk->exponent(other.terms[k].mon, i));
+		r.push_back(term(m, other.terms[k].wdeg, other.terms[k].coeff));
+	}
+	return r;
+}
+
+mseries mseries::operator+(const mseries & other) const
+{
+	check_compatible(other);
+	const mseries & lo = ord <= other.ord ? *this : other;
+	const mseries & hi = ord <= other.ord ? other : *this;
+	return mseries(lo, sum(lo.terms, lo.repack(hi, lo.ord), lo.ord), lo.ord);
+}
+
+mseries mseries::operator-(const mseries & other) const
+{
+	return *this + other.mul_const(_ex_1);
+}
+
+mseries mseries::operator*(const mseries & other) const
+{
+	check_compatible(other);
+	const mseries & lo = ord <= other.ord ? *this : other;
+	const mseries & hi = ord <= other.ord ? other : *this;
+	int o = lo.ord;
+	const termvector t = lo.multiply(lo.terms, lo.ord, lo.repack(hi, lo.ord), lo.ord, o);
+	return mseries(lo, t, o);
+}
+
+mseries mseries::mul_const(const ex & c) const
+{
+	termvector t(terms);
+	for (size_t k=0; k<t.size(); ++k)
+		t[k].coeff = c * t[k].coeff;
+	normalize(t, ord);
+	return mseries(*this, t, ord);
+}
+
+int mseries::ldegree() const
+{
+	return valuation(terms, ord);
+}
+
+ex mseries::homogeneous_part(int d) const
+{
+	exvector parts;
+	for (size_t k=0; k<terms.size(); ++k)
+		if (terms[k].wdeg == d)
+			parts.push_back(terms[k].coeff * pk->monomial_to_ex(terms[k].mon));
+	return (new add(parts))->setflag(status_flags::dynallocated);
+}
+
+ex mseries::to_polynomial() const
+{
+	exvector parts;
+	parts.reserve(terms.size());
+	for (size_t k=0; k<terms.size(); ++k)
+		parts.push_back(terms[k].coeff * pk->monomial_to_ex(terms[k].mon));
+	return (new add(parts))->setflag(status_flags::dynallocated);
+}
+
+ex mseries::to_pseries(const ex & t) const
+{
+	if (!is_a<symbol>(t))
+		throw std::invalid_argument("mseries::to_pseries(): argument must be a symbol");
+	epvector seq;
+	for (size_t k=0; k<terms.size(); ) {
+		exvector parts;
+		size_t j = k;
+		for (; j<terms.size() && terms[j].wdeg==terms[k].wdeg; ++j)
+			parts.push_back(terms[j].coeff * pk->monomial_to_ex(terms[j].mon));
+		seq.push_back(expair((new add(parts))->setflag(status_flags::dynallocated), numeric(terms[k].wdeg)));
+		k = j;
+	}
+	seq.push_back(expair(Order(_ex1), numeric(ord)));
+	return (new pseries(relational(t, _ex0), seq))->setflag(status_flags::dynallocated);
+}
+
+ex expand_truncated(const ex & e, const lst & vars, int max_degree)
+{
+	return expand_truncated(e, vars, std::vector<int>(vars.nops(), 1), max_degree);
+}
+
+ex expand_truncated(const ex & e, const lst & vars, const std::vector<int> & weights, int max_weight)
+{
+	if (max_weight < 0)
+		return _ex0;
+	// The coefficients are products and sums of parts of e which don't
+	// depend on vars, so expanding them doesn't create terms to discard
+	return mseries(e, vars, weights, max_weight + 1).to_polynomial().expand();
+}
+
+} // namespace GiNaC
@@ -0,0 +1,126 @@
+/** @file mseries.h
+ *
+ *  Interface to truncated power series in several variables. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_MSERIES_H
+#define GINAC_MSERIES_H
+
+#include "ex.h"
+
+#include <memory>
+#include <vector>
+
+namespace GiNaC {
+
+class monomial_packing;
+
+/** Power series in several variables around zero, truncated by weighted
+ *  total degree: with weights w_1,...,w_n for the variables x_1,...,x_n,
+ *  the term c*x_1^e_1*...*x_n^e_n has the weighted degree
+ *  w_1*e_1+...+w_n*e_n, and only the terms of weighted degree below the
+ *  order are kept. With all weights equal to one, this is the total degree.
+ *
+ *  The exponent vectors are packed into machine words like those of the
+ *  sparse polynomial kernel, and products only form the pairs of terms
+ *  whose weighted degrees add up to less than the order. The coefficients
+ *  may be arbitrary expressions not depending on the variables. */
+class mseries {
+public:
+	/** Expand e in the symbols vars up to the total degree order. */
+	mseries(const ex & e, const lst & vars, int order);
+
+	/** Expand e in the symbols vars up to the weighted degree order. The
+	 *  weights must be positive. */
+	mseries(const ex & e, const lst & vars, const std::vector<int> & weights, int order);
+
+	/** Weighted degree up to which the series is known. This may be lower
+	 *  than the order asked for, if e contains pseries objects or Order
+	 *  terms. */
+	int get_order() const { return ord; }
+
+	/** Number of non-zero terms. */
+	size_t nterms() const { return terms.size(); }
+
+	/** Lowest weighted degree of the terms (the order if there are none). */
+	int ldegree() const;
+
+	/** Sum of the terms of weighted degree d. */
+	ex homogeneous_part(int d) const;
+
+	/** The terms as a polynomial, without the order term. */
+	ex to_polynomial() const;
+
+	/** The series as a pseries in the symbol t, obtained by replacing
+	 *  every variable x_i by t^w_i*x_i and setting t to one in the
+	 *  coefficients: the coefficient of t^d is homogeneous_part(d), and
+	 *  the order term is Order(t^order). */
+	ex to_pseries(const ex & t) const;
+
+	mseries operator+(const mseries & other) const;
+	mseries operator-(const mseries & other) const;
+	mseries operator*(const mseries & other) const;
+
+	/** Product with an expression not depending on the variables. */
+	mseries mul_const(const ex & c) const;
+
+private:
+	struct term {
+		term(unsigned long long m, int d, const ex & c) : mon(m), wdeg(d), coeff(c) { }
+		unsigned long long mon; ///< packed exponent vector
+		int wdeg;               ///< weighted degree of mon
+		ex coeff;
+	};
+	typedef std::vector<term> termvector;
+
+	mseries(const mseries & proto, const termvector & t, int order);
+
+	void init(const ex & e);
+	void check_compatible(const mseries & other) const;
+	termvector repack(const mseries & other, int order) const;
+	termvector expand(const ex & e, int & order) const;
+	termvector compose(const exvector & taylor, const termvector & u, int & order) const;
+	termvector multiply(const termvector & a, int oa, const termvector & b, int ob, int & order) const;
+
+	static bool term_less(const term & a, const term & b);
+	static void normalize(termvector & t, int order);
+	static int valuation(const termvector & t, int order);
+	static termvector sum(const termvector & a, const termvector & b, int order);
+
+	exvector vars;
+	std::vector<int> weights;
+	int ord;
+	std::shared_ptr<const monomial_packing> pk;
+	termvector terms; ///< sorted by weighted degree, then by monomial
+};
+
+/** Expanded form of e without the terms whose total degree in the symbols
+ *  vars exceeds max_degree. Products and powers never form these terms.
+ *  Factors which are not polynomials in vars are expanded in series, as by
+ *  mseries. */
+ex expand_truncated(const ex & e, const lst & vars, int max_degree);
+
+/** Same as expand_truncated(const ex &, const lst &, int), with the
+ *  weighted total degree of mseries. */
+ex expand_truncated(const ex & e, const lst & vars, const std::vector<int> & weights, int max_weight);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_MSERIES_H
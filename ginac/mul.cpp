@@ -30,10 +30,18 @@
 #include "archive.h"
 #include "utils.h"
 #include "symbol.h"
+#include "ac_match.h"
 #include "compiler.h"
+#include "parallel.h"
+#include "budget.h"
+#include "polynomial/packed_mpoly.h"
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <limits>
+#include <map>
+#include <set>
 #include <stdexcept>
 #include <vector>
 
@@ -65,6 +73,7 @@ mul::mul(const ex & lh, const ex & rh)
 {
 	overall_coeff = _ex1;
 	construct_from_2_ex(lh,rh);
+	internal::count_event(*this, internal::stat_construction);
 	GINAC_ASSERT(is_canonical());
 }
 
@@ -72,6 +81,7 @@ mul::mul(const exvector & v)
 {
 	overall_coeff = _ex1;
 	construct_from_exvector(v);
+	internal::count_event(*this, internal::stat_construction);
 	GINAC_ASSERT(is_canonical());
 }
 
@@ -79,6 +89,7 @@ mul::mul(const epvector & v)
 {
 	overall_coeff = _ex1;
 	construct_from_epvector(v);
+	internal::count_event(*this, internal::stat_construction);
 	GINAC_ASSERT(is_canonical());
 }
 
@@ -86,6 +97,23 @@ mul::mul(const epvector & v, const ex & oc, bool do_index_renaming)
 {
 	overall_coeff = oc;
 	construct_from_epvector(v, do_index_renaming);
+	internal::count_event(*this, internal::stat_construction);
+	GINAC_ASSERT(is_canonical());
+}
+
+mul::mul(epvector && v)
+{
+	overall_coeff = _ex1;
+	construct_from_epvector(std::move(v));
+	internal::count_event(*this, internal::stat_construction);
+	GINAC_ASSERT(is_canonical());
+}
+
+mul::mul(epvector && v, const ex & oc, bool do_index_renaming)
+{
+	overall_coeff = oc;
+	construct_from_epvector(std::move(v), do_index_renaming);
+	internal::count_event(*this, internal::stat_construction);
 	GINAC_ASSERT(is_canonical());
 }
 
@@ -93,7 +121,8 @@ mul::mul(std::shared_ptr<epvector> vp, const ex & oc, bool do_index_renaming)
 {
 	GINAC_ASSERT(vp.get()!=0);
 	overall_coeff = oc;
-	construct_from_epvector(*vp, do_index_renaming);
+	construct_from_epvector(std::move(*vp), do_index_renaming);
+	internal::count_event(*this, internal::stat_construction);
 	GINAC_ASSERT(is_canonical());
 }
 
@@ -106,6 +135,7 @@ mul::mul(const ex & lh, const ex & mh, const ex & rh)
 	factors.push_back(rh);
 	overall_coeff = _ex1;
 	construct_from_exvector(factors);
+	internal::count_event(*this, internal::stat_construction);
 	GINAC_ASSERT(is_canonical());
 }
 
@@ -360,6 +390,8 @@ bool mul::is_polynomial(const ex & var) const
 
 int mul::degree(const ex & s) const
 {
+	if (!may_contain(s))
+		return 0;
 	// Sum up degrees of factors
 	int deg_sum = 0;
 	epvector::const_iterator i = seq.begin(), end = seq.end();
@@ -377,6 +409,8 @@ int mul::degree(const ex & s) const
 
 int mul::ldegree(const ex & s) const
 {
+	if (!may_contain(s))
+		return 0;
 	// Sum up degrees of factors
 	int deg_sum = 0;
 	epvector::const_iterator i = seq.begin(), end = seq.end();
@@ -394,6 +428,8 @@ int mul::ldegree(const ex & s) const
 
 ex mul::coeff(const ex & s, int n) const
 {
+	if (!may_contain(s))
+		return n==0 ? ex(*this) : _ex0;
 	exvector coeffseq;
 	coeffseq.reserve(seq.size()+1);
 	
@@ -430,6 +466,54 @@ ex mul::coeff(const ex & s, int n) const
 	return _ex0;
 }
 
+void mul::coeffs(const ex & s, std::map<int, ex> & c) const
+{
+	if (!may_contain(s)) {
+		c.insert(std::make_pair(0, ex(*this)));
+		return;
+	}
+
+	// Coefficients of the factors, combined like in coeff()
+	const size_t num = seq.size();
+	exvector factors;
+	factors.reserve(num);
+	std::vector<std::map<int, ex> > factorcoeffs(num);
+	std::set<int> degrees;
+	for (size_t k=0; k<num; ++k) {
+		factors.push_back(recombine_pair_to_ex(seq[k]));
+		ex_to<basic>(factors[k]).coeffs(s, factorcoeffs[k]);
+		for (std::map<int, ex>::const_iterator j=factorcoeffs[k].begin(); j!=factorcoeffs[k].end(); ++j)
+			if (j->first != 0)
+				degrees.insert(j->first);
+	}
+
+	// Constant coefficient: product of those of the factors
+	exvector coeffseq;
+	coeffseq.reserve(num+1);
+	for (size_t k=0; k<num; ++k) {
+		std::map<int, ex>::const_iterator j = factorcoeffs[k].find(0);
+		if (j == factorcoeffs[k].end())
+			break;
+		coeffseq.push_back(j->second);
+	}
+	if (coeffseq.size() == num) {
+		coeffseq.push_back(overall_coeff);
+		c.insert(std::make_pair(0, (new mul(coeffseq))->setflag(status_flags::dynallocated)));
+	}
+
+	// Other degrees: the factors with a coefficient of that degree are
+	// replaced by it
+	for (std::set<int>::const_iterator n=degrees.begin(); n!=degrees.end(); ++n) {
+		coeffseq.clear();
+		for (size_t k=0; k<num; ++k) {
+			std::map<int, ex>::const_iterator j = factorcoeffs[k].find(*n);
+			coeffseq.push_back(j != factorcoeffs[k].end() ? j->second : factors[k]);
+		}
+		coeffseq.push_back(overall_coeff);
+		c.insert(std::make_pair(*n, (new mul(coeffseq))->setflag(status_flags::dynallocated)));
+	}
+}
+
 /** Perform automatic term rewriting rules in this class.  In the following
  *  x, x1, x2,... stand for a symbolic variables of type ex and c, c1, c2...
  *  stand for such expressions that contain a plain number.
@@ -469,7 +553,7 @@ ex mul::eval(int level) const
 	           ex_to<numeric>((*seq.begin()).coeff).is_equal(*_num1_p)) {
 		// *(+(x,y,...);c) -> +(*(x,c),*(y,c),...) (c numeric(), no powers of +())
 		const add & addref = ex_to<add>((*seq.begin()).rest);
-		std::shared_ptr<epvector> distrseq(new epvector);
+		std::shared_ptr<epvector> distrseq = std::make_shared<epvector>();
 		distrseq->reserve(addref.seq.size());
 		epvector::const_iterator i = addref.seq.begin(), end = addref.seq.end();
 		while (i != end) {
@@ -478,7 +562,8 @@ ex mul::eval(int level) const
 		}
 		return (new add(distrseq,
 		                ex_to<numeric>(addref.overall_coeff).
-		                mul_dyn(ex_to<numeric>(overall_coeff)))
+		                mul_dyn(ex_to<numeric>(overall_coeff)),
+		                canonical_seq)
 		       )->setflag(status_flags::dynallocated | status_flags::evaluated);
 	} else if ((seq_size >= 2) && (! (flags & status_flags::expanded))) {
 		// Strip the content and the unit part from each term. Thus
@@ -487,7 +572,7 @@ ex mul::eval(int level) const
 		epvector::const_iterator last = seq.end();
 		epvector::const_iterator i = seq.begin();
 		epvector::const_iterator j = seq.begin();
-		std::shared_ptr<epvector> s(new epvector);
+		std::shared_ptr<epvector> s = std::make_shared<epvector>();
 		numeric oc = *_num1_p;
 		bool something_changed = false;
 		while (i!=last) {
@@ -563,7 +648,7 @@ ex mul::evalf(int level) const
 	if (level==-max_recursion_level)
 		throw(std::runtime_error("max recursion level reached"));
 	
-	std::shared_ptr<epvector> s(new epvector);
+	std::shared_ptr<epvector> s = std::make_shared<epvector>();
 	s->reserve(seq.size());
 
 	--level;
@@ -578,12 +663,30 @@ ex mul::evalf(int level) const
 
 void mul::find_real_imag(ex & rp, ex & ip) const
 {
-	rp = overall_coeff.real_part();
-	ip = overall_coeff.imag_part();
+	exvector rps, ips;
+	rps.reserve(seq.size());
+	ips.reserve(seq.size());
+	bool real = overall_coeff.info(info_flags::real);
 	for (epvector::const_iterator i=seq.begin(); i!=seq.end(); ++i) {
 		ex factor = recombine_pair_to_ex(*i);
-		ex new_rp = factor.real_part();
-		ex new_ip = factor.imag_part();
+		rps.push_back(factor.real_part());
+		ips.push_back(factor.imag_part());
+		if (!ips.back().is_zero())
+			real = false;
+	}
+	// A product of real factors is its own real part, don't multiply the
+	// parts together (an expanded product is returned as it is)
+	if (real) {
+		rp = ex(*this).expand();
+		ip = _ex0;
+		return;
+	}
+
+	rp = overall_coeff.real_part();
+	ip = overall_coeff.imag_part();
+	for (size_t i=0; i<rps.size(); ++i) {
+		const ex & new_rp = rps[i];
+		const ex & new_ip = ips[i];
 		if(new_ip.is_zero()) {
 			rp *= new_rp;
 			ip *= new_rp;
@@ -621,7 +724,7 @@ ex mul::evalm() const
 	// Evaluate children first, look whether there are any matrices at all
 	// (there can be either no matrices or one matrix; if there were more
 	// than one matrix, it would be a non-commutative product)
-	std::shared_ptr<epvector> s(new epvector);
+	std::shared_ptr<epvector> s = std::make_shared<epvector>();
 	s->reserve(seq.size());
 
 	bool have_matrix = false;
@@ -709,6 +812,29 @@ bool tryfactsubs(const ex & origfactor, const ex & patternfactor, int & nummatch
 	return true;
 }
 
+/** Matcher for the factors of a product in the sense of algebraic
+ *  substitutions, where a power matches the powers of the same base with
+ *  an exponent of the same sign and at least the same size. */
+class algebraic_factor_matcher : public ac_matcher {
+public:
+	algebraic_factor_matcher(const exvector & factors, const exvector & pattern_factors)
+	 : ac_matcher(factors, pattern_factors, false) {}
+
+protected:
+	bool match_operand(const ex & s, const ex & p, exmap & repls)
+	{
+		int nummatches = std::numeric_limits<int>::max();
+		return tryfactsubs(s, p, nummatches, repls);
+	}
+
+	ex key(const ex & e) const
+	{
+		if (is_exactly_a<power>(e) && e.op(1).info(info_flags::integer))
+			return e.op(0);
+		return e;
+	}
+};
+
 /** Checks wheter e matches to the pattern pat and the (possibly to be updated)
   * list of replacements repls. This matching is in the sense of algebraic
   * substitutions. Matching starts with pat.op(factor) of the pattern because
@@ -724,28 +850,30 @@ bool algebraic_match_mul_with_mul(const mul &e, const ex &pat, exmap& repls,
 	GINAC_ASSERT(subsed.size() == e.nops());
 	GINAC_ASSERT(matched.size() == e.nops());
 
-	if (factor == (int)pat.nops())
-		return true;
-
+	// The factors which are still free, and the rest of the pattern
+	exvector factors, pattern_factors;
+	std::vector<size_t> index;
 	for (size_t i=0; i<e.nops(); ++i) {
-		if(subsed[i] || matched[i])
-			continue;
-		exmap newrepls = repls;
-		int newnummatches = nummatches;
-		if (tryfactsubs(e.op(i), pat.op(factor), newnummatches, newrepls)) {
-			matched[i] = true;
-			if (algebraic_match_mul_with_mul(e, pat, newrepls, factor+1,
-					newnummatches, subsed, matched)) {
-				repls = newrepls;
-				nummatches = newnummatches;
-				return true;
-			}
-			else
-				matched[i] = false;
+		if (!subsed[i] && !matched[i]) {
+			factors.push_back(e.op(i));
+			index.push_back(i);
 		}
 	}
+	for (size_t k=factor; k<pat.nops(); ++k)
+		pattern_factors.push_back(pat.op(k));
 
-	return false;
+	algebraic_factor_matcher m(factors, pattern_factors);
+	if (!m.run(repls))
+		return false;
+
+	// How often the pattern fits is limited by the factor which fits least
+	for (size_t k=0; k<pattern_factors.size(); ++k) {
+		const size_t i = m.matched_operand(k);
+		matched[index[i]] = true;
+		exmap r = repls;
+		tryfactsubs(factors[i], pattern_factors[k], nummatches, r);
+	}
+	return true;
 }
 
 bool mul::has(const ex & pattern, unsigned options) const
@@ -849,9 +977,9 @@ ex mul::conjugate() const
 	if (!newepv && are_ex_trivially_equal(x, overall_coeff)) {
 		return *this;
 	}
-	ex result = thisexpairseq(newepv ? *newepv : seq, x);
-	delete newepv;
-	return result;
+	if (newepv)
+		return thisexpairseq(std::shared_ptr<epvector>(newepv), x);
+	return thisexpairseq(seq, x);
 }
 
 
@@ -1054,6 +1182,101 @@ bool mul::can_be_further_expanded(const ex & e)
 	return false;
 }
 
+/** Multiply the terms [first2, last2) of one sum with the terms [first1,
+ *  last1) of another one and return the sum of the products.  Helper
+ *  function for mul::expand().
+ *
+ *  @param renamed2  if not NULL, the rests of the terms of the second sum
+ *                   (starting at first2) with renamed dummy indices */
+static ex expand_product_terms(epvector::const_iterator first1, epvector::const_iterator last1,
+                               epvector::const_iterator first2, epvector::const_iterator last2,
+                               const ex * renamed2)
+{
+	numeric oc(*_num0_p);
+	epvector distrseq2;
+	distrseq2.reserve((last1 - first1) * (last2 - first2));
+	for (epvector::const_iterator i2=first2; i2!=last2; ++i2) {
+		const ex & i2_new = (renamed2 ? renamed2[i2 - first2] : i2->rest);
+		for (epvector::const_iterator i1=first1; i1!=last1; ++i1) {
+			// Don't push_back expairs which might have a rest that evaluates to a numeric,
+			// since that would violate an invariant of expairseq:
+			const ex rest = (new mul(i1->rest, i2_new))->setflag(status_flags::dynallocated);
+			if (is_exactly_a<numeric>(rest)) {
+				oc += ex_to<numeric>(rest).mul(ex_to<numeric>(i1->coeff).mul(ex_to<numeric>(i2->coeff)));
+			} else {
+				distrseq2.push_back(expair(rest, ex_to<numeric>(i1->coeff).mul_dyn(ex_to<numeric>(i2->coeff))));
+			}
+		}
+	}
+	return (new add(std::move(distrseq2), oc))->setflag(status_flags::dynallocated);
+}
+
+/** Computes slices of the products of two sums in parallel.
+ *  @see mul::expand */
+struct expand_product_task : public parallel_task {
+	expand_product_task(epvector::const_iterator first1_, epvector::const_iterator last1_,
+	                    epvector::const_iterator first2_, size_t size2_, size_t nparts_,
+	                    const ex * renamed2_, exvector & parts_)
+	 : first1(first1_), last1(last1_), first2(first2_), size2(size2_), nparts(nparts_),
+	   renamed2(renamed2_), parts(parts_) {}
+
+	void operator()(size_t i)
+	{
+		check_budget();
+		const size_t from = (i * size2) / nparts;
+		const size_t to = ((i + 1) * size2) / nparts;
+		parts[i] = expand_product_terms(first1, last1, first2 + from, first2 + to, renamed2 ? renamed2 + from : NULL);
+	}
+
+	const epvector::const_iterator first1, last1, first2;
+	const size_t size2, nparts;
+	const ex * renamed2;
+	exvector & parts;
+};
+
+/** Gives the dummy indices of terms new names where they clash with a
+ *  fixed set of dummy indices. Each clashing index gets one new name which
+ *  is used in all terms, so the new index objects are only created once,
+ *  and terms without clashes are left alone. Helper class for
+ *  mul::expand(). */
+class dummy_renaming {
+public:
+	/** @param va  the dummy indices to avoid, sorted with ex_is_less */
+	dummy_renaming(const exvector & va_) : va(va_) { }
+
+	/** Return e with the dummy indices in va renamed. */
+	ex operator()(const ex & e)
+	{
+		if (va.empty())
+			return e;
+		exvector vb = get_all_dummy_indices_safely(e);
+		if (vb.empty())
+			return e;
+		std::sort(vb.begin(), vb.end(), ex_is_less());
+		exvector common;
+		std::set_intersection(va.begin(), va.end(), vb.begin(), vb.end(), std::back_inserter(common), ex_is_less());
+		if (common.empty())
+			return e;
+
+		exmap m;
+		for (exvector::const_iterator i=common.begin(); i!=common.end(); ++i) {
+			std::map<ex, lst, ex_is_less>::iterator it = new_names.find(*i);
+			if (it == new_names.end()) {
+				const exvector old_index(1, *i);
+				it = new_names.insert(std::make_pair(*i, rename_dummy_indices_uniquely(old_index, old_index))).first;
+			}
+			const ex & indices_subs = it->second;
+			for (size_t k=0; k<indices_subs.op(0).nops(); ++k)
+				m[indices_subs.op(0).op(k)] = indices_subs.op(1).op(k);
+		}
+		return e.subs(m, subs_options::no_pattern|subs_options::no_index_renaming);
+	}
+
+private:
+	const exvector & va;
+	std::map<ex, lst, ex_is_less> new_names;
+};
+
 ex mul::expand(unsigned options) const
 {
 	{
@@ -1091,6 +1314,16 @@ ex mul::expand(unsigned options) const
 			(cit->coeff.is_equal(_ex1))) {
 			if (is_exactly_a<add>(last_expanded)) {
 
+				// Large products of polynomials with rational coefficients
+				// are multiplied out much faster in packed distributed form.
+				ex packed_product;
+				if (skip_idx_rename &&
+				    last_expanded.nops() * cit->rest.nops() >= 100 &&
+				    expand_product_packed(last_expanded, cit->rest, options, packed_product)) {
+					last_expanded = packed_product;
+					continue;
+				}
+
 				// Expand a product of two sums, aggressive version.
 				// Caring for the overall coefficients in separate loops can
 				// sometimes give a performance gain of up to 15%!
@@ -1126,49 +1359,53 @@ ex mul::expand(unsigned options) const
 				}
 
 				// Compute the new overall coefficient and put it together:
-				ex tmp_accu = (new add(distrseq, add1.overall_coeff*add2.overall_coeff))->setflag(status_flags::dynallocated);
-
-				exvector add1_dummy_indices, add2_dummy_indices, add_indices;
-				lst dummy_subs;
+				ex tmp_accu = (new add(std::move(distrseq), add1.overall_coeff*add2.overall_coeff))->setflag(status_flags::dynallocated);
 
+				// Rename the dummy indices of the terms of add2 which also
+				// occur in add1
+				exvector renamed2;
 				if (!skip_idx_rename) {
+					exvector add1_dummy_indices, add_indices;
 					for (epvector::const_iterator i=add1begin; i!=add1end; ++i) {
 						add_indices = get_all_dummy_indices_safely(i->rest);
 						add1_dummy_indices.insert(add1_dummy_indices.end(), add_indices.begin(), add_indices.end());
 					}
-					for (epvector::const_iterator i=add2begin; i!=add2end; ++i) {
-						add_indices = get_all_dummy_indices_safely(i->rest);
-						add2_dummy_indices.insert(add2_dummy_indices.end(), add_indices.begin(), add_indices.end());
-					}
-
 					sort(add1_dummy_indices.begin(), add1_dummy_indices.end(), ex_is_less());
-					sort(add2_dummy_indices.begin(), add2_dummy_indices.end(), ex_is_less());
-					dummy_subs = rename_dummy_indices_uniquely(add1_dummy_indices, add2_dummy_indices);
+					add1_dummy_indices.erase(std::unique(add1_dummy_indices.begin(), add1_dummy_indices.end(), ex_is_equal()), add1_dummy_indices.end());
+
+					dummy_renaming rename(add1_dummy_indices);
+					renamed2.reserve(add2.seq.size());
+					for (epvector::const_iterator i=add2begin; i!=add2end; ++i)
+						renamed2.push_back(rename(i->rest));
 				}
+				const ex * renamed2p = (renamed2.empty() ? NULL : &renamed2[0]);
 
 				// Multiply explicitly all non-numeric terms of add1 and add2:
-				for (epvector::const_iterator i2=add2begin; i2!=add2end; ++i2) {
-					// We really have to combine terms here in order to compactify
-					// the result.  Otherwise it would become waayy tooo bigg.
-					numeric oc(*_num0_p);
-					epvector distrseq2;
-					distrseq2.reserve(add1.seq.size());
-					const ex i2_new = (skip_idx_rename || (dummy_subs.op(0).nops() == 0) ?
-							i2->rest :
-							i2->rest.subs(ex_to<lst>(dummy_subs.op(0)), 
-								ex_to<lst>(dummy_subs.op(1)), subs_options::no_pattern));
-					for (epvector::const_iterator i1=add1begin; i1!=add1end; ++i1) {
-						// Don't push_back expairs which might have a rest that evaluates to a numeric,
-						// since that would violate an invariant of expairseq:
-						const ex rest = (new mul(i1->rest, i2_new))->setflag(status_flags::dynallocated);
-						if (is_exactly_a<numeric>(rest)) {
-							oc += ex_to<numeric>(rest).mul(ex_to<numeric>(i1->coeff).mul(ex_to<numeric>(i2->coeff)));
-						} else {
-							distrseq2.push_back(expair(rest, ex_to<numeric>(i1->coeff).mul_dyn(ex_to<numeric>(i2->coeff))));
-						}
+				const size_t add2size = add2.seq.size();
+				if ((options & expand_options::parallel) &&
+				    add1.seq.size() * add2size >= 1024 &&
+				    parallel_threads(add2size) > 1 &&
+				    numerics_are_immediate(add1.seq, add1.overall_coeff) &&
+				    numerics_are_immediate(add2.seq, add2.overall_coeff)) {
+					// Each thread sums up the products for a slice of add2,
+					// the partial sums are then combined in one go:
+					const size_t nparts = std::min(add2size, size_t(4 * parallel_threads(add2size)));
+					exvector parts(nparts + 1);
+					prepare_for_threads(add1.seq, add1.overall_coeff);
+					prepare_for_threads(add2.seq, add2.overall_coeff);
+					prepare_for_threads(renamed2);
+					expand_product_task task(add1begin, add1end, add2begin, add2size, nparts, renamed2p, parts);
+					parallel_for(nparts, task);
+					parts[nparts] = tmp_accu;
+					tmp_accu = (new add(parts))->setflag(status_flags::dynallocated);
+				} else {
+					for (epvector::const_iterator i2=add2begin; i2!=add2end; ++i2) {
+						check_budget();
+						// We really have to combine terms here in order to compactify
+						// the result.  Otherwise it would become waayy tooo bigg.
+						tmp_accu += expand_product_terms(add1begin, add1end, i2, i2 + 1, renamed2p ? renamed2p + (i2 - add2begin) : NULL);
 					}
-					tmp_accu += (new add(distrseq2, oc))->setflag(status_flags::dynallocated);
-				} 
+				}
 				last_expanded = tmp_accu;
 			} else {
 				if (!last_expanded.is_equal(_ex1))
@@ -1183,6 +1420,18 @@ ex mul::expand(unsigned options) const
 
 	// Now the only remaining thing to do is to multiply the factors which
 	// were not sums into the "last_expanded" sum
+	if (is_exactly_a<add>(last_expanded) && non_adds.empty()) {
+		// Only a number: scaling the coefficients keeps the expanded sum
+		// canonical and evaluated, so there is no need to build and sort
+		// the terms again
+		const add & addref = ex_to<add>(last_expanded);
+		std::shared_ptr<epvector> distrseq = std::make_shared<epvector>();
+		distrseq->reserve(addref.seq.size());
+		for (epvector::const_iterator i = addref.seq.begin(); i != addref.seq.end(); ++i)
+			distrseq->push_back(addref.combine_pair_with_coeff_to_pair(*i, overall_coeff));
+		return (new add(distrseq, ex_to<numeric>(addref.overall_coeff).mul_dyn(ex_to<numeric>(overall_coeff)), canonical_seq))->
+		        setflag(status_flags::dynallocated | status_flags::evaluated | (options == 0 ? status_flags::expanded : 0));
+	}
 	if (is_exactly_a<add>(last_expanded)) {
 		size_t n = last_expanded.nops();
 		exvector distrseq;
@@ -1192,14 +1441,15 @@ ex mul::expand(unsigned options) const
 			va = get_all_dummy_indices_safely(mul(non_adds));
 			sort(va.begin(), va.end(), ex_is_less());
 		}
+		dummy_renaming rename(va);
 
 		for (size_t i=0; i<n; ++i) {
 			epvector factors = non_adds;
 			if (skip_idx_rename)
 				factors.push_back(split_ex_to_pair(last_expanded.op(i)));
 			else
-				factors.push_back(split_ex_to_pair(rename_dummy_indices_uniquely(va, last_expanded.op(i))));
-			ex term = (new mul(factors, overall_coeff))->setflag(status_flags::dynallocated);
+				factors.push_back(split_ex_to_pair(rename(last_expanded.op(i))));
+			ex term = (new mul(std::move(factors), overall_coeff))->setflag(status_flags::dynallocated);
 			if (can_be_further_expanded(term)) {
 				distrseq.push_back(term.expand());
 			} else {
@@ -1214,7 +1464,7 @@ ex mul::expand(unsigned options) const
 	}
 
 	non_adds.push_back(split_ex_to_pair(last_expanded));
-	ex result = (new mul(non_adds, overall_coeff))->setflag(status_flags::dynallocated);
+	ex result = (new mul(std::move(non_adds), overall_coeff))->setflag(status_flags::dynallocated);
 	if (can_be_further_expanded(result)) {
 		return result.expand();
 	} else {
@@ -1253,7 +1503,7 @@ std::shared_ptr<epvector> mul::expandchildren(unsigned options) const
 		if (!are_ex_trivially_equal(factor,expanded_factor)) {
 			
 			// something changed, copy seq, eval and return it
-			std::shared_ptr<epvector> s(new epvector);
+			std::shared_ptr<epvector> s = std::make_shared<epvector>();
 			s->reserve(seq.size());
 			
 			// copy parts of seq which are known not to have changed
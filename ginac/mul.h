@@ -42,6 +42,8 @@ public:
 	mul(const exvector & v);
 	mul(const epvector & v);
 	mul(const epvector & v, const ex & oc, bool do_index_renaming = false);
+	mul(epvector && v);
+	mul(epvector && v, const ex & oc, bool do_index_renaming = false);
 	mul(std::shared_ptr<epvector> vp, const ex & oc, bool do_index_renaming = false);
 	mul(const ex & lh, const ex & mh, const ex & rh);
 	
@@ -53,6 +55,7 @@ public:
 	int degree(const ex & s) const;
 	int ldegree(const ex & s) const;
 	ex coeff(const ex & s, int n = 1) const;
+	void coeffs(const ex & s, std::map<int, ex> & c) const;
 	bool has(const ex & other, unsigned options = 0) const;
 	ex eval(int level=0) const;
 	ex evalf(int level=0) const;
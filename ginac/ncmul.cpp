@@ -32,6 +32,7 @@
 
 #include <algorithm>
 #include <iostream>
+#include <map>
 #include <stdexcept>
 
 namespace GiNaC {
@@ -84,6 +85,10 @@ ncmul::ncmul(const exvector & v, bool discardable) : inherited(v,discardable)
 {
 }
 
+ncmul::ncmul(exvector && v) : inherited(std::move(v))
+{
+}
+
 ncmul::ncmul(std::shared_ptr<exvector> vp) : inherited(vp)
 {
 }
@@ -116,6 +121,7 @@ bool ncmul::info(unsigned inf) const
 }
 
 typedef std::vector<std::size_t> uintvector;
+typedef std::vector<exvector> exvectorvector;
 
 ex ncmul::expand(unsigned options) const
 {
@@ -160,6 +166,20 @@ ex ncmul::expand(unsigned options) const
 
 	uintvector k(number_of_adds);
 
+	// The terms of the sums are taken apart once; add::op() recombines
+	// them on every call. Only terms with dummy indices need renaming.
+	exvectorvector summands(number_of_adds);
+	std::vector<std::vector<bool> > has_dummies(number_of_adds);
+	for (size_t i=0; i<number_of_adds; i++) {
+		const ex & s = expanded_seq[positions_of_adds[i]];
+		summands[i].reserve(number_of_add_operands[i]);
+		has_dummies[i].reserve(number_of_add_operands[i]);
+		for (size_t t=0; t<number_of_add_operands[i]; t++) {
+			summands[i].push_back(s.op(t));
+			has_dummies[i].push_back(!get_all_dummy_indices_safely(summands[i].back()).empty());
+		}
+	}
+
 	/* Rename indices in the static members of the product */
 	exvector expanded_seq_mod;
 	size_t j = 0;
@@ -177,10 +197,11 @@ ex ncmul::expand(unsigned options) const
 	while (true) {
 		exvector term = expanded_seq_mod;
 		for (size_t i=0; i<number_of_adds; i++) {
-			term[positions_of_adds[i]] = rename_dummy_indices_uniquely(va, expanded_seq[positions_of_adds[i]].op(k[i]), true);
+			const ex & summand = summands[i][k[i]];
+			term[positions_of_adds[i]] = has_dummies[i][k[i]] ? rename_dummy_indices_uniquely(va, summand, true) : summand;
 		}
 
-		distrseq.push_back((new ncmul(term, true))->
+		distrseq.push_back((new ncmul(std::move(term)))->
 		                    setflag(status_flags::dynallocated | (options == 0 ? status_flags::expanded : 0)));
 
 		// increment k[]
@@ -288,7 +309,6 @@ void ncmul::append_factors(exvector & v, const ex & e) const
 }
 
 typedef std::vector<unsigned> unsignedvector;
-typedef std::vector<exvector> exvectorvector;
 
 /** Perform automatic term rewriting rules in this class.  In the following
  *  x, x1, x2,... stand for a symbolic variables of type ex and c, c1, c2...
@@ -390,30 +410,19 @@ ex ncmul::eval(int level) const
 		// elements in assocseq
 		GINAC_ASSERT(count_commutative==0);
 
+		// partition the factors by their representation label in one pass,
+		// keeping the order of the labels and of the factors of each label
 		size_t assoc_num = assocseq.size();
 		exvectorvector evv;
-		std::vector<return_type_t> rttinfos;
-		evv.reserve(assoc_num);
-		rttinfos.reserve(assoc_num);
+		std::map<return_type_t, size_t> rttinfos;
 
 		cit = assocseq.begin(), citend = assocseq.end();
 		while (cit != citend) {
-			return_type_t ti = cit->return_type_tinfo();
-			size_t rtt_num = rttinfos.size();
-			// search type in vector of known types
-			for (i=0; i<rtt_num; ++i) {
-				if(ti == rttinfos[i]) {
-					evv[i].push_back(*cit);
-					break;
-				}
-			}
-			if (i >= rtt_num) {
-				// new type
-				rttinfos.push_back(ti);
+			std::pair<std::map<return_type_t, size_t>::iterator, bool> ins
+				= rttinfos.insert(std::make_pair(cit->return_type_tinfo(), evv.size()));
+			if (ins.second)
 				evv.push_back(exvector());
-				(evv.end()-1)->reserve(assoc_num);
-				(evv.end()-1)->push_back(*cit);
-			}
+			evv[ins.first->second].push_back(*cit);
 			++cit;
 		}
 
@@ -444,6 +453,58 @@ ex ncmul::eval(int level) const
 										  status_flags::evaluated);
 }
 
+/** Product of the matrices i to j starting at first, split as found by
+ *  chain_product(). */
+static matrix multiply_along_splits(exvector::const_iterator first,
+                                    const std::vector<std::vector<size_t> > & split,
+                                    size_t i, size_t j)
+{
+	if (i == j)
+		return ex_to<matrix>(first[i]);
+	const size_t k = split[i][j];
+	return multiply_along_splits(first, split, i, k).mul(multiply_along_splits(first, split, k + 1, j));
+}
+
+/** Product of the matrices [first, last), multiplied in the order which
+ *  needs the fewest multiplications of entries (found by the dynamic
+ *  programming algorithm for matrix chains). */
+static matrix chain_product(exvector::const_iterator first, exvector::const_iterator last)
+{
+	const size_t n = last - first;
+	if (n == 1)
+		return ex_to<matrix>(*first);
+
+	// The i-th matrix has dim[i] rows and dim[i+1] columns
+	std::vector<double> dim(n + 1);
+	for (size_t i=0; i<n; ++i) {
+		const matrix & m = ex_to<matrix>(first[i]);
+		if (i > 0 && m.rows() != dim[i])
+			throw std::logic_error("matrix::mul(): incompatible matrices");
+		dim[i] = m.rows();
+		dim[i+1] = m.cols();
+	}
+
+	// cost[i][j] is the cost of the product of the matrices i to j, which
+	// is split after the matrix split[i][j]
+	std::vector<std::vector<double> > cost(n, std::vector<double>(n, 0));
+	std::vector<std::vector<size_t> > split(n, std::vector<size_t>(n, 0));
+	for (size_t len=1; len<n; ++len) {
+		for (size_t i=0; i+len<n; ++i) {
+			const size_t j = i + len;
+			cost[i][j] = -1;
+			for (size_t k=i; k<j; ++k) {
+				const double c = cost[i][k] + cost[k+1][j] + dim[i] * dim[k+1] * dim[j+1];
+				if (cost[i][j] < 0 || c < cost[i][j]) {
+					cost[i][j] = c;
+					split[i][j] = k;
+				}
+			}
+		}
+	}
+
+	return multiply_along_splits(first, split, 0, n - 1);
+}
+
 ex ncmul::evalm() const
 {
 	// Evaluate children first
@@ -455,22 +516,12 @@ ex ncmul::evalm() const
 		it++;
 	}
 
-	// If there are only matrices, simply multiply them
-	it = s->begin(); itend = s->end();
-	if (is_a<matrix>(*it)) {
-		matrix prod(ex_to<matrix>(*it));
-		it++;
-		while (it != itend) {
-			if (!is_a<matrix>(*it))
-				goto no_matrix;
-			prod = prod.mul(ex_to<matrix>(*it));
-			it++;
-		}
-		return prod;
+	// If there are only matrices, multiply them in the cheapest order
+	for (it = s->begin(), itend = s->end(); it != itend; ++it) {
+		if (!is_a<matrix>(*it))
+			return (new ncmul(s))->setflag(status_flags::dynallocated);
 	}
-
-no_matrix:
-	return (new ncmul(s))->setflag(status_flags::dynallocated);
+	return chain_product(s->begin(), s->end());
 }
 
 ex ncmul::thiscontainer(const exvector & v) const
@@ -50,6 +50,7 @@ public:
 	ncmul(const ex & f1, const ex & f2, const ex & f3,
 	      const ex & f4, const ex & f5, const ex & f6);
 	ncmul(const exvector & v, bool discardable=false);
+	ncmul(exvector && v);
 	ncmul(std::shared_ptr<exvector> vp);
 
 	// functions overriding virtual functions from base classes
@@ -28,8 +28,11 @@
 #include "ex.h"
 #include "add.h"
 #include "constant.h"
+#include "evalplan.h"
 #include "expairseq.h"
+#include "exprseq.h"
 #include "fail.h"
+#include "hash_map.h"
 #include "inifcns.h"
 #include "lst.h"
 #include "mul.h"
@@ -38,13 +41,23 @@
 #include "relational.h"
 #include "operators.h"
 #include "matrix.h"
+#include "parallel.h"
 #include "pseries.h"
 #include "symbol.h"
 #include "utils.h"
 #include "polynomial/chinrem_gcd.h"
+#include "polynomial/kronecker.h"
+#include "polynomial/mod_resultant.h"
+#include "polynomial/packed_mpoly.h"
+#include "polynomial/primes_factory.h"
+#include "polynomial/rational_interp.h"
+#include "polynomial/sparse_mpoly.h"
+#include "polynomial/sqrfree_mod.h"
 
 #include <algorithm>
 #include <map>
+#include <set>
+#include <stdint.h> // for uint64_t
 
 namespace GiNaC {
 
@@ -171,6 +184,8 @@ static void add_symbol(const ex &s, sym_desc_vec &v)
 // Collect all symbols of an expression (used internally by get_symbol_stats())
 static void collect_symbols(const ex &e, sym_desc_vec &v)
 {
+	if (!ex_to<basic>(e).symbol_mask())
+		return;  // no symbols in here
 	if (is_a<symbol>(e)) {
 		add_symbol(e, v);
 	} else if (is_exactly_a<add>(e) || is_exactly_a<mul>(e)) {
@@ -578,6 +593,149 @@ ex sprem(const ex &a, const ex &b, const ex &x, bool check_args)
 }
 
 
+/** Minimal number of terms of the dividend for which divide_packed()
+ *  looks for a cheap proof of non-divisibility before dividing. */
+static const size_t divide_check_min_terms = 8;
+
+/** Number of random points tried by proves_not_divisible(). */
+static const unsigned divide_check_points = 2;
+
+/** Image of a in Z_p[x], x being the variable var of pk and the other
+ *  variables being replaced by vals. */
+static zp_upoly z_mpoly_image(const z_mpoly &a, size_t var, const std::vector<long> &vals,
+                              const monomial_packing &pk, long p)
+{
+	zp_upoly r;
+	for (size_t k=0; k<a.size(); ++k) {
+		long c = to_mod(a[k].coeff, p);
+		for (size_t i=0; i<vals.size() && c!=0; ++i) {
+			if (i == var)
+				continue;
+			long base = vals[i];
+			for (unsigned e=pk.exponent(a[k].mon, i); e!=0; e>>=1) {
+				if (e & 1)
+					c = mul_mod(c, base, p);
+				base = mul_mod(base, base, p);
+			}
+		}
+		const unsigned d = pk.exponent(a[k].mon, var);
+		if (r.size() <= d)
+			r.resize(d + 1, 0);
+		r[d] = add_mod(r[d], c, p);
+	}
+	while (!r.empty() && r.back() == 0)
+		r.pop_back();
+	return r;
+}
+
+/** Cheap necessary conditions for the primitive polynomial B to divide the
+ *  primitive polynomial A in Z[X]: the leading and trailing terms of B must
+ *  divide those of A, and the image of B in Z_p[x] must divide the one of A
+ *  when the other variables are replaced by random values (provided that
+ *  the degree in x is preserved).
+ *
+ *  @param x  variable kept in the modular images
+ *  @param bdeg  degrees of B in the variables of pk
+ *  @return "true" if B certainly doesn't divide A, "false" if the division
+ *          has to decide */
+static bool proves_not_divisible(const z_mpoly &A, const z_mpoly &B, const ex &x,
+                                 const std::vector<unsigned> &bdeg, const monomial_packing &pk)
+{
+	// Leading and trailing terms
+	if (!pk.divides(B.front().mon, A.front().mon) ||
+	    !pk.divides(B.back().mon, A.back().mon) ||
+	    !cln::zerop(cln::rem(A.front().coeff, B.front().coeff)) ||
+	    !cln::zerop(cln::rem(A.back().coeff, B.back().coeff)))
+		return true;
+
+	// Images in Z_p[x]
+	size_t xi = 0;
+	while (xi < pk.nvars() && !pk.var(xi).is_equal(x))
+		++xi;
+	if (xi == pk.nvars())
+		return false;
+	long p;
+	primes_factory next_prime;
+	if (!next_prime(p, cln::cl_I(1)) || p >= max_sparse_modulus)
+		return false;
+	uint64_t state = 0x2545f4914f6cdd1dULL;
+	std::vector<long> point(pk.nvars());
+	for (unsigned attempt=0; attempt<divide_check_points; ++attempt) {
+		for (size_t i=0; i<point.size(); ++i) {
+			// xorshift generator
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			point[i] = long(state % uint64_t(p));
+		}
+		const zp_upoly bp = z_mpoly_image(B, xi, point, pk, p);
+		if (bp.size() != bdeg[xi] + 1)
+			continue;  // the leading coefficient in x vanished
+		zp_upoly q, r;
+		zp_upoly_divide(z_mpoly_image(A, xi, point, pk, p), bp, q, r, p);
+		return !r.empty();
+	}
+	return false;
+}
+
+/** Outcome of divide_packed(). */
+enum packed_division_result {
+	packed_not_divisible,
+	packed_divisible,
+	packed_unsupported
+};
+
+/** Exact division of the expanded polynomial a by the expanded polynomial b
+ *  in Q[X] (in Z[X] if in_z is true) on the sparse representation, by the
+ *  heap algorithm of z_mpoly_divide(). Unlike the recursive long division,
+ *  this doesn't build intermediate remainders. Before dividing, the degrees
+ *  are compared and, for larger dividends, proves_not_divisible() is tried.
+ *
+ *  @param x  main variable
+ *  @param q  quotient (returned if b divides a)
+ *  @return packed_unsupported if a or b are not polynomials in symbols with
+ *          rational coefficients, or if their exponents are too large */
+static packed_division_result divide_packed(const ex &a, const ex &b, const ex &x, bool in_z, ex &q)
+{
+	exvector vars;
+	std::vector<unsigned> adeg, bdeg;
+	if (!packed_mpoly_collect_vars(a, vars, adeg) ||
+	    !packed_mpoly_collect_vars(b, vars, bdeg))
+		return packed_unsupported;
+	adeg.resize(vars.size(), 0);
+	for (size_t i=0; i<vars.size(); ++i)
+		if (bdeg[i] > adeg[i])
+			return packed_not_divisible;
+
+	monomial_packing pk;
+	if (!pk.init(vars, adeg))
+		return packed_unsupported;
+
+	// With a = ca*A and b = cb*B, A and B primitive, b divides a in Q[X]
+	// iff B divides A in Z[X] (Gauss' lemma), and in Z[X] iff moreover cb
+	// divides ca.
+	z_mpoly A, B, Q;
+	const cln::cl_RA ca = packed_mpoly_to_z_mpoly(ex_to_packed_mpoly(a, pk), A);
+	const cln::cl_RA cb = packed_mpoly_to_z_mpoly(ex_to_packed_mpoly(b, pk), B);
+	if (A.empty() || B.empty())
+		return packed_unsupported;
+	const cln::cl_RA c = ca / cb;
+	if (in_z && !cln::integerp(c))
+		return packed_not_divisible;
+	if (A.size() >= divide_check_min_terms && proves_not_divisible(A, B, x, bdeg, pk))
+		return packed_not_divisible;
+	if (!z_mpoly_divide(A, B, Q, pk))
+		return packed_not_divisible;
+
+	packed_mpoly pq;
+	pq.reserve(Q.size());
+	for (size_t i=0; i<Q.size(); ++i)
+		pq.push_back(packed_term(Q[i].mon, Q[i].coeff * c));
+	q = packed_mpoly_to_ex(pq, pk);
+	return packed_divisible;
+}
+
+
 /** Exact polynomial division of a(X) by b(X) in Q[X].
  *  
  *  @param a  first multivariate polynomial (dividend)
@@ -688,9 +846,13 @@ bool divide(const ex &a, const ex &b, ex &q, bool check_args)
 		q = _ex0;
 		return true;
 	}
-	int bdeg = b.degree(x);
+	ex eb = b.expand();
+	const packed_division_result pd = divide_packed(r, eb, x, false, q);
+	if (pd != packed_unsupported)
+		return pd == packed_divisible;
+	int bdeg = eb.degree(x);
 	int rdeg = r.degree(x);
-	ex blcoeff = b.expand().coeff(x, bdeg);
+	ex blcoeff = eb.coeff(x, bdeg);
 	bool blcoeff_is_numeric = is_exactly_a<numeric>(blcoeff);
 	exvector v; v.reserve(std::max(rdeg - bdeg + 1, 0));
 	while (rdeg >= bdeg) {
@@ -877,6 +1039,13 @@ static bool divide_in_z(const ex &a, const ex &b, ex &q, sym_desc_vec::const_ite
 		return true;
 	int rdeg = adeg;
 	ex eb = b.expand();
+	const packed_division_result pd = divide_packed(r, eb, x, true, q);
+	if (pd != packed_unsupported) {
+#if USE_REMEMBER
+		dr_remember[ex2(a, b)] = exbool(q, pd == packed_divisible);
+#endif
+		return pd == packed_divisible;
+	}
 	ex blcoeff = eb.coeff(x, bdeg);
 	exvector v; v.reserve(std::max(rdeg - bdeg + 1, 0));
 	while (rdeg >= bdeg) {
@@ -960,8 +1129,9 @@ ex ex::content(const ex &x) const
 	if (deg == ldeg)
 		return lcoeff * c / lcoeff.unit(x);
 	ex cont = _ex0;
-	for (int i=ldeg; i<=deg; i++)
-		cont = gcd(r.coeff(x, i), cont, NULL, NULL, false);
+	const std::map<int, ex> rc = r.coeffs(x);
+	for (std::map<int, ex>::const_iterator i=rc.begin(); i!=rc.end(); ++i)
+		cont = gcd(i->second, cont, NULL, NULL, false);
 	return cont * c;
 }
 
@@ -1213,20 +1383,24 @@ ex numeric::smod(const numeric &xi) const
 
 ex add::smod(const numeric &xi) const
 {
-	epvector newseq;
-	newseq.reserve(seq.size()+1);
+	std::shared_ptr<epvector> newseq = std::make_shared<epvector>();
+	newseq->reserve(seq.size());
 	epvector::const_iterator it = seq.begin();
 	epvector::const_iterator itend = seq.end();
 	while (it != itend) {
 		GINAC_ASSERT(!is_exactly_a<numeric>(it->rest));
 		numeric coeff = GiNaC::smod(ex_to<numeric>(it->coeff), xi);
 		if (!coeff.is_zero())
-			newseq.push_back(expair(it->rest, coeff));
+			newseq->push_back(expair(it->rest, coeff));
 		it++;
 	}
 	GINAC_ASSERT(is_exactly_a<numeric>(overall_coeff));
 	numeric coeff = GiNaC::smod(ex_to<numeric>(overall_coeff), xi);
-	return (new add(newseq,coeff))->setflag(status_flags::dynallocated);
+
+	// Only coefficients have changed, so the terms are still in canonical
+	// order, and with two or more of them there is nothing left to evaluate
+	unsigned evaluated = (newseq->size() > 1) ? (flags & status_flags::evaluated) : 0;
+	return (new add(newseq, coeff, canonical_seq))->setflag(status_flags::dynallocated | evaluated);
 }
 
 ex mul::smod(const numeric &xi) const
@@ -1265,6 +1439,61 @@ static ex interpolate(const ex &gamma, const numeric &xi, const ex &x, int degre
 /** Exception thrown by heur_gcd() to signal failure. */
 class gcdheu_failed {};
 
+/** heur_gcd() gives up when the bit length of an evaluation point times
+ *  the degree exceeds this. */
+static const int heur_gcd_bit_limit = 100000;
+
+/** Add the term t (a product of an integer and a power of x) of a
+ *  polynomial in Z[x] to u. Returns false if t isn't of this form. */
+static bool add_upoly_term(upoly& u, const ex& t, const ex& x)
+{
+	cln::cl_I c = 1;
+	std::size_t n = 0;
+	const std::size_t nfactors = is_exactly_a<mul>(t) ? t.nops() : 1;
+	for (std::size_t i = 0; i < nfactors; ++i) {
+		const ex& f = is_exactly_a<mul>(t) ? t.op(i) : t;
+		if (is_exactly_a<numeric>(f)) {
+			if (!ex_to<numeric>(f).is_integer())
+				return false;
+			c = c * cln::the<cln::cl_I>(ex_to<numeric>(f).to_cl_N());
+		} else if (f.is_equal(x)) {
+			n += 1;
+		} else if (is_exactly_a<power>(f) && f.op(0).is_equal(x) &&
+		           f.op(1).info(info_flags::posint)) {
+			n += ex_to<numeric>(f.op(1)).to_int();
+		} else
+			return false;
+	}
+	if (u.size() <= n)
+		u.resize(n + 1);
+	u[n] = u[n] + c;
+	return true;
+}
+
+/** Convert the expanded polynomial e to u if it is in Z[x]. */
+static bool upoly_from_z_poly(upoly& u, const ex& e, const ex& x)
+{
+	u.clear();
+	if (is_exactly_a<add>(e)) {
+		for (std::size_t i = 0; i < e.nops(); ++i)
+			if (!add_upoly_term(u, e.op(i), x))
+				return false;
+	} else if (!add_upoly_term(u, e, x))
+		return false;
+	canonicalize(u);
+	return !u.empty();
+}
+
+static ex upoly_to_ex(const upoly& a, const ex& x)
+{
+	exvector terms;
+	terms.reserve(a.size());
+	for (std::size_t i = 0; i < a.size(); ++i)
+		if (!cln::zerop(a[i]))
+			terms.push_back(numeric(a[i]) * pow(x, i));
+	return (new add(terms))->setflag(status_flags::dynallocated);
+}
+
 /** Compute GCD of multivariate polynomials using the heuristic GCD algorithm.
  *  get_symbol_stats() must have been called previously with the input
  *  polynomials and an iterator to the first element of the sym_desc vector
@@ -1312,6 +1541,21 @@ static bool heur_gcd_z(ex& res, const ex &a, const ex &b, ex *ca, ex *cb,
 	ex p = a * rgc;
 	ex q = b * rgc;
 	int maxdeg =  std::max(p.degree(x), q.degree(x));
+
+	// Univariate polynomials are evaluated and interpolated directly on
+	// the integers
+	upoly up, uq;
+	if (upoly_from_z_poly(up, p, x) && upoly_from_z_poly(uq, q, x)) {
+		upoly ug, ucp, ucq;
+		if (!heur_gcd_z_kronecker(ug, ucp, ucq, up, uq, heur_gcd_bit_limit))
+			throw gcdheu_failed();
+		res = upoly_to_ex(ug, x) * gc;
+		if (ca)
+			*ca = upoly_to_ex(ucp, x);
+		if (cb)
+			*cb = upoly_to_ex(ucq, x);
+		return true;
+	}
 	
 	// Find evaluation point
 	numeric mp = p.max_coefficient();
@@ -1324,7 +1568,7 @@ static bool heur_gcd_z(ex& res, const ex &a, const ex &b, ex *ca, ex *cb,
 
 	// 6 tries maximum
 	for (int t=0; t<6; t++) {
-		if (xi.int_length() * maxdeg > 100000) {
+		if (xi.int_length() * maxdeg > heur_gcd_bit_limit) {
 			throw gcdheu_failed();
 		}
 
@@ -1416,6 +1660,26 @@ static bool heur_gcd(ex& res, const ex& a, const ex& b, ex *ca, ex *cb,
 	return found;
 }
 
+/** Guess whether heur_gcd() would give up because its evaluation points
+ *  grow too large. The first evaluation point is about as long as the
+ *  coefficients, and every substitution makes the coefficients longer by
+ *  the degree times the length of the point. The last symbol is left to
+ *  the univariate algorithm, which has a limit of its own.
+ *
+ *  @param a  first polynomial (expanded)
+ *  @param b  second polynomial (expanded)
+ *  @param stats  the symbols in the order heur_gcd() substitutes them */
+static bool heur_gcd_hopeless(const ex& a, const ex& b, const sym_desc_vec& stats)
+{
+	double bits = std::min(ex_to<basic>(a).metrics().bits,
+	                       ex_to<basic>(b).metrics().bits) + 1;
+	for (std::size_t i = 0; i + 1 < stats.size(); ++i) {
+		if (bits * stats[i].max_deg > heur_gcd_bit_limit)
+			return true;
+		bits += bits * std::min(stats[i].deg_a, stats[i].deg_b) + 1;
+	}
+	return false;
+}
 
 // gcd helper to handle partially factored polynomials (to avoid expanding
 // large expressions). At least one of the arguments should be a power.
@@ -1425,6 +1689,97 @@ static ex gcd_pf_pow(const ex& a, const ex& b, ex* ca, ex* cb);
 // large expressions). At least one of the arguments should be a product.
 static ex gcd_pf_mul(const ex& a, const ex& b, ex* ca, ex* cb);
 
+// gcd() without the cache
+static ex gcd_compute(const ex &a, const ex &b, ex *ca, ex *cb, unsigned options);
+
+namespace {
+
+/** Cache of gcd() results. Each pair of arguments has one slot (chosen by
+ *  their hash values), a new result replaces the one stored there. */
+struct gcd_cache_entry {
+	gcd_cache_entry() : options(0), used(false), has_cofactors(false) {}
+	ex a, b, g, ca, cb;
+	unsigned options;
+	bool used;
+	bool has_cofactors;
+};
+
+struct gcd_cache_t {
+	gcd_cache_t() : lookups(0), hits(0), entries(0) {}
+	std::vector<gcd_cache_entry> slots;
+	unsigned long lookups, hits;
+	size_t entries;
+};
+
+size_t gcd_cache_size = 0;
+
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+thread_local gcd_cache_t gcd_cache;
+#else
+gcd_cache_t gcd_cache;
+#endif
+
+}
+
+void set_gcd_cache_size(size_t size)
+{
+	gcd_cache_size = size;
+	gcd_cache = gcd_cache_t();
+}
+
+gcd_cache_statistics get_gcd_cache_statistics()
+{
+	gcd_cache_statistics st;
+	st.lookups = gcd_cache.lookups;
+	st.hits = gcd_cache.hits;
+	st.entries = gcd_cache.entries;
+	return st;
+}
+
+static ex gcd_cached(const ex &a, const ex &b, ex *ca, ex *cb, unsigned options)
+{
+	gcd_cache_t & cache = gcd_cache;
+	if (cache.slots.size() != gcd_cache_size) {
+		// size changed by another thread
+		cache = gcd_cache_t();
+		cache.slots.resize(gcd_cache_size);
+	}
+	const hash_t h = hash_combine(hash_combine(a.gethash(), b.gethash()), options);
+	gcd_cache_entry & e = cache.slots[h % cache.slots.size()];
+	const bool want_cofactors = ca || cb;
+
+	++cache.lookups;
+	if (e.used && (e.has_cofactors || !want_cofactors) &&
+	    e.options == options && e.a.is_equal(a) && e.b.is_equal(b)) {
+		++cache.hits;
+		if (ca)
+			*ca = e.ca;
+		if (cb)
+			*cb = e.cb;
+		return e.g;
+	}
+
+	// The recursion may call us again and change the slot, so the
+	// result is stored afterwards
+	ex g, ca_, cb_;
+	g = gcd_compute(a, b, want_cofactors ? &ca_ : NULL, want_cofactors ? &cb_ : NULL, options);
+	if (!e.used)
+		++cache.entries;
+	e.used = true;
+	e.a = a;
+	e.b = b;
+	e.g = g;
+	e.ca = ca_;
+	e.cb = cb_;
+	e.options = options;
+	e.has_cofactors = want_cofactors;
+	if (ca)
+		*ca = ca_;
+	if (cb)
+		*cb = cb_;
+	return g;
+}
+
 /** Compute GCD (Greatest Common Divisor) of multivariate polynomials a(X)
  *  and b(X) in Z[X]. Optionally also compute the cofactors of a and b,
  *  defined by a = ca * gcd(a, b) and b = cb * gcd(a, b).
@@ -1438,6 +1793,7 @@ static ex gcd_pf_mul(const ex& a, const ex& b, ex* ca, ex* cb);
  *  @return the GCD as a new expression */
 ex gcd(const ex &a, const ex &b, ex *ca, ex *cb, bool check_args, unsigned options)
 {
+	trace_scope timer("gcd");
 #if STATISTICS
 	gcd_called++;
 #endif
@@ -1466,6 +1822,13 @@ ex gcd(const ex &a, const ex &b, ex *ca, ex *cb, bool check_args, unsigned optio
 		throw(std::invalid_argument("gcd: arguments must be polynomials over the rationals"));
 	}
 
+	if (gcd_cache_size != 0)
+		return gcd_cached(a, b, ca, cb, options);
+	return gcd_compute(a, b, ca, cb, options);
+}
+
+static ex gcd_compute(const ex &a, const ex &b, ex *ca, ex *cb, unsigned options)
+{
 	// Partially factored cases (to avoid expanding large expressions)
 	if (!(options & gcd_options::no_part_factored)) {
 		if (is_exactly_a<mul>(a) || is_exactly_a<mul>(b))
@@ -1603,9 +1966,12 @@ ex gcd(const ex &a, const ex &b, ex *ca, ex *cb, bool check_args, unsigned optio
 		return g;
 	}
 
-	// Try heuristic algorithm first, fall back to PRS if that failed
+	// Try heuristic algorithm first, fall back to PRS if that failed (or
+	// would fail after much work, as it does for large coefficients and
+	// many symbols)
 	ex g;
-	if (!(options & gcd_options::no_heur_gcd)) {
+	if (!(options & gcd_options::no_heur_gcd) &&
+	    !heur_gcd_hopeless(aex, bex, sym_stats)) {
 		bool found = heur_gcd(g, aex, bex, ca, cb, var);
 		if (found) {
 			// heur_gcd have already computed cofactors...
@@ -1630,7 +1996,7 @@ ex gcd(const ex &a, const ex &b, ex *ca, ex *cb, bool check_args, unsigned optio
 		exvector vars;
 		for (std::size_t n = sym_stats.size(); n-- != 0; )
 			vars.push_back(sym_stats[n].sym);
-		g = chinrem_gcd(aex, bex, vars);
+		g = chinrem_gcd(aex, bex, vars, options);
 	}
 
 	if (g.is_equal(_ex1)) {
@@ -1787,7 +2153,9 @@ ex lcm(const ex &a, const ex &b, bool check_args)
  */
 
 /** Compute square-free factorization of multivariate polynomial a(x) using
- *  Yun's algorithm.  Used internally by sqrfree().
+ *  Yun's algorithm.  Used internally by sqrfree().  Polynomials in symbols
+ *  are handled by the modular algorithm (see sqrfree_yun_modular()), which
+ *  avoids the repeated GCDs and divisions of expressions.
  *
  *  @param a  multivariate polynomial over Z[X], treated here as univariate
  *            polynomial in x.
@@ -1796,6 +2164,13 @@ ex lcm(const ex &a, const ex &b, bool check_args)
 static exvector sqrfree_yun(const ex &a, const symbol &x)
 {
 	exvector res;
+	if (sqrfree_yun_modular(a, x, res)) {
+		for (exvector::iterator i = res.begin(); i != res.end(); ++i)
+			if (i->unit(x).is_equal(_ex_1))
+				*i = -*i;
+		return res;
+	}
+
 	ex w = a;
 	ex z = w.diff(x);
 	ex g = gcd(w, z);
@@ -1815,6 +2190,20 @@ static exvector sqrfree_yun(const ex &a, const symbol &x)
 }
 
 
+/** Replaces the factors of a square-free factorization with respect to one
+ *  variable by their factorizations in the remaining variables.
+ *  @see sqrfree */
+struct sqrfree_factors_task : public parallel_task {
+	sqrfree_factors_task(exvector &f, const lst &a) : factors(f), args(a) {}
+	void operator()(size_t i)
+	{
+		factors[i] = sqrfree(factors[i], args);
+	}
+	exvector &factors;
+	const lst &args;
+};
+
+
 /** Compute a square-free factorization of a multivariate polynomial in Q[X].
  *
  *  @param a  multivariate polynomial over Q[X]
@@ -1888,12 +2277,23 @@ ex sqrfree(const ex &a, const lst &l)
 	lst newargs = args;
 	newargs.remove_first();
 
-	// recurse down the factors in remaining variables
+	// recurse down the factors in remaining variables; the factors are
+	// independent of each other, so this is done in parallel if possible
 	if (newargs.nops()>0) {
-		exvector::iterator i = factors.begin();
-		while (i != factors.end()) {
-			*i = sqrfree(*i, newargs);
-			++i;
+		bool parallel = factors.size() > 1 && parallel_threads(factors.size()) > 1;
+		for (exvector::iterator i = factors.begin(); parallel && i != factors.end(); ++i)
+			parallel = numerics_are_immediate(*i);
+		if (parallel) {
+			prepare_for_threads(factors);
+			prepare_for_threads(newargs);
+			sqrfree_factors_task task(factors, newargs);
+			parallel_for(factors.size(), task);
+		} else {
+			exvector::iterator i = factors.begin();
+			while (i != factors.end()) {
+				*i = sqrfree(*i, newargs);
+				++i;
+			}
 		}
 	}
 
@@ -1964,11 +2364,14 @@ ex sqrfree_parfrac(const ex & a, const symbol & x)
 	int max_denom_deg = denom.degree(x);
 	matrix sys(max_denom_deg + 1, num_factors);
 	matrix rhs(max_denom_deg + 1, 1);
-	for (int i=0; i<=max_denom_deg; i++) {
-		for (size_t j=0; j<num_factors; j++)
-			sys(i, j) = cofac[j].coeff(x, i);
-		rhs(i, 0) = red_numer.coeff(x, i);
-	}
+	for (size_t j=0; j<num_factors; j++) {
+		const exvector c = cofac[j].coeff_vector(x);
+		for (size_t i=0; i<c.size() && i<=size_t(max_denom_deg); i++)
+			sys(i, j) = c[i];
+	}
+	const exvector rc = red_numer.coeff_vector(x);
+	for (size_t i=0; i<rc.size() && i<=size_t(max_denom_deg); i++)
+		rhs(i, 0) = rc[i];
 //clog << "coeffs: " << sys << endl;
 //clog << "rhs   : " << rhs << endl;
 
@@ -2021,13 +2424,56 @@ static ex replace_with_symbol(const ex & e, exmap & repl, exmap & rev_lookup)
 	return es;
 }
 
+/** The reverse map of the temporary symbols of a normal_context, while
+ *  its to_rational() or to_polynomial() runs in the calling thread. */
+struct rational_lookup_t {
+	const exmap * repl;
+	exmap * rev_lookup;
+};
+
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+thread_local rational_lookup_t * rational_lookup = 0;
+#else
+rational_lookup_t * rational_lookup = 0;
+#endif
+
+/** Makes the reverse map of a normal_context known to replace_with_symbol()
+ *  for the lifetime of the object. */
+struct rational_lookup_scope {
+	rational_lookup_scope(const exmap & repl, exmap & rev_lookup) : saved(rational_lookup)
+	{
+		lookup.repl = &repl;
+		lookup.rev_lookup = &rev_lookup;
+		rational_lookup = &lookup;
+	}
+	~rational_lookup_scope() { rational_lookup = saved; }
+	rational_lookup_t lookup;
+	rational_lookup_t * saved;
+};
+
 /** Create a symbol for replacing the expression "e" (or return a previously
  *  assigned symbol). The symbol and expression are appended to repl, and the
- *  symbol is returned.
+ *  symbol is returned. Without a reverse map (from a normal_context), repl
+ *  is searched linearly.
  *  @see basic::to_rational
  *  @see basic::to_polynomial */
 static ex replace_with_symbol(const ex & e, exmap & repl)
 {
+	if (rational_lookup && rational_lookup->repl == &repl) {
+		exmap & rev_lookup = *rational_lookup->rev_lookup;
+		exmap::const_iterator it = rev_lookup.find(e);
+		if (it != rev_lookup.end())
+			return it->second;
+		ex e_replaced = e.subs(repl, subs_options::no_pattern);
+		it = rev_lookup.find(e_replaced);
+		if (it != rev_lookup.end())
+			return it->second;
+		ex es = (new symbol)->setflag(status_flags::dynallocated);
+		repl.insert(std::make_pair(es, e_replaced));
+		rev_lookup.insert(std::make_pair(e_replaced, es));
+		return es;
+	}
+
 	// Expression already replaced? Then return the assigned symbol
 	for (exmap::const_iterator it = repl.begin(); it != repl.end(); ++it)
 		if (it->second.is_equal(e))
@@ -2163,6 +2609,108 @@ static ex frac_cancel(const ex &n, const ex &d)
 }
 
 
+/** Addition of the fractions n1/d1 and n2/d2 to n/d, taking advantage of
+ *  the fact that the heuristic GCD algorithm computes the cofactors at no
+ *  extra cost.  The result is not cancelled. */
+static void add_fractions(const ex &n1, const ex &d1, const ex &n2, const ex &d2, ex &n, ex &d)
+{
+	ex co_den1, co_den2;
+	ex g = gcd(d1, d2, &co_den1, &co_den2, false);
+	n = ((n1 * co_den2) + (n2 * co_den1)).expand();
+	d = d1 * co_den2;	// this is the lcm(d1, d2)
+}
+
+/** Number of fractions with different denominators from which on
+ *  add::normal() adds them pairwise in a balanced tree. */
+static const size_t fraction_tree_threshold = 8;
+
+/** Minimal number of pairs of fractions which are added in parallel. */
+static const size_t parallel_fraction_pairs = 4;
+
+/** Adds the fractions 2i and 2i+1 of one level of the tree. */
+struct fraction_pair_task : public parallel_task {
+	fraction_pair_task(const exvector &n, const exvector &d, exvector &rn, exvector &rd)
+	 : nums(n), dens(d), res_nums(rn), res_dens(rd) {}
+	void operator()(size_t i)
+	{
+		add_fractions(nums[2*i], dens[2*i], nums[2*i+1], dens[2*i+1], res_nums[i], res_dens[i]);
+	}
+	const exvector &nums, &dens;
+	exvector &res_nums, &res_dens;
+};
+
+/** Replaces the fractions nums[i]/dens[i] by the sums of neighbouring
+ *  pairs, which halves their number.  The pairs are independent of each
+ *  other, so they are added in parallel if there are enough of them and
+ *  the expressions may be shared by several threads. */
+static void add_fractions_pairwise(exvector &nums, exvector &dens)
+{
+	const size_t pairs = nums.size() / 2;
+	exvector res_nums(pairs), res_dens(pairs);
+	fraction_pair_task task(nums, dens, res_nums, res_dens);
+
+	bool parallel = pairs >= parallel_fraction_pairs && parallel_threads(pairs) > 1;
+	for (size_t i=0; parallel && i<2*pairs; ++i) {
+		parallel = numerics_are_immediate(nums[i]) && numerics_are_immediate(dens[i]);
+		prepare_for_threads(nums[i]);
+		prepare_for_threads(dens[i]);
+	}
+	if (parallel)
+		parallel_for(pairs, task);
+	else
+		for (size_t i=0; i<pairs; ++i)
+			task(i);
+
+	if (nums.size() % 2) {
+		res_nums.push_back(nums.back());
+		res_dens.push_back(dens.back());
+	}
+	nums.swap(res_nums);
+	dens.swap(res_dens);
+}
+
+/** Sum of the fractions nums[i]/dens[i], which are the normalized terms of
+ *  a sum, as a list {numerator, denominator}.
+ *  @see add::normal */
+static ex add_normal_fractions(const exvector &nums, const exvector &dens)
+{
+//std::clog << "add::normal uses " << nums.size() << " summands:\n";
+
+	// Trivially add all fractions with identical denominators, keeping
+	// the order in which the denominators first appear
+	exvector group_nums, group_dens;
+	exhashmap<size_t> group_of;
+	for (size_t i=0; i<nums.size(); ++i) {
+		std::pair<exhashmap<size_t>::iterator, bool> g =
+			group_of.insert(std::make_pair(dens[i], group_nums.size()));
+		if (g.second) {
+			group_nums.push_back(nums[i]);
+			group_dens.push_back(dens[i]);
+		} else
+			group_nums[g.first->second] += nums[i];
+	}
+
+	// Add the fractions sequentially if there are only a few of them,
+	// otherwise pairwise in a balanced tree, so that the common
+	// denominators and the expanded numerators grow evenly
+	ex num, den;
+	if (group_nums.size() < fraction_tree_threshold) {
+		num = group_nums[0];
+		den = group_dens[0];
+		for (size_t i=1; i<group_nums.size(); ++i)
+			add_fractions(num, den, group_nums[i], group_dens[i], num, den);
+	} else {
+		while (group_nums.size() > 1)
+			add_fractions_pairwise(group_nums, group_dens);
+		num = group_nums[0];
+		den = group_dens[0];
+	}
+//std::clog << " common denominator = " << den << std::endl;
+
+	// Cancel common factors from num/den
+	return frac_cancel(num, den);
+}
+
 /** Implementation of ex::normal() for a sum. It expands terms and performs
  *  fractional addition.
  *  @see ex::normal */
@@ -2189,36 +2737,7 @@ ex add::normal(exmap & repl, exmap & rev_lookup, int level) const
 	dens.push_back(n.op(1));
 	GINAC_ASSERT(nums.size() == dens.size());
 
-	// Now, nums is a vector of all numerators and dens is a vector of
-	// all denominators
-//std::clog << "add::normal uses " << nums.size() << " summands:\n";
-
-	// Add fractions sequentially
-	exvector::const_iterator num_it = nums.begin(), num_itend = nums.end();
-	exvector::const_iterator den_it = dens.begin(), den_itend = dens.end();
-//std::clog << " num = " << *num_it << ", den = " << *den_it << std::endl;
-	ex num = *num_it++, den = *den_it++;
-	while (num_it != num_itend) {
-//std::clog << " num = " << *num_it << ", den = " << *den_it << std::endl;
-		ex next_num = *num_it++, next_den = *den_it++;
-
-		// Trivially add sequences of fractions with identical denominators
-		while ((den_it != den_itend) && next_den.is_equal(*den_it)) {
-			next_num += *num_it;
-			num_it++; den_it++;
-		}
-
-		// Additiion of two fractions, taking advantage of the fact that
-		// the heuristic GCD algorithm computes the cofactors at no extra cost
-		ex co_den1, co_den2;
-		ex g = gcd(den, next_den, &co_den1, &co_den2, false);
-		num = ((num * co_den2) + (next_num * co_den1)).expand();
-		den *= co_den2;		// this is the lcm(den, next_den)
-	}
-//std::clog << " common denominator = " << den << std::endl;
-
-	// Cancel common factors from num/den
-	return frac_cancel(num, den);
+	return add_normal_fractions(nums, dens);
 }
 
 
@@ -2341,6 +2860,8 @@ ex pseries::normal(exmap & repl, exmap & rev_lookup, int level) const
  *  @return normalized expression */
 ex ex::normal(int level) const
 {
+	trace_scope timer("normal");
+	numeric_alloc_scope scope;
 	exmap repl, rev_lookup;
 
 	ex e = bp->normal(repl, rev_lookup, level);
@@ -2414,6 +2935,561 @@ ex ex::numer_denom() const
 		return e.subs(repl, subs_options::no_pattern);
 }
 
+ex normal_context::normal(const ex & e, int level)
+{
+	trace_scope timer("normal");
+	numeric_alloc_scope scope;
+
+	ex r = ex_to<basic>(e).normal(repl, rev_lookup, level);
+	GINAC_ASSERT(is_a<lst>(r));
+	r = restore(r);
+	return r.op(0) / r.op(1);
+}
+
+ex normal_context::numer_denom(const ex & e)
+{
+	return restore(ex_to<basic>(e).normal(repl, rev_lookup, 0));
+}
+
+ex normal_context::to_rational(const ex & e)
+{
+	rational_lookup_scope scope(repl, rev_lookup);
+	return e.to_rational(repl);
+}
+
+ex normal_context::to_polynomial(const ex & e)
+{
+	rational_lookup_scope scope(repl, rev_lookup);
+	return e.to_polynomial(repl);
+}
+
+ex normal_context::restore(const ex & e) const
+{
+	if (repl.empty())
+		return e;
+	return e.subs(repl, subs_options::no_pattern);
+}
+
+void normal_context::clear()
+{
+	repl.clear();
+	rev_lookup.clear();
+}
+
+/** Normalizes the components of an expression, each one with its own
+ *  maps of temporary symbols.
+ *  @see normal_parallel */
+struct normal_component_task : public parallel_task {
+	normal_component_task(const exvector &c, int l, exvector &r, std::vector<exmap> &rp)
+	 : components(c), level(l), results(r), repls(rp) {}
+	void operator()(size_t i)
+	{
+		exmap rev_lookup;
+		results[i] = ex_to<basic>(components[i]).normal(repls[i], rev_lookup, level);
+	}
+	const exvector &components;
+	const int level;
+	exvector &results;
+	std::vector<exmap> &repls;
+};
+
+/** Normalization of the elements of a list or matrix, or of the terms of a
+ *  sum, in parallel. The components are normalized by several threads, each
+ *  one replacing non-rational subexpressions by its own temporary symbols.
+ *  For a sum, these symbols are then unified so that equal subexpressions
+ *  of different terms get the same symbol, and the fractions are added as
+ *  in ex::normal(). Other expressions, and expressions whose numbers may not
+ *  be shared by several threads (@see numerics_are_immediate), are
+ *  normalized by ex::normal().
+ *
+ *  @param level maximum depth of recursion
+ *  @return normalized expression */
+ex normal_parallel(const ex & e, int level)
+{
+	const bool is_sum = is_exactly_a<add>(e);
+	if (level == 1 || level == -max_recursion_level ||
+	    !(is_sum || is_a<lst>(e) || is_a<exprseq>(e) || is_a<matrix>(e)) ||
+	    parallel_threads(e.nops()) <= 1 || !numerics_are_immediate(e))
+		return e.normal(level);
+
+	const size_t n = e.nops();
+	exvector components;
+	components.reserve(n);
+	for (size_t i=0; i<n; ++i) {
+		components.push_back(e.op(i));
+		prepare_for_threads(components.back());
+	}
+	exvector results(n);
+	std::vector<exmap> repls(n);
+	normal_component_task task(components, level - 1, results, repls);
+	parallel_for(n, task);
+
+	if (!is_sum) {
+		// The components are independent, re-insert their symbols one
+		// by one
+		for (size_t i=0; i<n; ++i) {
+			if (!repls[i].empty())
+				results[i] = results[i].subs(repls[i], subs_options::no_pattern);
+			results[i] = results[i].op(0) / results[i].op(1);
+		}
+		if (is_a<matrix>(e))
+			return (new matrix(ex_to<matrix>(e).rows(), ex_to<matrix>(e).cols(), results))->setflag(status_flags::dynallocated);
+		if (is_a<exprseq>(e))
+			return (new exprseq(results))->setflag(status_flags::dynallocated);
+		lst l;
+		for (size_t i=0; i<n; ++i)
+			l.append(results[i]);
+		return l;
+	}
+
+	// Merge the temporary symbols of the terms: a symbol standing for a
+	// subexpression which was already replaced in an earlier term is
+	// renamed to the symbol of that term
+	exmap repl, rev_lookup;
+	exvector nums, dens;
+	nums.reserve(n);
+	dens.reserve(n);
+	for (size_t i=0; i<n; ++i) {
+		exmap rename;
+		for (exmap::const_iterator it = repls[i].begin(); it != repls[i].end(); ++it) {
+			exmap::const_iterator known = rev_lookup.find(it->second);
+			if (known != rev_lookup.end())
+				rename.insert(std::make_pair(it->first, known->second));
+			else {
+				repl.insert(*it);
+				rev_lookup.insert(std::make_pair(it->second, it->first));
+			}
+		}
+		if (!rename.empty())
+			results[i] = results[i].subs(rename, subs_options::no_pattern);
+		nums.push_back(results[i].op(0));
+		dens.push_back(results[i].op(1));
+	}
+
+	ex r = add_normal_fractions(nums, dens);
+	if (!repl.empty())
+		r = r.subs(repl, subs_options::no_pattern);
+	return r.op(0) / r.op(1);
+}
+
+/** Collect the symbols occurring in e, visiting shared subexpressions once. */
+static void collect_symbols(const ex & e, exset & syms, std::set<const basic *> & visited)
+{
+	if (is_a<symbol>(e)) {
+		syms.insert(e);
+		return;
+	}
+	if (e.nops() == 0 || !visited.insert(&ex_to<basic>(e)).second)
+		return;
+	for (size_t i=0; i<e.nops(); ++i)
+		collect_symbols(e.op(i), syms, visited);
+}
+
+/** Number of random points at which is_zero_modular() evaluates. */
+static const unsigned zero_test_points = 2;
+
+/** Probabilistic test whether an expression is zero as a rational function.
+ *  Non-rational subexpressions are replaced by temporary symbols with
+ *  to_rational(), like ex::normal() does, and the resulting rational
+ *  function is evaluated at random points modulo word-sized primes. A
+ *  non-zero value proves that the rational function is not zero. Zero
+ *  values at all points are wrong only with a probability of about the
+ *  degree divided by 2^28 per point.
+ *
+ *  Unlike ex::normal(), the arguments of functions are not normalized, so
+ *  that the test may fail to see that e.g. sin((x^2-1)/(x-1))-sin(x+1) is
+ *  zero. If exact is true, the answer is therefore only taken from the
+ *  modular values if they are non-zero and e is a rational function, and
+ *  from ex::normal() otherwise. ex::normal() is also used if e could not
+ *  be evaluated because denominators vanished at the random points.
+ *
+ *  @param exact prove the answer with ex::normal() unless it is not zero
+ *  @return true if e is (probably) zero */
+bool is_zero_modular(const ex & e, bool exact)
+{
+	exmap repl;
+	const ex r = e.to_rational(repl);
+	if (!r.info(info_flags::rational_function))
+		return e.normal().is_zero();
+
+	exset syms;
+	std::set<const basic *> visited;
+	collect_symbols(r, syms, visited);
+	lst vars;
+	for (exset::const_iterator i=syms.begin(); i!=syms.end(); ++i)
+		vars.append(*i);
+	const eval_plan plan(r, vars);
+
+	primes_factory next_prime;
+	uint64_t state = 0x2545f4914f6cdd1dULL;
+	std::vector<long> point(syms.size());
+	unsigned zeros = 0;
+	for (unsigned attempt=0; attempt<2*zero_test_points && zeros<zero_test_points; ++attempt) {
+		long p;
+		if (!next_prime(p, cln::cl_I(1)) || p >= max_sparse_modulus)
+			break;
+		for (size_t i=0; i<point.size(); ++i) {
+			// xorshift generator
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			point[i] = long(state % uint64_t(p));
+		}
+		long value;
+		if (!plan.eval_mod(point, p, value))
+			continue;  // a denominator vanished at this point
+		if (value != 0) {
+			if (!exact || repl.empty())
+				return false;
+			break;
+		}
+		++zeros;
+	}
+
+	if (zeros == zero_test_points && !exact)
+		return true;
+	return e.normal().is_zero();
+}
+
+/** The rational function of an eval_plan as a black box for
+ *  interpolate_rational(). */
+class plan_black_box : public zp_black_box {
+public:
+	plan_black_box(const eval_plan & p, size_t n_) : plan(p), n(n_) {}
+	size_t nvars() const { return n; }
+	bool eval(const std::vector<long> & points, long p, std::vector<long> & values) const
+	{
+		return plan.eval_mod_rows(points, p, values, true);
+	}
+private:
+	const eval_plan & plan;
+	const size_t n;
+};
+
+/** Sum of the terms c*(x_0-s_0)^e_0*...*(x_n-s_n)^e_n, multiplied by d. */
+static ex shifted_terms_to_ex(const std::vector<shifted_term> & terms, const exvector & vars,
+                              const std::vector<long> & shift, const cln::cl_I & d)
+{
+	exvector sum;
+	sum.reserve(terms.size());
+	for (size_t i=0; i<terms.size(); ++i) {
+		exvector factors;
+		factors.reserve(vars.size() + 1);
+		factors.push_back(numeric(cln::cl_N(terms[i].coeff * d)));
+		for (size_t j=0; j<vars.size(); ++j)
+			if (terms[i].expo[j])
+				factors.push_back(pow(vars[j] - shift[j], terms[i].expo[j]));
+		sum.push_back((new mul(factors))->setflag(status_flags::dynallocated));
+	}
+	return ((new add(sum))->setflag(status_flags::dynallocated)).expand();
+}
+
+/** Normalization of rational functions by evaluation and interpolation.
+ *  Non-rational subexpressions are replaced by temporary symbols with
+ *  to_rational(). The rational function is evaluated at many points
+ *  modulo word-sized primes (in parallel, if possible), reconstructed
+ *  from these values by interpolation, Chinese remaindering and rational
+ *  reconstruction, and checked at random points. This only depends on the
+ *  size of the result, not on the size of intermediate expressions in
+ *  the normalization of e. It is wrong only with a tiny probability.
+ *  If the reconstruction fails (for instance because the degrees are too
+ *  large), the result of ex::normal() is returned. Unlike ex::normal(),
+ *  the arguments of functions are not normalized.
+ *
+ *  @return normalized expression */
+ex normal_interpolate(const ex & e)
+{
+	exmap repl;
+	const ex r = e.to_rational(repl);
+	if (!r.info(info_flags::rational_function))
+		return e.normal();
+
+	exset syms;
+	std::set<const basic *> visited;
+	collect_symbols(r, syms, visited);
+	if (syms.empty())
+		return e.normal();
+	lst vars_lst;
+	for (exset::const_iterator i=syms.begin(); i!=syms.end(); ++i)
+		vars_lst.append(*i);
+	const exvector vars(syms.begin(), syms.end());
+	const eval_plan plan(r, vars_lst);
+
+	std::vector<long> shift;
+	std::vector<shifted_term> num_terms, den_terms;
+	if (!interpolate_rational(plan_black_box(plan, vars.size()), shift, num_terms, den_terms))
+		return e.normal();
+
+	// Integer coefficients without common factors
+	cln::cl_I d = 1;
+	for (size_t i=0; i<num_terms.size(); ++i)
+		d = cln::lcm(d, cln::denominator(num_terms[i].coeff));
+	for (size_t i=0; i<den_terms.size(); ++i)
+		d = cln::lcm(d, cln::denominator(den_terms[i].coeff));
+	ex num = shifted_terms_to_ex(num_terms, vars, shift, d);
+	ex den = shifted_terms_to_ex(den_terms, vars, shift, d);
+	const numeric c = gcd(ex_to<numeric>(num.integer_content()), ex_to<numeric>(den.integer_content()));
+	num = (num / c).expand();
+	den = (den / c).expand();
+
+	// Make denominator unit normal, like frac_cancel()
+	ex x;
+	if (get_first_symbol(den, x) && ex_to<numeric>(den.unit(x)).is_negative()) {
+		num = -num;
+		den = -den;
+	}
+
+	ex result = num / den;
+	if (!repl.empty())
+		result = result.subs(repl, subs_options::no_pattern);
+	return result;
+}
+
+namespace {
+
+/** A polynomial which is a factor of two products with the exponents e[0]
+ *  and e[1], for combining these products. */
+struct coprime_factor {
+	coprime_factor(const ex & b, long e0, long e1) : base(b) { e[0] = e0; e[1] = e1; }
+	ex base;
+	long e[2];
+};
+
+typedef std::vector<coprime_factor> coprime_base;
+
+/** Rational function coeff * prod base^e[0] over the factors, which are
+ *  pairwise coprime, primitive and unit normal polynomials in Z[X]. All
+ *  their e[1] are zero. */
+struct factored_fraction {
+	factored_fraction() : coeff(1) {}
+	numeric coeff;
+	coprime_base factors;
+};
+
+}
+
+/** Split the expanded polynomial p into a number c and a primitive, unit
+ *  normal polynomial in Z[X], which is returned. */
+static ex primitive_unit_part(const ex & p, numeric & c)
+{
+	if (is_exactly_a<numeric>(p)) {
+		c = ex_to<numeric>(p);
+		return _ex1;
+	}
+	c = p.integer_content();
+	ex x;
+	if (get_first_symbol(p, x) && ex_to<numeric>(p.unit(x)).is_negative())
+		c = -c;
+	return (p * c.inverse()).expand();
+}
+
+/** Multiply the products described by the coprime base b with the powers
+ *  f^e0 and f^e1 of the polynomial f, keeping the base coprime. A factor
+ *  which has a non-trivial gcd with f is split into the gcd and the
+ *  cofactor, which are inserted again. The numbers split off the factors
+ *  go into coeff[0] and coeff[1]. */
+static void insert_factor(coprime_base & b, const ex & f, long e0, long e1, numeric * coeff)
+{
+	numeric c;
+	const ex p = primitive_unit_part(f, c);
+	coeff[0] *= c.power(e0);
+	coeff[1] *= c.power(e1);
+	if (is_exactly_a<numeric>(p) || (e0 == 0 && e1 == 0))
+		return;
+
+	for (coprime_base::iterator i=b.begin(); i!=b.end(); ++i) {
+		if (i->base.is_equal(p)) {
+			i->e[0] += e0;
+			i->e[1] += e1;
+			return;
+		}
+		ex co_base, co_p;
+		const ex g = gcd(i->base, p, &co_base, &co_p, false);
+		if (is_exactly_a<numeric>(g))
+			continue;
+		const coprime_factor old = *i;
+		b.erase(i);
+		insert_factor(b, g, old.e[0] + e0, old.e[1] + e1, coeff);
+		insert_factor(b, co_base, old.e[0], old.e[1], coeff);
+		insert_factor(b, co_p, e0, e1, coeff);
+		return;
+	}
+	b.push_back(coprime_factor(p, e0, e1));
+}
+
+/** Coprime base of the factors of a and b, with the exponents of a in e[0]
+ *  and those of b in e[1]. The coefficients of a and b, changed by the
+ *  splitting of factors, are returned in coeff. */
+static coprime_base merge_factors(const factored_fraction & a, const factored_fraction & b, numeric * coeff)
+{
+	coeff[0] = a.coeff;
+	coeff[1] = b.coeff;
+	coprime_base result(a.factors);
+	for (coprime_base::const_iterator i=b.factors.begin(); i!=b.factors.end(); ++i)
+		insert_factor(result, i->base, 0, i->e[0], coeff);
+	return result;
+}
+
+static factored_fraction mul_factored(const factored_fraction & a, const factored_fraction & b)
+{
+	factored_fraction result;
+	if (a.coeff.is_zero() || b.coeff.is_zero()) {
+		result.coeff = 0;
+		return result;
+	}
+	numeric coeff[2];
+	const coprime_base f = merge_factors(a, b, coeff);
+	result.coeff = coeff[0] * coeff[1];
+	for (coprime_base::const_iterator i=f.begin(); i!=f.end(); ++i)
+		if (i->e[0] + i->e[1] != 0)
+			result.factors.push_back(coprime_factor(i->base, i->e[0] + i->e[1], 0));
+	return result;
+}
+
+/** Sum of two fractions. The powers which both have in common are kept as
+ *  they are, only the rest is multiplied out. */
+static factored_fraction add_factored(const factored_fraction & a, const factored_fraction & b)
+{
+	if (a.coeff.is_zero())
+		return b;
+	if (b.coeff.is_zero())
+		return a;
+
+	numeric coeff[2];
+	const coprime_base f = merge_factors(a, b, coeff);
+	factored_fraction result;
+	exvector terms[2];
+	terms[0].push_back(coeff[0]);
+	terms[1].push_back(coeff[1]);
+	for (coprime_base::const_iterator i=f.begin(); i!=f.end(); ++i) {
+		const long m = std::min(i->e[0], i->e[1]);
+		if (m != 0)
+			result.factors.push_back(coprime_factor(i->base, m, 0));
+		for (int j=0; j<2; ++j)
+			if (i->e[j] != m)
+				terms[j].push_back(power(i->base, i->e[j] - m));
+	}
+	const ex p = ((new mul(terms[0]))->setflag(status_flags::dynallocated)
+	            + (new mul(terms[1]))->setflag(status_flags::dynallocated)).expand();
+	if (p.is_zero()) {
+		result.coeff = 0;
+		result.factors.clear();
+		return result;
+	}
+
+	// The new factor may cancel against any of the common ones
+	numeric c[2];
+	c[0] = c[1] = 1;
+	insert_factor(result.factors, p, 1, 0, c);
+	result.coeff = c[0];
+	coprime_base::iterator i = result.factors.begin();
+	while (i != result.factors.end()) {
+		if (i->e[0] == 0)
+			i = result.factors.erase(i);
+		else
+			++i;
+	}
+	return result;
+}
+
+/** @exception overflow_error (division by zero) */
+static factored_fraction power_factored(const factored_fraction & a, long n)
+{
+	factored_fraction result;
+	if (n == 0)
+		return result;
+	if (a.coeff.is_zero()) {
+		if (n < 0)
+			throw(std::overflow_error("normal_factored(): division by zero"));
+		result.coeff = 0;
+		return result;
+	}
+	result.coeff = a.coeff.power(n);
+	for (coprime_base::const_iterator i=a.factors.begin(); i!=a.factors.end(); ++i)
+		result.factors.push_back(coprime_factor(i->base, i->e[0] * n, 0));
+	return result;
+}
+
+/** Fraction of a polynomial, which is a single factor. */
+static factored_fraction polynomial_factored(const ex & p)
+{
+	factored_fraction result;
+	numeric c[2];
+	c[0] = c[1] = 1;
+	insert_factor(result.factors, p.expand(), 1, 0, c);
+	result.coeff = c[0];
+	return result;
+}
+
+/** Fraction of a rational function with rational coefficients, as returned
+ *  by to_rational(). The polynomial terms of a sum are added first. */
+static factored_fraction to_factored(const ex & e)
+{
+	if (is_exactly_a<numeric>(e)) {
+		factored_fraction result;
+		result.coeff = ex_to<numeric>(e);
+		return result;
+	}
+	if (is_exactly_a<add>(e)) {
+		if (e.info(info_flags::polynomial))
+			return polynomial_factored(e);
+		exvector poly_terms;
+		factored_fraction result;
+		result.coeff = 0;
+		for (size_t i=0; i<e.nops(); ++i) {
+			if (e.op(i).info(info_flags::polynomial))
+				poly_terms.push_back(e.op(i));
+			else
+				result = add_factored(result, to_factored(e.op(i)));
+		}
+		if (!poly_terms.empty())
+			result = add_factored(result, polynomial_factored((new add(poly_terms))->setflag(status_flags::dynallocated)));
+		return result;
+	}
+	if (is_exactly_a<mul>(e)) {
+		factored_fraction result;
+		for (size_t i=0; i<e.nops(); ++i)
+			result = mul_factored(result, to_factored(e.op(i)));
+		return result;
+	}
+	if (is_exactly_a<power>(e) && e.op(1).info(info_flags::integer))
+		return power_factored(to_factored(e.op(0)), ex_to<numeric>(e.op(1)).to_long());
+	return polynomial_factored(e);
+}
+
+/** Normal form of a rational function as a number times a product of
+ *  powers of pairwise coprime polynomials, which are primitive and unit
+ *  normal, the negative powers making up the denominator. Unlike
+ *  normal(), which multiplies out the denominators and has to find their
+ *  common factors again with gcd() on the expanded polynomials, the
+ *  factors are kept separate, so that adding fractions only needs the
+ *  gcds of these factors and only the parts which are not common to the
+ *  terms are expanded. The factors are not irreducible in general, and
+ *  if the numerator or the whole expression is wanted as one polynomial,
+ *  normal() or expand() of the result produces it. Non-rational
+ *  subexpressions are treated like symbols, as by to_rational().
+ *
+ *  @param e  expression to normalize
+ *  @return the normal form as a product of powers
+ *  @exception overflow_error (division by zero) */
+ex normal_factored(const ex & e)
+{
+	exmap repl;
+	const factored_fraction f = to_factored(e.to_rational(repl));
+
+	exvector factors;
+	factors.reserve(f.factors.size() + 1);
+	factors.push_back(f.coeff);
+	for (coprime_base::const_iterator i=f.factors.begin(); i!=f.factors.end(); ++i)
+		factors.push_back(power(i->base, i->e[0]));
+	ex result = (new mul(factors))->setflag(status_flags::dynallocated);
+
+	// Re-insert replaced symbols
+	if (!repl.empty())
+		result = result.subs(repl, subs_options::no_pattern);
+	return result;
+}
+
 
 /** Rationalization of non-rational functions.
  *  This function converts a general expression to a rational function
@@ -2608,18 +3684,59 @@ ex expairseq::to_polynomial(exmap & repl) const
 }
 
 
-/** Remove the common factor in the terms of a sum 'e' by calculating the GCD,
- *  and multiply it into the expression 'factor' (which needs to be initialized
- *  to 1, unless you're accumulating factors). */
+/** The multiplicative factors of a term of a sum: a numeric coefficient and
+ *  bases with positive integer exponents. */
+struct term_factors {
+	numeric coeff;
+	std::vector<std::pair<ex, numeric> > factors;
+};
+
+/** Split a term of a sum into its factors. The bases are distinct because
+ *  mul::eval() combines powers of the same base. */
+static void split_term_factors(const ex & t, term_factors & tf)
+{
+	tf.coeff = *_num1_p;
+	tf.factors.clear();
+	const bool is_mul = is_exactly_a<mul>(t);
+	const size_t n = is_mul ? t.nops() : 1;
+	for (size_t i=0; i<n; i++) {
+		const ex f = is_mul ? t.op(i) : t;
+		if (is_exactly_a<numeric>(f))
+			tf.coeff = tf.coeff.mul(ex_to<numeric>(f));
+		else if (is_exactly_a<power>(f) && f.op(1).info(info_flags::posint))
+			tf.factors.push_back(std::make_pair(f.op(0), ex_to<numeric>(f.op(1))));
+		else
+			tf.factors.push_back(std::make_pair(f, *_num1_p));
+	}
+}
+
+/** Number of terms of a sum containing a base, and its smallest exponent. */
+struct common_factor_count {
+	common_factor_count() : count(0) {}
+	size_t count;
+	numeric expo;
+};
+
+/** Remove the common factor in the terms of a sum 'e' and multiply it into
+ *  the expression 'factor' (which needs to be initialized to 1, unless
+ *  you're accumulating factors).
+ *
+ *  The factors of all terms are indexed in a hash table first, so factors
+ *  which are explicitly present in every term are pulled out in one pass.
+ *  Only if the remaining terms contain sums (or rational coefficients),
+ *  which may still have a common divisor, is the GCD of the terms
+ *  calculated. */
 static ex find_common_factor(const ex & e, ex & factor, exmap & repl)
 {
 	if (is_exactly_a<add>(e)) {
 
 		size_t num = e.nops();
 		exvector terms; terms.reserve(num);
-		ex gc;
+		std::vector<term_factors> split(num);
+		exhashmap<common_factor_count> index;
+		bool integer_coeffs = true;
 
-		// Find the common GCD
+		// Index the factors of the terms
 		for (size_t i=0; i<num; i++) {
 			ex x = e.op(i).to_polynomial(repl);
 
@@ -2629,18 +3746,68 @@ static ex find_common_factor(const ex & e, ex & factor, exmap & repl)
 				x *= f;
 			}
 
-			if (i == 0)
-				gc = x;
-			else
-				gc = gcd(gc, x);
-
 			terms.push_back(x);
+			split_term_factors(x, split[i]);
+			integer_coeffs = integer_coeffs && split[i].coeff.is_integer();
+			for (size_t j=0; j<split[i].factors.size(); j++) {
+				common_factor_count & c = index[split[i].factors[j].first];
+				if (c.count++ == 0 || split[i].factors[j].second < c.expo)
+					c.expo = split[i].factors[j].second;
+			}
 		}
 
-		if (gc.is_equal(_ex1))
+		// Pull out the factors present in all terms and the GCD of the
+		// integer coefficients
+		exvector common;
+		numeric cg = *_num0_p;
+		if (integer_coeffs) {
+			for (size_t i=0; i<num && !cg.is_equal(*_num1_p); i++)
+				cg = gcd(cg, split[i].coeff);
+			if (!cg.is_equal(*_num1_p))
+				common.push_back(cg);
+		} else
+			cg = *_num1_p;
+		for (exhashmap<common_factor_count>::const_iterator it = index.begin(); it != index.end(); ++it)
+			if (it->second.count == num)
+				common.push_back(pow(it->first, it->second.expo));
+
+		bool has_sums = !integer_coeffs;
+		for (size_t i=0; i<num; i++) {
+			exvector v;
+			v.reserve(split[i].factors.size() + 1);
+			v.push_back(split[i].coeff.div(cg));
+			for (size_t j=0; j<split[i].factors.size(); j++) {
+				const ex & b = split[i].factors[j].first;
+				numeric expo = split[i].factors[j].second;
+				const common_factor_count & c = index.find(b)->second;
+				if (c.count == num)
+					expo = expo.sub(c.expo);
+				if (expo.is_zero())
+					continue;
+				has_sums = has_sums || is_exactly_a<add>(b);
+				v.push_back(pow(b, expo));
+			}
+			if (!common.empty())
+				terms[i] = (new mul(v))->setflag(status_flags::dynallocated);
+		}
+
+		// Sums in the remaining terms may still have a common divisor
+		ex gc = _ex1;
+		if (has_sums) {
+			for (size_t i=0; i<num; i++) {
+				gc = (i == 0) ? terms[i] : gcd(gc, terms[i]);
+				if (gc.is_equal(_ex1))
+					break;
+			}
+		}
+
+		if (common.empty() && gc.is_equal(_ex1))
 			return e;
 
-		// The GCD is the factor we pull out
+		// Both are the factor we pull out
+		factor *= (new mul(common))->setflag(status_flags::dynallocated);
+		if (gc.is_equal(_ex1))
+			return (new add(terms))->setflag(status_flags::dynallocated);
 		factor *= gc;
 
 		// Now divide all terms by the GCD
@@ -2724,23 +3891,27 @@ ex resultant(const ex & e1, const ex & e2, const ex & s)
 	    !ee2.info(info_flags::polynomial))
 		throw(std::runtime_error("resultant(): arguments must be polynomials"));
 
-	const int h1 = ee1.degree(s);
-	const int l1 = ee1.ldegree(s);
-	const int h2 = ee2.degree(s);
-	const int l2 = ee2.ldegree(s);
+	ex r;
+	if (mod_resultant(ee1, ee2, s, r))
+		return r;
+
+	const std::map<int, ex> c1 = ee1.coeffs(s);
+	const std::map<int, ex> c2 = ee2.coeffs(s);
+	const int h1 = c1.empty() ? 0 : c1.rbegin()->first;
+	const int h2 = c2.empty() ? 0 : c2.rbegin()->first;
 
 	const int msize = h1 + h2;
 	matrix m(msize, msize);
 
-	for (int l = h1; l >= l1; --l) {
-		const ex e = ee1.coeff(s, l);
+	for (std::map<int, ex>::const_iterator i = c1.begin(); i != c1.end(); ++i) {
+		const int l = i->first;
 		for (int k = 0; k < h2; ++k)
-			m(k, k+h1-l) = e;
+			m(k, k+h1-l) = i->second;
 	}
-	for (int l = h2; l >= l2; --l) {
-		const ex e = ee2.coeff(s, l);
+	for (std::map<int, ex>::const_iterator i = c2.begin(); i != c2.end(); ++i) {
+		const int l = i->first;
 		for (int k = 0; k < h1; ++k)
-			m(k+h2, k+h2-l) = e;
+			m(k+h2, k+h2-l) = i->second;
 	}
 
 	return m.determinant();
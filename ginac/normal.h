@@ -58,7 +58,23 @@ struct gcd_options
 		 * it's much faster than PRS (pseudo remainder sequence)
 		 * algorithm. This flag forces GiNaC to use PRS algorithm
 		 */
-		use_sr_gcd = 8
+		use_sr_gcd = 8,
+		/**
+		 * Compute the modular images of the GCD for several primes
+		 * at once, using several threads. This needs a library
+		 * built with GINAC_THREAD_SAFE_REFCOUNT and is ignored
+		 * otherwise.
+		 */
+		parallel = 16,
+		/**
+		 * The modular GCD algorithm interpolates the GCD from its
+		 * images one variable at a time. With this flag, all but
+		 * the first image are obtained by sparse (Zippel)
+		 * interpolation from the monomials of the first one. This
+		 * is much faster if the GCD has few terms of high degree
+		 * in many variables.
+		 */
+		use_sparse_interp = 32
 
 	};
 };
@@ -88,6 +104,24 @@ extern bool divide(const ex &a, const ex &b, ex &q, bool check_args = true);
 extern ex gcd(const ex &a, const ex &b, ex *ca = NULL, ex *cb = NULL,
 	      bool check_args = true, unsigned options = 0);
 
+/** Statistics of the cache of gcd() results (@see set_gcd_cache_size()). */
+struct gcd_cache_statistics {
+	unsigned long lookups;  ///< calls of gcd() which looked into the cache
+	unsigned long hits;     ///< calls answered from the cache
+	size_t entries;         ///< results currently stored
+};
+
+/** Let gcd() remember its results, together with the cofactors, in a
+ *  cache with room for size entries. Repeated calls with the same
+ *  arguments (compared with is_equal()) and options are then answered
+ *  from the cache. A size of 0, the default, switches the cache off and
+ *  frees the stored expressions. With GINAC_THREAD_SAFE_REFCOUNT every
+ *  thread has its own cache (and statistics) of this size. */
+extern void set_gcd_cache_size(size_t size);
+
+/** Return the statistics of the gcd() cache (of the calling thread). */
+extern gcd_cache_statistics get_gcd_cache_statistics();
+
 // Polynomial LCM in Z[X]
 extern ex lcm(const ex &a, const ex &b, bool check_args = true);
 
@@ -97,6 +131,44 @@ extern ex sqrfree(const ex &a, const lst &l = lst());
 // Square-free partial fraction decomposition of a rational function a(x)
 extern ex sqrfree_parfrac(const ex & a, const symbol & x);
 
+// Normal form of the elements of a list or matrix, or of the terms of a sum, computed in parallel
+extern ex normal_parallel(const ex & e, int level = 0);
+
+/** Temporary symbols for the non-rational subexpressions, kept across calls
+ *  of normal(), numer_denom(), to_rational() and to_polynomial(). Equal
+ *  subexpressions get the same symbol in all of these calls, so they need
+ *  not be found again, and the polynomials built from related expressions
+ *  share their symbols (which helps the gcd() cache). */
+class normal_context {
+public:
+	/** Normal form of e, like ex::normal(). */
+	ex normal(const ex & e, int level = 0);
+	/** Numerator and denominator of e, like ex::numer_denom(). */
+	ex numer_denom(const ex & e);
+	/** Rational function in the temporary symbols, like ex::to_rational(). */
+	ex to_rational(const ex & e);
+	/** Polynomial in the temporary symbols, like ex::to_polynomial(). */
+	ex to_polynomial(const ex & e);
+	/** Substitute the subexpressions for the temporary symbols in e. */
+	ex restore(const ex & e) const;
+	/** The temporary symbols and the subexpressions they stand for. */
+	const exmap & replacements() const { return repl; }
+	/** Forget all temporary symbols. */
+	void clear();
+private:
+	exmap repl;        ///< temporary symbols -> subexpressions
+	exmap rev_lookup;  ///< subexpressions -> temporary symbols
+};
+
+// Probabilistic test whether an expression is zero as a rational function
+extern bool is_zero_modular(const ex & e, bool exact = false);
+
+// Normal form of a rational function found by evaluation and interpolation
+extern ex normal_interpolate(const ex & e);
+
+// Normal form of a rational function as a product of powers of coprime polynomials
+extern ex normal_factored(const ex & e);
+
 // Collect common factors in sums.
 extern ex collect_common_factors(const ex & e);
 
@@ -34,6 +34,7 @@
 // do so for the compiler, hence the !defined(__MAKECINT__).
   #include <cln/complex_class.h>
 #endif
+#include <functional>
 #include <stdexcept>
 #include <vector>
 
@@ -53,7 +54,13 @@ typedef void (* digits_changed_callback)(long);
  *  for temprary storing its value e.g.  The user must not create an
  *  own working object of this class!  Since C++ forces us to make the
  *  class definition visible in order to use an object we put in a
- *  flag which prevents other objects of that class to be created. */
+ *  flag which prevents other objects of that class to be created.
+ *
+ *  If GiNaC was built with GINAC_THREAD_SAFE_REFCOUNT, the value is kept per
+ *  thread, so that threads can evaluate at different precisions at the same
+ *  time. Every thread starts with 17 digits. cl_default_float_format is left
+ *  alone then, and numerical evaluation passes the float format of the
+ *  current thread to CLN explicitly. */
 class _numeric_digits
 {
 // member functions
@@ -65,7 +72,6 @@ public:
 	void add_callback(digits_changed_callback callback);
 // member variables
 private:
-	long digits;                        ///< Number of decimal digits
 	static bool too_late;               ///< Already one object present
 	// Holds a list of functions that get called when digits is changed.
 	std::vector<digits_changed_callback> callbacklist;
@@ -130,7 +136,8 @@ protected:
 	 *  @see ex::diff */
 	ex derivative(const symbol &s) const { return 0; }
 	bool is_equal_same_type(const basic &other) const;
-	unsigned calchash() const;
+	hash_t calchash() const;
+	tree_metrics calc_metrics() const;
 	
 	// new virtual functions which can be overridden by derived classes
 	// (none)
@@ -211,6 +218,39 @@ GINAC_DECLARE_UNARCHIVER(numeric);
 extern const numeric I;
 extern _numeric_digits Digits;
 
+// Flyweights for the integers from small_integer_min to small_integer_max,
+// used internally. They are stored consecutively, so is_small_integer() and
+// small_integer_value() need no call into CLN.
+
+const long small_integer_min = -256;
+const long small_integer_max = 256;
+
+/** The flyweight 0 in the table of small integers. */
+extern const numeric *_num_small_p;
+
+/** The flyweight for i, which must be in the range of small integers. */
+inline const numeric & small_integer(long i)
+{
+	return _num_small_p[i];
+}
+
+/** Whether n is one of the small integer flyweights. Other numerics may
+ *  have the same values. */
+inline bool is_small_integer(const numeric & n)
+{
+	std::less<const numeric *> less;
+	return !less(&n, _num_small_p + small_integer_min) && !less(_num_small_p + small_integer_max, &n);
+}
+
+/** The value of the small integer flyweight n. */
+inline long small_integer_value(const numeric & n)
+{
+	return &n - _num_small_p;
+}
+
+/** The flyweight equal to n, or 0 if n is not a small integer. */
+const numeric * find_small_integer(const numeric & n);
+
 // global functions
 
 const numeric exp(const numeric &x);
@@ -329,6 +369,7 @@ inline const numeric denom(const numeric &x)
 ex PiEvalf();
 ex EulerEvalf();
 ex CatalanEvalf();
+ex cached_evalf(ex (*f)());
 
 
 } // namespace GiNaC
@@ -0,0 +1,60 @@
+/** @file numsum.h
+ *
+ *  Interface to an accumulator for sums of many numbers. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_NUMSUM_H
+#define GINAC_NUMSUM_H
+
+#include "numeric.h"
+
+#include <cln/integer.h>
+
+namespace GiNaC {
+
+/** Sum of numbers, for combining the coefficients of like terms. Adding
+ *  numerics one by one creates a heap object and a normalized rational
+ *  number for every partial sum. Here, small integers are summed up in a
+ *  long, the other rational numbers as a numerator over the least common
+ *  multiple of their denominators, and the fraction is reduced only once
+ *  by result_dyn(). Floating-point and complex terms are summed up
+ *  separately. */
+class numeric_sum {
+public:
+	numeric_sum() : small(0), num(0), den(1), has_rational(false), has_other(false) {}
+
+	void add(const numeric & x);
+
+	/** The sum as a numeric object on the heap, a flyweight if it is a small
+	 *  integer. */
+	const numeric & result_dyn() const;
+
+private:
+	long small;        ///< sum of the small integer flyweights
+	cln::cl_I num;     ///< numerator of the sum of the other rational terms
+	cln::cl_I den;     ///< their common denominator
+	cln::cl_N other;   ///< sum of the terms which are not rational
+	bool has_rational;
+	bool has_other;
+};
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_NUMSUM_H
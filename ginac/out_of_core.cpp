@@ -0,0 +1,266 @@
+/** @file out_of_core.cpp
+ *
+ *  Implementation of the expansion of expressions with more terms than fit
+ *  into memory. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "out_of_core.h"
+#include "add.h"
+#include "mul.h"
+#include "power.h"
+#include "numeric.h"
+#include "operators.h"
+#include "archive.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace GiNaC {
+
+/** Split an expanded term into its numeric coefficient and the rest. */
+static expair split_term(const ex & t)
+{
+	if (is_exactly_a<numeric>(t))
+		return expair(_ex1, t);
+	if (is_exactly_a<mul>(t)) {
+		const ex c = t.op(t.nops() - 1);
+		if (is_exactly_a<numeric>(c))
+			return expair(t / c, c);
+	}
+	return expair(t, _ex1);
+}
+
+/** Sort the terms and combine like terms, dropping those that cancel. */
+static void combine_terms(epvector & v)
+{
+	std::sort(v.begin(), v.end(), expair_rest_is_less());
+	epvector::iterator out = v.begin();
+	epvector::const_iterator i = v.begin();
+	while (i != v.end()) {
+		const ex rest = i->rest;
+		numeric coeff = ex_to<numeric>(i->coeff);
+		for (++i; i != v.end() && i->rest.is_equal(rest); ++i)
+			coeff = coeff.add(ex_to<numeric>(i->coeff));
+		if (!coeff.is_zero())
+			*out++ = expair(rest, coeff);
+	}
+	v.erase(out, v.end());
+}
+
+/** Append a term to a run. Each term is an archive of its own, preceded by
+ *  its length, so that the terms can be read back one at a time. */
+static void write_term(std::FILE * f, const expair & t)
+{
+	archive a;
+	a.archive_ex(t.rest, "r");
+	a.archive_ex(t.coeff, "c");
+	std::ostringstream os;
+	os << a;
+	const std::string s = os.str();
+	const unsigned long long n = s.size();
+	if (std::fwrite(&n, sizeof(n), 1, f) != 1 || std::fwrite(s.data(), 1, s.size(), f) != s.size())
+		throw std::runtime_error("out_of_core_expander: cannot write run");
+}
+
+/** Read the next term of a run.
+ *  @return false at the end of the run */
+static bool read_term(std::FILE * f, const lst & syms, expair & t)
+{
+	unsigned long long n;
+	if (std::fread(&n, sizeof(n), 1, f) != 1)
+		return false;
+	std::string s(n, '\0');
+	if (std::fread(&s[0], 1, s.size(), f) != s.size())
+		throw std::runtime_error("out_of_core_expander: run is truncated");
+	std::istringstream is(s);
+	archive a;
+	is >> a;
+	t = expair(a.unarchive_ex(syms, "r"), a.unarchive_ex(syms, "c"));
+	return true;
+}
+
+out_of_core_expander::out_of_core_expander(const lst & syms_, size_t run_size_)
+ : syms(syms_), run_size(std::max(run_size_, size_t(1))), runs_written(0)
+{
+}
+
+out_of_core_expander::~out_of_core_expander()
+{
+	close_runs();
+}
+
+void out_of_core_expander::close_runs()
+{
+	for (std::vector<std::FILE *>::iterator i = runs.begin(); i != runs.end(); ++i)
+		std::fclose(*i);
+	runs.clear();
+}
+
+size_t out_of_core_expander::expand(const ex & e, term_sink & sink)
+{
+	close_runs();
+	run.clear();
+	runs_written = 0;
+
+	if (is_exactly_a<add>(e)) {
+		for (const_iterator i = e.begin(); i != e.end(); ++i)
+			expand_product(*i);
+	} else
+		expand_product(e);
+
+	if (runs.empty()) {
+		// Everything fits into memory
+		combine_terms(run);
+		for (epvector::const_iterator i = run.begin(); i != run.end(); ++i)
+			sink(i->rest, ex_to<numeric>(i->coeff));
+		const size_t n = run.size();
+		run.clear();
+		return n;
+	}
+
+	write_run();
+	return merge_runs(sink);
+}
+
+/** Generate the terms of the expanded product p, one at a time. */
+void out_of_core_expander::expand_product(const ex & p)
+{
+	exvector ops;
+	if (is_exactly_a<mul>(p))
+		ops.assign(p.begin(), p.end());
+	else
+		ops.push_back(p);
+
+	// The expanded factors, each as the vector of its terms
+	std::vector<exvector> factors;
+	for (exvector::const_iterator i = ops.begin(); i != ops.end(); ++i) {
+		if (is_exactly_a<power>(*i) && is_exactly_a<add>(i->op(0))
+		 && i->op(1).info(info_flags::posint) && !i->op(1).is_equal(_ex1)) {
+			const numeric & n = ex_to<numeric>(i->op(1));
+			const numeric half = iquo(n, *_num2_p);
+			factors.push_back(exvector(1, pow(i->op(0), half).expand()));
+			factors.push_back(exvector(1, pow(i->op(0), n - half).expand()));
+		} else
+			factors.push_back(exvector(1, i->expand()));
+		if (is_exactly_a<add>(factors.back()[0])) {
+			const ex sum = factors.back()[0];
+			factors.back().assign(sum.begin(), sum.end());
+		}
+	}
+
+	// Run through all combinations of one term from each factor
+	std::vector<size_t> k(factors.size(), 0);
+	exvector v(factors.size());
+	while (true) {
+		for (size_t i = 0; i < factors.size(); ++i)
+			v[i] = factors[i][k[i]];
+		add_term(ex((new mul(v))->setflag(status_flags::dynallocated)).expand());
+
+		size_t i = 0;
+		while (i < k.size() && ++k[i] == factors[i].size())
+			k[i++] = 0;
+		if (i == k.size())
+			break;
+	}
+}
+
+void out_of_core_expander::add_term(const ex & t)
+{
+	if (is_exactly_a<add>(t)) {
+		for (const_iterator i = t.begin(); i != t.end(); ++i)
+			add_term(*i);
+		return;
+	}
+	if (t.is_zero())
+		return;
+	run.push_back(split_term(t));
+	if (run.size() >= run_size)
+		write_run();
+}
+
+/** Sort the collected terms, combine like terms and write them to a new
+ *  temporary file. */
+void out_of_core_expander::write_run()
+{
+	combine_terms(run);
+	std::FILE * f = std::tmpfile();
+	if (!f)
+		throw std::runtime_error("out_of_core_expander: cannot create temporary file");
+	runs.push_back(f);
+	++runs_written;
+	for (epvector::const_iterator i = run.begin(); i != run.end(); ++i)
+		write_term(f, *i);
+	run.clear();
+}
+
+namespace {
+
+/** Current term of a run while merging. */
+struct run_head {
+	expair term;
+	size_t run;
+};
+
+struct run_head_is_greater {
+	bool operator()(const run_head & a, const run_head & b) const
+	{
+		return a.term.rest.compare(b.term.rest) > 0;
+	}
+};
+
+} // anonymous namespace
+
+/** Merge the sorted runs, combining like terms from different runs. */
+size_t out_of_core_expander::merge_runs(term_sink & sink)
+{
+	std::priority_queue<run_head, std::vector<run_head>, run_head_is_greater> heads;
+	for (size_t r = 0; r < runs.size(); ++r) {
+		std::rewind(runs[r]);
+		run_head h;
+		h.run = r;
+		if (read_term(runs[r], syms, h.term))
+			heads.push(h);
+	}
+
+	size_t n = 0;
+	while (!heads.empty()) {
+		const ex rest = heads.top().term.rest;
+		numeric coeff = *_num0_p;
+		while (!heads.empty() && heads.top().term.rest.is_equal(rest)) {
+			run_head h = heads.top();
+			heads.pop();
+			coeff = coeff.add(ex_to<numeric>(h.term.coeff));
+			if (read_term(runs[h.run], syms, h.term))
+				heads.push(h);
+		}
+		if (!coeff.is_zero()) {
+			sink(rest, coeff);
+			++n;
+		}
+	}
+	close_runs();
+	return n;
+}
+
+} // namespace GiNaC
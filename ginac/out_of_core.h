@@ -0,0 +1,105 @@
+/** @file out_of_core.h
+ *
+ *  Interface to the expansion of expressions with more terms than fit
+ *  into memory. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_OUT_OF_CORE_H
+#define GINAC_OUT_OF_CORE_H
+
+#include "ex.h"
+#include "expair.h"
+#include "lst.h"
+
+#include <cstddef> // for size_t
+#include <cstdio>
+#include <vector>
+
+namespace GiNaC {
+
+class numeric;
+
+/** Function object receiving the terms of an out-of-core expansion. */
+struct term_sink {
+	virtual ~term_sink() {}
+	/** Called once for each term rest*coeff of the result. */
+	virtual void operator()(const ex & rest, const numeric & coeff) = 0;
+};
+
+/** Expansion of products of sums (and of sums of them) with more terms
+ *  than fit into memory, in the way of FORM. The terms of each product are
+ *  generated one at a time and collected in runs of at most run_size
+ *  terms. A full run is sorted, its like terms are combined, and it is
+ *  written to a temporary file, one archived term after the other. In the
+ *  end the runs are merged, like terms are combined again, and the terms
+ *  of the result are passed to a term_sink in canonical order. So only one
+ *  run, and one term of each run while merging, are held in memory. The
+ *  sink can transform the terms (with subs() or normal(), for instance)
+ *  and write them to an archive_writer.
+ *
+ *  The factors of the products are expanded in memory. A power of a sum
+ *  is split into two factors with half the exponent, so that only the
+ *  expansions of these are held in memory.
+ *
+ *  @code
+ *  struct writer : public term_sink {
+ *      ...
+ *      void operator()(const ex & rest, const numeric & coeff)
+ *      { w.archive_ex(rest*coeff, "term"); }
+ *  };
+ *  writer sink(...);
+ *  out_of_core_expander x(lst(a, b, c));
+ *  x.expand(pow(a+b+c, 40)*pow(a-b, 20), sink);
+ *  @endcode */
+class out_of_core_expander {
+public:
+	/** @param syms all symbols that occur in the expressions to expand,
+	 *         used to read back the terms from the runs
+	 *  @param run_size maximum number of terms held in memory */
+	explicit out_of_core_expander(const lst & syms, size_t run_size = 1 << 20);
+	~out_of_core_expander();
+
+	/** Expand e and pass the terms of the result to sink.
+	 *  @return number of terms of the result */
+	size_t expand(const ex & e, term_sink & sink);
+
+	/** Number of runs written to disk by the last call of expand(). */
+	size_t num_runs() const { return runs_written; }
+
+private:
+	out_of_core_expander(const out_of_core_expander &);
+	out_of_core_expander & operator=(const out_of_core_expander &);
+
+	void expand_product(const ex & p);
+	void add_term(const ex & t);
+	void write_run();
+	size_t merge_runs(term_sink & sink);
+	void close_runs();
+
+	lst syms;
+	size_t run_size;
+	epvector run;                 ///< terms collected for the next run
+	std::vector<std::FILE *> runs;
+	size_t runs_written;
+};
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_OUT_OF_CORE_H
@@ -0,0 +1,294 @@
+/** @file parallel.cpp
+ *
+ *  Implementation of helpers for running independent parts of an
+ *  algorithm in parallel. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "parallel.h"
+#include "numeric.h"
+
+#include <cln/integer.h>
+#include <cstdlib>
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace GiNaC {
+
+/** State of one parallel_for() call shared with its tasks. */
+struct parallel_control {
+	parallel_control() : cancelled(false) {}
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	std::atomic<bool> cancelled;
+#else
+	bool cancelled;
+#endif
+};
+
+void parallel_task::cancel()
+{
+	if (control)
+		control->cancelled = true;
+}
+
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+namespace {
+
+/** Default of max_threads(). */
+unsigned default_max_threads()
+{
+	const char* env = std::getenv("GINAC_NUM_THREADS");
+	if (env) {
+		const long n = std::atol(env);
+		if (n > 0)
+			return unsigned(n);
+	}
+	const unsigned hw = std::thread::hardware_concurrency();
+	return hw ? hw : 1;
+}
+
+std::atomic<unsigned> thread_limit(0);  ///< set_max_threads(), 0 for the default
+
+/** Whether this thread is running a task of parallel_for(). */
+thread_local bool in_parallel_for = false;
+
+/** Shared state of the threads of one parallel_for() call. The calls are
+ *  handed out one by one, so uneven work per call balances itself: a
+ *  thread which finishes early takes over the calls the others have not
+ *  started. */
+struct parallel_for_state {
+	parallel_for_state(size_t n_, parallel_task & task_, unsigned helpers_)
+	  : n(n_), task(task_), budget(current_budget()), next(0), wanted(helpers_), joined(0), active(0) {}
+
+	void run()
+	{
+		const bool outer = in_parallel_for;
+		in_parallel_for = true;
+		const computation_budget * const outer_budget = adopt_budget(budget);
+		size_t i;
+		while (!control.cancelled && (i = next.fetch_add(1)) < n) {
+			try {
+				task(i);
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if (!error)
+					error = std::current_exception();
+				control.cancelled = true;  // don't start any further calls
+			}
+		}
+		adopt_budget(outer_budget);
+		in_parallel_for = outer;
+	}
+
+	const size_t n;
+	parallel_task & task;
+	const computation_budget * const budget;  ///< budget of the caller
+	parallel_control control;
+	std::atomic<size_t> next;
+	std::mutex error_mutex;
+	std::exception_ptr error;
+	// The following are guarded by the mutex of the thread pool
+	const unsigned wanted;  ///< number of pool threads to help
+	unsigned joined;        ///< pool threads which took the call
+	unsigned active;        ///< pool threads still working on it
+};
+
+/** The threads which help the callers of parallel_for(). Calls waiting for
+ *  help are queued, and an idle thread joins the oldest one. The caller
+ *  works on its own call as well, so it finishes even if all threads of
+ *  the pool are busy with other calls. */
+class thread_pool {
+public:
+	/** The pool of the library. It is never destroyed, so that its
+	 *  (detached) threads may still wait for work at program exit. */
+	static thread_pool & instance()
+	{
+		static thread_pool * pool = new thread_pool;
+		return *pool;
+	}
+
+	void run(parallel_for_state & state)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			while (threads < state.wanted) {
+				std::thread(&thread_pool::work, this).detach();
+				++threads;
+			}
+			queue.push_back(&state);
+		}
+		wake.notify_all();
+
+		state.run();
+
+		std::unique_lock<std::mutex> lock(mutex);
+		for (std::deque<parallel_for_state *>::iterator i=queue.begin(); i!=queue.end(); ++i) {
+			if (*i == &state) {
+				queue.erase(i);
+				break;
+			}
+		}
+		while (state.active)
+			done.wait(lock);
+	}
+
+private:
+	thread_pool() : threads(0) {}
+
+	void work()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			while (queue.empty())
+				wake.wait(lock);
+			parallel_for_state & state = *queue.front();
+			++state.active;
+			if (++state.joined == state.wanted)
+				queue.pop_front();
+			lock.unlock();
+			state.run();
+			lock.lock();
+			if (--state.active == 0)
+				done.notify_all();
+		}
+	}
+
+	std::mutex mutex;
+	std::condition_variable wake;  ///< a call was queued
+	std::condition_variable done;  ///< a thread has left a call
+	std::deque<parallel_for_state *> queue;
+	unsigned threads;
+};
+
+}
+#endif
+
+unsigned max_threads()
+{
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	const unsigned n = thread_limit;
+	if (n)
+		return n;
+	static const unsigned default_n = default_max_threads();
+	return default_n;
+#else
+	return 1;
+#endif
+}
+
+void set_max_threads(unsigned n)
+{
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	thread_limit = n;
+#endif
+}
+
+unsigned parallel_threads(size_t n)
+{
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	if (in_parallel_for)
+		return 1;
+	const unsigned limit = max_threads();
+	return n < limit ? unsigned(n) : limit;
+#else
+	return 1;
+#endif
+}
+
+void parallel_for(size_t n, parallel_task & task)
+{
+	parallel_control * const outer = task.control;
+	const unsigned nthreads = parallel_threads(n);
+	if (nthreads <= 1) {
+		parallel_control control;
+		task.control = &control;
+		try {
+			for (size_t i=0; i<n && !control.cancelled; ++i)
+				task(i);
+		} catch (...) {
+			task.control = outer;
+			throw;
+		}
+		task.control = outer;
+		return;
+	}
+
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	parallel_for_state state(n, task, nthreads - 1);
+	task.control = &state.control;
+	thread_pool::instance().run(state);
+	task.control = outer;
+	if (state.error)
+		std::rethrow_exception(state.error);
+#endif
+}
+
+bool numerics_are_immediate(const ex & e)
+{
+	if (is_exactly_a<numeric>(e)) {
+		const numeric & n = ex_to<numeric>(e);
+		return n.is_integer() &&
+		       cln::integer_length(cln::the<cln::cl_I>(n.to_cl_N())) < cl_value_len - 1;
+	}
+	for (size_t i=0; i<e.nops(); ++i)
+		if (!numerics_are_immediate(e.op(i)))
+			return false;
+	return true;
+}
+
+bool numerics_are_immediate(const epvector & v, const ex & oc)
+{
+	if (!numerics_are_immediate(oc))
+		return false;
+	for (epvector::const_iterator i=v.begin(); i!=v.end(); ++i)
+		if (!numerics_are_immediate(i->rest) || !numerics_are_immediate(i->coeff))
+			return false;
+	return true;
+}
+
+void prepare_for_threads(const ex & e)
+{
+	const basic & b = ex_to<basic>(e);
+	b.gethash();
+	b.symbol_mask();
+	b.metrics();
+}
+
+void prepare_for_threads(const exvector & v)
+{
+	for (exvector::const_iterator i=v.begin(); i!=v.end(); ++i)
+		prepare_for_threads(*i);
+}
+
+void prepare_for_threads(const epvector & v, const ex & oc)
+{
+	prepare_for_threads(oc);
+	for (epvector::const_iterator i=v.begin(); i!=v.end(); ++i) {
+		prepare_for_threads(i->rest);
+		prepare_for_threads(i->coeff);
+	}
+}
+
+} // namespace GiNaC
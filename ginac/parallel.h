@@ -0,0 +1,101 @@
+/** @file parallel.h
+ *
+ *  Interface to helpers for running independent parts of an algorithm
+ *  in parallel. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_PARALLEL_H
+#define GINAC_PARALLEL_H
+
+#include "expairseq.h"
+#include "threads.h"
+#include "budget.h"
+
+#include <cstddef>
+
+namespace GiNaC {
+
+struct parallel_control;
+
+/** A unit of work for parallel_for(). */
+struct parallel_task {
+	parallel_task() : control(0) {}
+	virtual ~parallel_task() {}
+	virtual void operator()(size_t i) = 0;
+
+	/** Skip the calls of the running parallel_for() which have not started
+	 *  yet, e.g. because one call found a result which makes the others
+	 *  useless. Calls running in other threads are not interrupted. May
+	 *  only be called from operator(). */
+	void cancel();
+
+private:
+	friend void parallel_for(size_t n, parallel_task & task);
+	parallel_control * control;  ///< state of the running parallel_for()
+};
+
+/** Number of threads parallel_for() would use for n calls, at most
+ *  max_threads(). This is 1 if the library was not built with
+ *  GINAC_THREAD_SAFE_REFCOUNT, and in calls from a task of parallel_for(),
+ *  so that nested parallel algorithms run serially instead of starting
+ *  more threads. */
+unsigned parallel_threads(size_t n);
+
+/** Call task(i) for i = 0, ..., n-1, distributing the calls over the
+ *  calling thread and the threads of a pool shared by the library. The
+ *  calls must be independent of each other. If any of them throws, the
+ *  calls which have not started yet are skipped and the first exception
+ *  is rethrown in the calling thread after the others have finished. */
+void parallel_for(size_t n, parallel_task & task);
+
+/** The innermost computation_budget of the calling thread, or 0. */
+const computation_budget * current_budget();
+
+/** Make b the innermost budget of the calling thread and return the
+ *  previous one. parallel_for() uses this to let its tasks see the budget
+ *  of the caller. */
+const computation_budget * adopt_budget(const computation_budget * b);
+
+/** Check whether all numbers in an expression may be read by several
+ *  threads at once. CLN does not reference count its heap-allocated
+ *  numbers atomically, so this is only true if all numerics are integers
+ *  small enough to be stored immediately. */
+bool numerics_are_immediate(const ex & e);
+
+/** Same as numerics_are_immediate(const ex &), but for the terms and the
+ *  overall coefficient of an expairseq. */
+bool numerics_are_immediate(const epvector & v, const ex & oc);
+
+/** Fill in the caches of e and its subexpressions which are otherwise
+ *  filled in on first use (the hash values, the symbol masks and the
+ *  metrics), so that the tasks of a parallel_for() which share e only
+ *  read them. */
+void prepare_for_threads(const ex & e);
+
+/** Same as prepare_for_threads(const ex &), for all elements of v. */
+void prepare_for_threads(const exvector & v);
+
+/** Same as prepare_for_threads(const ex &), for the terms and the overall
+ *  coefficient of an expairseq. */
+void prepare_for_threads(const epvector & v, const ex & oc);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_PARALLEL_H
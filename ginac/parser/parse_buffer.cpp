@@ -0,0 +1,685 @@
+/** @file parse_buffer.cpp
+ *
+ *  Single pass parser for large expressions held in memory. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "parser.h"
+#include "add.h"
+#include "constant.h"
+#include "lst.h"
+#include "mapped_file.h"
+#include "mul.h"
+#include "numeric.h"
+#include "operators.h"
+#include "parallel.h"
+#include "power.h"
+#include "utils.h"
+
+#include <cln/complex.h>
+#include <cln/integer_io.h>
+#include <cctype>
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+#include <mutex>
+#endif
+
+namespace GiNaC {
+
+extern ex dispatch_reader_fcn(const reader_func ptr, const exvector& args);
+extern const numeric* _num_1_p;
+
+namespace {
+
+/// Name of an identifier, pointing into the input.
+struct name_ref
+{
+	const char* p;
+	std::size_t n;
+	bool operator==(const name_ref& other) const
+	{
+		return n == other.n && std::memcmp(p, other.p, n) == 0;
+	}
+};
+
+struct name_ref_hash
+{
+	std::size_t operator()(const name_ref& r) const
+	{
+		// FNV-1a
+		std::size_t h = 2166136261u;
+		for (std::size_t i = 0; i < r.n; ++i)
+			h = (h ^ (unsigned char)r.p[i]) * 16777619u;
+		return h;
+	}
+};
+
+/// The parser's symbol table, shared by the threads parsing one input.
+class shared_symtab
+{
+public:
+	shared_symtab(symtab& syms_, bool strict_) : syms(syms_), strict(strict_) { }
+
+	ex find(const std::string& name)
+	{
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+		std::lock_guard<std::mutex> lock(mutex);
+#endif
+		// The threads share the symbols, so they must only read their caches
+		const ex s = find_or_insert_symbol(name, syms, strict);
+		prepare_for_threads(s);
+		return s;
+	}
+
+private:
+	symtab& syms;
+	const bool strict;
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	std::mutex mutex;
+#endif
+};
+
+/**
+ * Recursive descent parser working on the characters directly:
+ *
+ *   sum:     term (('+' | '-') term)*
+ *   term:    factor (('*' | '/') factor)*
+ *   factor:  ('+' | '-')* primary ['^' ('+' | '-')* primary]
+ *   primary: number | identifier | identifier '(' sum (',' sum)* ')' |
+ *            '(' sum ')' | '{' sum (',' sum)* '}'
+ *
+ * Each term is collected as a pair of its non-numeric factors and its
+ * numeric coefficient, and a sum becomes one add object built from these
+ * pairs, so no intermediate sums are evaluated.
+ */
+class buffer_parser
+{
+public:
+	/// Parse [begin_, end_), which is part of the input starting at
+	/// origin_ (for the positions in error messages).
+	buffer_parser(const char* origin_, const char* begin_, const char* end_,
+	              shared_symtab& syms_, const prototype_table& funcs_)
+	  : origin(origin_), end(end_), p(begin_), syms(syms_), funcs(funcs_)
+	{
+		add_name("I", I);
+		add_name("Pi", Pi);
+		add_name("Euler", Euler);
+		add_name("Catalan", Catalan);
+	}
+
+	ex parse()
+	{
+		ex e = parse_sum();
+		expect_end();
+		return e;
+	}
+
+	/// Parse the terms of a sum up to the end.
+	void parse_terms(epvector& seq, numeric& oc)
+	{
+		parse_terms_to(seq, oc);
+		expect_end();
+	}
+
+	/// Parse comma separated expressions up to the end.
+	void parse_items(exvector& items)
+	{
+		while (true) {
+			items.push_back(parse_sum());
+			skip();
+			if (p == end)
+				break;
+			if (*p != ',')
+				throw error("expected ','");
+			++p; // eat ,
+		}
+	}
+
+	/// Use an imaginary unit of its own, so that no CLN number is shared
+	/// with other threads (CLN does not count references atomically).
+	void use_private_numbers()
+	{
+		name_ref r = { "I", 1 };
+		names[r] = numeric(cln::complex(cln::cl_I(0), cln::cl_I(1)));
+	}
+
+private:
+	ex parse_sum();
+	void parse_terms_to(epvector& seq, numeric& oc);
+	void parse_term(epvector& seq, numeric& oc, bool negate);
+	ex parse_factor(numeric& c);
+	ex parse_primary();
+	ex parse_number();
+	ex parse_identifier();
+
+	void add_name(const char* name, const ex& e)
+	{
+		name_ref r = { name, std::strlen(name) };
+		names.insert(std::make_pair(r, e));
+	}
+
+	/// Skip whitespace and comments.
+	void skip()
+	{
+		while (p != end) {
+			if (std::isspace((unsigned char)*p))
+				++p;
+			else if (*p == '#') {
+				while (p != end && *p != '\n' && *p != '\r')
+					++p;
+			} else
+				break;
+		}
+	}
+
+	/// Skip the signs in front of a factor, return true if the factor
+	/// has to be negated.
+	bool skip_signs()
+	{
+		bool negative = false;
+		skip();
+		while (p != end && (*p == '+' || *p == '-')) {
+			if (*p == '-')
+				negative = !negative;
+			++p;
+			skip();
+		}
+		return negative;
+	}
+
+	void expect_end()
+	{
+		skip();
+		if (p != end)
+			throw error("expected end of input");
+	}
+
+	/// Make the exception for an error at the current position.
+	parse_error error(const std::string& what) const
+	{
+		std::size_t line = 0;
+		const char* line_start = origin;
+		for (const char* q = origin; q != p; ++q) {
+			if (*q == '\n') {
+				++line;
+				line_start = q + 1;
+			}
+		}
+		std::size_t column = p - line_start;
+		std::ostringstream err;
+		err << "GiNaC: parse error at line " << line << ", column "
+		    << column << ": " << what;
+		if (p != end)
+			err << ", got: \"" << *p << "\"";
+		else
+			err << ", got: EOF";
+		return parse_error(err.str(), line, column);
+	}
+
+	const char* const origin;
+	const char* const end;
+	const char* p; ///< current position
+	shared_symtab& syms;
+	const prototype_table& funcs;
+	/// identifiers seen so far (and the literals)
+	std::unordered_map<name_ref, ex, name_ref_hash> names;
+};
+
+/// sum: term (('+' | '-') term)*
+ex buffer_parser::parse_sum()
+{
+	epvector seq;
+	numeric oc;
+	parse_terms_to(seq, oc);
+
+	if (seq.empty())
+		return oc;
+	if (seq.size() == 1 && oc.is_zero() && seq[0].coeff.is_equal(_ex1))
+		return seq[0].rest;
+	return (new add(seq, oc))->setflag(status_flags::dynallocated);
+}
+
+void buffer_parser::parse_terms_to(epvector& seq, numeric& oc)
+{
+	bool negate = false;
+	while (true) {
+		parse_term(seq, oc, negate);
+		skip();
+		if (p == end || (*p != '+' && *p != '-'))
+			break;
+		negate = *p++ == '-';
+	}
+}
+
+/// term: factor (('*' | '/') factor)*
+void buffer_parser::parse_term(epvector& seq, numeric& oc, bool negate)
+{
+	numeric c = negate ? *_num_1_p : numeric(1);
+	exvector factors;
+	char op = '*';
+	while (true) {
+		ex f = parse_factor(c);
+		if (is_exactly_a<numeric>(f)) {
+			if (op == '*')
+				c = c.mul(ex_to<numeric>(f));
+			else
+				c = c.div(ex_to<numeric>(f));
+		} else if (op == '*')
+			factors.push_back(f);
+		else
+			factors.push_back(pow(f, *_num_1_p));
+
+		skip();
+		if (p == end || (*p != '*' && *p != '/'))
+			break;
+		op = *p++;
+	}
+
+	if (c.is_zero())
+		return;
+	if (factors.empty()) {
+		oc = oc.add(c);
+		return;
+	}
+
+	ex rest;
+	if (factors.size() == 1)
+		rest = factors[0];
+	else
+		rest = (new mul(factors))->setflag(status_flags::dynallocated);
+
+	// The product may have become a number, or a product with a
+	// numeric coefficient, which belongs into c.
+	if (is_exactly_a<numeric>(rest)) {
+		oc = oc.add(c.mul(ex_to<numeric>(rest)));
+		return;
+	}
+	if (is_exactly_a<mul>(rest)) {
+		const ex& last = rest.op(rest.nops() - 1);
+		if (is_exactly_a<numeric>(last)) {
+			const numeric& coeff = ex_to<numeric>(last);
+			c = c.mul(coeff);
+			rest = (new mul(rest, coeff.inverse()))->setflag(status_flags::dynallocated);
+		}
+	}
+	seq.push_back(expair(rest, c));
+}
+
+/// factor: ('+' | '-')* primary ['^' ('+' | '-')* primary]
+ex buffer_parser::parse_factor(numeric& c)
+{
+	if (skip_signs())
+		c = c.mul(*_num_1_p);
+	ex b = parse_primary();
+	skip();
+	if (p == end || *p != '^')
+		return b;
+
+	++p; // eat ^
+	bool negative = skip_signs();
+	ex e = parse_primary();
+	if (negative)
+		e = -e;
+	skip();
+	if (p != end && *p == '^')
+		throw error("power should have exactly 2 operands");
+	return pow(b, e);
+}
+
+ex buffer_parser::parse_primary()
+{
+	skip();
+	if (p == end)
+		throw error("unexpected end of input");
+
+	unsigned char ch = *p;
+	if (std::isdigit(ch) || ch == '.')
+		return parse_number();
+	if (std::isalpha(ch))
+		return parse_identifier();
+
+	if (ch == '(') {
+		++p; // eat (
+		ex e = parse_sum();
+		skip();
+		if (p == end || *p != ')')
+			throw error("expected ')'");
+		++p; // eat )
+		return e;
+	}
+
+	if (ch == '{') {
+		++p; // eat {
+		lst list;
+		skip();
+		if (p != end && *p == '}') {
+			++p;
+			return list;
+		}
+		while (true) {
+			list.append(parse_sum());
+			skip();
+			if (p != end && *p == '}')
+				break;
+			if (p == end || *p != ',')
+				throw error("expected '}'");
+			++p; // eat ,
+		}
+		++p; // eat }
+		return list;
+	}
+
+	throw error("unexpected token");
+}
+
+/// number: [0-9.]+ ([eE] [+-]? [0-9]*)?, the same syntax as the lexer
+ex buffer_parser::parse_number()
+{
+	const char* start = p;
+	bool integer = true;
+	while (p != end && (std::isdigit((unsigned char)*p) || *p == '.')) {
+		if (*p == '.')
+			integer = false;
+		++p;
+	}
+	const std::size_t len = p - start;
+
+	if (p == end || (*p != 'e' && *p != 'E')) {
+		if (integer) {
+			if (len <= 9) {
+				long v = 0;
+				for (const char* q = start; q != p; ++q)
+					v = 10*v + (*q - '0');
+				return numeric(v);
+			}
+			return numeric(cln::read_integer(10, 0, start, 0, len));
+		}
+		return numeric(std::string(start, len).c_str());
+	}
+
+	// Exponent, normalized like in the lexer
+	std::string s(start, len);
+	s += 'E';
+	++p; // eat E
+	if (p != end && std::isdigit((unsigned char)*p))
+		s += '+';
+	if (p != end)
+		s += *p++;
+	while (p != end && std::isdigit((unsigned char)*p))
+		s += *p++;
+	return numeric(s.c_str());
+}
+
+/// identifier: [a-zA-Z][a-zA-Z0-9_]*, possibly followed by an argument list
+ex buffer_parser::parse_identifier()
+{
+	name_ref name = { p, 0 };
+	++p;
+	while (p != end && (std::isalnum((unsigned char)*p) || *p == '_'))
+		++p;
+	name.n = p - name.p;
+
+	skip();
+	if (p == end || *p != '(') {
+		std::unordered_map<name_ref, ex, name_ref_hash>::const_iterator i = names.find(name);
+		if (i != names.end())
+			return i->second;
+		ex sym = syms.find(std::string(name.p, name.n));
+		names.insert(std::make_pair(name, sym));
+		return sym;
+	}
+
+	// function/ctor call
+	++p; // eat (
+	exvector args;
+	skip();
+	if (p != end && *p == ')')
+		++p;
+	else {
+		while (true) {
+			args.push_back(parse_sum());
+			skip();
+			if (p != end && *p == ')')
+				break;
+			if (p == end || *p != ',')
+				throw error("expected ')' or ',' in argument list");
+			++p; // eat ,
+		}
+		++p; // eat )
+	}
+
+	const prototype the_prototype(std::string(name.p, name.n), args.size());
+	reader_func reader = find_reader(funcs, the_prototype);
+	if (reader == 0) {
+		std::ostringstream msg;
+		msg << "no function \"" << the_prototype.first << "\" with "
+		    << args.size() << " arguments";
+		throw error(msg.str());
+	}
+	return dispatch_reader_fcn(reader, args);
+}
+
+/** Find the places where a large input can be split into pieces that can
+ *  be parsed independently: the signs between the terms of a sum, or the
+ *  commas between the elements of a list. Only the tokens and the nesting
+ *  of brackets are looked at. The pieces are at least target characters
+ *  long. Returns false if the input cannot be split.
+ *
+ *  For a sum, the pieces are [starts[i], stops[i]) and start with the sign
+ *  of their first term; for a list they lie between the commas. */
+bool split_input(const char* begin, const char* end, std::size_t target,
+                 std::vector<const char*>& starts,
+                 std::vector<const char*>& stops, bool& is_list)
+{
+	std::vector<const char*> sum_cuts, list_cuts;
+	const char* last_sum_cut = begin;
+	const char* last_list_cut = begin;
+	const char* list_begin = 0; // after the opening brace of a list
+	const char* list_end = 0;   // at its closing brace
+	bool list_valid = false;
+	int depth = 0;
+	bool operand = false; // the last token ends an operand
+	bool seen = false;    // any token seen yet
+
+	const char* p = begin;
+	while (p != end) {
+		const unsigned char ch = *p;
+		if (std::isspace(ch)) {
+			++p;
+			continue;
+		}
+		if (ch == '#') {
+			while (p != end && *p != '\n' && *p != '\r')
+				++p;
+			continue;
+		}
+		if (list_end)
+			list_valid = false; // something after the list
+		const bool first = !seen;
+		seen = true;
+		if (std::isalpha(ch)) {
+			++p;
+			while (p != end && (std::isalnum((unsigned char)*p) || *p == '_'))
+				++p;
+			operand = true;
+			continue;
+		}
+		if (std::isdigit(ch) || ch == '.') {
+			while (p != end && (std::isdigit((unsigned char)*p) || *p == '.'))
+				++p;
+			if (p != end && (*p == 'e' || *p == 'E')) {
+				// the lexer takes the character after E in any case
+				if (++p != end)
+					++p;
+				while (p != end && std::isdigit((unsigned char)*p))
+					++p;
+			}
+			operand = true;
+			continue;
+		}
+
+		switch (ch) {
+		case '(':
+		case '{':
+			if (ch == '{' && first) {
+				list_begin = p + 1;
+				last_list_cut = list_begin;
+				list_valid = true;
+			}
+			++depth;
+			operand = false;
+			break;
+		case ')':
+		case '}':
+			--depth;
+			if (depth == 0 && list_begin && !list_end)
+				list_end = p;
+			operand = true;
+			break;
+		case '+':
+		case '-':
+			if (depth == 0 && operand && std::size_t(p - last_sum_cut) >= target) {
+				sum_cuts.push_back(p);
+				last_sum_cut = p;
+			}
+			operand = false;
+			break;
+		case ',':
+			if (depth == 1 && list_begin && !list_end &&
+			    std::size_t(p - last_list_cut) >= target) {
+				list_cuts.push_back(p);
+				last_list_cut = p + 1;
+			}
+			operand = false;
+			break;
+		default:
+			operand = false;
+		}
+		++p;
+	}
+
+	is_list = list_valid && list_end && !list_cuts.empty();
+	if (is_list) {
+		starts.push_back(list_begin);
+		for (std::size_t i = 0; i < list_cuts.size(); ++i) {
+			stops.push_back(list_cuts[i]);
+			starts.push_back(list_cuts[i] + 1);
+		}
+		stops.push_back(list_end);
+		return true;
+	}
+	if (sum_cuts.empty())
+		return false;
+	starts.push_back(begin);
+	for (std::size_t i = 0; i < sum_cuts.size(); ++i) {
+		stops.push_back(sum_cuts[i]);
+		starts.push_back(sum_cuts[i]);
+	}
+	stops.push_back(end);
+	return true;
+}
+
+/// Parse the pieces of a split input, each into its own part of the result.
+struct parse_pieces_task : public parallel_task {
+	parse_pieces_task(const char* origin_, const std::vector<const char*>& starts_,
+	                  const std::vector<const char*>& stops_, bool is_list_,
+	                  shared_symtab& syms_, const prototype_table& funcs_)
+	  : origin(origin_), starts(starts_), stops(stops_), is_list(is_list_),
+	    syms(syms_), funcs(funcs_), seqs(starts_.size()), ocs(starts_.size()),
+	    items(starts_.size()) { }
+
+	void operator()(size_t i)
+	{
+		buffer_parser bp(origin, starts[i], stops[i], syms, funcs);
+		bp.use_private_numbers();
+		if (is_list)
+			bp.parse_items(items[i]);
+		else
+			bp.parse_terms(seqs[i], ocs[i]);
+	}
+
+	const char* const origin;
+	const std::vector<const char*>& starts;
+	const std::vector<const char*>& stops;
+	const bool is_list;
+	shared_symtab& syms;
+	const prototype_table& funcs;
+	std::vector<epvector> seqs;
+	std::vector<numeric> ocs;
+	std::vector<exvector> items;
+};
+
+/// Inputs shorter than this are always parsed in one piece.
+const std::size_t min_piece_size = 1 << 16;
+
+} // anonymous namespace
+
+ex parser::parse_buffer(const char* begin, const char* end)
+{
+	shared_symtab table(syms, strict);
+
+	const std::size_t length = end - begin;
+	const unsigned nthreads = parallel ? parallel_threads(length / min_piece_size) : 1;
+	if (nthreads > 1) {
+		// A few pieces per thread, so that uneven pieces balance out
+		std::size_t target = length / (4 * nthreads);
+		if (target < min_piece_size)
+			target = min_piece_size;
+		std::vector<const char*> starts, stops;
+		bool is_list;
+		if (split_input(begin, end, target, starts, stops, is_list)) {
+			parse_pieces_task task(begin, starts, stops, is_list, table, funcs);
+			parallel_for(starts.size(), task);
+
+			if (is_list) {
+				lst result;
+				for (std::size_t i = 0; i < task.items.size(); ++i)
+					for (std::size_t j = 0; j < task.items[i].size(); ++j)
+						result.append(task.items[i][j]);
+				return result;
+			}
+
+			std::size_t nterms = 0;
+			for (std::size_t i = 0; i < task.seqs.size(); ++i)
+				nterms += task.seqs[i].size();
+			epvector seq;
+			seq.reserve(nterms);
+			numeric oc;
+			for (std::size_t i = 0; i < task.seqs.size(); ++i) {
+				seq.insert(seq.end(), task.seqs[i].begin(), task.seqs[i].end());
+				oc = oc.add(task.ocs[i]);
+			}
+			return (new add(seq, oc))->setflag(status_flags::dynallocated);
+		}
+	}
+
+	buffer_parser bp(begin, begin, end, table, funcs);
+	return bp.parse();
+}
+
+ex parser::parse_file(const std::string& filename)
+{
+	mapped_file f(filename);
+	return parse_buffer(f.data(), f.data() + f.size());
+}
+
+} // namespace GiNaC
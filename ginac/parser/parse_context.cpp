@@ -44,4 +44,18 @@ find_or_insert_symbol(const std::string& name, symtab& syms, const bool strict)
 	return sy;
 }
 
+reader_func find_reader(const prototype_table& funcs, const prototype& key)
+{
+	prototype_table::const_iterator p = funcs.find(key);
+	if (p != funcs.end())
+		return p->second;
+	if (key.second == 0)
+		return 0;
+
+	p = funcs.find(prototype(key.first, 0));
+	if (p != funcs.end())
+		return p->second;
+	return 0;
+}
+
 } // namespace GiNaC
@@ -27,8 +27,10 @@
 #include "symbol.h"
 
 #include <cstddef> // for size_t
+#include <functional>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <utility>
 
 namespace GiNaC {
@@ -37,8 +39,10 @@ namespace GiNaC {
  * Establishes correspondence between the strings and expressions.
  * The parser will create missing symbols (if not instructed otherwise,
  * in which case it fails if the expression contains unknown symbols).
+ * It is a hash table, so every identifier in the input costs one hash
+ * computation instead of string comparisons along a tree.
  */
-typedef std::map<std::string, ex> symtab;
+typedef std::unordered_map<std::string, ex> symtab;
 
 /**
  * Find the symbol (or abbreviation) with the @a name in the symbol table @a syms.
@@ -87,6 +91,32 @@ typedef ex (*reader_func)(const exvector& args);
  *       value of type reader_func is internally treated as an unsigned and not as a
  *       function pointer!! The unsigned has to correspond to the serial number of
  *       the defined GiNaC function.
+ *
+ * A reader registered with 0 arguments accepts any number of them, unless
+ * there is a reader with the same name for the actual number of arguments
+ * (see find_reader()).
+ */
+class PrototypeHash
+{
+public:
+	std::size_t operator()(const prototype& p) const
+	{
+		return std::hash<std::string>()(p.first) ^ (p.second * 0x9e3779b9u);
+	}
+};
+typedef std::unordered_map<prototype, reader_func, PrototypeHash> prototype_table;
+
+/**
+ * Find the reader for a call of the function @a key.first with @a key.second
+ * arguments in the table @a funcs, falling back to a reader for any number
+ * of arguments. Returns 0 if there is no such reader.
+ */
+extern reader_func find_reader(const prototype_table& funcs, const prototype& key);
+
+/**
+ * Ordering of prototypes for a map of readers, where a prototype with 0
+ * arguments is equivalent to the prototypes with the same name and any
+ * number of arguments. The parser uses the hashed prototype_table.
  */
 class PrototypeLess
 {
@@ -101,7 +131,6 @@ public:
 		return s < 0;
 	}
 };
-typedef std::map<prototype, reader_func, PrototypeLess> prototype_table;
 
 /**
  * Default prototype table.
@@ -36,6 +36,7 @@
 #endif
 #include <sstream>
 #include <stdexcept>
+#include <utility>
 
 namespace GiNaC {
 
@@ -57,7 +58,7 @@ static bool decode_serial(unsigned& serial, const reader_func ptr)
 // Figures out if ptr is a pointer to function or a serial of GiNaC function.
 // In the former case calls that function, in the latter case constructs
 // GiNaC function with corresponding serial and arguments.
-static ex dispatch_reader_fcn(const reader_func ptr, const exvector& args)
+ex dispatch_reader_fcn(const reader_func ptr, const exvector& args)
 {
 	unsigned serial = 0; // dear gcc, could you please shut up?
 	bool is_ptr = decode_serial(serial, ptr);
@@ -72,13 +73,17 @@ static ex dispatch_reader_fcn(const reader_func ptr, const exvector& args)
 /// identifier_expr:  identifier |  identifier '(' expression* ')'
 ex parser::parse_identifier_expr()
 {
-	std::string name = scanner->str;
+	// Take over the scanner's string instead of copying it, so that
+	// identifiers don't cost a memory allocation each.
+	ident.swap(scanner->str);
 	get_next_tok();  // eat identifier.
 
 	if (token != '(') // symbol
-		return find_or_insert_symbol(name, syms, strict);
+		return find_or_insert_symbol(ident, syms, strict);
 
 	// function/ctor call.
+	std::string name;
+	name.swap(ident);  // the arguments may contain identifiers
 	get_next_tok();  // eat (
 	exvector args;
 	if (token != ')') {
@@ -97,15 +102,15 @@ ex parser::parse_identifier_expr()
 	}
 	// Eat the ')'.
 	get_next_tok();
-	prototype the_prototype = make_pair(name, args.size());
-	prototype_table::const_iterator reader = funcs.find(the_prototype);
-	if (reader == funcs.end()) {
-		Parse_error_("no function \"" << name << "\" with " <<
+	const prototype the_prototype(std::move(name), args.size());
+	reader_func reader = find_reader(funcs, the_prototype);
+	if (reader == 0) {
+		Parse_error_("no function \"" << the_prototype.first << "\" with " <<
 			     args.size() << " arguments");
 	}
-	// reader->second might be a pointer to a C++ function or a specially
+	// reader might be a pointer to a C++ function or a specially
 	// crafted serial of a GiNaC::function.
-	ex ret = dispatch_reader_fcn(reader->second, args);
+	ex ret = dispatch_reader_fcn(reader, args);
 	return ret;
 }
 
@@ -254,7 +259,7 @@ int parser::get_next_tok()
 
 parser::parser(const symtab& syms_, const bool strict_,
 	       const prototype_table& funcs_) : strict(strict_),
-	funcs(funcs_), syms(syms_)
+	parallel(false), funcs(funcs_), syms(syms_)
 {
 	scanner = new lexer();
 }
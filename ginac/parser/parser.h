@@ -96,6 +96,19 @@ public:
 	/// parse the string @a input
 	ex operator()(const std::string& input);
 
+	/**
+	 * Parse the characters in [@a begin, @a end) in one pass, without
+	 * the token stream: sums and products are collected into a single
+	 * add or mul object, integers are read by CLN directly, and the
+	 * symbols are looked up in a hash table. A sign in front of a
+	 * factor applies to that factor only, so a*-b+c is (-a*b)+c.
+	 * With @a parallel set, large sums and lists are split into pieces
+	 * which are parsed on several threads.
+	 */
+	ex parse_buffer(const char* begin, const char* end);
+	/// parse the contents of the file @a filename with parse_buffer()
+	ex parse_file(const std::string& filename);
+
 	/// report the symbol table used by parser
 	symtab get_syms() const 
 	{ 
@@ -109,6 +122,9 @@ public:
 
 	/// If true, throw an exception if an unknown symbol is encountered.
 	bool strict;
+	/// If true, parse_buffer() and parse_file() parse large sums and
+	/// lists on several threads.
+	bool parallel;
 private:
 	/**
 	 * Function/ctor table, maps a prototype (which is a name and number
@@ -126,6 +142,8 @@ private:
 	symtab syms;
 	/// token scanner
 	lexer* scanner;
+	/// name of the identifier being parsed
+	std::string ident;
 	/// current token the parser is looking at
 	int token;
 	/// read the next token from the scanner
@@ -27,7 +27,13 @@
 
 namespace GiNaC {
 
-extern ex chinrem_gcd(const ex& A_, const ex& B_, const exvector& vars);
+/**
+ * GCD of multivariate polynomials A_ and B_ with the variables vars by the
+ * modular algorithm. Of the gcd_options, parallel and use_sparse_interp
+ * are taken into account.
+ */
+extern ex chinrem_gcd(const ex& A_, const ex& B_, const exvector& vars,
+		      const unsigned options = 0);
 extern ex chinrem_gcd(const ex& A, const ex& B);
 
 struct chinrem_gcd_failed
@@ -24,6 +24,8 @@
 #include "mul.h"
 #include "operators.h"
 #include "power.h"
+#include "numeric.h"
+#include "utils.h"
 #include "collect_vargs.h"
 #include "smod_helpers.h"
 #include "debug.h"
@@ -31,111 +33,193 @@
 #include <algorithm>
 #include <cln/integer.h>
 #include <iterator>
-#include <map>
+#include <vector>
 #include <stdexcept>
 #include <string>
 
 namespace GiNaC {
 
-typedef std::map<exp_vector_t, ex> ex_collect_priv_t;
+namespace {
 
-static void 
-collect_vargs(ex_collect_priv_t& ec, ex e, const exvector& vars);
-static void
-collect_term(ex_collect_priv_t& ec, const ex& e, const exvector& vars);
-static void wipe_out_zeros(ex_collect_priv_t& ec);
+/** Terms of an expanded polynomial, split into exponent vectors (stored
+ *  flat, one row of vars.size() entries per term) and coefficients. */
+struct split_terms {
+	std::vector<int> exponents;
+	exvector coeffs;
+};
 
-template<typename T, typename CoeffCMP>
-struct compare_terms
+/** Index of the variable x in vars, or vars.size(). */
+std::size_t var_index(const ex& x, const exvector& vars)
 {
-	const CoeffCMP& coeff_cmp;
-	explicit compare_terms(const CoeffCMP& coeff_cmp_) : coeff_cmp(coeff_cmp_)
-	{ }
-	inline bool operator()(const T& t1, const T& t2) const
-	{
-		bool exponent_is_less =
-			std::lexicographical_compare(t1.first.rbegin(),
-						     t1.first.rend(),
-						     t2.first.rbegin(),
-						     t2.first.rend());
-		if (exponent_is_less)
-			return true;
+	for (std::size_t i = 0; i < vars.size(); ++i)
+		if (x.is_equal(vars[i]))
+			return i;
+	return vars.size();
+}
 
-		if ((t1.first == t2.first) &&
-				coeff_cmp(t2.second, t2.second))
+/** True if e contains any of the variables. */
+bool has_any_var(const ex& e, const exvector& vars)
+{
+	for (exvector::const_iterator i = vars.begin(); i != vars.end(); ++i)
+		if (e.has(*i))
 			return true;
+	return false;
+}
+
+/** Orders the rows of the flat exponent array like operator< orders
+ *  exp_vector_t, i.e. comparing the last variable first. */
+struct exponent_order
+{
+	const int* exps;
+	std::size_t n;
+	exponent_order(const int* exps_, std::size_t n_) : exps(exps_), n(n_) { }
+	bool operator()(const std::pair<unsigned long long, std::size_t>& a,
+			const std::pair<unsigned long long, std::size_t>& b) const
+	{
+		const int* const ra = exps + a.second*n;
+		const int* const rb = exps + b.second*n;
+		for (std::size_t i = n; i-- > 0; )
+			if (ra[i] != rb[i])
+				return ra[i] < rb[i];
 		return false;
 	}
 };
 
-template<typename T, typename CoeffCMP>
-static compare_terms<T, CoeffCMP>
-make_compare_terms(const T& dummy, const CoeffCMP& coeff_cmp)
-{
-	return compare_terms<T, CoeffCMP>(coeff_cmp);
-}
-
-void collect_vargs(ex_collect_t& ec, const ex& e, const exvector& vars)
+/** Exponents of the variables in a factor of a monomial: true if the factor
+ *  is a variable or a positive integer power of one. */
+bool var_power(const ex& f, const exvector& vars, std::size_t& index, int& exponent)
 {
-	ex_collect_priv_t ecp;
-	collect_vargs(ecp, e, vars);
-	ec.reserve(ecp.size());
-	std::copy(ecp.begin(), ecp.end(), std::back_inserter(ec));
-	std::sort(ec.begin(), ec.end(),
-		  make_compare_terms(*ec.begin(), ex_is_less()));
+	if (is_a<power>(f)) {
+		const ex& e = f.op(1);
+		if (!e.info(info_flags::posint))
+			return false;
+		index = var_index(f.op(0), vars);
+		exponent = ex_to<numeric>(e).to_int();
+	} else {
+		index = var_index(f, vars);
+		exponent = 1;
+	}
+	return index < vars.size();
 }
 
-static void 
-collect_vargs(ex_collect_priv_t& ec, ex e, const exvector& vars)
+/** Split the term e into its exponents and coefficient. Factors are taken
+ *  apart directly; terms of other shapes go through degree() and coeff(). */
+void split_term(split_terms& st, const ex& e, const exvector& vars)
 {
-	e = e.expand();
-	if (e.is_zero()) {
-		ec.clear();
+	if (e.is_zero())
 		return;
-	}
+	const std::size_t n = vars.size();
+	const std::size_t row = st.exponents.size();
+	st.exponents.resize(row + n, 0);
 
-	if (!is_a<add>(e)) {
-		collect_term(ec, e, vars);
+	std::size_t index;
+	int exponent;
+	if (is_a<mul>(e)) {
+		exvector rest;
+		bool plain = true;
+		for (std::size_t i = 0; i < e.nops() && plain; ++i) {
+			const ex& f = e.op(i);
+			if (var_power(f, vars, index, exponent))
+				st.exponents[row + index] += exponent;
+			else if (has_any_var(f, vars))
+				plain = false;
+			else
+				rest.push_back(f);
+		}
+		if (plain) {
+			if (rest.empty())
+				st.coeffs.push_back(_ex1);
+			else if (rest.size() == 1)
+				st.coeffs.push_back(rest[0]);
+			else
+				st.coeffs.push_back((new mul(rest))->setflag(status_flags::dynallocated));
+			return;
+		}
+		std::fill(st.exponents.begin() + row, st.exponents.end(), 0);
+	} else if (var_power(e, vars, index, exponent)) {
+		st.exponents[row + index] = exponent;
+		st.coeffs.push_back(_ex1);
+		return;
+	} else if (!has_any_var(e, vars)) {
+		st.coeffs.push_back(e);
 		return;
 	}
 
-	for (const_iterator i = e.begin(); i != e.end(); ++i)
-		collect_term(ec, *i, vars);
-
-	wipe_out_zeros(ec);
+	ex pre_coeff = e;
+	for (std::size_t i = 0; i < n; ++i) {
+		const int var_i_pow = pre_coeff.degree(vars[i]);
+		st.exponents[row + i] = var_i_pow;
+		pre_coeff = pre_coeff.coeff(vars[i], var_i_pow);
+	}
+	st.coeffs.push_back(pre_coeff);
 }
 
-static void
-collect_term(ex_collect_priv_t& ec, const ex& e, const exvector& vars)
+} // anonymous namespace
+
+void collect_vargs(ex_collect_t& ec, const ex& e_, const exvector& vars)
 {
+	ec.clear();
+	const ex e = e_.expand();
 	if (e.is_zero())
 		return;
-	static const ex ex1(1);
-	exp_vector_t key(vars.size());
-	ex pre_coeff = e;
-	for (std::size_t i = 0; i < vars.size(); ++i) {
-		const int var_i_pow = pre_coeff.degree(vars[i]);
-		key[i] = var_i_pow;
-		pre_coeff = pre_coeff.coeff(vars[i], var_i_pow);
+
+	split_terms st;
+	if (is_a<add>(e)) {
+		st.coeffs.reserve(e.nops());
+		st.exponents.reserve(e.nops() * vars.size());
+		for (const_iterator i = e.begin(); i != e.end(); ++i)
+			split_term(st, *i, vars);
+	} else
+		split_term(st, e, vars);
+	const std::size_t n = vars.size(), terms = st.coeffs.size();
+
+	// Pack the exponent vectors into one word each if they fit, with the
+	// last variable in the highest bits, so that comparing the words
+	// orders them like operator< on exp_vector_t
+	std::vector<unsigned> bits(n, 0);
+	unsigned total_bits = 0;
+	bool packable = true;
+	for (std::size_t i = 0; i < n && packable; ++i) {
+		int maxdeg = 0;
+		for (std::size_t t = 0; t < terms; ++t) {
+			const int d = st.exponents[t*n + i];
+			if (d < 0)
+				packable = false;
+			maxdeg = std::max(maxdeg, d);
+		}
+		while (maxdeg >> bits[i])
+			++bits[i];
+		total_bits += bits[i];
+	}
+	packable = packable && total_bits <= 64;
+
+	std::vector<std::pair<unsigned long long, std::size_t> > order(terms);
+	for (std::size_t t = 0; t < terms; ++t) {
+		unsigned long long key = 0;
+		if (packable)
+			for (std::size_t i = n; i-- > 0; )
+				key = (key << bits[i]) | (unsigned long long)st.exponents[t*n + i];
+		order[t] = std::make_pair(key, t);
 	}
-	ex_collect_priv_t::iterator i = ec.find(key);
-	if (i != ec.end())
-		i->second += pre_coeff;
+	const int* const exps = st.exponents.empty() ? 0 : &st.exponents[0];
+	if (packable)
+		std::sort(order.begin(), order.end());
 	else
-		ec.insert(ex_collect_priv_t::value_type(key, pre_coeff));
-}
+		std::sort(order.begin(), order.end(), exponent_order(exps, n));
 
-static void wipe_out_zeros(ex_collect_priv_t& m)
-{
-	ex_collect_priv_t::iterator i = m.begin();
-	while (i != m.end()) {
-		// be careful to not invalide iterator, use post-increment
-		// for that, see e.g.
-		// http://coding.derkeiler.com/Archive/C_CPP/comp.lang.cpp/2004-02/0502.html
-		if (i->second.is_zero())
-			m.erase(i++);
-		else
-			++i;
+	// Merge the terms with equal exponents, dropping zero sums
+	exvector sum;
+	for (std::size_t k = 0; k < terms; ) {
+		const std::size_t t = order[k].second;
+		const int* const key = exps + t*n;
+		sum.clear();
+		std::size_t l = k;
+		for (; l < terms && std::equal(key, key + n, exps + order[l].second*n); ++l)
+			sum.push_back(st.coeffs[order[l].second]);
+		const ex c = sum.size() == 1 ? sum[0] : ex((new add(sum))->setflag(status_flags::dynallocated));
+		if (!c.is_zero())
+			ec.push_back(std::make_pair(exp_vector_t(key, key + n), c));
+		k = l;
 	}
 }
 
@@ -179,14 +263,11 @@ ex lcoeff_wrt(ex e, const exvector& x)
 
 exp_vector_t degree_vector(ex e, const exvector& vars)
 {
-	e = e.expand();
-	exp_vector_t dvec(vars.size());
-	for (std::size_t i = vars.size(); i-- != 0; ) {
-		const int deg_i = e.degree(vars[i]);
-		e = e.coeff(vars[i], deg_i);
-		dvec[i] = deg_i;
-	}
-	return dvec;
+	ex_collect_t ec;
+	collect_vargs(ec, e, vars);
+	if (ec.empty())
+		return exp_vector_t(vars.size());
+	return ec.rbegin()->first;
 }
 
 cln::cl_I integer_lcoeff(const ex& e, const exvector& vars)
@@ -25,6 +25,7 @@
 
 #include <cln/integer.h>
 #include <cln/modinteger.h>
+#include <cln/rational.h>
 #include <cstddef>
 #include <vector>
 
@@ -110,4 +111,101 @@ cl_I integer_cra(const vector<cl_I>& residues,
 	return result;
 }
 
+// Arithmetic modulo the word-sized moduli of garner_cra. The quotients are
+// estimated in floating point, so that the loops over many integers have
+// no divisions and compile to vector instructions.
+
+/** x mod p in [0, p), for |x| < 2^62 and pinv == 1.0/p. */
+static inline long reduce_fp(long long x, long p, double pinv)
+{
+	const long long q = (long long)(double(x)*pinv);
+	long long r = x - q*p;
+	r += r < 0 ? p : 0;
+	r += r < 0 ? p : 0;
+	r -= r >= p ? p : 0;
+	return long(r);
+}
+
+garner_cra::garner_cra(const vector<long>& moduli)
+  : m(moduli), inv(moduli.size()), m_mod(moduli.size()*moduli.size()), M(1)
+{
+	const size_t K = m.size();
+	for (size_t k = 0; k < K; ++k) {
+		const double pinv = 1.0/double(m[k]);
+		long prod = 1;
+		for (size_t j = 0; j < k; ++j) {
+			m_mod[k*K + j] = reduce_fp(m[j], m[k], pinv);
+			prod = reduce_fp((long long)prod*m_mod[k*K + j], m[k], pinv);
+		}
+		if (k > 0) {
+			cl_modint_ring R = find_modint_ring(m[k]);
+			inv[k] = cl_I_to_long(R->retract(recip(R->canonhom(prod))));
+		}
+		M = M*m[k];
+	}
+}
+
+void garner_cra::operator()(vector<cl_I>& values, const vector<long>& residues,
+			    size_t count) const
+{
+	const size_t K = m.size();
+	values.resize(count);
+	if (K == 0 || count == 0) {
+		values.assign(count, 0);
+		return;
+	}
+
+	// Mixed radix digits d_k, in the symmetric range, at [k*count + i]
+	vector<long> d(K*count), t(count);
+	for (size_t i = 0; i < count; ++i) {
+		const long r = residues[i];
+		d[i] = r > m[0]/2 ? r - m[0] : r;
+	}
+	for (size_t k = 1; k < K; ++k) {
+		const long p = m[k];
+		const double pinv = 1.0/double(p);
+		// t = d_0 + d_1 m_0 + ... + d_{k-1} m_0 ... m_{k-2} mod m_k
+		const long* dk1 = &d[(k - 1)*count];
+		for (size_t i = 0; i < count; ++i)
+			t[i] = reduce_fp(dk1[i], p, pinv);
+		for (size_t j = k - 1; j-- != 0; ) {
+			const long mj = m_mod[k*K + j];
+			const long* dj = &d[j*count];
+			for (size_t i = 0; i < count; ++i)
+				t[i] = reduce_fp((long long)t[i]*mj + dj[i], p, pinv);
+		}
+		const long ik = inv[k];
+		const long* rk = &residues[k*count];
+		long* dk = &d[k*count];
+		for (size_t i = 0; i < count; ++i) {
+			const long v = reduce_fp((long long)(rk[i] - t[i])*ik, p, pinv);
+			dk[i] = v > p/2 ? v - p : v;
+		}
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		cl_I u = d[(K - 1)*count + i];
+		for (size_t k = K - 1; k-- != 0; )
+			u = u*m[k] + d[k*count + i];
+		values[i] = u;
+	}
+}
+
+bool rational_reconstruction(const cl_I& u, const cl_I& M, cl_RA& x)
+{
+	cl_I bound;
+	isqrt(M >> 1, &bound);
+	cl_I r0 = M, r1 = mod(u, M), t0 = 0, t1 = 1;
+	while (r1 > bound) {
+		const cl_I k = floor1(r0, r1);
+		const cl_I r = r0 - k*r1, t = t0 - k*t1;
+		r0 = r1; r1 = r;
+		t0 = t1; t1 = t;
+	}
+	if (abs(t1) > bound || gcd(r1, t1) != 1)
+		return false;
+	x = cl_RA(r1) / t1;
+	return true;
+}
+
 } // namespace cln
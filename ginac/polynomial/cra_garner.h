@@ -24,6 +24,8 @@
 #define CL_INTEGER_CRA
 
 #include <cln/integer.h>
+#include <cln/rational.h>
+#include <cstddef>
 #include <vector>
 
 namespace cln {
@@ -31,6 +33,41 @@ namespace cln {
 extern cl_I integer_cra(const std::vector<cl_I>& residues,
 	                const std::vector<cl_I>& moduli);
 
+/**
+ * Garner's algorithm for many integers at once, all with the same
+ * word-sized moduli m_k (pairwise coprime, below 2^31). The constants of
+ * the algorithm are computed once, in the constructor. The mixed radix
+ * digits are computed in machine arithmetic, for all integers side by
+ * side, and only the final conversion of the digits uses CLN.
+ */
+class garner_cra {
+public:
+	explicit garner_cra(const std::vector<long>& moduli);
+
+	/** Product of the moduli. */
+	const cl_I& modulus() const { return M; }
+
+	/**
+	 * Reconstruct count integers. residues[k*count + i] in [0, m_k) is
+	 * the residue of the integer i modulo m_k. The results are in the
+	 * symmetric range (-M/2, M/2].
+	 */
+	void operator()(std::vector<cl_I>& values, const std::vector<long>& residues,
+			std::size_t count) const;
+
+private:
+	std::vector<long> m;
+	/// 1/(m_0 ... m_{k-1}) mod m_k, for k >= 1
+	std::vector<long> inv;
+	/// m_j mod m_k at [k*m.size() + j], for j < k
+	std::vector<long> m_mod;
+	cl_I M;
+};
+
+/** Fraction x with |numerator|, denominator <= sqrt(M/2) which is congruent
+ *  to u modulo M, if there is one. */
+extern bool rational_reconstruction(const cl_I& u, const cl_I& M, cl_RA& x);
+
 } // namespace cln
 
 #endif // CL_INTEGER_CRA
@@ -0,0 +1,281 @@
+/** @file half_gcd.cpp
+ *
+ *  Fast Euclidean algorithm (half-GCD) for univariate polynomials over
+ *  Z/p. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "half_gcd.h"
+#include "gcd_euclid.h"
+#include "kronecker.h"
+#include "normalize.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <cln/integer.h>
+#include <cln/modinteger.h>
+
+namespace GiNaC {
+
+const std::size_t half_gcd_threshold = 64;
+
+/// Polynomials shorter than this are multiplied by the schoolbook method.
+static const std::size_t kronecker_mul_threshold = 32;
+
+/// Below this degree hgcd() does plain Euclidean steps.
+static const long hgcd_base_degree = 32;
+
+/// Degree, -1 for the zero polynomial.
+static inline long deg(const umodpoly& p)
+{
+	return long(p.size()) - 1;
+}
+
+void mul_in_field(umodpoly& c, const umodpoly& a, const umodpoly& b)
+{
+	if (a.empty() || b.empty()) {
+		c.clear();
+		return;
+	}
+	const cln::cl_modint_ring R = a[0].ring();
+	const std::size_t shorter = std::min(a.size(), b.size());
+
+	if (shorter < kronecker_mul_threshold) {
+		umodpoly r(a.size() + b.size() - 1, R->zero());
+		for (std::size_t i = 0; i < a.size(); ++i) {
+			if (zerop(a[i]))
+				continue;
+			for (std::size_t j = 0; j < b.size(); ++j)
+				r[i + j] = r[i + j] + a[i]*b[j];
+		}
+		canonicalize(r);
+		c.swap(r);
+		return;
+	}
+
+	// The coefficients of the integer product are below
+	// shorter*(p-1)^2, so k bits per coefficient are enough to keep
+	// them apart (the unpacked digits are in the symmetric range)
+	upoly ai(a.size()), bi(b.size()), ci;
+	for (std::size_t i = a.size(); i-- != 0; )
+		ai[i] = R->retract(a[i]);
+	for (std::size_t i = b.size(); i-- != 0; )
+		bi[i] = R->retract(b[i]);
+	const unsigned k = 2*cln::integer_length(R->modulus) +
+			   cln::integer_length(cln::cl_I((unsigned long)shorter)) + 1;
+	kronecker_unpack(ci, kronecker_pack(ai, k)*kronecker_pack(bi, k), k);
+
+	c.resize(ci.size());
+	for (std::size_t i = ci.size(); i-- != 0; )
+		c[i] = R->canonhom(ci[i]);
+	canonicalize(c);
+}
+
+static void add_in_field(umodpoly& c, const umodpoly& a, const umodpoly& b)
+{
+	const umodpoly& longer = a.size() < b.size() ? b : a;
+	const umodpoly& shorter = a.size() < b.size() ? a : b;
+	umodpoly r(longer);
+	for (std::size_t i = shorter.size(); i-- != 0; )
+		r[i] = r[i] + shorter[i];
+	canonicalize(r);
+	c.swap(r);
+}
+
+static void sub_in_field(umodpoly& c, const umodpoly& a, const umodpoly& b)
+{
+	umodpoly r(a);
+	if (r.size() < b.size())
+		r.resize(b.size(), b[0].ring()->zero());
+	for (std::size_t i = b.size(); i-- != 0; )
+		r[i] = r[i] - b[i];
+	canonicalize(r);
+	c.swap(r);
+}
+
+/// Quotient and remainder of a, b \in F[x], b != 0.
+static void divrem_in_field(umodpoly& q, umodpoly& r,
+			    const umodpoly& a, const umodpoly& b)
+{
+	bug_on(b.empty(), "division by zero polynomial");
+	r = a;
+	if (a.size() < b.size()) {
+		q.clear();
+		return;
+	}
+	const cln::cl_MI lc_1 = recip(lcoeff(b));
+	q.assign(a.size() - b.size() + 1, lc_1.ring()->zero());
+	for (std::size_t k = a.size(); k-- >= b.size(); ) {
+		if (zerop(r[k]))
+			continue;
+		const cln::cl_MI qk = r[k]*lc_1;
+		q[k + 1 - b.size()] = qk;
+		for (std::size_t j = k, i = b.size(); i-- != 0; --j)
+			r[j] = r[j] - qk*b[i];
+	}
+	r.resize(b.size() - 1);
+	canonicalize(r);
+}
+
+/// p divided by x^k, dropping the remainder.
+static umodpoly shift_down(const umodpoly& p, const std::size_t k)
+{
+	if (p.size() <= k)
+		return umodpoly();
+	return umodpoly(p.begin() + k, p.end());
+}
+
+/// 2x2 matrix of polynomials, acting on pairs of remainders.
+struct matrix2 {
+	umodpoly m00, m01, m10, m11;
+};
+
+static void set_identity(matrix2& M, const cln::cl_MI& sample)
+{
+	M.m00.assign(1, the_one(sample));
+	M.m11.assign(1, the_one(sample));
+	M.m01.clear();
+	M.m10.clear();
+}
+
+/// (c, d) = M (a, b)
+static void apply(umodpoly& c, umodpoly& d, const matrix2& M,
+		  const umodpoly& a, const umodpoly& b)
+{
+	umodpoly t0, t1, c_, d_;
+	mul_in_field(t0, M.m00, a);
+	mul_in_field(t1, M.m01, b);
+	add_in_field(c_, t0, t1);
+	mul_in_field(t0, M.m10, a);
+	mul_in_field(t1, M.m11, b);
+	add_in_field(d_, t0, t1);
+	c.swap(c_);
+	d.swap(d_);
+}
+
+/// r = S T
+static void multiply(matrix2& r, const matrix2& S, const matrix2& T)
+{
+	umodpoly t0, t1;
+	matrix2 p;
+	mul_in_field(t0, S.m00, T.m00);
+	mul_in_field(t1, S.m01, T.m10);
+	add_in_field(p.m00, t0, t1);
+	mul_in_field(t0, S.m00, T.m01);
+	mul_in_field(t1, S.m01, T.m11);
+	add_in_field(p.m01, t0, t1);
+	mul_in_field(t0, S.m10, T.m00);
+	mul_in_field(t1, S.m11, T.m10);
+	add_in_field(p.m10, t0, t1);
+	mul_in_field(t0, S.m10, T.m01);
+	mul_in_field(t1, S.m11, T.m11);
+	add_in_field(p.m11, t0, t1);
+	std::swap(r, p);
+}
+
+/// M = [[0, 1], [1, -q]] M, i.e. one Euclidean step with quotient q.
+static void euclid_step(matrix2& M, const umodpoly& q)
+{
+	umodpoly t;
+	mul_in_field(t, q, M.m10);
+	sub_in_field(M.m00, M.m00, t);
+	mul_in_field(t, q, M.m11);
+	sub_in_field(M.m01, M.m01, t);
+	M.m00.swap(M.m10);
+	M.m01.swap(M.m11);
+}
+
+/**
+ * Half-GCD of a, b with deg(a) = n > deg(b): the product M of the matrices
+ * of the first Euclidean steps, such that (c, d) = M (a, b) are
+ * consecutive remainders with deg(c) >= ceil(n/2) > deg(d). Only the
+ * leading halves of a and b are needed to find the quotients, which is
+ * done by two recursive calls on polynomials of about half the degree.
+ */
+static void hgcd(matrix2& M, const umodpoly& a, const umodpoly& b)
+{
+	const long n = deg(a);
+	const long m = (n + 1)/2;
+	set_identity(M, a[0]);
+	if (deg(b) < m)
+		return;
+
+	if (n < hgcd_base_degree) {
+		umodpoly c(a), d(b), q, r;
+		while (deg(d) >= m) {
+			divrem_in_field(q, r, c, d);
+			c.swap(d);
+			d.swap(r);
+			euclid_step(M, q);
+		}
+		return;
+	}
+
+	matrix2 R;
+	hgcd(R, shift_down(a, m), shift_down(b, m));
+	umodpoly c, d;
+	apply(c, d, R, a, b);
+	if (deg(d) < m) {
+		std::swap(M, R);
+		return;
+	}
+
+	umodpoly q, r;
+	divrem_in_field(q, r, c, d);
+	euclid_step(R, q);
+	const std::size_t k = 2*m - deg(d);
+	matrix2 S;
+	hgcd(S, shift_down(d, k), shift_down(r, k));
+	multiply(M, S, R);
+}
+
+void gcd_half_gcd(umodpoly& c, umodpoly a, umodpoly b)
+{
+	if (a.empty() || b.empty()) {
+		c.clear();
+		return;
+	}
+	bug_on(a[0].ring()->modulus != b[0].ring()->modulus,
+		"different moduli");
+	if (deg(a) < deg(b))
+		a.swap(b);
+
+	umodpoly q, r;
+	while (!b.empty() && deg(b) >= long(half_gcd_threshold)) {
+		if (deg(a) > deg(b)) {
+			// Jump to the remainders of about half the degree
+			matrix2 M;
+			hgcd(M, a, b);
+			apply(a, b, M, a, b);
+			if (b.empty())
+				break;
+		}
+		divrem_in_field(q, r, a, b);
+		a.swap(b);
+		b.swap(r);
+	}
+
+	if (b.empty()) {
+		normalize_in_field(a);
+		c.swap(a);
+	} else
+		gcd_euclid(c, a, b);
+}
+
+} // namespace GiNaC
@@ -0,0 +1,54 @@
+/** @file half_gcd.h
+ *
+ *  Fast Euclidean algorithm (half-GCD) for univariate polynomials over
+ *  Z/p. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_HALF_GCD_H
+#define GINAC_HALF_GCD_H
+
+#include "upoly.h"
+
+namespace GiNaC {
+
+/** Degree of the smaller polynomial above which mod_gcd() uses
+ *  gcd_half_gcd() instead of gcd_euclid(). */
+extern const std::size_t half_gcd_threshold;
+
+/**
+ * Product of a, b \in Z/p[x]. Long polynomials are multiplied by Kronecker
+ * substitution, i.e. as (long) integers, short ones by the schoolbook
+ * method.
+ */
+extern void mul_in_field(umodpoly& c, const umodpoly& a, const umodpoly& b);
+
+/**
+ * GCD of a, b \in Z/p[x] by the half-GCD algorithm, which computes the
+ * quotients of the Euclidean remainder sequence from the leading halves
+ * of the polynomials and applies them in batches. Its cost is
+ * O(M(n) log n) instead of O(n^2) for the plain Euclidean algorithm,
+ * M(n) being the cost of a multiplication. The result is made monic.
+ * Like gcd_euclid(), the result is zero if one of the inputs is zero.
+ */
+extern void gcd_half_gcd(umodpoly& c, umodpoly a, umodpoly b);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_HALF_GCD_H
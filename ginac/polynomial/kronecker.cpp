@@ -0,0 +1,164 @@
+/** @file kronecker.cpp
+ *
+ *  Kronecker substitution for univariate integer polynomials, and the
+ *  heuristic GCD based on it. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "kronecker.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <cln/integer.h>
+
+namespace GiNaC {
+
+/** Value of a[lo] + a[lo+1]*2^k + ... + a[hi-1]*2^(k*(hi-lo-1)). The
+ *  halves are packed separately, so that most of the work is done on
+ *  short integers. */
+static cln::cl_I pack_range(const upoly& a, const std::size_t lo,
+			    const std::size_t hi, const unsigned k)
+{
+	if (hi - lo <= 8) {
+		cln::cl_I v = 0;
+		for (std::size_t i = hi; i-- != lo; )
+			v = (v << k) + a[i];
+		return v;
+	}
+	const std::size_t mid = lo + (hi - lo)/2;
+	return pack_range(a, lo, mid, k) +
+	       (pack_range(a, mid, hi, k) << (k*(mid - lo)));
+}
+
+cln::cl_I kronecker_pack(const upoly& a, const unsigned k)
+{
+	return pack_range(a, 0, a.size(), k);
+}
+
+void kronecker_unpack(upoly& a, const cln::cl_I& v, const unsigned k)
+{
+	bug_on(k < 2, "kronecker_unpack: digits too short");
+	a.clear();
+	const cln::cl_I half = cln::cl_I(1) << (k - 1);
+	const cln::cl_I full = cln::cl_I(1) << k;
+	const std::size_t len = cln::integer_length(v);
+	const int rest = cln::minusp(v) ? 1 : 0;
+	// Digits are read from the two's complement representation, a
+	// negative digit borrows from the next one
+	int carry = 0;
+	for (std::size_t pos = 0; pos < len || carry != rest; pos += k) {
+		cln::cl_I d = cln::ldb(v, cln::cl_byte(k, pos)) + carry;
+		if (d > half) {
+			d = d - full;
+			carry = 1;
+		} else
+			carry = 0;
+		a.push_back(d);
+	}
+	canonicalize(a);
+}
+
+static cln::cl_I max_abs_coeff(const upoly& a)
+{
+	cln::cl_I m = 0;
+	for (std::size_t i = 0; i < a.size(); ++i)
+		m = std::max(m, cln::abs(a[i]));
+	return m;
+}
+
+/** Check whether g*q == a. If all coefficients of g*q and a fit into
+ *  the digits, this is the same as a single product of integers. */
+static bool kronecker_check_product(const upoly& a, const upoly& g, const upoly& q)
+{
+	const std::size_t prod_bits = cln::integer_length(max_abs_coeff(g)) +
+		cln::integer_length(max_abs_coeff(q)) +
+		cln::integer_length(std::min(g.size(), q.size()));
+	const unsigned k = std::max(prod_bits, std::size_t(cln::integer_length(max_abs_coeff(a)))) + 2;
+	return kronecker_pack(g, k)*kronecker_pack(q, k) == kronecker_pack(a, k);
+}
+
+/**
+ * Exact division of a by g in Z[x]. If g divides a, then g(2^k) divides
+ * a(2^k) for every k, and the quotient q(2^k) gives q if the digits are
+ * wide enough. These are first tried as wide as the coefficients of a,
+ * which usually suffices, and then as wide as Mignotte's bound for the
+ * factors of a requires.
+ */
+static bool kronecker_divide(upoly& q, const upoly& a, const upoly& g)
+{
+	if (g.size() > a.size())
+		return false;
+	if (!cln::zerop(cln::rem(lcoeff(a), lcoeff(g))))
+		return false;
+	if (!cln::zerop(g[0]) && !cln::zerop(cln::rem(a[0], g[0])))
+		return false;
+
+	const std::size_t abits = cln::integer_length(max_abs_coeff(a));
+	const std::size_t lbits = cln::integer_length(a.size());
+	const unsigned k1 = abits + lbits + 2;
+	const unsigned k2 = abits + a.size() + lbits + 2;
+	for (unsigned k = k1; ; k = k2) {
+		const cln::cl_I_div_t qr = cln::truncate2(kronecker_pack(a, k), kronecker_pack(g, k));
+		if (!cln::zerop(qr.remainder))
+			return false;
+		kronecker_unpack(q, qr.quotient, k);
+		if (q.size() == a.size() - g.size() + 1 && kronecker_check_product(a, g, q))
+			return true;
+		if (k == k2)
+			return false;
+	}
+}
+
+bool heur_gcd_z_kronecker(upoly& g, upoly& ca, upoly& cb,
+			  const upoly& a, const upoly& b,
+			  const std::size_t max_bits)
+{
+	bug_on(a.empty() || b.empty(), "heur_gcd_z_kronecker: zero polynomial");
+	const std::size_t maxdeg = std::max(degree(a), degree(b));
+
+	// Evaluation point 2^k > 2*min(|a|_oo, |b|_oo) + 2
+	unsigned k = cln::integer_length(std::min(max_abs_coeff(a), max_abs_coeff(b))) + 1;
+
+	// 6 tries maximum
+	for (int t = 0; t < 6; ++t) {
+		if (k * maxdeg > max_bits)
+			return false;
+
+		const cln::cl_I gamma = cln::gcd(kronecker_pack(a, k), kronecker_pack(b, k));
+		kronecker_unpack(g, gamma, k);
+
+		// Remove integer content
+		cln::cl_I c = 0;
+		for (std::size_t i = 0; i < g.size(); ++i)
+			c = cln::gcd(c, g[i]);
+		if (c != 1)
+			for (std::size_t i = 0; i < g.size(); ++i)
+				g[i] = cln::exquo(g[i], c);
+
+		// If the calculated polynomial divides both a and b, this is the GCD
+		if (kronecker_divide(ca, a, g) && kronecker_divide(cb, b, g))
+			return true;
+
+		// Next evaluation point (roughly 2.73*xi^(5/4), as in gcd())
+		k = k + k/4 + 2;
+	}
+	return false;
+}
+
+} // namespace GiNaC
@@ -0,0 +1,56 @@
+/** @file kronecker.h
+ *
+ *  Kronecker substitution for univariate integer polynomials, and the
+ *  heuristic GCD based on it. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_KRONECKER_H
+#define GINAC_KRONECKER_H
+
+#include "upoly.h"
+
+namespace GiNaC {
+
+/** Value of a at x = 2^k. */
+extern cln::cl_I kronecker_pack(const upoly& a, const unsigned k);
+
+/**
+ * Inverse of kronecker_pack(): split v into digits of k bits in the
+ * symmetric range (-2^(k-1), 2^(k-1)]. This gives a if all coefficients
+ * of a are in that range.
+ */
+extern void kronecker_unpack(upoly& a, const cln::cl_I& v, const unsigned k);
+
+/**
+ * Heuristic GCD of non-zero polynomials a, b \in Z[x] whose integer
+ * contents are coprime. The polynomials are evaluated at powers of two,
+ * so that evaluation and interpolation are shifts of the integers. The
+ * cofactors are returned in ca and cb.
+ *
+ * @param max_bits give up when the values would get longer than this
+ * @return true if the GCD was found
+ */
+extern bool heur_gcd_z_kronecker(upoly& g, upoly& ca, upoly& cb,
+				 const upoly& a, const upoly& b,
+				 const std::size_t max_bits);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_KRONECKER_H
@@ -21,16 +21,21 @@
  */
 
 #include "operators.h"
+#include "normal.h"
 #include "chinrem_gcd.h"
 #include "pgcd.h"
 #include "collect_vargs.h"
 #include "primes_factory.h"
 #include "divide_in_z_p.h"
 #include "poly_cra.h"
+#include "packed_mpoly.h"
+#include "sparse_mpoly.h"
+#include "parallel.h"
 #include <numeric> // std::accumulate
 
 #include <cln/integer.h>
 #include <cln/integer_ring.h>
+#include <cln/random.h>
 #include <cln/rational.h>
 #include <cln/rational_ring.h>
 
@@ -58,8 +63,197 @@ static cln::cl_I extract_integer_content(ex& Apr, const ex& A)
 	}
 }
 
-ex chinrem_gcd(const ex& A_, const ex& B_, const exvector& vars)
+/** Upper limit of the number of images computed at once. */
+static const std::size_t max_parallel_images = 16;
+
+static bool same_terms(const z_mpoly& a, const z_mpoly& b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (std::size_t i = 0; i < a.size(); ++i)
+		if (a[i].mon != b[i].mon || a[i].coeff != b[i].coeff)
+			return false;
+	return true;
+}
+
+/** Computes images[k] = pgcd(Ap[k], Bp[k]) modulo primes[k]. The tasks
+ *  only read packed polynomials and the exponents in pk, not expressions,
+ *  so no caches have to be filled in with prepare_for_threads(). */
+struct pgcd_images_task : public parallel_task {
+	pgcd_images_task(const std::vector<zp_mpoly>& Ap_, const std::vector<zp_mpoly>& Bp_,
+			 std::vector<zp_mpoly>& images_, const std::vector<long>& primes_,
+			 std::vector<cln::random_state>& states_, const std::size_t var_,
+			 const monomial_packing& pk_, const bool sparse_interp_)
+	  : Ap(Ap_), Bp(Bp_), images(images_), primes(primes_), states(states_),
+	    var(var_), pk(pk_), sparse_interp(sparse_interp_) { }
+	void operator()(size_t k)
+	{
+		images[k] = pgcd(Ap[k], Bp[k], var, pk, primes[k], sparse_interp, states[k]);
+	}
+	const std::vector<zp_mpoly>& Ap;
+	const std::vector<zp_mpoly>& Bp;
+	std::vector<zp_mpoly>& images;
+	const std::vector<long>& primes;
+	std::vector<cln::random_state>& states;
+	const std::size_t var;
+	const monomial_packing& pk;
+	const bool sparse_interp;
+};
+
+/**
+ * The same algorithm for polynomials in sparse form. The polynomials are
+ * converted at entry and exit only, all the arithmetic is done on packed
+ * monomials with word-sized coefficients. Returns false if A_ and B_ can't
+ * be represented this way (or we run out of small primes), so that the
+ * caller can fall back to the generic code.
+ *
+ * The images modulo different primes are independent, and pgcd() on
+ * word-sized coefficients doesn't touch any CLN numbers, so in parallel
+ * mode they are computed by several threads. The candidate is checked by
+ * trial division as soon as the Chinese remainder step leaves it
+ * unchanged, which usually saves the primes needed to reach the bound.
+ */
+static bool sparse_chinrem_gcd(ex& res, const ex& A_, const ex& B_,
+			       const exvector& vars, const unsigned options)
 {
+	exvector allvars(vars);
+	std::vector<unsigned> deg_a, deg_b;
+	if (!packed_mpoly_collect_vars(A_, allvars, deg_a) ||
+	    !packed_mpoly_collect_vars(B_, allvars, deg_b) ||
+	    allvars.size() != vars.size())
+		return false;
+
+	// Room for the images of the GCD and the interpolation polynomials
+	std::vector<unsigned> capacity(vars.size());
+	for (std::size_t i = 0; i < vars.size(); ++i)
+		capacity[i] = 2*std::max(deg_a[i], deg_b[i]) + 2;
+	monomial_packing pk;
+	if (!pk.init(vars, capacity))
+		return false;
+
+	z_mpoly A, B;
+	const cln::cl_I a_icont = ex_to_z_mpoly(A_, pk, A);
+	const cln::cl_I b_icont = ex_to_z_mpoly(B_, pk, B);
+	if (A.empty() || B.empty())
+		return false;
+	const cln::cl_I c = cln::gcd(a_icont, b_icont);
+
+	const cln::cl_I g_lc = cln::gcd(A[0].coeff, B[0].coeff);
+
+	packed_monomial n = std::min(A[0].mon, B[0].mon);
+	unsigned nTot = 0;
+	for (std::size_t i = 0; i < vars.size(); ++i)
+		nTot += pk.exponent(n, i);
+	const cln::cl_I lcoeff_limit = (cln::cl_I(1) << nTot)*cln::abs(g_lc)*
+		std::min(z_mpoly_max_coeff(A), z_mpoly_max_coeff(B));
+
+	cln::cl_I q = 0;
+	z_mpoly H;
+
+	// In parallel mode the images modulo several primes are computed at
+	// once and then combined one by one.
+	const bool sparse_interp = options & gcd_options::use_sparse_interp;
+	const std::size_t batch = (options & gcd_options::parallel) ?
+		parallel_threads(max_parallel_images) : 1;
+	std::vector<cln::random_state> states(batch > 1 ? batch : 0);
+	std::vector<long> primes;
+	std::vector<zp_mpoly> Ap, Bp, images;
+
+	long p;
+	primes_factory pfactory;
+	while (true) {
+		primes.clear();
+		std::size_t wanted = 1;
+		while (primes.size() < wanted) {
+			bool has_primes = pfactory(p, g_lc);
+			if (!has_primes)
+				throw chinrem_gcd_failed();
+			if (p >= max_sparse_modulus)
+				break;
+			primes.push_back(p);
+			if (primes.size() == 1 && batch > 1 && q < lcoeff_limit) {
+				// Don't compute more images than needed to reach
+				// the bound on the coefficients
+				const std::size_t missing = (cln::integer_length(lcoeff_limit) -
+					cln::integer_length(q))/(cln::integer_length(p) - 1) + 1;
+				wanted = std::min(batch, missing);
+			}
+		}
+		if (primes.empty())
+			return false;
+
+		Ap.resize(primes.size());
+		Bp.resize(primes.size());
+		images.resize(primes.size());
+		for (std::size_t k = 0; k < primes.size(); ++k) {
+			Ap[k] = z_mpoly_mod(A, primes[k]);
+			Bp[k] = z_mpoly_mod(B, primes[k]);
+		}
+		if (primes.size() > 1) {
+			pgcd_images_task task(Ap, Bp, images, primes, states,
+					      vars.size() - 1, pk, sparse_interp);
+			parallel_for(primes.size(), task);
+		} else
+			images[0] = pgcd(Ap[0], Bp[0], vars.size() - 1, pk, primes[0],
+					 sparse_interp);
+
+		for (std::size_t k = 0; k < primes.size(); ++k) {
+			p = primes[k];
+			zp_mpoly& Cp = images[k];
+
+			const long g_lcp = to_mod(g_lc, p);
+			zp_mpoly_scale(Cp, mul_mod(recip_mod(Cp[0].coeff, p), g_lcp, p), p);
+			const packed_monomial cp_deg = Cp[0].mon;
+			if (cp_deg == 0) {
+				res = numeric(c);
+				return true;
+			}
+			// Set if the new image doesn't change the candidate
+			bool stable = false;
+			if (zerop(q)) {
+				H = z_mpoly_from_zp(Cp, p);
+				n = cp_deg;
+				q = p;
+			} else {
+				if (cp_deg == n) {
+					z_mpoly H_next = chinese_remainder(H, q, Cp, p);
+					q = q*cln::cl_I(p);
+					stable = same_terms(H, H_next);
+					H.swap(H_next);
+				} else if (cp_deg < n) {
+					// all previous homomorphisms are unlucky
+					q = p;
+					H = z_mpoly_from_zp(Cp, p);
+					n = cp_deg;
+				} else {
+					// dp_deg > d_deg: current prime is bad
+				}
+			}
+			if (q < lcoeff_limit && !stable)
+				continue; // don't bother to do division checks
+			z_mpoly C(H), dummy;
+			const cln::cl_I h_icont = z_mpoly_content(C);
+			for (std::size_t i = 0; i < C.size(); ++i)
+				C[i].coeff = cln::exquo(C[i].coeff, h_icont);
+			if (z_mpoly_divide(A, C, dummy, pk) &&
+					z_mpoly_divide(B, C, dummy, pk)) {
+				for (std::size_t i = 0; i < C.size(); ++i)
+					C[i].coeff = C[i].coeff*c;
+				res = z_mpoly_to_ex(C, pk);
+				return true;
+			}
+			// else: try more primes
+		}
+	}
+}
+
+ex chinrem_gcd(const ex& A_, const ex& B_, const exvector& vars,
+	       const unsigned options)
+{
+	ex res;
+	if (sparse_chinrem_gcd(res, A_, B_, vars, options))
+		return res;
+
 	ex A, B;
 	const cln::cl_I a_icont = extract_integer_content(A, A_);
 	const cln::cl_I b_icont = extract_integer_content(B, B_);
@@ -22,6 +22,7 @@
 
 #include "upoly.h"
 #include "gcd_euclid.h"
+#include "half_gcd.h"
 #include "cra_garner.h"
 #include "debug.h"
 
@@ -150,7 +151,10 @@ void mod_gcd(upoly& result, upoly A, upoly B)
 
 		// Compute the GCD in Z/p[x]
 		umodpoly cp;
-		gcd_euclid(cp, ap, bp);
+		if (std::min(degree(ap), degree(bp)) >= half_gcd_threshold)
+			gcd_half_gcd(cp, ap, bp);
+		else
+			gcd_euclid(cp, ap, bp);
 		bug_on(cp.size() == 0, "gcd(ap, bp) = 0, with ap = " <<
 			                ap << ", and bp = " << bp);
 
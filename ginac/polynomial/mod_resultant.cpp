@@ -0,0 +1,341 @@
+/** @file mod_resultant.cpp
+ *
+ *  Resultants of multivariate polynomials by the modular algorithm.
+ *
+ *  The polynomials are converted into sparse form over Z once. Modulo a
+ *  word-sized prime, the resultant is a polynomial in the other variables
+ *  whose degrees are bounded by those of the inputs, so it is interpolated
+ *  from its values at as many points, one variable after the other. The
+ *  univariate resultants at the bottom are computed by the Euclidean
+ *  algorithm. Points and primes at which the degree in s drops are skipped.
+ *  The images are combined by the Chinese remainder algorithm until the
+ *  modulus exceeds twice a bound on the coefficients. The evaluations of
+ *  the first variable are independent, for every prime, so all of them are
+ *  distributed over several threads by parallel_for(). */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "mod_resultant.h"
+#include "operators.h"
+#include "relational.h"
+#include "newton_interpolate.h"
+#include "poly_cra.h"
+#include "primes_factory.h"
+#include "packed_mpoly.h"
+#include "sparse_mpoly.h"
+#include "numeric.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cln/integer.h>
+#include <cln/rational.h>
+
+namespace GiNaC {
+
+/** Upper limit of the number of primes used at once. */
+static const std::size_t max_parallel_images = 16;
+
+/** The data shared by all images of one resultant. */
+struct resultant_setup {
+	/** The variables are y_0, ..., y_{n-1} and s (the last one). */
+	monomial_packing pk;
+	std::size_t s;
+	/** Degrees of the polynomials in s. */
+	unsigned h1, h2;
+	/** Degree bounds of the resultant in y_0, ..., y_{n-1}. */
+	std::vector<unsigned> bound;
+};
+
+static long expt_mod(long a, unsigned long e, const long p)
+{
+	long r = 1;
+	while (e != 0) {
+		if (e & 1)
+			r = mul_mod(r, a, p);
+		a = mul_mod(a, a, p);
+		e >>= 1;
+	}
+	return r;
+}
+
+/** Degree of a in the variable var, -1 if a is zero. */
+static int zp_mpoly_degree(const zp_mpoly& a, const std::size_t var, const monomial_packing& pk)
+{
+	int d = -1;
+	for (std::size_t i = 0; i < a.size(); ++i)
+		d = std::max(d, int(pk.exponent(a[i].mon, var)));
+	return d;
+}
+
+/** Convert a polynomial in the variable var only. */
+static zp_upoly zp_mpoly_to_upoly(const zp_mpoly& a, const std::size_t var, const monomial_packing& pk)
+{
+	zp_upoly u;
+	for (std::size_t i = 0; i < a.size(); ++i) {
+		const unsigned e = pk.exponent(a[i].mon, var);
+		if (u.size() <= e)
+			u.resize(e + 1, 0);
+		u[e] = a[i].coeff;
+	}
+	return u;
+}
+
+/** Resultant of univariate polynomials over Z_p by the Euclidean algorithm,
+ *  using res(a, b) = (-1)^(deg(a)*deg(b))*lc(b)^(deg(a)-deg(r))*res(b, r)
+ *  for the remainder r of a and b. */
+static long zp_upoly_resultant(zp_upoly a, zp_upoly b, const long p)
+{
+	if (a.empty() || b.empty())
+		return 0;
+	long res = 1;
+	zp_upoly q, r;
+	while (b.size() > 1) {
+		zp_upoly_divide(a, b, q, r, p);
+		if (r.empty())
+			return 0;
+		const std::size_t m = a.size() - 1, n = b.size() - 1;
+		if (m & n & 1)
+			res = p - res;
+		res = mul_mod(res, expt_mod(b.back(), m - (r.size() - 1), p), p);
+		a.swap(b);
+		b.swap(r);
+	}
+	return mul_mod(res, expt_mod(b[0], a.size() - 1, p), p);
+}
+
+/** Substitute the next point after x for the variable var at which A and B
+ *  keep their degrees in s. Returns that point. */
+static long next_point(const zp_mpoly& A, const zp_mpoly& B, const std::size_t var, long x,
+		       const resultant_setup& rs, const long p, zp_mpoly& Ax, zp_mpoly& Bx)
+{
+	do {
+		++x;
+		Ax = zp_mpoly_eval(A, var, x, rs.pk, p);
+		Bx = zp_mpoly_eval(B, var, x, rs.pk, p);
+	} while (zp_mpoly_degree(Ax, rs.s, rs.pk) != int(rs.h1) ||
+		 zp_mpoly_degree(Bx, rs.s, rs.pk) != int(rs.h2));
+	return x;
+}
+
+/** Resultant of A and B with respect to s modulo p, as a polynomial in
+ *  y_0, ..., y_{nv-1} (A and B don't contain the other y_j). */
+static zp_mpoly zp_resultant(const zp_mpoly& A, const zp_mpoly& B, const std::size_t nv,
+			     const resultant_setup& rs, const long p)
+{
+	if (nv == 0) {
+		const long r = zp_upoly_resultant(zp_mpoly_to_upoly(A, rs.s, rs.pk),
+						  zp_mpoly_to_upoly(B, rs.s, rs.pk), p);
+		return r == 0 ? zp_mpoly() : zp_mpoly(1, sparse_term<long>(0, r));
+	}
+
+	const std::size_t var = nv - 1;
+	zp_mpoly R, Ax, Bx;
+	zp_upoly prevpts(1, 1), lin(2, 1);
+	long x = 0;
+	for (unsigned i = 0; i <= rs.bound[var]; ++i) {
+		x = next_point(A, B, var, x, rs, p, Ax, Bx);
+		R = newton_interp(zp_resultant(Ax, Bx, var, rs, p), x, R, prevpts, var, rs.pk, p);
+		lin[0] = p - x;
+		prevpts = zp_upoly_mul(prevpts, lin, p);
+	}
+	return R;
+}
+
+/** Computes images[i] = zp_resultant(A[i], B[i]) modulo moduli[i]. */
+struct resultant_images_task : public parallel_task {
+	resultant_images_task(const std::vector<zp_mpoly>& A_, const std::vector<zp_mpoly>& B_,
+			      std::vector<zp_mpoly>& images_, const std::vector<long>& moduli_,
+			      const std::size_t nv_, const resultant_setup& rs_)
+	  : A(A_), B(B_), images(images_), moduli(moduli_), nv(nv_), rs(rs_) { }
+	void operator()(size_t i)
+	{
+		images[i] = zp_resultant(A[i], B[i], nv, rs, moduli[i]);
+	}
+	const std::vector<zp_mpoly>& A;
+	const std::vector<zp_mpoly>& B;
+	std::vector<zp_mpoly>& images;
+	const std::vector<long>& moduli;
+	const std::size_t nv;
+	const resultant_setup& rs;
+};
+
+/** Convert the expanded polynomial e into a primitive polynomial a over Z
+ *  and the rational number c with e == c*a. */
+static void ex_to_z_mpoly_scaled(const ex& e, const monomial_packing& pk, z_mpoly& a, cln::cl_RA& c)
+{
+	const packed_mpoly pe = ex_to_packed_mpoly(e, pk);
+	cln::cl_I den = 1;
+	for (std::size_t i = 0; i < pe.size(); ++i)
+		den = cln::lcm(den, cln::denominator(pe[i].coeff));
+	a.clear();
+	a.reserve(pe.size());
+	for (std::size_t i = 0; i < pe.size(); ++i)
+		a.push_back(sparse_term<cln::cl_I>(pe[i].mon, cln::numerator(pe[i].coeff * den)));
+	const cln::cl_I g = z_mpoly_content(a);
+	for (std::size_t i = 0; i < a.size(); ++i)
+		a[i].coeff = cln::exquo(a[i].coeff, g);
+	c = g / den;
+}
+
+/** Sum of the absolute values of the coefficients. */
+static cln::cl_I z_mpoly_norm1(const z_mpoly& a)
+{
+	cln::cl_I n = 0;
+	for (std::size_t i = 0; i < a.size(); ++i)
+		n = n + cln::abs(a[i].coeff);
+	return n;
+}
+
+bool mod_resultant(const ex& a, const ex& b, const ex& s, ex& res)
+{
+	exvector vars;
+	std::vector<unsigned> deg_a, deg_b;
+	if (!packed_mpoly_collect_vars(a, vars, deg_a) ||
+	    !packed_mpoly_collect_vars(b, vars, deg_b))
+		return false;
+	deg_a.resize(vars.size(), 0);
+	std::size_t si = 0;
+	while (si < vars.size() && !vars[si].is_equal(s))
+		++si;
+	if (si == vars.size())
+		return false;
+	const std::size_t n = vars.size() - 1;
+	std::swap(vars[si], vars[n]);
+	std::swap(deg_a[si], deg_a[n]);
+	std::swap(deg_b[si], deg_b[n]);
+
+	resultant_setup rs;
+	rs.s = n;
+	rs.h1 = deg_a[n];
+	rs.h2 = deg_b[n];
+	if (rs.h1 == 0 || rs.h2 == 0)
+		return false;
+	// The resultant is homogeneous of degree h2 in the coefficients of a
+	// and of degree h1 in those of b
+	rs.bound.resize(n);
+	std::vector<unsigned> capacity(n + 1);
+	for (std::size_t j = 0; j < n; ++j) {
+		rs.bound[j] = rs.h2*deg_a[j] + rs.h1*deg_b[j];
+		capacity[j] = std::max(std::max(deg_a[j], deg_b[j]), rs.bound[j] + 1);
+	}
+	capacity[n] = std::max(rs.h1, rs.h2);
+	if (!rs.pk.init(vars, capacity))
+		return false;
+
+	z_mpoly A, B;
+	cln::cl_RA ca, cb;
+	ex_to_z_mpoly_scaled(a, rs.pk, A, ca);
+	ex_to_z_mpoly_scaled(b, rs.pk, B, cb);
+
+	// Expanding the determinant along the rows of the Sylvester matrix
+	// gives |res|_1 <= |A|_1^h2*|B|_1^h1 for the sums of the absolute
+	// values of the coefficients
+	const cln::cl_I limit = 2*cln::expt_pos(z_mpoly_norm1(A), rs.h2)*
+		cln::expt_pos(z_mpoly_norm1(B), rs.h1);
+
+	std::vector<long> primes, moduli;
+	std::vector<std::size_t> start;
+	std::vector<std::vector<long> > points;
+	std::vector<zp_mpoly> Ae, Be, images;
+	const std::size_t nv = n == 0 ? 0 : n - 1;
+
+	z_mpoly R;
+	cln::cl_I q = 0;
+	long p;
+	primes_factory pfactory;
+	while (q <= limit) {
+		// Don't use more primes than needed to exceed the limit
+		primes.clear();
+		cln::cl_I next_q = cln::zerop(q) ? cln::cl_I(1) : q;
+		while (primes.size() < max_parallel_images && next_q <= limit) {
+			if (!pfactory(p, cln::cl_I(1)) || p >= max_sparse_modulus)
+				break;
+			primes.push_back(p);
+			next_q = next_q*cln::cl_I(p);
+		}
+		if (primes.empty())
+			return false;
+
+		// Evaluate the last of the y_j at enough points for every prime,
+		// the rest is done in parallel
+		Ae.clear();
+		Be.clear();
+		moduli.clear();
+		start.clear();
+		points.assign(primes.size(), std::vector<long>());
+		for (std::size_t k = 0; k < primes.size(); ++k) {
+			p = primes[k];
+			start.push_back(Ae.size());
+			const zp_mpoly Ap = z_mpoly_mod(A, p), Bp = z_mpoly_mod(B, p);
+			if (zp_mpoly_degree(Ap, rs.s, rs.pk) != int(rs.h1) ||
+			    zp_mpoly_degree(Bp, rs.s, rs.pk) != int(rs.h2))
+				continue;  // unlucky prime
+			if (n == 0) {
+				Ae.push_back(Ap);
+				Be.push_back(Bp);
+				moduli.push_back(p);
+				continue;
+			}
+			long x = 0;
+			zp_mpoly Ax, Bx;
+			for (unsigned i = 0; i <= rs.bound[nv]; ++i) {
+				x = next_point(Ap, Bp, nv, x, rs, p, Ax, Bx);
+				points[k].push_back(x);
+				Ae.push_back(Ax);
+				Be.push_back(Bx);
+				moduli.push_back(p);
+			}
+		}
+		start.push_back(Ae.size());
+		images.assign(Ae.size(), zp_mpoly());
+		resultant_images_task task(Ae, Be, images, moduli, nv, rs);
+		parallel_for(Ae.size(), task);
+
+		for (std::size_t k = 0; k < primes.size(); ++k) {
+			if (start[k] == start[k+1])
+				continue;
+			p = primes[k];
+			zp_mpoly Rp;
+			if (n == 0)
+				Rp = images[start[k]];
+			else {
+				zp_upoly prevpts(1, 1), lin(2, 1);
+				for (std::size_t i = start[k]; i < start[k+1]; ++i) {
+					const long x = points[k][i - start[k]];
+					Rp = newton_interp(images[i], x, Rp, prevpts, nv, rs.pk, p);
+					lin[0] = p - x;
+					prevpts = zp_upoly_mul(prevpts, lin, p);
+				}
+			}
+			if (cln::zerop(q)) {
+				R = z_mpoly_from_zp(Rp, p);
+				q = p;
+			} else {
+				R = chinese_remainder(R, q, Rp, p);
+				q = q*cln::cl_I(p);
+			}
+		}
+	}
+
+	const cln::cl_RA c = cln::expt(ca, rs.h2)*cln::expt(cb, rs.h1);
+	res = z_mpoly_to_ex(R, rs.pk)*numeric(cln::cl_N(c));
+	return true;
+}
+
+} // namespace GiNaC
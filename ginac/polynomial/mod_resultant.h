@@ -0,0 +1,44 @@
+/** @file mod_resultant.h
+ *
+ *  Resultants of multivariate polynomials by the modular algorithm. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_MOD_RESULTANT_H
+#define GINAC_MOD_RESULTANT_H
+
+#include "ex.h"
+
+namespace GiNaC {
+
+/**
+ * Resultant of the expanded polynomials a and b with respect to s, i.e.
+ * the determinant of their Sylvester matrix, computed modulo primes by
+ * evaluation and interpolation (Collins' algorithm).
+ *
+ * Returns false, so that the caller can fall back to the Sylvester matrix,
+ * if a or b is not a polynomial in symbols with rational coefficients, if
+ * one of them doesn't depend on s, or if the exponents of the result are
+ * too large for the sparse representation.
+ */
+extern bool mod_resultant(const ex& a, const ex& b, const ex& s, ex& res);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_MOD_RESULTANT_H
@@ -26,6 +26,7 @@
 #include "ex.h"
 #include "numeric.h"
 #include "smod_helpers.h"
+#include "sparse_mpoly.h"
 
 namespace GiNaC {
 
@@ -40,9 +41,9 @@ namespace GiNaC {
  * (x - pt_2) (x - pt_3) \ldots (x - pt_n).
  * @var{prev} encodes the result of previous interpolations.
  */
-ex newton_interp(const ex& e1, const long pt1,
-		 const ex& prev, const ex& prevpts,
-		 const ex& x, const long p)
+inline ex newton_interp(const ex& e1, const long pt1,
+			const ex& prev, const ex& prevpts,
+			const ex& x, const long p)
 {
 	const numeric pnum(p);
 	const numeric nc = ex_to<numeric>(prevpts.subs(x == numeric(pt1)).smod(pnum));
@@ -55,6 +56,38 @@ ex newton_interp(const ex& e1, const long pt1,
 	return tmp;
 }
 
+/**
+ * Same as above, for polynomials in sparse form, updating prev in place.
+ * prevpts is a polynomial in the variable var, the interpolation is done
+ * in that variable. Returns false if prev already takes the value e1 at
+ * pt1, i.e. the interpolated polynomial did not change.
+ */
+inline bool newton_interp_update(zp_mpoly& prev, const zp_mpoly& e1, const long pt1,
+				 const zp_upoly& prevpts, const std::size_t var,
+				 const monomial_packing& pk, const long p)
+{
+	zp_mpoly tmp = zp_mpoly_sub(e1, zp_mpoly_eval(prev, var, pt1, pk, p), p);
+	if (tmp.empty())
+		return false;
+	const long nc_1 = recip_mod(zp_upoly_eval(prevpts, pt1, p), p);
+	zp_mpoly_scale(tmp, nc_1, p);
+	prev = zp_mpoly_add(prev, zp_mpoly_mul_upoly(tmp, prevpts, var, pk, p), p);
+	return true;
+}
+
+/**
+ * Same as above, returning the interpolated polynomial.
+ */
+inline zp_mpoly newton_interp(const zp_mpoly& e1, const long pt1,
+			      const zp_mpoly& prev, const zp_upoly& prevpts,
+			      const std::size_t var, const monomial_packing& pk,
+			      const long p)
+{
+	zp_mpoly r(prev);
+	newton_interp_update(r, e1, pt1, prevpts, var, pk, p);
+	return r;
+}
+
 } // namespace GiNaC
 
 #endif // ndef GINAC_PGCD_NEWTON_INTERPOLATE_H
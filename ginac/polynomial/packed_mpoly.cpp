@@ -0,0 +1,395 @@
+/** @file packed_mpoly.cpp
+ *
+ *  Sparse distributed multivariate polynomials with packed exponent
+ *  vectors, used for fast expansion of products of polynomials. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "packed_mpoly.h"
+#include "add.h"
+#include "mul.h"
+#include "power.h"
+#include "symbol.h"
+#include "numeric.h"
+#include "parallel.h"
+#include "budget.h"
+#include "utils.h"
+#include "hash_map.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <limits>
+#include <cln/integer.h>
+#include <cln/integer_ring.h>
+#include <cln/rational.h>
+#include <map>
+#include <utility>
+
+namespace GiNaC {
+
+bool monomial_packing::init(const exvector & vars_, const std::vector<unsigned> & max_degrees)
+{
+	vars = vars_;
+	shift.resize(vars.size());
+	mask.resize(vars.size());
+	unsigned bits_used = 0;
+	for (size_t i = 0; i < vars.size(); ++i) {
+		unsigned bits = 1;
+		while (bits < 32 && (max_degrees[i] >> bits) != 0)
+			++bits;
+		if (bits_used + bits > 8*sizeof(packed_monomial))
+			return false;
+		shift[i] = bits_used;
+		mask[i] = (packed_monomial(1) << bits) - 1;
+		bits_used += bits;
+	}
+	return true;
+}
+
+ex monomial_packing::monomial_to_ex(packed_monomial m) const
+{
+	epvector factors;
+	for (size_t i = 0; i < vars.size(); ++i) {
+		const unsigned deg = exponent(m, i);
+		if (deg != 0)
+			factors.push_back(expair(vars[i], ex(deg)));
+	}
+	if (factors.empty())
+		return _ex1;
+	if (factors.size() == 1) {
+		if (factors[0].coeff.is_equal(_ex1))
+			return factors[0].rest;
+		return (new power(factors[0].rest, factors[0].coeff))->setflag(status_flags::dynallocated | status_flags::expanded);
+	}
+	return (new mul(factors, _ex1))->setflag(status_flags::dynallocated | status_flags::expanded);
+}
+
+namespace {
+
+/** Entry of the heap used for multiplication: the pair of terms a[i]*b[j]
+ *  and the monomial of their product. */
+struct heap_entry {
+	heap_entry(packed_monomial m, size_t i_, size_t j_) : mon(m), i(i_), j(j_) {}
+	packed_monomial mon;
+	size_t i, j;
+};
+
+/** Heap order: the largest monomial is on top. */
+struct heap_entry_less {
+	bool operator()(const heap_entry & x, const heap_entry & y) const
+	{
+		return x.mon < y.mon;
+	}
+};
+
+} // anonymous namespace
+
+packed_mpoly packed_mpoly_mul(const packed_mpoly & a, const packed_mpoly & b)
+{
+	packed_mpoly result;
+	if (a.empty() || b.empty())
+		return result;
+	const packed_mpoly & f = (a.size() <= b.size() ? a : b);
+	const packed_mpoly & g = (a.size() <= b.size() ? b : a);
+
+	// The heap holds at most one product f[i]*g[j] for every i. The
+	// product f[i+1]*g[0] is inserted only after f[i]*g[0] has been
+	// extracted, which keeps the heap small (Monagan & Pearce).
+	std::vector<heap_entry> heap;
+	heap.reserve(f.size());
+	heap.push_back(heap_entry(f[0].mon + g[0].mon, 0, 0));
+	heap_entry_less less;
+
+	std::size_t steps = 0;
+	while (!heap.empty()) {
+		if ((++steps & 1023) == 0)
+			check_budget();
+		const packed_monomial mon = heap.front().mon;
+		cln::cl_RA c = 0;
+		do {
+			std::pop_heap(heap.begin(), heap.end(), less);
+			const size_t i = heap.back().i, j = heap.back().j;
+			heap.pop_back();
+			c = c + f[i].coeff * g[j].coeff;
+			if (j == 0 && i + 1 < f.size()) {
+				heap.push_back(heap_entry(f[i+1].mon + g[0].mon, i + 1, 0));
+				std::push_heap(heap.begin(), heap.end(), less);
+			}
+			if (j + 1 < g.size()) {
+				heap.push_back(heap_entry(f[i].mon + g[j+1].mon, i, j + 1));
+				std::push_heap(heap.begin(), heap.end(), less);
+			}
+		} while (!heap.empty() && heap.front().mon == mon);
+		if (!cln::zerop(c))
+			result.push_back(packed_term(mon, c));
+	}
+	return result;
+}
+
+packed_mpoly packed_mpoly_add(const packed_mpoly & a, const packed_mpoly & b)
+{
+	packed_mpoly result;
+	result.reserve(a.size() + b.size());
+	packed_mpoly::const_iterator i = a.begin(), j = b.begin();
+	while (i != a.end() && j != b.end()) {
+		if (i->mon > j->mon) {
+			result.push_back(*i);
+			++i;
+		} else if (i->mon < j->mon) {
+			result.push_back(*j);
+			++j;
+		} else {
+			const cln::cl_RA c = i->coeff + j->coeff;
+			if (!cln::zerop(c))
+				result.push_back(packed_term(i->mon, c));
+			++i;
+			++j;
+		}
+	}
+	result.insert(result.end(), i, a.end());
+	result.insert(result.end(), j, b.end());
+	return result;
+}
+
+/** Split a term c*x1^e1*...*xn^en into its factors. If the term is of a
+ *  different form, false is returned. */
+static bool split_term(const ex & t, cln::cl_RA & c, std::vector<std::pair<ex, unsigned> > & factors)
+{
+	c = 1;
+	factors.clear();
+	const size_t n = is_exactly_a<mul>(t) ? t.nops() : 1;
+	for (size_t k = 0; k < n; ++k) {
+		const ex f = is_exactly_a<mul>(t) ? t.op(k) : t;
+		if (is_exactly_a<numeric>(f)) {
+			if (!f.info(info_flags::rational))
+				return false;
+			c = c * cln::the<cln::cl_RA>(ex_to<numeric>(f).to_cl_N());
+		} else if (is_a<symbol>(f)) {
+			factors.push_back(std::make_pair(f, 1U));
+		} else if (is_exactly_a<power>(f) && is_a<symbol>(f.op(0)) &&
+		           f.op(1).info(info_flags::posint) &&
+		           ex_to<numeric>(f.op(1)).int_length() < 31) {
+			factors.push_back(std::make_pair(f.op(0), unsigned(ex_to<numeric>(f.op(1)).to_int())));
+		} else
+			return false;
+	}
+	return true;
+}
+
+bool packed_mpoly_collect_vars(const ex & e, exvector & vars, std::vector<unsigned> & degrees)
+{
+	exhashmap<size_t> index;
+	for (size_t k = 0; k < vars.size(); ++k)
+		index[vars[k]] = k;
+	degrees.resize(vars.size(), 0);
+
+	cln::cl_RA c;
+	std::vector<std::pair<ex, unsigned> > factors;
+	const size_t n = is_exactly_a<add>(e) ? e.nops() : 1;
+	for (size_t k = 0; k < n; ++k) {
+		if (!split_term(is_exactly_a<add>(e) ? e.op(k) : e, c, factors))
+			return false;
+		for (size_t l = 0; l < factors.size(); ++l) {
+			exhashmap<size_t>::iterator it = index.find(factors[l].first);
+			if (it == index.end()) {
+				it = index.insert(std::make_pair(factors[l].first, vars.size())).first;
+				vars.push_back(factors[l].first);
+				degrees.push_back(0);
+			}
+			degrees[it->second] = std::max(degrees[it->second], factors[l].second);
+		}
+	}
+	return true;
+}
+
+/** Order of terms in a packed_mpoly: decreasing monomials. */
+static bool packed_term_greater(const packed_term & x, const packed_term & y)
+{
+	return x.mon > y.mon;
+}
+
+packed_mpoly ex_to_packed_mpoly(const ex & e, const monomial_packing & pk)
+{
+	exhashmap<size_t> index;
+	for (size_t k = 0; k < pk.nvars(); ++k)
+		index[pk.var(k)] = k;
+
+	packed_mpoly result;
+	cln::cl_RA c;
+	std::vector<std::pair<ex, unsigned> > factors;
+	const size_t n = is_exactly_a<add>(e) ? e.nops() : 1;
+	result.reserve(n);
+	for (size_t k = 0; k < n; ++k) {
+		bool ok = split_term(is_exactly_a<add>(e) ? e.op(k) : e, c, factors);
+		bug_on(!ok, "not a polynomial with rational coefficients: " << e);
+		packed_monomial m = 0;
+		for (size_t l = 0; l < factors.size(); ++l) {
+			exhashmap<size_t>::const_iterator it = index.find(factors[l].first);
+			bug_on(it == index.end(), "unexpected variable " << factors[l].first);
+			m += pk.pack(it->second, factors[l].second);
+		}
+		if (!cln::zerop(c))
+			result.push_back(packed_term(m, c));
+	}
+	// The terms of an expanded sum are all different, so sorting suffices.
+	std::sort(result.begin(), result.end(), packed_term_greater);
+	return result;
+}
+
+ex packed_mpoly_to_ex(const packed_mpoly & p, const monomial_packing & pk)
+{
+	epvector terms;
+	terms.reserve(p.size());
+	ex oc = _ex0;
+	for (packed_mpoly::const_iterator i = p.begin(); i != p.end(); ++i) {
+		if (i->mon == 0)
+			oc = numeric(i->coeff);
+		else
+			terms.push_back(expair(pk.monomial_to_ex(i->mon), numeric(i->coeff)));
+	}
+	if (terms.empty())
+		return oc;
+	return (new add(terms, oc))->setflag(status_flags::dynallocated | status_flags::expanded);
+}
+
+namespace {
+
+/** Multiplies slices of one packed polynomial with another one. The tasks
+ *  only read packed terms, not expressions, so there are no caches of
+ *  shared expressions to fill in beforehand (cf. prepare_for_threads()).
+ *  @see expand_product_packed */
+struct packed_mul_task : public parallel_task {
+	packed_mul_task(const packed_mpoly & a_, const packed_mpoly & b_, std::vector<packed_mpoly> & parts_)
+	 : a(a_), b(b_), parts(parts_) {}
+
+	void operator()(size_t i)
+	{
+		const size_t n = parts.size();
+		const packed_mpoly slice(a.begin() + (i * a.size()) / n, a.begin() + ((i + 1) * a.size()) / n);
+		parts[i] = packed_mpoly_mul(slice, b);
+	}
+
+	const packed_mpoly & a;
+	const packed_mpoly & b;
+	std::vector<packed_mpoly> & parts;
+};
+
+} // anonymous namespace
+
+/** Whether all coefficients of p are integers which CLN stores in the
+ *  term itself, so that terms can be copied by several threads at once
+ *  (see numerics_are_immediate()). */
+static bool coefficients_are_immediate(const packed_mpoly & p)
+{
+	for (packed_mpoly::const_iterator i = p.begin(); i != p.end(); ++i) {
+		if (!cln::instanceof(i->coeff, cln::cl_I_ring) ||
+		    cln::integer_length(cln::the<cln::cl_I>(i->coeff)) >= cl_value_len - 1)
+			return false;
+	}
+	return true;
+}
+
+/** Product of a and b, computed by several threads if parallel is set and
+ *  the polynomials are large enough. */
+static packed_mpoly packed_mul(const packed_mpoly & a, const packed_mpoly & b, bool parallel)
+{
+	const packed_mpoly & larger = (a.size() >= b.size() ? a : b);
+	const packed_mpoly & smaller = (a.size() >= b.size() ? b : a);
+	const unsigned nthreads = parallel_threads(larger.size());
+	if (!parallel || nthreads <= 1 || larger.size() * smaller.size() < 4096)
+		return packed_mpoly_mul(a, b);
+
+	std::vector<packed_mpoly> parts(std::min(larger.size(), size_t(nthreads)));
+	packed_mul_task task(larger, smaller, parts);
+	parallel_for(parts.size(), task);
+	// Sum up the partial products pairwise.
+	while (parts.size() > 1) {
+		std::vector<packed_mpoly> sums((parts.size() + 1) / 2);
+		for (size_t k = 0; k + 1 < parts.size(); k += 2)
+			sums[k / 2] = packed_mpoly_add(parts[k], parts[k + 1]);
+		if (parts.size() % 2)
+			sums.back().swap(parts.back());
+		parts.swap(sums);
+	}
+	return parts[0];
+}
+
+bool expand_product_packed(const ex & a, const ex & b, unsigned options, ex & result)
+{
+	exvector vars;
+	std::vector<unsigned> deg_a, deg_b;
+	if (!packed_mpoly_collect_vars(a, vars, deg_a) ||
+	    !packed_mpoly_collect_vars(b, vars, deg_b))
+		return false;
+	deg_a.resize(vars.size(), 0);
+	std::vector<unsigned> degrees(vars.size());
+	for (size_t l = 0; l < vars.size(); ++l)
+		degrees[l] = deg_a[l] + deg_b[l];
+
+	monomial_packing pk;
+	if (!pk.init(vars, degrees))
+		return false;
+
+	const packed_mpoly pa = ex_to_packed_mpoly(a, pk);
+	const packed_mpoly pb = ex_to_packed_mpoly(b, pk);
+	const bool parallel = (options & expand_options::parallel) &&
+	                      numerics_are_immediate(a) && numerics_are_immediate(b);
+	result = packed_mpoly_to_ex(packed_mul(pa, pb, parallel), pk);
+	return true;
+}
+
+bool expand_power_packed(const ex & a, unsigned n, unsigned options, ex & result)
+{
+	GINAC_ASSERT(n > 0);
+	exvector vars;
+	std::vector<unsigned> degrees;
+	if (!packed_mpoly_collect_vars(a, vars, degrees))
+		return false;
+	for (size_t l = 0; l < vars.size(); ++l) {
+		if (degrees[l] > std::numeric_limits<unsigned>::max() / n)
+			return false;
+		degrees[l] *= n;
+	}
+
+	monomial_packing pk;
+	if (!pk.init(vars, degrees))
+		return false;
+
+	// Left-to-right binary exponentiation, so that the odd steps multiply
+	// by the (short) base
+	const packed_mpoly base = ex_to_packed_mpoly(a, pk);
+	// The squarings share no expressions between threads, only packed
+	// terms, so there are no caches to fill in beforehand
+	const bool parallel = (options & expand_options::parallel) != 0;
+	packed_mpoly p = base;
+	unsigned bit = 1;
+	while (bit <= n / 2)
+		bit <<= 1;
+	for (bit >>= 1; bit != 0; bit >>= 1) {
+		check_budget();
+		p = packed_mul(p, p, parallel && coefficients_are_immediate(p));
+		if (n & bit)
+			p = packed_mul(p, base, parallel && coefficients_are_immediate(p) &&
+			                        coefficients_are_immediate(base));
+	}
+	result = packed_mpoly_to_ex(p, pk);
+	return true;
+}
+
+} // namespace GiNaC
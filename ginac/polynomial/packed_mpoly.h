@@ -0,0 +1,145 @@
+/** @file packed_mpoly.h
+ *
+ *  Sparse distributed multivariate polynomials with packed exponent
+ *  vectors. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_PACKED_MPOLY_H
+#define GINAC_PACKED_MPOLY_H
+
+#include "ex.h"
+
+#include <cln/rational.h>
+#include <cstddef>
+#include <vector>
+
+namespace GiNaC {
+
+/** Exponent vector of a monomial, packed into one machine word. */
+typedef unsigned long long packed_monomial;
+
+/**
+ * Layout of packed exponent vectors for a fixed list of variables.
+ *
+ * Every variable gets a bit field which is wide enough to hold the largest
+ * exponent that may occur, so the exponents of a product of monomials are
+ * obtained by simply adding the packed words. The last variable occupies
+ * the most significant bits, hence comparing packed words as unsigned
+ * integers gives a (multiplicative) lexicographic monomial order.
+ */
+class monomial_packing {
+public:
+	/** Set up the bit fields for variables vars, with exponents of the
+	 *  i-th variable not exceeding max_degrees[i]. Returns false if the
+	 *  fields don't fit into a packed_monomial. */
+	bool init(const exvector & vars, const std::vector<unsigned> & max_degrees);
+
+	size_t nvars() const { return vars.size(); }
+	const ex & var(size_t i) const { return vars[i]; }
+
+	packed_monomial pack(size_t i, unsigned deg) const
+	{
+		return packed_monomial(deg) << shift[i];
+	}
+
+	unsigned exponent(packed_monomial m, size_t i) const
+	{
+		return unsigned((m >> shift[i]) & mask[i]);
+	}
+
+	/** Bits occupied by the exponent of the i-th variable. */
+	packed_monomial field(size_t i) const
+	{
+		return mask[i] << shift[i];
+	}
+
+	/** Largest exponent of the i-th variable that can be stored. */
+	unsigned max_exponent(size_t i) const
+	{
+		return unsigned(mask[i]);
+	}
+
+	/** Check whether the monomial a divides the monomial b. */
+	bool divides(packed_monomial a, packed_monomial b) const
+	{
+		for (size_t i = 0; i < vars.size(); ++i)
+			if (exponent(a, i) > exponent(b, i))
+				return false;
+		return true;
+	}
+
+	/** Convert a monomial back to a product of powers of the variables. */
+	ex monomial_to_ex(packed_monomial m) const;
+
+private:
+	exvector vars;
+	std::vector<unsigned> shift;
+	std::vector<packed_monomial> mask;
+};
+
+/** A term of a packed_mpoly. */
+struct packed_term {
+	packed_term() { }
+	packed_term(packed_monomial m, const cln::cl_RA & c) : mon(m), coeff(c) { }
+	packed_monomial mon;
+	cln::cl_RA coeff;
+};
+
+/** Sparse distributed polynomial with rational coefficients. The terms
+ *  are sorted by decreasing monomials and have non-zero coefficients. */
+typedef std::vector<packed_term> packed_mpoly;
+
+/** Product of two packed polynomials, computed with a heap of pairs of
+ *  terms (Johnson's algorithm as refined by Monagan and Pearce), so that
+ *  the terms are generated in order and like terms are combined on the fly.
+ *  The caller must make sure that the exponents of the product fit into
+ *  the bit fields of the packing. */
+packed_mpoly packed_mpoly_mul(const packed_mpoly & a, const packed_mpoly & b);
+
+/** Sum of two packed polynomials (merge of the term lists). */
+packed_mpoly packed_mpoly_add(const packed_mpoly & a, const packed_mpoly & b);
+
+/** Collect the variables (symbols) of a polynomial in expanded form
+ *  together with their maximal degrees. New variables are appended to
+ *  vars, degrees[i] is the degree of e in vars[i]. Returns false if e is
+ *  not a polynomial in symbols with rational coefficients. */
+bool packed_mpoly_collect_vars(const ex & e, exvector & vars, std::vector<unsigned> & degrees);
+
+/** Convert an expanded polynomial e (see packed_mpoly_collect_vars) into
+ *  packed form. */
+packed_mpoly ex_to_packed_mpoly(const ex & e, const monomial_packing & pk);
+
+/** Convert a packed polynomial back into a sum. */
+ex packed_mpoly_to_ex(const packed_mpoly & p, const monomial_packing & pk);
+
+/** Expand the product of two expanded polynomials a and b in packed form.
+ *  Returns false, without touching result, if that is not possible (if a
+ *  or b are not polynomials in symbols with rational coefficients, or if
+ *  the exponents of the product don't fit into a packed_monomial). */
+bool expand_product_packed(const ex & a, const ex & b, unsigned options, ex & result);
+
+/** Expand a^n for an expanded polynomial a and n > 0 in packed form, by
+ *  repeated squaring. Returns false, without touching result, under the
+ *  same conditions as expand_product_packed(). */
+bool expand_power_packed(const ex & a, unsigned n, unsigned options, ex & result);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_PACKED_MPOLY_H
@@ -27,11 +27,17 @@
 #include "eval_point_finder.h"
 #include "newton_interpolate.h"
 #include "divide_in_z_p.h"
+#include "budget.h"
+
+#include <set>
 
 namespace GiNaC {
 
 extern void
 primpart_content(ex& pp, ex& c, ex e, const exvector& vars, const long p);
+extern void
+primpart_content(zp_mpoly& pp, zp_upoly& c, const zp_mpoly& e,
+		 const size_t var, const monomial_packing& pk, const long p);
 
 // Computes the GCD of two polynomials over a prime field.
 // Based on Algorithm 7.2 from "Algorithms for Computer Algebra"
@@ -153,4 +159,502 @@ ex pgcd(const ex& A, const ex& B, const exvector& vars, const long p)
 	throw pgcd_failed();
 }
 
+static long expt_mod(long a, unsigned e, const long p)
+{
+	long r = 1;
+	while (e != 0) {
+		if (e & 1)
+			r = mul_mod(r, a, p);
+		a = mul_mod(a, a, p);
+		e >>= 1;
+	}
+	return r;
+}
+
+/** Value of the monomial m with x_0 left out, for x_i = vals[i-1]. */
+static long monomial_value(const packed_monomial m, const std::vector<long>& vals,
+			   const monomial_packing& pk, const long p)
+{
+	long r = 1;
+	for (std::size_t i = 0; i < vals.size(); ++i)
+		r = mul_mod(r, expt_mod(vals[i], pk.exponent(m, i + 1), p), p);
+	return r;
+}
+
+/**
+ * Gauss-Jordan elimination mod p on the first ncols columns of the rows
+ * M. Returns the rank; the pivot rows come first, with 1 in the pivot
+ * column i and 0 in all other pivot columns.
+ */
+static std::size_t eliminate(std::vector<zp_upoly>& M, const std::size_t ncols, const long p)
+{
+	std::size_t rank = 0;
+	for (std::size_t col = 0; col < ncols && rank < M.size(); ++col) {
+		std::size_t piv = rank;
+		while (piv < M.size() && M[piv][col] == 0)
+			++piv;
+		if (piv == M.size())
+			continue;
+		M[rank].swap(M[piv]);
+		zp_upoly& row = M[rank];
+		const long inv = recip_mod(row[col], p);
+		for (std::size_t j = col; j < row.size(); ++j)
+			row[j] = mul_mod(row[j], inv, p);
+		for (std::size_t i = 0; i < M.size(); ++i) {
+			if (i == rank || M[i][col] == 0)
+				continue;
+			const long f = M[i][col];
+			for (std::size_t j = col; j < row.size(); ++j)
+				M[i][j] = sub_mod(M[i][j], mul_mod(f, row[j], p), p);
+		}
+		++rank;
+	}
+	return rank;
+}
+
+/**
+ * Image of gcd(A, B), A, B \in Z_p[x_0, \ldots, x_n], by sparse (Zippel)
+ * interpolation: assume that the GCD has the monomials of skel, evaluate
+ * x_1, \ldots, x_n at random points, and recover the coefficients from
+ * the univariate GCDs in x_0 by linear algebra. Each univariate image is
+ * only known up to a factor (the leading coefficient in x_0 is not known
+ * in advance), so these factors are unknowns too; they are eliminated
+ * first, which keeps the systems as small as the groups of monomials of
+ * the same degree in x_0. The result is normalized so that its leading
+ * coefficient is lc.
+ *
+ * Returns an empty polynomial if the assumption turns out to be wrong or
+ * the system can't be solved. The result is not checked otherwise, that
+ * is left to the trial division done by the caller.
+ */
+static zp_mpoly zippel_image(const zp_mpoly& A, const zp_mpoly& B, const zp_mpoly& skel,
+			     const std::size_t n, const long lc, const monomial_packing& pk,
+			     const long p, cln::random_state& rs)
+{
+	// The monomials of the skeleton, grouped by their degree in x_0
+	std::vector<std::vector<std::size_t> > blocks;
+	for (std::size_t i = 0; i < skel.size(); ++i) {
+		const unsigned k = pk.exponent(skel[i].mon, 0);
+		if (blocks.size() <= k)
+			blocks.resize(k + 1);
+		blocks[k].push_back(i);
+	}
+	std::size_t nblocks = 0, max_block = 0;
+	for (std::size_t k = 0; k < blocks.size(); ++k) {
+		if (!blocks[k].empty())
+			++nblocks;
+		max_block = std::max(max_block, blocks[k].size());
+	}
+	// With a single block the factors can't be told apart from the
+	// coefficients
+	if (nblocks < 2)
+		return zp_mpoly();
+	// Number of images: each block gives (images - block size) equations
+	// for the factors, which have to determine all of them (one extra
+	// image for checking the result)
+	const std::size_t T = std::max(max_block, (skel.size() + nblocks - 3)/(nblocks - 1)) + 1;
+
+	unsigned degA = 0, degB = 0;
+	for (std::size_t i = 0; i < A.size(); ++i)
+		degA = std::max(degA, pk.exponent(A[i].mon, 0));
+	for (std::size_t i = 0; i < B.size(); ++i)
+		degB = std::max(degB, pk.exponent(B[i].mon, 0));
+
+	// Points and the monic univariate GCDs there
+	std::vector<std::vector<long> > pts;
+	std::vector<zp_upoly> images;
+	// The points are drawn in batches, and A and B evaluated at all points
+	// of a batch at once
+	std::vector<std::vector<long> > batch;
+	std::vector<zp_upoly> a_batch, b_batch;
+	std::size_t tries = 0;
+	while (images.size() < T) {
+		if (tries > 2*T + 10)
+			return zp_mpoly();
+		batch.assign(T - images.size(), std::vector<long>(n));
+		for (std::size_t j = 0; j < batch.size(); ++j)
+			for (std::size_t i = 0; i < n; ++i)
+				batch[j][i] = cln::cl_I_to_long(cln::random_I(rs, cln::cl_I(p)));
+		tries += batch.size();
+		zp_mpoly_eval_points_but_x0(A, batch, pk, p, a_batch);
+		zp_mpoly_eval_points_but_x0(B, batch, pk, p, b_batch);
+		for (std::size_t j = 0; j < batch.size(); ++j) {
+			const zp_upoly& a = a_batch[j];
+			const zp_upoly& b = b_batch[j];
+			// Leading coefficients in x_0 must not vanish
+			if (a.size() != degA + 1 || b.size() != degB + 1)
+				continue;
+			const zp_upoly g = zp_upoly_gcd(a, b, p);
+			// The image must fit the skeleton (otherwise either the
+			// point or the skeleton is bad)
+			if (g.size() != blocks.size())
+				return zp_mpoly();
+			for (std::size_t k = 0; k < g.size(); ++k)
+				if (g[k] != 0 && blocks[k].empty())
+					return zp_mpoly();
+			pts.push_back(batch[j]);
+			images.push_back(g);
+		}
+	}
+
+	// For the block k, row j reads
+	//   \sum_{s \in block} c_s s(pts[j]) - m_j images[j][k] == 0,
+	// where m_j are the unknown factors. After elimination of the c_s the
+	// rows beyond the block size only contain the m_j.
+	std::vector<std::vector<zp_upoly> > reduced(blocks.size());
+	std::vector<zp_upoly> mrows;
+	for (std::size_t k = 0; k < blocks.size(); ++k) {
+		const std::vector<std::size_t>& blk = blocks[k];
+		if (blk.empty())
+			continue;
+		const std::size_t r = blk.size();
+		std::vector<zp_upoly>& M = reduced[k];
+		M.assign(T, zp_upoly(r + T, 0));
+		for (std::size_t j = 0; j < T; ++j) {
+			for (std::size_t l = 0; l < r; ++l)
+				M[j][l] = monomial_value(skel[blk[l]].mon, pts[j], pk, p);
+			M[j][r + j] = images[j][k] == 0 ? 0 : p - images[j][k];
+		}
+		if (eliminate(M, r, p) < r)
+			return zp_mpoly(); // bad points
+		for (std::size_t j = r; j < T; ++j)
+			mrows.push_back(zp_upoly(M[j].begin() + r, M[j].end()));
+	}
+
+	// Normalization: the coefficient of the leading monomial skel[0] is
+	// lc. Pivot row l of a block gives c_l = -\sum w_j m_j.
+	const std::size_t k0 = pk.exponent(skel[0].mon, 0);
+	const std::size_t l0 = std::find(blocks[k0].begin(), blocks[k0].end(), 0) - blocks[k0].begin();
+	const std::size_t r0 = blocks[k0].size();
+	zp_upoly norm(T + 1, 0);
+	for (std::size_t j = 0; j < T; ++j) {
+		const long w = reduced[k0][l0][r0 + j];
+		norm[j] = w == 0 ? 0 : p - w;
+	}
+	norm[T] = lc;
+	for (std::size_t i = 0; i < mrows.size(); ++i)
+		mrows[i].push_back(0);
+	mrows.push_back(norm);
+
+	// Solve for the factors, any remaining rows must be zero
+	if (eliminate(mrows, T, p) < T)
+		return zp_mpoly();
+	for (std::size_t i = T; i < mrows.size(); ++i)
+		if (mrows[i][T] != 0)
+			return zp_mpoly();
+	zp_upoly m(T);
+	for (std::size_t j = 0; j < T; ++j) {
+		if (mrows[j][T] == 0)
+			return zp_mpoly();
+		m[j] = mrows[j][T];
+	}
+
+	// Coefficients from the pivot rows
+	zp_mpoly res;
+	res.reserve(skel.size());
+	std::vector<long> coeffs(skel.size());
+	for (std::size_t k = 0; k < blocks.size(); ++k) {
+		const std::vector<std::size_t>& blk = blocks[k];
+		for (std::size_t l = 0; l < blk.size(); ++l) {
+			long c = 0;
+			for (std::size_t j = 0; j < T; ++j)
+				c = sub_mod(c, mul_mod(reduced[k][l][blk.size() + j], m[j], p), p);
+			coeffs[blk[l]] = c;
+		}
+	}
+	for (std::size_t i = 0; i < skel.size(); ++i)
+		if (coeffs[i] != 0)
+			res.push_back(sparse_term<long>(skel[i].mon, coeffs[i]));
+	return res;
+}
+
+/** Check whether all monomials of a occur in skel. */
+static bool fits_skeleton(const zp_mpoly& a, const zp_mpoly& skel)
+{
+	std::size_t j = 0;
+	for (std::size_t i = 0; i < a.size(); ++i) {
+		while (j < skel.size() && skel[j].mon > a[i].mon)
+			++j;
+		if (j == skel.size() || skel[j].mon != a[i].mon)
+			return false;
+	}
+	return true;
+}
+
+/** Union of the monomials of a and skel. */
+static zp_mpoly merge_skeleton(const zp_mpoly& a, const zp_mpoly& skel)
+{
+	zp_mpoly r;
+	std::size_t i = 0, j = 0;
+	while (i < a.size() || j < skel.size()) {
+		if (j == skel.size() || (i < a.size() && a[i].mon > skel[j].mon))
+			r.push_back(sparse_term<long>(a[i++].mon, 1));
+		else {
+			if (i < a.size() && a[i].mon == skel[j].mon)
+				++i;
+			r.push_back(sparse_term<long>(skel[j++].mon, 1));
+		}
+	}
+	return r;
+}
+
+/// Largest number of evaluation points handled at once by pgcd().
+static const std::size_t max_eval_batch = 16;
+
+/**
+ * Draw up to n evaluation points for pgcd() which are not in used yet (and
+ * add them there). Keep those which are not roots of lc, and evaluate lc,
+ * A and B at them, at all points at once. Returns false if all points of
+ * Z_p have been used.
+ */
+static bool eval_point_batch(std::vector<long>& pts, std::vector<long>& lc_vals,
+			     std::vector<zp_mpoly>& Ab, std::vector<zp_mpoly>& Bb,
+			     const zp_mpoly& A, const zp_mpoly& B, const zp_upoly& lc,
+			     std::set<long>& used, const std::size_t n, const size_t var,
+			     const monomial_packing& pk, const long p, cln::random_state& rs)
+{
+	std::vector<long> cand;
+	while (cand.size() < n && used.size() < std::size_t(p)) {
+		const long b = cln::cl_I_to_long(cln::random_I(rs, cln::cl_I(p)));
+		if (used.insert(b).second)
+			cand.push_back(b);
+	}
+	if (cand.empty())
+		return false;
+
+	std::vector<long> v;
+	zp_upoly_eval_points(lc, cand, p, v);
+	pts.clear();
+	lc_vals.clear();
+	for (std::size_t j = 0; j < cand.size(); ++j) {
+		if (v[j] == 0)
+			continue;
+		pts.push_back(cand[j]);
+		lc_vals.push_back(v[j]);
+	}
+	zp_mpoly_eval_points(A, var, pts, pk, p, Ab);
+	zp_mpoly_eval_points(B, var, pts, pk, p, Bb);
+	return true;
+}
+
+/**
+ * Upper bound for the degree of gcd(A, B) in x_var: the degree of the GCD
+ * of the univariate images at a random point of x_0, ..., x_{var-1} where
+ * the leading coefficients in x_var (of degrees degA and degB) don't
+ * vanish. Two such points are tried; if none is found, fallback is
+ * returned.
+ */
+static std::size_t gcd_degree_bound(const zp_mpoly& A, const zp_mpoly& B, const size_t var,
+				    const std::size_t degA, const std::size_t degB,
+				    const monomial_packing& pk, const long p,
+				    cln::random_state& rs, const std::size_t fallback)
+{
+	std::size_t bound = fallback;
+	std::vector<long> vals(var);
+	for (int tries = 0, found = 0; tries < 4 && found < 2; ++tries) {
+		for (std::size_t i = 0; i < var; ++i)
+			vals[i] = cln::cl_I_to_long(cln::random_I(rs, cln::cl_I(p)));
+		zp_upoly a(degA + 1, 0), b(degB + 1, 0);
+		for (std::size_t i = 0; i < A.size(); ++i) {
+			long v = A[i].coeff;
+			for (std::size_t k = 0; k < var; ++k)
+				v = mul_mod(v, expt_mod(vals[k], pk.exponent(A[i].mon, k), p), p);
+			const unsigned e = pk.exponent(A[i].mon, var);
+			a[e] = add_mod(a[e], v, p);
+		}
+		for (std::size_t i = 0; i < B.size(); ++i) {
+			long v = B[i].coeff;
+			for (std::size_t k = 0; k < var; ++k)
+				v = mul_mod(v, expt_mod(vals[k], pk.exponent(B[i].mon, k), p), p);
+			const unsigned e = pk.exponent(B[i].mon, var);
+			b[e] = add_mod(b[e], v, p);
+		}
+		if (a.back() == 0 || b.back() == 0)
+			continue;
+		++found;
+		bound = std::min(bound, zp_upoly_gcd(a, b, p).size() - 1);
+	}
+	return bound;
+}
+
+// The same algorithm for polynomials in sparse form. The main variable
+// x_n is the variable var of the packing, x_0, \ldots, x_{n-1} are the
+// variables before it.
+zp_mpoly pgcd(const zp_mpoly& A, const zp_mpoly& B, const size_t var,
+	      const monomial_packing& pk, const long p, const bool sparse_interp,
+	      cln::random_state& rs)
+{
+	if (A.empty())
+		return B;
+
+	if (B.empty())
+		return A;
+
+	const zp_mpoly one(1, sparse_term<long>(0, 1));
+	if (A.size() == 1 && A[0].mon == 0)
+		return one;
+
+	if (B.size() == 1 && B[0].mon == 0)
+		return one;
+
+	// Contents and primparts of A and B
+	zp_mpoly Aprim, Bprim;
+	zp_upoly contA, contB;
+	primpart_content(Aprim, contA, A, var, pk, p);
+	primpart_content(Bprim, contB, B, var, pk, p);
+	// gcd of univariate polynomials
+	const zp_upoly cont_gcd = zp_upoly_gcd(contA, contB, p);
+
+	// Checks for univariate polynomial
+	if (var == 0)
+		return zp_mpoly_mul_upoly(one, cont_gcd, var, pk, p);
+
+	zp_mpoly_coeffs Ac, Bc;
+	zp_mpoly_split(Aprim, var, pk, Ac);
+	zp_mpoly_split(Bprim, var, pk, Bc);
+	// gcd of univariate polynomials
+	const zp_upoly lc_gcd = zp_upoly_gcd(Ac[0].second, Bc[0].second, p);
+
+	// The estimate of degree of the gcd of Ab and Bb
+	packed_monomial gcd_deg = std::min(Ac[0].first, Bc[0].first);
+
+	// The GCD normalized to leading coefficient lc_gcd has degree less
+	// than max_points in the main variable. This also keeps the exponents
+	// of the candidates within the bit fields of the packing.
+	std::size_t degA = 0, degB = 0;
+	for (std::size_t i = 0; i < Ac.size(); ++i)
+		degA = std::max(degA, Ac[i].second.size() - 1);
+	for (std::size_t i = 0; i < Bc.size(); ++i)
+		degB = std::max(degB, Bc[i].second.size() - 1);
+	const std::size_t max_points = std::min(degA, degB) + lc_gcd.size();
+	// Images at random points give a tighter bound, usually the exact
+	// degree: with that many points the candidate is complete
+	const std::size_t needed_points =
+		gcd_degree_bound(Aprim, Bprim, var, degA, degB, pk, p, rs,
+				 std::min(degA, degB)) + lc_gcd.size();
+	// Number of points in a row at which the candidate didn't change
+	unsigned unchanged = 0;
+
+	zp_mpoly H;             // GCD candidate
+	zp_upoly newton_poly(1, 1); // for Newton Interpolation
+	// Monomials of the images, for sparse interpolation
+	zp_mpoly skeleton;
+	const bool use_skeleton = sparse_interp && var >= 2;
+	std::set<long> points;
+	// Evaluation points are drawn and A, B evaluated at them in batches,
+	// which grow while more points are needed
+	std::vector<long> batch, lc_batch;
+	std::vector<zp_mpoly> A_batch, B_batch;
+	std::size_t next = 0, batch_size = 1;
+	while (true) {
+		check_budget();
+		if (next == batch.size()) {
+			if (!eval_point_batch(batch, lc_batch, A_batch, B_batch, Aprim, Bprim,
+					      lc_gcd, points, batch_size, var, pk, p, rs))
+				break;
+			next = 0;
+			batch_size = std::min(2*batch_size, max_eval_batch);
+			continue;
+		}
+		const long b = batch[next];
+		const long lcb_gcd = lc_batch[next];
+		const zp_mpoly& Ab = A_batch[next];
+		const zp_mpoly& Bb = B_batch[next];
+		++next;
+
+		zp_mpoly Cb;
+		if (!skeleton.empty())
+			Cb = zippel_image(Ab, Bb, skeleton, var - 1, lcb_gcd, pk, p, rs);
+		const bool dense_image = Cb.empty();
+		if (dense_image) {
+			Cb = pgcd(Ab, Bb, var - 1, pk, p, sparse_interp, rs);
+
+			// Set the correct the leading coefficient
+			zp_mpoly_scale(Cb, mul_mod(lcb_gcd, recip_mod(Cb[0].coeff, p), p), p);
+		}
+
+		const packed_monomial img_gcd_deg = Cb[0].mon;
+		// Test for relatively prime polynomials
+		if (img_gcd_deg == 0)
+			return zp_mpoly_mul_upoly(one, cont_gcd, var, pk, p);
+		// Test for unlucky homomorphisms
+		if (img_gcd_deg < gcd_deg) {
+			// The degree decreased, previous homomorphisms were
+			// bad, so we have to start it all over.
+			if (use_skeleton)
+				skeleton = Cb;
+			H.swap(Cb);
+			unchanged = 0;
+			newton_poly.resize(2);
+			newton_poly[0] = p - b;
+			newton_poly[1] = 1;
+			gcd_deg = img_gcd_deg;
+			continue;
+		}
+		if (img_gcd_deg > gcd_deg) {
+			// The degree of images GCD is too high, this
+			// evaluation point is bad. Skip it.
+			continue;
+		}
+		if (use_skeleton && dense_image) {
+			if (skeleton.empty())
+				skeleton = Cb;
+			else if (!fits_skeleton(Cb, skeleton)) {
+				// Some monomials were missing in the image the
+				// skeleton came from, the previous (sparse)
+				// images are wrong.
+				skeleton = merge_skeleton(Cb, skeleton);
+				H.swap(Cb);
+				unchanged = 0;
+				newton_poly.resize(2);
+				newton_poly[0] = p - b;
+				newton_poly[1] = 1;
+				continue;
+			}
+		}
+
+		// Image has the same degree as the previous one
+		// (or at least not higher than the limit)
+		if (newton_interp_update(H, Cb, b, newton_poly, var, pk, p))
+			unchanged = 0;
+		else
+			++unchanged;
+		zp_upoly x_minus_b(2, 1);
+		x_minus_b[0] = p - b;
+		newton_poly = zp_upoly_mul(newton_poly, x_minus_b, p);
+		const std::size_t npoints = newton_poly.size() - 1;
+
+		// Trial division is tried as soon as the candidate agrees with
+		// the image at a new point, or when the degree bound says that
+		// it is complete; not after every point.
+		if (unchanged == 0 && npoints < needed_points)
+			continue;
+		zp_mpoly_coeffs Hc;
+		zp_mpoly_split(H, var, pk, Hc);
+
+		if (Hc[0].second == lc_gcd) {
+			zp_mpoly C; // primitive part of H
+			zp_upoly contH;
+			primpart_content(C, contH, H, var, pk, p);
+			// Normalize GCD so that leading coefficient is 1
+			zp_mpoly_scale(C, recip_mod(C[0].coeff, p), p);
+
+			zp_mpoly dummy;
+			if (zp_mpoly_divide(Aprim, C, dummy, pk, p) &&
+					zp_mpoly_divide(Bprim, C, dummy, pk, p))
+				return zp_mpoly_mul_upoly(C, cont_gcd, var, pk, p);
+			// else continue building the candidate
+		}
+		// As many points as the degree of the GCD requires: some of
+		// them were bad, so we have to start it all over.
+		if (npoints >= std::min(needed_points, max_points + 1)) {
+			H.clear();
+			newton_poly.assign(1, 1);
+			skeleton.clear();
+			unchanged = 0;
+		}
+	}
+	throw pgcd_failed();
+}
+
 } // namespace GiNaC
@@ -24,6 +24,9 @@
 #define GINAC_CHINREM_GCD_PGCD_H
 
 #include "ex.h"
+#include "sparse_mpoly.h"
+
+#include <cln/random.h>
 
 namespace GiNaC {
 
@@ -44,6 +47,24 @@ struct pgcd_failed
 extern ex
 pgcd(const ex& A, const ex& B, const exvector& vars, const long p);
 
+/**
+ * @brief Same as above, for polynomials in sparse form
+ *
+ * @param var A, B \in Z_p[x_0, \ldots, x_var], where x_i is the i-th
+ *        variable of the packing pk
+ * @param sparse_interp compute the images after the first one by Zippel's
+ *        sparse interpolation, using the monomials of the first one
+ *        (instead of dense interpolation in every variable)
+ * @param rs source of the evaluation points. Apart from the default, this
+ *        function uses no global state, so it may be called by several
+ *        threads at once if each of them has its own rs.
+ * @return GCD with leading coefficient 1 (if A and B are not zero)
+ */
+extern zp_mpoly
+pgcd(const zp_mpoly& A, const zp_mpoly& B, const std::size_t var,
+     const monomial_packing& pk, const long p, const bool sparse_interp = false,
+     cln::random_state& rs = cln::default_random_state);
+
 } // namespace GiNaC
 
 #endif // ndef GINAC_CHINREM_GCD_PGCD_H
@@ -25,7 +25,9 @@
 
 #include "ex.h"
 #include "smod_helpers.h"
+#include "sparse_mpoly.h"
 
+#include <algorithm>
 #include <cln/integer.h>
 
 namespace GiNaC {
@@ -38,8 +40,8 @@ namespace GiNaC {
  * \f$r \in Z_{q_1 q_2}[x_1, \ldots, x_n]\f$ such that \f$ r mod q_1 = e_1\f$
  * and \f$ r mod q_2 = e_2 \f$ 
  */
-ex chinese_remainder(const ex& e1, const cln::cl_I& q1,
-		     const ex& e2, const long q2)
+inline ex chinese_remainder(const ex& e1, const cln::cl_I& q1,
+			    const ex& e2, const long q2)
 {
 	// res = v_1 + v_2 q_1
 	// v_1 = e_1 mod q_1
@@ -55,6 +57,48 @@ ex chinese_remainder(const ex& e1, const cln::cl_I& q1,
 	return ret;
 }
 
+/**
+ * Same as above, for polynomials in sparse form. e1 must be reduced mod q1
+ * (in the symmetric representation).
+ */
+inline z_mpoly chinese_remainder(const z_mpoly& e1, const cln::cl_I& q1,
+				 const zp_mpoly& e2, const long q2)
+{
+	const long q1_1 = recip_mod(to_mod(q1, q2), q2); // 1/q_1 mod q_2
+	z_mpoly ret;
+	ret.reserve(std::max(e1.size(), e2.size()));
+	z_mpoly::const_iterator i = e1.begin();
+	zp_mpoly::const_iterator j = e2.begin();
+	while (i != e1.end() || j != e2.end()) {
+		packed_monomial m;
+		cln::cl_I v1 = 0;
+		long u2 = 0;
+		if (j == e2.end() || (i != e1.end() && i->mon > j->mon)) {
+			m = i->mon;
+			v1 = i->coeff;
+			++i;
+		} else if (i == e1.end() || i->mon < j->mon) {
+			m = j->mon;
+			u2 = j->coeff;
+			++j;
+		} else {
+			m = i->mon;
+			v1 = i->coeff;
+			u2 = j->coeff;
+			++i;
+			++j;
+		}
+		// v_2 = (e_2 - v_1)/q_1 mod q_2
+		long v2 = mul_mod(sub_mod(u2, to_mod(v1, q2), q2), q1_1, q2);
+		if (v2 > (q2 >> 1))
+			v2 -= q2;
+		const cln::cl_I c = v1 + cln::cl_I(v2)*q1;
+		if (!cln::zerop(c))
+			ret.push_back(sparse_term<cln::cl_I>(m, c));
+	}
+	return ret;
+}
+
 } // namespace GiNaC
 
 #endif // ndef GINAC_POLY_CRA_H
@@ -0,0 +1,147 @@
+/** @file prime_table.cpp
+ *
+ *  Table of word-sized primes for modular algorithms, with constants for
+ *  Montgomery multiplication and primitive roots. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "prime_table.h"
+
+#include <algorithm>
+
+namespace GiNaC {
+
+// The primes c*2^k + 1 with 2^28 < p < 2^30 and k >= 20. The constants were
+// computed with exact integer arithmetic; the primitive roots g satisfy
+// g^((p-1)/q) != 1 for all prime factors q of p - 1.
+const word_prime word_primes[] = {
+	{ 1053818881, 0x3ecfffffu,  79691772, 159648582,  7, 20 },  // 1005*2^20+1
+	{ 1051721729, 0x3eafffffu,  88080380, 748646691,  6, 20 },  // 1003*2^20+1
+	{ 1045430273, 0x3e4fffffu, 113246204, 798281873,  3, 20 },  // 997*2^20+1
+	{ 1012924417, 0x3c5fffffu, 243269628, 818184550,  5, 21 },  // 483*2^21+1
+	{ 1007681537, 0x3c0fffffu, 264241148, 986624927,  3, 20 },  // 961*2^20+1
+	{ 1004535809, 0x3bdfffffu, 276824060, 542374313,  3, 21 },  // 479*2^21+1
+	{  998244353, 0x3b7fffffu, 301989884, 932051910,  3, 23 },  // 119*2^23+1
+	{  985661441, 0x3abfffffu, 352321532, 616455619,  3, 22 },  // 235*2^22+1
+	{  976224257, 0x3a2fffffu, 390070268, 478527983,  3, 20 },  // 931*2^20+1
+	{  975175681, 0x3a1fffffu, 394264572, 603961756, 17, 21 },  // 465*2^21+1
+	{  972029953, 0x39efffffu, 406847484, 929668407, 10, 20 },  // 927*2^20+1
+	{  962592769, 0x395fffffu, 444596220, 639805001,  7, 21 },  // 459*2^21+1
+	{  957349889, 0x390fffffu, 465567740, 218186520,  6, 20 },  // 913*2^20+1
+	{  950009857, 0x389fffffu, 494927868, 612474883,  7, 21 },  // 453*2^21+1
+	{  943718401, 0x383fffffu, 520093692, 917135855,  7, 22 },  // 225*2^22+1
+	{  940572673, 0x380fffffu, 532676604, 285530656,  7, 20 },  // 897*2^20+1
+	{  938475521, 0x37efffffu, 541065212, 655891925,  3, 20 },  // 895*2^20+1
+	{  935329793, 0x37bfffffu, 553648124,  53961717,  3, 22 },  // 223*2^22+1
+	{  925892609, 0x372fffffu, 591396860, 726406687,  3, 20 },  // 883*2^20+1
+	{  924844033, 0x371fffffu, 595591164, 404973864,  5, 21 },  // 441*2^21+1
+	{  919601153, 0x36cfffffu, 616562684, 883703289,  3, 20 },  // 877*2^20+1
+	{  918552577, 0x36bfffffu, 620756988, 394187990,  5, 22 },  // 219*2^22+1
+	{  913309697, 0x366fffffu, 641728508, 136298048,  3, 20 },  // 871*2^20+1
+	{  907018241, 0x360fffffu, 666894332, 147193424,  3, 20 },  // 865*2^20+1
+	{  899678209, 0x359fffffu, 696254460, 620898781,  7, 21 },  // 429*2^21+1
+	{  897581057, 0x357fffffu, 704643068, 780610957,  3, 23 },  // 107*2^23+1
+	{  883949569, 0x34afffffu, 759169020, 693320217,  7, 20 },  // 843*2^20+1
+	{  880803841, 0x347fffffu, 771751932, 464649016, 26, 23 },  // 105*2^23+1
+	{  862978049, 0x336fffffu, 843055100, 595131247,  3, 20 },  // 823*2^20+1
+	{  850395137, 0x32afffffu,  42991611,  61789726,  3, 20 },  // 811*2^20+1
+	{  833617921, 0x31afffffu, 126877691, 317281978, 13, 20 },  // 795*2^20+1
+	{  824180737, 0x311fffffu, 174063611, 730796133,  5, 21 },  // 393*2^21+1
+	{  818937857, 0x30cfffffu, 200278011, 271884641,  5, 20 },  // 781*2^20+1
+	{  802160641, 0x2fcfffffu, 284164091,  15727298, 11, 20 },  // 765*2^20+1
+	{  800063489, 0x2fafffffu, 294649851, 413676317,  3, 20 },  // 763*2^20+1
+	{  799014913, 0x2f9fffffu, 299892731,  88768455, 13, 21 },  // 381*2^21+1
+	{  786432001, 0x2edfffffu, 362807291, 310775587,  7, 21 },  // 375*2^21+1
+	{  770703361, 0x2defffffu, 441450491, 115192168, 11, 20 },  // 735*2^20+1
+	{  754974721, 0x2cffffffu, 520093691, 749009521, 11, 24 },  // 45*2^24+1
+	{  745537537, 0x2c6fffffu, 567279611, 307602974,  5, 20 },  // 711*2^20+1
+	{  740294657, 0x2c1fffffu, 593494011, 621006546,  3, 21 },  // 353*2^21+1
+	{  718274561, 0x2acfffffu, 703594491, 538668070,  3, 20 },  // 685*2^20+1
+	{  715128833, 0x2a9fffffu,   4194298, 681549837,  3, 21 },  // 341*2^21+1
+	{  710934529, 0x2a5fffffu,  29360122, 116228036, 17, 21 },  // 339*2^21+1
+	{  683671553, 0x28bfffffu, 192937978, 515976628,  3, 22 },  // 163*2^22+1
+	{  666894337, 0x27bfffffu, 293601274, 453749873,  5, 22 },  // 159*2^22+1
+	{  655360001, 0x270fffffu, 362807290,  75973988,  3, 20 },  // 625*2^20+1
+	{  648019969, 0x269fffffu, 406847482, 189164512, 17, 21 },  // 309*2^21+1
+	{  645922817, 0x267fffffu, 419430394, 247736338,  3, 23 },  // 77*2^23+1
+	{  639631361, 0x261fffffu, 457179130,  33939528,  6, 21 },  // 305*2^21+1
+	{  635437057, 0x25dfffffu, 482344954, 380449720, 11, 21 },  // 303*2^21+1
+	{  605028353, 0x240fffffu,  59768825, 580249662,  3, 20 },  // 577*2^20+1
+	{  597688321, 0x239fffffu, 111149049, 484743860, 11, 21 },  // 285*2^21+1
+	{  595591169, 0x237fffffu, 125829113, 535453172,  3, 23 },  // 71*2^23+1
+	{  581959681, 0x22afffffu, 221249529, 578585399, 11, 20 },  // 555*2^20+1
+	{  576716801, 0x225fffffu, 257949689, 327125264,  6, 21 },  // 275*2^21+1
+	{  531628033, 0x1fafffffu,  41943032, 166560262,  5, 20 },  // 507*2^20+1
+	{  493879297, 0x1d6fffffu, 343932920, 232347598, 10, 20 },  // 471*2^20+1
+	{  469762049, 0x1bffffffu,  67108855, 460175152,  3, 26 },  // 7*2^26+1
+	{  468713473, 0x1befffffu,  76546039, 359743756,  5, 20 },  // 447*2^20+1
+	{  463470593, 0x1b9fffffu, 123731959, 216528658,  3, 21 },  // 221*2^21+1
+	{  459276289, 0x1b5fffffu, 161480695,  60664279, 11, 21 },  // 219*2^21+1
+	{  447741953, 0x1aafffffu, 265289719,  18975143,  3, 20 },  // 427*2^20+1
+	{  415236097, 0x18bfffffu, 142606326, 160739394,  5, 22 },  // 99*2^22+1
+	{  409993217, 0x186fffffu, 195035126, 372788992,  3, 20 },  // 391*2^20+1
+	{  399507457, 0x17cfffffu, 299892726, 173342664,  5, 20 },  // 381*2^20+1
+	{  387973121, 0x171fffffu,  27262965,  54707450,  6, 21 },  // 185*2^21+1
+	{  383778817, 0x16dfffffu,  73400309, 124373845,  5, 21 },  // 183*2^21+1
+	{  377487361, 0x167fffffu, 142606325,  97121569,  7, 23 },  // 45*2^23+1
+	{  361758721, 0x158fffffu, 315621365,  17184630, 29, 20 },  // 345*2^20+1
+	{  359661569, 0x156fffffu, 338690037, 198006754,  3, 20 },  // 343*2^20+1
+	{  347078657, 0x14afffffu, 130023412, 127451240,  3, 20 },  // 331*2^20+1
+	{  330301441, 0x13afffffu,   1048563, 241169321, 22, 20 },  // 315*2^20+1
+	{  311427073, 0x128fffffu, 246415347,  93383474,  7, 20 },  // 297*2^20+1
+	{  305135617, 0x122fffffu,  23068658,  58025007,  5, 20 },  // 291*2^20+1
+	{  290455553, 0x114fffffu, 228589554, 172420940,  3, 20 },  // 277*2^20+1
+	{  274726913, 0x105fffffu, 174063601, 197997008,  3, 21 },  // 131*2^21+1
+	{  270532609, 0x101fffffu, 236978161, 262176767, 22, 21 },  // 129*2^21+1
+};
+
+const std::size_t word_primes_count = sizeof(word_primes)/sizeof(word_primes[0]);
+
+uint32_t word_prime::expt(uint32_t a, uint64_t e) const
+{
+	uint32_t r = r1;
+	while (e) {
+		if (e & 1)
+			r = mul(r, a);
+		a = mul(a, a);
+		e >>= 1;
+	}
+	return r;
+}
+
+uint32_t word_prime::root_of_unity(unsigned j) const
+{
+	return expt(to_montgomery(root), (p - 1) >> j);
+}
+
+static bool greater_prime(const word_prime& a, long p)
+{
+	return long(a.p) > p;
+}
+
+const word_prime* find_word_prime(long p)
+{
+	const word_prime* end = word_primes + word_primes_count;
+	const word_prime* i = std::lower_bound(word_primes, end, p, greater_prime);
+	if (i != end && long(i->p) == p)
+		return i;
+	return 0;
+}
+
+} // namespace GiNaC
@@ -0,0 +1,91 @@
+/** @file prime_table.h
+ *
+ *  Table of word-sized primes for modular algorithms, with constants for
+ *  Montgomery multiplication and primitive roots. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_PRIME_TABLE_H
+#define GINAC_PRIME_TABLE_H
+
+#include <cstddef>
+#include <stdint.h> // for uint32_t, uint64_t
+
+namespace GiNaC {
+
+/** Montgomery reduction: returns t*2^(-32) mod p for t < p*2^32, p being
+ *  odd and pinv = -p^(-1) mod 2^32. */
+inline uint32_t montgomery_reduce(uint64_t t, uint32_t p, uint32_t pinv)
+{
+	const uint32_t m = static_cast<uint32_t>(t) * pinv;
+	const uint64_t u = (t + uint64_t(m) * p) >> 32;
+	return static_cast<uint32_t>(u >= p ? u - p : u);
+}
+
+/**
+ * A prime p = c*2^k + 1 below 2^30 with the constants needed to compute
+ * modulo p in a machine word. Products are reduced by Montgomery's method:
+ * x is represented by x*2^32 mod p, and mul() of two representatives gives
+ * the representative of the product. The large power of two dividing p - 1
+ * makes p suitable for number theoretic transforms of length up to 2^k.
+ */
+struct word_prime
+{
+	uint32_t p;
+	uint32_t pinv;         ///< -p^(-1) mod 2^32
+	uint32_t r1;           ///< 2^32 mod p, the representative of 1
+	uint32_t r2;           ///< 2^64 mod p, converts to the representation
+	uint32_t root;         ///< the smallest primitive root modulo p
+	unsigned two_adicity;  ///< k, the exponent of 2 in p - 1
+
+	/** t*2^(-32) mod p for t < p*2^32. */
+	uint32_t reduce(uint64_t t) const
+	{
+		return montgomery_reduce(t, p, pinv);
+	}
+	/** a*b*2^(-32) mod p for a, b < p. */
+	uint32_t mul(uint32_t a, uint32_t b) const
+	{
+		return reduce(uint64_t(a) * b);
+	}
+	/** Representative of 0 <= x < 2^32. */
+	uint32_t to_montgomery(uint32_t x) const
+	{
+		return reduce(uint64_t(x) * r2);
+	}
+	/** Representative of a^e, a being a representative. */
+	uint32_t expt(uint32_t a, uint64_t e) const;
+	/** Representative of a primitive 2^j-th root of unity, j <= two_adicity.
+	 *  Consecutive j give consistent roots: the square of the 2^j-th root
+	 *  is the 2^(j-1)-th one. */
+	uint32_t root_of_unity(unsigned j) const;
+};
+
+/** The table of primes, in decreasing order. The primes are above 2^28,
+ *  so that the coefficients of the modular images stay small integers
+ *  (cf. max_sparse_modulus) while few images are needed. */
+extern const word_prime word_primes[];
+extern const std::size_t word_primes_count;
+
+/** The table entry of p, or 0 if p is not in the table. */
+extern const word_prime* find_word_prime(long p);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_PRIME_TABLE_H
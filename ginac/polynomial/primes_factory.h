@@ -24,6 +24,7 @@
 #define GINAC_CHINREM_GCD_PRIMES_FACTORY_H
 
 #include "smod_helpers.h"
+#include "prime_table.h"
 #include "debug.h"
 
 #include <cln/integer.h>
@@ -34,7 +35,9 @@ namespace GiNaC {
 
 /**
  * Find a `big' prime p such that lc mod p != 0. Helper class used by modular
- * GCD algorithm.
+ * GCD algorithm. The primes of the word_primes table come first, so that
+ * the modular code can use their precomputed constants; after them, primes
+ * are searched for with a probabilistic primality test.
  */
 class primes_factory
 {
@@ -45,23 +48,39 @@ private:
 	// coefficients are efficient. Practically this means we coefficients
 	// should be native integers. (N.B.: as of now chinrem_gcd uses cl_I
 	// or even numeric. Eventually this will be fixed).
-	cln::cl_I last;
-	// This ensures coefficients are immediate.
+	std::size_t next_entry;  ///< next word_primes entry to try
+	cln::cl_I last;          ///< zero until the table is exhausted
+	// Primes searched for above opt_hint keep the coefficients immediate.
 	static const int immediate_bits = 8*sizeof(void *) - __alignof__(void *);
 	static const long opt_hint = (1L << (immediate_bits >> 1)) - 1;
-public:
-	primes_factory()
+	// The table primes (between 2^28 and 2^30) are handed out first, but
+	// only on 64-bit systems, where they are immediate, too.
+	static bool use_table()
 	{
-		last = cln::nextprobprime(cln::cl_I(opt_hint));
+		return opt_hint >= (1L << 28) - 1;
 	}
+public:
+	primes_factory() : next_entry(use_table() ? 0 : word_primes_count) { }
 
 	bool operator()(long& p, const cln::cl_I& lc)
 	{
+		while (next_entry < word_primes_count) {
+			const long p_ = word_primes[next_entry++].p;
+			if (!zerop(smod(lc, p_))) {
+				p = p_;
+				return true;
+			}
+		}
+		if (zerop(last))
+			last = cln::nextprobprime(cln::cl_I(opt_hint));
+
 		static const cln::cl_I maxval(std::numeric_limits<long>::max());
 		while (last < maxval) {
 			long p_ = cln::cl_I_to_long(last);
 			last = cln::nextprobprime(last + 1);
 
+			if (use_table() && find_word_prime(p_))
+				continue;  // already tried
 			if (!zerop(smod(lc, p_))) {
 				p = p_;
 				return true;
@@ -73,7 +92,7 @@ public:
 	bool has_primes() const
 	{
 		static const cln::cl_I maxval(std::numeric_limits<long>::max());
-		return last < maxval;
+		return next_entry < word_primes_count || last < maxval;
 	}
 };
 
@@ -25,6 +25,7 @@
 #include "collect_vargs.h"
 #include "euclid_gcd_wrap.h"
 #include "divide_in_z_p.h"
+#include "sparse_mpoly.h"
 #include "debug.h"
 
 namespace GiNaC {
@@ -95,4 +96,39 @@ void primpart_content(ex& pp, ex& c, ex e, const exvector& vars,
 	c = g;
 }
 
+/**
+ * Same as above, for a polynomial e \in Z_p[x_k][x_0, \ldots, x_{k-1}] in
+ * sparse form (k == var). The content is made monic.
+ */
+void primpart_content(zp_mpoly& pp, zp_upoly& c, const zp_mpoly& e,
+		      const size_t var, const monomial_packing& pk, const long p)
+{
+	if (e.empty()) {
+		pp.clear();
+		c.assign(1, 1);
+		return;
+	}
+	zp_mpoly_coeffs ec;
+	zp_mpoly_split(e, var, pk, ec);
+
+	// Start from the leading coefficient
+	c = ec[0].second;
+	for (std::size_t i = 1; i < ec.size() && c.size() > 1; ++i)
+		c = zp_upoly_gcd(ec[i].second, c, p);
+	zp_upoly_make_monic(c, p);
+	if (c.size() == 1) {
+		pp = e;
+		return;
+	}
+	zp_upoly q, r;
+	for (std::size_t i = 0; i < ec.size(); ++i) {
+		zp_upoly_divide(ec[i].second, c, q, r, p);
+		if (!r.empty())
+			throw std::logic_error(std::string(__func__) +
+					": bogus division failure");
+		ec[i].second.swap(q);
+	}
+	pp = zp_mpoly_join(ec, var, pk);
+}
+
 } // namespace GiNaC
@@ -0,0 +1,587 @@
+/** @file rational_interp.cpp
+ *
+ *  Reconstruction of rational functions from their values modulo primes.
+ *
+ *  The function f(x) = N(x)/D(x) is restricted to lines x = t*y + s with a
+ *  fixed random shift s. Along each line it is a rational function of t,
+ *  which is found by Thiele interpolation. If it is normalized so that its
+ *  denominator is 1 at t = 0, the coefficient of t^k in its numerator
+ *  (denominator) is the homogeneous part of degree k of N(y+s)/D(s)
+ *  (D(y+s)/D(s)), a polynomial in y. With y_0 = 1, these parts are
+ *  interpolated on a grid of values of y_1, ..., y_{n-1}. The coefficients
+ *  are combined over several primes by Chinese remaindering and rational
+ *  reconstruction, and the result is checked at random points. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "rational_interp.h"
+#include "cra_garner.h"
+#include "primes_factory.h"
+#include "sparse_mpoly.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cln/integer.h>
+#include <cln/rational.h>
+#include <stdint.h> // for uint64_t
+
+namespace GiNaC {
+
+namespace {
+
+/** Maximal number of points on a line, the sum of the degrees of the
+ *  numerator and the denominator must be smaller. */
+const long max_line_points = 1024;
+
+/** Maximal number of values of the black box for one modular image. */
+const std::size_t max_image_points = std::size_t(1) << 20;
+
+/** Maximal number of primes. */
+const std::size_t max_primes = 256;
+
+/** Number of primes in a row for which no image could be computed, after
+ *  which the degrees found with the first prime are assumed to be wrong. */
+const unsigned max_unlucky_primes = 3;
+
+/** Number of random points at which the result is checked. */
+const unsigned check_points = 2;
+
+/** Pseudo-random numbers (xorshift). */
+class random_generator {
+public:
+	random_generator() : state(0x2545f4914f6cdd1dULL) { }
+
+	/** A number in the range [1, bound). */
+	long operator()(long bound)
+	{
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		return 1 + long(state % uint64_t(bound - 1));
+	}
+
+private:
+	uint64_t state;
+};
+
+void trim(zp_upoly & a)
+{
+	while (!a.empty() && a.back() == 0)
+		a.pop_back();
+}
+
+/** Thiele's continued fraction a_0 + (t-t_0)/(a_1 + (t-t_1)/(a_2 + ...))
+ *  over Z_p, interpolating a rational function of t point by point. */
+class zp_thiele {
+public:
+	zp_thiele(long p_) : p(p_) { }
+
+	std::size_t size() const { return a.size(); }
+
+	/** Value at t, false if t is a pole. */
+	bool eval(long t, long & v) const
+	{
+		long r = a.back();
+		for (std::size_t j = a.size() - 1; j-- != 0; ) {
+			if (r == 0)
+				return false;
+			r = add_mod(a[j], mul_mod(sub_mod(t, ts[j], p), recip_mod(r, p), p), p);
+		}
+		v = r;
+		return true;
+	}
+
+	/** Interpolate the value v at t as well. Returns false if the
+	 *  reciprocal differences are not defined. */
+	bool add(long t, long v)
+	{
+		long phi = v;
+		for (std::size_t j = 0; j < a.size(); ++j) {
+			const long d = sub_mod(phi, a[j], p);
+			if (d == 0)
+				return false;
+			phi = mul_mod(sub_mod(t, ts[j], p), recip_mod(d, p), p);
+		}
+		a.push_back(phi);
+		ts.push_back(t);
+		return true;
+	}
+
+	/** The fraction as num/den in lowest terms, normalized so that
+	 *  den(0) == 1. Returns false if den(0) == 0. */
+	bool fraction(zp_upoly & num, zp_upoly & den) const
+	{
+		num.assign(1, a.back());
+		den.assign(1, 1);
+		trim(num);
+		for (std::size_t j = a.size() - 1; j-- != 0; ) {
+			// num/den <- a_j + (t-t_j)*den/num
+			zp_upoly r(std::max(num.size(), den.size() + 1), 0);
+			for (std::size_t i = 0; i < num.size(); ++i)
+				r[i] = mul_mod(a[j], num[i], p);
+			for (std::size_t i = 0; i < den.size(); ++i) {
+				r[i+1] = add_mod(r[i+1], den[i], p);
+				r[i] = sub_mod(r[i], mul_mod(ts[j], den[i], p), p);
+			}
+			trim(r);
+			den.swap(num);
+			num.swap(r);
+		}
+		if (den.empty())
+			return false;
+		if (num.empty()) {
+			den.assign(1, 1);
+			return true;
+		}
+		const zp_upoly g = zp_upoly_gcd(num, den, p);
+		if (g.size() > 1) {
+			zp_upoly q, r;
+			zp_upoly_divide(num, g, q, r, p);
+			num.swap(q);
+			zp_upoly_divide(den, g, q, r, p);
+			den.swap(q);
+		}
+		if (den[0] == 0)
+			return false;
+		const long c = recip_mod(den[0], p);
+		for (std::size_t i = 0; i < num.size(); ++i)
+			num[i] = mul_mod(num[i], c, p);
+		for (std::size_t i = 0; i < den.size(); ++i)
+			den[i] = mul_mod(den[i], c, p);
+		return true;
+	}
+
+private:
+	const long p;
+	std::vector<long> a, ts;
+};
+
+/** Interpolate f along the line x = t*dir + base for t = 1, 2, ..., until
+ *  two points in a row are predicted by the continued fraction. */
+bool line_fraction(const zp_black_box & f, const std::vector<long> & dir, const std::vector<long> & base,
+                   long p, zp_upoly & num, zp_upoly & den)
+{
+	const std::size_t n = dir.size();
+	const long chunk = 8;
+	zp_thiele cf(p);
+	unsigned predicted = 0;
+	std::vector<long> points(chunk * n), values;
+	for (long t0 = 1; t0 <= max_line_points; t0 += chunk) {
+		for (long i = 0; i < chunk; ++i)
+			for (std::size_t j = 0; j < n; ++j)
+				points[i*n+j] = add_mod(mul_mod(t0 + i, dir[j] % p, p), base[j] % p, p);
+		if (!f.eval(points, p, values))
+			return false;
+		for (long i = 0; i < chunk; ++i) {
+			if (values[i] < 0)
+				return false;
+			long v;
+			if (cf.size() > 0 && cf.eval(t0 + i, v) && v == values[i]) {
+				if (++predicted == 2)
+					return cf.fraction(num, den);
+				continue;
+			}
+			predicted = 0;
+			if (!cf.add(t0 + i, values[i]))
+				return false;
+		}
+	}
+	return false;
+}
+
+/** Replace the values of a polynomial of degree d at the points x[0], ...,
+ *  x[d], which are stored at v[0], v[stride], ..., by its coefficients,
+ *  using Newton's divided differences. inv[l*(d+1)+i] is 1/(x[i]-x[i-l]). */
+void newton_interpolate(long * v, std::size_t stride, const std::vector<long> & x,
+                        const std::vector<long> & inv, long p, std::vector<long> & c, std::vector<long> & r)
+{
+	const std::size_t d = x.size() - 1;
+	c.resize(d+1);
+	for (std::size_t i = 0; i <= d; ++i)
+		c[i] = v[i*stride];
+	for (std::size_t l = 1; l <= d; ++l)
+		for (std::size_t i = d; i >= l; --i)
+			c[i] = mul_mod(sub_mod(c[i], c[i-1], p), inv[l*(d+1)+i], p);
+	// from the Newton form, by multiplying with t-x[i] from the inside out
+	r.assign(d+1, 0);
+	r[0] = c[d];
+	for (std::size_t i = d; i-- != 0; ) {
+		for (std::size_t k = d - i; k > 0; --k)
+			r[k] = sub_mod(r[k-1], mul_mod(x[i], r[k], p), p);
+		r[0] = sub_mod(c[i], mul_mod(x[i], r[0], p), p);
+	}
+	for (std::size_t i = 0; i <= d; ++i)
+		v[i*stride] = r[i];
+}
+
+/** Reconstruction of the rational function of a black box. */
+class rational_interpolator {
+public:
+	rational_interpolator(const zp_black_box & f_) : f(f_), n(f_.nvars()) { }
+
+	bool find_degrees(long p);
+	bool image(long p, std::vector<long> & coeffs) const;
+	bool check(long p, const std::vector<cln::cl_RA> & coeffs);
+	void terms(const std::vector<cln::cl_RA> & coeffs,
+	           std::vector<shifted_term> & num, std::vector<shifted_term> & den) const;
+
+	std::vector<long> shift;
+	long dnum, dden;  ///< total degrees of numerator and denominator, dnum < 0 for zero
+
+private:
+	struct lines_task;
+
+	void grid_point(std::size_t g, std::vector<long> & y) const;
+	std::vector<unsigned> exponents(std::size_t g, long k) const;
+	long eval_part(const long * c, long k, const std::vector<std::vector<long> > & powers, long p) const;
+
+	const zp_black_box & f;
+	const std::size_t n;
+	random_generator random;
+	std::vector<std::vector<long> > nodes;  ///< values of y_j on the grid, j > 0
+	std::size_t grid;                       ///< number of points of the grid
+	long m;                                 ///< number of points on each line
+};
+
+/** Choose the shift and find the degrees of numerator and denominator,
+ *  in total and in the variables x_1, ..., x_{n-1}, along generic lines. */
+bool rational_interpolator::find_degrees(long p)
+{
+	shift.resize(n);
+	for (std::size_t j = 0; j < n; ++j)
+		shift[j] = random(64);
+	std::vector<long> dir(n, 1);
+	for (std::size_t j = 1; j < n; ++j)
+		dir[j] = random(1L << 20);
+	zp_upoly num, den;
+	if (!line_fraction(f, dir, shift, p, num, den))
+		return false;
+	dnum = long(num.size()) - 1;
+	dden = long(den.size()) - 1;
+	m = dnum + dden + 2;
+
+	std::vector<long> base(n);
+	for (std::size_t j = 0; j < n; ++j)
+		base[j] = random(1L << 20);
+	nodes.assign(n, std::vector<long>());
+	grid = 1;
+	for (std::size_t j = 1; j < n; ++j) {
+		if (dnum < 0) {
+			// f is zero, its denominator 1
+			nodes[j].assign(1, 1);
+			continue;
+		}
+		std::vector<long> e(n, 0);
+		e[j] = 1;
+		if (!line_fraction(f, e, base, p, num, den))
+			return false;
+		const std::size_t d = std::min(std::max(num.size(), den.size()) - 1, std::size_t(std::max(dnum, dden)));
+		while (nodes[j].size() <= d) {
+			const long y = random(1L << 20);
+			if (std::find(nodes[j].begin(), nodes[j].end(), y) == nodes[j].end())
+				nodes[j].push_back(y);
+		}
+		grid *= d + 1;
+		if (grid * std::size_t(m) > max_image_points)
+			return false;
+	}
+	return true;
+}
+
+/** Coordinates of the grid point g. */
+void rational_interpolator::grid_point(std::size_t g, std::vector<long> & y) const
+{
+	y.assign(n, 1);
+	for (std::size_t j = 1; j < n; ++j) {
+		y[j] = nodes[j][g % nodes[j].size()];
+		g /= nodes[j].size();
+	}
+}
+
+/** Exponents of the monomial of degree k with index g on the grid, or an
+ *  empty vector if its degree in x_1, ..., x_{n-1} is larger than k. */
+std::vector<unsigned> rational_interpolator::exponents(std::size_t g, long k) const
+{
+	std::vector<unsigned> expo(n);
+	long rest = k;
+	for (std::size_t j = 1; j < n; ++j) {
+		expo[j] = unsigned(g % nodes[j].size());
+		g /= nodes[j].size();
+		rest -= expo[j];
+	}
+	if (rest < 0)
+		return std::vector<unsigned>();
+	expo[0] = unsigned(rest);
+	return expo;
+}
+
+/** Interpolates along the lines through the grid points. */
+struct rational_interpolator::lines_task : public parallel_task {
+	lines_task(const rational_interpolator & ri_, long p_, const std::vector<long> & values_,
+	           std::vector<long> & nv_, std::vector<long> & dv_, std::vector<char> & ok_)
+	 : ri(ri_), p(p_), values(values_), nv(nv_), dv(dv_), ok(ok_) { }
+
+	void operator()(std::size_t g)
+	{
+		const long * v = &values[g * ri.m];
+		zp_thiele cf(p);
+		for (long i = 0; i < ri.m; ++i) {
+			if (v[i] < 0)
+				return;
+			long w;
+			if (cf.size() > 0 && cf.eval(i + 1, w) && w == v[i])
+				continue;
+			if (!cf.add(i + 1, v[i]))
+				return;
+		}
+		zp_upoly num, den;
+		if (!cf.fraction(num, den))
+			return;
+		for (long i = 0; i < ri.m; ++i)
+			if (zp_upoly_eval(num, i + 1, p) != mul_mod(v[i], zp_upoly_eval(den, i + 1, p), p))
+				return;
+		// A common factor of numerator and denominator on this line
+		// would lower both degrees
+		const long dn = long(num.size()) - 1, dd = long(den.size()) - 1;
+		if (dn > ri.dnum || dd > ri.dden || (dn < ri.dnum && dd < ri.dden))
+			return;
+		for (std::size_t k = 0; k < num.size(); ++k)
+			nv[k*ri.grid + g] = num[k];
+		for (std::size_t k = 0; k < den.size(); ++k)
+			dv[k*ri.grid + g] = den[k];
+		ok[g] = 1;
+	}
+
+	const rational_interpolator & ri;
+	const long p;
+	const std::vector<long> & values;
+	std::vector<long> & nv, & dv;
+	std::vector<char> & ok;
+};
+
+/** Coefficients of the homogeneous parts of numerator and denominator
+ *  modulo p, one after the other, each one for all monomials of the grid.
+ *  Returns false if p is unlucky. */
+bool rational_interpolator::image(long p, std::vector<long> & coeffs) const
+{
+	std::vector<long> points(grid * m * n), y;
+	for (std::size_t g = 0; g < grid; ++g) {
+		grid_point(g, y);
+		for (long i = 0; i < m; ++i)
+			for (std::size_t j = 0; j < n; ++j)
+				points[(g*m + i)*n + j] = add_mod(mul_mod(i + 1, y[j] % p, p), shift[j] % p, p);
+	}
+	std::vector<long> values;
+	if (!f.eval(points, p, values))
+		return false;
+
+	std::vector<long> nv((dnum+1) * grid, 0), dv((dden+1) * grid, 0);
+	std::vector<char> ok(grid, 0);
+	lines_task task(*this, p, values, nv, dv, ok);
+	if (parallel_threads(grid) > 1)
+		parallel_for(grid, task);
+	else
+		for (std::size_t g = 0; g < grid; ++g)
+			task(g);
+	if (std::find(ok.begin(), ok.end(), 0) != ok.end())
+		return false;
+
+	// Interpolate the homogeneous parts on the grid, one axis after the
+	// other
+	std::vector<long> c, r;
+	std::size_t stride = 1;
+	for (std::size_t j = 1; j < n; ++j) {
+		const std::size_t d = nodes[j].size() - 1;
+		std::vector<long> x(d+1), inv((d+1)*(d+1));
+		for (std::size_t i = 0; i <= d; ++i)
+			x[i] = nodes[j][i] % p;
+		for (std::size_t l = 1; l <= d; ++l)
+			for (std::size_t i = l; i <= d; ++i)
+				inv[l*(d+1)+i] = recip_mod(sub_mod(x[i], x[i-l], p), p);
+		const std::size_t block = stride * (d+1);
+		for (std::size_t hi = 0; hi < nv.size(); hi += block)
+			for (std::size_t lo = 0; lo < stride; ++lo)
+				newton_interpolate(&nv[hi+lo], stride, x, inv, p, c, r);
+		for (std::size_t hi = 0; hi < dv.size(); hi += block)
+			for (std::size_t lo = 0; lo < stride; ++lo)
+				newton_interpolate(&dv[hi+lo], stride, x, inv, p, c, r);
+		stride = block;
+	}
+
+	// The part of degree k has no monomials of higher degree
+	for (long k = 0; k <= std::max(dnum, dden); ++k)
+		for (std::size_t g = 0; g < grid; ++g)
+			if (exponents(g, k).empty() &&
+			    ((k <= dnum && nv[k*grid + g] != 0) || (k <= dden && dv[k*grid + g] != 0)))
+				return false;
+
+	coeffs.swap(nv);
+	coeffs.insert(coeffs.end(), dv.begin(), dv.end());
+	return true;
+}
+
+/** Value of the homogeneous part of degree k with the coefficients c
+ *  modulo p, where powers[j][e] is the value of (x_j-s_j)^e. */
+long rational_interpolator::eval_part(const long * c, long k, const std::vector<std::vector<long> > & powers,
+                                      long p) const
+{
+	long s = 0;
+	for (std::size_t g = 0; g < grid; ++g) {
+		if (c[g] == 0)
+			continue;
+		const std::vector<unsigned> expo = exponents(g, k);
+		long t = c[g];
+		for (std::size_t j = 0; j < n; ++j)
+			t = mul_mod(t, powers[j][expo[j]], p);
+		s = add_mod(s, t, p);
+	}
+	return s;
+}
+
+/** Check the rational function with the given coefficients against the
+ *  black box at random points modulo p. */
+bool rational_interpolator::check(long p, const std::vector<cln::cl_RA> & coeffs)
+{
+	std::vector<long> c(coeffs.size());
+	for (std::size_t i = 0; i < coeffs.size(); ++i) {
+		const long den = to_mod(cln::denominator(coeffs[i]), p);
+		if (den == 0)
+			return false;
+		c[i] = mul_mod(to_mod(cln::numerator(coeffs[i]), p), recip_mod(den, p), p);
+	}
+
+	const long maxdeg = std::max(dnum, dden);
+	std::vector<long> x(n), values;
+	std::vector<std::vector<long> > powers(n, std::vector<long>(maxdeg + 1));
+	unsigned checked = 0;
+	for (unsigned attempt = 0; attempt < 2*check_points && checked < check_points; ++attempt) {
+		for (std::size_t j = 0; j < n; ++j)
+			x[j] = random(p);
+		if (!f.eval(x, p, values))
+			return false;
+		if (values[0] < 0)
+			continue;
+		for (std::size_t j = 0; j < n; ++j) {
+			const long y = sub_mod(x[j], shift[j] % p, p);
+			powers[j][0] = 1;
+			for (long e = 1; e <= maxdeg; ++e)
+				powers[j][e] = mul_mod(powers[j][e-1], y, p);
+		}
+		long num = 0, den = 0;
+		for (long k = 0; k <= dnum; ++k)
+			num = add_mod(num, eval_part(&c[k*grid], k, powers, p), p);
+		for (long k = 0; k <= dden; ++k)
+			den = add_mod(den, eval_part(&c[(dnum+1+k)*grid], k, powers, p), p);
+		if (num != mul_mod(values[0], den, p))
+			return false;
+		++checked;
+	}
+	return checked == check_points;
+}
+
+/** Convert the coefficients to lists of terms. */
+void rational_interpolator::terms(const std::vector<cln::cl_RA> & coeffs,
+                                  std::vector<shifted_term> & num, std::vector<shifted_term> & den) const
+{
+	num.clear();
+	den.clear();
+	for (long k = 0; k <= std::max(dnum, dden); ++k)
+		for (std::size_t g = 0; g < grid; ++g) {
+			shifted_term t;
+			t.expo = exponents(g, k);
+			if (t.expo.empty())
+				continue;
+			if (k <= dnum && !cln::zerop(coeffs[k*grid + g])) {
+				t.coeff = coeffs[k*grid + g];
+				num.push_back(t);
+			}
+			if (k <= dden && !cln::zerop(coeffs[(dnum+1+k)*grid + g])) {
+				t.coeff = coeffs[(dnum+1+k)*grid + g];
+				den.push_back(t);
+			}
+		}
+}
+
+} // anonymous namespace
+
+bool interpolate_rational(const zp_black_box & f, std::vector<long> & shift,
+                          std::vector<shifted_term> & num, std::vector<shifted_term> & den)
+{
+	if (f.nvars() == 0)
+		return false;
+
+	rational_interpolator ri(f);
+	primes_factory next_prime;
+	long p;
+	if (!next_prime(p, cln::cl_I(1)) || p >= max_sparse_modulus)
+		return false;
+	bool found = false;
+	for (unsigned attempt = 0; attempt < 3 && !found; ++attempt)
+		found = ri.find_degrees(p);  // the shift may be a pole
+	if (!found)
+		return false;
+	shift = ri.shift;
+
+	// Combine the images by Garner's algorithm, one prime at a time, until
+	// the rational reconstruction of the coefficients doesn't change any
+	// more and passes the check at random points
+	std::vector<cln::cl_I> u;
+	cln::cl_I M = 1;
+	std::vector<cln::cl_RA> candidate, previous;
+	std::vector<long> image;
+	bool stable = false;
+	unsigned unlucky = 0, failed_checks = 0;
+	for (std::size_t primes = 0; primes < max_primes; ++primes) {
+		if (primes > 0 && (!next_prime(p, cln::cl_I(1)) || p >= max_sparse_modulus))
+			return false;
+		if (stable) {
+			if (ri.check(p, candidate)) {
+				ri.terms(candidate, num, den);
+				return true;
+			}
+			if (++failed_checks == 2)
+				return false;
+		}
+		if (!ri.image(p, image)) {
+			if (++unlucky == max_unlucky_primes)
+				return false;
+			continue;
+		}
+		unlucky = 0;
+		if (u.empty()) {
+			u.assign(image.begin(), image.end());
+		} else {
+			const long c = recip_mod(to_mod(M, p), p);
+			for (std::size_t i = 0; i < u.size(); ++i)
+				u[i] = u[i] + M * cln::cl_I(mul_mod(sub_mod(image[i], to_mod(u[i], p), p), c, p));
+		}
+		M = M * cln::cl_I(p);
+
+		previous.swap(candidate);
+		candidate.resize(u.size());
+		bool reconstructed = true;
+		for (std::size_t i = 0; i < u.size() && reconstructed; ++i)
+			reconstructed = rational_reconstruction(u[i], M, candidate[i]);
+		stable = reconstructed && previous.size() == candidate.size() &&
+		         std::equal(candidate.begin(), candidate.end(), previous.begin());
+	}
+	return false;
+}
+
+} // namespace GiNaC
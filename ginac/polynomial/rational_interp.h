@@ -0,0 +1,63 @@
+/** @file rational_interp.h
+ *
+ *  Reconstruction of rational functions from their values modulo primes. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_RATIONAL_INTERP_H
+#define GINAC_RATIONAL_INTERP_H
+
+#include <cln/rational.h>
+#include <cstddef>
+#include <vector>
+
+namespace GiNaC {
+
+/** A rational function with rational coefficients which can only be
+ *  evaluated modulo primes. */
+class zp_black_box {
+public:
+	virtual ~zp_black_box() { }
+
+	/** Number of variables. */
+	virtual std::size_t nvars() const = 0;
+
+	/** Values at the points, which are stored one after the other in
+	 *  points with nvars() coordinates in the range [0, p) each, modulo
+	 *  the prime p. The value is -1 where a denominator vanishes. Returns
+	 *  false if the function can't be evaluated modulo p. */
+	virtual bool eval(const std::vector<long> & points, long p, std::vector<long> & values) const = 0;
+};
+
+/** The term coeff*(x_0-s_0)^expo[0]*...*(x_n-s_n)^expo[n] of a polynomial
+ *  in shifted variables. */
+struct shifted_term {
+	std::vector<unsigned> expo;
+	cln::cl_RA coeff;
+};
+
+/** Reconstruct the rational function of the black box f as num/den, with
+ *  polynomials in the variables x_j-shift[j] which have no common factor.
+ *  Returns false if that failed, e.g. because the degrees are too large. */
+extern bool interpolate_rational(const zp_black_box & f, std::vector<long> & shift,
+                                 std::vector<shifted_term> & num, std::vector<shifted_term> & den);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_RATIONAL_INTERP_H
@@ -0,0 +1,635 @@
+/** @file sparse_mpoly.cpp
+ *
+ *  Sparse distributed multivariate polynomials over Z and Z_p with packed
+ *  exponent vectors, used by the modular GCD algorithms. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "sparse_mpoly.h"
+#include "numeric.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <cln/integer.h>
+#include <cln/rational.h>
+
+namespace GiNaC {
+
+long recip_mod(long a, long p)
+{
+	long r0 = p, r1 = a, s0 = 0, s1 = 1;
+	while (r1 != 0) {
+		const long q = r0 / r1;
+		long t = r0 - q*r1;
+		r0 = r1;
+		r1 = t;
+		t = s0 - q*s1;
+		s0 = s1;
+		s1 = t;
+	}
+	bug_on(r0 != 1, a << " is not invertible mod " << p);
+	return s0 < 0 ? s0 + p : s0;
+}
+
+long to_mod(const cln::cl_I & a, long p)
+{
+	return cln::cl_I_to_long(cln::mod(a, cln::cl_I(p)));
+}
+
+zp_upoly zp_upoly_mul(const zp_upoly & a, const zp_upoly & b, long p)
+{
+	if (a.empty() || b.empty())
+		return zp_upoly();
+	zp_upoly c(a.size() + b.size() - 1, 0);
+	for (size_t i = 0; i < a.size(); ++i) {
+		if (a[i] == 0)
+			continue;
+		for (size_t j = 0; j < b.size(); ++j)
+			c[i+j] = add_mod(c[i+j], mul_mod(a[i], b[j], p), p);
+	}
+	return c;
+}
+
+void zp_upoly_divide(const zp_upoly & a, const zp_upoly & b, zp_upoly & q, zp_upoly & r, long p)
+{
+	bug_on(b.empty(), "division by zero");
+	r = a;
+	q.clear();
+	if (r.size() < b.size())
+		return;
+	q.assign(r.size() - b.size() + 1, 0);
+	const long lc_1 = recip_mod(b.back(), p);
+	for (size_t k = q.size(); k-- != 0; ) {
+		const long c = mul_mod(r[k + b.size() - 1], lc_1, p);
+		q[k] = c;
+		if (c == 0)
+			continue;
+		for (size_t j = 0; j < b.size(); ++j)
+			r[k+j] = sub_mod(r[k+j], mul_mod(c, b[j], p), p);
+	}
+	while (!r.empty() && r.back() == 0)
+		r.pop_back();
+}
+
+zp_upoly zp_upoly_gcd(zp_upoly a, zp_upoly b, long p)
+{
+	zp_upoly q, r;
+	while (!b.empty()) {
+		zp_upoly_divide(a, b, q, r, p);
+		a.swap(b);
+		b.swap(r);
+	}
+	zp_upoly_make_monic(a, p);
+	return a;
+}
+
+long zp_upoly_eval(const zp_upoly & a, long x, long p)
+{
+	long v = 0;
+	for (size_t i = a.size(); i-- != 0; )
+		v = add_mod(mul_mod(v, x, p), a[i], p);
+	return v;
+}
+
+void zp_upoly_make_monic(zp_upoly & a, long p)
+{
+	if (a.empty() || a.back() == 1)
+		return;
+	const long lc_1 = recip_mod(a.back(), p);
+	for (size_t i = 0; i < a.size(); ++i)
+		a[i] = mul_mod(a[i], lc_1, p);
+}
+
+/** Order of terms: decreasing monomials. */
+template<typename T>
+static bool sparse_term_greater(const sparse_term<T> & x, const sparse_term<T> & y)
+{
+	return x.mon > y.mon;
+}
+
+/** Sort the terms of a and combine terms with equal monomials. */
+static void combine_terms(zp_mpoly & a, long p)
+{
+	std::sort(a.begin(), a.end(), sparse_term_greater<long>);
+	size_t n = 0;
+	for (size_t i = 0; i < a.size(); ) {
+		const packed_monomial mon = a[i].mon;
+		long c = 0;
+		for (; i < a.size() && a[i].mon == mon; ++i)
+			c = add_mod(c, a[i].coeff, p);
+		if (c != 0)
+			a[n++] = sparse_term<long>(mon, c);
+	}
+	a.resize(n);
+}
+
+zp_mpoly zp_mpoly_add(const zp_mpoly & a, const zp_mpoly & b, long p)
+{
+	zp_mpoly result;
+	result.reserve(a.size() + b.size());
+	zp_mpoly::const_iterator i = a.begin(), j = b.begin();
+	while (i != a.end() && j != b.end()) {
+		if (i->mon > j->mon) {
+			result.push_back(*i);
+			++i;
+		} else if (i->mon < j->mon) {
+			result.push_back(*j);
+			++j;
+		} else {
+			const long c = add_mod(i->coeff, j->coeff, p);
+			if (c != 0)
+				result.push_back(sparse_term<long>(i->mon, c));
+			++i;
+			++j;
+		}
+	}
+	result.insert(result.end(), i, a.end());
+	result.insert(result.end(), j, b.end());
+	return result;
+}
+
+zp_mpoly zp_mpoly_sub(const zp_mpoly & a, const zp_mpoly & b, long p)
+{
+	zp_mpoly result;
+	result.reserve(a.size() + b.size());
+	zp_mpoly::const_iterator i = a.begin(), j = b.begin();
+	while (i != a.end() || j != b.end()) {
+		if (j == b.end() || (i != a.end() && i->mon > j->mon)) {
+			result.push_back(*i);
+			++i;
+		} else if (i == a.end() || i->mon < j->mon) {
+			result.push_back(sparse_term<long>(j->mon, p - j->coeff));
+			++j;
+		} else {
+			const long c = sub_mod(i->coeff, j->coeff, p);
+			if (c != 0)
+				result.push_back(sparse_term<long>(i->mon, c));
+			++i;
+			++j;
+		}
+	}
+	return result;
+}
+
+void zp_mpoly_scale(zp_mpoly & a, long c, long p)
+{
+	if (c == 1)
+		return;
+	for (size_t i = 0; i < a.size(); ++i)
+		a[i].coeff = mul_mod(a[i].coeff, c, p);
+}
+
+zp_mpoly zp_mpoly_mul_upoly(const zp_mpoly & a, const zp_upoly & u, size_t var,
+                            const monomial_packing & pk, long p)
+{
+	zp_mpoly result;
+	result.reserve(a.size() * u.size());
+	for (size_t k = 0; k < u.size(); ++k) {
+		if (u[k] == 0)
+			continue;
+		const packed_monomial m = pk.pack(var, k);
+		for (size_t i = 0; i < a.size(); ++i)
+			result.push_back(sparse_term<long>(a[i].mon + m, mul_mod(a[i].coeff, u[k], p)));
+	}
+	combine_terms(result, p);
+	return result;
+}
+
+zp_mpoly zp_mpoly_eval(const zp_mpoly & a, size_t var, long x,
+                       const monomial_packing & pk, long p)
+{
+	const packed_monomial field = pk.field(var);
+	std::vector<long> powers(1, 1);
+	zp_mpoly result;
+	result.reserve(a.size());
+	for (size_t i = 0; i < a.size(); ++i) {
+		const unsigned e = pk.exponent(a[i].mon, var);
+		while (powers.size() <= e)
+			powers.push_back(mul_mod(powers.back(), x, p));
+		const long c = mul_mod(a[i].coeff, powers[e], p);
+		if (c != 0)
+			result.push_back(sparse_term<long>(a[i].mon & ~field, c));
+	}
+	combine_terms(result, p);
+	return result;
+}
+
+// Evaluation at many points. The values for all points are kept side by
+// side in arrays, and the inner loops run over the points, doing the
+// same operations on each of them. These loops have no division (see
+// mul_mod_fp()) and no branches, so compilers turn them into vector
+// instructions.
+
+/** a*b mod p for p < max_sparse_modulus, with pinv == 1.0/p. The quotient
+ *  is estimated in floating point, which is off by at most one, and the
+ *  remainder corrected accordingly. */
+static inline long mul_mod_fp(long a, long b, long p, double pinv)
+{
+	const long long q = (long long)(double(a)*double(b)*pinv);
+	long long r = (long long)a*b - q*p;
+	r += r < 0 ? p : 0;
+	r -= r >= p ? p : 0;
+	return long(r);
+}
+
+static inline long add_mod_fp(long a, long b, long p)
+{
+	const long s = a + b;
+	return s - (s >= p ? p : 0);
+}
+
+/** Powers x_j^e for e = 0, ..., maxe of all points x, stored as
+ *  pw[e*n + j] with n = x.size(). */
+static void powers_at_points(std::vector<long> & pw, const long * x, size_t n,
+                             unsigned maxe, long p, double pinv)
+{
+	pw.resize((maxe + 1)*n);
+	for (size_t j = 0; j < n; ++j)
+		pw[j] = 1;
+	for (unsigned e = 1; e <= maxe; ++e) {
+		const long * prev = &pw[(e - 1)*n];
+		long * cur = &pw[e*n];
+		for (size_t j = 0; j < n; ++j)
+			cur[j] = mul_mod_fp(prev[j], x[j], p, pinv);
+	}
+}
+
+void zp_upoly_eval_points(const zp_upoly & a, const std::vector<long> & x, long p,
+                          std::vector<long> & v)
+{
+	const size_t n = x.size();
+	const double pinv = 1.0/double(p);
+	v.assign(n, 0);
+	if (n == 0)
+		return;
+	long * const vp = &v[0];
+	const long * const xp = &x[0];
+	for (size_t i = a.size(); i-- != 0; ) {
+		const long c = a[i];
+		for (size_t j = 0; j < n; ++j)
+			vp[j] = add_mod_fp(mul_mod_fp(vp[j], xp[j], p, pinv), c, p);
+	}
+}
+
+void zp_mpoly_eval_points(const zp_mpoly & a, size_t var, const std::vector<long> & x,
+                          const monomial_packing & pk, long p, std::vector<zp_mpoly> & r)
+{
+	const size_t n = x.size();
+	r.assign(n, zp_mpoly());
+	if (n == 0)
+		return;
+	const double pinv = 1.0/double(p);
+	unsigned maxe = 0;
+	for (size_t i = 0; i < a.size(); ++i)
+		maxe = std::max(maxe, pk.exponent(a[i].mon, var));
+	std::vector<long> pw;
+	powers_at_points(pw, &x[0], n, maxe, p, pinv);
+
+	const packed_monomial field = pk.field(var);
+	std::vector<long> c(n);
+	for (size_t j = 0; j < n; ++j)
+		r[j].reserve(a.size());
+	for (size_t i = 0; i < a.size(); ++i) {
+		const long * const pe = &pw[pk.exponent(a[i].mon, var)*n];
+		const long ai = a[i].coeff;
+		for (size_t j = 0; j < n; ++j)
+			c[j] = mul_mod_fp(ai, pe[j], p, pinv);
+		const packed_monomial mon = a[i].mon & ~field;
+		for (size_t j = 0; j < n; ++j)
+			if (c[j] != 0)
+				r[j].push_back(sparse_term<long>(mon, c[j]));
+	}
+	for (size_t j = 0; j < n; ++j)
+		combine_terms(r[j], p);
+}
+
+void zp_mpoly_eval_points_but_x0(const zp_mpoly & a, const std::vector<std::vector<long> > & pts,
+                                 const monomial_packing & pk, long p, std::vector<zp_upoly> & r)
+{
+	const size_t n = pts.size();
+	r.assign(n, zp_upoly());
+	if (n == 0)
+		return;
+	const size_t nv = pts[0].size();
+	const double pinv = 1.0/double(p);
+
+	// Powers of the values of x_1, ..., x_nv, one table per variable
+	std::vector<unsigned> maxe(nv + 1, 0);
+	for (size_t i = 0; i < a.size(); ++i)
+		for (size_t k = 0; k <= nv; ++k)
+			maxe[k] = std::max(maxe[k], pk.exponent(a[i].mon, k));
+	std::vector<std::vector<long> > pw(nv);
+	std::vector<long> x(n);
+	for (size_t k = 0; k < nv; ++k) {
+		for (size_t j = 0; j < n; ++j)
+			x[j] = pts[j][k];
+		powers_at_points(pw[k], &x[0], n, maxe[k + 1], p, pinv);
+	}
+
+	// Coefficient of x_0^e at the point j is accumulated in acc[e*n + j]
+	std::vector<long> acc((maxe[0] + 1)*n, 0), t(n);
+	for (size_t i = 0; i < a.size(); ++i) {
+		const long ai = a[i].coeff;
+		for (size_t j = 0; j < n; ++j)
+			t[j] = ai;
+		for (size_t k = 0; k < nv; ++k) {
+			const unsigned e = pk.exponent(a[i].mon, k + 1);
+			if (e == 0)
+				continue;
+			const long * const pe = &pw[k][e*n];
+			for (size_t j = 0; j < n; ++j)
+				t[j] = mul_mod_fp(t[j], pe[j], p, pinv);
+		}
+		long * const dst = &acc[pk.exponent(a[i].mon, 0)*n];
+		for (size_t j = 0; j < n; ++j)
+			dst[j] = add_mod_fp(dst[j], t[j], p);
+	}
+
+	for (size_t j = 0; j < n; ++j) {
+		zp_upoly & rj = r[j];
+		rj.resize(maxe[0] + 1);
+		for (size_t e = 0; e <= maxe[0]; ++e)
+			rj[e] = acc[e*n + j];
+		while (!rj.empty() && rj.back() == 0)
+			rj.pop_back();
+	}
+}
+
+void zp_mpoly_split(const zp_mpoly & a, size_t var, const monomial_packing & pk,
+                    zp_mpoly_coeffs & c)
+{
+	const packed_monomial field = pk.field(var);
+	std::vector<std::pair<packed_monomial, size_t> > order(a.size());
+	for (size_t i = 0; i < a.size(); ++i)
+		order[i] = std::make_pair(a[i].mon & ~field, i);
+	std::sort(order.begin(), order.end());
+	c.clear();
+	for (size_t k = order.size(); k-- != 0; ) {
+		const packed_monomial m = order[k].first;
+		if (c.empty() || c.back().first != m)
+			c.push_back(std::make_pair(m, zp_upoly()));
+		zp_upoly & u = c.back().second;
+		const size_t i = order[k].second;
+		const unsigned e = pk.exponent(a[i].mon, var);
+		if (u.size() <= e)
+			u.resize(e + 1, 0);
+		u[e] = a[i].coeff;
+	}
+}
+
+zp_mpoly zp_mpoly_join(const zp_mpoly_coeffs & c, size_t var, const monomial_packing & pk)
+{
+	zp_mpoly result;
+	for (size_t k = 0; k < c.size(); ++k) {
+		const zp_upoly & u = c[k].second;
+		for (size_t i = u.size(); i-- != 0; )
+			if (u[i] != 0)
+				result.push_back(sparse_term<long>(c[k].first + pk.pack(var, i), u[i]));
+	}
+	std::sort(result.begin(), result.end(), sparse_term_greater<long>);
+	return result;
+}
+
+/** Degrees of a in all variables of pk. */
+template<typename T>
+static std::vector<unsigned> degrees(const std::vector<sparse_term<T> > & a, const monomial_packing & pk)
+{
+	std::vector<unsigned> d(pk.nvars(), 0);
+	for (size_t i = 0; i < a.size(); ++i)
+		for (size_t v = 0; v < d.size(); ++v)
+			d[v] = std::max(d[v], pk.exponent(a[i].mon, v));
+	return d;
+}
+
+/** Check whether the term t can be a term of the quotient a/b, given the
+ *  degrees of a and b. Ensures that the exponents of t*b fit into the
+ *  packing. */
+static bool quotient_term_fits(packed_monomial t, const std::vector<unsigned> & dega,
+                               const std::vector<unsigned> & degb, const monomial_packing & pk)
+{
+	for (size_t v = 0; v < dega.size(); ++v)
+		if (pk.exponent(t, v) + degb[v] > dega[v])
+			return false;
+	return true;
+}
+
+namespace {
+
+/** Entry of the heap used for division: the product q[i]*b[j] of a term
+ *  of the quotient and a term of the divisor, and its monomial. */
+struct division_heap_entry {
+	division_heap_entry(packed_monomial m, size_t i_, size_t j_) : mon(m), i(i_), j(j_) {}
+	packed_monomial mon;
+	size_t i, j;
+};
+
+/** Heap order: the largest monomial is on top. */
+struct division_heap_less {
+	bool operator()(const division_heap_entry & x, const division_heap_entry & y) const
+	{
+		return x.mon < y.mon;
+	}
+};
+
+/** Coefficient arithmetic of heap_divide() over Z. */
+struct z_division_ring {
+	bool is_zero(const cln::cl_I & c) const { return cln::zerop(c); }
+	cln::cl_I zero() const { return 0; }
+	cln::cl_I sub_mul(const cln::cl_I & c, const cln::cl_I & x, const cln::cl_I & y) const
+	{
+		return c - x * y;
+	}
+	bool divide(const cln::cl_I & c, const cln::cl_I & lc, cln::cl_I & q) const
+	{
+		const cln::cl_I_div_t qr = cln::truncate2(c, lc);
+		q = qr.quotient;
+		return cln::zerop(qr.remainder);
+	}
+};
+
+/** Coefficient arithmetic of heap_divide() over Z_p, for divisors with
+ *  leading coefficient lc. */
+struct zp_division_ring {
+	zp_division_ring(long p_, long lc) : p(p_), lc_1(recip_mod(lc, p_)) {}
+	bool is_zero(long c) const { return c == 0; }
+	long zero() const { return 0; }
+	long sub_mul(long c, long x, long y) const
+	{
+		return sub_mod(c, mul_mod(x, y, p), p);
+	}
+	bool divide(long c, long, long & q) const
+	{
+		q = mul_mod(c, lc_1, p);
+		return true;
+	}
+	const long p, lc_1;
+};
+
+} // anonymous namespace
+
+/**
+ * Exact division by a heap of products (Johnson's algorithm as refined by
+ * Monagan and Pearce). The terms of a - q*b are generated in decreasing
+ * order by merging a with the products q[i]*b[j], without ever storing the
+ * remainder: the heap holds the next product q[i]*b[j], j > 0, for every
+ * term q[i] of the quotient found so far, so its size is bounded by the
+ * number of terms of the quotient. Fails as soon as a term of the remainder
+ * is not divisible by the leading term of b.
+ */
+template<typename T, typename Ring>
+static bool heap_divide(const std::vector<sparse_term<T> > & a, const std::vector<sparse_term<T> > & b,
+                        std::vector<sparse_term<T> > & q, const monomial_packing & pk, const Ring & R)
+{
+	bug_on(b.empty(), "division by zero");
+	q.clear();
+	const std::vector<unsigned> dega = degrees(a, pk), degb = degrees(b, pk);
+	std::vector<division_heap_entry> heap;
+	division_heap_less less;
+	size_t k = 0;
+	while (k < a.size() || !heap.empty()) {
+		packed_monomial m;
+		T c;
+		if (k < a.size() && (heap.empty() || a[k].mon >= heap.front().mon)) {
+			m = a[k].mon;
+			c = a[k].coeff;
+			++k;
+		} else {
+			m = heap.front().mon;
+			c = R.zero();
+		}
+		while (!heap.empty() && heap.front().mon == m) {
+			std::pop_heap(heap.begin(), heap.end(), less);
+			const size_t i = heap.back().i, j = heap.back().j;
+			heap.pop_back();
+			c = R.sub_mul(c, q[i].coeff, b[j].coeff);
+			if (j + 1 < b.size()) {
+				heap.push_back(division_heap_entry(q[i].mon + b[j+1].mon, i, j + 1));
+				std::push_heap(heap.begin(), heap.end(), less);
+			}
+		}
+		if (R.is_zero(c))
+			continue;
+
+		// Next term of the quotient
+		if (!pk.divides(b[0].mon, m))
+			return false;
+		const packed_monomial t = m - b[0].mon;
+		if (!quotient_term_fits(t, dega, degb, pk))
+			return false;
+		T qc;
+		if (!R.divide(c, b[0].coeff, qc))
+			return false;
+		q.push_back(sparse_term<T>(t, qc));
+		if (b.size() > 1) {
+			heap.push_back(division_heap_entry(t + b[1].mon, q.size() - 1, 1));
+			std::push_heap(heap.begin(), heap.end(), less);
+		}
+	}
+	return true;
+}
+
+bool zp_mpoly_divide(const zp_mpoly & a, const zp_mpoly & b, zp_mpoly & q,
+                     const monomial_packing & pk, long p)
+{
+	bug_on(b.empty(), "division by zero");
+	return heap_divide(a, b, q, pk, zp_division_ring(p, b[0].coeff));
+}
+
+zp_mpoly z_mpoly_mod(const z_mpoly & a, long p)
+{
+	zp_mpoly result;
+	result.reserve(a.size());
+	for (size_t i = 0; i < a.size(); ++i) {
+		const long c = to_mod(a[i].coeff, p);
+		if (c != 0)
+			result.push_back(sparse_term<long>(a[i].mon, c));
+	}
+	return result;
+}
+
+z_mpoly z_mpoly_from_zp(const zp_mpoly & a, long p)
+{
+	z_mpoly result;
+	result.reserve(a.size());
+	for (size_t i = 0; i < a.size(); ++i) {
+		const long c = a[i].coeff > (p >> 1) ? a[i].coeff - p : a[i].coeff;
+		result.push_back(sparse_term<cln::cl_I>(a[i].mon, cln::cl_I(c)));
+	}
+	return result;
+}
+
+bool z_mpoly_divide(const z_mpoly & a, const z_mpoly & b, z_mpoly & q,
+                    const monomial_packing & pk)
+{
+	return heap_divide(a, b, q, pk, z_division_ring());
+}
+
+cln::cl_I z_mpoly_content(const z_mpoly & a)
+{
+	cln::cl_I c = 0;
+	for (size_t i = 0; i < a.size() && c != 1; ++i)
+		c = cln::gcd(c, a[i].coeff);
+	return c;
+}
+
+cln::cl_I z_mpoly_max_coeff(const z_mpoly & a)
+{
+	cln::cl_I m = 0;
+	for (size_t i = 0; i < a.size(); ++i) {
+		const cln::cl_I c = cln::abs(a[i].coeff);
+		if (c > m)
+			m = c;
+	}
+	return m;
+}
+
+cln::cl_RA packed_mpoly_to_z_mpoly(const packed_mpoly & e, z_mpoly & a)
+{
+	cln::cl_I den = 1;
+	for (size_t i = 0; i < e.size(); ++i)
+		den = cln::lcm(den, cln::denominator(e[i].coeff));
+	a.clear();
+	a.reserve(e.size());
+	for (size_t i = 0; i < e.size(); ++i)
+		a.push_back(sparse_term<cln::cl_I>(e[i].mon, cln::numerator(e[i].coeff * den)));
+	const cln::cl_I c = z_mpoly_content(a);
+	if (c != 1 && !cln::zerop(c))
+		for (size_t i = 0; i < a.size(); ++i)
+			a[i].coeff = cln::exquo(a[i].coeff, c);
+	return c / den;
+}
+
+cln::cl_I ex_to_z_mpoly(const ex & e, const monomial_packing & pk, z_mpoly & a)
+{
+	const cln::cl_RA c = packed_mpoly_to_z_mpoly(ex_to_packed_mpoly(e, pk), a);
+	// A polynomial over the rationals has a GCD only up to a rational
+	// factor, so the content doesn't matter then.
+	return cln::integerp(c) ? cln::the<cln::cl_I>(c) : cln::cl_I(1);
+}
+
+ex z_mpoly_to_ex(const z_mpoly & a, const monomial_packing & pk)
+{
+	packed_mpoly pa;
+	pa.reserve(a.size());
+	for (size_t i = 0; i < a.size(); ++i)
+		pa.push_back(packed_term(a[i].mon, a[i].coeff));
+	return packed_mpoly_to_ex(pa, pk);
+}
+
+} // namespace GiNaC
@@ -0,0 +1,157 @@
+/** @file sparse_mpoly.h
+ *
+ *  Sparse distributed multivariate polynomials over Z and Z_p with packed
+ *  exponent vectors, used by the modular GCD algorithms. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_SPARSE_MPOLY_H
+#define GINAC_SPARSE_MPOLY_H
+
+#include "packed_mpoly.h"
+
+#include <cln/integer.h>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace GiNaC {
+
+/** A term of a sparse polynomial with coefficients of type T. */
+template<typename T> struct sparse_term {
+	sparse_term() { }
+	sparse_term(packed_monomial m, const T & c) : mon(m), coeff(c) { }
+	packed_monomial mon;
+	T coeff;
+};
+
+/** Sparse distributed polynomial over Z_p. The terms are sorted by
+ *  decreasing monomials (see monomial_packing), the coefficients are
+ *  non-zero and in the range [0, p). */
+typedef std::vector<sparse_term<long> > zp_mpoly;
+
+/** Sparse distributed polynomial over Z, with terms as in zp_mpoly. */
+typedef std::vector<sparse_term<cln::cl_I> > z_mpoly;
+
+/** Dense univariate polynomial over Z_p. The coefficient of x^i is stored
+ *  at index i, the last coefficient is non-zero. */
+typedef std::vector<long> zp_upoly;
+
+/** A polynomial over Z_p viewed as a polynomial in all variables but one
+ *  (x, say) with coefficients in Z_p[x]: pairs of monomials not containing
+ *  x and their coefficients, sorted by decreasing monomials. */
+typedef std::vector<std::pair<packed_monomial, zp_upoly> > zp_mpoly_coeffs;
+
+/** Moduli must be smaller than this, so that sums of two residues fit
+ *  into a long and products into an unsigned long long. */
+const long max_sparse_modulus = 1L << 30;
+
+inline long add_mod(long a, long b, long p)
+{
+	const long s = a + b;
+	return s >= p ? s - p : s;
+}
+
+inline long sub_mod(long a, long b, long p)
+{
+	return a >= b ? a - b : a - b + p;
+}
+
+inline long mul_mod(long a, long b, long p)
+{
+	return long((unsigned long long)a * (unsigned long long)b % (unsigned long long)p);
+}
+
+/** Inverse of a modulo p, a must not be divisible by p. */
+extern long recip_mod(long a, long p);
+
+/** a mod p, in the range [0, p). */
+extern long to_mod(const cln::cl_I & a, long p);
+
+// univariate polynomials over Z_p
+
+extern zp_upoly zp_upoly_mul(const zp_upoly & a, const zp_upoly & b, long p);
+/** Division with remainder, a == q*b + r with deg(r) < deg(b). */
+extern void zp_upoly_divide(const zp_upoly & a, const zp_upoly & b, zp_upoly & q, zp_upoly & r, long p);
+/** Monic GCD by the Euclidean algorithm. */
+extern zp_upoly zp_upoly_gcd(zp_upoly a, zp_upoly b, long p);
+extern long zp_upoly_eval(const zp_upoly & a, long x, long p);
+/** Values of a at all points x at once, v[j] == zp_upoly_eval(a, x[j], p). */
+extern void zp_upoly_eval_points(const zp_upoly & a, const std::vector<long> & x, long p,
+                                 std::vector<long> & v);
+extern void zp_upoly_make_monic(zp_upoly & a, long p);
+
+// multivariate polynomials over Z_p
+
+extern zp_mpoly zp_mpoly_add(const zp_mpoly & a, const zp_mpoly & b, long p);
+extern zp_mpoly zp_mpoly_sub(const zp_mpoly & a, const zp_mpoly & b, long p);
+/** Multiply a by c, c must be non-zero mod p. */
+extern void zp_mpoly_scale(zp_mpoly & a, long c, long p);
+/** Product of a and the polynomial u in the variable var. */
+extern zp_mpoly zp_mpoly_mul_upoly(const zp_mpoly & a, const zp_upoly & u, size_t var,
+                                   const monomial_packing & pk, long p);
+/** Substitute x for the variable var. */
+extern zp_mpoly zp_mpoly_eval(const zp_mpoly & a, size_t var, long x,
+                              const monomial_packing & pk, long p);
+/** Substitute each of the points x for the variable var, all at once:
+ *  r[j] == zp_mpoly_eval(a, var, x[j], pk, p). The arithmetic is done on
+ *  the values for all points side by side, which the compiler vectorizes. */
+extern void zp_mpoly_eval_points(const zp_mpoly & a, size_t var, const std::vector<long> & x,
+                                 const monomial_packing & pk, long p, std::vector<zp_mpoly> & r);
+/** Substitute x_k = pts[j][k-1] for k = 1, ..., pts[j].size() at all
+ *  points j at once, leaving the polynomials r[j] in x_0. The exponents of
+ *  any further variables are ignored. */
+extern void zp_mpoly_eval_points_but_x0(const zp_mpoly & a, const std::vector<std::vector<long> > & pts,
+                                        const monomial_packing & pk, long p, std::vector<zp_upoly> & r);
+/** Split a into coefficients in Z_p[x_var], see zp_mpoly_coeffs. */
+extern void zp_mpoly_split(const zp_mpoly & a, size_t var, const monomial_packing & pk,
+                           zp_mpoly_coeffs & c);
+/** Inverse of zp_mpoly_split(). */
+extern zp_mpoly zp_mpoly_join(const zp_mpoly_coeffs & c, size_t var, const monomial_packing & pk);
+/** Exact division with a heap of products (Monagan & Pearce). Returns
+ *  false if b doesn't divide a. */
+extern bool zp_mpoly_divide(const zp_mpoly & a, const zp_mpoly & b, zp_mpoly & q,
+                            const monomial_packing & pk, long p);
+
+// multivariate polynomials over Z
+
+/** Image of a in Z_p[x_0, ..., x_n]. */
+extern zp_mpoly z_mpoly_mod(const z_mpoly & a, long p);
+/** Lift a \in Z_p[x_0, ..., x_n] to Z, using the symmetric representation. */
+extern z_mpoly z_mpoly_from_zp(const zp_mpoly & a, long p);
+/** Exact division with a heap of products (Monagan & Pearce). Returns
+ *  false if b doesn't divide a. */
+extern bool z_mpoly_divide(const z_mpoly & a, const z_mpoly & b, z_mpoly & q,
+                           const monomial_packing & pk);
+/** GCD of the coefficients (non-negative). */
+extern cln::cl_I z_mpoly_content(const z_mpoly & a);
+/** Largest absolute value of the coefficients. */
+extern cln::cl_I z_mpoly_max_coeff(const z_mpoly & a);
+/** Split a polynomial with rational coefficients into its (positive)
+ *  content c and a primitive polynomial a over Z, so that e = c*a. */
+extern cln::cl_RA packed_mpoly_to_z_mpoly(const packed_mpoly & e, z_mpoly & a);
+/** Convert an expanded polynomial in the variables of pk with rational
+ *  coefficients into a primitive polynomial over Z. Returns its integer
+ *  content if the coefficients of e are integers, and 1 otherwise. */
+extern cln::cl_I ex_to_z_mpoly(const ex & e, const monomial_packing & pk, z_mpoly & a);
+extern ex z_mpoly_to_ex(const z_mpoly & a, const monomial_packing & pk);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_SPARSE_MPOLY_H
@@ -0,0 +1,306 @@
+/** @file sqrfree_mod.cpp
+ *
+ *  Square-free decomposition of multivariate polynomials by Yun's algorithm
+ *  modulo primes.
+ *
+ *  The polynomial is converted into sparse form once, and Yun's algorithm
+ *  runs on its images modulo word-sized primes, with pgcd() for the GCDs.
+ *  The images of the factors, normalized to the leading coefficient of the
+ *  polynomial, are combined by the Chinese remainder algorithm until they
+ *  don't change any more, and the primitive parts of the result are checked
+ *  by trial division. The images modulo different primes are independent,
+ *  so several of them are computed at once by parallel_for(). */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "sqrfree_mod.h"
+#include "operators.h"
+#include "pgcd.h"
+#include "poly_cra.h"
+#include "primes_factory.h"
+#include "packed_mpoly.h"
+#include "sparse_mpoly.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cln/integer.h>
+#include <cln/random.h>
+
+namespace GiNaC {
+
+/** Upper limit of the number of images computed at once. */
+static const std::size_t max_parallel_images = 16;
+
+/** Number of primes in a row for which Yun's algorithm may fail before we
+ *  give up. */
+static const unsigned max_failed_images = 8;
+
+/** Derivative of a with respect to the variable var. The degree of a in var
+ *  must be smaller than p. */
+static zp_mpoly zp_mpoly_diff(const zp_mpoly& a, const std::size_t var,
+			      const monomial_packing& pk, const long p)
+{
+	zp_mpoly r;
+	r.reserve(a.size());
+	const packed_monomial one = pk.pack(var, 1);
+	for (std::size_t i = 0; i < a.size(); ++i) {
+		const unsigned e = pk.exponent(a[i].mon, var);
+		if (e == 0)
+			continue;
+		const long c = mul_mod(a[i].coeff, long(e), p);
+		if (c != 0)
+			r.push_back(sparse_term<long>(a[i].mon - one, c));
+	}
+	return r;
+}
+
+static void zp_mpoly_make_monic(zp_mpoly& a, const long p)
+{
+	if (!a.empty() && a[0].coeff != 1)
+		zp_mpoly_scale(a, recip_mod(a[0].coeff, p), p);
+}
+
+/** Square-free decomposition modulo one prime. */
+struct yun_image {
+	/** False if the algorithm failed for this prime. */
+	bool ok;
+	/** Leading monomial of gcd(a, da/dx). Unlucky primes give a larger
+	 *  GCD, hence a larger leading monomial. */
+	packed_monomial gcd_deg;
+	/** Monic factors, the i-th one has multiplicity i+1. */
+	std::vector<zp_mpoly> factors;
+};
+
+/** Yun's algorithm over Z_p. */
+static void zp_yun(const zp_mpoly& a, const std::size_t x, const monomial_packing& pk,
+		   const long p, cln::random_state& rs, yun_image& im)
+{
+	const std::size_t var = pk.nvars() - 1;
+	const unsigned max_factors = pk.max_exponent(x);
+	im.ok = false;
+	im.factors.clear();
+
+	zp_mpoly w(a), y, t;
+	zp_mpoly z = zp_mpoly_diff(w, x, pk, p);
+	if (z.empty())
+		return;
+	try {
+		zp_mpoly g = pgcd(w, z, var, pk, p, false, rs);
+		zp_mpoly_make_monic(g, p);
+		im.gcd_deg = g[0].mon;
+		if (im.gcd_deg == 0) {
+			im.factors.push_back(w);
+			zp_mpoly_make_monic(im.factors.back(), p);
+			im.ok = true;
+			return;
+		}
+		do {
+			if (!zp_mpoly_divide(w, g, t, pk, p) ||
+			    !zp_mpoly_divide(z, g, y, pk, p) ||
+			    im.factors.size() == max_factors)
+				return;
+			w.swap(t);
+			z = zp_mpoly_sub(y, zp_mpoly_diff(w, x, pk, p), p);
+			g = z.empty() ? w : pgcd(w, z, var, pk, p, false, rs);
+			zp_mpoly_make_monic(g, p);
+			im.factors.push_back(g);
+		} while (!z.empty());
+	} catch (pgcd_failed&) {
+		return;
+	}
+	im.ok = true;
+}
+
+/** Computes images[k] = zp_yun(Ap[k]) modulo primes[k]. */
+struct yun_images_task : public parallel_task {
+	yun_images_task(const std::vector<zp_mpoly>& Ap_, std::vector<yun_image>& images_,
+			const std::vector<long>& primes_, std::vector<cln::random_state>& states_,
+			const std::size_t x_, const monomial_packing& pk_)
+	  : Ap(Ap_), images(images_), primes(primes_), states(states_), x(x_), pk(pk_) { }
+	void operator()(size_t k)
+	{
+		zp_yun(Ap[k], x, pk, primes[k], states[k], images[k]);
+	}
+	const std::vector<zp_mpoly>& Ap;
+	std::vector<yun_image>& images;
+	const std::vector<long>& primes;
+	std::vector<cln::random_state>& states;
+	const std::size_t x;
+	const monomial_packing& pk;
+};
+
+static bool same_terms(const z_mpoly& a, const z_mpoly& b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (std::size_t i = 0; i < a.size(); ++i)
+		if (a[i].mon != b[i].mon || a[i].coeff != b[i].coeff)
+			return false;
+	return true;
+}
+
+/** Check whether the image im has the same number of factors with the same
+ *  leading monomials as the candidate H. */
+static bool same_shape(const std::vector<z_mpoly>& H, const yun_image& im)
+{
+	if (H.size() != im.factors.size())
+		return false;
+	for (std::size_t i = 0; i < H.size(); ++i)
+		if (H[i][0].mon != im.factors[i][0].mon)
+			return false;
+	return true;
+}
+
+/** Check whether A is the product of the primitive parts of H[i] to the
+ *  power i+1 and of a polynomial not containing x. If so, store these
+ *  primitive parts in factors. */
+static bool yun_check(const z_mpoly& A, const std::vector<z_mpoly>& H, const std::size_t x,
+		      const monomial_packing& pk, exvector& factors)
+{
+	std::vector<z_mpoly> C(H);
+	z_mpoly q(A), t;
+	for (std::size_t i = 0; i < C.size(); ++i) {
+		const cln::cl_I c = z_mpoly_content(C[i]);
+		for (std::size_t j = 0; j < C[i].size(); ++j)
+			C[i][j].coeff = cln::exquo(C[i][j].coeff, c);
+		for (std::size_t k = 0; k <= i; ++k) {
+			if (!z_mpoly_divide(q, C[i], t, pk))
+				return false;
+			q.swap(t);
+		}
+	}
+	for (std::size_t j = 0; j < q.size(); ++j)
+		if (pk.exponent(q[j].mon, x) != 0)
+			return false;
+
+	factors.clear();
+	factors.reserve(C.size());
+	for (std::size_t i = 0; i < C.size(); ++i)
+		factors.push_back(z_mpoly_to_ex(C[i], pk));
+	return true;
+}
+
+bool sqrfree_yun_modular(const ex& a, const ex& x, exvector& factors)
+{
+	const ex e = a.expand();
+	exvector vars;
+	std::vector<unsigned> degrees;
+	if (!packed_mpoly_collect_vars(e, vars, degrees))
+		return false;
+	std::size_t xi = 0;
+	while (xi < vars.size() && !vars[xi].is_equal(x))
+		++xi;
+	if (xi == vars.size())
+		return false;
+	// x is the variable pgcd() evaluates last
+	std::swap(vars[xi], vars.back());
+	std::swap(degrees[xi], degrees.back());
+	const std::size_t xv = vars.size() - 1;
+
+	// Room for the interpolation polynomials of pgcd()
+	std::vector<unsigned> capacity(vars.size());
+	for (std::size_t i = 0; i < vars.size(); ++i)
+		capacity[i] = 2*degrees[i] + 2;
+	monomial_packing pk;
+	if (!pk.init(vars, capacity))
+		return false;
+
+	z_mpoly A;
+	ex_to_z_mpoly(e, pk, A);
+	if (A.empty())
+		return false;
+	// Every factor divides A, so its leading coefficient divides this one
+	const cln::cl_I lc = A[0].coeff;
+
+	const std::size_t batch = parallel_threads(max_parallel_images);
+	std::vector<cln::random_state> states(batch);
+	std::vector<long> primes;
+	std::vector<zp_mpoly> Ap;
+	std::vector<yun_image> images;
+
+	cln::cl_I q = 0;
+	packed_monomial n = 0;
+	std::vector<z_mpoly> H;
+	unsigned failed = 0;
+
+	long p;
+	primes_factory pfactory;
+	while (true) {
+		primes.clear();
+		while (primes.size() < batch) {
+			if (!pfactory(p, lc) || p >= max_sparse_modulus)
+				break;
+			primes.push_back(p);
+		}
+		if (primes.empty())
+			return false;
+
+		Ap.resize(primes.size());
+		images.resize(primes.size());
+		for (std::size_t k = 0; k < primes.size(); ++k)
+			Ap[k] = z_mpoly_mod(A, primes[k]);
+		if (primes.size() > 1) {
+			yun_images_task task(Ap, images, primes, states, xv, pk);
+			parallel_for(primes.size(), task);
+		} else
+			zp_yun(Ap[0], xv, pk, primes[0], states[0], images[0]);
+
+		for (std::size_t k = 0; k < primes.size(); ++k) {
+			yun_image& im = images[k];
+			if (!im.ok) {
+				if (++failed == max_failed_images)
+					return false;
+				continue;
+			}
+			failed = 0;
+			p = primes[k];
+			const long lcp = to_mod(lc, p);
+			for (std::size_t i = 0; i < im.factors.size(); ++i)
+				zp_mpoly_scale(im.factors[i], lcp, p);
+
+			// Set if the new image doesn't change the candidate
+			bool stable = false;
+			if (zerop(q) || im.gcd_deg < n) {
+				// first image, or all previous primes were unlucky
+				H.clear();
+				for (std::size_t i = 0; i < im.factors.size(); ++i)
+					H.push_back(z_mpoly_from_zp(im.factors[i], p));
+				n = im.gcd_deg;
+				q = p;
+			} else if (im.gcd_deg == n && same_shape(H, im)) {
+				stable = true;
+				for (std::size_t i = 0; i < H.size(); ++i) {
+					z_mpoly H_next = chinese_remainder(H[i], q, im.factors[i], p);
+					if (!same_terms(H[i], H_next))
+						stable = false;
+					H[i].swap(H_next);
+				}
+				q = q*cln::cl_I(p);
+			} else {
+				// current prime is unlucky
+				continue;
+			}
+			if (stable && yun_check(A, H, xv, pk, factors))
+				return true;
+			// else: try more primes
+		}
+	}
+}
+
+} // namespace GiNaC
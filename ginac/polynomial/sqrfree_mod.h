@@ -0,0 +1,46 @@
+/** @file sqrfree_mod.h
+ *
+ *  Square-free decomposition of multivariate polynomials by Yun's algorithm
+ *  modulo primes. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_SQRFREE_MOD_H
+#define GINAC_SQRFREE_MOD_H
+
+#include "ex.h"
+
+namespace GiNaC {
+
+/**
+ * Square-free decomposition of the polynomial a with respect to x, with
+ * the same result as Yun's algorithm over Z: a is the product of factors[i]
+ * to the power i+1 and of a polynomial not containing x. The factors are
+ * primitive, square-free and pairwise coprime (some of them may be 1).
+ *
+ * Returns false, so that the caller can fall back to the generic code, if
+ * a is not a polynomial in symbols with rational coefficients which depends
+ * on x, if its exponents are too large for the sparse representation, or
+ * if we run out of small primes.
+ */
+extern bool sqrfree_yun_modular(const ex& a, const ex& x, exvector& factors);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_SQRFREE_MOD_H
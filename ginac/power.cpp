@@ -37,9 +37,14 @@
 #include "utils.h"
 #include "relational.h"
 #include "compiler.h"
+#include "parallel.h"
+#include "polynomial/packed_mpoly.h"
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <limits>
+#include <map>
 #include <stdexcept>
 #include <vector>
 
@@ -55,6 +60,127 @@ GINAC_IMPLEMENT_REGISTERED_CLASS_OPT(power, basic,
 
 typedef std::vector<int> intvector;
 
+/** Computes the terms of power::expand_add() for a list of compositions
+ *  of the exponent. */
+struct expand_add_task : public parallel_task {
+	expand_add_task(const power & p_, const add & a_, int n_, const std::vector<intvector> & ks_, unsigned options_, exvector & result_)
+	 : p(p_), a(a_), n(n_), ks(ks_), options(options_), result(result_) {}
+	void operator()(size_t i) { result[i] = p.expand_add_term(a, n, ks[i], options); }
+
+	const power & p;
+	const add & a;
+	const int n;
+	const std::vector<intvector> & ks;
+	const unsigned options;
+	exvector & result;
+};
+
+/** Generates the terms of (c_0*t_0 + ... + c_{m-1}*t_{m-1})^n, where the
+ *  c_i are numbers and the t_i are products of integer powers of symbols,
+ *  given by their exponent vectors. The coefficients of the multinomial
+ *  expansion are computed incrementally along the compositions of n, and
+ *  the terms are built directly as monomials.
+ *  @see power::expand_add_monomials */
+class multinomial_terms {
+public:
+	multinomial_terms(const exvector & syms_, const std::vector<numeric> & c_,
+	                  const std::vector<intvector> & e_, int n_)
+	 : syms(syms_), c(c_), e(e_), n(n_), acc(c_.size(), intvector(syms_.size()))
+	{
+		// The powers of the last coefficient are needed once per term
+		last_powers.reserve(n + 1);
+		last_powers.push_back(*_num1_p);
+		for (int i=1; i<=n; ++i)
+			last_powers.push_back(last_powers.back().mul(c.back()));
+	}
+
+	/** Append the terms in which t_0 is raised to the power k0 to terms,
+	 *  and add the one without symbols to constant. */
+	void generate(int k0, epvector & terms, numeric & constant)
+	{
+		const numeric f = binomial(numeric(n), numeric(k0)).mul(c[0].power(k0));
+		for (size_t j=0; j<syms.size(); ++j)
+			acc[1][j] = k0 * e[0][j];
+		descend(1, n - k0, f, terms, constant);
+	}
+
+private:
+	/** Distribute the remaining power r over t_l, ..., t_{m-1}. f is the
+	 *  coefficient so far, acc[l] the exponents so far. */
+	void descend(size_t l, int r, const numeric & f, epvector & terms, numeric & constant)
+	{
+		const intvector & el = e[l];
+		if (l + 1 == c.size()) {
+			intvector & a = acc[l];
+			for (size_t j=0; j<syms.size(); ++j)
+				a[j] += r * el[j];
+			emit(a, f.mul(last_powers[r]), terms, constant);
+			for (size_t j=0; j<syms.size(); ++j)
+				a[j] -= r * el[j];
+			return;
+		}
+		intvector & next = acc[l + 1];
+		next = acc[l];
+		numeric binom = *_num1_p, cpow = *_num1_p;
+		for (int k=0; ; ++k) {
+			descend(l + 1, r - k, f.mul(binom).mul(cpow), terms, constant);
+			if (k == r)
+				break;
+			binom = binom.mul(numeric(r - k)).div(numeric(k + 1));
+			cpow = cpow.mul(c[l]);
+			for (size_t j=0; j<syms.size(); ++j)
+				next[j] += el[j];
+		}
+	}
+
+	void emit(const intvector & a, const numeric & f, epvector & terms, numeric & constant) const
+	{
+		epvector factors;
+		for (size_t j=0; j<syms.size(); ++j)
+			if (a[j] != 0)
+				factors.push_back(expair(syms[j], numeric(a[j])));
+
+		if (factors.empty()) {
+			constant = constant.add(f);
+		} else if (factors.size() == 1 && factors[0].coeff.is_equal(_ex1)) {
+			terms.push_back(expair(factors[0].rest, f));
+		} else if (factors.size() == 1) {
+			terms.push_back(expair((new power(factors[0].rest, factors[0].coeff))->setflag(status_flags::dynallocated | status_flags::expanded), f));
+		} else {
+			terms.push_back(expair((new mul(std::move(factors)))->setflag(status_flags::dynallocated | status_flags::expanded), f));
+		}
+	}
+
+	const exvector & syms;
+	const std::vector<numeric> & c;
+	const std::vector<intvector> & e;
+	const int n;
+	std::vector<intvector> acc;
+	std::vector<numeric> last_powers;
+};
+
+/** Generates the terms of power::expand_add_monomials() for each power of
+ *  the first term of the sum. */
+struct multinomial_task : public parallel_task {
+	multinomial_task(const exvector & syms_, const std::vector<numeric> & c_,
+	                 const std::vector<intvector> & e_, int n_)
+	 : syms(syms_), c(c_), e(e_), n(n_), terms(n_ + 1), constants(n_ + 1) {}
+	void operator()(size_t i)
+	{
+		// Each call uses its own generator, so that no numbers are shared
+		// between the threads
+		multinomial_terms gen(syms, c, e, n);
+		gen.generate(i, terms[i], constants[i]);
+	}
+
+	const exvector & syms;
+	const std::vector<numeric> & c;
+	const std::vector<intvector> & e;
+	const int n;
+	std::vector<epvector> terms;
+	std::vector<numeric> constants;
+};
+
 //////////
 // default constructor
 //////////
@@ -74,8 +200,8 @@ power::power() { }
 void power::read_archive(const archive_node &n, lst &sym_lst)
 {
 	inherited::read_archive(n, sym_lst);
-	n.find_ex("basis", basis, sym_lst);
-	n.find_ex("exponent", exponent, sym_lst);
+	n.find_ex(archive_node::KN_BASIS, basis, sym_lst);
+	n.find_ex(archive_node::KN_EXPONENT, exponent, sym_lst);
 }
 
 void power::archive(archive_node &n) const
@@ -296,6 +422,8 @@ bool power::is_polynomial(const ex & var) const
 
 int power::degree(const ex & s) const
 {
+	if (!may_contain(s))
+		return 0;
 	if (is_equal(ex_to<basic>(s)))
 		return 1;
 	else if (is_exactly_a<numeric>(exponent) && ex_to<numeric>(exponent).is_integer()) {
@@ -311,6 +439,8 @@ int power::degree(const ex & s) const
 
 int power::ldegree(const ex & s) const 
 {
+	if (!may_contain(s))
+		return 0;
 	if (is_equal(ex_to<basic>(s)))
 		return 1;
 	else if (is_exactly_a<numeric>(exponent) && ex_to<numeric>(exponent).is_integer()) {
@@ -326,6 +456,8 @@ int power::ldegree(const ex & s) const
 
 ex power::coeff(const ex & s, int n) const
 {
+	if (!may_contain(s))
+		return n==0 ? ex(*this) : _ex0;
 	if (is_equal(ex_to<basic>(s)))
 		return n==1 ? _ex1 : _ex0;
 	else if (!basis.is_equal(s)) {
@@ -353,6 +485,22 @@ ex power::coeff(const ex & s, int n) const
 	}
 }
 
+void power::coeffs(const ex & s, std::map<int, ex> & c) const
+{
+	if (may_contain(s)) {
+		if (is_equal(ex_to<basic>(s))) {
+			c.insert(std::make_pair(1, _ex1));
+			return;
+		}
+		if (basis.is_equal(s) && is_exactly_a<numeric>(exponent) && ex_to<numeric>(exponent).is_integer()) {
+			c.insert(std::make_pair(ex_to<numeric>(exponent).to_int(), _ex1));
+			return;
+		}
+	}
+	// non-integer exponents are treated as zero
+	c.insert(std::make_pair(0, ex(*this)));
+}
+
 /** Perform automatic term rewriting rules in this class.  In the following
  *  x, x1, x2,... stand for a symbolic variables of type ex and c, c1, c2...
  *  stand for such expressions that contain a plain number.
@@ -705,6 +853,10 @@ ex power::real_part() const
 		result = result.subs(lst( a==basis_real, b==basis.imag_part() ));
 		return result;
 	}
+
+	// A positive number to a real power is real
+	if (basis.info(info_flags::positive) && exponent.imag_part().is_zero())
+		return *this;
 	
 	ex a = basis.real_part();
 	ex b = basis.imag_part();
@@ -730,6 +882,10 @@ ex power::imag_part() const
 		result = result.subs(lst( a==basis_real, b==basis.imag_part() ));
 		return result;
 	}
+
+	// A positive number to a real power is real
+	if (basis.info(info_flags::positive) && exponent.imag_part().is_zero())
+		return 0;
 	
 	ex a=basis.real_part();
 	ex b=basis.imag_part();
@@ -860,6 +1016,36 @@ ex power::expand(unsigned options) const
 // non-virtual functions in this class
 //////////
 
+/** Decide whether a^n is expanded faster by repeated squaring of the
+ *  polynomial a than term by term along the compositions of n. This is
+ *  the case for dense polynomials, where many compositions give the same
+ *  monomial: the number of compositions is compared with the cost of the
+ *  last squaring, estimated from the number of monomials of a^(n/2) which
+ *  fit into the degree bounds.
+ *  @see power::expand_add */
+static bool expand_by_squaring(const add & a, int n)
+{
+	if (n < 4)
+		return false;
+	exvector vars;
+	std::vector<unsigned> degrees;
+	if (!packed_mpoly_collect_vars(a, vars, degrees))
+		return false;
+
+	const double m = a.nops();
+	const double half = (n + 1) / 2;
+	double compositions = 1, compositions_half = 1;
+	for (int i = 1; i < m; ++i) {
+		compositions *= (n + i) / double(i);
+		compositions_half *= (half + i) / double(i);
+	}
+	double box_half = 1;
+	for (size_t l = 0; l < degrees.size() && box_half < compositions_half; ++l)
+		box_half *= half * degrees[l] + 1;
+	const double terms_half = std::min(box_half, compositions_half);
+	return terms_half * terms_half < compositions;
+}
+
 /** expand a^n where a is an add and n is a positive integer.
  *  @see power::expand */
 ex power::expand_add(const add & a, int n, unsigned options) const
@@ -867,13 +1053,24 @@ ex power::expand_add(const add & a, int n, unsigned options) const
 	if (n==2)
 		return expand_add_2(a, options);
 
+	if (expand_by_squaring(a, n)) {
+		ex result_packed;
+		if (expand_power_packed(a, n, options, result_packed))
+			return result_packed;
+	}
+
+	ex result_monomials;
+	if (expand_add_monomials(a, n, options, result_monomials))
+		return result_monomials;
+
 	const size_t m = a.nops();
 	exvector result;
 	// The number of terms will be the number of combinatorial compositions,
 	// i.e. the number of unordered arrangements of m nonnegative integers
 	// which sum up to n.  It is frequently written as C_n(m) and directly
 	// related with binomial coefficients:
-	result.reserve(binomial(numeric(n+m-1), numeric(m-1)).to_int());
+	const size_t nterms = binomial(numeric(n+m-1), numeric(m-1)).to_long();
+	result.reserve(nterms);
 	intvector k(m-1);
 	intvector k_cum(m-1); // k_cum[l]:=sum(i=0,l,k[l]);
 	intvector upper_limit(m-1);
@@ -884,44 +1081,20 @@ ex power::expand_add(const add & a, int n, unsigned options) const
 		upper_limit[l] = n;
 	}
 
-	while (true) {
-		exvector term;
-		term.reserve(m+1);
-		for (std::size_t l = 0; l < m - 1; ++l) {
-			const ex & b = a.op(l);
-			GINAC_ASSERT(!is_exactly_a<add>(b));
-			GINAC_ASSERT(!is_exactly_a<power>(b) ||
-			             !is_exactly_a<numeric>(ex_to<power>(b).exponent) ||
-			             !ex_to<numeric>(ex_to<power>(b).exponent).is_pos_integer() ||
-			             !is_exactly_a<add>(ex_to<power>(b).basis) ||
-			             !is_exactly_a<mul>(ex_to<power>(b).basis) ||
-			             !is_exactly_a<power>(ex_to<power>(b).basis));
-			if (is_exactly_a<mul>(b))
-				term.push_back(expand_mul(ex_to<mul>(b), numeric(k[l]), options, true));
-			else
-				term.push_back(power(b,k[l]));
-		}
+	// In parallel mode, only the compositions are generated here and the
+	// terms are computed afterwards by several threads.
+	const bool parallel = (options & expand_options::parallel) &&
+	                      parallel_threads(nterms) > 1 &&
+	                      numerics_are_immediate(a.seq, a.overall_coeff);
+	std::vector<intvector> compositions;
+	if (parallel)
+		compositions.reserve(nterms);
 
-		const ex & b = a.op(m - 1);
-		GINAC_ASSERT(!is_exactly_a<add>(b));
-		GINAC_ASSERT(!is_exactly_a<power>(b) ||
-		             !is_exactly_a<numeric>(ex_to<power>(b).exponent) ||
-		             !ex_to<numeric>(ex_to<power>(b).exponent).is_pos_integer() ||
-		             !is_exactly_a<add>(ex_to<power>(b).basis) ||
-		             !is_exactly_a<mul>(ex_to<power>(b).basis) ||
-		             !is_exactly_a<power>(ex_to<power>(b).basis));
-		if (is_exactly_a<mul>(b))
-			term.push_back(expand_mul(ex_to<mul>(b), numeric(n-k_cum[m-2]), options, true));
+	while (true) {
+		if (parallel)
+			compositions.push_back(k);
 		else
-			term.push_back(power(b,n-k_cum[m-2]));
-
-		numeric f = binomial(numeric(n),numeric(k[0]));
-		for (std::size_t l = 1; l < m - 1; ++l)
-			f *= binomial(numeric(n-k_cum[l-1]),numeric(k[l]));
-
-		term.push_back(f);
-
-		result.push_back(ex((new mul(term))->setflag(status_flags::dynallocated)).expand(options));
+			result.push_back(expand_add_term(a, n, k, options));
 
 		// increment k[]
 		bool done = false;
@@ -948,10 +1121,155 @@ ex power::expand_add(const add & a, int n, unsigned options) const
 			upper_limit[i] = n-k_cum[i-1];
 	}
 
+	if (parallel) {
+		result.resize(compositions.size());
+		prepare_for_threads(a.seq, a.overall_coeff);
+		expand_add_task task(*this, a, n, compositions, options, result);
+		parallel_for(compositions.size(), task);
+	}
+
 	return (new add(result))->setflag(status_flags::dynallocated |
 	                                  status_flags::expanded);
 }
 
+/** Expand a^n like power::expand_add() if the terms of a are products of
+ *  integer powers of symbols. The terms of the result are generated as
+ *  exponent vectors, which saves building and expanding a product for
+ *  each of them. Returns false (and leaves result alone) if a has other
+ *  terms.
+ *  @see power::expand_add */
+bool power::expand_add_monomials(const add & a, int n, unsigned options, ex & result) const
+{
+	// Find the symbols and the exponent vectors of the terms
+	typedef std::map<ex, size_t, ex_is_less> symbol_index;
+	symbol_index index;
+	exvector syms;
+	std::vector<intvector> e;
+	std::vector<numeric> c;
+	e.reserve(a.seq.size() + 1);
+	c.reserve(a.seq.size() + 1);
+	for (epvector::const_iterator i = a.seq.begin(); i != a.seq.end(); ++i) {
+		exvector factors;
+		if (is_exactly_a<mul>(i->rest)) {
+			const mul & m = ex_to<mul>(i->rest);
+			if (!m.overall_coeff.is_equal(_ex1))
+				return false;
+			for (epvector::const_iterator j = m.seq.begin(); j != m.seq.end(); ++j)
+				factors.push_back(m.recombine_pair_to_ex(*j));
+		} else
+			factors.push_back(i->rest);
+
+		e.push_back(intvector(syms.size()));
+		for (exvector::const_iterator f = factors.begin(); f != factors.end(); ++f) {
+			ex s = *f;
+			numeric k = *_num1_p;
+			if (is_exactly_a<power>(s)) {
+				const power & p = ex_to<power>(s);
+				if (!is_exactly_a<numeric>(p.exponent))
+					return false;
+				s = p.basis;
+				k = ex_to<numeric>(p.exponent);
+			}
+			if (!is_a<symbol>(s) || !k.is_integer() ||
+			    abs(k) > numeric(std::numeric_limits<int>::max() / n))
+				return false;
+			std::pair<symbol_index::iterator, bool> ins = index.insert(std::make_pair(s, syms.size()));
+			if (ins.second) {
+				syms.push_back(s);
+				for (size_t l=0; l<e.size(); ++l)
+					e[l].push_back(0);
+			}
+			e.back()[ins.first->second] += k.to_int();
+		}
+		c.push_back(ex_to<numeric>(i->coeff));
+	}
+	if (!a.overall_coeff.is_zero()) {
+		e.push_back(intvector(syms.size()));
+		c.push_back(ex_to<numeric>(a.overall_coeff));
+	}
+
+	// The number of compositions of n into m parts
+	const size_t m = c.size();
+	const size_t nterms = binomial(numeric(n+m-1), numeric(m-1)).to_long();
+	epvector terms;
+	numeric constant = *_num0_p;
+
+	const bool parallel = (options & expand_options::parallel) &&
+	                      parallel_threads(nterms) > 1 &&
+	                      numerics_are_immediate(a.seq, a.overall_coeff);
+	if (parallel) {
+		// Split the compositions by the power of the first term. The
+		// tasks share the symbols; the coefficients are only read.
+		prepare_for_threads(syms);
+		multinomial_task task(syms, c, e, n);
+		parallel_for(n + 1, task);
+		terms.reserve(nterms);
+		for (int k=0; k<=n; ++k) {
+			std::move(task.terms[k].begin(), task.terms[k].end(), std::back_inserter(terms));
+			constant = constant.add(task.constants[k]);
+		}
+	} else {
+		terms.reserve(nterms);
+		multinomial_terms gen(syms, c, e, n);
+		for (int k=0; k<=n; ++k)
+			gen.generate(k, terms, constant);
+	}
+
+	result = (new add(std::move(terms), constant))->setflag(status_flags::dynallocated |
+	                                                        status_flags::expanded);
+	return true;
+}
+
+/** Compute one term of the multinomial expansion of a^n, namely the one
+ *  where the first m-1 terms of a are raised to the powers k[0], ...,
+ *  k[m-2] and the last one to the remaining power n-k[0]-...-k[m-2].
+ *  @see power::expand_add */
+ex power::expand_add_term(const add & a, int n, const std::vector<int> & k, unsigned options) const
+{
+	const size_t m = a.nops();
+	exvector term;
+	term.reserve(m+1);
+	int k_sum = 0;
+	for (std::size_t l = 0; l < m - 1; ++l) {
+		const ex & b = a.op(l);
+		GINAC_ASSERT(!is_exactly_a<add>(b));
+		GINAC_ASSERT(!is_exactly_a<power>(b) ||
+		             !is_exactly_a<numeric>(ex_to<power>(b).exponent) ||
+		             !ex_to<numeric>(ex_to<power>(b).exponent).is_pos_integer() ||
+		             !is_exactly_a<add>(ex_to<power>(b).basis) ||
+		             !is_exactly_a<mul>(ex_to<power>(b).basis) ||
+		             !is_exactly_a<power>(ex_to<power>(b).basis));
+		if (is_exactly_a<mul>(b))
+			term.push_back(expand_mul(ex_to<mul>(b), numeric(k[l]), options, true));
+		else
+			term.push_back(power(b,k[l]));
+		k_sum += k[l];
+	}
+
+	const ex & b = a.op(m - 1);
+	GINAC_ASSERT(!is_exactly_a<add>(b));
+	GINAC_ASSERT(!is_exactly_a<power>(b) ||
+	             !is_exactly_a<numeric>(ex_to<power>(b).exponent) ||
+	             !ex_to<numeric>(ex_to<power>(b).exponent).is_pos_integer() ||
+	             !is_exactly_a<add>(ex_to<power>(b).basis) ||
+	             !is_exactly_a<mul>(ex_to<power>(b).basis) ||
+	             !is_exactly_a<power>(ex_to<power>(b).basis));
+	if (is_exactly_a<mul>(b))
+		term.push_back(expand_mul(ex_to<mul>(b), numeric(n-k_sum), options, true));
+	else
+		term.push_back(power(b,n-k_sum));
+
+	numeric f = binomial(numeric(n),numeric(k[0]));
+	int k_cum = k[0];
+	for (std::size_t l = 1; l < m - 1; ++l) {
+		f *= binomial(numeric(n-k_cum),numeric(k[l]));
+		k_cum += k[l];
+	}
+
+	term.push_back(f);
+
+	return ex((new mul(term))->setflag(status_flags::dynallocated)).expand(options);
+}
 
 /** Special case of power::expand_add. Expands a^2 where a is an add.
  *  @see power::expand_add */
@@ -40,6 +40,7 @@ class power : public basic
 	GINAC_DECLARE_REGISTERED_CLASS(power, basic)
 	
 	friend class mul;
+	friend struct expand_add_task;
 	
 // member functions
 	
@@ -59,6 +60,7 @@ public:
 	int degree(const ex & s) const;
 	int ldegree(const ex & s) const;
 	ex coeff(const ex & s, int n = 1) const;
+	void coeffs(const ex & s, std::map<int, ex> & c) const;
 	ex eval(int level=0) const;
 	ex evalf(int level=0) const;
 	ex evalm() const;
@@ -96,6 +98,8 @@ protected:
 	void do_print_csrc_cl_N(const print_csrc_cl_N & c, unsigned level) const;
 
 	ex expand_add(const add & a, int n, unsigned options) const;
+	ex expand_add_term(const add & a, int n, const std::vector<int> & k, unsigned options) const;
+	bool expand_add_monomials(const add & a, int n, unsigned options, ex & result) const;
 	ex expand_add_2(const add & a, unsigned options) const;
 	ex expand_mul(const mul & m, const numeric & n, unsigned options, bool from_expand = false) const;
 	
@@ -0,0 +1,193 @@
+/** @file profile.cpp
+ *
+ *  Statistics of the shape of expressions. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "profile.h"
+#include "expair.h"
+#include "hash_map.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <utility>
+
+namespace GiNaC {
+
+expression_profile::expression_profile(std::size_t max_ops, std::size_t num)
+ : max_operands(max_ops), num_largest(num), weight(1),
+   tree_nodes(0), dag_nodes(0), total_bytes(0), max_depth(0)
+{
+}
+
+void expression_profile::scan(const ex & e)
+{
+	const tree_metrics t = ex_to<basic>(e).metrics();
+	tree_nodes += t.size;
+
+	// Follow the operands of the greatest height down to a leaf
+	if (t.depth > max_depth) {
+		max_depth = t.depth;
+		path.clear();
+		ex x = e;
+		path.push_back(x);
+		while (x.nops()) {
+			ex deepest = x.op(0);
+			for (size_t i=1; i<x.nops(); ++i)
+				if (ex_to<basic>(x.op(i)).metrics().depth > ex_to<basic>(deepest).metrics().depth)
+					deepest = x.op(i);
+			x = deepest;
+			path.push_back(x);
+		}
+	}
+
+	// Visit every distinct subexpression once, with an explicit stack so
+	// that deep expressions don't exhaust the C++ stack
+	exhashset visited;
+	std::vector<std::pair<ex, double> > todo(1, std::make_pair(e, 1.0));
+	while (!todo.empty()) {
+		const ex x = todo.back().first;
+		const double w = todo.back().second;
+		todo.pop_back();
+		if (!visited.insert(x).second)
+			continue;
+		weight = w;
+		x.accept(*this);
+
+		const size_t n = x.nops();
+		if (max_operands && n > max_operands) {
+			const double scale = w * double(n) / max_operands;
+			for (size_t k=0; k<max_operands; ++k)
+				todo.push_back(std::make_pair(x.op(k * n / max_operands), scale));
+		} else {
+			for (size_t i=0; i<n; ++i)
+				todo.push_back(std::make_pair(x.op(i), w));
+		}
+	}
+}
+
+void expression_profile::record(const basic & b, std::size_t bytes)
+{
+	class_counts & c = by_class[b.class_name()];
+	c.nodes += weight;
+	c.bytes += weight * bytes;
+	dag_nodes += weight;
+	total_bytes += weight * bytes;
+}
+
+/** Keep e in v, which holds the largest sums or products by number of
+ *  operands, if it is large enough. */
+void expression_profile::note_largest(exvector & v, const ex & e)
+{
+	if (v.size() == num_largest && (num_largest == 0 || v.back().nops() >= e.nops()))
+		return;
+	exvector::iterator i = v.begin();
+	while (i != v.end() && i->nops() >= e.nops())
+		++i;
+	v.insert(i, e);
+	if (v.size() > num_largest)
+		v.pop_back();
+}
+
+// The memory of an object is estimated from the size of its class and the
+// storage of its operands.
+
+void expression_profile::visit(const basic & b)
+{
+	record(b, sizeof(basic) + b.nops() * sizeof(ex));
+}
+
+void expression_profile::visit(const GiNaC::add & a)
+{
+	record(a, sizeof(GiNaC::add) + a.nops() * sizeof(expair));
+	note_largest(sums, a);
+}
+
+void expression_profile::visit(const mul & m)
+{
+	record(m, sizeof(mul) + m.nops() * sizeof(expair));
+	note_largest(products, m);
+}
+
+void expression_profile::visit(const power & p)
+{
+	record(p, sizeof(power));
+}
+
+void expression_profile::visit(const numeric & n)
+{
+	// Small integers are stored in the object, others in limbs of CLN
+	const unsigned bits = n.metrics().bits;
+	record(n, sizeof(numeric) + (bits > 29 ? 2 * (bits / 8 + 16) : 0));
+}
+
+void expression_profile::visit(const symbol & s)
+{
+	record(s, sizeof(symbol));
+}
+
+void expression_profile::visit(const function & f)
+{
+	record(f, sizeof(function) + f.nops() * sizeof(ex));
+}
+
+void expression_profile::print(std::ostream & os) const
+{
+	os << "tree size " << tree_nodes << ", DAG size " << dag_nodes;
+	if (dag_nodes > 0)
+		os << " (sharing " << tree_nodes / dag_nodes << ")";
+	os << ", depth " << max_depth << ", memory " << total_bytes << " bytes";
+	if (max_operands)
+		os << " (sampled)";
+	os << std::endl;
+
+	std::vector<std::pair<double, std::string> > order;
+	for (class_map::const_iterator i = by_class.begin(); i != by_class.end(); ++i)
+		order.push_back(std::make_pair(-i->second.bytes, i->first));
+	std::sort(order.begin(), order.end());
+	os << std::setw(20) << std::left << "class" << std::right
+	   << std::setw(14) << "nodes" << std::setw(16) << "bytes" << std::endl;
+	for (size_t i = 0; i < order.size(); ++i) {
+		const class_counts & c = by_class.find(order[i].second)->second;
+		os << std::setw(20) << std::left << order[i].second << std::right
+		   << std::setw(14) << c.nodes << std::setw(16) << c.bytes << std::endl;
+	}
+
+	if (!sums.empty()) {
+		os << "largest sums:";
+		for (size_t i = 0; i < sums.size(); ++i)
+			os << ' ' << sums[i].nops();
+		os << " terms" << std::endl;
+	}
+	if (!products.empty()) {
+		os << "largest products:";
+		for (size_t i = 0; i < products.size(); ++i)
+			os << ' ' << products[i].nops();
+		os << " factors" << std::endl;
+	}
+	if (!path.empty()) {
+		os << "deepest path:";
+		for (size_t i = 0; i < path.size(); ++i)
+			os << (i ? " > " : " ") << ex_to<basic>(path[i]).class_name();
+		os << std::endl;
+	}
+}
+
+} // namespace GiNaC
@@ -0,0 +1,125 @@
+/** @file profile.h
+ *
+ *  Interface to statistics of the shape of expressions. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_PROFILE_H
+#define GINAC_PROFILE_H
+
+#include "ex.h"
+#include "basic.h"
+#include "add.h"
+#include "mul.h"
+#include "power.h"
+#include "numeric.h"
+#include "symbol.h"
+#include "function.h"
+
+#include <cstddef>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace GiNaC {
+
+/** Statistics of the shape of expressions, for finding out why they are
+ *  expensive: the number of distinct subexpressions and an estimate of
+ *  their memory by class, the sharing of subexpressions (tree size over
+ *  DAG size), the deepest path and the largest sums and products.
+ *
+ *  scan() walks the distinct subexpressions of an expression and lets each
+ *  accept() this visitor. For huge expressions, the walk can be limited to
+ *  a sample of max_operands (evenly spaced) operands of every node; the
+ *  counts below a node are then scaled by the fraction of its operands
+ *  that was visited, which estimates them in time proportional to the
+ *  size of the sample.
+ *
+ *  Example:
+ *  @code
+ *  expression_profile p;
+ *  p.scan(e);
+ *  p.print(std::cout);
+ *  @endcode */
+class expression_profile : public visitor, public basic::visitor,
+                           public add::visitor, public mul::visitor,
+                           public power::visitor, public numeric::visitor,
+                           public symbol::visitor, public function::visitor {
+public:
+	/** Counts of the subexpressions of one class. */
+	struct class_counts {
+		class_counts() : nodes(0), bytes(0) {}
+		double nodes;  ///< distinct subexpressions
+		double bytes;  ///< estimated memory of these objects
+	};
+	typedef std::map<std::string, class_counts> class_map;
+
+	/** With max_operands > 0, only that many operands of every node are
+	 *  visited. */
+	explicit expression_profile(std::size_t max_operands = 0, std::size_t num_largest = 5);
+
+	/** Add the subexpressions of e to the statistics. */
+	void scan(const ex & e);
+
+	/** Print a report. */
+	void print(std::ostream & os) const;
+
+	const class_map & classes() const { return by_class; }
+	/** Number of nodes, shared subexpressions counted each time. */
+	double tree_size() const { return tree_nodes; }
+	/** Number of distinct subexpressions. */
+	double dag_size() const { return dag_nodes; }
+	/** Estimated memory of the distinct subexpressions in bytes. */
+	double memory() const { return total_bytes; }
+	unsigned depth() const { return max_depth; }
+	/** Subexpressions from the root of the deepest expression scanned down
+	 *  to its deepest leaf. */
+	const exvector & deepest_path() const { return path; }
+	/** The sums and products with the most operands, largest first. */
+	const exvector & largest_sums() const { return sums; }
+	const exvector & largest_products() const { return products; }
+
+	// visitor interfaces, called by scan()
+	void visit(const basic & b);
+	void visit(const GiNaC::add & a);
+	void visit(const mul & m);
+	void visit(const power & p);
+	void visit(const numeric & n);
+	void visit(const symbol & s);
+	void visit(const function & f);
+
+private:
+	void record(const basic & b, std::size_t bytes);
+	void note_largest(exvector & v, const ex & e);
+
+	std::size_t max_operands;
+	std::size_t num_largest;
+	double weight;  ///< scale of the node being visited
+
+	class_map by_class;
+	double tree_nodes, dag_nodes, total_bytes;
+	unsigned max_depth;
+	exvector path;
+	exvector sums, products;
+};
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_PROFILE_H
@@ -26,15 +26,20 @@
 #include "inifcns.h" // for Order function
 #include "lst.h"
 #include "mul.h"
+#include "numeric.h"
 #include "power.h"
 #include "relational.h"
 #include "operators.h"
 #include "symbol.h"
 #include "integral.h"
+#include "lazy_series.h"
+#include "parallel.h"
 #include "archive.h"
 #include "utils.h"
+#include "hash_map.h"
 
 #include <limits>
+#include <map>
 #include <numeric>
 #include <stdexcept>
 
@@ -516,6 +521,28 @@ ex pseries::evalm() const
 		return *this;
 }
 
+unsigned pseries::calc_symbol_mask() const
+{
+	// op() constructs the terms, so look at their parts
+	unsigned m = ex_to<basic>(var).symbol_mask() | ex_to<basic>(point).symbol_mask();
+	for (epvector::const_iterator it = seq.begin(); it != seq.end(); ++it)
+		m |= ex_to<basic>(it->rest).symbol_mask();
+	return m;
+}
+
+tree_metrics pseries::calc_metrics() const
+{
+	// op() constructs the terms, so look at their parts
+	tree_metrics m;
+	m.add_child(ex_to<basic>(var).metrics());
+	m.add_child(ex_to<basic>(point).metrics());
+	for (epvector::const_iterator it = seq.begin(); it != seq.end(); ++it) {
+		m.add_child(ex_to<basic>(it->rest).metrics());
+		m.add_child(ex_to<basic>(it->coeff).metrics());
+	}
+	return m;
+}
+
 ex pseries::subs(const exmap & m, unsigned options) const
 {
 	// If expansion variable is being substituted, convert the series to a
@@ -630,7 +657,88 @@ ex pseries::exponop(size_t i) const
  *  Implementations of series expansion
  */
 
+/** The derivatives of an expression and their values at the expansion
+ *  point, for Taylor expansion. Higher derivatives mostly consist of the
+ *  same subexpressions (derivatives of the functions in the expression,
+ *  powers of the same bases), so the derivatives and the substituted
+ *  values of all subexpressions are remembered and shared between orders.
+ *  Sums, products and powers are differentiated and substituted here;
+ *  everything else is left to diff() and subs(). */
+class taylor_chain : public map_function {
+public:
+	taylor_chain(const relational & r_) : r(r_), s(ex_to<symbol>(r_.lhs())) { }
+
+	/** Derivative of e with respect to the expansion variable. */
+	ex derivative(const ex & e)
+	{
+		if (!e.has(s))
+			return _ex0;
+		if (e.is_equal(s))
+			return _ex1;
+		exhashmap<ex>::const_iterator it = derivatives.find(e);
+		if (it != derivatives.end())
+			return it->second;
+
+		ex d;
+		if (is_exactly_a<add>(e)) {
+			exvector terms;
+			for (size_t i=0; i<e.nops(); ++i)
+				terms.push_back(derivative(e.op(i)));
+			d = (new add(terms))->setflag(status_flags::dynallocated);
+		} else if (is_exactly_a<mul>(e)) {
+			exvector terms;
+			for (size_t i=0; i<e.nops(); ++i) {
+				const ex di = derivative(e.op(i));
+				if (di.is_zero())
+					continue;
+				exvector factors;
+				factors.reserve(e.nops());
+				for (size_t j=0; j<e.nops(); ++j)
+					factors.push_back(j == i ? di : e.op(j));
+				terms.push_back((new mul(factors))->setflag(status_flags::dynallocated));
+			}
+			d = (new add(terms))->setflag(status_flags::dynallocated);
+		} else if (is_exactly_a<power>(e) && !e.op(1).has(s)) {
+			const ex & b = e.op(0), & p = e.op(1);
+			d = p * power(b, p - _ex1) * derivative(b);
+		} else {
+			d = e.diff(s);
+		}
+		derivatives[e] = d;
+		return d;
+	}
+
+	/** Value of e at the expansion point. */
+	ex operator()(const ex & e)
+	{
+		if (!e.has(s))
+			return e;
+		if (e.is_equal(s))
+			return r.rhs();
+		exhashmap<ex>::const_iterator it = values.find(e);
+		if (it != values.end())
+			return it->second;
+
+		ex v;
+		if (is_exactly_a<add>(e) || is_exactly_a<mul>(e) || is_exactly_a<power>(e))
+			v = e.map(*this);
+		else
+			v = e.subs(r, subs_options::no_pattern);
+		values[e] = v;
+		return v;
+	}
+
+private:
+	const relational & r;
+	const symbol & s;
+	exhashmap<ex> derivatives;
+	exhashmap<ex> values;
+};
+
 /** Default implementation of ex::series(). This performs Taylor expansion.
+ *  The chain of derivatives is kept in expanded form, and derivatives and
+ *  values of subexpressions are shared between the orders, see
+ *  taylor_chain.
  *  @see ex::series */
 ex basic::series(const relational & r, int order, unsigned options) const
 {
@@ -644,9 +752,10 @@ ex basic::series(const relational & r, int order, unsigned options) const
 	}
 
 	// do Taylor expansion
+	taylor_chain chain(r);
 	numeric fac = 1;
 	ex deriv = *this;
-	ex coeff = deriv.subs(r, subs_options::no_pattern);
+	ex coeff = chain(deriv);
 
 	if (!coeff.is_zero()) {
 		seq.push_back(expair(coeff, _ex0));
@@ -658,17 +767,17 @@ ex basic::series(const relational & r, int order, unsigned options) const
 		// We need to test for zero in order to see if the series terminates.
 		// The problem is that there is no such thing as a perfect test for
 		// zero.  Expanding the term occasionally helps a little...
-		deriv = deriv.diff(s).expand();
+		deriv = chain.derivative(deriv).expand();
 		if (deriv.is_zero())  // Series terminates
 			return pseries(r, seq);
 
-		coeff = deriv.subs(r, subs_options::no_pattern);
+		coeff = chain(deriv);
 		if (!coeff.is_zero())
 			seq.push_back(expair(fac.inverse() * coeff, n));
 	}
 	
 	// Higher-order terms, if present
-	deriv = deriv.diff(s);
+	deriv = chain.derivative(deriv);
 	if (!deriv.expand().is_zero())
 		seq.push_back(expair(Order(_ex1), n));
 	return pseries(r, seq);
@@ -770,32 +879,156 @@ ex pseries::add_series(const pseries &other) const
 }
 
 
+/** Sums of series with the same variable and expansion point. The
+ *  coefficients are collected per exponent and only added up at the end,
+ *  so that summing many series doesn't build a chain of partial sums. */
+struct series_accumulator {
+	series_accumulator() : order(std::numeric_limits<int>::max()), incompatible(false) {}
+
+	/** Add factor times the series s. */
+	void accumulate(const pseries & s, const numeric & factor, const relational & r)
+	{
+		if (!s.get_var().is_equal(r.lhs()) || !s.get_point().is_equal(r.rhs())) {
+			incompatible = true;
+			return;
+		}
+		for (size_t i=0; i<s.nops(); ++i) {
+			const int deg = ex_to<numeric>(s.exponop(i)).to_int();
+			if (deg >= order)
+				break;
+			const ex c = s.coeffop(i);
+			if (is_order_function(c)) {
+				order = deg;
+				break;
+			}
+			coeffs[deg].push_back(factor.is_equal(*_num1_p) ? c : c * factor);
+		}
+	}
+
+	/** Move the coefficients of other into this accumulator. */
+	void merge(series_accumulator & other)
+	{
+		order = std::min(order, other.order);
+		incompatible = incompatible || other.incompatible;
+		for (std::map<int, exvector>::iterator it=other.coeffs.begin(); it!=other.coeffs.end(); ++it) {
+			if (it->first >= order)
+				break;
+			exvector & v = coeffs[it->first];
+			v.insert(v.end(), it->second.begin(), it->second.end());
+		}
+		other.coeffs.clear();
+	}
+
+	/** The sum as a pseries, with one add per exponent. */
+	ex result(const relational & r) const
+	{
+		epvector new_seq;
+		if (incompatible) {
+			// as in pseries::add_series()
+			new_seq.push_back(expair(Order(_ex1), _ex0));
+			return (new pseries(r, new_seq))->setflag(status_flags::dynallocated);
+		}
+		for (std::map<int, exvector>::const_iterator it=coeffs.begin(); it!=coeffs.end() && it->first<order; ++it) {
+			const ex c = it->second.size() == 1 ? it->second[0]
+			           : (new add(it->second))->setflag(status_flags::dynallocated);
+			if (!c.is_zero())
+				new_seq.push_back(expair(c, numeric(it->first)));
+		}
+		if (order < std::numeric_limits<int>::max())
+			new_seq.push_back(expair(Order(_ex1), numeric(order)));
+		return (new pseries(r, new_seq))->setflag(status_flags::dynallocated);
+	}
+
+	std::map<int, exvector> coeffs;
+	int order;
+	bool incompatible;
+};
+
+/** Add the series of one term of a sum to acc. */
+static void accumulate_term_series(series_accumulator & acc, const expair & term,
+                                   const relational & r, int order, unsigned options)
+{
+	const ex op = is_exactly_a<pseries>(term.rest) ? term.rest : term.rest.series(r, order, options);
+	acc.accumulate(ex_to<pseries>(op), ex_to<numeric>(term.coeff), r);
+}
+
+/** Sums with at least this many terms are expanded in parallel if
+ *  series_options::parallel is given. */
+static const size_t parallel_series_min_terms = 256;
+
+/** Expands the terms of a slice of a sum and collects their series.
+ *  @see add::series */
+struct series_terms_task : public parallel_task {
+	series_terms_task(const epvector & seq_, const relational & r_, int order_, unsigned options_,
+	                  std::vector<series_accumulator> & parts_)
+	 : seq(seq_), r(r_), order(order_), options(options_), parts(parts_) {}
+
+	void operator()(size_t i)
+	{
+		const size_t from = (i * seq.size()) / parts.size();
+		const size_t to = ((i + 1) * seq.size()) / parts.size();
+		for (size_t k=from; k<to; ++k)
+			accumulate_term_series(parts[i], seq[k], r, order, options);
+	}
+
+	const epvector & seq;
+	const relational & r;
+	const int order;
+	const unsigned options;
+	std::vector<series_accumulator> & parts;
+};
+
+/** One level of the tree reduction of the partial sums: part 2*i*step
+ *  takes over part (2*i+1)*step. */
+struct series_merge_task : public parallel_task {
+	series_merge_task(std::vector<series_accumulator> & parts_, size_t step_)
+	 : parts(parts_), step(step_) {}
+
+	void operator()(size_t i)
+	{
+		const size_t a = 2 * step * i, b = a + step;
+		if (b < parts.size())
+			parts[a].merge(parts[b]);
+	}
+
+	std::vector<series_accumulator> & parts;
+	const size_t step;
+};
+
 /** Implementation of ex::series() for sums. This performs series addition when
- *  adding pseries objects.
+ *  adding pseries objects. With series_options::parallel, the terms of
+ *  large sums are expanded by several threads and the partial sums merged
+ *  pairwise.
  *  @see ex::series */
 ex add::series(const relational & r, int order, unsigned options) const
 {
-	ex acc; // Series accumulator
-	
 	// Get first term from overall_coeff
-	acc = overall_coeff.series(r, order, options);
-	
-	// Add remaining terms
-	epvector::const_iterator it = seq.begin();
-	epvector::const_iterator itend = seq.end();
-	for (; it!=itend; ++it) {
-		ex op;
-		if (is_exactly_a<pseries>(it->rest))
-			op = it->rest;
-		else
-			op = it->rest.series(r, order, options);
-		if (!it->coeff.is_equal(_ex1))
-			op = ex_to<pseries>(op).mul_const(ex_to<numeric>(it->coeff));
-		
-		// Series addition
-		acc = ex_to<pseries>(acc).add_series(ex_to<pseries>(op));
+	series_accumulator acc;
+	acc.accumulate(ex_to<pseries>(overall_coeff.series(r, order, options)), *_num1_p, r);
+
+	if ((options & series_options::parallel) &&
+	    seq.size() >= parallel_series_min_terms &&
+	    parallel_threads(seq.size()) > 1 &&
+	    numerics_are_immediate(seq, overall_coeff) &&
+	    numerics_are_immediate(r.rhs())) {
+		// The threads must not start threads of their own
+		const unsigned nthreads = parallel_threads(seq.size());
+		std::vector<series_accumulator> parts(std::min(seq.size(), size_t(4 * nthreads)));
+		prepare_for_threads(seq, overall_coeff);
+		prepare_for_threads(r.lhs());
+		prepare_for_threads(r.rhs());
+		series_terms_task task(seq, r, order, options & ~series_options::parallel, parts);
+		parallel_for(parts.size(), task);
+		for (size_t step=1; step<parts.size(); step*=2) {
+			series_merge_task merge(parts, step);
+			parallel_for((parts.size() + 2*step - 1) / (2*step), merge);
+		}
+		acc.merge(parts[0]);
+	} else {
+		for (epvector::const_iterator it=seq.begin(); it!=seq.end(); ++it)
+			accumulate_term_series(acc, *it, r, order, options);
 	}
-	return acc;
+	return acc.result(r);
 }
 
 
@@ -821,12 +1054,146 @@ ex pseries::mul_const(const numeric &other) const
 }
 
 
+/** Coefficients of the terms of seq with exponents offset, offset+1, ...,
+ *  offset+n-1 in a dense vector. The order term and the terms following
+ *  it are left out. */
+static exvector dense_coefficients(const epvector & seq, int offset, int n)
+{
+	exvector c(n, _ex0);
+	epvector::const_iterator it = seq.begin(), itend = seq.end();
+	for (; it!=itend && !is_order_function(it->rest); ++it) {
+		const int k = ex_to<numeric>(it->coeff).to_int() - offset;
+		if (k >= n)
+			break;
+		c[k] = it->rest;
+	}
+	return c;
+}
+
+/** Products of dense polynomials with numeric coefficients are split by
+ *  Karatsuba's method down to this number of coefficients. */
+static const size_t karatsuba_threshold = 16;
+
+/** Product r[0..2n-1) of the polynomials with the coefficients a[0..n) and
+ *  b[0..n). */
+static void karatsuba_mul(const numeric *a, const numeric *b, size_t n, numeric *r)
+{
+	if (n < karatsuba_threshold) {
+		for (size_t k=0; k<2*n-1; ++k)
+			r[k] = *_num0_p;
+		for (size_t i=0; i<n; ++i) {
+			if (a[i].is_zero())
+				continue;
+			for (size_t j=0; j<n; ++j)
+				r[i+j] += a[i] * b[j];
+		}
+		return;
+	}
+
+	// a = a0 + x^h*a1, b = b0 + x^h*b1, with h2 >= h coefficients in a1, b1
+	const size_t h = n / 2, h2 = n - h;
+	karatsuba_mul(a, b, h, r);
+	r[2*h-1] = *_num0_p;
+	karatsuba_mul(a + h, b + h, h2, r + 2*h);
+
+	// a0*b1 + a1*b0 = (a0 + a1)*(b0 + b1) - a0*b0 - a1*b1
+	std::vector<numeric> as(h2), bs(h2), m(2*h2-1);
+	for (size_t i=0; i<h2; ++i) {
+		as[i] = i < h ? a[i] + a[h+i] : a[h+i];
+		bs[i] = i < h ? b[i] + b[h+i] : b[h+i];
+	}
+	karatsuba_mul(&as[0], &bs[0], h2, &m[0]);
+	for (size_t i=0; i<2*h-1; ++i)
+		m[i] -= r[i];
+	for (size_t i=0; i<2*h2-1; ++i)
+		m[i] -= r[2*h+i];
+	for (size_t i=0; i<2*h2-1; ++i)
+		r[h+i] += m[i];
+}
+
+/** Low part r[0..n) of the product of the polynomials with the coefficients
+ *  a[0..n) and b[0..n) (short product). The products of coefficients
+ *  which only contribute to the terms of degree n and higher are never
+ *  formed: with a = a0 + x^h*a1 and b = b0 + x^h*b1, the low part is the
+ *  full product a0*b0 plus x^h times the low parts of a0*b1 and a1*b0. */
+static void short_mul(const numeric *a, const numeric *b, size_t n, numeric *r)
+{
+	if (n < karatsuba_threshold) {
+		for (size_t k=0; k<n; ++k)
+			r[k] = *_num0_p;
+		for (size_t i=0; i<n; ++i) {
+			if (a[i].is_zero())
+				continue;
+			for (size_t j=0; j<n-i; ++j)
+				r[i+j] += a[i] * b[j];
+		}
+		return;
+	}
+
+	// 2*h-1 <= n, so the full product a0*b0 is not longer than the result
+	const size_t h = n - n/2, l = n - h;
+	std::vector<numeric> full(2*h-1), cross(l);
+	karatsuba_mul(a, b, h, &full[0]);
+	for (size_t k=0; k<n; ++k)
+		r[k] = k < 2*h-1 ? full[k] : *_num0_p;
+	short_mul(a, b + h, l, &cross[0]);
+	for (size_t k=0; k<l; ++k)
+		r[h+k] += cross[k];
+	short_mul(a + h, b, l, &cross[0]);
+	for (size_t k=0; k<l; ++k)
+		r[h+k] += cross[k];
+}
+
+/** First n coefficients of the product of the series with the dense
+ *  coefficients a and b (truncated convolution). */
+static exvector mul_dense(const exvector & a, const exvector & b, size_t n)
+{
+	exvector c(n);
+	bool numeric_coeffs = true;
+	for (size_t i=0; i<n && numeric_coeffs; ++i)
+		numeric_coeffs = is_exactly_a<numeric>(a[i]) && is_exactly_a<numeric>(b[i]);
+	if (numeric_coeffs) {
+		std::vector<numeric> an(n), bn(n), cn(n);
+		for (size_t i=0; i<n; ++i) {
+			an[i] = ex_to<numeric>(a[i]);
+			bn[i] = ex_to<numeric>(b[i]);
+		}
+		short_mul(&an[0], &bn[0], n, &cn[0]);
+		for (size_t k=0; k<n; ++k)
+			c[k] = cn[k];
+		return c;
+	}
+
+	for (size_t k=0; k<n; ++k) {
+		exvector terms;
+		for (size_t i=0; i<=k; ++i)
+			if (!a[i].is_zero() && !b[k-i].is_zero())
+				terms.push_back(a[i] * b[k-i]);
+		c[k] = (new add(terms))->setflag(status_flags::dynallocated);
+	}
+	return c;
+}
+
+
 /** Multiply one pseries object to another, producing a pseries object that
  *  represents the product.
  *
  *  @param other  pseries object to multiply with
  *  @return the product as a pseries */
 ex pseries::mul_series(const pseries &other) const
+{
+	return mul_series(other, std::numeric_limits<int>::max());
+}
+
+
+/** Multiply one pseries object to another, dropping the terms of degree
+ *  deg and higher. Products of coefficients which only contribute to these
+ *  terms are not computed.
+ *
+ *  @param other  pseries object to multiply with
+ *  @param deg  truncation order of the product
+ *  @return the product as a pseries */
+ex pseries::mul_series(const pseries &other, int deg) const
 {
 	// Multiplying two series with different variables or expansion points
 	// results in an empty (constant) series 
@@ -857,20 +1224,19 @@ ex pseries::mul_series(const pseries &other) const
 	if (is_order_function(other.coeff(var, b_max)))
 		higher_order_b = b_max + a_min;
 	int higher_order_c = std::min(higher_order_a, higher_order_b);
+	if (cdeg_max >= deg)
+		higher_order_c = std::min(higher_order_c, deg);
 	if (cdeg_max >= higher_order_c)
 		cdeg_max = higher_order_c - 1;
 	
-	for (int cdeg=cdeg_min; cdeg<=cdeg_max; ++cdeg) {
-		ex co = _ex0;
-		// c(i)=a(0)b(i)+...+a(i)b(0)
-		for (int i=a_min; cdeg-i>=b_min; ++i) {
-			ex a_coeff = coeff(var, i);
-			ex b_coeff = other.coeff(var, cdeg-i);
-			if (!is_order_function(a_coeff) && !is_order_function(b_coeff))
-				co += a_coeff * b_coeff;
-		}
-		if (!co.is_zero())
-			new_seq.push_back(expair(co, numeric(cdeg)));
+	if (cdeg_max >= cdeg_min) {
+		// c(i)=a(0)b(i)+...+a(i)b(0) on dense coefficient vectors
+		const int n = cdeg_max - cdeg_min + 1;
+		const exvector co = mul_dense(dense_coefficients(seq, a_min, n),
+		                              dense_coefficients(other.seq, b_min, n), n);
+		for (int k=0; k<n; ++k)
+			if (!co[k].is_zero())
+				new_seq.push_back(expair(co[k], numeric(cdeg_min + k)));
 	}
 	if (higher_order_c < std::numeric_limits<int>::max())
 		new_seq.push_back(expair(Order(_ex1), numeric(higher_order_c)));
@@ -888,9 +1254,12 @@ ex mul::series(const relational & r, int order, unsigned options) const
 	GINAC_ASSERT(is_a<symbol>(r.lhs()));
 	const ex& sym = r.lhs();
 		
-	// holds ldegrees of the series of individual factors
+	// holds ldegrees of the series of individual factors, and the series
+	// whose leading coefficients are computed to find them
 	std::vector<int> ldegrees;
 	std::vector<bool> ldegree_redo;
+	std::vector<int> factors;
+	std::vector<lazy_series> leading;
 
 	// find minimal degrees
 	const epvector::const_iterator itbeg = seq.begin();
@@ -908,30 +1277,22 @@ ex mul::series(const relational & r, int order, unsigned options) const
 		} else {
 			buf = recombine_pair_to_ex(*it);
 		}
+		factors.push_back(factor);
+		leading.push_back(lazy_series(buf, r, options));
 
 		int real_ldegree = 0;
 		bool flag_redo = false;
-		try {
-			real_ldegree = buf.expand().ldegree(sym-r.rhs());
-		} catch (std::runtime_error) {}
-
-		if (real_ldegree == 0) {
-			if ( factor < 0 ) {
-				// This case must terminate, otherwise we would have division by
-				// zero.
-				int orderloop = 0;
-				do {
-					orderloop++;
-					real_ldegree = buf.series(r, orderloop, options).ldegree(sym);
-				} while (real_ldegree == orderloop);
-			} else {
-				// Here it is possible that buf does not have a ldegree, therefore
-				// check only if ldegree is negative, otherwise reconsider the case
-				// in the second round.
-				real_ldegree = buf.series(r, 0, options).ldegree(sym);
-				if (real_ldegree == 0)
-					flag_redo = true;
-			}
+		if (factor < 0) {
+			// The leading term must exist, otherwise we would have
+			// division by zero.
+			real_ldegree = leading.back().ldegree();
+		} else {
+			// Here it is possible that buf does not have a ldegree,
+			// therefore only look for negative ldegrees and reconsider
+			// the case in the second round.
+			real_ldegree = leading.back().ldegree(0);
+			if (real_ldegree == 0)
+				flag_redo = true;
 		}
 
 		ldegrees.push_back(factor * real_ldegree);
@@ -939,32 +1300,16 @@ ex mul::series(const relational & r, int order, unsigned options) const
 	}
 
 	int degbound = order-std::accumulate(ldegrees.begin(), ldegrees.end(), 0);
-	// Second round: determine the remaining positive ldegrees by the series
-	// method.
-	// here we can ignore ldegrees larger than degbound
-	size_t j = 0;
-	for (epvector::const_iterator it=itbeg; it!=itend; ++it) {
-		if ( ldegree_redo[j] ) {
-			ex expon = it->coeff;
-			int factor = 1;
-			ex buf;
-			if (expon.info(info_flags::integer)) {
-				buf = it->rest;
-				factor = ex_to<numeric>(expon).to_int();
-			} else {
-				buf = recombine_pair_to_ex(*it);
-			}
-			int real_ldegree = 0;
-			int orderloop = 0;
-			do {
-				orderloop++;
-				real_ldegree = buf.series(r, orderloop, options).ldegree(sym);
-			} while ((real_ldegree == orderloop)
-					&& ( factor*real_ldegree < degbound));
-			ldegrees[j] = factor * real_ldegree;
-			degbound -= factor * real_ldegree;
+	// Second round: determine the remaining positive ldegrees. Here we can
+	// ignore ldegrees larger than degbound, so no coefficients beyond
+	// degbound/factor are computed.
+	for (size_t j=0; j<ldegrees.size(); ++j) {
+		if (ldegree_redo[j]) {
+			const int bound = degbound > 0 ? (degbound + factors[j] - 1) / factors[j] : 0;
+			const int real_ldegree = leading[j].ldegree(bound);
+			ldegrees[j] = factors[j] * real_ldegree;
+			degbound -= factors[j] * real_ldegree;
 		}
-		j++;
 	}
 
 	int degsum = std::accumulate(ldegrees.begin(), ldegrees.end(), 0);
@@ -975,18 +1320,21 @@ ex mul::series(const relational & r, int order, unsigned options) const
 		return (new pseries(r, epv))->setflag(status_flags::dynallocated);
 	}
 
-	// Multiply with remaining terms
+	// Multiply with remaining terms. The product of the first factors is
+	// only needed up to order minus the ldegrees of the remaining ones.
+	int rest_ldegree = degsum;
 	std::vector<int>::const_iterator itd = ldegrees.begin();
 	for (epvector::const_iterator it=itbeg; it!=itend; ++it, ++itd) {
 
 		// do series expansion with adjusted order
 		ex op = recombine_pair_to_ex(*it).series(r, order-degsum+(*itd), options);
+		rest_ldegree -= *itd;
 
 		// Series multiplication
 		if (it == itbeg)
 			acc = ex_to<pseries>(op);
 		else
-			acc = ex_to<pseries>(acc.mul_series(ex_to<pseries>(op)));
+			acc = ex_to<pseries>(acc.mul_series(ex_to<pseries>(op), order - rest_ldegree));
 	}
 
 	return acc.mul_const(ex_to<numeric>(overall_coeff));
@@ -1049,27 +1397,74 @@ ex pseries::power_const(const numeric &p, int deg) const
 	if (seq.size() == 1 && is_order_function(seq[0].rest) && p.real().is_negative())
 		throw pole_error("pseries::power_const(): division by zero",1);
 	
-	// Compute coefficients of the powered series
+	// Compute coefficients of the powered series, up to the order term of
+	// this series (if it comes first)
+	const ex a0 = seq[0].rest;
+	const exvector a = dense_coefficients(seq, ldeg, numcoeff);
+	int order_index = numcoeff;
+	if (!is_terminating()) {
+		const int k = ex_to<numeric>(seq.back().coeff).to_int() - ldeg;
+		if (k > 0 && k < numcoeff)
+			order_index = k;
+	}
+
+	// The recurrence is run for (A(x)/a_0)^p, whose coefficients d_i are
+	// multiplied by c_0 at the end: with u_j = a_j/a_0 it reads
+	//     d_i = sum_{j=1}^{i} ((p+1)*j/i - 1)*u_j*d_{i-j}.
+	// This keeps c_0, often an irrational power of a_0, and the divisions
+	// by a_0 out of the coefficients of each order, and the u_j are numbers
+	// whenever the coefficients of A(x) are multiples of a_0 with rational
+	// factors. Only the non-zero u_j are visited, which makes powers of
+	// sparse polynomials cheap.
+	const ex a0_inv = power(a0, _ex_1);
+	exvector u(order_index);
+	std::vector<int> nonzero;
+	bool numeric_coeffs = true;
+	for (int j=1; j<order_index; ++j) {
+		if (a[j].is_zero())
+			continue;
+		u[j] = is_exactly_a<numeric>(a0) && is_exactly_a<numeric>(a[j])
+		     ? ex(ex_to<numeric>(a[j]).div(ex_to<numeric>(a0))) : a[j] * a0_inv;
+		nonzero.push_back(j);
+		numeric_coeffs = numeric_coeffs && is_exactly_a<numeric>(u[j]);
+	}
+	const numeric p1 = p + *_num1_p;
+	const ex c0 = power(a0, p);
 	exvector co;
-	co.reserve(numcoeff);
-	co.push_back(power(coeff(var, ldeg), p));
-	for (int i=1; i<numcoeff; ++i) {
-		ex sum = _ex0;
-		for (int j=1; j<=i; ++j) {
-			ex c = coeff(var, j + ldeg);
-			if (is_order_function(c)) {
-				co.push_back(Order(_ex1));
-				break;
-			} else
-				sum += (p * j - (i - j)) * co[i - j] * c;
+	co.reserve(order_index + 1);
+	co.push_back(c0);
+	if (numeric_coeffs) {
+		// Same recurrence in numeric arithmetic
+		std::vector<numeric> d(order_index);
+		d[0] = *_num1_p;
+		for (int i=1; i<order_index; ++i) {
+			numeric sum = *_num0_p;
+			for (std::vector<int>::const_iterator j=nonzero.begin(); j!=nonzero.end() && *j<=i; ++j)
+				if (!d[i - *j].is_zero())
+					sum += (p1 * *j - i) * ex_to<numeric>(u[*j]) * d[i - *j];
+			d[i] = sum / i;
+			co.push_back(d[i].is_zero() ? _ex0 : c0 * d[i]);
+		}
+	} else {
+		exvector d(order_index);
+		d[0] = _ex1;
+		for (int i=1; i<order_index; ++i) {
+			exvector terms;
+			terms.reserve(nonzero.size());
+			for (std::vector<int>::const_iterator j=nonzero.begin(); j!=nonzero.end() && *j<=i; ++j)
+				if (!d[i - *j].is_zero())
+					terms.push_back(((p1 * *j - i) / i) * u[*j] * d[i - *j]);
+			d[i] = (new add(terms))->setflag(status_flags::dynallocated);
+			co.push_back(c0 * d[i]);
 		}
-		co.push_back(sum / coeff(var, ldeg) / i);
 	}
+	if (order_index < numcoeff)
+		co.push_back(Order(_ex1));
 	
 	// Construct new series (of non-zero coefficients)
 	epvector new_seq;
 	bool higher_order = false;
-	for (int i=0; i<numcoeff; ++i) {
+	for (int i=0; i<int(co.size()); ++i) {
 		if (!co[i].is_zero())
 			new_seq.push_back(expair(co[i], p * ldeg + i));
 		if (is_order_function(co[i])) {
@@ -1084,6 +1479,205 @@ ex pseries::power_const(const numeric &p, int deg) const
 }
 
 
+/** Exponent of the order term of seq, or order if that is smaller or the
+ *  series terminates. */
+static int truncation_degree(const epvector & seq, int order)
+{
+	for (epvector::const_iterator it=seq.begin(); it!=seq.end(); ++it)
+		if (is_order_function(it->rest))
+			return std::min(order, ex_to<numeric>(it->coeff).to_int());
+	return order;
+}
+
+/** Expand the coefficients, so that zeros are recognized and the
+ *  coefficients don't grow with every iteration. */
+static void expand_coefficients(exvector & c)
+{
+	for (size_t k=0; k<c.size(); ++k)
+		c[k] = c[k].expand();
+}
+
+/** First n coefficients of 1/a for a dense series a with a[0] != 0, by
+ *  Newton iteration: if b is 1/a up to x^m, then b - b*(a*b - 1) is 1/a up
+ *  to x^(2*m). The first m coefficients of a*b - 1 are zero and are not
+ *  used, so that they need not cancel symbolically. */
+static exvector dense_inverse(const exvector & a, size_t n)
+{
+	exvector b(n, _ex0);
+	if (n == 0)
+		return b;
+	b[0] = power(a[0], _ex_1);
+	for (size_t m=1; m<n; ) {
+		const size_t m2 = std::min(2*m, n);
+		const exvector ab = mul_dense(a, b, m2);
+		exvector e(m2, _ex0);
+		for (size_t k=m; k<m2; ++k)
+			e[k] = ab[k];
+		const exvector be = mul_dense(b, e, m2);
+		for (size_t k=m; k<m2; ++k)
+			b[k] = (-be[k]).expand();
+		m = m2;
+	}
+	return b;
+}
+
+/** First n coefficients of log(a) - log(a[0]) for a dense series a with
+ *  a[0] != 0, as the integral of a'/a. */
+static exvector dense_log(const exvector & a, size_t n)
+{
+	exvector c(n, _ex0);
+	if (n <= 1)
+		return c;
+	exvector da(n, _ex0);
+	for (size_t k=0; k+1<n; ++k)
+		da[k] = a[k+1] * numeric(k + 1);
+	const exvector q = mul_dense(da, dense_inverse(a, n), n - 1);
+	for (size_t k=1; k<n; ++k)
+		c[k] = (q[k-1] / numeric(k)).expand();
+	return c;
+}
+
+/** First n coefficients of exp(u) for a dense series u with u[0] == 0, by
+ *  Newton iteration: if y is exp(u) up to x^m, then y + y*(u - log(y)) is
+ *  exp(u) up to x^(2*m). */
+static exvector dense_exp(const exvector & u, size_t n)
+{
+	exvector y(n, _ex0);
+	if (n == 0)
+		return y;
+	y[0] = _ex1;
+	for (size_t m=1; m<n; ) {
+		const size_t m2 = std::min(2*m, n);
+		const exvector l = dense_log(y, m2);
+		exvector t(m2, _ex0);
+		for (size_t k=m; k<m2; ++k)
+			t[k] = u[k] - l[k];
+		const exvector yt = mul_dense(y, t, m2);
+		for (size_t k=m; k<m2; ++k)
+			y[k] = yt[k].expand();
+		m = m2;
+	}
+	return y;
+}
+
+/** First n coefficients of f(u) = f[0] + f[1]*u + f[2]*u^2 + ... for a
+ *  dense series u with u[0] == 0, by Brent and Kung's baby step giant step
+ *  method: with m about the square root of the number of terms of f, the
+ *  powers u^0, ..., u^m are computed once, and f is evaluated by Horner's
+ *  rule in u^m, with polynomials of degree less than m in u as coefficients.
+ *  This takes about 2*sqrt(n) series multiplications instead of n. */
+static exvector dense_compose(const exvector & f, const exvector & u, size_t n)
+{
+	exvector r(n, _ex0);
+	// u^k starts with x^k, so the terms of f from x^n on don't contribute
+	const size_t nf = std::min(f.size(), n);
+	if (nf == 0)
+		return r;
+	size_t m = 1;
+	while (m * m < nf)
+		++m;
+
+	std::vector<exvector> pw(m + 1);
+	pw[0] = exvector(n, _ex0);
+	pw[0][0] = _ex1;
+	pw[1] = exvector(u.begin(), u.begin() + n);
+	for (size_t i=2; i<=m; ++i) {
+		pw[i] = mul_dense(pw[i-1], u, n);
+		expand_coefficients(pw[i]);
+	}
+
+	const size_t blocks = (nf + m - 1) / m;
+	for (size_t j=blocks; j-->0; ) {
+		if (j + 1 < blocks)
+			r = mul_dense(r, pw[m], n);
+		for (size_t k=0; k<n; ++k) {
+			exvector terms(1, r[k]);
+			for (size_t i=0; i<m && j*m+i<nf; ++i)
+				if (!f[j*m+i].is_zero() && !pw[i][k].is_zero())
+					terms.push_back(f[j*m+i] * pw[i][k]);
+			r[k] = ex((new add(terms))->setflag(status_flags::dynallocated)).expand();
+		}
+	}
+	return r;
+}
+
+/** Series with the dense coefficients c, truncated at c.size(). */
+static ex dense_to_pseries(const relational & r, const exvector & c)
+{
+	epvector new_seq;
+	for (size_t k=0; k<c.size(); ++k)
+		if (!c[k].is_zero())
+			new_seq.push_back(expair(c[k], numeric(k)));
+	new_seq.push_back(expair(Order(_ex1), numeric(c.size())));
+	return (new pseries(r, new_seq))->setflag(status_flags::dynallocated);
+}
+
+
+/** Compute the exponential of a Taylor series by Newton iteration. The
+ *  series must not have terms with negative exponents.
+ *
+ *  @param order  truncation order of the result (at most the order of
+ *                this series)
+ *  @return exp() of the series, as a pseries */
+ex pseries::exp_series(int order) const
+{
+	if (!seq.empty() && ex_to<numeric>(seq.begin()->coeff).is_negative())
+		throw std::invalid_argument("pseries::exp_series(): series has a pole");
+	const int n = std::max(truncation_degree(seq, order), 0);
+	exvector u = dense_coefficients(seq, 0, n);
+	const ex e0 = n > 0 ? exp(u[0]) : _ex1;
+	if (n > 0)
+		u[0] = _ex0;
+	exvector c = dense_exp(u, n);
+	if (!e0.is_equal(_ex1))
+		for (size_t k=0; k<c.size(); ++k)
+			c[k] = e0 * c[k];
+	return dense_to_pseries(relational(var, point), c);
+}
+
+
+/** Compute the logarithm of a Taylor series with non-zero constant term,
+ *  as the integral of the quotient of its derivative and itself, with the
+ *  reciprocal computed by Newton iteration.
+ *
+ *  @param order  truncation order of the result (at most the order of
+ *                this series)
+ *  @return log() of the series, as a pseries */
+ex pseries::log_series(int order) const
+{
+	const int n = std::max(truncation_degree(seq, order), 0);
+	if (n == 0)
+		return dense_to_pseries(relational(var, point), exvector());
+	if (seq.empty() || !seq.begin()->coeff.is_zero() || is_order_function(seq.begin()->rest))
+		throw std::invalid_argument("pseries::log_series(): series has no non-zero constant term");
+	const exvector a = dense_coefficients(seq, 0, n);
+	exvector c = dense_log(a, n);
+	c[0] = log(a[0]);
+	return dense_to_pseries(relational(var, point), c);
+}
+
+
+/** Substitute this Taylor series into a power series, with Brent and
+ *  Kung's composition algorithm. The constant term c of this series is
+ *  dropped: taylor are the coefficients of the power series of a function
+ *  f around c, so the result is the series of f.
+ *
+ *  @param taylor  coefficients of the power series
+ *  @param order  truncation order of the result (at most the order of
+ *                this series)
+ *  @return the composed series, as a pseries */
+ex pseries::compose_series(const exvector & taylor, int order) const
+{
+	if (!seq.empty() && ex_to<numeric>(seq.begin()->coeff).is_negative())
+		throw std::invalid_argument("pseries::compose_series(): series has a pole");
+	const int n = std::max(truncation_degree(seq, order), 0);
+	exvector u = dense_coefficients(seq, 0, n);
+	if (n > 0)
+		u[0] = _ex0;
+	return dense_to_pseries(relational(var, point), dense_compose(taylor, u, n));
+}
+
+
 /** Return a new pseries object with the powers shifted by deg. */
 pseries pseries::shift_exponents(int deg) const
 {
@@ -1280,6 +1874,105 @@ ex integral::series(const relational & r, int order, unsigned options) const
 }
 
 
+namespace {
+
+/** Cache of series() results. Each expression, point and options have one
+ *  slot (chosen by their hash values), a new result replaces the one
+ *  stored there. */
+struct series_cache_entry {
+	series_cache_entry() : order(0), options(0), used(false) {}
+	ex e, var, point, result;
+	int order;
+	unsigned options;
+	bool used;
+};
+
+struct series_cache_t {
+	series_cache_t() : lookups(0), hits(0), entries(0) {}
+	std::vector<series_cache_entry> slots;
+	unsigned long lookups, hits;
+	size_t entries;
+};
+
+size_t series_cache_size = 0;
+
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+thread_local series_cache_t series_cache;
+#else
+series_cache_t series_cache;
+#endif
+
+}
+
+void set_series_cache_size(size_t size)
+{
+	series_cache_size = size;
+	series_cache = series_cache_t();
+}
+
+series_cache_statistics get_series_cache_statistics()
+{
+	series_cache_statistics st;
+	st.lookups = series_cache.lookups;
+	st.hits = series_cache.hits;
+	st.entries = series_cache.entries;
+	return st;
+}
+
+/** The series s, computed to some order, truncated at order. */
+static ex truncate_series(const pseries & s, int order)
+{
+	const numeric o(order);
+	epvector seq;
+	for (size_t i=0; i<s.nops(); ++i) {
+		const ex deg = s.exponop(i);
+		if (ex_to<numeric>(deg) >= o) {
+			seq.push_back(expair(Order(_ex1), o));
+			break;
+		}
+		seq.push_back(expair(s.coeffop(i), deg));
+		if (is_order_function(s.coeffop(i)))
+			break;
+	}
+	return (new pseries(relational(s.get_var(), s.get_point()), seq))->setflag(status_flags::dynallocated);
+}
+
+static ex series_cached(const ex & e, const relational & r, int order, unsigned options)
+{
+	series_cache_t & cache = series_cache;
+	if (cache.slots.size() != series_cache_size) {
+		// size changed by another thread
+		cache = series_cache_t();
+		cache.slots.resize(series_cache_size);
+	}
+	const hash_t h = hash_combine(hash_combine(hash_combine(e.gethash(), r.lhs().gethash()),
+	                                           r.rhs().gethash()), options);
+	series_cache_entry & entry = cache.slots[h % cache.slots.size()];
+
+	++cache.lookups;
+	if (entry.used && entry.order >= order && entry.options == options &&
+	    entry.e.is_equal(e) && entry.var.is_equal(r.lhs()) && entry.point.is_equal(r.rhs())) {
+		++cache.hits;
+		if (entry.order == order || !is_a<pseries>(entry.result))
+			return entry.result;
+		return truncate_series(ex_to<pseries>(entry.result), order);
+	}
+
+	// The expansion of the subexpressions may change the slot, so the
+	// result is stored afterwards
+	const ex result = ex_to<basic>(e).series(r, order, options);
+	if (!entry.used)
+		++cache.entries;
+	entry.used = true;
+	entry.e = e;
+	entry.var = r.lhs();
+	entry.point = r.rhs();
+	entry.result = result;
+	entry.order = order;
+	entry.options = options;
+	return result;
+}
+
 /** Compute the truncated series expansion of an expression.
  *  This function returns an expression containing an object of class pseries 
  *  to represent the series. If the series does not terminate within the given
@@ -1291,6 +1984,7 @@ ex integral::series(const relational & r, int order, unsigned options) const
  *  @return an expression holding a pseries object */
 ex ex::series(const ex & r, int order, unsigned options) const
 {
+	trace_scope timer("series");
 	ex e;
 	relational rel_;
 	
@@ -1301,6 +1995,10 @@ ex ex::series(const ex & r, int order, unsigned options) const
 	else
 		throw (std::logic_error("ex::series(): expansion point has unknown type"));
 	
+	// Symbols, numbers and other atoms are expanded faster than looked up
+	if (series_cache_size != 0 && bp->nops() != 0)
+		return series_cached(*this, rel_, order, options);
+
 	e = bp->series(rel_, order, options);
 	return e;
 }
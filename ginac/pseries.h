@@ -66,6 +66,8 @@ public:
 	void read_archive(const archive_node& n, lst& syms);
 protected:
 	ex derivative(const symbol & s) const;
+	unsigned calc_symbol_mask() const;
+	tree_metrics calc_metrics() const;
 
 	// non-virtual functions in this class
 public:
@@ -98,7 +100,11 @@ public:
 	ex add_series(const pseries &other) const;
 	ex mul_const(const numeric &other) const;
 	ex mul_series(const pseries &other) const;
+	ex mul_series(const pseries &other, int deg) const;
 	ex power_const(const numeric &p, int deg) const;
+	ex exp_series(int order) const;
+	ex log_series(int order) const;
+	ex compose_series(const exvector &taylor, int order) const;
 	pseries shift_exponents(int deg) const;
 
 protected:
@@ -142,6 +148,26 @@ inline bool is_terminating(const pseries & s)
 	return s.is_terminating();
 }
 
+/** Statistics of the cache of series() results (@see set_series_cache_size()). */
+struct series_cache_statistics {
+	unsigned long lookups;  ///< calls of ex::series() which looked into the cache
+	unsigned long hits;     ///< calls answered from the cache
+	size_t entries;         ///< results currently stored
+};
+
+/** Let ex::series() remember its results in a cache with room for size
+ *  entries. A call for the same expression (compared with is_equal()),
+ *  expansion point and options is answered from the cache if the stored
+ *  series was computed to at least the requested order, truncating it if
+ *  necessary. This also applies to the expansions of subexpressions. A
+ *  size of 0, the default, switches the cache off and frees the stored
+ *  expressions. With GINAC_THREAD_SAFE_REFCOUNT every thread has its own
+ *  cache (and statistics) of this size. */
+extern void set_series_cache_size(size_t size);
+
+/** Return the statistics of the series() cache (of the calling thread). */
+extern series_cache_statistics get_series_cache_statistics();
+
 } // namespace GiNaC
 
 #endif // ndef GINAC_SERIES_H
@@ -28,6 +28,18 @@
 #include <cstddef> // for size_t
 #include <functional>
 #include <iosfwd>
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+#include <atomic>
+#endif
+
+// Define GINAC_THREAD_SAFE_REFCOUNT (both when building the library and
+// when compiling code that uses it) to make the reference counters of
+// refcounted objects atomic, as well as the status flags, hash values and
+// other caches which const methods of basic fill in (see basic_cache).
+// This allows to share one expression between several threads at the cost
+// of slightly slower copying of ex objects. CLN numbers are not counted
+// atomically, though, so shared expressions may only contain numbers which
+// CLN stores immediately (see numerics_are_immediate()).
 
 namespace GiNaC {
 
@@ -36,13 +48,54 @@ class refcounted {
 public:
 	refcounted() throw() : refcount(0) {}
 
+	/** Reference count of immortal objects (see make_immortal()). */
+	static const unsigned int immortal_refcount = 0x80000000u;
+
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	// std::atomic is not copyable, and a copy must start its life
+	// unreferenced anyway.
+	refcounted(const refcounted &) throw() : refcount(0) {}
+	refcounted & operator=(const refcounted &) throw() { return *this; }
+
+	// The counters of immortal objects are only read, so the cache lines
+	// of the flyweights which nearly every expression refers to are not
+	// written by all threads at once.
+	unsigned int add_reference() throw()
+	{
+		const unsigned int r = refcount.load(std::memory_order_relaxed);
+		if (r >= immortal_refcount)
+			return r;
+		return refcount.fetch_add(1, std::memory_order_relaxed) + 1;
+	}
+	unsigned int remove_reference() throw()
+	{
+		const unsigned int r = refcount.load(std::memory_order_relaxed);
+		if (r >= immortal_refcount)
+			return r;
+		return refcount.fetch_sub(1, std::memory_order_acq_rel) - 1;
+	}
+	unsigned int get_refcount() const throw() { return refcount.load(std::memory_order_acquire); }
+	void set_refcount(unsigned int r) throw() { refcount.store(r, std::memory_order_release); }
+
+	/** Stop counting the references of this object, which is then never
+	 *  deleted. For objects which live as long as the library. */
+	void make_immortal() throw() { set_refcount(immortal_refcount); }
+
+private:
+	std::atomic<unsigned int> refcount; ///< reference counter
+#else
 	unsigned int add_reference() throw() { return ++refcount; }
 	unsigned int remove_reference() throw() { return --refcount; }
 	unsigned int get_refcount() const throw() { return refcount; }
 	void set_refcount(unsigned int r) throw() { refcount = r; }
 
+	// Counting is cheap without atomic operations, so the references of
+	// immortal objects are counted as usual.
+	void make_immortal() throw() { }
+
 private:
 	unsigned int refcount; ///< reference counter
+#endif
 };
 
 
@@ -56,9 +109,10 @@ private:
 template <class T> class ptr {
 	friend class std::less< ptr<T> >;
 
-	// NB: This implementation of reference counting is not thread-safe.
-	// The reference counter needs to be incremented/decremented atomically,
-	// and makewritable() requires locking.
+	// NB: Unless GINAC_THREAD_SAFE_REFCOUNT is defined, this implementation
+	// of reference counting is not thread-safe. Even then, a single ptr
+	// object must not be modified by several threads at once: it is the
+	// objects pointed to which may be shared, not the ptrs themselves.
 
 public:
     // no default ctor: a ptr is never unbound
@@ -102,7 +156,10 @@ public:
 		if (p->get_refcount() > 1) {
 			T *p2 = p->duplicate();
 			p2->set_refcount(1);
-			p->remove_reference();
+			// Other ptrs may have let go of the object while we were
+			// copying it, in which case we hold the last reference.
+			if (p->remove_reference() == 0)
+				delete p;
 			p = p2;
 		}
 	}
@@ -28,4 +28,12 @@
 
 namespace GiNaC {
 
+unsigned registered_class_options::next_index()
+{
+	// Classes are registered during static initialization, which runs in
+	// one thread
+	static unsigned n = 0;
+	return n++;
+}
+
 } // namespace GiNaC
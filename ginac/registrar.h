@@ -26,6 +26,7 @@
 #include "class_info.h"
 #include "print.h"
 
+#include <cstddef> // for size_t
 #include <list>
 #include <string>
 #include <typeinfo>
@@ -80,12 +81,16 @@ template<typename T> inline return_type_t make_return_type_t(const unsigned rl =
 class registered_class_options {
 public:
 	registered_class_options(const char *n, const char *p, 
-		                 const std::type_info& ti)
-	 : name(n), parent_name(p), tinfo_key(&ti) { }
+		                 const std::type_info& ti, std::size_t size = 0)
+	 : name(n), parent_name(p), tinfo_key(&ti), object_size(size), index(next_index()) { }
 
 	const char *get_name() const { return name; }
 	const char *get_parent_name() const { return parent_name; }
 	std::type_info const* get_id() const { return tinfo_key; }
+	/** Number of the class, in the order of registration. */
+	unsigned get_index() const { return index; }
+	/** sizeof() of the class (0 if unknown). */
+	std::size_t get_object_size() const { return object_size; }
 	const std::vector<print_functor> &get_print_dispatch_table() const { return print_dispatch_table; }
 
 	template <class Ctx, class T, class C>
@@ -120,7 +125,11 @@ private:
 	const char *name;         /**< Class name. */
 	const char *parent_name;  /**< Name of superclass. */
 	std::type_info const* tinfo_key;        /**< Type information key. */
+	std::size_t object_size;  /**< See get_object_size(). */
+	unsigned index;           /**< See get_index(). */
 	std::vector<print_functor> print_dispatch_table; /**< Method table for print() dispatch */
+
+	static unsigned next_index();
 };
 
 typedef class_info<registered_class_options> registered_class_info;
@@ -155,7 +164,7 @@ public: \
 	\
 	virtual void accept(GiNaC::visitor & v) const \
 	{ \
-		if (visitor *p = dynamic_cast<visitor *>(&v)) \
+		if (visitor *p = v.get_interface<visitor>(classname::get_class_info_static().get_tag())) \
 			p->visit(*this); \
 		else \
 			inherited::accept(v); \
@@ -167,17 +176,17 @@ private:
 
 /** Macro for inclusion in the implementation of each registered class. */
 #define GINAC_IMPLEMENT_REGISTERED_CLASS(classname, supername) \
-	GiNaC::registered_class_info classname::reg_info = GiNaC::registered_class_info(GiNaC::registered_class_options(#classname, #supername, typeid(classname))); 
+	GiNaC::registered_class_info classname::reg_info = GiNaC::registered_class_info(GiNaC::registered_class_options(#classname, #supername, typeid(classname), sizeof(classname))); 
 
 /** Macro for inclusion in the implementation of each registered class.
  *  Additional options can be specified. */
 #define GINAC_IMPLEMENT_REGISTERED_CLASS_OPT(classname, supername, options) \
-	GiNaC::registered_class_info classname::reg_info = GiNaC::registered_class_info(GiNaC::registered_class_options(#classname, #supername, typeid(classname)).options);
+	GiNaC::registered_class_info classname::reg_info = GiNaC::registered_class_info(GiNaC::registered_class_options(#classname, #supername, typeid(classname), sizeof(classname)).options);
 
 /** Macro for inclusion in the implementation of each registered class.
  *  Additional options can be specified. */
 #define GINAC_IMPLEMENT_REGISTERED_CLASS_OPT_T(classname, supername, options) \
-	GiNaC::registered_class_info classname::reg_info = GiNaC::registered_class_info(GiNaC::registered_class_options(#classname, #supername, typeid(classname)).options);
+	GiNaC::registered_class_info classname::reg_info = GiNaC::registered_class_info(GiNaC::registered_class_options(#classname, #supername, typeid(classname), sizeof(classname)).options);
 
 
 /** Add or replace a print method. */
@@ -29,6 +29,7 @@
 
 #include <iostream>
 #include <stdexcept>
+#include <vector>
 
 namespace GiNaC {
 
@@ -258,40 +259,38 @@ return_type_t relational::return_type_tinfo() const
 	return lh.return_type_tinfo();
 }
 
-unsigned relational::calchash() const
+hash_t relational::calchash() const
 {
-	unsigned v = make_hash_seed(typeid(*this));
-	unsigned lhash = lh.gethash();
-	unsigned rhash = rh.gethash();
+	hash_t v = make_hash_seed(typeid(*this));
+	hash_t lhash = lh.gethash();
+	hash_t rhash = rh.gethash();
 
-	v = rotate_left(v);
 	switch(o) {
 		case equal:
 		case not_equal:
 			if (lhash>rhash) {
-				v ^= lhash;
+				v = hash_combine(v, lhash);
 				lhash = rhash;
 			} else {
-				v ^= rhash;
+				v = hash_combine(v, rhash);
 			}
 			break;
 		case less:
 		case less_or_equal:
-			v ^= rhash;
+			v = hash_combine(v, rhash);
 			break;
 		case greater:
 		case greater_or_equal:
-	   		v ^= lhash;
+			v = hash_combine(v, lhash);
 			lhash = rhash;
 			break;
 	}
-	v = rotate_left(v);
-	v ^= lhash;
+	v = hash_combine(v, lhash);
 
 	// store calculated hash value only if object is already evaluated
 	if (flags & status_flags::evaluated) {
-		setflag(status_flags::hash_calculated);
 		hashvalue = v;
+		setflag(status_flags::hash_calculated);
 	}
 
 	return v;
@@ -322,34 +321,86 @@ relational::safe_bool relational::make_safe_bool(bool cond) const
 	return cond? &safe_bool_helper::nonnull : 0;
 }
 
-/** Cast the relational into a boolean, mainly for evaluation within an
- *  if-statement.  Note that (a<b) == false does not imply (a>=b) == true in
- *  the general symbolic case.  A false result means the comparison is either
- *  false or undecidable (except of course for !=, where true means either
- *  unequal or undecidable). */
-relational::operator relational::safe_bool() const
+/** Decide the relation lh o rh, see relational::operator safe_bool(). */
+static bool decide(const ex & lh, const ex & rh, relational::operators o)
 {
+	// Compare two exact numbers directly, without forming their difference
+	if (is_exactly_a<numeric>(lh) && is_exactly_a<numeric>(rh)) {
+		const numeric & l = ex_to<numeric>(lh);
+		const numeric & r = ex_to<numeric>(rh);
+		if (o == relational::equal && l.is_crational() && r.is_crational())
+			return l.is_equal(r);
+		if (o == relational::not_equal && l.is_crational() && r.is_crational())
+			return !l.is_equal(r);
+		if (l.is_rational() && r.is_rational()) {
+			const int cmp = l.compare(r);
+			switch (o) {
+				case relational::less:
+					return cmp < 0;
+				case relational::less_or_equal:
+					return cmp <= 0;
+				case relational::greater:
+					return cmp > 0;
+				case relational::greater_or_equal:
+					return cmp >= 0;
+				default:
+					break;
+			}
+		}
+	}
+
 	const ex df = lh-rh;
 	if (!is_exactly_a<numeric>(df))
 		// cannot decide on non-numerical results
-		return o==not_equal ? make_safe_bool(true) : make_safe_bool(false);
+		return o == relational::not_equal;
 
 	switch (o) {
-		case equal:
-			return make_safe_bool(ex_to<numeric>(df).is_zero());
-		case not_equal:
-			return make_safe_bool(!ex_to<numeric>(df).is_zero());
-		case less:
-			return make_safe_bool(ex_to<numeric>(df)<(*_num0_p));
-		case less_or_equal:
-			return make_safe_bool(ex_to<numeric>(df)<=(*_num0_p));
-		case greater:
-			return make_safe_bool(ex_to<numeric>(df)>(*_num0_p));
-		case greater_or_equal:
-			return make_safe_bool(ex_to<numeric>(df)>=(*_num0_p));
+		case relational::equal:
+			return ex_to<numeric>(df).is_zero();
+		case relational::not_equal:
+			return !ex_to<numeric>(df).is_zero();
+		case relational::less:
+			return ex_to<numeric>(df)<(*_num0_p);
+		case relational::less_or_equal:
+			return ex_to<numeric>(df)<=(*_num0_p);
+		case relational::greater:
+			return ex_to<numeric>(df)>(*_num0_p);
+		case relational::greater_or_equal:
+			return ex_to<numeric>(df)>=(*_num0_p);
 		default:
 			throw(std::logic_error("invalid relational operator"));
 	}
 }
 
+/** Cast the relational into a boolean, mainly for evaluation within an
+ *  if-statement.  Note that (a<b) == false does not imply (a>=b) == true in
+ *  the general symbolic case.  A false result means the comparison is either
+ *  false or undecidable (except of course for !=, where true means either
+ *  unequal or undecidable). */
+relational::operator relational::safe_bool() const
+{
+	return make_safe_bool(decide(lh, rh, o));
+}
+
+//////////
+// global functions
+//////////
+
+void decide_relations(const exvector & relations, std::vector<bool> & results)
+{
+	results.resize(relations.size());
+	for (size_t i = 0; i < relations.size(); ++i) {
+		if (!is_exactly_a<relational>(relations[i]))
+			throw std::invalid_argument("decide_relations(): not a relation");
+		results[i] = static_cast<bool>(ex_to<relational>(relations[i]));
+	}
+}
+
+void compare_all(const exvector & values, const ex & bound, relational::operators o, std::vector<bool> & results)
+{
+	results.resize(values.size());
+	for (size_t i = 0; i < values.size(); ++i)
+		results[i] = decide(values[i], bound, o);
+}
+
 } // namespace GiNaC
@@ -69,7 +69,7 @@ protected:
 	bool match_same_type(const basic & other) const;
 	unsigned return_type() const;
 	return_type_t return_type_tinfo() const;
-	unsigned calchash() const;
+	hash_t calchash() const;
 
 	// new virtual functions which can be overridden by derived classes
 protected:
@@ -109,6 +109,19 @@ GINAC_DECLARE_UNARCHIVER(relational);
 
 // utility functions
 
+/** Decide each of the relations like the conversion to bool, and store the
+ *  results in results, which is resized to the number of relations (so
+ *  that a vector reused for many calls is not allocated again). Relations
+ *  between exact numbers are compared without forming their difference.
+ *  @throws std::invalid_argument if one of the expressions is not a
+ *  relational */
+void decide_relations(const exvector & relations, std::vector<bool> & results);
+
+/** Compare each of the values with the bound, like decide_relations() for
+ *  the relations values[i] o bound, but without constructing them. This is
+ *  meant for range checks on many values. */
+void compare_all(const exvector & values, const ex & bound, relational::operators o, std::vector<bool> & results);
+
 // inlined functions for efficiency
 inline relational::safe_bool relational::operator!() const
 {
@@ -25,166 +25,274 @@
 #include "utils.h"
 #include "remember.h"
 
+#include <iostream>
 #include <stdexcept>
 
 namespace GiNaC {
 
 //////////
-// class remember_table_entry
+// class remember_table
 //////////
 
-remember_table_entry::remember_table_entry(function const & f, ex const & r)
-  : hashvalue(f.gethash()), seq(f.seq), result(r)
+remember_table::remember_table()
 {
-	++last_access = access_counter;
-	successful_hits = 0;
+	table_size=0;
+	max_assoc_size=0;
+	remember_strategy=remember_strategies::delete_never;
+	access_counter = hits = misses = evictions = 0;
+	init_table();
 }
 
-bool remember_table_entry::is_equal(function const & f) const
+remember_table::remember_table(unsigned s, unsigned as, unsigned strat)
+  : max_assoc_size(as), remember_strategy(strat),
+    access_counter(0), hits(0), misses(0), evictions(0)
 {
-	GINAC_ASSERT(f.seq.size()==seq.size());
-	if (f.gethash()!=hashvalue) return false;
-	size_t num = seq.size();
-	for (size_t i=0; i<num; ++i)
-		if (!seq[i].is_equal(f.seq[i])) return false;
-	++last_access = access_counter;
-	++successful_hits;
-	return true;
+	// we keep max_assoc_size and remember_strategy if we need to clear
+	// all entries
+	
+	// use some power of 2 next to s
+	table_size = 1 << log2(s);
+	init_table();
 }
 
-unsigned long remember_table_entry::access_counter = 0;
-
-//////////
-// class remember_table_list
-//////////
-
-remember_table_list::remember_table_list(unsigned as, unsigned strat)
+/** Entries are only discarded if the sets have a finite size. */
+bool remember_table::bounded() const
 {
-	max_assoc_size = as;
-	remember_strategy = strat;
+	return (max_assoc_size!=0) && (remember_strategy!=remember_strategies::delete_never);
 }
 
+bool remember_table::matches(size_t i, function const & f, hash_t hash) const
+{
+	const slot & sl = slots[i];
+	if (!sl.used || sl.hashvalue!=hash)
+		return false;
+	GINAC_ASSERT(f.seq.size()==nargs);
+	exvector::const_iterator a = args.begin() + i*nargs;
+	for (size_t k=0; k<nargs; ++k)
+		if (!a[k].is_equal(f.seq[k])) return false;
+	return true;
+}
 
-void remember_table_list::add_entry(function const & f, ex const & result)
+bool remember_table::lookup_entry(function const & f, ex & result) const
 {
-	if ((max_assoc_size!=0) &&
-		(remember_strategy!=remember_strategies::delete_never) &&
-		(size()>=max_assoc_size)) {
-		// table is full, we must delete an older entry
-		GINAC_ASSERT(size()>0); // there must be at least one entry
-		
-		switch (remember_strategy) {
-		case remember_strategies::delete_cyclic: {
-			// delete oldest entry (first in list)
-			erase(begin());
-			break;
-		}
-		case remember_strategies::delete_lru: {
-			// delete least recently used entry
-			iterator it = begin();
-			iterator lowest_access_it = it;
-			unsigned long lowest_access = (*it).get_last_access();
-			++it;
-			while (it!=end()) {
-				if ((*it).get_last_access()<lowest_access) {
-					lowest_access = (*it).get_last_access();
-					lowest_access_it = it;
-				}
-				++it;
-			}
-			erase(lowest_access_it);
-			break;
-		}
-		case remember_strategies::delete_lfu: {
-			// delete least frequently used entry
-			iterator it = begin();
-			iterator lowest_hits_it = it;
-			unsigned lowest_hits = (*it).get_successful_hits();
-			++it;
-			while (it!=end()) {
-				if ((*it).get_successful_hits()<lowest_hits) {
-					lowest_hits = (*it).get_successful_hits();
-					lowest_hits_it = it;
-				}
-				++it;
-			}
-			erase(lowest_hits_it);
-			break;
-		}
-		default:
-			throw(std::logic_error("remember_table_list::add_entry(): invalid remember_strategy"));
-        }
-		GINAC_ASSERT(size()==max_assoc_size-1);
+	if (num_entries == 0) {
+		++misses;
+		internal::count_event(f, internal::stat_remember_miss);
+		return false;
 	}
-	push_back(remember_table_entry(f,result));
+
+	const hash_t hash = f.gethash();
+	size_t i;
+	if (bounded()) {
+		const size_t first = (hash & (table_size-1)) * max_assoc_size;
+		for (i=first; i<first+max_assoc_size; ++i)
+			if (matches(i, f, hash))
+				break;
+		if (i == first+max_assoc_size)
+			i = slots.size();
+	} else {
+		const size_t mask = slots.size()-1;
+		i = hash & mask;
+		while (slots[i].used && !matches(i, f, hash))
+			i = (i+1) & mask;
+		if (!slots[i].used)
+			i = slots.size();
+	}
+
+	if (i == slots.size()) {
+		++misses;
+		internal::count_event(f, internal::stat_remember_miss);
+		return false;
+	}
+	++hits;
+	internal::count_event(f, internal::stat_remember_hit);
+	slots[i].last_access = ++access_counter;
+	++slots[i].hits;
+	slots[i].referenced = true;
+	result = results[i];
+	return true;
 }
 
-bool remember_table_list::lookup_entry(function const & f, ex & result) const
+void remember_table::add_entry(function const & f, ex const & result)
 {
-	const_iterator i = begin(), iend = end();
-	while (i != iend) {
-		if (i->is_equal(f)) {
-			result = i->get_result();
-			return true;
+	if (num_entries == 0 && nargs != f.seq.size()) {
+		nargs = f.seq.size();
+		args.clear();
+		args.resize(slots.size() * nargs);
+	}
+	GINAC_ASSERT(f.seq.size()==nargs);
+
+	const hash_t hash = f.gethash();
+	if (bounded()) {
+		const size_t first = (hash & (table_size-1)) * max_assoc_size;
+		size_t i = first;
+		while (i<first+max_assoc_size && slots[i].used)
+			++i;
+		if (i == first+max_assoc_size) {
+			// set is full, we must delete an older entry
+			i = find_victim(first);
+			++evictions;
+			--num_entries;
 		}
-		++i;
+		store(i, f, hash, result);
+	} else {
+		if ((num_entries+1)*2 > slots.size())
+			grow();
+		const size_t mask = slots.size()-1;
+		size_t i = hash & mask;
+		while (slots[i].used)
+			i = (i+1) & mask;
+		store(i, f, hash, result);
 	}
-	return false;
 }
 
-//////////
-// class remember_table
-//////////
-
-remember_table::remember_table()
+/** Choose the entry to be replaced in the full set starting at 'first'. */
+size_t remember_table::find_victim(size_t first)
 {
-	table_size=0;
-	max_assoc_size=0;
-	remember_strategy=remember_strategies::delete_never;
-}
+	const size_t last = first + max_assoc_size;
+	unsigned & hand = hands[first / max_assoc_size];
+	size_t victim = first;
 
-remember_table::remember_table(unsigned s, unsigned as, unsigned strat)
-  : max_assoc_size(as), remember_strategy(strat)
-{
-	// we keep max_assoc_size and remember_strategy if we need to clear
-	// all entries
-	
-	// use some power of 2 next to s
-	table_size = 1 << log2(s);
-	init_table();
+	switch (remember_strategy) {
+	case remember_strategies::delete_cyclic:
+		// delete oldest entry
+		victim = first + hand;
+		hand = (hand+1) % max_assoc_size;
+		break;
+	case remember_strategies::delete_lru:
+		// delete least recently used entry
+		for (size_t i=first+1; i<last; ++i)
+			if (slots[i].last_access < slots[victim].last_access)
+				victim = i;
+		break;
+	case remember_strategies::delete_lfu:
+		// delete least frequently used entry
+		for (size_t i=first+1; i<last; ++i)
+			if (slots[i].hits < slots[victim].hits)
+				victim = i;
+		break;
+	case remember_strategies::delete_clock:
+		// delete the first entry under the hand which was not hit since
+		// the hand passed it last
+		while (slots[first + hand].referenced) {
+			slots[first + hand].referenced = false;
+			hand = (hand+1) % max_assoc_size;
+		}
+		victim = first + hand;
+		hand = (hand+1) % max_assoc_size;
+		break;
+	default:
+		throw(std::logic_error("remember_table::add_entry(): invalid remember_strategy"));
+	}
+	return victim;
 }
 
-bool remember_table::lookup_entry(function const & f, ex & result) const
+void remember_table::store(size_t i, function const & f, hash_t hash, ex const & result)
 {
-	unsigned entry = f.gethash() & (table_size-1);
-	GINAC_ASSERT(entry<size());
-	return operator[](entry).lookup_entry(f,result);
+	slot & sl = slots[i];
+	sl.hashvalue = hash;
+	sl.used = true;
+	sl.referenced = true;
+	sl.hits = 0;
+	sl.last_access = ++access_counter;
+	exvector::iterator a = args.begin() + i*nargs;
+	for (size_t k=0; k<nargs; ++k)
+		a[k] = f.seq[k];
+	results[i] = result;
+	++num_entries;
 }
 
-void remember_table::add_entry(function const & f, ex const & result)
+/** Double the size of an unbounded table and rehash its entries. */
+void remember_table::grow()
 {
-	unsigned entry = f.gethash() & (table_size-1);
-	GINAC_ASSERT(entry<size());
-	operator[](entry).add_entry(f,result);
-}        
+	const size_t new_size = slots.empty() ? 8 : 2*slots.size();
+	const size_t mask = new_size-1;
+	std::vector<slot> new_slots(new_size);
+	exvector new_args(new_size * nargs);
+	exvector new_results(new_size);
+
+	for (size_t i=0; i<slots.size(); ++i) {
+		if (!slots[i].used)
+			continue;
+		size_t j = slots[i].hashvalue & mask;
+		while (new_slots[j].used)
+			j = (j+1) & mask;
+		new_slots[j] = slots[i];
+		for (size_t k=0; k<nargs; ++k)
+			new_args[j*nargs+k].swap(args[i*nargs+k]);
+		new_results[j].swap(results[i]);
+	}
+
+	slots.swap(new_slots);
+	args.swap(new_args);
+	results.swap(new_results);
+}
 
 void remember_table::clear_all_entries()
 {
-	clear();
 	init_table();
 }
 
 void remember_table::init_table()
 {
-	reserve(table_size);
-	for (unsigned i=0; i<table_size; ++i)
-		push_back(remember_table_list(max_assoc_size,remember_strategy));
+	size_t capacity = 0;
+	if (bounded())
+		capacity = size_t(table_size) * max_assoc_size;
+	else if (table_size != 0)
+		capacity = 2 * size_t(table_size);
+
+	nargs = 0;
+	num_entries = 0;
+	slots.clear();
+	slots.resize(capacity);
+	args.clear();
+	results.clear();
+	results.resize(capacity);
+	hands.clear();
+	if (bounded())
+		hands.resize(table_size, 0);
+}
+
+void remember_table::show_statistics(std::ostream & os, unsigned level) const
+{
+	const std::string indent(level, ' ');
+	os << indent << num_entries << " entries in " << slots.size() << " slots";
+	if (bounded())
+		os << " (" << table_size << " sets of " << max_assoc_size << ")";
+	os << std::endl;
+	os << indent << hits << " hits, " << misses << " misses";
+	if (hits + misses)
+		os << " (hit rate " << (100.0 * hits) / (hits + misses) << "%)";
+	os << ", " << evictions << " evictions" << std::endl;
 }
 
+/** The tables of the registered functions, in order of their serials.
+ *  With GINAC_THREAD_SAFE_REFCOUNT these are only the prototypes (holding
+ *  the sizes and strategies) of the tables of the threads. */
 std::vector<remember_table> & remember_table::remember_tables()
 {
 	static std::vector<remember_table> rt = std::vector<remember_table>();
+	if (rt.capacity() == 0)
+		rt.reserve(256);  // one for each of the built-in functions
 	return rt;
 }
 
+/** The remember table of the function with the given serial used by the
+ *  calling thread. With GINAC_THREAD_SAFE_REFCOUNT every thread remembers
+ *  on its own, so threads need no locking and don't evict each other's
+ *  entries. */
+remember_table & remember_table::thread_table(unsigned serial)
+{
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	thread_local std::vector<remember_table> tables;
+	if (serial >= tables.size()) {
+		const std::vector<remember_table> & proto = remember_tables();
+		tables.insert(tables.end(), proto.begin() + tables.size(), proto.end());
+	}
+	return tables[serial];
+#else
+	return remember_tables()[serial];
+#endif
+}
+
 } // namespace GiNaC
@@ -24,47 +24,15 @@
 #ifndef GINAC_REMEMBER_H
 #define GINAC_REMEMBER_H
 
+#include "ex.h"
+
+#include <cstddef>
 #include <iosfwd>
-#include <list>
 #include <vector>
 
 namespace GiNaC {
 
 class function;
-class ex;
-	
-/** A single entry in the remember table of a function.
- *  Needs to be a friend of class function to access 'seq'.
- *  'last_access' and 'successful_hits' are updated at each successful
- *  'is_equal'. */
-class remember_table_entry {
-public:
-	remember_table_entry(function const & f, ex const & r);
-	bool is_equal(function const & f) const;
-	ex get_result() const { return result; }
-	unsigned long get_last_access() const { return last_access; }
-	unsigned long get_successful_hits() const { return successful_hits; };
-
-protected:
-	unsigned hashvalue;
-	exvector seq;
-	ex result;
-	mutable unsigned long last_access;
-	mutable unsigned successful_hits;
-	static unsigned long access_counter;
-};    
-
-/** A list of entries in the remember table having some least
- *  significant bits of the hashvalue in common. */
-class remember_table_list : public std::list<remember_table_entry> {
-public:
-	remember_table_list(unsigned as, unsigned strat);
-	void add_entry(function const & f, ex const & result);
-	bool lookup_entry(function const & f, ex & result) const;
-protected:
-	unsigned max_assoc_size;
-	unsigned remember_strategy;
-};
 
 /** The remember table is organized like an n-fold associative cache
  *  in a microprocessor.  The table has a width of 's' (which is rounded
@@ -73,14 +41,21 @@ protected:
  *  an entry is stored depends on the hashvalue of the parameters of the
  *  function (this corresponds to the address of byte to be cached).
  *  The 'log_2(table_size)' least significant bits of this hashvalue
- *  give the slot in which the entry will be stored or looked up.
- *  Each slot can take up to 'as' entries. If a slot is full, an older
+ *  give the set in which the entry will be stored or looked up.
+ *  Each set can take up to 'as' entries. If a set is full, an older
  *  entry is removed by one of the following strategies:
- *   - oldest entry (the first one in the list)
+ *   - oldest entry (cyclic replacement)
  *   - least recently used (the one with the lowest 'last_access')
- *   - least frequently used (the one with the lowest 'successful_hits')
- *  or all entries are kept which means that the table grows indefinitely. */
-class remember_table : public std::vector<remember_table_list> {
+ *   - least frequently used (the one with the lowest 'hits')
+ *   - clock (second chance for entries which were hit since the hand of
+ *     the set passed them last)
+ *  or all entries are kept which means that the table grows indefinitely
+ *  (it is then an open-addressing hash table with linear probing).
+ *
+ *  All entries live in one flat array, and so do their arguments and
+ *  results, so a lookup touches a few consecutive hash values and compares
+ *  arguments (mostly by pointer) only if a hash value matches. */
+class remember_table {
 public:
 	remember_table();
 	remember_table(unsigned s, unsigned as, unsigned strat);
@@ -89,12 +64,42 @@ public:
 	void clear_all_entries();
 	void show_statistics(std::ostream & os, unsigned level) const;
 	static std::vector<remember_table> & remember_tables();
+	static remember_table & thread_table(unsigned serial);
 protected:
+	/** Bookkeeping for one entry; its arguments are stored at
+	 *  args[i * nargs] and its result at results[i]. */
+	struct slot {
+		slot() : hashvalue(0), used(false), referenced(false), hits(0), last_access(0) { }
+		hash_t hashvalue;
+		bool used;
+		mutable bool referenced;      ///< hit since the clock hand passed
+		mutable unsigned hits;
+		mutable unsigned long last_access;
+	};
+
 	void init_table();
+	bool bounded() const;
+	bool matches(size_t i, function const & f, hash_t hash) const;
+	size_t find_victim(size_t first);
+	void store(size_t i, function const & f, hash_t hash, ex const & result);
+	void grow();
+
 	unsigned table_size;
 	unsigned max_assoc_size;
 	unsigned remember_strategy;
-};      
+	size_t nargs;                 ///< number of arguments of the function
+	size_t num_entries;
+	std::vector<slot> slots;
+	exvector args;
+	exvector results;
+	std::vector<unsigned> hands;  ///< per set, for cyclic and clock replacement
+
+	// statistics
+	mutable unsigned long access_counter;
+	mutable unsigned long hits;
+	mutable unsigned long misses;
+	unsigned long evictions;
+};
 
 } // namespace GiNaC
 
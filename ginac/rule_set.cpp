@@ -0,0 +1,162 @@
+/** @file rule_set.cpp
+ *
+ *  Indexed sets of substitution rules. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "rule_set.h"
+#include "expairseq.h"
+#include "function.h"
+#include "traversal.h"
+#include "wildcard.h"
+
+#include <algorithm>
+#include <typeinfo>
+
+namespace GiNaC {
+
+namespace {
+
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+thread_local const rule_set * current_rule_set = 0;
+#else
+const rule_set * current_rule_set = 0;
+#endif
+
+} // anonymous namespace
+
+rule_set::head::head(const ex & e)
+ : type(typeid(ex_to<basic>(e))), nops(e.nops()), extra(0)
+{
+	if (is_a<expairseq>(e))
+		nops = std::size_t(-1);
+	else if (nops == 0)
+		extra = e.gethash();
+	else if (is_a<function>(e))
+		extra = ex_to<function>(e).get_serial();
+}
+
+bool rule_set::head::operator<(const head & other) const
+{
+	if (type != other.type)
+		return type < other.type;
+	if (nops != other.nops)
+		return nops < other.nops;
+	return extra < other.extra;
+}
+
+rule_set::rule_set(const exmap & r) : rules(r), nodes(1)
+{
+	for (exmap::const_iterator it = rules.begin(); it != rules.end(); ++it) {
+		const std::size_t n = add_path(0, it->first);
+		nodes[n].rules.push_back(rule_list.size());
+		rule_list.push_back(it);
+	}
+}
+
+/** Add the path of pattern, starting at node n. Returns the node at its
+ *  end. */
+std::size_t rule_set::add_path(std::size_t n, const ex & pattern)
+{
+	if (is_exactly_a<wildcard>(pattern)) {
+		if (nodes[n].star == std::size_t(-1)) {
+			nodes[n].star = nodes.size();
+			nodes.push_back(node());
+		}
+		return nodes[n].star;
+	}
+
+	const head h(pattern);
+	std::map<head, std::size_t>::const_iterator c = nodes[n].children.find(h);
+	std::size_t child;
+	if (c != nodes[n].children.end()) {
+		child = c->second;
+	} else {
+		child = nodes.size();
+		nodes[n].children.insert(std::make_pair(h, child));
+		nodes.push_back(node());
+	}
+	if (h.descends()) {
+		for (std::size_t i = 0; i < pattern.nops(); ++i)
+			child = add_path(child, pattern.op(i));
+	}
+	return child;
+}
+
+/** Collect the rules below node n for the subexpressions on the stack
+ *  todo (the next one on top). */
+void rule_set::retrieve(std::size_t n, exvector & todo, std::vector<std::size_t> & found) const
+{
+	const node & nd = nodes[n];
+	if (todo.empty()) {
+		found.insert(found.end(), nd.rules.begin(), nd.rules.end());
+		return;
+	}
+
+	const ex e = todo.back();
+	todo.pop_back();
+	if (nd.star != std::size_t(-1))
+		retrieve(nd.star, todo, found);
+	const head h(e);
+	std::map<head, std::size_t>::const_iterator c = nd.children.find(h);
+	if (c != nd.children.end()) {
+		if (h.descends()) {
+			const std::size_t num = e.nops();
+			for (std::size_t i = num; i-- > 0; )
+				todo.push_back(e.op(i));
+			retrieve(c->second, todo, found);
+			todo.resize(todo.size() - num);
+		} else
+			retrieve(c->second, todo, found);
+	}
+	todo.push_back(e);
+}
+
+void rule_set::candidates(const ex & e, std::vector<exmap::const_iterator> & v) const
+{
+	std::vector<std::size_t> found;
+	exvector todo(1, e);
+	retrieve(0, todo, found);
+	std::sort(found.begin(), found.end());
+	for (std::vector<std::size_t>::const_iterator i = found.begin(); i != found.end(); ++i)
+		v.push_back(rule_list[*i]);
+}
+
+ex rule_set::subs(const ex & e, unsigned options) const
+{
+	const rule_set * const saved = current_rule_set;
+	current_rule_set = this;
+	try {
+		const ex r = traverse_subs(e, rules, options);
+		current_rule_set = saved;
+		return r;
+	} catch (...) {
+		current_rule_set = saved;
+		throw;
+	}
+}
+
+const rule_set * rule_set::active(const exmap & m)
+{
+	if (current_rule_set && &current_rule_set->rules == &m)
+		return current_rule_set;
+	return 0;
+}
+
+} // namespace GiNaC
@@ -0,0 +1,93 @@
+/** @file rule_set.h
+ *
+ *  Interface to indexed sets of substitution rules. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_RULE_SET_H
+#define GINAC_RULE_SET_H
+
+#include "ex.h"
+
+#include <cstddef>
+#include <map>
+#include <typeindex>
+#include <vector>
+
+namespace GiNaC {
+
+/** Substitution rules (patterns and their replacements, as for
+ *  ex::subs()) with a discrimination tree over the patterns.
+ *
+ *  The tree is built from the patterns in preorder: a wildcard stands for
+ *  any subexpression, sums and products only for their class (since they
+ *  match their operands in any order), and other objects for their class,
+ *  number of operands (and function) or, without operands, for their
+ *  value. For every subexpression, subs() then only tries to match the
+ *  rules whose patterns lie along the paths of the subexpression in the
+ *  tree, in O(depth), instead of all of them.
+ *
+ *  ex::subs() builds such an index by itself for large maps of patterns;
+ *  building a rule_set once saves this when the same rules are applied
+ *  many times. */
+class rule_set {
+public:
+	explicit rule_set(const exmap & rules);
+
+	/** The same as e.subs(rules, options). */
+	ex subs(const ex & e, unsigned options = 0) const;
+
+	const exmap & get_rules() const { return rules; }
+
+	/** The rules whose patterns may match e, in the order of the map. */
+	void candidates(const ex & e, std::vector<exmap::const_iterator> & v) const;
+
+	/** The rule_set whose subs() is running in the calling thread with the
+	 *  map m, or 0. */
+	static const rule_set * active(const exmap & m);
+
+private:
+	struct head {
+		head(const ex & e);
+		bool operator<(const head & other) const;
+		bool descends() const { return nops != 0 && nops != std::size_t(-1); }
+
+		std::type_index type;
+		std::size_t nops;  ///< -1 for sums and products
+		hash_t extra;      ///< value of atoms, serial of functions
+	};
+
+	struct node {
+		node() : star(std::size_t(-1)) {}
+		std::map<head, std::size_t> children;
+		std::size_t star;               ///< child for a wildcard
+		std::vector<std::size_t> rules; ///< patterns ending here
+	};
+
+	std::size_t add_path(std::size_t n, const ex & pattern);
+	void retrieve(std::size_t n, exvector & todo, std::vector<std::size_t> & found) const;
+
+	exmap rules;
+	std::vector<exmap::const_iterator> rule_list;
+	std::vector<node> nodes;
+};
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_RULE_SET_H
@@ -0,0 +1,387 @@
+/** @file small_vector.h
+ *
+ *  Vector with inline storage for a few elements. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_SMALL_VECTOR_H
+#define GINAC_SMALL_VECTOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace GiNaC {
+
+/** A sequence container with the interface of std::vector which keeps up
+ *  to N elements inside the object itself. Only longer sequences allocate
+ *  memory from the heap. Iterators are plain pointers. Unlike std::vector,
+ *  swap() and moves of short sequences move the elements, so they
+ *  invalidate iterators. */
+template<typename T, std::size_t N>
+class small_vector {
+public:
+	typedef T value_type;
+	typedef std::size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef T & reference;
+	typedef const T & const_reference;
+	typedef T * pointer;
+	typedef const T * const_pointer;
+	typedef T * iterator;
+	typedef const T * const_iterator;
+	typedef std::reverse_iterator<iterator> reverse_iterator;
+	typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+	small_vector() : first(inline_data()), len(0), cap(N) { }
+
+	explicit small_vector(size_type n) : first(inline_data()), len(0), cap(N)
+	{
+		resize(n);
+	}
+
+	small_vector(size_type n, const T & value) : first(inline_data()), len(0), cap(N)
+	{
+		assign(n, value);
+	}
+
+	template<typename InputIt, typename = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+	small_vector(InputIt b, InputIt e) : first(inline_data()), len(0), cap(N)
+	{
+		assign(b, e);
+	}
+
+	small_vector(const small_vector & other) : first(inline_data()), len(0), cap(N)
+	{
+		reserve(other.len);
+		assign(other.begin(), other.end());
+	}
+
+	small_vector(small_vector && other) : first(inline_data()), len(0), cap(N)
+	{
+		steal(other);
+	}
+
+	~small_vector()
+	{
+		clear();
+		release();
+	}
+
+	small_vector & operator=(const small_vector & other)
+	{
+		if (this != &other) {
+			clear();
+			reserve(other.len);
+			assign(other.begin(), other.end());
+		}
+		return *this;
+	}
+
+	small_vector & operator=(small_vector && other)
+	{
+		if (this != &other) {
+			clear();
+			release();
+			first = inline_data();
+			cap = N;
+			steal(other);
+		}
+		return *this;
+	}
+
+	void assign(size_type n, const T & value)
+	{
+		clear();
+		reserve(n);
+		std::uninitialized_fill_n(first, n, value);
+		len = n;
+	}
+
+	template<typename InputIt>
+	typename std::enable_if<!std::is_integral<InputIt>::value>::type
+	assign(InputIt b, InputIt e)
+	{
+		clear();
+		for (; b != e; ++b)
+			push_back(*b);
+	}
+
+	// iterators
+	iterator begin() { return first; }
+	const_iterator begin() const { return first; }
+	iterator end() { return first + len; }
+	const_iterator end() const { return first + len; }
+	reverse_iterator rbegin() { return reverse_iterator(end()); }
+	const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+	reverse_iterator rend() { return reverse_iterator(begin()); }
+	const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+	// capacity
+	size_type size() const { return len; }
+	size_type capacity() const { return cap; }
+	size_type max_size() const { return size_type(-1) / sizeof(T); }
+	bool empty() const { return len == 0; }
+
+	void reserve(size_type n)
+	{
+		if (n > cap)
+			grow(n);
+	}
+
+	void resize(size_type n)
+	{
+		if (n < len)
+			erase(begin() + n, end());
+		else {
+			reserve(n);
+			for (; len < n; ++len)
+				new (first + len) T();
+		}
+	}
+
+	void resize(size_type n, const T & value)
+	{
+		if (n < len)
+			erase(begin() + n, end());
+		else
+			insert(end(), n - len, value);
+	}
+
+	// element access
+	reference operator[](size_type i) { return first[i]; }
+	const_reference operator[](size_type i) const { return first[i]; }
+	reference at(size_type i)
+	{
+		if (i >= len)
+			throw std::out_of_range("small_vector::at");
+		return first[i];
+	}
+	const_reference at(size_type i) const
+	{
+		if (i >= len)
+			throw std::out_of_range("small_vector::at");
+		return first[i];
+	}
+	reference front() { return first[0]; }
+	const_reference front() const { return first[0]; }
+	reference back() { return first[len - 1]; }
+	const_reference back() const { return first[len - 1]; }
+	pointer data() { return first; }
+	const_pointer data() const { return first; }
+
+	// modifiers
+	void push_back(const T & value)
+	{
+		if (len == cap) {
+			// value may be an element of this vector
+			T copy(value);
+			grow(2 * cap);
+			new (first + len) T(std::move(copy));
+		} else
+			new (first + len) T(value);
+		++len;
+	}
+
+	void push_back(T && value)
+	{
+		if (len == cap) {
+			T copy(std::move(value));
+			grow(2 * cap);
+			new (first + len) T(std::move(copy));
+		} else
+			new (first + len) T(std::move(value));
+		++len;
+	}
+
+	template<typename... Args>
+	void emplace_back(Args &&... args)
+	{
+		push_back(T(std::forward<Args>(args)...));
+	}
+
+	void pop_back()
+	{
+		first[--len].~T();
+	}
+
+	iterator insert(const_iterator pos, const T & value)
+	{
+		return insert(pos, size_type(1), value);
+	}
+
+	iterator insert(const_iterator pos, size_type n, const T & value)
+	{
+		const size_type i = pos - first;
+		if (n == 0)
+			return first + i;
+		T copy(value);
+		make_gap(i, n);
+		for (size_type k = 0; k < n; ++k)
+			new (first + i + k) T(copy);
+		len += n;
+		return first + i;
+	}
+
+	template<typename InputIt>
+	typename std::enable_if<!std::is_integral<InputIt>::value, iterator>::type
+	insert(const_iterator pos, InputIt b, InputIt e)
+	{
+		const size_type i = pos - first;
+		// The range may point into this vector, so it is copied first
+		small_vector tmp(b, e);
+		const size_type n = tmp.size();
+		if (n == 0)
+			return first + i;
+		make_gap(i, n);
+		for (size_type k = 0; k < n; ++k)
+			new (first + i + k) T(std::move(tmp[k]));
+		len += n;
+		return first + i;
+	}
+
+	iterator erase(const_iterator pos)
+	{
+		return erase(pos, pos + 1);
+	}
+
+	iterator erase(const_iterator b, const_iterator e)
+	{
+		iterator dst = first + (b - first);
+		iterator src = first + (e - first);
+		if (dst != src) {
+			iterator new_end = std::move(src, end(), dst);
+			for (iterator it = new_end; it != end(); ++it)
+				it->~T();
+			len = new_end - first;
+		}
+		return dst;
+	}
+
+	void clear()
+	{
+		for (size_type i = 0; i < len; ++i)
+			first[i].~T();
+		len = 0;
+	}
+
+	void swap(small_vector & other)
+	{
+		if (!is_inline() && !other.is_inline()) {
+			std::swap(first, other.first);
+			std::swap(len, other.len);
+			std::swap(cap, other.cap);
+			return;
+		}
+		small_vector tmp(std::move(other));
+		other = std::move(*this);
+		*this = std::move(tmp);
+	}
+
+private:
+	T * inline_data() { return reinterpret_cast<T *>(&storage); }
+	bool is_inline() const { return first == reinterpret_cast<const T *>(&storage); }
+
+	/** Move the elements to heap memory for at least n elements. */
+	void grow(size_type n)
+	{
+		n = std::max(n, size_type(2 * N));
+		T * p = static_cast<T *>(::operator new(n * sizeof(T)));
+		for (size_type i = 0; i < len; ++i) {
+			new (p + i) T(std::move(first[i]));
+			first[i].~T();
+		}
+		release();
+		first = p;
+		cap = n;
+	}
+
+	/** Move the elements [i, len) up by n places, leaving raw memory. */
+	void make_gap(size_type i, size_type n)
+	{
+		if (len + n > cap)
+			grow(std::max(len + n, 2 * cap));
+		for (size_type k = len; k-- > i; ) {
+			new (first + k + n) T(std::move(first[k]));
+			first[k].~T();
+		}
+	}
+
+	void release()
+	{
+		if (!is_inline())
+			::operator delete(first);
+	}
+
+	/** Take the elements of other, which must be empty, leaving other empty. */
+	void steal(small_vector & other)
+	{
+		if (other.is_inline()) {
+			for (size_type i = 0; i < other.len; ++i)
+				new (first + i) T(std::move(other.first[i]));
+			len = other.len;
+			other.clear();
+		} else {
+			first = other.first;
+			len = other.len;
+			cap = other.cap;
+			other.first = other.inline_data();
+			other.len = 0;
+			other.cap = N;
+		}
+	}
+
+	T * first;
+	size_type len;
+	size_type cap;
+	typename std::aligned_storage<N * sizeof(T), std::alignment_of<T>::value>::type storage;
+};
+
+template<typename T, std::size_t N>
+inline bool operator==(const small_vector<T, N> & a, const small_vector<T, N> & b)
+{
+	return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+template<typename T, std::size_t N>
+inline bool operator!=(const small_vector<T, N> & a, const small_vector<T, N> & b)
+{
+	return !(a == b);
+}
+
+template<typename T, std::size_t N>
+inline bool operator<(const small_vector<T, N> & a, const small_vector<T, N> & b)
+{
+	return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+}
+
+template<typename T, std::size_t N>
+inline void swap(small_vector<T, N> & a, small_vector<T, N> & b)
+{
+	a.swap(b);
+}
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_SMALL_VECTOR_H
@@ -0,0 +1,389 @@
+/** @file sparse_matrix.cpp
+ *
+ *  Implementation of sparse matrices of expressions. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "sparse_matrix.h"
+#include "normal.h"
+#include "numeric.h"
+#include "operators.h"
+#include "utils.h"
+
+#include <limits>
+#include <set>
+#include <stdexcept>
+#include <utility>
+
+namespace GiNaC {
+
+sparse_matrix::sparse_matrix(unsigned r, unsigned c) : nrows(r), ncols(c), m(r)
+{
+}
+
+sparse_matrix::sparse_matrix(const matrix & mat) : nrows(mat.rows()), ncols(mat.cols()), m(mat.rows())
+{
+	for (unsigned r=0; r<nrows; ++r)
+		for (unsigned c=0; c<ncols; ++c)
+			if (!mat(r,c).is_zero())
+				m[r].insert(m[r].end(), std::make_pair(c, mat(r,c)));
+}
+
+size_t sparse_matrix::nonzeros() const
+{
+	size_t n = 0;
+	for (unsigned r=0; r<nrows; ++r)
+		n += m[r].size();
+	return n;
+}
+
+/** @exception range_error (index out of range) */
+ex sparse_matrix::operator()(unsigned r, unsigned c) const
+{
+	if (r>=nrows || c>=ncols)
+		throw std::range_error("sparse_matrix::operator(): index out of range");
+	row_type::const_iterator i = m[r].find(c);
+	return i==m[r].end() ? _ex0 : i->second;
+}
+
+/** @exception range_error (index out of range) */
+sparse_matrix & sparse_matrix::set(unsigned r, unsigned c, const ex & e)
+{
+	if (r>=nrows || c>=ncols)
+		throw std::range_error("sparse_matrix::set(): index out of range");
+	if (e.is_zero())
+		m[r].erase(c);
+	else
+		m[r][c] = e;
+	return *this;
+}
+
+/** @exception range_error (index out of range) */
+const sparse_matrix::row_type & sparse_matrix::row(unsigned r) const
+{
+	if (r>=nrows)
+		throw std::range_error("sparse_matrix::row(): index out of range");
+	return m[r];
+}
+
+matrix sparse_matrix::to_matrix() const
+{
+	matrix result(nrows, ncols);
+	for (unsigned r=0; r<nrows; ++r)
+		for (row_type::const_iterator i=m[r].begin(); i!=m[r].end(); ++i)
+			result(r, i->first) = i->second;
+	return result;
+}
+
+/** Product with a dense matrix.
+ *
+ *  @exception logic_error (incompatible matrices) */
+matrix sparse_matrix::mul(const matrix & other) const
+{
+	if (ncols != other.rows())
+		throw std::logic_error("sparse_matrix::mul(): incompatible matrices");
+
+	const unsigned p = other.cols();
+	exvector prod(nrows*p);
+	for (unsigned r=0; r<nrows; ++r)
+		for (row_type::const_iterator i=m[r].begin(); i!=m[r].end(); ++i)
+			for (unsigned c=0; c<p; ++c)
+				prod[r*p+c] += i->second * other(i->first, c);
+	return matrix(nrows, p, prod);
+}
+
+namespace {
+
+/** Number of the columns with the fewest entries which are searched for
+ *  the pivot with the smallest Markowitz count. */
+const unsigned markowitz_columns = 4;
+
+/** Gauss elimination of an augmented sparse system.  For every column of
+ *  the coefficients, the remaining rows with an entry in it are kept, and
+ *  the columns are queued by their number of entries.
+ *
+ *  If all entries are integers, the elimination is fraction-free: a row is
+ *  multiplied by the pivot before the pivot row is subtracted, and then
+ *  divided by the gcd of its entries, so only integers are formed and no
+ *  entry needs to be normalized. */
+class sparse_elimination {
+public:
+	sparse_elimination(unsigned m, unsigned n_, bool integral_)
+	 : n(n_), integral(integral_), rows(m), col_rows(n_) {}
+
+	/** Stores a normalized entry, which must not be stored yet. */
+	void insert(unsigned r, unsigned c, const ex & e);
+	/** Eliminates all columns. */
+	void run();
+	/** Returns the solution, throws if the system is inconsistent. */
+	matrix solution(const matrix & vars) const;
+
+private:
+	void set_count(unsigned c, size_t old_count);
+	bool choose_pivot(unsigned & pr, unsigned & pc) const;
+	void eliminate(unsigned pr, unsigned pc);
+	void eliminate_integral(unsigned r, unsigned pr, unsigned pc);
+	void update(unsigned r, unsigned c, sparse_matrix::row_type::iterator e);
+
+	const unsigned n;
+	const bool integral;
+	std::vector<sparse_matrix::row_type> rows;     ///< augmented rows
+	std::vector<std::set<unsigned> > col_rows;     ///< remaining rows with an entry in a column
+	std::set<std::pair<size_t, unsigned> > queue;  ///< remaining columns by their number of entries
+	std::vector<std::pair<unsigned, unsigned> > pivots;
+	std::set<unsigned> done_rows;
+};
+
+void sparse_elimination::insert(unsigned r, unsigned c, const ex & e)
+{
+	rows[r].insert(std::make_pair(c, e));
+	if (c < n) {
+		col_rows[c].insert(r);
+		set_count(c, col_rows[c].size()-1);
+	}
+}
+
+/** Requeues column c, which had old_count entries. */
+void sparse_elimination::set_count(unsigned c, size_t old_count)
+{
+	if (old_count)
+		queue.erase(std::make_pair(old_count, c));
+	if (!col_rows[c].empty())
+		queue.insert(std::make_pair(col_rows[c].size(), c));
+}
+
+/** The pivot with the smallest Markowitz count (r-1)*(c-1), where r and c
+ *  are the numbers of entries in its row and column, among the columns
+ *  with the fewest entries.  It bounds the number of entries that can be
+ *  filled in by the elimination. */
+bool sparse_elimination::choose_pivot(unsigned & pr, unsigned & pc) const
+{
+	size_t best = std::numeric_limits<size_t>::max();
+	unsigned tried = 0;
+	for (std::set<std::pair<size_t, unsigned> >::const_iterator i=queue.begin();
+	     i!=queue.end() && tried<markowitz_columns; ++i, ++tried) {
+		const unsigned c = i->second;
+		const size_t col_count = i->first - 1;
+		for (std::set<unsigned>::const_iterator r=col_rows[c].begin(); r!=col_rows[c].end(); ++r) {
+			const size_t count = (rows[*r].size() - 1) * col_count;
+			if (count < best) {
+				best = count;
+				pr = *r;
+				pc = c;
+				if (count == 0)
+					return true;
+			}
+		}
+	}
+	return best != std::numeric_limits<size_t>::max();
+}
+
+void sparse_elimination::eliminate(unsigned pr, unsigned pc)
+{
+	const sparse_matrix::row_type & pivot_row = rows[pr];
+	for (sparse_matrix::row_type::const_iterator i=pivot_row.begin(); i!=pivot_row.end(); ++i) {
+		if (i->first >= n)
+			break;
+		col_rows[i->first].erase(pr);
+		set_count(i->first, col_rows[i->first].size()+1);
+	}
+	const ex & pivot = pivot_row.find(pc)->second;
+
+	const std::set<unsigned> targets(col_rows[pc]);
+	for (std::set<unsigned>::const_iterator r=targets.begin(); r!=targets.end(); ++r) {
+		if (integral) {
+			eliminate_integral(*r, pr, pc);
+			continue;
+		}
+		sparse_matrix::row_type & row = rows[*r];
+		sparse_matrix::row_type::iterator lead = row.find(pc);
+		const ex factor = (lead->second / pivot).normal();
+		row.erase(lead);
+		col_rows[pc].erase(*r);
+		for (sparse_matrix::row_type::const_iterator i=pivot_row.begin(); i!=pivot_row.end(); ++i) {
+			const unsigned c = i->first;
+			if (c == pc)
+				continue;
+			sparse_matrix::row_type::iterator e = row.find(c);
+			if (e == row.end()) {
+				// fill-in
+				row.insert(std::make_pair(c, (-factor * i->second).normal()));
+				if (c < n) {
+					col_rows[c].insert(*r);
+					set_count(c, col_rows[c].size()-1);
+				}
+			} else {
+				e->second = (e->second - factor * i->second).normal();
+				update(*r, c, e);
+			}
+		}
+	}
+	set_count(pc, targets.size());
+	pivots.push_back(std::make_pair(pr, pc));
+	done_rows.insert(pr);
+}
+
+/** Removes entry e in row r and column c if it has become zero. */
+void sparse_elimination::update(unsigned r, unsigned c, sparse_matrix::row_type::iterator e)
+{
+	if (!e->second.is_zero())
+		return;
+	rows[r].erase(e);
+	if (c < n) {
+		col_rows[c].erase(r);
+		set_count(c, col_rows[c].size()+1);
+	}
+}
+
+/** Fraction-free elimination of column pc from row r with the pivot row
+ *  pr, both with integer entries. */
+void sparse_elimination::eliminate_integral(unsigned r, unsigned pr, unsigned pc)
+{
+	const sparse_matrix::row_type & pivot_row = rows[pr];
+	sparse_matrix::row_type & row = rows[r];
+	sparse_matrix::row_type::iterator lead = row.find(pc);
+	const numeric & p = ex_to<numeric>(pivot_row.find(pc)->second);
+	const numeric & l = ex_to<numeric>(lead->second);
+	const numeric g = gcd(p, l);
+	const numeric row_factor = p / g, pivot_factor = l / g;
+	row.erase(lead);
+	col_rows[pc].erase(r);
+
+	// row_factor*row - pivot_factor*pivot_row
+	if (!row_factor.is_equal(*_num1_p))
+		for (sparse_matrix::row_type::iterator e=row.begin(); e!=row.end(); ++e)
+			e->second = ex_to<numeric>(e->second).mul(row_factor);
+	for (sparse_matrix::row_type::const_iterator i=pivot_row.begin(); i!=pivot_row.end(); ++i) {
+		const unsigned c = i->first;
+		if (c == pc)
+			continue;
+		const numeric d = ex_to<numeric>(i->second).mul(pivot_factor);
+		sparse_matrix::row_type::iterator e = row.find(c);
+		if (e == row.end()) {
+			// fill-in
+			row.insert(std::make_pair(c, ex(-d)));
+			if (c < n) {
+				col_rows[c].insert(r);
+				set_count(c, col_rows[c].size()-1);
+			}
+		} else {
+			e->second = ex_to<numeric>(e->second).sub(d);
+			update(r, c, e);
+		}
+	}
+
+	// keep the entries small
+	numeric content = *_num0_p;
+	for (sparse_matrix::row_type::const_iterator e=row.begin(); e!=row.end(); ++e) {
+		content = gcd(content, ex_to<numeric>(e->second));
+		if (content.is_equal(*_num1_p))
+			return;
+	}
+	if (!content.is_zero())
+		for (sparse_matrix::row_type::iterator e=row.begin(); e!=row.end(); ++e)
+			e->second = ex_to<numeric>(e->second).div(content);
+}
+
+void sparse_elimination::run()
+{
+	unsigned pr, pc;
+	while (choose_pivot(pr, pc))
+		eliminate(pr, pc);
+}
+
+matrix sparse_elimination::solution(const matrix & vars) const
+{
+	// the remaining rows have no coefficients left
+	for (unsigned r=0; r<rows.size(); ++r)
+		if (!done_rows.count(r) && !rows[r].empty())
+			throw std::runtime_error("sparse_matrix::solve(): inconsistent linear system");
+
+	// columns without a pivot are free parameters
+	const unsigned p = vars.cols();
+	matrix sol(vars);
+	for (std::vector<std::pair<unsigned, unsigned> >::const_reverse_iterator i=pivots.rbegin(); i!=pivots.rend(); ++i) {
+		const sparse_matrix::row_type & row = rows[i->first];
+		const unsigned pc = i->second;
+		for (unsigned co=0; co<p; ++co) {
+			sparse_matrix::row_type::const_iterator b = row.find(n+co);
+			ex e = b==row.end() ? _ex0 : b->second;
+			for (sparse_matrix::row_type::const_iterator j=row.begin(); j!=row.end() && j->first<n; ++j)
+				if (j->first != pc)
+					e -= j->second * sol(j->first, co);
+			sol(pc, co) = (e / row.find(pc)->second).normal();
+		}
+	}
+	return sol;
+}
+
+} // anonymous namespace
+
+matrix sparse_matrix::solve(const matrix & vars, const matrix & rhs) const
+{
+	const unsigned p = rhs.cols();
+
+	// syntax checks
+	if ((rhs.rows() != nrows) || (vars.rows() != ncols) || (vars.cols() != p))
+		throw std::logic_error("sparse_matrix::solve(): incompatible matrices");
+	for (unsigned ro=0; ro<ncols; ++ro)
+		for (unsigned co=0; co<p; ++co)
+			if (!vars(ro,co).info(info_flags::symbol))
+				throw std::invalid_argument("sparse_matrix::solve(): 1st argument must be matrix of symbols");
+
+	// the augmented system, normalized
+	std::vector<row_type> aug(nrows);
+	bool integral = true;
+	for (unsigned r=0; r<nrows; ++r) {
+		for (row_type::const_iterator i=m[r].begin(); i!=m[r].end(); ++i) {
+			const ex e = i->second.normal();
+			if (!e.is_zero())
+				aug[r].insert(aug[r].end(), std::make_pair(i->first, e));
+		}
+		for (unsigned co=0; co<p; ++co) {
+			const ex e = rhs(r,co).normal();
+			if (!e.is_zero())
+				aug[r].insert(aug[r].end(), std::make_pair(ncols+co, e));
+		}
+		for (row_type::const_iterator i=aug[r].begin(); integral && i!=aug[r].end(); ++i)
+			integral = i->second.info(info_flags::rational);
+	}
+
+	// rational systems are eliminated fraction-free, with the rows
+	// multiplied by the lcm of their denominators
+	if (integral) {
+		for (unsigned r=0; r<nrows; ++r) {
+			numeric l = *_num1_p;
+			for (row_type::const_iterator i=aug[r].begin(); i!=aug[r].end(); ++i)
+				l = lcm(l, ex_to<numeric>(i->second).denom());
+			if (!l.is_equal(*_num1_p))
+				for (row_type::iterator i=aug[r].begin(); i!=aug[r].end(); ++i)
+					i->second = ex_to<numeric>(i->second).mul(l);
+		}
+	}
+
+	sparse_elimination elim(nrows, ncols, integral);
+	for (unsigned r=0; r<nrows; ++r)
+		for (row_type::const_iterator i=aug[r].begin(); i!=aug[r].end(); ++i)
+			elim.insert(r, i->first, i->second);
+
+	elim.run();
+	return elim.solution(vars);
+}
+
+} // namespace GiNaC
@@ -0,0 +1,82 @@
+/** @file sparse_matrix.h
+ *
+ *  Interface to sparse matrices of expressions. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_SPARSE_MATRIX_H
+#define GINAC_SPARSE_MATRIX_H
+
+#include "ex.h"
+#include "matrix.h"
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace GiNaC {
+
+/** Matrix which stores only its non-zero entries, row by row as maps from
+ *  the column to the entry.  This is for large linear systems where almost
+ *  all coefficients vanish, which a matrix could not even hold. */
+class sparse_matrix {
+public:
+	typedef std::map<unsigned, ex> row_type;
+
+	sparse_matrix(unsigned r, unsigned c);
+	explicit sparse_matrix(const matrix & m);
+
+	unsigned rows() const { return nrows; }
+	unsigned cols() const { return ncols; }
+	/** Number of entries which are stored. */
+	size_t nonzeros() const;
+
+	/** Entry in row r and column c, zero if it isn't stored. */
+	ex operator()(unsigned r, unsigned c) const;
+	/** Sets an entry, a zero one is removed. */
+	sparse_matrix & set(unsigned r, unsigned c, const ex & e);
+	/** Non-zero entries of row r. */
+	const row_type & row(unsigned r) const;
+
+	matrix to_matrix() const;
+	matrix mul(const matrix & other) const;
+
+	/** Solve the linear system with this m x n matrix and the m x p right
+	 *  hand side rhs, like matrix::solve().  The elimination chooses its
+	 *  pivots by the Markowitz criterion, which keeps the fill-in small,
+	 *  and only the entries it changes are normalized.  If all entries are
+	 *  rational numbers, it is fraction-free.
+	 *
+	 *  @param vars n x p matrix, all elements must be symbols
+	 *  @param rhs m x p matrix
+	 *  @return n x p solution matrix, which still contains some of the
+	 *          symbols of vars if the system is underdetermined
+	 *  @exception logic_error (incompatible matrices)
+	 *  @exception invalid_argument (1st argument must be matrix of symbols)
+	 *  @exception runtime_error (inconsistent linear system) */
+	matrix solve(const matrix & vars, const matrix & rhs) const;
+
+private:
+	unsigned nrows, ncols;
+	std::vector<row_type> m;
+};
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_SPARSE_MATRIX_H
@@ -0,0 +1,287 @@
+/** @file statistics.cpp
+ *
+ *  Implementation of the run-time statistics. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "statistics.h"
+#include "basic.h"
+#include "registrar.h"
+
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+#include <algorithm>
+#include <mutex>
+#endif
+
+namespace GiNaC {
+
+namespace internal {
+
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+std::atomic<bool> statistics_on(false);
+#else
+bool statistics_on = false;
+#endif
+
+} // namespace internal
+
+namespace {
+
+using internal::num_statistics_events;
+
+/** The member of class_statistics for each event. */
+unsigned long class_statistics::* const event_fields[num_statistics_events] = {
+	&class_statistics::compares,
+	&class_statistics::compares_same_hash,
+	&class_statistics::is_equals,
+	&class_statistics::is_equals_same_hash,
+	&class_statistics::gethashs,
+	&class_statistics::gethashs_cached,
+	&class_statistics::evals,
+	&class_statistics::expands,
+	&class_statistics::constructions,
+	&class_statistics::remember_hits,
+	&class_statistics::remember_misses
+};
+
+// The counters of a thread are only written by that thread, so they need
+// no atomic read-modify-write operations. They are atomic anyway, since
+// get_statistics() may read them at any time.
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+typedef std::atomic<unsigned long> counter;
+
+inline void increment(counter & c)
+{
+	c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+inline unsigned long value(const counter & c)
+{
+	return c.load(std::memory_order_relaxed);
+}
+#else
+typedef unsigned long counter;
+
+inline void increment(counter & c) { ++c; }
+inline unsigned long value(const counter & c) { return c; }
+#endif
+
+/** Counters of one class. */
+struct counter_row {
+	counter_row(const char *n) : name(n)
+	{
+		clear();
+	}
+
+	void clear()
+	{
+		for (unsigned i=0; i<num_statistics_events; ++i)
+			c[i] = 0;
+	}
+
+	void add_to(statistics_map & m) const
+	{
+		unsigned i = 0;
+		while (i<num_statistics_events && value(c[i]) == 0)
+			++i;
+		if (i == num_statistics_events)
+			return;
+		class_statistics & s = m[name];
+		for (unsigned i=0; i<num_statistics_events; ++i)
+			s.*event_fields[i] += value(c[i]);
+	}
+
+	const char *name;
+	counter c[num_statistics_events];
+};
+
+/** Counters of one thread, by class index (see
+ *  registered_class_options::get_index()). */
+struct counter_block {
+	counter_row & row(const registered_class_options & opt)
+	{
+		const unsigned i = opt.get_index();
+		if (i >= rows.size() || !rows[i]) {
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+			std::lock_guard<std::mutex> lock(mtx);
+#endif
+			if (i >= rows.size())
+				rows.resize(i + 1);
+			rows[i].reset(new counter_row(opt.get_name()));
+		}
+		return *rows[i];
+	}
+
+	void add_to(statistics_map & m)
+	{
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+		std::lock_guard<std::mutex> lock(mtx);
+#endif
+		for (size_t i=0; i<rows.size(); ++i)
+			if (rows[i])
+				rows[i]->add_to(m);
+	}
+
+	void clear()
+	{
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+		std::lock_guard<std::mutex> lock(mtx);
+#endif
+		for (size_t i=0; i<rows.size(); ++i)
+			if (rows[i])
+				rows[i]->clear();
+	}
+
+	std::vector<std::unique_ptr<counter_row> > rows;
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	/** Held by the owning thread while it changes rows, and by other
+	 *  threads while they read them. */
+	std::mutex mtx;
+#endif
+};
+
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+
+// The registry is never deleted, since threads may end after the static
+// objects have been destroyed.
+struct registry {
+	std::mutex mtx;
+	std::vector<counter_block *> blocks; ///< blocks of running threads
+	statistics_map retired;              ///< sums of the ended threads
+};
+
+registry & reg()
+{
+	static registry * r = new registry;
+	return *r;
+}
+
+thread_local bool thread_finished = false;
+
+/** The counters of the calling thread, registered while the thread runs. */
+struct thread_block {
+	thread_block()
+	{
+		std::lock_guard<std::mutex> lock(reg().mtx);
+		reg().blocks.push_back(&block);
+	}
+
+	~thread_block()
+	{
+		thread_finished = true;
+		std::lock_guard<std::mutex> lock(reg().mtx);
+		block.add_to(reg().retired);
+		std::vector<counter_block *> & b = reg().blocks;
+		b.erase(std::find(b.begin(), b.end(), &block));
+	}
+
+	counter_block block;
+};
+
+thread_local thread_block this_thread;
+
+inline counter_block * current_block()
+{
+	// Events during the destruction of other thread-local objects are
+	// not counted.
+	if (thread_finished)
+		return 0;
+	return &this_thread.block;
+}
+
+#else
+
+counter_block * current_block()
+{
+	static counter_block * b = new counter_block;
+	return b;
+}
+
+#endif // def GINAC_THREAD_SAFE_REFCOUNT
+
+} // anonymous namespace
+
+void internal::count_statistics_event(const basic & obj, statistics_event e)
+{
+	counter_block * b = current_block();
+	if (b)
+		increment(b->row(obj.get_class_info().options).c[e]);
+}
+
+void set_statistics_enabled(bool enabled)
+{
+	internal::statistics_on = enabled;
+}
+
+bool get_statistics_enabled()
+{
+	return internal::statistics_active();
+}
+
+void reset_statistics()
+{
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	std::lock_guard<std::mutex> lock(reg().mtx);
+	reg().retired.clear();
+	for (size_t i=0; i<reg().blocks.size(); ++i)
+		reg().blocks[i]->clear();
+#else
+	current_block()->clear();
+#endif
+}
+
+statistics_map get_statistics()
+{
+	statistics_map m;
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	std::lock_guard<std::mutex> lock(reg().mtx);
+	m = reg().retired;
+	for (size_t i=0; i<reg().blocks.size(); ++i)
+		reg().blocks[i]->add_to(m);
+#else
+	current_block()->add_to(m);
+#endif
+	return m;
+}
+
+void print_statistics(std::ostream & os)
+{
+	static const char * const headers[num_statistics_events] = {
+		"compare", "(hash=)", "is_equal", "(hash=)", "gethash", "(cached)",
+		"eval", "expand", "construct", "remember", "(miss)"
+	};
+
+	const statistics_map m = get_statistics();
+	os << std::setw(16) << std::left << "class" << std::right;
+	for (unsigned i=0; i<num_statistics_events; ++i)
+		os << ' ' << std::setw(10) << headers[i];
+	os << std::endl;
+	for (statistics_map::const_iterator it = m.begin(); it != m.end(); ++it) {
+		os << std::setw(16) << std::left << it->first << std::right;
+		for (unsigned i=0; i<num_statistics_events; ++i)
+			os << ' ' << std::setw(10) << it->second.*event_fields[i];
+		os << std::endl;
+	}
+}
+
+} // namespace GiNaC
@@ -0,0 +1,113 @@
+/** @file statistics.h
+ *
+ *  Run-time statistics of the basic operations on expressions. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_STATISTICS_H
+#define GINAC_STATISTICS_H
+
+#include <iosfwd>
+#include <map>
+#include <string>
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+#include <atomic>
+#endif
+
+namespace GiNaC {
+
+class basic;
+
+/** Counters of one class, see get_statistics(). */
+struct class_statistics {
+	class_statistics()
+	 : compares(0), compares_same_hash(0), is_equals(0), is_equals_same_hash(0),
+	   gethashs(0), gethashs_cached(0), evals(0), expands(0), constructions(0),
+	   remember_hits(0), remember_misses(0) {}
+
+	unsigned long compares;            ///< calls of basic::compare()
+	unsigned long compares_same_hash;  ///< ... which found equal hash values
+	unsigned long is_equals;           ///< calls of basic::is_equal()
+	unsigned long is_equals_same_hash; ///< ... which found equal hash values
+	unsigned long gethashs;            ///< calls of basic::gethash()
+	unsigned long gethashs_cached;     ///< ... which used the cached hash value
+	unsigned long evals;               ///< automatic evaluations by eval()
+	unsigned long expands;             ///< calls of expand() which had to do work
+	unsigned long constructions;       ///< constructions of expairseq objects
+	unsigned long remember_hits;       ///< results found in remember tables
+	unsigned long remember_misses;     ///< remember table lookups which failed
+};
+
+/** Statistics by class name. */
+typedef std::map<std::string, class_statistics> statistics_map;
+
+/** Switch the collection of statistics on or off. It is off by default,
+ *  and then costs a single test of a flag in each operation. */
+void set_statistics_enabled(bool enabled = true);
+bool get_statistics_enabled();
+
+/** Set all counters to zero, in all threads. */
+void reset_statistics();
+
+/** Return the counters of all classes with at least one event, added up
+ *  over all threads (including threads which have ended). */
+statistics_map get_statistics();
+
+/** Print the result of get_statistics() as a table. */
+void print_statistics(std::ostream & os);
+
+namespace internal {
+
+enum statistics_event {
+	stat_compare,
+	stat_compare_same_hash,
+	stat_is_equal,
+	stat_is_equal_same_hash,
+	stat_gethash,
+	stat_gethash_cached,
+	stat_eval,
+	stat_expand,
+	stat_construction,
+	stat_remember_hit,
+	stat_remember_miss,
+	num_statistics_events
+};
+
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+extern std::atomic<bool> statistics_on;
+inline bool statistics_active() { return statistics_on.load(std::memory_order_relaxed); }
+#else
+extern bool statistics_on;
+inline bool statistics_active() { return statistics_on; }
+#endif
+
+/** Count an event of the class of obj, in the calling thread. */
+void count_statistics_event(const basic & obj, statistics_event e);
+
+inline void count_event(const basic & obj, statistics_event e)
+{
+	if (statistics_active())
+		count_statistics_event(obj, e);
+}
+
+} // namespace internal
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_STATISTICS_H
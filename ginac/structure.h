@@ -213,7 +213,7 @@ protected:
 		return this->struct_is_equal(&obj, &o.obj);
 	}
 
-	unsigned calchash() const { return inherited::calchash(); }
+	hash_t calchash() const { return inherited::calchash(); }
 
 	// non-virtual functions in this class
 public:
@@ -241,7 +241,7 @@ int structure<T, CP>::compare_same_type(const basic & other) const
 }
 
 template <class T, template <class> class CP>
-registered_class_info structure<T, CP>::reg_info = registered_class_info(registered_class_options(structure::get_class_name(), "basic", typeid(structure<T, CP>)));
+registered_class_info structure<T, CP>::reg_info = registered_class_info(registered_class_options(structure::get_class_name(), "basic", typeid(structure<T, CP>), sizeof(structure<T, CP>)));
 
 } // namespace GiNaC
 
@@ -46,7 +46,7 @@ GINAC_IMPLEMENT_REGISTERED_CLASS_OPT(symbol, basic,
 
 // symbol
 
-symbol::symbol() : serial(next_serial++), name(""), TeX_name("")
+symbol::symbol() : serial(new_serial())
 {
 	setflag(status_flags::evaluated | status_flags::expanded);
 }
@@ -67,15 +67,18 @@ possymbol::possymbol() : realsymbol() { }
 
 // symbol
 
-symbol::symbol(const std::string & initname) : serial(next_serial++),
-	name(initname), TeX_name("")
+symbol::symbol(const std::string & initname) : serial(new_serial())
 {
+	if (!initname.empty())
+		names = std::make_shared<names_t>(initname, std::string());
 	setflag(status_flags::evaluated | status_flags::expanded);
 }
 
 symbol::symbol(const std::string & initname, const std::string & texname) :
-	serial(next_serial++), name(initname), TeX_name(texname)
+	serial(new_serial())
 {
+	if (!initname.empty() || !texname.empty())
+		names = std::make_shared<names_t>(initname, texname);
 	setflag(status_flags::evaluated | status_flags::expanded);
 }
 
@@ -101,13 +104,13 @@ possymbol::possymbol(const std::string & initname, const std::string & texname)
 void symbol::read_archive(const archive_node &n, lst &sym_lst)
 {
 	inherited::read_archive(n, sym_lst);
-	serial = next_serial++;
+	serial = new_serial();
 	std::string tmp_name;
-	n.find_string("name", tmp_name);
+	n.find_string(archive_node::KN_NAME, tmp_name);
 
 	// If symbol is in sym_lst, return the existing symbol
 	for (lst::const_iterator it = sym_lst.begin(); it != sym_lst.end(); ++it) {
-		if (is_a<symbol>(*it) && (ex_to<symbol>(*it).name == tmp_name)) {
+		if (is_a<symbol>(*it) && (ex_to<symbol>(*it).stored_name() == tmp_name)) {
 			*this = ex_to<symbol>(*it);
 			// XXX: This method is responsible for reading realsymbol
 			// and possymbol objects too. But
@@ -121,9 +124,12 @@ void symbol::read_archive(const archive_node &n, lst &sym_lst)
 			return;
 		}
 	}
-	name = tmp_name;
-	if (!n.find_string("TeXname", TeX_name))
-		TeX_name = std::string("");
+	std::string tmp_TeX_name;
+	n.find_string(archive_node::KN_TEXNAME, tmp_TeX_name);
+	if (!tmp_name.empty() || !tmp_TeX_name.empty())
+		names = std::make_shared<names_t>(tmp_name, tmp_TeX_name);
+	else
+		names.reset();
 	setflag(status_flags::evaluated | status_flags::expanded);
 
 	setflag(status_flags::dynallocated);
@@ -135,10 +141,10 @@ void symbol::archive(archive_node &n) const
 {
 	inherited::archive(n);
 	// XXX: we should not archive anonymous symbols.
-	if (!name.empty())
-		n.add_string("name", name);
-	if (!TeX_name.empty())
-		n.add_string("TeX_name", TeX_name);
+	if (!stored_name().empty())
+		n.add_string("name", stored_name());
+	if (!stored_TeX_name().empty())
+		n.add_string("TeX_name", stored_TeX_name());
 }
 
 //////////
@@ -152,12 +158,14 @@ static const std::string& get_default_TeX_name(const std::string& name);
 
 std::string symbol::get_name() const
 {
-	if (name.empty()) {
-		std::ostringstream s;
-		s << "symbol" << serial;
-		name = s.str();
-	}
-	return name;
+	if (stored_name().empty())
+		return "symbol" + ToString(serial);
+	return stored_name();
+}
+
+void symbol::set_name(const std::string & n)
+{
+	names = std::make_shared<names_t>(n, stored_TeX_name());
 }
 
 // protected
@@ -169,17 +177,17 @@ void symbol::do_print(const print_context & c, unsigned level) const
 
 void symbol::do_print_latex(const print_latex & c, unsigned level) const
 {
-	if (!TeX_name.empty())
-		c.s << TeX_name;
-	else if (!name.empty())
-		c.s << get_default_TeX_name(name);
+	if (!stored_TeX_name().empty())
+		c.s << stored_TeX_name();
+	else if (!stored_name().empty())
+		c.s << get_default_TeX_name(stored_name());
 	else
 		c.s << "symbol" << serial;
 }
 
 void symbol::do_print_tree(const print_tree & c, unsigned level) const
 {
-	c.s << std::string(level, ' ') << name << " (" << class_name() << ")" << " @" << this
+	c.s << std::string(level, ' ') << stored_name() << " (" << class_name() << ")" << " @" << this
 	    << ", serial=" << serial
 	    << std::hex << ", hash=0x" << hashvalue << ", flags=0x" << flags << std::dec
 	    << ", domain=" << get_domain()
@@ -189,12 +197,12 @@ void symbol::do_print_tree(const print_tree & c, unsigned level) const
 void symbol::do_print_python_repr(const print_python_repr & c, unsigned level) const
 {
 	c.s << class_name() << "('";
-	if (!name.empty())
-		c.s << name;
+	if (!stored_name().empty())
+		c.s << stored_name();
 	else
 		c.s << "symbol" << serial;
-	if (!TeX_name.empty())
-		c.s << "','" << TeX_name;
+	if (!stored_TeX_name().empty())
+		c.s << "','" << stored_TeX_name();
 	c.s << "')";
 }
 
@@ -270,12 +278,18 @@ bool symbol::is_equal_same_type(const basic & other) const
 	return serial==o->serial;
 }
 
-unsigned symbol::calchash() const
+hash_t symbol::calchash() const
 {
-	unsigned seed = make_hash_seed(typeid(*this));
-	hashvalue = golden_ratio_hash(seed ^ serial);
+	hash_t seed = make_hash_seed(typeid(*this));
+	const hash_t v = golden_ratio_hash(seed ^ serial);
+	hashvalue = v;
 	setflag(status_flags::hash_calculated);
-	return hashvalue;
+	return v;
+}
+
+unsigned symbol::calc_symbol_mask() const
+{
+	return mask_bit(serial);
 }
 
 //////////
@@ -288,6 +302,31 @@ unsigned symbol::calchash() const
 // non-virtual functions in this class
 //////////
 
+/** The name given to the symbol, or an empty string. */
+const std::string & symbol::stored_name() const
+{
+	static const std::string empty;
+	return names ? names->name : empty;
+}
+
+/** The LaTeX name given to the symbol, or an empty string. */
+const std::string & symbol::stored_TeX_name() const
+{
+	static const std::string empty;
+	return names ? names->TeX_name : empty;
+}
+
+/** A new serial number. Only its uniqueness matters, so the counter needs
+ *  no ordering with other memory accesses. */
+unsigned symbol::new_serial()
+{
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	return next_serial.fetch_add(1, std::memory_order_relaxed);
+#else
+	return next_serial++;
+#endif
+}
+
 /** Return default TeX name for symbol. This recognizes some greek letters. */
 static const std::string& get_default_TeX_name(const std::string& name)
 {
@@ -354,6 +393,10 @@ GINAC_BIND_UNARCHIVER(possymbol);
 
 // private
 
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+std::atomic<unsigned> symbol::next_serial(0);
+#else
 unsigned symbol::next_serial = 0;
+#endif
 
 } // namespace GiNaC
@@ -28,13 +28,18 @@
 #include "ptr.h"
 #include "archive.h"
 
+#include <memory>
 #include <string>
 #include <typeinfo>
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+#include <atomic>
+#endif
 
 namespace GiNaC {
 
 /** Basic CAS symbol.  It has a name because it must know how to output itself.
- */
+ *  Anonymous symbols, like the temporary ones created by normal(), store no
+ *  name; it is made up from the serial number when they are printed. */
 class symbol : public basic
 {
 	GINAC_DECLARE_REGISTERED_CLASS(symbol, basic)
@@ -42,6 +47,14 @@ class symbol : public basic
 public:
 	explicit symbol(const std::string & initname);
 	symbol(const std::string & initname, const std::string & texname);
+
+	/** Number identifying the symbol, two symbols are equal if their
+	 *  serial numbers are. */
+	unsigned get_serial() const { return serial; }
+
+	/** The bit representing a symbol with the given serial number in
+	 *  basic::symbol_mask(). */
+	static unsigned mask_bit(unsigned serial) { return 1U << (serial % 32); }
 	
 	// functions overriding virtual functions from base classes
 public:
@@ -64,11 +77,12 @@ public:
 protected:
 	ex derivative(const symbol & s) const;
 	bool is_equal_same_type(const basic & other) const;
-	unsigned calchash() const;
+	hash_t calchash() const;
+	unsigned calc_symbol_mask() const;
 	
 	// non-virtual functions in this class
 public:
-	void set_name(const std::string & n) { name = n; }
+	void set_name(const std::string & n);
 	std::string get_name() const;
 	virtual unsigned get_domain() const { return domain::complex; }
 protected:
@@ -80,11 +94,25 @@ protected:
 // member variables
 
 protected:
+	/** The names of a named symbol, shared between its copies. */
+	struct names_t {
+		names_t(const std::string & n, const std::string & tn) : name(n), TeX_name(tn) { }
+		std::string name;            ///< printname of this symbol
+		std::string TeX_name;        ///< LaTeX name of this symbol
+	};
+
+	const std::string & stored_name() const;
+	const std::string & stored_TeX_name() const;
+	static unsigned new_serial();
+
 	unsigned serial;                 ///< unique serial number for comparison
-	mutable std::string name;        ///< printname of this symbol
-	std::string TeX_name;            ///< LaTeX name of this symbol
+	std::shared_ptr<const names_t> names; ///< names, or 0 for an anonymous symbol
 private:
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	static std::atomic<unsigned> next_serial;  // symbols are created by several threads in normal_parallel()
+#else
 	static unsigned next_serial;
+#endif
 };
 GINAC_DECLARE_UNARCHIVER(symbol);
 
@@ -23,16 +23,24 @@
 #include "symmetry.h"
 #include "lst.h"
 #include "add.h"
+#include "mul.h"
+#include "power.h"
+#include "idx.h"
+#include "indexed.h"
+#include "symbol.h"
 #include "numeric.h" // for factorial()
 #include "operators.h"
+#include "relational.h"
 #include "archive.h"
 #include "utils.h"
 #include "hash_seed.h"
 
+#include <algorithm>
 #include <functional>
 #include <iostream>
 #include <limits>
 #include <stdexcept>
+#include <typeinfo>
 
 namespace GiNaC {
 
@@ -185,25 +193,20 @@ int symmetry::compare_same_type(const basic & other) const
 	return 0;
 }
 
-unsigned symmetry::calchash() const
+hash_t symmetry::calchash() const
 {
-	unsigned v = make_hash_seed(typeid(*this));
+	hash_t v = make_hash_seed(typeid(*this));
 
-	if (type == none) {
-		v = rotate_left(v);
-		if (!indices.empty())
-			v ^= *(indices.begin());
-	} else {
+	if (type == none)
+		v = hash_combine(v, indices.empty() ? 0 : *(indices.begin()));
+	else {
 		for (exvector::const_iterator i=children.begin(); i!=children.end(); ++i)
-		{
-			v = rotate_left(v);
-			v ^= i->gethash();
-		}
+			v = hash_combine(v, i->gethash());
 	}
 
 	if (flags & status_flags::evaluated) {
-		setflag(status_flags::hash_calculated);
 		hashvalue = v;
+		setflag(status_flags::hash_calculated);
 	}
 
 	return v;
@@ -489,6 +492,286 @@ int canonicalize(exvector::iterator v, const symmetry &symm)
 }
 
 
+unsigned symmetry_slot_class(const symmetry &symm, unsigned i)
+{
+	if (symm.indices.find(i) == symm.indices.end())
+		return i;
+	if (symm.type != symmetry::none)
+		return *symm.indices.begin();
+	for (exvector::const_iterator it=symm.children.begin(); it!=symm.children.end(); ++it) {
+		const symmetry & child = ex_to<symmetry>(*it);
+		if (child.indices.find(i) != child.indices.end())
+			return symmetry_slot_class(child, i);
+	}
+	return i;
+}
+
+void symmetry_blocks(const symmetry &symm, std::vector<std::set<unsigned> > &symmetric, std::vector<std::set<unsigned> > &antisymmetric)
+{
+	bool leaves = symm.indices.size() > 1;
+	for (exvector::const_iterator it=symm.children.begin(); it!=symm.children.end(); ++it)
+		if (ex_to<symmetry>(*it).indices.size() != 1)
+			leaves = false;
+	if (leaves && symm.type == symmetry::symmetric)
+		symmetric.push_back(symm.indices);
+	else if (leaves && symm.type == symmetry::antisymmetric)
+		antisymmetric.push_back(symm.indices);
+	else
+		for (exvector::const_iterator it=symm.children.begin(); it!=symm.children.end(); ++it)
+			symmetry_blocks(ex_to<symmetry>(*it), symmetric, antisymmetric);
+}
+
+/** Maximal number of renamings of equivalent dummy indices which
+ *  canonicalize_dummy_indices() tries. */
+static const size_t max_dummy_renamings = 720;
+
+namespace {
+
+/** One of the two slots of a dummy index, described independently of the
+ *  names of the dummy indices. */
+struct dummy_slot {
+	ex shape;       ///< the indexed object with all dummy indices replaced
+	unsigned cls;   ///< class of the slot under the symmetry of the object
+	ex index;       ///< the index in the slot, with the dummy replaced
+
+	int compare(const dummy_slot & other) const
+	{
+		int c = shape.compare(other.shape);
+		if (c)
+			return c;
+		if (cls != other.cls)
+			return cls < other.cls ? -1 : 1;
+		return index.compare(other.index);
+	}
+};
+
+/** A dummy index with its two slots (sorted). */
+struct dummy_info {
+	ex value;
+	const std::type_info * type;
+	std::vector<dummy_slot> slots;
+
+	int compare(const dummy_info & other) const
+	{
+		if (*type != *other.type)
+			return type->before(*other.type) ? -1 : 1;
+		for (size_t k=0; k<2; ++k) {
+			int c = slots[k].compare(other.slots[k]);
+			if (c)
+				return c;
+		}
+		return 0;
+	}
+	bool operator<(const dummy_info & other) const { return compare(other) < 0; }
+};
+
+} // anonymous namespace
+
+bool canonicalize_dummy_indices(const ex & e, const exvector & dummies, const exvector & names, ex & result)
+{
+	if (dummies.empty()) {
+		result = e;
+		return true;
+	}
+
+	// Collect the factors, squares twice
+	exvector factors;
+	if (is_exactly_a<mul>(e)) {
+		for (size_t k=0; k<e.nops(); ++k) {
+			const ex & f = e.op(k);
+			if (is_exactly_a<power>(f) && f.op(1).is_equal(_ex2) && is_a<indexed>(f.op(0))) {
+				factors.push_back(f.op(0));
+				factors.push_back(f.op(0));
+			} else
+				factors.push_back(f);
+		}
+	} else
+		factors.push_back(e);
+
+	std::vector<dummy_info> info(dummies.size());
+	lst values;
+	for (size_t d=0; d<dummies.size(); ++d) {
+		if (!is_a<symbol>(dummies[d].op(0)))
+			return false;
+		info[d].value = dummies[d].op(0);
+		info[d].type = &typeid(ex_to<basic>(dummies[d]));
+		values.append(info[d].value);
+	}
+
+	// Describe the slots of the dummy indices by the objects they are in,
+	// with all dummy indices replaced by the same placeholder
+	static ex placeholder = (new symbol("*"))->setflag(status_flags::dynallocated);
+	lst placeholders;
+	for (size_t d=0; d<dummies.size(); ++d)
+		placeholders.append(placeholder);
+	for (exvector::const_iterator f=factors.begin(); f!=factors.end(); ++f) {
+		if (!is_a<indexed>(*f)) {
+			for (size_t d=0; d<dummies.size(); ++d)
+				if (f->has(info[d].value))
+					return false;
+			continue;
+		}
+		const ex shape = f->subs(values, placeholders, subs_options::no_pattern);
+		const symmetry & symm = ex_to<symmetry>(ex_to<indexed>(*f).get_symmetry());
+		for (size_t k=1; k<f->nops(); ++k) {
+			const ex & index = f->op(k);
+			for (size_t d=0; d<dummies.size(); ++d) {
+				if (!index.op(0).is_equal(info[d].value))
+					continue;
+				dummy_slot slot;
+				slot.shape = shape;
+				slot.cls = symmetry_slot_class(symm, k - 1);
+				slot.index = index.subs(info[d].value == placeholder, subs_options::no_pattern);
+				info[d].slots.push_back(slot);
+			}
+		}
+	}
+	for (size_t d=0; d<dummies.size(); ++d) {
+		if (info[d].slots.size() != 2)
+			return false;
+		if (info[d].slots[1].compare(info[d].slots[0]) < 0)
+			std::swap(info[d].slots[0], info[d].slots[1]);
+	}
+
+	// Dummy indices are ordered by their slots; those with the same slots
+	// can't be told apart and all their orders are tried
+	std::sort(info.begin(), info.end());
+	std::vector<std::pair<size_t, size_t> > groups;
+	size_t renamings = 1;
+	for (size_t d=0; d<info.size(); ) {
+		size_t end = d + 1;
+		while (end < info.size() && info[end].compare(info[d]) == 0)
+			++end;
+		for (size_t k=2; k<=end-d; ++k) {
+			renamings *= k;
+			if (renamings > max_dummy_renamings)
+				return false;
+		}
+		if (end - d > 1)
+			groups.push_back(std::make_pair(d, end));
+		d = end;
+	}
+
+	// The names, in the order of the dummy indices of each class
+	lst to;
+	std::vector<size_t> next_name(info.size(), 0);
+	for (size_t d=0; d<info.size(); ++d) {
+		size_t n = d == 0 || *info[d].type != *info[d-1].type ? 0 : next_name[d-1];
+		while (n < names.size() && typeid(ex_to<basic>(names[n])) != *info[d].type)
+			++n;
+		if (n == names.size())
+			return false;
+		to.append(names[n].op(0));
+		next_name[d] = n + 1;
+	}
+
+	// Try all orders of the equivalent dummy indices and take the smallest
+	// result
+	std::vector<size_t> order(info.size());
+	for (size_t d=0; d<order.size(); ++d)
+		order[d] = d;
+	exvector candidates;
+	candidates.reserve(renamings);
+	for (;;) {
+		lst from;
+		for (size_t d=0; d<order.size(); ++d)
+			from.append(info[order[d]].value);
+		candidates.push_back(e.subs(from, to, subs_options::no_pattern));
+
+		size_t g = 0;
+		while (g < groups.size() && !std::next_permutation(order.begin() + groups[g].first, order.begin() + groups[g].second))
+			++g;
+		if (g == groups.size())
+			break;
+	}
+	exvector::const_iterator best = candidates.begin();
+	for (exvector::const_iterator it=candidates.begin()+1; it!=candidates.end(); ++it)
+		if (it->compare(*best) < 0)
+			best = it;
+	for (exvector::const_iterator it=candidates.begin(); it!=candidates.end(); ++it)
+		if ((*it + *best).is_zero()) {
+			result = _ex0;
+			return true;
+		}
+	result = *best;
+	return true;
+}
+
+/** Split the objects first..last into groups which are permuted among each
+ *  other by the symmetries of the indexed objects in e. The objects must be
+ *  indices, each of which occurs in exactly one slot of e.
+ *
+ *  @param block Receives the number of the group of each object; groups
+ *         with more than one object are numbered first
+ *  @param signs Receives for each of these groups +1 if the objects are
+ *         symmetric, -1 if antisymmetric
+ *  @return false if the symmetries of e can't be used */
+static bool symm_blocks(const ex & e, exvector::const_iterator first, exvector::const_iterator last, std::vector<unsigned> & block, std::vector<int> & signs)
+{
+	const unsigned num = last - first;
+	exvector factors;
+	if (is_exactly_a<mul>(e))
+		factors.assign(e.begin(), e.end());
+	else
+		factors.push_back(e);
+
+	// Find the slot of each object
+	std::vector<std::pair<size_t, unsigned> > slot(num, std::make_pair(factors.size(), 0u));
+	for (size_t f=0; f<factors.size(); ++f) {
+		const ex & factor = factors[f];
+		if (!is_a<indexed>(factor)) {
+			for (exvector::const_iterator it=first; it!=last; ++it)
+				if (factor.has(*it))
+					return false;
+			continue;
+		}
+		for (size_t k=1; k<factor.nops(); ++k) {
+			const ex & index = factor.op(k);
+			for (unsigned n=0; n<num; ++n) {
+				if (!is_a<idx>(first[n]) || !index.op(0).is_equal(first[n].op(0)))
+					continue;
+				if (!index.is_equal(first[n]) || slot[n].first != factors.size())
+					return false;
+				slot[n] = std::make_pair(f, unsigned(k - 1));
+			}
+		}
+	}
+	for (unsigned n=0; n<num; ++n)
+		if (slot[n].first == factors.size())
+			return false;
+
+	// Objects in the same symmetric or antisymmetric set of slots form a
+	// group, the others are on their own
+	const unsigned none = std::numeric_limits<unsigned>::max();
+	block.assign(num, none);
+	signs.clear();
+	for (size_t f=0; f<factors.size(); ++f) {
+		if (!is_a<indexed>(factors[f]))
+			continue;
+		std::vector<std::set<unsigned> > sym, anti;
+		symmetry_blocks(ex_to<symmetry>(ex_to<indexed>(factors[f]).get_symmetry()), sym, anti);
+		for (int sign=1; sign>=-1; sign-=2) {
+			const std::vector<std::set<unsigned> > & sets = sign > 0 ? sym : anti;
+			for (std::vector<std::set<unsigned> >::const_iterator it=sets.begin(); it!=sets.end(); ++it) {
+				std::vector<unsigned> members;
+				for (unsigned n=0; n<num; ++n)
+					if (slot[n].first == f && it->find(slot[n].second) != it->end())
+						members.push_back(n);
+				if (members.size() < 2)
+					continue;
+				for (std::vector<unsigned>::const_iterator m=members.begin(); m!=members.end(); ++m)
+					block[*m] = signs.size();
+				signs.push_back(sign);
+			}
+		}
+	}
+	unsigned next = signs.size();
+	for (unsigned n=0; n<num; ++n)
+		if (block[n] == none)
+			block[n] = next++;
+	return true;
+}
+
 // Symmetrize/antisymmetrize over a vector of objects
 static ex symm(const ex & e, exvector::const_iterator first, exvector::const_iterator last, bool asymmetric)
 {
@@ -500,6 +783,50 @@ static ex symm(const ex & e, exvector::const_iterator first, exvector::const_ite
 	// Transform object vector to a lst (for subs())
 	lst orig_lst(first, last);
 
+	// If the indexed objects in e are (anti)symmetric in some of the
+	// objects, the permutations which only reorder these objects give
+	// the same term up to the sign, and only one permutation of each
+	// such class is needed
+	std::vector<unsigned> block;
+	std::vector<int> signs;
+	if (symm_blocks(e, first, last, block, signs) && !signs.empty()) {
+
+		// Symmetrizing over antisymmetric slots, or vice versa, gives zero
+		for (std::vector<int>::const_iterator it=signs.begin(); it!=signs.end(); ++it)
+			if ((*it < 0) != asymmetric)
+				return _ex0;
+
+		// The classes correspond to the distinct orderings of the word of
+		// group numbers: object v is moved into the slot of the next
+		// object of the group word[v]
+		std::vector<unsigned> word(block);
+		std::sort(word.begin(), word.end());
+		std::vector<unsigned> perm(num), perm2(num), next(num);
+		exvector sum_v;
+		do {
+			for (unsigned n=0; n<num; ++n)
+				next[n] = 0;
+			for (unsigned v=0; v<num; ++v) {
+				unsigned n = next[word[v]];
+				while (block[n] != word[v])
+					++n;
+				perm[n] = v;
+				next[word[v]] = n + 1;
+			}
+			lst new_lst;
+			for (unsigned n=0; n<num; ++n)
+				new_lst.append(orig_lst.op(perm[n]));
+			ex term = e.subs(orig_lst, new_lst, subs_options::no_pattern|subs_options::no_index_renaming);
+			if (asymmetric) {
+				perm2 = perm;
+				term *= permutation_sign(perm2.begin(), perm2.end());
+			}
+			sum_v.push_back(term);
+		} while (std::next_permutation(word.begin(), word.end()));
+		ex sum = (new add(sum_v))->setflag(status_flags::dynallocated);
+		return sum / numeric(sum_v.size());
+	}
+
 	// Create index vectors for permutation
 	unsigned *iv = new unsigned[num], *iv2;
 	for (unsigned i=0; i<num; i++)
@@ -40,6 +40,8 @@ class symmetry : public basic
 	friend class sy_is_less;
 	friend class sy_swap;
 	friend int canonicalize(exvector::iterator v, const symmetry &symm);
+	friend unsigned symmetry_slot_class(const symmetry &symm, unsigned i);
+	friend void symmetry_blocks(const symmetry &symm, std::vector<std::set<unsigned> > &symmetric, std::vector<std::set<unsigned> > &antisymmetric);
 
 	GINAC_DECLARE_REGISTERED_CLASS(symmetry, basic)
 
@@ -92,7 +94,7 @@ public:
 protected:
 	void do_print(const print_context & c, unsigned level) const;
 	void do_print_tree(const print_tree & c, unsigned level) const;
-	unsigned calchash() const;
+	hash_t calchash() const;
 
 	// member variables
 private:
@@ -149,6 +151,34 @@ const symmetry & antisymmetric4();
  *          or numeric_limits<int>::max() if nothing changed */
 extern int canonicalize(exvector::iterator v, const symmetry &symm);
 
+/** Class of the slot i under the symmetry tree symm: the smallest index of
+ *  the outermost symmetric, antisymmetric or cyclic node containing i, or
+ *  i itself. Slots which can be exchanged by the symmetry are in the same
+ *  class. */
+extern unsigned symmetry_slot_class(const symmetry &symm, unsigned i);
+
+/** Collect the sets of indices which symm permutes arbitrarily, with or
+ *  without a change of sign: the symmetric and antisymmetric nodes whose
+ *  children are single indices. The sets are disjoint. */
+extern void symmetry_blocks(const symmetry &symm, std::vector<std::set<unsigned> > &symmetric, std::vector<std::set<unsigned> > &antisymmetric);
+
+/** Bring a product of indexed objects into a canonical form under renaming
+ *  of its dummy indices, taking the symmetries of the objects into account.
+ *  Terms which only differ in the names of their dummy indices get the same
+ *  form (maybe with the opposite sign), so that they are combined when
+ *  added.
+ *
+ *  @param e Indexed object, or product of indexed objects and factors
+ *           without the dummy indices
+ *  @param dummies One index of each dummy pair of e
+ *  @param names Indices whose values are given to the dummy indices, the
+ *         first ones of each index class
+ *  @param result The canonical form (zero if e equals minus itself after
+ *         renaming)
+ *  @return false if e has another form, or too many equivalent dummy
+ *          indices, or names is too short */
+extern bool canonicalize_dummy_indices(const ex & e, const exvector & dummies, const exvector & names, ex & result);
+
 /** Symmetrize expression over a set of objects (symbols, indices). */
 ex symmetrize(const ex & e, exvector::const_iterator first, exvector::const_iterator last);
 
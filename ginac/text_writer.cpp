@@ -0,0 +1,384 @@
+/** @file text_writer.cpp
+ *
+ *  Fast output of large expressions. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "text_writer.h"
+#include "add.h"
+#include "mul.h"
+#include "numeric.h"
+#include "operators.h"
+#include "power.h"
+#include "print.h"
+#include "symbol.h"
+#include "traversal.h"
+#include "utils.h"
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cln/complex.h>
+#include <cln/integer.h>
+#include <cln/rational.h>
+#include <cln/real.h>
+#include <cstring>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <typeinfo>
+#ifdef HAVE_UNISTD_H
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+namespace GiNaC {
+
+// The precedences of the classes formatted directly
+static const unsigned add_precedence = 40;
+static const unsigned mul_precedence = 50;
+static const unsigned power_precedence = 60;
+static const unsigned numeric_precedence = 30;
+
+text_writer::text_writer(int fd_, size_t buffer_size)
+  : fd(fd_), os(0), buffer(buffer_size > 0 ? buffer_size : 1), pos(0),
+    powers(new std::vector<cln::cl_I>)
+{
+#ifndef HAVE_UNISTD_H
+	delete powers;
+	throw (std::runtime_error("text_writer: writing to file descriptors is not supported"));
+#endif
+}
+
+text_writer::text_writer(std::ostream & os_, size_t buffer_size)
+  : fd(-1), os(&os_), buffer(buffer_size > 0 ? buffer_size : 1), pos(0),
+    powers(new std::vector<cln::cl_I>)
+{
+}
+
+text_writer::~text_writer()
+{
+	try {
+		flush();
+	} catch (...) {
+	}
+	delete powers;
+}
+
+text_writer & text_writer::operator<<(const char * s)
+{
+	put(s, std::strlen(s));
+	return *this;
+}
+
+void text_writer::flush()
+{
+	const char * s = &buffer[0];
+	size_t n = pos;
+	pos = 0;
+	if (os) {
+		os->write(s, n);
+		os->flush();
+		return;
+	}
+#ifdef HAVE_UNISTD_H
+	while (n > 0) {
+		ssize_t written = ::write(fd, s, n);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			throw (std::runtime_error("text_writer: write failed"));
+		}
+		s += written;
+		n -= written;
+	}
+#endif
+}
+
+void text_writer::put(const char * s, size_t n)
+{
+	while (n > 0) {
+		if (pos == buffer.size())
+			flush();
+		size_t chunk = buffer.size() - pos;
+		if (chunk > n)
+			chunk = n;
+		std::memcpy(&buffer[pos], s, chunk);
+		pos += chunk;
+		s += chunk;
+		n -= chunk;
+	}
+}
+
+void text_writer::print(const ex & e, unsigned level)
+{
+	const std::type_info & t = typeid(ex_to<basic>(e));
+	if (t == typeid(add))
+		print_add(e, level);
+	else if (t == typeid(mul))
+		print_mul(e, level);
+	else if (t == typeid(power))
+		print_power(e.op(0), e.op(1), level);
+	else if (t == typeid(symbol) || t == typeid(realsymbol) || t == typeid(possymbol)) {
+		const std::string & name = ex_to<symbol>(e).get_name();
+		put(name.data(), name.size());
+	} else if (t == typeid(numeric))
+		print_numeric(ex_to<numeric>(e), level);
+	else
+		print_other(e, level);
+}
+
+/** Like add::print_add(). */
+void text_writer::print_add(const ex & e, unsigned level)
+{
+	const epvector & seq = traversal_terms(ex_to<expairseq>(e));
+	if (add_precedence <= level)
+		put('(');
+
+	bool first = true;
+	if (e.nops() > seq.size()) {
+		const ex oc = e.op(seq.size());
+		print_numeric(ex_to<numeric>(oc), 0);
+		first = false;
+	}
+
+	for (epvector::const_iterator it = seq.begin(); it != seq.end(); ++it) {
+		const numeric & coeff = ex_to<numeric>(it->coeff);
+		const bool negative = coeff.csgn() == -1;
+		if (!first)
+			put(negative ? '-' : '+');
+		else {
+			if (negative)
+				put('-');
+			first = false;
+		}
+		if (!coeff.is_equal(*_num1_p) && !coeff.is_equal(*_num_1_p)) {
+			print_coeff(coeff, add_precedence);
+			put('*');
+		}
+		print(it->rest, add_precedence);
+	}
+
+	if (add_precedence <= level)
+		put(')');
+}
+
+/** Like mul::do_print(). */
+void text_writer::print_mul(const ex & e, unsigned level)
+{
+	const epvector & seq = traversal_terms(ex_to<expairseq>(e));
+	if (mul_precedence <= level)
+		put('(');
+
+	if (e.nops() > seq.size()) {
+		const ex oc = e.op(seq.size());
+		const numeric & coeff = ex_to<numeric>(oc);
+		if (coeff.csgn() == -1)
+			put('-');
+		if (!coeff.is_equal(*_num_1_p)) {
+			print_coeff(coeff, mul_precedence);
+			put('*');
+		}
+	}
+
+	for (epvector::const_iterator it = seq.begin(); it != seq.end(); ++it) {
+		if (it != seq.begin())
+			put('*');
+		if (ex_to<numeric>(it->coeff).is_equal(*_num1_p))
+			print(it->rest, mul_precedence);
+		else
+			print_power(it->rest, it->coeff, mul_precedence);
+	}
+
+	if (mul_precedence <= level)
+		put(')');
+}
+
+/** Like power::do_print_dflt(). */
+void text_writer::print_power(const ex & basis, const ex & exponent, unsigned level)
+{
+	if (exponent.is_equal(_ex1_2)) {
+		put("sqrt(", 5);
+		print(basis, 0);
+		put(')');
+		return;
+	}
+
+	if (power_precedence <= level)
+		put('(');
+	print(basis, power_precedence);
+	put('^');
+	print(exponent, power_precedence);
+	if (power_precedence <= level)
+		put(')');
+}
+
+/** Print the absolute value of the coefficient of a term or of a product
+ *  (whose sign was printed already), with parentheses if needed. */
+void text_writer::print_coeff(const numeric & coeff, unsigned level)
+{
+	if (coeff.is_rational()) {
+		const cln::cl_RA x = cln::abs(cln::the<cln::cl_RA>(coeff.to_cl_N()));
+		if (cln::instanceof(x, cln::cl_I_ring))
+			put_integer(cln::the<cln::cl_I>(x));
+		else {
+			put_integer(cln::numerator(x));
+			put('/');
+			put_integer(cln::denominator(x));
+		}
+	} else if (coeff.csgn() == -1)
+		print_numeric(-coeff, level);
+	else
+		print_numeric(coeff, level);
+}
+
+/** Like numeric::print_numeric() for print_dflt, for numbers with rational
+ *  real and imaginary parts. */
+void text_writer::print_numeric(const numeric & n, unsigned level)
+{
+	const cln::cl_N z = n.to_cl_N();
+	const cln::cl_R r = cln::realpart(z);
+	const cln::cl_R i = cln::imagpart(z);
+	if (!cln::instanceof(r, cln::cl_RA_ring) || !cln::instanceof(i, cln::cl_RA_ring)) {
+		print_other(n, level);
+		return;
+	}
+
+	const bool parens = numeric_precedence <= level;
+	const cln::cl_RA & x = cln::the<cln::cl_RA>(r);
+	const cln::cl_RA & y = cln::the<cln::cl_RA>(i);
+
+	if (cln::zerop(y)) {
+		// real
+		const bool p = parens && !(cln::instanceof(x, cln::cl_I_ring) && !cln::minusp(x));
+		if (p)
+			put('(');
+		if (cln::instanceof(x, cln::cl_I_ring))
+			put_integer(cln::the<cln::cl_I>(x));
+		else {
+			put_integer(cln::numerator(x));
+			put('/');
+			put_integer(cln::denominator(x));
+		}
+		if (p)
+			put(')');
+		return;
+	}
+
+	// imaginary or complex
+	const bool p = parens && !(cln::zerop(x) && y == 1);
+	if (p)
+		put('(');
+	if (!cln::zerop(x)) {
+		if (cln::instanceof(x, cln::cl_I_ring))
+			put_integer(cln::the<cln::cl_I>(x));
+		else {
+			put_integer(cln::numerator(x));
+			put('/');
+			put_integer(cln::denominator(x));
+		}
+		if (!cln::minusp(y))
+			put('+');
+	}
+	if (y == -1)
+		put('-');
+	else if (y != 1) {
+		if (cln::instanceof(y, cln::cl_I_ring))
+			put_integer(cln::the<cln::cl_I>(y));
+		else {
+			put_integer(cln::numerator(y));
+			put('/');
+			put_integer(cln::denominator(y));
+		}
+		put('*');
+	}
+	put('I');
+	if (p)
+		put(')');
+}
+
+void text_writer::print_other(const ex & e, unsigned level)
+{
+	other.str("");
+	print_dflt c(other);
+	e.print(c, level);
+	const std::string s = other.str();
+	put(s.data(), s.size());
+}
+
+void text_writer::put_integer(const cln::cl_I & x)
+{
+	if (cln::minusp(x)) {
+		put('-');
+		put_integer(-x);
+		return;
+	}
+	if (cln::integer_length(x) < std::numeric_limits<long>::digits) {
+		put_long(cln::cl_I_to_long(x));
+		return;
+	}
+
+	// Large numbers: split off blocks of 9*2^k digits by dividing by
+	// 10^(9*2^k), so that the conversion takes O(log n) multiplication
+	// times instead of one division per word.
+	std::vector<cln::cl_I> & p = *powers;
+	if (p.empty())
+		p.push_back(cln::cl_I(1000000000L));
+	while (p.back() <= x)
+		p.push_back(cln::square(p.back()));
+	size_t k = p.size() - 1;
+	while (p[k] > x)
+		--k;
+	const cln::cl_I_div_t qr = cln::floor2(x, p[k]);
+	put_integer(qr.quotient);
+	put_digits(qr.remainder, k);
+}
+
+/** Print x < 10^(9*2^k) with exactly 9*2^k digits. */
+void text_writer::put_digits(const cln::cl_I & x, size_t k)
+{
+	if (k == 0) {
+		unsigned long v = cln::cl_I_to_ulong(x);
+		char digits[9];
+		for (int i = 8; i >= 0; --i) {
+			digits[i] = char('0' + v % 10);
+			v /= 10;
+		}
+		put(digits, 9);
+		return;
+	}
+	const cln::cl_I_div_t qr = cln::floor2(x, (*powers)[k-1]);
+	put_digits(qr.quotient, k-1);
+	put_digits(qr.remainder, k-1);
+}
+
+/** Print the non-negative number v. */
+void text_writer::put_long(long v)
+{
+	char digits[24];
+	char * end = digits + sizeof(digits);
+	char * p = end;
+	do {
+		*--p = char('0' + v % 10);
+		v /= 10;
+	} while (v != 0);
+	put(p, end - p);
+}
+
+} // namespace GiNaC
@@ -0,0 +1,100 @@
+/** @file text_writer.h
+ *
+ *  Interface to fast output of large expressions. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_TEXT_WRITER_H
+#define GINAC_TEXT_WRITER_H
+
+#include "ex.h"
+
+#include <cstddef>
+#include <iosfwd>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace cln { class cl_I; }
+
+namespace GiNaC {
+
+class numeric;
+
+/** Writes expressions in the format of print_dflt into a large buffer,
+ *  which is passed on to a file descriptor or a stream when it is full.
+ *
+ *  Sums, products, powers, symbols and rational numbers are formatted
+ *  directly (integers by splitting off blocks of decimal digits), without
+ *  going through the print methods and std::ostream. Other objects are
+ *  printed with print_dflt. Print functions registered with
+ *  set_print_func<..., print_dflt>() for the classes formatted directly
+ *  are not used. */
+class text_writer {
+public:
+	/** Write to the file descriptor fd, which is not closed. */
+	explicit text_writer(int fd, size_t buffer_size = 1 << 20);
+	/** Write to the stream os. */
+	explicit text_writer(std::ostream & os, size_t buffer_size = 1 << 20);
+	/** Flushes the buffer, ignoring errors. */
+	~text_writer();
+
+	text_writer & operator<<(const ex & e) { print(e, 0); return *this; }
+	text_writer & operator<<(const char * s);
+	text_writer & operator<<(const std::string & s) { put(s.data(), s.size()); return *this; }
+	text_writer & operator<<(char ch) { put(ch); return *this; }
+
+	/** Pass the buffered text on. Throws std::runtime_error if writing
+	 *  to the file descriptor fails. */
+	void flush();
+
+private:
+	text_writer(const text_writer &);
+	text_writer & operator=(const text_writer &);
+
+	void print(const ex & e, unsigned level);
+	void print_add(const ex & e, unsigned level);
+	void print_mul(const ex & e, unsigned level);
+	void print_power(const ex & basis, const ex & exponent, unsigned level);
+	void print_numeric(const numeric & n, unsigned level);
+	void print_coeff(const numeric & coeff, unsigned level);
+	void print_other(const ex & e, unsigned level);
+	void put_integer(const cln::cl_I & x);
+	void put_digits(const cln::cl_I & x, size_t k);
+	void put_long(long v);
+
+	void put(char ch)
+	{
+		if (pos == buffer.size())
+			flush();
+		buffer[pos++] = ch;
+	}
+	void put(const char * s, size_t n);
+
+	int fd;                ///< file descriptor, or -1
+	std::ostream * os;     ///< stream, if there is no file descriptor
+	std::vector<char> buffer;
+	size_t pos;            ///< end of the text in the buffer
+	std::ostringstream other; ///< for objects printed with print_dflt
+	std::vector<cln::cl_I> * powers; ///< 10^(9*2^k)
+};
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_TEXT_WRITER_H
@@ -0,0 +1,44 @@
+/** @file threads.h
+ *
+ *  Interface to the settings of the threads used by parallel algorithms. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_THREADS_H
+#define GINAC_THREADS_H
+
+namespace GiNaC {
+
+/** Largest number of threads working on one parallel operation (such as
+ *  expand() with expand_options::parallel), including the calling thread.
+ *  The default is the value of the environment variable
+ *  GINAC_NUM_THREADS if it is a positive number, otherwise the number of
+ *  hardware threads. This is always 1 if the library was not built with
+ *  GINAC_THREAD_SAFE_REFCOUNT. */
+unsigned max_threads();
+
+/** Set the value of max_threads(). The value 0 restores the default. The
+ *  threads are kept in a pool which all parallel operations of the library
+ *  share, so several operations running at once don't start more threads
+ *  than this. */
+void set_max_threads(unsigned n);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_THREADS_H
@@ -0,0 +1,341 @@
+/** @file trace.cpp
+ *
+ *  Implementation of the timing of nested scopes. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "trace.h"
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+#include <mutex>
+#endif
+
+namespace GiNaC {
+
+namespace internal {
+
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+std::atomic<bool> tracing_on(false);
+#else
+bool tracing_on = false;
+#endif
+
+} // namespace internal
+
+namespace {
+
+typedef long long nanoseconds;
+
+nanoseconds now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/** Time at which the trace starts, for the time stamps of events. */
+nanoseconds epoch = now();
+
+/** See set_trace_event_limit(). */
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+std::atomic<size_t> event_limit(1000000);
+#else
+size_t event_limit = 1000000;
+#endif
+
+/** A path of scope names, with the times of its scopes. The nodes of a
+ *  thread form a tree whose root has no name; they are kept until the
+ *  program ends, since open scopes refer to them. */
+struct trace_node {
+	trace_node(const char *n, trace_node *p) : name(n), parent(p), calls(0), total(0), nested(0) {}
+
+	trace_node * child(const char *n)
+	{
+		for (size_t i=0; i<children.size(); ++i)
+			if (children[i]->name == n || std::strcmp(children[i]->name, n) == 0)
+				return children[i];
+		children.push_back(new trace_node(n, this));
+		return children.back();
+	}
+
+	/** Whether the time of this node is already in that of an ancestor
+	 *  of the same name. */
+	bool recursive() const
+	{
+		for (const trace_node *p = parent; p->name; p = p->parent)
+			if (std::strcmp(p->name, name) == 0)
+				return true;
+		return false;
+	}
+
+	void clear()
+	{
+		calls = 0;
+		total = nested = 0;
+		for (size_t i=0; i<children.size(); ++i)
+			children[i]->clear();
+	}
+
+	const char *name;
+	trace_node *parent;
+	std::vector<trace_node *> children;
+	unsigned long calls;
+	nanoseconds total;  ///< time in the finished scopes
+	nanoseconds nested; ///< ... spent in the scopes of the children
+};
+
+struct trace_event {
+	const char *name;
+	nanoseconds start;
+	nanoseconds duration;
+};
+
+struct open_scope {
+	trace_node *node;
+	nanoseconds start;
+};
+
+/** Trace of one thread. */
+struct trace_buffer {
+	trace_buffer(unsigned i) : id(i), root(0, 0), current(&root) {}
+
+	unsigned id;
+	trace_node root;
+	trace_node *current;
+	std::vector<open_scope> stack;
+	std::vector<trace_event> events;
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	/** Held by the owning thread while it changes the trace, and by other
+	 *  threads while they read it. */
+	std::mutex mtx;
+#endif
+};
+
+// The buffers are never deleted, since threads may end after the static
+// objects have been destroyed, and their traces are still wanted after
+// the threads have ended.
+struct registry {
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+	std::mutex mtx;
+#endif
+	std::vector<trace_buffer *> buffers;
+};
+
+registry & reg()
+{
+	static registry * r = new registry;
+	return *r;
+}
+
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+thread_local trace_buffer * this_thread = 0;
+typedef std::lock_guard<std::mutex> buffer_lock;
+#define TRACE_LOCK(name, m) buffer_lock name(m)
+#else
+trace_buffer * this_thread = 0;
+#define TRACE_LOCK(name, m)
+#endif
+
+trace_buffer & current_buffer()
+{
+	if (!this_thread) {
+		TRACE_LOCK(lock, reg().mtx);
+		this_thread = new trace_buffer(reg().buffers.size());
+		reg().buffers.push_back(this_thread);
+	}
+	return *this_thread;
+}
+
+/** Append the path of names of n, separated by semicolons. */
+void write_path(std::ostream & os, const trace_node & n)
+{
+	if (n.parent->name) {
+		write_path(os, *n.parent);
+		os << ';';
+	}
+	os << n.name;
+}
+
+void add_folded(std::map<std::string, nanoseconds> & m, const trace_node & n)
+{
+	for (size_t i=0; i<n.children.size(); ++i) {
+		const trace_node & c = *n.children[i];
+		if (c.calls) {
+			std::ostringstream path;
+			write_path(path, c);
+			m[path.str()] += c.total - c.nested;
+		}
+		add_folded(m, c);
+	}
+}
+
+void add_statistics(trace_map & m, const trace_node & n)
+{
+	for (size_t i=0; i<n.children.size(); ++i) {
+		const trace_node & c = *n.children[i];
+		if (c.calls) {
+			trace_statistics & s = m[c.name];
+			s.calls += c.calls;
+			if (!c.recursive())
+				s.total += c.total * 1e-9;
+			s.self += (c.total - c.nested) * 1e-9;
+		}
+		add_statistics(m, c);
+	}
+}
+
+/** Write s as a JSON string. */
+void write_json_string(std::ostream & os, const char *s)
+{
+	os << '"';
+	for (; *s; ++s) {
+		if (*s == '"' || *s == '\\')
+			os << '\\' << *s;
+		else if (static_cast<unsigned char>(*s) < 0x20)
+			os << ' ';
+		else
+			os << *s;
+	}
+	os << '"';
+}
+
+} // anonymous namespace
+
+void internal::trace_enter(const char *name)
+{
+	trace_buffer & b = current_buffer();
+	TRACE_LOCK(lock, b.mtx);
+	b.current = b.current->child(name);
+	open_scope s;
+	s.node = b.current;
+	s.start = now();
+	b.stack.push_back(s);
+}
+
+void internal::trace_leave()
+{
+	const nanoseconds end = now();
+	trace_buffer & b = current_buffer();
+	TRACE_LOCK(lock, b.mtx);
+	const open_scope s = b.stack.back();
+	b.stack.pop_back();
+	const nanoseconds duration = end - s.start;
+	trace_node & n = *s.node;
+	++n.calls;
+	n.total += duration;
+	n.parent->nested += duration;
+	b.current = n.parent;
+	if (b.events.size() < event_limit) {
+		trace_event e;
+		e.name = n.name;
+		e.start = s.start;
+		e.duration = duration;
+		b.events.push_back(e);
+	}
+}
+
+void set_tracing_enabled(bool enabled)
+{
+	internal::tracing_on = enabled;
+}
+
+bool get_tracing_enabled()
+{
+	return internal::tracing_active();
+}
+
+void reset_trace()
+{
+	TRACE_LOCK(lock, reg().mtx);
+	epoch = now();
+	for (size_t i=0; i<reg().buffers.size(); ++i) {
+		trace_buffer & b = *reg().buffers[i];
+		TRACE_LOCK(block, b.mtx);
+		b.root.clear();
+		b.events.clear();
+	}
+}
+
+void set_trace_event_limit(std::size_t n)
+{
+	event_limit = n;
+}
+
+trace_map get_trace()
+{
+	trace_map m;
+	TRACE_LOCK(lock, reg().mtx);
+	for (size_t i=0; i<reg().buffers.size(); ++i) {
+		trace_buffer & b = *reg().buffers[i];
+		TRACE_LOCK(block, b.mtx);
+		add_statistics(m, b.root);
+	}
+	return m;
+}
+
+void write_folded_trace(std::ostream & os)
+{
+	std::map<std::string, nanoseconds> m;
+	{
+		TRACE_LOCK(lock, reg().mtx);
+		for (size_t i=0; i<reg().buffers.size(); ++i) {
+			trace_buffer & b = *reg().buffers[i];
+			TRACE_LOCK(block, b.mtx);
+			add_folded(m, b.root);
+		}
+	}
+	for (std::map<std::string, nanoseconds>::const_iterator i = m.begin(); i != m.end(); ++i)
+		os << i->first << ' ' << i->second / 1000 << '\n';
+	os << std::flush;
+}
+
+void write_chrome_trace(std::ostream & os)
+{
+	const std::ios::fmtflags oldflags = os.flags();
+	const std::streamsize oldprecision = os.precision();
+	os << std::fixed << std::setprecision(3);
+	os << "{\"traceEvents\":[";
+	bool first = true;
+	TRACE_LOCK(lock, reg().mtx);
+	for (size_t i=0; i<reg().buffers.size(); ++i) {
+		trace_buffer & b = *reg().buffers[i];
+		TRACE_LOCK(block, b.mtx);
+		for (size_t j=0; j<b.events.size(); ++j) {
+			const trace_event & e = b.events[j];
+			os << (first ? "\n" : ",\n") << "{\"name\":";
+			write_json_string(os, e.name);
+			os << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << b.id
+			   << ",\"ts\":" << (e.start - epoch) * 1e-3
+			   << ",\"dur\":" << e.duration * 1e-3 << '}';
+			first = false;
+		}
+	}
+	os << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+	os.flags(oldflags);
+	os.precision(oldprecision);
+}
+
+#undef TRACE_LOCK
+
+} // namespace GiNaC
@@ -0,0 +1,126 @@
+/** @file trace.h
+ *
+ *  Timing of the main operations on expressions by named, nested scopes. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_TRACE_H
+#define GINAC_TRACE_H
+
+#include <cstddef> // for size_t
+#include <iosfwd>
+#include <map>
+#include <string>
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+#include <atomic>
+#endif
+
+namespace GiNaC {
+
+namespace internal {
+
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+extern std::atomic<bool> tracing_on;
+inline bool tracing_active() { return tracing_on.load(std::memory_order_relaxed); }
+#else
+extern bool tracing_on;
+inline bool tracing_active() { return tracing_on; }
+#endif
+
+void trace_enter(const char *name);
+void trace_leave();
+
+} // namespace internal
+
+/** Scope which is timed while tracing is on. The scopes of a thread nest,
+ *  and the time of a scope is attributed to the path of names from the
+ *  outermost one. ex::eval(), ex::expand(), ex::normal(), ex::subs(),
+ *  ex::series(), gcd(), factor() and the main matrix operations open
+ *  such scopes; user code may add its own. name must be a string which
+ *  lives as long as the trace (usually a literal).
+ *
+ *  Example:
+ *  @code
+ *  {
+ *      trace_scope t("my_step");
+ *      r = normal(e);
+ *  }
+ *  @endcode */
+class trace_scope {
+public:
+	explicit trace_scope(const char *name) : active(internal::tracing_active())
+	{
+		if (active)
+			internal::trace_enter(name);
+	}
+	~trace_scope()
+	{
+		if (active)
+			internal::trace_leave();
+	}
+private:
+	trace_scope(const trace_scope &);
+	trace_scope & operator=(const trace_scope &);
+
+	bool active;
+};
+
+/** Times of the scopes of one name, see get_trace(). */
+struct trace_statistics {
+	trace_statistics() : calls(0), total(0), self(0) {}
+
+	unsigned long calls; ///< number of scopes
+	double total;        ///< seconds spent in them (not counting scopes of the same name in them twice)
+	double self;         ///< ... but not in nested scopes
+};
+
+/** Trace times by scope name. */
+typedef std::map<std::string, trace_statistics> trace_map;
+
+/** Switch tracing on or off. It is off by default, and then costs a
+ *  single test of a flag in each scope. */
+void set_tracing_enabled(bool enabled = true);
+bool get_tracing_enabled();
+
+/** Forget all times and events, in all threads. */
+void reset_trace();
+
+/** Maximal number of single scopes each thread keeps for
+ *  write_chrome_trace() (default 1000000). Later scopes are only added
+ *  to the totals. */
+void set_trace_event_limit(std::size_t n);
+
+/** Return the times of the finished scopes by name, added up over all
+ *  threads. */
+trace_map get_trace();
+
+/** Write the self times of all paths of nested scopes in the "folded
+ *  stacks" format of flame graph tools: one line per path, with the
+ *  names separated by semicolons and followed by the time in
+ *  microseconds. */
+void write_folded_trace(std::ostream & os);
+
+/** Write the single scopes as "complete" events of the Chrome trace
+ *  event format (JSON), one track per thread, for viewers like
+ *  chrome://tracing or Perfetto. */
+void write_chrome_trace(std::ostream & os);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_TRACE_H
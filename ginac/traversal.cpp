@@ -0,0 +1,480 @@
+/** @file traversal.cpp
+ *
+ *  Implementation of the iterative traversal of expressions. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "traversal.h"
+#include "add.h"
+#include "integral.h"
+#include "mul.h"
+#include "numeric.h"
+#include "symbol.h"
+#include "utils.h"
+
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace GiNaC {
+
+const epvector & traversal_terms(const expairseq & s)
+{
+	return s.seq;
+}
+
+namespace {
+
+/** An operand of an object and the level at which it is visited. */
+typedef std::pair<ex, int> traversal_operand;
+
+/** Post-order traversal of the distinct subexpressions of an expression.
+ *  Each one is passed to visit() after its operands, and the results are
+ *  remembered by address and level. */
+template<class R>
+class memo_traversal {
+public:
+	virtual ~memo_traversal() {}
+
+	/** Return visit(e, level), visiting the operands of e first. */
+	R run(const ex & e, int level);
+
+	/** Find the result for b at the given level. */
+	bool lookup(const basic & b, int level, R & result) const
+	{
+		typename memo_map::const_iterator it = memo.find(key(&b, level));
+		if (it == memo.end())
+			return false;
+		result = it->second.second;
+		return true;
+	}
+
+protected:
+	virtual R visit(const ex & e, int level) = 0;
+
+	/** List the operands visit(e, level) will ask for. The default is
+	 *  op(i), or the rest of each term for add and mul, at the same level. */
+	virtual void operands(const ex & e, int level, std::vector<traversal_operand> & v) const
+	{
+		if (is_a<expairseq>(e)) {
+			const epvector & seq = traversal_terms(ex_to<expairseq>(e));
+			for (epvector::const_iterator it = seq.begin(); it != seq.end(); ++it)
+				v.push_back(traversal_operand(it->rest, level));
+		} else {
+			const size_t num = e.nops();
+			for (size_t i=0; i<num; ++i)
+				v.push_back(traversal_operand(e.op(i), level));
+		}
+	}
+
+private:
+	typedef std::pair<const basic *, int> key;
+
+	struct key_hash {
+		size_t operator()(const key & k) const
+		{
+			return std::hash<const basic *>()(k.first) ^ size_t(k.second);
+		}
+	};
+
+	// The original object is kept, so that its address isn't reused
+	typedef std::unordered_map<key, std::pair<ex, R>, key_hash> memo_map;
+	memo_map memo;
+};
+
+template<class R>
+R memo_traversal<R>::run(const ex & e, int level)
+{
+	struct frame {
+		frame(const ex & e_, int l) : node(e_), level(l), expanded(false) {}
+		ex node;
+		int level;
+		bool expanded;
+	};
+
+	std::vector<frame> stack;
+	std::vector<traversal_operand> ops;
+	stack.push_back(frame(e, level));
+	while (!stack.empty()) {
+		const key k(&ex_to<basic>(stack.back().node), stack.back().level);
+		if (memo.find(k) != memo.end()) {
+			// Shared subexpression, already visited
+			stack.pop_back();
+			continue;
+		}
+		if (!stack.back().expanded) {
+			stack.back().expanded = true;
+			ops.clear();
+			operands(stack.back().node, stack.back().level, ops);
+			for (size_t i=ops.size(); i-- > 0; ) {
+				const ex & o = ops[i].first;
+				if (o.nops() && memo.find(key(&ex_to<basic>(o), ops[i].second)) == memo.end())
+					stack.push_back(frame(o, ops[i].second));
+			}
+			continue;
+		}
+		const ex node = stack.back().node;
+		const R r = visit(node, stack.back().level);
+		memo.insert(std::make_pair(k, std::make_pair(node, r)));
+		stack.pop_back();
+	}
+	return memo.find(key(&ex_to<basic>(e), level))->second.second;
+}
+
+/** Whether the operands of e are all without operands themselves, so that
+ *  a traversal wouldn't pay off. */
+bool is_shallow(const ex & e)
+{
+	if (is_a<expairseq>(e)) {
+		const epvector & seq = traversal_terms(ex_to<expairseq>(e));
+		for (epvector::const_iterator it = seq.begin(); it != seq.end(); ++it)
+			if (it->rest.nops())
+				return false;
+		return true;
+	}
+	const size_t num = e.nops();
+	for (size_t i=0; i<num; ++i)
+		if (e.op(i).nops())
+			return false;
+	return true;
+}
+
+class subs_traversal : public memo_traversal<ex> {
+public:
+	subs_traversal(const exmap & m_, unsigned options_) : m(m_), options(options_), key_mask(0)
+	{
+		if (options & subs_options::keys_are_symbols)
+			for (exmap::const_iterator it = m.begin(); it != m.end(); ++it) {
+				symbol_values[ex_to<symbol>(it->first).get_serial()] = it->second;
+				key_mask |= ex_to<basic>(it->first).symbol_mask();
+			}
+	}
+
+	/** Whether b contains none of the keys, which must be symbols. */
+	bool misses(const basic & b) const
+	{
+		return (options & subs_options::keys_are_symbols) && !(b.symbol_mask() & key_mask);
+	}
+
+	/** Substitute into a symbol with the serial number table, if the keys
+	 *  are symbols. */
+	bool lookup_symbol(const basic & b, ex & result) const
+	{
+		if (!(options & subs_options::keys_are_symbols) || !is_a<symbol>(b))
+			return false;
+		std::unordered_map<unsigned, ex>::const_iterator it = symbol_values.find(static_cast<const symbol &>(b).get_serial());
+		if (it == symbol_values.end())
+			result = b;
+		else
+			result = it->second;
+		return true;
+	}
+
+	/** Whether subs(m_, options_) has the results of this traversal. The
+	 *  flags added by expairseq::subschildren() don't change results. */
+	bool applies_to(const exmap & m_, unsigned options_) const
+	{
+		const unsigned cache_flags = subs_options::pattern_is_product | subs_options::pattern_is_not_product;
+		return &m_ == &m && ((options_ ^ options) & ~cache_flags) == 0;
+	}
+
+protected:
+	ex visit(const ex & e, int level)
+	{
+		if (misses(ex_to<basic>(e)))
+			return e;
+		return ex_to<basic>(e).subs(m, options);
+	}
+
+	void operands(const ex & e, int level, std::vector<traversal_operand> & v) const
+	{
+		if (!misses(ex_to<basic>(e)))
+			memo_traversal<ex>::operands(e, level, v);
+	}
+
+private:
+	const exmap & m;
+	const unsigned options;
+	std::unordered_map<unsigned, ex> symbol_values;
+	unsigned key_mask;
+};
+
+/** If all keys of m are symbols, matching patterns amounts to comparing
+ *  symbols, so add the flags which make subs() look them up directly. */
+unsigned symbol_subs_options(const exmap & m, unsigned options)
+{
+	if (m.empty() || (options & (subs_options::algebraic | subs_options::keys_are_symbols)))
+		return options;
+	for (exmap::const_iterator it = m.begin(); it != m.end(); ++it)
+		if (!is_a<symbol>(it->first))
+			return options;
+	return options | subs_options::no_pattern | subs_options::keys_are_symbols
+	               | subs_options::pattern_is_not_product;
+}
+
+class has_traversal : public memo_traversal<bool> {
+public:
+	has_traversal(const ex & pattern_, unsigned options_) : pattern(pattern_), options(options_) {}
+
+	bool applies_to(const ex & pattern_, unsigned options_) const
+	{
+		return &pattern_ == &pattern && options_ == options;
+	}
+
+protected:
+	bool visit(const ex & e, int level)
+	{
+		return ex_to<basic>(e).has(pattern, options);
+	}
+
+private:
+	const ex & pattern;
+	const unsigned options;
+};
+
+class evalf_traversal : public memo_traversal<ex> {
+protected:
+	ex visit(const ex & e, int level)
+	{
+		return ex_to<basic>(e).evalf(level);
+	}
+
+	/** The evalf() methods stop at level 1 and throw at the maximum
+	 *  recursion level, otherwise they evaluate their operands at the next
+	 *  level. The terms of a sum go through expairseq::op(), so rests
+	 *  with a coefficient other than 1 are two levels further down. */
+	void operands(const ex & e, int level, std::vector<traversal_operand> & v) const
+	{
+		if (level == 1 || level == -max_recursion_level)
+			return;
+		if (is_exactly_a<add>(e)) {
+			const epvector & seq = traversal_terms(ex_to<expairseq>(e));
+			for (epvector::const_iterator it = seq.begin(); it != seq.end(); ++it) {
+				if (ex_to<numeric>(it->coeff).is_equal(*_num1_p))
+					v.push_back(traversal_operand(it->rest, level - 1));
+				else if (level - 1 != 1 && level - 1 != -max_recursion_level)
+					v.push_back(traversal_operand(it->rest, level - 2));
+			}
+		} else if (is_exactly_a<mul>(e)) {
+			const epvector & seq = traversal_terms(ex_to<expairseq>(e));
+			for (epvector::const_iterator it = seq.begin(); it != seq.end(); ++it)
+				v.push_back(traversal_operand(it->rest, level - 1));
+		} else {
+			const size_t num = e.nops();
+			for (size_t i=0; i<num; ++i)
+				v.push_back(traversal_operand(e.op(i), level - 1));
+		}
+	}
+};
+
+class diff_traversal : public memo_traversal<ex> {
+public:
+	diff_traversal(const symbol & s_) : s(s_) {}
+
+	bool applies_to(const symbol & s_) const
+	{
+		return &s_ == &s;
+	}
+
+protected:
+	ex visit(const ex & e, int level)
+	{
+		return ex_to<basic>(e).diff(s);
+	}
+
+private:
+	const symbol & s;
+};
+
+/** The traversals running in a thread, and the depth of the recursive
+ *  calls since the innermost one was started. */
+struct traversal_state {
+	subs_traversal * subs;
+	has_traversal * has;
+	evalf_traversal * evalf;
+	diff_traversal * diff;
+	unsigned depth;
+};
+
+// Zero-initialized
+#ifdef GINAC_THREAD_SAFE_REFCOUNT
+thread_local traversal_state state;
+#else
+traversal_state state;
+#endif
+
+/** Makes t the current traversal of its kind while it runs. */
+template<class T>
+class traversal_scope {
+public:
+	traversal_scope(T * & current_, T & t)
+	 : current(current_), saved(current_), saved_depth(state.depth)
+	{
+		current = &t;
+		state.depth = 0;
+	}
+
+	~traversal_scope()
+	{
+		current = saved;
+		state.depth = saved_depth;
+	}
+
+private:
+	T * & current;
+	T * const saved;
+	const unsigned saved_depth;
+};
+
+/** Counts a recursive call. */
+class recursion_guard {
+public:
+	recursion_guard() { ++state.depth; }
+	~recursion_guard() { --state.depth; }
+};
+
+} // anonymous namespace
+
+ex traverse_subs(const ex & e, const exmap & m, unsigned options)
+{
+	const basic & b = ex_to<basic>(e);
+	subs_traversal * const current = state.subs;
+	if (b.nops() == 0) {
+		ex result;
+		if (current && current->applies_to(m, options) && current->lookup_symbol(b, result))
+			return result;
+		return b.subs(m, options);
+	}
+
+	if (current && current->applies_to(m, options)) {
+		ex result;
+		if (current->misses(b))
+			return e;
+		if (current->lookup(b, 0, result))
+			return result;
+		if (state.depth < max_traversal_recursion) {
+			recursion_guard g;
+			return b.subs(m, options);
+		}
+	} else if (is_shallow(e))
+		return b.subs(m, options);
+
+	subs_traversal t(m, symbol_subs_options(m, options));
+	if (t.misses(b))
+		return e;
+	traversal_scope<subs_traversal> s(state.subs, t);
+	return t.run(e, 0);
+}
+
+bool traverse_has(const ex & e, const ex & pattern, unsigned options)
+{
+	const basic & b = ex_to<basic>(e);
+	if (b.nops() == 0 || !b.may_contain(pattern))
+		return b.has(pattern, options);
+
+	has_traversal * const current = state.has;
+	if (current && current->applies_to(pattern, options)) {
+		bool result;
+		if (current->lookup(b, 0, result))
+			return result;
+		if (state.depth < max_traversal_recursion) {
+			recursion_guard g;
+			return b.has(pattern, options);
+		}
+	} else if (is_shallow(e))
+		return b.has(pattern, options);
+
+	has_traversal t(pattern, options);
+	traversal_scope<has_traversal> s(state.has, t);
+	return t.run(e, 0);
+}
+
+ex traverse_evalf(const ex & e, int level)
+{
+	const basic & b = ex_to<basic>(e);
+	if (b.nops() == 0)
+		return b.evalf(level);
+
+	evalf_traversal * const current = state.evalf;
+	if (current) {
+		ex result;
+		if (current->lookup(b, level, result))
+			return result;
+		if (state.depth < max_traversal_recursion) {
+			recursion_guard g;
+			return b.evalf(level);
+		}
+	} else if (is_shallow(e))
+		return b.evalf(level);
+
+	if (level == 0)
+		evalf_integrals_concurrently(e);
+	evalf_traversal t;
+	traversal_scope<evalf_traversal> s(state.evalf, t);
+	return t.run(e, level);
+}
+
+/** First derivative of e. */
+static ex traverse_diff1(const ex & e, const symbol & s)
+{
+	const basic & b = ex_to<basic>(e);
+	if (b.nops() == 0)
+		return b.diff(s);
+
+	diff_traversal * const current = state.diff;
+	if (current && current->applies_to(s)) {
+		ex result;
+		if (current->lookup(b, 0, result))
+			return result;
+		if (state.depth < max_traversal_recursion) {
+			recursion_guard g;
+			return b.diff(s);
+		}
+	} else if (is_shallow(e))
+		return b.diff(s);
+
+	diff_traversal t(s);
+	traversal_scope<diff_traversal> scope(state.diff, t);
+	return t.run(e, 0);
+}
+
+ex traverse_diff(const ex & e, const symbol & s, unsigned nth)
+{
+	// Like basic::diff(), one derivative at a time
+	if (nth == 0)
+		return e;
+	if (nth == 1)
+		return traverse_diff1(e, s);
+
+	// Higher derivatives share one traversal, so that the subexpressions
+	// which are carried over from one derivative to the next are
+	// differentiated only once
+	diff_traversal t(s);
+	traversal_scope<diff_traversal> scope(state.diff, t);
+	ex ndiff = t.run(e, 0);
+	while (!ndiff.is_zero() && nth > 1) {
+		ndiff = t.run(ndiff, 0);
+		--nth;
+	}
+	return ndiff;
+}
+
+} // namespace GiNaC
@@ -0,0 +1,58 @@
+/** @file traversal.h
+ *
+ *  Iterative traversal of expressions for subs(), has(), evalf() and
+ *  diff(). */
+
+/*
+ *  GiNaC Copyright (C) 1999-2011 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_TRAVERSAL_H
+#define GINAC_TRAVERSAL_H
+
+#include "ex.h"
+#include "expairseq.h"
+
+namespace GiNaC {
+
+// ex::subs(), ex::has(), ex::evalf() and ex::diff() don't recurse through
+// the methods of the same name. Instead, the distinct subexpressions (by
+// address) are visited in post-order with an explicit stack, and the
+// results are remembered. When the method of an object then asks for the
+// results of its operands, they are looked up, so the C++ stack stays
+// flat, subexpressions which occur several times are only processed once,
+// and since the methods return the original objects where nothing changed,
+// only the changed spine of the expression is rebuilt. Operands whose
+// results were not prepared (like the temporary products made by
+// expairseq::op()) are handled recursively, up to a depth at which a new
+// traversal is started.
+
+/** Depth of recursive calls at which a new traversal is started. */
+const unsigned max_traversal_recursion = 256;
+
+ex traverse_subs(const ex & e, const exmap & m, unsigned options);
+bool traverse_has(const ex & e, const ex & pattern, unsigned options);
+ex traverse_evalf(const ex & e, int level);
+ex traverse_diff(const ex & e, const symbol & s, unsigned nth);
+
+/** The terms of an expairseq, for listing the operands the methods of
+ *  add and mul ask for. */
+const epvector & traversal_terms(const expairseq & s);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_TRAVERSAL_H
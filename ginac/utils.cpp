@@ -62,6 +62,9 @@ unsigned log2(unsigned n)
  *  the static flyweights on the heap. */
 int library_init::count = 0;
 
+// small integers, see small_integer()
+const numeric *_num_small_p;
+
 // static numeric -120
 const numeric *_num_120_p;
 const ex _ex_120 = _ex_120;
@@ -264,56 +267,74 @@ const ex _ex120 = _ex120;
 library_init::library_init()
 {
 	if (count++==0) {
-		(_num_120_p = new numeric(-120))->setflag(status_flags::dynallocated);
-		(_num_60_p = new numeric(-60))->setflag(status_flags::dynallocated);
-		(_num_48_p = new numeric(-48))->setflag(status_flags::dynallocated);
-		(_num_30_p = new numeric(-30))->setflag(status_flags::dynallocated);
-		(_num_25_p = new numeric(-25))->setflag(status_flags::dynallocated);
-		(_num_24_p = new numeric(-24))->setflag(status_flags::dynallocated);
-		(_num_20_p = new numeric(-20))->setflag(status_flags::dynallocated);
-		(_num_18_p = new numeric(-18))->setflag(status_flags::dynallocated);
-		(_num_15_p = new numeric(-15))->setflag(status_flags::dynallocated);
-		(_num_12_p = new numeric(-12))->setflag(status_flags::dynallocated);
-		(_num_11_p = new numeric(-11))->setflag(status_flags::dynallocated);
-		(_num_10_p = new numeric(-10))->setflag(status_flags::dynallocated);
-		(_num_9_p = new numeric(-9))->setflag(status_flags::dynallocated);
-		(_num_8_p = new numeric(-8))->setflag(status_flags::dynallocated);
-		(_num_7_p = new numeric(-7))->setflag(status_flags::dynallocated);
-		(_num_6_p = new numeric(-6))->setflag(status_flags::dynallocated);
-		(_num_5_p = new numeric(-5))->setflag(status_flags::dynallocated);
-		(_num_4_p = new numeric(-4))->setflag(status_flags::dynallocated);
-		(_num_3_p = new numeric(-3))->setflag(status_flags::dynallocated);
-		(_num_2_p = new numeric(-2))->setflag(status_flags::dynallocated);
-		(_num_1_p = new numeric(-1))->setflag(status_flags::dynallocated);
+		// The table holds a reference to each of the small integers, so
+		// they are never deleted through an ex. With atomic reference
+		// counters, they are immortal instead.
+		numeric *small = static_cast<numeric *>(::operator new((small_integer_max - small_integer_min + 1) * sizeof(numeric)));
+		for (long i = small_integer_min; i <= small_integer_max; ++i) {
+			numeric *n = new(small + (i - small_integer_min)) numeric(i);
+			n->setflag(status_flags::dynallocated);
+			n->add_reference();
+			n->make_immortal();
+		}
+		_num_small_p = small - small_integer_min;
+
+		_num_120_p = &small_integer(-120);
+		_num_60_p = &small_integer(-60);
+		_num_48_p = &small_integer(-48);
+		_num_30_p = &small_integer(-30);
+		_num_25_p = &small_integer(-25);
+		_num_24_p = &small_integer(-24);
+		_num_20_p = &small_integer(-20);
+		_num_18_p = &small_integer(-18);
+		_num_15_p = &small_integer(-15);
+		_num_12_p = &small_integer(-12);
+		_num_11_p = &small_integer(-11);
+		_num_10_p = &small_integer(-10);
+		_num_9_p = &small_integer(-9);
+		_num_8_p = &small_integer(-8);
+		_num_7_p = &small_integer(-7);
+		_num_6_p = &small_integer(-6);
+		_num_5_p = &small_integer(-5);
+		_num_4_p = &small_integer(-4);
+		_num_3_p = &small_integer(-3);
+		_num_2_p = &small_integer(-2);
+		_num_1_p = &small_integer(-1);
 		(_num_1_2_p = new numeric(-1,2))->setflag(status_flags::dynallocated);
 		(_num_1_3_p = new numeric(-1,3))->setflag(status_flags::dynallocated);
 		(_num_1_4_p = new numeric(-1,4))->setflag(status_flags::dynallocated);
-		(_num0_p = new numeric(0))->setflag(status_flags::dynallocated);
+		_num0_p = &small_integer(0);
 		_num0_bp  = _num0_p;  // Cf. class ex default ctor.
 		(_num1_4_p = new numeric(1,4))->setflag(status_flags::dynallocated);
 		(_num1_3_p = new numeric(1,3))->setflag(status_flags::dynallocated);
 		(_num1_2_p = new numeric(1,2))->setflag(status_flags::dynallocated);
-		(_num1_p = new numeric(1))->setflag(status_flags::dynallocated);
-		(_num2_p = new numeric(2))->setflag(status_flags::dynallocated);
-		(_num3_p = new numeric(3))->setflag(status_flags::dynallocated);
-		(_num4_p = new numeric(4))->setflag(status_flags::dynallocated);
-		(_num5_p = new numeric(5))->setflag(status_flags::dynallocated);
-		(_num6_p = new numeric(6))->setflag(status_flags::dynallocated);
-		(_num7_p = new numeric(7))->setflag(status_flags::dynallocated);
-		(_num8_p = new numeric(8))->setflag(status_flags::dynallocated);
-		(_num9_p = new numeric(9))->setflag(status_flags::dynallocated);
-		(_num10_p = new numeric(10))->setflag(status_flags::dynallocated);
-		(_num11_p = new numeric(11))->setflag(status_flags::dynallocated);
-		(_num12_p = new numeric(12))->setflag(status_flags::dynallocated);
-		(_num15_p = new numeric(15))->setflag(status_flags::dynallocated);
-		(_num18_p = new numeric(18))->setflag(status_flags::dynallocated);
-		(_num20_p = new numeric(20))->setflag(status_flags::dynallocated);
-		(_num24_p = new numeric(24))->setflag(status_flags::dynallocated);
-		(_num25_p = new numeric(25))->setflag(status_flags::dynallocated);
-		(_num30_p = new numeric(30))->setflag(status_flags::dynallocated);
-		(_num48_p = new numeric(48))->setflag(status_flags::dynallocated);
-		(_num60_p = new numeric(60))->setflag(status_flags::dynallocated);
-		(_num120_p = new numeric(120))->setflag(status_flags::dynallocated);
+		_num1_p = &small_integer(1);
+		_num2_p = &small_integer(2);
+		_num3_p = &small_integer(3);
+		_num4_p = &small_integer(4);
+		_num5_p = &small_integer(5);
+		_num6_p = &small_integer(6);
+		_num7_p = &small_integer(7);
+		_num8_p = &small_integer(8);
+		_num9_p = &small_integer(9);
+		_num10_p = &small_integer(10);
+		_num11_p = &small_integer(11);
+		_num12_p = &small_integer(12);
+		_num15_p = &small_integer(15);
+		_num18_p = &small_integer(18);
+		_num20_p = &small_integer(20);
+		_num24_p = &small_integer(24);
+		_num25_p = &small_integer(25);
+		_num30_p = &small_integer(30);
+		_num48_p = &small_integer(48);
+		_num60_p = &small_integer(60);
+		_num120_p = &small_integer(120);
+		const_cast<numeric *>(_num_1_2_p)->make_immortal();
+		const_cast<numeric *>(_num_1_3_p)->make_immortal();
+		const_cast<numeric *>(_num_1_4_p)->make_immortal();
+		const_cast<numeric *>(_num1_4_p)->make_immortal();
+		const_cast<numeric *>(_num1_3_p)->make_immortal();
+		const_cast<numeric *>(_num1_2_p)->make_immortal();
 
 		new((void*)&_ex_120) ex(*_num_120_p);
 		new((void*)&_ex_60) ex(*_num_60_p);
@@ -365,20 +386,9 @@ library_init::library_init()
 		new((void*)&_ex60) ex(*_num60_p);
 		new((void*)&_ex120) ex(*_num120_p);
 
-		// Initialize print context class info (this is not strictly necessary
-		// but we do it anyway to make print_context_class_info::dump_hierarchy()
-		// output the whole hierarchy whether or not the classes are actually
-		// used)
-		print_context::get_class_info_static();
-		print_dflt::get_class_info_static();
-		print_latex::get_class_info_static();
-		print_python::get_class_info_static();
-		print_python_repr::get_class_info_static();
-		print_tree::get_class_info_static();
-		print_csrc::get_class_info_static();
-		print_csrc_float::get_class_info_static();
-		print_csrc_double::get_class_info_static();
-		print_csrc_cl_N::get_class_info_static();
+		// The class infos of the print contexts are not initialized here
+		// but on first use, so print_context_class_info::dump_hierarchy()
+		// only shows the print contexts used so far
 	}
 }
 
@@ -441,6 +451,19 @@ library_init::~library_init()
 		_ex1_4.~ex();
 		_ex_1_4.~ex();
 		_ex0.~ex();
+
+		// Small integers still referenced by some ex are left alone, as
+		// well as immortal ones, whose references are not known
+		bool all_gone = true;
+		for (long i = small_integer_min; i <= small_integer_max; ++i) {
+			const numeric & n = small_integer(i);
+			if (n.get_refcount() == 1)
+				n.~numeric();
+			else
+				all_gone = false;
+		}
+		if (all_gone)
+			::operator delete(const_cast<numeric *>(_num_small_p + small_integer_min));
 	}
 }
 
@@ -25,6 +25,7 @@
 #define GINAC_UTILS_H
 
 #include "assertion.h"
+#include "basic.h" // for hash_t
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
@@ -48,11 +49,26 @@ class dunno {};
 
 unsigned log2(unsigned n);
 
-/** Rotate bits of unsigned value by one bit to the left.
+/** Rotate bits of a hash value by one bit to the left.
   * This can be necesary if the user wants to define its own hashes. */
-inline unsigned rotate_left(unsigned n)
+inline hash_t rotate_left(hash_t n)
 {
-	return (n & 0x80000000U) ? (n << 1 | 0x00000001U) : (n << 1);
+	return (n << 1) | (n >> (8*sizeof(hash_t) - 1));
+}
+
+/** Combine the hash value h of the first parts of an object with the hash
+ *  value v of its next part. In the default mode this is rotate_left(h)^v,
+ *  with GINAC_HASH64 the result is mixed further by a multiplication and
+ *  an xor-shift, both of which are bijective, so that structured inputs
+ *  don't collide. */
+inline hash_t hash_combine(hash_t h, hash_t v)
+{
+#ifdef GINAC_HASH64
+	h = (rotate_left(h) ^ v) * 0x9e3779b97f4a7c15ULL;
+	return h ^ (h >> 29);
+#else
+	return rotate_left(h) ^ v;
+#endif
 }
 
 /** Compare two pointers (just to establish some sort of canonical order).
@@ -76,8 +92,12 @@ typedef unsigned long p_int;
 #endif
 
 /** Truncated multiplication with golden ratio, for computing hash values. */
-inline unsigned golden_ratio_hash(p_int n)
+inline hash_t golden_ratio_hash(p_int n)
 {
+#ifdef GINAC_HASH64
+	const hash_t h = hash_t(n) * 0x9e3779b97f4a7c15ULL;
+	return h ^ (h >> 32);
+#endif
 	// This function works much better when fast arithmetic with at
 	// least 64 significant bits is available.
 	if (sizeof(long) >= 8) {
@@ -71,8 +71,8 @@
  *	GINACLIB_ARCHIVE_VERSION += 1
  *	GINACLIB_ARCHIVE_AGE = 0
  */
-#define GINACLIB_ARCHIVE_VERSION 3
-#define GINACLIB_ARCHIVE_AGE 3
+#define GINACLIB_ARCHIVE_VERSION 5
+#define GINACLIB_ARCHIVE_AGE 5
 
 #define GINACLIB_STR_HELPER(x) #x
 #define GINACLIB_STR(x) GINACLIB_STR_HELPER(x)
@@ -102,15 +102,16 @@ void wildcard::do_print_python_repr(const print_python_repr & c, unsigned level)
 	c.s << class_name() << '(' << label << ')';
 }
 
-unsigned wildcard::calchash() const
+hash_t wildcard::calchash() const
 {
 	// this is where the schoolbook method
 	// (golden_ratio_hash(typeid(*this).name()) ^ label)
 	// is not good enough yet...
-	unsigned seed = make_hash_seed(typeid(*this));
-	hashvalue = golden_ratio_hash(seed ^ label);
+	hash_t seed = make_hash_seed(typeid(*this));
+	const hash_t v = golden_ratio_hash(seed ^ label);
+	hashvalue = v;
 	setflag(status_flags::hash_calculated);
-	return hashvalue;
+	return v;
 }
 
 bool wildcard::match(const ex & pattern, exmap& repl_lst) const
@@ -48,7 +48,7 @@ public:
 	/** Read (a.k.a. deserialize) object from archive. */
 	void read_archive(const archive_node& n, lst& syms);
 protected:
-	unsigned calchash() const;
+	hash_t calchash() const;
 
 	// non-virtual functions in this class
 public:
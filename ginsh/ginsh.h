@@ -29,6 +29,7 @@
 #include <map>
 #include <iostream>
 #include <string>
+#include <unordered_map>
 
 using namespace std;
 
@@ -66,7 +67,7 @@ extern int num_files;
 extern char **file_list;
 
 // Table of all used symbols
-typedef map<string, ex> sym_tab;
+typedef unordered_map<string, ex> sym_tab;
 extern sym_tab syms;
 
 // Type of symbols to generate (real or complex)
@@ -38,10 +38,16 @@
 
 #ifdef HAVE_UNISTD_H
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #endif
 
+#include <chrono>
+#include <ctime>
+#include <fstream>
 #include <stdexcept>
+#include <unordered_map>
+#include <vector>
 
 #include "ginsh.h"
 
@@ -63,7 +69,7 @@ static const char *orig_basic_word_break_characters;
 static void push(const ex &e);
 static ex exstack[3];
 // Assigned symbols
-static exmap assigned_symbol_table;
+static exhashmap<ex> assigned_symbol_table;
 
 // Start and end time for the time() function
 #ifdef HAVE_RUSAGE
@@ -84,6 +90,15 @@ static std::clock_t start_time, end_time;
   cout << double(end_time - start_time)/CLOCKS_PER_SEC << 's' << endl;
 #endif
 
+// Batch mode: resources used by every statement, reported on stderr
+static bool batch_mode = false;
+static unsigned long statement_number = 0;
+static std::clock_t statement_cpu;
+static std::chrono::steady_clock::time_point statement_wall;
+static unsigned long long statement_alloc;
+static void batch_start_statement(void);
+static void batch_report_statement(void);
+
 // Table of functions (a multimap, because one function may appear with different
 // numbers of parameters)
 typedef ex (*fcnp)(const exprseq &e);
@@ -103,6 +118,13 @@ struct fcn_desc {
 typedef multimap<string, fcn_desc> fcn_tab;
 static fcn_tab fcns;
 
+// Hashed index of fcns for calls: the entries of each name, in the order in
+// which they were inserted
+typedef unordered_map<string, vector<fcn_tab::const_iterator> > fcn_index;
+static fcn_index fcns_by_name;
+
+static void insert_fcn(const string &name, const fcn_desc &desc);
+
 static fcn_tab::const_iterator find_function(const ex &sym, int req_params);
 
 // Table to map help topics to help strings
@@ -141,7 +163,7 @@ static void print_help_topics(void);
 
 %%
 input	: /* empty */
-	| input line
+	| input line		{if (batch_mode) batch_report_statement();}
 	;
 
 line	: ';'
@@ -238,7 +260,7 @@ line	: ';'
 
 exp	: T_NUMBER		{$$ = $1;}
 	| T_SYMBOL		{
-		exmap::const_iterator i = assigned_symbol_table.find($1);
+		exhashmap<ex>::const_iterator i = assigned_symbol_table.find($1);
 		if (i == assigned_symbol_table.end())
 			$$ = $1;
 		else
@@ -280,7 +302,7 @@ exp	: T_NUMBER		{$$ = $1;}
 	;
 
 exprseq	: exp			{$$ = exprseq($1);}
-	| exprseq ',' exp	{exprseq es(ex_to<exprseq>($1)); $$ = es.append($3);}
+	| exprseq ',' exp	{$$ = 0; $$.swap($1); append_to<exprseq>($$, $3);}
 	;
 
 list_or_empty: /* empty */	{$$ = *new lst;}
@@ -288,15 +310,15 @@ list_or_empty: /* empty */	{$$ = *new lst;}
 	;
 
 list	: exp			{$$ = lst($1);}
-	| list ',' exp		{lst l(ex_to<lst>($1)); $$ = l.append($3);}
+	| list ',' exp		{$$ = 0; $$.swap($1); append_to<lst>($$, $3);}
 	;
 
 matrix	: '[' row ']'		{$$ = lst($2);}
-	| matrix ',' '[' row ']' {lst l(ex_to<lst>($1)); $$ = l.append($4);}
+	| matrix ',' '[' row ']' {$$ = 0; $$.swap($1); append_to<lst>($$, $4);}
 	;
 
 row	: exp			{$$ = lst($1);}
-	| row ',' exp		{lst l(ex_to<lst>($1)); $$ = l.append($3);}
+	| row ',' exp		{$$ = 0; $$.swap($1); append_to<lst>($$, $3);}
 	;
 
 
@@ -579,7 +601,7 @@ static ex f_transpose(const exprseq &e)
 static ex f_unassign(const exprseq &e)
 {
 	CHECK_ARG(0, symbol, unassign);
-	exmap::iterator i = assigned_symbol_table.find(e[0]);
+	exhashmap<ex>::iterator i = assigned_symbol_table.find(e[0]);
 	if (i != assigned_symbol_table.end())
 		assigned_symbol_table.erase(i);
 	return e[0];
@@ -718,11 +740,16 @@ static const fcn_help_init builtin_help[] = {
  *  Add functions to ginsh
  */
 
+static void insert_fcn(const string &name, const fcn_desc &desc)
+{
+	fcns_by_name[name].push_back(fcns.insert(make_pair(name, desc)));
+}
+
 // Functions from fcn_init array
 static void insert_fcns(const fcn_init *p)
 {
 	while (p->name) {
-		fcns.insert(make_pair(string(p->name), fcn_desc(p->p, p->num_params)));
+		insert_fcn(p->name, fcn_desc(p->p, p->num_params));
 		p++;
 	}
 }
@@ -740,7 +767,7 @@ static void ginsh_get_ginac_functions(void)
 	vector<function_options>::const_iterator i = gfv.begin(), end = gfv.end();
 	unsigned serial = 0;
 	while (i != end) {
-		fcns.insert(make_pair(i->get_name(), fcn_desc(f_ginac_function, i->get_nparams(), serial)));
+		insert_fcn(i->get_name(), fcn_desc(f_ginac_function, i->get_nparams(), serial));
 		++i;
 		serial++;
 	}
@@ -755,14 +782,13 @@ static void ginsh_get_ginac_functions(void)
 static fcn_tab::const_iterator find_function(const ex &sym, int req_params)
 {
 	const string &name = ex_to<symbol>(sym).get_name();
-	typedef fcn_tab::const_iterator I;
-	pair<I, I> b = fcns.equal_range(name);
-	if (b.first == b.second)
+	fcn_index::const_iterator b = fcns_by_name.find(name);
+	if (b == fcns_by_name.end())
 		throw(std::logic_error("unknown function '" + name + "'"));
 	else {
-		for (I i=b.first; i!=b.second; i++)
-			if ((i->second.num_params == 0) || (i->second.num_params == req_params))
-				return i;
+		for (vector<fcn_tab::const_iterator>::const_iterator i=b->second.begin(); i!=b->second.end(); ++i)
+			if (((*i)->second.num_params == 0) || ((*i)->second.num_params == req_params))
+				return *i;
 	}
 	throw(std::logic_error("invalid number of arguments to " + name + "()"));
 }
@@ -899,6 +925,136 @@ static void ginsh_readline_init(char* name)
 #endif // HAVE_LIBREADLINE
 }
 
+/*
+ *  Batch mode
+ */
+
+static void batch_start_statement(void)
+{
+	statement_cpu = std::clock();
+	statement_wall = std::chrono::steady_clock::now();
+	statement_alloc = basic_alloc_bytes();
+}
+
+// One line per statement: number, CPU and wall clock time in seconds, bytes
+// of expression objects allocated, and the peak memory of the process in
+// kilobytes (if available)
+static void batch_report_statement(void)
+{
+	const double cpu = double(std::clock() - statement_cpu) / CLOCKS_PER_SEC;
+	const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - statement_wall).count();
+	cout << flush;
+	cerr << "#stat statement=" << ++statement_number
+	     << " cpu=" << cpu << " wall=" << wall
+	     << " alloc=" << basic_alloc_bytes() - statement_alloc;
+#ifdef HAVE_RUSAGE
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	cerr << " maxrss=" << usage.ru_maxrss;
+#endif
+	cerr << endl;
+	batch_start_statement();
+}
+
+// Run the scripts named in list_name (one per line) in up to jobs processes
+// at once, with the output of each script going to the file <script>.out.
+// One line is reported per finished script. Returns the number of scripts
+// which failed.
+static int run_script_list(const char *list_name, unsigned jobs)
+{
+	std::ifstream list(list_name);
+	if (!list) {
+		cerr << "Can't open " << list_name << endl;
+		return 1;
+	}
+	std::vector<string> scripts;
+	string name;
+	while (std::getline(list, name)) {
+		if (!name.empty() && name[0] != '#')
+			scripts.push_back(name);
+	}
+
+#ifdef HAVE_UNISTD_H
+	if (jobs == 0) {
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+		jobs = n > 0 ? n : 1;
+	}
+
+	typedef std::map<pid_t, std::pair<size_t, std::chrono::steady_clock::time_point> > job_map;
+	job_map running;
+	size_t next = 0;
+	int failed = 0;
+	cout << flush;
+	while (next < scripts.size() || !running.empty()) {
+
+		// Start scripts while there are free slots
+		while (next < scripts.size() && running.size() < jobs) {
+			const pid_t pid = fork();
+			if (pid == 0) {
+				const string out = scripts[next] + ".out";
+				if (!freopen(out.c_str(), "w", stdout) || !freopen(out.c_str(), "a", stderr))
+					_exit(127);
+				setvbuf(stderr, NULL, _IONBF, 0);
+				yyin = fopen(scripts[next].c_str(), "r");
+				if (yyin == NULL) {
+					cerr << "Can't open " << scripts[next] << endl;
+					_exit(1);
+				}
+				if (!freopen("/dev/null", "r", stdin))
+					_exit(127);
+				num_files = 0;
+				batch_start_statement();
+				int result;
+				try {
+					result = yyparse();
+				} catch (exception &e) {
+					cerr << e.what() << endl;
+					result = 1;
+				}
+				cout << flush;
+				_exit(result);
+			} else if (pid < 0) {
+				cerr << "Can't run " << scripts[next] << endl;
+				++failed;
+			} else
+				running[pid] = std::make_pair(next, std::chrono::steady_clock::now());
+			++next;
+		}
+		if (running.empty())
+			continue;
+
+		// Wait for one of them
+		int status;
+#ifdef HAVE_RUSAGE
+		struct rusage usage;
+		const pid_t pid = wait4(-1, &status, 0, &usage);
+#else
+		const pid_t pid = waitpid(-1, &status, 0);
+#endif
+		job_map::iterator job = running.find(pid);
+		if (job == running.end())
+			continue;
+		const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - job->second.second).count();
+		const int code = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+		if (code != 0)
+			++failed;
+		cerr << "#script name=" << scripts[job->second.first]
+		     << " status=" << code << " wall=" << wall;
+#ifdef HAVE_RUSAGE
+		cerr << " cpu=" << usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+		                   + double(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6
+		     << " maxrss=" << usage.ru_maxrss;
+#endif
+		cerr << endl;
+		running.erase(job);
+	}
+	return failed;
+#else
+	cerr << "Running scripts in parallel is not supported on this system" << endl;
+	return scripts.size();
+#endif
+}
+
 void greeting(void)
 {
     cout << "ginsh - GiNaC Interactive Shell (GiNaC V" << GINACLIB_VERSION << ")" << endl;
@@ -913,12 +1069,37 @@ void greeting(void)
  *  Main program
  */
 
+static void usage(const char *name)
+{
+	cerr << "Usage: " << name << " [--batch] [--jobs=n --script-list=file] [file...]" << endl;
+	exit(1);
+}
+
 int main(int argc, char **argv)
 {
+	// Options
+	const char *script_list = NULL;
+	unsigned jobs = 0;
+	int arg = 1;
+	for (; arg < argc && strncmp(argv[arg], "--", 2) == 0; ++arg) {
+		const string opt = argv[arg];
+		if (opt == "--") {
+			++arg;
+			break;
+		} else if (opt == "--batch")
+			batch_mode = true;
+		else if (opt.compare(0, 7, "--jobs=") == 0)
+			jobs = atoi(argv[arg] + 7);
+		else if (opt.compare(0, 14, "--script-list=") == 0)
+			script_list = argv[arg] + 14;
+		else
+			usage(argv[0]);
+	}
+
 	// Print banner in interactive mode
-	if (isatty(0)) 
+	if (isatty(0) && !batch_mode && !script_list)
 		greeting();
-	assigned_symbol_table = exmap();
+	assigned_symbol_table = exhashmap<ex>();
 
 	// Init function table
 	insert_fcns(builtin_fcns);
@@ -944,9 +1125,13 @@ int main(int argc, char **argv)
 
 	ginsh_readline_init(argv[0]);
 
+	// Independent scripts
+	if (script_list)
+		return run_script_list(script_list, jobs) ? 1 : 0;
+
 	// Init input file list, open first file
-	num_files = argc - 1;
-	file_list = argv + 1;
+	num_files = argc - arg;
+	file_list = argv + arg;
 	if (num_files) {
 		yyin = fopen(*file_list, "r");
 		if (yyin == NULL) {
@@ -958,6 +1143,8 @@ int main(int argc, char **argv)
 	}
 
 	// Parse input, catch all remaining exceptions
+	if (batch_mode)
+		batch_start_statement();
 	int result;
 again:	try {
 		result = yyparse();
@@ -23,32 +23,158 @@
 #include "ginac.h"
 using namespace GiNaC;
 
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
 #include <stdexcept>
+#include <vector>
 using namespace std;
 
+/** Open an archive file for inspection. Indexed archives are used in place;
+ *  archives in the stream format are read once and converted. */
+static indexed_archive *open_indexed(const char *filename, std::string &buffer)
+{
+	try {
+		return new indexed_archive(filename);
+	} catch (std::runtime_error &) {
+		std::ifstream f(filename, std::ios_base::binary);
+		archive ar;
+		f >> ar;
+		std::ostringstream os;
+		ar.write_indexed(os);
+		buffer = os.str();
+		return new indexed_archive(buffer.data(), buffer.size());
+	}
+}
+
+/** Visit the nodes reachable from a root once each, calling f with the
+ *  information about every node. */
+template <class F>
+static void walk(const indexed_archive &ar, archive_node_id root, std::vector<unsigned> &stamp, unsigned mark, F f)
+{
+	std::vector<archive_node_id> stack(1, root);
+	stamp[root] = mark;
+	indexed_archive::node_info info;
+	while (!stack.empty()) {
+		archive_node_id id = stack.back();
+		stack.pop_back();
+		ar.get_node_info(id, info);
+		f(info);
+		for (size_t i=0; i<info.children.size(); ++i) {
+			archive_node_id c = info.children[i];
+			if (stamp[c] != mark) {
+				stamp[c] = mark;
+				stack.push_back(c);
+			}
+		}
+	}
+}
+
+struct count_nodes {
+	count_nodes(size_t &n, size_t &b) : nodes(n), bytes(b) {}
+	void operator()(const indexed_archive::node_info &info) { ++nodes; bytes += info.size; }
+	size_t &nodes, &bytes;
+};
+
+struct count_classes {
+	typedef std::map<std::string, std::pair<size_t, size_t> > histogram;
+	explicit count_classes(histogram &h) : hist(h) {}
+	void operator()(const indexed_archive::node_info &info)
+	{
+		std::pair<size_t, size_t> &c = hist[info.class_name];
+		++c.first;
+		c.second += info.size;
+	}
+	histogram &hist;
+};
+
+static bool more_nodes(const std::pair<std::string, std::pair<size_t, size_t> > &a,
+                       const std::pair<std::string, std::pair<size_t, size_t> > &b)
+{
+	return a.second.first > b.second.first;
+}
+
+/** Print name, number of nodes and size of each archived expression. */
+static void list_expressions(const indexed_archive &ar)
+{
+	std::vector<unsigned> stamp(ar.num_nodes(), 0);
+	for (unsigned i=0; i<ar.num_expressions(); ++i) {
+		size_t nodes = 0, bytes = 0;
+		walk(ar, ar.get_root(i), stamp, i + 1, count_nodes(nodes, bytes));
+		std::cout << ar.get_name(i) << ": " << nodes << " nodes, " << bytes << " bytes" << std::endl;
+	}
+}
+
+/** Print the number of nodes and their size for each class. Shared nodes
+ *  are counted once. */
+static void class_histogram(const indexed_archive &ar)
+{
+	std::vector<unsigned> stamp(ar.num_nodes(), 0);
+	count_classes::histogram hist;
+	for (unsigned i=0; i<ar.num_expressions(); ++i) {
+		if (stamp[ar.get_root(i)] == 0)
+			walk(ar, ar.get_root(i), stamp, 1, count_classes(hist));
+	}
+	std::vector<std::pair<std::string, std::pair<size_t, size_t> > > v(hist.begin(), hist.end());
+	std::stable_sort(v.begin(), v.end(), more_nodes);
+	for (size_t i=0; i<v.size(); ++i)
+		std::cout << v[i].first << ": " << v[i].second.first << " nodes, " << v[i].second.second << " bytes" << std::endl;
+}
+
 int main(int argc, char **argv)
 {
 	if (argc < 2) {
-		cerr << "Usage: " << argv[0] << " [-d] file..." << endl;
+		cerr << "Usage: " << argv[0] << " [-d | -l | -c | -x name] file..." << endl;
 		exit(1);
 	}
 	--argc; ++argv;
 
-	bool dump_mode = false;
+	enum { print_mode, dump_mode, list_mode, class_mode, extract_mode } mode = print_mode;
+	const char *extract_name = 0;
 	try {
 		lst l;
 		while (argc) {
 			if (strcmp(*argv, "-d") == 0) {
-				dump_mode = true;
+				mode = dump_mode;
+				--argc; ++argv;
+				continue;
+			} else if (strcmp(*argv, "-l") == 0) {
+				mode = list_mode;
+				--argc; ++argv;
+				continue;
+			} else if (strcmp(*argv, "-c") == 0) {
+				mode = class_mode;
+				--argc; ++argv;
+				continue;
+			} else if (strcmp(*argv, "-x") == 0 && argc > 1) {
+				mode = extract_mode;
+				extract_name = argv[1];
+				argc -= 2; argv += 2;
+				continue;
+			}
+			if (mode == list_mode || mode == class_mode || mode == extract_mode) {
+				std::string buffer;
+				std::unique_ptr<indexed_archive> ar(open_indexed(*argv, buffer));
+				if (mode == list_mode)
+					list_expressions(*ar);
+				else if (mode == class_mode)
+					class_histogram(*ar);
+				else {
+					text_writer out(1);
+					out << extract_name << " = " << ar->unarchive_ex(l, extract_name) << '\n';
+				}
 				--argc; ++argv;
+				continue;
 			}
 			std::ifstream f(*argv, std::ios_base::binary);
 			archive ar;
 			f >> ar;
-			if (dump_mode) {
+			if (mode == dump_mode) {
 				ar.printraw(std::cout);
 				std::cout << std::endl;
 			} else {